@@ -1,13 +1,27 @@
 #!/bin/bash
 set -e
 
-#throw all the text into one big header
+#throw all the text into one big header, const so it stays in read only data
 code=
 for f in "${@}"; do
-	code="$(xxd -i ${f})
+	code="$(xxd -i ${f} | sed -e "s/^unsigned/const unsigned/")
 ${code}"
 done
 
+#every language tag and alias a locale answers to
+tags=
+for f in "${@}"; do
+	key="${f%.*}"
+	tags="${tags}${key} ${key}
+$(jq -r ".aliases[]" ${f} | sed -e "s/$/ ${key}/")
+"
+done
+duplicates="$(echo "${tags}" | awk 'NF { print $1 }' | sort | uniq -d)"
+if [ -n "${duplicates}" ]; then
+	echo "Locale tags or aliases used more than once: ${duplicates}" 1>&2
+	exit 1
+fi
+
 #output the code
 echo "#include <unordered_map>"
 echo "${code}"
@@ -18,6 +32,9 @@ for f in "${@}"; do
 	echo "  {\"${key}\", {${var}, ${var} + ${var}_len}},"
 done
 echo "};";
+echo "const std::unordered_map<std::string, std::string> locales_tags = {";
+echo "${tags}" | awk 'NF { print "  {\"" $1 "\", \"" $2 "\"}," }'
+echo "};";
 
 #install locales locally for testing
 for loc in $(jq ".posix_locale" *.json | sed -e 's/"//g'); do
@@ -0,0 +1,150 @@
+#include "baldr/chgraph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Current version of the overlay file
+constexpr uint32_t kCHGraphVersion = 2;
+
+// Magic bytes at the beginning of every overlay file
+constexpr char kCHGraphMagic[4] = {'V', 'C', 'H', 'G'};
+
+// Fixed size header at the beginning of the overlay file
+struct CHGraphHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t node_count;
+  uint64_t fwd_arc_count;
+  uint64_t bwd_arc_count;
+  char costing[32];
+};
+
+template <class T>
+void write_vector(std::ofstream& out, const std::vector<T>& v) {
+  out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <class T>
+void read_vector(std::ifstream& in, std::vector<T>& v, const uint64_t count) {
+  v.resize(count);
+  in.read(reinterpret_cast<char*>(v.data()), count * sizeof(T));
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+CHGraph::CHGraph() : fwd_offsets_(1, 0), bwd_offsets_(1, 0) {
+}
+
+CHGraph::CHGraph(const std::string& costing, std::vector<GraphId>&& edges,
+                 std::vector<uint32_t>&& fwd_offsets, std::vector<CHArc>&& fwd_arcs,
+                 std::vector<uint32_t>&& bwd_offsets, std::vector<CHArc>&& bwd_arcs)
+    : costing_(costing), edges_(std::move(edges)),
+      fwd_offsets_(std::move(fwd_offsets)), fwd_arcs_(std::move(fwd_arcs)),
+      bwd_offsets_(std::move(bwd_offsets)), bwd_arcs_(std::move(bwd_arcs)) {
+  if (fwd_offsets_.size() != edges_.size() + 1 || bwd_offsets_.size() != edges_.size() + 1 ||
+      fwd_offsets_.back() != fwd_arcs_.size() || bwd_offsets_.back() != bwd_arcs_.size())
+    throw std::runtime_error("Contraction hierarchy arc offsets do not match its nodes and arcs");
+}
+
+CHGraph CHGraph::Load(const std::string& file_name) {
+  std::ifstream in(file_name, std::ios::in | std::ios::binary);
+  if (!in.is_open())
+    throw std::runtime_error("Could not open contraction hierarchy " + file_name);
+
+  CHGraphHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, kCHGraphMagic, sizeof(header.magic)) != 0 ||
+      header.version != kCHGraphVersion)
+    throw std::runtime_error(file_name + " is not a contraction hierarchy");
+
+  CHGraph graph;
+  header.costing[sizeof(header.costing) - 1] = '\0';
+  graph.costing_ = header.costing;
+  read_vector(in, graph.edges_, header.node_count);
+  read_vector(in, graph.fwd_offsets_, header.node_count + 1);
+  read_vector(in, graph.fwd_arcs_, header.fwd_arc_count);
+  read_vector(in, graph.bwd_offsets_, header.node_count + 1);
+  read_vector(in, graph.bwd_arcs_, header.bwd_arc_count);
+  if (!in || graph.fwd_offsets_.back() != graph.fwd_arcs_.size() ||
+      graph.bwd_offsets_.back() != graph.bwd_arcs_.size())
+    throw std::runtime_error("Contraction hierarchy " + file_name + " is truncated");
+  return graph;
+}
+
+void CHGraph::Write(const std::string& file_name) const {
+  CHGraphHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kCHGraphMagic, sizeof(header.magic));
+  header.version = kCHGraphVersion;
+  header.node_count = edges_.size();
+  header.fwd_arc_count = fwd_arcs_.size();
+  header.bwd_arc_count = bwd_arcs_.size();
+  if (costing_.size() >= sizeof(header.costing))
+    throw std::runtime_error("Costing name is too long for a contraction hierarchy");
+  std::memcpy(header.costing, costing_.data(), costing_.size());
+
+  std::ofstream out(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open())
+    throw std::runtime_error("Could not open " + file_name + " for writing");
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_vector(out, edges_);
+  write_vector(out, fwd_offsets_);
+  write_vector(out, fwd_arcs_);
+  write_vector(out, bwd_offsets_);
+  write_vector(out, bwd_arcs_);
+  out.close();
+  if (!out)
+    throw std::runtime_error("Failed to write contraction hierarchy " + file_name);
+}
+
+std::string CHGraph::FileName(const std::string& tile_dir, const std::string& costing) {
+  return tile_dir + (tile_dir.empty() || tile_dir.back() == '/' ? "" : "/") +
+         costing + kCHGraphExtension;
+}
+
+uint32_t CHGraph::node(const GraphId& edgeid) const {
+  auto itr = std::lower_bound(edges_.cbegin(), edges_.cend(), edgeid,
+      [](const GraphId& a, const GraphId& b) { return a.value < b.value; });
+  return (itr != edges_.cend() && *itr == edgeid) ? itr - edges_.cbegin() : kInvalidCHNode;
+}
+
+void CHGraph::Unpack(const uint32_t from, const uint32_t to, const CHArc& arc,
+                     std::vector<std::pair<uint32_t, float> >& nodes) const {
+  // Shortcuts are split into their two halves until only original arcs
+  // remain. Keep the halves still to be done on a stack, last one first.
+  struct todo_t { uint32_t from; uint32_t to; CHArc arc; };
+  std::vector<todo_t> todo{{from, to, arc}};
+  while (!todo.empty()) {
+    todo_t t = todo.back();
+    todo.pop_back();
+    if (t.arc.middle == kInvalidCHNode) {
+      nodes.emplace_back(t.to, t.arc.secs);
+      continue;
+    }
+
+    // The middle node is lower ranked than both ends. The arc into it is one
+    // of its backward arcs and the arc out of it one of its forward arcs.
+    const CHArc* in = nullptr;
+    for (const auto& a : backward(t.arc.middle))
+      if (a.node == t.from && (in == nullptr || a.cost < in->cost))
+        in = &a;
+    const CHArc* out = nullptr;
+    for (const auto& a : forward(t.arc.middle))
+      if (a.node == t.to && (out == nullptr || a.cost < out->cost))
+        out = &a;
+    if (in == nullptr || out == nullptr)
+      throw std::runtime_error("Contraction hierarchy shortcut can not be unpacked");
+    todo.push_back({t.arc.middle, t.to, *out});
+    todo.push_back({t.from, t.arc.middle, *in});
+  }
+}
+
+}
+}
@@ -1,4 +1,6 @@
 #include <boost/filesystem.hpp>
+#include <cstring>
+#include <fstream>
 #include <list>
 #include <iomanip>
 #include <random>
@@ -209,44 +211,136 @@ namespace {
 
 namespace valhalla {
   namespace baldr {
-    connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt) {
+    connectivity_map_t::connectivity_map_t(const boost::property_tree::ptree& pt, const bool use_file) {
+      transit_level = TileHierarchy::levels().rbegin()->second.level + 1;
+      levels.resize(transit_level + 1, level_colors_t{nullptr, 0});
+
+      // Map the colors if they were already found by valhalla_build_connectivity
+      auto file_name = pt.get<std::string>("connectivity_map", "");
+      if (use_file && !file_name.empty() && load(file_name)) {
+        LOG_INFO("Mapped connectivity map from " + file_name);
+        return;
+      }
+
       // See what kind of tiles we are dealing with here by getting a graphreader
       GraphReader reader(pt);
       auto tiles = reader.GetTileSet();
-      transit_level = TileHierarchy::levels().rbegin()->second.level + 1;
 
       // Populate a map for each level of the tiles that exist
+      std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t> > colors;
       for(const auto& t : tiles) {
         auto& level_colors = colors.insert({t.level(), std::unordered_map<uint32_t, size_t>{}}).first->second;
         level_colors.insert({t.tileid(), 0});
       }
 
       // All tiles have color 0 (not connected), go through and connect
-      // (build the ColorMap). Transit level uses local hierarchy tiles
+      // (build the ColorMap). Transit level uses local hierarchy tiles.
+      // Then flatten the colors into an array per level
+      owned.reserve(colors.size());
       for (auto& color : colors) {
-        if (color.first == transit_level)
-          TileHierarchy::levels().rbegin()->second.tiles.ColorMap(color.second);
-        else
-          TileHierarchy::levels().find(color.first)->second.tiles.ColorMap(color.second);
+        if (color.first > transit_level)
+          continue;
+        const auto& level_tiles = color.first == transit_level ?
+          TileHierarchy::levels().rbegin()->second.tiles :
+          TileHierarchy::levels().find(color.first)->second.tiles;
+        level_tiles.ColorMap(color.second);
+        owned.emplace_back(level_tiles.TileCount(), 0);
+        auto& flat = owned.back();
+        for (const auto& tile : color.second) {
+          if (tile.first < flat.size())
+            flat[tile.first] = static_cast<uint32_t>(tile.second);
+        }
+        levels[color.first] = level_colors_t{flat.data(), static_cast<uint32_t>(flat.size())};
+      }
+    }
+
+    // The file is a magic string, the number of levels, the number of tiles of each level
+    // (0 for levels without tiles) and then the colors of each level one after the other
+    namespace {
+      constexpr char kConnectivityMagic[8] = {'V', 'C', 'O', 'N', 'N', 'M', 'A', 'P'};
+      struct connectivity_header_t {
+        char magic[8];
+        uint32_t level_count;
+        uint32_t spare;
+      };
+    }
+
+    bool connectivity_map_t::load(const std::string& file_name) {
+      try {
+        if (!boost::filesystem::exists(file_name))
+          throw std::runtime_error("Missing file");
+        auto size = boost::filesystem::file_size(file_name);
+        if (size < sizeof(connectivity_header_t))
+          throw std::runtime_error("File too small");
+        mapped.reset(new midgard::mem_map<char>(file_name, size, POSIX_MADV_NORMAL, true));
+
+        // Make sure its for this tile hierarchy
+        const auto* header = reinterpret_cast<const connectivity_header_t*>(mapped->get());
+        if (memcmp(header->magic, kConnectivityMagic, sizeof(kConnectivityMagic)) != 0)
+          throw std::runtime_error("Not a connectivity map");
+        if (header->level_count != levels.size())
+          throw std::runtime_error("Wrong number of levels");
+        const auto* counts = reinterpret_cast<const uint32_t*>(header + 1);
+        size_t expected = sizeof(connectivity_header_t) + levels.size() * sizeof(uint32_t);
+        for (uint32_t level = 0; level < levels.size(); ++level) {
+          auto tiles = TileHierarchy::levels().find(level == transit_level ? transit_level - 1 : level);
+          if (counts[level] != 0 && (tiles == TileHierarchy::levels().cend() ||
+                                     counts[level] != tiles->second.tiles.TileCount()))
+            throw std::runtime_error("Wrong number of tiles for level " + std::to_string(level));
+          expected += counts[level] * sizeof(uint32_t);
+        }
+        if (size != expected)
+          throw std::runtime_error("Wrong size");
+
+        // Point at the colors of each level
+        const auto* colors = counts + levels.size();
+        for (uint32_t level = 0; level < levels.size(); ++level) {
+          levels[level] = level_colors_t{counts[level] ? colors : nullptr, counts[level]};
+          colors += counts[level];
+        }
+        return true;
+      } catch (const std::exception& e) {
+        LOG_WARN("Could not map connectivity map " + file_name + ": " + e.what());
       }
+      mapped.reset();
+      levels.assign(levels.size(), level_colors_t{nullptr, 0});
+      return false;
+    }
+
+    void connectivity_map_t::save(const std::string& file_name) const {
+      std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!file)
+        throw std::runtime_error("Failed to open " + file_name);
+      connectivity_header_t header;
+      memcpy(header.magic, kConnectivityMagic, sizeof(kConnectivityMagic));
+      header.level_count = levels.size();
+      header.spare = 0;
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      for (const auto& level : levels)
+        file.write(reinterpret_cast<const char*>(&level.count), sizeof(level.count));
+      for (const auto& level : levels)
+        file.write(reinterpret_cast<const char*>(level.colors), level.count * sizeof(uint32_t));
+      if (!file)
+        throw std::runtime_error("Failed to write " + file_name);
+    }
+
+    const connectivity_map_t::level_colors_t* connectivity_map_t::find_level(const uint32_t level) const {
+      return level < levels.size() && levels[level].count ? &levels[level] : nullptr;
     }
 
     size_t connectivity_map_t::get_color(const GraphId& id) const {
-      auto level = colors.find(id.level());
-      if(level == colors.cend())
+      auto level = find_level(id.level());
+      if(level == nullptr || id.tileid() >= level->count)
         return 0;
-      auto color = level->second.find(id.tileid());
-      if(color == level->second.cend())
-        return 0;
-      return color->second;
+      return level->colors[id.tileid()];
     }
 
     std::unordered_set<size_t> connectivity_map_t::get_colors(uint32_t hierarchy_level,
       const baldr::PathLocation& location, float radius) const {
 
       std::unordered_set<size_t> result;
-      auto level = colors.find(hierarchy_level);
-      if(level == colors.cend())
+      auto level = find_level(hierarchy_level);
+      if(level == nullptr)
         return result;
       const auto& tiles = TileHierarchy::levels().find(hierarchy_level)->second.tiles;
       for(const auto& edge : location.edges) {
@@ -259,9 +353,9 @@ namespace valhalla {
                             Point2(ll.lng() + lngdeg, ll.lat() + latdeg));
         std::vector<int32_t> tilelist = tiles.TileList(bbox);
         for (auto& id : tilelist) {
-          auto color = level->second.find(id);
-          if(color != level->second.cend())
-            result.emplace(color->second);
+          // Only tiles that exist have a color
+          if(id >= 0 && static_cast<uint32_t>(id) < level->count && level->colors[id] != 0)
+            result.emplace(level->colors[id]);
         }
       }
       return result;
@@ -277,14 +371,11 @@ namespace valhalla {
       //make a region map (inverse mapping of color to lists of tiles)
       //could cache this but shouldnt need to call it much
       std::unordered_map<size_t, std::unordered_set<uint32_t> > regions;
-      auto level = colors.find(hierarchy_level);
-      if(level != colors.cend()) {
-        for(const auto& tile : level->second) {
-          auto region = regions.find(tile.second);
-          if(region == regions.end())
-            regions.emplace(tile.second, std::unordered_set<uint32_t>{tile.first});
-          else
-            region->second.emplace(tile.first);
+      auto level = find_level(hierarchy_level);
+      if(level != nullptr) {
+        for(uint32_t tile = 0; tile < level->count; ++tile) {
+          if(level->colors[tile] != 0)
+            regions[level->colors[tile]].emplace(tile);
         }
       }
 
@@ -312,13 +403,10 @@ namespace valhalla {
         throw std::runtime_error("hierarchy level not found");
 
       std::vector<size_t> tiles(bbox->second.tiles.nrows() * bbox->second.tiles.ncolumns(), static_cast<uint32_t>(0));
-      auto level = colors.find(hierarchy_level);
-      if (level != colors.cend()) {
-        for(size_t i = 0; i < tiles.size(); ++i) {
-          const auto color = level->second.find(static_cast<uint32_t>(i));
-          if(color != level->second.cend())
-            tiles[i] = color->second;
-        }
+      auto level = find_level(hierarchy_level);
+      if (level != nullptr) {
+        for(size_t i = 0; i < tiles.size() && i < level->count; ++i)
+          tiles[i] = level->colors[i];
       }
 
       return tiles;
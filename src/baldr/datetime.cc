@@ -11,6 +11,7 @@
 
 #include "baldr/datetime.h"
 #include "baldr/graphconstants.h"
+#include "midgard/constants.h"
 
 #include "date_time_zonespec.h"
 
@@ -33,6 +34,8 @@ tz_db_t::tz_db_t() {
   load_from_stream(ss);
   //unfortunately boosts object has its map marked as private... so we have to keep our own
   regions = region_list();
+  for (const auto& region : regions)
+    zones.emplace_back(time_zone_from_region(region));
 }
 
 size_t tz_db_t::to_index(const std::string& region) const {
@@ -45,7 +48,7 @@ size_t tz_db_t::to_index(const std::string& region) const {
 boost::shared_ptr<boost::local_time::tz_database::time_zone_base_type> tz_db_t::from_index(size_t index) const {
   if(index < 1 || index > regions.size())
     return {};
-  return time_zone_from_region(regions[index - 1]);
+  return zones[index - 1];
 }
 
 const tz_db_t& get_tz_db() {
@@ -587,6 +590,13 @@ uint32_t seconds_from_midnight(const std::string& date_time) {
   return static_cast<uint32_t>(td.total_seconds());
 }
 
+//get the seconds from sunday midnight.
+//date_time is in the format of 2015-05-06T08:00
+uint32_t second_of_week(const std::string& date_time) {
+  boost::gregorian::date date = get_formatted_date(date_time);
+  return date.day_of_week().as_number() * midgard::kSecondsPerDay + seconds_from_midnight(date_time);
+}
+
 //add x seconds to a date_time and return a ISO date_time string.
 //date_time is in the format of 20150516 or 2015-05-06T08:00
 std::string get_duration(const std::string& date_time, const uint32_t seconds,
@@ -690,6 +700,17 @@ bool is_iso_local(const std::string& date_time) {
   return is_ok;
 }
 
+//parse the date and time of a request once for the searches to use.
+time_context_t::time_context_t(const std::string& date_time)
+  : valid(!date_time.empty()), seconds_from_midnight(0), days_from_pivot(0),
+    dow_mask(kDOWNone) {
+  if (!valid)
+    return;
+  seconds_from_midnight = DateTime::seconds_from_midnight(date_time);
+  days_from_pivot = days_from_pivot_date(get_formatted_date(date_time));
+  dow_mask = day_of_week_mask(date_time);
+}
+
 }
 }
 }
@@ -1,5 +1,6 @@
 #include "baldr/directededge.h"
 #include "baldr/nodeinfo.h"
+#include <algorithm>
 #include <boost/functional/hash.hpp>
 #include "midgard/logging.h"
 
@@ -195,6 +196,29 @@ void DirectedEdge::set_unreachable(const bool unreachable) {
   unreachable_ = unreachable;
 }
 
+// Get the number of nodes a mode can reach going forward from the end node
+// of this edge, 0 if it is not known.
+uint32_t DirectedEdge::reach(const uint32_t access) const {
+  switch (access) {
+    case kAutoAccess:       return auto_reach_;
+    case kBicycleAccess:    return bicycle_reach_;
+    case kPedestrianAccess: return pedestrian_reach_;
+    default:                return 0;
+  }
+}
+
+// Sets the number of nodes a mode can reach going forward from the end node
+// of this edge.
+void DirectedEdge::set_reach(const uint32_t access, const uint32_t reach) {
+  uint32_t r = std::min(reach, kMaxStoredReach);
+  switch (access) {
+    case kAutoAccess:       auto_reach_ = r; break;
+    case kBicycleAccess:    bicycle_reach_ = r; break;
+    case kPedestrianAccess: pedestrian_reach_ = r; break;
+    default:                break;
+  }
+}
+
 // Sets the flag indicating a traffic signal is present at the end of
 // this edge.
 void DirectedEdge::set_traffic_signal(const bool signal) {
@@ -558,6 +582,9 @@ json::MapPtr DirectedEdge::json() const {
     {"bridge", static_cast<bool>(bridge_)},
     {"round_about", static_cast<bool>(roundabout_)},
     {"unreachable", static_cast<bool>(unreachable_)},
+    {"auto_reach", static_cast<uint64_t>(auto_reach_)},
+    {"bicycle_reach", static_cast<uint64_t>(bicycle_reach_)},
+    {"pedestrian_reach", static_cast<uint64_t>(pedestrian_reach_)},
     {"traffic_signal", static_cast<bool>(traffic_signal_)},
     {"forward", static_cast<bool>(forward_)},
     {"not_thru", static_cast<bool>(not_thru_)},
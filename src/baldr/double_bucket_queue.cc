@@ -20,6 +20,7 @@ DoubleBucketQueue::DoubleBucketQueue(const float mincost, const float range,
   // Adjust min cost to be the start of a bucket
   uint32_t c = static_cast<uint32_t>(mincost);
   currentcost_ = (c - (c % bucketsize));
+  startcost_ = currentcost_;
   mincost_ = currentcost_;
   bucketrange_ = range;
   bucketsize_ = static_cast<float>(bucketsize);
@@ -37,6 +38,7 @@ DoubleBucketQueue::DoubleBucketQueue(const float mincost, const float range,
 
   // Set the cost function.
   labelcost_ = labelcost;
+  pushes_ = 0;
 }
 
 // Destructor
@@ -53,7 +55,9 @@ void DoubleBucketQueue::clear() {
     currentbucket_++;
   }
 
-  // Reset current bucket and cost
+  // Reset the range if the overflow moved it, the current bucket and cost
+  mincost_ = startcost_;
+  maxcost_ = mincost_ + bucketrange_;
   currentcost_ = mincost_;
   currentbucket_ = buckets_.begin();
 }
@@ -69,6 +73,7 @@ void DoubleBucketQueue::decrease(const uint32_t label, const float newcost) {
   if (prevbucket != newbucket) {
     // Add label to newbucket and remove from previous bucket
     newbucket.push_back(label);
+    ++pushes_;
     prevbucket.erase(std::remove(prevbucket.begin(), prevbucket.end(), label));
   }
 }
@@ -0,0 +1,59 @@
+#include "baldr/edge_attribute_index.h"
+
+namespace {
+
+// Index of the first entry of each edge, the entries being sorted by edge
+// index. Entries of edges past the last one are left out.
+template <typename entry_t, typename edge_index_t>
+std::vector<uint32_t> first_entries(const entry_t* entries, const uint32_t count,
+                                    const uint32_t edge_count, const edge_index_t& edge_index) {
+  std::vector<uint32_t> first(edge_count + 1, 0);
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t idx = edge_index(entries[i]);
+    if (idx < edge_count)
+      ++first[idx + 1];
+  }
+  for (uint32_t i = 1; i <= edge_count; ++i)
+    first[i] += first[i - 1];
+  return first;
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+// Constructor
+EdgeAttributeIndex::EdgeAttributeIndex()
+    : sign_(0), access_restriction_(0), lane_connectivity_(0) {
+}
+
+// Constructor with arguments.
+EdgeAttributeIndex::EdgeAttributeIndex(const uint32_t sign, const uint32_t access_restriction,
+                                       const uint32_t lane_connectivity)
+    : sign_(sign), access_restriction_(access_restriction),
+      lane_connectivity_(lane_connectivity) {
+}
+
+// Make the index of the directed edges of a tile from its lists.
+std::vector<EdgeAttributeIndex> EdgeAttributeIndex::Build(const Sign* signs, const uint32_t sign_count,
+                                                          const AccessRestriction* restrictions,
+                                                          const uint32_t restriction_count,
+                                                          const LaneConnectivity* lanes,
+                                                          const uint32_t lane_count,
+                                                          const uint32_t edge_count) {
+  auto sign = first_entries(signs, sign_count, edge_count,
+                            [](const Sign& s) { return s.edgeindex(); });
+  auto restriction = first_entries(restrictions, restriction_count, edge_count,
+                                   [](const AccessRestriction& r) { return r.edgeindex(); });
+  auto lane = first_entries(lanes, lane_count, edge_count,
+                            [](const LaneConnectivity& l) { return l.to(); });
+  std::vector<EdgeAttributeIndex> index;
+  index.reserve(edge_count + 1);
+  for (uint32_t i = 0; i <= edge_count; ++i)
+    index.emplace_back(sign[i], restriction[i], lane[i]);
+  return index;
+}
+
+}
+}
@@ -0,0 +1,64 @@
+#include <cmath>
+#include "baldr/edge_bbox.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// Quantize the range of an axis, rounding outward with an extra unit on each
+// side for floating point error. The range is stored as unbounded if it
+// doesn't fit.
+void quantize(const float min, const float max, const float base, const float size,
+              int16_t& qmin, int16_t& qmax) {
+  float lower = std::floor((min - base) / size * valhalla::baldr::kEdgeBBoxUnitsPerTile) - 1.0f;
+  float upper = std::ceil((max - base) / size * valhalla::baldr::kEdgeBBoxUnitsPerTile) + 1.0f;
+  if (lower <= valhalla::baldr::kEdgeBBoxUnboundedMin ||
+      upper >= valhalla::baldr::kEdgeBBoxUnboundedMax) {
+    qmin = valhalla::baldr::kEdgeBBoxUnboundedMin;
+    qmax = valhalla::baldr::kEdgeBBoxUnboundedMax;
+  } else {
+    qmin = static_cast<int16_t>(lower);
+    qmax = static_cast<int16_t>(upper);
+  }
+}
+
+// Get back the range of an axis
+void dequantize(const int16_t qmin, const int16_t qmax, const float base, const float size,
+                const float world_min, const float world_max, float& min, float& max) {
+  if (qmin == valhalla::baldr::kEdgeBBoxUnboundedMin &&
+      qmax == valhalla::baldr::kEdgeBBoxUnboundedMax) {
+    min = world_min;
+    max = world_max;
+  } else {
+    min = base + qmin * size / valhalla::baldr::kEdgeBBoxUnitsPerTile;
+    max = base + qmax * size / valhalla::baldr::kEdgeBBoxUnitsPerTile;
+  }
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+// Constructor of an unbounded box.
+EdgeBBox::EdgeBBox()
+    : minx_(kEdgeBBoxUnboundedMin), miny_(kEdgeBBoxUnboundedMin),
+      maxx_(kEdgeBBoxUnboundedMax), maxy_(kEdgeBBoxUnboundedMax) {
+}
+
+// Constructor with arguments.
+EdgeBBox::EdgeBBox(const AABB2<PointLL>& box, const AABB2<PointLL>& tile_box) {
+  quantize(box.minx(), box.maxx(), tile_box.minx(), tile_box.Width(), minx_, maxx_);
+  quantize(box.miny(), box.maxy(), tile_box.miny(), tile_box.Height(), miny_, maxy_);
+}
+
+// Get the bounding box.
+AABB2<PointLL> EdgeBBox::box(const AABB2<PointLL>& tile_box) const {
+  float minx, miny, maxx, maxy;
+  dequantize(minx_, maxx_, tile_box.minx(), tile_box.Width(), -180.0f, 180.0f, minx, maxx);
+  dequantize(miny_, maxy_, tile_box.miny(), tile_box.Height(), -90.0f, 90.0f, miny, maxy);
+  return AABB2<PointLL>(minx, miny, maxx, maxy);
+}
+
+}
+}
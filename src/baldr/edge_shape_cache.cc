@@ -0,0 +1,53 @@
+#include "baldr/edge_shape_cache.h"
+
+#include <atomic>
+
+#include "midgard/encoded.h"
+
+namespace {
+
+// How many shapes each tile keeps, 0 for none
+std::atomic<size_t> process_max_shapes(0);
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+EdgeShapeCache::EdgeShapeCache(const size_t max_shapes) : max_shapes_(max_shapes) {
+}
+
+std::shared_ptr<const std::vector<midgard::PointLL> > EdgeShapeCache::Get(const char* encoded,
+                                                                           const size_t size) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = shapes_.find(encoded);
+    if (found != shapes_.cend())
+      return found->second;
+  }
+
+  // Decode it without holding up the other threads, if another one decoded
+  // it meanwhile the first one is kept
+  auto shape = std::make_shared<const std::vector<midgard::PointLL> >(
+      midgard::decode7<std::vector<midgard::PointLL> >(encoded, size));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (shapes_.size() >= max_shapes_)
+    return shape;
+  return shapes_.emplace(encoded, shape).first->second;
+}
+
+size_t EdgeShapeCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shapes_.size();
+}
+
+void EdgeShapeCache::set_max_shapes(const size_t max_shapes) {
+  process_max_shapes = max_shapes;
+}
+
+size_t EdgeShapeCache::max_shapes() {
+  return process_max_shapes;
+}
+
+}
+}
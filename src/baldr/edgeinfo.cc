@@ -19,8 +19,8 @@ namespace valhalla {
 namespace baldr {
 
 EdgeInfo::EdgeInfo(char* ptr, const char* names_list,
-                   const size_t names_list_length)
-  : names_list_(names_list), names_list_length_(names_list_length) {
+                   const size_t names_list_length, EdgeShapeCache* shape_cache)
+  : names_list_(names_list), names_list_length_(names_list_length), shape_cache_(shape_cache) {
 
   wayid_ = *(reinterpret_cast<uint64_t*>(ptr));
   ptr += sizeof(uint64_t);
@@ -95,6 +95,12 @@ uint16_t EdgeInfo::GetTypes() const {
 
 // Returns shape as a vector of PointLL
 const std::vector<PointLL>& EdgeInfo::shape() const {
+  //the tile keeps the decoded shapes, share its copy
+  if(shape_cache_ != nullptr && encoded_shape_ != nullptr) {
+    if(!cached_shape_)
+      cached_shape_ = shape_cache_->Get(encoded_shape_, item_->encoded_shape_size);
+    return *cached_shape_;
+  }
   //if we haven't yet decoded the shape, do so
   if(encoded_shape_ != nullptr && shape_.empty())
     shape_ = midgard::decode7<std::vector<PointLL> >(encoded_shape_, item_->encoded_shape_size);
@@ -10,14 +10,22 @@ void bitset_t::set(const uint64_t id) {
   if (id >= end_id()) {
     throw std::runtime_error("id out of bounds");
   }
-  bits[id / u64_size] |= u64_one << (id % u64_size);
+  bits[id / u64_size].fetch_or(u64_one << (id % u64_size), std::memory_order_relaxed);
 }
 
 bool bitset_t::get(const uint64_t id) const {
   if (id >= end_id()) {
     throw std::runtime_error("id out of bounds");
   }
-  return bits[id / u64_size] & (u64_one << (id % u64_size));
+  return bits[id / u64_size].load(std::memory_order_relaxed) & (u64_one << (id % u64_size));
+}
+
+bool bitset_t::test_and_set(const uint64_t id) {
+  if (id >= end_id()) {
+    throw std::runtime_error("id out of bounds");
+  }
+  const auto bit = u64_one << (id % u64_size);
+  return bits[id / u64_size].fetch_or(bit, std::memory_order_relaxed) & bit;
 }
 
 bool edge_tracker::get(const GraphId &edge_id) const {
@@ -32,5 +40,11 @@ void edge_tracker::set(const GraphId &edge_id) {
   m_edge_set.set(edge_id.id() + itr->second);
 }
 
+bool edge_tracker::test_and_set(const GraphId &edge_id) {
+  auto itr = m_edges_in_tiles.find(edge_id.Tile_Base());
+  assert(itr != m_edges_in_tiles.end());
+  return m_edge_set.test_and_set(edge_id.id() + itr->second);
+}
+
 }
 }
@@ -0,0 +1,38 @@
+#include "baldr/fixed_shape.h"
+
+#include <stdexcept>
+
+namespace {
+
+// Next delta encoded integer of a shape, as read by midgard::Shape7Decoder
+int32_t next(const char*& begin, const char* end, const int32_t previous) {
+  int32_t byte, shift = 0, result = 0;
+  do {
+    if (begin == end)
+      throw std::runtime_error("Bad encoded polyline");
+    byte = int32_t(*begin++);
+    result |= (byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return previous + ((result & 1 ? ~result : result) >> 1);
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+std::vector<FixedPoint> DecodeFixedShape(const char* encoded, const size_t size) {
+  std::vector<FixedPoint> points;
+  const char* end = encoded + size;
+  FixedPoint point{0, 0};
+  while (encoded != end) {
+    point.lat = next(encoded, end, point.lat);
+    point.lon = next(encoded, end, point.lon);
+    points.push_back(point);
+  }
+  return points;
+}
+
+}
+}
@@ -0,0 +1,129 @@
+#include "baldr/flatgraph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// Current version of the flat graph file
+constexpr uint32_t kFlatGraphVersion = 1;
+
+// Magic bytes at the beginning of every flat graph file
+constexpr char kFlatGraphMagic[4] = {'V', 'F', 'L', 'G'};
+
+// Fixed size header at the beginning of the flat graph file
+struct FlatGraphHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t node_count;
+  uint64_t arc_count;
+  double bounds[4];
+  char costing[32];
+};
+
+template <class T>
+void write_vector(std::ofstream& out, const std::vector<T>& v) {
+  out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <class T>
+void read_vector(std::ifstream& in, std::vector<T>& v, const uint64_t count) {
+  v.resize(count);
+  in.read(reinterpret_cast<char*>(v.data()), count * sizeof(T));
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+FlatGraph::FlatGraph() : offsets_(1, 0) {
+}
+
+FlatGraph::FlatGraph(const std::string& costing, const AABB2<PointLL>& bounds,
+                     std::vector<GraphId>&& edges, std::vector<uint32_t>&& offsets,
+                     std::vector<uint32_t>&& targets, std::vector<float>&& costs,
+                     std::vector<float>&& secs, std::vector<float>&& lengths)
+    : costing_(costing), bounds_(bounds), edges_(std::move(edges)),
+      offsets_(std::move(offsets)), targets_(std::move(targets)), costs_(std::move(costs)),
+      secs_(std::move(secs)), lengths_(std::move(lengths)) {
+  if (offsets_.size() != edges_.size() + 1 || offsets_.back() != targets_.size() ||
+      costs_.size() != targets_.size() || secs_.size() != targets_.size() ||
+      lengths_.size() != targets_.size())
+    throw std::runtime_error("Flat graph arc offsets do not match its nodes and arcs");
+}
+
+FlatGraph FlatGraph::Load(const std::string& file_name) {
+  std::ifstream in(file_name, std::ios::in | std::ios::binary);
+  if (!in.is_open())
+    throw std::runtime_error("Could not open flat graph " + file_name);
+
+  FlatGraphHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, kFlatGraphMagic, sizeof(header.magic)) != 0 ||
+      header.version != kFlatGraphVersion)
+    throw std::runtime_error(file_name + " is not a flat graph");
+
+  FlatGraph graph;
+  header.costing[sizeof(header.costing) - 1] = '\0';
+  graph.costing_ = header.costing;
+  graph.bounds_ = AABB2<PointLL>(header.bounds[0], header.bounds[1],
+                                 header.bounds[2], header.bounds[3]);
+  read_vector(in, graph.edges_, header.node_count);
+  read_vector(in, graph.offsets_, header.node_count + 1);
+  read_vector(in, graph.targets_, header.arc_count);
+  read_vector(in, graph.costs_, header.arc_count);
+  read_vector(in, graph.secs_, header.arc_count);
+  read_vector(in, graph.lengths_, header.arc_count);
+  if (!in || graph.offsets_.back() != graph.targets_.size())
+    throw std::runtime_error("Flat graph " + file_name + " is truncated");
+  return graph;
+}
+
+void FlatGraph::Write(const std::string& file_name) const {
+  FlatGraphHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kFlatGraphMagic, sizeof(header.magic));
+  header.version = kFlatGraphVersion;
+  header.node_count = edges_.size();
+  header.arc_count = targets_.size();
+  header.bounds[0] = bounds_.minx();
+  header.bounds[1] = bounds_.miny();
+  header.bounds[2] = bounds_.maxx();
+  header.bounds[3] = bounds_.maxy();
+  if (costing_.size() >= sizeof(header.costing))
+    throw std::runtime_error("Costing name is too long for a flat graph");
+  std::memcpy(header.costing, costing_.data(), costing_.size());
+
+  std::ofstream out(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open())
+    throw std::runtime_error("Could not open " + file_name + " for writing");
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_vector(out, edges_);
+  write_vector(out, offsets_);
+  write_vector(out, targets_);
+  write_vector(out, costs_);
+  write_vector(out, secs_);
+  write_vector(out, lengths_);
+  out.close();
+  if (!out)
+    throw std::runtime_error("Failed to write flat graph " + file_name);
+}
+
+std::string FlatGraph::FileName(const std::string& tile_dir, const std::string& costing) {
+  return tile_dir + (tile_dir.empty() || tile_dir.back() == '/' ? "" : "/") +
+         costing + kFlatGraphExtension;
+}
+
+uint32_t FlatGraph::node(const GraphId& edgeid) const {
+  auto itr = std::lower_bound(edges_.cbegin(), edges_.cend(), edgeid,
+      [](const GraphId& a, const GraphId& b) { return a.value < b.value; });
+  return (itr != edges_.cend() && *itr == edgeid) ? itr - edges_.cbegin() : kInvalidFlatNode;
+}
+
+}
+}
@@ -1,16 +1,27 @@
 #include "baldr/graphreader.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <boost/filesystem.hpp>
 
+#include "midgard/compute_slots.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "midgard/sequence.h"
 
 #include "baldr/connectivity_map.h"
 #include "baldr/filesystem_utils.h"
+#include "baldr/tilecompression.h"
 
 using namespace valhalla::baldr;
 
@@ -18,25 +29,58 @@ namespace {
   constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; //1 gig
   constexpr size_t AVERAGE_TILE_SIZE = 2097152; //2 megs
   constexpr size_t AVERAGE_MM_TILE_SIZE = 1024; //1k
+  constexpr size_t DEFAULT_CACHE_SHARDS = 64;
+  constexpr float DEFAULT_LOW_WATERMARK = 0.75f;
+  constexpr size_t DEFAULT_PREFETCH_MAX = 64;
+  constexpr uint32_t DEFAULT_PREFETCH_RING_DEPTH = 32;
+  constexpr size_t DEFAULT_URL_CONCURRENCY = 8;
+  constexpr size_t DEFAULT_TRAFFIC_REFRESH = 60; //seconds
+  constexpr size_t DEFAULT_TILE_UPDATES_REFRESH = 60; //seconds
+  constexpr size_t DEFAULT_TILE_HEAT_FLUSH = 300; //seconds
+  constexpr size_t DEFAULT_PRELOAD_THREADS = 4;
+  constexpr size_t PRELOAD_BATCH = 16; //tiles per thread read before caching them
 }
 
 namespace valhalla {
 namespace baldr {
 
+// An extract is a tar of the tile files. An indexed one starts with an
+// index.bin member listing where each tile is, sorted by tile id, so loading
+// it is just the mapping. Otherwise every header has to be looked at.
 struct GraphReader::tile_extract_t : public midgard::tar {
-  tile_extract_t(const boost::property_tree::ptree& pt):tar(pt.get<std::string>("tile_extract","")) {
+  // Where a tile is in the extract, as written by valhalla_build_extract
+  struct entry_t {
+    uint64_t offset;   // of the tile data from the start of the extract
+    uint32_t tile_id;  // value of the GraphId of the tile
+    uint32_t size;     // of the tile data
+  };
+
+  tile_extract_t(const boost::property_tree::ptree& pt)
+    : tar(pt.get<std::string>("tile_extract",""), true, false), begin_(nullptr), end_(nullptr) {
     //if you really meant to load it
     if(pt.get_optional<std::string>("tile_extract")) {
+      if(load_index()) {
+        LOG_INFO("Tile extract index successfully loaded");
+        return;
+      }
+
       //map files to graph ids
+      read_contents();
       for(auto& c : contents) {
         try {
           auto id = GraphTile::GetTileId(c.first);
-          tiles[id] = std::make_pair(const_cast<char*>(c.second.first), c.second.second);
+          built_.push_back({static_cast<uint64_t>(c.second.first - mm.get()), static_cast<uint32_t>(id.value),
+                            static_cast<uint32_t>(c.second.second)});
         }
         catch(...){}
       }
+      std::sort(built_.begin(), built_.end(), [](const entry_t& a, const entry_t& b) { return a.tile_id < b.tile_id; });
+      built_.erase(std::unique(built_.begin(), built_.end(),
+                               [](const entry_t& a, const entry_t& b) { return a.tile_id == b.tile_id; }), built_.end());
+      begin_ = built_.data();
+      end_ = built_.data() + built_.size();
       //couldn't load it
-      if(tiles.empty()) {
+      if(empty()) {
         LOG_WARN("Tile extract could not be loaded");
       }//loaded ok but with possibly bad blocks
       else {
@@ -46,8 +90,63 @@ struct GraphReader::tile_extract_t : public midgard::tar {
       }
     }
   }
+
+  // Uses the index at the front of the extract if it has one and it makes sense
+  bool load_index() {
+    if(mm.size() < sizeof(header_t))
+      return false;
+    const header_t* h = static_cast<const header_t*>(static_cast<const void*>(mm.get()));
+    if(!h->verify() || std::string(h->name, strnlen(h->name, sizeof(h->name))) != "index.bin")
+      return false;
+    auto size = h->get_file_size();
+    if(size == 0 || size % sizeof(entry_t) != 0 || sizeof(header_t) + size > mm.size())
+      return false;
+    const entry_t* begin = static_cast<const entry_t*>(static_cast<const void*>(mm.get() + sizeof(header_t)));
+    const entry_t* end = begin + size / sizeof(entry_t);
+    //its only the index we look at, not the tiles it points to
+    for(const entry_t* e = begin; e < end; ++e) {
+      if(e->offset + e->size > mm.size() || (e > begin && (e - 1)->tile_id >= e->tile_id)) {
+        LOG_WARN("Tile extract index is corrupt, reading the whole extract instead");
+        return false;
+      }
+    }
+    begin_ = begin;
+    end_ = end;
+    return true;
+  }
+
+  bool empty() const {
+    return begin_ == end_;
+  }
+
+  size_t size() const {
+    return end_ - begin_;
+  }
+
+  const entry_t* begin() const {
+    return begin_;
+  }
+
+  const entry_t* end() const {
+    return end_;
+  }
+
+  // The tile with this id, nullptr if it isn't in the extract
+  const entry_t* find(const GraphId& graphid) const {
+    auto id = static_cast<uint32_t>(graphid.Tile_Base().value);
+    auto found = std::lower_bound(begin_, end_, id, [](const entry_t& e, uint32_t id) { return e.tile_id < id; });
+    return found != end_ && found->tile_id == id ? found : nullptr;
+  }
+
   // TODO: dont remove constness, and actually make graphtile read only?
-  std::unordered_map<uint64_t, std::pair<char*, size_t> > tiles;
+  char* data(const entry_t& entry) const {
+    return const_cast<char*>(mm.get() + entry.offset);
+  }
+
+  // Sorted by tile id, either the index in the extract or built from its headers
+  const entry_t* begin_;
+  const entry_t* end_;
+  std::vector<entry_t> built_;
 };
 
 std::shared_ptr<const GraphReader::tile_extract_t> GraphReader::get_extract_instance(const boost::property_tree::ptree& pt) {
@@ -86,6 +185,19 @@ void SimpleTileCache::Clear()
   cache_.clear();
 }
 
+// Evicts every tile, same as Clear.
+void SimpleTileCache::Trim()
+{
+  Clear();
+}
+
+// Evicts a single tile. The sizes of the tiles aren't kept so its size stays
+// counted until the cache is cleared.
+void SimpleTileCache::Evict(const GraphId& graphid)
+{
+  cache_.erase(graphid);
+}
+
 // Get a pointer to a graph tile object given a GraphId.
 const GraphTile* SimpleTileCache::Get(const GraphId& graphid) const
 {
@@ -104,8 +216,122 @@ const GraphTile* SimpleTileCache::Put(const GraphId& graphid, const GraphTile& t
 }
 
 // Constructor.
-SynchronizedTileCache::SynchronizedTileCache(TileCache& cache, std::mutex& mutex)
-      : cache_(cache), mutex_ref_(mutex)
+LRUTileCache::LRUTileCache(size_t max_size, float low_watermark)
+      : cache_size_(0), max_cache_size_(max_size),
+        low_cache_size_(static_cast<size_t>(max_size * std::min(std::max(low_watermark, 0.f), 1.f)))
+{
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void LRUTileCache::Reserve(size_t tile_size)
+{
+  cache_.reserve(max_cache_size_ / tile_size);
+}
+
+// Checks if tile exists in the cache.
+bool LRUTileCache::Contains(const GraphId& graphid) const
+{
+  return cache_.find(graphid) != cache_.end();
+}
+
+// Lets you know if the cache is too large.
+bool LRUTileCache::OverCommitted() const
+{
+  return max_cache_size_ < cache_size_;
+}
+
+// Clears the cache.
+void LRUTileCache::Clear()
+{
+  cache_size_ = 0;
+  cache_.clear();
+  recency_.clear();
+}
+
+// Evicts the least recently used tiles until we are down to the low watermark.
+void LRUTileCache::Trim()
+{
+  while (cache_size_ > low_cache_size_ && !recency_.empty()) {
+    auto evicted = cache_.find(recency_.back());
+    cache_size_ -= evicted->second.size;
+    cache_.erase(evicted);
+    recency_.pop_back();
+  }
+}
+
+// Evicts a single tile.
+void LRUTileCache::Evict(const GraphId& graphid)
+{
+  auto cached = cache_.find(graphid);
+  if(cached == cache_.end())
+    return;
+  cache_size_ -= cached->second.size;
+  recency_.erase(cached->second.position);
+  cache_.erase(cached);
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+const GraphTile* LRUTileCache::Get(const GraphId& graphid) const
+{
+  auto cached = cache_.find(graphid);
+  if(cached != cache_.end()) {
+    // its now the most recently used tile
+    recency_.splice(recency_.begin(), recency_, cached->second.position);
+    return &cached->second.tile;
+  }
+  return nullptr;
+}
+
+// Puts a copy of a tile of into the cache.
+const GraphTile* LRUTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size)
+{
+  auto cached = cache_.find(graphid);
+  if(cached != cache_.end())
+    return &cached->second.tile;
+  recency_.push_front(graphid);
+  cache_size_ += size;
+  return &cache_.emplace(graphid, entry_t{tile, size, recency_.begin()}).first->second.tile;
+}
+
+// Constructor.
+TileLookaside::TileLookaside(std::atomic<uint64_t>& generation)
+      : generation_(generation), seen_(generation.load(std::memory_order_acquire))
+{
+  slots_.fill({GraphId(), nullptr});
+}
+
+// Get a tile this reader got from the shared cache before, unless something
+// was evicted from it since.
+const GraphTile* TileLookaside::Get(const GraphId& graphid) const
+{
+  auto generation = generation_.load(std::memory_order_acquire);
+  if (generation != seen_) {
+    slots_.fill({GraphId(), nullptr});
+    seen_ = generation;
+    return nullptr;
+  }
+  const auto& slot = slots_[(graphid.tileid() + graphid.level() * 7919) % kSlots];
+  return slot.first == graphid ? slot.second : nullptr;
+}
+
+// Remember a tile this reader got from the shared cache.
+void TileLookaside::Put(const GraphId& graphid, const GraphTile* tile) const
+{
+  if (tile)
+    slots_[(graphid.tileid() + graphid.level() * 7919) % kSlots] = {graphid, tile};
+}
+
+// Makes every lookaside of the shared cache forget its tiles.
+void TileLookaside::Invalidate()
+{
+  generation_.fetch_add(1, std::memory_order_acq_rel);
+  slots_.fill({GraphId(), nullptr});
+}
+
+// Constructor.
+SynchronizedTileCache::SynchronizedTileCache(TileCache& cache, std::mutex& mutex,
+                                             std::atomic<uint64_t>& generation)
+      : cache_(cache), mutex_ref_(mutex), lookaside_(generation)
 {
 }
 
@@ -119,6 +345,8 @@ void SynchronizedTileCache::Reserve(size_t tile_size)
 // Checks if tile exists in the cache.
 bool SynchronizedTileCache::Contains(const GraphId& graphid) const
 {
+  if (lookaside_.Get(graphid))
+    return true;
   std::lock_guard<std::mutex> lock(mutex_ref_);
   return cache_.Contains(graphid);
 }
@@ -134,51 +362,566 @@ bool SynchronizedTileCache::OverCommitted() const
 void SynchronizedTileCache::Clear()
 {
   std::lock_guard<std::mutex> lock(mutex_ref_);
+  lookaside_.Invalidate();
   cache_.Clear();
 }
 
+// Evicts tiles until the cache is no longer over committed.
+void SynchronizedTileCache::Trim()
+{
+  std::lock_guard<std::mutex> lock(mutex_ref_);
+  lookaside_.Invalidate();
+  cache_.Trim();
+}
+
+// Evicts a single tile.
+void SynchronizedTileCache::Evict(const GraphId& graphid)
+{
+  std::lock_guard<std::mutex> lock(mutex_ref_);
+  lookaside_.Invalidate();
+  cache_.Evict(graphid);
+}
+
 // Get a pointer to a graph tile object given a GraphId.
 const GraphTile* SynchronizedTileCache::Get(const GraphId& graphid) const
 {
+  if (auto seen = lookaside_.Get(graphid))
+    return seen;
   std::lock_guard<std::mutex> lock(mutex_ref_);
-  return cache_.Get(graphid);
+  auto cached = cache_.Get(graphid);
+  lookaside_.Put(graphid, cached);
+  return cached;
 }
 
 // Puts a copy of a tile of into the cache.
 const GraphTile* SynchronizedTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size)
 {
   std::lock_guard<std::mutex> lock(mutex_ref_);
-  return cache_.Put(graphid, tile, size);
+  auto cached = cache_.Put(graphid, tile, size);
+  lookaside_.Put(graphid, cached);
+  return cached;
+}
+
+// Constructor.
+ShardedTileCache::ShardedTileCache(std::vector<std::unique_ptr<TileCache> >& shards,
+                                   std::vector<std::mutex>& mutexes,
+                                   std::atomic<uint64_t>& generation)
+      : shards_(shards), mutexes_(mutexes), lookaside_(generation)
+{
+}
+
+// Returns the shard a given tile is stored in. The low bits of a GraphId
+// are the hierarchy level so key off of the tile id instead, that way
+// neighboring tiles end up in different shards.
+size_t ShardedTileCache::Shard(const GraphId& graphid) const
+{
+  return (graphid.tileid() + graphid.level() * 7919) % shards_.size();
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ShardedTileCache::Reserve(size_t tile_size)
+{
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    std::lock_guard<std::mutex> lock(mutexes_[i]);
+    shards_[i]->Reserve(tile_size);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ShardedTileCache::Contains(const GraphId& graphid) const
+{
+  if (lookaside_.Get(graphid))
+    return true;
+  auto i = Shard(graphid);
+  std::lock_guard<std::mutex> lock(mutexes_[i]);
+  return shards_[i]->Contains(graphid);
+}
+
+// Lets you know if the cache is too large.
+bool ShardedTileCache::OverCommitted() const
+{
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    std::lock_guard<std::mutex> lock(mutexes_[i]);
+    if (shards_[i]->OverCommitted())
+      return true;
+  }
+  return false;
+}
+
+// Clears the cache.
+void ShardedTileCache::Clear()
+{
+  lookaside_.Invalidate();
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    std::lock_guard<std::mutex> lock(mutexes_[i]);
+    shards_[i]->Clear();
+  }
+}
+
+// Evicts tiles from every over committed shard.
+void ShardedTileCache::Trim()
+{
+  lookaside_.Invalidate();
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    std::lock_guard<std::mutex> lock(mutexes_[i]);
+    if (shards_[i]->OverCommitted())
+      shards_[i]->Trim();
+  }
+}
+
+// Evicts a single tile from its shard.
+void ShardedTileCache::Evict(const GraphId& graphid)
+{
+  auto i = Shard(graphid);
+  std::lock_guard<std::mutex> lock(mutexes_[i]);
+  lookaside_.Invalidate();
+  shards_[i]->Evict(graphid);
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+const GraphTile* ShardedTileCache::Get(const GraphId& graphid) const
+{
+  if (auto seen = lookaside_.Get(graphid))
+    return seen;
+  auto i = Shard(graphid);
+  std::lock_guard<std::mutex> lock(mutexes_[i]);
+  auto cached = shards_[i]->Get(graphid);
+  lookaside_.Put(graphid, cached);
+  return cached;
+}
+
+// Puts a copy of a tile of into the cache.
+const GraphTile* ShardedTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size)
+{
+  auto i = Shard(graphid);
+  std::lock_guard<std::mutex> lock(mutexes_[i]);
+  auto cached = shards_[i]->Put(graphid, tile, size);
+  lookaside_.Put(graphid, cached);
+  return cached;
+}
+
+// Constructor.
+SharedMemoryTileCache::SharedMemoryTileCache(TileCache* cache, const std::string& shared_dir,
+                                             size_t max_size)
+      : cache_(cache), shared_dir_(shared_dir), max_size_(max_size), size_(0)
+{
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void SharedMemoryTileCache::Reserve(size_t tile_size)
+{
+  cache_->Reserve(tile_size);
+}
+
+// Checks if tile exists in the cache of this or any other process.
+bool SharedMemoryTileCache::Contains(const GraphId& graphid) const
+{
+  if (cache_->Contains(graphid))
+    return true;
+  struct stat s;
+  auto file_location = shared_dir_ + filesystem::path_separator + GraphTile::FileSuffix(graphid);
+  return stat(file_location.c_str(), &s) == 0 && s.st_size > 0;
+}
+
+// Lets you know if the cache is too large.
+bool SharedMemoryTileCache::OverCommitted() const
+{
+  return cache_->OverCommitted();
+}
+
+// Clears the mappings of this process.
+void SharedMemoryTileCache::Clear()
+{
+  cache_->Clear();
+}
+
+// Drops mappings until the cache is no longer over committed.
+void SharedMemoryTileCache::Trim()
+{
+  cache_->Trim();
+}
+
+// Drops the mapping of a tile and removes the shared copy. Other processes
+// keep their mappings of it until they evict the tile themselves.
+void SharedMemoryTileCache::Evict(const GraphId& graphid)
+{
+  cache_->Evict(graphid);
+  auto file_location = shared_dir_ + filesystem::path_separator + GraphTile::FileSuffix(graphid);
+  unlink(file_location.c_str());
+  auto spilled = std::find_if(spilled_.begin(), spilled_.end(),
+    [&graphid](const std::pair<GraphId, size_t>& copy) { return copy.first == graphid; });
+  if (spilled != spilled_.end()) {
+    size_ -= spilled->second;
+    spilled_.erase(spilled);
+  }
+}
+
+// Accounts for a copy this process put into the directory. Removing the
+// oldest copies leaves the mappings of them, in this or any other process,
+// as they are, the tile is just put there again the next time it's loaded.
+void SharedMemoryTileCache::Spilled(const GraphId& graphid)
+{
+  if (max_size_ == 0)
+    return;
+  struct stat s;
+  auto file_location = shared_dir_ + filesystem::path_separator + GraphTile::FileSuffix(graphid);
+  if (stat(file_location.c_str(), &s) != 0)
+    return;
+  spilled_.emplace_back(graphid, s.st_size);
+  size_ += s.st_size;
+  while (size_ > max_size_ && spilled_.size() > 1) {
+    const auto& oldest = spilled_.front();
+    auto oldest_location = shared_dir_ + filesystem::path_separator + GraphTile::FileSuffix(oldest.first);
+    unlink(oldest_location.c_str());
+    size_ -= oldest.second;
+    spilled_.pop_front();
+  }
+}
+
+// Maps the shared copy of a tile and keeps it in the wrapped cache. The
+// pages belong to the shared memory file system rather than this process
+// so the mapping is accounted for like a tile of a memory mapped extract.
+const GraphTile* SharedMemoryTileCache::Map(const GraphId& graphid) const
+{
+  struct stat s;
+  auto file_location = shared_dir_ + filesystem::path_separator + GraphTile::FileSuffix(graphid);
+  if (stat(file_location.c_str(), &s) != 0 || s.st_size == 0)
+    return nullptr;
+  GraphTile shared(shared_dir_, graphid, true);
+  if (!shared.header())
+    return nullptr;
+  return cache_->Put(graphid, shared, AVERAGE_MM_TILE_SIZE);
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+const GraphTile* SharedMemoryTileCache::Get(const GraphId& graphid) const
+{
+  if (auto cached = cache_->Get(graphid))
+    return cached;
+  return Map(graphid);
+}
+
+// Puts the tile into shared memory, unless another process already has,
+// and keeps a mapping of the shared copy.
+const GraphTile* SharedMemoryTileCache::Put(const GraphId& graphid, const GraphTile& tile, size_t size)
+{
+  if (auto cached = cache_->Get(graphid))
+    return cached;
+  if (auto mapped = Map(graphid))
+    return mapped;
+  if (tile.Spill(shared_dir_)) {
+    Spilled(graphid);
+    if (auto mapped = Map(graphid))
+      return mapped;
+  }
+  // Keep the tile to ourselves if the shared memory is full or unwritable
+  return cache_->Put(graphid, tile, size);
 }
 
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt)
 {
+  // the process wide caches, readers of different groups get caches of their
+  // own, for example one per numa node so each keeps its tiles in local memory
+  struct global_cache_t {
+    std::mutex mutex;
+    std::shared_ptr<TileCache> cache;
+    std::vector<std::unique_ptr<TileCache> > shards;
+    std::unique_ptr<std::vector<std::mutex> > shard_mutexes;
+    std::atomic<uint64_t> generation{0};
+  };
   static std::mutex globalCacheMutex_;
-  static std::shared_ptr<TileCache> globalTileCache_;
+  static std::unordered_map<size_t, std::unique_ptr<global_cache_t> > globalCaches_;
 
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
 
-  // wrap tile cache with thread-safe version
-  if (pt.get<bool>("global_synchronized_cache", false)) {
-    if (!globalTileCache_)
-      globalTileCache_.reset(new SimpleTileCache(max_cache_size));
-    return new SynchronizedTileCache(*globalTileCache_, globalCacheMutex_);
+  // how tiles are evicted once the cache is over committed
+  bool use_lru = pt.get<std::string>("cache_eviction", "clear") == "lru";
+  float low_watermark = pt.get<float>("cache_low_watermark", DEFAULT_LOW_WATERMARK);
+  // optionally share the decompressed tiles with the other processes on the host
+  // or keep them on a local disk below the cache
+  auto shared_dir = pt.get<std::string>("shared_cache_dir", "");
+  size_t shared_max_size = pt.get<size_t>("shared_cache_max_size", 0);
+  auto make_cache = [use_lru, low_watermark, shared_dir](size_t max_size, size_t shared_size) -> TileCache* {
+    TileCache* cache;
+    if (use_lru)
+      cache = new LRUTileCache(max_size, low_watermark);
+    else
+      cache = new SimpleTileCache(max_size);
+    if (!shared_dir.empty())
+      cache = new SharedMemoryTileCache(cache, shared_dir, shared_size);
+    return cache;
+  };
+
+  bool sharded = pt.get<bool>("global_sharded_cache", false);
+  if (!sharded && !pt.get<bool>("global_synchronized_cache", false))
+    return make_cache(max_cache_size, shared_max_size);
+
+  std::lock_guard<std::mutex> lock(globalCacheMutex_);
+  auto& global = globalCaches_[pt.get<size_t>("cache_group", 0)];
+  if (!global)
+    global.reset(new global_cache_t);
+
+  // split the shared tile cache into shards each with their own lock
+  if (sharded) {
+    if (global->shards.empty()) {
+      size_t shard_count = std::max(pt.get<size_t>("cache_shards", DEFAULT_CACHE_SHARDS), size_t(1));
+      for (size_t i = 0; i < shard_count; ++i)
+        global->shards.emplace_back(make_cache(max_cache_size / shard_count,
+            shared_max_size == 0 ? 0 : std::max<size_t>(shared_max_size / shard_count, 1)));
+      global->shard_mutexes.reset(new std::vector<std::mutex>(shard_count));
+    }
+    return new ShardedTileCache(global->shards, *global->shard_mutexes, global->generation);
   }
 
-  // default
-  return new SimpleTileCache(max_cache_size);
+  // wrap tile cache with thread-safe version
+  if (!global->cache)
+    global->cache.reset(make_cache(max_cache_size, shared_max_size));
+  return new SynchronizedTileCache(*global->cache, global->mutex, global->generation);
 }
 
 // Constructor using separate tile files
 GraphReader::GraphReader(const boost::property_tree::ptree& pt)
     : tile_url_(pt.get<std::string>("tile_url", "")),
       tile_dir_(pt.get<std::string>("tile_dir")),
+      tile_mmap_(pt.get<bool>("tile_mmap", false)),
+      tile_url_spill_(pt.get<bool>("tile_url_spill", false)),
+      tile_url_concurrency_(pt.get<size_t>("tile_url_concurrency", DEFAULT_URL_CONCURRENCY)),
+      prefetch_max_(pt.get<size_t>("tile_prefetch_max", DEFAULT_PREFETCH_MAX)),
       tile_extract_(get_extract_instance(pt)),
       cache_(TileCacheFactory::createTileCache(pt)) {
+  // Keep the decoded shapes of the edges with the tiles, for the whole process
+  if (auto max_shapes = pt.get_optional<size_t>("edge_shape_cache_size"))
+    EdgeShapeCache::set_max_shapes(*max_shapes);
+
   // Reserve cache (based on whether using individual tile files or shared,
   // mmap'd file
-  cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+  cache_->Reserve(tile_extract_->empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+
+  // Optionally load tiles in the background, the extract is already mapped
+  // so there is nothing to gain there
+  auto prefetch_threads = pt.get<size_t>("tile_prefetch_threads", 0);
+  if (prefetch_threads > 0 && tile_extract_->empty())
+    prefetcher_.reset(new TilePrefetcher(tile_dir_, tile_url_, tile_mmap_, prefetch_threads, prefetch_max_,
+                                         tile_url_spill_,
+                                         pt.get<uint32_t>("tile_prefetch_ring_depth", DEFAULT_PREFETCH_RING_DEPTH)));
+
+  // Overlay live traffic speeds if there are any
+  auto traffic_dir = pt.get<std::string>("traffic_dir", tile_dir_ + filesystem::path_separator + "traffic");
+  if (boost::filesystem::is_directory(traffic_dir))
+    traffic_ = TrafficSpeeds::get_instance(traffic_dir,
+                                          pt.get<size_t>("traffic_refresh_seconds", DEFAULT_TRAFFIC_REFRESH));
+
+  // Follow tiles updated in place, the extract is mapped once for the process
+  // so it can only be replaced by restarting
+  if (tile_extract_->empty())
+    tile_updates_.reset(new TileUpdates(tile_dir_, pt.get<size_t>("tile_updates_refresh_seconds",
+                                                                  DEFAULT_TILE_UPDATES_REFRESH)));
+
+  // Count how often each tile is asked for so the next start can warm up with them
+  auto heat_file = pt.get<std::string>("tile_heat_file", "");
+  if (!heat_file.empty())
+    heat_.reset(new TileHeat(heat_file, pt.get<size_t>("tile_heat_seconds", DEFAULT_TILE_HEAT_FLUSH)));
+
+  // Warm the cache up with the tiles asked for most last time and those of the
+  // hot areas before taking any requests
+  std::vector<GraphId> preload;
+  auto preload_count = pt.get<size_t>("tile_preload_count", 0);
+  if (preload_count > 0 && !heat_file.empty()) {
+    for (const auto& tile : TileHeat::Read(heat_file, preload_count))
+      preload.push_back(tile.first);
+  }
+  if (auto bboxes = pt.get_child_optional("tile_preload_bboxes")) {
+    for (const auto& bbox : *bboxes) {
+      // min_lon,min_lat,max_lon,max_lat
+      std::istringstream in(bbox.second.get_value<std::string>());
+      float minx, miny, maxx, maxy;
+      char comma;
+      if (!(in >> minx >> comma >> miny >> comma >> maxx >> comma >> maxy))
+        throw std::runtime_error("Bad tile_preload_bboxes entry: " + in.str());
+      auto ids = TileHierarchy::GetGraphIds(midgard::AABB2<midgard::PointLL>(minx, miny, maxx, maxy));
+      preload.insert(preload.end(), ids.cbegin(), ids.cend());
+    }
+  }
+  if (!preload.empty()) {
+    auto threads = std::max<size_t>(1, pt.get<size_t>("tile_preload_threads", DEFAULT_PRELOAD_THREADS));
+    auto max_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE) *
+                    pt.get<float>("cache_low_watermark", DEFAULT_LOW_WATERMARK);
+    auto loaded = Preload(preload, threads, max_size);
+    LOG_INFO("Preloaded " + std::to_string(loaded) + " of " + std::to_string(preload.size()) + " tiles");
+  }
+}
+
+// Evicts the tiles updated in place since the last time we looked
+bool GraphReader::RefreshTiles() {
+  if (heat_)
+    heat_->Flush();
+  if (!tile_updates_)
+    return false;
+  auto changed = tile_updates_->Changed();
+  if (changed.empty())
+    return false;
+
+  // Staged tiles may be the old ones
+  if (prefetcher_)
+    prefetcher_->Clear();
+  for (const auto& id : changed) {
+    cache_->Evict(id);
+    _404s.erase(id);
+  }
+  LOG_INFO("Evicted " + std::to_string(changed.size()) + " tiles updated to version " +
+           std::to_string(tile_updates_->version()));
+  return true;
+}
+
+// Load tiles ahead of the requests
+size_t GraphReader::Preload(const std::vector<GraphId>& ids, const size_t threads, const size_t max_size) {
+  // The ones we dont have yet, once each and in order
+  std::vector<GraphId> missing;
+  std::unordered_set<GraphId> seen;
+  for (const auto& id : ids) {
+    auto base = id.Tile_Base();
+    if (seen.insert(base).second && DoesTileExist(base) && !cache_->Contains(base))
+      missing.push_back(base);
+  }
+
+  // The extract is mapped already, have the kernel read the tiles in ahead so
+  // the first requests dont fault on each one and keep a view of each
+  size_t loaded = 0, size = 0;
+  if (!tile_extract_->empty()) {
+    auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    for (const auto& id : missing) {
+      auto t = tile_extract_->find(id);
+      auto begin = reinterpret_cast<uintptr_t>(tile_extract_->data(*t));
+      auto aligned = begin & ~(page - 1);
+      madvise(reinterpret_cast<void*>(aligned), begin + t->size - aligned, MADV_WILLNEED);
+    }
+    for (const auto& id : missing) {
+      if (size + AVERAGE_MM_TILE_SIZE > max_size || OverCommitted())
+        break;
+      if (GetGraphTile(id) != nullptr) {
+        size += AVERAGE_MM_TILE_SIZE;
+        ++loaded;
+      }
+    }
+    return loaded;
+  }
+
+  // Otherwise the tiles are read a batch at a time on the threads and cached
+  // here since not every cache can be used from several threads
+  std::vector<GraphTile> tiles;
+  for (size_t b = 0; b < missing.size(); b += threads * PRELOAD_BATCH) {
+    auto count = std::min(missing.size() - b, threads * PRELOAD_BATCH);
+    tiles.assign(count, GraphTile());
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < std::min(threads, count); ++r) {
+      readers.emplace_back([this, &tiles, &missing, b, r, count, threads]() {
+        for (size_t i = r; i < count; i += threads)
+          tiles[i] = GraphTile(tile_dir_, missing[b + i], tile_mmap_);
+      });
+    }
+    for (auto& reader : readers)
+      reader.join();
+    for (size_t i = 0; i < count; ++i) {
+      if (!tiles[i].header())
+        continue;
+      auto tile_size = tiles[i].header()->end_offset();
+      if (size + tile_size > max_size || OverCommitted())
+        return loaded;
+      cache_->Put(missing[b + i], tiles[i], tile_size);
+      size += tile_size;
+      ++loaded;
+    }
+  }
+  return loaded;
+}
+
+// Load tiles in the background
+void GraphReader::Prefetch(const std::vector<GraphId>& ids) {
+  if (!prefetcher_)
+    return;
+  std::vector<GraphId> missing;
+  for (const auto& id : ids) {
+    if (!id.Is_Valid() || id.level() > TileHierarchy::get_max_level())
+      continue;
+    auto base = id.Tile_Base();
+    if (!cache_->Contains(base) && _404s.find(base) == _404s.cend())
+      missing.push_back(base);
+    if (missing.size() == prefetch_max_)
+      break;
+  }
+  prefetcher_->Prefetch(missing);
+}
+
+// Load the tiles along a line in the background, ends first
+void GraphReader::PrefetchAlong(const PointLL& a, const PointLL& b) {
+  if (!prefetcher_ && tile_url_.empty())
+    return;
+  // Local tiles first, near the ends is where the search spends most of its time
+  std::vector<GraphId> ids;
+  std::unordered_set<GraphId> seen;
+  float extent = std::max(std::abs(b.first - a.first), std::abs(b.second - a.second));
+  for (auto level = TileHierarchy::levels().crbegin(); level != TileHierarchy::levels().crend(); ++level) {
+    // Sample the line at half a tile so we don't hop over any tiles
+    size_t samples = static_cast<size_t>(std::ceil(extent / (level->second.tiles.TileSize() / 2.f))) + 1;
+    for (size_t i = 0; i <= samples / 2; ++i) {
+      for (auto t : { static_cast<float>(i) / samples, static_cast<float>(samples - i) / samples }) {
+        PointLL p(a.first + (b.first - a.first) * t, a.second + (b.second - a.second) * t);
+        auto id = TileHierarchy::GetGraphId(p, level->first);
+        if (id.Is_Valid() && seen.insert(id).second)
+          ids.push_back(id);
+      }
+    }
+  }
+  // No background threads so get the remote ones now rather than one at a time
+  if (!prefetcher_) {
+    if (ids.size() > prefetch_max_)
+      ids.resize(prefetch_max_);
+    FetchTiles(ids);
+    return;
+  }
+  Prefetch(ids);
+}
+
+// Fetch a batch of remote tiles all at once
+void GraphReader::FetchTiles(const std::vector<GraphId>& ids) {
+  if (tile_url_.empty() || !tile_extract_->empty())
+    return;
+
+  // Only the ones we dont have and dont know to be missing
+  std::vector<GraphId> bases;
+  std::vector<std::string> urls;
+  std::unordered_set<GraphId> seen;
+  for (const auto& id : ids) {
+    if (!id.Is_Valid() || id.level() > TileHierarchy::get_max_level())
+      continue;
+    auto base = id.Tile_Base();
+    if (!seen.insert(base).second || cache_->Contains(base) || _404s.find(base) != _404s.cend() ||
+        DoesTileExist(base))
+      continue;
+    bases.push_back(base);
+    urls.push_back(tile_url_ + filesystem::path_separator + GraphTile::FileSuffix(base));
+  }
+  if (bases.empty())
+    return;
+
+  // Fetch them all and cache the good ones
+  if (!multi_curler_)
+    multi_curler_.reset(new multi_curler_t(tile_url_concurrency_));
+  std::vector<long> http_codes;
+  auto responses = (*multi_curler_)(urls, http_codes);
+  for (size_t i = 0; i < bases.size(); ++i) {
+    GraphTile tile;
+    if (http_codes[i] == 200)
+      tile = GraphTile(bases[i], std::move(responses[i]));
+    if (!tile.header()) {
+      _404s.insert(bases[i]);
+      continue;
+    }
+    if (tile_url_spill_)
+      tile.Spill(tile_dir_);
+    cache_->Put(bases[i], tile, tile.header()->end_offset());
+  }
 }
 
 // Method to test if tile exists
@@ -187,15 +930,16 @@ bool GraphReader::DoesTileExist(const GraphId& graphid) const {
     return false;
   }
   //if you are using an extract only check that
-  if(!tile_extract_->tiles.empty())
-    return tile_extract_->tiles.find(graphid) != tile_extract_->tiles.cend();
+  if(!tile_extract_->empty())
+    return tile_extract_->find(graphid) != nullptr;
   //otherwise check memory or disk
   if(cache_->Contains(graphid))
     return true;
   std::string file_location = tile_dir_ + filesystem::path_separator +
             GraphTile::FileSuffix(graphid.Tile_Base());
   struct stat buffer;
-  return stat(file_location.c_str(), &buffer) == 0 || stat((file_location + ".gz").c_str(), &buffer) == 0;
+  return stat(file_location.c_str(), &buffer) == 0 || stat((file_location + ".gz").c_str(), &buffer) == 0 ||
+         stat((file_location + kLZ4TileExtension).c_str(), &buffer) == 0;
 }
 
 bool GraphReader::DoesTileExist(const boost::property_tree::ptree& pt, const GraphId& graphid) {
@@ -204,13 +948,14 @@ bool GraphReader::DoesTileExist(const boost::property_tree::ptree& pt, const Gra
   }
   //if you are using an extract only check that
   auto extract = get_extract_instance(pt);
-  if(!extract->tiles.empty())
-    return extract->tiles.find(graphid) != extract->tiles.cend();
+  if(!extract->empty())
+    return extract->find(graphid) != nullptr;
   //otherwise check the disk
   std::string file_location = pt.get<std::string>("tile_dir") + filesystem::path_separator +
             GraphTile::FileSuffix(graphid.Tile_Base());
   struct stat buffer;
-  return stat(file_location.c_str(), &buffer) == 0 || stat((file_location + ".gz").c_str(), &buffer) == 0;
+  return stat(file_location.c_str(), &buffer) == 0 || stat((file_location + ".gz").c_str(), &buffer) == 0 ||
+         stat((file_location + kLZ4TileExtension).c_str(), &buffer) == 0;
 }
 
 // Get a pointer to a graph tile object given a GraphId. Return nullptr
@@ -225,19 +970,25 @@ const GraphTile* GraphReader::GetGraphTile(const GraphId& graphid) {
 
   // Check if the level/tileid combination is in the cache
   auto base = graphid.Tile_Base();
+  if (heat_)
+    heat_->Count(base);
   if(auto cached = cache_->Get(base)) {
+    METRICS_COUNT(kTileCacheHits, 1);
+    ++tile_counts_.cache_hits;
     return cached;
   }
+  METRICS_COUNT(kTileCacheMisses, 1);
+  ++tile_counts_.cache_misses;
 
   // Try getting it from the memmapped tar extract
-  if (!tile_extract_->tiles.empty()) {
+  if (!tile_extract_->empty()) {
     // Do we have this tile
-    auto t = tile_extract_->tiles.find(base);
-    if(t == tile_extract_->tiles.cend())
+    auto t = tile_extract_->find(base);
+    if(t == nullptr)
       return nullptr;
 
     // This initializes the tile from mmap
-    GraphTile tile(base, t->second.first, t->second.second);
+    GraphTile tile(base, tile_extract_->data(*t), t->size);
     if (!tile.header())
       return nullptr;
 
@@ -247,15 +998,22 @@ const GraphTile* GraphReader::GetGraphTile(const GraphId& graphid) {
     return inserted;
   }// Try getting it from flat file
   else {
-    // This reads the tile from disk
-    GraphTile tile(tile_dir_, base);
-    if (!tile.header()) {
-      if(tile_url_.empty() || _404s.find(base) != _404s.end())
-        return nullptr;
-      tile = GraphTile(tile_url_, base, curler);
-      if(!tile.header()) {
-        _404s.insert(base);
-        return nullptr;
+    // This reads (or maps) the tile from disk unless it was prefetched. The
+    // compute slot of the thread, if it has one, is free for another thread
+    // to use while this one waits on the disk or the network
+    GraphTile tile;
+    {
+      midgard::compute_slots::ScopedWait wait;
+      if (!prefetcher_ || !prefetcher_->Take(base, tile))
+        tile = GraphTile(tile_dir_, base, tile_mmap_);
+      if (!tile.header()) {
+        if(tile_url_.empty() || _404s.find(base) != _404s.end())
+          return nullptr;
+        tile = GraphTile(tile_url_, base, curler, tile_url_spill_ ? tile_dir_ : "");
+        if(!tile.header()) {
+          _404s.insert(base);
+          return nullptr;
+        }
       }
     }
 
@@ -287,6 +1045,15 @@ GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, const GraphTile*&
   return id;
 }
 
+// Convenience method to recover the base edges of a shortcut edge.
+std::vector<GraphId> GraphReader::RecoverShortcut(const GraphId& shortcut_id) {
+  const GraphTile* tile = GetGraphTile(shortcut_id);
+  if (!tile || !tile->directededge(shortcut_id)->is_shortcut())
+    return {};
+  auto base_edges = tile->GetShortcutEdges(shortcut_id.id());
+  return std::vector<GraphId>(base_edges.begin(), base_edges.end());
+}
+
 // Convenience method to determine if 2 directed edges are connected.
 bool GraphReader::AreEdgesConnected(const GraphId& edge1, const GraphId& edge2) {
   // Check if there is a transition edge between n1 and n2
@@ -468,13 +1235,24 @@ std::pair<GraphId, GraphId> GraphReader::GetDirectedEdgeNodes(const GraphTile* t
   return std::make_pair(start_node, end_node);
 }
 
+// Get the segment index of the bins of a tile, building it if needed.
+std::shared_ptr<const SegmentIndex> GraphReader::GetSegmentIndex(const GraphTile* tile,
+                                                                 const uint32_t divisions) {
+  auto index = tile->segment_index();
+  if (index && index->divisions() == divisions) {
+    return index;
+  }
+  // Another reader may build one at the same time, the first one is kept
+  return tile->set_segment_index(std::make_shared<const SegmentIndex>(*tile, *this, divisions));
+}
+
 // Note: this will grab all road tiles and transit tiles.
 std::unordered_set<GraphId> GraphReader::GetTileSet() const {
   //either mmap'd tiles
   std::unordered_set<GraphId> tiles;
-  if(tile_extract_->tiles.size()) {
-    for(const auto& t : tile_extract_->tiles)
-      tiles.emplace(t.first);
+  if(!tile_extract_->empty()) {
+    for(const auto& t : *tile_extract_)
+      tiles.emplace(t.tile_id);
   }//or individually on disk
   else {
     //for each level
@@ -502,10 +1280,10 @@ std::unordered_set<GraphId> GraphReader::GetTileSet() const {
 std::unordered_set<GraphId> GraphReader::GetTileSet(const uint8_t level) const {
   //either mmap'd tiles
   std::unordered_set<GraphId> tiles;
-  if(tile_extract_->tiles.size()) {
-    for(const auto& t : tile_extract_->tiles)
-      if(static_cast<GraphId>(t.first).level() == level)
-        tiles.emplace(t.first);
+  if(!tile_extract_->empty()) {
+    for(const auto& t : *tile_extract_)
+      if(GraphId(t.tile_id).level() == level)
+        tiles.emplace(t.tile_id);
   }//or individually on disk
   else {
     //crack open this level of tiles directory
@@ -2,12 +2,15 @@
 #include "baldr/datetime.h"
 #include "baldr/filesystem_utils.h"
 #include "baldr/tilehierarchy.h"
+#include "baldr/tilecompression.h"
 #include "midgard/tiles.h"
 #include "midgard/aabb2.h"
 #include "midgard/pointll.h"
 #include "midgard/logging.h"
+#include "midgard/sequence.h"
 
 #include <ctime>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -15,7 +18,9 @@
 #include <locale>
 #include <iomanip>
 #include <cmath>
+#include <sys/stat.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -45,6 +50,7 @@ GraphTile::GraphTile()
       nodes_(nullptr),
       directededges_(nullptr),
       departures_(nullptr),
+      departure_count_(0),
       transit_stops_(nullptr),
       transit_routes_(nullptr),
       transit_schedules_(nullptr),
@@ -66,19 +72,47 @@ GraphTile::GraphTile()
       traffic_chunk_size_(0),
       lane_connectivity_(nullptr),
       lane_connectivity_size_(0),
-      edge_elevation_(nullptr) {
+      edge_elevation_(nullptr),
+      edge_bboxes_(nullptr),
+      hotedges_(nullptr),
+      speed_profile_index_(nullptr),
+      speed_profiles_(nullptr),
+      speed_profile_count_(0),
+      edge_attribute_index_(nullptr),
+      fixed_shape_index_(nullptr),
+      fixed_shape_index_count_(0),
+      fixed_shape_points_(nullptr),
+      shortcut_edges_index_(nullptr),
+      shortcut_edges_index_count_(0),
+      shortcut_base_edges_(nullptr) {
 }
 
 // Constructor given a filename. Reads the graph data into memory.
-GraphTile::GraphTile(const std::string& tile_dir, const GraphId& graphid)
+GraphTile::GraphTile(const std::string& tile_dir, const GraphId& graphid, bool mmap_tile)
       : header_(nullptr) {
 
   // Don't bother with invalid ids
   if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level())
     return;
 
-  // Open to the end of the file so we can immediately get size;
+  // Map the file read only so the os page cache backs the tile directly
   std::string file_location = tile_dir + filesystem::path_separator + FileSuffix(graphid.Tile_Base());
+  if (mmap_tile) {
+    struct stat s;
+    if (stat(file_location.c_str(), &s) == 0 && s.st_size > 0) {
+      try {
+        memmap_.reset(new midgard::mem_map<char>(file_location, s.st_size, POSIX_MADV_NORMAL, true));
+        Initialize(graphid, memmap_->get(), memmap_->size());
+        return;
+      }
+      catch (const std::exception& e) {
+        LOG_WARN("Could not map tile " + file_location + ": " + e.what());
+        memmap_.reset();
+      }
+    }
+  }
+
+  // Open to the end of the file so we can immediately get size;
   std::ifstream file(file_location, std::ios::in | std::ios::binary | std::ios::ate);
   if (file.is_open()) {
     // Read binary file into memory. TODO - protect against failure to
@@ -92,6 +126,10 @@ GraphTile::GraphTile(const std::string& tile_dir, const GraphId& graphid)
     // Set pointers to internal data structures
     Initialize(graphid, &(*graphtile_)[0], graphtile_->size());
   }
+  else if (ReadCompressed(file_location + kLZ4TileExtension)) {
+    // Set pointers to internal data structures
+    Initialize(graphid, &(*graphtile_)[0], graphtile_->size());
+  }
   else {
     std::ifstream file(file_location + ".gz", std::ios::in | std::ios::binary | std::ios::ate);
     if (file.is_open()) {
@@ -116,6 +154,28 @@ GraphTile::GraphTile(const std::string& tile_dir, const GraphId& graphid)
   }
 }
 
+// Read an lz4 compressed tile into graphtile_
+bool GraphTile::ReadCompressed(const std::string& file_location) {
+  std::ifstream file(file_location, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!file.is_open())
+    return false;
+
+  // Read the compressed container and decode it straight into a buffer
+  // sized by the uncompressed size in its header
+  size_t filesize = file.tellg();
+  std::vector<char> compressed(filesize);
+  file.seekg(0, std::ios::beg);
+  file.read(compressed.data(), filesize);
+  file.close();
+  graphtile_.reset(new std::vector<char>());
+  if (!lz4_decompress_tile(compressed.data(), compressed.size(), *graphtile_) || graphtile_->empty()) {
+    LOG_ERROR("Tile " + file_location + " is not a valid lz4 compressed tile");
+    graphtile_.reset();
+    return false;
+  }
+  return true;
+}
+
 GraphTile::GraphTile(const GraphId& graphid, char* ptr, size_t size)
     : header_(nullptr) {
   // Initialize the internal tile data structures using a pointer to the
@@ -123,7 +183,9 @@ GraphTile::GraphTile(const GraphId& graphid, char* ptr, size_t size)
   Initialize(graphid, ptr, size);
 }
 
-GraphTile::GraphTile(const std::string& tile_url, const GraphId& graphid, curler_t& curler) {
+GraphTile::GraphTile(const std::string& tile_url, const GraphId& graphid, curler_t& curler,
+                     const std::string& spill_dir)
+    : header_(nullptr) {
   // Don't bother with invalid ids
   if (!graphid.Is_Valid() || graphid.level() > TileHierarchy::get_max_level())
     return;
@@ -137,8 +199,51 @@ GraphTile::GraphTile(const std::string& tile_url, const GraphId& graphid, curler
   if(http_code == 200) {
     graphtile_ = std::make_shared<std::vector<char> >(std::move(tile_data));
     Initialize(graphid, &(*graphtile_)[0], graphtile_->size());
-    //TODO: optionally write the tile to disk?
+    if (!spill_dir.empty())
+      Spill(spill_dir);
+  }
+}
+
+GraphTile::GraphTile(const GraphId& graphid, std::vector<char>&& tile_data)
+    : header_(nullptr) {
+  if (tile_data.size() < sizeof(GraphTileHeader))
+    return;
+  graphtile_ = std::make_shared<std::vector<char> >(std::move(tile_data));
+  Initialize(graphid, &(*graphtile_)[0], graphtile_->size());
+}
+
+bool GraphTile::Spill(const std::string& tile_dir) const {
+  if (!header_)
+    return false;
+
+  // Write to a temporary file next to where the tile goes
+  std::string file_location = tile_dir + filesystem::path_separator + FileSuffix(header_->graphid());
+  boost::filesystem::path path(file_location);
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(path.parent_path(), ec);
+  auto tmp_location = file_location + "." + boost::filesystem::unique_path().string();
+  {
+    std::ofstream file(tmp_location, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      LOG_WARN("Could not spill tile to " + file_location);
+      return false;
+    }
+    size_t size = graphtile_ ? graphtile_->size() : header_->end_offset();
+    file.write(reinterpret_cast<const char*>(header_), size);
+    if (!file) {
+      file.close();
+      boost::filesystem::remove(tmp_location, ec);
+      return false;
+    }
+  }
+
+  // Move it into place
+  boost::filesystem::rename(tmp_location, file_location, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp_location, ec);
+    return false;
   }
+  return true;
 }
 
 GraphTile::~GraphTile() {
@@ -167,8 +272,27 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr,
 
   // Set a pointer to the transit departure list
   departures_ = reinterpret_cast<TransitDeparture*>(ptr);
+  departure_count_ = header_->departurecount();
   ptr += header_->departurecount() * sizeof(TransitDeparture);
 
+  // Departures of repetitive timetables are stored as schedule patterns and
+  // their trips, expand them once so lookups see every departure of the tile
+  const auto* patterns = reinterpret_cast<const TransitPattern*>(ptr);
+  ptr += header_->departure_pattern_count() * sizeof(TransitPattern);
+  const auto* trips = reinterpret_cast<const PatternTrip*>(ptr);
+  ptr += header_->pattern_trip_count() * sizeof(PatternTrip);
+  decoded_departures_.reset();
+  if (header_->departure_pattern_count() > 0) {
+    decoded_departures_.reset(new std::vector<TransitDeparture>(
+        TransitPattern::Decode(departures_, departure_count_, patterns,
+                               header_->departure_pattern_count(), trips)));
+    departures_ = decoded_departures_->data();
+    departure_count_ = decoded_departures_->size();
+  }
+  departure_index_.reset();
+  if (departure_count_ > 0)
+    departure_index_.reset(new TransitDepartureIndex(departures_, departure_count_));
+
   // Set a pointer to the transit stop list
   transit_stops_ = reinterpret_cast<TransitStop*>(ptr);
   ptr += header_->stopcount() * sizeof(TransitStop);
@@ -206,6 +330,14 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr,
   complex_restriction_reverse_size_ =
       header_->edgeinfo_offset() - header_->complex_restriction_reverse_offset();
 
+  // Index the restrictions by edge so looking them up doesn't have to scan
+  // all of them, turn restricted city centers have many
+  auto derived = std::make_shared<derived_t>();
+  IndexRestrictions(complex_restriction_forward_, complex_restriction_forward_size_,
+                    true, derived->complex_restriction_forward_index);
+  IndexRestrictions(complex_restriction_reverse_, complex_restriction_reverse_size_,
+                    false, derived->complex_restriction_reverse_index);
+
   // Start of edge information and its size
   edgeinfo_ = tile_ptr + header_->edgeinfo_offset();
   edgeinfo_size_ = header_->textlist_offset() - header_->edgeinfo_offset();
@@ -231,16 +363,116 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr,
   // the header) then the count is the same as the directed edge count.
   edge_elevation_ = reinterpret_cast<EdgeElevation*>(tile_ptr + header_->edge_elevation_offset());
 
+  // Start of the edge bounding boxes. Tiles that have them have one for each
+  // directed edge, older tiles have none.
+  edge_bboxes_ = nullptr;
+  if (header_->directededgecount() > 0 &&
+      header_->hotedge_offset() - header_->edge_bbox_offset() ==
+      header_->directededgecount() * sizeof(EdgeBBox)) {
+    edge_bboxes_ = reinterpret_cast<EdgeBBox*>(tile_ptr + header_->edge_bbox_offset());
+    bounding_box_ = BoundingBox();
+  }
+
+  // Start of the hot edges, one for each directed edge. Older tiles don't
+  // have them so make them from the directed edges.
+  if (header_->speed_profile_offset() - header_->hotedge_offset() ==
+      header_->directededgecount() * sizeof(HotEdge)) {
+    hotedges_ = reinterpret_cast<HotEdge*>(tile_ptr + header_->hotedge_offset());
+  } else {
+    derived_hotedges_.reset(new std::vector<HotEdge>(directededges_,
+                            directededges_ + header_->directededgecount()));
+    hotedges_ = derived_hotedges_->data();
+  }
+
+  // Start of the speed profile index of the directed edges followed by the
+  // profiles. Older tiles and tiles without historical speeds have none.
+  speed_profile_index_ = nullptr;
+  speed_profiles_ = nullptr;
+  speed_profile_count_ = 0;
+  uint32_t index_size = SpeedProfileIndexSize(header_->directededgecount());
+  uint32_t profiles_size = header_->edge_attribute_index_offset() - header_->speed_profile_offset();
+  if (header_->directededgecount() > 0 && profiles_size > index_size &&
+      (profiles_size - index_size) % sizeof(SpeedProfile) == 0) {
+    speed_profile_index_ = reinterpret_cast<uint16_t*>(tile_ptr + header_->speed_profile_offset());
+    speed_profiles_ = reinterpret_cast<SpeedProfile*>(tile_ptr + header_->speed_profile_offset() +
+                                                      index_size);
+    speed_profile_count_ = (profiles_size - index_size) / sizeof(SpeedProfile);
+  }
+
+  // Start of the edge attribute index, one entry for each directed edge plus
+  // one. Older tiles don't have it so their lists are searched instead.
+  edge_attribute_index_ = nullptr;
+  if (header_->fixed_shape_offset() - header_->edge_attribute_index_offset() ==
+      (header_->directededgecount() + 1) * sizeof(EdgeAttributeIndex)) {
+    edge_attribute_index_ = reinterpret_cast<EdgeAttributeIndex*>(tile_ptr +
+                                header_->edge_attribute_index_offset());
+  }
+
+  // Start of the fixed point shapes, the number of index entries, padding,
+  // the index of the edge infos then the points. Tiles only have them if
+  // they were added after building them.
+  fixed_shape_index_ = nullptr;
+  fixed_shape_index_count_ = 0;
+  fixed_shape_points_ = nullptr;
+  uint32_t fixed_shape_size = header_->shortcut_edges_offset() - header_->fixed_shape_offset();
+  if (header_->fixed_shape_offset() >= sizeof(GraphTileHeader) &&
+      fixed_shape_size >= 2 * sizeof(uint32_t)) {
+    uint32_t count = *reinterpret_cast<uint32_t*>(tile_ptr + header_->fixed_shape_offset());
+    uint32_t index_size = 2 * sizeof(uint32_t) + count * sizeof(FixedShapeIndex);
+    if (count > 0 && fixed_shape_size >= index_size &&
+        (fixed_shape_size - index_size) % sizeof(FixedPoint) == 0) {
+      fixed_shape_index_ = reinterpret_cast<FixedShapeIndex*>(tile_ptr + header_->fixed_shape_offset() +
+                                                               2 * sizeof(uint32_t));
+      fixed_shape_index_count_ = count;
+      fixed_shape_points_ = reinterpret_cast<FixedPoint*>(tile_ptr + header_->fixed_shape_offset() +
+                                                          index_size);
+    }
+  }
+
+  // Start of the base edges of the shortcut edges, the number of index
+  // entries, padding, the index of the shortcuts then the base edges. Tiles
+  // built before shortcuts kept their base edges have none.
+  shortcut_edges_index_ = nullptr;
+  shortcut_edges_index_count_ = 0;
+  shortcut_base_edges_ = nullptr;
+  uint32_t shortcut_edges_size = header_->end_offset() - header_->shortcut_edges_offset();
+  if (header_->shortcut_edges_offset() >= sizeof(GraphTileHeader) &&
+      shortcut_edges_size >= 2 * sizeof(uint32_t)) {
+    uint32_t count = *reinterpret_cast<uint32_t*>(tile_ptr + header_->shortcut_edges_offset());
+    uint32_t index_size = 2 * sizeof(uint32_t) + count * sizeof(ShortcutEdgesIndex);
+    if (count > 0 && shortcut_edges_size >= index_size &&
+        (shortcut_edges_size - index_size) % sizeof(GraphId) == 0) {
+      shortcut_edges_index_ = reinterpret_cast<ShortcutEdgesIndex*>(tile_ptr +
+          header_->shortcut_edges_offset() + 2 * sizeof(uint32_t));
+      shortcut_edges_index_count_ = count;
+      shortcut_base_edges_ = reinterpret_cast<GraphId*>(tile_ptr + header_->shortcut_edges_offset() +
+                                                        index_size);
+    }
+  }
+
   // For reference - how to use the end offset to set size of an object (that
   // is not fixed size and count).
   // example_size_ = header_->end_offset() - header_->example_offset();
 
   // ANY NEW EXPANSION DATA GOES HERE
 
+  // Pack the access of the edges together so filtering by access is cheap
+  derived->edge_access.reserve(header_->directededgecount());
+  for (uint32_t i = 0; i < header_->directededgecount(); ++i) {
+    derived->edge_access.push_back(directededges_[i].forwardaccess() |
+                                   (directededges_[i].reverseaccess() << kReverseAccessShift));
+  }
+
+  // Keep the decoded shapes of the edges if the process wants them
+  if (EdgeShapeCache::max_shapes() > 0) {
+    derived->shape_cache.reset(new EdgeShapeCache(EdgeShapeCache::max_shapes()));
+  }
+
   // Associate one stop Ids for transit tiles
   if (graphid.level() == 3) {
-    AssociateOneStopIds(graphid);
+    AssociateOneStopIds(graphid, *derived);
   }
+  derived_ = std::move(derived);
 }
 
 // For transit tiles we need to save off the pair<tileid,lineid> lookup via
@@ -248,12 +480,12 @@ void GraphTile::Initialize(const GraphId& graphid, char* tile_ptr,
 // for transit routes.  We save 2 maps because operators contain all of their
 // route's tile_line pairs and it is used to include or exclude the operator
 // as a whole. Also associates stops.
-void GraphTile::AssociateOneStopIds(const GraphId& graphid) {
+void GraphTile::AssociateOneStopIds(const GraphId& graphid, derived_t& derived) {
   // Associate stop Ids
-  stop_one_stops.reserve(header_->stopcount());
+  derived.stop_one_stops.reserve(header_->stopcount());
   for (uint32_t i = 0; i < header_->stopcount(); i++) {
     const auto& stop = GetName(transit_stops_[i].one_stop_offset());
-    stop_one_stops[stop] = tile_index_pair(graphid.tileid(), i);
+    derived.stop_one_stops[stop] = tile_index_pair(graphid.tileid(), i);
   }
 
   // Associate route and operator Ids
@@ -261,24 +493,24 @@ void GraphTile::AssociateOneStopIds(const GraphId& graphid) {
   for (auto const& dep: deps) {
     const auto* t = GetTransitRoute(dep.second->routeid());
     const auto& route_one_stop = GetName(t->one_stop_offset());
-    auto stops = route_one_stops.find(route_one_stop);
-    if (stops == route_one_stops.end()) {
+    auto stops = derived.route_one_stops.find(route_one_stop);
+    if (stops == derived.route_one_stops.end()) {
       std::list<tile_index_pair> tile_line_ids;
       tile_line_ids.emplace_back(tile_index_pair(graphid.tileid(), dep.second->lineid()));
-      route_one_stops[route_one_stop] = tile_line_ids;
+      derived.route_one_stops[route_one_stop] = tile_line_ids;
     } else {
-      route_one_stops[route_one_stop].emplace_back(tile_index_pair(graphid.tileid(), dep.second->lineid()));
+      derived.route_one_stops[route_one_stop].emplace_back(tile_index_pair(graphid.tileid(), dep.second->lineid()));
     }
 
     // operators contain all of their route's tile_line pairs.
     const auto& op_one_stop = GetName(t->op_by_onestop_id_offset());
-    stops = oper_one_stops.find(op_one_stop);
-    if (stops == oper_one_stops.end()) {
+    stops = derived.oper_one_stops.find(op_one_stop);
+    if (stops == derived.oper_one_stops.end()) {
       std::list<tile_index_pair> tile_line_ids;
       tile_line_ids.emplace_back(tile_index_pair(graphid.tileid(), dep.second->lineid()));
-      oper_one_stops[op_one_stop] = tile_line_ids;
+      derived.oper_one_stops[op_one_stop] = tile_line_ids;
     } else {
-      oper_one_stops[op_one_stop].emplace_back(tile_index_pair(graphid.tileid(), dep.second->lineid()));
+      derived.oper_one_stops[op_one_stop].emplace_back(tile_index_pair(graphid.tileid(), dep.second->lineid()));
     }
   }
 }
@@ -407,15 +639,20 @@ GraphId GraphTile::GetTileId(const std::string& fname) {
 
 // Get the bounding box of this graph tile.
 AABB2<PointLL> GraphTile::BoundingBox() const {
+  return BoundingBox(header_->graphid());
+}
+
+// Get the bounding box of a graph tile.
+AABB2<PointLL> GraphTile::BoundingBox(const GraphId& graphid) {
 
   //figure the largest id for this level
-  auto level = TileHierarchy::levels().find(header_->graphid().level());
+  auto level = TileHierarchy::levels().find(graphid.level());
   if(level == TileHierarchy::levels().end() &&
-      header_->graphid().level() == ((TileHierarchy::levels().rbegin())->second.level+1))
+      graphid.level() == ((TileHierarchy::levels().rbegin())->second.level+1))
     level = TileHierarchy::levels().begin();
 
   auto tiles = level->second.tiles;
-  return tiles.TileBounds(header_->graphid().tileid());
+  return tiles.TileBounds(graphid.tileid());
 }
 
 iterable_t<const DirectedEdge> GraphTile::GetDirectedEdges(const GraphId& node) const {
@@ -446,7 +683,38 @@ iterable_t<const DirectedEdge> GraphTile::GetDirectedEdges(const size_t idx) con
 
 // Get a pointer to edge info.
 EdgeInfo GraphTile::edgeinfo(const size_t offset) const {
-  return EdgeInfo(edgeinfo_ + offset, textlist_, textlist_size_);
+  return EdgeInfo(edgeinfo_ + offset, textlist_, textlist_size_,
+                  derived_ ? derived_->shape_cache.get() : nullptr);
+}
+
+// Get the fixed point shape of an edge info
+FixedShapeDecoder<PointLL> GraphTile::fixed_shape(const uint32_t edgeinfo_offset) const {
+  // The last entry only marks the end of the points
+  auto end = fixed_shape_index_ + fixed_shape_index_count_ - 1;
+  auto entry = std::lower_bound(fixed_shape_index_, end, edgeinfo_offset,
+      [](const FixedShapeIndex& index, const uint32_t offset) {
+        return index.edgeinfo_offset < offset;
+      });
+  if (entry == end || entry->edgeinfo_offset != edgeinfo_offset)
+    return FixedShapeDecoder<PointLL>(fixed_shape_points_, fixed_shape_points_);
+  return FixedShapeDecoder<PointLL>(fixed_shape_points_ + entry->first_point,
+                                    fixed_shape_points_ + (entry + 1)->first_point);
+}
+
+// Get the base edges of a shortcut edge
+midgard::iterable_t<const GraphId> GraphTile::GetShortcutEdges(const uint32_t idx) const {
+  if (shortcut_edges_index_ == nullptr)
+    return midgard::iterable_t<const GraphId>(shortcut_base_edges_, shortcut_base_edges_);
+  // The last entry only marks the end of the base edges
+  auto end = shortcut_edges_index_ + shortcut_edges_index_count_ - 1;
+  auto entry = std::lower_bound(shortcut_edges_index_, end, idx,
+      [](const ShortcutEdgesIndex& index, const uint32_t idx) {
+        return index.shortcut_index < idx;
+      });
+  if (entry == end || entry->shortcut_index != idx)
+    return midgard::iterable_t<const GraphId>(shortcut_base_edges_, shortcut_base_edges_);
+  return midgard::iterable_t<const GraphId>(shortcut_base_edges_ + entry->first_edge,
+                                            shortcut_base_edges_ + (entry + 1)->first_edge);
 }
 
 // Get the complex restrictions in the forward or reverse order based on
@@ -455,26 +723,54 @@ std::vector<ComplexRestriction> GraphTile::GetRestrictions(const bool forward,
                                                            const GraphId id,
                                                            const uint64_t modes) const {
   std::vector<ComplexRestriction> cr_vector;
-  size_t offset = 0;
+  VisitRestrictions(forward, id, modes, [&cr_vector](const ComplexRestriction& cr) {
+    cr_vector.push_back(cr);
+    return true;
+  });
+  return cr_vector;
+}
 
-  if (forward) {
-    while (offset < complex_restriction_forward_size_) {
+// Is there a complex restriction in the forward or reverse order for the id
+// and modes
+bool GraphTile::HasRestrictions(const bool forward, const GraphId id,
+                                const uint64_t modes) const {
+  bool found = false;
+  VisitRestrictions(forward, id, modes, [&found](const ComplexRestriction&) {
+    found = true;
+    return false;
+  });
+  return found;
+}
 
-      ComplexRestriction cr(complex_restriction_forward_ + offset);
-      offset += cr.SizeOf();
-      if (cr.to_id() == id && (cr.modes() & modes))
-        cr_vector.push_back(cr);
-    }
-  } else {
-    while (offset < complex_restriction_reverse_size_) {
+// Visit the complex restrictions in the forward or reverse order based on
+// the id and modes until the visitor returns false
+void GraphTile::VisitRestrictions(const bool forward, const GraphId id, const uint64_t modes,
+    const std::function<bool (const ComplexRestriction&)>& visitor) const {
+  if (!derived_)
+    return;
+  char* restrictions = forward ? complex_restriction_forward_ : complex_restriction_reverse_;
+  const auto& index = forward ? derived_->complex_restriction_forward_index :
+                                derived_->complex_restriction_reverse_index;
+  auto entry = std::lower_bound(index.cbegin(), index.cend(), std::make_pair(id.value, 0u));
+  for (; entry != index.cend() && entry->first == id.value; ++entry) {
+    ComplexRestriction cr(restrictions + entry->second);
+    if ((cr.modes() & modes) && !visitor(cr))
+      return;
+  }
+}
 
-      ComplexRestriction cr(complex_restriction_reverse_ + offset);
-      offset += cr.SizeOf();
-      if (cr.from_id() == id && (cr.modes() & modes))
-        cr_vector.push_back(cr);
-    }
+// Index complex restrictions by the edge they are found by
+void GraphTile::IndexRestrictions(char* restrictions, const std::size_t size,
+                                  const bool forward, restriction_index_t& index) {
+  index.clear();
+  size_t offset = 0;
+  while (offset < size) {
+    ComplexRestriction cr(restrictions + offset);
+    index.emplace_back((forward ? cr.to_id() : cr.from_id()).value, offset);
+    offset += cr.SizeOf();
   }
-  return cr_vector;
+  // Keep restrictions of the same edge in tile order
+  std::sort(index.begin(), index.end());
 }
 
 // Get the directed edges outbound from the specified node index.
@@ -520,6 +816,11 @@ const Admin* GraphTile::admin(const size_t idx) const {
 
 // Convenience method to get the text/name for a given offset to the textlist
 std::string GraphTile::GetName(const uint32_t textlist_offset) const {
+  return GetText(textlist_offset);
+}
+
+// Get the text/name for a given offset to the textlist without copying it
+const char* GraphTile::GetText(const uint32_t textlist_offset) const {
   if (textlist_offset < textlist_size_) {
     return textlist_ + textlist_offset;
   } else {
@@ -530,12 +831,30 @@ std::string GraphTile::GetName(const uint32_t textlist_offset) const {
 // Convenience method to get the signs for an edge given the
 // directed edge index.
 std::vector<SignInfo> GraphTile::GetSigns(const uint32_t idx) const {
-  uint32_t count = header_->signcount();
   std::vector<SignInfo> signs;
-  if (count == 0) {
+  if (header_->signcount() == 0) {
     return signs;
   }
 
+  // Add signs
+  auto range = GetSignRange(idx);
+  signs.reserve(range.size());
+  for (const auto& sign : range)
+    signs.emplace_back(sign.type(), GetText(sign.text_offset()));
+  if (signs.size() == 0)
+    LOG_ERROR("No signs found for idx = " + std::to_string(idx));
+  return signs;
+}
+
+midgard::iterable_t<const Sign> GraphTile::GetSignRange(const uint32_t idx) const {
+  uint32_t count = header_->signcount();
+  if (edge_attribute_index_ != nullptr) {
+    if (idx >= header_->directededgecount())
+      return midgard::iterable_t<const Sign>(signs_, signs_);
+    return midgard::iterable_t<const Sign>(signs_ + edge_attribute_index_[idx].sign(),
+                                           signs_ + edge_attribute_index_[idx + 1].sign());
+  }
+
   // Signs are sorted by edge index.
   // Binary search to find a sign with matching edge index.
   int32_t low = 0;
@@ -558,25 +877,31 @@ std::vector<SignInfo> GraphTile::GetSigns(const uint32_t idx) const {
     }
   }
 
-  // Add signs
-  for(; found < count && signs_[found].edgeindex() == idx; ++found) {
-    if (signs_[found].text_offset() < textlist_size_)
-      signs.emplace_back(signs_[found].type(), (textlist_ + signs_[found].text_offset()));
-    else
-      throw std::runtime_error("GetSigns: offset exceeds size of text list");
-  }
-  if (signs.size() == 0)
-    LOG_ERROR("No signs found for idx = " + std::to_string(idx));
-  return signs;
+  // The signs of the edge follow the first one
+  uint32_t end = found;
+  while (end < count && signs_[end].edgeindex() == idx)
+    ++end;
+  return midgard::iterable_t<const Sign>(signs_ + found, signs_ + end);
 }
 
 // Get lane connections ending on this edge.
 std::vector<LaneConnectivity> GraphTile::GetLaneConnectivity(const uint32_t idx) const {
-  uint32_t count = lane_connectivity_size_ / sizeof(LaneConnectivity);
-  std::vector<LaneConnectivity> lcs;
-  if (count == 0) {
+  auto range = GetLaneConnectivityRange(idx);
+  std::vector<LaneConnectivity> lcs(range.begin(), range.end());
+  if (lcs.size() == 0)
     LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
-    return lcs;
+  return lcs;
+}
+
+midgard::iterable_t<const LaneConnectivity> GraphTile::GetLaneConnectivityRange(
+    const uint32_t idx) const {
+  uint32_t count = lane_connectivity_size_ / sizeof(LaneConnectivity);
+  if (edge_attribute_index_ != nullptr) {
+    if (idx >= header_->directededgecount())
+      return midgard::iterable_t<const LaneConnectivity>(lane_connectivity_, lane_connectivity_);
+    return midgard::iterable_t<const LaneConnectivity>(
+        lane_connectivity_ + edge_attribute_index_[idx].lane_connectivity(),
+        lane_connectivity_ + edge_attribute_index_[idx + 1].lane_connectivity());
   }
 
   // Lane connections are sorted by edge index.
@@ -601,13 +926,12 @@ std::vector<LaneConnectivity> GraphTile::GetLaneConnectivity(const uint32_t idx)
     }
   }
 
-  // Add Lane connections
-  for(; found < count && lane_connectivity_[found].to() == idx; ++found) {
-    lcs.emplace_back(lane_connectivity_[found]);
-  }
-  if (lcs.size() == 0)
-    LOG_ERROR("No lane connections found for idx = " + std::to_string(idx));
-  return lcs;
+  // The lane connections of the edge follow the first one
+  uint32_t end = found;
+  while (end < count && lane_connectivity_[end].to() == idx)
+    ++end;
+  return midgard::iterable_t<const LaneConnectivity>(lane_connectivity_ + found,
+                                                     lane_connectivity_ + end);
 }
 
 // Get the next departure given the directed line Id and the current
@@ -616,71 +940,61 @@ const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
                  const uint32_t current_time, const uint32_t day,
                  const uint32_t dow, bool date_before_tile,
                  bool wheelchair, bool bicycle) const {
-  uint32_t count = header_->departurecount();
-  if (count == 0) {
+  if (departure_index_ == nullptr) {
     return nullptr;
   }
 
-  // Departures are sorted by edge Id and then by departure time.
-  // Binary search to find a departure with matching line Id.
-  int32_t low = 0;
-  int32_t high = count-1;
-  int32_t mid;
-  int32_t found = count;
-  while (low <= high) {
-    mid = (low + high) / 2;
-    const auto& dep = departures_[mid];
-    //matching lineid and a workable time
-    if (lineid == dep.lineid() &&
-        ((current_time <= dep.departure_time() && dep.type() == kFixedSchedule) ||
-         (current_time <= dep.end_time() && dep.type() == kFrequencySchedule))) {
-      found = mid;
-      high = mid - 1;
-    }//need a smaller lineid
-    else if (lineid < dep.lineid()) {
-      high = mid - 1;
-    }//either need a bigger lineid or a later time
-    else {
-      low = mid + 1;
-    }
+  // Only the departures on schedules valid for the date and day of week,
+  // each schedule is checked once per run of departures using it
+  uint32_t departure_time;
+  uint32_t found = departure_index_->Next(lineid, current_time,
+      [this, day, dow, date_before_tile](const uint32_t schedule_index) {
+        return GetTransitSchedule(schedule_index)->IsValid(day, dow, date_before_tile);
+      }, wheelchair, bicycle, departure_time);
+  if (found != kNoDeparture) {
+    const auto& d = departures_[found];
+    if (d.type() == kFixedSchedule)
+      return &d;
+    return new TransitDeparture(d.lineid(),d.tripid(), d.routeid(),
+                                d.blockid(), d.headsign_offset(), departure_time,
+                                d.end_time(),d.frequency(),
+                                d.elapsed_time(), d.schedule_index(),
+                                d.wheelchair_accessible(), d.bicycle_accessible());
   }
 
-  // Iterate through departures until one is found with valid date, dow or
-  // calendar date, and does not have a calendar exception.
-  for(; found < count && departures_[found].lineid() == lineid; ++found) {
-    // Make sure valid departure time
-    if (departures_[found].type() == kFixedSchedule) {
-      if (departures_[found].departure_time() >= current_time &&
-          GetTransitSchedule(departures_[found].schedule_index())->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
-        return &departures_[found];
-      }
-    } else {
-      uint32_t departure_time = departures_[found].departure_time();
-      uint32_t end_time = departures_[found].end_time();
-      uint32_t frequency = departures_[found].frequency();
-      while (departure_time < current_time && departure_time < end_time)
-        departure_time += frequency;
+  // TODO - maybe wrap around, try next day?
+  LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
+           " current_time = " + std::to_string(current_time));
+  return nullptr;
+}
 
-      if (departure_time >= current_time && departure_time < end_time &&
-          GetTransitSchedule(departures_[found].schedule_index())->IsValid(day, dow, date_before_tile) &&
-          (!wheelchair || departures_[found].wheelchair_accessible()) &&
-          (!bicycle || departures_[found].bicycle_accessible())) {
+// Get the previous departure given the line Id and the current time at
+// the end of the line
+const TransitDeparture* GraphTile::GetPreviousDeparture(const uint32_t lineid,
+                 const uint32_t current_time, const uint32_t day,
+                 const uint32_t dow, bool date_before_tile,
+                 bool wheelchair, bool bicycle) const {
+  if (departure_index_ == nullptr) {
+    return nullptr;
+  }
 
-        const auto& d = departures_[found];
-        const TransitDeparture *dep = new TransitDeparture(d.lineid(),d.tripid(), d.routeid(),
-                                                           d.blockid(), d.headsign_offset(), departure_time,
-                                                           d.end_time(),d.frequency(),
-                                                           d.elapsed_time(), d.schedule_index(),
-                                                           d.wheelchair_accessible(), d.bicycle_accessible());
-        return dep;
-      }
-    }
+  uint32_t departure_time;
+  uint32_t found = departure_index_->Previous(lineid, current_time,
+      [this, day, dow, date_before_tile](const uint32_t schedule_index) {
+        return GetTransitSchedule(schedule_index)->IsValid(day, dow, date_before_tile);
+      }, wheelchair, bicycle, departure_time);
+  if (found != kNoDeparture) {
+    const auto& d = departures_[found];
+    if (d.type() == kFixedSchedule)
+      return &d;
+    return new TransitDeparture(d.lineid(),d.tripid(), d.routeid(),
+                                d.blockid(), d.headsign_offset(), departure_time,
+                                d.end_time(),d.frequency(),
+                                d.elapsed_time(), d.schedule_index(),
+                                d.wheelchair_accessible(), d.bicycle_accessible());
   }
 
-  // TODO - maybe wrap around, try next day?
-  LOG_DEBUG("No more departures found for lineid = " + std::to_string(lineid) +
+  LOG_DEBUG("No earlier departures found for lineid = " + std::to_string(lineid) +
            " current_time = " + std::to_string(current_time));
   return nullptr;
 }
@@ -688,7 +1002,7 @@ const TransitDeparture* GraphTile::GetNextDeparture(const uint32_t lineid,
 // Get the departure given the line Id and tripid
 const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
                      const uint32_t tripid, const uint32_t current_time) const {
-  uint32_t count = header_->departurecount();
+  uint32_t count = departure_count_;
   if (count == 0) {
     return nullptr;
   }
@@ -740,8 +1054,8 @@ const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
     }
   }
 
-  LOG_INFO("No departures found for lineid = " + std::to_string(lineid) +
-           " and tripid = " + std::to_string(tripid));
+  LOG_DEBUG("No departures found for lineid = " + std::to_string(lineid) +
+            " and tripid = " + std::to_string(tripid));
   return nullptr;
 }
 
@@ -749,9 +1063,9 @@ const TransitDeparture* GraphTile::GetTransitDeparture(const uint32_t lineid,
 std::unordered_map<uint32_t,TransitDeparture*> GraphTile::GetTransitDepartures() const {
 
   std::unordered_map<uint32_t,TransitDeparture*> deps;
-  deps.reserve(header_->departurecount());
+  deps.reserve(departure_count_);
 
-  for (uint32_t i = 0; i < header_->departurecount(); i++)
+  for (uint32_t i = 0; i < departure_count_; i++)
     deps.insert({departures_[i].lineid(),&departures_[i]});
 
   return deps;
@@ -760,19 +1074,19 @@ std::unordered_map<uint32_t,TransitDeparture*> GraphTile::GetTransitDepartures()
 // Get the stop onestops in this tile
 std::unordered_map<std::string, tile_index_pair>
 GraphTile::GetStopOneStops() const {
-  return stop_one_stops;
+  return derived_ ? derived_->stop_one_stops : std::unordered_map<std::string, tile_index_pair>{};
 }
 
 // Get the route onestops in this tile.
 std::unordered_map<std::string, std::list<tile_index_pair>>
 GraphTile::GetRouteOneStops() const {
-  return route_one_stops;
+  return derived_ ? derived_->route_one_stops : std::unordered_map<std::string, std::list<tile_index_pair>>{};
 }
 
 // Get the operator onestops in this tile.
 std::unordered_map<std::string, std::list<tile_index_pair>>
 GraphTile::GetOperatorOneStops() const {
-  return oper_one_stops;
+  return derived_ ? derived_->oper_one_stops : std::unordered_map<std::string, std::list<tile_index_pair>>{};
 }
 
 // Get the transit stop given its index within the tile.
@@ -813,15 +1127,34 @@ const TransitSchedule* GraphTile::GetTransitSchedule(const uint32_t idx) const {
 // Get the access restriction given its directed edge index
 std::vector<AccessRestriction> GraphTile::GetAccessRestrictions(const uint32_t idx,
                                                                 const uint32_t access) const {
-
   std::vector<AccessRestriction> restrictions;
-  uint32_t count = header_->access_restriction_count();
-  if (count == 0) {
+  if (header_->access_restriction_count() == 0) {
     return restrictions;
   }
 
+  // Add restrictions for only the access that we are interested in
+  for (const auto& restriction : GetAccessRestrictionRange(idx))
+    if (restriction.modes() & access)
+      restrictions.emplace_back(restriction);
+
+  if (restrictions.size() == 0)
+    LOG_ERROR("No restrictions found for edge index = " + std::to_string(idx));
+  return restrictions;
+}
+
+midgard::iterable_t<const AccessRestriction> GraphTile::GetAccessRestrictionRange(
+    const uint32_t idx) const {
+  uint32_t count = header_->access_restriction_count();
+  if (edge_attribute_index_ != nullptr) {
+    if (idx >= header_->directededgecount())
+      return midgard::iterable_t<const AccessRestriction>(access_restrictions_, access_restrictions_);
+    return midgard::iterable_t<const AccessRestriction>(
+        access_restrictions_ + edge_attribute_index_[idx].access_restriction(),
+        access_restrictions_ + edge_attribute_index_[idx + 1].access_restriction());
+  }
+
   // Access restriction are sorted by edge Id.
-  // Binary search to find a access restriction with matching edge Id.
+  // Binary search to find the first access restriction with matching edge Id.
   int32_t low = 0;
   int32_t high = count-1;
   int32_t mid;
@@ -842,14 +1175,12 @@ std::vector<AccessRestriction> GraphTile::GetAccessRestrictions(const uint32_t i
     }
   }
 
-  // Add restrictions for only the access that we are interested in
-  for (; found < count && access_restrictions_[found].edgeindex() == idx; ++found)
-    if (access_restrictions_[found].modes() & access)
-      restrictions.emplace_back(access_restrictions_[found]);
-
-  if (restrictions.size() == 0)
-    LOG_ERROR("No restrictions found for edge index = " + std::to_string(idx));
-  return restrictions;
+  // The restrictions of the edge follow the first one
+  uint32_t end = found;
+  while (end < count && access_restrictions_[end].edgeindex() == idx)
+    ++end;
+  return midgard::iterable_t<const AccessRestriction>(access_restrictions_ + found,
+                                                      access_restrictions_ + end);
 }
 
 // Get the array of graphids for this bin
@@ -863,6 +1194,23 @@ midgard::iterable_t<GraphId> GraphTile::GetBin(size_t index) const {
   return iterable_t<GraphId>{edge_bins_ + offsets.first, edge_bins_ + offsets.second};
 }
 
+// Get the segment index of the bins of the tile, if it has been built.
+std::shared_ptr<const SegmentIndex> GraphTile::segment_index() const {
+  return std::atomic_load(&segment_index_);
+}
+
+// Attach a segment index to the tile unless an equivalent one was attached
+std::shared_ptr<const SegmentIndex> GraphTile::set_segment_index(
+    std::shared_ptr<const SegmentIndex> index) const {
+  auto current = std::atomic_load(&segment_index_);
+  while (!current || current->divisions() != index->divisions()) {
+    if (std::atomic_compare_exchange_weak(&segment_index_, &current, index)) {
+      return index;
+    }
+  }
+  return current;
+}
+
 std::vector<TrafficSegment> GraphTile::GetTrafficSegments(const GraphId& edge) const {
   if(edge.Tile_Base() != header_->graphid())
     throw std::runtime_error("Wrong tile for edge id");
@@ -871,34 +1219,48 @@ std::vector<TrafficSegment> GraphTile::GetTrafficSegments(const GraphId& edge) c
 
 // Get traffic segment(s) associated to this edge.
 std::vector<TrafficSegment> GraphTile::GetTrafficSegments(const uint32_t idx) const {
+  std::vector<TrafficSegment> segments;
+  GetTrafficSegments(idx, segments);
+  return segments;
+}
+
+void GraphTile::GetTrafficSegments(const GraphId& edge, std::vector<TrafficSegment>& segments) const {
+  if(edge.Tile_Base() != header_->graphid())
+    throw std::runtime_error("Wrong tile for edge id");
+  GetTrafficSegments(edge.id(), segments);
+}
+
+// Get traffic segment(s) associated to this edge into a list the caller keeps
+void GraphTile::GetTrafficSegments(const uint32_t idx, std::vector<TrafficSegment>& segments) const {
+  segments.clear();
   if (idx < header_->traffic_id_count()) {
     const TrafficAssociation& t = traffic_segments_[idx];
     //normal ots's
     if (!t.chunk()) {
       //single association should always be 1 segment
       if (t.count() != 1)
-        return {};
+        return;
       //return the one
       GraphId segment_id = { header_->graphid().tileid(), header_->graphid().level(), t.id() };
-      TrafficSegment seg(segment_id, 0.0f, 1.0f, t.starts_segment(), t.ends_segment());
-      return { seg };
+      segments.emplace_back(segment_id, 0.0f, 1.0f, t.starts_segment(), t.ends_segment());
+      return;
     }//chunked ots's
     else {
       // This edge associates to more than 1 segment (or the segment is in
       // a different tile. Get traffic chunks.
       auto c = t.GetChunkCountAndIndex();
       TrafficChunk* chunk = &traffic_chunks_[c.second];
-      std::vector<TrafficSegment> segments;
+      segments.reserve(c.first);
       for (uint32_t i = 0; i < c.first; i++, chunk++) {
         segments.emplace_back(chunk->segment_id(), chunk->begin_percent(),
                               chunk->end_percent(), chunk->starts_segment(),
                               chunk->ends_segment());
       }
-      return segments;
+      return;
     }
   }// Tile does not contain traffic
   else if (header_->traffic_id_count() == 0)
-    return { };
+    return;
   //you were out of bounds
   throw std::runtime_error("GraphTile GetTrafficSegments index out of bounds: " +
                          std::to_string(header_->graphid().tileid()) + "," +
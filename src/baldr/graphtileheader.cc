@@ -1,4 +1,6 @@
 #include <string.h>
+#include <algorithm>
+#include <cmath>
 #include "baldr/graphtileheader.h"
 #include "baldr/nodeinfo.h"
 #include "baldr/directededge.h"
@@ -8,6 +10,17 @@
 
 using namespace valhalla::baldr;
 
+namespace {
+
+// Quantize a hierarchy limits factor to the 4 bits it is kept in. 0 is
+// left for tiles built without factors.
+uint32_t hierarchy_limits_factor(const float factor) {
+  float steps = std::round(factor / kHierarchyLimitsStep);
+  return static_cast<uint32_t>(std::max(1.0f, std::min(15.0f, steps)));
+}
+
+}
+
 namespace valhalla {
 namespace baldr {
 
@@ -45,6 +58,16 @@ void GraphTileHeader::set_density(const uint32_t density) {
   density_ = (density <= kMaxDensity) ? density : kMaxDensity;
 }
 
+// Set the factor the maximum upward transitions are scaled with.
+void GraphTileHeader::set_up_transition_factor(const float factor) {
+  up_transition_factor_ = hierarchy_limits_factor(factor);
+}
+
+// Set the factor the expansion within distance is scaled with.
+void GraphTileHeader::set_expansion_within_factor(const float factor) {
+  expansion_within_factor_ = hierarchy_limits_factor(factor);
+}
+
 // Set the relative quality of name assignment for this tile.
 void GraphTileHeader::set_name_quality(const uint32_t name_quality) {
   name_quality_ = name_quality;
@@ -85,6 +108,26 @@ void GraphTileHeader::set_departurecount(const uint32_t departures) {
   departurecount_ = departures;
 }
 
+// Sets the number of transit departure patterns in this tile.
+void GraphTileHeader::set_departure_pattern_count(const uint32_t patterns) {
+  // Check against limit
+  if (patterns > kMaxDeparturePatterns) {
+    throw std::runtime_error(
+        "Exceeding maximum number of transit departure patterns per tile");
+  }
+  departure_pattern_count_ = patterns;
+}
+
+// Sets the number of trips of the transit departure patterns in this tile.
+void GraphTileHeader::set_pattern_trip_count(const uint32_t trips) {
+  // Check against limit
+  if (trips > kMaxPatternTrips) {
+    throw std::runtime_error(
+        "Exceeding maximum number of transit pattern trips per tile");
+  }
+  pattern_trip_count_ = trips;
+}
+
 // Sets the number of transit stops in this tile.
 void GraphTileHeader::set_stopcount(const uint32_t stops) {
   // Check against limit
@@ -197,6 +240,36 @@ void GraphTileHeader::set_edge_elevation_offset(const uint32_t offset) {
   edge_elevation_offset_ = offset;
 }
 
+// Sets the offset to the edge bounding boxes.
+void GraphTileHeader::set_edge_bbox_offset(const uint32_t offset) {
+  edge_bbox_offset_ = offset;
+}
+
+// Sets the offset to the hot edges.
+void GraphTileHeader::set_hotedge_offset(const uint32_t offset) {
+  hotedge_offset_ = offset;
+}
+
+// Sets the offset to the speed profiles.
+void GraphTileHeader::set_speed_profile_offset(const uint32_t offset) {
+  speed_profile_offset_ = offset;
+}
+
+// Sets the offset to the edge attribute index.
+void GraphTileHeader::set_edge_attribute_index_offset(const uint32_t offset) {
+  edge_attribute_index_offset_ = offset;
+}
+
+// Sets the offset to the fixed point shapes.
+void GraphTileHeader::set_fixed_shape_offset(const uint32_t offset) {
+  fixed_shape_offset_ = offset;
+}
+
+// Sets the offset to the base edges of the shortcut edges.
+void GraphTileHeader::set_shortcut_edges_offset(const uint32_t offset) {
+  shortcut_edges_offset_ = offset;
+}
+
 // Gets the offset to the end of the tile.
 uint32_t GraphTileHeader::end_offset() const {
   return empty_slots_[0];
@@ -0,0 +1,23 @@
+#include "baldr/hotedge.h"
+
+namespace valhalla {
+namespace baldr {
+
+// Constructor
+HotEdge::HotEdge()
+    : endnode_(kInvalidGraphId), superseded_(0), trans_up_(0), trans_down_(0),
+      is_shortcut_(0), leaves_tile_(0), spare1_(0), forwardaccess_(0),
+      reverseaccess_(0), spare2_(0) {
+}
+
+// Constructor with arguments.
+HotEdge::HotEdge(const DirectedEdge& edge)
+    : endnode_(edge.endnode().value), superseded_(edge.superseded()),
+      trans_up_(edge.trans_up()), trans_down_(edge.trans_down()),
+      is_shortcut_(edge.is_shortcut()), leaves_tile_(edge.leaves_tile()),
+      spare1_(0), forwardaccess_(edge.forwardaccess()),
+      reverseaccess_(edge.reverseaccess()), spare2_(0) {
+}
+
+}
+}
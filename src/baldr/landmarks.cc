@@ -0,0 +1,137 @@
+#include "baldr/landmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Current version of the landmarks file
+constexpr uint32_t kLandmarksVersion = 1;
+
+// Magic bytes at the beginning of every landmarks file
+constexpr char kLandmarksMagic[4] = {'V', 'A', 'L', 'T'};
+
+// Fixed size header at the beginning of the landmarks file
+struct LandmarksHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t tile_count;
+  uint64_t node_count;
+  uint64_t landmark_count;
+  char costing[32];
+};
+
+template <class T>
+void write_vector(std::ofstream& out, const std::vector<T>& v) {
+  out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <class T>
+void read_vector(std::ifstream& in, std::vector<T>& v, const uint64_t count) {
+  v.resize(count);
+  in.read(reinterpret_cast<char*>(v.data()), count * sizeof(T));
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+Landmarks::Landmarks() : offsets_(1, 0) {
+}
+
+Landmarks::Landmarks(const std::string& costing, std::vector<GraphId>&& tiles,
+                     std::vector<uint32_t>&& offsets, std::vector<uint32_t>&& landmarks,
+                     std::vector<float>&& costs)
+    : costing_(costing), tiles_(std::move(tiles)), offsets_(std::move(offsets)),
+      landmarks_(std::move(landmarks)), costs_(std::move(costs)) {
+  if (offsets_.size() != tiles_.size() + 1 ||
+      costs_.size() != static_cast<size_t>(offsets_.back()) * landmarks_.size() * 2)
+    throw std::runtime_error("Landmark costs do not match the nodes and landmarks");
+}
+
+Landmarks Landmarks::Load(const std::string& file_name) {
+  std::ifstream in(file_name, std::ios::in | std::ios::binary);
+  if (!in.is_open())
+    throw std::runtime_error("Could not open landmarks " + file_name);
+
+  LandmarksHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, kLandmarksMagic, sizeof(header.magic)) != 0 ||
+      header.version != kLandmarksVersion)
+    throw std::runtime_error(file_name + " is not a landmarks file");
+
+  Landmarks landmarks;
+  header.costing[sizeof(header.costing) - 1] = '\0';
+  landmarks.costing_ = header.costing;
+  read_vector(in, landmarks.tiles_, header.tile_count);
+  read_vector(in, landmarks.offsets_, header.tile_count + 1);
+  read_vector(in, landmarks.landmarks_, header.landmark_count);
+  read_vector(in, landmarks.costs_, header.node_count * header.landmark_count * 2);
+  if (!in || landmarks.offsets_.back() != header.node_count)
+    throw std::runtime_error("Landmarks " + file_name + " is truncated");
+  return landmarks;
+}
+
+void Landmarks::Write(const std::string& file_name) const {
+  LandmarksHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kLandmarksMagic, sizeof(header.magic));
+  header.version = kLandmarksVersion;
+  header.tile_count = tiles_.size();
+  header.node_count = offsets_.back();
+  header.landmark_count = landmarks_.size();
+  if (costing_.size() >= sizeof(header.costing))
+    throw std::runtime_error("Costing name is too long for landmarks");
+  std::memcpy(header.costing, costing_.data(), costing_.size());
+
+  std::ofstream out(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open())
+    throw std::runtime_error("Could not open " + file_name + " for writing");
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_vector(out, tiles_);
+  write_vector(out, offsets_);
+  write_vector(out, landmarks_);
+  write_vector(out, costs_);
+  out.close();
+  if (!out)
+    throw std::runtime_error("Failed to write landmarks " + file_name);
+}
+
+std::string Landmarks::FileName(const std::string& tile_dir, const std::string& costing) {
+  return tile_dir + (tile_dir.empty() || tile_dir.back() == '/' ? "" : "/") +
+         costing + kLandmarksExtension;
+}
+
+uint32_t Landmarks::node(const GraphId& nodeid) const {
+  GraphId tileid = nodeid.Tile_Base();
+  auto itr = std::lower_bound(tiles_.cbegin(), tiles_.cend(), tileid,
+      [](const GraphId& a, const GraphId& b) { return a.value < b.value; });
+  if (itr == tiles_.cend() || !(*itr == tileid))
+    return kInvalidLandmarkNode;
+  size_t tile = itr - tiles_.cbegin();
+  uint32_t node = offsets_[tile] + nodeid.id();
+  return node < offsets_[tile + 1] ? node : kInvalidLandmarkNode;
+}
+
+float Landmarks::LowerBound(const uint32_t from, const uint32_t to) const {
+  const float* f = costs_.data() + static_cast<size_t>(from) * landmarks_.size() * 2;
+  const float* t = costs_.data() + static_cast<size_t>(to) * landmarks_.size() * 2;
+  float bound = 0.f;
+  for (size_t i = 0; i < landmarks_.size(); ++i, f += 2, t += 2) {
+    // landmark to the node to go to can't be shorter than to the node to go
+    // from and on to the other one
+    if (std::isfinite(f[0]) && std::isfinite(t[0]))
+      bound = std::max(bound, t[0] - f[0]);
+    // and the same going on to the landmark
+    if (std::isfinite(f[1]) && std::isfinite(t[1]))
+      bound = std::max(bound, f[1] - t[1]);
+  }
+  return bound;
+}
+
+}
+}
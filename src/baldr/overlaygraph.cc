@@ -0,0 +1,109 @@
+#include "baldr/overlaygraph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Current version of the overlay file
+constexpr uint32_t kOverlayGraphVersion = 1;
+
+// Magic bytes at the beginning of every overlay file
+constexpr char kOverlayGraphMagic[4] = {'V', 'M', 'L', 'D'};
+
+// Fixed size header at the beginning of the overlay file
+struct OverlayGraphHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t node_count;
+  uint64_t arc_count;
+  char costing[32];
+};
+
+template <class T>
+void write_vector(std::ofstream& out, const std::vector<T>& v) {
+  out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <class T>
+void read_vector(std::ifstream& in, std::vector<T>& v, const uint64_t count) {
+  v.resize(count);
+  in.read(reinterpret_cast<char*>(v.data()), count * sizeof(T));
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+OverlayGraph::OverlayGraph() : offsets_(1, 0) {
+}
+
+OverlayGraph::OverlayGraph(const std::string& costing, std::vector<GraphId>&& edges,
+                           std::vector<uint32_t>&& offsets, std::vector<OverlayArc>&& arcs)
+    : costing_(costing), edges_(std::move(edges)), offsets_(std::move(offsets)),
+      arcs_(std::move(arcs)) {
+  if (offsets_.size() != edges_.size() + 1 || offsets_.back() != arcs_.size())
+    throw std::runtime_error("Overlay arc offsets do not match its nodes and arcs");
+}
+
+OverlayGraph OverlayGraph::Load(const std::string& file_name) {
+  std::ifstream in(file_name, std::ios::in | std::ios::binary);
+  if (!in.is_open())
+    throw std::runtime_error("Could not open boundary overlay " + file_name);
+
+  OverlayGraphHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, kOverlayGraphMagic, sizeof(header.magic)) != 0 ||
+      header.version != kOverlayGraphVersion)
+    throw std::runtime_error(file_name + " is not a boundary overlay");
+
+  OverlayGraph graph;
+  header.costing[sizeof(header.costing) - 1] = '\0';
+  graph.costing_ = header.costing;
+  read_vector(in, graph.edges_, header.node_count);
+  read_vector(in, graph.offsets_, header.node_count + 1);
+  read_vector(in, graph.arcs_, header.arc_count);
+  if (!in || graph.offsets_.back() != graph.arcs_.size())
+    throw std::runtime_error("Boundary overlay " + file_name + " is truncated");
+  return graph;
+}
+
+void OverlayGraph::Write(const std::string& file_name) const {
+  OverlayGraphHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kOverlayGraphMagic, sizeof(header.magic));
+  header.version = kOverlayGraphVersion;
+  header.node_count = edges_.size();
+  header.arc_count = arcs_.size();
+  if (costing_.size() >= sizeof(header.costing))
+    throw std::runtime_error("Costing name is too long for a boundary overlay");
+  std::memcpy(header.costing, costing_.data(), costing_.size());
+
+  std::ofstream out(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open())
+    throw std::runtime_error("Could not open " + file_name + " for writing");
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_vector(out, edges_);
+  write_vector(out, offsets_);
+  write_vector(out, arcs_);
+  out.close();
+  if (!out)
+    throw std::runtime_error("Failed to write boundary overlay " + file_name);
+}
+
+std::string OverlayGraph::FileName(const std::string& tile_dir, const std::string& costing) {
+  return tile_dir + (tile_dir.empty() || tile_dir.back() == '/' ? "" : "/") +
+         costing + kOverlayGraphExtension;
+}
+
+uint32_t OverlayGraph::node(const GraphId& edgeid) const {
+  auto itr = std::lower_bound(edges_.cbegin(), edges_.cend(), edgeid,
+      [](const GraphId& a, const GraphId& b) { return a.value < b.value; });
+  return (itr != edges_.cend() && *itr == edgeid) ? itr - edges_.cbegin() : kInvalidOverlayNode;
+}
+
+}
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/segmentindex.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// Column or row of the cell a coordinate falls in, clamped to the grid
+uint32_t cell_of(const float coord, const float min, const float size, const uint32_t divisions) {
+  const auto cell = std::floor((coord - min) / size * divisions);
+  return static_cast<uint32_t>(std::max(0.f, std::min(cell, divisions - 1.f)));
+}
+
+// Mark the cells of the bin crossed by a segment. For each row the segment
+// spans, the columns are those between where it enters and leaves the row.
+void mark_cells(const valhalla::baldr::SegmentIndex::Bin& bin, const PointLL& u, const PointLL& v,
+                const uint32_t edge, std::vector<std::pair<uint32_t, uint32_t>>& marks) {
+  const auto width = bin.bounds.Width(), height = bin.bounds.Height();
+  if (std::max(u.lng(), v.lng()) < bin.bounds.minx() || std::min(u.lng(), v.lng()) > bin.bounds.maxx() ||
+      std::max(u.lat(), v.lat()) < bin.bounds.miny() || std::min(u.lat(), v.lat()) > bin.bounds.maxy()) {
+    return;
+  }
+
+  const auto minrow = cell_of(std::min(u.lat(), v.lat()), bin.bounds.miny(), height, bin.divisions);
+  const auto maxrow = cell_of(std::max(u.lat(), v.lat()), bin.bounds.miny(), height, bin.divisions);
+  const auto dy = v.lat() - u.lat();
+  for (auto row = minrow; row <= maxrow; ++row) {
+    // Part of the segment within the row
+    float x0 = u.lng(), x1 = v.lng();
+    if (dy != 0.f) {
+      const auto y0 = std::max(std::min(u.lat(), v.lat()), bin.bounds.miny() + height * row / bin.divisions);
+      const auto y1 = std::min(std::max(u.lat(), v.lat()), bin.bounds.miny() + height * (row + 1) / bin.divisions);
+      x0 = u.lng() + (v.lng() - u.lng()) * ((y0 - u.lat()) / dy);
+      x1 = u.lng() + (v.lng() - u.lng()) * ((y1 - u.lat()) / dy);
+    }
+    auto mincol = cell_of(std::min(x0, x1), bin.bounds.minx(), width, bin.divisions);
+    auto maxcol = cell_of(std::max(x0, x1), bin.bounds.minx(), width, bin.divisions);
+    // Leave room for rounding at the ends
+    mincol = mincol > 0 ? mincol - 1 : 0;
+    maxcol = std::min(maxcol + 1, bin.divisions - 1);
+    for (auto col = mincol; col <= maxcol; ++col) {
+      marks.emplace_back(row * bin.divisions + col, edge);
+    }
+  }
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+// Get the edges with a segment in the cells overlapping the range.
+void SegmentIndex::Bin::Query(const AABB2<PointLL>& range, std::vector<uint32_t>& indexes) const {
+  if (!bounds.Intersects(range) || cells.empty()) {
+    return;
+  }
+
+  const auto mincol = cell_of(range.minx(), bounds.minx(), bounds.Width(), divisions);
+  const auto maxcol = cell_of(range.maxx(), bounds.minx(), bounds.Width(), divisions);
+  const auto minrow = cell_of(range.miny(), bounds.miny(), bounds.Height(), divisions);
+  const auto maxrow = cell_of(range.maxy(), bounds.miny(), bounds.Height(), divisions);
+  const auto begin = indexes.size();
+  for (auto row = minrow; row <= maxrow; ++row) {
+    // The cells of a row are contiguous in the sorted cells
+    auto cell = std::lower_bound(cells.begin(), cells.end(), row * divisions + mincol);
+    for (; cell != cells.end() && *cell <= row * divisions + maxcol; ++cell) {
+      const auto i = cell - cells.begin();
+      indexes.insert(indexes.end(), cell_edges.begin() + cell_offsets[i],
+                     cell_edges.begin() + cell_offsets[i + 1]);
+    }
+  }
+  std::sort(indexes.begin() + begin, indexes.end());
+  indexes.erase(std::unique(indexes.begin() + begin, indexes.end()), indexes.end());
+}
+
+// Constructor. Indexes the edges of each bin of the tile.
+SegmentIndex::SegmentIndex(const GraphTile& tile, GraphReader& reader, const uint32_t divisions)
+    : divisions_(std::max(divisions, 1u)), bins_(kBinCount) {
+  const auto tile_box = tile.BoundingBox();
+  const auto bin_width = tile_box.Width() / kBinsDim;
+  const auto bin_height = tile_box.Height() / kBinsDim;
+  std::vector<std::pair<uint32_t, uint32_t>> marks;
+  for (size_t index = 0; index < kBinCount; ++index) {
+    auto& bin = bins_[index];
+    const auto row = index / kBinsDim, col = index % kBinsDim;
+    bin.bounds = AABB2<PointLL>(tile_box.minx() + col * bin_width, tile_box.miny() + row * bin_height,
+                                tile_box.minx() + (col + 1) * bin_width, tile_box.miny() + (row + 1) * bin_height);
+    bin.divisions = divisions_;
+    bin.first_segment.push_back(0);
+    marks.clear();
+
+    for (const auto& edgeid : tile.GetBin(index)) {
+      // Edges in a bin can be in a different tile if they pass through the
+      // tile but do not start or end in it. Skip them if the tile is missing.
+      const auto* edge_tile = edgeid.tileid() == tile.header()->graphid().tileid() &&
+          edgeid.level() == tile.header()->graphid().level() ? &tile : reader.GetGraphTile(edgeid);
+      if (edge_tile == nullptr) {
+        continue;
+      }
+
+      // Use lazy_shape to avoid allocations. Bins do not contain transition
+      // edges and transit connection edges.
+      auto shape = edge_tile->edgeinfo(edge_tile->directededge(edgeid)->edgeinfo_offset()).lazy_shape();
+      if (shape.empty()) {
+        continue;
+      }
+      const uint32_t edge = bin.edgeids.size();
+      float length = 0.f;
+      PointLL v = shape.pop();
+      while (!shape.empty()) {
+        const PointLL u = v;
+        v = shape.pop();
+        mark_cells(bin, u, v, edge, marks);
+        bin.ux.push_back(u.first);
+        bin.uy.push_back(u.second);
+        bin.vx.push_back(v.first);
+        bin.vy.push_back(v.second);
+        bin.partial_lengths.push_back(length);
+        length += u.Distance(v);
+      }
+
+      // Only keep the edges with segments, the others can't be found
+      const uint32_t end = bin.ux.size();
+      if (end > bin.first_segment.back()) {
+        bin.edgeids.push_back(edgeid);
+        bin.lengths.push_back(length);
+        bin.first_segment.push_back(end);
+      }
+    }
+
+    // Group the edges by the cells they cross
+    std::sort(marks.begin(), marks.end());
+    marks.erase(std::unique(marks.begin(), marks.end()), marks.end());
+    bin.cell_edges.reserve(marks.size());
+    for (const auto& mark : marks) {
+      if (bin.cells.empty() || bin.cells.back() != mark.first) {
+        bin.cells.push_back(mark.first);
+        bin.cell_offsets.push_back(bin.cell_edges.size());
+      }
+      bin.cell_edges.push_back(mark.second);
+    }
+    bin.cell_offsets.push_back(bin.cell_edges.size());
+  }
+}
+
+}
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "baldr/shard_map.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/constants.h"
+#include "midgard/distanceapproximator.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+  constexpr size_t kNoShard = std::numeric_limits<size_t>::max();
+
+  // Whether every tile within the box is one the region was cut with
+  bool holds(const shard_t& shard, const AABB2<PointLL>& box) {
+    for (const auto& level : TileHierarchy::levels()) {
+      for (auto id : level.second.tiles.TileList(box)) {
+        if (!shard.bbox.Intersects(level.second.tiles.TileBounds(id)))
+          return false;
+      }
+    }
+    return true;
+  }
+}
+
+namespace valhalla {
+  namespace baldr {
+
+    ShardMap::ShardMap(const boost::property_tree::ptree& pt) : self_(kNoShard), fallback_(kNoShard) {
+      auto self = pt.get<std::string>("self");
+      auto fallback = pt.get<std::string>("fallback", "");
+      for (const auto& region : pt.get_child("regions")) {
+        std::vector<float> bbox;
+        for (const auto& coord : region.second.get_child("bbox"))
+          bbox.push_back(coord.second.get_value<float>());
+        if (bbox.size() != 4)
+          throw std::runtime_error("The bbox of a shard must be [min_lon, min_lat, max_lon, max_lat]");
+        shards_.emplace_back(shard_t{region.second.get<std::string>("name"),
+                                     region.second.get<std::string>("url"),
+                                     AABB2<PointLL>(bbox[0], bbox[1], bbox[2], bbox[3])});
+        if (shards_.back().name == self)
+          self_ = shards_.size() - 1;
+        if (shards_.back().name == fallback)
+          fallback_ = shards_.size() - 1;
+      }
+      if (self_ == kNoShard)
+        throw std::runtime_error("The shard of this cluster '" + self + "' is not one of the regions");
+      if (!fallback.empty() && fallback_ == kNoShard)
+        throw std::runtime_error("The fallback shard '" + fallback + "' is not one of the regions");
+    }
+
+    const shard_t& ShardMap::self() const {
+      return shards_[self_];
+    }
+
+    const shard_t* ShardMap::fallback() const {
+      return fallback_ == kNoShard ? nullptr : &shards_[fallback_];
+    }
+
+    const std::vector<shard_t>& ShardMap::shards() const {
+      return shards_;
+    }
+
+    const shard_t* ShardMap::Owner(const std::vector<PointLL>& locations, const float radius) const {
+      // The tiles each location could be correlated in
+      std::vector<AABB2<PointLL> > boxes;
+      boxes.reserve(locations.size());
+      for (const auto& ll : locations) {
+        float lat = radius / kMetersPerDegreeLat;
+        float lng = radius / std::max(DistanceApproximator::MetersPerLngDegree(ll.lat()), 1.f);
+        boxes.emplace_back(ll.lng() - lng, ll.lat() - lat, ll.lng() + lng, ll.lat() + lat);
+      }
+
+      // Ours first, then whichever comes first
+      auto owns = [&boxes](const shard_t& shard) {
+        return std::all_of(boxes.cbegin(), boxes.cend(),
+                           [&shard](const AABB2<PointLL>& box) { return holds(shard, box); });
+      };
+      if (owns(shards_[self_]))
+        return &shards_[self_];
+      for (const auto& shard : shards_) {
+        if (&shard != &shards_[self_] && owns(shard))
+          return &shard;
+      }
+      return nullptr;
+    }
+
+  }
+}
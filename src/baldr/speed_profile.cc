@@ -0,0 +1,25 @@
+#include <algorithm>
+#include <cstring>
+#include "baldr/speed_profile.h"
+
+namespace valhalla {
+namespace baldr {
+
+// Constructor of a profile without speeds.
+SpeedProfile::SpeedProfile() {
+  std::fill(speeds_, speeds_ + kSpeedProfileBuckets, 0);
+}
+
+// Constructor with arguments.
+SpeedProfile::SpeedProfile(const std::vector<uint8_t>& speeds) {
+  std::fill(speeds_, speeds_ + kSpeedProfileBuckets, 0);
+  std::copy(speeds.begin(), speeds.begin() +
+            std::min(speeds.size(), static_cast<size_t>(kSpeedProfileBuckets)), speeds_);
+}
+
+bool SpeedProfile::operator==(const SpeedProfile& other) const {
+  return std::memcmp(speeds_, other.speeds_, kSpeedProfileBuckets) == 0;
+}
+
+}
+}
@@ -19,7 +19,7 @@ const std::string& StreetName::value() const {
 }
 
 bool StreetName::operator ==(const StreetName& rhs) const {
-  return (value_ == rhs.value_);
+  return (this == &rhs) || (value_ == rhs.value_);
 }
 
 bool StreetName::StartsWith(const std::string& prefix) const {
@@ -51,7 +51,7 @@ std::string StreetName::GetBaseName() const {
 }
 
 bool StreetName::HasSameBaseName(const StreetName& rhs) const {
-  return (GetBaseName() == rhs.GetBaseName());
+  return (this == &rhs) || (GetBaseName() == rhs.GetBaseName());
 }
 
 }
@@ -51,7 +51,7 @@ std::string StreetNameUs::GetBaseName() const {
 }
 
 bool StreetNameUs::HasSameBaseName(const StreetName& rhs) const {
-  return (GetBaseName() == rhs.GetBaseName());
+  return (this == &rhs) || (GetBaseName() == rhs.GetBaseName());
 }
 
 }
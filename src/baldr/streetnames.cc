@@ -1,4 +1,5 @@
 #include <iostream>
+#include <typeinfo>
 #include <vector>
 
 #include "baldr/streetnames.h"
@@ -10,12 +11,12 @@ namespace valhalla {
 namespace baldr {
 
 StreetNames::StreetNames()
-    : std::list<std::unique_ptr<StreetName>>() {
+    : std::list<std::shared_ptr<const StreetName>>() {
 }
 
 StreetNames::StreetNames(const std::vector<std::string>& names) {
   for (auto& name : names) {
-    this->emplace_back(midgard::make_unique<StreetName>(name));
+    this->emplace_back(std::make_shared<StreetName>(name));
   }
 }
 
@@ -66,10 +67,7 @@ std::string StreetNames::ToParameterString() const {
 std::unique_ptr<StreetNames> StreetNames::clone() const {
   std::unique_ptr<StreetNames> clone_street_names = midgard::make_unique<
       StreetNames>();
-  for (const auto& street_name : *this) {
-    clone_street_names->emplace_back(
-        midgard::make_unique<StreetName>(street_name->value()));
-  }
+  clone_street_names->assign(this->begin(), this->end());
 
   return clone_street_names;
 }
@@ -81,8 +79,7 @@ std::unique_ptr<StreetNames> StreetNames::FindCommonStreetNames(
   for (const auto& street_name : *this) {
     for (const auto& other_street_name : other_street_names) {
       if (*street_name == *other_street_name) {
-        common_street_names->emplace_back(
-            midgard::make_unique<StreetName>(street_name->value()));
+        common_street_names->emplace_back(street_name);
         break;
       }
     }
@@ -101,15 +98,14 @@ std::unique_ptr<StreetNames> StreetNames::FindCommonBaseNames(
         // Use the name with the cardinal directional suffix
         // thus, 'US 30 West' will be used instead of 'US 30'
         if (!street_name->GetPostCardinalDir().empty())
-          common_base_names->emplace_back(
-              midgard::make_unique<StreetName>(street_name->value()));
+          common_base_names->emplace_back(street_name);
         else if (!other_street_name->GetPostCardinalDir().empty())
           common_base_names->emplace_back(
-              midgard::make_unique<StreetName>(other_street_name->value()));
+              typeid(*other_street_name) == typeid(StreetName) ? other_street_name :
+                  std::make_shared<StreetName>(other_street_name->value()));
         // Use street_name by default
         else
-          common_base_names->emplace_back(
-              midgard::make_unique<StreetName>(street_name->value()));
+          common_base_names->emplace_back(street_name);
         break;
       }
     }
@@ -1,7 +1,7 @@
 #include <iostream>
 #include <memory>
+#include <typeinfo>
 
-#include "baldr/streetnames_us.h"
 #include "baldr/streetnames_us.h"
 #include "midgard/util.h"
 
@@ -14,7 +14,7 @@ StreetNamesUs::StreetNamesUs()
 
 StreetNamesUs::StreetNamesUs(const std::vector<std::string>& names) {
   for (auto& name : names) {
-    this->emplace_back(midgard::make_unique<StreetNameUs>(name));
+    this->emplace_back(std::make_shared<StreetNameUs>(name));
   }
 }
 
@@ -24,10 +24,7 @@ StreetNamesUs::~StreetNamesUs() {
 std::unique_ptr<StreetNames> StreetNamesUs::clone() const {
   std::unique_ptr<StreetNames> clone_street_names = midgard::make_unique<
       StreetNamesUs>();
-  for (const auto& street_name : *this) {
-    clone_street_names->emplace_back(
-        midgard::make_unique<StreetNameUs>(street_name->value()));
-  }
+  clone_street_names->assign(this->begin(), this->end());
 
   return clone_street_names;
 }
@@ -39,8 +36,7 @@ std::unique_ptr<StreetNames> StreetNamesUs::FindCommonStreetNames(
   for (const auto& street_name : *this) {
     for (const auto& other_street_name : other_street_names) {
       if (*street_name == *other_street_name) {
-        common_street_names->emplace_back(
-            midgard::make_unique<StreetNameUs>(street_name->value()));
+        common_street_names->emplace_back(street_name);
         break;
       }
     }
@@ -59,15 +55,14 @@ std::unique_ptr<StreetNames> StreetNamesUs::FindCommonBaseNames(
         // Use the name with the cardinal directional suffix
         // thus, 'US 30 West' will be used instead of 'US 30'
         if (!street_name->GetPostCardinalDir().empty())
-          common_base_names->emplace_back(
-              midgard::make_unique<StreetNameUs>(street_name->value()));
+          common_base_names->emplace_back(street_name);
         else if (!other_street_name->GetPostCardinalDir().empty())
           common_base_names->emplace_back(
-              midgard::make_unique<StreetNameUs>(other_street_name->value()));
+              typeid(*other_street_name) == typeid(StreetNameUs) ? other_street_name :
+                  std::make_shared<StreetNameUs>(other_street_name->value()));
         // Use street_name by default
         else
-          common_base_names->emplace_back(
-              midgard::make_unique<StreetNameUs>(street_name->value()));
+          common_base_names->emplace_back(street_name);
         break;
       }
     }
@@ -0,0 +1,87 @@
+#include "baldr/tile_heat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include "midgard/logging.h"
+
+namespace valhalla {
+namespace baldr {
+
+struct TileHeat::totals_t {
+  std::mutex mutex;
+  std::unordered_map<uint64_t, uint64_t> counts;
+};
+
+TileHeat::TileHeat(const std::string& file, const size_t flush_seconds)
+  : file_(file), flush_interval_(std::chrono::seconds(flush_seconds)),
+    last_flush_(std::chrono::steady_clock::now()) {
+  // One set of totals per heat file, starting from what is in it already
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::weak_ptr<totals_t> > totals;
+  std::lock_guard<std::mutex> lock(mutex);
+  totals_ = totals[file].lock();
+  if (!totals_) {
+    totals_ = std::make_shared<totals_t>();
+    for (const auto& tile : Read(file))
+      totals_->counts[tile.first.value] += tile.second;
+    totals[file] = totals_;
+  }
+}
+
+TileHeat::~TileHeat() {
+  Flush(true);
+}
+
+void TileHeat::Flush(const bool force) {
+  // Not time yet
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - last_flush_ < flush_interval_)
+    return;
+  last_flush_ = now;
+  if (counts_.empty())
+    return;
+
+  std::lock_guard<std::mutex> lock(totals_->mutex);
+  for (const auto& count : counts_)
+    totals_->counts[count.first] += count.second;
+  counts_.clear();
+  try {
+    Write(file_, totals_->counts);
+  }
+  catch(const std::exception& e) {
+    LOG_WARN(e.what());
+  }
+}
+
+std::vector<std::pair<GraphId, uint64_t> > TileHeat::Read(const std::string& file, const size_t count) {
+  std::vector<std::pair<GraphId, uint64_t> > tiles;
+  std::ifstream in(file);
+  uint64_t id, hits;
+  while ((count == 0 || tiles.size() < count) && in >> id >> hits)
+    tiles.emplace_back(GraphId(id), hits);
+  return tiles;
+}
+
+void TileHeat::Write(const std::string& file, const std::unordered_map<uint64_t, uint64_t>& counts) {
+  std::vector<std::pair<uint64_t, uint64_t> > sorted(counts.cbegin(), counts.cend());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b) {
+              return a.second > b.second || (a.second == b.second && a.first < b.first);
+            });
+  {
+    std::ofstream out(file + ".tmp", std::ios::trunc);
+    for (const auto& tile : sorted)
+      out << tile.first << ' ' << tile.second << '\n';
+    if (!out)
+      throw std::runtime_error("Failed to write " + file + ".tmp");
+  }
+  if (std::rename((file + ".tmp").c_str(), file.c_str()) != 0)
+    throw std::runtime_error("Failed to install " + file);
+}
+
+}
+}
@@ -0,0 +1,250 @@
+#include "baldr/tile_ring.h"
+#include "baldr/filesystem_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+
+#include <algorithm>
+
+#ifdef VALHALLA_IO_URING
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace valhalla {
+namespace baldr {
+
+#ifdef VALHALLA_IO_URING
+
+// The submission and completion queues shared with the kernel. There is no
+// liburing dependency, the few syscalls needed are made directly
+struct TileRing::ring_t {
+  int fd = -1;
+  uint32_t entries = 0;
+  void* sq_ptr = MAP_FAILED;
+  size_t sq_size = 0;
+  void* cq_ptr = MAP_FAILED;
+  size_t cq_size = 0;
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size = 0;
+  unsigned* sq_head = nullptr;
+  unsigned* sq_tail = nullptr;
+  unsigned* sq_mask = nullptr;
+  unsigned* sq_array = nullptr;
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  unsigned* cq_mask = nullptr;
+  io_uring_cqe* cqes = nullptr;
+
+  explicit ring_t(uint32_t depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = syscall(__NR_io_uring_setup, depth, &params);
+    if (fd < 0)
+      return;
+    entries = params.sq_entries;
+
+    // Map the queues, separately so that kernels without a single mapping work too
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                  IORING_OFF_SQ_RING);
+    cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                  IORING_OFF_CQ_RING);
+    sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes == MAP_FAILED) {
+      close();
+      return;
+    }
+
+    char* sq = static_cast<char*>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~ring_t() {
+    close();
+  }
+
+  void close() {
+    if (sqes != MAP_FAILED)
+      munmap(sqes, sqes_size);
+    if (cq_ptr != MAP_FAILED)
+      munmap(cq_ptr, cq_size);
+    if (sq_ptr != MAP_FAILED)
+      munmap(sq_ptr, sq_size);
+    if (fd >= 0)
+      ::close(fd);
+    sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    cq_ptr = sq_ptr = MAP_FAILED;
+    fd = -1;
+  }
+
+  // Queue a read of the whole buffer from the start of the file
+  void push(int file, const iovec* iov, uint64_t user_data) {
+    unsigned tail = *sq_tail;
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = file;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = 1;
+    sqe->off = 0;
+    sqe->user_data = user_data;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // Submit queued reads and wait for at least min_complete of them to complete
+  int enter(unsigned to_submit, unsigned min_complete) {
+    int ret;
+    do {
+      ret = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, IORING_ENTER_GETEVENTS,
+                    nullptr, 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+  }
+};
+
+TileRing::TileRing(uint32_t depth) : ring_(new ring_t(depth)) {
+  if (ring_->fd < 0) {
+    LOG_WARN("io_uring is unavailable, tiles will be read one at a time");
+    ring_.reset();
+  }
+}
+
+TileRing::~TileRing() {
+}
+
+bool TileRing::valid() const {
+  return ring_ != nullptr;
+}
+
+std::vector<GraphTile> TileRing::Read(const std::string& tile_dir,
+                                      const std::vector<GraphId>& ids) {
+  std::vector<GraphTile> tiles(ids.size());
+  if (!ring_)
+    return tiles;
+
+  struct read_t {
+    int file;
+    std::vector<char> data;
+    iovec iov;
+    bool done;
+  };
+  for (size_t wave = 0; wave < ids.size(); wave += ring_->entries) {
+    // Open everything in this wave and queue up a read per file
+    size_t end = std::min(ids.size(), wave + ring_->entries);
+    std::vector<read_t> reads(end - wave);
+    unsigned queued = 0;
+    for (size_t i = wave; i < end; ++i) {
+      auto& read = reads[i - wave];
+      read.file = -1;
+      read.done = false;
+      if (!ids[i].Is_Valid() || ids[i].level() > TileHierarchy::get_max_level())
+        continue;
+      std::string file_location = tile_dir + filesystem::path_separator +
+                                  GraphTile::FileSuffix(ids[i].Tile_Base());
+      read.file = open(file_location.c_str(), O_RDONLY);
+      struct stat s;
+      if (read.file < 0 || fstat(read.file, &s) != 0 || s.st_size <= 0) {
+        if (read.file >= 0)
+          ::close(read.file);
+        read.file = -1;
+        continue;
+      }
+      read.data.resize(s.st_size);
+      read.iov.iov_base = read.data.data();
+      read.iov.iov_len = read.data.size();
+      ring_->push(read.file, &read.iov, i - wave);
+      ++queued;
+    }
+
+    // Submit them all at once, anything the kernel wouldn't take is dropped from
+    // the queue so that it can't be picked up with a stale buffer later on
+    unsigned submitted = 0;
+    while (submitted < queued) {
+      int ret = ring_->enter(queued - submitted, 0);
+      if (ret <= 0) {
+        LOG_WARN("io_uring submission failed: " + std::string(strerror(errno)));
+        __atomic_store_n(ring_->sq_tail, __atomic_load_n(ring_->sq_head, __ATOMIC_ACQUIRE),
+                         __ATOMIC_RELEASE);
+        break;
+      }
+      submitted += ret;
+    }
+
+    // Collect the completions as they come in, every submitted read has to
+    // complete before its buffer can go away
+    for (unsigned completed = 0; completed < submitted;) {
+      unsigned head = *ring_->cq_head;
+      while (head != __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe* cqe = &ring_->cqes[head & *ring_->cq_mask];
+        auto& read = reads[cqe->user_data];
+        // Finish any short read the old fashioned way
+        ssize_t size = cqe->res;
+        while (size >= 0 && static_cast<size_t>(size) < read.data.size()) {
+          ssize_t more = pread(read.file, read.data.data() + size, read.data.size() - size, size);
+          size = more > 0 ? size + more : -1;
+        }
+        read.done = size >= 0;
+        ++head;
+        ++completed;
+      }
+      __atomic_store_n(ring_->cq_head, head, __ATOMIC_RELEASE);
+      if (completed < submitted)
+        ring_->enter(0, 1);
+    }
+
+    // Make tiles out of whatever was read
+    for (size_t i = wave; i < end; ++i) {
+      auto& read = reads[i - wave];
+      if (read.file >= 0)
+        ::close(read.file);
+      if (read.done)
+        tiles[i] = GraphTile(ids[i], std::move(read.data));
+    }
+  }
+  return tiles;
+}
+
+#else
+
+// Without io_uring there is nothing to read with, callers load tiles as usual
+struct TileRing::ring_t {};
+
+TileRing::TileRing(uint32_t depth) {
+}
+
+TileRing::~TileRing() {
+}
+
+bool TileRing::valid() const {
+  return false;
+}
+
+std::vector<GraphTile> TileRing::Read(const std::string& tile_dir,
+                                      const std::vector<GraphId>& ids) {
+  return std::vector<GraphTile>(ids.size());
+}
+
+#endif
+
+}
+}
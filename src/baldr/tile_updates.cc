@@ -0,0 +1,127 @@
+#include "baldr/tile_updates.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+#include "baldr/filesystem_utils.h"
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+
+namespace {
+
+// Name of the list of updated tiles in the tile directory
+const std::string kTileUpdatesFile = "tile_updates";
+
+std::string read_file(const std::string& file) {
+  std::ifstream in(file, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+TileUpdates::TileUpdates(const std::string& tile_dir, const size_t refresh_seconds)
+  : tile_dir_(tile_dir), file_(tile_dir + filesystem::path_separator + kTileUpdatesFile),
+    refresh_interval_(std::chrono::seconds(refresh_seconds)),
+    last_refresh_(std::chrono::steady_clock::now()), inode_(0), modified_(0), version_(0) {
+  struct stat s;
+  if (stat(file_.c_str(), &s) != 0)
+    return;
+  inode_ = s.st_ino;
+  modified_ = s.st_mtime;
+  for (const auto& update : Read(tile_dir))
+    version_ = std::max(version_, update.first);
+}
+
+std::vector<GraphId> TileUpdates::Changed() {
+  // Not time yet
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_refresh_ < refresh_interval_)
+    return {};
+  last_refresh_ = now;
+
+  // Nothing changed
+  struct stat s;
+  if (stat(file_.c_str(), &s) != 0 || (s.st_ino == inode_ && s.st_mtime == modified_))
+    return {};
+  inode_ = s.st_ino;
+  modified_ = s.st_mtime;
+
+  // The tiles of the versions we havent seen
+  std::vector<GraphId> changed;
+  uint32_t version = version_;
+  for (const auto& update : Read(tile_dir_)) {
+    if (update.first > version_)
+      changed.push_back(update.second);
+    version = std::max(version, update.first);
+  }
+  version_ = version;
+  return changed;
+}
+
+std::vector<GraphId> TileUpdates::Apply(const std::string& tile_dir, const std::string& delta_dir) {
+  auto updates = Read(tile_dir);
+  uint32_t version = 0;
+  for (const auto& update : updates)
+    version = std::max(version, update.first);
+  ++version;
+
+  // Install the tiles that differ, next to the old one and renamed into place
+  std::vector<GraphId> installed;
+  for (boost::filesystem::recursive_directory_iterator i(delta_dir), end; i != end; ++i) {
+    if (!boost::filesystem::is_regular_file(i->path()) || i->path().extension() != ".gph")
+      continue;
+    auto id = GraphTile::GetTileId(i->path().string());
+    auto file = tile_dir + filesystem::path_separator + GraphTile::FileSuffix(id);
+    auto tile = read_file(i->path().string());
+    if (boost::filesystem::exists(file) && read_file(file) == tile)
+      continue;
+    boost::filesystem::create_directories(boost::filesystem::path(file).parent_path());
+    {
+      std::ofstream out(file + ".tmp", std::ios::binary | std::ios::trunc);
+      out.write(tile.data(), tile.size());
+      if (!out)
+        throw std::runtime_error("Failed to write " + file + ".tmp");
+    }
+    if (std::rename((file + ".tmp").c_str(), file.c_str()) != 0)
+      throw std::runtime_error("Failed to install " + file);
+    installed.push_back(id);
+    updates.emplace_back(version, id);
+  }
+  if (installed.empty())
+    return installed;
+
+  // Then record which tiles changed so the readers can evict them
+  auto file = tile_dir + filesystem::path_separator + kTileUpdatesFile;
+  {
+    std::ofstream out(file + ".tmp", std::ios::trunc);
+    for (const auto& update : updates)
+      out << update.first << ' ' << update.second.value << '\n';
+    if (!out)
+      throw std::runtime_error("Failed to write " + file + ".tmp");
+  }
+  if (std::rename((file + ".tmp").c_str(), file.c_str()) != 0)
+    throw std::runtime_error("Failed to install " + file);
+  LOG_INFO("Installed " + std::to_string(installed.size()) + " tiles as version " + std::to_string(version));
+  return installed;
+}
+
+std::vector<std::pair<uint32_t, GraphId> > TileUpdates::Read(const std::string& tile_dir) {
+  std::vector<std::pair<uint32_t, GraphId> > updates;
+  std::ifstream in(tile_dir + filesystem::path_separator + kTileUpdatesFile);
+  uint32_t version;
+  uint64_t id;
+  while (in >> version >> id)
+    updates.emplace_back(version, GraphId(id));
+  return updates;
+}
+
+}
+}
@@ -0,0 +1,100 @@
+#include "baldr/tilecompression.h"
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <lz4.h>
+#include <lz4hc.h>
+
+namespace {
+
+// Current version of the compressed tile container
+constexpr uint32_t kCompressedTileVersion = 1;
+
+// Lz4hc level to compress with, the library default
+constexpr int kLZ4HCLevel = 9;
+
+}
+
+namespace valhalla {
+namespace baldr {
+
+std::vector<char> lz4_compress_tile(const char* data, size_t size, bool high_compression) {
+  // Lz4 blocks are limited to int sized inputs
+  if (size > static_cast<size_t>(LZ4_MAX_INPUT_SIZE))
+    throw std::runtime_error("Tile is too large to be lz4 compressed");
+
+  // Room for the header and the worst case block
+  int bound = LZ4_compressBound(static_cast<int>(size));
+  std::vector<char> out(sizeof(CompressedTileHeader) + bound);
+  char* block = out.data() + sizeof(CompressedTileHeader);
+  int compressed_size = high_compression ?
+      LZ4_compress_HC(data, block, static_cast<int>(size), bound, kLZ4HCLevel) :
+      LZ4_compress_default(data, block, static_cast<int>(size), bound);
+  if (compressed_size <= 0)
+    throw std::runtime_error("Tile lz4 compression failed");
+
+  // Fill out the header and trim to what was actually used
+  CompressedTileHeader header;
+  std::memcpy(header.magic, kLZ4TileMagic, sizeof(header.magic));
+  header.version = kCompressedTileVersion;
+  header.uncompressed_size = size;
+  header.compressed_size = compressed_size;
+  std::memcpy(out.data(), &header, sizeof(header));
+  out.resize(sizeof(CompressedTileHeader) + compressed_size);
+  return out;
+}
+
+bool lz4_decompress_tile(const char* data, size_t size, std::vector<char>& tile) {
+  // Has to at least have a header that we understand
+  if (size < sizeof(CompressedTileHeader))
+    return false;
+  CompressedTileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kLZ4TileMagic, sizeof(header.magic)) != 0 ||
+      header.version != kCompressedTileVersion ||
+      header.compressed_size != size - sizeof(CompressedTileHeader) ||
+      header.uncompressed_size > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+    return false;
+
+  // One allocation of exactly the right size and one block decode
+  tile.resize(header.uncompressed_size);
+  int decompressed_size = LZ4_decompress_safe(data + sizeof(CompressedTileHeader), tile.data(),
+      static_cast<int>(header.compressed_size), static_cast<int>(header.uncompressed_size));
+  if (decompressed_size < 0 || static_cast<uint64_t>(decompressed_size) != header.uncompressed_size) {
+    tile.clear();
+    return false;
+  }
+  return true;
+}
+
+size_t lz4_compress_tile_file(const std::string& file_name, bool remove_original) {
+  // Read in the whole tile
+  std::ifstream in(file_name, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!in.is_open())
+    return 0;
+  size_t filesize = in.tellg();
+  std::vector<char> tile(filesize);
+  in.seekg(0, std::ios::beg);
+  in.read(tile.data(), filesize);
+  in.close();
+
+  // Compress it and write it out next to the original
+  auto compressed = lz4_compress_tile(tile.data(), tile.size());
+  std::ofstream out(file_name + kLZ4TileExtension, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open())
+    return 0;
+  out.write(compressed.data(), compressed.size());
+  out.close();
+  if (!out)
+    return 0;
+
+  if (remove_original)
+    std::remove(file_name.c_str());
+  return compressed.size();
+}
+
+}
+}
@@ -0,0 +1,143 @@
+#include "baldr/tileprefetcher.h"
+#include "baldr/curler.h"
+#include "baldr/tile_ring.h"
+#include "midgard/logging.h"
+
+#include <memory>
+
+namespace valhalla {
+namespace baldr {
+
+TilePrefetcher::TilePrefetcher(const std::string& tile_dir, const std::string& tile_url,
+                               bool mmap_tile, size_t thread_count, size_t max_staged,
+                               bool spill_tiles, uint32_t ring_depth)
+    : tile_dir_(tile_dir), tile_url_(tile_url), mmap_tile_(mmap_tile),
+      max_staged_(max_staged), spill_tiles_(spill_tiles), ring_depth_(ring_depth),
+      stop_(false) {
+  for (size_t i = 0; i < thread_count; ++i)
+    threads_.emplace_back(&TilePrefetcher::Work, this);
+}
+
+TilePrefetcher::~TilePrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+void TilePrefetcher::Prefetch(const std::vector<GraphId>& ids) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& id : ids) {
+      // Nothing to do if we already have it or are getting it
+      if (queued_.count(id) || loading_.count(id) || staged_.count(id))
+        continue;
+      queue_.push_back(id);
+      queued_.insert(id);
+    }
+  }
+  work_cv_.notify_all();
+}
+
+bool TilePrefetcher::Take(const GraphId& id, GraphTile& tile) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // The caller is going to load it now so don't bother in the background
+  if (queued_.erase(id))
+    return false;
+
+  // Wait for it if its in the middle of being loaded
+  loaded_cv_.wait(lock, [this, &id]() { return loading_.find(id) == loading_.cend(); });
+  auto staged = staged_.find(id);
+  if (staged == staged_.cend())
+    return false;
+  tile = staged->second;
+  staged_.erase(staged);
+  return true;
+}
+
+void TilePrefetcher::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.clear();
+  queued_.clear();
+  staged_.clear();
+  dropped_.insert(loading_.cbegin(), loading_.cend());
+}
+
+size_t TilePrefetcher::Staged() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return staged_.size();
+}
+
+void TilePrefetcher::Work() {
+  // Each thread needs its own connection and ring, mapped tiles don't need reading
+  std::unique_ptr<curler_t> curler;
+  std::unique_ptr<TileRing> ring;
+  if (ring_depth_ > 0 && !mmap_tile_) {
+    ring.reset(new TileRing(ring_depth_));
+    if (!ring->valid())
+      ring.reset();
+  }
+  size_t batch_size = ring ? ring_depth_ : 1;
+  std::vector<GraphId> ids;
+  while (true) {
+    // Wait for something to load
+    ids.clear();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (stop_)
+        return;
+      while (!queue_.empty() && ids.size() < batch_size) {
+        GraphId id = queue_.front();
+        queue_.pop_front();
+        // Skip it if it was taken or cleared while still in the queue
+        if (!queued_.erase(id))
+          continue;
+        loading_.insert(id);
+        ids.push_back(id);
+      }
+      if (ids.empty())
+        continue;
+    }
+
+    // Load the tiles without holding the lock, anything the ring couldn't read
+    // is loaded the usual way
+    std::vector<GraphTile> tiles = ring ? ring->Read(tile_dir_, ids) : std::vector<GraphTile>(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (tiles[i].header())
+        continue;
+      const auto& id = ids[i];
+      auto& tile = tiles[i];
+      try {
+        tile = GraphTile(tile_dir_, id, mmap_tile_);
+        if (!tile.header() && !tile_url_.empty()) {
+          if (!curler)
+            curler.reset(new curler_t());
+          tile = GraphTile(tile_url_, id, *curler, spill_tiles_ ? tile_dir_ : "");
+        }
+      }
+      catch (const std::exception& e) {
+        LOG_WARN("Failed to prefetch tile " + std::to_string(id) + ": " + e.what());
+        tile = GraphTile();
+      }
+    }
+
+    // Stage them for the owner to take
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < ids.size(); ++i) {
+        loading_.erase(ids[i]);
+        bool dropped = dropped_.erase(ids[i]) > 0;
+        if (!dropped && tiles[i].header() && staged_.size() < max_staged_)
+          staged_.emplace(ids[i], tiles[i]);
+      }
+    }
+    loaded_cv_.notify_all();
+  }
+}
+
+}
+}
@@ -0,0 +1,111 @@
+#include "baldr/traffic_speeds.h"
+
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+
+#include "midgard/logging.h"
+
+namespace valhalla {
+namespace baldr {
+
+TrafficSpeeds::TrafficSpeeds(const std::string& traffic_dir, const size_t refresh_seconds)
+  : traffic_dir_(traffic_dir), refresh_interval_(std::chrono::seconds(refresh_seconds)),
+    last_refresh_(std::chrono::steady_clock::now()), current_(nullptr) {
+  owned_current_.reset(Scan(snapshot_t{}));
+  if (!owned_current_)
+    owned_current_.reset(new snapshot_t);
+  current_.store(owned_current_.get(), std::memory_order_release);
+}
+
+TrafficSpeeds::~TrafficSpeeds() {
+}
+
+bool TrafficSpeeds::Refresh() {
+  // Someone else is already on it
+  std::unique_lock<std::mutex> lock(refresh_lock_, std::try_to_lock);
+  if (!lock.owns_lock())
+    return false;
+
+  // Not time yet
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_refresh_ < refresh_interval_)
+    return false;
+  last_refresh_ = now;
+
+  // Nothing changed
+  std::unique_ptr<const snapshot_t> next(Scan(*owned_current_));
+  if (next == nullptr)
+    return false;
+
+  // Publish the new one, readers may still be looking at the current one so
+  // it stays around until the next swap
+  current_.store(next.get(), std::memory_order_release);
+  previous_ = std::move(owned_current_);
+  owned_current_ = std::move(next);
+  LOG_INFO("Refreshed traffic speeds for " + std::to_string(owned_current_->size()) + " tiles");
+  return true;
+}
+
+TrafficSpeeds::snapshot_t* TrafficSpeeds::Scan(const snapshot_t& last) const {
+  std::unique_ptr<snapshot_t> next(new snapshot_t);
+  bool changed = false;
+  try {
+    boost::filesystem::path dir(traffic_dir_);
+    if (boost::filesystem::is_directory(dir)) {
+      for (boost::filesystem::directory_iterator i(dir), end; i != end; ++i) {
+        // Only the speed files, named for the tile they belong to
+        if (!boost::filesystem::is_regular_file(i->path()) || i->path().extension() != ".spd")
+          continue;
+        uint32_t tileid;
+        try {
+          tileid = std::stoul(i->path().stem().string());
+        } catch (...) {
+          continue;
+        }
+
+        // Reuse it if it hasnt changed
+        struct stat s;
+        if (stat(i->path().string().c_str(), &s) != 0)
+          continue;
+        size_t size = s.st_size;
+        auto found = last.find(tileid);
+        if (found != last.cend() && found->second->inode == s.st_ino &&
+            found->second->modified == s.st_mtime && found->second->map.size() == size) {
+          next->emplace(tileid, found->second);
+          continue;
+        }
+
+        // Map the new one
+        if (size == 0)
+          continue;
+        std::shared_ptr<tile_t> tile(new tile_t);
+        tile->map.map(i->path().string(), size, POSIX_MADV_NORMAL, true);
+        tile->inode = s.st_ino;
+        tile->modified = s.st_mtime;
+        next->emplace(tileid, std::move(tile));
+        changed = true;
+      }
+    }
+  } catch (const std::exception& e) {
+    LOG_WARN("Failed to load traffic speeds from " + traffic_dir_ + ": " + e.what());
+    return nullptr;
+  }
+
+  // Tiles that went away count as a change too
+  changed = changed || next->size() != last.size();
+  return changed ? next.release() : nullptr;
+}
+
+std::shared_ptr<TrafficSpeeds> TrafficSpeeds::get_instance(const std::string& traffic_dir,
+                                                           const size_t refresh_seconds) {
+  static std::mutex lock;
+  static std::unordered_map<std::string, std::shared_ptr<TrafficSpeeds> > instances;
+  std::lock_guard<std::mutex> guard(lock);
+  auto& instance = instances[traffic_dir];
+  if (!instance)
+    instance.reset(new TrafficSpeeds(traffic_dir, refresh_seconds));
+  return instance;
+}
+
+}
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "baldr/transit_stop_index.h"
+#include "baldr/graphtile.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/constants.h"
+#include "midgard/distanceapproximator.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+  const AABB2<PointLL> world_box(PointLL(-180, -90), PointLL(180, 90));
+
+  // The file is a magic string, the number of cells and stops, the cells and then the
+  // longitudes and latitudes of the stops
+  constexpr char kTransitStopMagic[8] = {'V', 'T', 'R', 'S', 'T', 'O', 'P', 'S'};
+  struct transit_stop_header_t {
+    char magic[8];
+    uint32_t cell_count;
+    uint32_t stop_count;
+    float cell_size;
+    uint32_t spare;
+  };
+}
+
+namespace valhalla {
+  namespace baldr {
+
+    transit_stop_index_t::transit_stop_index_t(const std::vector<PointLL>& stops):
+      grid(world_box, kTransitStopCellSize), cells(nullptr), cell_count(0), lngs(nullptr),
+      lats(nullptr), stop_count(0) {
+
+      // Sort the stops by the cell they are in
+      std::vector<std::pair<int32_t, uint32_t> > binned;
+      binned.reserve(stops.size());
+      for (uint32_t i = 0; i < stops.size(); ++i) {
+        auto id = grid.TileId(stops[i]);
+        if (id >= 0)
+          binned.emplace_back(id, i);
+      }
+      std::sort(binned.begin(), binned.end());
+
+      owned_lngs.reserve(stops.size());
+      owned_lats.reserve(stops.size());
+      for (const auto& stop : binned) {
+        if (owned_cells.empty() || owned_cells.back().id != static_cast<uint32_t>(stop.first))
+          owned_cells.push_back({static_cast<uint32_t>(stop.first), static_cast<uint32_t>(owned_lngs.size())});
+        owned_lngs.push_back(stops[stop.second].lng());
+        owned_lats.push_back(stops[stop.second].lat());
+      }
+      cell_count = owned_cells.size();
+      stop_count = owned_lngs.size();
+      owned_cells.push_back({std::numeric_limits<uint32_t>::max(), stop_count});
+      cells = owned_cells.data();
+      lngs = owned_lngs.data();
+      lats = owned_lats.data();
+    }
+
+    transit_stop_index_t::transit_stop_index_t(const std::string& file_name):
+      grid(world_box, kTransitStopCellSize), cells(nullptr), cell_count(0), lngs(nullptr),
+      lats(nullptr), stop_count(0) {
+      if (!boost::filesystem::exists(file_name))
+        throw std::runtime_error("Missing file");
+      auto size = boost::filesystem::file_size(file_name);
+      if (size < sizeof(transit_stop_header_t))
+        throw std::runtime_error("File too small");
+      mapped.reset(new midgard::mem_map<char>(file_name, size, POSIX_MADV_NORMAL, true));
+
+      // Make sure its an index with the same grid
+      const auto* header = reinterpret_cast<const transit_stop_header_t*>(mapped->get());
+      if (memcmp(header->magic, kTransitStopMagic, sizeof(kTransitStopMagic)) != 0)
+        throw std::runtime_error("Not a transit stop index");
+      if (header->cell_size != kTransitStopCellSize)
+        throw std::runtime_error("Wrong cell size");
+      if (size != sizeof(transit_stop_header_t) + (header->cell_count + 1) * sizeof(cell_t) +
+                  header->stop_count * 2 * sizeof(float))
+        throw std::runtime_error("Wrong size");
+
+      cell_count = header->cell_count;
+      stop_count = header->stop_count;
+      cells = reinterpret_cast<const cell_t*>(header + 1);
+      lngs = reinterpret_cast<const float*>(cells + cell_count + 1);
+      lats = lngs + stop_count;
+    }
+
+    transit_stop_index_t transit_stop_index_t::build(const boost::property_tree::ptree& pt) {
+      // The platforms of the transit level are where the stops are boarded
+      GraphReader reader(pt);
+      std::vector<PointLL> stops;
+      auto transit_level = TileHierarchy::levels().rbegin()->first + 1;
+      for (const auto& tile_id : reader.GetTileSet(transit_level)) {
+        if (reader.OverCommitted())
+          reader.Clear();
+        const GraphTile* tile = reader.GetGraphTile(tile_id);
+        if (tile == nullptr)
+          continue;
+        for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+          const NodeInfo* node = tile->node(i);
+          if (node->type() == NodeType::kMultiUseTransitPlatform)
+            stops.push_back(node->latlng());
+        }
+      }
+      return transit_stop_index_t(stops);
+    }
+
+    bool transit_stop_index_t::has_stop(const PointLL& ll, const float radius) const {
+      if (cell_count == 0)
+        return false;
+
+      // Only the stops of the cells the circle could touch
+      float latdeg = radius / kMetersPerDegreeLat;
+      float lngdeg = radius / DistanceApproximator::MetersPerLngDegree(ll.lat());
+      AABB2<PointLL> bbox(Point2(ll.lng() - lngdeg, ll.lat() - latdeg),
+                          Point2(ll.lng() + lngdeg, ll.lat() + latdeg));
+      DistanceApproximator approximator(ll);
+      float radius_sq = radius * radius;
+      std::vector<float> sq_distances;
+      for (auto id : grid.TileList(bbox)) {
+        const cell_t* cell = std::lower_bound(cells, cells + cell_count, static_cast<uint32_t>(id),
+          [](const cell_t& cell, const uint32_t id) { return cell.id < id; });
+        if (cell == cells + cell_count || cell->id != static_cast<uint32_t>(id))
+          continue;
+        uint32_t count = (cell + 1)->first - cell->first;
+        sq_distances.resize(count);
+        approximator.DistanceSquared(lngs + cell->first, lats + cell->first, count, sq_distances.data());
+        if (std::any_of(sq_distances.cbegin(), sq_distances.cend(),
+                        [radius_sq](const float d) { return d <= radius_sq; }))
+          return true;
+      }
+      return false;
+    }
+
+    size_t transit_stop_index_t::size() const {
+      return stop_count;
+    }
+
+    void transit_stop_index_t::save(const std::string& file_name) const {
+      std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!file)
+        throw std::runtime_error("Failed to open " + file_name);
+      transit_stop_header_t header;
+      memcpy(header.magic, kTransitStopMagic, sizeof(kTransitStopMagic));
+      header.cell_count = cell_count;
+      header.stop_count = stop_count;
+      header.cell_size = kTransitStopCellSize;
+      header.spare = 0;
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char*>(cells), (cell_count + 1) * sizeof(cell_t));
+      file.write(reinterpret_cast<const char*>(lngs), stop_count * sizeof(float));
+      file.write(reinterpret_cast<const char*>(lats), stop_count * sizeof(float));
+      if (!file)
+        throw std::runtime_error("Failed to write " + file_name);
+    }
+
+  }
+}
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <numeric>
+#include "baldr/transitdepartureindex.h"
+
+namespace valhalla {
+namespace baldr {
+
+// Constructor with arguments.
+TransitDepartureIndex::TransitDepartureIndex(const TransitDeparture* departures,
+                                             const uint32_t count)
+    : departures_(departures), order_(count) {
+  // Group the departures of each line by schedule and type, a stable sort
+  // keeps each run in departure order
+  std::iota(order_.begin(), order_.end(), 0);
+  std::stable_sort(order_.begin(), order_.end(),
+    [departures](const uint32_t a, const uint32_t b) {
+      const auto& da = departures[a];
+      const auto& db = departures[b];
+      if (da.lineid() != db.lineid())
+        return da.lineid() < db.lineid();
+      if (da.schedule_index() != db.schedule_index())
+        return da.schedule_index() < db.schedule_index();
+      return da.type() < db.type();
+    });
+
+  // Mark where each run starts and ends
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& d = departures[order_[i]];
+    if (runs_.empty() || runs_.back().lineid != d.lineid() ||
+        runs_.back().schedule_index != d.schedule_index() ||
+        runs_.back().type != d.type()) {
+      runs_.push_back({d.lineid(), d.schedule_index(), d.type(), i, i});
+    }
+    runs_.back().end = i + 1;
+  }
+}
+
+// Position of the first run of a line
+size_t TransitDepartureIndex::FirstRun(const uint32_t lineid) const {
+  return std::lower_bound(runs_.cbegin(), runs_.cend(), lineid,
+    [](const Run& run, const uint32_t lineid) {
+      return run.lineid < lineid;
+    }) - runs_.cbegin();
+}
+
+// Position in order_ of the first departure of a fixed run at or after the
+// current time
+uint32_t TransitDepartureIndex::LowerBound(const Run& run,
+                                           const uint32_t current_time) const {
+  const auto* departures = departures_;
+  return std::lower_bound(order_.cbegin() + run.begin, order_.cbegin() + run.end,
+    current_time, [departures](const uint32_t i, const uint32_t current_time) {
+      return departures[i].departure_time() < current_time;
+    }) - order_.cbegin();
+}
+
+// Position in order_ after the last departure of a fixed run at or before
+// the current time
+uint32_t TransitDepartureIndex::UpperBound(const Run& run,
+                                           const uint32_t current_time) const {
+  const auto* departures = departures_;
+  return std::upper_bound(order_.cbegin() + run.begin, order_.cbegin() + run.end,
+    current_time, [departures](const uint32_t current_time, const uint32_t i) {
+      return current_time < departures[i].departure_time();
+    }) - order_.cbegin();
+}
+
+}
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include "baldr/transitpattern.h"
+
+namespace valhalla {
+namespace baldr {
+
+namespace {
+
+// Orders departures by everything a pattern shares between its trips
+bool shared_less(const TransitDeparture& a, const TransitDeparture& b) {
+  return std::make_tuple(a.lineid(), a.type(), a.routeid(), a.blockid(),
+                         a.headsign_offset(), a.elapsed_time(), a.schedule_index(),
+                         a.wheelchair_accessible(), a.bicycle_accessible()) <
+         std::make_tuple(b.lineid(), b.type(), b.routeid(), b.blockid(),
+                         b.headsign_offset(), b.elapsed_time(), b.schedule_index(),
+                         b.wheelchair_accessible(), b.bicycle_accessible());
+}
+
+}
+
+// Constructor with arguments.
+TransitPattern::TransitPattern(const TransitDeparture& departure,
+                               const uint32_t first_trip,
+                               const uint32_t trip_count)
+    : departure_(departure), first_trip_(first_trip), trip_count_(trip_count) {
+}
+
+// Get the index of the first trip of the pattern.
+uint32_t TransitPattern::first_trip() const {
+  return first_trip_;
+}
+
+// Get the number of trips of the pattern.
+uint32_t TransitPattern::trip_count() const {
+  return trip_count_;
+}
+
+// Get the departure of a trip of the pattern.
+TransitDeparture TransitPattern::departure(const PatternTrip& trip) const {
+  const auto& d = departure_;
+  return TransitDeparture(d.lineid(), trip.tripid, d.routeid(), d.blockid(),
+                          d.headsign_offset(), trip.departure_time,
+                          d.elapsed_time(), d.schedule_index(),
+                          d.wheelchair_accessible(), d.bicycle_accessible());
+}
+
+// Split departures into the ones stored as they are and the patterns
+void TransitPattern::Encode(const std::vector<TransitDeparture>& departures,
+                            std::vector<TransitDeparture>& others,
+                            std::vector<TransitPattern>& patterns,
+                            std::vector<PatternTrip>& trips) {
+  others.clear();
+  patterns.clear();
+  trips.clear();
+
+  // Group the departures sharing everything but their trip and time, a
+  // stable sort keeps the trips of each group in departure order
+  std::vector<uint32_t> order(departures.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+    [&departures](const uint32_t a, const uint32_t b) {
+      return shared_less(departures[a], departures[b]);
+    });
+
+  // Groups of fixed departures with enough trips become patterns as long
+  // as the tile has room for them
+  std::vector<bool> patterned(departures.size(), false);
+  for (size_t begin = 0, end = 0; begin < order.size(); begin = end) {
+    const auto& first = departures[order[begin]];
+    for (end = begin + 1; end < order.size() &&
+         !shared_less(first, departures[order[end]]); ++end);
+    uint32_t count = end - begin;
+    if (first.type() != kFixedSchedule || count < kMinPatternTrips ||
+        patterns.size() >= kMaxDeparturePatterns ||
+        trips.size() + count > kMaxPatternTrips)
+      continue;
+
+    patterns.emplace_back(first, trips.size(), count);
+    for (size_t i = begin; i < end; ++i) {
+      const auto& d = departures[order[i]];
+      trips.push_back({d.tripid(), d.departure_time()});
+      patterned[order[i]] = true;
+    }
+  }
+
+  // The rest keep their order
+  for (size_t i = 0; i < departures.size(); ++i) {
+    if (!patterned[i])
+      others.push_back(departures[i]);
+  }
+}
+
+// Expand patterns back into departures.
+std::vector<TransitDeparture> TransitPattern::Decode(const TransitDeparture* departures,
+                                                     const uint32_t count,
+                                                     const TransitPattern* patterns,
+                                                     const uint32_t pattern_count,
+                                                     const PatternTrip* trips) {
+  std::vector<TransitDeparture> all(departures, departures + count);
+  for (uint32_t p = 0; p < pattern_count; ++p) {
+    const auto& pattern = patterns[p];
+    for (uint32_t t = 0; t < pattern.trip_count(); ++t)
+      all.push_back(pattern.departure(trips[pattern.first_trip() + t]));
+  }
+  std::sort(all.begin(), all.end());
+  return all;
+}
+
+}
+}
@@ -1,5 +1,14 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
@@ -7,6 +16,7 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/python.hpp>
+#include <boost/python/stl_iterator.hpp>
 
 #include "midgard/logging.h"
 #include "meili/traffic_segment_matcher.h"
@@ -48,42 +58,215 @@ namespace {
     configure(config_file);
   }
 
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(route_overloads, route, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(locate_overloads, locate, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(optimized_route_overloads, optimized_route, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(matrix_overloads, matrix, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(isochrone_overloads, isochrone, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(trace_route_overloads, trace_route, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(trace_attributes_overloads, trace_attributes, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(height_overloads, height, 1, 1);
-  BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(transit_available_overloads, transit_available, 1, 1);
+
+  //lets other python threads run while we are off doing c++ work, nothing
+  //touching python objects can happen while one of these is in scope
+  struct gil_release_t {
+    gil_release_t() : state(PyEval_SaveThread()) { }
+    ~gil_release_t() { PyEval_RestoreThread(state); }
+    PyThreadState* state;
+  };
+
+  //the workers of a pool can't share a graph reader but they can share its tiles
+  boost::property_tree::ptree shared_config() {
+    auto shared = configure();
+    if(!shared.get<bool>("mjolnir.global_synchronized_cache", false))
+      shared.put("mjolnir.global_sharded_cache", true);
+    return shared;
+  }
+
+  //workers that are only ever used by one thread at a time. they are made as
+  //they are needed up to the limit and after that handed out as they come back
+  template <class worker_t>
+  class pool_t : public boost::noncopyable {
+   public:
+    using job_t = std::function<std::string (worker_t&, const std::string&)>;
+
+    pool_t(const std::function<worker_t* ()>& make, size_t limit) : make(make),
+      limit(limit ? limit : std::max(1u, std::thread::hardware_concurrency())), made(0) { }
+
+    //runs one request on whichever worker is free
+    std::string run(const std::string& request, const job_t& job) {
+      lease_t lease(*this);
+      return job(*lease.worker, request);
+    }
+
+    //runs the requests on as many workers as there are, the responses are in
+    //the order of the requests. if any fails the rest are skipped and the
+    //first failure is rethrown
+    std::vector<std::string> run(const std::vector<std::string>& requests, const job_t& job) {
+      std::vector<std::string> responses(requests.size());
+      if(requests.empty())
+        return responses;
+
+      std::atomic<size_t> next(0);
+      std::mutex error_mutex;
+      std::exception_ptr error;
+      auto work = [&]() {
+        try {
+          lease_t lease(*this);
+          for(size_t i = next++; i < requests.size(); i = next++)
+            responses[i] = job(*lease.worker, requests[i]);
+        }
+        catch(...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if(!error)
+            error = std::current_exception();
+          next = requests.size();
+        }
+      };
+
+      std::vector<std::thread> threads;
+      for(size_t i = 1; i < std::min(limit, requests.size()); ++i)
+        threads.emplace_back(work);
+      work();
+      for(auto& thread : threads)
+        thread.join();
+      if(error)
+        std::rethrow_exception(error);
+      return responses;
+    }
+
+   protected:
+    //a worker checked out of the pool until it goes out of scope
+    struct lease_t {
+      lease_t(pool_t& pool) : pool(pool), worker(pool.acquire()) { }
+      ~lease_t() { pool.release(std::move(worker)); }
+      pool_t& pool;
+      std::unique_ptr<worker_t> worker;
+    };
+
+    std::unique_ptr<worker_t> acquire() {
+      std::unique_lock<std::mutex> lock(mutex);
+      available.wait(lock, [this]() { return !idle.empty() || made < limit; });
+      if(!idle.empty()) {
+        auto worker = std::move(idle.back());
+        idle.pop_back();
+        return worker;
+      }
+      //make a new one without holding up the others
+      ++made;
+      lock.unlock();
+      try {
+        return std::unique_ptr<worker_t>(make());
+      }
+      catch(...) {
+        lock.lock();
+        --made;
+        available.notify_one();
+        throw;
+      }
+    }
+
+    void release(std::unique_ptr<worker_t>&& worker) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.emplace_back(std::move(worker));
+      }
+      available.notify_one();
+    }
+
+    std::function<worker_t* ()> make;
+    size_t limit;
+    size_t made;
+    std::vector<std::unique_ptr<worker_t> > idle;
+    std::mutex mutex;
+    std::condition_variable available;
+  };
+
+  //one request in one response out, without holding the gil
+  template <class worker_t>
+  std::string run(pool_t<worker_t>& pool, const std::string& request, const typename pool_t<worker_t>::job_t& job) {
+    gil_release_t release;
+    return pool.run(request, job);
+  }
+
+  //a list of requests in and a list of responses out, without holding the gil
+  //while the pool works through them
+  template <class worker_t>
+  boost::python::list run_batch(pool_t<worker_t>& pool, const boost::python::object& py_requests,
+      const typename pool_t<worker_t>::job_t& job) {
+    std::vector<std::string> requests{boost::python::stl_input_iterator<std::string>(py_requests),
+                                      boost::python::stl_input_iterator<std::string>()};
+    std::vector<std::string> responses;
+    {
+      gil_release_t release;
+      responses = pool.run(requests, job);
+    }
+    boost::python::list py_responses;
+    for(const auto& response : responses)
+      py_responses.append(response);
+    return py_responses;
+  }
+
+  using matcher_pool_t = pool_t<valhalla::meili::TrafficSegmentMatcher>;
+  boost::shared_ptr<matcher_pool_t> make_matcher_pool(size_t threads) {
+    auto config = shared_config();
+    return boost::make_shared<matcher_pool_t>([config]() { return new valhalla::meili::TrafficSegmentMatcher(config); }, threads);
+  }
+  std::string match(valhalla::meili::TrafficSegmentMatcher& matcher, const std::string& request) {
+    return matcher.match(request);
+  }
+
+  using actor_pool_t = pool_t<valhalla::tyr::actor_t>;
+  boost::shared_ptr<actor_pool_t> make_actor_pool(size_t threads) {
+    auto config = shared_config();
+    return boost::make_shared<actor_pool_t>([config]() { return new valhalla::tyr::actor_t(config, true); }, threads);
+  }
+  using action_t = std::string (valhalla::tyr::actor_t::*)(const std::string&, const std::function<void ()>&);
+  template <action_t action>
+  std::string act(valhalla::tyr::actor_t& actor, const std::string& request) {
+    return (actor.*action)(request, []()->void{});
+  }
+  template <action_t action>
+  std::string py_act(actor_pool_t& pool, const std::string& request) {
+    return run(pool, request, act<action>);
+  }
+  template <action_t action>
+  boost::python::list py_act_batch(actor_pool_t& pool, const boost::python::object& requests) {
+    return run_batch(pool, requests, act<action>);
+  }
 }
 
 BOOST_PYTHON_MODULE(valhalla) {
+  using namespace valhalla::tyr;
 
   //python interface for configuring the system, always call this first in your python program
   boost::python::def("Configure", py_configure);
 
-  //class for doing matching to traffic segments. Pass in the config to the constructor
-  boost::python::class_<valhalla::meili::TrafficSegmentMatcher, boost::noncopyable,
-                       boost::shared_ptr<valhalla::meili::TrafficSegmentMatcher> >
+  //class for doing matching to traffic segments. Pass in the number of threads to match
+  //batches with to the constructor, none or 0 for as many as there are cores. The
+  //instances of a process share their tiles
+  boost::python::class_<matcher_pool_t, boost::noncopyable, boost::shared_ptr<matcher_pool_t> >
         ("SegmentMatcher", boost::python::no_init)
-      .def("__init__", boost::python::make_constructor(+[](){ return boost::make_shared<valhalla::meili::TrafficSegmentMatcher>(configure()); }))
-      .def("Match", &valhalla::meili::TrafficSegmentMatcher::match);
+      .def("__init__", boost::python::make_constructor(+[]() { return make_matcher_pool(0); }))
+      .def("__init__", boost::python::make_constructor(+[](size_t threads) { return make_matcher_pool(threads); }))
+      .def("Match", +[](matcher_pool_t& pool, const std::string& request) { return run(pool, request, match); })
+      .def("MatchBatch", +[](matcher_pool_t& pool, const boost::python::object& requests) { return run_batch(pool, requests, match); });
 
-  boost::python::class_<valhalla::tyr::actor_t, boost::noncopyable,
-                       boost::shared_ptr<valhalla::tyr::actor_t> >
+  //class for doing every other action, constructed like the one above. Each action
+  //has a batch version taking a list of requests and giving back a list of responses
+  boost::python::class_<actor_pool_t, boost::noncopyable, boost::shared_ptr<actor_pool_t> >
         ("Actor", boost::python::no_init)
-      .def("__init__", boost::python::make_constructor(+[](){ return boost::make_shared<valhalla::tyr::actor_t>(configure(), true); }))
-      .def("Route", &valhalla::tyr::actor_t::route, route_overloads())
-      .def("Locate", &valhalla::tyr::actor_t::route, locate_overloads())
-      .def("OptimizedRoute", &valhalla::tyr::actor_t::route, optimized_route_overloads())
-      .def("Matrix", &valhalla::tyr::actor_t::route, matrix_overloads())
-      .def("Isochrone", &valhalla::tyr::actor_t::route, isochrone_overloads())
-      .def("TraceRoute", &valhalla::tyr::actor_t::route, trace_route_overloads())
-      .def("TraceAttributes", &valhalla::tyr::actor_t::route, trace_attributes_overloads())
-      .def("Height", &valhalla::tyr::actor_t::route, height_overloads())
-      .def("TransitAvailable", &valhalla::tyr::actor_t::route, transit_available_overloads())
-
+      .def("__init__", boost::python::make_constructor(+[]() { return make_actor_pool(0); }))
+      .def("__init__", boost::python::make_constructor(+[](size_t threads) { return make_actor_pool(threads); }))
+      .def("Route", py_act<&actor_t::route>)
+      .def("RouteBatch", py_act_batch<&actor_t::route>)
+      .def("Locate", py_act<&actor_t::locate>)
+      .def("LocateBatch", py_act_batch<&actor_t::locate>)
+      .def("OptimizedRoute", py_act<&actor_t::optimized_route>)
+      .def("OptimizedRouteBatch", py_act_batch<&actor_t::optimized_route>)
+      .def("Matrix", py_act<&actor_t::matrix>)
+      .def("MatrixBatch", py_act_batch<&actor_t::matrix>)
+      .def("Isochrone", py_act<&actor_t::isochrone>)
+      .def("IsochroneBatch", py_act_batch<&actor_t::isochrone>)
+      .def("TraceRoute", py_act<&actor_t::trace_route>)
+      .def("TraceRouteBatch", py_act_batch<&actor_t::trace_route>)
+      .def("TraceAttributes", py_act<&actor_t::trace_attributes>)
+      .def("TraceAttributesBatch", py_act_batch<&actor_t::trace_attributes>)
+      .def("Height", py_act<&actor_t::height>)
+      .def("HeightBatch", py_act_batch<&actor_t::height>)
+      .def("TransitAvailable", py_act<&actor_t::transit_available>)
+      .def("TransitAvailableBatch", py_act_batch<&actor_t::transit_available>)
   ;
 }
@@ -17,46 +17,63 @@ void from_ll(odin::Location* l, const PointLL& p) {
   l->mutable_ll()->set_lat(p.lat());
   l->mutable_ll()->set_lng(p.lng());
 }
+//distance along the shape to each posting
+std::vector<float> get_ranges(const std::vector<PointLL>& shape) {
+  std::vector<float> ranges;
+  ranges.reserve(shape.size()); ranges.emplace_back(0);
+  for(auto point = std::next(shape.cbegin()); point != shape.cend(); ++point)
+    ranges.emplace_back(ranges.back() +  point->Distance(*std::prev(point)));
+  return ranges;
+}
 }
 
 namespace valhalla {
   namespace loki {
 
-    std::vector<PointLL> loki_worker_t::init_height(valhalla_request_t& request) {
-      //not enough shape
-      if (request.options.shape_size() < 1)
-        throw valhalla_exception_t{312};
-
-      //convert back to native pointll :(
-      std::vector<PointLL> shape;
-      for(const auto& l : request.options.shape()) shape.emplace_back(to_ll(l));
-
+    bool loki_worker_t::resample_height(std::vector<PointLL>& shape, const valhalla_request_t& request) const {
       //resample the shape
       bool resampled = false;
       if(request.options.has_resample_distance()) {
         if(request.options.resample_distance() < min_resample)
           throw valhalla_exception_t{313, " " + std::to_string(min_resample) + " meters"};
-        if(request.options.shape_size() > 1) {
+        if(shape.size() > 1) {
           //resample the shape but make sure to keep the first and last shapepoint
           auto last = shape.back();
-          shape = midgard::resample_spherical_polyline(shape, request.options.resample_distance());
-          shape.emplace_back(std::move(last));
-          //put it back
-          request.options.clear_shape();
-          for(const auto& p : shape) from_ll(request.options.mutable_shape()->Add(), p);
-          //reencode it for display if they sent it encoded
-          if(request.options.has_encoded_polyline())
-            request.options.set_encoded_polyline(midgard::encode(shape));
+          std::vector<PointLL> resampled;
+          midgard::resample_spherical_polyline(shape, request.options.resample_distance(), resampled);
+          resampled.emplace_back(std::move(last));
+          shape.swap(resampled);
           resampled = true;
         }
       }
 
       //there are limits though
-      if(request.options.shape_size() > max_elevation_shape) {
-        throw valhalla_exception_t{314, " (" + std::to_string(request.options.shape_size()) +
+      if(shape.size() > max_elevation_shape) {
+        throw valhalla_exception_t{314, " (" + std::to_string(shape.size()) +
             (resampled ? " after resampling" : "") + "). The limit is " + std::to_string(max_elevation_shape)};
       }
 
+      return resampled;
+    }
+
+    std::vector<PointLL> loki_worker_t::init_height(valhalla_request_t& request) {
+      //not enough shape
+      if (request.options.shape_size() < 1)
+        throw valhalla_exception_t{312};
+
+      //convert back to native pointll :(
+      std::vector<PointLL> shape;
+      for(const auto& l : request.options.shape()) shape.emplace_back(to_ll(l));
+
+      if(resample_height(shape, request)) {
+        //put it back
+        request.options.clear_shape();
+        for(const auto& p : shape) from_ll(request.options.mutable_shape()->Add(), p);
+        //reencode it for display if they sent it encoded
+        if(request.options.has_encoded_polyline())
+          request.options.set_encoded_polyline(midgard::encode(shape));
+      }
+
       return shape;
     }
 
@@ -67,21 +84,58 @@ namespace valhalla {
     }
     */
     std::string loki_worker_t::height(valhalla_request_t& request) {
+      //several shapes at once
+      if (request.options.encoded_polylines_size() > 0)
+        return height_batch(request);
+
       auto shape = init_height(request);
       //get the elevation of each posting
-      std::vector<double> heights = sample.get_all(shape);
+      std::vector<double> heights = sample->get_all(shape);
       if (!request.options.do_not_track())
         valhalla::midgard::logging::Log("sample_count::" + std::to_string(shape.size()), " [ANALYTICS] ");
 
       //get the distances between the postings if desired
       std::vector<float> ranges;
-      if (request.options.range()) {
-        ranges.reserve(shape.size()); ranges.emplace_back(0);
-        for(auto point = std::next(shape.cbegin()); point != shape.cend(); ++point)
-          ranges.emplace_back(ranges.back() +  point->Distance(*std::prev(point)));
-      }
+      if (request.options.range())
+        ranges = get_ranges(shape);
 
       return tyr::serializeHeight(request, heights, ranges);
     }
+
+    /* example batch height with range response:
+    {
+      "heights": [
+        { "encoded_polyline": "s{cplAfiz{pCa]xBxBx`A", "range_height": [ [0,258], [54,258], [143,259] ] },
+        { "encoded_polyline": "_c@rFodDbR", "range_height": [ [0,303], [8467,275] ] }
+      ]
+    }
+    */
+    std::string loki_worker_t::height_batch(valhalla_request_t& request) {
+      //there are limits
+      if (static_cast<size_t>(request.options.encoded_polylines_size()) > max_elevation_shapes) {
+        throw valhalla_exception_t{315, " (" + std::to_string(request.options.encoded_polylines_size()) +
+            "). The limit is " + std::to_string(max_elevation_shapes)};
+      }
+
+      //sample each shape on its own, the decompressed tiles are shared by every worker
+      std::vector<std::string> shapes;
+      std::vector<std::vector<double> > heights;
+      std::vector<std::vector<float> > ranges;
+      size_t samples = 0;
+      for(const auto& encoded : request.options.encoded_polylines()) {
+        auto shape = midgard::decode<std::vector<PointLL> >(encoded);
+        if(shape.empty())
+          throw valhalla_exception_t{312};
+        //reencode it for display if it was resampled
+        shapes.emplace_back(resample_height(shape, request) ? midgard::encode(shape) : encoded);
+        heights.emplace_back(sample->get_all(shape));
+        ranges.emplace_back(request.options.range() ? get_ranges(shape) : std::vector<float>{});
+        samples += shape.size();
+      }
+      if (!request.options.do_not_track())
+        valhalla::midgard::logging::Log("sample_count::" + std::to_string(samples), " [ANALYTICS] ");
+
+      return tyr::serializeHeightBatch(request, shapes, heights, ranges);
+    }
   }
 }
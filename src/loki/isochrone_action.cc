@@ -59,23 +59,31 @@ namespace valhalla {
         prev = c;
       }
       parse_costing(request);
+
+      //there is no reverse expansion for multimodal isochrones
+      auto direction = rapidjson::get<std::string>(request.document, "/direction", "forward");
+      if((direction == "reverse" || direction == "both") &&
+         (request.options.costing() == odin::DirectionsOptions::multimodal ||
+          request.options.costing() == odin::DirectionsOptions::transit))
+        throw valhalla_exception_t{140};
     }
     void loki_worker_t::isochrones(valhalla_request_t& request) {
       init_isochrones(request);
       //check that location size does not exceed max
-      if (request.options.locations_size() > max_locations.find("isochrone")->second)
-        throw valhalla_exception_t{150, std::to_string(max_locations.find("isochrone")->second)};
+      const auto& isochrone_limits = service_limits.action(odin::DirectionsOptions::isochrone);
+      if (request.options.locations_size() > isochrone_limits.max_locations)
+        throw valhalla_exception_t{150, std::to_string(isochrone_limits.max_locations)};
 
       //check the distances
       auto max_location_distance = std::numeric_limits<float>::min();
-      check_distance(request.options.locations(), max_distance.find("isochrone")->second, max_location_distance);
+      check_distance(request.options.locations(), isochrone_limits.max_distance, max_location_distance);
       if (!request.options.do_not_track())
         valhalla::midgard::logging::Log("max_location_distance::" + std::to_string(max_location_distance * kKmPerMeter) + "km", " [ANALYTICS] ");
 
       try{
         //correlate the various locations to the underlying graph
         auto locations = PathLocation::fromPBF(request.options.locations());
-        const auto projections = loki::Search(locations, reader, edge_filter, node_filter);
+        const auto projections = loki::Search(locations, reader, edge_filter, node_filter, access_mode);
         for(size_t i = 0; i < locations.size(); ++i) {
           const auto& projection = projections.at(locations[i]);
           PathLocation::toPBF(projection, request.options.mutable_locations(i), reader);
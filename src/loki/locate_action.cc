@@ -24,7 +24,8 @@ namespace valhalla {
       //correlate the various locations to the underlying graph
       init_locate(request);
       auto locations = PathLocation::fromPBF(request.options.locations());
-      auto projections = loki::Search(locations, reader, edge_filter, node_filter);
+      //batches of locations are spread over the search threads, if there are any
+      auto projections = search(locations);
       return tyr::serializeLocate(request, locations, projections, reader);
     }
 
@@ -83,13 +83,19 @@ namespace valhalla {
         throw valhalla_exception_t{140, odin::DirectionsOptions::Action_Name(request.options.action())};
 
       //check that location size does not exceed max.
-      auto max = max_matrix_locations.find(costing)->second;
+      const auto& costing_limits = service_limits.costing(request.options.costing());
+      auto max = costing_limits.max_matrix_locations;
       if (request.options.sources_size() > max || request.options.targets_size() > max)
         throw valhalla_exception_t{150, std::to_string(max)};
 
+      //check the number of departure times of a sweep
+      auto time_slices = rapidjson::get<uint64_t>(request.document, "/time_slices/count", 1);
+      if (time_slices > max_time_slices)
+        throw valhalla_exception_t{164, std::to_string(max_time_slices)};
+
       //check the distances
       auto max_location_distance = std::numeric_limits<float>::min();
-      check_distance(request.options.sources(), request.options.targets(), max_matrix_distance.find(costing)->second, max_location_distance);
+      check_distance(request.options.sources(), request.options.targets(), costing_limits.max_matrix_distance, max_location_distance);
 
       //correlate the various locations to the underlying graph
       auto sources_targets = PathLocation::fromPBF(request.options.sources());
@@ -99,7 +105,7 @@ namespace valhalla {
       //correlate the various locations to the underlying graph
       std::unordered_map<size_t, size_t> color_counts;
       try{
-        const auto searched = loki::Search(sources_targets, reader, edge_filter, node_filter);
+        const auto searched = search(sources_targets);
         for(size_t i = 0; i < sources_targets.size(); ++i) {
           const auto& l = sources_targets[i];
           const auto& projection = searched.at(l);
@@ -51,8 +51,9 @@ namespace valhalla {
       init_route(request);
       auto costing = odin::DirectionsOptions::Costing_Name(request.options.costing());
       if(costing.back() == '_') costing.pop_back();
-      check_locations(request.options.locations_size(), max_locations.find(costing)->second);
-      check_distance(reader, request.options.locations(), max_distance.find(costing)->second);
+      const auto& costing_limits = service_limits.costing(request.options.costing());
+      check_locations(request.options.locations_size(), costing_limits.max_locations);
+      check_distance(reader, request.options.locations(), costing_limits.max_distance);
 
       // Validate walking distances (make sure they are in the accepted range)
       if (costing == "multimodal" || costing == "transit") {
@@ -75,7 +76,7 @@ namespace valhalla {
       std::unordered_map<size_t, size_t> color_counts;
       try{
         auto locations = PathLocation::fromPBF(request.options.locations());
-        const auto projections = loki::Search(locations, reader, edge_filter, node_filter);
+        const auto projections = search(locations);
         for(size_t i = 0; i < locations.size(); ++i) {
           const auto& correlated = projections.at(locations[i]);
           PathLocation::toPBF(correlated, request.options.mutable_locations(i), reader);
@@ -1,9 +1,12 @@
 #include "loki/search.h"
 #include "midgard/linesegment2.h"
 #include "midgard/distanceapproximator.h"
+#include "midgard/metrics.h"
 #include "baldr/tilehierarchy.h"
 
 #include <unordered_set>
+#include <exception>
+#include <thread>
 #include <list>
 #include <cmath>
 #include <algorithm>
@@ -30,6 +33,9 @@ constexpr float SIDE_OF_STREET_SNAP = 25.f; //this is 5 meters squared, the comp
 constexpr float HEADING_SAMPLE = 30.f;
 //cone width to use for cosine similarity comparisons for favoring heading
 constexpr float DEFAULT_ANGLE_WIDTH = 60.f;
+//fewest locations each thread gets when searching on several, below that the
+//threads cost more than they save
+constexpr size_t kMinLocationsPerThread = 16;
 
 //TODO: move this to midgard and test the crap out of it
 //we are essentially estimating the angle of the tangent
@@ -235,6 +241,14 @@ struct projector_t {
     return {u.first + bx * scale, u.second + by * scale};
   }
 
+  // Square distance to the closest point of a box, no point in the box can
+  // project any closer than this
+  float sq_distance(const AABB2<PointLL>& box) const {
+    PointLL closest(std::min(std::max(lng, box.minx()), box.maxx()),
+                    std::min(std::max(lat, box.miny()), box.maxy()));
+    return approx.DistanceSquared(closest);
+  }
+
   std::function<std::tuple<int32_t, unsigned short, float>()> binner;
   const GraphTile* cur_tile = nullptr;
   Location location;
@@ -255,6 +269,7 @@ struct bin_handler_t {
   valhalla::baldr::GraphReader& reader;
   const EdgeFilter& edge_filter;
   const NodeFilter& node_filter;
+  uint32_t access_mode;
   unsigned int max_reach_limit;
   std::vector<candidate_t> bin_candidates;
   std::unordered_set<uint64_t> correlated_edges;
@@ -276,8 +291,8 @@ struct bin_handler_t {
   };
 
   bin_handler_t(const std::vector<valhalla::baldr::Location>& locations, valhalla::baldr::GraphReader& reader,
-    const EdgeFilter& edge_filter, const NodeFilter& node_filter):
-    reader(reader), edge_filter(edge_filter), node_filter(node_filter) {
+    const EdgeFilter& edge_filter, const NodeFilter& node_filter, const uint32_t access_mode):
+    reader(reader), edge_filter(edge_filter), node_filter(node_filter), access_mode(access_mode) {
     //get the unique set of input locations and the max reachability of them all
     std::unordered_set<Location> uniq_locations(locations.begin(), locations.end());
     pps.reserve(uniq_locations.size());
@@ -441,6 +456,11 @@ struct bin_handler_t {
     if(found != reach_indices.cend())
       return reaches[found->second];
 
+    //the tile already knows this edge leads to enough of the network
+    auto stored = edge->reach(access_mode);
+    if(stored >= max_reach_limit)
+      return stored;
+
     //we only want to waste time checking if this could become the best reachable option for a given location
     bool check = false;
     auto c_itr = bin_candidates.begin();
@@ -466,6 +486,57 @@ struct bin_handler_t {
     return reaches.back();
   }
 
+  //whether an edge is too far from all of the locations in the range for any
+  //point along it to be kept, judging only by the bounding box of its shape.
+  //this has to agree with what would happen to the candidates if we did
+  //project onto the edge, which depends on the batch they would go into
+  bool too_far(std::vector<projector_t>::iterator begin, std::vector<projector_t>::iterator end,
+    const DirectedEdge* edge, const AABB2<PointLL>& box) const {
+    //the reachability the edge gets if nobody wants to check it
+    auto found = reach_indices.find(edge->endnode());
+    bool known = max_reach_limit == 0 || found != reach_indices.cend();
+    unsigned int reachability = max_reach_limit == 0 ? 0 :
+      (found != reach_indices.cend() ? reaches[found->second] : max_reach_limit);
+    for (auto p_itr = begin; p_itr != end; ++p_itr) {
+      auto sq_distance = p_itr->sq_distance(box);
+      //it might be worth checking the reachability which could be anything
+      if(!known && (p_itr->reachable.empty() || sq_distance < p_itr->reachable.back().sq_distance))
+        return false;
+      //it could be in the radius or better than what that batch has
+      const auto& batch = reachability < p_itr->location.minimum_reachability_ ? p_itr->unreachable : p_itr->reachable;
+      if(batch.empty() || sq_distance < p_itr->sq_radius || sq_distance < batch.back().sq_distance)
+        return false;
+    }
+    return true;
+  }
+
+  //iterate along the segments of a shape projecting each of the points in
+  //the range onto them and keeping the closest point in their bin candidates
+  template <class shape_t>
+  void project(shape_t shape, std::vector<projector_t>::iterator begin,
+               std::vector<projector_t>::iterator end) {
+    PointLL v;
+    if (!shape.empty())
+      v = shape.pop();
+    for(size_t i = 0; !shape.empty(); ++i) {
+      auto u = v;
+      v = shape.pop();
+      //for each input point
+      auto c_itr = bin_candidates.begin();
+      for (auto p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
+        //how close is the input to this segment
+        auto point = p_itr->project(u, v);
+        auto sq_distance = p_itr->approx.DistanceSquared(point);
+        //do we want to keep it
+        if(sq_distance < c_itr->sq_distance) {
+          c_itr->sq_distance = sq_distance;
+          c_itr->point = std::move(point);
+          c_itr->index = i;
+        }
+      }
+    }
+  }
+
   //handle a bin for the range of candidates that share it
   void handle_bin(std::vector<projector_t>::iterator begin,
                   std::vector<projector_t>::iterator end) {
@@ -477,14 +548,31 @@ struct bin_handler_t {
       if(!reader.GetGraphTile(e, tile))
         continue;
 
+      //the filter of a costing requires its access mode so the access the tile keeps packed
+      //rules out the edges it cant use in either direction without calling the filter or
+      //looking up the opposing edge
+      bool forward = true, reverse = true;
+      if(access_mode) {
+        auto access = tile->edge_access(e);
+        forward = (access & access_mode) != 0;
+        reverse = ((access >> kReverseAccessShift) & access_mode) != 0;
+        if(!forward && !reverse)
+          continue;
+      }
+
       //no thanks on this one or its evil twin
       const auto* edge = tile->directededge(e);
-      if(edge_filter(edge) == 0.0f &&
-        (!(e = reader.GetOpposingEdgeId(e, tile)).Is_Valid() ||
+      if((!forward || edge_filter(edge) == 0.0f) &&
+        (!reverse || !(e = reader.GetOpposingEdgeId(e, tile)).Is_Valid() ||
         edge_filter(edge = tile->directededge(e)) == 0.0f)) {
         continue;
       }
 
+      //skip it without decoding its shape if it is too far away to matter
+      AABB2<PointLL> box;
+      if(tile->edge_bbox(e, box) && too_far(begin, end, edge, box))
+        continue;
+
       //reset these so we know the best point along the edge
       auto c_itr = bin_candidates.begin();
       decltype(begin) p_itr;
@@ -499,31 +587,12 @@ struct bin_handler_t {
       //of the shape which are on the same side of h that p is. to make this fast we would need a
       //a trivial half plane test as maybe a single dot product and comparison?
 
-      //get some shape of the edge
+      //get some shape of the edge, without decoding it if the tile has it in fixed point
       auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge->edgeinfo_offset()));
-      auto shape = edge_info->lazy_shape();
-      PointLL v;
-      if (!shape.empty())
-        v = shape.pop();
-
-      //iterate along this edges segments projecting each of the points
-      for(size_t i = 0; !shape.empty(); ++i) {
-        auto u = v;
-        v = shape.pop();
-        //for each input point
-        c_itr = bin_candidates.begin();
-        for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-          //how close is the input to this segment
-          auto point = p_itr->project(u, v);
-          auto sq_distance = p_itr->approx.DistanceSquared(point);
-          //do we want to keep it
-          if(sq_distance < c_itr->sq_distance) {
-            c_itr->sq_distance = sq_distance;
-            c_itr->point = std::move(point);
-            c_itr->index = i;
-          }
-        }
-      }
+      if (tile->has_fixed_shapes())
+        project(tile->fixed_shape(edge->edgeinfo_offset()), begin, end);
+      else
+        project(edge_info->lazy_shape(), begin, end);
 
       //if we already have a better reachable candidate we can just assume this one is reachable
       auto reachability = check_reachability(begin, end, tile, edge);
@@ -683,17 +752,80 @@ namespace valhalla {
 namespace loki {
 
 std::unordered_map<Location, PathLocation>
-Search(const std::vector<Location>& locations, GraphReader& reader, const EdgeFilter& edge_filter, const NodeFilter& node_filter) {
+Search(const std::vector<Location>& locations, GraphReader& reader, const EdgeFilter& edge_filter, const NodeFilter& node_filter,
+  const uint32_t access_mode) {
+  METRICS_TIME(kLokiSearch);
   //trivially finished already
   if(locations.empty())
     return std::unordered_map<Location, PathLocation>{};
   //setup the unique list of locations
-  bin_handler_t handler(locations, reader, edge_filter, node_filter);
+  bin_handler_t handler(locations, reader, edge_filter, node_filter, access_mode);
   //search over the bins doing multiple locations per bin
   handler.search();
   //turn each locations candidate set into path locations
   return handler.finalize();
 }
 
+std::unordered_map<Location, PathLocation>
+Search(const std::vector<Location>& locations, const std::vector<GraphReader*>& readers, const EdgeFilter& edge_filter,
+  const NodeFilter& node_filter, const uint32_t access_mode) {
+  //not worth the threads
+  std::unordered_set<Location> uniq_locations(locations.begin(), locations.end());
+  size_t thread_count = std::min(readers.size(), uniq_locations.size() / kMinLocationsPerThread);
+  if(thread_count < 2)
+    return Search(locations, *readers.front(), edge_filter, node_filter, access_mode);
+  METRICS_TIME(kLokiSearch);
+
+  //keep the locations in each bin of the local tiles together so they share it
+  const auto& local_tiles = TileHierarchy::levels().rbegin()->second.tiles;
+  Tiles<PointLL> bins({-180, -90, 180, 90}, local_tiles.TileSize() / kBinsDim);
+  std::unordered_map<int32_t, std::vector<Location> > binned;
+  for(const auto& location : uniq_locations)
+    binned[bins.TileId(location.latlng_)].push_back(location);
+  thread_count = std::min(thread_count, binned.size());
+
+  //deal the bins out, biggest first, to whichever thread has the fewest locations
+  std::vector<const std::vector<Location>*> sorted;
+  for(const auto& bin : binned)
+    sorted.push_back(&bin.second);
+  std::sort(sorted.begin(), sorted.end(),
+    [](const std::vector<Location>* a, const std::vector<Location>* b) { return a->size() > b->size(); });
+  std::vector<std::vector<Location> > shares(thread_count);
+  for(const auto* bin : sorted) {
+    auto share = std::min_element(shares.begin(), shares.end(),
+      [](const std::vector<Location>& a, const std::vector<Location>& b) { return a.size() < b.size(); });
+    share->insert(share->end(), bin->begin(), bin->end());
+  }
+
+  //search each share with its own reader
+  std::vector<std::unordered_map<Location, PathLocation> > results(thread_count);
+  std::vector<std::exception_ptr> errors(thread_count);
+  auto search = [&](size_t i) {
+    try {
+      bin_handler_t handler(shares[i], *readers[i], edge_filter, node_filter, access_mode);
+      handler.search();
+      results[i] = handler.finalize();
+    }
+    catch(...) {
+      errors[i] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  for(size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(search, i);
+  search(0);
+  for(auto& thread : threads)
+    thread.join();
+
+  //put them back together
+  for(size_t i = 0; i < thread_count; ++i) {
+    if(errors[i])
+      std::rethrow_exception(errors[i]);
+    if(i > 0)
+      results.front().insert(results[i].begin(), results[i].end());
+  }
+  return std::move(results.front());
+}
+
 }
 }
@@ -112,7 +112,7 @@ namespace valhalla {
 
       // Validate shape count and distance (for now, just send max_factor for distance)
       check_shape(request.options.shape(), max_trace_shape);
-      check_distance(request.options.shape(), max_distance.find("trace")->second, max_factor);
+      check_distance(request.options.shape(), service_limits.action(request.options.action()).max_distance, max_factor);
 
       // Validate best paths and best paths shape for `map_snap` requests
       if  (shape_match == "map_snap") {
@@ -154,7 +154,7 @@ namespace valhalla {
 
       // Add first and last correlated locations to request
       try{
-        auto projections = loki::Search(locations, reader, edge_filter, node_filter);
+        auto projections = loki::Search(locations, reader, edge_filter, node_filter, access_mode);
         request.options.clear_locations();
         PathLocation::toPBF(projections.at(locations.front()), request.options.mutable_locations()->Add(), reader);
         PathLocation::toPBF(projections.at(locations.back()), request.options.mutable_locations()->Add(), reader);
@@ -22,6 +22,13 @@ namespace valhalla {
       try{
         const auto& tiles = TileHierarchy::levels().find(TileHierarchy::levels().rbegin()->first)->second.tiles;
         for (const auto& location : locations) {
+          // With a transit stop index look for the stops themselves, it needs no tiles
+          if (transit_stops) {
+            if (transit_stops->has_stop(location.latlng_, location.radius_))
+              found.emplace(location);
+            continue;
+          }
+
           // Get a list of tiles required within the radius of the projected point
           const auto& ll = location.latlng_;
           DistanceApproximator approximator(ll);
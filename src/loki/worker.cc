@@ -8,11 +8,13 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
+#include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
 #include "sif/motorscootercost.h"
+#include "baldr/curler.h"
 #include "baldr/json.h"
 #include "baldr/rapidjson_utils.h"
 #include "tyr/actor.h"
@@ -27,6 +29,12 @@ using namespace valhalla::baldr;
 using namespace valhalla::sif;
 using namespace valhalla::loki;
 
+namespace {
+  //how many shapes one /height may sample if the service_limits dont say
+  constexpr size_t DEFAULT_MAX_ELEVATION_SHAPES = 100;
+  constexpr size_t DEFAULT_MAX_TIME_SLICES = 96;
+}
+
 namespace valhalla {
   namespace loki {
     void loki_worker_t::parse_locations(google::protobuf::RepeatedPtrField<odin::Location>* locations,
@@ -77,6 +85,7 @@ namespace valhalla {
         c = factory.Create(costing, *method_options_ptr);
         edge_filter = c->GetEdgeFilter();
         node_filter = c->GetNodeFilter();
+        access_mode = c->access_mode();
       }
       catch(const std::runtime_error&) {
         throw valhalla_exception_t{125, "'" + costing + "'"};
@@ -88,7 +97,7 @@ namespace valhalla {
       if(request.options.avoid_locations_size()) {
         try {
           auto avoid_locations = PathLocation::fromPBF(request.options.avoid_locations());
-          auto results = loki::Search(avoid_locations, reader, edge_filter, node_filter);
+          auto results = loki::Search(avoid_locations, reader, edge_filter, node_filter, access_mode);
           std::unordered_set<uint64_t> avoids;
           for(const auto& result : results) {
             for(const auto& edge : result.second.edges) {
@@ -110,14 +119,17 @@ namespace valhalla {
     }
 
     loki_worker_t::loki_worker_t(const boost::property_tree::ptree& config):
-        config(config), reader(config.get_child("mjolnir")),
+        config(config), access_mode(0), reader(config.get_child("mjolnir")),
         connectivity_map(config.get<bool>("loki.use_connectivity", true) ? new connectivity_map_t(config.get_child("mjolnir")) : nullptr),
+        service_limits(config.get_child("service_limits")),
         long_request(config.get<float>("loki.logging.long_request")),
         max_contours(config.get<size_t>("service_limits.isochrone.max_contours")),
         max_time(config.get<size_t>("service_limits.isochrone.max_time")),
         max_trace_shape(config.get<size_t>("service_limits.trace.max_shape")),
-        sample(config.get<std::string>("additional_data.elevation", "test/data/")),
+        sample(skadi::sample::get_instance(config.get<std::string>("additional_data.elevation", "test/data/"),
+          config.get<size_t>("additional_data.elevation_cache_size", skadi::sample::kDefaultCacheSize))),
         max_elevation_shape(config.get<size_t>("service_limits.skadi.max_shape")),
+        max_elevation_shapes(config.get<size_t>("service_limits.skadi.max_shapes", DEFAULT_MAX_ELEVATION_SHAPES)),
         min_resample(config.get<float>("service_limits.skadi.min_resample")) {
 
       // Keep a string noting which actions we support, throw if one isnt supported
@@ -132,31 +144,23 @@ namespace valhalla {
       if(action_str.empty())
         throw std::runtime_error("The config actions for Loki are incorrectly loaded");
 
-      //Build max_locations and max_distance maps
-      for (const auto& kv : config.get_child("service_limits")) {
-        if(kv.first == "max_avoid_locations" || kv.first == "max_reachability" || kv.first == "max_radius")
-          continue;
-        if (kv.first != "skadi" && kv.first != "trace")
-          max_locations.emplace(kv.first, config.get<size_t>("service_limits." + kv.first + ".max_locations"));
-        if (kv.first != "skadi")
-          max_distance.emplace(kv.first, config.get<float>("service_limits." + kv.first + ".max_distance"));
-        if (kv.first != "skadi" && kv.first != "trace" && kv.first != "isochrone") {
-          max_matrix_distance.emplace(kv.first, config.get<float>("service_limits." + kv.first + ".max_matrix_distance"));
-          max_matrix_locations.emplace(kv.first, config.get<float>("service_limits." + kv.first + ".max_matrix_locations"));
+      // Map the transit stops if there is an index of them, otherwise checking for transit
+      // falls back to the connectivity of the transit tiles
+      auto transit_stop_index = config.get<std::string>("mjolnir.transit_stop_index", "");
+      if (!transit_stop_index.empty()) {
+        try {
+          transit_stops.reset(new transit_stop_index_t(transit_stop_index));
+        } catch (const std::exception& e) {
+          LOG_WARN("Could not map transit stop index " + transit_stop_index + ": " + e.what());
         }
       }
-      //this should never happen
-      if (max_locations.empty())
-        throw std::runtime_error("Missing max_locations configuration");
-
-      if (max_distance.empty())
-        throw std::runtime_error("Missing max_distance configuration");
-
-      if (max_matrix_distance.empty())
-        throw std::runtime_error("Missing max_matrix_distance configuration");
 
-      if (max_matrix_locations.empty())
-        throw std::runtime_error("Missing max_matrix_locations configuration");
+      // Hand the requests for other regions on to the clusters holding them
+      auto shards_config = config.get_child_optional("loki.shards");
+      if (shards_config && !shards_config->empty()) {
+        shards.reset(new ShardMap(*shards_config));
+        shard_curler.reset(new curler_t());
+      }
 
       min_transit_walking_dis =
         config.get<size_t>("service_limits.pedestrian.min_transit_walking_distance");
@@ -164,6 +168,7 @@ namespace valhalla {
         config.get<size_t>("service_limits.pedestrian.max_transit_walking_distance");
 
       max_avoid_locations = config.get<size_t>("service_limits.max_avoid_locations");
+      max_time_slices = config.get<size_t>("service_limits.max_time_slices", DEFAULT_MAX_TIME_SLICES);
       max_reachability = config.get<unsigned int>("service_limits.max_reachability");
       default_reachability = config.get<unsigned int>("loki.service_defaults.minimum_reachability");
       max_radius = config.get<unsigned long>("service_limits.max_radius");
@@ -172,7 +177,10 @@ namespace valhalla {
       max_search_radius = config.get<float>("service_limits.trace.max_search_radius");
       max_best_paths = config.get<unsigned int>("service_limits.trace.max_best_paths");
       max_best_paths_shape = config.get<size_t>("service_limits.trace.max_best_paths_shape");
-
+      trace_sample_rate = config.get<float>("httpd.service.trace_sample_rate", 0.f);
+      auto search_threads = config.get<uint32_t>("loki.search_threads", 1);
+      for (uint32_t i = 1; i < search_threads; ++i)
+        search_readers.emplace_back(new GraphReader(config.get_child("mjolnir")));
 
       // Register edge/node costing methods
       // TODO: move this into the loop above
@@ -184,15 +192,80 @@ namespace valhalla {
       factory.Register("motor_scooter", sif::CreateMotorScooterCost);
       factory.Register("pedestrian", sif::CreatePedestrianCost);
       factory.Register("truck", sif::CreateTruckCost);
+      factory.Register("truck_fleet", sif::CreateProfileTruckCost<sif::FleetTruckProfile>);
       factory.Register("transit", sif::CreateTransitCost);
     }
 
     void loki_worker_t::cleanup() {
       if(reader.OverCommitted())
-        reader.Clear();
+        reader.Trim();
+      reader.RefreshTiles();
+      for (auto& search_reader : search_readers) {
+        if(search_reader->OverCommitted())
+          search_reader->Trim();
+        search_reader->RefreshTiles();
+      }
+    }
+
+    std::unordered_map<Location, PathLocation> loki_worker_t::search(const std::vector<Location>& locations) {
+      if (search_readers.empty())
+        return loki::Search(locations, reader, edge_filter, node_filter, access_mode);
+      std::vector<GraphReader*> readers{&reader};
+      for (const auto& search_reader : search_readers)
+        readers.push_back(search_reader.get());
+      return loki::Search(locations, readers, edge_filter, node_filter, access_mode);
     }
 
 #ifdef HAVE_HTTP
+    boost::optional<worker_t::result_t> loki_worker_t::dispatch(const valhalla_request_t& request,
+        const std::string& path, http_request_info_t& info) {
+      // Heights dont need the graph and what another region handed on is ours to answer
+      if (!shards || request.options.action() == odin::DirectionsOptions::height ||
+          request.document.HasMember("shard"))
+        return boost::none;
+
+      std::vector<PointLL> lls;
+      for (const auto* locations : {&request.options.locations(), &request.options.sources(),
+                                    &request.options.targets(), &request.options.shape()}) {
+        for (const auto& location : *locations)
+          lls.emplace_back(location.ll().lng(), location.ll().lat());
+      }
+      if (!request.options.shape_size() && request.options.has_encoded_polyline()) {
+        auto shape = midgard::decode<std::vector<PointLL> >(request.options.encoded_polyline());
+        lls.insert(lls.end(), shape.begin(), shape.end());
+      }
+      if (lls.empty())
+        return boost::none;
+
+      // Locations are correlated within at most the max radius, whoever answers needs those tiles
+      const auto* owner = shards->Owner(lls, max_radius);
+      if (!owner)
+        owner = shards->fallback();
+      if (!owner)
+        throw valhalla_exception_t{173};
+      if (owner == &shards->self())
+        return boost::none;
+
+      // Hand it on marked as handed on, so that it is answered there no matter how that region
+      // sees the shards, and pass back whatever comes back
+      rapidjson::Document document;
+      document.CopyFrom(request.document, document.GetAllocator());
+      document.AddMember("shard", rapidjson::Value(owner->name, document.GetAllocator()), document.GetAllocator());
+      long http_code = 0;
+      std::string content_type;
+      std::vector<char> body;
+      try {
+        body = shard_curler->post(owner->url + path, http_code, content_type, rapidjson::to_string(document));
+      }
+      catch(const std::exception&) {
+        http_code = 0;
+      }
+      if (http_code == 0)
+        throw valhalla_exception_t{174, "'" + owner->name + "'"};
+      LOG_INFO("Handed Loki Request " + std::to_string(info.id) + " on to shard " + owner->name);
+      return to_response_proxied(http_code, content_type, std::string(body.begin(), body.end()), info);
+    }
+
     void loki_worker_t::limits(valhalla_request_t& request) const {
       for(auto& location : *request.options.mutable_locations()) {
         if(location.minimum_reachability() > max_reachability)
@@ -211,17 +284,25 @@ namespace valhalla {
       try{
         //request parsing
         auto http_request = http_request_t::from_string(static_cast<const char*>(job.front().data()), job.front().size());
+        if(http_request.path == "/metrics")
+          return to_response_metrics(info);
         request.parse(http_request);
+        stage_trace_t span("loki", request.options, trace_sample_rate);
 
         //check there is a valid action
         if(!request.options.has_action())
           return jsonify_error({106, action_str}, info, request);
 
+        //requests for another region go to the cluster holding it
+        auto dispatched = dispatch(request, http_request.path, info);
+        if(dispatched)
+          return *dispatched;
+
         //enforce some limits
         limits(request);
 
         // Set the interrupt function
-        service_worker_t::set_interrupt(interrupt_function);
+        service_worker_t::set_interrupt(interrupt_function, request.options.deadline());
 
         worker_t::result_t result{true};
         //do request specific processing
@@ -229,7 +310,7 @@ namespace valhalla {
           case odin::DirectionsOptions::route:
             route(request);
             result.messages.emplace_back(rapidjson::to_string(request.document));
-            result.messages.emplace_back(request.options.SerializeAsString());
+            result.messages.emplace_back(span.forward(request.options));
             break;
           case odin::DirectionsOptions::locate:
             result = to_response_json(locate(request), info, request);
@@ -238,18 +319,18 @@ namespace valhalla {
           case odin::DirectionsOptions::optimized_route:
             matrix(request);
             result.messages.emplace_back(rapidjson::to_string(request.document));
-            result.messages.emplace_back(request.options.SerializeAsString());
+            result.messages.emplace_back(span.forward(request.options));
             break;
           case odin::DirectionsOptions::isochrone:
             isochrones(request);
             result.messages.emplace_back(rapidjson::to_string(request.document));
-            result.messages.emplace_back(request.options.SerializeAsString());
+            result.messages.emplace_back(span.forward(request.options));
             break;
           case odin::DirectionsOptions::trace_attributes:
           case odin::DirectionsOptions::trace_route:
             trace(request);
             result.messages.emplace_back(rapidjson::to_string(request.document));
-            result.messages.emplace_back(request.options.SerializeAsString());
+            result.messages.emplace_back(span.forward(request.options));
             break;
           case odin::DirectionsOptions::height:
             result = to_response_json(height(request), info, request);
@@ -295,6 +376,9 @@ namespace valhalla {
       auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
       auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
 
+      //compress what this stage sends back to the clients that take it
+      configure_compression(config.get_child("httpd.service"));
+
       //listen for requests
       zmq::context_t context;
       loki_worker_t loki_worker(config);
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "meili/batch_matcher.h"
+
+namespace valhalla {
+namespace meili {
+
+BatchMatcher::BatchMatcher(const boost::property_tree::ptree& config,
+                           const uint32_t thread_count) {
+  // The threads can't share a graph reader but they can share its tiles
+  auto shared = config;
+  if (!shared.get<bool>("mjolnir.global_synchronized_cache", false)) {
+    shared.put("mjolnir.global_sharded_cache", true);
+  }
+  uint32_t count = thread_count ? thread_count :
+                   std::max(1u, std::thread::hardware_concurrency());
+  for (uint32_t i = 0; i < count; ++i) {
+    factories_.emplace_back(new MapMatcherFactory(shared));
+  }
+}
+
+BatchMatcher::~BatchMatcher() {
+}
+
+void BatchMatcher::Run(const boost::property_tree::ptree& preferences,
+                       const size_t count, const job_t& job) {
+  std::atomic<size_t> next(0);
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  // Each thread takes the next trace until there are none left
+  const auto work = [&](MapMatcherFactory& factory) {
+    std::shared_ptr<MapMatcher> matcher;
+    std::string create_error;
+    try {
+      matcher.reset(factory.Create(preferences));
+    } catch (const std::exception& e) {
+      create_error = e.what();
+    }
+
+    for (size_t i = next++; i < count; i = next++) {
+      try {
+        job(i, matcher, create_error);
+      } catch (...) {
+        // Stop everyone, keeping the first failure
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+        return;
+      }
+      // Check if we are overcommitted on either cache and clear if needed
+      if (matcher) {
+        factory.ClearFullCache();
+      }
+    }
+  };
+
+  size_t thread_count = std::max<size_t>(1, std::min(factories_.size(), count));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(work, std::ref(*factories_[i]));
+  }
+  work(*factories_.front());
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void BatchMatcher::Match(const boost::property_tree::ptree& preferences,
+                         const std::vector<std::vector<Measurement> >& traces,
+                         const callback_t& callback, const uint32_t k) {
+  // Hand each result back as soon as it is matched, one at a time and
+  // none after the callback failed
+  std::mutex callback_mutex;
+  bool failed = false;
+  Run(preferences, traces.size(), [&](size_t i, const std::shared_ptr<MapMatcher>& matcher,
+                                      const std::string& create_error) {
+    TraceResult result{i, {}, create_error};
+    if (matcher) {
+      try {
+        result.results = matcher->OfflineMatch(traces[i], k);
+      } catch (const std::exception& e) {
+        result.error = e.what();
+      }
+    }
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    if (failed) {
+      return;
+    }
+    try {
+      callback(std::move(result));
+    } catch (...) {
+      failed = true;
+      throw;
+    }
+  });
+}
+
+std::vector<BatchMatcher::TraceResult> BatchMatcher::Match(
+    const boost::property_tree::ptree& preferences,
+    const std::vector<std::vector<Measurement> >& traces, const uint32_t k) {
+  std::vector<TraceResult> results(traces.size());
+  Match(preferences, traces, [&results](TraceResult&& result) {
+    results[result.index] = std::move(result);
+  }, k);
+  return results;
+}
+
+}
+}
@@ -2,6 +2,104 @@
 #include "meili/candidate_search.h"
 #include "meili/geometry_helpers.h"
 
+namespace {
+
+using namespace valhalla;
+
+// Projects onto the shapes of the edges decoding them
+struct ShapeProjector {
+  ShapeProjector(const midgard::PointLL& location)
+      : approximator(location) {}
+
+  const baldr::GraphId& edgeid(const baldr::GraphId& edgeid) const {
+    return edgeid;
+  }
+
+  bool operator()(const baldr::GraphId& edgeid, const baldr::GraphTile* tile,
+                  const baldr::DirectedEdge* edge, const midgard::PointLL& location,
+                  midgard::PointLL& point, float& sq_distance, float& offset) const {
+    // NOTE a pointer to edgeinfo is needed here because it returns
+    // an unique ptr
+    const auto edgeinfo = tile->edgeinfo(edge->edgeinfo_offset());
+    const auto& shape = edgeinfo.shape();
+    if (shape.empty()) {
+      // Otherwise Project will fail
+      return false;
+    }
+    std::tie(point, sq_distance, std::ignore, offset) = meili::helpers::Project(location, shape, approximator);
+    return true;
+  }
+
+  midgard::DistanceApproximator approximator;
+};
+
+// Projects onto the segments of the edges kept in the bins, a batch of
+// segments at a time
+struct SegmentProjector {
+  SegmentProjector(const midgard::PointLL& location)
+      : approximator(location) {}
+
+  const baldr::GraphId& edgeid(const meili::CandidateGridQuery::edge_ref_t& ref) const {
+    return ref.edgeid;
+  }
+
+  float DistanceSquared(const midgard::PointLL&, const float lng, const float lat) const {
+    return approximator.DistanceSquared(midgard::PointLL(lng, lat));
+  }
+
+  bool operator()(const meili::CandidateGridQuery::edge_ref_t& ref, const baldr::GraphTile*,
+                  const baldr::DirectedEdge*, const midgard::PointLL& location,
+                  midgard::PointLL& point, float& sq_distance, float& offset) {
+    const auto& bin = *ref.bin;
+    const auto first = bin.first_segment[ref.index];
+    const auto count = bin.first_segment[ref.index + 1] - first;
+    x.resize(count);
+    y.resize(count);
+    sq_distances.resize(count);
+    approximator.Project(&bin.ux[first], &bin.uy[first], &bin.vx[first], &bin.vy[first], count,
+                         x.data(), y.data(), sq_distances.data());
+
+    // The closest one, the first of them if tied
+    point = {bin.ux[first], bin.uy[first]};
+    sq_distance = DistanceSquared(location, point.first, point.second);
+    uint32_t segment = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      if (sq_distances[i] < sq_distance) {
+        point = {x[i], y[i]};
+        sq_distance = sq_distances[i];
+        segment = i;
+      }
+    }
+
+    // Offset is a float between 0 and 1 representing the location of
+    // the closest point on LineString to the given Point, as a fraction
+    // of total 2d line length.
+    const auto total_length = bin.lengths[ref.index];
+    const auto partial_length = bin.partial_lengths[first + segment] +
+        midgard::PointLL(bin.ux[first + segment], bin.uy[first + segment]).Distance(point);
+    offset = total_length > 0.f ? static_cast<float>(partial_length / total_length) : 0.f;
+    offset = std::max(0.f, std::min(offset, 1.f));
+
+    // Snap to the ends of the shape
+    if (total_length * offset <= 0.f) {
+      point = {bin.ux[first], bin.uy[first]};
+      sq_distance = DistanceSquared(location, point.first, point.second);
+      offset = 0.f;
+    } else if (total_length * (1.f - offset) <= 0.f) {
+      const auto last = first + count - 1;
+      point = {bin.vx[last], bin.vy[last]};
+      sq_distance = DistanceSquared(location, point.first, point.second);
+      offset = 1.f;
+    }
+    return true;
+  }
+
+  midgard::DistanceApproximator approximator;
+  std::vector<float> x, y, sq_distances;
+};
+
+}
+
 namespace valhalla {
 
 namespace meili {
@@ -32,14 +130,33 @@ CandidateQuery::WithinSquaredDistance(const midgard::PointLL& location,
                                       edgeid_iterator_t edgeid_begin,
                                       edgeid_iterator_t edgeid_end,
                                       sif::EdgeFilter edgefilter) const
+{
+  ShapeProjector projector(location);
+  return WithinSquaredDistance(location, sq_search_radius, edgeid_begin, edgeid_end, edgefilter, projector);
+}
+
+template std::vector<baldr::PathLocation>
+CandidateQuery::WithinSquaredDistance(const midgard::PointLL&, float,
+                                      std::vector<baldr::GraphId>::const_iterator,
+                                      std::vector<baldr::GraphId>::const_iterator,
+                                      sif::EdgeFilter) const;
+
+
+template <typename item_iterator_t, typename projector_t>
+std::vector<baldr::PathLocation>
+CandidateQuery::WithinSquaredDistance(const midgard::PointLL& location,
+                                      float sq_search_radius,
+                                      item_iterator_t item_begin,
+                                      item_iterator_t item_end,
+                                      sif::EdgeFilter edgefilter,
+                                      projector_t& projector) const
 {
   std::vector<baldr::PathLocation> candidates;
   std::unordered_set<baldr::GraphId> visited_nodes;
-  DistanceApproximator approximator(location);
   const baldr::GraphTile* tile = nullptr;
 
-  for (auto it = edgeid_begin; it != edgeid_end; it++) {
-    const auto& edgeid = *it;
+  for (auto it = item_begin; it != item_end; it++) {
+    const auto& edgeid = projector.edgeid(*it);
     if (!edgeid.Is_Valid()) continue;
 
     // Get the edge and its opposing edge. Transition edges are not
@@ -52,19 +169,9 @@ CandidateQuery::WithinSquaredDistance(const midgard::PointLL& location,
     const auto edge = reader_.directededge(edgeid, tile);
     if (!edge) continue;
 
-    // NOTE a pointer to edgeinfo is needed here because it returns
-    // an unique ptr
-    const auto edgeinfo = tile->edgeinfo(edge->edgeinfo_offset());
-    const auto& shape = edgeinfo.shape();
-    if (shape.empty()) {
-      // Otherwise Project will fail
-      continue;
-    }
-
     // Projection information
     midgard::PointLL point;
     float sq_distance = 0.f;
-    decltype(shape.size()) segment;
     float offset;
 
     baldr::GraphId snapped_node;
@@ -72,10 +179,15 @@ CandidateQuery::WithinSquaredDistance(const midgard::PointLL& location,
 
     // For avoiding recomputing projection later
     const bool edge_included = !edgefilter || edgefilter(edge) != 0.f;
+    bool oppedge_included = !edgefilter || edgefilter(opp_edge) != 0.f;
 
-    if (edge_included) {
-      std::tie(point, sq_distance, segment, offset) = helpers::Project(location, shape, approximator);
+    // Project once for both of them, skipping edges without shape
+    if (!(edge_included || oppedge_included) ||
+        !projector(*it, tile, edge, location, point, sq_distance, offset)) {
+      continue;
+    }
 
+    if (edge_included) {
       if (sq_distance <= sq_search_radius) {
         const float dist = edge->forward()? offset : 1.f - offset;
         if (dist == 1.f) {
@@ -87,13 +199,8 @@ CandidateQuery::WithinSquaredDistance(const midgard::PointLL& location,
       }
     }
 
-    bool oppedge_included = !edgefilter || edgefilter(opp_edge) != 0.f;
-
     // Correlate its opp edge
     if (oppedge_included) {
-      if (!edge_included) {
-        std::tie(point, sq_distance, segment, offset) = helpers::Project(location, shape, approximator);
-      }
       if (sq_distance <= sq_search_radius) {
         const float dist = opp_edge->forward()? offset : 1.f - offset;
         if (dist == 1.f) {
@@ -118,67 +225,44 @@ CandidateQuery::WithinSquaredDistance(const midgard::PointLL& location,
 }
 
 
-// Add each road linestring's line segments into grid. Only one side
-// of directed edges is added
-void IndexBin(const baldr::GraphTile& tile, const int32_t bin_index,
-               baldr::GraphReader& reader, CandidateGridQuery::grid_t& grid)
-{
-  // Get the edges within the specified bin.
-  auto edge_ids = tile.GetBin(bin_index);
-  for(const auto& edge_id : edge_ids) {
-    // Get the right tile (edges in a bin can be in a different tile if they
-    // pass through the tile but do not start or end in the tile). Skip if
-    // tile is null.
-    const auto* bin_tile = edge_id.tileid() == tile.header()->graphid().tileid() ?
-                  &tile : reader.GetGraphTile(edge_id);
-    if(bin_tile == nullptr) continue;
-
-    // Get the edge shape and add to grid. Use lazy_shape to avoid allocations
-    // NOTE: bins do not contain transition edges and transit connection edges
-    auto shape = bin_tile->edgeinfo(
-        bin_tile->directededge(edge_id)->edgeinfo_offset()).lazy_shape();
-    if (!shape.empty()) {
-      PointLL v = shape.pop();
-      while (!shape.empty()) {
-        const PointLL u = v;
-        v = shape.pop();
-        grid.AddLineSegment(edge_id, {u, v});
-      }
-    }
-  }
-}
-
-
 CandidateGridQuery::CandidateGridQuery(baldr::GraphReader& reader, float cell_width, float cell_height)
     : CandidateQuery(reader),
-      cell_width_(cell_width),
-      cell_height_(cell_height),
       grid_cache_() {
   bin_level_ = baldr::TileHierarchy::levels().rbegin()->second.level;
+
+  // Cells along each side of a bin as near as possible to the given size
+  const auto bin_size = baldr::TileHierarchy::levels().rbegin()->second.tiles.SubdivisionSize();
+  divisions_ = std::max(1.f, std::round(bin_size / std::min(cell_width, cell_height)));
 }
 
 
 CandidateGridQuery::~CandidateGridQuery() {}
 
 
-inline const CandidateGridQuery::grid_t*
+inline const baldr::SegmentIndex::Bin*
 CandidateGridQuery::GetGrid(const int32_t bin_id, const Tiles<PointLL>& tiles,
                             const Tiles<PointLL>& bins) const
 {
   // Check if the bin is in the cache
   const auto it = grid_cache_.find(bin_id);
   if (it != grid_cache_.end()) {
-    return &(it->second);
+    return it->second;
   }
 
-  // Not in the cache. Get the tile and Index the bin within the tile.
+  // Not in the cache. Get the tile and the segment index of its bins,
+  // which is only built by the first to ask for it
   int32_t ndiv = tiles.nsubdivisions();
   auto rc = bins.GetRowColumn(bin_id);
   int32_t tile_id = tiles.TileId(rc.second / ndiv, rc.first / ndiv);
   baldr::GraphId tileid(tile_id, bin_level_, 0);
-  auto tile = reader_.GetGraphTile(tileid);
-  if (!tile) {
-    return nullptr;
+  auto& index = indexes_[tileid];
+  if (!index) {
+    auto tile = reader_.GetGraphTile(tileid);
+    if (!tile) {
+      indexes_.erase(tileid);
+      return nullptr;
+    }
+    index = reader_.GetSegmentIndex(tile, divisions_);
   }
 
   // Compute bin index within the tile (row-ordered)
@@ -186,14 +270,13 @@ CandidateGridQuery::GetGrid(const int32_t bin_id, const Tiles<PointLL>& tiles,
   int32_t bin_col = rc.second % ndiv;
   int32_t bin_index = (bin_row * ndiv) + bin_col;
 
-  // Insert the bin into the cache and index the bin
-  const auto inserted = grid_cache_.emplace(bin_id,
-          grid_t(tile->BoundingBox(), cell_width_, cell_height_));
-  IndexBin(*tile, bin_index, reader_, inserted.first->second);
-  return &(inserted.first->second);
+  // Insert the bin into the cache
+  const auto* bin = &index->bin(bin_index);
+  grid_cache_.emplace(bin_id, bin);
+  return bin;
 }
 
-std::unordered_set<baldr::GraphId>
+std::vector<CandidateGridQuery::edge_ref_t>
 CandidateGridQuery::RangeQuery(const AABB2<midgard::PointLL>& range) const
 {
   // Get the tiles object from the tile hierarchy and create the bin tiles
@@ -206,14 +289,26 @@ CandidateGridQuery::RangeQuery(const AABB2<midgard::PointLL>& range) const
   auto bin_list = bins.TileList(range);
 
   // Iterate through the bins and query grids to get results
-  std::unordered_set<baldr::GraphId> result;
+  std::vector<edge_ref_t> result;
+  std::vector<uint32_t> indexes;
   for (auto bin_id : bin_list) {
-    auto grid = GetGrid(bin_id, tiles, bins);
-    if (grid) {
-      const auto set = grid->Query(range);
-      result.insert(set.begin(), set.end());
+    auto bin = GetGrid(bin_id, tiles, bins);
+    if (bin) {
+      indexes.clear();
+      bin->Query(range, indexes);
+      for (const auto index : indexes) {
+        result.push_back({bin->edgeids[index], bin, index});
+      }
     }
   }
+
+  // Edges crossing several bins are found in each of them
+  std::sort(result.begin(), result.end(), [](const edge_ref_t& a, const edge_ref_t& b) {
+    return a.edgeid < b.edgeid;
+  });
+  result.erase(std::unique(result.begin(), result.end(), [](const edge_ref_t& a, const edge_ref_t& b) {
+    return a.edgeid == b.edgeid;
+  }), result.end());
   return result;
 }
 
@@ -228,9 +323,10 @@ CandidateGridQuery::Query(const midgard::PointLL& location,
   }
 
   const auto range = midgard::ExpandMeters(location, std::sqrt(sq_search_radius));
-  const auto edgeids = RangeQuery(range);
+  const auto edges = RangeQuery(range);
+  SegmentProjector projector(location);
   return WithinSquaredDistance(location, sq_search_radius,
-                               edgeids.begin(), edgeids.end(), filter);
+                               edges.begin(), edges.end(), filter, projector);
 }
 
 }
@@ -14,6 +14,9 @@ using namespace valhalla::meili;
 
 constexpr float MAX_ACCUMULATED_COST = 99999999;
 
+// How many paths through the states are looked at for each alternative match
+constexpr uint32_t kPathsPerAlternative = 4;
+
 inline float
 GreatCircleDistanceSquared(const Measurement& left,
                            const Measurement& right)
@@ -29,6 +32,22 @@ ClockDistance(const Measurement& left, const Measurement& right)
 { return right.epoch_time() < 0 || left.epoch_time() < 0 ?
     -1 : right.epoch_time() - left.epoch_time(); }
 
+// Whether every measurement strictly between first and last lies within the
+// tolerance of the straight line from first to last
+inline bool
+Collinear(std::vector<Measurement>::const_iterator first,
+          std::vector<Measurement>::const_iterator last,
+          float sq_tolerance)
+{
+  for (auto m = std::next(first); m != last; ++m) {
+    const auto projected = m->lnglat().Project(first->lnglat(), last->lnglat());
+    if (sq_tolerance < m->lnglat().DistanceSquared(projected)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 struct Interpolation {
   midgard::PointLL projected;
   baldr::GraphId edgeid;
@@ -205,16 +224,11 @@ InterpolateMeasurements(
 // state
 MatchResult
 FindMatchResult(const MapMatcher& mapmatcher,
-                const std::vector<StateId>& stateids,
+                const StateId& prev_stateid,
+                const StateId& stateid,
+                const StateId& next_stateid,
                 StateId::Time time)
 {
-  if (!(time < stateids.size())) {
-    throw std::runtime_error("reading stateid at time out of bounds");
-  }
-
-  const auto& prev_stateid = 0 < time ? stateids[time - 1] : StateId(),
-                   stateid = stateids[time],
-              next_stateid = time + 1 < stateids.size() ? stateids[time + 1] : StateId();
   const auto& measurement = mapmatcher.state_container().measurement(time);
 
   if (!stateid.IsValid()) {
@@ -260,6 +274,22 @@ FindMatchResult(const MapMatcher& mapmatcher,
   return {edge.projected, std::sqrt(edge.distance), edgeid, edge.percent_along, measurement.epoch_time(), stateid};
 }
 
+MatchResult
+FindMatchResult(const MapMatcher& mapmatcher,
+                const std::vector<StateId>& stateids,
+                StateId::Time time)
+{
+  if (!(time < stateids.size())) {
+    throw std::runtime_error("reading stateid at time out of bounds");
+  }
+
+  return FindMatchResult(mapmatcher,
+                         0 < time ? stateids[time - 1] : StateId(),
+                         stateids[time],
+                         time + 1 < stateids.size() ? stateids[time + 1] : StateId(),
+                         time);
+}
+
 
 // Find the corresponding match results of a list of states
 std::vector<MatchResult>
@@ -274,29 +304,6 @@ FindMatchResults(const MapMatcher& mapmatcher, const std::vector<StateId>& state
   return results;
 }
 
-struct path_t{
-  path_t(const std::vector<EdgeSegment>& segments) {
-    edges.reserve(segments.size());
-    for(const auto& segment : segments)
-      if(edges.empty() || edges.back() != segment.edgeid)
-        edges.push_back(segment.edgeid);
-    e1 = segments.empty() || segments.front().source < 1.0f ? edges.cbegin() : edges.cbegin() + 1;
-    e2 = segments.empty() || segments.back().target > 0.0f ? edges.cend() : edges.cend() - 1;
-  }
-  bool operator!=(const path_t& p) const {
-    return std::search(e1, e2, p.e1, p.e2) == e2 && std::search(p.e1, p.e2, e1, e2) == p.e2;
-  }
-  bool crosses(const baldr::PathLocation& candidate) const {
-    for(const auto& edge: candidate.edges)
-      if(std::find(edges.cbegin(), edges.cend(), edge.id) != edges.cend())
-        return true;
-    return false;
-  }
-  std::vector<uint64_t> edges;
-  std::vector<uint64_t>::const_iterator e1;
-  std::vector<uint64_t>::const_iterator e2;
-};
-
 }
 
 namespace valhalla {
@@ -328,7 +335,10 @@ MapMatcher::MapMatcher(
           container_,
           mode_costing_,
           travelmode_,
-          config_)
+          config_),
+      online_time_(0),
+      online_stateid_(),
+      online_result_()
 {
   vs_.set_emission_cost_model(emission_cost_model_);
   vs_.set_transition_cost_model(transition_cost_model_);
@@ -344,191 +354,10 @@ void MapMatcher::Clear()
   vs_.set_transition_cost_model(transition_cost_model_);
   ts_.Clear();
   container_.Clear();
+  online_time_ = 0;
+  online_stateid_ = StateId();
 }
 
-void MapMatcher::RemoveRedundancies(const std::vector<StateId>& result)
-{
-  if (result.empty()) {
-    return;
-  }
-  // For each pair of states in the last sequence of states
-  for(auto left_state_id_itr = result.cbegin(); left_state_id_itr != result.cend() - 1; ++left_state_id_itr) {
-    // Get all the paths that use the left winner
-    auto time = left_state_id_itr->time();
-    auto left_used_candidate = container_.state(*left_state_id_itr);
-    std::unordered_map<StateId, path_t> paths_from_winner;
-    for(const auto& right_candidate : container_.column(time + 1)) {
-      std::vector<EdgeSegment> edges;
-      if(!ts_.IsRemoved(right_candidate.stateid()) && MergeRoute(edges, left_used_candidate, right_candidate))
-        paths_from_winner.emplace(right_candidate.stateid(), std::move(edges));
-    }
-/*
-    std::cout << std::endl << "Paths from left winner:" << std::endl;
-    for(const auto& kv:paths_from_winner) {
-      std::cout << R"({"type":"FeatureCollection","features":[)";
-      std::cout << container_.geojson(left_used_candidate) << ',' << container_.geojson(kv.first) << R"(]})" << std::endl;
-    }
-*/
-    // For each candidate of the left state that isnt the winner
-    std::unordered_set<StateId> right_uniques;
-    std::unordered_set<StateId> redundancies;
-    for(const auto& left_unused_candidate : container_.column(time)) {
-      // We cant remove candidates that were used in the result or already removed
-      if(left_used_candidate.stateid() == left_unused_candidate.stateid() || ts_.IsRemoved(left_unused_candidate.stateid()))
-        continue;
-
-      // If we didnt compute the paths from this loser we need to do it now
-      if(!left_unused_candidate.routed())
-        vs_.transition_cost_model()(left_unused_candidate.stateid(), StateId(time + 1, 0));
-
-      // For each candidate in the right state
-      bool found_unique = false;
-     // std::cout << std::endl << "Paths from left loser:" << std::endl;
-      for(const auto& right_candidate : container_.column(time + 1)) {
-/*
-        std::cout << R"({"type":"FeatureCollection","features":[)";
-        std::cout << container_.geojson(left_unused_candidate) << ',' << container_.geojson(right_candidate);
-        std::cout << R"(]})" << std::endl;
-*/
-
-        // If there is no route its not really unique since we dont need discontinuities
-        std::vector<EdgeSegment> edges;
-        if(ts_.IsRemoved(right_candidate.stateid()) || !MergeRoute(edges, left_unused_candidate, right_candidate))
-          continue;
-
-        // This subpath is unique if: there is no path from the winner
-        // or its node to node (no edges) and not on winner path or they dont overlap
-        path_t path_from_loser(std::move(edges));
-        auto path_from_winner = paths_from_winner.find(right_candidate.stateid());
-        if(path_from_winner == paths_from_winner.end() ||
-            (path_from_loser.edges.empty() && !path_from_winner->second.crosses(right_candidate.candidate())) ||
-            path_from_winner->second != path_from_loser) {
-          found_unique = true;
-          right_uniques.emplace(right_candidate.stateid());
-          break;
-        }
-      }
-
-      // We didnt find any unique paths for this left candidate so we need to mark it has useless
-      if(!found_unique)
-        redundancies.emplace(left_unused_candidate.stateid());
-    }
-
-/*
-    if(redundancies.size()) {
-      std::cout << std::endl << "Removing: " << R"({"type":"FeatureCollection","features":[)";
-      std::string fsep = "";
-      for(auto r : redundancies) { std::cout << fsep << container_.geojson(r); fsep = ","; }
-      std::cout << R"(]})" << std::endl;
-    }
-*/
-
-    // Clean up the left hand redundancies
-    for(const auto& r : redundancies) {
-      ts_.RemoveStateId(r);
-      vs_.RemoveStateId(r);
-    }
-
-    // If this was the last state pair we can possibly remove some of the right candidates
-    if(left_state_id_itr == result.cend() - 2) {
-      auto right_state_id = *(left_state_id_itr + 1);
-      // For each right candidate
-      redundancies.clear();
-      for(const auto& right_candidate : container_.column(time + 1)) {
-        // If its not the winner and there are no uniques for this right candidate we can remove it
-        if(right_candidate.stateid() != right_state_id &&
-            right_uniques.find(right_candidate.stateid()) == right_uniques.cend()) {
-          redundancies.emplace(right_candidate.stateid());
-        }
-      }
-
-/*
-      if(redundancies.size()) {
-        std::cout << std::endl << "Removing: " << R"({"type":"FeatureCollection","features":[)";
-        std::string fsep = "";
-        for(auto r : redundancies) { std::cout << fsep << container_.geojson(r); fsep = ","; }
-        std::cout << R"(]})" << std::endl;
-      }
-*/
-
-      // Cleanup the right hand redundancies
-      for(const auto& r : redundancies) {
-        ts_.RemoveStateId(r);
-        vs_.RemoveStateId(r);
-      }
-    }
-  }
-}
-
-// Mark any sub paths (pairs of candidates between two states) that are redundant with this one
-/*void MapMatcher::RemoveRedundancies(const path_t& path, std::vector<StateId>& state_ids) {
-  // For each state pair
-  for(StateId::Time time = 0; time < state_ids.back().time(); ++time) {
-    // For each left candidate
-    for(const auto& lhs : container_.column(time)) {
-      // If we dont have routes from this state
-      if(!lhs.routed())
-        vs_.transition_cost_model()(lhs.stateid(), StateId(time + 1, 0));
-
-      // For each right candidate
-      for(const auto& rhs : container_.column(time + 1)) {
-
-        // If this is the path we already used skip it
-        if(lhs.stateid() == state_ids[time] && rhs.stateid() == state_ids[time + 1])
-          continue;
-
-        // Get the path for this pair of candidates
-        path_t sub_path(MergeRoute(lhs, rhs));
-
-        // If this is redundant if its empty (because we dont want discontinuities in subsequent results
-        // or the first subpath starts the original path or the last subpath ends the original path or
-        // the intermediate subpath is contained within the original path
-        if(sub_path.edges.empty() ||
-           (time == state_ids.front().time() && sub_path.start_of(path)) ||
-           (time == state_ids.back().time() - 1 && sub_path.end_of(path)) ||
-           sub_path.within(path)) {
-
-          // Swap out the real candidates for the redundant ones
-          auto lid = lhs.stateid(); std::swap(lid, state_ids[time]);
-          auto rid = rhs.stateid(); std::swap(rid, state_ids[time + 1]);
-
-          std::cout << std::endl << "Removing: ";
-          std::cout << R"({"type":"FeatureCollection","features":[)";
-          std::string fsep = "";
-          for(auto s : state_ids) {
-            std::cout << fsep << container_.geojson(s);
-            fsep = ",";
-          }
-          std::cout << R"(]})" << std::endl;
-
-          // Mark them redundant in searching
-          ts_.RemovePath(state_ids);
-          // Swap back the real candidates for the redundant ones
-          std::swap(lid, state_ids[time]);
-          std::swap(rid, state_ids[time + 1]);
-          // TODO: Mark them so we dont consider them again in another pass
-        }
-        else {
-          auto lid = lhs.stateid(); std::swap(lid, state_ids[time]);
-          auto rid = rhs.stateid(); std::swap(rid, state_ids[time + 1]);
-
-          std::cout << std::endl << "Keeping: ";
-          std::cout << R"({"type":"FeatureCollection","features":[)";
-          std::string fsep = "";
-          for(auto s : state_ids) {
-            std::cout << fsep << container_.geojson(s);
-            fsep = ",";
-          }
-          std::cout << R"(]})" << std::endl;
-
-          std::swap(lid, state_ids[time]);
-          std::swap(rid, state_ids[time + 1]);
-        }
-      }
-    }
-  }
-}*/
-
 std::vector<MatchResults>
 MapMatcher::OfflineMatch(const std::vector<Measurement>& measurements, uint32_t k)
 {
@@ -555,42 +384,9 @@ MapMatcher::OfflineMatch(const std::vector<Measurement>& measurements, uint32_t
   // Separate the measurements we are using for matching from the ones we'll just interpolate
   auto interpolated = AppendMeasurements(measurements);
 
-  //For k paths
-  while(best_paths.size() < k && !found_broken_path) {
-    // Get the states for the kth best path in reversed order then fix the order
-    std::vector<StateId> state_ids;
-    double accumulated_cost = 0.f;
-    while (state_ids.size() < container_.size()) {
-      // Get the time at the last column of states
-      const auto time = container_.size() - state_ids.size() - 1;
-      std::copy(vs_.SearchPath(time, false), vs_.PathEnd(), std::back_inserter(state_ids));
-      const auto& winner = vs_.SearchWinner(time);
-      if (winner.IsValid()) {
-        accumulated_cost += vs_.AccumulatedCost(winner);
-      } else {
-        // TODO need a sane constant cost for invalid state
-        accumulated_cost += MAX_ACCUMULATED_COST;
-        found_broken_path = true;
-      }
-
-      if (state_ids.size() < container_.size()) {
-        found_broken_path = true;
-        // cost for disconnection
-        accumulated_cost += MAX_ACCUMULATED_COST;
-      }
-    }
-
-    // early quit if we found best paths
-    if (!best_paths.empty() && found_broken_path) {
-      break;
-    }
-
-    // Get back the real state ids in order
-    std::vector<StateId> original_state_ids;
-    for(auto s_itr = state_ids.rbegin(); s_itr != state_ids.rend(); ++s_itr) {
-      original_state_ids.push_back(ts_.GetOrigin(*s_itr, *s_itr));
-    }
-
+  // Keeps the match of the states unless there is one along the same route already
+  const auto keep = [this, &interpolated, &best_paths](const std::vector<StateId>& original_state_ids,
+                                                        double accumulated_cost) {
     // Verify that stateids are in correct order
     for (StateId::Time time = 0; time < original_state_ids.size(); time++) {
       if (!original_state_ids[time].IsValid()) {
@@ -632,26 +428,52 @@ MapMatcher::OfflineMatch(const std::vector<Measurement>& measurements, uint32_t
     // We'll keep it if we don't have a duplicate already
     auto found_path = std::find(best_paths.rbegin(), best_paths.rend(), match_results);
     if(found_path == best_paths.rend()) {
-      /*std::cout << "Result: " << best_paths.size() << std::endl;
-      std::cout << R"({"type":"FeatureCollection","features":[)";
-      std::string fsep = "";
-      for(auto s : original_state_ids) {
-        std::cout << fsep << container_.geojson(s);
-        fsep = ",";
-      }
-      std::cout << R"(]})" << std::endl;*/
       best_paths.emplace_back(std::move(match_results));
     }
+  };
+
+  // Get the states for the best path in reversed order then fix the order
+  std::vector<StateId> state_ids;
+  double accumulated_cost = 0.f;
+  while (state_ids.size() < container_.size()) {
+    // Get the time at the last column of states
+    const auto time = container_.size() - state_ids.size() - 1;
+    std::copy(vs_.SearchPath(time, false), vs_.PathEnd(), std::back_inserter(state_ids));
+    const auto& winner = vs_.SearchWinner(time);
+    if (winner.IsValid()) {
+      accumulated_cost += vs_.AccumulatedCost(winner);
+    } else {
+      // TODO need a sane constant cost for invalid state
+      accumulated_cost += MAX_ACCUMULATED_COST;
+      found_broken_path = true;
+    }
 
-    // RemoveRedundancies doesn't work with broken paths yet,
-    // also we want to avoid removing path for the last best path
-    if (!found_broken_path && best_paths.size() < k) {
-      // Remove all the candidates pairs whose paths are redundant with this one
-      RemoveRedundancies(original_state_ids);
-      // Remove this particular sequence of stateids
-      ts_.RemovePath(state_ids);
-      // Prepare for a fresh search in the next search iteration
-      vs_.ClearSearch();
+    if (state_ids.size() < container_.size()) {
+      found_broken_path = true;
+      // cost for disconnection
+      accumulated_cost += MAX_ACCUMULATED_COST;
+    }
+  }
+  std::reverse(state_ids.begin(), state_ids.end());
+  keep(state_ids, accumulated_cost);
+
+  // The alternatives are the next cheapest paths through the same states, which
+  // are all found in one pass. Many of them only differ in where along the same
+  // edges they match so more of them are looked at than are asked for. Broken
+  // paths have no alternatives
+  if (1 < k && !found_broken_path) {
+    std::vector<std::vector<StateId>> columns(container_.size());
+    for (StateId::Time time = 0; time < container_.size(); time++) {
+      for (const auto& state : container_.column(time)) {
+        columns[time].push_back(state.stateid());
+      }
+    }
+    const KBestViterbiSearch kbest(emission_cost_model_, transition_cost_model_);
+    for (const auto& path : kbest.Search(columns, k * kPathsPerAlternative)) {
+      if (k <= best_paths.size()) {
+        break;
+      }
+      keep(path.stateids, path.cost);
     }
   }
 
@@ -663,6 +485,80 @@ MapMatcher::OfflineMatch(const std::vector<Measurement>& measurements, uint32_t
   return best_paths;
 }
 
+std::vector<MatchResult>
+MapMatcher::OnlineMatch(const std::vector<Measurement>& measurements, StateId::Time lag)
+{
+  const float max_search_radius = config_.get<float>("max_search_radius"),
+           sq_max_search_radius = max_search_radius * max_search_radius;
+  for (const auto& measurement : measurements) {
+    AppendMeasurement(measurement, sq_max_search_radius);
+  }
+
+  // Finalize all but the latest lag measurements
+  const auto size = container_.size();
+  return lag < size ? FinalizeOnline(size - lag) : std::vector<MatchResult>{};
+}
+
+MatchResult
+MapMatcher::OnlineWinner()
+{
+  if (container_.size() == 0) {
+    throw std::runtime_error("no measurement has been matched online");
+  }
+
+  // The latest measurement is final already
+  const auto time = container_.size() - 1;
+  if (time < online_time_) {
+    return online_result_;
+  }
+
+  // Its predecessor comes after the discarded states so it is safe to use
+  const auto& stateid = vs_.SearchWinner(time);
+  const auto& prev_stateid = stateid.IsValid() ? vs_.Predecessor(stateid) : StateId();
+  return FindMatchResult(*this, prev_stateid, stateid, StateId(), time);
+}
+
+std::vector<MatchResult>
+MapMatcher::FinalizeOnline(StateId::Time time)
+{
+  if (time <= online_time_) {
+    return {};
+  }
+
+  // Walk back the best path from the latest measurement to the first one
+  // that isn't final, only as far as the lag and the new measurements
+  const auto latest = container_.size() - 1;
+  std::vector<StateId> stateids(latest + 1 - online_time_);
+  auto stateid = vs_.SearchWinner(latest);
+  for (auto t = latest; ; t--) {
+    // Start over from the winner where the path is broken
+    if (!stateid.IsValid()) {
+      stateid = vs_.SearchWinner(t);
+    }
+    stateids[t - online_time_] = stateid;
+    if (t == online_time_) {
+      break;
+    }
+    stateid = stateid.IsValid() ? vs_.Predecessor(stateid) : StateId();
+  }
+
+  // The states earlier than the lag won't change anymore
+  std::vector<MatchResult> results;
+  for (auto t = online_time_; t < time; t++) {
+    const auto& next_stateid = t < latest ? stateids[t + 1 - online_time_] : StateId();
+    results.push_back(FindMatchResult(*this, online_stateid_, stateids[t - online_time_], next_stateid, t));
+    online_stateid_ = stateids[t - online_time_];
+  }
+  online_result_ = results.back();
+  online_time_ = time;
+
+  // The previous final state is the only one before it to still be needed
+  vs_.DiscardBefore(online_time_ - 1);
+  container_.DiscardBefore(online_time_ - 1);
+
+  return results;
+}
+
 std::unordered_map<StateId::Time, std::vector<Measurement>>
 MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements)
 {
@@ -670,6 +566,11 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements)
            sq_max_search_radius = max_search_radius * max_search_radius;
   const float interpolation_distance = config_.get<float>("interpolation_distance"),
            sq_interpolation_distance = interpolation_distance * interpolation_distance;
+  const float breakage_distance = config_.get<float>("breakage_distance"),
+           sq_breakage_distance = breakage_distance * breakage_distance;
+  const float simplification_tolerance = config_.get<float>("simplification_tolerance", 0.f),
+           sq_simplification_tolerance = simplification_tolerance * simplification_tolerance;
+  const float stop_speed = config_.get<float>("stop_speed", 0.f);
   std::unordered_map<StateId::Time, std::vector<Measurement>> interpolated;
 
   // Always match the first measurement
@@ -678,8 +579,33 @@ MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements)
   double interpolated_epoch_time = -1;
   for (auto m = std::next(last); m != measurements.end(); ++m) {
     const auto sq_distance = GreatCircleDistanceSquared(*last, *m);
+    const auto next = std::next(m);
+    bool interpolate = !(sq_interpolation_distance < sq_distance);
+
+    // It has hardly moved away from the last match for the time it took and
+    // isn't moving on either, so it is stopped there and adds nothing the last
+    // match doesn't already say
+    if (!interpolate && 0.f < stop_speed && !(sq_max_search_radius < sq_distance)) {
+      const auto previous = std::prev(m);
+      const auto clock_distance = ClockDistance(*last, *m),
+          previous_clock_distance = ClockDistance(*previous, *m);
+      const auto sq_stop_speed = stop_speed * stop_speed;
+      interpolate = 0 < clock_distance && 0 < previous_clock_distance &&
+          sq_distance < sq_stop_speed * clock_distance * clock_distance &&
+          GreatCircleDistanceSquared(*previous, *m) <
+              sq_stop_speed * previous_clock_distance * previous_clock_distance;
+    }
+
+    // It and the ones before it since the last match are on the straight line
+    // to the next measurement, so the route between those two goes by them
+    // anyway. The line is kept short enough to be routed over in one go
+    if (!interpolate && 0.f < simplification_tolerance && next != measurements.end() &&
+        !(sq_breakage_distance < GreatCircleDistanceSquared(*last, *next))) {
+      interpolate = Collinear(last, next, sq_simplification_tolerance);
+    }
+
     // Always match the last measurement and if its far enough away
-    if (sq_interpolation_distance < sq_distance || std::next(m) == measurements.end()) {
+    if (!interpolate || next == measurements.end()) {
       // If there were interpolated points between these two points with time information
       if (interpolated_epoch_time != -1) {
         // Project the last interpolated point onto the line between the two match points
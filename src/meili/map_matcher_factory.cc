@@ -107,7 +107,11 @@ sif::cost_ptr_t MapMatcherFactory::get_costing(const boost::property_tree::ptree
 void MapMatcherFactory::ClearFullCache()
 {
   if(graphreader_.OverCommitted()) {
-    graphreader_.Clear();
+    graphreader_.Trim();
+  }
+  // The candidates of updated tiles may be gone
+  if (graphreader_.RefreshTiles()) {
+    candidatequery_.Clear();
   }
 
   if (candidatequery_.size() > max_grid_cache_size_) {
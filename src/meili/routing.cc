@@ -15,11 +15,23 @@ namespace valhalla {
 
 namespace meili {
 
-LabelSet::LabelSet(const float max_cost, const float bucket_size) {
+SearchSpace::SearchSpace(const float max_cost, const float bucket_size)
+    : labels(nullptr) {
   const auto edgecost = [this](const uint32_t label) {
-    return labels_[label].sortcost();
+    return (*labels)[label].sortcost();
   };
-  queue_.reset(new baldr::DoubleBucketQueue(0.0f, max_cost, bucket_size, edgecost));
+  queue.reset(new baldr::DoubleBucketQueue(0.0f, max_cost, bucket_size, edgecost));
+}
+
+LabelSet::LabelSet(const float max_cost, const float bucket_size)
+    : LabelSet(std::make_shared<SearchSpace>(max_cost, bucket_size)) {
+}
+
+LabelSet::LabelSet(const search_space_ptr_t& space)
+    : space_(space) {
+  // In case the last search with it didn't get to clean up
+  space_->queue->clear();
+  space_->node_status.clear();
 }
 
 void LabelSet::put(const baldr::GraphId& nodeid, const baldr::GraphId& edgeid,
@@ -33,22 +45,21 @@ void LabelSet::put(const baldr::GraphId& nodeid, const baldr::GraphId& edgeid,
 
   // Find the node Id. If not found, create a new label and push
   // it to the queue
-  const auto it = node_status_.find(nodeid);
-  if (it == node_status_.end()) {
+  const auto status = space_->node_status.find(nodeid);
+  if (!status) {
     const uint32_t idx = labels_.size();
     labels_.emplace_back(nodeid, kInvalidDestination, edgeid, source, target,
               cost, turn_cost, sortcost, predecessor, edge, mode);
-    queue_->add(idx);
-    node_status_.emplace(nodeid, idx);
+    queue().add(idx);
+    space_->node_status.emplace(nodeid, idx);
   } else {
     // Node has been found. Check if there is a lower sortcost than the
     // existing label - if so update priority queue and Label
-    const auto& status = it->second;
-    if (!status.permanent && sortcost < labels_[status.label_idx].sortcost()) {
+    if (!status->permanent && sortcost < labels_[status->label_idx].sortcost()) {
       // Update queue first since it uses the label cost within the decrease
       // method to determine the current bucket.
-      queue_->decrease(status.label_idx, sortcost);
-      labels_[status.label_idx] = { nodeid, kInvalidDestination, edgeid, source,
+      queue().decrease(status->label_idx, sortcost);
+      labels_[status->label_idx] = { nodeid, kInvalidDestination, edgeid, source,
                 target, cost, turn_cost, sortcost, predecessor, edge, mode };
     }
   }
@@ -65,21 +76,20 @@ void LabelSet::put(const uint16_t dest, const baldr::GraphId& edgeid,
   // Find the destination. If not count, create a new label and push it
   // to the queue
   baldr::GraphId inv;
-  const auto it = dest_status_.find(dest);
-  if (it == dest_status_.end()) {
+  const auto status = dest_status(dest);
+  if (!status) {
     const uint32_t idx = labels_.size();
     labels_.emplace_back(inv, dest, edgeid, source, target, cost, turn_cost,
                          sortcost, predecessor, edge, travelmode);
-    queue_->add(idx);
-    dest_status_.emplace(dest, idx);
+    queue().add(idx);
+    dest_status_[dest] = Status(idx);
   } else {
     // Decrease cost of the existing label
-    const auto& status = it->second;
-    if (!status.permanent && sortcost < labels_[status.label_idx].sortcost()) {
+    if (!status->permanent && sortcost < labels_[status->label_idx].sortcost()) {
       // Update queue first since it uses the label cost within the decrease
       // method to determine the current bucket.
-      queue_->decrease(status.label_idx, sortcost);
-      labels_[status.label_idx] = { inv, dest, edgeid, source, target, cost,
+      queue().decrease(status->label_idx, sortcost);
+      labels_[status->label_idx] = { inv, dest, edgeid, source, target, cost,
                  turn_cost, sortcost, predecessor, edge, travelmode };
     }
   }
@@ -88,26 +98,25 @@ void LabelSet::put(const uint16_t dest, const baldr::GraphId& edgeid,
 // Get the next label from the priority queue. Marks the popped label
 // as permanent (best path found).
 uint32_t LabelSet::pop() {
-  const auto idx = queue_->pop();
+  const auto idx = queue().pop();
 
   // Mark the popped label as permanent (optimal)
   if (idx != baldr::kInvalidLabel) {
     const auto& label = labels_[idx];
     if (label.nodeid().Is_Valid()) {
-      const auto it = node_status_.find(label.nodeid());
+      const auto status = space_->node_status.find(label.nodeid());
 
       // When these logic errors happen, go check LabelSet::put
-      if (it == node_status_.end()) {
+      if (!status) {
         // No exception, unless BucketQueue::put was wrong: it said it
         // added but actually failed
         throw std::logic_error("all nodes in the queue should have its status");
       }
-      auto& status = it->second;
-      if (status.label_idx != idx) {
-        throw std::logic_error("the index stored in the node status " + std::to_string(status.label_idx) +
+      if (status->label_idx != idx) {
+        throw std::logic_error("the index stored in the node status " + std::to_string(status->label_idx) +
                                " is not synced up with the index popped from the queue idx = " + std::to_string(idx));
       }
-      if (status.permanent) {
+      if (status->permanent) {
         // For example, if the queue has popped up an index 2, and
         // marked the label at this index as permanent (optimal), then
         // some time later the queue pops up another index 2
@@ -116,24 +125,23 @@ uint32_t LabelSet::pop() {
                                " probably negative costs occurred");
       }
 
-      status.permanent = true;
+      status->permanent = true;
     } else {  // assert(label.dest != kInvalidDestination)
-      const auto it = dest_status_.find(label.dest());
+      const auto status = dest_status(label.dest());
 
-      if (it == dest_status_.end()) {
+      if (!status) {
         throw std::logic_error("all dests in the queue should have its status");
       }
-      auto& status = it->second;
-      if (status.label_idx != idx) {
-        throw std::logic_error("the index stored in the dest status " + std::to_string(status.label_idx) +
+      if (status->label_idx != idx) {
+        throw std::logic_error("the index stored in the dest status " + std::to_string(status->label_idx) +
                                " is not synced up with the index popped from the queue idx = " + std::to_string(idx));
       }
-      if (status.permanent) {
+      if (status->permanent) {
         throw std::logic_error("the principle of optimality is violated during routing,"
                                " probably negative costs occurred");
       }
 
-      status.permanent = true;
+      status->permanent = true;
     }
   }
   return idx;
@@ -327,7 +335,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const midgard::DistanceApproximator& approximator,
                    const float search_radius, sif::cost_ptr_t costing,
                    const Label* edgelabel, const float turn_cost_table[181],
-                   const float max_dist, const float max_time) {
+                   const float max_dist, const float max_time,
+                   const Corridor* corridor) {
   Label label;
   const sif::TravelMode travelmode = costing->travel_mode();
 
@@ -430,8 +439,14 @@ find_shortest_path(baldr::GraphReader& reader,
         if (cost.cost < max_dist && (max_time < 0 || cost.secs < max_time)) {
           const auto end_nodeinfo = endtile->node(directededge->endnode());
           float sortcost = cost.cost + heuristic(end_nodeinfo->latlng());
-          labelset->put(directededge->endnode(), edgeid, 0.0f, 1.0f, cost,
-                 turn_cost, sortcost, label_idx, directededge, travelmode);
+          // The heuristic never overestimates the distance left so no
+          // destination can be reached within max_dist from here if the
+          // sortcost is over it already
+          if (sortcost < max_dist &&
+              (corridor == nullptr || corridor->contains(end_nodeinfo->latlng()))) {
+            labelset->put(directededge->endnode(), edgeid, 0.0f, 1.0f, cost,
+                   turn_cost, sortcost, label_idx, directededge, travelmode);
+          }
         }
       }
     }
@@ -548,14 +563,17 @@ find_shortest_path(baldr::GraphReader& reader,
             if(nodeinfo == nullptr)
               continue;
             float sortcost = cost.cost + heuristic(nodeinfo->latlng());
-            labelset->put(directededge->endnode(), origin_edge.id, origin_edge.percent_along, 1.f,
-                       cost, turn_cost, sortcost, label_idx, directededge, travelmode);
+            if (sortcost < max_dist &&
+                (corridor == nullptr || corridor->contains(nodeinfo->latlng()))) {
+              labelset->put(directededge->endnode(), origin_edge.id, origin_edge.percent_along, 1.f,
+                         cost, turn_cost, sortcost, label_idx, directededge, travelmode);
+            }
           }
         }
       }
     }
   }
-  // TODO - do we need to clear since it is constructed prior to each call??
+  // The queue and the node status may be shared with the next search
   labelset->clear_queue();
   labelset->clear_status();
   return results;
@@ -1,7 +1,7 @@
 #include <algorithm>
 #include <cstdio>
+#include <mutex>
 
-#include <boost/property_tree/json_parser.hpp>
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/util.h"
@@ -10,32 +10,35 @@
 
 namespace {
 
-  boost::property_tree::ptree parse_json(const std::string& json, const std::unordered_set<std::string> customizable, boost::property_tree::ptree& match_config) {
-    boost::property_tree::ptree request;
-    try { std::stringstream stream(json); boost::property_tree::read_json(stream, request); }
-    catch (...) { throw std::runtime_error("Couln't parse json input"); }
+  rapidjson::Document parse_json(const std::string& json, const std::unordered_set<std::string>& customizable, boost::property_tree::ptree& match_config) {
+    rapidjson::Document request;
+    request.Parse(json.c_str());
+    if (request.HasParseError() || !request.IsObject())
+      throw std::runtime_error("Couln't parse json input");
 
     if(customizable.empty())
       return request;
 
-    auto match_options = request.get_child_optional("match_options");
-    if (!match_options)
+    auto match_options = rapidjson::get_child_optional(request, "/match_options");
+    if (!match_options || !match_options->IsObject())
       return request;
 
-    for (const auto& kv : *match_options) {
-      if (customizable.find(kv.first) != customizable.end() && !kv.second.data().empty()){
-        //mode is a string
-        if(kv.first == "mode")
-          match_config.put<std::string>(kv.first, kv.second.data());
-        //anything else is float
-        else {
-          try {
-            match_config.put<float>(kv.first, std::stof(kv.second.data()));
-          }
-          catch (...) {
-            throw std::out_of_range("Invalid argument: " + kv.first + " is out of float range.");
-          }
-        }
+    for (const auto& kv : match_options->GetObject()) {
+      std::string name(kv.name.GetString(), kv.name.GetStringLength());
+      if (customizable.find(name) == customizable.end() || kv.value.IsObject() || kv.value.IsArray() ||
+          kv.value.IsNull() || (kv.value.IsString() && !kv.value.GetStringLength()))
+        continue;
+      //mode is a string
+      if(name == "mode") {
+        if(kv.value.IsString())
+          match_config.put<std::string>(name, kv.value.GetString());
+      }
+      //anything else is float
+      else {
+        auto value = rapidjson::get_optional<float>(kv.value, "");
+        if (!value)
+          throw std::out_of_range("Invalid argument: " + name + " is out of float range.");
+        match_config.put<float>(name, *value);
       }
     }
 
@@ -79,6 +82,7 @@ namespace {
     std::vector<merged_traffic_segment_t> merged;
     const valhalla::baldr::GraphTile* tile = nullptr;
     valhalla::baldr::GraphId edge;
+    std::vector<valhalla::baldr::TrafficSegment> segments;
     for(const auto& marker : markers) {
       //skip if its a repeat or we cant get the tile
       if(marker.edge == edge || !reader.GetGraphTile(marker.edge, tile))
@@ -88,9 +92,9 @@ namespace {
       const auto* directed_edge = tile->directededge(edge);
       //if there were no segments we'll start an invalid one to serve
       //as a placeholder for the section of the path that has no ots's
-      auto segments = tile->GetTrafficSegments(edge);
+      tile->GetTrafficSegments(edge, segments);
       if(segments.empty())
-        segments = { valhalla::baldr::TrafficSegment{{}, 0, 1, true, true} };
+        segments.emplace_back(valhalla::baldr::GraphId{}, 0, 1, true, true);
       //the way id for this edge
       auto way_id = tile->edgeinfo(directed_edge->edgeinfo_offset()).wayid();
       //merge them into single entries per segment id
@@ -160,6 +164,18 @@ std::string TrafficSegmentMatcher::match(const std::string& json) {
   if(measurements.empty())
     return R"({"segments":[]})";
 
+  // Get the segments along the measurements
+  auto traffic_segments = match(matcher, measurements);
+
+  // Check if we are overcommitted on either cache and and clear if needed
+  matcher_factory.ClearFullCache();
+
+  //give back json
+  return serialize(traffic_segments);
+}
+
+std::vector<traffic_segment_t> TrafficSegmentMatcher::match(const std::shared_ptr<MapMatcher>& matcher,
+  const std::vector<Measurement>& measurements) const {
   // Create the matched path results
   auto topk_matches = matcher->OfflineMatch(measurements);
   const auto& match_results = topk_matches.front().results;
@@ -171,13 +187,38 @@ std::string TrafficSegmentMatcher::match(const std::string& json) {
   auto interpolations = interpolate_matches(match_results, edge_segments, matcher);
 
   // Get the segments along the measurements
-  auto traffic_segments = form_segments(interpolations, matcher->graphreader());
-
-  // Check if we are overcommitted on either cache and and clear if needed
-  matcher_factory.ClearFullCache();
+  return form_segments(interpolations, matcher->graphreader());
+}
 
-  //give back json
-  return serialize(traffic_segments);
+void TrafficSegmentMatcher::match(BatchMatcher& batch, const boost::property_tree::ptree& match_config,
+  std::vector<std::vector<Measurement> >& traces, const segments_callback_t& callback) const {
+  // Hand each trace back as soon as it is done, one at a time and none
+  // after the callback failed
+  std::mutex callback_mutex;
+  bool failed = false;
+  batch.Run(match_config, traces.size(), [&](size_t i, const std::shared_ptr<MapMatcher>& matcher,
+                                             const std::string& create_error) {
+    std::vector<traffic_segment_t> traffic_segments;
+    std::string error = create_error;
+    if (matcher) {
+      try {
+        validate_measurements(traces[i]);
+        if (!traces[i].empty())
+          traffic_segments = match(matcher, traces[i]);
+      } catch (const std::exception& e) {
+        error = e.what();
+      }
+    }
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    if (failed)
+      return;
+    try {
+      callback(i, std::move(traffic_segments), error);
+    } catch (...) {
+      failed = true;
+      throw;
+    }
+  });
 }
 
 std::list<std::vector<interpolation_t> > TrafficSegmentMatcher::interpolate_matches(const std::vector<MatchResult>& matches,
@@ -413,26 +454,33 @@ std::vector<traffic_segment_t> TrafficSegmentMatcher::form_segments(const std::l
   return traffic_segments;
 }
 
-std::vector<meili::Measurement> TrafficSegmentMatcher::parse_measurements(const boost::property_tree::ptree request,
+std::vector<meili::Measurement> TrafficSegmentMatcher::parse_measurements(const rapidjson::Value& request,
   float default_accuracy, float default_search_radius) {
   //check for required parameters
-  auto trace_pts = request.get_child_optional("trace");
-  if (!trace_pts)
+  auto trace_pts = rapidjson::get_child_optional(request, "/trace");
+  if (!trace_pts || !trace_pts->IsArray())
     throw std::runtime_error("Missing required json array 'trace'.");
 
   // Populate a measurement sequence to pass to the map matcher
   std::vector<Measurement> measurements;
+  measurements.reserve(trace_pts->Size());
   try {
-    for (const auto& pt : *trace_pts) {
-      double lat = pt.second.get<double>("lat");
-      double lon = pt.second.get<double>("lon");
-      double epoch_time = pt.second.get<double>("time");
-      double accuracy = pt.second.get<double>("accuracy", default_accuracy);
+    for (const auto& pt : trace_pts->GetArray()) {
+      double lat = rapidjson::get<double>(pt, "/lat");
+      double lon = rapidjson::get<double>(pt, "/lon");
+      double epoch_time = rapidjson::get<double>(pt, "/time");
+      double accuracy = rapidjson::get<double>(pt, "/accuracy", default_accuracy);
       measurements.emplace_back(PointLL{lon, lat}, accuracy, default_search_radius, epoch_time);
     }
   }
   catch (...) { throw std::runtime_error("Missing parameters, trace points require lat, lon and time."); }
 
+  validate_measurements(measurements);
+  //done with them
+  return measurements;
+}
+
+void TrafficSegmentMatcher::validate_measurements(std::vector<Measurement>& measurements) {
   //not enough data
   if(measurements.size() < 2)
     throw std::runtime_error("2 or more trace points are required.");
@@ -445,8 +493,39 @@ std::vector<meili::Measurement> TrafficSegmentMatcher::parse_measurements(const
     return &measurements.back() != &m && m.epoch_time() == (&m + 1)->epoch_time();
   });
   measurements.erase(remove_itr, measurements.end());
-  //done with them
-  return measurements;
+}
+
+bool TrafficSegmentMatcher::read_trace(std::istream& in, float default_accuracy, float default_search_radius,
+  uint64_t& trace_id, std::vector<Measurement>& measurements) {
+  probe_trace_t trace;
+  if (!in.read(reinterpret_cast<char*>(&trace), sizeof(trace)))
+    return false;
+
+  //read the points all at once
+  std::vector<probe_point_t> points(trace.point_count);
+  if (!in.read(reinterpret_cast<char*>(points.data()), points.size() * sizeof(probe_point_t)))
+    throw std::runtime_error("Truncated probe input in trace " + std::to_string(trace.trace_id));
+
+  trace_id = trace.trace_id;
+  measurements.clear();
+  measurements.reserve(points.size());
+  for (const auto& point : points) {
+    measurements.emplace_back(PointLL{point.lon, point.lat}, point.accuracy > 0 ? point.accuracy : default_accuracy,
+      default_search_radius, point.time);
+  }
+  return true;
+}
+
+void TrafficSegmentMatcher::write_segments(std::ostream& out, const uint64_t trace_id,
+  const std::vector<traffic_segment_t>& traffic_segments) {
+  std::vector<segment_speed_t> records;
+  records.reserve(traffic_segments.size());
+  for (const auto& seg : traffic_segments) {
+    records.emplace_back(segment_speed_t{trace_id, seg.segment_id.value, seg.start_time, seg.end_time,
+      seg.length, seg.queue_length, static_cast<uint32_t>(seg.begin_shape_index),
+      static_cast<uint32_t>(seg.end_shape_index), seg.internal, 0});
+  }
+  out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(segment_speed_t));
 }
 
 std::string TrafficSegmentMatcher::serialize(const std::vector<traffic_segment_t>& traffic_segments) {
@@ -22,7 +22,8 @@ TransitionCostModel::TransitionCostModel(
     float breakage_distance,
     float max_route_distance_factor,
     float max_route_time_factor,
-    float turn_penalty_factor)
+    float turn_penalty_factor,
+    float corridor_buffer)
     : graphreader_(graphreader),
       vs_(vs),
       ts_(ts),
@@ -35,7 +36,10 @@ TransitionCostModel::TransitionCostModel(
       max_route_distance_factor_(max_route_distance_factor),
       max_route_time_factor_(max_route_time_factor),
       turn_penalty_factor_(turn_penalty_factor),
-      turn_cost_table_{0.f}
+      corridor_buffer_(corridor_buffer),
+      turn_cost_table_{0.f},
+      search_space_(std::make_shared<SearchSpace>(std::ceil(std::max(breakage_distance_, 1.f)))),
+      labels_(0)
 {
   if (beta_ <= 0.f) {
     throw std::invalid_argument("Expect beta to be positive");
@@ -45,6 +49,10 @@ TransitionCostModel::TransitionCostModel(
     throw std::invalid_argument("Expect turn penalty factor to be nonnegative");
   }
 
+  if (corridor_buffer_ < 0.f) {
+    throw std::invalid_argument("Expect corridor buffer to be nonnegative");
+  }
+
   if (0.f < turn_penalty_factor_) {
     for (int i = 0; i <= 180; ++i) {
       turn_cost_table_[i] = turn_penalty_factor_ * std::exp(-i/45.f);
@@ -71,7 +79,8 @@ TransitionCostModel::TransitionCostModel(
           config.get<float>("breakage_distance"),
           config.get<float>("max_route_distance_factor"),
           config.get<float>("max_route_time_factor"),
-          config.get<float>("turn_penalty_factor")) {}
+          config.get<float>("turn_penalty_factor"),
+          config.get<float>("corridor_buffer", 0.f)) {}
 
 float
 TransitionCostModel::operator()(const StateId& lhs, const StateId& rhs) const
@@ -159,7 +168,17 @@ TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) const
     max_route_time = std::ceil(max_route_time);
   }
 
-  labelset_ptr_t labelset = std::make_shared<LabelSet>(max_route_distance);
+  // Keep the search near the segment between the measurements. The buffer
+  // is never smaller than the search radii so every candidate is within it.
+  std::unique_ptr<Corridor> corridor;
+  if (0.f < corridor_buffer_) {
+    float buffer = std::max(corridor_buffer_, std::max(left_measurement.search_radius(),
+                                                       right_measurement.search_radius()));
+    corridor.reset(new Corridor(left_measurement.lnglat(), right_measurement.lnglat(), buffer));
+  }
+
+  // The route is kept with the labels but the search space is reused
+  labelset_ptr_t labelset = std::make_shared<LabelSet>(search_space_);
   const auto& results = find_shortest_path(
       graphreader_,
       locations,
@@ -171,8 +190,10 @@ TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) const
       edgelabel,
       turn_cost_table_,
       max_route_distance,
-      max_route_time);
+      max_route_time,
+      corridor.get());
 
+  labels_ += labelset->size();
   left.SetRoute(unreached_stateids, results, labelset);
 }
 
@@ -11,8 +11,8 @@ namespace meili {
 class UniversalCost : public sif::DynamicCost
 {
  public:
-  UniversalCost(const boost::property_tree::ptree& pt)
-      : DynamicCost(pt, kUniversalTravelMode) {}
+  UniversalCost(const rapidjson::Value& config)
+      : DynamicCost(config, kUniversalTravelMode) {}
 
   bool Allowed(const baldr::DirectedEdge* edge,
                const sif::EdgeLabel& pred,
@@ -73,7 +73,7 @@ class UniversalCost : public sif::DynamicCost
 };
 
 
-sif::cost_ptr_t CreateUniversalCost(const boost::property_tree::ptree& config)
+sif::cost_ptr_t CreateUniversalCost(const rapidjson::Value& config)
 { return std::make_shared<UniversalCost>(config); }
 
 }
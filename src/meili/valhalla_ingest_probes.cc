@@ -0,0 +1,70 @@
+#include <iostream>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "meili/batch_matcher.h"
+#include "meili/traffic_segment_matcher.h"
+
+
+using namespace valhalla::meili;
+
+
+// Matches binary probe traces from stdin to traffic segments, writing the
+// segment speed records of each trace to stdout as soon as it is done
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    std::cerr << "usage: valhalla_ingest_probes CONFIG [THREADS] [BATCH] < PROBES > SEGMENTS" << std::endl;
+    return 1;
+  }
+
+  boost::property_tree::ptree config;
+  boost::property_tree::read_json(argv[1], config);
+  const std::string modename = config.get<std::string>("meili.mode");
+  const uint32_t threads = argc > 2 ? std::stoul(argv[2]) : 0;
+  const size_t batch_size = argc > 3 ? std::stoul(argv[3]) : 10000;
+
+  const auto& meili = config.get_child("meili");
+  const float default_gps_accuracy = meili.get<float>(modename + ".gps_accuracy",
+                                                      meili.get<float>("default.gps_accuracy")),
+             default_search_radius = meili.get<float>(modename + ".search_radius",
+                                                      meili.get<float>("default.search_radius"));
+
+  TrafficSegmentMatcher segment_matcher(config);
+  BatchMatcher batch_matcher(config, threads);
+  boost::property_tree::ptree mode;
+  mode.put("mode", modename);
+
+  // Read a batch of traces at a time so the input can be any size
+  std::ios::sync_with_stdio(false);
+  std::vector<uint64_t> ids;
+  std::vector<std::vector<Measurement> > traces;
+  size_t matched = 0, failed = 0;
+  bool more = true;
+  while (more) {
+    ids.clear();
+    traces.clear();
+    uint64_t trace_id;
+    std::vector<Measurement> measurements;
+    while (traces.size() < batch_size &&
+           (more = TrafficSegmentMatcher::read_trace(std::cin, default_gps_accuracy, default_search_radius,
+                                                     trace_id, measurements))) {
+      ids.push_back(trace_id);
+      traces.emplace_back(std::move(measurements));
+    }
+
+    segment_matcher.match(batch_matcher, mode, traces,
+      [&ids, &matched, &failed](size_t index, std::vector<traffic_segment_t>&& segments, const std::string& error) {
+        if (!error.empty()) {
+          std::cerr << "Trace " << ids[index] << ": " << error << std::endl;
+          failed++;
+          return;
+        }
+        TrafficSegmentMatcher::write_segments(std::cout, ids[index], segments);
+        matched++;
+      });
+  }
+
+  std::cerr << matched << " traces matched, " << failed << " failed" << std::endl;
+  return 0;
+}
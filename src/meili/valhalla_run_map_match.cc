@@ -2,7 +2,7 @@
 #include <boost/property_tree/json_parser.hpp>
 
 #include "meili/measurement.h"
-#include "meili/map_matcher_factory.h"
+#include "meili/batch_matcher.h"
 
 
 using namespace valhalla::meili;
@@ -41,50 +41,53 @@ ReadMeasurements(istream_t& istream, float default_gps_accuracy, float default_s
 int main(int argc, char *argv[])
 {
   if (argc < 2) {
-    std::cout << "usage: map_matching CONFIG" << std::endl;
+    std::cout << "usage: map_matching CONFIG [THREADS]" << std::endl;
     return 1;
   }
 
   boost::property_tree::ptree config;
   boost::property_tree::read_json(argv[1], config);
   const std::string modename = config.get<std::string>("meili.mode");
-
-  MapMatcherFactory matcher_factory(config);
-  auto mapmatcher = matcher_factory.Create(modename);
-
-  const float default_gps_accuracy = mapmatcher->config().get<float>("gps_accuracy"),
-             default_search_radius = mapmatcher->config().get<float>("search_radius");
-
-  size_t index = 0;
+  const uint32_t threads = argc > 2 ? std::stoul(argv[2]) : 1;
+
+  // Read all the sequences up front so they can be matched concurrently
+  const auto& meili = config.get_child("meili");
+  const float default_gps_accuracy = meili.get<float>(modename + ".gps_accuracy",
+                                                      meili.get<float>("default.gps_accuracy")),
+             default_search_radius = meili.get<float>(modename + ".search_radius",
+                                                      meili.get<float>("default.search_radius"));
+  std::vector<std::vector<Measurement> > sequences;
   for (auto measurements = ReadMeasurements(std::cin, default_gps_accuracy, default_search_radius);
        !measurements.empty();
        measurements = ReadMeasurements(std::cin, default_gps_accuracy, default_search_radius)) {
+    sequences.emplace_back(std::move(measurements));
+  }
 
-    // Offline match
-    std::cout << "Sequence " << index++ << std::endl;
-    auto results = mapmatcher->OfflineMatch(measurements).front().results;
+  // Offline match, showing the results of each sequence as it is matched
+  BatchMatcher batch_matcher(config, threads);
+  boost::property_tree::ptree mode;
+  mode.put("mode", modename);
+  batch_matcher.Match(mode, sequences, [&sequences](BatchMatcher::TraceResult&& result) {
+    std::cout << "Sequence " << result.index << std::endl;
+    if (!result.error.empty()) {
+      std::cout << result.error << std::endl << std::endl;
+      return;
+    }
 
     // Show results
     size_t mmt_id = 0, count = 0;
-    for (const auto& result : results) {
-      if (result.HasState()) {
+    for (const auto& match : result.results.front().results) {
+      if (match.HasState()) {
         std::cout << mmt_id << " ";
-        std::cout << result.distance_from << std::endl;
+        std::cout << match.distance_from << std::endl;
         count++;
       }
       mmt_id++;
     }
 
     // Summary
-    std::cout << count << "/" << measurements.size() << std::endl << std::endl;
-
-    // Clean up
-    measurements.clear();
-    matcher_factory.ClearFullCache();
-  }
-
-  delete mapmatcher;
-  matcher_factory.ClearCache();
+    std::cout << count << "/" << sequences[result.index].size() << std::endl << std::endl;
+  });
 
   return 0;
 }
@@ -1,4 +1,7 @@
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
 #include <string>
 
 #include "meili/viterbi_search.h"
@@ -216,10 +219,10 @@ bool ViterbiSearch::AddStateId(const StateId& stateid)
   }
   states_[stateid.time()].push_back(stateid);
 
-  while (unreached_states_.size() <= stateid.time()) {
-    unreached_states_.emplace_back();
+  while (unreached_counts_.size() <= stateid.time()) {
+    unreached_counts_.push_back(0);
   }
-  unreached_states_[stateid.time()].push_back(stateid);
+  unreached_counts_[stateid.time()]++;
 
   return true;
 }
@@ -231,11 +234,11 @@ StateId ViterbiSearch::SearchWinner(StateId::Time time)
     return winner_[time];
   }
 
-  if (unreached_states_.empty()) {
+  if (unreached_counts_.empty()) {
     return {};
   }
 
-  const StateId::Time max_allowed_time = unreached_states_.size() - 1;
+  const StateId::Time max_allowed_time = unreached_counts_.size() - 1;
   const auto target = std::min(time, max_allowed_time);
 
   // Continue last search if possible
@@ -258,21 +261,43 @@ StateId ViterbiSearch::SearchWinner(StateId::Time time)
 StateId
 ViterbiSearch::Predecessor(const StateId& stateid) const
 {
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
+  const auto label = FindScannedLabel(stateid);
+  if (!label) {
+    return {};
+  }
+  // Don't give away the discarded states
+  const auto& predecessor = label->predecessor;
+  if (predecessor.IsValid() && predecessor.time() < discarded_time_) {
     return {};
-  } else {
-    return (it->second).predecessor();
   }
+  return predecessor;
+}
+
+void ViterbiSearch::DiscardBefore(StateId::Time time)
+{
+  time = std::min(time, static_cast<StateId::Time>(states_.size()));
+  for (; discarded_time_ < time; discarded_time_++) {
+    for (const auto& stateid : states_[discarded_time_]) {
+      IViterbiSearch::RemoveStateId(stateid);
+      sparse_scanned_labels_.erase(stateid);
+    }
+    // Swap to actually free the memory of the columns
+    std::vector<StateId>().swap(states_[discarded_time_]);
+    if (discarded_time_ < scanned_labels_.size()) {
+      std::vector<ScannedLabel>().swap(scanned_labels_[discarded_time_]);
+    }
+    unreached_counts_[discarded_time_] = 0;
+  }
+  earliest_time_ = std::max(earliest_time_, discarded_time_);
 }
 
 double ViterbiSearch::AccumulatedCost(const StateId& stateid) const
 {
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
+  const auto label = FindScannedLabel(stateid);
+  if (!label) {
     return -1.f;
   } else {
-    return it->second.costsofar();
+    return label->costsofar;
   }
 }
 
@@ -280,22 +305,69 @@ void ViterbiSearch::Clear()
 {
   IViterbiSearch::Clear();
   states_.clear();
+  discarded_time_ = 0;
   ClearSearch();
 }
 
 void ViterbiSearch::ClearSearch()
 {
-  earliest_time_ = 0;
+  earliest_time_ = discarded_time_;
   queue_.clear();
   scanned_labels_.clear();
+  sparse_scanned_labels_.clear();
   winner_.clear();
-  unreached_states_ = states_;
+  unreached_counts_.resize(states_.size());
+  for (StateId::Time time = 0; time < states_.size(); ++time) {
+    unreached_counts_[time] = states_[time].size();
+  }
+}
+
+const ViterbiSearch::ScannedLabel*
+ViterbiSearch::FindScannedLabel(const StateId& stateid) const
+{
+  const auto time = stateid.time();
+  if (time < scanned_labels_.size() && stateid.id() < scanned_labels_[time].size()) {
+    const auto& label = scanned_labels_[time][stateid.id()];
+    if (0 <= label.costsofar) {
+      return &label;
+    }
+  }
+  if (sparse_scanned_labels_.empty()) {
+    return nullptr;
+  }
+  const auto it = sparse_scanned_labels_.find(stateid);
+  return it == sparse_scanned_labels_.end() ? nullptr : &it->second;
+}
+
+bool ViterbiSearch::Scan(const StateLabel& label)
+{
+  if (FindScannedLabel(label.stateid())) {
+    return false;
+  }
+  const auto& stateid = label.stateid();
+  const auto time = stateid.time();
+  if (scanned_labels_.size() <= time) {
+    scanned_labels_.resize(time + 1);
+  }
+  auto& column = scanned_labels_[time];
+  if (stateid.id() < std::max(column.size(), states_[time].size())) {
+    if (column.size() <= stateid.id()) {
+      column.resize(states_[time].size(), {-1.0, StateId()});
+    }
+    column[stateid.id()] = {label.costsofar(), label.predecessor()};
+  } else {
+    sparse_scanned_labels_.emplace(stateid, ScannedLabel{label.costsofar(), label.predecessor()});
+  }
+  return true;
 }
 
 void ViterbiSearch::InitQueue(const std::vector<StateId>& column)
 {
   queue_.clear();
   for (const auto stateid : column) {
+    if (FindScannedLabel(stateid)) {
+      continue;
+    }
     const auto emission_cost = EmissionCost(stateid);
     if (IsInvalidCost(emission_cost)) {
       continue;
@@ -306,24 +378,27 @@ void ViterbiSearch::InitQueue(const std::vector<StateId>& column)
 
 void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid)
 {
-  if (!(stateid.time() + 1 < unreached_states_.size())) {
+  if (!(stateid.time() + 1 < unreached_counts_.size())) {
     throw std::logic_error("the state at time " + std::to_string(stateid.time()) + " is impossible to have successors");
   }
 
-  const auto it = scanned_labels_.find(stateid);
-  if (it == scanned_labels_.end()) {
+  const auto label = FindScannedLabel(stateid);
+  if (!label) {
     throw std::logic_error("the state must be scanned");
   }
-  const auto costsofar = it->second.costsofar();
+  const auto costsofar = label->costsofar;
   if (IsInvalidCost(costsofar)) {
     // All invalid ones should be filtered out before pushing labels
     // into the queue
     throw std::logic_error("impossible to get invalid cost from scanned labels");
   }
 
-  // Optimal states have been removed from unreached_states_ so no
-  // worry about optimality
-  for (const auto& next_stateid : unreached_states_[stateid.time() + 1]) {
+  // Optimal states are scanned already so no worry about optimality
+  for (const auto& next_stateid : states_[stateid.time() + 1]) {
+    if (FindScannedLabel(next_stateid)) {
+      continue;
+    }
+
     const auto emission_cost = EmissionCost(next_stateid);
     if (IsInvalidCost(emission_cost)) {
       continue;
@@ -345,14 +420,14 @@ void ViterbiSearch::AddSuccessorsToQueue(const StateId& stateid)
 
 StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_new_start)
 {
-  if (unreached_states_.size() <= target) {
-    if (unreached_states_.empty()) {
+  if (unreached_counts_.size() <= target) {
+    if (unreached_counts_.empty()) {
       throw std::runtime_error(
           "empty states: add some states at least before searching");
     } else {
       throw std::runtime_error(
           "the target time is beyond the maximum allowed time "
-          + std::to_string(unreached_states_.size()-1));
+          + std::to_string(unreached_counts_.size()-1));
     }
   }
 
@@ -361,7 +436,7 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
     return target;
   }
 
-  // Clearly here we have precondition: winner_.size() <= target < unreached_states_.size()
+  // Clearly here we have precondition: winner_.size() <= target < unreached_counts_.size()
 
   StateId::Time source;
 
@@ -371,7 +446,7 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
     AddSuccessorsToQueue(winner_[source]);
   } else {
     source = winner_.size();
-    InitQueue(unreached_states_[source]);
+    InitQueue(states_[source]);
   }
 
   // Start with the source time, which will be searched anyhow
@@ -392,25 +467,23 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
     }
 
     // Mark it as scanned and remember its cost and predecessor
-    const auto& inserted = scanned_labels_.emplace(stateid, label);
-    if (!inserted.second) {
+    if (!Scan(label)) {
       throw std::logic_error(
           "the principle of optimality is violated in the viterbi search,"
           " probably negative costs occurred");
     }
 
-    // Remove it from its column
-    auto& column = unreached_states_[stateid.time()];
-    const auto it = std::find(column.begin(), column.end(), stateid);
-    if (it == column.end()) {
+    // Count it out of its column
+    auto& unreached_count = unreached_counts_[stateid.time()];
+    if (unreached_count == 0) {
       throw std::logic_error("the state must exist in the column");
     }
-    column.erase(it);
+    unreached_count--;
 
     // Since current column is empty now, earlier labels can't reach
     // future winners in a optimal way any more, so we mark time + 1
     // as the earliest time to skip all earlier labels
-    if (column.empty()) {
+    if (unreached_count == 0) {
       earliest_time_ = stateid.time() + 1;
     }
 
@@ -452,5 +525,95 @@ StateId::Time ViterbiSearch::IterativeSearch(StateId::Time target, bool request_
   return searched_time;
 }
 
+std::vector<KBestViterbiSearch::Path>
+KBestViterbiSearch::Search(const std::vector<std::vector<StateId>>& columns, uint32_t k) const
+{
+  if (columns.empty() || k == 0) {
+    return {};
+  }
+
+  // A path to a state as the state and the label of the path to its predecessor
+  struct label_t
+  {
+    StateId::Time time;
+    uint32_t ordinal;
+    uint32_t predecessor;
+  };
+  constexpr auto kNoPredecessor = std::numeric_limits<uint32_t>::max();
+  std::vector<label_t> labels;
+  using queue_entry_t = std::pair<double, uint32_t>;
+  std::priority_queue<queue_entry_t, std::vector<queue_entry_t>, std::greater<queue_entry_t>> queue;
+
+  // The states of every column by their place in it
+  std::vector<std::vector<float>> emission_costs(columns.size());
+  std::vector<std::vector<uint32_t>> settled(columns.size());
+  std::vector<std::vector<std::vector<float>>> transition_costs(columns.size());
+  for (StateId::Time time = 0; time < columns.size(); time++) {
+    emission_costs[time].reserve(columns[time].size());
+    for (const auto& stateid : columns[time]) {
+      emission_costs[time].push_back(emission_cost_model_(stateid));
+    }
+    settled[time].resize(columns[time].size(), 0);
+    transition_costs[time].resize(columns[time].size());
+  }
+
+  for (uint32_t ordinal = 0; ordinal < columns.front().size(); ordinal++) {
+    const auto emission_cost = emission_costs.front()[ordinal];
+    if (0.f <= emission_cost) {
+      queue.emplace(emission_cost, labels.size());
+      labels.push_back({0, ordinal, kNoPredecessor});
+    }
+  }
+
+  std::vector<Path> paths;
+  const StateId::Time last_time = columns.size() - 1;
+  while (!queue.empty() && paths.size() < k) {
+    const auto costsofar = queue.top().first;
+    const auto label_idx = queue.top().second;
+    queue.pop();
+    const auto label = labels[label_idx];
+
+    // The state has its k cheapest paths already
+    auto& settled_count = settled[label.time][label.ordinal];
+    if (k <= settled_count) {
+      continue;
+    }
+    settled_count++;
+
+    // A path through all the columns
+    if (label.time == last_time) {
+      Path path{std::vector<StateId>(columns.size()), costsofar};
+      for (auto idx = label_idx; idx != kNoPredecessor; idx = labels[idx].predecessor) {
+        const auto& l = labels[idx];
+        path.stateids[l.time] = columns[l.time][l.ordinal];
+      }
+      paths.push_back(std::move(path));
+      continue;
+    }
+
+    // The transitions from a state are the same for all its paths
+    const auto& next_column = columns[label.time + 1];
+    auto& costs = transition_costs[label.time][label.ordinal];
+    if (costs.empty()) {
+      costs.reserve(next_column.size());
+      const auto& stateid = columns[label.time][label.ordinal];
+      for (uint32_t ordinal = 0; ordinal < next_column.size(); ordinal++) {
+        const auto emission_cost = emission_costs[label.time + 1][ordinal];
+        costs.push_back(0.f <= emission_cost ? transition_cost_model_(stateid, next_column[ordinal]) : -1.f);
+      }
+    }
+
+    for (uint32_t ordinal = 0; ordinal < next_column.size(); ordinal++) {
+      if (costs[ordinal] < 0.f || k <= settled[label.time + 1][ordinal]) {
+        continue;
+      }
+      queue.emplace(costsofar + costs[ordinal] + emission_costs[label.time + 1][ordinal], labels.size());
+      labels.push_back({label.time + 1, ordinal, label_idx});
+    }
+  }
+
+  return paths;
+}
+
 }
 }
@@ -0,0 +1,81 @@
+#include "midgard/compute_slots.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace {
+
+std::mutex slot_mutex;
+std::condition_variable slot_freed;
+size_t slot_count = 0;
+size_t slots_held = 0;
+
+//whether the calling thread holds a slot right now
+thread_local bool holding = false;
+
+void acquire() {
+  std::unique_lock<std::mutex> lock(slot_mutex);
+  slot_freed.wait(lock, []() { return slot_count == 0 || slots_held < slot_count; });
+  ++slots_held;
+  holding = true;
+}
+
+void release() {
+  {
+    std::lock_guard<std::mutex> lock(slot_mutex);
+    --slots_held;
+    holding = false;
+  }
+  slot_freed.notify_one();
+}
+
+}
+
+namespace valhalla {
+namespace midgard {
+namespace compute_slots {
+
+void set_slots(size_t slots) {
+  {
+    std::lock_guard<std::mutex> lock(slot_mutex);
+    slot_count = slots;
+  }
+  slot_freed.notify_all();
+}
+
+size_t slots() {
+  std::lock_guard<std::mutex> lock(slot_mutex);
+  return slot_count;
+}
+
+size_t held() {
+  std::lock_guard<std::mutex> lock(slot_mutex);
+  return slots_held;
+}
+
+ScopedSlot::ScopedSlot() : acquired(false) {
+  //without slots, or if the thread already has one, there is nothing to wait for
+  if(holding || slots() == 0)
+    return;
+  acquire();
+  acquired = true;
+}
+
+ScopedSlot::~ScopedSlot() {
+  if(acquired && holding)
+    release();
+}
+
+ScopedWait::ScopedWait() : released(holding) {
+  if(released)
+    release();
+}
+
+ScopedWait::~ScopedWait() {
+  if(released)
+    acquire();
+}
+
+}
+}
+}
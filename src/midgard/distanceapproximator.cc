@@ -0,0 +1,162 @@
+#include "midgard/distanceapproximator.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace valhalla {
+namespace midgard {
+
+// Approximates the squared distances of a batch of positions to the test point
+void DistanceApproximator::DistanceSquared(const float* lngs, const float* lats,
+                                           const size_t count, float* sq_distances) const {
+  size_t i = 0;
+#if defined(__AVX__)
+  const auto lng = _mm256_set1_ps(centerlng_), lat = _mm256_set1_ps(centerlat_);
+  const auto m_per_lng = _mm256_set1_ps(m_per_lng_degree_), m_per_lat = _mm256_set1_ps(kMetersPerDegreeLat);
+  for (; i + 8 <= count; i += 8) {
+    const auto dy = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(lats + i), lat), m_per_lat);
+    const auto dx = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(lngs + i), lng), m_per_lng);
+    _mm256_storeu_ps(sq_distances + i, _mm256_add_ps(_mm256_mul_ps(dy, dy), _mm256_mul_ps(dx, dx)));
+  }
+#elif defined(__SSE2__)
+  const auto lng = _mm_set1_ps(centerlng_), lat = _mm_set1_ps(centerlat_);
+  const auto m_per_lng = _mm_set1_ps(m_per_lng_degree_), m_per_lat = _mm_set1_ps(kMetersPerDegreeLat);
+  for (; i + 4 <= count; i += 4) {
+    const auto dy = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(lats + i), lat), m_per_lat);
+    const auto dx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(lngs + i), lng), m_per_lng);
+    _mm_storeu_ps(sq_distances + i, _mm_add_ps(_mm_mul_ps(dy, dy), _mm_mul_ps(dx, dx)));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const auto lng = vdupq_n_f32(centerlng_), lat = vdupq_n_f32(centerlat_);
+  const auto m_per_lng = vdupq_n_f32(m_per_lng_degree_), m_per_lat = vdupq_n_f32(kMetersPerDegreeLat);
+  for (; i + 4 <= count; i += 4) {
+    const auto dy = vmulq_f32(vsubq_f32(vld1q_f32(lats + i), lat), m_per_lat);
+    const auto dx = vmulq_f32(vsubq_f32(vld1q_f32(lngs + i), lng), m_per_lng);
+    vst1q_f32(sq_distances + i, vaddq_f32(vmulq_f32(dy, dy), vmulq_f32(dx, dx)));
+  }
+#endif
+  // The rest one at a time
+  for (; i < count; i++) {
+    const auto dy = (lats[i] - centerlat_) * kMetersPerDegreeLat;
+    const auto dx = (lngs[i] - centerlng_) * m_per_lng_degree_;
+    sq_distances[i] = dy * dy + dx * dx;
+  }
+}
+
+// Projects the test point onto a batch of segments, longitude scaled by the
+// cos of the latitude, and approximates the distances to the projections
+void DistanceApproximator::Project(const float* ux, const float* uy, const float* vx,
+                                   const float* vy, const size_t count, float* x, float* y,
+                                   float* sq_distances) const {
+  const PointLL location(centerlng_, centerlat_);
+  const float lon_scale = cosf(centerlat_ * kRadPerDeg);
+  const float m_per_lng_degree = m_per_lng_degree_;
+  size_t i = 0;
+#if defined(__AVX__)
+  const auto px = _mm256_set1_ps(location.first), py = _mm256_set1_ps(location.second);
+  const auto scale_lng = _mm256_set1_ps(lon_scale), m_per_lng = _mm256_set1_ps(m_per_lng_degree);
+  const auto m_per_lat = _mm256_set1_ps(kMetersPerDegreeLat);
+  const auto zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f);
+  for (; i + 8 <= count; i += 8) {
+    const auto u_x = _mm256_loadu_ps(ux + i), u_y = _mm256_loadu_ps(uy + i);
+    const auto v_x = _mm256_loadu_ps(vx + i), v_y = _mm256_loadu_ps(vy + i);
+    const auto bx = _mm256_sub_ps(v_x, u_x), by = _mm256_sub_ps(v_y, u_y);
+    const auto bx2 = _mm256_mul_ps(bx, scale_lng);
+    const auto sq = _mm256_add_ps(_mm256_mul_ps(bx2, bx2), _mm256_mul_ps(by, by));
+    const auto dot = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(px, u_x), scale_lng), bx2),
+                                   _mm256_mul_ps(_mm256_sub_ps(py, u_y), by));
+    const auto scale = _mm256_and_ps(_mm256_cmp_ps(sq, zero, _CMP_GT_OQ), _mm256_div_ps(dot, sq));
+    const auto before = _mm256_cmp_ps(scale, zero, _CMP_LE_OQ), after = _mm256_cmp_ps(scale, one, _CMP_GE_OQ);
+    auto p_x = _mm256_add_ps(_mm256_mul_ps(bx, scale), u_x), p_y = _mm256_add_ps(_mm256_mul_ps(by, scale), u_y);
+    p_x = _mm256_blendv_ps(_mm256_blendv_ps(p_x, v_x, after), u_x, before);
+    p_y = _mm256_blendv_ps(_mm256_blendv_ps(p_y, v_y, after), u_y, before);
+    const auto dy = _mm256_mul_ps(_mm256_sub_ps(p_y, py), m_per_lat);
+    const auto dx = _mm256_mul_ps(_mm256_sub_ps(p_x, px), m_per_lng);
+    _mm256_storeu_ps(x + i, p_x);
+    _mm256_storeu_ps(y + i, p_y);
+    _mm256_storeu_ps(sq_distances + i, _mm256_add_ps(_mm256_mul_ps(dy, dy), _mm256_mul_ps(dx, dx)));
+  }
+#elif defined(__SSE2__)
+  const auto px = _mm_set1_ps(location.first), py = _mm_set1_ps(location.second);
+  const auto scale_lng = _mm_set1_ps(lon_scale), m_per_lng = _mm_set1_ps(m_per_lng_degree);
+  const auto m_per_lat = _mm_set1_ps(kMetersPerDegreeLat);
+  const auto zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+  const auto select = [](const __m128 mask, const __m128 a, const __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  };
+  for (; i + 4 <= count; i += 4) {
+    const auto u_x = _mm_loadu_ps(ux + i), u_y = _mm_loadu_ps(uy + i);
+    const auto v_x = _mm_loadu_ps(vx + i), v_y = _mm_loadu_ps(vy + i);
+    const auto bx = _mm_sub_ps(v_x, u_x), by = _mm_sub_ps(v_y, u_y);
+    const auto bx2 = _mm_mul_ps(bx, scale_lng);
+    const auto sq = _mm_add_ps(_mm_mul_ps(bx2, bx2), _mm_mul_ps(by, by));
+    const auto dot = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_sub_ps(px, u_x), scale_lng), bx2),
+                                _mm_mul_ps(_mm_sub_ps(py, u_y), by));
+    const auto scale = _mm_and_ps(_mm_cmpgt_ps(sq, zero), _mm_div_ps(dot, sq));
+    const auto before = _mm_cmple_ps(scale, zero), after = _mm_cmpge_ps(scale, one);
+    auto p_x = _mm_add_ps(_mm_mul_ps(bx, scale), u_x), p_y = _mm_add_ps(_mm_mul_ps(by, scale), u_y);
+    p_x = select(before, u_x, select(after, v_x, p_x));
+    p_y = select(before, u_y, select(after, v_y, p_y));
+    const auto dy = _mm_mul_ps(_mm_sub_ps(p_y, py), m_per_lat);
+    const auto dx = _mm_mul_ps(_mm_sub_ps(p_x, px), m_per_lng);
+    _mm_storeu_ps(x + i, p_x);
+    _mm_storeu_ps(y + i, p_y);
+    _mm_storeu_ps(sq_distances + i, _mm_add_ps(_mm_mul_ps(dy, dy), _mm_mul_ps(dx, dx)));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const auto px = vdupq_n_f32(location.first), py = vdupq_n_f32(location.second);
+  const auto scale_lng = vdupq_n_f32(lon_scale), m_per_lng = vdupq_n_f32(m_per_lng_degree);
+  const auto m_per_lat = vdupq_n_f32(kMetersPerDegreeLat);
+  const auto zero = vdupq_n_f32(0.f), one = vdupq_n_f32(1.f);
+  for (; i + 4 <= count; i += 4) {
+    const auto u_x = vld1q_f32(ux + i), u_y = vld1q_f32(uy + i);
+    const auto v_x = vld1q_f32(vx + i), v_y = vld1q_f32(vy + i);
+    const auto bx = vsubq_f32(v_x, u_x), by = vsubq_f32(v_y, u_y);
+    const auto bx2 = vmulq_f32(bx, scale_lng);
+    const auto sq = vaddq_f32(vmulq_f32(bx2, bx2), vmulq_f32(by, by));
+    const auto dot = vaddq_f32(vmulq_f32(vmulq_f32(vsubq_f32(px, u_x), scale_lng), bx2),
+                               vmulq_f32(vsubq_f32(py, u_y), by));
+    const auto scale = vbslq_f32(vcgtq_f32(sq, zero), vdivq_f32(dot, sq), zero);
+    const auto before = vcleq_f32(scale, zero), after = vcgeq_f32(scale, one);
+    auto p_x = vaddq_f32(vmulq_f32(bx, scale), u_x), p_y = vaddq_f32(vmulq_f32(by, scale), u_y);
+    p_x = vbslq_f32(before, u_x, vbslq_f32(after, v_x, p_x));
+    p_y = vbslq_f32(before, u_y, vbslq_f32(after, v_y, p_y));
+    const auto dy = vmulq_f32(vsubq_f32(p_y, py), m_per_lat);
+    const auto dx = vmulq_f32(vsubq_f32(p_x, px), m_per_lng);
+    vst1q_f32(x + i, p_x);
+    vst1q_f32(y + i, p_y);
+    vst1q_f32(sq_distances + i, vaddq_f32(vmulq_f32(dy, dy), vmulq_f32(dx, dx)));
+  }
+#endif
+  // The rest one at a time
+  for (; i < count; i++) {
+    auto bx = vx[i] - ux[i];
+    auto by = vy[i] - uy[i];
+    const auto bx2 = bx * lon_scale;
+    const auto sq = bx2 * bx2 + by * by;
+    const auto scale = sq > 0 ? (((location.first - ux[i]) * lon_scale * bx2 + (location.second - uy[i]) * by) / sq) : 0.f;
+    if (scale <= 0.f) {
+      bx = ux[i];
+      by = uy[i];
+    } else if (scale >= 1.f) {
+      bx = vx[i];
+      by = vy[i];
+    } else {
+      bx = bx * scale + ux[i];
+      by = by * scale + uy[i];
+    }
+    const auto dy = (by - location.second) * kMetersPerDegreeLat;
+    const auto dx = (bx - location.first) * m_per_lng_degree;
+    x[i] = bx;
+    y[i] = by;
+    sq_distances[i] = dy * dy + dx * dx;
+  }
+}
+
+}
+}
@@ -7,8 +7,12 @@
 #include "midgard/util.h"
 
 #include <sstream>
+#include <stdexcept>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
 
 namespace valhalla {
 namespace midgard {
@@ -19,17 +23,32 @@ GriddedData<coord_t>::GriddedData(const AABB2<coord_t>& bounds, const float tile
             const float value)
     : Tiles<coord_t>(bounds, tilesize),
       max_value_(value) {
-  // Resize the data vector and fill with the value
-  data_.resize(this->nrows_ * this->ncolumns_);
-  std::fill(data_.begin(), data_.end(), value);
+  // Blocks are allocated the first time one of their tiles is set
+  block_rows_ = (this->nrows_ + kGriddedBlockSize - 1) / kGriddedBlockSize;
+  block_columns_ = (this->ncolumns_ + kGriddedBlockSize - 1) / kGriddedBlockSize;
+  blocks_.resize(block_rows_ * block_columns_);
+}
+
+// Get the value of a tile for writing, allocating its block if need be
+template <class coord_t>
+float& GriddedData<coord_t>::Cell(const int tile_id) {
+  auto& block = blocks_[BlockId(tile_id)];
+  if (block.empty())
+    block.resize(kGriddedBlockSize * kGriddedBlockSize, max_value_);
+  return block[BlockOffset(tile_id)];
 }
 
 // Set the value at a specified coordinate.
 template <class coord_t>
 bool GriddedData<coord_t>::Set(const coord_t& pt, const float value) {
-  auto cell_id = this->TileId(pt);
-  if (cell_id >= 0 && cell_id < data_.size()) {
-    data_[cell_id] = value;
+  return Set(this->TileId(pt), value);
+}
+
+// Set the value at a specified tile Id.
+template <class coord_t>
+bool GriddedData<coord_t>::Set(const int tile_id, const float value) {
+  if (tile_id >= 0 && tile_id < static_cast<int32_t>(this->TileCount())) {
+    Cell(tile_id) = value;
     return true;
   }
   return false;
@@ -38,39 +57,193 @@ bool GriddedData<coord_t>::Set(const coord_t& pt, const float value) {
 // Set the value at a specified coordinate if less than the current value
 template <class coord_t>
 bool GriddedData<coord_t>::SetIfLessThan(const coord_t& pt, const float value) {
-  int32_t cell_id = this->TileId(pt);
-  if (cell_id >= 0 && cell_id < data_.size() && value < data_[cell_id]) {
-      data_[cell_id] = value;
-      return true;
-  }
-  return false;
+  return SetIfLessThan(this->TileId(pt), value);
 }
 
 // Set the value at a specified tile Id if less than the current value
 template <class coord_t>
 bool GriddedData<coord_t>::SetIfLessThan(const int tile_id, const float value) {
-  if (tile_id >= 0 && tile_id < data_.size() && value < data_[tile_id]) {
-      data_[tile_id] = value;
+  // Check before writing so blocks aren't allocated for nothing
+  if (tile_id >= 0 && tile_id < static_cast<int32_t>(this->TileCount()) && value < Value(tile_id)) {
+      Cell(tile_id) = value;
       return true;
   }
   return false;
 }
 
+// Combine the values of another grid over the same tiles
+template <class coord_t>
+void GriddedData<coord_t>::Combine(const GriddedData<coord_t>& other, const bool keep_max) {
+  if (this->nrows_ != other.nrows_ || this->ncolumns_ != other.ncolumns_ ||
+      this->tilesize_ != other.tilesize_ || this->tilebounds_.minx() != other.tilebounds_.minx() ||
+      this->tilebounds_.miny() != other.tilebounds_.miny() || max_value_ != other.max_value_)
+    throw std::invalid_argument("Only grids over the same tiles can be combined");
+
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    auto& block = blocks_[b];
+    const auto& other_block = other.blocks_[b];
+    // A block that was never set has nothing but the initial value
+    if (keep_max) {
+      if (other_block.empty())
+        block.clear();
+      else if (!block.empty())
+        for (size_t i = 0; i < block.size(); ++i)
+          block[i] = std::max(block[i], other_block[i]);
+    }
+    else if (!other_block.empty()) {
+      if (block.empty())
+        block = other_block;
+      else
+        for (size_t i = 0; i < block.size(); ++i)
+          block[i] = std::min(block[i], other_block[i]);
+    }
+  }
+}
+
+// Keep the tiles with a given value in another grid over the same tiles
+template <class coord_t>
+void GriddedData<coord_t>::Mask(const GriddedData<coord_t>& keys, const float key) {
+  if (this->nrows_ != keys.nrows_ || this->ncolumns_ != keys.ncolumns_ ||
+      this->tilesize_ != keys.tilesize_ || this->tilebounds_.minx() != keys.tilebounds_.minx() ||
+      this->tilebounds_.miny() != keys.tilebounds_.miny())
+    throw std::invalid_argument("Only grids over the same tiles can be masked");
+
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    auto& block = blocks_[b];
+    const auto& key_block = keys.blocks_[b];
+    if (block.empty())
+      continue;
+    // A block of keys that was never set has nothing but their initial value
+    if (key_block.empty()) {
+      if (keys.max_value_ != key)
+        block.clear();
+      continue;
+    }
+    bool kept = false;
+    for (size_t i = 0; i < block.size(); ++i) {
+      if (key_block[i] != key)
+        block[i] = max_value_;
+      kept = kept || block[i] != max_value_;
+    }
+    if (!kept)
+      block.clear();
+  }
+}
+
 // Get the array of times
 template <class coord_t>
-const std::vector<float>& GriddedData<coord_t>::data() const {
-  return data_;
+std::vector<float> GriddedData<coord_t>::data() const {
+  std::vector<float> data(this->TileCount());
+  for (int32_t tile_id = 0; tile_id < static_cast<int32_t>(data.size()); ++tile_id)
+    data[tile_id] = Value(tile_id);
+  return data;
+}
+
+// Get the number of blocks that have been allocated
+template <class coord_t>
+size_t GriddedData<coord_t>::allocated_blocks() const {
+  return std::count_if(blocks_.begin(), blocks_.end(),
+    [](const std::vector<float>& block) { return !block.empty(); });
 }
 
 // Generate contour lines from the isotile data.
 // contours is an ordered list of contour interval values
-// Derivation from the C code version of CONREC by Paul Bourke:
-// http://paulbourke.net/papers/conrec/
 template <class coord_t>
 typename GriddedData<coord_t>::contours_t GriddedData<coord_t>::GenerateContours(const std::vector<float>& contour_intervals,
-  const bool rings_only, const float denoise, const float generalize) const {
+  const bool rings_only, const float denoise, const float generalize, const size_t max_threads) const {
   //TODO: sort and validate contour range
 
+  // If the generalization value equals kOptimalGeneralization then set
+  // the generalization factor to 1/4 of the grid size
+  float gen_factor = generalize;
+  if (generalize == kOptimalGeneralization) {
+    gen_factor = this->tilesize_ * 0.125f * kMetersPerDegreeLat;
+  }
+
+  // The intervals don't depend on each other so each thread takes the next
+  // one that nobody has started yet
+  std::vector<std::vector<contour_t> > lines(contour_intervals.size());
+  std::atomic<size_t> next(0);
+  auto trace = [&]() {
+    for (size_t i = next++; i < contour_intervals.size(); i = next++)
+      lines[i] = GenerateContour(contour_intervals[i], rings_only, denoise, gen_factor);
+  };
+  size_t thread_count = max_threads ? max_threads : std::max(1u, std::thread::hardware_concurrency());
+  thread_count = std::min(thread_count, contour_intervals.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(trace);
+  trace();
+  for (auto& thread : threads)
+    thread.join();
+
+  //we need something to hold each iso-line, bigger ones first
+  contours_t contours([](float a, float b){return a > b;});
+  for (size_t i = 0; i < contour_intervals.size(); ++i) {
+    auto& collection = contours[contour_intervals[i]];
+    //if they wanted polygons its all one feature
+    if (rings_only)
+      collection.emplace_back(std::move(lines[i]));
+    //if they just wanted linestrings we need only one per feature
+    else
+      for (auto& linestring : lines[i])
+        collection.push_back({std::move(linestring)});
+  }
+  return contours;
+}
+
+namespace {
+
+// A contour line being traced. Points can be added to either end without
+// moving the rest since the front of the line is kept in reverse in its own
+// vector
+template <class coord_t>
+struct line_t {
+  std::vector<coord_t> head;
+  std::vector<coord_t> tail;
+
+  bool empty() const { return head.empty() && tail.empty(); }
+  size_t size() const { return head.size() + tail.size(); }
+  const coord_t& front() const { return head.empty() ? tail.front() : head.back(); }
+  const coord_t& back() const { return tail.empty() ? head.front() : tail.back(); }
+  void push_front(const coord_t& p) { head.push_back(p); }
+  void push_back(const coord_t& p) { tail.push_back(p); }
+  void reverse() { std::swap(head, tail); }
+
+  // Put another line on the end of this one
+  void append(line_t& other) {
+    tail.insert(tail.end(), other.head.rbegin(), other.head.rend());
+    tail.insert(tail.end(), other.tail.begin(), other.tail.end());
+    other.head.clear();
+    other.tail.clear();
+  }
+
+  // Put another line on the front of this one
+  void prepend(line_t& other) {
+    head.insert(head.end(), other.tail.rbegin(), other.tail.rend());
+    head.insert(head.end(), other.head.begin(), other.head.end());
+    other.head.clear();
+    other.tail.clear();
+  }
+
+  // The points from front to back
+  std::vector<coord_t> flatten() {
+    std::vector<coord_t> line;
+    line.reserve(size());
+    line.insert(line.end(), head.rbegin(), head.rend());
+    line.insert(line.end(), tail.begin(), tail.end());
+    return line;
+  }
+};
+
+}
+
+// Trace the contour lines of one interval.
+// Derivation from the C code version of CONREC by Paul Bourke:
+// http://paulbourke.net/papers/conrec/
+template <class coord_t>
+std::vector<typename GriddedData<coord_t>::contour_t> GriddedData<coord_t>::GenerateContour(const float contour,
+  const bool rings_only, const float denoise, const float gen_factor) const {
   // Values at tile corners and center (0 element is center)
   int sh[5];
   typename coord_t::first_type s[5];               // Values at the tile corners and center
@@ -83,13 +256,10 @@ typename GriddedData<coord_t>::contours_t GriddedData<coord_t>::GenerateContours
                    (s[p2] * tile_corners[p1].y() - s[p1] * tile_corners[p2].y()) / ds);
   };
 
-  //we need something to hold each iso-line, bigger ones first
-  contours_t contours([](float a, float b){return a > b;});
-  for(auto v : contour_intervals) contours[v].emplace_back();
-  //and something to find them quickly
-  using contour_lookup_t = std::unordered_map<coord_t, typename feature_t::iterator>;
-  std::unordered_map<float, contour_lookup_t> lookup(contour_intervals.size());
-  //TODO: preallocate the lookups for each interval
+  //we need something to hold each iso-line, merged ones are left empty
+  std::vector<line_t<coord_t> > lines;
+  //and something to find their ends quickly
+  std::unordered_map<coord_t, size_t> lookup;
 
   int tile_inc[4] = { 0, 1, this->ncolumns_ + 1, this->ncolumns_ };
   int case_value;
@@ -99,244 +269,259 @@ typename GriddedData<coord_t>::contours_t GriddedData<coord_t>::GenerateContours
      { {9,6,7},{5,2,0},{8,0,0} }
    };
 
-  // For each cell, skipping the outer rim since its out of bounds
-  for (int row = 1; row < this->nrows_ - 1; ++row) {
-    for (int col = 1; col < this->ncolumns_ - 1; ++col) {
-      int tileid = this->TileId(col, row);
-      auto cell1 = data_[tileid];
-      auto cell2 = data_[tileid + this->ncolumns_];     // TileId(col,   row+1)];
-      auto cell3 = data_[tileid + 1];                   // TileId(col+1, row)];
-      auto cell4 = data_[tileid + this->ncolumns_ + 1]; // TileId(col+1, row+1)];
-      auto dmin  = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
-      auto dmax  = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
-
-      // Continue if outside the range of contour values
-      if (dmax < contour_intervals.front() || dmin > contour_intervals.back())
-         continue;
-
-      for (auto contour : contour_intervals) {
-        if (contour < dmin || contour > dmax) {
-          continue;
-        }
-        for (int m = 4; m >= 0; m--) {
-          if (m > 0) {
-            int newtileid = tileid + tile_inc[m-1];
-            // Make sure the tile corner value is not set to the max_value
-            // (messes up the intersect method). Set a value slightly above
-            // the contour (e.g. 1 minute higher).
-            // TODO - the value 1 is a bit of a hack.
-            s[m] = (data_[newtileid] < max_value_) ? data_[newtileid] - contour : 1.0f;
-            tile_corners[m] = this->Base(newtileid);
-          } else {
-            s[0]  = 0.25 * (s[1] + s[2] + s[3] + s[4]);
-            tile_corners[0] = this->Center(tileid);
-          }
-          if (s[m] > 0.0f)
-            sh[m] = 1;
-          else if (s[m] < 0.0f)
-            sh[m] = -1;
-          else
-            sh[m] = 0;
-        }
-
-        /*
-         Note: at this stage the relative heights of the corners and the
-         centre are in the h array, and the corresponding coordinates are
-         in the xh and yh arrays. The centre of the box is indexed by 0
-         and the 4 corners by 1 to 4 as shown below.
-         Each triangle is then indexed by the parameter m, and the 3
-         vertices of each triangle are indexed by parameters m1,m2,and m3.
-         It is assumed that the centre of the box is always vertex 2
-         though this is important only when all 3 vertices lie exactly on
-         the same contour level, in which case only the side of the box
-         is drawn.
-            vertex 4 +-------------------+ vertex 3
-                     | \               / |
-                     |   \    m-3    /   |
-                     |     \       /     |
-                     |       \   /       |
-                     |  m=2    X   m=2   |       the centre is vertex 0
-                     |       /   \       |
-                     |     /       \     |
-                     |   /    m=1    \   |
-                     | /               \ |
-            vertex 1 +-------------------+ vertex 2
-        */
-
-        // Scan each triangle in the box
-        coord_t pt1, pt2;
-        for (int m = 1; m <= 4; m++) {
-          int m1 = m;
-          int m2 = 0;
-          int m3 = (m != 4) ? m + 1 : 1;
-          if ((case_value = case_table[sh[m1]+1][sh[m2]+1][sh[m3]+1]) == 0) {
+  // Is the block allocated, blocks outside the grid never are
+  auto allocated = [this](int32_t block_row, int32_t block_col) {
+    return block_row < block_rows_ && block_col < block_columns_ &&
+           !blocks_[block_row * block_columns_ + block_col].empty();
+  };
+
+  // For each block. A cell has corners on the tiles above and to the right
+  // of it so the top row and right column of a block that was never set
+  // are still needed when the blocks next to them were. Cells with all of
+  // their corners in blocks that were never set have no contours
+  for (int32_t block_row = 0; block_row < block_rows_; ++block_row) {
+    for (int32_t block_col = 0; block_col < block_columns_; ++block_col) {
+      bool set = allocated(block_row, block_col);
+      if (!set && !allocated(block_row + 1, block_col) && !allocated(block_row, block_col + 1) &&
+          !allocated(block_row + 1, block_col + 1))
+        continue;
+      int row_begin = block_row * kGriddedBlockSize;
+      int row_end = std::min(row_begin + kGriddedBlockSize, this->nrows_);
+      int col_begin = block_col * kGriddedBlockSize;
+      int col_end = std::min(col_begin + kGriddedBlockSize, this->ncolumns_);
+
+      // For each cell, skipping the outer rim since its out of bounds
+      for (int row = std::max(row_begin, 1); row < std::min(row_end, this->nrows_ - 1); ++row) {
+        for (int col = std::max(col_begin, 1); col < std::min(col_end, this->ncolumns_ - 1); ++col) {
+          if (!set && row != row_end - 1 && col != col_end - 1)
+            continue;
+          int tileid = this->TileId(col, row);
+          auto cell1 = Value(tileid);
+          auto cell2 = Value(tileid + this->ncolumns_);     // TileId(col,   row+1)];
+          auto cell3 = Value(tileid + 1);                   // TileId(col+1, row)];
+          auto cell4 = Value(tileid + this->ncolumns_ + 1); // TileId(col+1, row+1)];
+          auto dmin  = std::min(std::min(cell1, cell2), std::min(cell3, cell4));
+          auto dmax  = std::max(std::max(cell1, cell2), std::max(cell3, cell4));
+
+          // Continue if outside the range of the contour value
+          if (contour < dmin || contour > dmax) {
             continue;
           }
-
-          switch (case_value) {
-          case 1:              // Line between vertices 1 and 2
-            pt1 = tile_corners[m1];
-            pt2 = tile_corners[m2];
-            break;
-          case 2:              // Line between vertices 2 and 3
-            pt1 = tile_corners[m2];
-            pt2 = tile_corners[m3];
-            break;
-          case 3:              // Line between vertices 3 and 1
-            pt1 = tile_corners[m3];
-            pt2 = tile_corners[m1];
-            break;
-          case 4:              // Line between vertex 1 and side 2-3
-            pt1 = tile_corners[m1];
-            pt2 = intersect(m2, m3);
-            break;
-          case 5:              // Line between vertex 2 and side 3-1
-            pt1 = tile_corners[m2];
-            pt2 = intersect(m3, m1);
-            break;
-          case 6:              // Line between vertex 3 and side 1-2
-            pt1 = tile_corners[m3];
-            pt2 = intersect(m1, m2);
-            break;
-          case 7:              // Line between sides 1-2 and 2-3
-            pt1 = intersect(m1, m2);
-            pt2 = intersect(m2, m3);
-          break;
-          case 8:              // Line between sides 2-3 and 3-1
-            pt1 = intersect(m2, m3);
-            pt2 = intersect(m3, m1);
-            break;
-          case 9:              // Line between sides 3-1 and 1-2
-            pt1 = intersect(m3, m1);
-            pt2 = intersect(m1, m2);
-            break;
-          default:
-            break;
+          for (int m = 4; m >= 0; m--) {
+            if (m > 0) {
+              int newtileid = tileid + tile_inc[m-1];
+              // Make sure the tile corner value is not set to the max_value
+              // (messes up the intersect method). Set a value slightly above
+              // the contour (e.g. 1 minute higher).
+              // TODO - the value 1 is a bit of a hack.
+              auto value = Value(newtileid);
+              s[m] = (value < max_value_) ? value - contour : 1.0f;
+              tile_corners[m] = this->Base(newtileid);
+            } else {
+              s[0]  = 0.25 * (s[1] + s[2] + s[3] + s[4]);
+              tile_corners[0] = this->Center(tileid);
+            }
+            if (s[m] > 0.0f)
+              sh[m] = 1;
+            else if (s[m] < 0.0f)
+              sh[m] = -1;
+            else
+              sh[m] = 0;
           }
 
-          //this isnt a segment..
-          if(pt1 == pt2)
-            continue;
+          /*
+           Note: at this stage the relative heights of the corners and the
+           centre are in the h array, and the corresponding coordinates are
+           in the xh and yh arrays. The centre of the box is indexed by 0
+           and the 4 corners by 1 to 4 as shown below.
+           Each triangle is then indexed by the parameter m, and the 3
+           vertices of each triangle are indexed by parameters m1,m2,and m3.
+           It is assumed that the centre of the box is always vertex 2
+           though this is important only when all 3 vertices lie exactly on
+           the same contour level, in which case only the side of the box
+           is drawn.
+              vertex 4 +-------------------+ vertex 3
+                       | \               / |
+                       |   \    m-3    /   |
+                       |     \       /     |
+                       |       \   /       |
+                       |  m=2    X   m=2   |       the centre is vertex 0
+                       |       /   \       |
+                       |     /       \     |
+                       |   /    m=1    \   |
+                       | /               \ |
+              vertex 1 +-------------------+ vertex 2
+          */
+
+          // Scan each triangle in the box
+          coord_t pt1, pt2;
+          for (int m = 1; m <= 4; m++) {
+            int m1 = m;
+            int m2 = 0;
+            int m3 = (m != 4) ? m + 1 : 1;
+            if ((case_value = case_table[sh[m1]+1][sh[m2]+1][sh[m3]+1]) == 0) {
+              continue;
+            }
 
-          //see if we have anything to connect this segment to
-          typename contour_lookup_t::iterator rec_a = lookup[contour].find(pt1);
-          typename contour_lookup_t::iterator rec_b = lookup[contour].find(pt2);
-          if(rec_b != lookup[contour].end()) {
-            std::swap(pt1, pt2);
-            std::swap(rec_a, rec_b);
-          }
+            switch (case_value) {
+            case 1:              // Line between vertices 1 and 2
+              pt1 = tile_corners[m1];
+              pt2 = tile_corners[m2];
+              break;
+            case 2:              // Line between vertices 2 and 3
+              pt1 = tile_corners[m2];
+              pt2 = tile_corners[m3];
+              break;
+            case 3:              // Line between vertices 3 and 1
+              pt1 = tile_corners[m3];
+              pt2 = tile_corners[m1];
+              break;
+            case 4:              // Line between vertex 1 and side 2-3
+              pt1 = tile_corners[m1];
+              pt2 = intersect(m2, m3);
+              break;
+            case 5:              // Line between vertex 2 and side 3-1
+              pt1 = tile_corners[m2];
+              pt2 = intersect(m3, m1);
+              break;
+            case 6:              // Line between vertex 3 and side 1-2
+              pt1 = tile_corners[m3];
+              pt2 = intersect(m1, m2);
+              break;
+            case 7:              // Line between sides 1-2 and 2-3
+              pt1 = intersect(m1, m2);
+              pt2 = intersect(m2, m3);
+            break;
+            case 8:              // Line between sides 2-3 and 3-1
+              pt1 = intersect(m2, m3);
+              pt2 = intersect(m3, m1);
+              break;
+            case 9:              // Line between sides 3-1 and 1-2
+              pt1 = intersect(m3, m1);
+              pt2 = intersect(m1, m2);
+              break;
+            default:
+              break;
+            }
 
-          //we want to merge two records
-          if(rec_b != lookup[contour].end()) {
-            //get the segments in question and remove their lookup info
-            auto segment_a = rec_a->second;
-            bool head_a = rec_a->first == segment_a->front();
-            auto segment_b = rec_b->second;
-            bool head_b = rec_b->first == segment_b->front();
-            lookup[contour].erase(rec_a);
-            lookup[contour].erase(rec_b);
-
-            //this segment is now a ring
-            if(segment_a == segment_b) {
-              segment_a->push_back(segment_a->front());
+            //this isnt a segment..
+            if(pt1 == pt2)
               continue;
+
+            //see if we have anything to connect this segment to
+            auto rec_a = lookup.find(pt1);
+            auto rec_b = lookup.find(pt2);
+            if(rec_b != lookup.end()) {
+              std::swap(pt1, pt2);
+              std::swap(rec_a, rec_b);
             }
 
-            //erase the other lookups
-            lookup[contour].erase(lookup[contour].find(pt1 == segment_a->front() ? segment_a->back() : segment_a->front()));
-            lookup[contour].erase(lookup[contour].find(pt2 == segment_b->front() ? segment_b->back() : segment_b->front()));
-
-            //add b to a
-            if(!head_a && head_b) {
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
-            }//add a to b
-            else if(!head_b && head_a) {
-              segment_b->splice(segment_b->end(), *segment_a);
-              contours[contour].front().erase(segment_a);
-              segment_a = segment_b;
-            }//flip a and add b
-            else if(head_a && head_b) {
-              segment_a->reverse();
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
-            }//flip b and add to a
-            else if(!head_a && !head_b) {
-              segment_b->reverse();
-              segment_a->splice(segment_a->end(), *segment_b);
-              contours[contour].front().erase(segment_b);
+            //we want to merge two records
+            if(rec_b != lookup.end()) {
+              //get the segments in question and remove their lookup info
+              auto segment_a = rec_a->second;
+              bool head_a = rec_a->first == lines[segment_a].front();
+              auto segment_b = rec_b->second;
+              bool head_b = rec_b->first == lines[segment_b].front();
+              lookup.erase(rec_a);
+              lookup.erase(rec_b);
+
+              //this segment is now a ring
+              if(segment_a == segment_b) {
+                lines[segment_a].push_back(lines[segment_a].front());
+                continue;
+              }
+
+              //erase the other lookups
+              auto& a = lines[segment_a];
+              auto& b = lines[segment_b];
+              lookup.erase(pt1 == a.front() ? a.back() : a.front());
+              lookup.erase(pt2 == b.front() ? b.back() : b.front());
+
+              //add b to a or a to b, flipping one of them if their heads or tails meet
+              if(head_a && head_b)
+                a.reverse();
+              else if(!head_a && !head_b)
+                b.reverse();
+              if(head_a && !head_b)
+                std::swap(segment_a, segment_b);
+
+              //then copy the shorter one onto the longer one
+              auto& first = lines[segment_a];
+              auto& second = lines[segment_b];
+              if(first.size() < second.size()) {
+                second.prepend(first);
+                segment_a = segment_b;
+              }
+              else
+                first.append(second);
+
+              //update the look up
+              lookup[lines[segment_a].front()] = segment_a;
+              lookup[lines[segment_a].back()] = segment_a;
+            }//ap/prepend to an existing one
+            else if(rec_a != lookup.end()) {
+              auto segment = rec_a->second;
+              //it goes on the front
+              if(lines[segment].front() == pt1)
+                lines[segment].push_front(pt2);
+              //it goes on the back
+              else
+                lines[segment].push_back(pt2);
+
+              //update the lookup table
+              lookup.erase(rec_a);
+              lookup.emplace(pt2, segment);
+            }//this is an orphan segment for now
+            else {
+              lines.emplace_back();
+              lines.back().push_back(pt1);
+              lines.back().push_back(pt2);
+              lookup.emplace(pt1, lines.size() - 1);
+              lookup.emplace(pt2, lines.size() - 1);
             }
 
-            //update the look up
-            lookup[contour].emplace(segment_a->front(), segment_a);
-            lookup[contour].emplace(segment_a->back(), segment_a);
-          }//ap/prepend to an existing one
-          else if(rec_a != lookup[contour].end()) {
-            //it goes on the front
-            if(rec_a->second->front() == pt1)
-              rec_a->second->push_front(pt2);
-            //it goes on the back
-            else
-              rec_a->second->push_back(pt2);
-
-            //update the lookup table
-            lookup[contour].emplace(pt2, rec_a->second);
-            lookup[contour].erase(rec_a);
-          }//this is an orphan segment for now
-          else {
-            contours[contour].front().push_front(contour_t{pt1, pt2});
-            lookup[contour].emplace(pt1, contours[contour].front().begin());
-            lookup[contour].emplace(pt2, contours[contour].front().begin());
           }
-
-        }
-      } // Each contour
-    } // Each tile col
-  } // Each tile row
-
-  // If the generalization value equals kOptimalGeneralization then set
-  // the generalization factor to 1/4 of the grid size
-  float gen_factor = generalize;
-  if (generalize == kOptimalGeneralization) {
-    gen_factor = this->tilesize_ * 0.125f * kMetersPerDegreeLat;
-  }
+        } // Each tile col
+      } // Each tile row
+    } // Each block col
+  } // Each block row
 
   //some info about the area the image covers
-  auto c = this->TileBounds().Center();
   auto h = this->tilesize_ / 2;
-  //for each contour
-  for(auto& collection : contours) {
-    auto& contour = collection.second.front();
+  //sort them by area (maybe length would be sufficient?) biggest first
+  std::vector<std::pair<typename coord_t::first_type, contour_t> > contours;
+  for (auto& line : lines) {
+    if (line.empty())
+      continue;
+    auto flat = line.flatten();
     //they only wanted rings
-    if(rings_only)
-      contour.remove_if([](const contour_t& line){return line.front() != line.back();});
-    //sort them by area (maybe length would be sufficient?) biggest first
-    std::unordered_map<const contour_t*, typename coord_t::first_type> cache(contour.size());
-    std::for_each(contour.cbegin(), contour.cend(), [&cache](const contour_t& c){cache[&c] = polygon_area(c);});
-    contour.sort([&cache](const contour_t& a, const contour_t& b) {return std::abs(cache[&a]) > std::abs(cache[&b]);});
-    //they only want the most significant ones!
-    if(denoise > 0.f)
-      contour.remove_if([&cache, &contour, denoise](const contour_t& c){return std::abs(cache[&c]/cache[&contour.front()]) < denoise;});
-    //clean up the lines
-    for(auto& line : contour) {
-      //TODO: generalizing makes self intersections which makes other libraries unhappy
-      if(gen_factor > 0.f)
-        Polyline2<coord_t>::Generalize(line, gen_factor);
-      //if this ends up as an inner we'll undo this later
-      if(cache[&line] > 0)
-        line.reverse();
-      //sampling the bottom left corner means everything is skewed, so unskew it
-      for(auto& coord : line) { coord.first += h; coord.second += h; }
-    }
-    //if they just wanted linestrings we need only one per feature
-    if(!rings_only) {
-      for(auto& linestring : contour)
-        collection.second.push_back({std::move(linestring)});
-      collection.second.pop_front();
-    }
+    if (rings_only && flat.front() != flat.back())
+      continue;
+    auto area = polygon_area(flat);
+    contours.emplace_back(area, std::move(flat));
   }
-
-  return contours;
+  std::stable_sort(contours.begin(), contours.end(),
+    [](const std::pair<typename coord_t::first_type, contour_t>& a, const std::pair<typename coord_t::first_type, contour_t>& b) {
+      return std::abs(a.first) > std::abs(b.first);
+    });
+  //they only want the most significant ones!
+  std::vector<contour_t> result;
+  for (auto& c : contours) {
+    if (denoise > 0.f && std::abs(c.first / contours.front().first) < denoise)
+      continue;
+    auto& line = c.second;
+    //TODO: generalizing makes self intersections which makes other libraries unhappy
+    if(gen_factor > 0.f)
+      Polyline2<coord_t>::Generalize(line, gen_factor);
+    //if this ends up as an inner we'll undo this later
+    if(c.first > 0)
+      std::reverse(line.begin(), line.end());
+    //sampling the bottom left corner means everything is skewed, so unskew it
+    for(auto& coord : line) { coord.first += h; coord.second += h; }
+    result.emplace_back(std::move(line));
+  }
+  return result;
 }
 
 // Explicit instantiation
@@ -8,6 +8,10 @@
 #include <chrono>
 #include <ctime>
 #include <cstdlib>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
 
 namespace {
 
@@ -25,21 +29,138 @@ inline std::tm* get_gmtime(const std::time_t* time, std::tm* tm)
 }
 
 //returns formated to: 'year/mo/dy hr:mn:sc.xxxxxx'
+//the date and time down to the minute only change once a minute, each thread
+//keeps them formatted and only formats the seconds
 std::string TimeStamp() {
   //get the time
   std::chrono::system_clock::time_point tp = std::chrono::system_clock::now();
   std::time_t tt = std::chrono::system_clock::to_time_t(tp);
-  std::tm gmt{}; get_gmtime(&tt, &gmt);
-  using sec_t = std::chrono::duration<double>;
+  thread_local std::time_t minute = -1;
+  thread_local char prefix[24];
+  if(tt / 60 != minute) {
+    minute = tt / 60;
+    std::time_t start = minute * 60;
+    std::tm gmt{}; get_gmtime(&start, &gmt);
+    sprintf(prefix, "%04d/%02d/%02d %02d:%02d:", gmt.tm_year + 1900, gmt.tm_mon + 1,
+      gmt.tm_mday, gmt.tm_hour, gmt.tm_min);
+  }
   std::chrono::duration<double> fractional_seconds =
-    (tp - std::chrono::system_clock::from_time_t(tt)) + std::chrono::seconds(gmt.tm_sec);
+    tp - std::chrono::system_clock::from_time_t(minute * 60);
   //format the string
   std::string buffer("year/mo/dy hr:mn:sc.xxxxxx");
-  sprintf(&buffer.front(), "%04d/%02d/%02d %02d:%02d:%09.6f", gmt.tm_year + 1900, gmt.tm_mon + 1,
-    gmt.tm_mday, gmt.tm_hour, gmt.tm_min, fractional_seconds.count());
+  sprintf(&buffer.front(), "%s%09.6f", prefix, fractional_seconds.count());
   return buffer;
 }
 
+//lines a thread logged, written by it and read by the thread writing them out
+//without either of them waiting on a lock
+class LineRing {
+ public:
+  LineRing() : orphaned(false), lines(kSize), head(0), tail(0) {}
+  //takes the line if there is room for it
+  bool Push(std::string& line) {
+    auto h = head.load(std::memory_order_relaxed);
+    if(h - tail.load(std::memory_order_acquire) == kSize)
+      return false;
+    lines[h % kSize].swap(line);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+  //appends all the lines there are so far
+  void Drain(std::string& batch) {
+    auto t = tail.load(std::memory_order_relaxed);
+    auto h = head.load(std::memory_order_acquire);
+    for(; t != h; ++t) {
+      batch.append(lines[t % kSize]);
+      lines[t % kSize].clear();
+    }
+    tail.store(t, std::memory_order_release);
+  }
+  //set once the thread that logs to it is gone
+  std::atomic<bool> orphaned;
+ protected:
+  static constexpr size_t kSize = 1024;
+  std::vector<std::string> lines;
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+};
+constexpr size_t LineRing::kSize;
+
+//writes the lines every thread logged from a thread of its own, a batch at a
+//time, so logging never blocks on the output or on the other threads
+class AsyncWriter {
+ public:
+  using sink_t = std::function<void (const std::string&)>;
+  AsyncWriter(const sink_t& sink) : sink(sink), id(++count), done(false),
+    writer([this]() { Run(); }) {}
+  ~AsyncWriter() {
+    done.store(true, std::memory_order_release);
+    writer.join();
+  }
+  void Write(std::string&& line) {
+    auto& ring = Ring();
+    //only waits if the writer fell a whole ring behind
+    while(!ring.Push(line))
+      std::this_thread::yield();
+  }
+ protected:
+  //the ring of the calling thread, made the first time it logs
+  LineRing& Ring() {
+    struct holder_t {
+      uint64_t id = 0;
+      std::shared_ptr<LineRing> ring;
+      ~holder_t() { if(ring) ring->orphaned.store(true, std::memory_order_release); }
+    };
+    thread_local holder_t holder;
+    if(holder.id != id) {
+      if(holder.ring)
+        holder.ring->orphaned.store(true, std::memory_order_release);
+      holder.ring = std::make_shared<LineRing>();
+      holder.id = id;
+      std::lock_guard<std::mutex> guard(rings_lock);
+      rings.push_back(holder.ring);
+    }
+    return *holder.ring;
+  }
+  void Run() {
+    std::string batch;
+    while(true) {
+      bool stop = done.load(std::memory_order_acquire);
+      batch.clear();
+      {
+        std::lock_guard<std::mutex> guard(rings_lock);
+        for(auto ring = rings.begin(); ring != rings.end();) {
+          //nothing more can come after the thread is gone
+          bool orphaned = (*ring)->orphaned.load(std::memory_order_acquire);
+          (*ring)->Drain(batch);
+          ring = orphaned ? rings.erase(ring) : ring + 1;
+        }
+      }
+      if(!batch.empty()) {
+        try { sink(batch); } catch(...) {}
+      }
+      else if(stop)
+        break;
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  static std::atomic<uint64_t> count;
+  sink_t sink;
+  uint64_t id;
+  std::mutex rings_lock;
+  std::vector<std::shared_ptr<LineRing> > rings;
+  std::atomic<bool> done;
+  std::thread writer;
+};
+std::atomic<uint64_t> AsyncWriter::count(0);
+
+//whether the config asks for the lines to be written asynchronously
+bool IsAsync(const valhalla::midgard::logging::LoggingConfig& config) {
+  auto async = config.find("async");
+  return async != config.end() && async->second == "true";
+}
+
 }
 
 namespace valhalla {
@@ -90,8 +211,24 @@ const std::unordered_map<LogLevel, std::string, EnumHasher> colored
   };
 
 
+//the lowest level a config wants logged
+LogLevel MinLevel(const LoggingConfig& config) {
+  auto level = config.find("level");
+  if(level == config.end())
+    return LogLevel::TRACE;
+  const std::unordered_map<std::string, LogLevel> levels
+    {
+      {"trace", LogLevel::TRACE}, {"debug", LogLevel::DEBUG}, {"info", LogLevel::INFO},
+      {"warn", LogLevel::WARN}, {"error", LogLevel::ERROR}
+    };
+  auto found = levels.find(level->second);
+  if(found == levels.end())
+    throw std::runtime_error(level->second + " is not a valid log level");
+  return found->second;
+}
+
 //logger base class, not pure virtual so you can use as a null logger if you want
-Logger::Logger(const LoggingConfig& config) {};
+Logger::Logger(const LoggingConfig& config) : min_level(MinLevel(config)) {};
 Logger::~Logger() {};
 void Logger::Log(const std::string&, const LogLevel) {};
 void Logger::Log(const std::string&, const std::string&) {};
@@ -102,8 +239,14 @@ bool logger_registered =
 class StdOutLogger : public Logger {
  public:
   StdOutLogger() = delete;
-  StdOutLogger(const LoggingConfig& config) : Logger(config), levels(config.find("color") != config.end() && config.find("color")->second == "true" ? colored : uncolored) {}
+  StdOutLogger(const LoggingConfig& config, std::ostream& out = std::cout) : Logger(config), out(out),
+    levels(config.find("color") != config.end() && config.find("color")->second == "true" ? colored : uncolored) {
+    if(IsAsync(config))
+      writer.reset(new AsyncWriter([this](const std::string& batch) { Write(batch); }));
+  }
   virtual void Log(const std::string& message, const LogLevel level) {
+    if(level < min_level)
+      return;
     Log(message, levels.find(level)->second);
   }
   virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
@@ -113,31 +256,31 @@ class StdOutLogger : public Logger {
     output.append(custom_directive);
     output.append(message);
     output.push_back('\n');
+    if(writer)
+      writer->Write(std::move(output));
+    else
+      Write(output);
+  }
+ protected:
+  void Write(const std::string& output) {
     //cout is thread safe, to avoid multiple threads interleaving on one line
     //though, we make sure to only call the << operator once on std::cout
     //otherwise the << operators from different threads could interleave
     //obviously we dont care if flushes interleave
-    std::cout << output;
-    std::cout.flush();
+    out << output;
+    out.flush();
   }
- protected:
+  std::ostream& out;
   const std::unordered_map<LogLevel, std::string, EnumHasher> levels;
+  //last so it is done writing before the rest goes away
+  std::unique_ptr<AsyncWriter> writer;
 };
 bool std_out_logger_registered =
   RegisterLogger("std_out", [](const LoggingConfig& config){Logger* l = new StdOutLogger(config); return l;});
 
 class StdErrLogger : public StdOutLogger {
-  using StdOutLogger::StdOutLogger;
-  virtual void Log(const std::string& message, const std::string& custom_directive = " [TRACE] ") {
-    std::string output;
-    output.reserve(message.length() + 64);
-    output.append(TimeStamp());
-    output.append(custom_directive);
-    output.append(message);
-    output.push_back('\n');
-    std::cerr << output;
-    std::cerr.flush();
-  }
+ public:
+  StdErrLogger(const LoggingConfig& config) : StdOutLogger(config, std::cerr) {}
 };
 bool std_err_logger_registered =
   RegisterLogger("std_err", [](const LoggingConfig& config){Logger* l = new StdErrLogger(config); return l;});
@@ -169,8 +312,14 @@ class FileLogger : public Logger {
     
     //crack the file open
     ReOpen();
+
+    //write a batch at a time from a thread of its own if asked to
+    if(IsAsync(config))
+      writer.reset(new AsyncWriter([this](const std::string& batch) { Write(batch); }));
   }
   virtual void Log(const std::string& message, const LogLevel level) {
+    if(level < min_level)
+      return;
     Log(message, uncolored.find(level)->second);
   }
   virtual void Log(const std::string& message,  const std::string& custom_directive = " [TRACE] ") {
@@ -180,13 +329,19 @@ class FileLogger : public Logger {
     output.append(custom_directive);
     output.append(message);
     output.push_back('\n');
+    if(writer)
+      writer->Write(std::move(output));
+    else
+      Write(output);
+  }
+ protected:
+  void Write(const std::string& output) {
     lock.lock();
     file << output;
     file.flush();
     lock.unlock();
     ReOpen();
   }
- protected:
   void ReOpen() {
     //TODO: use CLOCK_MONOTONIC_COARSE
     //check if it should be closed and reopened
@@ -210,6 +365,8 @@ class FileLogger : public Logger {
   std::ofstream file;
   std::chrono::seconds reopen_interval;
   std::chrono::system_clock::time_point last_reopen;
+  //last so it is done writing before the rest goes away
+  std::unique_ptr<AsyncWriter> writer;
 };
 bool file_logger_registered =
   RegisterLogger("file", [](const LoggingConfig& config){Logger* l = new FileLogger(config); return l;});
@@ -0,0 +1,155 @@
+#include "midgard/metrics.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+namespace {
+
+using namespace valhalla::midgard::metrics;
+
+constexpr size_t kCounters = static_cast<size_t>(Counter::kCount);
+constexpr size_t kTimers = static_cast<size_t>(Timer::kCount);
+constexpr size_t kGauges = static_cast<size_t>(Gauge::kCount);
+
+//name and help text for each counter and timer, in enum order
+const char* kCounterNames[][2] = {
+  { "valhalla_tile_cache_hits_total", "Graph tile requests satisfied by the tile cache" },
+  { "valhalla_tile_cache_misses_total", "Graph tile requests that had to load the tile" },
+  { "valhalla_edges_labelled_total", "Edge labels created by path algorithms" },
+  { "valhalla_response_cache_hits_total", "Requests answered with a response made for an identical request moments before" },
+  { "valhalla_requests_coalesced_total", "Requests that waited on an identical request in flight instead of being worked on" },
+  { "valhalla_response_cache_evictions_total", "Responses dropped from the response cache for being too old or the cache being full" },
+  { "valhalla_memory_budget_exceeded_total", "Requests stopped for allocating more search memory than the memory budget allows" },
+  { "valhalla_request_memory_bytes_total", "Most search memory each request held at once, summed over the requests" },
+};
+const char* kTimerNames[][2] = {
+  { "valhalla_loki_search_milliseconds", "Time spent correlating locations to the graph" },
+  { "valhalla_thor_path_milliseconds", "Time spent computing best paths" },
+  { "valhalla_thor_trip_path_milliseconds", "Time spent building trip paths" },
+  { "valhalla_odin_directions_milliseconds", "Time spent building directions" },
+  { "valhalla_tyr_serialize_milliseconds", "Time spent serializing responses" },
+};
+const char* kGaugeNames[][2] = {
+  { "valhalla_response_cache_size", "Responses kept in the response cache" },
+  { "valhalla_requests_in_flight", "Distinct requests being worked on that identical requests can wait on" },
+};
+static_assert(sizeof(kCounterNames) / sizeof(kCounterNames[0]) == kCounters, "Every counter needs a name");
+static_assert(sizeof(kTimerNames) / sizeof(kTimerNames[0]) == kTimers, "Every timer needs a name");
+static_assert(sizeof(kTimerSpans) / sizeof(kTimerSpans[0]) == kTimers, "Every timer needs a span name");
+static_assert(sizeof(kGaugeNames) / sizeof(kGaugeNames[0]) == kGauges, "Every gauge needs a name");
+
+//gauges are set by whoever changes what they measure so there is one copy for the process
+std::atomic<int64_t> gauges[kGauges];
+
+//the stats recorded by a single thread. only the owning thread writes to it so
+//increments are a relaxed load and store, the atomics just make scraping safe
+struct shard_t {
+  std::atomic<uint64_t> counters[kCounters];
+  std::atomic<uint64_t> buckets[kTimers][kBucketCount];
+  std::atomic<uint64_t> sums[kTimers]; //microseconds
+  shard_t() {
+    for(auto& c : counters) c.store(0, std::memory_order_relaxed);
+    for(auto& t : buckets) for(auto& b : t) b.store(0, std::memory_order_relaxed);
+    for(auto& s : sums) s.store(0, std::memory_order_relaxed);
+  }
+};
+
+inline void bump(std::atomic<uint64_t>& a, uint64_t value) {
+  a.store(a.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+//all the shards ever made, they are never freed so counts outlive their threads
+std::mutex shards_lock;
+std::vector<shard_t*>& shards() {
+  static std::vector<shard_t*> all;
+  return all;
+}
+
+shard_t& local_shard() {
+  thread_local shard_t* shard = nullptr;
+  if(!shard) {
+    shard = new shard_t();
+    std::lock_guard<std::mutex> lock(shards_lock);
+    shards().push_back(shard);
+  }
+  return *shard;
+}
+
+}
+
+namespace valhalla {
+namespace midgard {
+namespace metrics {
+
+void Add(Counter counter, uint64_t value) {
+  bump(local_shard().counters[static_cast<size_t>(counter)], value);
+}
+
+void Observe(Timer timer, double milliseconds) {
+  auto& shard = local_shard();
+  auto t = static_cast<size_t>(timer);
+  auto bucket = std::lower_bound(std::begin(kBucketBounds), std::end(kBucketBounds), milliseconds) - std::begin(kBucketBounds);
+  bump(shard.buckets[t][bucket], 1);
+  bump(shard.sums[t], static_cast<uint64_t>(std::max(milliseconds, 0.0) * 1000.0 + .5));
+}
+
+void Set(Gauge gauge, int64_t value) {
+  gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+}
+
+std::string ToPrometheus() {
+  //sum up all the threads
+  uint64_t counters[kCounters] = {};
+  uint64_t buckets[kTimers][kBucketCount] = {};
+  uint64_t sums[kTimers] = {};
+  {
+    std::lock_guard<std::mutex> lock(shards_lock);
+    for(const auto* shard : shards()) {
+      for(size_t c = 0; c < kCounters; ++c)
+        counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+      for(size_t t = 0; t < kTimers; ++t) {
+        for(size_t b = 0; b < kBucketCount; ++b)
+          buckets[t][b] += shard->buckets[t][b].load(std::memory_order_relaxed);
+        sums[t] += shard->sums[t].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  //write them out
+  std::ostringstream out;
+  for(size_t c = 0; c < kCounters; ++c) {
+    out << "# HELP " << kCounterNames[c][0] << ' ' << kCounterNames[c][1] << '\n';
+    out << "# TYPE " << kCounterNames[c][0] << " counter\n";
+    out << kCounterNames[c][0] << ' ' << counters[c] << '\n';
+  }
+  for(size_t g = 0; g < kGauges; ++g) {
+    out << "# HELP " << kGaugeNames[g][0] << ' ' << kGaugeNames[g][1] << '\n';
+    out << "# TYPE " << kGaugeNames[g][0] << " gauge\n";
+    out << kGaugeNames[g][0] << ' ' << gauges[g].load(std::memory_order_relaxed) << '\n';
+  }
+  for(size_t t = 0; t < kTimers; ++t) {
+    const auto* name = kTimerNames[t][0];
+    out << "# HELP " << name << ' ' << kTimerNames[t][1] << '\n';
+    out << "# TYPE " << name << " histogram\n";
+    uint64_t cumulative = 0;
+    for(size_t b = 0; b < kBucketCount; ++b) {
+      cumulative += buckets[t][b];
+      out << name << "_bucket{le=\"";
+      if(b < kBucketCount - 1)
+        out << kBucketBounds[b];
+      else
+        out << "+Inf";
+      out << "\"} " << cumulative << '\n';
+    }
+    out << name << "_sum " << sums[t] / 1000.0 << '\n';
+    out << name << "_count " << cumulative << '\n';
+  }
+  return out.str();
+}
+
+}
+}
+}
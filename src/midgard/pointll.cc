@@ -5,6 +5,7 @@
 #include "midgard/vector2.h"
 #include "midgard/logging.h"
 
+#include <algorithm>
 #include <limits>
 #include <cmath>
 #include <list>
@@ -143,52 +144,36 @@ std::tuple<PointLL, float, int> PointLL::ClosestPoint(
   if (process_size == 1)
     return std::make_tuple(pts[begin_index], sqrt(DistanceSquared(pts[begin_index])), begin_index);
 
-  // Longitude (x) is scaled by the cos of the latitude so that distances are
-  // correct in lat,lon space
-  float lon_scale = cosf(lat() * kRadPerDeg);
-
+  // Project onto a batch of segments at a time, longitude (x) scaled by the
+  // cos of the latitude so that distances are correct in lat,lon space
+  constexpr size_t kBatchSize = 64;
+  float ux[kBatchSize], uy[kBatchSize], vx[kBatchSize], vy[kBatchSize];
+  float x[kBatchSize], y[kBatchSize], sq_distances[kBatchSize];
   DistanceApproximator approx(*this);
-  PointLL point;
-  for (size_t index = begin_index; index < pts.size() - 1; ++index) {
-    // Get the current segment
-    const PointLL& u = pts[index];
-    const PointLL& v = pts[index + 1];
-
-    // Project a onto b where b is the origin vector representing this segment
-    // and a is the origin vector to the point we are projecting, (a.b/b.b)*b
-    auto bx = v.lng() - u.lng();
-    auto by = v.lat() - u.lat();
-
-    // Scale longitude when finding the projection. Avoid divided-by-zero
-    // which gives a NaN scale, otherwise comparisons below will fail
-    auto bx2 = bx * lon_scale;
-    auto sq  = bx2 * bx2 + by * by;
-    auto scale = sq > 0 ?  (((lng() - u.lng()) * lon_scale * bx2 +
-                             (lat() - u.lat()) *by) / sq) : 0.f;
-
-    // Projects along the ray before u
-    if (scale <= 0.f) {
-      point = { u.lng(), u.lat() };
-    } // Projects along the ray after v
-    else if (scale >= 1.f) {
-      point = { v.lng(), v.lat() };
-    } // Projects along the ray between u and v
-    else {
-      point = { u.lng() + bx * scale, u.lat() + by * scale };
+  for (size_t first = begin_index; first < pts.size() - 1; first += kBatchSize) {
+    const size_t count = std::min(kBatchSize, pts.size() - 1 - first);
+    for (size_t i = 0; i < count; ++i) {
+      ux[i] = pts[first + i].lng();
+      uy[i] = pts[first + i].lat();
+      vx[i] = pts[first + i + 1].lng();
+      vy[i] = pts[first + i + 1].lat();
     }
+    approx.Project(ux, uy, vx, vy, count, x, y, sq_distances);
+
+    for (size_t i = 0; i < count; ++i) {
+      // Check if this point is better
+      if (sq_distances[i] < mindistsqr) {
+        closest_segment = static_cast<int>(first + i);
+        mindistsqr = sq_distances[i];
+        closest = { x[i], y[i] };
+      }
 
-    // Check if this point is better
-    const auto sq_distance = approx.DistanceSquared(point);
-    if (sq_distance < mindistsqr) {
-      closest_segment = static_cast<int>(index);
-      mindistsqr = sq_distance;
-      closest = std::move(point);
+      // Check if we should bail early because of looking at too much shape
+      if(dist_cutoff != std::numeric_limits<float>::infinity() &&
+          (dist_cutoff -= pts[first + i].Distance(pts[first + i + 1])) < 0)
+        return std::make_tuple(std::move(closest), sqrt(mindistsqr),
+                               closest_segment);
     }
-
-    // Check if we should bail early because of looking at too much shape
-    if(dist_cutoff != std::numeric_limits<float>::infinity() &&
-        (dist_cutoff -= u.Distance(v)) < 0)
-      break;
   }
   return std::make_tuple(std::move(closest), sqrt(mindistsqr),
                          closest_segment);
@@ -1,8 +1,59 @@
 #include "valhalla/midgard/polyline2.h"
+#include "valhalla/midgard/distanceapproximator.h"
 
 #include <vector>
 #include <list>
-#include <functional>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+using namespace valhalla::midgard;
+
+// How much a unit of x and y along a segment is in the units of the
+// generalization tolerance, meters for lat,lng
+template <class coord_t>
+std::pair<float, float> Scales(const coord_t& a, const coord_t& b) {
+  return {1.f, 1.f};
+}
+template <>
+std::pair<float, float> Scales(const PointLL& a, const PointLL& b) {
+  return {DistanceApproximator::MetersPerLngDegree((a.lat() + b.lat()) * 0.5f), kMetersPerDegreeLat};
+}
+
+// Squared distance from points to a segment, set up once per segment so
+// that each point only takes a few multiplies and no square roots
+template <class coord_t>
+class SegmentDistance {
+ public:
+  SegmentDistance(const coord_t& a, const coord_t& b) : a_(a) {
+    std::tie(sx_, sy_) = Scales(a, b);
+    vx_ = (b.first - a.first) * sx_;
+    vy_ = (b.second - a.second) * sy_;
+    vv_ = vx_ * vx_ + vy_ * vy_;
+  }
+  float operator()(const coord_t& p) const {
+    float px = (p.first - a_.first) * sx_;
+    float py = (p.second - a_.second) * sy_;
+    float n = px * vx_ + py * vy_;
+    // before the start or past the end of the segment
+    if (n <= 0.f)
+      return px * px + py * py;
+    if (n >= vv_) {
+      px -= vx_;
+      py -= vy_;
+      return px * px + py * py;
+    }
+    // off to the side of it
+    float c = px * vy_ - py * vx_;
+    return c * c / vv_;
+  }
+ private:
+  coord_t a_;
+  float sx_, sy_, vx_, vy_, vv_;
+};
+
+}
 
 namespace valhalla {
 namespace midgard {
@@ -87,20 +138,37 @@ Polyline2<coord_t> Polyline2<coord_t>::GeneralizedPolyline(const float t) {
 template <class coord_t>
 template <class container_t>
 void Polyline2<coord_t>::Generalize(container_t& polyline, float epsilon) {
+  //nothing to simplify
+  if(polyline.size() < 3)
+    return;
 
-  //the recursive bit
+  //marks what to keep so that erasing doesn't move the points out from under
+  //the iterators of vectors, the ranges still to look at are on a stack
+  //rather than the call stack. both are kept from one call to the next
   epsilon *= epsilon;
-  std::function<void (typename container_t::iterator, typename container_t::iterator)> peucker;
-  peucker = [&peucker, &polyline, epsilon](typename container_t::iterator start, typename container_t::iterator end) {
+  using point_t = std::pair<typename container_t::iterator, size_t>;
+  thread_local std::vector<bool> keep;
+  thread_local std::vector<std::pair<point_t, point_t> > ranges;
+  keep.assign(polyline.size(), false);
+  keep.front() = keep.back() = true;
+  ranges.clear();
+  ranges.emplace_back(point_t{polyline.begin(), 0}, point_t{std::prev(polyline.end()), polyline.size() - 1});
+  while(!ranges.empty()) {
+    auto start = ranges.back().first;
+    auto end = ranges.back().second;
+    ranges.pop_back();
+    if(end.second - start.second < 2)
+      continue;
+
     //find the point furthest from the line
     float dmax = 0.f;
-    typename container_t::iterator itr;
-    LineSegment2<coord_t> l{*start, *end};
-    coord_t tmp;
-    for(auto i = std::next(start); i != end; ++i) {
-      auto d = l.DistanceSquared(*i, tmp);
-      if(d > dmax) {
-        itr = i;
+    point_t furthest;
+    SegmentDistance<coord_t> distance(*start.first, *end.first);
+    size_t index = start.second + 1;
+    for(auto i = std::next(start.first); i != end.first; ++i, ++index) {
+      auto d = distance(*i);
+      if(d > dmax || index == start.second + 1) {
+        furthest = {i, index};
         dmax = d;
       }
     }
@@ -108,15 +176,23 @@ void Polyline2<coord_t>::Generalize(container_t& polyline, float epsilon) {
     //there are some high frequency details between start and end
     //so we need to look for flatter sections between them
     if(dmax >= epsilon) {
-        peucker(start, itr);
-        peucker(itr, end);
-    }//nothing sticks out between start and end so simplify it away
-    else
-      polyline.erase(std::next(start), end);
-  };
-
-  //recurse!
-  peucker(polyline.begin(), std::prev(polyline.end()));
+      keep[furthest.second] = true;
+      ranges.emplace_back(start, furthest);
+      ranges.emplace_back(furthest, end);
+    }//nothing sticks out between start and end so it gets simplified away
+  }
+
+  //move what we kept to the front and drop the rest
+  auto out = polyline.begin();
+  size_t index = 0;
+  for(auto in = polyline.begin(); in != polyline.end(); ++in, ++index) {
+    if(keep[index]) {
+      if(out != in)
+        *out = std::move(*in);
+      ++out;
+    }
+  }
+  polyline.erase(out, polyline.end());
 }
 
 // Clip this polyline to the specified bounding box.
@@ -2,6 +2,7 @@
 #include "midgard/polyline2.h"
 #include "midgard/util.h"
 #include "midgard/distanceapproximator.h"
+#include <algorithm>
 #include <cmath>
 #include <set>
 
@@ -388,10 +389,23 @@ void Tiles<coord_t>::ColorMap(std::unordered_map<uint32_t,
 template <class coord_t>
 template <class container_t>
 std::unordered_map<int32_t, std::unordered_set<unsigned short> > Tiles<coord_t>::Intersect(const container_t& linestring) const {
+  std::vector<std::pair<int32_t, unsigned short> > cells;
+  Intersect(linestring, cells);
+
+  //group the sub cells by their tile
   std::unordered_map<int32_t, std::unordered_set<unsigned short> > intersection;
+  for(const auto& cell : cells)
+    intersection[cell.first].insert(cell.second);
+  return intersection;
+}
+
+template <class coord_t>
+template <class container_t>
+void Tiles<coord_t>::Intersect(const container_t& linestring, std::vector<std::pair<int32_t, unsigned short> >& cells) const {
+  cells.clear();
 
   //what to do when we want to mark a subdivision as containing a segment of this linestring
-  const auto set_pixel = [this, &intersection](int32_t x, int32_t y) {
+  const auto set_pixel = [this, &cells](int32_t x, int32_t y) {
     //cant mark ones that are outside the valid range of tiles
     //TODO: wrap coordinates around x and y?
     if(x < 0 || y < 0 || x >= nsubdivisions_ * ncolumns_ || y >= nsubdivisions_ * nrows_)
@@ -400,9 +414,10 @@ std::unordered_map<int32_t, std::unordered_set<unsigned short> > Tiles<coord_t>:
     int32_t tile_column = x / nsubdivisions_;
     int32_t tile_row = y / nsubdivisions_;
     int32_t tile = tile_row * ncolumns_ + tile_column;
-    //find the subdivision
+    //find the subdivision, consecutive segments often mark the same one
     unsigned short subdivision = (y % nsubdivisions_) * nsubdivisions_ + (x % nsubdivisions_);
-    intersection[tile].insert(subdivision);
+    if(cells.empty() || cells.back().first != tile || cells.back().second != subdivision)
+      cells.emplace_back(tile, subdivision);
     return false;
   };
 
@@ -426,7 +441,7 @@ std::unordered_map<int32_t, std::unordered_set<unsigned short> > Tiles<coord_t>:
     if(vi != line.cend())
       v = *vi;
     else if(line.size() > 1)
-      return intersection;
+      break;
     ui = vi;
 
     //figure out global subdivision start and end points
@@ -447,8 +462,9 @@ std::unordered_map<int32_t, std::unordered_set<unsigned short> > Tiles<coord_t>:
     else { bresenham_line(x0, y0, x1, y1, set_pixel); }
   }
 
-  //give them back
-  return intersection;
+  //give them back sorted and without duplicates
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
 }
 
 template <class coord_t>
@@ -497,6 +513,10 @@ template class std::unordered_map<int32_t, std::unordered_set<unsigned short> >
 template class std::unordered_map<int32_t, std::unordered_set<unsigned short> > Tiles<PointLL>::Intersect(const std::list<PointLL>&) const;
 template class std::unordered_map<int32_t, std::unordered_set<unsigned short> > Tiles<Point2>::Intersect(const std::vector<Point2>&) const;
 template class std::unordered_map<int32_t, std::unordered_set<unsigned short> > Tiles<PointLL>::Intersect(const std::vector<PointLL>&) const;
+template void Tiles<Point2>::Intersect(const std::list<Point2>&, std::vector<std::pair<int32_t, unsigned short> >&) const;
+template void Tiles<PointLL>::Intersect(const std::list<PointLL>&, std::vector<std::pair<int32_t, unsigned short> >&) const;
+template void Tiles<Point2>::Intersect(const std::vector<Point2>&, std::vector<std::pair<int32_t, unsigned short> >&) const;
+template void Tiles<PointLL>::Intersect(const std::vector<PointLL>&, std::vector<std::pair<int32_t, unsigned short> >&) const;
 
 }
 }
@@ -0,0 +1,91 @@
+#include "midgard/tracing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+using namespace valhalla::midgard::tracing;
+
+thread_local trace_t* current_trace = nullptr;
+
+std::mt19937_64& generator() {
+  thread_local std::mt19937_64 generator(std::random_device{}() ^
+    static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+  return generator;
+}
+
+}
+
+namespace valhalla {
+namespace midgard {
+namespace tracing {
+
+trace_t* current() {
+  return current_trace;
+}
+
+ScopedTrace::ScopedTrace(trace_t& trace) : previous(current_trace) {
+  current_trace = &trace;
+}
+
+ScopedTrace::~ScopedTrace() {
+  current_trace = previous;
+}
+
+void ScopedSpan::begin(const char* name) {
+  index = trace->spans.size();
+  parent = trace->parent;
+  trace->spans.push_back({name, new_span_id(), parent, now(), 0});
+  trace->parent = trace->spans.back().id;
+}
+
+void ScopedSpan::end() {
+  trace->spans[index].end = now();
+  trace->parent = parent;
+}
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string new_trace_id() {
+  uint64_t high = new_span_id(), low = new_span_id();
+  return to_hex(high) + to_hex(low);
+}
+
+uint64_t new_span_id() {
+  uint64_t id;
+  do {
+    id = generator()();
+  } while(id == 0);
+  return id;
+}
+
+std::string to_hex(uint64_t span_id) {
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(span_id));
+  return hex;
+}
+
+uint64_t from_hex(const std::string& span_id) {
+  if(span_id.size() != 16 || span_id.find_first_not_of("0123456789abcdef") != std::string::npos)
+    return 0;
+  return std::stoull(span_id, nullptr, 16);
+}
+
+std::string to_json(const trace_t& trace, const span_t& span) {
+  std::string json = R"({"traceId":")" + trace.id + R"(","spanId":")" + to_hex(span.id) + '"';
+  if(span.parent)
+    json += R"(,"parentSpanId":")" + to_hex(span.parent) + '"';
+  json += R"(,"name":")" + span.name +
+          R"(","startTimeUnixNano":)" + std::to_string(span.start * 1000) +
+          R"(,"endTimeUnixNano":)" + std::to_string(span.end * 1000) + '}';
+  return json;
+}
+
+}
+}
+}
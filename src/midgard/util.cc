@@ -189,8 +189,85 @@ container_t resample_spherical_polyline(const container_t& polyline, double reso
   return resampled;
 }
 
+void resample_spherical_polyline(const std::vector<PointLL>& polyline, double resolution,
+                                 std::vector<PointLL>& resampled, bool preserve) {
+  resampled.clear();
+  if(polyline.empty())
+    return;
+  if(!(resolution > 0.0)) {
+    resampled = polyline;
+    return;
+  }
+
+  //unit vectors of the points and the arc between each one and the next, in radians
+  resolution *= RAD_PER_METER;
+  std::vector<double> xyz(polyline.size() * 3), arcs(polyline.size() - 1);
+  for(size_t i = 0; i < polyline.size(); ++i) {
+    auto lon = polyline[i].first * RAD_PER_DEG;
+    auto lat = polyline[i].second * RAD_PER_DEG;
+    auto cos_lat = cos(lat);
+    xyz[i * 3] = cos_lat * cos(lon);
+    xyz[i * 3 + 1] = cos_lat * sin(lon);
+    xyz[i * 3 + 2] = sin(lat);
+  }
+  for(size_t i = 0; i < arcs.size(); ++i) {
+    const double* a = &xyz[i * 3];
+    const double* b = a + 3;
+    arcs[i] = acos(std::max(-1.0, std::min(1.0, a[0] * b[0] + a[1] * b[1] + a[2] * b[2])));
+  }
+
+  //points go at every multiple of the resolution along the line, strictly inside a segment.
+  //how many land on each segment and how far into it the first one is follows from the arcs
+  const auto placed = [resolution](const double arc, double& remaining) {
+    size_t count = arc > remaining ? static_cast<size_t>(std::ceil((arc - remaining) / resolution)) : 0;
+    remaining += count * resolution - arc;
+    return count;
+  };
+  size_t count = 1;
+  double remaining = resolution;
+  for(auto arc : arcs)
+    count += placed(arc, remaining) + (preserve ? 1 : 0);
+  resampled.reserve(count + 1);
+
+  //step the sine and cosine of the offset along each segment by the resolution
+  const auto cos_step = cos(resolution), sin_step = sin(resolution);
+  resampled.push_back(polyline.front());
+  remaining = resolution;
+  for(size_t i = 0; i < arcs.size(); ++i) {
+    auto offset = remaining;
+    auto points = placed(arcs[i], remaining);
+    if(points > 0) {
+      const double* a = &xyz[i * 3];
+      const double* b = a + 3;
+      auto sin_arc = sin(arcs[i]), cos_arc = cos(arcs[i]);
+      auto sin_offset = sin(offset), cos_offset = cos(offset);
+      for(size_t p = 0; p < points; ++p) {
+        //slerp between the ends, the weights are sin(arc - offset) and sin(offset) over sin(arc)
+        auto wa = (sin_arc * cos_offset - cos_arc * sin_offset) / sin_arc;
+        auto wb = sin_offset / sin_arc;
+        auto x = wa * a[0] + wb * b[0];
+        auto y = wa * a[1] + wb * b[1];
+        auto z = wa * a[2] + wb * b[2];
+        resampled.emplace_back(atan2(y, x) * DEG_PER_RAD, atan2(z, sqrt(x * x + y * y)) * DEG_PER_RAD);
+        auto s = sin_offset * cos_step + cos_offset * sin_step;
+        cos_offset = cos_offset * cos_step - sin_offset * sin_step;
+        sin_offset = s;
+      }
+    }
+    if(preserve)
+      resampled.push_back(polyline[i + 1]);
+  }
+}
+
+template <>
+std::vector<PointLL> resample_spherical_polyline<std::vector<PointLL> >(const std::vector<PointLL>& polyline,
+                                                                       double resolution, bool preserve) {
+  std::vector<PointLL> resampled;
+  resample_spherical_polyline(polyline, resolution, resampled, preserve);
+  return resampled;
+}
+
 //explicit instantiations
-template std::vector<PointLL> resample_spherical_polyline<std::vector<PointLL> >(const std::vector<PointLL>&, double, bool);
 template std::vector<Point2> resample_spherical_polyline<std::vector<Point2> >(const std::vector<Point2>&, double, bool);
 template std::list<PointLL> resample_spherical_polyline<std::list<PointLL> >(const std::list<PointLL>&, double, bool);
 template std::list<Point2> resample_spherical_polyline<std::list<Point2> >(const std::list<Point2>&, double, bool);
@@ -257,6 +334,25 @@ template PointLL::first_type polygon_area(const std::vector<PointLL>&);
 template Point2::first_type polygon_area(const std::list<Point2>&);
 template Point2::first_type polygon_area(const std::vector<Point2>&);
 
+uint32_t hilbert_index(const uint32_t order, uint32_t x, uint32_t y) {
+  uint32_t n = 1 << order;
+  uint32_t d = 0;
+  for (uint32_t s = n / 2; s > 0; s /= 2) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    //rotate the quadrant so the curve through it starts and ends where the next one expects
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
 std::vector<midgard::PointLL> simulate_gps(
     const std::vector<gps_segment_t>& segments, std::vector<float>& accuracies,
     float smoothing, float accuracy, size_t sample_rate) {
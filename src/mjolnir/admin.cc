@@ -1,14 +1,54 @@
 #include "mjolnir/admin.h"
 #include "baldr/datetime.h"
 #include "midgard/logging.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
 #include <unordered_map>
 #include <boost/filesystem/operations.hpp>
 #include <sqlite3.h>
 #include <spatialite.h>
 
+namespace {
+
+// Marks a packed admin file and its layout version
+constexpr char kPackedAdminsMagic[8] = { 'V', 'A', 'D', 'M', 'I', 'N', '0', '1' };
+
+}
+
 namespace valhalla {
 namespace mjolnir {
 
+// The packed admin file is the header followed by the admins, the rings of
+// their polygons, the ring points as lng,lat doubles and then a blob of nul
+// terminated strings. Every part starts 8 byte aligned.
+struct PackedAdmins::Header {
+  char magic[8];
+  uint32_t admin_count;
+  uint32_t ring_count;
+  uint64_t point_count;
+  uint64_t string_size;
+};
+
+struct PackedAdmins::Admin {
+  double minx, miny, maxx, maxy;  // Bounding box of the polygons
+  uint32_t admin_level;           // 4 for states, 2 for countries
+  uint32_t drive_on_right;
+  uint32_t country_name;          // Offsets in the string blob
+  uint32_t state_name;
+  uint32_t country_iso;
+  uint32_t state_iso;
+  uint32_t first_ring;
+  uint32_t ring_count;
+};
+
+// An outer ring starts a new polygon, the inner rings after it are its holes
+struct PackedAdmins::Ring {
+  uint64_t first_point;
+  uint32_t point_count;
+  uint32_t outer;
+};
+
 // Get the dbhandle of a sqlite db.  Used for timezones and admins DBs.
 sqlite3 * GetDBHandle(const std::string& database) {
 
@@ -209,6 +249,190 @@ std::unordered_map<uint32_t,multi_polygon_type> GetAdminInfo(sqlite3 *db_handle,
   return polys;
 }
 
+// Constructor. Maps the packed admin file.
+PackedAdmins::PackedAdmins(const std::string& file_name) {
+  file_.map(file_name, boost::filesystem::file_size(file_name),
+            POSIX_MADV_RANDOM, true);
+  if (file_.size() < sizeof(Header))
+    throw std::runtime_error(file_name + " is not a packed admin file");
+  header_ = reinterpret_cast<const Header*>(file_.get());
+  if (std::memcmp(header_->magic, kPackedAdminsMagic, sizeof(kPackedAdminsMagic)) != 0)
+    throw std::runtime_error(file_name + " is not a packed admin file");
+
+  admins_ = reinterpret_cast<const Admin*>(header_ + 1);
+  rings_ = reinterpret_cast<const Ring*>(admins_ + header_->admin_count);
+  points_ = reinterpret_cast<const double*>(rings_ + header_->ring_count);
+  strings_ = reinterpret_cast<const char*>(points_ + header_->point_count * 2);
+  if (strings_ + header_->string_size > file_.get() + file_.size())
+    throw std::runtime_error(file_name + " is truncated");
+}
+
+// Get the number of admin areas in the file.
+size_t PackedAdmins::size() const {
+  return header_->admin_count;
+}
+
+// Get the polygons of an admin area
+multi_polygon_type PackedAdmins::GetPolygons(const Admin& admin) const {
+  multi_polygon_type multi_poly;
+  for (uint32_t i = admin.first_ring; i < admin.first_ring + admin.ring_count; ++i) {
+    const auto& ring = rings_[i];
+    if (ring.outer || multi_poly.empty()) {
+      multi_poly.emplace_back();
+    }
+    if (!ring.outer) {
+      multi_poly.back().inners().emplace_back();
+    }
+    auto& points = ring.outer ? multi_poly.back().outer() :
+                                multi_poly.back().inners().back();
+    points.reserve(ring.point_count);
+    const double* p = points_ + ring.first_point * 2;
+    for (uint32_t j = 0; j < ring.point_count; ++j, p += 2) {
+      points.emplace_back(p[0], p[1]);
+    }
+  }
+  return multi_poly;
+}
+
+// Get a string from the string blob
+std::string PackedAdmins::GetString(const uint32_t offset) const {
+  return offset < header_->string_size ? std::string(strings_ + offset) : "";
+}
+
+// Find the admins of a level that intersect the bounding box and add them
+void PackedAdmins::AddAdmins(const uint32_t admin_level, const AABB2<PointLL>& aabb,
+                             std::unordered_map<uint32_t, bool>& drive_on_right,
+                             GraphTileBuilder& tilebuilder,
+                             std::unordered_map<uint32_t,multi_polygon_type>& polys) const {
+  boost::geometry::model::box<point_type> box(point_type(aabb.minx(), aabb.miny()),
+                                              point_type(aabb.maxx(), aabb.maxy()));
+  for (uint32_t i = 0; i < header_->admin_count; ++i) {
+    const auto& admin = admins_[i];
+    if (admin.admin_level != admin_level || admin.maxx < aabb.minx() ||
+        admin.minx > aabb.maxx() || admin.maxy < aabb.miny() || admin.miny > aabb.maxy())
+      continue;
+
+    multi_polygon_type multi_poly = GetPolygons(admin);
+    if (!boost::geometry::intersects(box, multi_poly))
+      continue;
+
+    uint32_t index = tilebuilder.AddAdmin(GetString(admin.country_name), GetString(admin.state_name),
+                                          GetString(admin.country_iso), GetString(admin.state_iso));
+    polys.emplace(index, std::move(multi_poly));
+    drive_on_right.emplace(index, admin.drive_on_right);
+  }
+}
+
+// Get the admin polys that intersect with the tile bounding box.
+std::unordered_map<uint32_t,multi_polygon_type> PackedAdmins::GetAdminInfo(
+    std::unordered_map<uint32_t,bool>& drive_on_right, const AABB2<PointLL>& aabb,
+    GraphTileBuilder& tilebuilder) const {
+  std::unordered_map<uint32_t,multi_polygon_type> polys;
+  AddAdmins(4, aabb, drive_on_right, tilebuilder, polys);
+
+  //state/prov not found, try to find country
+  if (polys.empty())
+    AddAdmins(2, aabb, drive_on_right, tilebuilder, polys);
+  return polys;
+}
+
+// Pack the states and countries of an admin db into a file.
+uint32_t PackedAdmins::Write(sqlite3 *db_handle, const std::string& file_name) {
+  std::vector<Admin> admins;
+  std::vector<Ring> rings;
+  std::vector<double> points;
+  std::string strings(1, '\0');
+  std::unordered_map<std::string, uint32_t> string_offsets{ {"", 0} };
+  const auto add_string = [&strings, &string_offsets](const std::string& str) {
+    auto inserted = string_offsets.emplace(str, strings.size());
+    if (inserted.second) {
+      strings.append(str);
+      strings.push_back('\0');
+    }
+    return inserted.first->second;
+  };
+  const auto column_text = [](sqlite3_stmt* stmt, int col) {
+    return sqlite3_column_type(stmt, col) == SQLITE_TEXT ?
+        std::string((char*)sqlite3_column_text(stmt, col)) : std::string();
+  };
+
+  // The states with their countries, then the countries
+  const std::vector<std::pair<uint32_t, std::string>> queries{
+    { 4, "SELECT country.name, state.name, country.iso_code, state.iso_code, "
+         "state.drive_on_right, st_astext(state.geom) from admins state, admins country "
+         "where country.rowid = state.parent_admin and state.admin_level=4" },
+    { 2, "SELECT name, \"\", iso_code, \"\", drive_on_right, st_astext(geom) from "
+         "admins where admin_level=2" }
+  };
+  for (const auto& query : queries) {
+    sqlite3_stmt *stmt = 0;
+    uint32_t ret = sqlite3_prepare_v2(db_handle, query.second.c_str(),
+                                      query.second.length(), &stmt, 0);
+    if (ret != SQLITE_OK) {
+      LOG_ERROR("SQL error: " + query.second);
+      LOG_ERROR(std::string(sqlite3_errmsg(db_handle)));
+    }
+    while (ret == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+      multi_polygon_type multi_poly;
+      boost::geometry::read_wkt(column_text(stmt, 5), multi_poly);
+      if (multi_poly.empty())
+        continue;
+
+      boost::geometry::model::box<point_type> box;
+      boost::geometry::envelope(multi_poly, box);
+      Admin admin;
+      admin.minx = box.min_corner().x();
+      admin.miny = box.min_corner().y();
+      admin.maxx = box.max_corner().x();
+      admin.maxy = box.max_corner().y();
+      admin.admin_level = query.first;
+      admin.drive_on_right = sqlite3_column_type(stmt, 4) == SQLITE_INTEGER ?
+          sqlite3_column_int(stmt, 4) : 1;
+      admin.country_name = add_string(column_text(stmt, 0));
+      admin.state_name = add_string(column_text(stmt, 1));
+      admin.country_iso = add_string(column_text(stmt, 2));
+      admin.state_iso = add_string(column_text(stmt, 3));
+      admin.first_ring = rings.size();
+
+      const auto add_ring = [&rings, &points](const polygon_type::ring_type& ring, bool outer) {
+        rings.push_back({points.size() / 2, static_cast<uint32_t>(ring.size()), outer});
+        for (const auto& p : ring) {
+          points.push_back(p.x());
+          points.push_back(p.y());
+        }
+      };
+      for (const auto& poly : multi_poly) {
+        add_ring(poly.outer(), true);
+        for (const auto& inner : poly.inners())
+          add_ring(inner, false);
+      }
+      admin.ring_count = rings.size() - admin.first_ring;
+      admins.push_back(admin);
+    }
+    if (stmt)
+      sqlite3_finalize(stmt);
+  }
+
+  // Pad the strings so the file stays a multiple of 8 bytes
+  strings.resize((strings.size() + 7) & ~7);
+  Header header;
+  std::memcpy(header.magic, kPackedAdminsMagic, sizeof(kPackedAdminsMagic));
+  header.admin_count = admins.size();
+  header.ring_count = rings.size();
+  header.point_count = points.size() / 2;
+  header.string_size = strings.size();
+
+  std::ofstream file(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  file.write(reinterpret_cast<const char*>(admins.data()), admins.size() * sizeof(Admin));
+  file.write(reinterpret_cast<const char*>(rings.data()), rings.size() * sizeof(Ring));
+  file.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(double));
+  file.write(strings.data(), strings.size());
+  if (!file)
+    throw std::runtime_error("Failed writing " + file_name);
+  return admins.size();
+}
+
 //Get all the country access records from the db and save them to a map.
 std::unordered_map<std::string, std::vector<int>> GetCountryAccess(sqlite3 *db_handle) {
 
@@ -0,0 +1,350 @@
+#include "mjolnir/chbuilder.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "midgard/logging.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "sif/costfactory.h"
+#include "sif/edgelabel.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// An arc while contracting, node is the other end
+struct arc_t {
+  uint32_t node;
+  uint32_t middle;
+  float cost;
+  float secs;
+  float length;
+};
+
+using queue_entry_t = std::pair<float, uint32_t>;
+using min_queue_t = std::priority_queue<queue_entry_t, std::vector<queue_entry_t>,
+                                        std::greater<queue_entry_t> >;
+
+/**
+ * Contracts the nodes of a graph one at a time in the order of their edge
+ * difference (shortcuts added minus arcs removed), adding a shortcut between
+ * the neighbours of a node whenever a bounded witness search can't find a
+ * path around it that is at least as cheap.
+ */
+class Contractor {
+ public:
+  Contractor(const size_t node_count, const std::vector<CHBuilder::Turn>& turns,
+             const uint32_t witness_limit)
+      : out_(node_count), in_(node_count), contracted_(node_count, false),
+        deleted_neighbors_(node_count, 0), witness_limit_(witness_limit),
+        dist_(node_count, std::numeric_limits<float>::infinity()) {
+    for (const auto& turn : turns) {
+      if (turn.from != turn.to)
+        AddArc(turn.from, turn.to, turn.cost, turn.secs, turn.length, kInvalidCHNode);
+    }
+  }
+
+  // Contract every node
+  void Run() {
+    // Lazily updated queue of nodes by priority
+    std::priority_queue<std::pair<int32_t, uint32_t>, std::vector<std::pair<int32_t, uint32_t> >,
+                        std::greater<std::pair<int32_t, uint32_t> > > queue;
+    for (uint32_t v = 0; v < out_.size(); ++v)
+      queue.emplace(Priority(v), v);
+
+    size_t contracted = 0;
+    size_t step = std::max<size_t>(out_.size() / 10, 1);
+    while (!queue.empty()) {
+      uint32_t v = queue.top().second;
+      queue.pop();
+      if (contracted_[v])
+        continue;
+
+      // If its priority went up since it was queued put it back
+      int32_t priority = Priority(v);
+      if (!queue.empty() && priority > queue.top().first) {
+        queue.emplace(priority, v);
+        continue;
+      }
+
+      Contract(v);
+      if (++contracted % step == 0)
+        LOG_INFO("Contracted " + std::to_string(contracted) + " of " +
+                 std::to_string(out_.size()) + " nodes, " +
+                 std::to_string(shortcuts_) + " shortcuts");
+    }
+  }
+
+  // Create the hierarchy from the arcs remaining at each node when it was
+  // contracted, all of which lead to higher ranked nodes
+  CHGraph Graph(const std::string& costing, std::vector<GraphId>&& edges) const {
+    std::vector<uint32_t> fwd_offsets(1, 0), bwd_offsets(1, 0);
+    std::vector<CHArc> fwd_arcs, bwd_arcs;
+    for (uint32_t v = 0; v < out_.size(); ++v) {
+      for (const auto& arc : out_[v])
+        fwd_arcs.push_back({arc.node, arc.middle, arc.cost, arc.secs, arc.length});
+      for (const auto& arc : in_[v])
+        bwd_arcs.push_back({arc.node, arc.middle, arc.cost, arc.secs, arc.length});
+      fwd_offsets.push_back(fwd_arcs.size());
+      bwd_offsets.push_back(bwd_arcs.size());
+    }
+    return CHGraph(costing, std::move(edges), std::move(fwd_offsets), std::move(fwd_arcs),
+                   std::move(bwd_offsets), std::move(bwd_arcs));
+  }
+
+  size_t shortcuts() const {
+    return shortcuts_;
+  }
+
+ protected:
+  // Add an arc from u to w, keeping only the cheapest arc between two nodes
+  void AddArc(const uint32_t u, const uint32_t w, const float cost, const float secs,
+              const float length, const uint32_t middle) {
+    auto out = std::find_if(out_[u].begin(), out_[u].end(),
+                            [w](const arc_t& a) { return a.node == w; });
+    if (out != out_[u].end()) {
+      if (cost < out->cost) {
+        *out = {w, middle, cost, secs, length};
+        auto in = std::find_if(in_[w].begin(), in_[w].end(),
+                               [u](const arc_t& a) { return a.node == u; });
+        *in = {u, middle, cost, secs, length};
+      }
+      return;
+    }
+    out_[u].push_back({w, middle, cost, secs, length});
+    in_[w].push_back({u, middle, cost, secs, length});
+  }
+
+  // Bounded search from source that doesn't go through avoid, leaves the
+  // costs found in dist_
+  void Witness(const uint32_t source, const uint32_t avoid, const float max_cost) {
+    for (auto n : touched_)
+      dist_[n] = std::numeric_limits<float>::infinity();
+    touched_.clear();
+
+    min_queue_t queue;
+    dist_[source] = 0.f;
+    touched_.push_back(source);
+    queue.emplace(0.f, source);
+    uint32_t settled = 0;
+    while (!queue.empty()) {
+      float cost = queue.top().first;
+      uint32_t n = queue.top().second;
+      queue.pop();
+      if (cost > dist_[n])
+        continue;
+      if (cost > max_cost || ++settled > witness_limit_)
+        break;
+      for (const auto& arc : out_[n]) {
+        if (arc.node == avoid)
+          continue;
+        float c = cost + arc.cost;
+        if (c < dist_[arc.node]) {
+          if (dist_[arc.node] == std::numeric_limits<float>::infinity())
+            touched_.push_back(arc.node);
+          dist_[arc.node] = c;
+          queue.emplace(c, arc.node);
+        }
+      }
+    }
+  }
+
+  // Count (or add) the shortcuts contracting v needs
+  template <bool add>
+  int32_t Shortcuts(const uint32_t v) {
+    if (out_[v].empty())
+      return 0;
+    float max_out = 0.f;
+    for (const auto& out : out_[v])
+      max_out = std::max(max_out, out.cost);
+
+    int32_t count = 0;
+    for (const auto& in : in_[v]) {
+      Witness(in.node, v, in.cost + max_out);
+      for (const auto& out : out_[v]) {
+        if (out.node == in.node)
+          continue;
+        float cost = in.cost + out.cost;
+        if (dist_[out.node] > cost) {
+          ++count;
+          if (add)
+            AddArc(in.node, out.node, cost, in.secs + out.secs, in.length + out.length, v);
+        }
+      }
+    }
+    return count;
+  }
+
+  int32_t Priority(const uint32_t v) {
+    int32_t removed = in_[v].size() + out_[v].size();
+    return Shortcuts<false>(v) - removed + 2 * deleted_neighbors_[v];
+  }
+
+  // Remove v from the graph, bridging its neighbours with shortcuts. The arcs
+  // of v itself stay, they are its arcs in the hierarchy
+  void Contract(const uint32_t v) {
+    shortcuts_ += Shortcuts<true>(v);
+    for (const auto& out : out_[v]) {
+      auto& in = in_[out.node];
+      in.erase(std::remove_if(in.begin(), in.end(), [v](const arc_t& a) { return a.node == v; }),
+               in.end());
+      deleted_neighbors_[out.node]++;
+    }
+    for (const auto& in : in_[v]) {
+      auto& out = out_[in.node];
+      out.erase(std::remove_if(out.begin(), out.end(), [v](const arc_t& a) { return a.node == v; }),
+                out.end());
+      deleted_neighbors_[in.node]++;
+    }
+    contracted_[v] = true;
+  }
+
+  std::vector<std::vector<arc_t> > out_;
+  std::vector<std::vector<arc_t> > in_;
+  std::vector<bool> contracted_;
+  std::vector<int32_t> deleted_neighbors_;
+  uint32_t witness_limit_;
+  size_t shortcuts_ = 0;
+
+  // Witness search state
+  std::vector<float> dist_;
+  std::vector<uint32_t> touched_;
+};
+
+}
+
+namespace valhalla {
+namespace mjolnir {
+
+CHGraph CHBuilder::Contract(const std::string& costing_name, std::vector<GraphId>&& edges,
+                            const std::vector<Turn>& turns, const uint32_t witness_limit) {
+  Contractor contractor(edges.size(), turns, witness_limit);
+  contractor.Run();
+  LOG_INFO("Contracted " + std::to_string(edges.size()) + " nodes with " +
+           std::to_string(turns.size()) + " turns adding " +
+           std::to_string(contractor.shortcuts()) + " shortcuts");
+  return contractor.Graph(costing_name, std::move(edges));
+}
+
+CHGraph CHBuilder::Contract(GraphReader& reader, const cost_ptr_t& costing,
+                            const std::string& costing_name, const uint32_t witness_limit) {
+  std::vector<GraphId> edges;
+  auto turns = Turns(reader, costing, costing_name, edges);
+  return Contract(costing_name, std::move(edges), turns, witness_limit);
+}
+
+std::vector<CHBuilder::Turn> CHBuilder::Turns(GraphReader& reader, const cost_ptr_t& costing,
+                                              const std::string& costing_name,
+                                              std::vector<GraphId>& edges,
+                                              const AABB2<PointLL>* bounds,
+                                              const int only_level) {
+  // Every directed edge the costing may use is a node of the hierarchy
+  auto filter = costing->GetEdgeFilter();
+  const auto usable = [&filter](const DirectedEdge* edge) {
+    return !edge->IsTransition() && !edge->is_shortcut() && filter(edge) > 0.f;
+  };
+  edges.clear();
+  for (const auto& level : TileHierarchy::levels()) {
+    if (only_level >= 0 && level.first != only_level)
+      continue;
+    std::vector<int32_t> tileids;
+    if (bounds) {
+      tileids = level.second.tiles.TileList(*bounds);
+    } else {
+      for (int32_t tileid = 0; tileid < static_cast<int32_t>(level.second.tiles.TileCount()); ++tileid)
+        tileids.push_back(tileid);
+    }
+    for (auto tileid : tileids) {
+      GraphId base(tileid, level.first, 0);
+      if (!reader.DoesTileExist(base))
+        continue;
+      const GraphTile* tile = reader.GetGraphTile(base);
+      if (tile == nullptr)
+        continue;
+      for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+        if (usable(tile->directededge(i)))
+          edges.emplace_back(tileid, level.first, i);
+      }
+      if (reader.OverCommitted())
+        reader.Trim();
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  const auto node = [&edges](const GraphId& edgeid) {
+    auto itr = std::lower_bound(edges.cbegin(), edges.cend(), edgeid);
+    return (itr != edges.cend() && *itr == edgeid) ? static_cast<uint32_t>(itr - edges.cbegin()) :
+                                                     kInvalidCHNode;
+  };
+  LOG_INFO("Found " + std::to_string(edges.size()) + " edges usable by " + costing_name);
+
+  // Every allowed turn from one edge onto the next is an arc. Turns are
+  // made at the end node of an edge, or at its copy on another level.
+  std::vector<Turn> turns;
+  std::vector<GraphId> nodes;
+  for (uint32_t from = 0; from < edges.size(); ++from) {
+    if (reader.OverCommitted())
+      reader.Trim();
+    const GraphTile* tile = nullptr;
+    const DirectedEdge* edge = reader.directededge(edges[from], tile);
+    EdgeLabel pred(0, edges[from], edge, Cost(), 0.f, 0.f, costing->travel_mode(), 0);
+    nodes.assign(1, edge->endnode());
+    for (size_t n = 0; n < nodes.size(); ++n) {
+      const GraphTile* node_tile = reader.GetGraphTile(nodes[n]);
+      if (node_tile == nullptr)
+        continue;
+      const NodeInfo* nodeinfo = node_tile->node(nodes[n]);
+      bool node_allowed = costing->Allowed(nodeinfo);
+      GraphId edgeid(nodes[n].tileid(), nodes[n].level(), nodeinfo->edge_index());
+      const DirectedEdge* next = node_tile->directededge(nodeinfo->edge_index());
+      for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++next, ++edgeid) {
+        if (next->IsTransition()) {
+          if (std::find(nodes.cbegin(), nodes.cend(), next->endnode()) == nodes.cend())
+            nodes.push_back(next->endnode());
+          continue;
+        }
+        if (!node_allowed)
+          continue;
+        uint32_t to = node(edgeid);
+        if (to == kInvalidCHNode || !costing->Allowed(next, pred, node_tile, edgeid))
+          continue;
+        Cost cost = costing->TransitionCost(next, nodeinfo, pred) + costing->EdgeCost(next);
+        turns.push_back({from, to, cost.cost, cost.secs, static_cast<float>(next->length())});
+      }
+    }
+  }
+  reader.Clear();
+  return turns;
+}
+
+void CHBuilder::Build(const boost::property_tree::ptree& pt, const std::string& costing) {
+  // Default costing options, the hierarchy is only used when a request
+  // doesn't change them
+  CostFactory<DynamicCost> factory;
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("hov", CreateHOVCost);
+  factory.Register("motor_scooter", CreateMotorScooterCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("truck", CreateTruckCost);
+  auto cost = factory.Create(costing, rapidjson::Value{});
+
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto graph = Contract(reader, cost, costing);
+  auto file_name = CHGraph::FileName(pt.get<std::string>("mjolnir.tile_dir"), costing);
+  graph.Write(file_name);
+  LOG_INFO("Wrote contraction hierarchy with " + std::to_string(graph.node_count()) +
+           " nodes and " + std::to_string(graph.arc_count()) + " arcs to " + file_name);
+}
+
+}
+}
@@ -71,11 +71,11 @@ std::size_t EdgeInfoBuilder::SizeOf() const {
   return size;
 }
 
-// Output edge info to output stream
-std::ostream& operator<<(std::ostream& os, const EdgeInfoBuilder& eib) {
+// Append the edge info bytes to a buffer
+void EdgeInfoBuilder::AppendTo(std::string& buffer) const {
   // Pack the name count and encoded shape size. Check against limits.
   baldr::EdgeInfo::PackedItem item;
-  uint32_t name_count = eib.name_info_list_.size();
+  uint32_t name_count = name_info_list_.size();
   if (name_count > kMaxNamesPerEdge) {
     LOG_WARN("Exceeding max names per edge: " + std::to_string(name_count));
     name_count = kMaxNamesPerEdge;
@@ -83,28 +83,34 @@ std::ostream& operator<<(std::ostream& os, const EdgeInfoBuilder& eib) {
   item.name_count = name_count;
 
   // Check if we are exceeding the max encoded size
-  if (eib.encoded_shape_.size() > kMaxEncodedShapeSize) {
+  if (encoded_shape_.size() > kMaxEncodedShapeSize) {
     LOG_WARN("Exceeding max encoded shape size: " +
-              std::to_string(eib.encoded_shape_.size()));
+              std::to_string(encoded_shape_.size()));
     item.encoded_shape_size = static_cast<uint32_t>(kMaxEncodedShapeSize);
   } else {
-    item.encoded_shape_size = static_cast<uint32_t>(eib.encoded_shape_.size());
+    item.encoded_shape_size = static_cast<uint32_t>(encoded_shape_.size());
   }
 
-  // Write out the bytes
-  os.write(reinterpret_cast<const char*>(&eib.wayid_), sizeof(uint64_t));
-  os.write(reinterpret_cast<const char*>(&item), sizeof(baldr::EdgeInfo::PackedItem));
-  os.write(reinterpret_cast<const char*>(eib.name_info_list_.data()),
-            (name_count * sizeof(NameInfo)));
-  os << eib.encoded_shape_;
+  // Append the bytes
+  buffer.append(reinterpret_cast<const char*>(&wayid_), sizeof(uint64_t));
+  buffer.append(reinterpret_cast<const char*>(&item), sizeof(baldr::EdgeInfo::PackedItem));
+  buffer.append(reinterpret_cast<const char*>(name_info_list_.data()),
+                (name_count * sizeof(NameInfo)));
+  buffer.append(encoded_shape_);
 
   // Pad to an 8 byte boundary
-  std::size_t n = (eib.BaseSizeOf() % 8);
+  std::size_t n = (BaseSizeOf() % 8);
   if (n != 0) {
-    for (std::size_t i = 0; i < 8 - n; i++) {
-      os << static_cast<char>(0);
-    }
+    buffer.append(8 - n, static_cast<char>(0));
   }
+}
+
+// Output edge info to output stream
+std::ostream& operator<<(std::ostream& os, const EdgeInfoBuilder& eib) {
+  std::string bytes;
+  bytes.reserve(eib.SizeOf());
+  eib.AppendTo(bytes);
+  os.write(bytes.data(), bytes.size());
   return os;
 }
 
@@ -10,7 +10,7 @@ namespace mjolnir {
 
 // Get the best classification for any driveable non-ferry and non-link
 // edges from a node. Skip any reclassified ferry edges
-uint32_t GetBestNonFerryClass(const std::map<Edge, size_t>& edges) {
+uint32_t GetBestNonFerryClass(const node_edges_t& edges) {
   uint32_t bestrc = kAbsurdRoadClass;
   for (const auto& edge : edges) {
     if (!edge.first.attributes.driveable_ferry &&
@@ -39,7 +39,7 @@ public:
 // touches the specified road classification.
 uint32_t ShortestPath(const uint32_t start_node_idx,
                       const uint32_t node_idx,
-                      sequence<OSMWay>& ways,
+                      compressed_sequence<OSMWay>& ways,
                       sequence<OSMWayNode>& way_nodes,
                       sequence<Edge>& edges,
                       sequence<Node>& nodes,
@@ -201,7 +201,7 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
 // just one edge and length < 2 km
 bool ShortFerry(const uint32_t node_index, node_bundle& bundle,
                 sequence<Edge>& edges, sequence<Node>& nodes,
-                sequence<OSMWay>& ways,
+                compressed_sequence<OSMWay>& ways,
                 sequence<OSMWayNode>& way_nodes) {
   // Method to get the shape for an edge - since LL is stored as a pair of
   // floats we need to change into PointLL to get length of an edge
@@ -248,10 +248,11 @@ void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& nodes_file,
                                 const std::string& edges_file,
                                 const uint32_t rc,
-                                DataQuality& stats) {
+                                DataQuality& stats,
+                                const unsigned int threads) {
   LOG_INFO("Reclassifying ferry connection graph edges...");
 
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   sequence<Edge> edges(edges_file, false);
   sequence<Node> nodes(nodes_file, false);
@@ -260,16 +261,24 @@ void ReclassifyFerryConnections(const std::string& ways_file,
   // specified classification. Want to do simple shortest path (time based
   // only) and obey driveability.
 
-  // Iterate through nodes and find any that connect to both a ferry and a
-  // regular (non-ferry) edge. Skip short ferry edges (river crossing?)
+  // Find the nodes that connect to both a ferry and a regular (non-ferry)
+  // edge on all the threads. Reclassifying doesn't change which edges are
+  // ferries so the scan can run ahead of it.
+  auto ferry_nodes = find_node_bundles(nodes_file, edges_file, threads,
+    [](const node_bundle& bundle) {
+      return bundle.node.attributes_.ferry_edge &&
+             bundle.node.attributes_.non_ferry_edge;
+    });
+
+  // Iterate through those nodes in order. The classification of their edges
+  // is checked here as paths from earlier ferries may have upgraded them.
+  // Skip short ferry edges (river crossing?)
   uint32_t ferry_endpoint_count = 0;
   uint32_t total_count = 0;
-  sequence<Node>::iterator node_itr = nodes.begin();
-  while (node_itr != nodes.end()) {
+  for (const auto position : ferry_nodes) {
+    auto node_itr = nodes[position];
     auto bundle = collect_node_edges(node_itr, nodes, edges);
-    if (bundle.node.attributes_.ferry_edge &&
-        bundle.node.attributes_.non_ferry_edge &&
-        GetBestNonFerryClass(bundle.node_edges) > rc &&
+    if (GetBestNonFerryClass(bundle.node_edges) > rc &&
         !ShortFerry(node_itr.position(), bundle, edges,
                     nodes, ways, way_nodes)) {
       // Form shortest path from node along each edge connected to the ferry,
@@ -318,9 +327,6 @@ void ReclassifyFerryConnections(const std::string& ways_file,
         total_count++;
       }
     }
-
-    // Go to the next node
-    node_itr += bundle.node_count;
   }
   LOG_INFO("Finished ReclassifyFerryEdges: ferry_endpoint_count = " +
            std::to_string(ferry_endpoint_count) + ", " +
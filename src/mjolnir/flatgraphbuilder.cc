@@ -0,0 +1,71 @@
+#include "mjolnir/flatgraphbuilder.h"
+
+#include <algorithm>
+
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace valhalla {
+namespace mjolnir {
+
+FlatGraph FlatGraphBuilder::Flatten(const std::string& costing_name, const AABB2<PointLL>& bounds,
+                                    std::vector<GraphId>&& edges,
+                                    const std::vector<CHBuilder::Turn>& turns) {
+  // Count the turns leaving each node then place them, keeping the order
+  // they were found in
+  std::vector<uint32_t> offsets(edges.size() + 1, 0);
+  for (const auto& turn : turns)
+    ++offsets[turn.from + 1];
+  for (size_t i = 1; i < offsets.size(); ++i)
+    offsets[i] += offsets[i - 1];
+  std::vector<uint32_t> targets(turns.size()), next(offsets.begin(), offsets.end() - 1);
+  std::vector<float> costs(turns.size()), secs(turns.size()), lengths(turns.size());
+  for (const auto& turn : turns) {
+    uint32_t arc = next[turn.from]++;
+    targets[arc] = turn.to;
+    costs[arc] = turn.cost;
+    secs[arc] = turn.secs;
+    lengths[arc] = turn.length;
+  }
+  return FlatGraph(costing_name, bounds, std::move(edges), std::move(offsets), std::move(targets),
+                   std::move(costs), std::move(secs), std::move(lengths));
+}
+
+FlatGraph FlatGraphBuilder::Flatten(GraphReader& reader, const cost_ptr_t& costing,
+                                    const std::string& costing_name,
+                                    const AABB2<PointLL>& bounds) {
+  std::vector<GraphId> edges;
+  auto turns = CHBuilder::Turns(reader, costing, costing_name, edges, &bounds);
+  return Flatten(costing_name, bounds, std::move(edges), turns);
+}
+
+void FlatGraphBuilder::Build(const boost::property_tree::ptree& pt, const std::string& costing,
+                             const AABB2<PointLL>& bounds, const std::string& file_name) {
+  // Default costing options, like the contraction hierarchy
+  CostFactory<DynamicCost> factory;
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("hov", CreateHOVCost);
+  factory.Register("motor_scooter", CreateMotorScooterCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("truck", CreateTruckCost);
+  auto cost = factory.Create(costing, rapidjson::Value{});
+
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto graph = Flatten(reader, cost, costing, bounds);
+  auto out_file = file_name.empty() ?
+      FlatGraph::FileName(pt.get<std::string>("mjolnir.tile_dir"), costing) : file_name;
+  graph.Write(out_file);
+  LOG_INFO("Wrote flat graph with " + std::to_string(graph.node_count()) +
+           " nodes and " + std::to_string(graph.arc_count()) + " arcs to " + out_file);
+}
+
+}
+}
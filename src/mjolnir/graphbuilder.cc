@@ -43,14 +43,23 @@ constexpr double POSTING_INTERVAL = 60;
 // Do not compute grade for intervals less than 10 meters.
 constexpr double kMinimumInterval = 10.0f;
 
+// Order of the hilbert curve nodes can be laid out along within a tile. The
+// index along it has to fit in the id of a GraphId.
+constexpr uint32_t kHilbertOrder = 10;
+constexpr uint32_t kHilbertCells = 1 << kHilbertOrder;
+
 /**
  * we need the nodes to be sorted by graphid and then by osmid to make a set of tiles
- * we also need to then update the egdes that pointed to them
+ * we also need to then update the egdes that pointed to them. the graphids coming in
+ * may carry the hilbert order of the nodes within their tile in their id, in which case
+ * that is the order the nodes end up in within the tile
  *
  */
 std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
                                     const std::string& edges_file,
-                                    const uint8_t level) {
+                                    const uint8_t level,
+                                    const size_t sort_memory,
+                                    const unsigned int threads) {
   LOG_INFO("Sorting graph...");
 
   // Sort nodes by graphid then by osmid, so its basically a set of tiles
@@ -60,7 +69,7 @@ std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
       if(a.graph_id == b.graph_id)
         return a.node.osmid < b.node.osmid;
       return a.graph_id < b.graph_id;
-    }
+    }, sort_memory / sizeof(Node), threads
   );
   //run through the sorted nodes, going back to the edges they reference and updating each edge
   //to point to the first (out of the duplicates) nodes index. at the end of this there will be
@@ -75,8 +84,8 @@ std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
   nodes.transform(
     [&nodes, &edges, &run_index, &node_index, &node_count, &last_node, &tiles](Node& node) {
       //remember if this was a new tile
-      if(node_index == 0 || node.graph_id != (--tiles.end())->first) {
-        tiles.insert({node.graph_id, node_index});
+      if(node_index == 0 || node.graph_id.Tile_Base() != (--tiles.end())->first) {
+        tiles.insert({node.graph_id.Tile_Base(), node_index});
         node.graph_id.set_id(0);
         run_index = node_index;
         ++node_count;
@@ -123,7 +132,7 @@ void ConstructEdges(const OSMData& osmdata, const std::string& ways_file,
   LOG_INFO("Creating graph edges from ways...");
 
   //so we can read ways and nodes and write edges
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   sequence<Edge> edges(edges_file, true);
   sequence<Node> nodes(nodes_file, true);
@@ -258,7 +267,7 @@ void CheckForDuplicates(const GraphId& nodeid, const Node& node,
 */
 uint32_t CreateSimpleTurnRestriction(const uint64_t wayid, const size_t endnode,
     sequence<Node>& nodes, sequence<Edge>& edges, const OSMData& osmdata,
-    sequence<OSMWay>& ways, DataQuality& stats) {
+    compressed_sequence<OSMWay>& ways, DataQuality& stats) {
 
   auto res = osmdata.restrictions.equal_range(wayid);
   if (res.first == osmdata.restrictions.end()) {
@@ -356,27 +365,37 @@ uint32_t AddAccessRestrictions(const uint32_t edgeid, const uint64_t wayid,
   return modes;
 }
 
+// A tile to build, the index of its first node and how many nodes it has
+struct tile_task_t {
+  GraphId tile_id;
+  size_t first_node;
+  size_t node_count;
+};
+
 void BuildTileSet(const std::string& ways_file, const std::string& way_nodes_file,
     const std::string& nodes_file, const std::string& edges_file,
     const std::string& complex_restriction_file,
     const std::string tile_dir, const OSMData& osmdata,
     const std::unique_ptr<const valhalla::skadi::sample>& sample,
-    std::map<GraphId, size_t>::const_iterator tile_start,
-    std::map<GraphId, size_t>::const_iterator tile_end,
+    std::vector<tile_task_t>::const_iterator tile_start,
+    std::vector<tile_task_t>::const_iterator tile_end,
     const uint32_t tile_creation_date,
+    const PackedAdmins* packed_admins,
     const boost::property_tree::ptree& pt,
     std::promise<DataQuality>& result) {
 
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   sequence<Edge> edges(edges_file, false);
   sequence<Node> nodes(nodes_file, false);
   sequence<OSMRestriction> complex_restrictions(complex_restriction_file, false);
 
   auto database = pt.get_optional<std::string>("admin");
-  // Initialize the admin DB (if it exists)
-  sqlite3 *admin_db_handle = database ? GetDBHandle(*database) : nullptr;
-  if (!database)
+  // Initialize the admin DB (if it exists) unless the admins are packed
+  sqlite3 *admin_db_handle = database && !packed_admins ? GetDBHandle(*database) : nullptr;
+  if (packed_admins)
+    LOG_INFO("Using packed admins.");
+  else if (!database)
     LOG_WARN("Admin db not found.  Not saving admin information.");
   else if (!admin_db_handle)
     LOG_WARN("Admin db " + *database + " not found.  Not saving admin information.");
@@ -417,7 +436,7 @@ void BuildTileSet(const std::string& ways_file, const std::string& way_nodes_fil
   for(; tile_start != tile_end; ++tile_start) {
     try {
       // What actually writes the tile
-      GraphId tile_id = tile_start->first.Tile_Base();
+      GraphId tile_id = tile_start->tile_id.Tile_Base();
       GraphTileBuilder graphtile(tile_dir, tile_id, false);
 
       // Information about tile creation
@@ -430,9 +449,10 @@ void BuildTileSet(const std::string& ways_file, const std::string& way_nodes_fil
       uint32_t id  = tile_id.tileid();
       std::unordered_map<uint32_t,multi_polygon_type> admin_polys;
       std::unordered_map<uint32_t,bool> drive_on_right;
-      if (admin_db_handle) {
-        admin_polys = GetAdminInfo(admin_db_handle, drive_on_right,
-                                   tiling.TileBounds(id), graphtile);
+      if (packed_admins || admin_db_handle) {
+        admin_polys = packed_admins ?
+            packed_admins->GetAdminInfo(drive_on_right, tiling.TileBounds(id), graphtile) :
+            GetAdminInfo(admin_db_handle, drive_on_right, tiling.TileBounds(id), graphtile);
         if (admin_polys.size() == 1) {
           // TODO - check if tile bounding box is entirely inside the polygon...
           tile_within_one_admin = true;
@@ -448,16 +468,20 @@ void BuildTileSet(const std::string& ways_file, const std::string& way_nodes_fil
         }
       }
 
+      // Index the polygons so each node tests only the polygons crossing
+      // the part of the tile it is in
+      PolygonIndex admin_poly_index(admin_polys, tiling.TileBounds(id));
+      PolygonIndex tz_poly_index(tz_polys, tiling.TileBounds(id));
+
       // Iterate through the nodes
       uint32_t idx = 0;                 // Current directed edge index
 
       ////////////////////////////////////////////////////////////////////////
       // Iterate over nodes in the tile
-      auto node_itr = nodes[tile_start->second];
+      auto node_itr = nodes[tile_start->first_node];
       // to avoid realloc we guess how many edges there might be in a given tile
       geo_attribute_cache.clear();
-      geo_attribute_cache.reserve(5 * (std::next(tile_start) == tile_end ? nodes.end() - node_itr :
-        std::next(tile_start)->second - tile_start->second));
+      geo_attribute_cache.reserve(5 * tile_start->node_count);
 
       while (node_itr != nodes.end() && (*node_itr).graph_id.Tile_Base() == tile_id) {
         //amalgamate all the node duplicates into one and the edges that connect to it
@@ -476,7 +500,7 @@ void BuildTileSet(const std::string& ways_file, const std::string& way_nodes_fil
         // Get the admin index
         uint32_t admin_index = (tile_within_one_admin) ?
                       admin_polys.begin()->first :
-                      GetMultiPolyId(admin_polys, node_ll);
+                      admin_poly_index.Get(node_ll);
 
         // Look for potential duplicates
         //CheckForDuplicates(nodeid, node, edgelengths, nodes, edges, osmdata.ways, stats);
@@ -926,7 +950,7 @@ void BuildTileSet(const std::string& ways_file, const std::string& way_nodes_fil
         // Set the time zone index
         uint32_t tz_index = (tile_within_one_tz) ?
                       tz_polys.begin()->first :
-                      GetMultiPolyId(tz_polys, node_ll);
+                      tz_poly_index.Get(node_ll);
         graphtile.nodes().back().set_timezone(tz_index);
 
         // Increment the counts in the histogram
@@ -942,12 +966,12 @@ void BuildTileSet(const std::string& ways_file, const std::string& way_nodes_fil
       graphtile.StoreTileData();
 
       // Made a tile
-      LOG_DEBUG((boost::format("Wrote tile %1%: %2% bytes") % tile_start->first % graphtile.header_builder().end_offset()).str());
+      LOG_DEBUG((boost::format("Wrote tile %1%: %2% bytes") % tile_start->tile_id % graphtile.header_builder().end_offset()).str());
     }// Whatever happens in Vegas..
     catch(std::exception& e) {
       // ..gets sent back to the main thread
       result.set_exception(std::current_exception());
-      LOG_ERROR((boost::format("Failed tile %1%: %2%") % tile_start->first % e.what()).str());
+      LOG_ERROR((boost::format("Failed tile %1%: %2%") % tile_start->tile_id % e.what()).str());
       return;
     }
   }
@@ -970,21 +994,70 @@ void BuildLocalTiles(const unsigned int thread_count, const OSMData& osmdata,
   const std::map<GraphId, size_t>& tiles, const std::string& tile_dir, DataQuality& stats,
   const std::unique_ptr<const valhalla::skadi::sample>& sample, const boost::property_tree::ptree& pt) {
 
-  auto tz = DateTime::get_tz_db().from_index(DateTime::get_tz_db().to_index("America/New_York"));
-  uint32_t tile_creation_date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(DateTime::iso_date_time(tz)));
+  // Tiles are stamped with the day they are built unless a date is given, so
+  // rebuilding the same data gives the same tiles
+  auto creation_date = pt.get<std::string>("mjolnir.tile_creation_date", "");
+  if (creation_date.empty()) {
+    auto tz = DateTime::get_tz_db().from_index(DateTime::get_tz_db().to_index("America/New_York"));
+    creation_date = DateTime::iso_date_time(tz);
+  }
+  uint32_t tile_creation_date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(creation_date));
 
   LOG_INFO("Building " + std::to_string(tiles.size()) + " tiles with " + std::to_string(thread_count) + " threads...");
 
+  // Map the packed admins once for all the threads, if there are any
+  std::unique_ptr<PackedAdmins> packed_admins;
+  auto packed = pt.get_optional<std::string>("mjolnir.admin_packed");
+  if (packed && boost::filesystem::exists(*packed)) {
+    try {
+      packed_admins.reset(new PackedAdmins(*packed));
+      LOG_INFO("Mapped " + std::to_string(packed_admins->size()) + " packed admins from " + *packed);
+    }
+    catch (const std::exception& e) {
+      LOG_ERROR(std::string(e.what()) + ".  Using the admin db instead.");
+    }
+  }
+
   // A place to hold worker threads and their results, be they exceptions or otherwise
   std::vector<std::shared_ptr<std::thread> > threads(thread_count);
 
   // Hold the results (DataQuality/stats) for the threads
   std::vector<std::promise<DataQuality> > results(threads.size());
 
+  // The tiles to build and how many nodes each has
+  size_t node_count = sequence<Node>(nodes_file, false).size();
+  std::vector<tile_task_t> tasks;
+  tasks.reserve(tiles.size());
+  for (auto tile = tiles.cbegin(); tile != tiles.cend(); ++tile) {
+    auto next = std::next(tile);
+    tasks.push_back({tile->first, tile->second,
+                     (next == tiles.cend() ? node_count : next->second) - tile->second});
+  }
+
+  // With elevation each thread samples with a cache of its own and builds the
+  // tiles within the same 1 degree elevation tile one after the other, so it
+  // decompresses each elevation tile once rather than once per row of tiles
+  std::vector<std::unique_ptr<const valhalla::skadi::sample> > samples(threads.size());
+  if (sample) {
+    auto cache_size = pt.get<size_t>("additional_data.elevation_cache_size",
+                                     valhalla::skadi::sample::kDefaultCacheSize);
+    for (auto& thread_sample : samples)
+      thread_sample.reset(new valhalla::skadi::sample(*sample, cache_size));
+    const auto& tiling = TileHierarchy::levels().rbegin()->second.tiles;
+    const auto cell = [&tiling](const GraphId& tile_id) {
+      auto center = tiling.TileBounds(tile_id.tileid()).Center();
+      return std::make_pair(std::floor(center.lat()), std::floor(center.lng()));
+    };
+    std::stable_sort(tasks.begin(), tasks.end(),
+      [&cell](const tile_task_t& a, const tile_task_t& b) {
+        return cell(a.tile_id) < cell(b.tile_id);
+      });
+  }
+
   // Divvy up the work
-  size_t floor = tiles.size() / threads.size();
-  size_t at_ceiling = tiles.size() - (threads.size() * floor);
-  std::map<GraphId, size_t>::const_iterator tile_start, tile_end = tiles.begin();
+  size_t floor = tasks.size() / threads.size();
+  size_t at_ceiling = tasks.size() - (threads.size() * floor);
+  std::vector<tile_task_t>::const_iterator tile_start, tile_end = tasks.begin();
 
   // Atomically pass around stats info
   for (size_t i = 0; i < threads.size(); ++i) {
@@ -999,8 +1072,8 @@ void BuildLocalTiles(const unsigned int thread_count, const OSMData& osmdata,
       new std::thread(BuildTileSet,  std::cref(ways_file), std::cref(way_nodes_file),
                       std::cref(nodes_file), std::cref(edges_file),
                       std::cref(complex_restriction_file), std::cref(tile_dir),
-                      std::cref(osmdata), std::cref(sample), tile_start, tile_end, tile_creation_date,
-                      std::cref(pt.get_child("mjolnir")), std::ref(results[i]))
+                      std::cref(osmdata), std::cref(samples[i]), tile_start, tile_end, tile_creation_date,
+                      packed_admins.get(), std::cref(pt.get_child("mjolnir")), std::ref(results[i]))
     );
   }
 
@@ -1043,21 +1116,36 @@ void GraphBuilder::Build(const boost::property_tree::ptree& pt, const OSMData& o
   const auto& tl = TileHierarchy::levels().rbegin();
   uint8_t level = tl->second.level;
 
-  // Make the edges and nodes in the graph
-  ConstructEdges(osmdata, ways_file, way_nodes_file, nodes_file, edges_file, tl->second.tiles.TileSize(),
-    [&level](const OSMNode& node) {
-      return TileHierarchy::GetGraphId({node.lng, node.lat}, level);
+  // Make the edges and nodes in the graph. Optionally lay out the nodes (and so
+  // their edges) within each tile along a hilbert curve rather than by osm id so
+  // the nodes and edges a path expansion visits in a row are close in the tile
+  bool hilbert_order = pt.get<bool>("mjolnir.hilbert_order", false);
+  const auto& local_tiles = tl->second.tiles;
+  ConstructEdges(osmdata, ways_file, way_nodes_file, nodes_file, edges_file, local_tiles.TileSize(),
+    [&level, &local_tiles, hilbert_order](const OSMNode& node) {
+      auto graph_id = TileHierarchy::GetGraphId({node.lng, node.lat}, level);
+      if (hilbert_order) {
+        auto bounds = local_tiles.TileBounds(graph_id.tileid());
+        auto cell = [](const float offset, const float size) {
+          return std::min(static_cast<uint32_t>(std::max(0.0f, offset / size * kHilbertCells)),
+                          kHilbertCells - 1);
+        };
+        graph_id.set_id(hilbert_index(kHilbertOrder, cell(node.lng - bounds.minx(), bounds.Width()),
+                                      cell(node.lat - bounds.miny(), bounds.Height())));
+      }
+      return graph_id;
     }
   );
 
   // Line up the nodes and then re-map the edges that the edges to them
-  auto tiles = SortGraph(nodes_file, edges_file, level);
+  auto tiles = SortGraph(nodes_file, edges_file, level,
+    pt.get<size_t>("mjolnir.sort_memory", 1024 * 1024 * 512), threads);
 
   // Reclassify links (ramps). Cannot do this when building tiles since the
   // edge list needs to be modified
   DataQuality stats;
   if (pt.get<bool>("mjolnir.reclassify_links", true)) {
-    ReclassifyLinks(ways_file, nodes_file, edges_file, way_nodes_file);
+    ReclassifyLinks(ways_file, nodes_file, edges_file, way_nodes_file, threads);
   } else {
     LOG_WARN("Not reclassifying link graph edges");
   }
@@ -1070,13 +1158,14 @@ void GraphBuilder::Build(const boost::property_tree::ptree& pt, const OSMData& o
     }
   }
   ReclassifyFerryConnections(ways_file, way_nodes_file, nodes_file, edges_file,
-                             static_cast<uint32_t>(rc), stats);
+                             static_cast<uint32_t>(rc), stats, threads);
 
   // Crack open some elevation data if its there
   boost::optional<std::string> elevation = pt.get_optional<std::string>("additional_data.elevation");
   std::unique_ptr<const skadi::sample> sample;
   if(elevation && boost::filesystem::exists(*elevation))
-    sample.reset(new skadi::sample(*elevation));
+    sample.reset(new skadi::sample(*elevation,
+        pt.get<size_t>("additional_data.elevation_cache_size", skadi::sample::kDefaultCacheSize)));
 
   // Build tiles at the local level. Form connected graph from nodes and edges.
   BuildLocalTiles(threads, osmdata, ways_file, way_nodes_file, nodes_file,
@@ -1135,7 +1224,7 @@ std::vector<SignInfo> GraphBuilder::CreateExitSignInfoList(
       exit_list.emplace_back(Sign::Type::kExitNumber, j_ref);
   }  else if (node.ref() && !fork) {
     std::vector<std::string> n_refs = GetTagTokens(
-        osmdata.node_ref.find(node.osmid)->second);
+        osmdata.ref_offset_map.name(osmdata.node_ref.find(node.osmid)));
     for (auto& n_ref : n_refs)
       exit_list.emplace_back(Sign::Type::kExitNumber, n_ref);
   }
@@ -1211,7 +1300,7 @@ std::vector<SignInfo> GraphBuilder::CreateExitSignInfoList(
       std::string tmp;
       std::size_t pos;
       std::vector<std::string> exit_tos = GetTagTokens(
-          osmdata.node_exit_to.find(node.osmid)->second);
+          osmdata.name_offset_map.name(osmdata.node_exit_to.find(node.osmid)));
       for (auto& exit_to : exit_tos) {
 
         tmp = exit_to;
@@ -1267,7 +1356,7 @@ std::vector<SignInfo> GraphBuilder::CreateExitSignInfoList(
   // Exit sign name
   if (node.name() && !fork) {
     std::vector<std::string> names = GetTagTokens(
-            osmdata.node_name.find(node.osmid)->second);
+            osmdata.name_offset_map.name(osmdata.node_name.find(node.osmid)));
     for (auto& name : names) {
       exit_list.emplace_back(Sign::Type::kExitName, name);
     }
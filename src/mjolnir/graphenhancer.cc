@@ -41,6 +41,7 @@
 #include "baldr/streetnames_factory.h"
 #include "baldr/streetnames_us.h"
 #include "baldr/admininfo.h"
+#include "baldr/filesystem_utils.h"
 #include "baldr/datetime.h"
 #include "mjolnir/osmaccess.h"
 
@@ -68,6 +69,8 @@ constexpr float kDensityRadius  = 2.0f;
 constexpr float kDensityRadius2 = kDensityRadius * kDensityRadius;
 constexpr float kDensityLatDeg  = (kDensityRadius * kMetersPerKm) /
                                       kMetersPerDegreeLat;
+// Cells of the density grid across the density radius
+constexpr float kDensityCellsPerRadius = 8.0f;
 
 // Factors used to adjust speed assignments
 constexpr float kTurnChannelFactor = 1.25f;
@@ -445,51 +448,52 @@ bool IsIntersectionInternal(GraphReader& reader, std::mutex& lock,
 }
 
 /**
- * Get the road density around the specified lat,lng position. This is a
- * value from 0-15 indicating a relative road density. This can be used
- * in costing methods to help avoid dense, urban areas.
- * @param  reader        Graph reader
- * @param  lock          Mutex for locking while tiles are retrieved
- * @param  ll            Lat,lng position
- * @param  maxdensity    (OUT) max density found
- * @param  tiles         Tiling (for getting list of required tiles)
- * @param  local_level   Level of the local tiles.
- * @return  Returns the relative road density (0-15) - higher values are
- *          more dense.
+ * Road lengths around a tile summed into a uniform grid of cells, so the road
+ * density around each node of the tile is read from the grid rather than by
+ * going over every node of the tiles near it. Each row keeps the running sum
+ * of its cells, so the lengths within the density radius of a position are
+ * the sums of a span of cells of each row the radius reaches.
  */
-uint32_t GetDensity(GraphReader& reader, std::mutex& lock, const PointLL& ll,
-                    enhancer_stats& stats, const Tiles<PointLL>& tiles,
-                    uint8_t local_level) {
-  // Radius is in km - turn into meters
-  float rm = kDensityRadius * kMetersPerKm;
-  float mr2 = rm * rm;
-
-  // Use distance approximator for all distance checks
-  DistanceApproximator approximator(ll);
-
-  // Get a list of tiles required for a node search within this radius
-  float lngdeg = (rm / DistanceApproximator::MetersPerLngDegree(ll.lat()));
-  AABB2<PointLL> bbox(Point2(ll.lng() - lngdeg, ll.lat() - kDensityLatDeg),
-                      Point2(ll.lng() + lngdeg, ll.lat() + kDensityLatDeg));
-  std::vector<int32_t> tilelist = tiles.TileList(bbox);
-
-  // For all tiles needed to find nodes within the radius...find nodes within
-  // the radius (squared) and add lengths of directed edges
-  float roadlengths = 0.0f;
-  for (auto t : tilelist) {
-    // Check all the nodes within the tile. Skip if tile has no nodes (can be
-    // an empty tile added for connectivity map logic).
-    lock.lock();
-    const GraphTile* newtile = reader.GetGraphTile(GraphId(t, local_level, 0));
-    lock.unlock();
-    if (!newtile || newtile->header()->nodecount() == 0)
-      continue;
-    const auto start_node = newtile->node(0);
-    const auto end_node   = start_node + newtile->header()->nodecount();
-    for (auto node = start_node; node < end_node; ++node) {
-      // Check if within radius
-      if (approximator.DistanceSquared(node->latlng()) < mr2) {
-        // Get all directed edges and add length
+class DensityGrid {
+ public:
+  /**
+   * Sum the road lengths of the nodes within the density radius of a tile.
+   * @param  reader        Graph reader
+   * @param  lock          Mutex for locking while tiles are retrieved
+   * @param  tiles         Tiling (for getting list of required tiles)
+   * @param  local_level   Level of the local tiles.
+   * @param  tile_bounds   Bounds of the tile whose nodes get their density
+   */
+  DensityGrid(GraphReader& reader, std::mutex& lock, const Tiles<PointLL>& tiles,
+              const uint8_t local_level, const AABB2<PointLL>& tile_bounds) {
+    // The widest the radius gets in longitude is at the latitude of the tile
+    // furthest from the equator
+    float rm = kDensityRadius * kMetersPerKm;
+    float lat = std::max(std::fabs(tile_bounds.miny()), std::fabs(tile_bounds.maxy()));
+    float lngdeg = rm / DistanceApproximator::MetersPerLngDegree(std::min(lat, 89.0f));
+    bounds_ = AABB2<PointLL>(tile_bounds.minx() - lngdeg, tile_bounds.miny() - kDensityLatDeg,
+                             tile_bounds.maxx() + lngdeg, tile_bounds.maxy() + kDensityLatDeg);
+    cell_lat_ = kDensityLatDeg / kDensityCellsPerRadius;
+    cell_lng_ = lngdeg / kDensityCellsPerRadius;
+    rows_ = static_cast<int32_t>(std::ceil(bounds_.Height() / cell_lat_));
+    cols_ = static_cast<int32_t>(std::ceil(bounds_.Width() / cell_lng_));
+    sums_.assign(rows_ * (cols_ + 1), 0.0f);
+
+    // Add the lengths of the roads leaving each node to its cell
+    for (auto t : tiles.TileList(bounds_)) {
+      // Skip if tile has no nodes (can be an empty tile added for
+      // connectivity map logic).
+      lock.lock();
+      const GraphTile* newtile = reader.GetGraphTile(GraphId(t, local_level, 0));
+      lock.unlock();
+      if (!newtile || newtile->header()->nodecount() == 0)
+        continue;
+      const auto start_node = newtile->node(0);
+      const auto end_node   = start_node + newtile->header()->nodecount();
+      for (auto node = start_node; node < end_node; ++node) {
+        int32_t row, col;
+        if (!Cell(node->latlng(), row, col))
+          continue;
         const DirectedEdge* directededge = newtile->directededge(node->edge_index());
         for (uint32_t i = 0; i < node->edge_count(); i++, directededge++) {
           // Exclude non-roads (parking, walkways, ferries, etc.)
@@ -498,27 +502,78 @@ uint32_t GetDensity(GraphReader& reader, std::mutex& lock, const PointLL& ll,
               directededge->use() == Use::kTurnChannel ||
               directededge->use() == Use::kAlley ||
               directededge->use() == Use::kEmergencyAccess) {
-            roadlengths += directededge->length();
+            sums_[row * (cols_ + 1) + col + 1] += directededge->length();
           }
         }
       }
     }
+    for (int32_t row = 0; row < rows_; ++row) {
+      float* sums = sums_.data() + row * (cols_ + 1);
+      for (int32_t col = 1; col <= cols_; ++col)
+        sums[col] += sums[col - 1];
+    }
   }
 
-  // Form density measure as km/km^2. Convert roadlengths to km and divide by 2
-  // (since 2 directed edges per edge)
-  float density = (roadlengths * 0.0005f) / (kPi * kDensityRadius2);
-  if (density > stats.max_density)
-    stats.max_density = density;
+  /**
+   * Get the road density around the specified lat,lng position. This is a
+   * value from 0-15 indicating a relative road density. This can be used
+   * in costing methods to help avoid dense, urban areas. The roads counted
+   * are those of the cells whose centers are within the radius.
+   * @param  ll     Lat,lng position, within the tile of the grid
+   * @param  stats  Stats getting the max density and density counts
+   * @return  Returns the relative road density (0-15) - higher values are
+   *          more dense.
+   */
+  uint32_t Density(const PointLL& ll, enhancer_stats& stats) const {
+    float rm = kDensityRadius * kMetersPerKm;
+    float meters_per_lng = DistanceApproximator::MetersPerLngDegree(ll.lat());
+    float roadlengths = 0.0f;
+    for (int32_t row = 0; row < rows_; ++row) {
+      float dy = (bounds_.miny() + (row + 0.5f) * cell_lat_ - ll.lat()) * kMetersPerDegreeLat;
+      if (std::fabs(dy) >= rm)
+        continue;
+      float half = std::sqrt(rm * rm - dy * dy) / meters_per_lng;
+      int32_t first = std::max(0, static_cast<int32_t>(
+          std::ceil((ll.lng() - half - bounds_.minx()) / cell_lng_ - 0.5f)));
+      int32_t last = std::min(cols_ - 1, static_cast<int32_t>(
+          std::floor((ll.lng() + half - bounds_.minx()) / cell_lng_ - 0.5f)));
+      if (first <= last) {
+        const float* sums = sums_.data() + row * (cols_ + 1);
+        roadlengths += sums[last + 1] - sums[first];
+      }
+    }
+
+    // Form density measure as km/km^2. Convert roadlengths to km and divide by 2
+    // (since 2 directed edges per edge)
+    float density = (roadlengths * 0.0005f) / (kPi * kDensityRadius2);
+    if (density > stats.max_density)
+      stats.max_density = density;
 
-  // Convert density into a relative value from 0-16.
-  uint32_t relative_density = std::round(density * 0.7f);
-  if (relative_density > 15) {
-    relative_density = 15;
+    // Convert density into a relative value from 0-16.
+    uint32_t relative_density = std::round(density * 0.7f);
+    if (relative_density > 15) {
+      relative_density = 15;
+    }
+    stats.density_counts[relative_density]++;
+    return relative_density;
   }
-  stats.density_counts[relative_density]++;
-  return relative_density;
-}
+
+ protected:
+  // Cell of a position, false if it is off the grid
+  bool Cell(const PointLL& ll, int32_t& row, int32_t& col) const {
+    row = static_cast<int32_t>(std::floor((ll.lat() - bounds_.miny()) / cell_lat_));
+    col = static_cast<int32_t>(std::floor((ll.lng() - bounds_.minx()) / cell_lng_));
+    return row >= 0 && row < rows_ && col >= 0 && col < cols_;
+  }
+
+  AABB2<PointLL> bounds_;
+  float cell_lat_;
+  float cell_lng_;
+  int32_t rows_;
+  int32_t cols_;
+  // Running sums of the road lengths of each row, the first of a row being 0
+  std::vector<float> sums_;
+};
 
 /**
  * Returns true if edge transition is a pencil point u-turn, false otherwise.
@@ -912,6 +967,18 @@ bool ConsistentNames(const std::string& country_code,
 
 // We make sure to lock on reading and writing because we dont want to race
 // since difference threads, use for the tilequeue as well
+// Get the directory enhanced tiles are staged in. Tiles are enhanced from
+// their neighbours (access, classification, ...) so for reproducible builds
+// every tile has to be enhanced from its neighbours as they were built rather
+// than from whichever of them another thread has already enhanced. Empty
+// when tiles are enhanced in place.
+std::string StagingDir(const boost::property_tree::ptree& pt) {
+  if (!pt.get<bool>("reproducible", false)) {
+    return "";
+  }
+  return pt.get<std::string>("tile_dir") + filesystem::path_separator + "enhancing";
+}
+
 void enhance(const boost::property_tree::ptree& pt,
              const std::string& access_file,
              const boost::property_tree::ptree& hierarchy_properties,
@@ -950,6 +1017,10 @@ void enhance(const boost::property_tree::ptree& pt,
   const auto& local_level = TileHierarchy::levels().rbegin()->second.level;
   const auto& tiles = TileHierarchy::levels().rbegin()->second.tiles;
 
+  // Where enhanced tiles are written until all tiles are enhanced, empty to
+  // write them in place
+  const std::string staging_dir = StagingDir(hierarchy_properties);
+
   // Iterate through the tiles in the queue and perform enhancements
   while (true) {
     // Get the next tile Id from the queue and get writeable and readable
@@ -1018,13 +1089,13 @@ void enhance(const boost::property_tree::ptree& pt,
     }
 
     // Second pass - add admin information and edge transition information.
+    DensityGrid density_grid(reader, lock, tiles, local_level, tiles.TileBounds(id));
     for (uint32_t i = 0; i < tilebuilder.header()->nodecount(); i++) {
       GraphId startnode(id, local_level, i);
       NodeInfo& nodeinfo = tilebuilder.node_builder(i);
 
       // Get relative road density and local density
-      uint32_t density = GetDensity(reader, lock, nodeinfo.latlng(),
-                                    stats, tiles, local_level);
+      uint32_t density = density_grid.Density(nodeinfo.latlng(), stats);
       nodeinfo.set_density(density);
 
       uint32_t admin_index = nodeinfo.admin_index();
@@ -1275,7 +1346,11 @@ void enhance(const boost::property_tree::ptree& pt,
 
     // Write the new file
     lock.lock();
-    tilebuilder.StoreTileData();
+    if (staging_dir.empty()) {
+      tilebuilder.StoreTileData();
+    } else {
+      tilebuilder.StoreTileData(staging_dir);
+    }
     LOG_TRACE((boost::format("GraphEnhancer completed tile %1%") % tile_id).str());
 
     // Check if we need to clear the tile cache
@@ -1340,6 +1415,20 @@ void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
     thread->join();
   }
 
+  // Move the staged tiles over the ones they were enhanced from
+  const std::string staging_dir = StagingDir(hierarchy_properties);
+  if (!staging_dir.empty()) {
+    for (const auto& tile_id : local_tiles) {
+      boost::filesystem::path staged(staging_dir + filesystem::path_separator +
+                                     GraphTile::FileSuffix(tile_id));
+      if (boost::filesystem::exists(staged)) {
+        boost::filesystem::rename(staged, reader.tile_dir() + filesystem::path_separator +
+                                  GraphTile::FileSuffix(tile_id));
+      }
+    }
+    boost::filesystem::remove_all(staging_dir);
+  }
+
   // Check all of the outcomes, to see about maximum density (km/km2)
   enhancer_stats stats{std::numeric_limits<float>::min(), 0};
   for (auto& result : results) {
@@ -5,15 +5,43 @@
 #include "baldr/edgeinfo.h"
 #include "baldr/filesystem_utils.h"
 #include "baldr/tilehierarchy.h"
+#include "baldr/transitpattern.h"
+#include "midgard/encoded.h"
 #include <boost/format.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <stdexcept>
 #include <set>
 #include <list>
 #include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <limits>
 
 using namespace valhalla::baldr;
 
+namespace {
+
+// Write the speed profile index of the directed edges, padded so the
+// profiles stay aligned, followed by the profiles. Returns the bytes written,
+// nothing is written if there are no profiles
+uint32_t SerializeSpeedProfiles(std::ostream& out, const std::vector<SpeedProfile>& profiles,
+                                const std::vector<uint16_t>& index,
+                                const uint32_t directededgecount) {
+  if (profiles.empty())
+    return 0;
+  if (profiles.size() > kMaxSpeedProfiles)
+    throw std::runtime_error("Too many speed profiles in a tile: " + std::to_string(profiles.size()));
+  if (index.size() != directededgecount)
+    LOG_ERROR("Speed profile index count is not equal to directed edge count!");
+  std::vector<uint16_t> padded(index);
+  padded.resize(SpeedProfileIndexSize(directededgecount) / sizeof(uint16_t), kNoSpeedProfile);
+  out.write(reinterpret_cast<const char*>(padded.data()), padded.size() * sizeof(uint16_t));
+  out.write(reinterpret_cast<const char*>(profiles.data()), profiles.size() * sizeof(SpeedProfile));
+  return padded.size() * sizeof(uint16_t) + profiles.size() * sizeof(SpeedProfile);
+}
+
+}
+
 namespace valhalla {
 namespace mjolnir {
 
@@ -35,9 +63,7 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
 
   // Done if not deserializing and creating builders for everything
   if (!deserialize) {
-    textlistbuilder_.emplace_back("");
-    text_offset_map_.emplace("", 0);
-    text_list_offset_ = 1;
+    AppendName("", std::hash<std::string>()(""));
 
     // Add a dummy admin record at index 0 to be used if admin records are
     // not used/created or if none is found.
@@ -63,7 +89,7 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
   }
 
   // Create transit builders and add any text offsets to the set
-  for (uint32_t i = 0; i < header_->departurecount(); i++) {
+  for (uint32_t i = 0; i < departure_count_; i++) {
     departure_builder_.emplace_back(std::move(departures_[i]));
     name_info.insert({departures_[i].headsign_offset()});
   }
@@ -171,8 +197,10 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
           " size = " + std::to_string(complex_restriction_reverse_size_));
   }
 
-  // EdgeInfo. Create list of EdgeInfoBuilders. Add to text offset set.
+  // EdgeInfo. Serialize EdgeInfoBuilders into the buffer. Add to text
+  // offset set.
   edge_info_offset_ = 0;
+  edgeinfo_buffer_.reserve(edgeinfo_size_);
   for (auto offset : edge_info_offsets) {
     // Verify the offsets match as we create the edge info builder list
     if (offset != edge_info_offset_) {
@@ -192,25 +220,21 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
     }
     eib.set_encoded_shape(ei.encoded_shape());
     edge_info_offset_ += eib.SizeOf();
-    edgeinfo_list_.emplace_back(std::move(eib));
+    eib.AppendTo(edgeinfo_buffer_);
   }
 
   // Text list
+  textlist_buffer_.reserve(textlist_size_);
   for (auto ni : name_info) {
     // Verify offsets as we add text. Identify any strings in the text list
     // that are not referenced by any objects.
     while (ni.name_offset_ != text_list_offset_) {
       std::string unused_string(textlist_ + text_list_offset_);
-      textlistbuilder_.push_back(unused_string);
-      text_offset_map_.emplace(unused_string, text_list_offset_);
-      text_list_offset_ += unused_string.length() + 1;
+      AppendName(unused_string, std::hash<std::string>()(unused_string));
       LOG_WARN("Unused text string: " + unused_string);
     }
     std::string str(textlist_ + ni.name_offset_);
-    textlistbuilder_.push_back(str);
-    uint32_t offset = ni.name_offset_;
-    text_offset_map_.emplace(str, offset);
-    text_list_offset_ += str.length() + 1;
+    AppendName(str, std::hash<std::string>()(str));
   }
 
   // Lane connectivity
@@ -228,12 +252,32 @@ GraphTileBuilder::GraphTileBuilder(const std::string& tile_dir,
     std::copy(edge_elevation_, edge_elevation_ + n,
         std::back_inserter(edge_elevation_builder_));
   }
+
+  // Historical speed profiles
+  if (has_speed_profiles()) {
+    speed_profile_builder_.assign(speed_profiles_, speed_profiles_ + speed_profile_count_);
+    speed_profile_index_builder_.assign(speed_profile_index_,
+        speed_profile_index_ + header_->directededgecount());
+  }
+
+  // Base edges of the shortcut edges, without the entry marking the end
+  if (has_shortcut_edges()) {
+    shortcut_edges_index_builder_.assign(shortcut_edges_index_,
+        shortcut_edges_index_ + shortcut_edges_index_count_ - 1);
+    shortcut_base_edges_builder_.assign(shortcut_base_edges_,
+        shortcut_base_edges_ + shortcut_edges_index_[shortcut_edges_index_count_ - 1].first_edge);
+  }
 }
 
 // Output the tile to file. Stores as binary data.
 void GraphTileBuilder::StoreTileData() {
+  StoreTileData(tile_dir_);
+}
+
+// Output the tile to file under another tile directory. Stores as binary data.
+void GraphTileBuilder::StoreTileData(const std::string& tile_dir) {
   // Get the name of the file
-  boost::filesystem::path filename(tile_dir_ + filesystem::path_separator
+  boost::filesystem::path filename(tile_dir + filesystem::path_separator
       + GraphTile::FileSuffix(header_builder_.graphid()));
 
   // Make sure the directory exists on the system
@@ -261,11 +305,22 @@ void GraphTileBuilder::StoreTileData() {
     in_mem.write(reinterpret_cast<const char*>(access_restriction_builder_.data()),
                access_restriction_builder_.size() * sizeof(AccessRestriction));
 
-    // Sort and write the transit departures
-    header_builder_.set_departurecount(departure_builder_.size());
+    // Sort the transit departures and write the ones not stored in a
+    // schedule pattern, then the patterns and their trips
     std::sort(departure_builder_.begin(), departure_builder_.end());
-    in_mem.write(reinterpret_cast<const char*>(departure_builder_.data()),
-               departure_builder_.size() * sizeof(TransitDeparture));
+    std::vector<TransitDeparture> departures;
+    std::vector<TransitPattern> patterns;
+    std::vector<PatternTrip> pattern_trips;
+    TransitPattern::Encode(departure_builder_, departures, patterns, pattern_trips);
+    header_builder_.set_departurecount(departures.size());
+    in_mem.write(reinterpret_cast<const char*>(departures.data()),
+               departures.size() * sizeof(TransitDeparture));
+    header_builder_.set_departure_pattern_count(patterns.size());
+    in_mem.write(reinterpret_cast<const char*>(patterns.data()),
+               patterns.size() * sizeof(TransitPattern));
+    header_builder_.set_pattern_trip_count(pattern_trips.size());
+    in_mem.write(reinterpret_cast<const char*>(pattern_trips.data()),
+               pattern_trips.size() * sizeof(PatternTrip));
 
     // Sort write the transit stops
     header_builder_.set_stopcount(stop_builder_.size());
@@ -303,7 +358,9 @@ void GraphTileBuilder::StoreTileData() {
              + (nodes_builder_.size() * sizeof(NodeInfo))
              + (directededges_builder_.size() * sizeof(DirectedEdge))
              + (access_restriction_builder_.size() * sizeof(AccessRestriction))
-             + (departure_builder_.size() * sizeof(TransitDeparture))
+             + (departures.size() * sizeof(TransitDeparture))
+             + (patterns.size() * sizeof(TransitPattern))
+             + (pattern_trips.size() * sizeof(PatternTrip))
              + (stop_builder_.size() * sizeof(TransitStop))
              + (route_builder_.size() * sizeof(TransitRoute))
              + (schedule_builder_.size() * sizeof(TransitSchedule))
@@ -324,14 +381,12 @@ void GraphTileBuilder::StoreTileData() {
     header_builder_.set_edgeinfo_offset(
             header_builder_.complex_restriction_reverse_offset() +
             complex_restriction_reverse_list_offset_);
-    for (const auto& edgeinfo : edgeinfo_list_)
-      in_mem << edgeinfo;
+    in_mem.write(edgeinfo_buffer_.data(), edgeinfo_buffer_.size());
 
     // Write the names
     header_builder_.set_textlist_offset(
             header_builder_.edgeinfo_offset() + edge_info_offset_);
-    for (const auto& text : textlistbuilder_)
-      in_mem << text << '\0';
+    in_mem.write(textlist_buffer_.data(), textlist_buffer_.size());
 
     // Add padding (if needed) to align to 8-byte word.
     int tmp = in_mem.tellp() % 8;
@@ -366,9 +421,63 @@ void GraphTileBuilder::StoreTileData() {
                          edge_elevation_builder_.size() * sizeof(EdgeElevation));
     }
 
-    // Set the end offset
-    header_builder_.set_end_offset(header_builder_.edge_elevation_offset() +
+    // Write the bounding boxes of the directed edges
+    header_builder_.set_edge_bbox_offset(header_builder_.edge_elevation_offset() +
       (edge_elevation_builder_.size() * sizeof(EdgeElevation)));
+    auto edge_bboxes = EdgeBBoxes();
+    in_mem.write(reinterpret_cast<const char*>(edge_bboxes.data()),
+                 edge_bboxes.size() * sizeof(EdgeBBox));
+
+    // Write the hot edges
+    header_builder_.set_hotedge_offset(header_builder_.edge_bbox_offset() +
+      (edge_bboxes.size() * sizeof(EdgeBBox)));
+    std::vector<HotEdge> hotedges(directededges_builder_.begin(), directededges_builder_.end());
+    in_mem.write(reinterpret_cast<const char*>(hotedges.data()),
+                 hotedges.size() * sizeof(HotEdge));
+
+    // Write the historical speed profiles, the index of the directed edges
+    // padded to keep the profiles aligned then the profiles
+    header_builder_.set_speed_profile_offset(header_builder_.hotedge_offset() +
+      (hotedges.size() * sizeof(HotEdge)));
+    uint32_t speed_profile_size = SerializeSpeedProfiles(in_mem, speed_profile_builder_,
+        speed_profile_index_builder_, directededges_builder_.size());
+
+    // Write where the signs, access restrictions and lane connections of
+    // each directed edge start
+    header_builder_.set_edge_attribute_index_offset(header_builder_.speed_profile_offset() +
+                                                    speed_profile_size);
+    auto edge_attribute_index = EdgeAttributeIndex::Build(signs_builder_.data(), signs_builder_.size(),
+        access_restriction_builder_.data(), access_restriction_builder_.size(),
+        lane_connectivity_builder_.data(), lane_connectivity_builder_.size(),
+        directededges_builder_.size());
+    in_mem.write(reinterpret_cast<const char*>(edge_attribute_index.data()),
+                 edge_attribute_index.size() * sizeof(EdgeAttributeIndex));
+
+    // Fixed point shapes are only added to finished tiles, they go in here
+    header_builder_.set_fixed_shape_offset(header_builder_.edge_attribute_index_offset() +
+        edge_attribute_index.size() * sizeof(EdgeAttributeIndex));
+
+    // Write the base edges of the shortcut edges, the number of index
+    // entries then the index of the shortcuts then the base edges
+    header_builder_.set_shortcut_edges_offset(header_builder_.fixed_shape_offset());
+    uint32_t shortcut_edges_size = 0;
+    if (!shortcut_edges_index_builder_.empty()) {
+      uint32_t count = shortcut_edges_index_builder_.size() + 1, spare = 0;
+      ShortcutEdgesIndex last{std::numeric_limits<uint32_t>::max(),
+                              static_cast<uint32_t>(shortcut_base_edges_builder_.size())};
+      in_mem.write(reinterpret_cast<const char*>(&count), sizeof(uint32_t));
+      in_mem.write(reinterpret_cast<const char*>(&spare), sizeof(uint32_t));
+      in_mem.write(reinterpret_cast<const char*>(shortcut_edges_index_builder_.data()),
+                   shortcut_edges_index_builder_.size() * sizeof(ShortcutEdgesIndex));
+      in_mem.write(reinterpret_cast<const char*>(&last), sizeof(ShortcutEdgesIndex));
+      in_mem.write(reinterpret_cast<const char*>(shortcut_base_edges_builder_.data()),
+                   shortcut_base_edges_builder_.size() * sizeof(GraphId));
+      shortcut_edges_size = 2 * sizeof(uint32_t) + count * sizeof(ShortcutEdgesIndex) +
+                            shortcut_base_edges_builder_.size() * sizeof(GraphId);
+    }
+
+    // Set the end offset
+    header_builder_.set_end_offset(header_builder_.shortcut_edges_offset() + shortcut_edges_size);
 
     // Sanity check for the end offset
     uint32_t curr = static_cast<uint32_t>(in_mem.tellp()) +
@@ -392,6 +501,35 @@ void GraphTileBuilder::StoreTileData() {
   }
 }
 
+// Bounding boxes of the shapes of the directed edges.
+std::vector<EdgeBBox> GraphTileBuilder::EdgeBBoxes() const {
+  // The box of each edge info, by its offset
+  auto tile_box = GraphTile::BoundingBox(header_builder_.graphid());
+  std::unordered_map<uint32_t, EdgeBBox> boxes;
+
+  // Both directions of an edge share the edge info so each one is only
+  // decoded once
+  std::vector<EdgeBBox> edge_bboxes;
+  edge_bboxes.reserve(directededges_builder_.size());
+  for (const auto& directededge : directededges_builder_) {
+    uint32_t offset = directededge.edgeinfo_offset();
+    auto box = boxes.find(offset);
+    if (box == boxes.end()) {
+      EdgeBBox edge_bbox;
+      if (offset < edgeinfo_buffer_.size()) {
+        EdgeInfo edgeinfo(const_cast<char*>(edgeinfo_buffer_.data()) + offset,
+                          textlist_buffer_.data(), textlist_buffer_.size());
+        const auto& shape = edgeinfo.shape();
+        if (!shape.empty())
+          edge_bbox = EdgeBBox(AABB2<PointLL>(shape), tile_box);
+      }
+      box = boxes.emplace(offset, edge_bbox).first;
+    }
+    edge_bboxes.emplace_back(box->second);
+  }
+  return edge_bboxes;
+}
+
 // Update a graph tile with new nodes and directed edges. The rest of the
 // tile contents remains the same.
 void GraphTileBuilder::Update(const std::vector<NodeInfo>& nodes,
@@ -426,10 +564,23 @@ void GraphTileBuilder::Update(const std::vector<NodeInfo>& nodes,
     file.write(reinterpret_cast<const char*>(directededges.data()),
                directededges.size() * sizeof(DirectedEdge));
 
-    // Write the rest of the tiles
+    // Write the rest of the tiles, with the hot edges of the updated
+    // directed edges if the tile has them
     auto begin = reinterpret_cast<const char*>(&access_restrictions_[0]);
     auto end = reinterpret_cast<const char*>(header()) + header()->end_offset();
-    file.write(begin, end - begin);
+    if (header()->speed_profile_offset() - header()->hotedge_offset() ==
+        directededges.size() * sizeof(HotEdge)) {
+      end = reinterpret_cast<const char*>(header()) + header()->hotedge_offset();
+      std::vector<HotEdge> hotedges(directededges.begin(), directededges.end());
+      file.write(begin, end - begin);
+      file.write(reinterpret_cast<const char*>(hotedges.data()),
+                 hotedges.size() * sizeof(HotEdge));
+      begin = reinterpret_cast<const char*>(header()) + header()->speed_profile_offset();
+      end = reinterpret_cast<const char*>(header()) + header()->end_offset();
+      file.write(begin, end - begin);
+    } else {
+      file.write(begin, end - begin);
+    }
     file.close();
   } else {
     throw std::runtime_error("GraphTileBuilder::Update - Failed to open file " + filename.string());
@@ -503,6 +654,14 @@ void GraphTileBuilder::AddLaneConnectivity(const std::vector<baldr::LaneConnecti
   lane_connectivity_offset_ += sizeof(baldr::LaneConnectivity) * lc.size();
 }
 
+// Add the base edges of a shortcut edge
+void GraphTileBuilder::AddShortcutBaseEdges(const uint32_t idx,
+                                            const std::vector<GraphId>& base_edges) {
+  shortcut_edges_index_builder_.push_back({idx, static_cast<uint32_t>(shortcut_base_edges_builder_.size())});
+  shortcut_base_edges_builder_.insert(shortcut_base_edges_builder_.end(), base_edges.begin(),
+                                      base_edges.end());
+}
+
 bool GraphTileBuilder::HasEdgeInfo(const uint32_t edgeindex, const baldr::GraphId& nodea,
                      const baldr::GraphId& nodeb, uint32_t& edge_info_offset) {
   auto edge_tuple_item = EdgeTuple(edgeindex, nodea, nodeb);
@@ -521,8 +680,13 @@ void GraphTileBuilder::UpdateComplexRestrictions(const std::list<ComplexRestrict
   if (forward) {
     complex_restriction_forward_list_offset_ = 0;
     complex_restriction_forward_builder_.clear();
-    // Add a new complex restrictions to the lists
+    // Add a new complex restrictions to the lists, those of the same to edge
+    // next to each other
     complex_restriction_forward_builder_ = complex_restriction_builder;
+    complex_restriction_forward_builder_.sort(
+        [](const ComplexRestrictionBuilder& a, const ComplexRestrictionBuilder& b) {
+          return a.to_id().value < b.to_id().value;
+        });
 
     for (const auto& crb : complex_restriction_builder) {
       // Update edge offset for next item
@@ -531,8 +695,13 @@ void GraphTileBuilder::UpdateComplexRestrictions(const std::list<ComplexRestrict
   } else {
     complex_restriction_reverse_list_offset_ = 0;
     complex_restriction_reverse_builder_.clear();
-    // Add a new complex restrictions to the lists
+    // Add a new complex restrictions to the lists, those of the same from
+    // edge next to each other
     complex_restriction_reverse_builder_ = complex_restriction_builder;
+    complex_restriction_reverse_builder_.sort(
+        [](const ComplexRestrictionBuilder& a, const ComplexRestrictionBuilder& b) {
+          return a.from_id().value < b.from_id().value;
+        });
 
     for (const auto& crb : complex_restriction_builder) {
       // Update edge offset for next item
@@ -555,9 +724,8 @@ uint32_t GraphTileBuilder::AddEdgeInfo(const uint32_t edgeindex,
   auto edge_tuple_item = EdgeTuple(edgeindex, nodea, nodeb);
   auto existing_edge_offset_item = edge_offset_map_.find(edge_tuple_item);
   if (existing_edge_offset_item == edge_offset_map_.end()) {
-    // Add a new EdgeInfo to the list and get a reference to it
-    edgeinfo_list_.emplace_back();
-    EdgeInfoBuilder& edgeinfo = edgeinfo_list_.back();
+    // Build the new EdgeInfo, it is serialized once it has its names
+    EdgeInfoBuilder edgeinfo;
     edgeinfo.set_wayid(wayid);
     edgeinfo.set_shape(lls);
 
@@ -586,6 +754,7 @@ uint32_t GraphTileBuilder::AddEdgeInfo(const uint32_t edgeindex,
       location++;
     }
     edgeinfo.set_name_info_list(name_info_list);
+    edgeinfo.AppendTo(edgeinfo_buffer_);
 
     // Add to the map
     edge_offset_map_.emplace(edge_tuple_item, edge_info_offset_);
@@ -626,9 +795,8 @@ uint32_t GraphTileBuilder::AddEdgeInfo(const uint32_t edgeindex,
   auto edge_tuple_item = EdgeTuple(edgeindex, nodea, nodeb);
   auto existing_edge_offset_item = edge_offset_map_.find(edge_tuple_item);
   if (existing_edge_offset_item == edge_offset_map_.end()) {
-    // Add a new EdgeInfo to the list and get a reference to it
-    edgeinfo_list_.emplace_back();
-    EdgeInfoBuilder& edgeinfo = edgeinfo_list_.back();
+    // Build the new EdgeInfo, it is serialized once it has its names
+    EdgeInfoBuilder edgeinfo;
     edgeinfo.set_wayid(wayid);
     edgeinfo.set_encoded_shape(llstr);
 
@@ -657,6 +825,7 @@ uint32_t GraphTileBuilder::AddEdgeInfo(const uint32_t edgeindex,
       location++;
     }
     edgeinfo.set_name_info_list(name_info_list);
+    edgeinfo.AppendTo(edgeinfo_buffer_);
 
     // Add to the map
     edge_offset_map_.emplace(edge_tuple_item, edge_info_offset_);
@@ -683,22 +852,45 @@ uint32_t GraphTileBuilder::AddName(const std::string& name) {
     return 0;
   }
 
-  // If nothing already used this name
-  auto existing_text_offset = text_offset_map_.find(name);
-  if (existing_text_offset == text_offset_map_.end()) {
-    // Save the current offset and add name to text list
-    uint32_t offset = text_list_offset_;
-    textlistbuilder_.emplace_back(name);
-
-    // Add name/offset pair to map and update text offset value
-    // to length of string plus null terminator
-    text_offset_map_.emplace(name, text_list_offset_);
-    text_list_offset_ += (name.length() + 1);
+  // Return the offset to the existing name if something already used it
+  uint32_t offset;
+  size_t hash = std::hash<std::string>()(name);
+  if (FindName(name, hash, offset)) {
     return offset;
-  } else {
-    // Return the offset to the existing name
-    return existing_text_offset->second;
   }
+  return AppendName(name, hash);
+}
+
+// Find the offset of a name already in the text list
+bool GraphTileBuilder::FindName(const std::string& name, const size_t hash,
+                                uint32_t& offset) const {
+  auto range = text_offset_map_.equal_range(hash);
+  for (auto existing = range.first; existing != range.second; ++existing) {
+    // Same hash, make sure its the same name and not just the start of one
+    if (textlist_buffer_.compare(existing->second, name.length(), name) == 0 &&
+        textlist_buffer_[existing->second + name.length()] == '\0') {
+      offset = existing->second;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Put a name at the end of the text list
+uint32_t GraphTileBuilder::AppendName(const std::string& name, const size_t hash) {
+  // Save the current offset and add name to text list
+  uint32_t offset = text_list_offset_;
+  textlist_buffer_.append(name);
+  textlist_buffer_.push_back('\0');
+
+  // Keep the first offset of a name so lookups match what was first added,
+  // update text offset value to length of string plus null terminator
+  uint32_t existing;
+  if (!FindName(name, hash, existing)) {
+    text_offset_map_.emplace(hash, offset);
+  }
+  text_list_offset_ += (name.length() + 1);
+  return offset;
 }
 
 // Add admin
@@ -812,8 +1004,10 @@ std::array<std::vector<GraphId>, kBinCount> GraphTileBuilder::BinEdges(const Gra
   auto max = tile->header()->graphid().level() == max_level;
   auto tiles = TileHierarchy::levels().rbegin()->second.tiles;
 
-  //each edge please
+  //each edge please, the shape and the cells it intersects are reused from edge to edge
   std::unordered_set<uint64_t> ids(tile->header()->directededgecount() / 2);
+  std::vector<PointLL> shape;
+  std::vector<std::pair<int32_t, unsigned short> > cells;
   const auto* start_edge = tile->directededge(0);
   for(const DirectedEdge* edge = start_edge; edge < start_edge + tile->header()->directededgecount(); ++edge) {
     //dont bin these
@@ -822,8 +1016,10 @@ std::array<std::vector<GraphId>, kBinCount> GraphTileBuilder::BinEdges(const Gra
       continue;
 
     //get the shape or bail if none
-    auto info = tile->edgeinfo(edge->edgeinfo_offset());
-    const auto& shape = info.shape();
+    auto decoder = tile->edgeinfo(edge->edgeinfo_offset()).lazy_shape();
+    shape.clear();
+    while(!decoder.empty())
+      shape.push_back(decoder.pop());
     if(shape.empty())
       continue;
 
@@ -839,20 +1035,24 @@ std::array<std::vector<GraphId>, kBinCount> GraphTileBuilder::BinEdges(const Gra
     if(start_id == end_id && !ids.insert(edge->edgeinfo_offset()).second)
       continue;
 
-    //for each bin that got intersected
-    auto intersection = tiles.Intersect(shape);
+    //for each tile that got intersected, its bins follow one another
+    tiles.Intersect(shape, cells);
     GraphId edge_id(tile->header()->graphid().tileid(), tile->header()->graphid().level(), edge - start_edge);
-    for(const auto& i : intersection) {
+    for(auto cell = cells.cbegin(); cell != cells.cend();) {
+      auto tile_id = cell->first;
       //as per the rules above about when to add intersections
-      auto originating = i.first == start_id;
-      auto terminating = i.first == end_id;
-      auto loop_back = i.first != start_id && i.first != end_id && start_id == end_id;
+      auto originating = tile_id == start_id;
+      auto terminating = tile_id == end_id;
+      auto loop_back = tile_id != start_id && tile_id != end_id && start_id == end_id;
       if(originating || (intermediate && !terminating) || loop_back) {
         //which set of bins, either this local set or tweeners to be added later
-        auto& out_bins = originating && max ? bins : tweeners.insert({GraphId(i.first, max_level, 0), {}}).first->second;
+        auto& out_bins = originating && max ? bins : tweeners.insert({GraphId(tile_id, max_level, 0), {}}).first->second;
         //keep the edge id
-        for(auto bin : i.second)
-          out_bins[bin].push_back(edge_id);
+        for(; cell != cells.cend() && cell->first == tile_id; ++cell)
+          out_bins[cell->second].push_back(edge_id);
+      } else {
+        //skip this tiles bins
+        for(; cell != cells.cend() && cell->first == tile_id; ++cell);
       }
     }
   }
@@ -890,6 +1090,12 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
   header.set_traffic_chunk_offset(header.traffic_chunk_offset() + shift);
   header.set_lane_connectivity_offset(header.lane_connectivity_offset() + shift);
   header.set_edge_elevation_offset(header.edge_elevation_offset() + shift);
+  header.set_edge_bbox_offset(header.edge_bbox_offset() + shift);
+  header.set_hotedge_offset(header.hotedge_offset() + shift);
+  header.set_speed_profile_offset(header.speed_profile_offset() + shift);
+  header.set_edge_attribute_index_offset(header.edge_attribute_index_offset() + shift);
+  header.set_fixed_shape_offset(header.fixed_shape_offset() + shift);
+  header.set_shortcut_edges_offset(header.shortcut_edges_offset() + shift);
   header.set_end_offset(header.end_offset() + shift);
   //rewrite the tile
   boost::filesystem::path filename = tile_dir + filesystem::path_separator + GraphTile::FileSuffix(header.graphid());
@@ -916,6 +1122,118 @@ void GraphTileBuilder::AddBins(const std::string& tile_dir,
     throw std::runtime_error("Failed to open file " + filename.string());
 }
 
+// Sets the historical speed profiles of the directed edges of a tile.
+void GraphTileBuilder::AddSpeedProfiles(const std::string& tile_dir,
+                const GraphTile* tile,
+                const std::vector<SpeedProfile>& profiles,
+                const std::vector<uint16_t>& index) {
+  //serialize the new profiles
+  std::stringstream in_mem;
+  uint32_t size = SerializeSpeedProfiles(in_mem, profiles, index, tile->header()->directededgecount());
+  //update header offsets, only the edge attribute index after the profiles moves
+  GraphTileHeader header = *tile->header();
+  uint32_t index_size = header.fixed_shape_offset() - header.edge_attribute_index_offset();
+  uint32_t fixed_shape_size = header.shortcut_edges_offset() - header.fixed_shape_offset();
+  uint32_t shortcut_edges_size = header.end_offset() - header.shortcut_edges_offset();
+  header.set_edge_attribute_index_offset(header.speed_profile_offset() + size);
+  header.set_fixed_shape_offset(header.edge_attribute_index_offset() + index_size);
+  header.set_shortcut_edges_offset(header.fixed_shape_offset() + fixed_shape_size);
+  header.set_end_offset(header.shortcut_edges_offset() + shortcut_edges_size);
+  //rewrite the tile
+  boost::filesystem::path filename = tile_dir + filesystem::path_separator + GraphTile::FileSuffix(header.graphid());
+  if(!boost::filesystem::exists(filename.parent_path()))
+    boost::filesystem::create_directories(filename.parent_path());
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  //open it
+  if(file.is_open()) {
+    //new header
+    file.write(reinterpret_cast<const char*>(&header), sizeof(GraphTileHeader));
+    //everything up to the profiles
+    const auto* begin = reinterpret_cast<const char*>(tile->header()) + sizeof(GraphTileHeader);
+    const auto* end = reinterpret_cast<const char*>(tile->header()) + tile->header()->speed_profile_offset();
+    file.write(begin, end - begin);
+    //the new profiles
+    if (size > 0)
+      file << in_mem.rdbuf();
+    //the edge attribute index, fixed point shapes and shortcut edges after them
+    begin = reinterpret_cast<const char*>(tile->header()) + tile->header()->edge_attribute_index_offset();
+    end = reinterpret_cast<const char*>(tile->header()) + tile->header()->end_offset();
+    file.write(begin, end - begin);
+  }//failed
+  else
+    throw std::runtime_error("Failed to open file " + filename.string());
+}
+
+// Adds the shapes of the edge infos of a tile as fixed point integers.
+void GraphTileBuilder::AddFixedShapes(const std::string& tile_dir, const GraphTile* tile) {
+  //the edge infos in the order they are in the tile, both directions share one
+  std::vector<uint32_t> offsets;
+  offsets.reserve(tile->header()->directededgecount());
+  for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i)
+    offsets.push_back(tile->directededge(i)->edgeinfo_offset());
+  std::sort(offsets.begin(), offsets.end());
+  offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+  //decode them into the index and the points
+  std::vector<FixedShapeIndex> index;
+  std::vector<FixedPoint> points;
+  index.reserve(offsets.size() + 1);
+  for (auto offset : offsets) {
+    auto edgeinfo = tile->edgeinfo(offset);
+    index.push_back({offset, static_cast<uint32_t>(points.size())});
+    auto encoded = edgeinfo.encoded_shape();
+    auto shape = DecodeFixedShape(encoded.data(), encoded.size());
+    points.insert(points.end(), shape.cbegin(), shape.cend());
+  }
+  index.push_back({std::numeric_limits<uint32_t>::max(), static_cast<uint32_t>(points.size())});
+  //update header offsets, only the shortcut edges after the fixed point shapes move
+  GraphTileHeader header = *tile->header();
+  uint32_t count = index.size(), padding = 0;
+  uint32_t shortcut_edges_size = header.end_offset() - header.shortcut_edges_offset();
+  header.set_shortcut_edges_offset(header.fixed_shape_offset() + 2 * sizeof(uint32_t) +
+                        index.size() * sizeof(FixedShapeIndex) + points.size() * sizeof(FixedPoint));
+  header.set_end_offset(header.shortcut_edges_offset() + shortcut_edges_size);
+  //rewrite the tile
+  boost::filesystem::path filename = tile_dir + filesystem::path_separator + GraphTile::FileSuffix(header.graphid());
+  if(!boost::filesystem::exists(filename.parent_path()))
+    boost::filesystem::create_directories(filename.parent_path());
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  //open it
+  if(file.is_open()) {
+    //new header
+    file.write(reinterpret_cast<const char*>(&header), sizeof(GraphTileHeader));
+    //everything up to the fixed point shapes
+    const auto* begin = reinterpret_cast<const char*>(tile->header()) + sizeof(GraphTileHeader);
+    const auto* end = reinterpret_cast<const char*>(tile->header()) + tile->header()->fixed_shape_offset();
+    file.write(begin, end - begin);
+    //the new fixed point shapes
+    file.write(reinterpret_cast<const char*>(&count), sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(&padding), sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(FixedShapeIndex));
+    file.write(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(FixedPoint));
+    //the shortcut edges after them
+    begin = reinterpret_cast<const char*>(tile->header()) + tile->header()->shortcut_edges_offset();
+    end = reinterpret_cast<const char*>(tile->header()) + tile->header()->end_offset();
+    file.write(begin, end - begin);
+  }//failed
+  else
+    throw std::runtime_error("Failed to open file " + filename.string());
+}
+
+// Replaces the header of a tile on disk.
+void GraphTileBuilder::UpdateHeader(const std::string& tile_dir, const GraphTileHeader& header) {
+  boost::filesystem::path filename = tile_dir + filesystem::path_separator + GraphTile::FileSuffix(header.graphid());
+  std::fstream file(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  //open it
+  if(file.is_open()) {
+    //overwrite the header only
+    file.write(reinterpret_cast<const char*>(&header), sizeof(GraphTileHeader));
+    if(!file)
+      throw std::runtime_error("Failed to write header to " + filename.string());
+  }//failed
+  else
+    throw std::runtime_error("Failed to open file " + filename.string());
+}
+
 // Initialize traffic segment association. Sizes the traffic segment Id list
 // and sets them all to Invalid.
 void GraphTileBuilder::InitializeTrafficSegments() {
@@ -1012,6 +1330,12 @@ void GraphTileBuilder::UpdateTrafficSegments(const bool update_dir_edges) {
   uint32_t shift = new_segments * sizeof(TrafficAssociation) + new_chunks * sizeof(TrafficChunk);
   header_builder_.set_lane_connectivity_offset(header_builder_.lane_connectivity_offset() + shift);
   header_builder_.set_edge_elevation_offset(header_builder_.edge_elevation_offset() + shift);
+  header_builder_.set_edge_bbox_offset(header_builder_.edge_bbox_offset() + shift);
+  header_builder_.set_hotedge_offset(header_builder_.hotedge_offset() + shift);
+  header_builder_.set_speed_profile_offset(header_builder_.speed_profile_offset() + shift);
+  header_builder_.set_edge_attribute_index_offset(header_builder_.edge_attribute_index_offset() + shift);
+  header_builder_.set_fixed_shape_offset(header_builder_.fixed_shape_offset() + shift);
+  header_builder_.set_shortcut_edges_offset(header_builder_.shortcut_edges_offset() + shift);
   header_builder_.set_end_offset(header_builder_.end_offset() + shift);
 
   // Get the name of the file
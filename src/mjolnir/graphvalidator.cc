@@ -19,6 +19,10 @@
 #include <mutex>
 #include <numeric>
 #include <tuple>
+#include <iterator>
+#include <unordered_map>
+#include <limits>
+#include <algorithm>
 #include <boost/filesystem/operations.hpp>
 
 #include "midgard/logging.h"
@@ -36,6 +40,9 @@ using namespace valhalla::mjolnir;
 
 namespace {
 
+// Tiles per side of the blocks of neighbouring tiles a thread validates
+constexpr int32_t kBlockSize = 4;
+
 struct HGVRestrictionTypes {
   bool hazmat;
   bool axle_load;
@@ -77,6 +84,88 @@ bool ShapesMatch(const std::vector<PointLL>& shape1,
   }
 }
 
+// Set the reach of the directed edges of a tile for the modes loki checks
+// the reachability of. The reach of an edge is the size of the strongly
+// connected component its end node is in, using only the nodes and edges of
+// this tile the mode can pass. Every node of the component can be reached
+// from the end node so it never overstates how far loki would get going
+// forward. Edges leaving the tile are left unknown (0) so loki searches them.
+void SetReach(const GraphId& tile_id, const std::vector<NodeInfo>& nodes,
+              std::vector<DirectedEdge>& directededges) {
+  constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> index(nodes.size()), lowlink(nodes.size());
+  std::vector<uint32_t> component(nodes.size());
+  std::vector<bool> on_stack(nodes.size());
+  std::vector<uint32_t> stack, sizes;
+  // Nodes being visited and the next of their edges to follow
+  std::vector<std::pair<uint32_t, uint32_t>> path;
+  for (uint32_t mode : { kAutoAccess, kBicycleAccess, kPedestrianAccess }) {
+    // Can the mode follow this edge to a node of this tile it can pass
+    auto usable = [&tile_id, &nodes, mode](const DirectedEdge& de) {
+      return !de.IsTransition() && !de.is_shortcut() &&
+             (de.forwardaccess() & mode) && de.endnode().Tile_Base() == tile_id &&
+             (nodes[de.endnode().id()].access() & mode);
+    };
+
+    // Tarjan's algorithm without recursion, tiles have far too many nodes
+    std::fill(index.begin(), index.end(), kUnvisited);
+    sizes.clear();
+    uint32_t next_index = 0;
+    for (uint32_t root = 0; root < nodes.size(); root++) {
+      if (index[root] != kUnvisited || !(nodes[root].access() & mode)) {
+        continue;
+      }
+      index[root] = lowlink[root] = next_index++;
+      stack.push_back(root);
+      on_stack[root] = true;
+      path.emplace_back(root, nodes[root].edge_index());
+      while (!path.empty()) {
+        uint32_t n = path.back().first;
+        uint32_t e = path.back().second;
+        if (e < nodes[n].edge_index() + nodes[n].edge_count()) {
+          path.back().second++;
+          const auto& de = directededges[e];
+          if (!usable(de)) {
+            continue;
+          }
+          uint32_t end = de.endnode().id();
+          if (index[end] == kUnvisited) {
+            index[end] = lowlink[end] = next_index++;
+            stack.push_back(end);
+            on_stack[end] = true;
+            path.emplace_back(end, nodes[end].edge_index());
+          } else if (on_stack[end]) {
+            lowlink[n] = std::min(lowlink[n], index[end]);
+          }
+          continue;
+        }
+
+        // All edges followed, pop the component if this node is its root
+        if (lowlink[n] == index[n]) {
+          uint32_t m, size = 0;
+          do {
+            m = stack.back();
+            stack.pop_back();
+            on_stack[m] = false;
+            component[m] = sizes.size();
+            size++;
+          } while (m != n);
+          sizes.push_back(size);
+        }
+        path.pop_back();
+        if (!path.empty()) {
+          uint32_t parent = path.back().first;
+          lowlink[parent] = std::min(lowlink[parent], lowlink[n]);
+        }
+      }
+    }
+
+    for (auto& de : directededges) {
+      de.set_reach(mode, usable(de) ? sizes[component[de.endnode().id()]] : 0);
+    }
+  }
+}
+
 // Get the GraphId of the opposing edge.
 uint32_t GetOpposingEdgeIndex(const GraphId& startnode, DirectedEdge& edge,
                               uint64_t wayid, const GraphTile* tile, const GraphTile* end_tile,
@@ -299,7 +388,7 @@ uint32_t GetOpposingEdgeIndex(const GraphId& startnode, DirectedEdge& edge,
 
 using tweeners_t = GraphTileBuilder::tweeners_t;
 void validate(const boost::property_tree::ptree& pt,
-              std::deque<GraphId>& tilequeue, std::mutex& lock,
+              std::deque<std::vector<GraphId> >& tilequeue, std::mutex& lock,
               std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float> >, tweeners_t> >& result) {
     // Our local copy of edges binned to tiles that they pass through (dont start or end in)
     tweeners_t tweeners;
@@ -318,17 +407,22 @@ void validate(const boost::property_tree::ptree& pt,
     // Vector to hold problem ways
     std::set<uint64_t> problem_ways;
 
-    // Check for more tiles
+    // Check for more tiles, a block of neighbouring tiles at a time
+    std::vector<GraphId> block;
     while (true) {
-      lock.lock();
-      if (tilequeue.empty()) {
+      if (block.empty()) {
+        lock.lock();
+        if (tilequeue.empty()) {
+          lock.unlock();
+          break;
+        }
+        block = std::move(tilequeue.front());
+        tilequeue.pop_front();
         lock.unlock();
-        break;
       }
       // Get the next tile Id
-      GraphId tile_id = tilequeue.front();
-      tilequeue.pop_front();
-      lock.unlock();
+      GraphId tile_id = block.back();
+      block.pop_back();
 
       // Point tiles to the set we need for current level
       auto level = tile_id.level();
@@ -370,14 +464,14 @@ void validate(const boost::property_tree::ptree& pt,
 
           // Validate signs
           if (de->exitsign()) {
-            if (tile->GetSigns(idx).size() == 0) {
+            if (tile->GetSignRange(idx).empty()) {
               LOG_ERROR("Directed edge marked as having signs but none found");
             }
           }
 
           // Validate lane connectivity
           if (de->laneconnectivity()) {
-            if (tile->GetLaneConnectivity(idx).size() == 0) {
+            if (tile->GetLaneConnectivityRange(idx).empty()) {
               LOG_ERROR("Directed edge marked as having lane connectivity but none found ; tile level = " +
                   std::to_string(tile_id.level()));
             }
@@ -452,7 +546,7 @@ void validate(const boost::property_tree::ptree& pt,
             uint32_t modes = 0;
             for (uint32_t mode = 1; mode < kAllAccess; mode *= 2) {
               if ((de->end_restriction() & mode) &&
-                  tile->GetRestrictions(true, edgeid, mode).size() > 0) {
+                  tile->HasRestrictions(true, edgeid, mode)) {
                 modes |= mode;
               }
             }
@@ -463,7 +557,7 @@ void validate(const boost::property_tree::ptree& pt,
             uint32_t modes = 0;
             for (uint32_t mode = 1; mode < kAllAccess; mode *= 2) {
               if ((de->start_restriction() & mode) &&
-                  tile->GetRestrictions(false, edgeid, mode).size() > 0) {
+                  tile->HasRestrictions(false, edgeid, mode)) {
                 modes |= mode;
               }
             }
@@ -500,6 +594,11 @@ void validate(const boost::property_tree::ptree& pt,
       // Bin the edges
       auto bins = GraphTileBuilder::BinEdges(tile, tweeners);
 
+      // Set how far each mode can get from the end of each edge
+      if (level != transit_level) {
+        SetReach(tile_id, nodes, directededges);
+      }
+
       // Write the new tile
       lock.lock();
       tilebuilder.Update(nodes, directededges);
@@ -584,17 +683,33 @@ namespace mjolnir {
     auto hierarchy_properties = pt.get_child("mjolnir");
     std::string tile_dir = hierarchy_properties.get<std::string>("tile_dir");
 
-    // Create a randomized queue of tiles (at all levels) to work from
-    std::deque<GraphId> tilequeue;
+    // Create a randomized queue of blocks of neighbouring tiles (at all
+    // levels) to work from. A thread validates all the tiles of a block so
+    // most of the neighbour tiles it reads to find opposing edges are already
+    // in its cache, rather than every thread reading all the neighbours of
+    // the scattered tiles it happened to get
     GraphReader reader(pt.get_child("mjolnir"));
     auto tileset = reader.GetTileSet();
+    std::unordered_map<uint64_t, std::vector<GraphId> > blocks;
     for (const auto& id : tileset) {
-      tilequeue.emplace_back(id);
+      // Transit tiles use the tiling of the local level
+      auto level = TileHierarchy::levels().find(id.level());
+      if (level == TileHierarchy::levels().end())
+        level = std::prev(TileHierarchy::levels().end());
+      auto row_col = level->second.tiles.GetRowColumn(id.tileid());
+      uint64_t block = (static_cast<uint64_t>(id.level()) << 48) |
+                       (static_cast<uint64_t>(row_col.first / kBlockSize) << 24) |
+                       static_cast<uint64_t>(row_col.second / kBlockSize);
+      blocks[block].emplace_back(id);
+    }
+    std::deque<std::vector<GraphId> > tilequeue;
+    for (auto& block : blocks) {
+      tilequeue.emplace_back(std::move(block.second));
     }
     std::random_shuffle(tilequeue.begin(), tilequeue.end());
 
     // Remember what the dataset id is in case we have to make some tiles
-    auto dataset_id = GraphTile(tile_dir, *tilequeue.begin()).header()->dataset_id();
+    auto dataset_id = GraphTile(tile_dir, *tileset.begin()).header()->dataset_id();
 
     // An mutex we can use to do the synchronization
     std::mutex lock;
@@ -632,6 +747,15 @@ namespace mjolnir {
       //keep track of tweeners
       merge(std::get<2>(data), tweeners);
     }
+
+    //which thread binned which tile decides the order the tweeners were merged
+    //in, sort them so the bins come out the same whatever the concurrency
+    for (auto& tile_bins : tweeners) {
+      for (auto& bin : tile_bins.second) {
+        std::sort(bin.begin(), bin.end(),
+          [](const GraphId& a, const GraphId& b) { return a.value < b.value; });
+      }
+    }
     LOG_INFO("Finished");
 
     //run a pass to add the edges that binned to tweener tiles
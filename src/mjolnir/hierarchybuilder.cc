@@ -1,9 +1,15 @@
 #include "mjolnir/hierarchybuilder.h"
 #include "mjolnir/graphtilebuilder.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <list>
+#include <memory>
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
 #include <utility>
@@ -127,14 +133,19 @@ OldToNewNodes find_nodes(sequence<OldToNewNodes>& old_to_new, const GraphId& nod
   }
 }
 
-// Form tiles in the new level.
-void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
-  // Use the sequence that associate new nodes to old nodes
-  sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-
-  // Use the sorted sequence that associates old nodes to new nodes
-  sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
+// The new nodes of a tile in the new levels, as a range of the sorted
+// sequence that associates new nodes to old nodes
+struct NewTile {
+  GraphId tile_id;
+  size_t begin;
+  size_t end;
+};
 
+// Form a tile in the new level.
+void FormTile(GraphReader& reader,
+              sequence<std::pair<GraphId, GraphId>>& new_to_old,
+              sequence<OldToNewNodes>& old_to_new,
+              const NewTile& new_tile, const bool has_elevation) {
   // lambda to indicate whether a directed edge should be included
   auto include_edge = [&old_to_new](const DirectedEdge* directededge,
         const GraphId& base_node, const uint8_t current_level) {
@@ -158,34 +169,14 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
     }
   };
 
-  // Iterate through the new nodes. They have been sorted by level so that
-  // highway level is done first.
-  reader.Clear();
+  // New tilebuilder for the tile
   bool added = false;
-  uint8_t current_level;
-  GraphId tile_id;
+  uint8_t current_level = new_tile.tile_id.level();
   std::hash<std::string> hasher;
-  GraphTileBuilder* tilebuilder = nullptr;
-  for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++) {
-    // Get the node - check if a new tile
+  GraphTileBuilder tilebuilder(reader.tile_dir(), new_tile.tile_id, false);
+  for (size_t n = new_tile.begin; n < new_tile.end; ++n) {
+    auto new_node = new_to_old.at(n);
     GraphId nodea = (*new_node).first;
-    if (nodea.Tile_Base() != tile_id) {
-      // Store the prior tile
-      if (tilebuilder != nullptr) {
-        tilebuilder->StoreTileData();
-        delete tilebuilder;
-      }
-
-      // New tilebuilder for the next tile. Update current level.
-      tile_id = nodea.Tile_Base();
-      tilebuilder = new GraphTileBuilder(reader.tile_dir(), tile_id, false);
-      current_level = nodea.level();
-
-      // Check if we need to clear the base/local tile cache
-      if (reader.OverCommitted()) {
-        reader.Clear();
-      }
-    }
 
     // Get the node in the base level
     GraphId base_node = (*new_node).second;
@@ -196,23 +187,23 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
     }
 
     // Copy the data version
-    tilebuilder->header_builder().set_dataset_id(tile->header()->dataset_id());
+    tilebuilder.header_builder().set_dataset_id(tile->header()->dataset_id());
 
     // Copy node information
     NodeInfo baseni = *(tile->node(base_node.id()));
-    tilebuilder->nodes().push_back(baseni);
+    tilebuilder.nodes().push_back(baseni);
     const auto& admin = tile->admininfo(baseni.admin_index());
-    NodeInfo& node = tilebuilder->nodes().back();
-    node.set_edge_index(tilebuilder->directededges().size());
+    NodeInfo& node = tilebuilder.nodes().back();
+    node.set_edge_index(tilebuilder.directededges().size());
     node.set_timezone(baseni.timezone());
-    node.set_admin_index(tilebuilder->AddAdmin(admin.country_text(), admin.state_text(),
+    node.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
                                                admin.country_iso(), admin.state_iso()));
 
     // Density at this node
     uint32_t density1 = baseni.density();
 
     // Current edge count
-    size_t edge_count = tilebuilder->directededges().size();
+    size_t edge_count = tilebuilder.directededges().size();
 
     // Iterate through directed edges of the base node to get remaining
     // directed edges (based on classification/importance cutoff)
@@ -267,7 +258,7 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
         if (signs.size() == 0) {
           LOG_ERROR("Base edge should have signs, but none found");
         }
-        tilebuilder->AddSigns(tilebuilder->directededges().size(), signs);
+        tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
       }
 
       // Get access restrictions from the base directed edge. Add these to
@@ -276,8 +267,8 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
       if (directededge->access_restriction()) {
         auto restrictions = tile->GetAccessRestrictions(base_edge_id.id(), kAllAccess);
         for (const auto& res : restrictions) {
-          tilebuilder->AddAccessRestriction(
-              AccessRestriction(tilebuilder->directededges().size(),
+          tilebuilder.AddAccessRestriction(
+              AccessRestriction(tilebuilder.directededges().size(),
                  res.type(), res.modes(), res.value()));
         }
       }
@@ -289,9 +280,9 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
           LOG_ERROR("Base edge should have lane connectivity, but none found");
         }
         for (auto& lc : laneconnectivity) {
-          lc.set_to(tilebuilder->directededges().size());
+          lc.set_to(tilebuilder.directededges().size());
         }
-        tilebuilder->AddLaneConnectivity(laneconnectivity);
+        tilebuilder.AddLaneConnectivity(laneconnectivity);
       }
 
       // Get edge info, shape, and names from the old tile and add to the
@@ -302,21 +293,21 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
       auto edgeinfo = tile->edgeinfo(idx);
       std::string encoded_shape = edgeinfo.encoded_shape();
       uint32_t w = hasher(encoded_shape + std::to_string(edgeinfo.wayid()));
-      uint32_t edge_info_offset = tilebuilder->AddEdgeInfo(w, nodea, nodeb,
+      uint32_t edge_info_offset = tilebuilder.AddEdgeInfo(w, nodea, nodeb,
                     edgeinfo.wayid(), encoded_shape,
                     tile->GetNames(idx), tile->GetTypes(idx), added);
       newedge.set_edgeinfo_offset(edge_info_offset);
 
       // Add directed edge
-      tilebuilder->directededges().emplace_back(std::move(newedge));
+      tilebuilder.directededges().emplace_back(std::move(newedge));
 
       // Add edge elevation
       if (has_elevation) {
         const EdgeElevation* elev = tile->edge_elevation(base_edge_id);
         if (elev == nullptr) {
-          tilebuilder->edge_elevations().emplace_back(0.0f, 0.0f, 0.0f);
+          tilebuilder.edge_elevations().emplace_back(0.0f, 0.0f, 0.0f);
         } else {
-          tilebuilder->edge_elevations().emplace_back(std::move(*elev));
+          tilebuilder.edge_elevations().emplace_back(std::move(*elev));
         }
       }
     }
@@ -324,25 +315,160 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
     // Add transition edges
     auto new_nodes = find_nodes(old_to_new, base_node);
     if (current_level == 0) {
-      AddDownwardTransition(new_nodes.arterial_node, tilebuilder, has_elevation);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder, has_elevation);
+      AddDownwardTransition(new_nodes.arterial_node, &tilebuilder, has_elevation);
+      AddDownwardTransition(new_nodes.local_node, &tilebuilder, has_elevation);
     } else if (current_level == 1) {
-      AddDownwardTransition(new_nodes.local_node, tilebuilder, has_elevation);
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder, has_elevation);
+      AddDownwardTransition(new_nodes.local_node, &tilebuilder, has_elevation);
+      AddUpwardTransition(new_nodes.highway_node, &tilebuilder, has_elevation);
     }
     if (current_level == 2) {
-      AddUpwardTransition(new_nodes.arterial_node, tilebuilder, has_elevation);
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder, has_elevation);
+      AddUpwardTransition(new_nodes.arterial_node, &tilebuilder, has_elevation);
+      AddUpwardTransition(new_nodes.highway_node, &tilebuilder, has_elevation);
     }
 
     // Set the edge count for the new node
-    node.set_edge_count(tilebuilder->directededges().size() - edge_count);
+    node.set_edge_count(tilebuilder.directededges().size() - edge_count);
+  }
+
+  // Store the tile
+  tilebuilder.StoreTileData();
+}
+
+// Form the new tiles from next on, one at a time, until there are none left
+void FormTiles(const boost::property_tree::ptree& pt,
+               const std::vector<NewTile>& new_tiles,
+               std::atomic<size_t>& next, const bool has_elevation,
+               std::promise<void>& result) {
+  try {
+    // Each thread has its own reader and views of the sequences
+    GraphReader reader(pt);
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
+    for (size_t i = next++; i < new_tiles.size(); i = next++) {
+      FormTile(reader, new_to_old, old_to_new, new_tiles[i], has_elevation);
+
+      // Check if we need to clear the base/local tile cache
+      if (reader.OverCommitted()) {
+        reader.Clear();
+      }
+    }
+    result.set_value();
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
+
+// Form tiles in the new levels. Each tile only depends on the base tiles so
+// they are spread over the threads, but the new local tiles replace the base
+// tiles so those are only formed once the other levels are done.
+void FormTilesInNewLevel(const boost::property_tree::ptree& pt,
+                         const bool has_elevation, const unsigned int thread_count) {
+  // Find where each new tile's nodes are in the sequence that associates new
+  // nodes to old nodes. It is sorted by level so that highway level is first.
+  std::vector<NewTile> upper_tiles, local_tiles;
+  {
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    auto local_level = TileHierarchy::levels().rbegin()->first;
+    size_t n = 0;
+    for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++, n++) {
+      GraphId tile_id = (*new_node).first.Tile_Base();
+      auto& new_tiles = tile_id.level() == local_level ? local_tiles : upper_tiles;
+      if (new_tiles.empty() || new_tiles.back().tile_id != tile_id) {
+        new_tiles.push_back({tile_id, n, n});
+      }
+      new_tiles.back().end = n + 1;
+    }
+  }
+
+  for (const auto* new_tiles : { &upper_tiles, &local_tiles }) {
+    std::atomic<size_t> next(0);
+    std::vector<std::shared_ptr<std::thread> > threads(thread_count);
+    std::list<std::promise<void> > results;
+    for (auto& thread : threads) {
+      results.emplace_back();
+      thread.reset(new std::thread(FormTiles, std::cref(pt), std::cref(*new_tiles),
+                                   std::ref(next), has_elevation, std::ref(results.back())));
+    }
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    // If something bad went down this will rethrow it
+    for (auto& result : results) {
+      result.get_future().get();
+    }
+  }
+}
+
+// The levels a node of a base tile exists on
+struct NodeLevels {
+  bool levels[3];
+  PointLL latlng;
+  uint32_t density;
+};
+
+// The levels of all the nodes of a base tile
+struct TileLevels {
+  bool has_elevation;
+  std::vector<NodeLevels> nodes;
+};
+
+// Find which levels the nodes of a base tile exist on
+void FindTileNodeLevels(GraphReader& reader, const GraphId& base_tile_id,
+                    TileLevels& tile_levels) {
+  // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
+  tile_levels.has_elevation = false;
+  const GraphTile* tile = reader.GetGraphTile(base_tile_id);
+  if (tile == nullptr || tile->header()->nodecount() == 0) {
+    return;
+  }
+
+  // Update the has_elevation flag
+  if (tile->header()->has_edge_elevation()) {
+    tile_levels.has_elevation = true;
   }
 
-  // Delete the tile builder
-  if (tilebuilder != nullptr) {
-    tilebuilder->StoreTileData();
-    delete tilebuilder;
+  // Iterate through the nodes. Add nodes to the new level when
+  // best road class <= the new level classification cutoff
+  uint32_t nodecount = tile->header()->nodecount();
+  tile_levels.nodes.resize(nodecount);
+  GraphId edgeid = base_tile_id;
+  const NodeInfo* nodeinfo = tile->node(base_tile_id);
+  for (uint32_t i = 0; i < nodecount; i++, nodeinfo++) {
+    // Iterate through the edges to see which levels this node exists.
+    auto& node = tile_levels.nodes[i];
+    node.levels[0] = node.levels[1] = node.levels[2] = false;
+    node.latlng = nodeinfo->latlng();
+    node.density = nodeinfo->density();
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
+      // Update the flag for the level of this edge (skip transit
+      // connection edges)
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      if (directededge->use() != Use::kTransitConnection &&
+          directededge->use() != Use::kEgressConnection &&
+          directededge->use() != Use::kPlatformConnection) {
+        node.levels[TileHierarchy::get_level(directededge->classification())] = true;
+      }
+    }
+  }
+}
+
+// Find the levels of the nodes of the base tiles from next on, until the
+// end of the batch
+void FindNodeLevels(GraphReader& reader, const std::vector<GraphId>& base_tiles,
+                    const size_t batch, std::atomic<size_t>& next, const size_t end,
+                    std::vector<TileLevels>& tile_levels, std::promise<void>& result) {
+  try {
+    for (size_t i = next++; i < end; i = next++) {
+      FindTileNodeLevels(reader, base_tiles[i], tile_levels[i - batch]);
+
+      // Check if we need to clear the tile cache
+      if (reader.OverCommitted()) {
+        reader.Clear();
+      }
+    }
+    result.set_value();
+  } catch (...) {
+    result.set_exception(std::current_exception());
   }
 }
 
@@ -351,10 +477,13 @@ void FormTilesInNewLevel(GraphReader& reader, bool has_elevation) {
  * hierarchy levels and the existing nodes on the base/local level. The
  * associations go both ways: from the "old" nodes on the base/local level
  * to new nodes (using a mapping in memory) and from new nodes to old nodes
- * using a sequence (file).
+ * using a sequence (file). The base tiles are read by the threads a batch at
+ * a time, then the new node ids are handed out in tile order so they are the
+ * same no matter how many threads there are.
  * @return  Returns true if any base tiles have edge elevation data.
  */
-bool CreateNodeAssociations(GraphReader& reader) {
+bool CreateNodeAssociations(const boost::property_tree::ptree& pt,
+                            const unsigned int thread_count) {
   // Map of tiles vs. count of nodes. Used to construct new node Ids.
   std::unordered_map<GraphId, uint32_t> new_nodes;
 
@@ -386,82 +515,83 @@ bool CreateNodeAssociations(GraphReader& reader) {
   tile_level++;
   auto& highway_level = tile_level->second;
 
-  // Get the set of tiles on the local level
-  auto local_tiles = reader.GetTileSet(base_level.level);
+  // A reader for each thread
+  std::vector<std::unique_ptr<GraphReader> > readers;
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    readers.emplace_back(new GraphReader(pt));
+  }
+
+  // Get the set of tiles on the local level, in order
+  auto local_tile_set = readers.front()->GetTileSet(base_level.level);
+  std::vector<GraphId> local_tiles(local_tile_set.begin(), local_tile_set.end());
+  std::sort(local_tiles.begin(), local_tiles.end());
 
   // Iterate through all tiles in the local level
   bool has_elevation = false;
-  uint32_t ntiles = base_level.tiles.TileCount();
-  uint32_t bl = static_cast<uint32_t>(base_level.level);
   uint32_t al = static_cast<uint32_t>(arterial_level.level);
   uint32_t hl = static_cast<uint32_t>(highway_level.level);
-  for (const auto& base_tile_id : local_tiles) {
-    // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
-    const GraphTile* tile = reader.GetGraphTile(base_tile_id);
-    if (tile == nullptr || tile->header()->nodecount() == 0) {
-      continue;
+  const size_t batch_size = thread_count * 64;
+  for (size_t batch = 0; batch < local_tiles.size(); batch += batch_size) {
+    // Have the threads find the levels of the nodes of this batch of tiles
+    size_t end = std::min(batch + batch_size, local_tiles.size());
+    std::vector<TileLevels> tile_levels(end - batch);
+    std::atomic<size_t> next(batch);
+    std::vector<std::shared_ptr<std::thread> > threads(thread_count);
+    std::list<std::promise<void> > results;
+    for (size_t i = 0; i < threads.size(); ++i) {
+      results.emplace_back();
+      threads[i].reset(new std::thread(FindNodeLevels, std::ref(*readers[i]),
+                                       std::cref(local_tiles), batch, std::ref(next), end,
+                                       std::ref(tile_levels), std::ref(results.back())));
     }
-
-    // Update the has_elevation flag
-    if (tile->header()->has_edge_elevation()) {
-      has_elevation = true;
+    for (auto& thread : threads) {
+      thread->join();
+    }
+    // If something bad went down this will rethrow it
+    for (auto& result : results) {
+      result.get_future().get();
     }
 
-    // Iterate through the nodes. Add nodes to the new level when
-    // best road class <= the new level classification cutoff
-    bool levels[3];
-    uint32_t nodecount = tile->header()->nodecount();
-    GraphId basenode = base_tile_id;
-    GraphId edgeid = base_tile_id;
-    const NodeInfo* nodeinfo = tile->node(basenode);
-    for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
-      // Iterate through the edges to see which levels this node exists.
-      levels[0] = levels[1] = levels[2] = false;
-      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
-        // Update the flag for the level of this edge (skip transit
-        // connection edges)
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        if (directededge->use() != Use::kTransitConnection &&
-            directededge->use() != Use::kEgressConnection &&
-            directededge->use() != Use::kPlatformConnection) {
-          levels[TileHierarchy::get_level(directededge->classification())] = true;
-        }
-      }
-
-      // Associate new nodes to base nodes and base node to new nodes
-      GraphId highway_node, arterial_node, local_node;
-      if (levels[0]) {
-        // New node is on the highway level. Associate back to base/local node
-        GraphId new_tile(highway_level.tiles.TileId(nodeinfo->latlng()), hl, 0);
-        highway_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(highway_node, basenode));
-      }
-      if (levels[1]) {
-        // New node is on the arterial level. Associate back to base/local node
-        GraphId new_tile(arterial_level.tiles.TileId(nodeinfo->latlng()), al, 0);
-        arterial_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(arterial_node, basenode));
-      }
-      if (levels[2]) {
-        // New node is on the local level. Associate back to base/local node
-        local_node = get_new_node(base_tile_id);
-        new_to_old.push_back(std::make_pair(local_node, basenode));
+    for (size_t t = batch; t < end; ++t) {
+      const GraphId& base_tile_id = local_tiles[t];
+      const auto& levels = tile_levels[t - batch];
+      if (levels.has_elevation) {
+        has_elevation = true;
       }
 
-      if (!levels[0] && !levels[1] && !levels[2]) {
-        LOG_ERROR("No valid level for this node!");
-      }
+      GraphId basenode = base_tile_id;
+      for (const auto& node : levels.nodes) {
+        // Associate new nodes to base nodes and base node to new nodes
+        GraphId highway_node, arterial_node, local_node;
+        if (node.levels[0]) {
+          // New node is on the highway level. Associate back to base/local node
+          GraphId new_tile(highway_level.tiles.TileId(node.latlng), hl, 0);
+          highway_node = get_new_node(new_tile);
+          new_to_old.push_back(std::make_pair(highway_node, basenode));
+        }
+        if (node.levels[1]) {
+          // New node is on the arterial level. Associate back to base/local node
+          GraphId new_tile(arterial_level.tiles.TileId(node.latlng), al, 0);
+          arterial_node = get_new_node(new_tile);
+          new_to_old.push_back(std::make_pair(arterial_node, basenode));
+        }
+        if (node.levels[2]) {
+          // New node is on the local level. Associate back to base/local node
+          local_node = get_new_node(base_tile_id);
+          new_to_old.push_back(std::make_pair(local_node, basenode));
+        }
 
-      // Associate the old node to the new node(s). Entries in the tuple
-      // that are invalid nodes indicate no node exists in the new level.
-      OldToNewNodes assoc(basenode, highway_node, arterial_node,
-                           local_node, nodeinfo->density());
-      old_to_new.push_back(assoc);
-    }
+        if (!node.levels[0] && !node.levels[1] && !node.levels[2]) {
+          LOG_ERROR("No valid level for this node!");
+        }
 
-    // Check if we need to clear the tile cache
-    if(reader.OverCommitted()) {
-      reader.Clear();
+        // Associate the old node to the new node(s). Entries in the tuple
+        // that are invalid nodes indicate no node exists in the new level.
+        OldToNewNodes assoc(basenode, highway_node, arterial_node,
+                             local_node, node.density);
+        old_to_new.push_back(assoc);
+        ++basenode;
+      }
     }
   }
   return has_elevation;
@@ -561,16 +691,15 @@ namespace mjolnir {
 // base level. Each successive level of the hierarchy is based on
 // and connected to the next.
 void HierarchyBuilder::Build(const boost::property_tree::ptree& pt) {
-
-  // TODO: thread this. Might be more possible now that we don't create
-  // shortcuts in the HierarchyBuilder
-
   // Construct GraphReader
   LOG_INFO("HierarchyBuilder");
-  GraphReader reader(pt.get_child("mjolnir"));
+  auto hierarchy_properties = pt.get_child("mjolnir");
+  GraphReader reader(hierarchy_properties);
+  unsigned int thread_count = std::max(static_cast<unsigned int>(1),
+      pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
 
   // Association of old nodes to new nodes
-  bool has_elevation = CreateNodeAssociations(reader);
+  bool has_elevation = CreateNodeAssociations(hierarchy_properties, thread_count);
   if (has_elevation) {
     LOG_INFO("Base tiles have edge elevation information");
   }
@@ -580,14 +709,13 @@ void HierarchyBuilder::Build(const boost::property_tree::ptree& pt) {
 
   // Iterate through the hierarchy (from highway down to local) and build
   // new tiles
-  FormTilesInNewLevel(reader, has_elevation);
+  FormTilesInNewLevel(hierarchy_properties, has_elevation, thread_count);
 
   // Remove any base tiles that no longer have any data (nodes and edges
   // only exist on arterial and highway levels)
   RemoveUnusedLocalTiles(reader.tile_dir());
 
   // Update the end nodes to all transit connections in the transit hierarchy
-  auto hierarchy_properties = pt.get_child("mjolnir");
   auto transit_dir = hierarchy_properties.get_optional<std::string>("transit_dir");
   if (transit_dir && boost::filesystem::exists(*transit_dir) && boost::filesystem::is_directory(*transit_dir)) {
     UpdateTransitConnections(reader);
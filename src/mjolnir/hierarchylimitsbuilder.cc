@@ -0,0 +1,138 @@
+#include "mjolnir/hierarchylimitsbuilder.h"
+#include "mjolnir/graphtilebuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "midgard/logging.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Largest factor the tile header can keep
+constexpr float kMaxHierarchyLimitsFactor = kHierarchyLimitsStep * 15;
+
+// Smallest upward transitions factor, the counts are never cut by more than
+// half so the search still expands enough to find the way up
+constexpr float kMinUpTransitionFactor = 0.5f;
+
+// What is measured of a tile
+struct tile_stats_t {
+  GraphTileHeader header;  // Header of the tile, to write back
+  uint32_t nodes;          // Number of nodes
+  uint32_t up_nodes;       // Number of nodes with a transition up
+};
+
+}
+
+namespace valhalla {
+namespace mjolnir {
+
+float HierarchyLimitsBuilder::ExpansionWithinFactor(const float density) {
+  // Low density - increase expansion within distance.
+  // High density - decrease expansion within distance.
+  if (density < 8.0f) {
+    return 1.0f + (8.0f - density) * 0.125f;
+  } else if (density > 8.0f) {
+    return 0.5f + (15.0f - density) * 0.0625f;
+  }
+  return 1.0f;
+}
+
+float HierarchyLimitsBuilder::UpTransitionFactor(const float up_ratio,
+                                                 const float level_up_ratio) {
+  // Nothing to compare with, keep the defaults
+  if (!(up_ratio > 0.0f) || !(level_up_ratio > 0.0f)) {
+    return 1.0f;
+  }
+  float factor = std::sqrt(up_ratio / level_up_ratio);
+  return std::max(kMinUpTransitionFactor, std::min(kMaxHierarchyLimitsFactor, factor));
+}
+
+void HierarchyLimitsBuilder::Build(const boost::property_tree::ptree& pt) {
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto highway_level = TileHierarchy::levels().begin()->first;
+  for (const auto& level : TileHierarchy::levels()) {
+    // Nothing leads up from the highest level
+    if (level.first == highway_level) {
+      continue;
+    }
+
+    // Measure every tile of the level
+    std::unordered_map<uint32_t, tile_stats_t> stats;
+    uint64_t level_nodes = 0, level_up_nodes = 0;
+    const auto& tiles = level.second.tiles;
+    for (uint32_t tileid = 0; tileid < tiles.TileCount(); ++tileid) {
+      GraphId base(tileid, level.first, 0);
+      if (!reader.DoesTileExist(base)) {
+        continue;
+      }
+      const GraphTile* tile = reader.GetGraphTile(base);
+      if (tile == nullptr) {
+        continue;
+      }
+      tile_stats_t tile_stats{*tile->header(), tile->header()->nodecount(), 0};
+      for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+        const NodeInfo* nodeinfo = tile->node(i);
+        const DirectedEdge* edge = tile->directededge(nodeinfo->edge_index());
+        for (uint32_t e = 0; e < nodeinfo->edge_count(); ++e, ++edge) {
+          if (edge->trans_up()) {
+            ++tile_stats.up_nodes;
+            break;
+          }
+        }
+      }
+      level_nodes += tile_stats.nodes;
+      level_up_nodes += tile_stats.up_nodes;
+      stats.emplace(tileid, tile_stats);
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+    reader.Clear();
+    if (level_nodes == 0) {
+      continue;
+    }
+    float level_up_ratio = static_cast<float>(level_up_nodes) / level_nodes;
+
+    // A tile on its own says little about the region around a location near
+    // its edge, so every tile is measured with its neighbors
+    for (auto& tile_stats : stats) {
+      auto rc = tiles.GetRowColumn(tile_stats.first);
+      uint32_t density = 0, count = 0, nodes = 0, up_nodes = 0;
+      for (int32_t row = std::max(0, rc.first - 1);
+           row <= std::min(tiles.nrows() - 1, rc.first + 1); ++row) {
+        for (int32_t col = std::max(0, rc.second - 1);
+             col <= std::min(tiles.ncolumns() - 1, rc.second + 1); ++col) {
+          auto neighbor = stats.find(tiles.TileId(col, row));
+          if (neighbor != stats.end()) {
+            density += neighbor->second.header.density();
+            nodes += neighbor->second.nodes;
+            up_nodes += neighbor->second.up_nodes;
+            ++count;
+          }
+        }
+      }
+
+      GraphTileHeader& header = tile_stats.second.header;
+      header.set_expansion_within_factor(ExpansionWithinFactor(
+          static_cast<float>(density) / count));
+      header.set_up_transition_factor(UpTransitionFactor(
+          nodes > 0 ? static_cast<float>(up_nodes) / nodes : 0.0f, level_up_ratio));
+      GraphTileBuilder::UpdateHeader(reader.tile_dir(), header);
+    }
+    LOG_INFO("Set hierarchy limits of " + std::to_string(stats.size()) +
+             " tiles on level " + std::to_string(level.first));
+  }
+}
+
+}
+}
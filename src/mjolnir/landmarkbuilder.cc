@@ -0,0 +1,234 @@
+#include "mjolnir/landmarkbuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "midgard/logging.h"
+#include "baldr/graphtile.h"
+#include "baldr/tilehierarchy.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+using queue_entry_t = std::pair<float, uint32_t>;
+using min_queue_t = std::priority_queue<queue_entry_t, std::vector<queue_entry_t>,
+                                        std::greater<queue_entry_t> >;
+
+// The arcs leaving (or entering, for the reverse) each node as a compressed
+// adjacency array
+struct adjacency_t {
+  std::vector<uint32_t> offsets;
+  std::vector<std::pair<uint32_t, float> > arcs;
+
+  adjacency_t(const uint32_t node_count, const std::vector<LandmarkBuilder::Arc>& graph,
+              const bool reverse)
+      : offsets(node_count + 1, 0), arcs(graph.size()) {
+    for (const auto& arc : graph)
+      ++offsets[(reverse ? arc.to : arc.from) + 1];
+    for (uint32_t n = 0; n < node_count; ++n)
+      offsets[n + 1] += offsets[n];
+    std::vector<uint32_t> next(offsets.cbegin(), offsets.cend() - 1);
+    for (const auto& arc : graph) {
+      if (reverse)
+        arcs[next[arc.to]++] = std::make_pair(arc.from, arc.cost);
+      else
+        arcs[next[arc.from]++] = std::make_pair(arc.to, arc.cost);
+    }
+  }
+};
+
+// Least cost from the source to every node over the arcs
+void Dijkstra(const adjacency_t& adjacency, const uint32_t source, std::vector<float>& costs) {
+  costs.assign(adjacency.offsets.size() - 1, kUnreachableLandmark);
+  min_queue_t queue;
+  costs[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > costs[top.second])
+      continue;
+    for (uint32_t i = adjacency.offsets[top.second]; i < adjacency.offsets[top.second + 1]; ++i) {
+      const auto& arc = adjacency.arcs[i];
+      float cost = top.first + arc.second;
+      if (cost < costs[arc.first]) {
+        costs[arc.first] = cost;
+        queue.emplace(cost, arc.first);
+      }
+    }
+  }
+}
+
+// The node with the highest finite cost, or the source if there is none
+uint32_t Farthest(const std::vector<float>& costs, const uint32_t source) {
+  uint32_t farthest = source;
+  for (uint32_t n = 0; n < costs.size(); ++n) {
+    if (std::isfinite(costs[n]) && costs[n] > costs[farthest])
+      farthest = n;
+  }
+  return farthest;
+}
+
+}
+
+namespace valhalla {
+namespace mjolnir {
+
+Landmarks LandmarkBuilder::Compute(const std::string& costing_name,
+                                   std::vector<GraphId>&& tiles,
+                                   std::vector<uint32_t>&& offsets,
+                                   const std::vector<Arc>& arcs, const uint32_t count) {
+  uint32_t node_count = offsets.back();
+  adjacency_t forward(node_count, arcs, false);
+  adjacency_t reverse(node_count, arcs, true);
+
+  // Start from the node farthest from some node with edges, the first
+  // landmark then lands at the edge of the graph
+  std::vector<uint32_t> landmarks;
+  std::vector<float> costs;
+  if (node_count > 0 && count > 0) {
+    std::vector<float> from, to;
+    uint32_t start = arcs.empty() ? 0 : arcs.front().from;
+    Dijkstra(forward, start, from);
+    uint32_t next = Farthest(from, start);
+
+    // Then keep picking the node farthest from all the landmarks so far in
+    // either direction, keeping the costs of a node together
+    std::vector<float> nearest(node_count, kUnreachableLandmark);
+    costs.resize(static_cast<size_t>(node_count) * count * 2);
+    while (landmarks.size() < count) {
+      size_t l = landmarks.size();
+      landmarks.push_back(next);
+      std::thread reverse_search([&reverse, &to, next]() { Dijkstra(reverse, next, to); });
+      Dijkstra(forward, next, from);
+      reverse_search.join();
+      for (uint32_t n = 0; n < node_count; ++n) {
+        costs[(static_cast<size_t>(n) * count + l) * 2] = from[n];
+        costs[(static_cast<size_t>(n) * count + l) * 2 + 1] = to[n];
+        nearest[n] = std::min(nearest[n], std::min(from[n], to[n]));
+      }
+      LOG_INFO("Landmark " + std::to_string(landmarks.size()) + " of " + std::to_string(count) +
+               " for " + costing_name + " is node " + std::to_string(next));
+
+      // Stop early if every node reached is a landmark already
+      next = Farthest(nearest, next);
+      if (!(nearest[next] > 0.f))
+        break;
+    }
+
+    // Drop the room left for landmarks there weren't enough nodes for
+    if (landmarks.size() < count) {
+      auto cost = costs.begin();
+      for (uint32_t n = 0; n < node_count; ++n) {
+        auto first = costs.cbegin() + static_cast<size_t>(n) * count * 2;
+        cost = std::copy(first, first + landmarks.size() * 2, cost);
+      }
+      costs.erase(cost, costs.end());
+    }
+  }
+
+  return Landmarks(costing_name, std::move(tiles), std::move(offsets), std::move(landmarks),
+                   std::move(costs));
+}
+
+Landmarks LandmarkBuilder::Compute(GraphReader& reader, const cost_ptr_t& costing,
+                                   const std::string& costing_name, const uint32_t count) {
+  // Number the nodes of every tile in the order of the tile ids
+  std::vector<std::pair<GraphId, uint32_t> > tile_nodes;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (uint32_t tileid = 0; tileid < level.second.tiles.TileCount(); ++tileid) {
+      GraphId base(tileid, level.first, 0);
+      if (!reader.DoesTileExist(base))
+        continue;
+      const GraphTile* tile = reader.GetGraphTile(base);
+      if (tile != nullptr && tile->header()->nodecount() > 0)
+        tile_nodes.emplace_back(base, tile->header()->nodecount());
+      if (reader.OverCommitted())
+        reader.Trim();
+    }
+  }
+  std::sort(tile_nodes.begin(), tile_nodes.end(),
+      [](const std::pair<GraphId, uint32_t>& a, const std::pair<GraphId, uint32_t>& b) {
+        return a.first.value < b.first.value;
+      });
+  std::vector<GraphId> tiles;
+  std::vector<uint32_t> offsets(1, 0);
+  for (const auto& t : tile_nodes) {
+    tiles.push_back(t.first);
+    offsets.push_back(offsets.back() + t.second);
+  }
+  const auto node = [&tiles, &offsets](const GraphId& nodeid) {
+    auto itr = std::lower_bound(tiles.cbegin(), tiles.cend(), nodeid.Tile_Base(),
+        [](const GraphId& a, const GraphId& b) { return a.value < b.value; });
+    if (itr == tiles.cend() || !(*itr == nodeid.Tile_Base()))
+      return kInvalidLandmarkNode;
+    return offsets[itr - tiles.cbegin()] + static_cast<uint32_t>(nodeid.id());
+  };
+  LOG_INFO("Found " + std::to_string(offsets.back()) + " nodes in " +
+           std::to_string(tiles.size()) + " tiles");
+
+  // Every edge the costing may use is an arc and so is every transition
+  // to the same node on another level, at no cost. Shortcuts only repeat
+  // the edges they stand for.
+  auto filter = costing->GetEdgeFilter();
+  std::vector<Arc> arcs;
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    if (reader.OverCommitted())
+      reader.Trim();
+    const GraphTile* tile = reader.GetGraphTile(tiles[t]);
+    if (tile == nullptr)
+      continue;
+    for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+      uint32_t from = offsets[t] + i;
+      const NodeInfo* nodeinfo = tile->node(i);
+      const DirectedEdge* edge = tile->directededge(nodeinfo->edge_index());
+      for (uint32_t e = 0; e < nodeinfo->edge_count(); ++e, ++edge) {
+        if (edge->is_shortcut() || (!edge->IsTransition() && !(filter(edge) > 0.f)))
+          continue;
+        uint32_t to = node(edge->endnode());
+        if (to == kInvalidLandmarkNode)
+          continue;
+        arcs.push_back({from, to, edge->IsTransition() ? 0.f : costing->EdgeCost(edge).cost});
+      }
+    }
+  }
+  reader.Clear();
+  LOG_INFO("Found " + std::to_string(arcs.size()) + " edges usable by " + costing_name);
+  return Compute(costing_name, std::move(tiles), std::move(offsets), arcs, count);
+}
+
+void LandmarkBuilder::Build(const boost::property_tree::ptree& pt, const std::string& costing,
+                            const uint32_t count) {
+  // Default costing options, the tables are only used when a request
+  // doesn't change them
+  CostFactory<DynamicCost> factory;
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("hov", CreateHOVCost);
+  factory.Register("motor_scooter", CreateMotorScooterCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("truck", CreateTruckCost);
+  auto cost = factory.Create(costing, rapidjson::Value{});
+
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto landmarks = Compute(reader, cost, costing, count);
+  auto file_name = Landmarks::FileName(pt.get<std::string>("mjolnir.tile_dir"), costing);
+  landmarks.Write(file_name);
+  LOG_INFO("Wrote " + std::to_string(landmarks.landmark_count()) + " landmarks for " +
+           std::to_string(landmarks.node_count()) + " nodes to " + file_name);
+}
+
+}
+}
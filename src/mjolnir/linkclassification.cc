@@ -48,7 +48,7 @@ struct LinkTreeNode {
 
 // Test if the set of edges can be classified as a turn channel. Total length
 // must be less than kMaxTurnChannelLength and there cannot be any exit signs.
-bool IsTurnChannel(sequence<OSMWay>& ways,
+bool IsTurnChannel(compressed_sequence<OSMWay>& ways,
                    sequence<Edge>& edges,
                    sequence<OSMWayNode>& way_nodes,
                    std::vector<uint32_t>& linkedgeindexes) {
@@ -93,7 +93,7 @@ bool IsTurnChannel(sequence<OSMWay>& ways,
 }
 
 // Get the best classification for any driveable non-link edges from a node.
-uint32_t GetBestNonLinkClass(const std::map<Edge, size_t>& edges) {
+uint32_t GetBestNonLinkClass(const node_edges_t& edges) {
   uint32_t bestrc = kAbsurdRoadClass;
   for (const auto& edge : edges) {
     if (!edge.first.attributes.link &&
@@ -109,31 +109,45 @@ uint32_t GetBestNonLinkClass(const std::map<Edge, size_t>& edges) {
 
 // Form a list of all nodes - sorted by highest classification of non-link
 // edges at the node.
-nodelist_t FormExitNodes(sequence<Node>& nodes, sequence<Edge>& edges) {
+nodelist_t FormExitNodes(const std::string& nodes_file,
+                         const std::string& edges_file,
+                         sequence<Node>& nodes, sequence<Edge>& edges,
+                         const unsigned int threads) {
+  // Find the nodes with both links and non links at them, a link driveable
+  // from the node and a valid classification of the non-links. Scanning every
+  // node is most of the work, so it is done on all the threads. Nothing is
+  // reclassified yet so the same nodes are found whatever the order.
+  auto found = find_node_bundles(nodes_file, edges_file, threads,
+    [](const node_bundle& bundle) {
+      if (!bundle.node.attributes_.link_edge ||
+          !bundle.node.attributes_.non_link_edge) {
+        return false;
+      }
+      for (const auto& edge : bundle.node_edges) {
+        if (edge.first.attributes.link && edge.first.attributes.driveforward) {
+          return GetBestNonLinkClass(bundle.node_edges) < kMaxClassification;
+        }
+      }
+      return false;
+    });
+
   nodelist_t exit_nodes(kMaxClassification);
-  sequence<Node>::iterator node_itr = nodes.begin();
-  while (node_itr != nodes.end()) {
-    // If the node has a both links and non links at it
+  for (const auto position : found) {
+    auto node_itr = nodes[position];
     auto bundle = collect_node_edges(node_itr, nodes, edges);
-    if (bundle.node.attributes_.link_edge &&
-        bundle.node.attributes_.non_link_edge) {
-      // Check if this node has a link edge that is driveable from the node
-      for (const auto& edge : bundle.node_edges) {
-        if (edge.first.attributes.link &&
-            edge.first.attributes.driveforward) {
-          // Get the highest classification of non-link edges at this node.
-          // Add to the exit node list if a valid classification...if no
-          // connecting edge is driveable the node will be skipped.
-          uint32_t rc = GetBestNonLinkClass(bundle.node_edges);
-          if (rc < kMaxClassification) {
-            exit_nodes[rc].push_back(node_itr);
-          }
+    // Check if this node has a link edge that is driveable from the node
+    for (const auto& edge : bundle.node_edges) {
+      if (edge.first.attributes.link &&
+          edge.first.attributes.driveforward) {
+        // Get the highest classification of non-link edges at this node.
+        // Add to the exit node list if a valid classification...if no
+        // connecting edge is driveable the node will be skipped.
+        uint32_t rc = GetBestNonLinkClass(bundle.node_edges);
+        if (rc < kMaxClassification) {
+          exit_nodes[rc].push_back(node_itr);
         }
       }
     }
-
-    // Go to the next node
-    node_itr += bundle.node_count;
   }
 
   // Output exit counts for each class
@@ -148,7 +162,7 @@ nodelist_t FormExitNodes(sequence<Node>& nodes, sequence<Edge>& edges) {
 // reclassify sets of connected links until a branch (more than 1 child link)
 // or the root is encountered.
 std::pair<uint32_t, uint32_t> Reclassify(LinkTreeNode& root, sequence<Edge>& edges,
-                sequence<OSMWay>& ways, sequence<OSMWayNode>& way_nodes,
+                compressed_sequence<OSMWay>& ways, sequence<OSMWayNode>& way_nodes,
                 std::queue<LinkTreeNode*>& leaves) {
   // Get the classification at the root node.
   std::pair<uint32_t, uint32_t> counts = std::make_pair(0, 0);
@@ -260,7 +274,8 @@ std::pair<uint32_t, uint32_t> Reclassify(LinkTreeNode& root, sequence<Edge>& edg
 void ReclassifyLinks(const std::string& ways_file,
                      const std::string& nodes_file,
                      const std::string& edges_file,
-                     const std::string& way_nodes_file) {
+                     const std::string& way_nodes_file,
+                     const unsigned int threads) {
   LOG_INFO("Reclassifying link graph edges...");
 
     // Need to capture these in the expand lambda
@@ -326,13 +341,13 @@ void ReclassifyLinks(const std::string& ways_file,
 
   // Find list of exit nodes - nodes where driveable outbound links connect to
   // non-link edges. Group by best road class of the non-link connecting edges.
-  nodelist_t exit_nodes = FormExitNodes(nodes, edges);
+  nodelist_t exit_nodes = FormExitNodes(nodes_file, edges_file, nodes, edges, threads);
 
   // Iterate through the exit node list by classification so exits from major
   // roads are considered before exits from minor roads.
   uint32_t count = 0;
   uint32_t tc_count = 0;
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   for (uint32_t classification = 0; classification < 8; classification++) {
     for (auto& node : exit_nodes[classification]) {
@@ -1,6 +1,8 @@
 #include "mjolnir/luatagtransform.h"
 
 #include <stdexcept>
+#include <tuple>
+#include <utility>
 #include <boost/format.hpp>
 #include "midgard/logging.h"
 #include "mjolnir/osmdata.h"
@@ -84,18 +86,17 @@ Tags LuaTagTransform::Transform(OSMType type, const Tags &maptags) {
     //grab the function
     lua_getglobal(state_, lua_func.c_str());
 
-    //set up the lua table (map)
-    int count = 0;
-    lua_newtable(state_);
+    //set up the lua table (map), sized up front so lua doesnt rehash it as
+    //the tags are added and with the lengths we already know
+    lua_createtable(state_, 0, maptags.size());
     for (const auto& tag : maptags) {
-      lua_pushstring(state_, tag.first.c_str());
-      lua_pushstring(state_, tag.second.c_str());
+      lua_pushlstring(state_, tag.first.c_str(), tag.first.size());
+      lua_pushlstring(state_, tag.second.c_str(), tag.second.size());
       lua_rawset(state_, -3);
-      count++;
     }
 
     //tell lua how many items are in the map
-    lua_pushinteger(state_, count);
+    lua_pushinteger(state_, maptags.size());
 
     //call lua
     if (lua_pcall(state_, 2, type == OSMType::kWay ? 4 : 2, 0)) {
@@ -115,17 +116,19 @@ Tags LuaTagTransform::Transform(OSMType type, const Tags &maptags) {
     //pull out the keys and values into a map
     lua_pushnil(state_);
     while (lua_next(state_,-2) != 0) {
-      const char* key = lua_tostring(state_,-2);
+      size_t key_size, value_size;
+      const char* key = lua_tolstring(state_,-2,&key_size);
       if (key == nullptr) {
         LOG_ERROR((boost::format("Invalid key in Lua function: %1%.") % lua_func).str());
         break;
       }
-      const char* value = lua_tostring(state_,-1);
+      const char* value = lua_tolstring(state_,-1,&value_size);
       if (value == nullptr) {
         LOG_ERROR((boost::format("Invalid value in Lua function: %1%.") % lua_func).str());
         break;
       }
-      result[key] = value;
+      result.emplace(std::piecewise_construct, std::forward_as_tuple(key, key_size),
+                     std::forward_as_tuple(value, value_size));
       lua_pop(state_,1);
     }
 
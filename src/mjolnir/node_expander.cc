@@ -1,5 +1,8 @@
 #include "mjolnir/node_expander.h"
 
+#include <exception>
+#include <thread>
+
 namespace valhalla {
 namespace mjolnir {
 
@@ -18,7 +21,7 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
       auto edge = *edge_itr;
       // Set driveforward - this edge is traversed in forward direction
       edge.attributes.driveforward = edge.attributes.driveableforward;
-      bundle.node_edges.emplace(std::make_pair(edge, node.start_of));
+      bundle.add_edge(edge, node.start_of);
       bundle.node.attributes_.link_edge = bundle.node.attributes_.link_edge || edge.attributes.link;
       bundle.node.attributes_.ferry_edge = bundle.node.attributes_.ferry_edge || edge.attributes.driveable_ferry;
       bundle.node.attributes_.shortlink |= edge.attributes.shortlink;
@@ -42,7 +45,7 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
       auto edge = *edge_itr;
       // Set driveforward - this edge is traversed in reverse direction
       edge.attributes.driveforward = edge.attributes.driveablereverse;
-      bundle.node_edges.emplace(std::make_pair(edge, node.end_of));
+      bundle.add_edge(edge, node.end_of);
       bundle.node.attributes_.link_edge = bundle.node.attributes_.link_edge || edge.attributes.link;
       bundle.node.attributes_.ferry_edge = bundle.node.attributes_.ferry_edge || edge.attributes.driveable_ferry;
       bundle.node.attributes_.shortlink |= edge.attributes.shortlink;
@@ -64,5 +67,68 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
   return bundle;
 }
 
+std::vector<size_t> find_node_bundles(const std::string& nodes_file,
+                                      const std::string& edges_file,
+                                      const unsigned int threads,
+                                      const std::function<bool (const node_bundle&)>& pick) {
+  // Split the nodes evenly between the threads, moving each split forward to
+  // the start of a bundle so that no bundle is split
+  std::vector<size_t> splits(1, 0);
+  {
+    sequence<Node> nodes(nodes_file, false);
+    size_t count = std::max(threads, 1u);
+    for (size_t i = 1; i < count; ++i) {
+      size_t split = std::max(splits.back(), nodes.size() * i / count);
+      while (split > 0 && split < nodes.size() &&
+             (*nodes[split]).node.osmid == (*nodes[split - 1]).node.osmid) {
+        ++split;
+      }
+      splits.push_back(split);
+    }
+    splits.push_back(nodes.size());
+  }
+
+  // Scan a range of nodes with its own view of the files
+  std::vector<std::vector<size_t> > found(splits.size() - 1);
+  std::vector<std::exception_ptr> errors(found.size());
+  auto scan = [&](const size_t range) {
+    try {
+      sequence<Node> nodes(nodes_file, false);
+      sequence<Edge> edges(edges_file, false);
+      if (splits[range] == splits[range + 1]) {
+        return;
+      }
+      auto node_itr = nodes[splits[range]];
+      while (node_itr.position() < splits[range + 1]) {
+        auto bundle = collect_node_edges(node_itr, nodes, edges);
+        if (pick(bundle)) {
+          found[range].push_back(node_itr.position());
+        }
+        node_itr += bundle.node_count;
+      }
+    } catch (...) {
+      errors[range] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t range = 1; range < found.size(); ++range) {
+    workers.emplace_back(scan, range);
+  }
+  scan(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // Hand back the nodes in order
+  std::vector<size_t> nodes;
+  for (size_t range = 0; range < found.size(); ++range) {
+    if (errors[range]) {
+      std::rethrow_exception(errors[range]);
+    }
+    nodes.insert(nodes.end(), found[range].begin(), found[range].end());
+  }
+  return nodes;
+}
+
 }
 }
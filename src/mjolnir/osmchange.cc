@@ -0,0 +1,181 @@
+#include "mjolnir/osmchange.h"
+#include "mjolnir/osmdata.h"
+
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// The local level tile a point is in
+GraphId LocalTile(const PointLL& ll) {
+  return TileHierarchy::GetGraphId(ll, TileHierarchy::levels().rbegin()->first);
+}
+
+}
+
+namespace valhalla {
+namespace mjolnir {
+
+// Read the changes of an osc file
+void OSMChange::Read(const std::string& osc_file) {
+  boost::property_tree::ptree osc;
+  boost::property_tree::read_xml(osc_file, osc);
+  for (const auto& action : osc.get_child("osmChange")) {
+    if (action.first != "create" && action.first != "modify" && action.first != "delete")
+      continue;
+    bool deleted = action.first == "delete";
+    for (const auto& element : action.second) {
+      if (element.first == "<xmlattr>")
+        continue;
+      uint64_t id = element.second.get<uint64_t>("<xmlattr>.id");
+      if (element.first == "node") {
+        if (deleted) {
+          nodes.erase(id);
+          deleted_nodes.insert(id);
+        } else {
+          deleted_nodes.erase(id);
+          nodes[id] = PointLL(element.second.get<float>("<xmlattr>.lon"),
+                              element.second.get<float>("<xmlattr>.lat"));
+        }
+      } else if (element.first == "way") {
+        if (deleted) {
+          ways.erase(id);
+          deleted_ways.insert(id);
+        } else {
+          deleted_ways.erase(id);
+          auto& refs = ways[id];
+          refs.clear();
+          for (const auto& nd : element.second) {
+            if (nd.first == "nd")
+              refs.push_back(nd.second.get<uint64_t>("<xmlattr>.ref"));
+          }
+        }
+      } else if (element.first == "relation") {
+        for (const auto& member : element.second) {
+          if (member.first != "member")
+            continue;
+          auto type = member.second.get<std::string>("<xmlattr>.type");
+          if (type == "node")
+            relation_nodes.insert(member.second.get<uint64_t>("<xmlattr>.ref"));
+          else if (type == "way")
+            relation_ways.insert(member.second.get<uint64_t>("<xmlattr>.ref"));
+        }
+      }
+    }
+  }
+}
+
+// Find the tiles that have to be built again to pick up the changes
+std::set<GraphId> OSMChange::DirtyTiles(const boost::property_tree::ptree& pt,
+                                        const std::string& ways_file,
+                                        const std::string& way_nodes_file) const {
+  std::unordered_set<GraphId> dirty;
+
+  // Where the created and modified nodes are now
+  for (const auto& node : nodes)
+    dirty.insert(LocalTile(node.second));
+
+  // The nodes of the created and modified ways we don't have a new location for
+  std::unordered_map<uint64_t, PointLL> old_nodes;
+  for (const auto& way : ways) {
+    for (auto ref : way.second) {
+      if (nodes.find(ref) == nodes.end())
+        old_nodes.emplace(ref, PointLL());
+    }
+  }
+
+  // The way nodes are sorted by way and shape index so we see each way of the
+  // previous build at once. If anything about it changed, all of it goes
+  auto touched_node = [this](uint64_t id) {
+    return nodes.find(id) != nodes.end() || deleted_nodes.find(id) != deleted_nodes.end() ||
+           relation_nodes.find(id) != relation_nodes.end();
+  };
+  auto touched_way = [this](uint64_t id) {
+    return ways.find(id) != ways.end() || deleted_ways.find(id) != deleted_ways.end() ||
+           relation_ways.find(id) != relation_ways.end();
+  };
+  {
+    compressed_sequence<OSMWay> old_ways(ways_file, false);
+    sequence<OSMWayNode> way_nodes(way_nodes_file, false);
+    std::vector<PointLL> shape;
+    size_t way_index = -1;
+    bool touched = false;
+    auto finish_way = [&dirty, &shape, &touched]() {
+      if (touched) {
+        for (const auto& ll : shape)
+          dirty.insert(LocalTile(ll));
+      }
+      shape.clear();
+      touched = false;
+    };
+    way_nodes.enumerate([&](const OSMWayNode& way_node) {
+      if (way_node.way_index != way_index) {
+        finish_way();
+        way_index = way_node.way_index;
+        touched = touched_way((*old_ways[way_index]).way_id());
+      }
+      PointLL ll(way_node.node.lng, way_node.node.lat);
+      shape.push_back(ll);
+      touched = touched || touched_node(way_node.node.osmid);
+      auto old_node = old_nodes.find(way_node.node.osmid);
+      if (old_node != old_nodes.end())
+        old_node->second = ll;
+    });
+    finish_way();
+  }
+
+  // Where the nodes of the created and modified ways are now, nodes that
+  // weren't on any way before and weren't changed we can't know about
+  for (const auto& way : ways) {
+    for (auto ref : way.second) {
+      auto node = nodes.find(ref);
+      if (node != nodes.end())
+        continue;
+      auto old_node = old_nodes.find(ref);
+      if (old_node->second.IsValid())
+        dirty.insert(LocalTile(old_node->second));
+      else
+        LOG_WARN("No location for node " + std::to_string(ref) + " of way " + std::to_string(way.first));
+    }
+  }
+
+  // The neighbouring tiles with edges to the dirty ones need their opposing
+  // edges and end nodes fixed up
+  std::set<GraphId> tiles(dirty.begin(), dirty.end());
+  GraphReader reader(pt);
+  for (const auto& tile_id : dirty) {
+    const GraphTile* tile = reader.GetGraphTile(tile_id);
+    if (tile == nullptr)
+      continue;
+    for (uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
+      const DirectedEdge* edge = tile->directededge(i);
+      if (edge->endnode().level() == tile_id.level())
+        tiles.insert(edge->endnode().Tile_Base());
+    }
+    if (reader.OverCommitted())
+      reader.Clear();
+  }
+
+  // And the tiles over them all on the other levels
+  const auto& local_tiles = TileHierarchy::levels().rbegin()->second.tiles;
+  std::set<GraphId> parents;
+  for (const auto& tile_id : tiles) {
+    auto center = local_tiles.TileBounds(tile_id.tileid()).Center();
+    for (const auto& level : TileHierarchy::levels()) {
+      if (level.first != tile_id.level())
+        parents.insert(TileHierarchy::GetGraphId(center, level.first));
+    }
+  }
+  tiles.insert(parents.begin(), parents.end());
+  return tiles;
+}
+
+}
+}
@@ -34,6 +34,12 @@
 #include <netinet/in.h>
 #endif
 #include <zlib.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
@@ -49,201 +55,393 @@ namespace {
 // the maximum size of an uncompressed blob in bytes 32 MB
 #define MAX_UNCOMPRESSED_BLOB_SIZE 33554432
 
-BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
-  BlobHeader result;
+// a blob as it was read from the file and, once one of the workers gets
+// to it, the primitive block it decodes to
+struct block_t {
+  uint64_t offset;
+  std::string type;
+  std::string blob;
+  std::unique_ptr<PrimitiveBlock> primblock;
+  std::exception_ptr error;
+  bool decoded;
+};
+
+// reads the next blob header and blob from the file, false at the end of it
+bool read_block(std::ifstream& file, block_t& block) {
+  block.offset = file.tellg();
 
   //read the first 4 bytes of the file, this is the size of the blob-header
   int32_t sz;
-  if (!file.read(static_cast<char*>(static_cast<void*>(&sz)), 4)) {
-    finished = true;
-    return result;
-  }
+  if (!file.read(static_cast<char*>(static_cast<void*>(&sz)), 4))
+    return false;
 
   //convert the size from network byte-order to host byte-order and check its sane
   sz = ntohl(sz);
   if (sz > MAX_BLOB_HEADER_SIZE)
     throw std::runtime_error("blob-header-size is bigger than allowed " + std::to_string(sz) + " > " + std::to_string(MAX_BLOB_HEADER_SIZE));
 
-  //grab the blob header bytes
-  file.read(buffer, sz);
-  if (!file.good())
+  //grab the blob header bytes and turn them into a protobuf object
+  block.blob.resize(sz);
+  if (!file.read(&block.blob[0], sz))
     throw std::runtime_error("unable to read blob-header from file");
-
-  //turn the bytes into a protobuf object
-  if (!result.ParseFromArray(buffer, sz))
+  BlobHeader header;
+  if (!header.ParseFromArray(block.blob.data(), sz))
     throw std::runtime_error("unable to parse blob header");
 
-  finished = false;
-  return result;
-}
-
-int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader & header) {
-  Blob blob;
-
   //is the size of the following blob sane
-  int32_t sz = header.datasize();
+  sz = header.datasize();
   if (sz > MAX_UNCOMPRESSED_BLOB_SIZE)
     throw std::runtime_error("blob-size is bigger than allowed");
 
-  //pull out the bytes
-  if (!file.read(buffer, sz))
+  //pull out the bytes, decoding them is left to whoever has time for it
+  block.blob.resize(sz);
+  if (sz > 0 && !file.read(&block.blob[0], sz))
     throw std::runtime_error("unable to read blob from file");
+  block.type = header.type();
+  block.decoded = false;
+  return true;
+}
 
+// reads the next block, skipping those in the index without anything of interest
+bool read_next(std::ifstream& file, const Index* index, size_t& next, const Interest interest, block_t& block) {
+  if (index == nullptr)
+    return read_block(file, block);
+  while (next < index->size() && ((*index)[next].contents & interest) == 0)
+    ++next;
+  if (next == index->size())
+    return false;
+  file.clear();
+  if (!file.seekg((*index)[next++].offset))
+    throw std::runtime_error("unable to seek to blob in file");
+  if (!read_block(file, block))
+    throw std::runtime_error("unable to read indexed blob from file");
+  return true;
+}
+
+// inflates and decodes the blob of a block, the unpack buffer is scratch
+// space that only grows so each worker can keep reusing its own
+void decode_block(block_t& block, std::vector<char>& unpack_buffer) {
   //turn it into a protobuf object
-  if (!blob.ParseFromArray(buffer, sz))
+  Blob blob;
+  if (!blob.ParseFromArray(block.blob.data(), block.blob.size()))
     throw std::runtime_error("unable to parse blob");
+  std::string().swap(block.blob);
 
-  //if the blob was uncompressed
+  //if the blob was uncompressed we can use it as is
+  const char* data = nullptr;
+  int32_t sz = 0;
   if (blob.has_raw()) {
-    //check that raw_size is set correctly and move it to the final buffer
+    //check that raw_size is set correctly
     sz = blob.raw().size();
     if (sz != blob.raw_size())
       LOG_WARN("blob reports wrong raw_size: " + std::to_string(blob.raw_size()) + " bytes");
-    memcpy(unpack_buffer, buffer, sz);
-    return sz;
+    data = blob.raw().data();
   }//if the blob was zlib compressed
   else if (blob.has_zlib_data()) {
-    sz = blob.zlib_data().size();
+    if (blob.raw_size() > MAX_UNCOMPRESSED_BLOB_SIZE)
+      throw std::runtime_error("uncompressed blob-size is bigger than allowed");
+    if (unpack_buffer.size() < static_cast<size_t>(blob.raw_size()))
+      unpack_buffer.resize(blob.raw_size());
     z_stream z;
     z.next_in = (unsigned char*) blob.zlib_data().c_str();
-    z.avail_in = sz;
-    z.next_out = (unsigned char*) unpack_buffer;
+    z.avail_in = blob.zlib_data().size();
+    z.next_out = (unsigned char*) unpack_buffer.data();
     z.avail_out = blob.raw_size();
     z.zalloc = Z_NULL;
     z.zfree = Z_NULL;
     z.opaque = Z_NULL;
     if (inflateInit(&z) != Z_OK)
       throw std::runtime_error("failed to init zlib stream");
-    if (inflate(&z, Z_FINISH) != Z_STREAM_END)
+    if (inflate(&z, Z_FINISH) != Z_STREAM_END) {
+      inflateEnd(&z);
       throw std::runtime_error("failed to inflate zlib stream");
+    }
     if (inflateEnd(&z) != Z_OK)
       throw std::runtime_error("failed to deinit zlib stream");
-    return z.total_out;
-  }
-
-  //if the blob was lzma compressed
-  //if (blob.has_lzma_data())
+    data = unpack_buffer.data();
+    sz = z.total_out;
+  }//if the blob was lzma compressed
+  //else if (blob.has_lzma_data())
   //  throw std::runtime_error("lzma-decompression is not supported");
+  else
+    throw std::runtime_error("Unsupported blob data format");
 
-  throw std::runtime_error("Unsupported blob data format");
+  //turn the blob bytes into a protobuf object
+  block.primblock.reset();
+  if (block.type == "OSMData") {
+    block.primblock.reset(new PrimitiveBlock());
+    if (!block.primblock->ParseFromArray(data, sz))
+      throw std::runtime_error("unable to parse primitive block");
+  }//if its something other than a header
+  else if (block.type == "OSMHeader") {
+    HeaderBlock header_block;
+    if (!header_block.ParseFromArray(data, sz))
+      throw std::runtime_error("unable to parse header block");
+    //TODO: do something with replication information?
+  }
 }
 
 template <class T>
-OSMPBF::Tags get_tags(const T& object, const OSMPBF::PrimitiveBlock &primblock) {
-  OSMPBF::Tags result(object.keys_size());
-  for (int i = 0; i < object.keys_size(); ++i) {
-    uint64_t key = object.keys(i);
-    uint64_t val = object.vals(i);
-    std::string key_string = primblock.stringtable().s(key);
-    std::string val_string = primblock.stringtable().s(val);
-    result[key_string] = val_string;
-  }
-  return result;
+void get_tags(const T& object, const OSMPBF::PrimitiveBlock &primblock, OSMPBF::Tags& tags) {
+  tags.clear();
+  for (int i = 0; i < object.keys_size(); ++i)
+    tags[primblock.stringtable().s(object.keys(i))] = primblock.stringtable().s(object.vals(i));
 }
 
-void parse_primitive_block(char* unpack_buffer, int32_t sz, const Interest interest, Callback& callback) {
-  //turn the blob bytes into a protobuf object
-  PrimitiveBlock primblock;
-  if (!primblock.ParseFromArray(unpack_buffer, sz))
-    throw std::runtime_error("unable to parse primitive block");
-
-  //for each primitive group
-  for (const auto& primitive_group : primblock.primitivegroup()) {
-
-    //do the nodes
-    if ((interest & NODES) == NODES) {
-      // Simple Nodes
-      for (const auto& node : primitive_group.nodes()) {
-        double lon = 0.000000001 * (primblock.lon_offset() + (primblock.granularity() * node.lon()));
-        double lat = 0.000000001 * (primblock.lat_offset() + (primblock.granularity() * node.lat()));
-        callback.node_callback(node.id(), lon, lat, get_tags<Node>(node, primblock));
-        if (node.has_info() && node.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS)
-          callback.changeset_callback(node.info().changeset());
+// hands the contents of decoded blocks to the callback and adds them to the
+// index if there is one to fill in. the tags, node and member lists are kept
+// around from one element to the next and from one block to the next so that
+// their memory is only allocated once
+class block_parser_t {
+ public:
+  block_parser_t(const Interest interest, Callback& callback, Index* index)
+    : interest(interest), callback(callback), index(index) {}
+
+  void parse(const block_t& block) {
+    if (block.type == "OSMData")
+      parse_primitive_block(*block.primblock);
+    else if (block.type != "OSMHeader")
+      LOG_WARN("Unknown blob type: " + block.type);
+    if (index)
+      index->push_back({block.offset, contents(block)});
+  }
+
+ protected:
+  static Interest contents(const block_t& block) {
+    int contents = NONE;
+    if (block.primblock) {
+      for (const auto& primitive_group : block.primblock->primitivegroup()) {
+        if (primitive_group.nodes_size() || primitive_group.has_dense())
+          contents |= NODES;
+        if (primitive_group.ways_size())
+          contents |= WAYS;
+        if (primitive_group.relations_size())
+          contents |= RELATIONS;
+        if (primitive_group.changesets_size())
+          contents |= CHANGESETS;
       }
+    }
+    return static_cast<Interest>(contents);
+  }
 
-      // Dense Nodes
-      if (primitive_group.has_dense()) {
-        const DenseNodes& dense_nodes = primitive_group.dense();
-        uint64_t id = 0;
-        double lon = 0;
-        double lat = 0;
-
-        int current_kv = 0;
-        for (int i = 0; i < dense_nodes.id_size(); ++i) {
-          id += dense_nodes.id(i);
-          lon += 0.000000001 * (primblock.lon_offset() + (primblock.granularity() * dense_nodes.lon(i)));
-          lat += 0.000000001 * (primblock.lat_offset() + (primblock.granularity() * dense_nodes.lat(i)));
-
-          //can't exactly preallocate because you don't know how many there are
-          Tags tags;
-          while (current_kv < dense_nodes.keys_vals_size() && dense_nodes.keys_vals(current_kv) != 0) {
-            uint64_t key = dense_nodes.keys_vals(current_kv);
-            uint64_t val = dense_nodes.keys_vals(current_kv + 1);
-            std::string key_string = primblock.stringtable().s(key);
-            std::string val_string = primblock.stringtable().s(val);
-            current_kv += 2;
-            tags[key_string] = val_string;
-          }
-          ++current_kv;
-          callback.node_callback(id, lon, lat, tags);
+  void parse_primitive_block(const PrimitiveBlock& primblock) {
+    //for each primitive group
+    for (const auto& primitive_group : primblock.primitivegroup()) {
+
+      //do the nodes
+      if ((interest & NODES) == NODES) {
+        // Simple Nodes
+        for (const auto& node : primitive_group.nodes()) {
+          double lon = 0.000000001 * (primblock.lon_offset() + (primblock.granularity() * node.lon()));
+          double lat = 0.000000001 * (primblock.lat_offset() + (primblock.granularity() * node.lat()));
+          get_tags<Node>(node, primblock, tags);
+          callback.node_callback(node.id(), lon, lat, tags);
+          if (node.has_info() && node.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS)
+            callback.changeset_callback(node.info().changeset());
         }
-        if (dense_nodes.has_denseinfo() && (interest & CHANGESETS) == CHANGESETS) {
-          uint64_t changeset = 0;
-          for(auto changeset_id_offset : dense_nodes.denseinfo().changeset())
-            callback.changeset_callback(changeset += changeset_id_offset);
+
+        // Dense Nodes
+        if (primitive_group.has_dense()) {
+          const DenseNodes& dense_nodes = primitive_group.dense();
+          uint64_t id = 0;
+          double lon = 0;
+          double lat = 0;
+
+          int current_kv = 0;
+          for (int i = 0; i < dense_nodes.id_size(); ++i) {
+            id += dense_nodes.id(i);
+            lon += 0.000000001 * (primblock.lon_offset() + (primblock.granularity() * dense_nodes.lon(i)));
+            lat += 0.000000001 * (primblock.lat_offset() + (primblock.granularity() * dense_nodes.lat(i)));
+
+            tags.clear();
+            while (current_kv < dense_nodes.keys_vals_size() && dense_nodes.keys_vals(current_kv) != 0) {
+              uint64_t key = dense_nodes.keys_vals(current_kv);
+              uint64_t val = dense_nodes.keys_vals(current_kv + 1);
+              current_kv += 2;
+              tags[primblock.stringtable().s(key)] = primblock.stringtable().s(val);
+            }
+            ++current_kv;
+            callback.node_callback(id, lon, lat, tags);
+          }
+          if (dense_nodes.has_denseinfo() && (interest & CHANGESETS) == CHANGESETS) {
+            uint64_t changeset = 0;
+            for(auto changeset_id_offset : dense_nodes.denseinfo().changeset())
+              callback.changeset_callback(changeset += changeset_id_offset);
+          }
         }
       }
-    }
 
-    //do the ways
-    if ((interest & WAYS) == WAYS) {
-      for (const auto& way : primitive_group.ways()) {
-        uint64_t node = 0;
-        std::vector<uint64_t> nodes;
-        nodes.reserve(way.refs_size());
-        for (auto node_id_offset : way.refs()) {
-          node += node_id_offset;
-          //TODO: skip consecutive duplicates, make this configurable
-          if(nodes.size() == 0 || node != nodes.back())
-            nodes.push_back(node);
+      //do the ways
+      if ((interest & WAYS) == WAYS) {
+        for (const auto& way : primitive_group.ways()) {
+          uint64_t node = 0;
+          nodes.clear();
+          nodes.reserve(way.refs_size());
+          for (auto node_id_offset : way.refs()) {
+            node += node_id_offset;
+            //TODO: skip consecutive duplicates, make this configurable
+            if(nodes.size() == 0 || node != nodes.back())
+              nodes.push_back(node);
+          }
+          get_tags<Way>(way, primblock, tags);
+          callback.way_callback(way.id(), tags, nodes);
+          if (way.has_info() && way.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS)
+            callback.changeset_callback(way.info().changeset());
         }
-        callback.way_callback(way.id(), get_tags<Way>(way, primblock), nodes);
-        if (way.has_info() && way.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS)
-          callback.changeset_callback(way.info().changeset());
       }
-    }
 
-    //do the relations
-    if ((interest & RELATIONS) == RELATIONS) {
-      for (const auto& relation : primitive_group.relations()) {
-        uint64_t member = 0;
-        std::vector<Member> members;
-        members.reserve(relation.memids_size());
-        for (int l = 0; l < relation.memids_size(); ++l) {
-          member += relation.memids(l);
-          members.emplace_back(relation.types(l), member, primblock.stringtable().s(relation.roles_sid(l)));
+      //do the relations
+      if ((interest & RELATIONS) == RELATIONS) {
+        for (const auto& relation : primitive_group.relations()) {
+          uint64_t member = 0;
+          members.clear();
+          members.reserve(relation.memids_size());
+          for (int l = 0; l < relation.memids_size(); ++l) {
+            member += relation.memids(l);
+            members.emplace_back(relation.types(l), member, primblock.stringtable().s(relation.roles_sid(l)));
+          }
+          get_tags<Relation>(relation, primblock, tags);
+          callback.relation_callback(relation.id(), tags, members);
+          if (relation.has_info() && relation.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS)
+            callback.changeset_callback(relation.info().changeset());
         }
-        callback.relation_callback(relation.id(), get_tags<Relation>(relation, primblock), members);
-        if (relation.has_info() && relation.info().has_changeset() && (interest & CHANGESETS) == CHANGESETS)
-          callback.changeset_callback(relation.info().changeset());
       }
+
+      //do the changesets
+      if ((interest & CHANGESETS) == CHANGESETS)
+       for (const auto& changeset : primitive_group.changesets())
+         callback.changeset_callback(changeset.id());
     }
+  }
 
-    //do the changesets
-    if ((interest & CHANGESETS) == CHANGESETS)
-     for (const auto& changeset : primitive_group.changesets())
-       callback.changeset_callback(changeset.id());
+  const Interest interest;
+  Callback& callback;
+  Index* index;
+  Tags tags;
+  std::vector<uint64_t> nodes;
+  std::vector<Member> members;
+};
+
+// one thread reads blobs from the file as fast as it can, a pool of workers
+// inflates and decodes them and the calling thread hands them to the callback
+// in the order they were in the file, since the callbacks count on that
+class pipeline_t {
+ public:
+  pipeline_t(std::ifstream& file, const unsigned int threads, const Index* index, const Interest interest)
+    : file(file), index(index), interest(interest), max_blocks(threads * 4), reading(true), stopped(false) {
+    reader = std::thread(&pipeline_t::read, this);
+    for (unsigned int i = 0; i < threads; ++i)
+      workers.emplace_back(&pipeline_t::decode, this);
   }
-}
 
-void parse_header_block(char* unpack_buffer, int32_t sz) {
-  //turn the blob bytes into a protobuf object
-  HeaderBlock header_block;
-  if (!header_block.ParseFromArray(unpack_buffer, sz))
-    throw std::runtime_error("unable to parse header block");
+  ~pipeline_t() {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      stopped = true;
+    }
+    read_cv.notify_all();
+    decode_cv.notify_all();
+    reader.join();
+    for (auto& worker : workers)
+      worker.join();
+  }
 
-  //TODO: do something with replication information?
-}
+  // the next block in file order once its decoded, null at the end of the file
+  std::shared_ptr<block_t> next() {
+    std::unique_lock<std::mutex> lock(mutex);
+    deliver_cv.wait(lock, [this]() {
+      return (!blocks.empty() && blocks.front()->decoded) || (blocks.empty() && !reading);
+    });
+    if (blocks.empty())
+      return nullptr;
+    auto block = blocks.front();
+    blocks.pop_front();
+    lock.unlock();
+    read_cv.notify_one();
+    if (block->error)
+      std::rethrow_exception(block->error);
+    return block;
+  }
+
+ protected:
+  void read() {
+    size_t next = 0;
+    while (true) {
+      std::shared_ptr<block_t> block(new block_t());
+      bool more = false;
+      try {
+        more = read_next(file, index, next, interest, *block);
+      }
+      catch (...) {
+        block->error = std::current_exception();
+        block->decoded = true;
+      }
+
+      //wait for some room and hand it out to be decoded
+      std::unique_lock<std::mutex> lock(mutex);
+      read_cv.wait(lock, [this]() { return blocks.size() < max_blocks || stopped; });
+      if (stopped)
+        return;
+      if (block->error) {
+        blocks.push_back(block);
+        reading = false;
+        lock.unlock();
+        deliver_cv.notify_one();
+        decode_cv.notify_all();
+        return;
+      }
+      if (!more) {
+        reading = false;
+        lock.unlock();
+        deliver_cv.notify_one();
+        decode_cv.notify_all();
+        return;
+      }
+      blocks.push_back(block);
+      undecoded.push_back(block);
+      lock.unlock();
+      decode_cv.notify_one();
+    }
+  }
+
+  void decode() {
+    std::vector<char> unpack_buffer;
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex);
+      decode_cv.wait(lock, [this]() { return !undecoded.empty() || !reading || stopped; });
+      if (undecoded.empty() || stopped)
+        return;
+      auto block = undecoded.front();
+      undecoded.pop_front();
+      lock.unlock();
+
+      try {
+        decode_block(*block, unpack_buffer);
+      }
+      catch (...) {
+        block->error = std::current_exception();
+      }
+
+      lock.lock();
+      block->decoded = true;
+      lock.unlock();
+      deliver_cv.notify_one();
+    }
+  }
+
+  std::ifstream& file;
+  const Index* index;
+  const Interest interest;
+  const size_t max_blocks;
+  std::mutex mutex;
+  std::condition_variable read_cv, decode_cv, deliver_cv;
+  std::deque<std::shared_ptr<block_t> > blocks;     //read, in file order
+  std::deque<std::shared_ptr<block_t> > undecoded;  //read, waiting for a worker
+  bool reading;
+  bool stopped;
+  std::thread reader;
+  std::vector<std::thread> workers;
+};
 
 }
 
@@ -256,37 +454,32 @@ Member::Member(const Relation::MemberType type, const uint64_t id, const std::st
 Member::Member(Member&& other): member_type(other.member_type), member_id(other.member_id), role(std::move(other.role)) {
 }
 
-void Parser::parse(std::ifstream& file, const Interest interest, Callback& callback) {
-  char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-  char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-
+void Parser::parse(std::ifstream& file, const Interest interest, Callback& callback,
+                   const unsigned int threads, Index* index) {
   //start from the top
   file.clear();
   file.seekg(0, std::ios::beg);
 
-  //while there is more to read
-  while (!file.eof()) {
-    //grab the blob header
-    bool finished = false;
-    BlobHeader header = read_header(buffer, file, finished);
-    //if we didnt hit the end
-    if (!finished) {
-      //grab the blob that goes with the blob header
-      int32_t sz = read_blob(buffer, unpack_buffer, file, header);
-      //if its data parse it
-      if (header.type() == "OSMData")
-        parse_primitive_block(unpack_buffer, sz, interest, callback);
-      //if its something other than a header
-      else if (header.type() == "OSMHeader")
-        parse_header_block(unpack_buffer, sz);
-      else
-        LOG_WARN("Unknown blob type: " + header.type());
+  //either we read the blocks the index points at or we fill in the index
+  const Index* skip = index && !index->empty() ? index : nullptr;
+  block_parser_t parser(interest, callback, skip ? nullptr : index);
+
+  //on one thread read, decode and parse one blob at a time
+  if (threads <= 1) {
+    block_t block;
+    std::vector<char> unpack_buffer;
+    size_t next = 0;
+    while (read_next(file, skip, next, interest, block)) {
+      decode_block(block, unpack_buffer);
+      parser.parse(block);
     }
+    return;
   }
 
-  //done with protobuf and buffers
-  delete [] buffer;
-  delete [] unpack_buffer;
+  //otherwise the reading and decoding happens ahead of the parsing
+  pipeline_t pipeline(file, threads, skip, interest);
+  while (auto block = pipeline.next())
+    parser.parse(*block);
 }
 
 void Parser::free() {
@@ -0,0 +1,175 @@
+#include "mjolnir/overlaybuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "midgard/logging.h"
+#include "baldr/graphtile.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Search label of a node while crossing a cell
+struct label_t {
+  float cost;
+  float secs;
+  float length;
+};
+
+using queue_entry_t = std::pair<float, uint32_t>;
+using min_queue_t = std::priority_queue<queue_entry_t, std::vector<queue_entry_t>,
+                                        std::greater<queue_entry_t> >;
+
+}
+
+namespace valhalla {
+namespace mjolnir {
+
+OverlayGraph OverlayBuilder::Overlay(const std::string& costing_name,
+                                     const std::vector<GraphId>& edges,
+                                     const std::vector<uint32_t>& end_tiles,
+                                     const std::vector<CHBuilder::Turn>& turns,
+                                     const uint32_t threads) {
+  // The turns leaving each node
+  std::vector<uint32_t> turn_offsets(edges.size() + 1, 0);
+  for (const auto& turn : turns)
+    turn_offsets[turn.from + 1]++;
+  for (size_t i = 1; i < turn_offsets.size(); ++i)
+    turn_offsets[i] += turn_offsets[i - 1];
+  std::vector<CHBuilder::Turn> out(turns.size());
+  std::vector<uint32_t> next_turn(turn_offsets.begin(), turn_offsets.end() - 1);
+  for (const auto& turn : turns)
+    out[next_turn[turn.from]++] = turn;
+
+  // The nodes whose edge leaves its cell are the nodes of the overlay
+  std::vector<uint32_t> boundary;
+  std::vector<uint32_t> overlay_node(edges.size(), kInvalidOverlayNode);
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    if (end_tiles[i] != edges[i].tileid()) {
+      overlay_node[i] = boundary.size();
+      boundary.push_back(i);
+    }
+  }
+
+  // Cross the cell each boundary node enters to every boundary node leaving
+  // it, over the nodes of that cell alone. Nothing is shared between the
+  // searches but the graph so they are split across threads.
+  std::vector<std::vector<OverlayArc> > cliques(boundary.size());
+  std::atomic<size_t> next(0);
+  const auto cross = [&]() {
+    std::unordered_map<uint32_t, label_t> labels;
+    min_queue_t queue;
+    for (size_t b = next++; b < boundary.size(); b = next++) {
+      const uint32_t from = boundary[b];
+      const uint32_t cell = end_tiles[from];
+      labels.clear();
+      labels[from] = {0.f, 0.f, 0.f};
+      queue.emplace(0.f, from);
+      while (!queue.empty()) {
+        float cost = queue.top().first;
+        uint32_t node = queue.top().second;
+        queue.pop();
+        const label_t pred = labels[node];
+        if (cost > pred.cost)
+          continue;
+        // Leaving the cell, the rest is up to the overlay
+        if (node != from && overlay_node[node] != kInvalidOverlayNode) {
+          cliques[b].push_back({overlay_node[node], pred.cost, pred.secs, pred.length});
+          continue;
+        }
+        for (uint32_t t = turn_offsets[node]; t < turn_offsets[node + 1]; ++t) {
+          const auto& turn = out[t];
+          if (edges[turn.to].tileid() != cell)
+            continue;
+          float c = cost + turn.cost;
+          auto label = labels.find(turn.to);
+          if (label == labels.end() || c < label->second.cost) {
+            labels[turn.to] = {c, pred.secs + turn.secs, pred.length + turn.length};
+            queue.emplace(c, turn.to);
+          }
+        }
+      }
+      std::sort(cliques[b].begin(), cliques[b].end(),
+                [](const OverlayArc& x, const OverlayArc& y) { return x.node < y.node; });
+    }
+  };
+  size_t thread_count = std::max<size_t>(1, std::min<size_t>(
+      threads ? threads : std::max(1u, std::thread::hardware_concurrency()), boundary.size()));
+  std::vector<std::thread> pool;
+  for (size_t i = 1; i < thread_count; ++i)
+    pool.emplace_back(cross);
+  cross();
+  for (auto& thread : pool)
+    thread.join();
+
+  // Pack the cliques into the arcs of the overlay
+  std::vector<GraphId> nodes;
+  std::vector<uint32_t> offsets(1, 0);
+  std::vector<OverlayArc> arcs;
+  nodes.reserve(boundary.size());
+  offsets.reserve(boundary.size() + 1);
+  for (size_t b = 0; b < boundary.size(); ++b) {
+    nodes.push_back(edges[boundary[b]]);
+    arcs.insert(arcs.end(), cliques[b].begin(), cliques[b].end());
+    offsets.push_back(arcs.size());
+    std::vector<OverlayArc>().swap(cliques[b]);
+  }
+  LOG_INFO("Crossed the cells of " + std::to_string(edges.size()) + " edges between " +
+           std::to_string(nodes.size()) + " boundary edges with " +
+           std::to_string(arcs.size()) + " arcs");
+  return OverlayGraph(costing_name, std::move(nodes), std::move(offsets), std::move(arcs));
+}
+
+OverlayGraph OverlayBuilder::Overlay(GraphReader& reader, const cost_ptr_t& costing,
+                                     const std::string& costing_name, const uint32_t threads) {
+  // The turns between the level 0 edges, the turns onto the other levels
+  // are left to the searches of the matrix
+  std::vector<GraphId> edges;
+  auto turns = CHBuilder::Turns(reader, costing, costing_name, edges, nullptr, 0);
+  std::vector<uint32_t> end_tiles;
+  end_tiles.reserve(edges.size());
+  for (const auto& edgeid : edges) {
+    if (reader.OverCommitted())
+      reader.Trim();
+    end_tiles.push_back(reader.directededge(edgeid)->endnode().tileid());
+  }
+  reader.Clear();
+  return Overlay(costing_name, edges, end_tiles, turns, threads);
+}
+
+void OverlayBuilder::Build(const boost::property_tree::ptree& pt, const std::string& costing) {
+  // Default costing options, the overlay is only used when a request
+  // doesn't change them
+  CostFactory<DynamicCost> factory;
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("hov", CreateHOVCost);
+  factory.Register("motor_scooter", CreateMotorScooterCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("truck", CreateTruckCost);
+  auto cost = factory.Create(costing, rapidjson::Value{});
+
+  GraphReader reader(pt.get_child("mjolnir"));
+  auto graph = Overlay(reader, cost, costing,
+                       pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  auto file_name = OverlayGraph::FileName(pt.get<std::string>("mjolnir.tile_dir"), costing);
+  graph.Write(file_name);
+  LOG_INFO("Wrote boundary overlay with " + std::to_string(graph.node_count()) +
+           " nodes and " + std::to_string(graph.arc_count()) + " arcs to " + file_name);
+}
+
+}
+}
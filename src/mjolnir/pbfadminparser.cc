@@ -135,6 +135,7 @@ OSMData PBFAdminParser::Parse(const boost::property_tree::ptree& pt, const std::
   // methods can use it.
   OSMData osmdata{};
   admin_callback callback(pt, osmdata);
+  unsigned int threads = std::max(static_cast<unsigned int>(1), pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
 
   LOG_INFO("Parsing files: " + boost::algorithm::join(input_files, ", "));
 
@@ -147,23 +148,28 @@ OSMData PBFAdminParser::Parse(const boost::property_tree::ptree& pt, const std::
       throw std::runtime_error("Unable to open: " + input_file);
   }
 
-  // Parse each input file for relations
+  // Parse each input file for relations, noting where the blocks of ways and
+  // nodes are so the other passes can skip the rest
   LOG_INFO("Parsing relations...");
+  std::vector<OSMPBF::Index> indices(file_handles.size());
+  auto index = indices.begin();
   for (auto& file_handle : file_handles)
-    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS | OSMPBF::Interest::CHANGESETS), callback);
+    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS | OSMPBF::Interest::CHANGESETS), callback, threads, &*index++);
   LOG_INFO("Finished with " + std::to_string(osmdata.admins_.size()) + " admin polygons comprised of " + std::to_string(osmdata.osm_way_count) + " ways");
 
   // Parse the ways.
   LOG_INFO("Parsing ways...");
+  index = indices.begin();
   for (auto& file_handle : file_handles)
-    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS | OSMPBF::Interest::CHANGESETS), callback);
+    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS | OSMPBF::Interest::CHANGESETS), callback, threads, &*index++);
   LOG_INFO("Finished with " + std::to_string(osmdata.way_map.size()) + " ways comprised of " + std::to_string(osmdata.node_count) + " nodes");
 
   // Parse node in all the input files. Skip any that are not marked from
   // being used in a way.
   LOG_INFO("Parsing nodes...");
+  index = indices.begin();
   for (auto& file_handle : file_handles)
-    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES | OSMPBF::Interest::CHANGESETS), callback);
+    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES | OSMPBF::Interest::CHANGESETS), callback, threads, &*index++);
   LOG_INFO("Finished with " + std::to_string(osmdata.osm_node_count) + " nodes");
 
   // Return OSM data
@@ -56,6 +56,9 @@ struct graph_callback : public OSMPBF::Callback {
     }
 
     include_driveways_ = pt.get<bool>("include_driveways", true);
+
+    // Only the built in tag transform is known to drop some elements outright
+    builtin_lua_ = !pt.get_optional<std::string>("graph_lua_name");
   }
 
   static std::string get_lua(const boost::property_tree::ptree& pt) {
@@ -112,19 +115,19 @@ struct graph_callback : public OSMPBF::Callback {
         bool hasTag = (tag.second.length() ? true : false);
         n.set_exit_to(hasTag);
         if (hasTag)
-          osmdata_.node_exit_to[osmid] = tag.second;
+          osmdata_.node_exit_to.insert(osmid, osmdata_.name_offset_map.index(tag.second));
       }
       else if (is_highway_junction && (tag.first == "ref")) {
         bool hasTag = (tag.second.length() ? true : false);
         n.set_ref(hasTag);
         if (hasTag)
-          osmdata_.node_ref[osmid] = tag.second;
+          osmdata_.node_ref.insert(osmid, osmdata_.ref_offset_map.index(tag.second));
       }
       else if (is_highway_junction && (tag.first == "name")) {
         bool hasTag = (tag.second.length() ? true : false);
         n.set_name(hasTag);
         if (hasTag)
-          osmdata_.node_name[osmid] = tag.second;
+          osmdata_.node_name.insert(osmid, osmdata_.name_offset_map.index(tag.second));
       }
       else if (tag.first == "gate") {
         if (tag.second == "true") {
@@ -210,6 +213,16 @@ struct graph_callback : public OSMPBF::Callback {
       return;
     }
 
+    // The built in tag transform drops every way that is neither a highway,
+    // a ferry nor an auto train. Skip calling into lua for those, they are
+    // most of the ways (buildings, landuse, ...)
+    if (builtin_lua_ && tags.find("highway") == tags.cend()) {
+      auto route = tags.find("route");
+      if (route == tags.cend() || (route->second != "ferry" && route->second != "shuttle_train")) {
+        return;
+      }
+    }
+
     // Transform tags. If no results that means the way does not have tags
     // suitable for use in routing.
     Tags results = lua_.Transform(OSMType::kWay, tags);
@@ -1015,6 +1028,16 @@ struct graph_callback : public OSMPBF::Callback {
   }
 
   virtual void relation_callback(const uint64_t osmid, const OSMPBF::Tags &tags, const std::vector<OSMPBF::Member> &members) override {
+    // The built in tag transform only keeps restrictions, routes and lane
+    // connectivity, skip calling into lua for the other relations
+    if (builtin_lua_) {
+      auto type = tags.find("type");
+      if (type == tags.cend() || (type->second != "restriction" && type->second != "route" &&
+                                  type->second != "connectivity")) {
+        return;
+      }
+    }
+
     // Get tags
     Tags results = lua_.Transform(OSMType::kRelation, tags);
     if (results.size() == 0)
@@ -1330,7 +1353,7 @@ struct graph_callback : public OSMPBF::Callback {
   }
 
   //lets the sequences be set and reset
-  void reset(sequence<OSMWay>* ways, sequence<OSMWayNode>* way_nodes,
+  void reset(compressed_sequence<OSMWay>* ways, sequence<OSMWayNode>* way_nodes,
              sequence<OSMAccess>* access, sequence<OSMRestriction>* complex_restrictions){
     //reset the pointers (either null them out or set them to something valid)
     ways_.reset(ways);
@@ -1354,6 +1377,9 @@ struct graph_callback : public OSMPBF::Callback {
   // Configuration option to include driveways
   bool include_driveways_;
 
+  // Are tags transformed by the built in lua script (no graph_lua_name)
+  bool builtin_lua_;
+
   //Road class assignment needs to be set to the highway cutoff for ferries and auto trains.
   RoadClass highway_cutoff_rc_;
 
@@ -1369,7 +1395,7 @@ struct graph_callback : public OSMPBF::Callback {
   IdTable shape_, intersection_;
 
   // Ways and nodes written to file, nodes are written in the order they appear in way (shape)
-  std::unique_ptr<sequence<OSMWay> > ways_;
+  std::unique_ptr<compressed_sequence<OSMWay> > ways_;
   std::unique_ptr<sequence<OSMWayNode> > way_nodes_;
   // When updating the references with the node information we keep the last index we looked at
   // this lets us only have to iterate over the whole set once
@@ -1395,15 +1421,14 @@ namespace mjolnir {
 OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt, const std::vector<std::string>& input_files,
     const std::string& ways_file, const std::string& way_nodes_file, const std::string& access_file,
     const std::string& complex_restriction_file) {
-  //TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  //option 2: synchronize around adding things to a single osmdata. will have to test to see
-  //which is the least expensive (memory and speed). leaning towards option 2
+  //the callbacks aren't thread safe so the threads are only used to decode the pbf blobs
   unsigned int threads = std::max(static_cast<unsigned int>(1), pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  size_t sort_memory = pt.get<size_t>("sort_memory", 1024 * 1024 * 512);
 
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   OSMData osmdata{};
   graph_callback callback(pt, osmdata);
-  callback.reset(new sequence<OSMWay>(ways_file, true),
+  callback.reset(new compressed_sequence<OSMWay>(ways_file, true),
     new sequence<OSMWayNode>(way_nodes_file, true),
     new sequence<OSMAccess>(access_file, true),
     new sequence<OSMRestriction>(complex_restriction_file, true));
@@ -1419,14 +1444,21 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt, const std::
   }
 
   // Parse the ways and find all node Ids needed (those that are part of a
-  // way's node list. Iterate through each pbf input file.
-  LOG_INFO("Parsing ways...");
+  // way's node list. The relations don't depend on the ways so they are parsed
+  // from the same blocks. Iterate through each pbf input file, noting where its
+  // blocks of nodes are so the node pass can skip the rest
+  LOG_INFO("Parsing ways and relations...");
+  std::vector<OSMPBF::Index> indices(file_handles.size());
+  auto index = indices.begin();
   for (auto& file_handle : file_handles) {
     callback.current_way_node_index_ = callback.last_node_ = callback.last_way_ = callback.last_relation_ = 0;
-    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS | OSMPBF::Interest::CHANGESETS), callback);
+    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS | OSMPBF::Interest::RELATIONS | OSMPBF::Interest::CHANGESETS), callback, threads, &*index++);
   }
   callback.output_loops();
+  callback.reset(nullptr, nullptr, nullptr, nullptr);
   LOG_INFO("Finished with " + std::to_string(osmdata.osm_way_count) + " routable ways containing " + std::to_string(osmdata.osm_way_node_count) + " nodes");
+  LOG_INFO("Finished with " + std::to_string(osmdata.restrictions.size()) + " simple restrictions");
+  LOG_INFO("Finished with " + std::to_string(osmdata.lane_connectivity_map.size()) + " lane connections");
 
   //we need to sort the access tags so that we can easily find them.
   LOG_INFO("Sorting osm access tags by way id...");
@@ -1435,25 +1467,16 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt, const std::
     access.sort(
         [](const OSMAccess& a, const OSMAccess& b){
       return a.way_id() < b.way_id();
-    }
+    }, sort_memory / sizeof(OSMAccess), threads
     );
   }
 
-  // Parse relations.
-  LOG_INFO("Parsing relations...");
-  for (auto& file_handle : file_handles) {
-    callback.current_way_node_index_ = callback.last_node_ = callback.last_way_ = callback.last_relation_ = 0;
-    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS | OSMPBF::Interest::CHANGESETS), callback);
-  }
-  LOG_INFO("Finished with " + std::to_string(osmdata.restrictions.size()) + " simple restrictions");
-  LOG_INFO("Finished with " + std::to_string(osmdata.lane_connectivity_map.size()) + " lane connections");
-  callback.reset(nullptr, nullptr, nullptr, nullptr);
-
   //we need to sort the complex restrictions so that we can easily find them.
   LOG_INFO("Sorting complex restrictions by from id...");
   {
     sequence<OSMRestriction> complex_restrictions(complex_restriction_file, false);
-    complex_restrictions.sort([](const OSMRestriction& a, const OSMRestriction& b){return a < b;});
+    complex_restrictions.sort([](const OSMRestriction& a, const OSMRestriction& b){return a < b;},
+                              sort_memory / sizeof(OSMRestriction), threads);
   }
 
   //we need to sort the refs so that we can easily (sequentially) update them
@@ -1465,7 +1488,7 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt, const std::
     way_nodes.sort(
       [](const OSMWayNode& a, const OSMWayNode& b){
         return a.node.osmid < b.node.osmid;
-      }
+      }, sort_memory / sizeof(OSMWayNode), threads
     );
   }
   LOG_INFO("Finished");
@@ -1474,16 +1497,22 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt, const std::
   // being used in a way.
   // TODO: we know how many knows we expect, stop early once we have that many
   LOG_INFO("Parsing nodes...");
+  index = indices.begin();
   for (auto& file_handle : file_handles) {
     //each time we parse nodes we have to run through the way nodes file from the beginning because
     //because osm node ids are only sorted at the single pbf file level
     callback.reset(nullptr, new sequence<OSMWayNode>(way_nodes_file, false), nullptr, nullptr);
     callback.current_way_node_index_ = callback.last_node_ = callback.last_way_ = callback.last_relation_ = 0;
-    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES | OSMPBF::Interest::CHANGESETS), callback);
+    OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES | OSMPBF::Interest::CHANGESETS), callback, threads, &*index++);
   }
   callback.reset(nullptr, nullptr, nullptr, nullptr);
   LOG_INFO("Finished with " + std::to_string(osmdata.osm_node_count) + " nodes contained in routable ways");
 
+  //node ids are only sorted per input file so sort the node names and refs now
+  osmdata.node_ref.sort();
+  osmdata.node_exit_to.sort();
+  osmdata.node_name.sort();
+
   //we need to sort the refs so that we easily iterate over them for building edges
   //so we line them first by way index then by shape index of the node
   LOG_INFO("Sorting osm way node references by way index and node shape index...");
@@ -1496,7 +1525,7 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt, const std::
           return a.way_shape_node_index < b.way_shape_node_index;
         }
         return a.way_index < b.way_index;
-      }
+      }, sort_memory / sizeof(OSMWayNode), threads
     );
   }
 
@@ -1506,7 +1535,7 @@ OSMData PBFGraphParser::Parse(const boost::property_tree::ptree& pt, const std::
   LOG_DEBUG("Number of node refs (exits) = " + std::to_string(osmdata.node_ref.size()));
   LOG_DEBUG("Number of node exit_to = " + std::to_string(osmdata.node_exit_to.size()));
   LOG_DEBUG("Number of node names = " + std::to_string(osmdata.node_name.size()));
-  LOG_DEBUG("Number of way refs = " + std::to_string(osmdata.node_ref.size()));
+  LOG_DEBUG("Number of way refs = " + std::to_string(osmdata.way_ref.size()));
   LOG_DEBUG("Ref Names:");
   osmdata.ref_offset_map.Log();
   LOG_DEBUG("Names");
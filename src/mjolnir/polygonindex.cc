@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <iterator>
+
+#include "mjolnir/polygonindex.h"
+
+using namespace valhalla::midgard;
+
+namespace valhalla {
+namespace mjolnir {
+
+// Constructor.
+PolygonIndex::PolygonIndex(
+    const std::unordered_map<uint32_t, multi_polygon_type>& polys,
+    const AABB2<PointLL>& bounds, const uint32_t grid_size)
+    : bounds_(bounds), grid_size_(std::max(grid_size, 1u)),
+      cell_width_(bounds.Width() / grid_size_),
+      cell_height_(bounds.Height() / grid_size_),
+      cells_(grid_size_ * grid_size_, Cell{false, 0, {}}) {
+  // Keep the polygons in the order GetMultiPolyId tests them so points
+  // covered by more than one polygon get the same one
+  std::vector<value_type> boxes;
+  polys_.reserve(polys.size());
+  boxes.reserve(polys.size());
+  for (const auto& poly : polys) {
+    box_type box;
+    boost::geometry::envelope(poly.second, box);
+    boxes.emplace_back(box, polys_.size());
+    polys_.emplace_back(poly.first, &poly.second);
+  }
+
+  // Bulk load the R-tree
+  rtree_ = decltype(rtree_)(boxes.begin(), boxes.end());
+}
+
+// Get the index of the polygon that covers a point.
+uint32_t PolygonIndex::Get(const PointLL& ll) const {
+  point_type p(ll.lng(), ll.lat());
+
+  // Points off the tile test the polygons whose bounding boxes hold them
+  if (!bounds_.Contains(ll) || cell_width_ <= 0.0 || cell_height_ <= 0.0) {
+    std::vector<value_type> results;
+    rtree_.query(boost::geometry::index::intersects(p),
+                 std::back_inserter(results));
+    std::vector<uint32_t> candidates;
+    candidates.reserve(results.size());
+    for (const auto& result : results) {
+      candidates.push_back(result.second);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    return Test(p, candidates, 0);
+  }
+
+  // Find the cell holding the point, classifying it on first use
+  uint32_t col = std::min(static_cast<uint32_t>((ll.lng() - bounds_.minx()) /
+                          cell_width_), grid_size_ - 1);
+  uint32_t row = std::min(static_cast<uint32_t>((ll.lat() - bounds_.miny()) /
+                          cell_height_), grid_size_ - 1);
+  Cell& cell = cells_[row * grid_size_ + col];
+  if (!cell.classified) {
+    Classify(row, col, cell);
+  }
+  return Test(p, cell.candidates, cell.id);
+}
+
+// Classify a cell from the polygons whose bounding boxes it intersects
+void PolygonIndex::Classify(const uint32_t row, const uint32_t col,
+                            Cell& cell) const {
+  double minx = bounds_.minx() + col * cell_width_;
+  double miny = bounds_.miny() + row * cell_height_;
+  box_type box(point_type(minx, miny),
+               point_type(minx + cell_width_, miny + cell_height_));
+  polygon_type cell_poly;
+  boost::geometry::convert(box, cell_poly);
+
+  std::vector<value_type> results;
+  rtree_.query(boost::geometry::index::intersects(box),
+               std::back_inserter(results));
+  std::sort(results.begin(), results.end(),
+    [](const value_type& a, const value_type& b) {
+      return a.second < b.second;
+    });
+
+  // Polygons after one that covers the whole cell can never be returned
+  for (const auto& result : results) {
+    const auto& poly = polys_[result.second];
+    if (boost::geometry::covered_by(cell_poly, *poly.second)) {
+      cell.id = poly.first;
+      break;
+    }
+    if (boost::geometry::intersects(box, *poly.second)) {
+      cell.candidates.push_back(result.second);
+    }
+  }
+  cell.classified = true;
+}
+
+// Test the point against the candidates in order
+uint32_t PolygonIndex::Test(const point_type& p,
+                            const std::vector<uint32_t>& candidates,
+                            const uint32_t id) const {
+  for (const auto candidate : candidates) {
+    const auto& poly = polys_[candidate];
+    if (boost::geometry::covered_by(p, *poly.second)) {
+      return poly.first;
+    }
+  }
+  return id;
+}
+
+}
+}
@@ -1,11 +1,17 @@
 #include "mjolnir/shortcutbuilder.h"
 #include "mjolnir/graphtilebuilder.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <list>
+#include <memory>
 #include <ostream>
 #include <sstream>
 #include <iostream>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
 #include <utility>
@@ -16,6 +22,7 @@
 #include "midgard/pointll.h"
 #include "midgard/logging.h"
 #include "midgard/encoded.h"
+#include "baldr/filesystem_utils.h"
 #include "baldr/tilehierarchy.h"
 #include "baldr/graphid.h"
 #include "baldr/graphconstants.h"
@@ -44,6 +51,15 @@ struct EdgePairs {
   std::pair<GraphId, GraphId> edge2;
 };
 
+// Base edges of the shortcuts formed in a tile. The base edges are found
+// while the tiles are being rewritten so they are kept as their ids in the
+// old tiles, along with the index each old directed edge has in the new tile
+// so that they can be moved over once all of the tiles are done.
+struct TileShortcuts {
+  std::vector<std::pair<uint32_t, std::vector<GraphId> > > base_edges;
+  std::vector<uint32_t> edge_map;
+};
+
 /**
  * Sample elevation along the shape to get weighted grade and max grades
  */
@@ -382,6 +398,7 @@ uint32_t AddShortcutEdges(GraphReader& reader, const GraphTile* tile,
               GraphTileBuilder& tilebuilder, const GraphId& start_node,
               const uint32_t edge_index, const uint32_t edge_count,
               std::unordered_map<uint32_t, uint32_t>& shortcuts,
+              TileShortcuts& tile_shortcuts,
               const std::unique_ptr<const valhalla::skadi::sample>& sample) {
   // Shortcut edges have to start at a node that is not contracted - return if
   // this node can be contracted.
@@ -443,6 +460,7 @@ uint32_t AddShortcutEdges(GraphReader& reader, const GraphTile* tile,
       uint32_t rst = 0;
       uint32_t opp_local_idx = 0;
       GraphId next_edge_id = edge_id;
+      std::vector<GraphId> base_edges{edge_id};
       while (true) {
         EdgePairs edgepairs;
         const GraphTile* tile = reader.GetGraphTile(end_node);
@@ -472,6 +490,7 @@ uint32_t AddShortcutEdges(GraphReader& reader, const GraphTile* tile,
         // off of shortcuts work properly
         length += ConnectEdges(reader, end_node, next_edge_id, shape, end_node,
                                opp_local_idx, rst, average_density);
+        base_edges.push_back(next_edge_id);
       }
 
       // Add the edge info. Use length and number of shape points to match an
@@ -535,6 +554,10 @@ uint32_t AddShortcutEdges(GraphReader& reader, const GraphTile* tile,
       // Make sure shortcut edge is not marked as internal edge
       newedge.set_internal(false);
 
+      // Keep the base edges the shortcut was formed from
+      tile_shortcuts.base_edges.emplace_back(tilebuilder.directededges().size(),
+                                             std::move(base_edges));
+
       // Add new directed edge to tile builder
       tilebuilder.directededges().emplace_back(std::move(newedge));
       shortcut_count++;
@@ -544,143 +567,263 @@ uint32_t AddShortcutEdges(GraphReader& reader, const GraphTile* tile,
   return shortcut_count;
 }
 
-// Form shortcuts for tiles in this level.
-uint32_t FormShortcuts(GraphReader& reader,
-            const TileLevel& level,
+// Form shortcuts for a tile, storing the new tile in the staging directory.
+uint32_t FormTileShortcuts(GraphReader& reader, const GraphId& tile_id,
+            const std::string& staging_dir, TileShortcuts& tile_shortcuts,
             const std::unique_ptr<const valhalla::skadi::sample>& sample) {
-  // Iterate through the tiles at this level (TODO - can we mark the tiles
-  // the tiles that shortcuts end within?)
-  reader.Clear();
+  // Get the graph tile. Skip if no nodes exist in the tile
+  const GraphTile* tile = reader.GetGraphTile(tile_id);
+  if (tile == nullptr || tile->header()->nodecount() == 0) {
+    return 0;
+  }
+
   bool added = false;
   uint32_t shortcut_count = 0;
-  uint32_t ntiles = level.tiles.TileCount();
-  uint32_t tile_level = (uint32_t)level.level;
-  const GraphTile* tile = nullptr;
-  for (uint32_t tileid = 0; tileid < ntiles; tileid++) {
-    // Get the graph tile. Skip if no tile exists (common case)
-    tile = reader.GetGraphTile(GraphId(tileid, tile_level, 0));
-    if (tile == nullptr || tile->header()->nodecount() == 0) {
-      continue;
-    }
 
-    // Create GraphTileBuilder for the new tile
-    GraphId new_tile(tileid, tile_level, 0);
-    GraphTileBuilder tilebuilder(reader.tile_dir(), new_tile, false);
-
-    // Iterate through the nodes in the tile
-    GraphId node_id(tileid, tile_level, 0);
-    for (uint32_t n = 0; n < tile->header()->nodecount(); n++, ++node_id) {
-      // Get the node info, copy node index and count from old tile
-      NodeInfo nodeinfo = *(tile->node(node_id));
-      uint32_t old_edge_index = nodeinfo.edge_index();
-      uint32_t old_edge_count = nodeinfo.edge_count();
-
-      // Update node information
-      const auto& admin = tile->admininfo(nodeinfo.admin_index());
-      nodeinfo.set_edge_index(tilebuilder.directededges().size());
-      nodeinfo.set_timezone(nodeinfo.timezone());
-      nodeinfo.set_admin_index(tilebuilder.AddAdmin(admin.country_text(),
-                admin.state_text(), admin.country_iso(), admin.state_iso()));
-
-      // Current edge count
-      size_t edge_count = tilebuilder.directededges().size();
-
-      // Add shortcut edges first.
-      std::unordered_map<uint32_t, uint32_t> shortcuts;
-      shortcut_count += AddShortcutEdges(reader, tile, tilebuilder, node_id,
-                   old_edge_index, old_edge_count, shortcuts, sample);
-
-      // Copy the rest of the directed edges from this node
-      GraphId edgeid(tileid, tile_level, old_edge_index);
-      for (uint32_t i = 0; i < old_edge_count; i++, ++edgeid) {
-        // Copy the directed edge information and update end node,
-        // edge data offset, and opp_index
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        DirectedEdge newedge = *directededge;
-
-        // Transition edges are stored as is (no need for EdgeInfo, signs,
-        // or restrictions).
-        if (!directededge->trans_down() && !directededge->trans_up()) {
-          // Get signs from the base directed edge
-          if (directededge->exitsign()) {
-            std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
-            if (signs.size() == 0) {
-              LOG_ERROR("Base edge should have signs, but none found");
-            }
-            tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
+  // Create GraphTileBuilder for the new tile, in the staging directory so
+  // that the other threads keep reading the tile as it was. Start from the
+  // header of the tile it replaces.
+  GraphTileBuilder tilebuilder(staging_dir, tile_id, false);
+  tilebuilder.header_builder() = *tile->header();
+  tilebuilder.header_builder().set_graphid(tile_id);
+  tile_shortcuts.edge_map.resize(tile->header()->directededgecount());
+
+  // Iterate through the nodes in the tile
+  GraphId node_id = tile_id;
+  for (uint32_t n = 0; n < tile->header()->nodecount(); n++, ++node_id) {
+    // Get the node info, copy node index and count from old tile
+    NodeInfo nodeinfo = *(tile->node(node_id));
+    uint32_t old_edge_index = nodeinfo.edge_index();
+    uint32_t old_edge_count = nodeinfo.edge_count();
+
+    // Update node information
+    const auto& admin = tile->admininfo(nodeinfo.admin_index());
+    nodeinfo.set_edge_index(tilebuilder.directededges().size());
+    nodeinfo.set_timezone(nodeinfo.timezone());
+    nodeinfo.set_admin_index(tilebuilder.AddAdmin(admin.country_text(),
+              admin.state_text(), admin.country_iso(), admin.state_iso()));
+
+    // Current edge count
+    size_t edge_count = tilebuilder.directededges().size();
+
+    // Add shortcut edges first.
+    std::unordered_map<uint32_t, uint32_t> shortcuts;
+    shortcut_count += AddShortcutEdges(reader, tile, tilebuilder, node_id,
+                 old_edge_index, old_edge_count, shortcuts, tile_shortcuts, sample);
+
+    // Copy the rest of the directed edges from this node
+    GraphId edgeid(tile_id.tileid(), tile_id.level(), old_edge_index);
+    for (uint32_t i = 0; i < old_edge_count; i++, ++edgeid) {
+      // Copy the directed edge information and update end node,
+      // edge data offset, and opp_index
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      DirectedEdge newedge = *directededge;
+
+      // Transition edges are stored as is (no need for EdgeInfo, signs,
+      // or restrictions).
+      if (!directededge->trans_down() && !directededge->trans_up()) {
+        // Get signs from the base directed edge
+        if (directededge->exitsign()) {
+          std::vector<SignInfo> signs = tile->GetSigns(edgeid.id());
+          if (signs.size() == 0) {
+            LOG_ERROR("Base edge should have signs, but none found");
           }
+          tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
+        }
 
-          // Get access restrictions from the base directed edge. Add these to
-          // the list of access restrictions in the new tile. Update the
-          // edge index in the restriction to be the current directed edge Id
-          if (directededge->access_restriction()) {
-            auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
-            for (const auto& res : restrictions) {
-              tilebuilder.AddAccessRestriction(
-                  AccessRestriction(tilebuilder.directededges().size(),
-                     res.type(), res.modes(), res.value()));
-            }
+        // Get access restrictions from the base directed edge. Add these to
+        // the list of access restrictions in the new tile. Update the
+        // edge index in the restriction to be the current directed edge Id
+        if (directededge->access_restriction()) {
+          auto restrictions = tile->GetAccessRestrictions(edgeid.id(), kAllAccess);
+          for (const auto& res : restrictions) {
+            tilebuilder.AddAccessRestriction(
+                AccessRestriction(tilebuilder.directededges().size(),
+                   res.type(), res.modes(), res.value()));
           }
+        }
 
-          // Copy lane connectivity
-          if (directededge->laneconnectivity()) {
-            auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
-            if (laneconnectivity.size() == 0) {
-              LOG_ERROR("Base edge should have lane connectivity, but none found");
-            }
-            for (auto& lc : laneconnectivity) {
-              lc.set_to(tilebuilder.directededges().size());
-            }
-            tilebuilder.AddLaneConnectivity(laneconnectivity);
+        // Copy lane connectivity
+        if (directededge->laneconnectivity()) {
+          auto laneconnectivity = tile->GetLaneConnectivity(edgeid.id());
+          if (laneconnectivity.size() == 0) {
+            LOG_ERROR("Base edge should have lane connectivity, but none found");
           }
+          for (auto& lc : laneconnectivity) {
+            lc.set_to(tilebuilder.directededges().size());
+          }
+          tilebuilder.AddLaneConnectivity(laneconnectivity);
+        }
+
+        // Get edge info, shape, and names from the old tile and add
+        // to the new. Use prior edgeinfo offset as the key to make sure
+        // edges that have the same end nodes are differentiated (this
+        // should be a valid key since tile sizes aren't changed)
+        auto edgeinfo = tile->edgeinfo(directededge->edgeinfo_offset());
+        uint32_t edge_info_offset = tilebuilder.AddEdgeInfo(directededge->edgeinfo_offset(),
+                       node_id, directededge->endnode(), edgeinfo.wayid(), edgeinfo.encoded_shape(),
+                       tile->GetNames(directededge->edgeinfo_offset()),
+                       tile->GetTypes(directededge->edgeinfo_offset()), added);
+        newedge.set_edgeinfo_offset(edge_info_offset);
+
+        // Set the superseded mask - this is the shortcut mask that
+        // supersedes this edge (outbound from the node)
+        auto s = shortcuts.find(i);
+        uint32_t supersed_idx = (s != shortcuts.end()) ? s->second : 0;
+        newedge.set_superseded(supersed_idx);
+      }
+
+      // Add directed edge
+      tile_shortcuts.edge_map[edgeid.id()] = tilebuilder.directededges().size();
+      tilebuilder.directededges().emplace_back(std::move(newedge));
 
-          // Get edge info, shape, and names from the old tile and add
-          // to the new. Use prior edgeinfo offset as the key to make sure
-          // edges that have the same end nodes are differentiated (this
-          // should be a valid key since tile sizes aren't changed)
-          auto edgeinfo = tile->edgeinfo(directededge->edgeinfo_offset());
-          uint32_t edge_info_offset = tilebuilder.AddEdgeInfo(directededge->edgeinfo_offset(),
-                         node_id, directededge->endnode(), edgeinfo.wayid(), edgeinfo.encoded_shape(),
-                         tile->GetNames(directededge->edgeinfo_offset()),
-                         tile->GetTypes(directededge->edgeinfo_offset()), added);
-          newedge.set_edgeinfo_offset(edge_info_offset);
-
-          // Set the superseded mask - this is the shortcut mask that
-          // supersedes this edge (outbound from the node)
-          auto s = shortcuts.find(i);
-          uint32_t supersed_idx = (s != shortcuts.end()) ? s->second : 0;
-          newedge.set_superseded(supersed_idx);
+      // Add existing edge elevation (if the tile has elevation information)
+      if (tile->header()->has_edge_elevation()) {
+        const EdgeElevation* elev = tile->edge_elevation(edgeid);
+        if (elev == nullptr) {
+          tilebuilder.edge_elevations().emplace_back(0.0f, 0.0f, 0.0f);
+        } else {
+          tilebuilder.edge_elevations().emplace_back(std::move(*elev));
         }
+      }
+    }
 
-        // Add directed edge
-        tilebuilder.directededges().emplace_back(std::move(newedge));
+    // Set the edge count for the new node
+    nodeinfo.set_edge_count(tilebuilder.directededges().size() - edge_count);
+    tilebuilder.nodes().emplace_back(std::move(nodeinfo));
+  }
+
+  // Store the new tile
+  tilebuilder.StoreTileData();
+  LOG_DEBUG((boost::format("ShortcutBuilder created tile %1%: %2% bytes") %
+       tile_id % tilebuilder.header_builder().end_offset()).str());
 
-        // Add existing edge elevation (if the tile has elevation information)
-        if (tile->header()->has_edge_elevation()) {
-          const EdgeElevation* elev = tile->edge_elevation(edgeid);
-          if (elev == nullptr) {
-            tilebuilder.edge_elevations().emplace_back(0.0f, 0.0f, 0.0f);
-          } else {
-            tilebuilder.edge_elevations().emplace_back(std::move(*elev));
+  return shortcut_count;
+}
+
+// Form shortcuts for the tiles from next on, one at a time, until there are
+// none left
+void FormShortcutTiles(const boost::property_tree::ptree& pt,
+                       const std::vector<GraphId>& tiles, std::atomic<size_t>& next,
+                       const std::string& staging_dir,
+                       std::vector<TileShortcuts>& tile_shortcuts,
+                       const std::unique_ptr<const valhalla::skadi::sample>& sample,
+                       std::promise<uint32_t>& result) {
+  try {
+    GraphReader reader(pt);
+    uint32_t shortcut_count = 0;
+    for (size_t i = next++; i < tiles.size(); i = next++) {
+      shortcut_count += FormTileShortcuts(reader, tiles[i], staging_dir, tile_shortcuts[i],
+                                          sample);
+
+      // Check if we need to clear the tile cache.
+      if (reader.OverCommitted()) {
+        reader.Clear();
+      }
+    }
+    result.set_value(shortcut_count);
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
+
+// Store the base edges of the shortcuts for the tiles from next on, moved
+// over to the edge ids of the new tiles
+void StoreShortcutEdges(const std::vector<GraphId>& tiles, std::atomic<size_t>& next,
+                        const std::string& staging_dir,
+                        const std::vector<TileShortcuts>& tile_shortcuts,
+                        std::promise<uint32_t>& result) {
+  try {
+    for (size_t i = next++; i < tiles.size(); i = next++) {
+      if (tile_shortcuts[i].base_edges.empty()) {
+        continue;
+      }
+      GraphTileBuilder tilebuilder(staging_dir, tiles[i], true);
+      for (const auto& shortcut : tile_shortcuts[i].base_edges) {
+        std::vector<GraphId> base_edges;
+        base_edges.reserve(shortcut.second.size());
+        for (const auto& edge_id : shortcut.second) {
+          // Base edges are on the same level, in this tile or a neighbour
+          auto tile = std::lower_bound(tiles.begin(), tiles.end(), edge_id.Tile_Base());
+          if (tile == tiles.end() || *tile != edge_id.Tile_Base()) {
+            LOG_ERROR("Base edge of a shortcut is not in a tile of the level");
+            break;
           }
+          const auto& edge_map = tile_shortcuts[tile - tiles.begin()].edge_map;
+          base_edges.emplace_back(edge_id.tileid(), edge_id.level(), edge_map[edge_id.id()]);
+        }
+        if (base_edges.size() == shortcut.second.size()) {
+          tilebuilder.AddShortcutBaseEdges(shortcut.first, base_edges);
         }
       }
-
-      // Set the edge count for the new node
-      nodeinfo.set_edge_count(tilebuilder.directededges().size() - edge_count);
-      tilebuilder.nodes().emplace_back(std::move(nodeinfo));
+      tilebuilder.StoreTileData();
     }
+    result.set_value(0);
+  } catch (...) {
+    result.set_exception(std::current_exception());
+  }
+}
 
-    // Store the new tile
-    tilebuilder.StoreTileData();
-    LOG_DEBUG((boost::format("ShortcutBuilder created tile %1%: %2% bytes") %
-         tile % tilebuilder.header_builder().end_offset()).str());
+// Form shortcuts for tiles in this level. Shortcuts follow edges into the
+// neighbouring tiles, so the threads store the new tiles in a staging
+// directory and they only replace the tiles of the level when all are done.
+uint32_t FormShortcuts(const boost::property_tree::ptree& pt,
+            const TileLevel& level,
+            const std::vector<std::unique_ptr<const valhalla::skadi::sample> >& samples,
+            const unsigned int thread_count) {
+  GraphReader reader(pt);
+  auto level_tiles = reader.GetTileSet(level.level);
+  std::vector<GraphId> tiles(level_tiles.begin(), level_tiles.end());
+  std::sort(tiles.begin(), tiles.end());
+  std::string staging_dir = reader.tile_dir() + filesystem::path_separator + "shortcuts";
+
+  std::atomic<size_t> next(0);
+  std::vector<TileShortcuts> tile_shortcuts(tiles.size());
+  std::vector<std::shared_ptr<std::thread> > threads(thread_count);
+  std::list<std::promise<uint32_t> > results;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    results.emplace_back();
+    threads[i].reset(new std::thread(FormShortcutTiles, std::cref(pt), std::cref(tiles),
+                                     std::ref(next), std::cref(staging_dir),
+                                     std::ref(tile_shortcuts), std::cref(samples[i]),
+                                     std::ref(results.back())));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  // If something bad went down this will rethrow it
+  uint32_t shortcut_count = 0;
+  for (auto& result : results) {
+    shortcut_count += result.get_future().get();
+  }
 
-    // Check if we need to clear the tile cache.
-    if (reader.OverCommitted()) {
-      reader.Clear();
+  // Now that every tile of the level has its new edge ids, keep the base
+  // edges of the shortcuts in the new tiles so that paths can recover them
+  next = 0;
+  results.clear();
+  for (size_t i = 0; i < threads.size(); ++i) {
+    results.emplace_back();
+    threads[i].reset(new std::thread(StoreShortcutEdges, std::cref(tiles), std::ref(next),
+                                     std::cref(staging_dir), std::cref(tile_shortcuts),
+                                     std::ref(results.back())));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  for (auto& result : results) {
+    result.get_future().get();
+  }
+
+  // Move the new tiles into place
+  for (const auto& tile_id : tiles) {
+    auto suffix = GraphTile::FileSuffix(tile_id);
+    boost::filesystem::path staged(staging_dir + filesystem::path_separator + suffix);
+    if (boost::filesystem::exists(staged)) {
+      boost::filesystem::rename(staged, reader.tile_dir() + filesystem::path_separator + suffix);
     }
   }
+  boost::filesystem::remove_all(staging_dir);
   return shortcut_count;
 }
 
@@ -693,19 +836,20 @@ namespace mjolnir {
 // only connect to 2 edges on the hierarchy level, and have compatible
 // attributes. Shortcut edges are inserted before regular edges.
 void ShortcutBuilder::Build(const boost::property_tree::ptree& pt) {
+  // Shortcuts are formed a tile at a time on each thread
+  unsigned int thread_count = std::max(static_cast<unsigned int>(1),
+      pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
 
-  //TODO: thread this. would need to make sure we dont make shortcuts
-  //across tile boundaries so that we are only messing with one tile
-  //in one thread at a time
-
-  // Get GraphReader
-  GraphReader reader(pt.get_child("mjolnir"));
-
-  // Crack open some elevation data if its there
+  // Crack open some elevation data if its there. Each thread samples with a
+  // cache of its own so the threads don't push each other's tiles out of it
   boost::optional<std::string> elevation = pt.get_optional<std::string>("additional_data.elevation");
-  std::unique_ptr<const skadi::sample> sample;
+  std::vector<std::unique_ptr<const skadi::sample> > samples(thread_count);
   if (elevation && boost::filesystem::exists(*elevation)) {
-    sample.reset(new skadi::sample(*elevation));
+    auto cache_size = pt.get<size_t>("additional_data.elevation_cache_size",
+                                     skadi::sample::kDefaultCacheSize);
+    skadi::sample sample(*elevation, cache_size);
+    for (auto& thread_sample : samples)
+      thread_sample.reset(new skadi::sample(sample, cache_size));
   }
 
   auto level = TileHierarchy::levels().rbegin();
@@ -714,7 +858,7 @@ void ShortcutBuilder::Build(const boost::property_tree::ptree& pt) {
     // Create shortcuts on this level
     auto tile_level = level->second;
     LOG_INFO("Creating shortcuts on level " + std::to_string(tile_level.level));
-    uint32_t count = FormShortcuts(reader, tile_level, sample);
+    uint32_t count = FormShortcuts(pt.get_child("mjolnir"), tile_level, samples, thread_count);
     LOG_INFO("Finished with " + std::to_string(count) + " shortcuts");
   }
 }
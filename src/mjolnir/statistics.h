@@ -234,6 +234,13 @@ public:
 
   void build_db(const boost::property_tree::ptree& pt);
 
+  /**
+   * Write the same tables as the database as one csv file each, written
+   * in parallel and without the database overhead.
+   * @param  directory  Directory the files are written to, created if missing
+   */
+  void build_csv(const std::string& directory) const;
+
 private:
   void create_tile_tables(sqlite3 *db_handle, sqlite3_stmt *stmt);
 
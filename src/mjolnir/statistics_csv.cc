@@ -0,0 +1,148 @@
+#include <cstdint>
+#include "statistics.h"
+
+#include "midgard/logging.h"
+
+#include <fstream>
+#include <future>
+#include <boost/filesystem/operations.hpp>
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+// Value of a road class for a tile or country, 0 if none was seen
+template <typename key_t, typename value_t, typename hasher_t>
+value_t get(const std::unordered_map<key_t, std::unordered_map<RoadClass, value_t, hasher_t> >& values,
+            const key_t& key, const RoadClass rclass) {
+  auto found = values.find(key);
+  if (found == values.cend())
+    return 0;
+  auto value = found->second.find(rclass);
+  return value == found->second.cend() ? 0 : value->second;
+}
+
+// Opens a table's file and writes its header
+std::ofstream open(const std::string& directory, const std::string& table, const std::string& header) {
+  auto file_name = directory + "/" + table + ".csv";
+  std::ofstream file(file_name);
+  if (!file.is_open())
+    throw std::runtime_error("Could not open " + file_name + " for writing");
+  file << header << '\n';
+  return file;
+}
+
+// Writes the sign share rows of the tiles or countries
+template <typename key_t>
+void write_signs(const std::string& directory, const std::string& table, const std::string& key_name,
+                 const std::unordered_map<key_t, size_t>& signs,
+                 const std::unordered_map<key_t, size_t>& counts) {
+  auto file = open(directory, table, key_name + ",exitsign");
+  for (const auto& sign : signs)
+    file << sign.first << ',' << static_cast<float>(sign.second) / counts.at(sign.first) << '\n';
+}
+
+}
+
+namespace valhalla {
+namespace mjolnir {
+
+void statistics::build_csv(const std::string& directory) const {
+  boost::filesystem::create_directories(directory);
+  LOG_INFO("Writing statistics tables to " + directory);
+
+  // Road class columns, in the order they are written
+  std::string rclass_columns;
+  for (auto rclass : rclasses)
+    rclass_columns += "," + roadClassToString.at(rclass);
+
+  // The tables don't depend on each other so each is written on its own thread
+  std::vector<std::future<void> > tables;
+  tables.emplace_back(std::async(std::launch::async, [&]() {
+    auto file = open(directory, "tiledata", "tileid,tilearea,totalroadlen" + rclass_columns +
+                     ",minx,miny,maxx,maxy");
+    for (auto tileid : tile_ids) {
+      float total = 0;
+      for (auto rclass : rclasses)
+        total += get(tile_lengths, tileid, rclass);
+      auto area = tile_areas.find(tileid);
+      file << tileid << ',' << (area == tile_areas.cend() ? 0.f : area->second) << ',' << total;
+      for (auto rclass : rclasses)
+        file << ',' << get(tile_lengths, tileid, rclass);
+      auto geometry = tile_geometries.find(tileid);
+      if (geometry != tile_geometries.cend())
+        file << ',' << geometry->second.minx() << ',' << geometry->second.miny() << ','
+             << geometry->second.maxx() << ',' << geometry->second.maxy();
+      else
+        file << ",,,,";
+      file << '\n';
+    }
+  }));
+  tables.emplace_back(std::async(std::launch::async, [&]() {
+    auto file = open(directory, "rclasstiledata", "tileid,type,oneway,maxspeed,internaledges,named");
+    for (auto tileid : tile_ids) {
+      for (auto rclass : rclasses)
+        file << tileid << ',' << roadClassToString.at(rclass) << ','
+             << get(tile_one_way, tileid, rclass) << ',' << get(tile_speed_info, tileid, rclass) << ','
+             << get(tile_int_edges, tileid, rclass) << ',' << get(tile_named, tileid, rclass) << '\n';
+    }
+  }));
+  tables.emplace_back(std::async(std::launch::async, [&]() {
+    auto file = open(directory, "truckrclasstiledata",
+                     "tileid,type,hazmat,truck_route,height,width,length,weight,axle_load");
+    for (auto tileid : tile_ids) {
+      for (auto rclass : rclasses)
+        file << tileid << ',' << roadClassToString.at(rclass) << ','
+             << get(tile_hazmat, tileid, rclass) << ',' << get(tile_truck_route, tileid, rclass) << ','
+             << get(tile_height, tileid, rclass) << ',' << get(tile_width, tileid, rclass) << ','
+             << get(tile_length, tileid, rclass) << ',' << get(tile_weight, tileid, rclass) << ','
+             << get(tile_axle_load, tileid, rclass) << '\n';
+    }
+  }));
+  tables.emplace_back(std::async(std::launch::async, [&]() {
+    auto file = open(directory, "countrydata", "isocode" + rclass_columns);
+    for (const auto& country : iso_codes) {
+      file << country;
+      for (auto rclass : rclasses)
+        file << ',' << get(country_lengths, country, rclass);
+      file << '\n';
+    }
+  }));
+  tables.emplace_back(std::async(std::launch::async, [&]() {
+    auto file = open(directory, "rclassctrydata", "isocode,type,oneway,maxspeed,internaledges,named");
+    for (const auto& country : iso_codes) {
+      for (auto rclass : rclasses)
+        file << country << ',' << roadClassToString.at(rclass) << ','
+             << get(country_one_way, country, rclass) << ',' << get(country_speed_info, country, rclass) << ','
+             << get(country_int_edges, country, rclass) << ',' << get(country_named, country, rclass) << '\n';
+    }
+  }));
+  tables.emplace_back(std::async(std::launch::async, [&]() {
+    auto file = open(directory, "truckrclassctrydata",
+                     "isocode,type,hazmat,truck_route,height,width,length,weight,axle_load");
+    for (const auto& country : iso_codes) {
+      for (auto rclass : rclasses)
+        file << country << ',' << roadClassToString.at(rclass) << ','
+             << get(country_hazmat, country, rclass) << ',' << get(country_truck_route, country, rclass) << ','
+             << get(country_height, country, rclass) << ',' << get(country_width, country, rclass) << ','
+             << get(country_length, country, rclass) << ',' << get(country_weight, country, rclass) << ','
+             << get(country_axle_load, country, rclass) << '\n';
+    }
+  }));
+  tables.emplace_back(std::async(std::launch::async, [&]() {
+    write_signs(directory, "tile_exitinfo", "tileid", tile_exit_signs, tile_exit_count);
+    write_signs(directory, "tile_forkinfo", "tileid", tile_fork_signs, tile_fork_count);
+    write_signs(directory, "ctry_exitinfo", "isocode", ctry_exit_signs, ctry_exit_count);
+    write_signs(directory, "ctry_forkinfo", "isocode", ctry_fork_signs, ctry_fork_count);
+  }));
+
+  // Rethrows the first failure, if any
+  for (auto& table : tables)
+    table.get();
+  LOG_INFO("Statistics tables saved to " + directory);
+}
+
+}
+}
@@ -74,6 +74,17 @@ void statistics::build_db(const boost::property_tree::ptree& pt) {
   create_exit_tables(db_handle, stmt);
   LOG_INFO("Created exit tables");
 
+  // The database is built from scratch so there is nothing to recover if
+  // writing it fails, every row goes in through one transaction
+  sql = "PRAGMA synchronous = OFF; PRAGMA journal_mode = MEMORY; BEGIN";
+  ret = sqlite3_exec(db_handle, sql.c_str(), NULL, NULL, &err_msg);
+  if (ret != SQLITE_OK) {
+    LOG_ERROR("Error: " + std::string(err_msg));
+    sqlite3_free(err_msg);
+    sqlite3_close(db_handle);
+    return;
+  }
+
   insert_tile_data(db_handle, stmt);
   LOG_INFO("Tile info inserted");
 
@@ -83,6 +94,14 @@ void statistics::build_db(const boost::property_tree::ptree& pt) {
   insert_exit_data(db_handle, stmt);
   LOG_INFO("Exit info inserted");
 
+  ret = sqlite3_exec(db_handle, "COMMIT", NULL, NULL, &err_msg);
+  if (ret != SQLITE_OK) {
+    LOG_ERROR("Error: " + std::string(err_msg));
+    sqlite3_free(err_msg);
+    sqlite3_close(db_handle);
+    return;
+  }
+
   // Create Index on geometry column
   sql = "SELECT CreateSpatialIndex('tiledata', 'geom')";
   ret = sqlite3_exec (db_handle, sql.c_str(), NULL, NULL, &err_msg);
@@ -301,21 +320,11 @@ void statistics::create_exit_tables(sqlite3* db_handle, sqlite3_stmt* stmt) {
 }
 
 void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
-
   uint32_t ret;
-  char *err_msg = NULL;
   std::string sql;
 
-  // Begin the prepared statements for tiledata
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
   sql = "INSERT INTO tiledata (tileid, tilearea, totalroadlen, motorway, pmary, secondary, tertiary, trunk, residential, unclassified, serviceother, geom) ";
-  sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, GeomFromText(?, 4326))";
+  sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, BuildMbr(?, ?, ?, ?, 4326))";
   ret = sqlite3_prepare_v2(db_handle, sql.c_str(), strlen (sql.c_str()), &stmt, NULL);
   if (ret != SQLITE_OK) {
     LOG_ERROR("SQL error: " + sql);
@@ -344,23 +353,16 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     ++index;
     // Individual Road Class Lengths
     for (auto rclass : rclasses) {
-      std::string roadStr = roadClassToString.at(rclass);
       sqlite3_bind_double(stmt, index, tile_lengths[tileid][rclass]);
       ++index;
     }
     // Use tile bounding box corners to make a polygon
-    if (tile_geometries.find(tileid) != tile_geometries.end()) {
-      auto maxx = std::to_string(tile_geometries.at(tileid).maxx());
-      auto minx = std::to_string(tile_geometries.at(tileid).minx());
-      auto maxy = std::to_string(tile_geometries.at(tileid).maxy());
-      auto miny = std::to_string(tile_geometries.at(tileid).miny());
-      std::string polyWKT = "POLYGON (("
-          + minx + " " + miny + ", "
-          + minx + " " + maxy + ", "
-          + maxx + " " + maxy + ", "
-          + maxx + " " + miny + ", "
-          + minx + " " + miny + "))";
-      sqlite3_bind_text (stmt, index, polyWKT.c_str(), polyWKT.length(), SQLITE_STATIC);
+    auto geometry = tile_geometries.find(tileid);
+    if (geometry != tile_geometries.end()) {
+      sqlite3_bind_double(stmt, index++, geometry->second.minx());
+      sqlite3_bind_double(stmt, index++, geometry->second.miny());
+      sqlite3_bind_double(stmt, index++, geometry->second.maxx());
+      sqlite3_bind_double(stmt, index, geometry->second.maxy());
     } else {
       LOG_ERROR("Geometry for tile " + std::to_string(tileid) + " not found.");
     }
@@ -371,22 +373,6 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-
-  // Begin adding the statistics for each road type of tile data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO rclasstiledata (tileid, type, oneway, maxspeed, internaledges, named) ";
   sql += "VALUES (?, ?, ?, ?, ?, ?)";
@@ -408,7 +394,7 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
       sqlite3_bind_int(stmt, index, tileid);
       ++index;
       // Roadway type
-      auto type = roadClassToString.at(rclass);
+      const auto& type = roadClassToString.at(rclass);
       sqlite3_bind_text(stmt, index, type.c_str(), type.length(), SQLITE_STATIC);
       ++index;
       // One Way data
@@ -430,22 +416,6 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-
-  // Begin adding the truck statistics for each road type of tile data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO truckrclasstiledata (tileid, type, hazmat, truck_route, height, width, length, weight, axle_load) ";
   sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
@@ -467,7 +437,7 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
       sqlite3_bind_int(stmt, index, tileid);
       ++index;
       // Roadway type
-      auto type = roadClassToString.at(rclass);
+      const auto& type = roadClassToString.at(rclass);
       sqlite3_bind_text(stmt, index, type.c_str(), type.length(), SQLITE_STATIC);
       ++index;
       // Hazmat
@@ -498,29 +468,12 @@ void statistics::insert_tile_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-
 }
 
 void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   uint32_t ret;
-  char *err_msg = NULL;
   std::string sql;
 
-  // Begin the prepared statements for country data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
   sql = "INSERT INTO countrydata (isocode, motorway, pmary, secondary, tertiary, trunk, residential, unclassified, serviceother)";
   sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
   ret = sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, NULL);
@@ -541,7 +494,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     ++index;
     // Individual Road Class Lengths
     for (auto rclass : rclasses) {
-      std::string roadStr = roadClassToString.at(rclass);
       sqlite3_bind_double(stmt, index, country_lengths[country][rclass]);
       ++index;
     }
@@ -552,22 +504,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-
-  // Begin adding the statistics for each road type of country data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO rclassctrydata (isocode, type, oneway, maxspeed, internaledges, named) ";
   sql += "VALUES (?, ?, ?, ?, ?, ?)";
@@ -589,7 +525,7 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
       sqlite3_bind_text(stmt, index, country.c_str(), country.length(), SQLITE_STATIC);
       ++index;
       // Roadway type
-      auto type = roadClassToString.at(rclass);
+      const auto& type = roadClassToString.at(rclass);
       sqlite3_bind_text(stmt, index, type.c_str(), type.length(), SQLITE_STATIC);
       ++index;
       // One Way data
@@ -611,22 +547,6 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-
-  // Begin adding the truck statistics for each road type of country data
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO truckrclassctrydata (isocode, type, hazmat, truck_route, height, width, length, weight, axle_load) ";
   sql += "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
@@ -648,7 +568,7 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
       sqlite3_bind_text(stmt, index, country.c_str(), country.length(), SQLITE_STATIC);
       ++index;
       // Roadway type
-      auto type = roadClassToString.at(rclass);
+      const auto& type = roadClassToString.at(rclass);
       sqlite3_bind_text(stmt, index, type.c_str(), type.length(), SQLITE_STATIC);
       ++index;
       // Hazmat
@@ -679,29 +599,12 @@ void statistics::insert_country_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     }
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
 }
 
 void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
   uint32_t ret;
-  char *err_msg = NULL;
   std::string sql;
 
-  // Begin adding the statistics for exits in tiles
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
-
   sql = "INSERT INTO tile_exitinfo (tileid, exitsign) ";
   sql += "VALUES (?, ?)";
   ret = sqlite3_prepare_v2(db_handle, sql.c_str(), sql.length(), &stmt, NULL);
@@ -730,22 +633,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-
-  // Begin adding the statistics for forks in tiles
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO tile_forkinfo (tileid, exitsign) ";
   sql += "VALUES (?, ?)";
@@ -775,22 +662,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-
-  // Begin adding the exit statistics for countries
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO ctry_exitinfo (isocode, exitsign) ";
   sql += "VALUES (?, ?)";
@@ -820,21 +691,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
-  // Begin adding the fork statistics for countries
-  ret = sqlite3_exec(db_handle, "BEGIN", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free(err_msg);
-    sqlite3_close(db_handle);
-    return;
-  }
 
   sql = "INSERT INTO ctry_forkinfo (isocode, exitsign) ";
   sql += "VALUES (?, ?)";
@@ -864,13 +720,6 @@ void statistics::insert_exit_data(sqlite3* db_handle, sqlite3_stmt* stmt) {
     LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
   }
   sqlite3_finalize (stmt);
-  ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
-  if (ret != SQLITE_OK) {
-    LOG_ERROR("Error: " + std::string(err_msg));
-    sqlite3_free (err_msg);
-    sqlite3_close (db_handle);
-    return;
-  }
 }
 
 }
@@ -2,61 +2,101 @@
 
 #include "midgard/logging.h"
 
+#include <functional>
+
 namespace valhalla {
 namespace mjolnir {
 
+namespace {
+
+// Slots the table starts with, it doubles whenever it gets half full
+constexpr size_t kInitialSlotCount = 1024;
+
+}
+
 // Constructor
-UniqueNames::UniqueNames() {
-  // Insert dummy so index 0 is never used
-  index("");
+UniqueNames::UniqueNames()
+    : names_(1), slots_(kInitialSlotCount, 0) {
+  // The blank name is added first so index 0 is never used
 }
 
 // Get an index given a name. Add the name if it is not in the current list
 // of unique names
 uint32_t UniqueNames::index(const std::string& name) {
-  // Find the name in the map. If it is there return the index.
-  uint32_t index = 0;
-  auto it = names_.find(name);
-  if (it != names_.end()) {
-     index = it->second;
+  if (name.empty()) {
+    return 0;
+  }
+
+  // Find the name in the table. If it is there return the index.
+  size_t slot = Slot(name);
+  if (slots_[slot] != 0) {
+    return slots_[slot];
   }
-  else {
-     // Not in the map, add index and update
-     it = names_.insert(it, NamesMap::value_type(name, 0));
-     indexes_.push_back(it);
-     index = indexes_.size() - 1;
-     it->second = index;
+
+  // Not in the table, add it. Keep the table at most half full so probing
+  // for a name stays short
+  uint32_t index = names_.size();
+  names_.push_back(name);
+  slots_[slot] = index;
+  if (names_.size() * 2 > slots_.size()) {
+    Rehash(slots_.size() * 2);
   }
   return index;
 }
 
 // Get the name given the index
 const std::string& UniqueNames::name(const uint32_t index) const {
-  if (index < (uint32_t)indexes_.size())
-    return indexes_[index]->first;
+  if (index < (uint32_t)names_.size())
+    return names_[index];
 
   // Return the empty string in the index 0 location
-  return indexes_[0]->first;
+  return names_[0];
 }
 
-// Clear the unique names list
+// Clear the unique names list, leaving only the blank name
 void UniqueNames::Clear() {
   names_.clear();
-  indexes_.clear();
+  names_.shrink_to_fit();
+  names_.emplace_back();
+  slots_.assign(kInitialSlotCount, 0);
+  slots_.shrink_to_fit();
 }
 
 // Get the number of unique names. Since a blank name is added as the first
-// unique name we return the size of the map - 1.
+// unique name we return the size of the list - 1.
 size_t UniqueNames::Size() const {
   return names_.size() - 1;
 }
 
+// Get the slot of a name, probing linearly from where its hash puts it
+size_t UniqueNames::Slot(const std::string& name) const {
+  size_t mask = slots_.size() - 1;
+  size_t slot = std::hash<std::string>()(name) & mask;
+  while (slots_[slot] != 0 && names_[slots_[slot]] != name) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+// Resize the table and put the indexes of all the names back into it
+void UniqueNames::Rehash(const size_t slot_count) {
+  slots_.assign(slot_count, 0);
+  size_t mask = slot_count - 1;
+  for (uint32_t index = 1; index < names_.size(); index++) {
+    size_t slot = std::hash<std::string>()(names_[index]) & mask;
+    while (slots_[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = index;
+  }
+}
+
 /**
  * Log information about the number of unique names, size of the vector, etc.
  */
 void UniqueNames::Log() const {
   LOG_DEBUG("Number of names: " + std::to_string(Size()));
-  LOG_DEBUG("Number of indexes: " + std::to_string(indexes_.size()));
+  LOG_DEBUG("Number of slots: " + std::to_string(slots_.size()));
 }
 
 }
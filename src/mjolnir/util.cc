@@ -1,5 +1,6 @@
 #include "mjolnir/util.h"
 
+#include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/osmpbfparser.h"
@@ -7,6 +8,7 @@
 #include "mjolnir/transitbuilder.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/hierarchylimitsbuilder.h"
 #include "mjolnir/shortcutbuilder.h"
 #include "mjolnir/restrictionbuilder.h"
 #include "midgard/point2.h"
@@ -15,6 +17,7 @@
 #include "midgard/logging.h"
 #include "baldr/filesystem_utils.h"
 #include "baldr/tilehierarchy.h"
+#include "baldr/tilecompression.h"
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -118,6 +121,45 @@ void build_tile_set(const boost::property_tree::ptree& config, const std::vector
   // full graph is formed.
   GraphValidator::Validate(config);
 
+  // Learn how far each hierarchy level should be expanded around every tile
+  // now that their densities are known
+  if (build_hierarchy) {
+    HierarchyLimitsBuilder::Build(config);
+  }
+
+  // Optionally keep the shapes of the finished tiles as fixed point integers
+  // too so they can be read without decoding them
+  if (config.get<bool>("mjolnir.fixed_point_shapes", false)) {
+    LOG_INFO("Adding fixed point shapes to the tiles");
+    for (boost::filesystem::recursive_directory_iterator i(tile_dir), end; i != end; ++i) {
+      if (!boost::filesystem::is_regular(i->path()) || i->path().extension() != ".gph")
+        continue;
+      baldr::GraphTile tile(tile_dir, baldr::GraphTile::GetTileId(i->path().string()));
+      if (tile.header())
+        GraphTileBuilder::AddFixedShapes(tile_dir, &tile);
+    }
+  }
+
+  // Optionally compress the finished tiles, they are read directly from the
+  // compressed form so the uncompressed ones are removed
+  auto compression = config.get<std::string>("mjolnir.tile_compression", "none");
+  if (compression == "lz4") {
+    LOG_INFO("Compressing tiles with lz4");
+    size_t uncompressed = 0, compressed = 0;
+    for (boost::filesystem::recursive_directory_iterator i(tile_dir), end; i != end; ++i) {
+      if (!boost::filesystem::is_regular(i->path()) || i->path().extension() != ".gph")
+        continue;
+      uncompressed += boost::filesystem::file_size(i->path());
+      auto size = baldr::lz4_compress_tile_file(i->path().string());
+      if (size == 0)
+        throw std::runtime_error("Failed to compress tile " + i->path().string());
+      compressed += size;
+    }
+    LOG_INFO("Compressed " + std::to_string(uncompressed) + " bytes of tiles to " + std::to_string(compressed));
+  }
+  else if (compression != "none") {
+    throw std::runtime_error("Unsupported tile compression: " + compression);
+  }
 }
 
 }
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "baldr/graphtile.h"
+#include "baldr/tile_updates.h"
+#include "midgard/logging.h"
+
+namespace bpo = boost::program_options;
+
+using namespace valhalla::baldr;
+
+boost::filesystem::path config_file_path;
+std::string delta_dir;
+
+bool ParseArguments(int argc, char *argv[]) {
+
+  bpo::options_description options(
+    "valhalla_apply_tile_delta " VERSION "\n"
+    "\n"
+    " Usage: valhalla_apply_tile_delta [options] <delta_dir>\n"
+    "\n"
+    "valhalla_apply_tile_delta is a program that installs newer tiles into the "
+    "tile_dir of a running service. The delta directory is laid out like the "
+    "tile_dir and holds the tiles of a newer build, typically only the ones "
+    "valhalla_dirty_tiles listed. Tiles that are the same as the ones already "
+    "there are skipped, which with reproducible builds is every tile that did "
+    "not change. Each tile is renamed into place so readers only ever see whole "
+    "tiles, and then the changed tiles are recorded so the services evict only "
+    "those from their caches without restarting. The installed tiles are listed "
+    "one per line as the paths to them in the tile_dir."
+    "\n"
+    "\n");
+
+  options.add_options()
+      ("help,h", "Print this help message.")
+      ("version,v", "Print the version of this software.")
+      ("config,c",
+        boost::program_options::value<boost::filesystem::path>(&config_file_path)->required(),
+        "Path to the json configuration file.")
+      // positional arguments
+      ("delta_dir", boost::program_options::value<std::string>(&delta_dir));
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("delta_dir", 1);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what()
+      << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT
+      << "\n";
+    return false;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return true;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_apply_tile_delta " << VERSION << "\n";
+    return true;
+  }
+
+  if (!vm.count("delta_dir") || !boost::filesystem::is_directory(delta_dir)) {
+    std::cerr << "Delta directory is required\n\n" << options << "\n\n";
+    return false;
+  }
+
+  if (vm.count("config")) {
+    if (boost::filesystem::is_regular_file(config_file_path))
+      return true;
+    else
+      std::cerr << "Configuration file is required\n\n" << options << "\n\n";
+  }
+
+  return false;
+}
+
+int main(int argc, char** argv) {
+  // Parse command line arguments
+  if (!ParseArguments(argc, argv) || delta_dir.empty())
+    return EXIT_FAILURE;
+
+  // Read the config, logging goes to stderr since the tiles go to stdout
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(config_file_path.c_str(), pt);
+  valhalla::midgard::logging::Configure({{"type", "std_err"}, {"color", "true"}});
+
+  // Install whatever changed
+  auto tile_dir = pt.get<std::string>("mjolnir.tile_dir");
+  auto installed = TileUpdates::Apply(tile_dir, delta_dir);
+  for (const auto& tile : installed)
+    std::cout << GraphTile::FileSuffix(tile) << std::endl;
+  LOG_INFO(std::to_string(installed.size()) + " tiles installed");
+
+  return EXIT_SUCCESS;
+}
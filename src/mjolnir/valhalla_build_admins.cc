@@ -1,12 +1,16 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <thread>
+#include <memory>
+#include <algorithm>
 
 #include "mjolnir/pbfadminparser.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/hierarchybuilder.h"
 #include "mjolnir/adminconstants.h"
+#include "mjolnir/admin.h"
 #include "baldr/graphconstants.h"
 
 #include "config.h"
@@ -242,6 +246,79 @@ std::vector<std::string> GetWkts(std::unique_ptr<Geometry>& mline) {
   return wkts;
 }
 
+/**
+ * Assemble the multipolygons of every thread_count-th admin, starting at
+ * the given one, from the ways of its relation.
+ */
+void AssembleAdmins(const OSMData& osmdata, const size_t first,
+                    const size_t thread_count,
+                    std::vector<std::vector<std::string> >& admin_wkts) {
+  // Geometry factories are not shared across threads
+#if 3 == GEOS_VERSION_MAJOR && 6 <= GEOS_VERSION_MINOR
+  GeometryFactory::unique_ptr gf = GeometryFactory::create();
+#else
+  std::unique_ptr<GeometryFactory> gf(new GeometryFactory());
+#endif
+
+  for (size_t i = first; i < osmdata.admins_.size(); i += thread_count) {
+    const auto& admin = osmdata.admins_[i];
+    try {
+
+      std::unique_ptr<Geometry> geom;
+      std::unique_ptr<std::vector<Geometry*> > lines(new std::vector<Geometry*>);
+      bool has_data = true;
+
+      for (const auto memberid : admin.ways()) {
+
+        auto itr = osmdata.way_map.find(memberid);
+
+        // A relation may be included in an extract but it's members may not.
+        // Example:  PA extract can contain a NY relation.
+        if (itr == osmdata.way_map.end()) {
+          has_data = false;
+          break;
+        }
+
+        std::unique_ptr<CoordinateSequence> coords(gf->getCoordinateSequenceFactory()->create((size_t)0, (size_t)2));
+
+        for (const auto ref_id :itr->second) {
+
+          const PointLL ll = osmdata.shape_map.at(ref_id);
+
+          Coordinate c;
+          c.x = ll.lng();
+          c.y = ll.lat();
+          coords->add(c, 0);
+
+        }
+
+        if (coords->getSize() > 1) {
+          geom = std::unique_ptr<Geometry>(gf->createLineString(coords.release()));
+          lines->push_back(geom.release());
+        }
+
+      } // member loop
+
+      if (has_data) {
+        std::unique_ptr<Geometry> mline (gf->createMultiLineString(lines.release()));
+        admin_wkts[i] = GetWkts(mline);
+      }
+      else {
+        for (auto* line : *lines)
+          delete line;
+      }
+    }
+    catch (std::exception& e)
+    {
+      LOG_ERROR("Standard exception processing relation: " + std::string(e.what()));
+    }
+    catch (...)
+    {
+      LOG_ERROR("Exception caught processing relations.");
+    }
+  }
+}
+
 /**
  * Build admins from protocol buffer input.
  */
@@ -406,114 +483,68 @@ void BuildAdminFromPBF(const boost::property_tree::ptree& pt,
     return;
   }
 
-  uint32_t count = 0;
-  uint64_t nodeid;
-  bool has_data;
-#if 3 == GEOS_VERSION_MAJOR && 6 <= GEOS_VERSION_MINOR
-  GeometryFactory::unique_ptr gf = GeometryFactory::create();
-#else
-  std::unique_ptr<GeometryFactory> gf(new GeometryFactory());
-#endif
-
-  try {
-
-    for (const auto admin : osmdata.admins_) {
-
-      std::unique_ptr<Geometry> geom;
-      std::unique_ptr<std::vector<Geometry*> > lines(new std::vector<Geometry*>);
-      has_data = true;
-
-      for (const auto memberid : admin.ways()) {
-
-        auto itr = osmdata.way_map.find(memberid);
-
-        // A relation may be included in an extract but it's members may not.
-        // Example:  PA extract can contain a NY relation.
-        if (itr == osmdata.way_map.end()) {
-          has_data = false;
-          break;
-        }
-
-        std::unique_ptr<CoordinateSequence> coords(gf->getCoordinateSequenceFactory()->create((size_t)0, (size_t)2));
-        size_t j = 0;
-
-        for (const auto ref_id :itr->second) {
-
-          const PointLL ll = osmdata.shape_map.at(ref_id);
-
-          Coordinate c;
-          c.x = ll.lng();
-          c.y = ll.lat();
-          coords->add(c, 0);
-
-        }
-
-        if (coords->getSize() > 1) {
-          geom = std::unique_ptr<Geometry>(gf->createLineString(coords.release()));
-          lines->push_back(geom.release());
-        }
-
-      } // member loop
-
-      if (has_data) {
-
-        std::unique_ptr<Geometry> mline (gf->createMultiLineString(lines.release()));
-        std::vector<std::string> wkts = GetWkts(mline);
-        std::string name;
-        std::string name_en;
-        std::string iso;
-
-        for (const auto& wkt : wkts) {
+  // Assemble the admin multipolygons in parallel
+  unsigned int thread_count = std::max(1u, pt.get<unsigned int>("concurrency",
+                                       std::thread::hardware_concurrency()));
+  std::vector<std::vector<std::string> > admin_wkts(osmdata.admins_.size());
+  std::vector<std::shared_ptr<std::thread> > threads(thread_count);
+  LOG_INFO("Assembling " + std::to_string(osmdata.admins_.size()) + " admin areas with " +
+           std::to_string(thread_count) + " threads...");
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].reset(new std::thread(AssembleAdmins, std::cref(osmdata), i,
+                                     threads.size(), std::ref(admin_wkts)));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
 
-          count++;
-          sqlite3_reset (stmt);
-          sqlite3_clear_bindings (stmt);
-          sqlite3_bind_int (stmt, 1, admin.admin_level());
+  uint32_t count = 0;
+  std::string name;
+  std::string name_en;
+  std::string iso;
+  for (size_t i = 0; i < osmdata.admins_.size(); ++i) {
+    const auto& admin = osmdata.admins_[i];
+    for (const auto& wkt : admin_wkts[i]) {
+
+      count++;
+      sqlite3_reset (stmt);
+      sqlite3_clear_bindings (stmt);
+      sqlite3_bind_int (stmt, 1, admin.admin_level());
+
+      if (admin.iso_code_index()) {
+        iso = osmdata.name_offset_map.name(admin.iso_code_index());
+        sqlite3_bind_text (stmt, 2, iso.c_str(), iso.length(), SQLITE_STATIC);
+      }
+      else
+        sqlite3_bind_null(stmt,2);
 
-          if (admin.iso_code_index()) {
-            iso = osmdata.name_offset_map.name(admin.iso_code_index());
-            sqlite3_bind_text (stmt, 2, iso.c_str(), iso.length(), SQLITE_STATIC);
-          }
-          else
-            sqlite3_bind_null(stmt,2);
+      sqlite3_bind_null(stmt,3);
 
-          sqlite3_bind_null(stmt,3);
+      name = osmdata.name_offset_map.name(admin.name_index());
+      sqlite3_bind_text (stmt, 4, name.c_str(), name.length(), SQLITE_STATIC);
 
-          name = osmdata.name_offset_map.name(admin.name_index());
-          sqlite3_bind_text (stmt, 4, name.c_str(), name.length(), SQLITE_STATIC);
+      if (admin.name_en_index()) {
+        name_en = osmdata.name_offset_map.name(admin.name_en_index());
+        sqlite3_bind_text (stmt, 5, name_en.c_str(), name_en.length(), SQLITE_STATIC);
+      }
+      else
+        sqlite3_bind_null(stmt,5);
 
-          if (admin.name_en_index()) {
-            name_en = osmdata.name_offset_map.name(admin.name_en_index());
-            sqlite3_bind_text (stmt, 5, name_en.c_str(), name_en.length(), SQLITE_STATIC);
-          }
-          else
-            sqlite3_bind_null(stmt,5);
-
-          sqlite3_bind_int (stmt,  6, admin.drive_on_right());
-          sqlite3_bind_text (stmt, 7, wkt.c_str(), wkt.length(), SQLITE_STATIC);
-          /* performing INSERT INTO */
-          ret = sqlite3_step (stmt);
-          if (ret == SQLITE_DONE || ret == SQLITE_ROW) {
-            continue;
-          }
-          LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
-          LOG_ERROR("sqlite3_step() Name: " + osmdata.name_offset_map.name(admin.name_index()));
-          LOG_ERROR("sqlite3_step() Name:en: " + osmdata.name_offset_map.name(admin.name_en_index()));
-          LOG_ERROR("sqlite3_step() Admin Level: " + std::to_string(admin.admin_level()));
-          LOG_ERROR("sqlite3_step() Drive on Right: " + std::to_string(admin.drive_on_right()));
+      sqlite3_bind_int (stmt,  6, admin.drive_on_right());
+      sqlite3_bind_text (stmt, 7, wkt.c_str(), wkt.length(), SQLITE_STATIC);
+      /* performing INSERT INTO */
+      ret = sqlite3_step (stmt);
+      if (ret == SQLITE_DONE || ret == SQLITE_ROW) {
+        continue;
+      }
+      LOG_ERROR("sqlite3_step() error: " + std::string(sqlite3_errmsg(db_handle)));
+      LOG_ERROR("sqlite3_step() Name: " + osmdata.name_offset_map.name(admin.name_index()));
+      LOG_ERROR("sqlite3_step() Name:en: " + osmdata.name_offset_map.name(admin.name_en_index()));
+      LOG_ERROR("sqlite3_step() Admin Level: " + std::to_string(admin.admin_level()));
+      LOG_ERROR("sqlite3_step() Drive on Right: " + std::to_string(admin.drive_on_right()));
 
-        }
-      }// has data
-    }// admins
-  }
-  catch (std::exception& e)
-  {
-    LOG_ERROR("Standard exception processing relation: " + std::string(e.what()));
-  }
-  catch (...)
-  {
-    LOG_ERROR("Exception caught processing relations.");
-  }
+    }
+  }// admins
 
   sqlite3_finalize (stmt);
   ret = sqlite3_exec (db_handle, "COMMIT", NULL, NULL, &err_msg);
@@ -639,6 +670,18 @@ void BuildAdminFromPBF(const boost::property_tree::ptree& pt,
     return;
   }
 
+  // Pack the admins for the graph builder, if asked to
+  auto packed = pt.get_optional<std::string>("admin_packed");
+  if (packed && !packed->empty()) {
+    try {
+      count = PackedAdmins::Write(db_handle, *packed);
+      LOG_INFO("Packed " + std::to_string(count) + " admin areas into " + *packed);
+    }
+    catch (std::exception& e) {
+      LOG_ERROR("Failed packing admins: " + std::string(e.what()));
+    }
+  }
+
   sqlite3_close (db_handle);
 
   LOG_INFO("Finished.");
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "baldr/connectivity_map.h"
+#include "baldr/transit_stop_index.h"
 #include "baldr/tilehierarchy.h"
 #include "config.h"
 
@@ -115,8 +116,24 @@ int main(int argc, char** argv) {
   boost::property_tree::ptree pt;
   boost::property_tree::read_json(config_file_path.c_str(), pt);
 
-  // Get something we can use to fetch tiles
-  valhalla::baldr::connectivity_map_t connectivity_map(pt.get_child("mjolnir"));
+  // Get something we can use to fetch tiles, always crawl the tiles since
+  // the point is to refresh the colors
+  valhalla::baldr::connectivity_map_t connectivity_map(pt.get_child("mjolnir"), false);
+
+  // Keep the colors so the services can map them rather than crawl the tiles
+  auto connectivity_file = pt.get<std::string>("mjolnir.connectivity_map", "");
+  if (!connectivity_file.empty()) {
+    connectivity_map.save(connectivity_file);
+    std::cout << "Wrote connectivity map to " << connectivity_file << std::endl;
+  }
+
+  // Keep the transit stops so the services can check for transit without the tiles
+  auto transit_stop_file = pt.get<std::string>("mjolnir.transit_stop_index", "");
+  if (!transit_stop_file.empty()) {
+    auto transit_stops = transit_stop_index_t::build(pt.get_child("mjolnir"));
+    transit_stops.save(transit_stop_file);
+    std::cout << "Wrote " << transit_stops.size() << " transit stops to " << transit_stop_file << std::endl;
+  }
 
   uint32_t transit_level = TileHierarchy::levels().rbegin()->second.level + 1;
   for (uint32_t level = 0; level <= transit_level; level++) {
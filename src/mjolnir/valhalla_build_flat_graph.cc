@@ -0,0 +1,132 @@
+#include <string>
+#include <vector>
+
+#include "mjolnir/flatgraphbuilder.h"
+#include "config.h"
+
+using namespace valhalla::mjolnir;
+
+#include <iostream>
+#include <boost/program_options.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/optional.hpp>
+
+#include "midgard/logging.h"
+#include "midgard/util.h"
+
+namespace bpo = boost::program_options;
+
+int main(int argc, char** argv) {
+  // Program options
+  boost::filesystem::path config_file_path;
+  std::string inline_config;
+  std::vector<std::string> costings;
+  std::string bbox, output;
+  bpo::options_description options(
+    "valhalla_build_flat_graph " VERSION "\n\n"
+    "Usage: valhalla_build_flat_graph [options] <costing>...\n\n"
+    "valhalla_build_flat_graph is a program that flattens the tiles of a region "
+    "of the route graph in the tile_dir into a contiguous snapshot for each given "
+    "costing, with its default options. Offline batch jobs run their matrices over "
+    "the snapshot without looking up a tile for every edge, valhalla_run_matrix "
+    "does with --flat-graph. Rebuild them whenever the tiles change.\n\n");
+
+  options.add_options()
+      ("help,h", "Print this help message.")
+      ("version,v", "Print the version of this software.")
+      ("config,c",
+        boost::program_options::value<boost::filesystem::path>(&config_file_path),
+        "Path to the json configuration file.")
+      ("inline-config,i",
+        boost::program_options::value<std::string>(&inline_config),
+        "Inline json config.")
+      ("bbox,b",
+        boost::program_options::value<std::string>(&bbox),
+        "Region to flatten as minx,miny,maxx,maxy, the whole graph if not given.")
+      ("output,o",
+        boost::program_options::value<std::string>(&output),
+        "File to write, only with one costing. Defaults to <costing>.flat in the tile_dir.")
+      // positional arguments
+      ("costings", boost::program_options::value<std::vector<std::string> >(&costings)->multitoken());
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("costings", 16);
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // Print out help or version and return
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+  if (vm.count("version")) {
+    std::cout << "valhalla_build_flat_graph " << VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+  if (costings.size() == 0) {
+    std::cerr << "At least one costing is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+  if (!output.empty() && costings.size() > 1) {
+    std::cerr << "An output file can only be given for one costing\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+  valhalla::midgard::AABB2<valhalla::midgard::PointLL> bounds(-180.f, -90.f, 180.f, 90.f);
+  if (vm.count("bbox")) {
+    std::vector<float> corners;
+    std::stringstream ss(bbox);
+    std::string corner;
+    while (std::getline(ss, corner, ','))
+      corners.push_back(std::stof(corner));
+    if (corners.size() != 4) {
+      std::cerr << "The bbox needs four comma separated coordinates\n\n" << options << "\n\n";
+      return EXIT_FAILURE;
+    }
+    bounds = valhalla::midgard::AABB2<valhalla::midgard::PointLL>(corners[0], corners[1], corners[2], corners[3]);
+  }
+
+  // Read the config file
+  boost::property_tree::ptree pt;
+  if(vm.count("inline-config")) {
+    std::stringstream ss; ss << inline_config;
+    boost::property_tree::read_json(ss, pt);
+  }
+  else if (vm.count("config") && boost::filesystem::is_regular_file(config_file_path)) {
+    boost::property_tree::read_json(config_file_path.string(), pt);
+  }
+  else {
+    std::cerr << "Configuration is required\n\n" << options << "\n\n";
+    return EXIT_FAILURE;
+  }
+
+  //configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree = pt.get_child_optional("mjolnir.logging");
+  if(logging_subtree) {
+    auto logging_config = valhalla::midgard::ToMap<const boost::property_tree::ptree&, std::unordered_map<std::string, std::string> >(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  //flatten the tiles in the tile_dir
+  pt.get_child("mjolnir").erase("tile_extract");
+  pt.get_child("mjolnir").erase("tile_url");
+  for (const auto& costing : costings) {
+    try {
+      FlatGraphBuilder::Build(pt, costing, bounds, output);
+    }
+    catch (const std::exception& e) {
+      LOG_ERROR("Failed to build the " + costing + " flat graph: " + e.what());
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -6,6 +6,9 @@
 #include <unordered_map>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cctype>
+#include <algorithm>
 
 #include "config.h"
 
@@ -22,6 +25,8 @@
 #include "baldr/tilehierarchy.h"
 #include "baldr/directededge.h"
 #include "baldr/edgeinfo.h"
+#include "baldr/speed_profile.h"
+#include "mjolnir/graphtilebuilder.h"
 
 namespace bpo = boost::program_options;
 
@@ -30,6 +35,7 @@ using namespace valhalla::midgard;
 
 boost::filesystem::path config_file_path;
 std::vector<std::string> input_files;
+bool profiles = false;
 
 const uint32_t kMinutesPerHour = 60;
 const uint32_t kMinutesPerDay  = 24 * kMinutesPerHour;
@@ -61,7 +67,12 @@ bool ParseArguments(int argc, char *argv[]) {
     " Usage: valhalla_build_speeds [options]\n"
     "\n"
     "valhalla_build_speeds is a program that reads speed data associated to OSM ways "
-    "and creates a speed table on the local level tiles."
+    "and creates a speed table on the local level tiles. With --profiles it instead "
+    "reads historical speed profiles, one per line of traffic/speed_profiles.csv as an id "
+    "followed by the speed (kph) at each hour of the week starting at midnight on Sunday, "
+    "and the profiles of OSM ways, one per line of traffic/way_profiles.csv as the way id, "
+    "the forward profile id and the reverse profile id, and stores them in the local level "
+    "tiles for time dependent routing."
     "\n"
     "\n");
 
@@ -71,6 +82,7 @@ bool ParseArguments(int argc, char *argv[]) {
       ("config,c",
         boost::program_options::value<boost::filesystem::path>(&config_file_path)->required(),
         "Path to the json configuration file.")
+      ("profiles,p", bpo::bool_switch(&profiles), "Store historical speed profiles in the tiles.")
       // positional arguments
       ("input_files", boost::program_options::value<std::vector<std::string> >(&input_files)->multitoken());
 
@@ -193,6 +205,126 @@ uint8_t GetSpeed(const bool forward, const uint8_t fwd, const uint8_t rev) {
   return (forward) ? fwd : rev;
 }
 
+/**
+ * Read the speed profiles CSV file and return a mapping of ids to profiles.
+ */
+std::unordered_map<uint32_t, SpeedProfile> ReadSpeedProfiles(const std::string& tile_dir) {
+  std::string speed_profiles_file = tile_dir + "/traffic/speed_profiles.csv";
+  LOG_INFO("Read Speed Profiles file: " + speed_profiles_file);
+  std::unordered_map<uint32_t, SpeedProfile> speed_profiles;
+
+  // Get speed profile: id, speed (kph) at each hour of the week
+  std::ifstream profiles_file(speed_profiles_file);
+  std::string line;
+  while (std::getline(profiles_file, line)) {
+    std::string num;
+    std::stringstream line_stream(line);
+    if (!std::getline(line_stream, num, ',') || num.empty() || !std::isdigit(num.front()))
+      continue;
+    uint32_t id = std::stoul(num);
+    std::vector<uint8_t> speeds;
+    while (std::getline(line_stream, num, ','))
+      speeds.push_back(num.empty() ? 0 : std::min(std::stoi(num), 255));
+    if (speeds.size() != kSpeedProfileBuckets) {
+      LOG_WARN("Speed profile " + std::to_string(id) + " has " + std::to_string(speeds.size()) +
+               " speeds rather than " + std::to_string(kSpeedProfileBuckets));
+      continue;
+    }
+    speed_profiles.emplace(id, SpeedProfile(speeds));
+  }
+  return speed_profiles;
+}
+
+// Speed profiles of a tile and the profile of each of its directed edges
+struct TileProfiles {
+  std::vector<SpeedProfile> profiles;
+  std::unordered_map<uint32_t, uint16_t> indices;
+  std::vector<uint16_t> index;
+};
+
+/**
+ * Store the speed profiles of the ways in the tiles of their edges. Each tile
+ * only keeps the profiles its edges use.
+ */
+void StoreSpeedProfiles(const std::string& tile_dir, GraphReader& reader,
+    const std::unordered_map<uint64_t, std::vector<EdgeAndDirection>>& way_edges) {
+  auto speed_profiles = ReadSpeedProfiles(tile_dir);
+  LOG_INFO(std::to_string(speed_profiles.size()) + " speed profiles");
+  if (speed_profiles.empty())
+    return;
+
+  // Get the profiles of the ways: wayid, forward profile, reverse profile
+  std::string way_profiles_file = tile_dir + "/traffic/way_profiles.csv";
+  LOG_INFO("Read Way Profiles file: " + way_profiles_file);
+  std::ifstream ways_file(way_profiles_file);
+  std::unordered_map<uint32_t, TileProfiles> tile_profiles;
+  std::string line;
+  uint32_t stored_profiles = 0;
+  while (std::getline(ways_file, line)) {
+    std::string num;
+    std::stringstream line_stream(line);
+    std::vector<std::string> tokens;
+    while (std::getline(line_stream, num, ','))
+      tokens.push_back(num);
+    if (tokens.size() < 3 || tokens[0].empty() || !std::isdigit(tokens[0].front()))
+      continue;
+    auto way = way_edges.find(std::stoull(tokens[0]));
+    if (way == way_edges.end())
+      continue;
+
+    for (const auto& edge : way->second) {
+      const auto& profile_id = edge.forward ? tokens[1] : tokens[2];
+      if (profile_id.empty())
+        continue;
+      auto profile = speed_profiles.find(std::stoul(profile_id));
+      if (profile == speed_profiles.end())
+        continue;
+
+      // Set up the tile the first time one of its edges has a profile
+      uint32_t tileid = edge.edgeid.tileid();
+      auto tile_itr = tile_profiles.find(tileid);
+      if (tile_itr == tile_profiles.end()) {
+        const GraphTile* tile = reader.GetGraphTile(edge.edgeid.Tile_Base());
+        if (tile == nullptr) {
+          LOG_ERROR("No tile found for " + std::to_string(edge.edgeid.Tile_Base().tileid()) +
+                    "," + std::to_string(edge.edgeid.Tile_Base().level()));
+          continue;
+        }
+        tile_itr = tile_profiles.emplace(tileid, TileProfiles{}).first;
+        tile_itr->second.index.resize(tile->header()->directededgecount(), kNoSpeedProfile);
+      }
+
+      // Add the profile to the tile if it doesn't have it yet
+      auto& tp = tile_itr->second;
+      auto local = tp.indices.find(profile->first);
+      if (local == tp.indices.end()) {
+        if (tp.profiles.size() == kMaxSpeedProfiles) {
+          LOG_WARN("Too many speed profiles for tile " + std::to_string(tileid));
+          continue;
+        }
+        tp.profiles.push_back(profile->second);
+        local = tp.indices.emplace(profile->first, tp.profiles.size()).first;
+      }
+      if (edge.edgeid.id() < tp.index.size()) {
+        tp.index[edge.edgeid.id()] = local->second;
+        stored_profiles++;
+      }
+    }
+  }
+  LOG_INFO("Number of speed profile tiles = " + std::to_string(tile_profiles.size()));
+  LOG_INFO("Stored speed profiles = " + std::to_string(stored_profiles));
+
+  // Rewrite the tiles with their profiles
+  auto local_level = TileHierarchy::levels().rbegin()->second.level;
+  for (const auto& tile_itr : tile_profiles) {
+    const GraphTile* tile = reader.GetGraphTile(GraphId(tile_itr.first, local_level, 0));
+    LOG_INFO("TileID: " + std::to_string(tile_itr.first) + " speed profiles = " +
+             std::to_string(tile_itr.second.profiles.size()));
+    valhalla::mjolnir::GraphTileBuilder::AddSpeedProfiles(tile_dir, tile,
+        tile_itr.second.profiles, tile_itr.second.index);
+  }
+}
+
 // Main application to create a ppm image file of connectivity.
 int main(int argc, char** argv) {
   // Parse command line arguments
@@ -206,6 +338,13 @@ int main(int argc, char** argv) {
   // Get the tile directory from the config
   std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
 
+  // Store historical speed profiles in the tiles
+  if (profiles) {
+    GraphReader reader(pt.get_child("mjolnir"));
+    StoreSpeedProfiles(tile_dir, reader, ReadWaysToEdges(tile_dir + "/way_edges.txt"));
+    return EXIT_SUCCESS;
+  }
+
   // Read the way speed CSV file
   auto way_speeds = ReadWaySpeeds(tile_dir);
   if (way_speeds.size() == 0) {
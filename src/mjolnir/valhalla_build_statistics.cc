@@ -35,6 +35,7 @@ using namespace valhalla::mjolnir;
 
 namespace bpo = boost::program_options;
 boost::filesystem::path config_file_path;
+std::string csv_dir;
 
 namespace {
 
@@ -541,7 +542,10 @@ void BuildStatistics(const boost::property_tree::ptree& pt) {
   }
   LOG_INFO("Finished");
 
-  stats.build_db(pt);
+  if (csv_dir.empty())
+    stats.build_db(pt);
+  else
+    stats.build_csv(csv_dir);
   stats.roulette_data.GenerateTasks(pt);
 }
 
@@ -551,7 +555,10 @@ bool ParseArguments(int argc, char *argv[]) {
     ("help,h", "Print this help message")
     ("config,c",
      boost::program_options::value<boost::filesystem::path>(&config_file_path)->required(),
-     "Path to the json configuration file.");
+     "Path to the json configuration file.")
+    ("csv",
+     boost::program_options::value<std::string>(&csv_dir),
+     "Write the tables as csv files to this directory instead of to statistics.sqlite.");
   bpo::variables_map vm;
   try {
     bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
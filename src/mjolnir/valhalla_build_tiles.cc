@@ -91,6 +91,8 @@ int main(int argc, char** argv) {
   //build some tiles
   pt.get_child("mjolnir").erase("tile_extract");
   pt.get_child("mjolnir").erase("tile_url");
+  //tiles are rewritten while building so they must never be mapped
+  pt.get_child("mjolnir").erase("tile_mmap");
   build_tile_set(pt, input_files);
 
   return EXIT_SUCCESS;
@@ -1034,194 +1034,181 @@ std::unordered_multimap<GraphId, Departure> ProcessStopPairs(
   uint32_t schedule_index = 0;
   std::map<TransitSchedule, uint32_t> schedules;
 
-  std::size_t slash_found = file.find_last_of("/\\");
-  std::string directory = file.substr(0,slash_found);
-
-  boost::filesystem::recursive_directory_iterator transit_file_itr(directory);
-  boost::filesystem::recursive_directory_iterator end_file_itr;
+  // The stop pairs of a tile are in its pbf and then in .pbf.0, .pbf.1 and
+  // so on when there were too many for one. Read them one at a time so only
+  // one of the extra files is in memory at once.
+  std::string fname = file;
+  int ext = 0;
+  Transit extra;
+  for (const Transit* tile = &transit; boost::filesystem::exists(fname);
+       fname = file + "." + std::to_string(ext++)) {
+    if (ext > 0) {
+      extra = read_pbf(fname, lock);
+      tile = &extra;
+    }
+    const Transit& spp = *tile;
 
-  //for each tile.
-  for(; transit_file_itr != end_file_itr; ++transit_file_itr) {
-    if(boost::filesystem::is_regular(transit_file_itr->path())) {
-      std::string fname = transit_file_itr->path().string();
-      std::string ext = transit_file_itr->path().extension().string();
-      std::string file_name = fname.substr(0, fname.size() - ext.size());
-
-      // make sure we are looking at a pbf file
-      if ((ext == ".pbf" && fname == file) ||
-          (file_name.substr(file_name.size()-4) == ".pbf" && file_name == file)) {
-
-        Transit spp; {
-          // already loaded
-          if (ext == ".pbf")
-            spp = transit;
-          else
-            spp = read_pbf(fname, lock);
-        }
+    if (spp.stop_pairs_size() == 0) {
+      if (transit.nodes_size() > 0) {
+        LOG_ERROR("Tile " + fname +
+                  " has 0 schedule stop pairs but has " +
+                  std::to_string(transit.nodes_size()) + " stops");
+      }
+      departures.clear();
+      return departures;
+    }
 
-        if (spp.stop_pairs_size() == 0) {
-          if (transit.nodes_size() > 0) {
-            LOG_ERROR("Tile " + fname +
-                      " has 0 schedule stop pairs but has " +
-                      std::to_string(transit.nodes_size()) + " stops");
-          }
-          departures.clear();
-          return departures;
-        }
+    // Iterate through the stop pairs in this tile and form Valhalla departure
+    // records
+    for (const auto& sp : spp.stop_pairs()) {
+      // We do not know in this step if the end node is in a valid (non-empty)
+      // Valhalla tile. So just add the stop pair and we will address this later
+
+      // Use transit PBF graph Ids internally until adding to the graph tiles
+      // TODO - wheelchair accessible, shape information
+      Departure dep;
+      dep.orig_pbf_graphid = GraphId(sp.origin_graphid());
+      dep.dest_pbf_graphid = GraphId(sp.destination_graphid());
+      dep.route = sp.route_index();
+      dep.trip = sp.trip_id();
+
+      // if we have shape data then set everything else shapeid = 0;
+      if (sp.has_shape_id() && sp.has_destination_dist_traveled() && sp.has_origin_dist_traveled()) {
+        dep.shapeid = sp.shape_id();
+        dep.orig_dist_traveled = sp.origin_dist_traveled();
+        dep.dest_dist_traveled = sp.destination_dist_traveled();
+      } else dep.shapeid = 0;
+
+      dep.blockid = sp.has_block_id() ? sp.block_id() : 0;
+      dep.dep_time = sp.origin_departure_time();
+      dep.elapsed_time = sp.destination_arrival_time() - dep.dep_time;
+
+      dep.frequency_end_time = sp.has_frequency_end_time() ? sp.frequency_end_time() : 0;
+      dep.frequency = sp.has_frequency_headway_seconds() ? sp.frequency_headway_seconds() : 0;
+
+      if (!sp.bikes_allowed()) {
+        stop_access[dep.orig_pbf_graphid] |= kBicycleAccess;
+        stop_access[dep.dest_pbf_graphid] |= kBicycleAccess;
+      }
 
-        // Iterate through the stop pairs in this tile and form Valhalla departure
-        // records
-        for (const auto& sp : spp.stop_pairs()) {
-          // We do not know in this step if the end node is in a valid (non-empty)
-          // Valhalla tile. So just add the stop pair and we will address this later
-
-          // Use transit PBF graph Ids internally until adding to the graph tiles
-          // TODO - wheelchair accessible, shape information
-          Departure dep;
-          dep.orig_pbf_graphid = GraphId(sp.origin_graphid());
-          dep.dest_pbf_graphid = GraphId(sp.destination_graphid());
-          dep.route = sp.route_index();
-          dep.trip = sp.trip_id();
-
-          // if we have shape data then set everything else shapeid = 0;
-          if (sp.has_shape_id() && sp.has_destination_dist_traveled() && sp.has_origin_dist_traveled()) {
-            dep.shapeid = sp.shape_id();
-            dep.orig_dist_traveled = sp.origin_dist_traveled();
-            dep.dest_dist_traveled = sp.destination_dist_traveled();
-          } else dep.shapeid = 0;
-
-          dep.blockid = sp.has_block_id() ? sp.block_id() : 0;
-          dep.dep_time = sp.origin_departure_time();
-          dep.elapsed_time = sp.destination_arrival_time() - dep.dep_time;
-
-          dep.frequency_end_time = sp.has_frequency_end_time() ? sp.frequency_end_time() : 0;
-          dep.frequency = sp.has_frequency_headway_seconds() ? sp.frequency_headway_seconds() : 0;
-
-          if (!sp.bikes_allowed()) {
-            stop_access[dep.orig_pbf_graphid] |= kBicycleAccess;
-            stop_access[dep.dest_pbf_graphid] |= kBicycleAccess;
-          }
+      if (!sp.wheelchair_accessible()) {
+        stop_access[dep.orig_pbf_graphid] |= kWheelchairAccess;
+        stop_access[dep.dest_pbf_graphid] |= kWheelchairAccess;
+      }
 
-          if (!sp.wheelchair_accessible()) {
-            stop_access[dep.orig_pbf_graphid] |= kWheelchairAccess;
-            stop_access[dep.dest_pbf_graphid] |= kWheelchairAccess;
+      dep.bicycle_accessible = sp.bikes_allowed();
+      dep.wheelchair_accessible = sp.wheelchair_accessible();
+
+      // Compute days of week mask
+      uint32_t dow_mask = kDOWNone;
+      for (uint32_t x = 0; x < sp.service_days_of_week_size(); x++) {
+        bool dow = sp.service_days_of_week(x);
+        if (dow) {
+          switch (x) {
+            case 0:
+              dow_mask |= kMonday;
+              break;
+            case 1:
+              dow_mask |= kTuesday;
+              break;
+            case 2:
+              dow_mask |= kWednesday;
+              break;
+            case 3:
+              dow_mask |= kThursday;
+              break;
+            case 4:
+              dow_mask |= kFriday;
+              break;
+            case 5:
+              dow_mask |= kSaturday;
+              break;
+            case 6:
+              dow_mask |= kSunday;
+              break;
           }
+        }
+      }
 
-          dep.bicycle_accessible = sp.bikes_allowed();
-          dep.wheelchair_accessible = sp.wheelchair_accessible();
-
-          // Compute days of week mask
-          uint32_t dow_mask = kDOWNone;
-          for (uint32_t x = 0; x < sp.service_days_of_week_size(); x++) {
-            bool dow = sp.service_days_of_week(x);
-            if (dow) {
-              switch (x) {
-                case 0:
-                  dow_mask |= kMonday;
-                  break;
-                case 1:
-                  dow_mask |= kTuesday;
-                  break;
-                case 2:
-                  dow_mask |= kWednesday;
-                  break;
-                case 3:
-                  dow_mask |= kThursday;
-                  break;
-                case 4:
-                  dow_mask |= kFriday;
-                  break;
-                case 5:
-                  dow_mask |= kSaturday;
-                  break;
-                case 6:
-                  dow_mask |= kSunday;
-                  break;
-              }
-            }
-          }
+      // Compute the valid days
+      // set the bits based on the dow.
+      boost::gregorian::date start_date(boost::gregorian::gregorian_calendar::from_julian_day_number(sp.service_start_date()));
+      boost::gregorian::date end_date(boost::gregorian::gregorian_calendar::from_julian_day_number(sp.service_end_date()));
+      uint64_t days = DateTime::get_service_days(start_date, end_date, tile_date, dow_mask);
 
-          // Compute the valid days
-          // set the bits based on the dow.
-          boost::gregorian::date start_date(boost::gregorian::gregorian_calendar::from_julian_day_number(sp.service_start_date()));
-          boost::gregorian::date end_date(boost::gregorian::gregorian_calendar::from_julian_day_number(sp.service_end_date()));
-          uint64_t days = DateTime::get_service_days(start_date, end_date, tile_date, dow_mask);
+      // if this is a service addition for one day, delete the dow_mask.
+      if (sp.service_start_date() == sp.service_end_date())
+        dow_mask = kDOWNone;
 
-          // if this is a service addition for one day, delete the dow_mask.
-          if (sp.service_start_date() == sp.service_end_date())
-            dow_mask = kDOWNone;
+      // if dep.days == 0 then feed either starts after the end_date or tile_header_date > end_date
+      if (days == 0 && !sp.service_added_dates_size()) {
+        LOG_DEBUG("Feed rejected!  Start date: " + to_iso_extended_string(start_date) + " End date: " + to_iso_extended_string(end_date));
+        continue;
+      }
 
-          // if dep.days == 0 then feed either starts after the end_date or tile_header_date > end_date
-          if (days == 0 && !sp.service_added_dates_size()) {
-            LOG_DEBUG("Feed rejected!  Start date: " + to_iso_extended_string(start_date) + " End date: " + to_iso_extended_string(end_date));
-            continue;
-          }
+      dep.headsign_offset = transit_tilebuilder.AddName(sp.trip_headsign());
+      uint32_t end_day = (DateTime::days_from_pivot_date(end_date) - tile_date);
 
-          dep.headsign_offset = transit_tilebuilder.AddName(sp.trip_headsign());
-          uint32_t end_day = (DateTime::days_from_pivot_date(end_date) - tile_date);
+      if (end_day > kScheduleEndDay)
+        end_day = kScheduleEndDay;
 
-          if (end_day > kScheduleEndDay)
-            end_day = kScheduleEndDay;
+      //if subtractions are between start and end date then turn off bit.
+      for (const auto& x : sp.service_except_dates()) {
+        boost::gregorian::date d(boost::gregorian::gregorian_calendar::from_julian_day_number(x));
+        days = DateTime::remove_service_day(days, end_date, tile_date, d);
+      }
 
-          //if subtractions are between start and end date then turn off bit.
-          for (const auto& x : sp.service_except_dates()) {
-            boost::gregorian::date d(boost::gregorian::gregorian_calendar::from_julian_day_number(x));
-            days = DateTime::remove_service_day(days, end_date, tile_date, d);
-          }
+      //if additions are between start and end date then turn on bit.
+      for (const auto& x : sp.service_added_dates()) {
+        boost::gregorian::date d(boost::gregorian::gregorian_calendar::from_julian_day_number(x));
+        days = DateTime::add_service_day(days, end_date, tile_date, d);
+      }
 
-          //if additions are between start and end date then turn on bit.
-          for (const auto& x : sp.service_added_dates()) {
-            boost::gregorian::date d(boost::gregorian::gregorian_calendar::from_julian_day_number(x));
-            days = DateTime::add_service_day(days, end_date, tile_date, d);
-          }
+      TransitSchedule sched(days, dow_mask, end_day);
+      auto sched_itr = schedules.find(sched);
+      if (sched_itr == schedules.end()) {
+        // Not in the map - add a new transit schedule to the tile
+        transit_tilebuilder.AddTransitSchedule(sched);
 
-          TransitSchedule sched(days, dow_mask, end_day);
-          auto sched_itr = schedules.find(sched);
-          if (sched_itr == schedules.end()) {
-            // Not in the map - add a new transit schedule to the tile
-            transit_tilebuilder.AddTransitSchedule(sched);
-
-            // Add to the map and increment the index
-            schedules[sched] = schedule_index;
-            dep.schedule_index = schedule_index;
-            schedule_index++;
-          } else {
-            dep.schedule_index = sched_itr->second;
-          }
+        // Add to the map and increment the index
+        schedules[sched] = schedule_index;
+        dep.schedule_index = schedule_index;
+        schedule_index++;
+      } else {
+        dep.schedule_index = sched_itr->second;
+      }
 
-          //is this passed midnight?
-          //adjust the time if it is after midnight.
-          //create a departure for before midnight and one after
-          uint32_t origin_seconds = sp.origin_departure_time();
-          if (origin_seconds >= kSecondsPerDay) {
-
-            // Add the current dep to the departures list
-            // and then update it with new dep time.  This
-            // dep will be used when the start time is after
-            // midnight.
-            stats.midnight_dep_count++;
-            departures.emplace(dep.orig_pbf_graphid, dep);
-            while (origin_seconds >= kSecondsPerDay)
-              origin_seconds -= kSecondsPerDay;
-
-            dep.dep_time = origin_seconds;
-            dep.frequency_end_time = 0;
-            dep.frequency = 0;
-            if (sp.has_frequency_end_time() && sp.has_frequency_headway_seconds()) {
-              uint32_t frequency_end_time = sp.frequency_end_time();
-              //adjust the end time if it is after midnight.
-              while (frequency_end_time >= kSecondsPerDay)
-                frequency_end_time -= kSecondsPerDay;
-
-              dep.frequency_end_time = frequency_end_time;
-              dep.frequency = sp.frequency_headway_seconds();
-            }
-          }
-          // Add to the departures list
-          departures.emplace(dep.orig_pbf_graphid, std::move(dep));
-          stats.dep_count++;
+      //is this passed midnight?
+      //adjust the time if it is after midnight.
+      //create a departure for before midnight and one after
+      uint32_t origin_seconds = sp.origin_departure_time();
+      if (origin_seconds >= kSecondsPerDay) {
+
+        // Add the current dep to the departures list
+        // and then update it with new dep time.  This
+        // dep will be used when the start time is after
+        // midnight.
+        stats.midnight_dep_count++;
+        departures.emplace(dep.orig_pbf_graphid, dep);
+        while (origin_seconds >= kSecondsPerDay)
+          origin_seconds -= kSecondsPerDay;
+
+        dep.dep_time = origin_seconds;
+        dep.frequency_end_time = 0;
+        dep.frequency = 0;
+        if (sp.has_frequency_end_time() && sp.has_frequency_headway_seconds()) {
+          uint32_t frequency_end_time = sp.frequency_end_time();
+          //adjust the end time if it is after midnight.
+          while (frequency_end_time >= kSecondsPerDay)
+            frequency_end_time -= kSecondsPerDay;
+
+          dep.frequency_end_time = frequency_end_time;
+          dep.frequency = sp.frequency_headway_seconds();
         }
       }
+      // Add to the departures list
+      departures.emplace(dep.orig_pbf_graphid, std::move(dep));
+      stats.dep_count++;
     }
   }
   return departures;
@@ -1414,14 +1401,14 @@ GraphId GetGraphId(const GraphId& nodeid,
 
 void AddToGraph(GraphTileBuilder& tilebuilder_transit,
                 const GraphId& tileid,
-                const std::string& tile,
+                const Transit& transit,
                 const std::string& transit_dir,
                 std::mutex& lock,
                 const std::unordered_set<GraphId>& all_tiles,
                 const std::map<GraphId, StopEdges>& stop_edge_map,
                 const std::unordered_map<GraphId, uint16_t>& stop_access,
-                const std::unordered_map<uint32_t, Shape> shape_data,
-                const std::vector<float> distances,
+                const std::unordered_map<uint32_t, Shape>& shape_data,
+                const std::vector<float>& distances,
                 const std::vector<uint32_t>& route_types,
                 std::vector<OneStopTest>& onestoptests,
                 bool tile_within_one_tz,
@@ -1429,8 +1416,8 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
                 uint32_t& no_dir_edge_count) {
   auto t1 = std::chrono::high_resolution_clock::now();
 
-  // Get Transit PBF data for this tile
-  Transit transit = read_pbf(tile, lock);
+  // Transit PBF data of the neighboring tiles lines end in, read once each
+  std::unordered_map<GraphId, Transit> neighbors;
 
   std::set<uint64_t> added_stations;
   std::set<uint64_t> added_egress;
@@ -1782,13 +1769,15 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
 
       } else {
         // Get Transit PBF data for this tile
-        // Get transit pbf tile
-        std::string file_name = GraphTile::FileSuffix(GraphId(end_platform_graphid.tileid(), end_platform_graphid.level(),0));
-        boost::algorithm::trim_if(file_name, boost::is_any_of(".gph"));
-        file_name += ".pbf";
-        const std::string file = transit_dir + filesystem::path_separator + file_name;
-        Transit endtransit = read_pbf(file, lock);
-        const Transit_Node& endplatform = endtransit.nodes(end_platform_graphid.id());
+        auto endtransit = neighbors.find(end_platform_graphid.Tile_Base());
+        if (endtransit == neighbors.end()) {
+          std::string file_name = GraphTile::FileSuffix(GraphId(end_platform_graphid.tileid(), end_platform_graphid.level(),0));
+          boost::algorithm::trim_if(file_name, boost::is_any_of(".gph"));
+          file_name += ".pbf";
+          const std::string file = transit_dir + filesystem::path_separator + file_name;
+          endtransit = neighbors.emplace(end_platform_graphid.Tile_Base(), read_pbf(file, lock)).first;
+        }
+        const Transit_Node& endplatform = endtransit->second.nodes(end_platform_graphid.id());
         endstopname = endplatform.name();
         endll = {endplatform.lon(), endplatform.lat()};
         dest_id = endplatform.onestop_id();
@@ -1874,8 +1863,7 @@ void AddToGraph(GraphTileBuilder& tilebuilder_transit,
 // written. Also lock on queue access since shared by different threads.
 void build_tiles(const boost::property_tree::ptree& pt, std::mutex& lock,
                  const std::unordered_set<GraphId>& all_tiles,
-                 std::unordered_set<GraphId>::const_iterator tile_start,
-                 std::unordered_set<GraphId>::const_iterator tile_end,
+                 std::list<GraphId>& queue,
                  std::vector<OneStopTest>& onestoptests,
                  std::promise<builder_stats>& results) {
 
@@ -1892,15 +1880,22 @@ void build_tiles(const boost::property_tree::ptree& pt, std::mutex& lock,
     LOG_WARN("Time zone db " + *database + " not found.  Not saving time zone information from db.");
 
   const auto& tiles = TileHierarchy::levels().rbegin()->second.tiles;
+  const std::string transit_dir = pt.get<std::string>("transit_dir");
   // Iterate through the tiles in the queue and find any that include stops
-  for(; tile_start != tile_end; ++tile_start) {
+  while (true) {
     // Get the next tile Id from the queue and get a tile builder
+    lock.lock();
+    if (queue.empty()) {
+      lock.unlock();
+      break;
+    }
+    GraphId tile_id = queue.front().Tile_Base();
+    queue.pop_front();
+    lock.unlock();
     if(reader_transit_level.OverCommitted())
       reader_transit_level.Clear();
-    GraphId tile_id = tile_start->Tile_Base();
 
     // Get transit pbf tile
-    const std::string transit_dir = pt.get<std::string>("transit_dir");
     std::string file_name = GraphTile::FileSuffix(GraphId(tile_id.tileid(), tile_id.level(),0));
     boost::algorithm::trim_if(file_name, boost::is_any_of(".gph"));
     file_name += ".pbf";
@@ -1909,7 +1904,7 @@ void build_tiles(const boost::property_tree::ptree& pt, std::mutex& lock,
     // Make sure it exists
     if (!boost::filesystem::exists(file)) {
       LOG_ERROR("File not found.  " + file);
-      return;
+      continue;
     }
 
     Transit transit = read_pbf(file, lock);
@@ -2063,7 +2058,7 @@ void build_tiles(const boost::property_tree::ptree& pt, std::mutex& lock,
     }
 
     // Add nodes, directededges, and edgeinfo
-    AddToGraph(tilebuilder_transit, tile_id, file, transit_dir,
+    AddToGraph(tilebuilder_transit, tile_id, transit, transit_dir,
                lock, all_tiles, stop_edge_map, stop_access, shapes, distances,
                route_types, onestoptests, tile_within_one_tz, tz_polys,
                stats.no_dir_edge_count);
@@ -2114,25 +2109,37 @@ void build(const ptree& pt, const std::unordered_set<GraphId>& all_tiles,
   // A place to hold the results of those threads (exceptions, stats)
   std::list<std::promise<builder_stats> > results;
 
-  // Start the threads, divvy up the work
+  // Queue the tiles biggest first, the size of a tile's pbfs is about how
+  // long it takes to build, so threads take the next tile as they finish one
+  // rather than some being left with a run of big tiles at the end
   LOG_INFO("Adding " + std::to_string(all_tiles.size()) + " transit tiles to the transit graph...");
-  size_t floor = all_tiles.size() / threads.size();
-  size_t at_ceiling = all_tiles.size() - (threads.size() * floor);
-  std::unordered_set<GraphId>::const_iterator tile_start, tile_end = all_tiles.begin();
+  const std::string transit_dir = pt.get<std::string>("mjolnir.transit_dir");
+  std::vector<std::pair<uintmax_t, GraphId> > sized;
+  for (const auto& tile_id : all_tiles) {
+    std::string file_name = GraphTile::FileSuffix(GraphId(tile_id.tileid(), tile_id.level(),0));
+    boost::algorithm::trim_if(file_name, boost::is_any_of(".gph"));
+    const std::string prefix = transit_dir + filesystem::path_separator + file_name + ".pbf";
+    uintmax_t size = 0;
+    auto file = prefix;
+    for (int ext = 0; boost::filesystem::exists(file); file = prefix + "." + std::to_string(ext++))
+      size += boost::filesystem::file_size(file);
+    sized.emplace_back(size, tile_id);
+  }
+  std::sort(sized.begin(), sized.end(),
+    [](const std::pair<uintmax_t, GraphId>& a, const std::pair<uintmax_t, GraphId>& b) {
+      return a.first == b.first ? a.second < b.second : a.first > b.first;
+    });
+  std::list<GraphId> queue;
+  for (const auto& tile : sized)
+    queue.push_back(tile.second);
 
   // Atomically pass around stats info
   for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
     // Make the thread
     results.emplace_back();
     threads[i].reset(
         new std::thread(build_tiles, std::cref(pt.get_child("mjolnir")),
-                        std::ref(lock), std::cref(all_tiles), tile_start, tile_end,
+                        std::ref(lock), std::cref(all_tiles), std::ref(queue),
                         std::ref(onestoptests), std::ref(results.back())));
   }
 
@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+#include "mjolnir/osmchange.h"
+
+namespace bpo = boost::program_options;
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+boost::filesystem::path config_file_path;
+std::vector<std::string> input_files;
+std::string bin_file_prefix;
+
+bool ParseArguments(int argc, char *argv[]) {
+
+  bpo::options_description options(
+    "valhalla_dirty_tiles " VERSION "\n"
+    "\n"
+    " Usage: valhalla_dirty_tiles [options] <osc_change_file_path> ...\n"
+    "\n"
+    "valhalla_dirty_tiles is a program that lists the tiles of a previous build "
+    "of valhalla_build_tiles that have to be built again to pick up the changes "
+    "in osm change files, given oldest first. It needs the ways and way nodes "
+    "files that build left behind. The tiles are listed one per line as the "
+    "paths to them in the tile_dir."
+    "\n"
+    "\n");
+
+  options.add_options()
+      ("help,h", "Print this help message.")
+      ("version,v", "Print the version of this software.")
+      ("config,c",
+        boost::program_options::value<boost::filesystem::path>(&config_file_path)->required(),
+        "Path to the json configuration file.")
+      ("bin_file_prefix,b",
+        boost::program_options::value<std::string>(&bin_file_prefix)->default_value(""),
+        "Prefix of the ways.bin and way_nodes.bin files of the previous build.")
+      // positional arguments
+      ("input_files", boost::program_options::value<std::vector<std::string> >(&input_files)->multitoken());
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("input_files", 16);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what()
+      << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT
+      << "\n";
+    return false;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return true;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_dirty_tiles " << VERSION << "\n";
+    return true;
+  }
+
+  if (!vm.count("input_files")) {
+    std::cerr << "Input file is required\n\n" << options << "\n\n";
+    return false;
+  }
+
+  if (vm.count("config")) {
+    if (boost::filesystem::is_regular_file(config_file_path))
+      return true;
+    else
+      std::cerr << "Configuration file is required\n\n" << options << "\n\n";
+  }
+
+  return false;
+}
+
+int main(int argc, char** argv) {
+  // Parse command line arguments
+  if (!ParseArguments(argc, argv) || input_files.empty())
+    return EXIT_FAILURE;
+
+  // Read the config, logging goes to stderr since the tiles go to stdout
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(config_file_path.c_str(), pt);
+  valhalla::midgard::logging::Configure({{"type", "std_err"}, {"color", "true"}});
+
+  // Gather up all the changes
+  OSMChange change;
+  for (const auto& input_file : input_files) {
+    LOG_INFO("Reading " + input_file);
+    change.Read(input_file);
+  }
+  LOG_INFO("Changed " + std::to_string(change.nodes.size() + change.deleted_nodes.size()) + " nodes, " +
+           std::to_string(change.ways.size() + change.deleted_ways.size()) + " ways");
+
+  // List what has to be built again
+  auto tiles = change.DirtyTiles(pt.get_child("mjolnir"), bin_file_prefix + "ways.bin",
+                                 bin_file_prefix + "way_nodes.bin");
+  for (const auto& tile : tiles)
+    std::cout << GraphTile::FileSuffix(tile) << std::endl;
+  LOG_INFO(std::to_string(tiles.size()) + " tiles to build again");
+
+  return EXIT_SUCCESS;
+}
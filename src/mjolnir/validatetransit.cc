@@ -1,10 +1,11 @@
 #include "mjolnir/validatetransit.h"
-#include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/dataquality.h"
 #include "mjolnir/osmrestriction.h"
 
+#include <atomic>
 #include <future>
 #include <thread>
+#include <tuple>
 #include <queue>
 
 #include <boost/algorithm/string/regex.hpp>
@@ -25,27 +26,59 @@ using namespace valhalla::midgard;
 using namespace valhalla::baldr;
 using namespace valhalla::mjolnir;
 
-// Struct to hold stats information during each threads work
+namespace {
+
+// Outcome of the tests each thread ran, indexed by the position of the test
+// in the sorted tests. A station has multiple platforms so a test is tried
+// from each of them until one passes.
 struct validate_stats {
-  uint32_t failure_count;
+  std::vector<bool> tried;
+  std::vector<bool> passed;
 
   // Accumulate stats from all threads
   void operator()(const validate_stats& other) {
-    failure_count = other.failure_count;
+    for (size_t i = 0; i < tried.size(); ++i) {
+      tried[i] = tried[i] || other.tried[i];
+      passed[i] = passed[i] || other.passed[i];
+    }
   }
 };
 
+// Get the onestop id of the station of a platform. Stations are in the
+// same tile as their platforms and the tests contain the station onestop
+// ids and not the platforms.
+std::string StationName(const GraphTile* tile, const NodeInfo* platform) {
+  for (uint32_t j = 0; j < platform->edge_count(); ++j) {
+    const DirectedEdge* de = tile->directededge(platform->edge_index() + j);
+    if (de->use() == Use::kPlatformConnection) {
+      const TransitStop* transit_station = tile->GetTransitStop(
+          tile->node(de->endnode())->stop_index());
+      return tile->GetName(transit_station->one_stop_offset());
+    }
+  }
+  return "";
+}
+
+// Orders tests by origin, then destination, time and route so that the
+// tests of a station are next to each other and duplicates can be dropped
+bool test_less(const OneStopTest& a, const OneStopTest& b) {
+  return std::tie(a.origin, a.destination, a.date_time, a.route_id) <
+         std::tie(b.origin, b.destination, b.date_time, b.route_id);
+}
+
+std::string test_name(const OneStopTest& test) {
+  return test.origin + " to " + test.destination + " @ " + test.date_time +
+         " route id " + test.route_id;
+}
+
 // Walk the transit data starting at the origin onestop_id/node and walk the edges
 // until we find the destination onestop_id/node.  Must walk via the route
 // onestop_id provided in the tests.
 bool WalkTransitLines(const GraphId& n_graphId, GraphReader& reader,
-                      const GraphId& tileid, std::mutex& lock,
                       std::unordered_multimap<GraphId,uint64_t>& visited_map,
                       const std::string& date_time,
                       const std::string& end_name, const std::string& route_name) {
-  lock.lock();
   const GraphTile* endnodetile = reader.GetGraphTile(n_graphId);
-  lock.unlock();
   const NodeInfo* n_info = endnodetile->node(n_graphId);
   GraphId currentNode = n_graphId;
 
@@ -106,36 +139,13 @@ bool WalkTransitLines(const GraphId& n_graphId, GraphReader& reader,
 
           //get the new tile if needed.
           if (endnodetile->id() != currentNode.Tile_Base()) {
-            lock.lock();
             endnodetile = reader.GetGraphTile(currentNode);
-            lock.unlock();
           }
           //get new end node and start over if needed.
           n_info = endnodetile->node(currentNode);
 
           // are we done?
-          std::string station_name;
-          //stations are in the same tile as platforms and the tests contain the station
-          //onestop ids and not the platforms
-          uint32_t z = 0;
-          while (z < n_info->edge_count()) {
-
-            const DirectedEdge* de =
-                endnodetile->directededge(n_info->edge_index() + z);
-
-            //get the station node
-            if (de->use() == Use::kPlatformConnection) {
-
-              const TransitStop* transit_station = endnodetile->GetTransitStop(
-                  endnodetile->node(de->endnode())->stop_index());
-
-              station_name = endnodetile->GetName(transit_station->one_stop_offset());
-              break;
-            }
-            z++;
-          }
-
-          if (station_name == end_name) {
+          if (StationName(endnodetile, n_info) == end_name) {
             bDone = true;
             break;
           }
@@ -159,135 +169,72 @@ bool WalkTransitLines(const GraphId& n_graphId, GraphReader& reader,
   return bDone;
 }
 
-// validate the transit data using the one_stop tests.
-void validate(const boost::property_tree::ptree& pt, std::mutex& lock,
-              std::unordered_set<GraphId>::const_iterator tile_start,
-              std::unordered_set<GraphId>::const_iterator tile_end,
+// Validate the transit data of the tiles from next on, one at a time, using
+// the one_stop tests of the stations in them. Each thread has its own reader
+// so the threads do not wait on each other for tiles.
+void validate(const boost::property_tree::ptree& pt,
+              const std::vector<GraphId>& tiles, std::atomic<size_t>& next,
               const std::vector<OneStopTest>& onestoptests,
               std::promise<validate_stats>& results) {
-
-  uint32_t failure_count = 0;
-  GraphReader reader_transit_level(pt);
-
-  std::unordered_multimap<std::string, std::string> passed_tests;
-  std::unordered_multimap<std::string, std::string> failed_tests;
-
-  // Iterate through the tiles in the queue and find any that include stops
-  for(; tile_start != tile_end; ++tile_start) {
-    // Get the next tile Id from the queue and get a tile builder
-    if(reader_transit_level.OverCommitted())
-      reader_transit_level.Clear();
-    GraphId tile_id = tile_start->Tile_Base();
-
-    lock.lock();
-    GraphId transit_tile_id = GraphId(tile_id.tileid(), tile_id.level()+1, tile_id.id());
-    const GraphTile* transit_tile = reader_transit_level.GetGraphTile(transit_tile_id);
-    GraphTileBuilder tilebuilder(reader_transit_level.tile_dir(), transit_tile_id, true);
-    lock.unlock();
-
-    for (uint32_t i = 0; i < tilebuilder.header()->nodecount(); i++) {
-      NodeInfo& nodeinfo = tilebuilder.node_builder(i);
-
-      std::string station_name;
-      // all should be multiuseplatform, but check just to be sure.
-      if (nodeinfo.type() == NodeType::kMultiUseTransitPlatform) {
-
-        //stations are in the same tile as platforms and the tests contain the station
-        //onestop ids and not the platforms
-        uint32_t j = 0;
-        while (j < nodeinfo.edge_count()) {
-
-          const DirectedEdge* de =
-              transit_tile->directededge(nodeinfo.edge_index() + j);
-
-          //get the station node
-          if (de->use() == Use::kPlatformConnection) {
-            const TransitStop* transit_station = transit_tile->GetTransitStop(
-                transit_tile->node(de->endnode())->stop_index());
-
-            station_name = transit_tile->GetName(transit_station->one_stop_offset());
-            break;
-          }
-          j++;
-        }
+  try {
+    GraphReader reader_transit_level(pt);
+    validate_stats stats{std::vector<bool>(onestoptests.size(), false),
+                         std::vector<bool>(onestoptests.size(), false)};
+
+    // Iterate through the tiles and find any that include stops
+    for (size_t t = next++; t < tiles.size(); t = next++) {
+      if(reader_transit_level.OverCommitted())
+        reader_transit_level.Clear();
+      GraphId tile_id = tiles[t].Tile_Base();
+      GraphId transit_tile_id = GraphId(tile_id.tileid(), tile_id.level()+1, tile_id.id());
+      const GraphTile* transit_tile = reader_transit_level.GetGraphTile(transit_tile_id);
+      if (transit_tile == nullptr)
+        continue;
+
+      for (uint32_t i = 0; i < transit_tile->header()->nodecount(); i++) {
+        const NodeInfo* nodeinfo = transit_tile->node(i);
+
+        // all should be multiuseplatform, but check just to be sure.
+        if (nodeinfo->type() != NodeType::kMultiUseTransitPlatform)
+          continue;
 
         OneStopTest ost;
-        ost.origin = station_name;
+        ost.origin = StationName(transit_tile, nodeinfo);
         auto p = std::equal_range(onestoptests.begin(), onestoptests.end(), ost);
-
-        for (auto t = p.first; t != p.second; ++t) {
-
-          //has this test passed already?
-          //don't want to run again for another platform under a station.
-          bool bfound = false;
-          auto tests = passed_tests.equal_range(t->origin);
-          for (auto it = tests.first; it != tests.second; ++it) {
-            if (it->second == (t->destination + " @ " + t->date_time + " " + t->route_id)) {
-              bfound = true;
-              break;
-            }
-          }
-
-          if (bfound)
+        for (auto test = p.first; test != p.second; ++test) {
+          //has this test passed already from another platform of the station?
+          size_t index = test - onestoptests.begin();
+          if (stats.passed[index])
             continue;
+          stats.tried[index] = true;
 
-          const TransitStop* transit_stop = transit_tile->GetTransitStop(
-                      nodeinfo.stop_index());
           GraphId currentNode = GraphId(transit_tile->id().tileid(),transit_tile->id().level(), i);
-          GraphId tileid = transit_tile->id();
           std::unordered_multimap<GraphId,uint64_t> visited_map;
-
-          if (!WalkTransitLines(currentNode, reader_transit_level,
-                                tileid, lock, visited_map, t->date_time,
-                                t->destination, t->route_id)) {
+          if (!WalkTransitLines(currentNode, reader_transit_level, visited_map,
+                                test->date_time, test->destination, test->route_id)) {
 
             //Try again avoiding the departures found in the previous "walk"
             //We do this because we could of walked in the incorrect direction and
             //the route line could have the same name and id.
-            if (!WalkTransitLines(currentNode, reader_transit_level,
-                                  tileid, lock, visited_map, t->date_time,
-                                  t->destination, t->route_id)) {
-
-              LOG_DEBUG("Test from " + t->origin + " to " + t->destination + " @ " +
-                        t->date_time + " route id " + t->route_id + " failed.");
-              failed_tests.emplace(t->origin, (t->destination + " @ " + t->date_time + " " + t->route_id));
+            if (!WalkTransitLines(currentNode, reader_transit_level, visited_map,
+                                  test->date_time, test->destination, test->route_id)) {
+              LOG_DEBUG("Test from " + test_name(*test) + " failed.");
               continue;
             }
           }
-          LOG_DEBUG("Test from " + t->origin + " to " + t->destination + " @ " +
-                   t->date_time + " route id " + t->route_id + " passed.");
-          passed_tests.emplace(t->origin, (t->destination + " @ " + t->date_time + " " + t->route_id));
-
+          LOG_DEBUG("Test from " + test_name(*test) + " passed.");
+          stats.passed[index] = true;
         }
       }
     }
-  }
 
-  std::set<std::string> failures;
-  for ( auto p = failed_tests.begin(); p != failed_tests.end(); ++p ) {
-    bool bfound = false;
-    auto tests = passed_tests.equal_range(p->first);
-     for (auto it = tests.first; it != tests.second; ++it) {
-       if (it->second == (p->second)) {
-         bfound = true;
-         break;
-       }
-     }
-
-     if (bfound)
-       continue;
-     else { // only report a failure one time.  A station has multiple platforms and we could of
-       //walked the transit lines of the wrong platform.
-       if (failures.find(p->first + p->second) == failures.end()) {
-         failure_count++;
-         LOG_ERROR("Test from " + p->first + " to " + p->second + " failed.");
-         failures.emplace(p->first + p->second);
-       }
-     }
+    // Send back the statistics
+    results.set_value(std::move(stats));
+  } catch (...) {
+    results.set_exception(std::current_exception());
   }
+}
 
-  // Send back the statistics
-  results.set_value({failure_count});
 }
 
 namespace valhalla {
@@ -498,35 +445,29 @@ bool ValidateTransit::Validate(const boost::property_tree::ptree& pt,
     return false;
   }
 
-  // A place to hold worker threads and their results
+  // Index the tests by their origin station, each test is run once however
+  // many times it is listed
+  std::vector<OneStopTest> tests(onestoptests);
+  std::sort(tests.begin(), tests.end(), test_less);
+  tests.erase(std::unique(tests.begin(), tests.end(),
+    [](const OneStopTest& a, const OneStopTest& b) {
+      return !test_less(a, b) && !test_less(b, a);
+    }), tests.end());
+
+  // The threads take the tiles one at a time, the stations of a feed are
+  // rarely spread evenly over its tiles
+  std::vector<GraphId> tile_list(all_tiles.begin(), all_tiles.end());
+  std::sort(tile_list.begin(), tile_list.end());
+  std::atomic<size_t> next(0);
   std::vector<std::shared_ptr<std::thread> > threads(thread_count);
-
-  // An atomic object we can use to do the synchronization
-  std::mutex lock;
-
-  // A place to hold the results of those threads (exceptions, stats)
   std::list<std::promise<validate_stats> > results;
-
-  // Start the threads, divvy up the work
-  LOG_INFO("Validating " + std::to_string(all_tiles.size()) + " transit tiles...");
-  size_t floor = all_tiles.size() / threads.size();
-  size_t at_ceiling = all_tiles.size() - (threads.size() * floor);
-  std::unordered_set<GraphId>::const_iterator tile_start, tile_end = all_tiles.begin();
-
-  // Atomically pass around stats info
-  for (size_t i = 0; i < threads.size(); ++i) {
-    // Figure out how many this thread will work on (either ceiling or floor)
-    size_t tile_count = (i < at_ceiling ? floor + 1 : floor);
-    // Where the range begins
-    tile_start = tile_end;
-    // Where the range ends
-    std::advance(tile_end, tile_count);
-    // Make the thread
+  LOG_INFO("Validating " + std::to_string(tile_list.size()) + " transit tiles...");
+  for (auto& thread : threads) {
     results.emplace_back();
-    threads[i].reset(
+    thread.reset(
         new std::thread(validate, std::cref(local_pt.get_child("mjolnir")),
-                        std::ref(lock), tile_start, tile_end,
-                        std::cref(onestoptests), std::ref(results.back())));
+                        std::cref(tile_list), std::ref(next), std::cref(tests),
+                        std::ref(results.back())));
   }
 
   // Wait for them to finish up their work
@@ -534,20 +475,35 @@ bool ValidateTransit::Validate(const boost::property_tree::ptree& pt,
     thread->join();
   }
 
-  // Check all of the outcomes, to see about maximum density (km/km2)
-  validate_stats stats{};
-  uint32_t failure_count = 0;
+  // Gather the outcomes of all of the threads, a test passes if it passed
+  // from any platform of its station
+  validate_stats stats{std::vector<bool>(tests.size(), false),
+                       std::vector<bool>(tests.size(), false)};
   for (auto& result : results) {
     // If something bad went down this will rethrow it
     try {
-      auto thread_stats = result.get_future().get();
-      stats(thread_stats);
-      failure_count += stats.failure_count;
+      stats(result.get_future().get());
     }
     catch(std::exception& e) {
       //TODO: throw further up the chain?
+      LOG_ERROR("Transit validation failed: " + std::string(e.what()));
+    }
+  }
+
+  // Report each failure once, in the order of the tests
+  uint32_t failure_count = 0, untested_count = 0;
+  for (size_t i = 0; i < tests.size(); ++i) {
+    if (!stats.tried[i]) {
+      untested_count++;
+      LOG_DEBUG("Test from " + test_name(tests[i]) + " has no origin station.");
+    } else if (!stats.passed[i]) {
+      failure_count++;
+      LOG_ERROR("Test from " + test_name(tests[i]) + " failed.");
     }
   }
+  LOG_INFO("Ran " + std::to_string(tests.size() - untested_count) + " of " +
+           std::to_string(tests.size()) + " transit tests, " +
+           std::to_string(failure_count) + " failed.");
 
   auto t2 = std::chrono::high_resolution_clock::now();
   uint32_t secs = std::chrono::duration_cast<std::chrono::seconds>(t2 - t1).count();
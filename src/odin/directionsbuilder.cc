@@ -9,6 +9,7 @@
 #include "odin/narrativebuilder.h"
 #include "odin/narrative_builder_factory.h"
 #include "exception.h"
+#include "midgard/metrics.h"
 
 namespace {
 // Minimum edge length (~10 feet)
@@ -68,6 +69,7 @@ DirectionsBuilder::DirectionsBuilder() {
 // trip directions.
 TripDirections DirectionsBuilder::Build(
     const DirectionsOptions& directions_options, TripPath& trip_path) {
+  METRICS_TIME(kOdinDirections);
   // Validate trip path node list
   if (trip_path.node_size() < 1) {
     throw valhalla_exception_t{210};
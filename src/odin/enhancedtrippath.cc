@@ -71,11 +71,11 @@ EnhancedTripPath_Admin* EnhancedTripPath::GetAdmin(size_t index) {
   return static_cast<EnhancedTripPath_Admin*>(mutable_admin(index));
 }
 
-std::string EnhancedTripPath::GetCountryCode(int node_index) {
+const std::string& EnhancedTripPath::GetCountryCode(int node_index) {
   return GetAdmin(node(node_index).admin_index())->country_code();
 }
 
-std::string EnhancedTripPath::GetStateCode(int node_index) {
+const std::string& EnhancedTripPath::GetStateCode(int node_index) {
   return GetAdmin(node(node_index).admin_index())->state_code();
 }
 
@@ -86,14 +86,9 @@ std::list<Maneuver> ManeuversBuilder::Build() {
   // Combine maneuvers
   Combine(maneuvers);
 
-  // Calculate the consecutive exit sign count and then sort
-  CountAndSortExitSigns(maneuvers);
-
-  // Confirm maneuver type assignment
-  ConfirmManeuverTypeAssignment(maneuvers);
-
-  // Enhance signless interchanges
-  EnhanceSignlessInterchnages(maneuvers);
+  // Calculate the consecutive exit sign count and then sort,
+  // confirm maneuver type assignment and enhance signless interchanges
+  PostProcess(maneuvers);
 
 #ifdef LOGGING_LEVEL_TRACE
   int combined_man_id = 1;
@@ -643,43 +638,7 @@ void ManeuversBuilder::CountAndSortExitSigns(std::list<Maneuver>& maneuvers) {
 
   // Rank the exit signs
   while (prev_man != maneuvers.rend()) {
-
-    // Increase the branch exit sign consecutive count
-    // if it matches the succeeding named maneuver
-    if (prev_man->HasExitBranchSign() && !curr_man->HasExitSign()
-        && curr_man->HasStreetNames()) {
-      for (Sign& sign : *(prev_man->mutable_signs()->mutable_exit_branch_list())) {
-        for (const auto& street_name : curr_man->street_names()) {
-          if (sign.text() == street_name->value()) {
-            sign.set_consecutive_count(sign.consecutive_count() + 1);
-          }
-        }
-      }
-      SortExitSignList(prev_man->mutable_signs()->mutable_exit_number_list());
-    }
-    // Increase the consecutive count of signs that match their neighbor
-    else if (prev_man->HasExitSign() && curr_man->HasExitSign()) {
-
-      // Process the exit number signs
-      CountAndSortExitSignList(
-          prev_man->mutable_signs()->mutable_exit_number_list(),
-          curr_man->mutable_signs()->mutable_exit_number_list());
-
-      // Process the exit branch signs
-      CountAndSortExitSignList(
-          prev_man->mutable_signs()->mutable_exit_branch_list(),
-          curr_man->mutable_signs()->mutable_exit_branch_list());
-
-      // Process the exit toward signs
-      CountAndSortExitSignList(
-          prev_man->mutable_signs()->mutable_exit_toward_list(),
-          curr_man->mutable_signs()->mutable_exit_toward_list());
-
-      // Process the exit name signs
-      CountAndSortExitSignList(
-          prev_man->mutable_signs()->mutable_exit_name_list(),
-          curr_man->mutable_signs()->mutable_exit_name_list());
-    }
+    CountAndSortExitSigns(*prev_man, *curr_man);
 
     // Update iterators
     curr_man = prev_man;
@@ -688,6 +647,46 @@ void ManeuversBuilder::CountAndSortExitSigns(std::list<Maneuver>& maneuvers) {
 
 }
 
+void ManeuversBuilder::CountAndSortExitSigns(Maneuver& prev_man,
+                                             Maneuver& curr_man) {
+  // Increase the branch exit sign consecutive count
+  // if it matches the succeeding named maneuver
+  if (prev_man.HasExitBranchSign() && !curr_man.HasExitSign()
+      && curr_man.HasStreetNames()) {
+    for (Sign& sign : *(prev_man.mutable_signs()->mutable_exit_branch_list())) {
+      for (const auto& street_name : curr_man.street_names()) {
+        if (sign.text() == street_name->value()) {
+          sign.set_consecutive_count(sign.consecutive_count() + 1);
+        }
+      }
+    }
+    SortExitSignList(prev_man.mutable_signs()->mutable_exit_number_list());
+  }
+  // Increase the consecutive count of signs that match their neighbor
+  else if (prev_man.HasExitSign() && curr_man.HasExitSign()) {
+
+    // Process the exit number signs
+    CountAndSortExitSignList(
+        prev_man.mutable_signs()->mutable_exit_number_list(),
+        curr_man.mutable_signs()->mutable_exit_number_list());
+
+    // Process the exit branch signs
+    CountAndSortExitSignList(
+        prev_man.mutable_signs()->mutable_exit_branch_list(),
+        curr_man.mutable_signs()->mutable_exit_branch_list());
+
+    // Process the exit toward signs
+    CountAndSortExitSignList(
+        prev_man.mutable_signs()->mutable_exit_toward_list(),
+        curr_man.mutable_signs()->mutable_exit_toward_list());
+
+    // Process the exit name signs
+    CountAndSortExitSignList(
+        prev_man.mutable_signs()->mutable_exit_name_list(),
+        curr_man.mutable_signs()->mutable_exit_name_list());
+  }
+}
+
 void ManeuversBuilder::ConfirmManeuverTypeAssignment(
     std::list<Maneuver>& maneuvers) {
 
@@ -696,6 +695,37 @@ void ManeuversBuilder::ConfirmManeuverTypeAssignment(
   }
 }
 
+void ManeuversBuilder::PostProcess(std::list<Maneuver>& maneuvers) {
+  // Walking backwards keeps the order the separate passes had: the exit signs
+  // of a maneuver are counted against its successor before its type is
+  // confirmed, and an interchange is only enhanced once the counting has read
+  // its signs and the type of the maneuver after it has been confirmed
+  auto prev_man = maneuvers.rbegin();
+  auto curr_man = maneuvers.rbegin();
+  Maneuver* next_man = nullptr;
+
+  if (curr_man == maneuvers.rend())
+    return;
+  SetManeuverType(*curr_man, false);
+  ++prev_man;
+
+  while (prev_man != maneuvers.rend()) {
+    CountAndSortExitSigns(*prev_man, *curr_man);
+    SetManeuverType(*prev_man, false);
+    if (next_man)
+      EnhanceSignlessInterchnage(*prev_man, *curr_man, *next_man);
+
+    // Update iterators
+    next_man = &(*curr_man);
+    curr_man = prev_man;
+    ++prev_man;
+  }
+
+  // The first maneuver is its own previous maneuver
+  if (next_man)
+    EnhanceSignlessInterchnage(*curr_man, *curr_man, *next_man);
+}
+
 void ManeuversBuilder::CreateDestinationManeuver(Maneuver& maneuver) {
   int node_index = trip_path_->GetLastNodeIndex();
 
@@ -915,10 +945,7 @@ void ManeuversBuilder::UpdateManeuver(Maneuver& maneuver, int node_index) {
   // or usable internal intersection name exists
   if ((maneuver.street_names().empty() && !maneuver.internal_intersection())
       || UsableInternalIntersectionName(maneuver, node_index)) {
-    maneuver.set_street_names(
-        std::move(
-            StreetNamesFactory::Create(trip_path_->GetCountryCode(node_index),
-                                       prev_edge->GetNameList())));
+    maneuver.set_street_names(GetPrevEdgeNames(node_index).clone());
   }
 
   // Update the internal turn count
@@ -1085,13 +1112,12 @@ void ManeuversBuilder::FinalizeManeuver(Maneuver& maneuver, int node_index) {
 
   // Set begin street names
   if (!curr_edge->IsHighway() && !curr_edge->internal_intersection()
-      && (curr_edge->GetNameList().size() > 1)) {
-    std::unique_ptr<StreetNames> curr_edge_names = StreetNamesFactory::Create(
-        trip_path_->GetCountryCode(node_index), curr_edge->GetNameList());
+      && (curr_edge->name_size() > 1)) {
+    const auto& curr_edge_names = GetCurrEdgeNames(node_index);
     std::unique_ptr<StreetNames> common_base_names = curr_edge_names
-        ->FindCommonBaseNames(maneuver.street_names());
-    if (curr_edge_names->size() > common_base_names->size()) {
-      maneuver.set_begin_street_names(std::move(curr_edge_names));
+        .FindCommonBaseNames(maneuver.street_names());
+    if (curr_edge_names.size() > common_base_names->size()) {
+      maneuver.set_begin_street_names(curr_edge_names.clone());
     }
   }
 
@@ -1636,13 +1662,10 @@ bool ManeuversBuilder::CanManeuverIncludePrevEdge(Maneuver& maneuver,
     return false;
   }
 
-  std::unique_ptr<StreetNames> prev_edge_names = StreetNamesFactory::Create(
-      trip_path_->GetCountryCode(node_index), prev_edge->GetNameList());
-
   /////////////////////////////////////////////////////////////////////////////
   // Process common base names
-  std::unique_ptr<StreetNames> common_base_names = prev_edge_names
-      ->FindCommonBaseNames(maneuver.street_names());
+  std::unique_ptr<StreetNames> common_base_names = GetPrevEdgeNames(node_index)
+      .FindCommonBaseNames(maneuver.street_names());
   if (!common_base_names->empty()) {
     maneuver.set_street_names(std::move(common_base_names));
     return true;
@@ -1764,15 +1787,9 @@ bool ManeuversBuilder::IsLeftPencilPointUturn(
                                                    prev_edge->travel_mode(),
                                                    xedge_counts);
 
-    std::unique_ptr<StreetNames> prev_edge_names = StreetNamesFactory::Create(
-        trip_path_->GetCountryCode(node_index), prev_edge->GetNameList());
-
-    std::unique_ptr<StreetNames> curr_edge_names = StreetNamesFactory::Create(
-        trip_path_->GetCountryCode(node_index), curr_edge->GetNameList());
-
     // Process common base names
-    std::unique_ptr<StreetNames> common_base_names = prev_edge_names
-        ->FindCommonBaseNames(*curr_edge_names);
+    std::unique_ptr<StreetNames> common_base_names = GetPrevEdgeNames(node_index)
+        .FindCommonBaseNames(GetCurrEdgeNames(node_index));
 
     // If no intersecting traversable left road exists
     // and the from and to edges have a common base name
@@ -1810,15 +1827,9 @@ bool ManeuversBuilder::IsRightPencilPointUturn(
                                                    prev_edge->travel_mode(),
                                                    xedge_counts);
 
-    std::unique_ptr<StreetNames> prev_edge_names = StreetNamesFactory::Create(
-        trip_path_->GetCountryCode(node_index), prev_edge->GetNameList());
-
-    std::unique_ptr<StreetNames> curr_edge_names = StreetNamesFactory::Create(
-        trip_path_->GetCountryCode(node_index), curr_edge->GetNameList());
-
     // Process common base names
-    std::unique_ptr<StreetNames> common_base_names = prev_edge_names
-        ->FindCommonBaseNames(*curr_edge_names);
+    std::unique_ptr<StreetNames> common_base_names = GetPrevEdgeNames(node_index)
+        .FindCommonBaseNames(GetCurrEdgeNames(node_index));
 
     // If no intersecting traversable right road exists
     // and the from and to edges have a common base name
@@ -2067,22 +2078,7 @@ void ManeuversBuilder::EnhanceSignlessInterchnages(
 
   // Walk the maneuvers to find signless interchange maneuvers to enhance
   while (next_man != maneuvers.end()) {
-
-    // If the current maneuver is a ramp OR nameless fork and does not have any signage
-    // and the previous maneuver is not a ramp or fork
-    // and the next maneuver is a 'Merge maneuver'
-    // then add the first street name from the next maneuver
-    // to the current maneuver branch sign list
-    if ((curr_man->ramp() || (curr_man->fork() && !curr_man->HasStreetNames()))
-        && !curr_man->HasExitSign()
-        && !(prev_man->ramp() || prev_man->fork())
-        && (next_man->type()
-            == TripDirections_Maneuver_Type::TripDirections_Maneuver_Type_kMerge)
-        && next_man->HasStreetNames()) {
-      curr_man->mutable_signs()->mutable_exit_branch_list()->emplace_back(
-          next_man->street_names().front()->value());
-
-    }
+    EnhanceSignlessInterchnage(*prev_man, *curr_man, *next_man);
 
     // on to the next maneuver...
     prev_man = curr_man;
@@ -2092,5 +2088,46 @@ void ManeuversBuilder::EnhanceSignlessInterchnages(
 
 }
 
+void ManeuversBuilder::EnhanceSignlessInterchnage(const Maneuver& prev_man,
+                                                  Maneuver& curr_man,
+                                                  const Maneuver& next_man) {
+  // If the current maneuver is a ramp OR nameless fork and does not have any signage
+  // and the previous maneuver is not a ramp or fork
+  // and the next maneuver is a 'Merge maneuver'
+  // then add the first street name from the next maneuver
+  // to the current maneuver branch sign list
+  if ((curr_man.ramp() || (curr_man.fork() && !curr_man.HasStreetNames()))
+      && !curr_man.HasExitSign()
+      && !(prev_man.ramp() || prev_man.fork())
+      && (next_man.type()
+          == TripDirections_Maneuver_Type::TripDirections_Maneuver_Type_kMerge)
+      && next_man.HasStreetNames()) {
+    curr_man.mutable_signs()->mutable_exit_branch_list()->emplace_back(
+        next_man.street_names().front()->value());
+  }
+}
+
+const StreetNames& ManeuversBuilder::GetPrevEdgeNames(int node_index) const {
+  if (prev_edge_names_.size() <= static_cast<size_t>(node_index))
+    prev_edge_names_.resize(trip_path_->node_size());
+  auto& names = prev_edge_names_[node_index];
+  if (!names) {
+    names = StreetNamesFactory::Create(trip_path_->GetCountryCode(node_index),
+        trip_path_->GetPrevEdge(node_index)->GetNameList());
+  }
+  return *names;
+}
+
+const StreetNames& ManeuversBuilder::GetCurrEdgeNames(int node_index) const {
+  if (curr_edge_names_.size() <= static_cast<size_t>(node_index))
+    curr_edge_names_.resize(trip_path_->node_size());
+  auto& names = curr_edge_names_[node_index];
+  if (!names) {
+    names = StreetNamesFactory::Create(trip_path_->GetCountryCode(node_index),
+        trip_path_->GetCurrEdge(node_index)->GetNameList());
+  }
+  return *names;
+}
+
 }
 }
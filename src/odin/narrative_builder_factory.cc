@@ -16,33 +16,32 @@ std::unique_ptr<NarrativeBuilder> NarrativeBuilderFactory::Create(
     const EnhancedTripPath* trip_path) {
 
   // Get the locale dictionary
-  const auto phrase_dictionary = get_locales().find(
-      directions_options.language());
+  const auto dictionary = get_locale(directions_options.language());
 
   // If language tag is not found then throw error
-  if (phrase_dictionary == get_locales().end()) {
+  if (!dictionary) {
     throw std::runtime_error("Invalid language tag.");
   }
 
   // if a NarrativeBuilder is derived with specific code for a particular
   // language then add logic here and return derived NarrativeBuilder
-  if (phrase_dictionary->second->GetLanguageTag() == "cs-CZ") {
+  if (dictionary->GetLanguageTag() == "cs-CZ") {
     return midgard::make_unique<NarrativeBuilder_csCZ>(
-        directions_options, trip_path, *phrase_dictionary->second);
-  } else if (phrase_dictionary->second->GetLanguageTag() == "hi-IN") {
+        directions_options, trip_path, *dictionary);
+  } else if (dictionary->GetLanguageTag() == "hi-IN") {
     return midgard::make_unique<NarrativeBuilder_hiIN>(
-        directions_options, trip_path, *phrase_dictionary->second);
-  } else if (phrase_dictionary->second->GetLanguageTag() == "it-IT") {
+        directions_options, trip_path, *dictionary);
+  } else if (dictionary->GetLanguageTag() == "it-IT") {
     return midgard::make_unique<NarrativeBuilder_itIT>(
-        directions_options, trip_path, *phrase_dictionary->second);
-  } else if (phrase_dictionary->second->GetLanguageTag() == "ru-RU") {
+        directions_options, trip_path, *dictionary);
+  } else if (dictionary->GetLanguageTag() == "ru-RU") {
     return midgard::make_unique<NarrativeBuilder_ruRU>(
-        directions_options, trip_path, *phrase_dictionary->second);
+        directions_options, trip_path, *dictionary);
   }
 
   // otherwise just return pointer to NarrativeBuilder
   return midgard::make_unique<NarrativeBuilder>(directions_options, trip_path,
-                                                *phrase_dictionary->second);
+                                                *dictionary);
 }
 
 }
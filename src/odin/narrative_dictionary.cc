@@ -31,11 +31,98 @@ std::unordered_map<K, V> as_unordered_map(
   return items;
 }
 
+// Phrase tags and their slots
+const std::unordered_map<std::string, valhalla::odin::PhraseTag> kPhraseTags = {
+  { kCardinalDirectionTag, valhalla::odin::PhraseTag::kCardinalDirection },
+  { kRelativeDirectionTag, valhalla::odin::PhraseTag::kRelativeDirection },
+  { kOrdinalValueTag, valhalla::odin::PhraseTag::kOrdinalValue },
+  { kStreetNamesTag, valhalla::odin::PhraseTag::kStreetNames },
+  { kPreviousStreetNamesTag, valhalla::odin::PhraseTag::kPreviousStreetNames },
+  { kBeginStreetNamesTag, valhalla::odin::PhraseTag::kBeginStreetNames },
+  { kCrossStreetNamesTag, valhalla::odin::PhraseTag::kCrossStreetNames },
+  { kLengthTag, valhalla::odin::PhraseTag::kLength },
+  { kDestinationTag, valhalla::odin::PhraseTag::kDestination },
+  { kCurrentVerbalCueTag, valhalla::odin::PhraseTag::kCurrentVerbalCue },
+  { kNextVerbalCueTag, valhalla::odin::PhraseTag::kNextVerbalCue },
+  { kNumberSignTag, valhalla::odin::PhraseTag::kNumberSign },
+  { kBranchSignTag, valhalla::odin::PhraseTag::kBranchSign },
+  { kTowardSignTag, valhalla::odin::PhraseTag::kTowardSign },
+  { kNameSignTag, valhalla::odin::PhraseTag::kNameSign },
+  { kFerryLabelTag, valhalla::odin::PhraseTag::kFerryLabel },
+  { kTransitPlatformTag, valhalla::odin::PhraseTag::kTransitPlatform },
+  { kStationLabelTag, valhalla::odin::PhraseTag::kStationLabel },
+  { kTimeTag, valhalla::odin::PhraseTag::kTime },
+  { kTransitNameTag, valhalla::odin::PhraseTag::kTransitName },
+  { kTransitHeadSignTag, valhalla::odin::PhraseTag::kTransitHeadSign },
+  { kTransitPlatformCountTag, valhalla::odin::PhraseTag::kTransitPlatformCount },
+  { kTransitPlatformCountLabelTag, valhalla::odin::PhraseTag::kTransitPlatformCountLabel }
+};
+
 }
 
 namespace valhalla {
 namespace odin {
 
+constexpr uint8_t PhraseTemplate::kLiteral;
+
+PhraseTemplate::PhraseTemplate(const std::string& phrase) : phrase_(phrase) {
+  // Split the phrase at its tags, merging unknown tags into the literal text
+  size_t literal_start = 0;
+  size_t pos = 0;
+  while ((pos = phrase_.find('<', pos)) != std::string::npos) {
+    size_t end = phrase_.find('>', pos);
+    if (end == std::string::npos) {
+      break;
+    }
+    auto tag = kPhraseTags.find(phrase_.substr(pos, end - pos + 1));
+    if (tag == kPhraseTags.end()) {
+      ++pos;
+      continue;
+    }
+    if (pos > literal_start) {
+      tokens_.push_back({static_cast<uint32_t>(literal_start),
+                         static_cast<uint32_t>(pos - literal_start), kLiteral});
+      literal_length_ += pos - literal_start;
+    }
+    tokens_.push_back({static_cast<uint32_t>(pos),
+                       static_cast<uint32_t>(end - pos + 1),
+                       static_cast<uint8_t>(tag->second)});
+    pos = literal_start = end + 1;
+  }
+  if (phrase_.size() > literal_start) {
+    tokens_.push_back({static_cast<uint32_t>(literal_start),
+                       static_cast<uint32_t>(phrase_.size() - literal_start),
+                       kLiteral});
+    literal_length_ += phrase_.size() - literal_start;
+  }
+}
+
+void PhraseTemplate::Render(const PhraseValues& values,
+                            std::string& instruction) const {
+  // Size the instruction once for the literal text and the values
+  size_t length = instruction.size() + literal_length_;
+  for (const auto& token : tokens_) {
+    if (token.slot != kLiteral) {
+      const auto* value = values.Get(static_cast<PhraseTag>(token.slot));
+      length += (value == nullptr) ? token.length : value->size();
+    }
+  }
+  instruction.reserve(length);
+
+  // Append the literal text and the values of the tags in order
+  for (const auto& token : tokens_) {
+    const std::string* value = nullptr;
+    if (token.slot != kLiteral) {
+      value = values.Get(static_cast<PhraseTag>(token.slot));
+    }
+    if (value == nullptr) {
+      instruction.append(phrase_, token.offset, token.length);
+    } else {
+      instruction.append(*value);
+    }
+  }
+}
+
 NarrativeDictionary::NarrativeDictionary(
     const std::string language_tag,
     const boost::property_tree::ptree& narrative_pt) {
@@ -330,6 +417,12 @@ void NarrativeDictionary::Load(PhraseSet& phrase_handle,
 
   phrase_handle.phrases = as_unordered_map<std::string, std::string>(
       phrase_pt, kPhrasesKey);
+
+  // Compile the phrases into templates
+  phrase_handle.templates.clear();
+  for (const auto& phrase : phrase_handle.phrases) {
+    phrase_handle.templates.emplace(phrase.first, PhraseTemplate(phrase.second));
+  }
 }
 
 void NarrativeDictionary::Load(
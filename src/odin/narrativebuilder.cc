@@ -576,13 +576,13 @@ std::string NarrativeBuilder::FormStartInstruction(Maneuver& maneuver) {
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.start_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kCardinalDirection, cardinal_direction)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -634,17 +634,16 @@ std::string NarrativeBuilder::FormVerbalStartInstruction(
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.start_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
-  boost::replace_all(instruction, kLengthTag,
-      FormLength(maneuver, dictionary_.start_verbal_subset.metric_lengths,
-                 dictionary_.start_verbal_subset.us_customary_lengths));
+  // Form instruction from the determined tagged phrase
+  dictionary_.start_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kCardinalDirection, cardinal_direction)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names)
+          .Set(PhraseTag::kLength,
+              FormLength(maneuver, dictionary_.start_verbal_subset.metric_lengths,
+                  dictionary_.start_verbal_subset.us_customary_lengths)),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -688,15 +687,12 @@ std::string NarrativeBuilder::FormDestinationInstruction(Maneuver& maneuver) {
     relative_direction = dictionary_.destination_subset.relative_directions.at(1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Form instruction from the determined tagged phrase
+  dictionary_.destination_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_direction)
+          .Set(PhraseTag::kDestination, destination),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -745,15 +741,12 @@ std::string NarrativeBuilder::FormVerbalAlertDestinationInstruction(
     relative_direction = dictionary_.destination_subset.relative_directions.at(1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_alert_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Form instruction from the determined tagged phrase
+  dictionary_.destination_verbal_alert_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_direction)
+          .Set(PhraseTag::kDestination, destination),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -802,15 +795,12 @@ std::string NarrativeBuilder::FormVerbalDestinationInstruction(
     relative_direction = dictionary_.destination_subset.relative_directions.at(1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.destination_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  if (phrase_id > 0) {
-    // Replace phrase tags with values
-    boost::replace_all(instruction, kRelativeDirectionTag, relative_direction);
-    boost::replace_all(instruction, kDestinationTag, destination);
-  }
+  // Form instruction from the determined tagged phrase
+  dictionary_.destination_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_direction)
+          .Set(PhraseTag::kDestination, destination),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -835,12 +825,12 @@ std::string NarrativeBuilder::FormBecomesInstruction(Maneuver& maneuver,
   // Determine which phrase to use
   uint8_t phrase_id = 0;
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.becomes_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kPreviousStreetNames, prev_street_names)
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -871,12 +861,12 @@ std::string NarrativeBuilder::FormVerbalBecomesInstruction(
   // Determine which phrase to use
   uint8_t phrase_id = 0;
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.becomes_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kPreviousStreetNamesTag, prev_street_names);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.becomes_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kPreviousStreetNames, prev_street_names)
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -905,12 +895,11 @@ std::string NarrativeBuilder::FormContinueInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.continue_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -940,12 +929,11 @@ std::string NarrativeBuilder::FormVerbalAlertContinueInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_alert_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.continue_verbal_alert_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -976,15 +964,14 @@ std::string NarrativeBuilder::FormVerbalContinueInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.continue_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-      FormLength(maneuver, dictionary_.continue_verbal_subset.metric_lengths,
-                 dictionary_.continue_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.continue_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kLength,
+              FormLength(maneuver, dictionary_.continue_verbal_subset.metric_lengths,
+                  dictionary_.continue_verbal_subset.us_customary_lengths))
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1043,14 +1030,15 @@ std::string NarrativeBuilder::FormTurnInstruction(Maneuver& maneuver,
     phrase_id = 3;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-      FormRelativeTwoDirection(maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  subset->templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection,
+              FormRelativeTwoDirection(maneuver.type(),
+                                       subset->relative_directions))
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1127,15 +1115,15 @@ std::string NarrativeBuilder::FormVerbalTurnInstruction(
     phrase_id = 3;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = subset->phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-      FormRelativeTwoDirection(
-          maneuver.type(), subset->relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  subset->templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection,
+              FormRelativeTwoDirection(
+                  maneuver.type(), subset->relative_directions))
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1178,15 +1166,15 @@ std::string NarrativeBuilder::FormUturnInstruction(Maneuver& maneuver,
     phrase_id += 3;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-      FormRelativeTwoDirection(maneuver.type(),
-                               dictionary_.uturn_subset.relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.uturn_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection,
+              FormRelativeTwoDirection(maneuver.type(),
+                  dictionary_.uturn_subset.relative_directions))
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kCrossStreetNames, cross_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1289,14 +1277,13 @@ std::string NarrativeBuilder::FormVerbalUturnInstruction(
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.uturn_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kCrossStreetNamesTag, cross_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.uturn_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_dir)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kCrossStreetNames, cross_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1344,14 +1331,13 @@ std::string NarrativeBuilder::FormVerbalUturnInstruction(
         element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.ramp_straight_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kBranchSign, exit_branch_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign)
+          .Set(PhraseTag::kNameSign, exit_name_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1451,14 +1437,13 @@ std::string NarrativeBuilder::FormVerbalRampStraightInstruction(
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_straight_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.ramp_straight_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kBranchSign, exit_branch_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign)
+          .Set(PhraseTag::kNameSign, exit_name_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1517,16 +1502,16 @@ std::string NarrativeBuilder::FormRampInstruction(
         element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-      FormRelativeTwoDirection(maneuver.type(),
-                               dictionary_.ramp_subset.relative_directions));
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.ramp_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection,
+              FormRelativeTwoDirection(maneuver.type(),
+                  dictionary_.ramp_subset.relative_directions))
+          .Set(PhraseTag::kBranchSign, exit_branch_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign)
+          .Set(PhraseTag::kNameSign, exit_name_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1650,14 +1635,14 @@ std::string NarrativeBuilder::FormVerbalRampInstruction(
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.ramp_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.ramp_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_dir)
+          .Set(PhraseTag::kBranchSign, exit_branch_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign)
+          .Set(PhraseTag::kNameSign, exit_name_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1717,17 +1702,17 @@ std::string NarrativeBuilder::FormExitInstruction(
         element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-      FormRelativeTwoDirection(maneuver.type(),
-                               dictionary_.exit_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.exit_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection,
+              FormRelativeTwoDirection(maneuver.type(),
+                  dictionary_.exit_subset.relative_directions))
+          .Set(PhraseTag::kNumberSign, exit_number_sign)
+          .Set(PhraseTag::kBranchSign, exit_branch_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign)
+          .Set(PhraseTag::kNameSign, exit_name_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1850,15 +1835,15 @@ std::string NarrativeBuilder::FormVerbalExitInstruction(
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kBranchSignTag, exit_branch_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
-  boost::replace_all(instruction, kNameSignTag, exit_name_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.exit_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_dir)
+          .Set(PhraseTag::kNumberSign, exit_number_sign)
+          .Set(PhraseTag::kBranchSign, exit_branch_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign)
+          .Set(PhraseTag::kNameSign, exit_name_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -1914,16 +1899,16 @@ std::string NarrativeBuilder::FormKeepInstruction(
         element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-      FormRelativeThreeDirection(maneuver.type(),
-                                 dictionary_.keep_subset.relative_directions));
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.keep_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection,
+              FormRelativeThreeDirection(maneuver.type(),
+                  dictionary_.keep_subset.relative_directions))
+          .Set(PhraseTag::kNumberSign, exit_number_sign)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2046,14 +2031,14 @@ std::string NarrativeBuilder::FormVerbalKeepInstruction(
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.keep_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_dir)
+          .Set(PhraseTag::kNumberSign, exit_number_sign)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2097,16 +2082,16 @@ std::string NarrativeBuilder::FormKeepToStayOnInstruction(
         element_max_count, limit_by_consecutive_count);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag,
-      FormRelativeThreeDirection(maneuver.type(),
-                                 dictionary_.keep_to_stay_on_subset.relative_directions));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.keep_to_stay_on_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection,
+              FormRelativeThreeDirection(maneuver.type(),
+                  dictionary_.keep_to_stay_on_subset.relative_directions))
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kNumberSign, exit_number_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2186,15 +2171,14 @@ std::string NarrativeBuilder::FormVerbalKeepToStayOnInstruction(
   std::string instruction;
   instruction.reserve(kInstructionInitialCapacity);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.keep_to_stay_on_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kRelativeDirectionTag, relative_dir);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kNumberSignTag, exit_number_sign);
-  boost::replace_all(instruction, kTowardSignTag, exit_toward_sign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.keep_to_stay_on_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kRelativeDirection, relative_dir)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kNumberSign, exit_number_sign)
+          .Set(PhraseTag::kTowardSign, exit_toward_sign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2223,11 +2207,11 @@ std::string NarrativeBuilder::FormMergeInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.merge_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2265,12 +2249,11 @@ std::string NarrativeBuilder::FormVerbalMergeInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.merge_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.merge_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2299,11 +2282,11 @@ std::string NarrativeBuilder::FormEnterRoundaboutInstruction(Maneuver& maneuver)
         maneuver.roundabout_exit_count()-1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
+  // Form instruction from the determined tagged phrase
+  dictionary_.enter_roundabout_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kOrdinalValue, ordinal_value),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2333,11 +2316,11 @@ std::string NarrativeBuilder::FormVerbalAlertEnterRoundaboutInstruction(
         maneuver.roundabout_exit_count()-1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
+  // Form instruction from the determined tagged phrase
+  dictionary_.enter_roundabout_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kOrdinalValue, ordinal_value),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2367,11 +2350,11 @@ std::string NarrativeBuilder::FormVerbalEnterRoundaboutInstruction(
         maneuver.roundabout_exit_count()-1);
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kOrdinalValueTag, ordinal_value);
+  // Form instruction from the determined tagged phrase
+  dictionary_.enter_roundabout_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kOrdinalValue, ordinal_value),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2408,12 +2391,12 @@ std::string NarrativeBuilder::FormExitRoundaboutInstruction(Maneuver& maneuver)
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.exit_roundabout_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2453,12 +2436,12 @@ std::string NarrativeBuilder::FormVerbalExitRoundaboutInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_roundabout_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.exit_roundabout_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2493,12 +2476,12 @@ std::string NarrativeBuilder::FormEnterFerryInstruction(Maneuver& maneuver) {
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.enter_ferry_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kFerryLabel, ferry_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2543,12 +2526,12 @@ std::string NarrativeBuilder::FormVerbalEnterFerryInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.enter_ferry_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kFerryLabelTag, ferry_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.enter_ferry_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kFerryLabel, ferry_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2605,13 +2588,13 @@ std::string NarrativeBuilder::FormExitFerryInstruction(Maneuver& maneuver) {
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_ferry_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.exit_ferry_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kCardinalDirection, cardinal_direction)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2689,13 +2672,13 @@ std::string NarrativeBuilder::FormVerbalExitFerryInstruction(
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.exit_ferry_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.exit_ferry_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kCardinalDirection, cardinal_direction)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2730,12 +2713,12 @@ std::string NarrativeBuilder::FormTransitConnectionStartInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_start_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_connection_start_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop)
+          .Set(PhraseTag::kStationLabel, station_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2770,12 +2753,12 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionStartInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_start_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_connection_start_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop)
+          .Set(PhraseTag::kStationLabel, station_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2810,12 +2793,12 @@ std::string NarrativeBuilder::FormTransitConnectionTransferInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_transfer_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_connection_transfer_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop)
+          .Set(PhraseTag::kStationLabel, station_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2850,12 +2833,12 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionTransferInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_connection_transfer_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop)
+          .Set(PhraseTag::kStationLabel, station_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2890,12 +2873,12 @@ std::string NarrativeBuilder::FormTransitConnectionDestinationInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_destination_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_connection_destination_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop)
+          .Set(PhraseTag::kStationLabel, station_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2930,12 +2913,12 @@ std::string NarrativeBuilder::FormVerbalTransitConnectionDestinationInstruction(
     }
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_connection_destination_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop);
-  boost::replace_all(instruction, kStationLabelTag, station_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_connection_destination_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop)
+          .Set(PhraseTag::kStationLabel, station_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2959,13 +2942,14 @@ std::string NarrativeBuilder::FormDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-      get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  // Form instruction from the determined tagged phrase
+  dictionary_.depart_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop_name)
+          .Set(PhraseTag::kTime,
+              get_localized_time(maneuver.GetTransitDepartureTime(),
+                                 dictionary_.GetLocale())),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -2988,13 +2972,14 @@ std::string NarrativeBuilder::FormVerbalDepartInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.depart_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-      get_localized_time(maneuver.GetTransitDepartureTime(), dictionary_.GetLocale()));
+  // Form instruction from the determined tagged phrase
+  dictionary_.depart_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop_name)
+          .Set(PhraseTag::kTime,
+              get_localized_time(maneuver.GetTransitDepartureTime(),
+                                 dictionary_.GetLocale())),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3017,13 +3002,14 @@ std::string NarrativeBuilder::FormArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-      get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  // Form instruction from the determined tagged phrase
+  dictionary_.arrive_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop_name)
+          .Set(PhraseTag::kTime,
+              get_localized_time(maneuver.GetTransitArrivalTime(),
+                                 dictionary_.GetLocale())),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3046,13 +3032,14 @@ std::string NarrativeBuilder::FormVerbalArriveInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.arrive_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformTag, transit_stop_name);
-  boost::replace_all(instruction, kTimeTag,
-      get_localized_time(maneuver.GetTransitArrivalTime(), dictionary_.GetLocale()));
+  // Form instruction from the determined tagged phrase
+  dictionary_.arrive_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatform, transit_stop_name)
+          .Set(PhraseTag::kTime,
+              get_localized_time(maneuver.GetTransitArrivalTime(),
+                                 dictionary_.GetLocale())),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3079,18 +3066,16 @@ std::string NarrativeBuilder::FormTransitInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(
-      instruction,
-      kTransitNameTag,
-      FormTransitName(maneuver,
-                      dictionary_.transit_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag, std::to_string(stop_count)); //TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitName,
+              FormTransitName(maneuver,
+                  dictionary_.transit_subset.empty_transit_name_labels))
+          .Set(PhraseTag::kTransitHeadSign, transit_headsign)
+          .Set(PhraseTag::kTransitPlatformCount, std::to_string(stop_count)) //TODO: locale specific numerals
+          .Set(PhraseTag::kTransitPlatformCountLabel, stop_count_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3113,16 +3098,14 @@ std::string NarrativeBuilder::FormVerbalTransitInstruction(Maneuver& maneuver) {
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(
-      instruction,
-      kTransitNameTag,
-      FormTransitName(maneuver,
-                      dictionary_.transit_verbal_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitName,
+              FormTransitName(maneuver,
+                  dictionary_.transit_verbal_subset.empty_transit_name_labels))
+          .Set(PhraseTag::kTransitHeadSign, transit_headsign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3149,19 +3132,17 @@ std::string NarrativeBuilder::FormTransitRemainOnInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(
-      instruction,
-      kTransitNameTag,
-      FormTransitName(
-          maneuver,
-          dictionary_.transit_remain_on_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag, std::to_string(stop_count)); //TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_remain_on_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitName,
+              FormTransitName(
+                  maneuver,
+                  dictionary_.transit_remain_on_subset.empty_transit_name_labels))
+          .Set(PhraseTag::kTransitHeadSign, transit_headsign)
+          .Set(PhraseTag::kTransitPlatformCount, std::to_string(stop_count)) //TODO: locale specific numerals
+          .Set(PhraseTag::kTransitPlatformCountLabel, stop_count_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3186,17 +3167,15 @@ std::string NarrativeBuilder::FormVerbalTransitRemainOnInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_remain_on_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(
-      instruction,
-      kTransitNameTag,
-      FormTransitName(
-          maneuver,
-          dictionary_.transit_remain_on_verbal_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_remain_on_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitName,
+              FormTransitName(
+                  maneuver,
+                  dictionary_.transit_remain_on_verbal_subset.empty_transit_name_labels))
+          .Set(PhraseTag::kTransitHeadSign, transit_headsign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3223,19 +3202,17 @@ std::string NarrativeBuilder::FormTransitTransferInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(
-      instruction,
-      kTransitNameTag,
-      FormTransitName(
-          maneuver,
-          dictionary_.transit_transfer_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
-  boost::replace_all(instruction, kTransitPlatformCountTag, std::to_string(stop_count)); //TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_transfer_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitName,
+              FormTransitName(
+                  maneuver,
+                  dictionary_.transit_transfer_subset.empty_transit_name_labels))
+          .Set(PhraseTag::kTransitHeadSign, transit_headsign)
+          .Set(PhraseTag::kTransitPlatformCount, std::to_string(stop_count)) //TODO: locale specific numerals
+          .Set(PhraseTag::kTransitPlatformCountLabel, stop_count_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3260,17 +3237,15 @@ std::string NarrativeBuilder::FormVerbalTransitTransferInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.transit_transfer_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(
-      instruction,
-      kTransitNameTag,
-      FormTransitName(
-          maneuver,
-          dictionary_.transit_transfer_verbal_subset.empty_transit_name_labels));
-  boost::replace_all(instruction, kTransitHeadSignTag, transit_headsign);
+  // Form instruction from the determined tagged phrase
+  dictionary_.transit_transfer_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitName,
+              FormTransitName(
+                  maneuver,
+                  dictionary_.transit_transfer_verbal_subset.empty_transit_name_labels))
+          .Set(PhraseTag::kTransitHeadSign, transit_headsign),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3328,14 +3303,13 @@ std::string NarrativeBuilder::FormPostTransitConnectionDestinationInstruction(
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transit_connection_destination_subset.
-      phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.post_transit_connection_destination_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kCardinalDirection, cardinal_direction)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3395,13 +3369,13 @@ std::string NarrativeBuilder::FormVerbalPostTransitConnectionDestinationInstruct
     phrase_id += 16;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transit_connection_destination_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCardinalDirectionTag, cardinal_direction);
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
-  boost::replace_all(instruction, kBeginStreetNamesTag, begin_street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.post_transit_connection_destination_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kCardinalDirection, cardinal_direction)
+          .Set(PhraseTag::kStreetNames, street_names)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3432,16 +3406,15 @@ std::string NarrativeBuilder::FormVerbalPostTransitionInstruction(
     phrase_id = 1;
   }
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transition_verbal_subset.phrases.at(
-      std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kLengthTag,
-      FormLength(
-          maneuver, dictionary_.post_transition_verbal_subset.metric_lengths,
-          dictionary_.post_transition_verbal_subset.us_customary_lengths));
-  boost::replace_all(instruction, kStreetNamesTag, street_names);
+  // Form instruction from the determined tagged phrase
+  dictionary_.post_transition_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kLength,
+              FormLength(
+                  maneuver, dictionary_.post_transition_verbal_subset.metric_lengths,
+                  dictionary_.post_transition_verbal_subset.us_customary_lengths))
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3464,12 +3437,12 @@ std::string NarrativeBuilder::FormVerbalPostTransitionTransitInstruction(
       dictionary_.post_transition_transit_verbal_subset
           .transit_stop_count_labels);
 
-  // Set instruction to the determined tagged phrase
-  instruction = dictionary_.post_transition_transit_verbal_subset.phrases.at(std::to_string(phrase_id));
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kTransitPlatformCountTag, std::to_string(stop_count)); //TODO: locale specific numerals
-  boost::replace_all(instruction, kTransitPlatformCountLabelTag, stop_count_label);
+  // Form instruction from the determined tagged phrase
+  dictionary_.post_transition_transit_verbal_subset.templates.at(std::to_string(phrase_id)).Render(
+      PhraseValues()
+          .Set(PhraseTag::kTransitPlatformCount, std::to_string(stop_count)) //TODO: locale specific numerals
+          .Set(PhraseTag::kTransitPlatformCountLabel, stop_count_label),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
@@ -3794,12 +3767,12 @@ std::string NarrativeBuilder::FormVerbalMultiCue(Maneuver* maneuver,
           next_maneuver.verbal_pre_transition_instruction();
 
 
-  // Set instruction to the verbal multi-cue
-  instruction = dictionary_.verbal_multi_cue_subset.phrases.at("0");
-
-  // Replace phrase tags with values
-  boost::replace_all(instruction, kCurrentVerbalCueTag, current_verbal_cue);
-  boost::replace_all(instruction, kNextVerbalCueTag, next_verbal_cue);
+  // Form instruction from the verbal multi-cue
+  dictionary_.verbal_multi_cue_subset.templates.at("0").Render(
+      PhraseValues()
+          .Set(PhraseTag::kCurrentVerbalCue, current_verbal_cue)
+          .Set(PhraseTag::kNextVerbalCue, next_verbal_cue),
+      instruction);
 
   // If enabled, form articulated prepositions
   if (articulated_preposition_enabled_) {
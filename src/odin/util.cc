@@ -5,40 +5,42 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/date_time/local_time/local_time.hpp>
 
+#include <memory>
+#include <mutex>
+#include <tuple>
+
 #include "midgard/logging.h"
 #include "odin/util.h"
 #include "locales.h"
 
 namespace {
 
-  valhalla::odin::locales_singleton_t load_narrative_locals() {
-    valhalla::odin::locales_singleton_t locales;
-    //for each locale
-    for(const auto& json : locales_json) {
-      LOG_TRACE("LOCALES");
-      LOG_TRACE("-------");
-      LOG_TRACE("- " + json.first);
-      //load the json
-      boost::property_tree::ptree narrative_pt;
-      std::stringstream ss; ss << json.second;
-      boost::property_tree::read_json(ss, narrative_pt);
-      LOG_TRACE("JSON read");
-      //parse it into an object and add it to the map
-      auto narrative_dictionary = std::make_shared<valhalla::odin::NarrativeDictionary>(json.first, narrative_pt);
-      LOG_TRACE("NarrativeDictionary created");
-      locales.insert(std::make_pair(json.first, narrative_dictionary));
-      //insert all the aliases as this same object
-      auto aliases = narrative_pt.get_child("aliases");
-      for(const auto& alias : aliases) {
-        auto name = alias.second.get_value<std::string>();
-        auto inserted = locales.insert(std::make_pair(name, narrative_dictionary));
-        if(!inserted.second) {
-          throw std::logic_error("Alias '" + name + "' in json locale '" + json.first +
-            "' has duplicate with posix_locale '" + inserted.first->second->GetLocale().name());
-        }
-      }
-    }
-    return locales;
+  //the dictionary of a locale, parsed the first time the locale is used
+  struct locale_entry_t {
+    std::once_flag parsed;
+    std::shared_ptr<valhalla::odin::NarrativeDictionary> dictionary;
+  };
+
+  std::unordered_map<std::string, locale_entry_t> make_locale_entries() {
+    std::unordered_map<std::string, locale_entry_t> entries;
+    for(const auto& json : locales_json)
+      entries.emplace(std::piecewise_construct, std::forward_as_tuple(json.first), std::forward_as_tuple());
+    return entries;
+  }
+
+  std::shared_ptr<valhalla::odin::NarrativeDictionary> load_narrative_locale(const std::string& key) {
+    LOG_TRACE("LOCALES");
+    LOG_TRACE("-------");
+    LOG_TRACE("- " + key);
+    //load the json
+    boost::property_tree::ptree narrative_pt;
+    std::stringstream ss; ss << locales_json.at(key);
+    boost::property_tree::read_json(ss, narrative_pt);
+    LOG_TRACE("JSON read");
+    //parse it into an object
+    auto narrative_dictionary = std::make_shared<valhalla::odin::NarrativeDictionary>(key, narrative_pt);
+    LOG_TRACE("NarrativeDictionary created");
+    return narrative_dictionary;
   }
 
 }
@@ -167,9 +169,31 @@ std::string get_localized_date(const std::string& date_time,
   return date;
 }
 
+bool is_supported_locale(const std::string& locale) {
+  return locales_tags.find(locale) != locales_tags.cend();
+}
+
+std::shared_ptr<NarrativeDictionary> get_locale(const std::string& locale) {
+  auto tag = locales_tags.find(locale);
+  if(tag == locales_tags.cend())
+    return nullptr;
+  //thread safe static initializer, the entries never change after
+  static std::unordered_map<std::string, locale_entry_t> entries(make_locale_entries());
+  auto& entry = entries.at(tag->second);
+  std::call_once(entry.parsed, [&entry, &tag]() {
+    entry.dictionary = load_narrative_locale(tag->second);
+  });
+  return entry.dictionary;
+}
+
 const locales_singleton_t& get_locales() {
-  //thread safe static initializer for singleton
-  static locales_singleton_t locales(load_narrative_locals());
+  //thread safe static initializer for singleton, aliases share the object
+  static locales_singleton_t locales([]() {
+    locales_singleton_t locales;
+    for(const auto& tag : locales_tags)
+      locales.emplace(tag.first, get_locale(tag.first));
+    return locales;
+  }());
   return locales;
 }
 
@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <functional>
 #include <string>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
@@ -26,23 +30,52 @@ using namespace valhalla::baldr;
 namespace valhalla {
   namespace odin {
 
-    odin_worker_t::odin_worker_t(const boost::property_tree::ptree& config){}
+    odin_worker_t::odin_worker_t(const boost::property_tree::ptree& config):
+      narrate_threads(config.get<uint32_t>("odin.narrate_threads", 0)) {
+      if (narrate_threads == 0)
+        narrate_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
 
     odin_worker_t::~odin_worker_t(){}
 
     void odin_worker_t::cleanup(){}
 
     std::list<TripDirections> odin_worker_t::narrate(const valhalla_request_t& request, std::list<TripPath>& legs) const {
-      //get some annotated directions
-      std::list<TripDirections> narrated;
-      try{
-        for(auto& leg : legs) {
-          narrated.emplace_back(odin::DirectionsBuilder().Build(request.options, leg));
-          LOG_INFO("maneuver_count::" + std::to_string(narrated.back().maneuver_size()));
+      //the legs dont depend on each other so the threads take the next one
+      //left and the longest leg decides how long it takes
+      std::vector<TripPath*> paths;
+      for(auto& leg : legs)
+        paths.push_back(&leg);
+      std::vector<TripDirections> directions(paths.size());
+      std::vector<std::exception_ptr> errors(paths.size());
+      std::atomic<size_t> next_leg(0);
+      auto narrate_legs = [&request, &paths, &directions, &errors, &next_leg]() {
+        for(size_t i = next_leg++; i < paths.size(); i = next_leg++) {
+          try {
+            auto built = odin::DirectionsBuilder().Build(request.options, *paths[i]);
+            directions[i].Swap(&built);
+          }
+          catch(...) {
+            errors[i] = std::current_exception();
+          }
         }
-      }
-      catch(...) {
-        throw valhalla_exception_t{202};
+      };
+      std::vector<std::thread> threads;
+      auto extra_threads = std::min<size_t>(narrate_threads, paths.size()) - (paths.empty() ? 0 : 1);
+      for(size_t i = 0; i < extra_threads; ++i)
+        threads.emplace_back(narrate_legs);
+      narrate_legs();
+      for(auto& thread : threads)
+        thread.join();
+
+      //get some annotated directions, in the order of the legs
+      std::list<TripDirections> narrated;
+      for(size_t i = 0; i < directions.size(); ++i) {
+        if(errors[i])
+          throw valhalla_exception_t{202};
+        narrated.emplace_back();
+        narrated.back().Swap(&directions[i]);
+        LOG_INFO("maneuver_count::" + std::to_string(narrated.back().maneuver_size()));
       }
       return narrated;
     }
@@ -57,9 +90,10 @@ namespace valhalla {
         std::string request_str(static_cast<const char*>(job.front().data()), job.front().size());
         std::string serialized_options(static_cast<const char*>((++job.cbegin())->data()), (++job.cbegin())->size());
         request.parse(request_str, serialized_options);
+        stage_trace_t span("odin", request.options);
 
         // Set the interrupt function
-        service_worker_t::set_interrupt(interrupt_function);
+        service_worker_t::set_interrupt(interrupt_function, request.options.deadline());
 
         //parse each leg
         std::list<TripPath> legs;
@@ -77,7 +111,8 @@ namespace valhalla {
         //narrate them and serialize them along
         auto narrated = narrate(request, legs);
         auto response = tyr::serializeDirections(request, legs, narrated);
-        auto* to_response = request.options.format() == DirectionsOptions::gpx ? to_response_xml : to_response_json;
+        auto* to_response = request.options.format() == DirectionsOptions::gpx ? to_response_xml :
+                            (request.options.format() == DirectionsOptions::pbf ? to_response_pbf : to_response_json);
         return to_response(response, info, request);
       }
       catch(const std::exception& e) {
@@ -92,6 +127,9 @@ namespace valhalla {
       auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
       auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
 
+      //compress what this stage sends back to the clients that take it
+      configure_compression(config.get_child("httpd.service"));
+
       //listen for requests
       zmq::context_t context;
       prime_server::worker_t worker(context, upstream_endpoint, "ipc:///dev/null", loopback_endpoint, interrupt_endpoint,
@@ -1,5 +1,6 @@
 #include "sif/autocost.h"
 #include "sif/costconstants.h"
+#include "sif/turncosts.h"
 
 #include <iostream>
 #include "midgard/constants.h"
@@ -11,7 +12,7 @@
 #ifdef INLINE_TEST
 #include "test/test.h"
 #include <random>
-#include <boost/property_tree/json_parser.hpp>
+#include <sstream>
 #endif
 
 using namespace valhalla::baldr;
@@ -63,6 +64,9 @@ constexpr float kLeftSideTurnCosts[]  = { kTCStraight, kTCSlight,
       kTCUnfavorable, kTCUnfavorableSharp, kTCReverse, kTCFavorableSharp,
       kTCFavorable, kTCSlight };
 
+// Turn costs by turn class
+const TurnCosts kTurnCosts(kRightSideTurnCosts, kLeftSideTurnCosts, kTCCrossing);
+
 // Maximum amount of seconds that will be allowed to be passed in to influence paths
 // This can't be too high because sometimes a certain kind of path is required to be taken
 constexpr float kMaxSeconds = 12.0f * kSecPerHour; // 12 hours
@@ -94,197 +98,22 @@ constexpr float kRoadClassFactor[] = {
     0.5f    // Service, other
 };
 
-}
-
-/**
- * Derived class providing dynamic edge costing for "direct" auto routes. This
- * is a route that is generally shortest time but uses route hierarchies that
- * can result in slightly longer routes that avoid shortcuts on residential
- * roads.
- */
-class AutoCost : public DynamicCost {
- public:
-  /**
-   * Construct auto costing. Pass in configuration using property tree.
-   * @param  config  Property tree with configuration/options.
-   */
-  AutoCost(const boost::property_tree::ptree& config);
-
-  virtual ~AutoCost();
-
-  /**
-   * Does the costing method allow multiple passes (with relaxed hierarchy
-   * limits).
-   * @return  Returns true if the costing model allows multiple passes.
-   */
-  virtual bool AllowMultiPass() const;
-
-  /**
-   * Get the access mode used by this costing method.
-   * @return  Returns access mode.
-   */
-  uint32_t access_mode() const;
-
-  /**
-   * Checks if access is allowed for the provided directed edge.
-   * This is generally based on mode of travel and the access modes
-   * allowed on the edge. However, it can be extended to exclude access
-   * based on other parameters.
-   * @param  edge     Pointer to a directed edge.
-   * @param  pred     Predecessor edge information.
-   * @param  tile     current tile
-   * @param  edgeid   edgeid that we care about
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::DirectedEdge* edge,
-                       const EdgeLabel& pred,
-                       const baldr::GraphTile*& tile,
-                       const baldr::GraphId& edgeid) const;
-
-  /**
-   * Checks if access is allowed for an edge on the reverse path
-   * (from destination towards origin). Both opposing edges are
-   * provided.
-   * @param  edge           Pointer to a directed edge.
-   * @param  pred           Predecessor edge information.
-   * @param  opp_edge       Pointer to the opposing directed edge.
-   * @param  tile           Tile for the opposing edge (for looking
-   *                        up restrictions).
-   * @param  opp_edgeid     Opposing edge Id
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool AllowedReverse(const baldr::DirectedEdge* edge,
-                 const EdgeLabel& pred,
-                 const baldr::DirectedEdge* opp_edge,
-                 const baldr::GraphTile*& tile,
-                 const baldr::GraphId& opp_edgeid) const;
-
-  /**
-   * Checks if access is allowed for the provided node. Node access can
-   * be restricted if bollards or gates are present.
-   * @param  edge  Pointer to node information.
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::NodeInfo* node) const;
-
-  /**
-   * Get the cost to traverse the specified directed edge. Cost includes
-   * the time (seconds) to traverse the edge.
-   * @param   edge  Pointer to a directed edge.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge.
-   * Defaults to 0. Costing models that wish to include edge transition
-   * costs (i.e., intersection/turn costs) must override this method.
-   * @param  edge  Directed edge (the to edge)
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  Predecessor edge information.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
-                              const baldr::NodeInfo* node,
-                              const EdgeLabel& pred) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge
-   * when using a reverse search (from destination towards the origin).
-   * @param  idx   Directed edge local index
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  the opposing current edge in the reverse tree.
-   * @param  edge  the opposing predecessor in the reverse tree
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCostReverse(
-      const uint32_t idx, const baldr::NodeInfo* node,
-      const baldr::DirectedEdge* pred,
-      const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Get the cost factor for A* heuristics. This factor is multiplied
-   * with the distance to the destination to produce an estimate of the
-   * minimum cost to the destination. The A* heuristic must underestimate the
-   * cost to the destination. So a time based estimate based on speed should
-   * assume the maximum speed is used to the destination such that the time
-   * estimate is less than the least possible time along roads.
-   */
-  virtual float AStarCostFactor() const;
-
-  /**
-   * Get the current travel type.
-   * @return  Returns the current travel type.
-   */
-  virtual uint8_t travel_type() const;
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude and allow ranking results from the search by looking at each
-   * edges attribution and suitability for use as a location by the travel
-   * mode used by the costing method. Function/functor is also used to filter
-   * edges not usable / inaccessible by automobile.
-   */
-  virtual const EdgeFilter GetEdgeFilter() const {
-    // Throw back a lambda that checks the access for this type of costing
-    return [](const baldr::DirectedEdge* edge) {
-      if (edge->IsTransition() || edge->is_shortcut() ||
-         !(edge->forwardaccess() & kAutoAccess))
-        return 0.0f;
-      else {
-        // TODO - use classification/use to alter the factor
-        return 1.0f;
-      }
-    };
-  }
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude results from the search by looking at each node's attribution
-   * @return Function/functor to be used in filtering out nodes
-   */
-  virtual const NodeFilter GetNodeFilter() const {
-    //throw back a lambda that checks the access for this type of costing
-    return [](const baldr::NodeInfo* node){
-      return !(node->access() & kAutoAccess);
-    };
-  }
-
-  // Hidden in source file so we don't need it to be protected
-  // We expose it within the source file for testing purposes
- public:
-  VehicleType type_;                // Vehicle type: car (default), motorcycle, etc
-  float speedfactor_[kMaxSpeedKph + 1];
-  float density_factor_[16];        // Density factor
-  float maneuver_penalty_;          // Penalty (seconds) when inconsistent names
-  float destination_only_penalty_;  // Penalty (seconds) using a driveway or parking aisle
-  float gate_cost_;                 // Cost (seconds) to go through gate
-  float gate_penalty_;              // Penalty (seconds) to go through gate
-  float tollbooth_cost_;            // Cost (seconds) to go through toll booth
-  float tollbooth_penalty_;         // Penalty (seconds) to go through a toll booth
-  float ferry_cost_;                // Cost (seconds) to enter a ferry
-  float ferry_penalty_;             // Penalty (seconds) to enter a ferry
-  float ferry_factor_;              // Weighting to apply to ferry edges
-  float alley_penalty_;             // Penalty (seconds) to use a alley
-  float country_crossing_cost_;     // Cost (seconds) to go across a country border
-  float country_crossing_penalty_;  // Penalty (seconds) to go across a country border
-  float use_ferry_;
-
-  // Density factor used in edge transition costing
-  std::vector<float> trans_density_factor_;
+// Density factor used in edge transition costing
+constexpr float kTransDensityFactor[] = {
+    1.0f, 1.0f, 1.0f, 1.0f,
+    1.0f, 1.1f, 1.2f, 1.3f,
+    1.4f, 1.6f, 1.9f, 2.2f,
+    2.5f, 2.8f, 3.1f, 3.5f
 };
 
+}
 
 // Constructor
-AutoCost::AutoCost(const boost::property_tree::ptree& pt)
-    : DynamicCost(pt, TravelMode::kDrive),
-      trans_density_factor_{ 1.0f, 1.0f, 1.0f, 1.0f,
-                             1.0f, 1.1f, 1.2f, 1.3f,
-                             1.4f, 1.6f, 1.9f, 2.2f,
-                             2.5f, 2.8f, 3.1f, 3.5f } {
+AutoCost::AutoCost(const rapidjson::Value& config)
+    : DynamicCost(config, TravelMode::kDrive) {
 
   // Get the vehicle type - enter as string and convert to enum
-  std::string type = pt.get<std::string>("type", "car");
+  std::string type = rapidjson::get<std::string>(config, "/type", "car");
   if (type == "motorcycle") {
     type_ = VehicleType::kMotorcycle;
   } else if (type == "bus") {
@@ -296,43 +125,43 @@ AutoCost::AutoCost(const boost::property_tree::ptree& pt)
   }
 
   maneuver_penalty_ = kManeuverPenaltyRange(
-    pt.get<float>("maneuver_penalty", kDefaultManeuverPenalty)
+    rapidjson::get<float>(config, "/maneuver_penalty", kDefaultManeuverPenalty)
   );
   destination_only_penalty_ = kDestinationOnlyPenaltyRange(
-    pt.get<float>("destination_only_penalty", kDefaultDestinationOnlyPenalty)
+    rapidjson::get<float>(config, "/destination_only_penalty", kDefaultDestinationOnlyPenalty)
   );
   gate_cost_ = kGateCostRange(
-    pt.get<float>("gate_cost", kDefaultGateCost)
+    rapidjson::get<float>(config, "/gate_cost", kDefaultGateCost)
   );
   gate_penalty_ = kGatePenaltyRange(
-    pt.get<float>("gate_penalty", kDefaultGatePenalty)
+    rapidjson::get<float>(config, "/gate_penalty", kDefaultGatePenalty)
   );
   tollbooth_cost_ = kTollBoothCostRange(
-    pt.get<float>("toll_booth_cost", kDefaultTollBoothCost)
+    rapidjson::get<float>(config, "/toll_booth_cost", kDefaultTollBoothCost)
   );
   tollbooth_penalty_ = kTollBoothPenaltyRange(
-    pt.get<float>("toll_booth_penalty", kDefaultTollBoothPenalty)
+    rapidjson::get<float>(config, "/toll_booth_penalty", kDefaultTollBoothPenalty)
   );
   alley_penalty_ = kAlleyPenaltyRange(
-    pt.get<float>("alley_penalty", kDefaultAlleyPenalty)
+    rapidjson::get<float>(config, "/alley_penalty", kDefaultAlleyPenalty)
   );
   country_crossing_cost_ = kCountryCrossingCostRange(
-    pt.get<float>("country_crossing_cost", kDefaultCountryCrossingCost)
+    rapidjson::get<float>(config, "/country_crossing_cost", kDefaultCountryCrossingCost)
   );
   country_crossing_penalty_ = kCountryCrossingPenaltyRange(
-    pt.get<float>("country_crossing_penalty", kDefaultCountryCrossingPenalty)
+    rapidjson::get<float>(config, "/country_crossing_penalty", kDefaultCountryCrossingPenalty)
   );
 
   // Set the cost (seconds) to enter a ferry (only apply entering since
   // a route must exit a ferry (except artificial test routes ending on
   // a ferry!)
   ferry_cost_ = kFerryCostRange(
-    pt.get<float>("ferry_cost", kDefaultFerryCost)
+    rapidjson::get<float>(config, "/ferry_cost", kDefaultFerryCost)
   );
 
   // Modify ferry penalty and edge weighting based on use_ferry factor
   use_ferry_ = kUseFerryRange(
-    pt.get<float>("use_ferry", kDefaultUseFerry)
+    rapidjson::get<float>(config, "/use_ferry", kDefaultUseFerry)
   );
   if (use_ferry_ < 0.5f) {
     // Penalty goes from max at use_ferry_ = 0 to 0 at use_ferry_ = 0.5
@@ -364,6 +193,11 @@ AutoCost::AutoCost(const boost::property_tree::ptree& pt)
 AutoCost::~AutoCost() {
 }
 
+// Copies this costing
+cost_ptr_t AutoCost::Clone() const {
+  return std::make_shared<AutoCost>(*this);
+}
+
 // Does the costing method allow multiple passes (with relaxed hierarchy
 // limits).
 bool AutoCost::AllowMultiPass() const {
@@ -375,64 +209,6 @@ uint32_t AutoCost::access_mode() const {
   return kAutoAccess;
 }
 
-// Check if access is allowed on the specified edge.
-bool AutoCost::Allowed(const baldr::DirectedEdge* edge,
-                       const EdgeLabel& pred,
-                       const baldr::GraphTile*& tile,
-                       const baldr::GraphId& edgeid) const {
-  // TODO - obtain and check the access restrictions.
-
-  // Check access, U-turn, and simple turn restriction.
-  // Allow U-turns at dead-end nodes in case the origin is inside
-  // a not thru region and a heading selected an edge entering the
-  // region.
-  if (!(edge->forwardaccess() & kAutoAccess) ||
-      (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
-      (pred.restrictions() & (1 << edge->localedgeidx())) ||
-       edge->surface() == Surface::kImpassable ||
-       IsUserAvoidEdge(edgeid) ||
-      (!allow_destination_only_ && !pred.destonly() && edge->destonly())) {
-    return false;
-  }
-  return true;
-}
-
-// Checks if access is allowed for an edge on the reverse path (from
-// destination towards origin). Both opposing edges are provided.
-bool AutoCost::AllowedReverse(const baldr::DirectedEdge* edge,
-               const EdgeLabel& pred,
-               const baldr::DirectedEdge* opp_edge,
-               const baldr::GraphTile*& tile,
-               const baldr::GraphId& opp_edgeid) const {
-  // TODO - obtain and check the access restrictions.
-
-  // Check access, U-turn, and simple turn restriction.
-  // Allow U-turns at dead-end nodes.
-  if (!(opp_edge->forwardaccess() & kAutoAccess) ||
-       (!pred.deadend() && pred.opp_local_idx() == edge->localedgeidx()) ||
-       (opp_edge->restrictions() & (1 << pred.opp_local_idx())) ||
-        opp_edge->surface() == Surface::kImpassable ||
-        IsUserAvoidEdge(opp_edgeid) ||
-       (!allow_destination_only_ && !pred.destonly() && opp_edge->destonly())) {
-    return false;
-  }
-  return true;
-}
-
-// Check if access is allowed at the specified node.
-bool AutoCost::Allowed(const baldr::NodeInfo* node) const  {
-  return (node->access() & kAutoAccess);
-}
-
-// Get the cost to traverse the edge in seconds
-Cost AutoCost::EdgeCost(const DirectedEdge* edge) const {
-  float factor = (edge->use() == Use::kFerry) ?
-        ferry_factor_ : density_factor_[edge->density()];
-
-  float sec = (edge->length() * speedfactor_[edge->speed()]);
-  return Cost(sec * factor, sec);
-}
-
 // Returns the time (in seconds) to make the transition from the predecessor
 Cost AutoCost::TransitionCost(const baldr::DirectedEdge* edge,
                               const baldr::NodeInfo* node,
@@ -475,18 +251,8 @@ Cost AutoCost::TransitionCost(const baldr::DirectedEdge* edge,
   }
 
   // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (edge->drive_on_right()) ?
-          kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-          kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
-  }
+  seconds += kTransDensityFactor[node->density()] * edge->stopimpact(idx) *
+             kTurnCosts[edge->turn_class(idx)];
 
   // Return cost (time and penalty)
   return { seconds + penalty, seconds };
@@ -537,18 +303,8 @@ Cost AutoCost::TransitionCostReverse(const uint32_t idx,
   }
 
   // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (edge->drive_on_right()) ?
-          kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-          kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
-  }
+  seconds += kTransDensityFactor[node->density()] * edge->stopimpact(idx) *
+             kTurnCosts[edge->turn_class(idx)];
 
   // Return cost (time and penalty)
   return { seconds + penalty, seconds };
@@ -569,7 +325,7 @@ uint8_t AutoCost::travel_type() const {
   return static_cast<uint8_t>(type_);
 }
 
-cost_ptr_t CreateAutoCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateAutoCost(const rapidjson::Value& config) {
   return std::make_shared<AutoCost>(config);
 }
 
@@ -581,13 +337,19 @@ class AutoShorterCost : public AutoCost {
  public:
   /**
    * Construct auto costing for shorter (not absolute shortest) path.
-   * Pass in configuration using property tree.
-   * @param  config  Property tree with configuration/options.
+   * Pass in configuration using a json object.
+   * @param  config  Json object with configuration/options.
    */
-  AutoShorterCost(const boost::property_tree::ptree& config);
+  AutoShorterCost(const rapidjson::Value& config);
 
   virtual ~AutoShorterCost();
 
+  /**
+   * Copies this costing, options and all.
+   * @return  Returns the copy.
+   */
+  virtual cost_ptr_t Clone() const;
+
   /**
    * Returns the cost to traverse the edge and an estimate of the actual time
    * (in seconds) to traverse the edge.
@@ -596,6 +358,18 @@ class AutoShorterCost : public AutoCost {
    */
   virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const;
 
+  /**
+   * Get the costs to traverse a run of directed edges. Uses EdgeCost of
+   * each edge rather than the loop of auto costing.
+   * @param   edges  Pointer to the first directed edge.
+   * @param   count  Number of directed edges.
+   * @param   costs  Returns the cost and time (seconds) of each edge.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t count, Cost* costs) const {
+    DynamicCost::EdgeCosts(edges, count, costs);
+  }
+
   /**
    * Get the cost factor for A* heuristics. This factor is multiplied
    * with the distance to the destination to produce an estimate of the
@@ -612,8 +386,8 @@ class AutoShorterCost : public AutoCost {
 
 
 // Constructor
-AutoShorterCost::AutoShorterCost(const boost::property_tree::ptree& pt)
-    : AutoCost(pt) {
+AutoShorterCost::AutoShorterCost(const rapidjson::Value& config)
+    : AutoCost(config) {
   // Create speed cost table that reduces the impact of speed
   adjspeedfactor_[0] = kSecPerHour;  // TODO - what to make speed=0?
   for (uint32_t s = 1; s <= kMaxSpeedKph; s++) {
@@ -625,6 +399,11 @@ AutoShorterCost::AutoShorterCost(const boost::property_tree::ptree& pt)
 AutoShorterCost::~AutoShorterCost() {
 }
 
+// Copies this costing
+cost_ptr_t AutoShorterCost::Clone() const {
+  return std::make_shared<AutoShorterCost>(*this);
+}
+
 // Returns the cost to traverse the edge and an estimate of the actual time
 // (in seconds) to traverse the edge.
 Cost AutoShorterCost::EdgeCost(const baldr::DirectedEdge* edge) const {
@@ -637,7 +416,7 @@ float AutoShorterCost::AStarCostFactor() const {
   return adjspeedfactor_[kMaxSpeedKph];
 }
 
-cost_ptr_t CreateAutoShorterCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateAutoShorterCost(const rapidjson::Value& config) {
   return std::make_shared<AutoShorterCost>(config);
 }
 
@@ -648,13 +427,19 @@ class BusCost : public AutoCost {
  public:
   /**
    * Construct bus costing.
-   * Pass in configuration using property tree.
-   * @param  config  Property tree with configuration/options.
+   * Pass in configuration using a json object.
+   * @param  config  Json object with configuration/options.
    */
-  BusCost(const boost::property_tree::ptree& config);
+  BusCost(const rapidjson::Value& config);
 
   virtual ~BusCost();
 
+  /**
+   * Copies this costing, options and all.
+   * @return  Returns the copy.
+   */
+  virtual cost_ptr_t Clone() const;
+
   /**
    * Get the access mode used by this costing method.
    * @return  Returns access mode.
@@ -738,8 +523,8 @@ class BusCost : public AutoCost {
 
 
 // Constructor
-BusCost::BusCost(const boost::property_tree::ptree& pt)
-    : AutoCost(pt) {
+BusCost::BusCost(const rapidjson::Value& config)
+    : AutoCost(config) {
   type_ = VehicleType::kBus;
 }
 
@@ -747,6 +532,11 @@ BusCost::BusCost(const boost::property_tree::ptree& pt)
 BusCost::~BusCost() {
 }
 
+// Copies this costing
+cost_ptr_t BusCost::Clone() const {
+  return std::make_shared<BusCost>(*this);
+}
+
 // Get the access mode used by this costing method.
 uint32_t BusCost::access_mode() const {
   return kBusAccess;
@@ -799,7 +589,7 @@ bool BusCost::Allowed(const baldr::NodeInfo* node) const  {
   return (node->access() & kBusAccess);
 }
 
-cost_ptr_t CreateBusCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateBusCost(const rapidjson::Value& config) {
   return std::make_shared<BusCost>(config);
 }
 
@@ -811,13 +601,19 @@ class HOVCost : public AutoCost {
  public:
   /**
    * Construct hov costing.
-   * Pass in configuration using property tree.
-   * @param  config  Property tree with configuration/options.
+   * Pass in configuration using a json object.
+   * @param  config  Json object with configuration/options.
    */
-  HOVCost(const boost::property_tree::ptree& config);
+  HOVCost(const rapidjson::Value& config);
 
   virtual ~HOVCost();
 
+  /**
+   * Copies this costing, options and all.
+   * @return  Returns the copy.
+   */
+  virtual cost_ptr_t Clone() const;
+
   /**
    * Get the access mode used by this costing method.
    * @return  Returns access mode.
@@ -866,6 +662,18 @@ class HOVCost : public AutoCost {
    */
   virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const;
 
+  /**
+   * Get the costs to traverse a run of directed edges. Uses EdgeCost of
+   * each edge rather than the loop of auto costing.
+   * @param   edges  Pointer to the first directed edge.
+   * @param   count  Number of directed edges.
+   * @param   costs  Returns the cost and time (seconds) of each edge.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t count, Cost* costs) const {
+    DynamicCost::EdgeCosts(edges, count, costs);
+  }
+
   /**
    * Checks if access is allowed for the provided node. Node access can
    * be restricted if bollards or gates are present.
@@ -908,14 +716,19 @@ class HOVCost : public AutoCost {
 };
 
 // Constructor
-HOVCost::HOVCost(const boost::property_tree::ptree& pt)
-    : AutoCost(pt) {
+HOVCost::HOVCost(const rapidjson::Value& config)
+    : AutoCost(config) {
 }
 
 // Destructor
 HOVCost::~HOVCost() {
 }
 
+// Copies this costing
+cost_ptr_t HOVCost::Clone() const {
+  return std::make_shared<HOVCost>(*this);
+}
+
 // Get the access mode used by this costing method.
 uint32_t HOVCost::access_mode() const {
   return kHOVAccess;
@@ -985,7 +798,7 @@ bool HOVCost::Allowed(const baldr::NodeInfo* node) const  {
   return (node->access() & kHOVAccess);
 }
 
-cost_ptr_t CreateHOVCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateHOVCost(const rapidjson::Value& config) {
   return std::make_shared<HOVCost>(config);
 }
 
@@ -1004,9 +817,9 @@ namespace {
 AutoCost* make_autocost_from_json(const std::string& property, float testVal) {
   std::stringstream ss;
   ss << R"({")" << property << R"(":)" << testVal << "}";
-  boost::property_tree::ptree costing_ptree;
-  boost::property_tree::read_json(ss, costing_ptree);
-  return new AutoCost(costing_ptree);
+  rapidjson::Document costing_options;
+  costing_options.Parse(ss.str().c_str());
+  return new AutoCost(costing_options);
 }
 
 std::uniform_real_distribution<float>* make_distributor_from_range (const ranged_default_t<float>& range) {
@@ -1131,6 +944,34 @@ void testAutoCostParams() {
     }
   }
 }
+
+void testEdgeCosts() {
+  // A run of edges of all sorts of speeds, densities and uses
+  std::vector<DirectedEdge> edges(kMaxEdgesPerNode);
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    edges[i].set_length(10 + i * 37);
+    edges[i].set_speed((i * 13) % kMaxSpeedKph);
+    edges[i].set_density(i % 16);
+    edges[i].set_use(i % 5 == 0 ? Use::kFerry : Use::kRoad);
+  }
+
+  // The batch has to cost each edge the same as EdgeCost, also for costing
+  // derived from auto that has its own EdgeCost
+  rapidjson::Value config;
+  std::vector<cost_ptr_t> costings = { CreateAutoCost(config),
+                                       CreateAutoShorterCost(config),
+                                       CreateHOVCost(config) };
+  for (const auto& costing : costings) {
+    std::vector<Cost> costs(edges.size());
+    costing->EdgeCosts(edges.data(), edges.size(), costs.data());
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+      Cost cost = costing->EdgeCost(&edges[i]);
+      if (costs[i].cost != cost.cost || costs[i].secs != cost.secs) {
+        throw std::runtime_error("EdgeCosts differs from EdgeCost for edge " + std::to_string(i));
+      }
+    }
+  }
+}
 }
 
 int main() {
@@ -1138,6 +979,8 @@ int main() {
 
   suite.test(TEST_CASE(testAutoCostParams));
 
+  suite.test(TEST_CASE(testEdgeCosts));
+
   return suite.tear_down();
 }
 
@@ -1,5 +1,6 @@
 #include "sif/bicyclecost.h"
 #include "sif/costconstants.h"
+#include "sif/turncosts.h"
 
 #include "baldr/directededge.h"
 #include "baldr/nodeinfo.h"
@@ -10,7 +11,7 @@
 #ifdef INLINE_TEST
 #include "test/test.h"
 #include <random>
-#include <boost/property_tree/json_parser.hpp>
+#include <sstream>
 #endif
 
 using namespace valhalla::baldr;
@@ -87,6 +88,11 @@ constexpr float kLeftSideTurnPenalties[]  = {
     kTPFavorableSlight
 };
 
+// Turn costs and turn stress penalties by turn class. A crossing raises the
+// turn cost to the crossing cost, it doesn't change the turn stress
+const TurnCosts kTurnCosts(kRightSideTurnCosts, kLeftSideTurnCosts, kTCCrossing, true);
+const TurnCosts kTurnPenalties(kRightSideTurnPenalties, kLeftSideTurnPenalties, 0.0f, true);
+
 // Cost of traversing an edge with steps. Make this high but not impassible.
 // Equal to about 5 minutes (penalty)
 const float kBicycleStepsFactor = 8.0f;
@@ -223,216 +229,23 @@ constexpr ranged_default_t<float> kUseRoadRange{0.0f, kDefaultUseRoad, 1.0f};
 constexpr ranged_default_t<float> kUseFerryRange{0.0f, kDefaultUseFerry, 1.0f};
 constexpr ranged_default_t<float> kUseHillsRange{0.0f, kDefaultUseHills, 1.0f};
 constexpr ranged_default_t<float> kAvoidBadSurfacesRange{0.0f, kDefaultAvoidBadSurfaces, 1.0f};
-}
-
-/**
- * Derived class providing dynamic edge costing for bicycle routes.
- */
-class BicycleCost : public DynamicCost {
- public:
-  /**
-   * Constructor. Configuration / options for bicycle costing are provided
-   * via a property tree.
-   * @param  config  Property tree with configuration/options.
-   */
-  BicycleCost(const boost::property_tree::ptree& config);
-
-  virtual ~BicycleCost();
-
-  /**
-   * Get the access mode used by this costing method.
-   * @return  Returns access mode.
-   */
-  uint32_t access_mode() const;
-
-  /**
-   * Checks if access is allowed for the provided directed edge.
-   * This is generally based on mode of travel and the access modes
-   * allowed on the edge. However, it can be extended to exclude access
-   * based on other parameters.
-   * @param  edge     Pointer to a directed edge.
-   * @param  pred     Predecessor edge information.
-   * @param  tile     current tile
-   * @param  edgeid   edgeid that we care about
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::DirectedEdge* edge,
-                       const EdgeLabel& pred,
-                       const baldr::GraphTile*& tile,
-                       const baldr::GraphId& edgeid) const;
-
-  /**
-   * Checks if access is allowed for an edge on the reverse path
-   * (from destination towards origin). Both opposing edges are
-   * provided.
-   * @param  edge           Pointer to a directed edge.
-   * @param  pred           Predecessor edge information.
-   * @param  opp_edge       Pointer to the opposing directed edge.
-   * @param  tile           Tile for the opposing edge (for looking
-   *                        up restrictions).
-   * @param  opp_edgeid     Opposing edge Id
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool AllowedReverse(const baldr::DirectedEdge* edge,
-                 const EdgeLabel& pred,
-                 const baldr::DirectedEdge* opp_edge,
-                 const baldr::GraphTile*& tile,
-                 const baldr::GraphId& opp_edgeid) const;
-
-  /**
-   * Checks if access is allowed for the provided node. Node access can
-   * be restricted if bollards or gates are present. (TODO - others?)
-   * @param  edge  Pointer to node information.
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::NodeInfo* node) const;
-
-  /**
-   * Get the cost to traverse the specified directed edge. Cost includes
-   * the time (seconds) to traverse the edge.
-   * @param   edge  Pointer to a directed edge.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge.
-   * Defaults to 0. Costing models that wish to include edge transition
-   * costs (i.e., intersection/turn costs) must override this method.
-   * @param  edge  Directed edge (the to edge)
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  Predecessor edge information.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
-                              const baldr::NodeInfo* node,
-                              const EdgeLabel& pred) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge
-   * when using a reverse search (from destination towards the origin).
-   * @param  idx   Directed edge local index
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  the opposing current edge in the reverse tree.
-   * @param  edge  the opposing predecessor in the reverse tree
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCostReverse(const uint32_t idx,
-                                     const baldr::NodeInfo* node,
-                                     const baldr::DirectedEdge* pred,
-                                     const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Get the cost factor for A* heuristics. This factor is multiplied
-   * with the distance to the destination to produce an estimate of the
-   * minimum cost to the destination. The A* heuristic must underestimate the
-   * cost to the destination. So a time based estimate based on speed should
-   * assume the maximum speed is used to the destination such that the time
-   * estimate is less than the least possible time along roads.
-   */
-  virtual float AStarCostFactor() const;
-
-  /**
-   * Get the current travel type.
-   * @return  Returns the current travel type.
-   */
-  virtual uint8_t travel_type() const;
-
-  // Hidden in source file so we don't need it to be protected
-  // We expose it within the source file for testing purposes
-
-  float speedfactor_[kMaxSpeedKph + 1];  // Cost factors based on speed in kph
-  float maneuver_penalty_;               // Penalty (seconds) when inconsistent names
-  float driveway_penalty_;               // Penalty (seconds) using a driveway
-  float gate_cost_;                      // Cost (seconds) to go through gate
-  float gate_penalty_;                   // Penalty (seconds) to go through gate
-  float alley_penalty_;                  // Penalty (seconds) to use a alley
-  float ferry_cost_;                     // Cost (seconds) to exit a ferry
-  float ferry_penalty_;                  // Penalty (seconds) to enter a ferry
-  float ferry_factor_;                   // Weighting to apply to ferry edges
-  float country_crossing_cost_;          // Cost (seconds) to go across a country border
-  float country_crossing_penalty_;       // Penalty (seconds) to go across a country border
-  float use_roads_;                      // Preference of using roads between 0 and 1
-  float road_factor_;                    // Road factor based on use_roads_
-  float use_ferry_;                      // Preference of using ferries between 0 and 1
-  float use_hills_;                      // Preference of using hills between 0 and 1
-  float avoid_bad_surfaces_;             // Preference of avoiding bad surfaces for the bike type
-
-  // Density factor used in edge transition costing
-  std::vector<float> trans_density_factor_;
-
-  // Average speed (kph) on smooth, flat roads.
-  float speed_;
-
-  // Bicycle type
-  BicycleType type_;
-
-  // Minimal surface type that will be penalized for costing
-  Surface minimal_surface_penalized_;
-
-  Surface worst_allowed_surface_;
-
-  // Surface speed factors (based on road surface type).
-  const float* surface_speed_factor_;
-
-  // Speed penalty factor. Penalties apply above a threshold
-  // (based on the use_roads factor)
-  float speedpenalty_[kMaxSpeedKph + 1];
-  uint32_t speed_penalty_threshold_;
-  
-  // Elevation/grade penalty (weighting applied based on the edge's weighted
-  // grade (relative value from 0-15)
-  float grade_penalty[16];
-
-protected:
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude and allow ranking results from the search by looking at each
-   * edges attribution and suitability for use as a location by the travel
-   * mode used by the costing method. Function/functor is also used to filter
-   * edges not usable / inaccessible by bicycle.
-   */
-  virtual const EdgeFilter GetEdgeFilter() const {
-    // Throw back a lambda that checks the access for this type of costing
-    Surface s = worst_allowed_surface_;
-    return [s](const baldr::DirectedEdge* edge) {
-      if ( edge->IsTransition() || edge->is_shortcut() ||
-          !(edge->forwardaccess() & kBicycleAccess) ||
-           edge->use() == Use::kSteps ||
-           edge->surface() > s) {
-        return 0.0f;
-      } else {
-        // TODO - use classification/use to alter the factor
-        return 1.0f;
-      }
-    };
-  }
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude results from the search by looking at each node's attribution
-   * @return Function to be used in filtering out nodes
-   */
-  virtual const NodeFilter GetNodeFilter() const {
-    //throw back a lambda that checks the access for this type of costing
-    return [](const baldr::NodeInfo* node) {
-      return !(node->access() & kBicycleAccess);
-    };
-  }
 
+// Density factor used in edge transition costing
+constexpr float kTransDensityFactor[] = {
+    1.0f,  1.0f, 1.0f,  1.0f,
+    1.0f,  1.0f, 1.0f,  1.0f,
+    1.05f, 1.1f, 1.15f, 1.2f,
+    1.25f, 1.3f, 1.4f,  1.5f
 };
 
+}
+
 // Bicycle route costs are distance based with some favor/avoid based on
 // attribution.
 
 // Constructor
-BicycleCost::BicycleCost(const boost::property_tree::ptree& pt)
-    : DynamicCost(pt, TravelMode::kBicycle),
-      trans_density_factor_{ 1.0f,  1.0f, 1.0f,  1.0f,
-                             1.0f,  1.0f, 1.0f,  1.0f,
-                             1.05f, 1.1f, 1.15f, 1.2f,
-                             1.25f, 1.3f, 1.4f,  1.5f } {
+BicycleCost::BicycleCost(const rapidjson::Value& config)
+    : DynamicCost(config, TravelMode::kBicycle) {
   // Set hierarchy to allow unlimited transitions
   for (auto& h : hierarchy_limits_) {
     h.max_up_transitions = kUnlimitedTransitions;
@@ -440,29 +253,29 @@ BicycleCost::BicycleCost(const boost::property_tree::ptree& pt)
 
   // Transition penalties (similar to auto)
   maneuver_penalty_ = kManeuverPenaltyRange(
-    pt.get<float>("maneuver_penalty", kDefaultManeuverPenalty)
+    rapidjson::get<float>(config, "/maneuver_penalty", kDefaultManeuverPenalty)
   );
   driveway_penalty_ = kDrivewayPenaltyRange(
-    pt.get<float>("driveway", kDefaultDrivewayPenalty)
+    rapidjson::get<float>(config, "/driveway", kDefaultDrivewayPenalty)
   );
   gate_cost_ = kGateCostRange(
-    pt.get<float>("gate_cost", kDefaultGateCost)
+    rapidjson::get<float>(config, "/gate_cost", kDefaultGateCost)
   );
   gate_penalty_ = kGatePenaltyRange(
-    pt.get<float>("gate_penalty", kDefaultGatePenalty)
+    rapidjson::get<float>(config, "/gate_penalty", kDefaultGatePenalty)
   );
   alley_penalty_ = kAlleyPenaltyRange(
-    pt.get<float>("alley_penalty", kDefaultAlleyPenalty)
+    rapidjson::get<float>(config, "/alley_penalty", kDefaultAlleyPenalty)
   );
   country_crossing_cost_ = kCountryCrossingCostRange(
-    pt.get<float>("country_crossing_cost", kDefaultCountryCrossingCost)
+    rapidjson::get<float>(config, "/country_crossing_cost", kDefaultCountryCrossingCost)
   );
   country_crossing_penalty_ = kCountryCrossingPenaltyRange(
-    pt.get<float>("country_crossing_penalty", kDefaultCountryCrossingPenalty)
+    rapidjson::get<float>(config, "/country_crossing_penalty", kDefaultCountryCrossingPenalty)
   );
 
   // Get the bicycle type - enter as string and convert to enum
-  std::string bicycle_type = pt.get("bicycle_type", "Hybrid");
+  std::string bicycle_type = rapidjson::get<std::string>(config, "/bicycle_type", "Hybrid");
   if (bicycle_type == "Cross") {
     type_ = BicycleType::kCross;
   } else if (bicycle_type == "Road") {
@@ -484,11 +297,11 @@ BicycleCost::BicycleCost(const boost::property_tree::ptree& pt)
   };
 
   speed_ = kCycleSpeedRange(
-    pt.get<float>("cycling_speed", kDefaultCyclingSpeed[t])
+    rapidjson::get<float>(config, "/cycling_speed", kDefaultCyclingSpeed[t])
   );
 
   avoid_bad_surfaces_ = kAvoidBadSurfacesRange (
-    pt.get<float>("avoid_bad_surfaces", kDefaultAvoidBadSurfaces)
+    rapidjson::get<float>(config, "/avoid_bad_surfaces", kDefaultAvoidBadSurfaces)
   );
 
   minimal_surface_penalized_ = kWorstAllowedSurface[static_cast<uint32_t> (type_)];
@@ -497,20 +310,9 @@ BicycleCost::BicycleCost(const boost::property_tree::ptree& pt)
           minimal_surface_penalized_ :
           Surface::kPath;
 
-  // Set the surface speed factors for the bicycle type.
-  if (type_ == BicycleType::kRoad) {
-    surface_speed_factor_ = kRoadSurfaceSpeedFactors;
-  } else if (type_ == BicycleType::kHybrid) {
-    surface_speed_factor_ = kHybridSurfaceSpeedFactors;
-  } else if (type_ == BicycleType::kCross) {
-    surface_speed_factor_ = kCrossSurfaceSpeedFactors;
-  } else {
-    surface_speed_factor_ = kMountainSurfaceSpeedFactors;
-  }
-
   // Willingness to use roads. Make sure this is within range [0, 1].
   use_roads_ = kUseRoadRange(
-    pt.get<float>("use_roads", kDefaultUseRoad)
+    rapidjson::get<float>(config, "/use_roads", kDefaultUseRoad)
   );
 
   // Set the road classification factor. use_roads factors above 0.5 start to
@@ -524,12 +326,12 @@ BicycleCost::BicycleCost(const boost::property_tree::ptree& pt)
   // a route must exit a ferry (except artificial test routes ending on
   // a ferry!)
   ferry_cost_ = kFerryCostRange(
-    pt.get<float>("ferry_cost", kDefaultFerryCost)
+    rapidjson::get<float>(config, "/ferry_cost", kDefaultFerryCost)
   );
 
   // Modify ferry penalty and edge weighting based on use_ferry_ factor
   use_ferry_ = kUseFerryRange(
-    pt.get<float>("use_ferry", 0.5f)
+    rapidjson::get<float>(config, "/use_ferry", 0.5f)
   );
   if (use_ferry_ < 0.5f) {
     // Penalty goes from max at use_ferry_ = 0 to 0 at use_ferry_ = 0.5
@@ -568,13 +370,41 @@ BicycleCost::BicycleCost(const boost::property_tree::ptree& pt)
     speedpenalty_[s] = (base_pen - 1.0f) * avoid_roads + 1.0f;
   }
 
+  // Set the surface speed factors for the bicycle type.
+  const float* surface_speed_factor;
+  if (type_ == BicycleType::kRoad) {
+    surface_speed_factor = kRoadSurfaceSpeedFactors;
+  } else if (type_ == BicycleType::kHybrid) {
+    surface_speed_factor = kHybridSurfaceSpeedFactors;
+  } else if (type_ == BicycleType::kCross) {
+    surface_speed_factor = kCrossSurfaceSpeedFactors;
+  } else {
+    surface_speed_factor = kMountainSurfaceSpeedFactors;
+  }
+
   // Populate the grade penalties (based on use_hills factor).
   use_hills_   = kUseHillsRange(
-    pt.get<float>("use_hills", kDefaultUseHills)
+    rapidjson::get<float>(config, "/use_hills", kDefaultUseHills)
   );
   float avoid_hills = (1.0f - use_hills_);
-  for (uint32_t i = 0; i <= kMaxGradeFactor; i++) {
-    grade_penalty[i] = avoid_hills * kAvoidHillsStrength[i];
+
+  // Fold the speed and weighting of every surface and weighted grade into
+  // tables. Speed is lower for rougher surfaces depending on the bicycle
+  // type and modulated by the weighted grade (relative measure of elevation
+  // change along the edge).
+  for (uint32_t surface = 0; surface < 8; surface++) {
+    float surface_factor = 0.0f;
+    if (surface >= static_cast<uint32_t>(minimal_surface_penalized_)) {
+      surface_factor = avoid_bad_surfaces_ *
+          kSurfaceFactors[surface - static_cast<uint32_t>(minimal_surface_penalized_)];
+    }
+    for (uint32_t grade = 0; grade <= kMaxGradeFactor; grade++) {
+      uint32_t bike_speed = static_cast<uint32_t>((speed_ *
+          surface_speed_factor[surface] * kGradeBasedSpeedFactor[grade]) + 0.5f);
+      surface_grade_sec_[surface][grade] = speedfactor_[bike_speed];
+      surface_grade_factor_[surface][grade] = 1.0f +
+          avoid_hills * kAvoidHillsStrength[grade] + surface_factor;
+    }
   }
 }
 
@@ -582,6 +412,11 @@ BicycleCost::BicycleCost(const boost::property_tree::ptree& pt)
 BicycleCost::~BicycleCost() {
 }
 
+// Copies this costing
+cost_ptr_t BicycleCost::Clone() const {
+  return std::make_shared<BicycleCost>(*this);
+}
+
 // Get the access mode used by this costing method.
 uint32_t BicycleCost::access_mode() const {
   return kBicycleAccess;
@@ -661,14 +496,12 @@ Cost BicycleCost::EdgeCost(const baldr::DirectedEdge* edge) const {
   }
 
   // If you have to dismount on the edge then we set speed to an average walking speed
-  // Otherwise, Update speed based on surface factor. Lower speed for rougher surfaces
-  // depending on the bicycle type. Modulate speed based on weighted grade
-  // (relative measure of elevation change along the edge)
-  uint32_t bike_speed = edge->dismount () ?
-      kDismountSpeed :
-      static_cast<uint32_t>((speed_ *
-        surface_speed_factor_[static_cast<uint32_t>(edge->surface())] *
-        kGradeBasedSpeedFactor[edge->weighted_grade()]) + 0.5f);
+  // Otherwise the speed is based on the surface and weighted grade
+  uint32_t surface = static_cast<uint32_t>(edge->surface());
+  uint32_t grade = edge->weighted_grade();
+  float sec_per_meter = edge->dismount() ?
+      speedfactor_[static_cast<uint32_t>(kDismountSpeed)] :
+      surface_grade_sec_[surface][grade];
 
   // Represents how stressful a roadway is without looking at grade or cycle accommodations
   float roadway_stress = 1.0f;
@@ -740,18 +573,12 @@ Cost BicycleCost::EdgeCost(const baldr::DirectedEdge* edge) const {
   // The stress of this road after accommodation but before grade
   float total_stress = accommodation_factor * roadway_stress;
 
-  float surface_factor = 0.0f;
-  if (edge->surface () >= minimal_surface_penalized_)
-  {
-    surface_factor = avoid_bad_surfaces_ * kSurfaceFactors[static_cast<uint32_t> (edge->surface ())
-                                   - static_cast<uint32_t> (minimal_surface_penalized_)];
-  }
-
-  // Create a final edge factor based on total stress and the weighted grade penalty for the edge.
-  float factor = 1.0f + grade_penalty[edge->weighted_grade()] + total_stress + surface_factor;
+  // Create a final edge factor based on total stress and the weighted grade
+  // and surface penalties for the edge.
+  float factor = surface_grade_factor_[surface][grade] + total_stress;
 
   // Compute elapsed time based on speed. Modulate cost with weighting factors.
-  float sec = (edge->length() * speedfactor_[bike_speed]);
+  float sec = (edge->length() * sec_per_meter);
   return { sec * factor, sec };
 }
 
@@ -818,23 +645,13 @@ Cost BicycleCost::TransitionCost(const baldr::DirectedEdge* edge,
 
   if (edge->stopimpact(idx) > 0) {
     // Increase turn stress depending on the kind of turn that has to be made.
-    float turn_penalty = (edge->drive_on_right()) ?
-        kRightSideTurnPenalties[static_cast<uint32_t>(edge->turntype(idx))] :
-        kLeftSideTurnPenalties[static_cast<uint32_t>(edge->turntype(idx))];
-    turn_stress += turn_penalty;
-
-    // Take the higher of the turn degree cost and the crossing cost
-    float turn_cost = (edge->drive_on_right()) ?
-        kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-        kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    if (turn_cost < kTCCrossing &&
-        edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    }
+    uint32_t turn_class = edge->turn_class(idx);
+    turn_stress += kTurnPenalties[turn_class];
 
-    // Transition time = densityfactor * stopimpact * turncost
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
+    // Transition time = densityfactor * stopimpact * turncost, the turn cost
+    // is the higher of the turn degree cost and the crossing cost
+    seconds += kTransDensityFactor[node->density()] *
+               edge->stopimpact(idx) * kTurnCosts[turn_class];
   }
 
   // Reduce stress by road class factor the closer use_roads_ is to 0
@@ -922,23 +739,13 @@ Cost BicycleCost::TransitionCostReverse(const uint32_t idx,
 
   if (edge->stopimpact(idx) > 0) {
     // Increase turn stress depending on the kind of turn that has to be made.
-    float turn_penalty = (edge->drive_on_right()) ?
-        kRightSideTurnPenalties[static_cast<uint32_t>(edge->turntype(idx))] :
-        kLeftSideTurnPenalties[static_cast<uint32_t>(edge->turntype(idx))];
-    turn_stress += turn_penalty;
-
-    // Take the higher of the turn degree cost and the crossing cost
-    float turn_cost = (edge->drive_on_right()) ?
-        kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-        kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    if (turn_cost < kTCCrossing &&
-        edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    }
+    uint32_t turn_class = edge->turn_class(idx);
+    turn_stress += kTurnPenalties[turn_class];
 
-    // Transition time = densityfactor * stopimpact * turncost
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
+    // Transition time = densityfactor * stopimpact * turncost, the turn cost
+    // is the higher of the turn degree cost and the crossing cost
+    seconds += kTransDensityFactor[node->density()] *
+               edge->stopimpact(idx) * kTurnCosts[turn_class];
   }
 
   // Reduce stress by road class factor the closer use_roads_ is to 0
@@ -978,7 +785,7 @@ uint8_t BicycleCost::travel_type() const {
   return static_cast<uint8_t>(type_);
 }
 
-cost_ptr_t CreateBicycleCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateBicycleCost(const rapidjson::Value& config) {
   return std::make_shared<BicycleCost>(config);
 }
 
@@ -997,9 +804,9 @@ namespace {
 BicycleCost* make_bicyclecost_from_json(const std::string& property, float testVal) {
   std::stringstream ss;
   ss << R"({")" << property << R"(":)" << testVal << "}";
-  boost::property_tree::ptree costing_ptree;
-  boost::property_tree::read_json(ss, costing_ptree);
-  return new BicycleCost(costing_ptree);
+  rapidjson::Document costing_options;
+  costing_options.Parse(ss.str().c_str());
+  return new BicycleCost(costing_options);
 }
 
 std::uniform_real_distribution<float>* make_distributor_from_range (const ranged_default_t<float>& range) {
@@ -5,25 +5,27 @@ using namespace valhalla::baldr;
 namespace valhalla{
 namespace sif {
 
-DynamicCost::DynamicCost(const boost::property_tree::ptree& pt,
+DynamicCost::DynamicCost(const rapidjson::Value& config,
                          const TravelMode mode)
     : pass_(0),
       allow_transit_connections_(false),
       allow_destination_only_(true),
       travel_mode_(mode) {
-  // Parse property tree to get hierarchy limits
+  // Parse json to get hierarchy limits
   // TODO - get the number of levels
   uint32_t n_levels = sizeof(kDefaultMaxUpTransitions) /
       sizeof(kDefaultMaxUpTransitions[0]);
   for (uint32_t level = 0; level < n_levels; level++) {
-    hierarchy_limits_.emplace_back(HierarchyLimits(pt, level));
+    hierarchy_limits_.emplace_back(HierarchyLimits(config, level));
   }
 
-  // Parse property tree to get avoid edges
-  auto avoid_edges = pt.get_child_optional("avoid_edges");
-  if (avoid_edges) {
-    for (auto& edgeid : *avoid_edges) {
-      user_avoid_edges_.insert(GraphId(edgeid.second.get_value<uint64_t>()));
+  // Parse json to get avoid edges
+  auto avoid_edges = rapidjson::get_child_optional(config, "/avoid_edges");
+  if (avoid_edges && avoid_edges->IsArray()) {
+    for (const auto& edgeid : avoid_edges->GetArray()) {
+      if (edgeid.IsUint64()) {
+        user_avoid_edges_.insert(GraphId(edgeid.GetUint64()));
+      }
     }
   }
 }
@@ -31,6 +33,12 @@ DynamicCost::DynamicCost(const boost::property_tree::ptree& pt,
 DynamicCost::~DynamicCost() {
 }
 
+// Copies this costing. Defaults to nullptr, costing methods that can be
+// copied must override this method.
+std::shared_ptr<DynamicCost> DynamicCost::Clone() const {
+  return nullptr;
+}
+
 // Does the costing method allow multiple passes (with relaxed hierarchy
 // limits). Defaults to false. Costing methods that wish to allow multiple
 // passes with relaxed hierarchy transitions must override this method.
@@ -38,6 +46,15 @@ bool DynamicCost::AllowMultiPass() const {
   return false;
 }
 
+// Get the costs to traverse a run of directed edges. Defaults to EdgeCost
+// of each edge.
+void DynamicCost::EdgeCosts(const baldr::DirectedEdge* edges,
+                            const uint32_t count, Cost* costs) const {
+  for (uint32_t i = 0; i < count; i++) {
+    costs[i] = EdgeCost(edges + i);
+  }
+}
+
 // Get the cost to traverse the specified directed edge using a transit
 // departure (schedule based edge traversal). Cost includes
 // the time (seconds) to traverse the edge. Only transit cost models override
@@ -48,6 +65,15 @@ Cost DynamicCost::EdgeCost(const baldr::DirectedEdge* edge,
   return { 0.0f, 0.0f };
 }
 
+// Get the cost to traverse the specified directed edge using a transit
+// departure when searching back in time. Only transit cost models override
+// this method.
+Cost DynamicCost::EdgeCostReverse(const baldr::DirectedEdge* edge,
+              const baldr::TransitDeparture* departure,
+              const uint32_t curr_time) const {
+  return { 0.0f, 0.0f };
+}
+
 // Returns the cost to make the transition from the predecessor edge.
 // Defaults to 0. Costing models that wish to include edge transition
 // costs (i.e., intersection/turn costs) must override this method.
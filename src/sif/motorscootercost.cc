@@ -1,5 +1,6 @@
 #include "sif/motorscootercost.h"
 #include "sif/costconstants.h"
+#include "sif/turncosts.h"
 
 #include <iostream>
 #include "midgard/constants.h"
@@ -11,7 +12,7 @@
 #ifdef INLINE_TEST
 #include "test/test.h"
 #include <random>
-#include <boost/property_tree/json_parser.hpp>
+#include <sstream>
 #endif
 
 using namespace valhalla::baldr;
@@ -59,6 +60,9 @@ constexpr float kLeftSideTurnCosts[]  = { kTCStraight, kTCSlight,
       kTCUnfavorable, kTCUnfavorableSharp, kTCReverse, kTCFavorableSharp,
       kTCFavorable, kTCSlight };
 
+// Turn costs by turn class
+const TurnCosts kTurnCosts(kRightSideTurnCosts, kLeftSideTurnCosts, kTCCrossing);
+
 // Maximum amount of seconds that will be allowed to be passed in to influence paths
 // This can't be too high because sometimes a certain kind of path is required to be taken
 constexpr float kMaxSeconds = 12.0f * kSecPerHour; // 12 hours
@@ -142,6 +146,14 @@ constexpr float kGradeBasedSpeedFactor[] = {
 constexpr float kSurfaceSpeedFactors[] =
         { 1.0f, 1.0f, 0.9f, 0.6f, 0.1f, 0.0f, 0.0f, 0.0f };
 
+// Density factor used in edge transition costing
+constexpr float kTransDensityFactor[] = {
+    1.0f, 1.0f, 1.0f, 1.0f,
+    1.0f, 1.1f, 1.2f, 1.3f,
+    1.4f, 1.6f, 1.9f, 2.2f,
+    2.5f, 2.8f, 3.1f, 3.5f
+};
+
 }
 
 /**
@@ -153,13 +165,19 @@ constexpr float kSurfaceSpeedFactors[] =
 class MotorScooterCost : public DynamicCost {
  public:
   /**
-   * Construct motor_scooter costing. Pass in configuration using property tree.
-   * @param  config  Property tree with configuration/options.
+   * Construct motor_scooter costing. Pass in configuration using a json object.
+   * @param  config  Json object with configuration/options.
    */
-  MotorScooterCost(const boost::property_tree::ptree& config);
+  MotorScooterCost(const rapidjson::Value& config);
 
   virtual ~MotorScooterCost();
 
+  /**
+   * Copies this costing, options and all.
+   * @return  Returns the copy.
+   */
+  virtual cost_ptr_t Clone() const;
+
   /**
    * Does the costing method allow multiple passes (with relaxed hierarchy
    * limits).
@@ -315,9 +333,6 @@ class MotorScooterCost : public DynamicCost {
   float country_crossing_penalty_;  // Penalty (seconds) to go across a country border
   float use_ferry_;
 
-  // Density factor used in edge transition costing
-  std::vector<float> trans_density_factor_;
-
   uint32_t top_speed_;  // Top speed the motorized scooter can go. Used to avoid roads
                         // with higher speeds than it
 
@@ -332,41 +347,37 @@ class MotorScooterCost : public DynamicCost {
 
 
 // Constructor
-MotorScooterCost::MotorScooterCost(const boost::property_tree::ptree& pt)
-    : DynamicCost(pt, TravelMode::kDrive),
-      trans_density_factor_{ 1.0f, 1.0f, 1.0f, 1.0f,
-                             1.0f, 1.1f, 1.2f, 1.3f,
-                             1.4f, 1.6f, 1.9f, 2.2f,
-                             2.5f, 2.8f, 3.1f, 3.5f } {
+MotorScooterCost::MotorScooterCost(const rapidjson::Value& config)
+    : DynamicCost(config, TravelMode::kDrive) {
   maneuver_penalty_ = kManeuverPenaltyRange(
-    pt.get<float>("maneuver_penalty", kDefaultManeuverPenalty)
+    rapidjson::get<float>(config, "/maneuver_penalty", kDefaultManeuverPenalty)
   );
   gate_cost_ = kGateCostRange(
-    pt.get<float>("gate_cost", kDefaultGateCost)
+    rapidjson::get<float>(config, "/gate_cost", kDefaultGateCost)
   );
   gate_penalty_ = kGatePenaltyRange(
-    pt.get<float>("gate_penalty", kDefaultGatePenalty)
+    rapidjson::get<float>(config, "/gate_penalty", kDefaultGatePenalty)
   );
   alley_penalty_ = kAlleyPenaltyRange(
-    pt.get<float>("alley_penalty", kDefaultAlleyPenalty)
+    rapidjson::get<float>(config, "/alley_penalty", kDefaultAlleyPenalty)
   );
   country_crossing_cost_ = kCountryCrossingCostRange(
-    pt.get<float>("country_crossing_cost", kDefaultCountryCrossingCost)
+    rapidjson::get<float>(config, "/country_crossing_cost", kDefaultCountryCrossingCost)
   );
   country_crossing_penalty_ = kCountryCrossingPenaltyRange(
-    pt.get<float>("country_crossing_penalty", kDefaultCountryCrossingPenalty)
+    rapidjson::get<float>(config, "/country_crossing_penalty", kDefaultCountryCrossingPenalty)
   );
 
   // Set the cost (seconds) to enter a ferry (only apply entering since
   // a route must exit a ferry (except artificial test routes ending on
   // a ferry!)
   ferry_cost_ = kFerryCostRange(
-    pt.get<float>("ferry_cost", kDefaultFerryCost)
+    rapidjson::get<float>(config, "/ferry_cost", kDefaultFerryCost)
   );
 
   // Modify ferry penalty and edge weighting based on use_ferry factor
   use_ferry_ = kUseFerryRange(
-    pt.get<float>("use_ferry", kDefaultUseFerry)
+    rapidjson::get<float>(config, "/use_ferry", kDefaultUseFerry)
   );
   if (use_ferry_ < 0.5f) {
     // Penalty goes from max at use_ferry_ = 0 to 0 at use_ferry_ = 0.5
@@ -394,11 +405,11 @@ MotorScooterCost::MotorScooterCost(const boost::property_tree::ptree& pt)
   }
 
   top_speed_ = kTopSpeedRange (
-    pt.get<float>("top_speed", kDefaultTopSpeed)
+    rapidjson::get<float>(config, "/top_speed", kDefaultTopSpeed)
   );
 
   use_hills_ = kUseHillsRange (
-      pt.get<float>("use_hills", kDefaultUseHills)
+      rapidjson::get<float>(config, "/use_hills", kDefaultUseHills)
   );
 
   float avoid_hills = (1.0f - use_hills_);
@@ -407,7 +418,7 @@ MotorScooterCost::MotorScooterCost(const boost::property_tree::ptree& pt)
   }
 
   use_primary_ = kUsePrimaryRange (
-      pt.get<float>("use_primary", kDefaultUsePrimary));
+      rapidjson::get<float>(config, "/use_primary", kDefaultUsePrimary));
 
   // Set the road classification factor. use_roads factors above 0.5 start to
   // reduce the weight difference between road classes while factors below 0.5
@@ -422,6 +433,11 @@ MotorScooterCost::MotorScooterCost(const boost::property_tree::ptree& pt)
 MotorScooterCost::~MotorScooterCost() {
 }
 
+// Copies this costing
+cost_ptr_t MotorScooterCost::Clone() const {
+  return std::make_shared<MotorScooterCost>(*this);
+}
+
 // Does the costing method allow multiple passes (with relaxed hierarchy
 // limits).
 bool MotorScooterCost::AllowMultiPass() const {
@@ -533,18 +549,8 @@ Cost MotorScooterCost::TransitionCost(const baldr::DirectedEdge* edge,
   }
 
   // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (edge->drive_on_right()) ?
-          kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-          kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
-  }
+  seconds += kTransDensityFactor[node->density()] * edge->stopimpact(idx) *
+             kTurnCosts[edge->turn_class(idx)];
 
   // Return cost (time and penalty)
   return { seconds + penalty, seconds };
@@ -587,18 +593,8 @@ Cost MotorScooterCost::TransitionCostReverse(const uint32_t idx,
   }
 
   // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (edge->drive_on_right()) ?
-          kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-          kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
-  }
+  seconds += kTransDensityFactor[node->density()] * edge->stopimpact(idx) *
+             kTurnCosts[edge->turn_class(idx)];
 
   // Return cost (time and penalty)
   return { seconds + penalty, seconds };
@@ -619,7 +615,7 @@ uint8_t MotorScooterCost::travel_type() const {
   return static_cast<uint8_t>(VehicleType::kMotorScooter);
 }
 
-cost_ptr_t CreateMotorScooterCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateMotorScooterCost(const rapidjson::Value& config) {
   return std::make_shared<MotorScooterCost>(config);
 }
 
@@ -638,9 +634,9 @@ namespace {
 MotorScooterCost* make_motorscootercost_from_json(const std::string& property, float testVal) {
   std::stringstream ss;
   ss << R"({")" << property << R"(":)" << testVal << "}";
-  boost::property_tree::ptree costing_ptree;
-  boost::property_tree::read_json(ss, costing_ptree);
-  return new MotorScooterCost(costing_ptree);
+  rapidjson::Document costing_options;
+  costing_options.Parse(ss.str().c_str());
+  return new MotorScooterCost(costing_options);
 }
 
 template <typename T>
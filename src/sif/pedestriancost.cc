@@ -8,7 +8,7 @@
 #ifdef INLINE_TEST
 #include "test/test.h"
 #include <random>
-#include <boost/property_tree/json_parser.hpp>
+#include <sstream>
 #endif
 
 using namespace valhalla::baldr;
@@ -95,7 +95,7 @@ constexpr ranged_default_t<uint32_t> kMaxGradeWheelchairRange{0, kDefaultMaxGrad
 constexpr ranged_default_t<uint32_t> kMaxGradeFootRange{0, kDefaultMaxGradeFoot, kDefaultMaxGradeFoot};
 
 // Other valid ranges and defaults (not dependent on type)
-constexpr ranged_default_t<uint8_t> kMaxHikingDifficultyRange{0, kDefaultMaxHikingDifficulty, 6};
+constexpr ranged_default_t<uint32_t> kMaxHikingDifficultyRange{0, kDefaultMaxHikingDifficulty, 6};
 constexpr ranged_default_t<float> kModeFactorRange{kMinFactor, kModeFactor, kMaxFactor};
 constexpr ranged_default_t<float> kManeuverPenaltyRange{kMinFactor, kDefaultManeuverPenalty, kMaxSeconds};
 constexpr ranged_default_t<float> kGatePenaltyRange{kMinFactor, kDefaultGatePenalty, kMaxSeconds};
@@ -134,233 +134,10 @@ constexpr float kSacScaleCostFactor[] = {
 
 }
 
-/**
- * Derived class providing dynamic edge costing for pedestrian routes.
- */
-class PedestrianCost : public DynamicCost {
- public:
-  /**
-   * Constructor. Configuration / options for pedestrian costing are provided
-   * via a property tree (JSON).
-   * @param  pt  Property tree with configuration/options.
-   */
-  PedestrianCost(const boost::property_tree::ptree& pt);
-
-  virtual ~PedestrianCost();
-
-  /**
-   * Does the costing method allow multiple passes (with relaxed hierarchy
-   * limits).
-   * @return  Returns true if the costing model allows multiple passes.
-   */
-  virtual bool AllowMultiPass() const;
-
-  /**
-   * This method overrides the max_distance with the max_distance_mm per segment
-   * distance. An example is a pure walking route may have a max distance of
-   * 10000 meters (10km) but for a multi-modal route a lower limit of 5000
-   * meters per segment (e.g. from origin to a transit stop or from the last
-   * transit stop to the destination).
-   */
-  virtual void UseMaxMultiModalDistance();
-
-  /**
-   * Returns the maximum transfer distance between stops that you are willing
-   * to travel for this mode.  In this case, it is the max walking
-   * distance you are willing to walk between transfers.
-   */
-  virtual uint32_t GetMaxTransferDistanceMM();
-
-  /**
-   * This method overrides the factor for this mode.  The higher the value
-   * the more the mode is favored.
-   */
-  virtual float GetModeFactor();
-
-  /**
-   * Get the access mode used by this costing method.
-   * @return  Returns access mode.
-   */
-  uint32_t access_mode() const;
-
-  /**
-   * Checks if access is allowed for the provided directed edge.
-   * This is generally based on mode of travel and the access modes
-   * allowed on the edge. However, it can be extended to exclude access
-   * based on other parameters.
-   * @param  edge     Pointer to a directed edge.
-   * @param  pred     Predecessor edge information.
-   * @param  tile     current tile
-   * @param  edgeid   edgeid that we care about
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::DirectedEdge* edge,
-                       const EdgeLabel& pred,
-                       const baldr::GraphTile*& tile,
-                       const baldr::GraphId& edgeid) const;
-
-  /**
-   * Checks if access is allowed for an edge on the reverse path
-   * (from destination towards origin). Both opposing edges are
-   * provided.
-   * @param  edge           Pointer to a directed edge.
-   * @param  pred           Predecessor edge information.
-   * @param  opp_edge       Pointer to the opposing directed edge.
-   * @param  tile           Tile for the opposing edge (for looking
-   *                        up restrictions).
-   * @param  opp_edgeid     Opposing edge Id
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool AllowedReverse(const baldr::DirectedEdge* edge,
-                 const EdgeLabel& pred,
-                 const baldr::DirectedEdge* opp_edge,
-                 const baldr::GraphTile*& tile,
-                 const baldr::GraphId& opp_edgeid) const;
-
-  /**
-   * Checks if access is allowed for the provided node. Node access can
-   * be restricted if bollards or gates are present.
-   * @param  edge  Pointer to node information.
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::NodeInfo* node) const;
-
-  /**
-   * Get the cost to traverse the specified directed edge. Cost includes
-   * the time (seconds) to traverse the edge.
-   * @param   edge  Pointer to a directed edge.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge.
-   * Defaults to 0. Costing models that wish to include edge transition
-   * costs (i.e., intersection/turn costs) must override this method.
-   * @param  edge  Directed edge (the to edge)
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  Predecessor edge information.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
-                              const baldr::NodeInfo* node,
-                              const EdgeLabel& pred) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge
-   * when using a reverse search (from destination towards the origin).
-   * Defaults to 0. Costing models that wish to include edge transition
-   * costs (i.e., intersection/turn costs) must override this method.
-   * @param  idx   Directed edge local index
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  the opposing current edge in the reverse tree.
-   * @param  edge  the opposing predecessor in the reverse tree
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCostReverse(const uint32_t idx,
-                                     const baldr::NodeInfo* node,
-                                     const baldr::DirectedEdge* pred,
-                                     const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Get the cost factor for A* heuristics. This factor is multiplied
-   * with the distance to the destination to produce an estimate of the
-   * minimum cost to the destination. The A* heuristic must underestimate the
-   * cost to the destination. So a time based estimate based on speed should
-   * assume the maximum speed is used to the destination such that the time
-   * estimate is less than the least possible time along roads.
-   */
-  virtual float AStarCostFactor() const;
-
-  /**
-   * Get the current travel type.
-   * @return  Returns the current travel type.
-   */
-  virtual uint8_t travel_type() const;
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude and allow ranking results from the search by looking at each
-   * edges attribution and suitability for use as a location by the travel
-   * mode used by the costing method. Function/functor is also used to filter
-   * edges not usable / inaccessible by pedestrians.
-   */
-   virtual const EdgeFilter GetEdgeFilter() const {
-     // Throw back a lambda that checks the access for this type of costing
-     auto access_mask = access_mask_;
-     auto max_sac_scale = max_hiking_difficulty_;
-     return [access_mask, max_sac_scale](const baldr::DirectedEdge* edge) {
-       return !(edge->IsTransition() || edge->is_shortcut() ||
-           edge->use() >= Use::kRail || edge->sac_scale() > max_sac_scale ||
-          !(edge->forwardaccess() & access_mask));
-     };
-   }
-
-   virtual const NodeFilter GetNodeFilter() const {
-     //throw back a lambda that checks the access for this type of costing
-     auto access_mask = access_mask_;
-     return [access_mask](const baldr::NodeInfo* node){
-       return !(node->access() & access_mask);
-     };
-   }
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude results from the search by looking at each node's attribution
-   * @return Function/functor to be used in filtering out nodes
-   */
-
- public:
-  // Type: foot (default), wheelchair, etc.
-  PedestrianType type_;
-
-  uint32_t access_mask_;
-
-  // Maximum pedestrian distance.
-  uint32_t max_distance_;
-
-  // This is the factor for this mode.  The higher the value the more the
-  // mode is favored.
-  float mode_factor_;
-
-  // Maximum pedestrian distance in meters for multimodal routes.
-  // Maximum distance at the beginning or end of a multimodal route
-  // that you are willing to travel for this mode.  In this case,
-  // it is the max walking distance.
-  uint32_t transit_start_end_max_distance_;
-
-  // Maximum transfer, distance in meters for multimodal routes.
-  // Maximum transfer distance between stops that you are willing
-  // to travel for this mode.  In this case, it is the max distance
-  // you are willing to walk between transfers.
-  uint32_t transit_transfer_max_distance_;
-
-  // Minimal surface type usable by the pedestrian type
-  Surface minimal_allowed_surface_;
-
-  uint32_t max_grade_;    // Maximum grade (percent).
-  SacScale max_hiking_difficulty_;  // Max sac_scale (0 - 6)
-  float speed_;           // Pedestrian speed.
-  float speedfactor_;     // Speed factor for costing. Based on speed.
-  float walkway_factor_;  // Factor for favoring walkways and paths.
-  float sidewalk_factor_; // Factor for favoring sidewalks.
-  float alley_factor_;    // Avoid alleys factor.
-  float driveway_factor_; // Avoid driveways factor.
-  float step_penalty_;    // Penalty applied to steps/stairs (seconds).
-  float gate_penalty_;    // Penalty (seconds) to go through gate
-  float maneuver_penalty_;          // Penalty (seconds) when inconsistent names
-  float country_crossing_cost_;     // Cost (seconds) to go across a country border
-  float country_crossing_penalty_;  // Penalty (seconds) to go across a country border
-  float ferry_cost_;                // Cost (seconds) to exit a ferry
-  float ferry_penalty_;             // Penalty (seconds) to enter a ferry
-  float ferry_factor_;              // Weighting to apply to ferry edges
-  float use_ferry_;
-};
-
-// Constructor. Parse pedestrian options from property tree. If option is
+// Constructor. Parse pedestrian options from the json costing options. If option is
 // not present, set the default.
-PedestrianCost::PedestrianCost(const boost::property_tree::ptree& pt)
-    : DynamicCost(pt, TravelMode::kPedestrian) {
+PedestrianCost::PedestrianCost(const rapidjson::Value& config)
+    : DynamicCost(config, TravelMode::kPedestrian) {
   // Set hierarchy to allow unlimited transitions
   for (auto& h : hierarchy_limits_) {
     h.max_up_transitions = kUnlimitedTransitions;
@@ -369,7 +146,7 @@ PedestrianCost::PedestrianCost(const boost::property_tree::ptree& pt)
   allow_transit_connections_ = false;
 
   // Get the pedestrian type - enter as string and convert to enum
-  std::string type = pt.get<std::string>("type", "foot");
+  std::string type = rapidjson::get<std::string>(config, "/type", "foot");
   if (type == "wheelchair") {
     type_ = PedestrianType::kWheelchair;
   } else if (type == "segway") {
@@ -382,32 +159,32 @@ PedestrianCost::PedestrianCost(const boost::property_tree::ptree& pt)
   if (type == "wheelchair") {
     access_mask_ = kWheelchairAccess;
     max_distance_ = kMaxDistanceWheelchairRange(
-      pt.get<uint32_t>("max_distance", kMaxDistanceWheelchair)
+      rapidjson::get<uint32_t>(config, "/max_distance", kMaxDistanceWheelchair)
     );
     speed_ = kSpeedWheelchairRange(
-      pt.get<float>("walking_speed", kDefaultSpeedWheelchair)
+      rapidjson::get<float>(config, "/walking_speed", kDefaultSpeedWheelchair)
     );
     step_penalty_ = kStepPenaltyWheelchairRange(
-      pt.get<float>("step_penalty", kDefaultStepPenaltyWheelchair)
+      rapidjson::get<float>(config, "/step_penalty", kDefaultStepPenaltyWheelchair)
     );
     max_grade_ = kMaxGradeWheelchairRange(
-      pt.get<uint32_t>("max_grade", kDefaultMaxGradeWheelchair)
+      rapidjson::get<uint32_t>(config, "/max_grade", kDefaultMaxGradeWheelchair)
     );
     minimal_allowed_surface_ = Surface::kCompacted;
   } else {
     // Assume type = foot
     access_mask_ = kPedestrianAccess;
     max_distance_ = kMaxDistanceFootRange(
-      pt.get<uint32_t>("max_distance", kMaxDistanceFoot)
+      rapidjson::get<uint32_t>(config, "/max_distance", kMaxDistanceFoot)
     );
     speed_ = kSpeedFootRange(
-      pt.get<float>("walking_speed", kDefaultSpeedFoot)
+      rapidjson::get<float>(config, "/walking_speed", kDefaultSpeedFoot)
     );
     step_penalty_ = kStepPenaltyFootRange(
-      pt.get<float>("step_penalty", kDefaultStepPenaltyFoot)
+      rapidjson::get<float>(config, "/step_penalty", kDefaultStepPenaltyFoot)
     );
     max_grade_ = kMaxGradeFootRange(
-      pt.get<uint32_t>("max_grade", kDefaultMaxGradeFoot)
+      rapidjson::get<uint32_t>(config, "/max_grade", kDefaultMaxGradeFoot)
     );
     minimal_allowed_surface_ = Surface::kPath;
   }
@@ -415,52 +192,52 @@ PedestrianCost::PedestrianCost(const boost::property_tree::ptree& pt)
   if (type == "foot")
   {
     max_hiking_difficulty_ = static_cast<SacScale> (kMaxHikingDifficultyRange(
-      pt.get<uint8_t>("max_hiking_difficulty", kDefaultMaxHikingDifficulty)
+      rapidjson::get<uint32_t>(config, "/max_hiking_difficulty", kDefaultMaxHikingDifficulty)
     ));
   } else {
     max_hiking_difficulty_ = SacScale::kNone;
   }
 
   mode_factor_ = kModeFactorRange(
-    pt.get<float>("mode_factor", kModeFactor)
+    rapidjson::get<float>(config, "/mode_factor", kModeFactor)
   );
   maneuver_penalty_ = kManeuverPenaltyRange(
-    pt.get<float>("maneuver_penalty", kDefaultManeuverPenalty)
+    rapidjson::get<float>(config, "/maneuver_penalty", kDefaultManeuverPenalty)
   );
   gate_penalty_ = kGatePenaltyRange(
-    pt.get<float>("gate_penalty", kDefaultGatePenalty)
+    rapidjson::get<float>(config, "/gate_penalty", kDefaultGatePenalty)
   );
   walkway_factor_ = kWalkwayFactorRange(
-    pt.get<float>("walkway_factor", kDefaultWalkwayFactor)
+    rapidjson::get<float>(config, "/walkway_factor", kDefaultWalkwayFactor)
   );
   sidewalk_factor_ = kSideWalkFactorRange(
-    pt.get<float>("sidewalk_factor", kDefaultSideWalkFactor)
+    rapidjson::get<float>(config, "/sidewalk_factor", kDefaultSideWalkFactor)
   );
   alley_factor_ = kAlleyFactorRange(
-    pt.get<float>("alley_factor", kDefaultAlleyFactor)
+    rapidjson::get<float>(config, "/alley_factor", kDefaultAlleyFactor)
   );
   driveway_factor_ = kDrivewayFactorRange(
-    pt.get<float>("driveway_factor", kDefaultDrivewayFactor)
+    rapidjson::get<float>(config, "/driveway_factor", kDefaultDrivewayFactor)
   );
   ferry_cost_ = kFerryCostRange(
-    pt.get<float>("ferry_cost", kDefaultFerryCost)
+    rapidjson::get<float>(config, "/ferry_cost", kDefaultFerryCost)
   );
   country_crossing_cost_ = kCountryCrossingCostRange(
-    pt.get<float>("country_crossing_cost", kDefaultCountryCrossingCost)
+    rapidjson::get<float>(config, "/country_crossing_cost", kDefaultCountryCrossingCost)
   );
   country_crossing_penalty_ = kCountryCrossingPenaltyRange(
-    pt.get<float>("country_crossing_penalty", kDefaultCountryCrossingPenalty)
+    rapidjson::get<float>(config, "/country_crossing_penalty", kDefaultCountryCrossingPenalty)
   );
   transit_start_end_max_distance_ = kTransitStartEndMaxDistanceRange(
-    pt.get<uint32_t>("transit_start_end_max_distance", kTransitStartEndMaxDistance)
+    rapidjson::get<uint32_t>(config, "/transit_start_end_max_distance", kTransitStartEndMaxDistance)
   );
   transit_transfer_max_distance_  = kTransitTransferMaxDistanceRange(
-    pt.get<uint32_t>("transit_transfer_max_distance", kTransitTransferMaxDistance)
+    rapidjson::get<uint32_t>(config, "/transit_transfer_max_distance", kTransitTransferMaxDistance)
   );
 
   // Modify ferry penalty and edge weighting based on use_ferry_ factor
   use_ferry_ = kUseFerryRange(
-    pt.get<float>("use_ferry", kDefaultUseFerry)
+    rapidjson::get<float>(config, "/use_ferry", kDefaultUseFerry)
   );
   if (use_ferry_ < 0.5f) {
     // Penalty goes from max at use_ferry_ = 0 to 0 at use_ferry_ = 0.5
@@ -478,12 +255,45 @@ PedestrianCost::PedestrianCost(const boost::property_tree::ptree& pt)
 
   // Set the speed factor (to avoid division in costing)
   speedfactor_ = (kSecPerHour * 0.001f) / speed_;
+
+  // Fold the speed and cost factors of each sac_scale into tables. The
+  // sac_scale values past the last one are treated like it.
+  constexpr uint32_t kLastSacScale = static_cast<uint32_t>(SacScale::kDifficultAlpineHiking);
+  for (uint32_t s = 0; s < 8; s++) {
+    uint32_t i = std::min(s, kLastSacScale);
+    sac_scale_sec_[s] = speedfactor_ * kSacScaleSpeedFactor[i];
+    sac_scale_factor_[s] = 1.0f + kSacScaleCostFactor[i];
+  }
+
+  // Slightly favor walkways/paths and penalize alleys and driveways. Other
+  // uses on roundabouts are slightly penalized.
+  for (uint32_t u = 0; u < 64; u++) {
+    Use use = static_cast<Use>(u);
+    float factor = 1.0f;
+    float roundabout_factor = kRoundaboutFactor;
+    if (use == Use::kFootway) {
+      factor = roundabout_factor = walkway_factor_;
+    } else if (use == Use::kAlley) {
+      factor = roundabout_factor = alley_factor_;
+    } else if (use == Use::kDriveway) {
+      factor = roundabout_factor = driveway_factor_;
+    } else if (use == Use::kSidewalk) {
+      factor = roundabout_factor = sidewalk_factor_;
+    }
+    use_factor_[0][u] = factor;
+    use_factor_[1][u] = roundabout_factor;
+  }
 }
 
 // Destructor
 PedestrianCost::~PedestrianCost() {
 }
 
+// Copies this costing
+cost_ptr_t PedestrianCost::Clone() const {
+  return std::make_shared<PedestrianCost>(*this);
+}
+
 // Allow multiple passes when ferries are on initial path.
 bool PedestrianCost::AllowMultiPass() const {
   return true;
@@ -553,19 +363,23 @@ bool PedestrianCost::AllowedReverse(const baldr::DirectedEdge* edge,
                const baldr::GraphId& opp_edgeid) const {
   // TODO - obtain and check the access restrictions.
 
-  // Do not check max walking distance and assume we are not allowing
-  // transit connections. Assume this method is never used in
-  // multimodal routes).
   if (!(opp_edge->forwardaccess() & access_mask_) ||
        (opp_edge->surface() > minimal_allowed_surface_) ||
         opp_edge->is_shortcut() || IsUserAvoidEdge(opp_edgeid) ||
-        edge->sac_scale() > max_hiking_difficulty_ ||
- //      (opp_edge->max_up_slope() > max_grade_ || opp_edge->max_down_slope() > max_grade_) ||
-        opp_edge->use() == Use::kTransitConnection || opp_edge->use() == Use::kEgressConnection ||
-        opp_edge->use() == Use::kPlatformConnection) {
+        edge->sac_scale() > max_hiking_difficulty_) {
+ //      || (opp_edge->max_up_slope() > max_grade_ || opp_edge->max_down_slope() > max_grade_)
     return false;
   }
-  return true;
+
+  // Multi-modal routes arriving by a time search in reverse, they check the
+  // walking distance and may use transit connections. Otherwise do not check
+  // max walking distance and disallow transit connections.
+  if (allow_transit_connections_) {
+    return (pred.path_distance() + opp_edge->length()) <= max_distance_;
+  }
+  return !(opp_edge->use() == Use::kTransitConnection ||
+           opp_edge->use() == Use::kEgressConnection ||
+           opp_edge->use() == Use::kPlatformConnection);
 }
 
 // Check if access is allowed at the specified node.
@@ -584,23 +398,11 @@ Cost PedestrianCost::EdgeCost(const baldr::DirectedEdge* edge) const {
     return { sec * ferry_factor_, sec };
   }
 
-  float factor = 1.0f + kSacScaleCostFactor[static_cast<uint8_t>(edge->sac_scale())];
-
-  if (edge->use() == Use::kFootway) {
-    factor *= walkway_factor_;
-  } else if (edge->use() == Use::kAlley) {
-    factor *= alley_factor_;
-  } else if (edge->use() == Use::kDriveway) {
-    factor *= driveway_factor_;
-  } else if (edge->use() == Use::kSidewalk) {
-    factor *= sidewalk_factor_;
-  } else if (edge->roundabout()) {
-    factor *= kRoundaboutFactor;
-  }
-
-  // Slightly favor walkways/paths and penalize alleys and driveways.
-  float sec = edge->length() * speedfactor_
-      * kSacScaleSpeedFactor[static_cast<uint8_t>(edge->sac_scale())];
+  // Factors of the sac_scale and the use (see the constructor)
+  uint32_t sac_scale = static_cast<uint32_t>(edge->sac_scale());
+  float factor = sac_scale_factor_[sac_scale] *
+      use_factor_[edge->roundabout()][static_cast<uint32_t>(edge->use())];
+  float sec = edge->length() * sac_scale_sec_[sac_scale];
   return { sec * factor, sec };
 }
 
@@ -708,7 +510,7 @@ uint8_t PedestrianCost::travel_type() const {
   return static_cast<uint8_t>(type_);
 }
 
-cost_ptr_t CreatePedestrianCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreatePedestrianCost(const rapidjson::Value& config) {
   return std::make_shared<PedestrianCost>(config);
 }
 
@@ -727,9 +529,9 @@ namespace {
 PedestrianCost* make_pedestriancost_from_json(const std::string& property, float testVal, const std::string& type) {
   std::stringstream ss;
   ss << R"({")" << property << R"(":)" << testVal << R"(,"type":")" << type << R"(")" << "}";
-  boost::property_tree::ptree costing_ptree;
-  boost::property_tree::read_json(ss, costing_ptree);
-  return new PedestrianCost(costing_ptree);
+  rapidjson::Document costing_options;
+  costing_options.Parse(ss.str().c_str());
+  return new PedestrianCost(costing_options);
 }
 
 std::uniform_real_distribution<float>* make_distributor_from_range (const ranged_default_t<float>& range) {
@@ -0,0 +1,30 @@
+#include "sif/staticcost.h"
+#include "sif/autocost.h"
+#include "sif/bicyclecost.h"
+#include "sif/pedestriancost.h"
+#include "sif/truckcost.h"
+#include "sif/truckprofile.h"
+
+#include <typeinfo>
+
+namespace valhalla {
+namespace sif {
+
+// Get the costing class to instantiate a path algorithm for.
+StaticCostType static_cost_type(const DynamicCost& costing) {
+  const std::type_info& type = typeid(costing);
+  if (type == typeid(AutoCost))
+    return StaticCostType::kAuto;
+  if (type == typeid(BicycleCost))
+    return StaticCostType::kBicycle;
+  if (type == typeid(PedestrianCost))
+    return StaticCostType::kPedestrian;
+  if (type == typeid(TruckCost))
+    return StaticCostType::kTruck;
+  if (type == typeid(ProfileTruckCost<FleetTruckProfile>))
+    return StaticCostType::kTruckFleet;
+  return StaticCostType::kDynamic;
+}
+
+}
+}
@@ -7,7 +7,7 @@
 #ifdef INLINE_TEST
 #include "test/test.h"
 #include <random>
-#include <boost/property_tree/json_parser.hpp>
+#include <sstream>
 #endif
 
 using namespace valhalla::baldr;
@@ -62,13 +62,19 @@ class TransitCost : public DynamicCost {
  public:
   /**
    * Constructor. Configuration / options for pedestrian costing are provided
-   * via a property tree (JSON).
-   * @param  pt  Property tree with configuration/options.
+   * via a json object.
+   * @param  config  Json object with configuration/options.
    */
-  TransitCost(const boost::property_tree::ptree& pt);
+  TransitCost(const rapidjson::Value& config);
 
   virtual ~TransitCost();
 
+  /**
+   * Copies this costing, options and all.
+   * @return  Returns the copy.
+   */
+  virtual cost_ptr_t Clone() const;
+
   /**
    * Get the wheelchair required flag.
    * @return  Returns true if wheelchair is required.
@@ -156,6 +162,20 @@ class TransitCost : public DynamicCost {
                         const baldr::TransitDeparture* departure,
                         const uint32_t curr_time) const;
 
+  /**
+   * Get the cost to traverse the specified directed edge using a transit
+   * departure when searching back in time from the destination. The wait
+   * is the time at the end of the edge from the arrival of the departure.
+   * @param   edge      Pointer to a directed edge.
+   * @param   departure Transit departure record.
+   * @param   curr_time Current local time (seconds from midnight) at the
+   *                    end of the edge.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost EdgeCostReverse(const baldr::DirectedEdge* edge,
+                               const baldr::TransitDeparture* departure,
+                               const uint32_t curr_time) const;
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -313,34 +333,34 @@ class TransitCost : public DynamicCost {
   std::unordered_set<tile_index_pair, TileIndexHasher> exclude_stops_;
 };
 
-// Constructor. Parse pedestrian options from property tree. If option is
+// Constructor. Parse pedestrian options from the json costing options. If option is
 // not present, set the default.
-TransitCost::TransitCost(const boost::property_tree::ptree& pt)
-    : DynamicCost(pt, TravelMode::kPublicTransit) {
+TransitCost::TransitCost(const rapidjson::Value& config)
+    : DynamicCost(config, TravelMode::kPublicTransit) {
 
   mode_factor_ = kModeFactorRange(
-    pt.get<float>("mode_factor", kModeFactor)
+    rapidjson::get<float>(config, "/mode_factor", kModeFactor)
   );
 
-  wheelchair_ = pt.get<bool>("wheelchair", false);
-  bicycle_ = pt.get<bool>("bicycle", false);
+  wheelchair_ = rapidjson::get<bool>(config, "/wheelchair", false);
+  bicycle_ = rapidjson::get<bool>(config, "/bicycle", false);
 
   // Willingness to use buses. Make sure this is within range [0, 1]
   // Otherwise it will default
   use_bus_ = kUseBusRange(
-    pt.get<float>("use_bus", kDefaultUseBus)
+    rapidjson::get<float>(config, "/use_bus", kDefaultUseBus)
   );
 
   // Willingness to use rail. Make sure this is within range [0, 1].
   // Otherwise it will default
   use_rail_ = kUseRailRange(
-    pt.get<float>("use_rail", kDefaultUseRail)
+    rapidjson::get<float>(config, "/use_rail", kDefaultUseRail)
   );
 
   // Willingness to make transfers. Make sure this is within range [0, 1].
   // Otherwise it will default
   use_transfers_ = kUseTransfersRange(
-    pt.get<float>("use_transfers", kDefaultUseTransfers)
+    rapidjson::get<float>(config, "/use_transfers", kDefaultUseTransfers)
   );
 
   // Set the factors. The factors above 0.5 start to reduce the weight
@@ -359,39 +379,45 @@ TransitCost::TransitCost(const boost::property_tree::ptree& pt)
                      5.0f - use_transfers_ * 8.0f;
 
   transfer_cost_ = kTransferCostRange(
-    pt.get<float>("transfer_cost", kDefaultTransferCost)
+    rapidjson::get<float>(config, "/transfer_cost", kDefaultTransferCost)
   );
   transfer_penalty_ = kTransferPenaltyRange(
-    pt.get<float>("transfer_penalty", kDefaultTransferPenalty)
+    rapidjson::get<float>(config, "/transfer_penalty", kDefaultTransferPenalty)
   );
 
-  std::string stop_action = pt.get("filters.stops.action", "");
+  std::string stop_action = rapidjson::get<std::string>(config, "/filters/stops/action", "");
   if (stop_action.size()) {
-    for (const auto& kv : pt.get_child("filters.stops.ids")) {
+    for (const auto& id : rapidjson::get<rapidjson::Value::ConstArray>(config, "/filters/stops/ids")) {
+      if (!id.IsString())
+        continue;
       if (stop_action == "exclude")
-        stop_exclude_onestops_.emplace(kv.second.get_value<std::string>());
+        stop_exclude_onestops_.emplace(id.GetString());
       else if (stop_action == "include")
-        stop_include_onestops_.emplace(kv.second.get_value<std::string>());
+        stop_include_onestops_.emplace(id.GetString());
     }
   }
 
-  std::string operator_action = pt.get("filters.operators.action", "");
+  std::string operator_action = rapidjson::get<std::string>(config, "/filters/operators/action", "");
   if (operator_action.size()) {
-    for (const auto& kv : pt.get_child("filters.operators.ids")) {
+    for (const auto& id : rapidjson::get<rapidjson::Value::ConstArray>(config, "/filters/operators/ids")) {
+      if (!id.IsString())
+        continue;
       if (operator_action == "exclude")
-        oper_exclude_onestops_.emplace(kv.second.get_value<std::string>());
+        oper_exclude_onestops_.emplace(id.GetString());
       else if (operator_action == "include")
-        oper_include_onestops_.emplace(kv.second.get_value<std::string>());
+        oper_include_onestops_.emplace(id.GetString());
     }
   }
 
-  std::string routes_action = pt.get("filters.routes.action", "");
+  std::string routes_action = rapidjson::get<std::string>(config, "/filters/routes/action", "");
   if (routes_action.size()) {
-    for (const auto& kv : pt.get_child("filters.routes.ids")) {
+    for (const auto& id : rapidjson::get<rapidjson::Value::ConstArray>(config, "/filters/routes/ids")) {
+      if (!id.IsString())
+        continue;
       if (routes_action == "exclude")
-        route_exclude_onestops_.emplace(kv.second.get_value<std::string>());
+        route_exclude_onestops_.emplace(id.GetString());
       else if (routes_action == "include")
-        route_include_onestops_.emplace(kv.second.get_value<std::string>());
+        route_include_onestops_.emplace(id.GetString());
     }
   }
 
@@ -411,6 +437,11 @@ TransitCost::TransitCost(const boost::property_tree::ptree& pt)
 TransitCost::~TransitCost() {
 }
 
+// Copies this costing
+cost_ptr_t TransitCost::Clone() const {
+  return std::make_shared<TransitCost>(*this);
+}
+
 // Get the wheelchair required flag.
 bool TransitCost::wheelchair() const {
   return wheelchair_;
@@ -602,6 +633,27 @@ Cost TransitCost::EdgeCost(const baldr::DirectedEdge* edge,
            wait_time + departure->elapsed_time() };
 }
 
+// Get the cost to traverse the specified directed edge using a transit
+// departure when searching back in time. The wait is at the end of the edge,
+// from the arrival of the departure until the current time.
+Cost TransitCost::EdgeCostReverse(const baldr::DirectedEdge* edge,
+                                  const baldr::TransitDeparture* departure,
+                                  const uint32_t curr_time) const {
+  // Separate wait time from time on transit
+  float wait_time = curr_time - (departure->departure_time() +
+                                 departure->elapsed_time());
+
+  // Cost is modulated by mode-based weight factor
+  float weight = 1.0f;
+  if (edge->use() == Use::kBus) {
+    weight *= bus_factor_;
+  } else if (edge->use() == Use::kRail) {
+    weight *= rail_factor_;
+  }
+  return { wait_time + (departure->elapsed_time() * weight),
+           wait_time + departure->elapsed_time() };
+}
+
 // Returns the time (in seconds) to make the transition from the predecessor
 Cost TransitCost::TransitionCost(const baldr::DirectedEdge* edge,
                                  const baldr::NodeInfo* node,
@@ -645,7 +697,7 @@ uint32_t TransitCost::UnitSize() const {
   return kUnitSize;
 }
 
-cost_ptr_t CreateTransitCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateTransitCost(const rapidjson::Value& config) {
   return std::make_shared<TransitCost>(config);
 }
 
@@ -664,9 +716,9 @@ namespace {
 TransitCost* make_transitcost_from_json(const std::string& property, float testVal) {
   std::stringstream ss;
   ss << R"({")" << property << R"(":)" << testVal << "}";
-  boost::property_tree::ptree costing_ptree;
-  boost::property_tree::read_json(ss, costing_ptree);
-  return new TransitCost(costing_ptree);
+  rapidjson::Document costing_options;
+  costing_options.Parse(ss.str().c_str());
+  return new TransitCost(costing_options);
 }
 
 std::uniform_real_distribution<float>* make_distributor_from_range (const ranged_default_t<float>& range) {
@@ -1,4 +1,5 @@
 #include "sif/truckcost.h"
+#include "sif/turncosts.h"
 
 #include <iostream>
 #include "midgard/constants.h"
@@ -9,8 +10,9 @@
 
 #ifdef INLINE_TEST
 #include "test/test.h"
+#include "sif/truckprofile.h"
 #include <random>
-#include <boost/property_tree/json_parser.hpp>
+#include <sstream>
 #endif
 
 using namespace valhalla::baldr;
@@ -56,6 +58,9 @@ constexpr float kLeftSideTurnCosts[]  = { kTCStraight, kTCSlight,
       kTCUnfavorable, kTCUnfavorableSharp, kTCReverse, kTCFavorableSharp,
       kTCFavorable, kTCSlight };
 
+// Turn costs by turn class
+const TurnCosts kTurnCosts(kRightSideTurnCosts, kLeftSideTurnCosts, kTCCrossing);
+
 // How much to favor truck routes.
 constexpr float kTruckRouteFactor = 0.85f;
 
@@ -93,252 +98,87 @@ constexpr ranged_default_t<float> kTruckHeightRange{0, kDefaultTruckHeight, 10.0
 constexpr ranged_default_t<float> kTruckWidthRange{0, kDefaultTruckWidth, 10.0f};
 constexpr ranged_default_t<float> kTruckLengthRange{0, kDefaultTruckLength, 50.0f};
 
-}
-
-/**
- * Derived class providing dynamic edge costing for truck routes.
- */
-class TruckCost : public DynamicCost {
- public:
-  /**
-   * Construct truck costing. Pass in configuration using property tree.
-   * @param  config  Property tree with configuration/options.
-   */
-  TruckCost(const boost::property_tree::ptree& config);
-
-  virtual ~TruckCost();
-
-  /**
-   * Does the costing allow hierarchy transitions. Truck costing will allow
-   * transitions by default.
-   * @return  Returns true if the costing model allows hierarchy transitions).
-   */
-   virtual bool AllowTransitions() const;
-
-  /**
-   * Does the costing method allow multiple passes (with relaxed hierarchy
-   * limits).
-   * @return  Returns true if the costing model allows multiple passes.
-   */
-  virtual bool AllowMultiPass() const;
-
-  /**
-   * Get the access mode used by this costing method.
-   * @return  Returns access mode.
-   */
-  uint32_t access_mode() const;
-
-  /**
-   * Checks if access is allowed for the provided directed edge.
-   * This is generally based on mode of travel and the access modes
-   * allowed on the edge. However, it can be extended to exclude access
-   * based on other parameters.
-   * @param  edge     Pointer to a directed edge.
-   * @param  pred     Predecessor edge information.
-   * @param  tile     current tile
-   * @param  edgeid   edgeid that we care about
-   * @return Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::DirectedEdge* edge,
-                       const EdgeLabel& pred,
-                       const baldr::GraphTile*& tile,
-                       const baldr::GraphId& edgeid) const;
-
-  /**
-   * Checks if access is allowed for an edge on the reverse path
-   * (from destination towards origin). Both opposing edges are
-   * provided.
-   * @param  edge           Pointer to a directed edge.
-   * @param  pred           Predecessor edge information.
-   * @param  opp_edge       Pointer to the opposing directed edge.
-   * @param  tile           Tile for the opposing edge (for looking
-   *                        up restrictions).
-   * @param  opp_edgeid     Opposing edge Id
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool AllowedReverse(const baldr::DirectedEdge* edge,
-                 const EdgeLabel& pred,
-                 const baldr::DirectedEdge* opp_edge,
-                 const baldr::GraphTile*& tile,
-                 const baldr::GraphId& opp_edgeid) const;
-
-  /**
-   * Checks if access is allowed for the provided node. Node access can
-   * be restricted if bollards or gates are present.
-   * @param  edge  Pointer to node information.
-   * @return  Returns true if access is allowed, false if not.
-   */
-  virtual bool Allowed(const baldr::NodeInfo* node) const;
-
-  /**
-   * Get the cost to traverse the specified directed edge. Cost includes
-   * the time (seconds) to traverse the edge.
-   * @param   edge  Pointer to a directed edge.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge.
-   * Defaults to 0. Costing models that wish to include edge transition
-   * costs (i.e., intersection/turn costs) must override this method.
-   * @param  edge  Directed edge (the to edge)
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  Predecessor edge information.
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
-                              const baldr::NodeInfo* node,
-                              const EdgeLabel& pred) const;
-
-  /**
-   * Returns the cost to make the transition from the predecessor edge
-   * when using a reverse search (from destination towards the origin).
-   * @param  idx   Directed edge local index
-   * @param  node  Node (intersection) where transition occurs.
-   * @param  pred  the opposing current edge in the reverse tree.
-   * @param  edge  the opposing predecessor in the reverse tree
-   * @return  Returns the cost and time (seconds)
-   */
-  virtual Cost TransitionCostReverse(
-      const uint32_t idx, const baldr::NodeInfo* node,
-      const baldr::DirectedEdge* pred,
-      const baldr::DirectedEdge* edge) const;
-
-  /**
-   * Get the cost factor for A* heuristics. This factor is multiplied
-   * with the distance to the destination to produce an estimate of the
-   * minimum cost to the destination. The A* heuristic must underestimate the
-   * cost to the destination. So a time based estimate based on speed should
-   * assume the maximum speed is used to the destination such that the time
-   * estimate is less than the least possible time along roads.
-   */
-  virtual float AStarCostFactor() const;
-
-  /**
-   * Get the current travel type.
-   * @return  Returns the current travel type.
-   */
-  virtual uint8_t travel_type() const;
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude and allow ranking results from the search by looking at each
-   * edges attribution and suitability for use as a location by the travel
-   * mode used by the costing method. Function/functor is also used to filter
-   * edges not usable / inaccessible by truck.
-   */
-  virtual const EdgeFilter GetEdgeFilter() const {
-    // Throw back a lambda that checks the access for this type of costing
-    return [](const baldr::DirectedEdge* edge) {
-      if (edge->IsTransition() || edge->is_shortcut() ||
-         !(edge->forwardaccess() & kTruckAccess))
-        return 0.0f;
-      else {
-        // TODO - use classification/use to alter the factor
-        return 1.0f;
-      }
-    };
-  }
-
-  /**
-   * Returns a function/functor to be used in location searching which will
-   * exclude results from the search by looking at each node's attribution
-   * @return Function/functor to be used in filtering out nodes
-   */
-  virtual const NodeFilter GetNodeFilter() const {
-    //throw back a lambda that checks the access for this type of costing
-    return [](const baldr::NodeInfo* node){
-      return !(node->access() & kTruckAccess);
-    };
-  }
-
- public:
-  VehicleType type_;                // Vehicle type: tractor trailer
-  float speedfactor_[kMaxSpeedKph + 1];
-  float density_factor_[16];        // Density factor
-  float maneuver_penalty_;          // Penalty (seconds) when inconsistent names
-  float destination_only_penalty_;  // Penalty (seconds) using a driveway or parking aisle
-  float gate_cost_;                 // Cost (seconds) to go through gate
-  float gate_penalty_;              // Penalty (seconds) to go through gate
-  float tollbooth_cost_;            // Cost (seconds) to go through toll booth
-  float tollbooth_penalty_;         // Penalty (seconds) to go through a toll booth
-  float alley_penalty_;             // Penalty (seconds) to use a alley
-  float country_crossing_cost_;     // Cost (seconds) to go through a country border
-  float country_crossing_penalty_;  // Penalty (seconds) to go across a country border
-  float low_class_penalty_;         // Penalty (seconds) to go to residential or service road
-
-  // Vehicle attributes (used for special restrictions and costing)
-  bool  hazmat_;        // Carrying hazardous materials
-  float weight_;        // Vehicle weight in metric tons
-  float axle_load_;     // Axle load weight in metric tons
-  float height_;        // Vehicle height in meters
-  float width_;         // Vehicle width in meters
-  float length_;        // Vehicle length in meters
-
-  // Density factor used in edge transition costing
-  std::vector<float> trans_density_factor_;
+// Density factor used in edge transition costing
+constexpr float kTransDensityFactor[] = {
+    1.0f, 1.0f, 1.0f, 1.0f,
+    1.0f, 1.1f, 1.2f, 1.3f,
+    1.4f, 1.6f, 1.9f, 2.2f,
+    2.5f, 2.8f, 3.1f, 3.5f
 };
 
+// Smallest restriction value (hundredths of meters or metric tons) a
+// vehicle dimension is within, so restrictions are compared as integers the
+// same way as dimension > value * 0.01
+uint64_t MinAllowedRestriction(const float dimension) {
+  uint64_t value = static_cast<uint64_t>(dimension * 100.0f);
+  while (dimension > static_cast<float>(value * 0.01)) {
+    value++;
+  }
+  while (value > 0 && !(dimension > static_cast<float>((value - 1) * 0.01))) {
+    value--;
+  }
+  return value;
+}
+
+}
 
 // Constructor
-TruckCost::TruckCost(const boost::property_tree::ptree& pt)
-    : DynamicCost(pt, TravelMode::kDrive),
-      trans_density_factor_{ 1.0f, 1.0f, 1.0f, 1.0f,
-                             1.0f, 1.1f, 1.2f, 1.3f,
-                             1.4f, 1.6f, 1.9f, 2.2f,
-                             2.5f, 2.8f, 3.1f, 3.5f } {
+TruckCost::TruckCost(const rapidjson::Value& config)
+    : DynamicCost(config, TravelMode::kDrive) {
   type_ = VehicleType::kTractorTrailer;
   maneuver_penalty_ = kManeuverPenaltyRange(
-    pt.get<float>("maneuver_penalty", kDefaultManeuverPenalty)
+    rapidjson::get<float>(config, "/maneuver_penalty", kDefaultManeuverPenalty)
   );
   destination_only_penalty_ = kDestinationOnlyPenaltyRange(
-    pt.get<float>("destination_only_penalty", kDefaultDestinationOnlyPenalty)
+    rapidjson::get<float>(config, "/destination_only_penalty", kDefaultDestinationOnlyPenalty)
   );
   alley_penalty_ = kAlleyPenaltyRange(
-    pt.get<float>("alley_penalty", kDefaultAlleyPenalty)
+    rapidjson::get<float>(config, "/alley_penalty", kDefaultAlleyPenalty)
   );
   gate_cost_ = kGateCostRange(
-    pt.get<float>("gate_cost", kDefaultGateCost)
+    rapidjson::get<float>(config, "/gate_cost", kDefaultGateCost)
   );
   gate_penalty_ = kGatePenaltyRange(
-    pt.get<float>("gate_penalty", kDefaultGatePenalty)
+    rapidjson::get<float>(config, "/gate_penalty", kDefaultGatePenalty)
   );
   tollbooth_cost_ = kTollBoothCostRange(
-    pt.get<float>("toll_booth_cost", kDefaultTollBoothCost)
+    rapidjson::get<float>(config, "/toll_booth_cost", kDefaultTollBoothCost)
   );
   tollbooth_penalty_ = kTollBoothPenaltyRange(
-    pt.get<float>("toll_booth_penalty", kDefaultTollBoothPenalty)
+    rapidjson::get<float>(config, "/toll_booth_penalty", kDefaultTollBoothPenalty)
   );
   country_crossing_cost_ = kCountryCrossingCostRange(
-    pt.get<float>("country_crossing_cost", kDefaultCountryCrossingCost)
+    rapidjson::get<float>(config, "/country_crossing_cost", kDefaultCountryCrossingCost)
   );
   country_crossing_penalty_ = kCountryCrossingPenaltyRange(
-    pt.get<float>("country_crossing_penalty", kDefaultCountryCrossingPenalty)
+    rapidjson::get<float>(config, "/country_crossing_penalty", kDefaultCountryCrossingPenalty)
   );
 
   low_class_penalty_ = kLowClassPenaltyRange(
-    pt.get<float>("low_class_penalty", kDefaultLowClassPenalty)
+    rapidjson::get<float>(config, "/low_class_penalty", kDefaultLowClassPenalty)
   );
 
   // Get the vehicle attributes
-  hazmat_ = pt.get<bool>("hazmat", false);
+  hazmat_ = rapidjson::get<bool>(config, "/hazmat", false);
   weight_ = kTruckWeightRange(
-    pt.get<float>("weight", kDefaultTruckWeight)
+    rapidjson::get<float>(config, "/weight", kDefaultTruckWeight)
   );
   axle_load_ = kTruckAxleLoadRange(
-    pt.get<float>("axle_load", kDefaultTruckAxleLoad)
+    rapidjson::get<float>(config, "/axle_load", kDefaultTruckAxleLoad)
   );
   height_ = kTruckHeightRange(
-    pt.get<float>("height", kDefaultTruckHeight)
+    rapidjson::get<float>(config, "/height", kDefaultTruckHeight)
   );
   width_ = kTruckWidthRange(
-    pt.get<float>("width", kDefaultTruckWidth)
+    rapidjson::get<float>(config, "/width", kDefaultTruckWidth)
   );
   length_ = kTruckLengthRange(
-    pt.get<float>("length", kDefaultTruckLength)
+    rapidjson::get<float>(config, "/length", kDefaultTruckLength)
   );
 
+  // Smallest value of each dimension restriction the vehicle is within
+  SetMinAllowed();
+
   // Create speed cost table
   speedfactor_[0] = kSecPerHour;  // TODO - what to make speed=0?
   for (uint32_t s = 1; s <= kMaxSpeedKph; s++) {
@@ -353,6 +193,21 @@ TruckCost::TruckCost(const boost::property_tree::ptree& pt)
 TruckCost::~TruckCost() {
 }
 
+// Set the smallest value of each dimension restriction the vehicle is within
+void TruckCost::SetMinAllowed() {
+  min_allowed_[static_cast<uint32_t>(AccessType::kHazmat)] = 0;
+  min_allowed_[static_cast<uint32_t>(AccessType::kMaxHeight)] = MinAllowedRestriction(height_);
+  min_allowed_[static_cast<uint32_t>(AccessType::kMaxWidth)] = MinAllowedRestriction(width_);
+  min_allowed_[static_cast<uint32_t>(AccessType::kMaxLength)] = MinAllowedRestriction(length_);
+  min_allowed_[static_cast<uint32_t>(AccessType::kMaxWeight)] = MinAllowedRestriction(weight_);
+  min_allowed_[static_cast<uint32_t>(AccessType::kMaxAxleLoad)] = MinAllowedRestriction(axle_load_);
+}
+
+// Copies this costing
+cost_ptr_t TruckCost::Clone() const {
+  return std::make_shared<TruckCost>(*this);
+}
+
 // Auto costing will allow hierarchy transitions by default.
 bool TruckCost::AllowTransitions() const {
   return true;
@@ -385,45 +240,7 @@ bool TruckCost::Allowed(const baldr::DirectedEdge* edge,
     return false;
   }
 
-  if (edge->access_restriction()) {
-    const std::vector<baldr::AccessRestriction>& restrictions =
-        tile->GetAccessRestrictions(edgeid.id(), kTruckAccess);
-
-    for (const auto& restriction : restrictions ) {
-      // TODO:  Need to handle restictions that take place only at certain
-      // times.  Currently, we only support kAllDaysOfWeek;
-      switch (restriction.type()) {
-        case AccessType::kHazmat:
-          if (hazmat_ != restriction.value())
-            return false;
-          break;
-        case AccessType::kMaxAxleLoad:
-          if (axle_load_ > static_cast<float>(restriction.value()*0.01))
-            return false;
-          break;
-        case AccessType::kMaxHeight:
-          if (height_ > static_cast<float>(restriction.value()*0.01))
-            return false;
-          break;
-        case AccessType::kMaxLength:
-          if (length_ > static_cast<float>(restriction.value()*0.01))
-            return false;
-          break;
-        case AccessType::kMaxWeight:
-          if (weight_ > static_cast<float>(restriction.value()*0.01))
-            return false;
-          break;
-        case AccessType::kMaxWidth:
-          if (width_ > static_cast<float>(restriction.value()*0.01))
-            return false;
-          break;
-        default:
-          break;
-      }
-    }
-  }
-
-  return true;
+  return !edge->access_restriction() || !IsRestricted(tile, edgeid.id());
 }
 
 // Checks if access is allowed for an edge on the reverse path (from
@@ -444,47 +261,28 @@ bool TruckCost::AllowedReverse(const baldr::DirectedEdge* edge,
     return false;
   }
 
-  if (edge->access_restriction()) {
-    const std::vector<baldr::AccessRestriction>& restrictions =
-          tile->GetAccessRestrictions(opp_edgeid.id(), kTruckAccess);
-
-    for (const auto& restriction : restrictions ) {
-      // TODO:  Need to handle restictions that take place only at certain
-      // times.  Currently, we only support kAllDaysOfWeek;
-      if (restriction.modes() & kTruckAccess) {
-
-        switch (restriction.type()) {
-          case AccessType::kHazmat:
-            if (hazmat_ != restriction.value())
-              return false;
-            break;
-          case AccessType::kMaxAxleLoad:
-            if (axle_load_ > static_cast<float>(restriction.value()*0.01))
-              return false;
-            break;
-          case AccessType::kMaxHeight:
-            if (height_ > static_cast<float>(restriction.value()*0.01))
-              return false;
-            break;
-          case AccessType::kMaxLength:
-            if (length_ > static_cast<float>(restriction.value()*0.01))
-              return false;
-            break;
-          case AccessType::kMaxWeight:
-            if (weight_ > static_cast<float>(restriction.value()*0.01))
-              return false;
-            break;
-          case AccessType::kMaxWidth:
-            if (width_ > static_cast<float>(restriction.value()*0.01))
-              return false;
-            break;
-          default:
-            break;
-        }
+  return !edge->access_restriction() || !IsRestricted(tile, opp_edgeid.id());
+}
+
+// Check the access restrictions of an edge against the vehicle attributes.
+bool TruckCost::IsRestricted(const baldr::GraphTile* tile, const uint32_t idx) const {
+  for (const auto& restriction : tile->GetAccessRestrictionRange(idx)) {
+    // TODO:  Need to handle restictions that take place only at certain
+    // times.  Currently, we only support kAllDaysOfWeek;
+    if (!(restriction.modes() & kTruckAccess)) {
+      continue;
+    }
+    uint32_t type = static_cast<uint32_t>(restriction.type());
+    if (restriction.type() == AccessType::kHazmat) {
+      if (hazmat_ != restriction.value()) {
+        return true;
       }
+    } else if (type <= static_cast<uint32_t>(AccessType::kMaxAxleLoad) &&
+               restriction.value() < min_allowed_[type]) {
+      return true;
     }
   }
-  return true;
+  return false;
 }
 
 // Check if access is allowed at the specified node.
@@ -510,6 +308,15 @@ Cost TruckCost::EdgeCost(const DirectedEdge* edge) const {
   return { sec * factor, sec };
 }
 
+// Returns the time (in seconds) of the turn onto the edge at the node
+float TruckCost::TurnCost(const baldr::DirectedEdge* edge,
+                          const baldr::NodeInfo* node,
+                          const uint32_t idx) const {
+  // Transition time = densityfactor * stopimpact * turncost
+  return kTransDensityFactor[node->density()] * edge->stopimpact(idx) *
+         kTurnCosts[edge->turn_class(idx)];
+}
+
 // Returns the time (in seconds) to make the transition from the predecessor
 Cost TruckCost::TransitionCost(const baldr::DirectedEdge* edge,
                                const baldr::NodeInfo* node,
@@ -552,18 +359,7 @@ Cost TruckCost::TransitionCost(const baldr::DirectedEdge* edge,
     penalty += low_class_penalty_;
 
   // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (edge->drive_on_right()) ?
-          kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-          kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
-  }
+  seconds += TurnCost(edge, node, idx);
 
   // Return cost (time and penalty)
   return { seconds + penalty, seconds };
@@ -613,18 +409,7 @@ Cost TruckCost::TransitionCostReverse(const uint32_t idx,
     penalty += low_class_penalty_;
 
   // Transition time = densityfactor * stopimpact * turncost
-  if (edge->stopimpact(idx) > 0) {
-    float turn_cost;
-    if (edge->edge_to_right(idx) && edge->edge_to_left(idx)) {
-      turn_cost = kTCCrossing;
-    } else {
-      turn_cost = (edge->drive_on_right()) ?
-          kRightSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))] :
-          kLeftSideTurnCosts[static_cast<uint32_t>(edge->turntype(idx))];
-    }
-    seconds += trans_density_factor_[node->density()] *
-               edge->stopimpact(idx) * turn_cost;
-  }
+  seconds += TurnCost(edge, node, idx);
 
   // Return cost (time and penalty)
   return { seconds + penalty, seconds };
@@ -645,7 +430,7 @@ uint8_t TruckCost::travel_type() const {
   return static_cast<uint8_t>(type_);
 }
 
-cost_ptr_t CreateTruckCost(const boost::property_tree::ptree& config) {
+cost_ptr_t CreateTruckCost(const rapidjson::Value& config) {
   return std::make_shared<TruckCost>(config);
 }
 
@@ -664,9 +449,9 @@ namespace {
 TruckCost* make_truckcost_from_json(const std::string& property, float testVal) {
   std::stringstream ss;
   ss << R"({")" << property << R"(":)" << testVal << "}";
-  boost::property_tree::ptree costing_ptree;
-  boost::property_tree::read_json(ss, costing_ptree);
-  return new TruckCost(costing_ptree);
+  rapidjson::Document costing_options;
+  costing_options.Parse(ss.str().c_str());
+  return new TruckCost(costing_options);
 }
 
 std::uniform_real_distribution<float>* make_distributor_from_range (const ranged_default_t<float>& range) {
@@ -832,12 +617,46 @@ void testTruckCostParams() {
   }
 
 }
+
+void testFleetProfile() {
+  // The fleet profile is the truck defaults, its costing has to match
+  // the costing of a request without any options
+  rapidjson::Document costing_options;
+  costing_options.Parse("{}");
+  TruckCost truck(costing_options);
+  ProfileTruckCost<FleetTruckProfile> fleet(costing_options);
+  if (fleet.maneuver_penalty_ != truck.maneuver_penalty_ ||
+      fleet.destination_only_penalty_ != truck.destination_only_penalty_ ||
+      fleet.alley_penalty_ != truck.alley_penalty_ ||
+      fleet.gate_cost_ != truck.gate_cost_ ||
+      fleet.gate_penalty_ != truck.gate_penalty_ ||
+      fleet.tollbooth_cost_ != truck.tollbooth_cost_ ||
+      fleet.tollbooth_penalty_ != truck.tollbooth_penalty_ ||
+      fleet.country_crossing_cost_ != truck.country_crossing_cost_ ||
+      fleet.country_crossing_penalty_ != truck.country_crossing_penalty_ ||
+      fleet.low_class_penalty_ != truck.low_class_penalty_ ||
+      FleetTruckProfile::kTruckRouteFactor != kTruckRouteFactor) {
+    throw std::runtime_error("Fleet profile costs and penalties are not the truck defaults");
+  }
+  if (fleet.hazmat_ != truck.hazmat_ || fleet.weight_ != truck.weight_ ||
+      fleet.axle_load_ != truck.axle_load_ || fleet.height_ != truck.height_ ||
+      fleet.width_ != truck.width_ || fleet.length_ != truck.length_) {
+    throw std::runtime_error("Fleet profile vehicle attributes are not the truck defaults");
+  }
+  for (uint32_t i = 0; i <= static_cast<uint32_t>(AccessType::kMaxAxleLoad); i++) {
+    if (fleet.min_allowed_[i] != truck.min_allowed_[i]) {
+      throw std::runtime_error("Fleet profile restrictions are not the truck defaults");
+    }
+  }
+}
+
 }
 
 int main() {
   test::suite suite("costing");
 
   suite.test(TEST_CASE(testTruckCostParams));
+  suite.test(TEST_CASE(testFleetProfile));
 
   return suite.tear_down();
 }
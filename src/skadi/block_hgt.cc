@@ -0,0 +1,104 @@
+#include "skadi/block_hgt.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <lz4.h>
+#include <lz4hc.h>
+
+namespace {
+
+  constexpr size_t HGT_DIM = 3601;
+  constexpr char MAGIC[4] = {'H', 'G', 'T', 'B'};
+  constexpr uint32_t VERSION = 1;
+
+  using namespace valhalla::skadi::block_hgt;
+
+  //the pixels covered by a block
+  void extent(size_t block, size_t& x, size_t& y, size_t& width, size_t& height) {
+    x = (block % kBlocksPerSide) * kBlockDim;
+    y = (block / kBlocksPerSide) * kBlockDim;
+    width = std::min(kBlockDim, HGT_DIM - x);
+    height = std::min(kBlockDim, HGT_DIM - y);
+  }
+
+  const uint64_t* offsets(const char* data) {
+    return static_cast<const uint64_t*>(static_cast<const void*>(data + sizeof(header_t)));
+  }
+
+  constexpr size_t DATA_OFFSET = sizeof(header_t) + sizeof(uint64_t) * (kBlockCount + 1);
+
+}
+
+namespace valhalla {
+  namespace skadi {
+    namespace block_hgt {
+
+      std::vector<char> pack(const int16_t* tile, int level) {
+        //room for the header and offsets up front
+        std::vector<char> out(DATA_OFFSET);
+        header_t header{{MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3]}, VERSION,
+                        static_cast<uint32_t>(kBlockDim), static_cast<uint32_t>(kBlockCount)};
+        std::memcpy(out.data(), &header, sizeof(header));
+        std::vector<uint64_t> block_offsets{DATA_OFFSET};
+
+        //compress each block on its own
+        std::vector<int16_t> pixels(kBlockDim * kBlockDim);
+        std::vector<char> compressed(LZ4_compressBound(pixels.size() * sizeof(int16_t)));
+        for(size_t b = 0; b < kBlockCount; ++b) {
+          size_t x, y, width, height;
+          extent(b, x, y, width, height);
+          for(size_t row = 0; row < height; ++row)
+            std::copy(tile + (y + row) * HGT_DIM + x, tile + (y + row) * HGT_DIM + x + width,
+                      pixels.begin() + row * width);
+          auto size = LZ4_compress_HC(static_cast<const char*>(static_cast<const void*>(pixels.data())),
+                                      compressed.data(), width * height * sizeof(int16_t), compressed.size(), level);
+          if(size <= 0)
+            throw std::runtime_error("Compression of block " + std::to_string(b) + " failed");
+          out.insert(out.end(), compressed.begin(), compressed.begin() + size);
+          block_offsets.push_back(out.size());
+        }
+        std::memcpy(out.data() + sizeof(header), block_offsets.data(), block_offsets.size() * sizeof(uint64_t));
+        return out;
+      }
+
+      bool valid(const char* data, size_t size) {
+        if(size < DATA_OFFSET)
+          return false;
+        header_t header;
+        std::memcpy(&header, data, sizeof(header));
+        if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) || header.version != VERSION ||
+           header.block_dim != kBlockDim || header.block_count != kBlockCount)
+          return false;
+        //the blocks must follow each other and end with the file
+        const auto* o = offsets(data);
+        if(o[0] != DATA_OFFSET || o[kBlockCount] != size)
+          return false;
+        for(size_t b = 0; b < kBlockCount; ++b)
+          if(o[b] > o[b + 1])
+            return false;
+        return true;
+      }
+
+      void unpack(const char* data, size_t block, int16_t* tile) {
+        if(block >= kBlockCount)
+          throw std::runtime_error("Block " + std::to_string(block) + " is out of range");
+        size_t x, y, width, height;
+        extent(block, x, y, width, height);
+
+        //decompress it and put the rows where they go in the tile
+        const auto* o = offsets(data);
+        std::vector<int16_t> pixels(width * height);
+        int size = width * height * sizeof(int16_t);
+        if(LZ4_decompress_safe(data + o[block], static_cast<char*>(static_cast<void*>(pixels.data())),
+                               o[block + 1] - o[block], size) != size)
+          throw std::runtime_error("Corrupt lz4 elevation block " + std::to_string(block));
+        for(size_t row = 0; row < height; ++row)
+          std::copy(pixels.begin() + row * width, pixels.begin() + (row + 1) * width,
+                    tile + (y + row) * HGT_DIM + x);
+      }
+
+    }
+  }
+}
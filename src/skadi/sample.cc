@@ -7,16 +7,27 @@
 #include <list>
 #include <fstream>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <boost/regex.hpp>
 #include <sys/stat.h>
 #include <zlib.h>
 #include <lz4.h>
 #include <lz4hc.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 
 #include "baldr/filesystem_utils.h"
+#include "skadi/block_hgt.h"
 
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
@@ -77,10 +88,11 @@ namespace {
   template<typename fmt_t>
   uint16_t is_hgt(const std::string& name, fmt_t& fmt) {
     boost::smatch m;
-    boost::regex e(".*/([NS])([0-9]{2})([WE])([0-9]{3})\\.hgt(\\.gz|\\.lz4)?$");
+    boost::regex e(".*/([NS])([0-9]{2})([WE])([0-9]{3})\\.hgt(\\.gz|\\.lz4|\\.blk)?$");
     if(boost::regex_search(name, m, e)) {
-      //enum class format_t{ UNKNOWN = 0, GZIP = 1, LZ4 = 2, RAW = 3 };
-      fmt = static_cast<fmt_t>(m[5].length() ? (m[5] == ".lz4" ? 2 : (m[5] == ".gz" ? 1 : 0)) : 3);
+      //enum class format_t{ UNKNOWN = 0, GZIP = 1, LZ4 = 2, BLOCKS = 3, RAW = 4 };
+      fmt = static_cast<fmt_t>(m[5].length() ?
+          (m[5] == ".blk" ? 3 : (m[5] == ".lz4" ? 2 : (m[5] == ".gz" ? 1 : 0))) : 4);
       auto lon = std::stoul(m[4]) * (m[3] == "E" ? 1 : -1) + 180;
       auto lat = std::stoul(m[2]) * (m[1] == "N" ? 1 : -1) + 90;
       if(lon >= 0 && lon < 360 && lat >=0 && lat < 180)
@@ -123,148 +135,451 @@ namespace {
       throw std::runtime_error("Corrupt lz4 elevation data");
   }
 
+
+  //bilinear interpolation of the pixels around the fractional pixel u, v
+  double interpolate(const int16_t* t, double u, double v) {
+    //integer pixel
+    size_t x = std::floor(u);
+    size_t y = std::floor(v);
+
+    //coefficients
+    double u_ratio = u - x;
+    double v_ratio = v - y;
+    double u_inv = 1 - u_ratio;
+    double v_inv = 1 - v_ratio;
+    double a_coef = u_inv * v_inv;
+    double b_coef = u_ratio * v_inv;
+    double c_coef = u_inv * v_ratio;
+    double d_coef = u_ratio * v_ratio;
+
+    //values
+    double adjust = 0;
+    auto a = flip(t[y * HGT_DIM + x]);
+    auto b = flip(t[y * HGT_DIM + x + 1]);
+    if(out_of_range(a)) a_coef = 0;
+    if(out_of_range(b)) b_coef = 0;
+
+    //first part of the bilinear interpolation
+    auto value = a * a_coef + b * b_coef;
+    adjust += a_coef + b_coef;
+    //LOG_INFO('{' + std::to_string(y * HGT_DIM + x) + ',' + std::to_string(a) + '}');
+    //LOG_INFO('{' + std::to_string(y * HGT_DIM + x + 1) + ',' + std::to_string(b) + '}');
+    //only need the second part if you aren't right on the row
+    //this also protects from a corner case where you sample past the end of the image
+    if(y < HGT_DIM - 1) {
+      auto c = flip(t[(y + 1) * HGT_DIM + x]);
+      auto d = flip(t[(y + 1) * HGT_DIM + x + 1]);
+      if(out_of_range(c)) c_coef = 0;
+      if(out_of_range(d)) d_coef = 0;
+      //LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x) + ',' + std::to_string(c) + '}');
+      //LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x + 1) + ',' + std::to_string(d) + '}');
+      value += c * c_coef + d * d_coef;
+      adjust += c_coef + d_coef;
+    }
+    //if we are missing everything then give up
+    if(adjust == 0)
+      return NO_DATA_VALUE;
+    //if we were missing some we need to adjust by that
+    return value / adjust;
+  }
+
+  //the index of the tile a coordinate is in and the fractional pixel within it
+  template <class coord_t>
+  uint16_t locate(const coord_t& coord, double& u, double& v) {
+    auto lon = std::floor(coord.first);
+    auto lat = std::floor(coord.second);
+    //NOTE: data is arranged from upper left to bottom right, so y is flipped
+    u = (coord.first - lon) * (HGT_DIM - 1);
+    v = (1.0 - (coord.second - lat)) * (HGT_DIM - 1);
+    return static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
+  }
+
+  //postings are interpolated in batches of this many, the pixels are gathered one posting
+  //at a time but the weighting is done for the whole batch at once in simd lanes
+  constexpr size_t BATCH_SIZE = 4;
+
+  //the 4 pixels of each posting in a batch, with the weight of the missing ones zeroed
+  struct batch_t {
+    alignas(32) double u_ratio[BATCH_SIZE];
+    alignas(32) double v_ratio[BATCH_SIZE];
+    alignas(32) double pixels[4][BATCH_SIZE];
+    alignas(32) double valid[4][BATCH_SIZE];
+  };
+
+  void gather(int16_t pixel, double& value, double& valid) {
+    auto p = flip(pixel);
+    value = p;
+    valid = out_of_range(p) ? 0 : 1;
+  }
+
+  //the same weighting as the single posting interpolation but for a whole batch
+  void weigh(const batch_t& b, double* values) {
+#if defined(__AVX__)
+    const auto one = _mm256_set1_pd(1);
+    auto u_ratio = _mm256_load_pd(b.u_ratio);
+    auto v_ratio = _mm256_load_pd(b.v_ratio);
+    auto u_inv = _mm256_sub_pd(one, u_ratio);
+    auto v_inv = _mm256_sub_pd(one, v_ratio);
+    auto a_coef = _mm256_mul_pd(_mm256_mul_pd(u_inv, v_inv), _mm256_load_pd(b.valid[0]));
+    auto b_coef = _mm256_mul_pd(_mm256_mul_pd(u_ratio, v_inv), _mm256_load_pd(b.valid[1]));
+    auto c_coef = _mm256_mul_pd(_mm256_mul_pd(u_inv, v_ratio), _mm256_load_pd(b.valid[2]));
+    auto d_coef = _mm256_mul_pd(_mm256_mul_pd(u_ratio, v_ratio), _mm256_load_pd(b.valid[3]));
+    auto value = _mm256_add_pd(
+      _mm256_add_pd(_mm256_mul_pd(_mm256_load_pd(b.pixels[0]), a_coef), _mm256_mul_pd(_mm256_load_pd(b.pixels[1]), b_coef)),
+      _mm256_add_pd(_mm256_mul_pd(_mm256_load_pd(b.pixels[2]), c_coef), _mm256_mul_pd(_mm256_load_pd(b.pixels[3]), d_coef)));
+    auto adjust = _mm256_add_pd(_mm256_add_pd(a_coef, b_coef), _mm256_add_pd(c_coef, d_coef));
+    auto missing = _mm256_cmp_pd(adjust, _mm256_setzero_pd(), _CMP_EQ_OQ);
+    auto result = _mm256_div_pd(value, _mm256_blendv_pd(adjust, one, missing));
+    _mm256_storeu_pd(values, _mm256_blendv_pd(result, _mm256_set1_pd(NO_DATA_VALUE), missing));
+#elif defined(__SSE2__)
+    const auto one = _mm_set1_pd(1);
+    for(size_t i = 0; i < BATCH_SIZE; i += 2) {
+      auto u_ratio = _mm_load_pd(b.u_ratio + i);
+      auto v_ratio = _mm_load_pd(b.v_ratio + i);
+      auto u_inv = _mm_sub_pd(one, u_ratio);
+      auto v_inv = _mm_sub_pd(one, v_ratio);
+      auto a_coef = _mm_mul_pd(_mm_mul_pd(u_inv, v_inv), _mm_load_pd(b.valid[0] + i));
+      auto b_coef = _mm_mul_pd(_mm_mul_pd(u_ratio, v_inv), _mm_load_pd(b.valid[1] + i));
+      auto c_coef = _mm_mul_pd(_mm_mul_pd(u_inv, v_ratio), _mm_load_pd(b.valid[2] + i));
+      auto d_coef = _mm_mul_pd(_mm_mul_pd(u_ratio, v_ratio), _mm_load_pd(b.valid[3] + i));
+      auto value = _mm_add_pd(
+        _mm_add_pd(_mm_mul_pd(_mm_load_pd(b.pixels[0] + i), a_coef), _mm_mul_pd(_mm_load_pd(b.pixels[1] + i), b_coef)),
+        _mm_add_pd(_mm_mul_pd(_mm_load_pd(b.pixels[2] + i), c_coef), _mm_mul_pd(_mm_load_pd(b.pixels[3] + i), d_coef)));
+      auto adjust = _mm_add_pd(_mm_add_pd(a_coef, b_coef), _mm_add_pd(c_coef, d_coef));
+      auto missing = _mm_cmpeq_pd(adjust, _mm_setzero_pd());
+      auto result = _mm_div_pd(value, _mm_or_pd(_mm_and_pd(missing, one), _mm_andnot_pd(missing, adjust)));
+      _mm_storeu_pd(values + i, _mm_or_pd(_mm_and_pd(missing, _mm_set1_pd(NO_DATA_VALUE)), _mm_andnot_pd(missing, result)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const auto one = vdupq_n_f64(1);
+    for(size_t i = 0; i < BATCH_SIZE; i += 2) {
+      auto u_ratio = vld1q_f64(b.u_ratio + i);
+      auto v_ratio = vld1q_f64(b.v_ratio + i);
+      auto u_inv = vsubq_f64(one, u_ratio);
+      auto v_inv = vsubq_f64(one, v_ratio);
+      auto a_coef = vmulq_f64(vmulq_f64(u_inv, v_inv), vld1q_f64(b.valid[0] + i));
+      auto b_coef = vmulq_f64(vmulq_f64(u_ratio, v_inv), vld1q_f64(b.valid[1] + i));
+      auto c_coef = vmulq_f64(vmulq_f64(u_inv, v_ratio), vld1q_f64(b.valid[2] + i));
+      auto d_coef = vmulq_f64(vmulq_f64(u_ratio, v_ratio), vld1q_f64(b.valid[3] + i));
+      auto value = vaddq_f64(
+        vaddq_f64(vmulq_f64(vld1q_f64(b.pixels[0] + i), a_coef), vmulq_f64(vld1q_f64(b.pixels[1] + i), b_coef)),
+        vaddq_f64(vmulq_f64(vld1q_f64(b.pixels[2] + i), c_coef), vmulq_f64(vld1q_f64(b.pixels[3] + i), d_coef)));
+      auto adjust = vaddq_f64(vaddq_f64(a_coef, b_coef), vaddq_f64(c_coef, d_coef));
+      auto missing = vceqq_f64(adjust, vdupq_n_f64(0));
+      auto result = vdivq_f64(value, vbslq_f64(missing, one, adjust));
+      vst1q_f64(values + i, vbslq_f64(missing, vdupq_n_f64(NO_DATA_VALUE), result));
+    }
+#else
+    for(size_t i = 0; i < BATCH_SIZE; ++i) {
+      double u_inv = 1 - b.u_ratio[i];
+      double v_inv = 1 - b.v_ratio[i];
+      double a_coef = u_inv * v_inv * b.valid[0][i];
+      double b_coef = b.u_ratio[i] * v_inv * b.valid[1][i];
+      double c_coef = u_inv * b.v_ratio[i] * b.valid[2][i];
+      double d_coef = b.u_ratio[i] * b.v_ratio[i] * b.valid[3][i];
+      double value = (b.pixels[0][i] * a_coef + b.pixels[1][i] * b_coef) +
+                     (b.pixels[2][i] * c_coef + b.pixels[3][i] * d_coef);
+      double adjust = (a_coef + b_coef) + (c_coef + d_coef);
+      values[i] = adjust == 0 ? NO_DATA_VALUE : value / adjust;
+    }
+#endif
+  }
+
+  //bilinear interpolation of a run of postings that are all in the same tile
+  void interpolate(const int16_t* t, const double* u, const double* v, double* values, size_t count) {
+    batch_t b;
+    size_t i = 0;
+    for(; i + BATCH_SIZE <= count; i += BATCH_SIZE) {
+      for(size_t j = 0; j < BATCH_SIZE; ++j) {
+        size_t x = std::floor(u[i + j]);
+        size_t y = std::floor(v[i + j]);
+        b.u_ratio[j] = u[i + j] - x;
+        b.v_ratio[j] = v[i + j] - y;
+        const auto* p = t + y * HGT_DIM + x;
+        gather(p[0], b.pixels[0][j], b.valid[0][j]);
+        gather(p[1], b.pixels[1][j], b.valid[1][j]);
+        //the last row has nothing below it
+        if(y < HGT_DIM - 1) {
+          gather(p[HGT_DIM], b.pixels[2][j], b.valid[2][j]);
+          gather(p[HGT_DIM + 1], b.pixels[3][j], b.valid[3][j]);
+        }
+        else {
+          b.pixels[2][j] = b.pixels[3][j] = 0;
+          b.valid[2][j] = b.valid[3][j] = 0;
+        }
+      }
+      weigh(b, values + i);
+    }
+    //whatever didnt fill a batch
+    for(; i < count; ++i)
+      values[i] = interpolate(t, u[i], v[i]);
+  }
+
+
 }
 
 namespace valhalla {
 namespace skadi {
 
-  sample::sample(const std::string& data_source):
-      mapped_cache(TILE_COUNT), unzipped_cache(-1, std::vector<int16_t>(HGT_PIXELS)), data_source(data_source) {
+  //lru of decompressed tiles, the most recently used one is at the front
+  struct sample::cache_t {
+    //a decompressed tile, tiles stored in blocks are decompressed a block at a time
+    struct tile_t {
+      tile_t(): pixels(new int16_t[HGT_PIXELS]), blocks(new std::atomic<bool>[block_hgt::kBlockCount]) {
+        reset();
+      }
+      void reset() {
+        for(size_t b = 0; b < block_hgt::kBlockCount; ++b)
+          blocks[b].store(false, std::memory_order_relaxed);
+      }
+      //left uninitialized so the pages of blocks that are never decompressed are never touched
+      std::unique_ptr<int16_t[]> pixels;
+      std::unique_ptr<std::atomic<bool>[]> blocks;
+      std::mutex mutex;
+    };
+    using tile_ptr = std::shared_ptr<tile_t>;
+    using tiles_t = std::list<std::pair<uint16_t, tile_ptr> >;
+    cache_t(size_t max_size): max_size(std::max<size_t>(max_size, 1)) {}
+
+    //the tile if its cached, in which case its now the most recently used
+    tile_ptr find(uint16_t i) {
+      auto cached = index.find(i);
+      if(cached == index.end())
+        return nullptr;
+      tiles.splice(tiles.begin(), tiles, cached->second);
+      return cached->second->second;
+    }
+
+    //make room, keeping the evicted tile around if nobody is still using it
+    void insert(uint16_t i, const tile_ptr& tile) {
+      if(tiles.size() >= max_size) {
+        auto& evicted = tiles.back();
+        index.erase(evicted.first);
+        if(evicted.second.unique())
+          spare = std::move(evicted.second);
+        tiles.pop_back();
+      }
+      tiles.emplace_front(i, tile);
+      index.emplace(i, tiles.begin());
+    }
+
+    //a tile to decompress into
+    tile_ptr allocate() {
+      auto tile = std::move(spare);
+      if(!tile)
+        return std::make_shared<tile_t>();
+      tile->reset();
+      return tile;
+    }
+
+    std::mutex mutex;
+    size_t max_size;
+    tiles_t tiles;
+    std::unordered_map<uint16_t, tiles_t::iterator> index;
+    //an evicted tile nobody was using anymore, saves reallocating 25MB
+    tile_ptr spare;
+  };
+
+  constexpr size_t sample::kDefaultCacheSize;
+
+  sample::sample(const std::string& data_source, size_t cache_size):
+      mapped_cache(new mapped_t(TILE_COUNT)), unzipped_cache(new cache_t(cache_size)),
+      data_source(data_source) {
     //messy but needed
     while(this->data_source.size() && this->data_source.back() == baldr::filesystem::path_separator)
       this->data_source.pop_back();
 
     //check the directory for files that look like what we need
     auto files = get_files(data_source);
+    auto& tiles = mapped_cache->tiles;
     for(const auto& f : files) {
       //make sure its a valid index
       format_t format;
       auto index = is_hgt(f, format);
-      if(index < mapped_cache.size() && format > mapped_cache[index].first) {
+      if(index < tiles.size() && format > tiles[index].first) {
         auto size = file_size(f);
         if(format == format_t::RAW && size != HGT_BYTES) {
           LOG_WARN("Corrupt elevation data: " + f);
           continue;
         }
-        mapped_cache[index].first = format;
-        mapped_cache[index].second.map(f, size, POSIX_MADV_SEQUENTIAL);
+        if(format == format_t::BLOCKS) {
+          midgard::mem_map<char> blocks(f, size);
+          if(!block_hgt::valid(blocks.get(), blocks.size())) {
+            LOG_WARN("Corrupt elevation data: " + f);
+            continue;
+          }
+        }
+        //blocks are read all over the place rather than front to back
+        tiles[index].first = format;
+        tiles[index].second.map(f, size, format == format_t::BLOCKS ? POSIX_MADV_RANDOM : POSIX_MADV_SEQUENTIAL);
       }
     }
   }
 
-  const int16_t* sample::source(uint16_t index) const {
+  sample::sample(const sample& other, size_t cache_size):
+      mapped_cache(other.mapped_cache), unzipped_cache(new cache_t(cache_size)),
+      data_source(other.data_source) {
+  }
+
+  std::shared_ptr<const sample> sample::get_instance(const std::string& data_source, size_t cache_size) {
+    static std::mutex lock;
+    static std::unordered_map<std::string, std::shared_ptr<const sample> > instances;
+    std::lock_guard<std::mutex> guard(lock);
+    auto& instance = instances[data_source];
+    if(!instance)
+      instance.reset(new sample(data_source, cache_size));
+    return instance;
+  }
+
+  sample::sample(sample&&) = default;
+  sample& sample::operator=(sample&&) = default;
+  sample::~sample() = default;
+
+  std::shared_ptr<const int16_t> sample::source(uint16_t index, const double* u, const double* v, size_t count) const {
     //bail if its out of bounds
     if(index >= TILE_COUNT)
       return nullptr;
 
-    //if we dont have anything maybe its lazy loaded
-    auto& mapped = mapped_cache[index];
-    if(mapped.second.get() == nullptr) {
-      auto f = data_source + name_hgt(index);
-      auto size = file_size(f);
-      if(size != HGT_BYTES)
-        return nullptr;
-      mapped.first = format_t::RAW;
-      mapped.second.map(f, size, POSIX_MADV_SEQUENTIAL);
+    //if we dont have anything maybe its lazy loaded, which every sampler of the
+    //datasource shares. once mapped a tile stays as it is
+    auto& mapped = mapped_cache->tiles[index];
+    {
+      std::lock_guard<std::mutex> map_lock(mapped_cache->mutex);
+      if(mapped.second.get() == nullptr) {
+        auto f = data_source + name_hgt(index);
+        auto size = file_size(f);
+        if(size != HGT_BYTES)
+          return nullptr;
+        mapped.first = format_t::RAW;
+        mapped.second.map(f, size, POSIX_MADV_SEQUENTIAL);
+      }
     }
 
-    //we have it raw or we dont
-    if(mapped.first == format_t::RAW)
-      return static_cast<const int16_t*>(static_cast<const void*>(mapped.second.get()));
+    //the lru is shared by all threads using this sampler
+    auto& cache = *unzipped_cache;
+    std::unique_lock<std::mutex> lock(cache.mutex);
 
-    //if we have it already unzipped
-    if(unzipped_cache.first == index)
-      return unzipped_cache.second.data();
+    //we have it raw or we dont, the mapping lives as long as we do so there is nothing to own
+    if(mapped.first == format_t::RAW)
+      return std::shared_ptr<const int16_t>(std::shared_ptr<const int16_t>(),
+        static_cast<const int16_t*>(static_cast<const void*>(mapped.second.get())));
+
+    //if we have it already unzipped its now the most recently used
+    auto tile = cache.find(index);
+    if(tile && mapped.first != format_t::BLOCKS)
+      return std::shared_ptr<const int16_t>(tile, tile->pixels.get());
+
+    //blocks get decompressed into the cached tile as they are needed
+    if(mapped.first == format_t::BLOCKS) {
+      if(!tile) {
+        tile = cache.allocate();
+        cache.insert(index, tile);
+      }
+      lock.unlock();
+      try {
+        //make sure the blocks under the 4 pixels of each posting have been decompressed
+        auto load = [&mapped, &tile](size_t block) {
+          if(tile->blocks[block].load(std::memory_order_acquire))
+            return;
+          std::lock_guard<std::mutex> block_lock(tile->mutex);
+          if(tile->blocks[block].load(std::memory_order_relaxed))
+            return;
+          block_hgt::unpack(mapped.second.get(), block, tile->pixels.get());
+          tile->blocks[block].store(true, std::memory_order_release);
+        };
+        if(u == nullptr || v == nullptr) {
+          for(size_t b = 0; b < block_hgt::kBlockCount; ++b)
+            load(b);
+        }
+        size_t last = -1;
+        for(size_t i = 0; u && v && i < count; ++i) {
+          size_t x = std::floor(u[i]);
+          size_t y = std::floor(v[i]);
+          auto block = block_hgt::block(x, y);
+          //most postings are in the same block as the last one and not on its edge
+          if(block == last && block == block_hgt::block(x + 1, std::min(y + 1, HGT_DIM - 1)))
+            continue;
+          load(block);
+          load(block_hgt::block(x + 1, y));
+          if(y < HGT_DIM - 1) {
+            load(block_hgt::block(x, y + 1));
+            load(block_hgt::block(x + 1, y + 1));
+          }
+          last = block;
+        }
+      }//failed to unzip
+      catch(...) {
+        LOG_WARN("Corrupt compressed elevation data");
+        return nullptr;
+      }
+      return std::shared_ptr<const int16_t>(tile, tile->pixels.get());
+    }
 
-    //we have to unzip it
+    //we have to unzip it but we dont hold up the other threads while we do
+    tile = cache.allocate();
+    lock.unlock();
     try {
       if(mapped.first == format_t::LZ4HC)
-        lunzip(mapped.second, unzipped_cache.second.data());
+        lunzip(mapped.second, tile->pixels.get());
       else
-        gunzip(mapped.second, unzipped_cache.second.data());
+        gunzip(mapped.second, tile->pixels.get());
     }//failed to unzip
     catch(...) {
       LOG_WARN("Corrupt compressed elevation data");
-      unzipped_cache.first = -1;
       return nullptr;
     }
+    lock.lock();
 
-    //update the simple cache
-    //TODO: LRU
-    unzipped_cache.first = index;
-    return unzipped_cache.second.data();
+    //another thread might have beaten us to it
+    auto cached = cache.find(index);
+    if(cached) {
+      cache.spare = std::move(tile);
+      return std::shared_ptr<const int16_t>(cached, cached->pixels.get());
+    }
+    cache.insert(index, tile);
+    return std::shared_ptr<const int16_t>(tile, tile->pixels.get());
   }
 
   template <class coord_t>
   double sample::get(const coord_t& coord) const {
-    //check the cache and load
-    auto lon = std::floor(coord.first);
-    auto lat = std::floor(coord.second);
-    auto index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
-
     //get the proper source of the data
-    const auto* t = source(index);
-    if(t == nullptr)
+    double u, v;
+    auto index = locate(coord, u, v);
+    auto t = source(index, &u, &v, 1);
+    if(!t)
       return NO_DATA_VALUE;
-
-    //figure out what row and column we need from the array of data
-    //NOTE: data is arranged from upper left to bottom right, so y is flipped
-
-    //fractional pixel
-    double u = (coord.first - lon) * (HGT_DIM - 1);
-    double v = (1.0 - (coord.second - lat)) * (HGT_DIM - 1);
-
-    //integer pixel
-    size_t x = std::floor(u);
-    size_t y = std::floor(v);
-
-    //coefficients
-    double u_ratio = u - x;
-    double v_ratio = v - y;
-    double u_inv = 1 - u_ratio;
-    double v_inv = 1 - v_ratio;
-    double a_coef = u_inv * v_inv;
-    double b_coef = u_ratio * v_inv;
-    double c_coef = u_inv * v_ratio;
-    double d_coef = u_ratio * v_ratio;
-
-    //values
-    double adjust = 0;
-    auto a = flip(t[y * HGT_DIM + x]);
-    auto b = flip(t[y * HGT_DIM + x + 1]);
-    if(out_of_range(a)) a_coef = 0;
-    if(out_of_range(b)) b_coef = 0;
-
-    //first part of the bilinear interpolation
-    auto value = a * a_coef + b * b_coef;
-    adjust += a_coef + b_coef;
-    //LOG_INFO('{' + std::to_string(y * HGT_DIM + x) + ',' + std::to_string(a) + '}');
-    //LOG_INFO('{' + std::to_string(y * HGT_DIM + x + 1) + ',' + std::to_string(b) + '}');
-    //only need the second part if you aren't right on the row
-    //this also protects from a corner case where you sample past the end of the image
-    if(y < HGT_DIM - 1) {
-      auto c = flip(t[(y + 1) * HGT_DIM + x]);
-      auto d = flip(t[(y + 1) * HGT_DIM + x + 1]);
-      if(out_of_range(c)) c_coef = 0;
-      if(out_of_range(d)) d_coef = 0;
-      //LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x) + ',' + std::to_string(c) + '}');
-      //LOG_INFO('{' + std::to_string((y + 1) * HGT_DIM + x + 1) + ',' + std::to_string(d) + '}');
-      value += c * c_coef + d * d_coef;
-      adjust += c_coef + d_coef;
-    }
-    //if we are missing everything then give up
-    if(adjust == 0)
-      return NO_DATA_VALUE;
-    //if we were missing some we need to adjust by that
-    return value / adjust;
+    return interpolate(t.get(), u, v);
   }
 
   template <class coords_t>
   std::vector<double> sample::get_all(const coords_t& coords) const {
     std::vector<double> values;
     values.reserve(coords.size());
-    for(const auto& coord : coords)
-      values.emplace_back(get(coord));
+    //consecutive postings are mostly in the same tile so we do a run of them at a time
+    std::vector<double> u, v;
+    double next_u, next_v;
+    auto coord = coords.cbegin();
+    uint16_t index = coord == coords.cend() ? 0 : locate(*coord, next_u, next_v);
+    while(coord != coords.cend()) {
+      //find the end of the run
+      u.clear();
+      v.clear();
+      uint16_t next = index;
+      while(next == index) {
+        u.push_back(next_u);
+        v.push_back(next_v);
+        if(++coord == coords.cend())
+          break;
+        next = locate(*coord, next_u, next_v);
+      }
+
+      //only one trip to the cache for the whole run
+      auto t = source(index, u.data(), v.data(), u.size());
+      values.resize(values.size() + u.size(), NO_DATA_VALUE);
+      if(t)
+        interpolate(t.get(), u.data(), v.data(), values.data() + values.size() - u.size(), u.size());
+      index = next;
+    }
     return values;
   }
 
@@ -3,7 +3,13 @@
 #include <algorithm>
 #include "baldr/datetime.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "thor/astar.h"
+#include "sif/autocost.h"
+#include "sif/bicyclecost.h"
+#include "sif/pedestriancost.h"
+#include "sif/truckcost.h"
+#include "sif/truckprofile.h"
 
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
@@ -23,7 +29,10 @@ AStarPathAlgorithm::AStarPathAlgorithm()
       travel_type_(0),
       adjacencylist_(nullptr),
       edgestatus_(nullptr),
+      time_dependent_(false),
+      origin_second_of_week_(0),
       max_label_count_(std::numeric_limits<uint32_t>::max()) {
+  expand_forward_ = &AStarPathAlgorithm::ExpandForward<DynamicCost>;
 }
 
 // Destructor
@@ -34,14 +43,17 @@ AStarPathAlgorithm::~AStarPathAlgorithm() {
 // Clear the temporary information generated during path construction.
 void AStarPathAlgorithm::Clear() {
   // Clear the edge labels and destination list
-  edgelabels_.clear();
+  METRICS_COUNT(kEdgesLabelled, edgelabels_.size());
+  AddSearchStats(stats_, edgelabels_.size(), adjacencylist_.get());
+  ReleaseLabels(label_arena_, edgelabels_);
   destinations_.clear();
 
   // Clear elements from the adjacency list
   adjacencylist_.reset();
 
-  // Clear the edge status flags
-  edgestatus_.reset();
+  // Clear the edge status flags, keeping the touched tiles allocated
+  if (edgestatus_)
+    edgestatus_->Init();
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -61,7 +73,7 @@ void AStarPathAlgorithm::Init(const PointLL& origll, const PointLL& destll) {
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects.
   // TODO - reserve based on estimate based on distance and route type.
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  ReserveLabels(label_arena_, edgelabels_, kInitialEdgeLabelCount);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) {
@@ -73,7 +85,10 @@ void AStarPathAlgorithm::Init(const PointLL& origll, const PointLL& destll) {
   uint32_t bucketsize = costing_->UnitSize();
   float range = kBucketCount * bucketsize;
   adjacencylist_.reset(new DoubleBucketQueue(mincost, range, bucketsize, edgecost));
-  edgestatus_.reset(new EdgeStatus());
+  if (edgestatus_)
+    edgestatus_->Init();
+  else
+    edgestatus_.reset(new EdgeStatus());
 
   // Get hierarchy limits from the costing. Get a copy since we increment
   // transition counts (i.e., this is not a const reference).
@@ -95,29 +110,50 @@ void AStarPathAlgorithm::ModifyHierarchyLimits(const float dist,
   if (25000.0f < dist && dist < 100000.0f) {
     factor = std::min(3.0f, 100000.0f / dist);
   }
-  /* TODO - need a reliable density factor near the destination (e.g. tile level?)
-  // Low density - increase expansion within distance.
-  // High density - decrease expansion within distance.
-  if (density < 8) {
-    float f = 1.0f + (8.0f - density) * 0.125f;
-    factor *= f;
-  } else if (density > 8) {
-    float f = 0.5f + (15.0f - density) * 0.0625;
-    factor *= f;
-  }*/
+  // The density near the destination is accounted for by the factors of
+  // the destination tiles, see ScaleHierarchyLimits
   // TODO - just arterial for now...investigate whether to alter local as well
   hierarchy_limits_[1].expansion_within_dist *= factor;
 }
 
+// Pick the expansion instantiated for the class of the costing so the
+// costing isn't called through the vtable for every edge
+void AStarPathAlgorithm::SetExpansion() {
+  switch (static_cost_type(*costing_)) {
+    case StaticCostType::kAuto:
+      expand_forward_ = &AStarPathAlgorithm::ExpandForward<AutoCost>;
+      break;
+    case StaticCostType::kBicycle:
+      expand_forward_ = &AStarPathAlgorithm::ExpandForward<BicycleCost>;
+      break;
+    case StaticCostType::kPedestrian:
+      expand_forward_ = &AStarPathAlgorithm::ExpandForward<PedestrianCost>;
+      break;
+    case StaticCostType::kTruck:
+      expand_forward_ = &AStarPathAlgorithm::ExpandForward<TruckCost>;
+      break;
+    case StaticCostType::kTruckFleet:
+      expand_forward_ = &AStarPathAlgorithm::ExpandForward<ProfileTruckCost<FleetTruckProfile>>;
+      break;
+    default:
+      expand_forward_ = &AStarPathAlgorithm::ExpandForward<DynamicCost>;
+      break;
+  }
+}
+
 // Expand from the node along the forward search path. Immediately expands
 // from the end node of any transition edge (so no transition edges are added
 // to the adjacency list or EdgeLabel list). Does not expand transition
 // edges if from_transition is false.
+template <class cost_t>
 void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
                    const GraphId& node, const EdgeLabel& pred,
                    const uint32_t pred_idx, const bool from_transition,
                    const odin::Location& destination,
                    std::pair<int32_t, float>& best_path) {
+  // Costing of the concrete class this expansion is instantiated for
+  const StaticCost<cost_t> costing(*costing_);
+
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
   const GraphTile* tile = graphreader.GetGraphTile(node);
@@ -125,7 +161,7 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
     return;
   }
   const NodeInfo* nodeinfo = tile->node(node);
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!costing.Allowed(nodeinfo)) {
     return;
   }
 
@@ -134,21 +170,42 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
   uint32_t max_shortcut_length = static_cast<uint32_t>(pred.distance() * 0.5f);
   GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
   const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
-  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid) {
+  const HotEdge* hotedge = tile->hotedge(nodeinfo->edge_index());
+
+  // Cost all the outbound edges at once, they are contiguous in the tile
+  Cost edgecosts[kMaxEdgesPerNode];
+  costing.EdgeCosts(directededge, nodeinfo->edge_count(), edgecosts);
+
+  // Live traffic speeds replace the ones the costing assumed. Otherwise,
+  // when departing at a time, the historical speeds at the time the search
+  // gets to the node do
+  TileSpeeds speeds = graphreader.GetTrafficSpeeds(node);
+  bool historical = time_dependent_ && tile->has_speed_profiles();
+  if (speeds || historical) {
+    uint32_t second_of_week = origin_second_of_week_ + static_cast<uint32_t>(pred.cost().secs);
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i) {
+      uint8_t speed = speeds[edgeid.id() + i];
+      if (speed == 0 && historical) {
+        speed = tile->historical_speed(edgeid.id() + i, second_of_week);
+      }
+      edgecosts[i] = costing.TrafficCost(directededge + i, edgecosts[i], speed);
+    }
+  }
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++hotedge, ++edgeid) {
     // Handle transition edges - expand from the end node of the transition
     // (unless this is called from a transition).
-    if (directededge->trans_up()) {
+    if (hotedge->trans_up()) {
       if (!from_transition) {
         hierarchy_limits_[node.level()].up_transition_count++;
-        ExpandForward(graphreader, directededge->endnode(), pred, pred_idx,
+        ExpandForward<cost_t>(graphreader, hotedge->endnode(), pred, pred_idx,
                       true, destination, best_path);
       }
       continue;
     }
-    if (directededge->trans_down()) {
+    if (hotedge->trans_down()) {
       if (!from_transition &&
-          !hierarchy_limits_[directededge->endnode().level()].StopExpanding(pred.distance())) {
-        ExpandForward(graphreader, directededge->endnode(), pred, pred_idx,
+          !hierarchy_limits_[hotedge->endnode().level()].StopExpanding(pred.distance())) {
+        ExpandForward<cost_t>(graphreader, hotedge->endnode(), pred, pred_idx,
                       true, destination, best_path);
       }
       continue;
@@ -163,8 +220,8 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
 
     // Skip any superseded edges that match the shortcut mask. Also skip
     // if no access is allowed to this edge (based on costing method)
-    if ((shortcuts & directededge->superseded()) ||
-        !costing_->Allowed(directededge, pred, tile, edgeid)) {
+    if ((shortcuts & hotedge->superseded()) ||
+        !costing.Allowed(directededge, pred, tile, edgeid)) {
       continue;
     }
 
@@ -177,7 +234,7 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
     }
 
     // Check for complex restriction
-    if (costing_->Restricted(directededge, pred, edgelabels_, tile,
+    if (costing.Restricted(directededge, pred, edgelabels_, tile,
                              edgeid, true)) {
       continue;
     }
@@ -186,8 +243,8 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
     shortcuts |= directededge->shortcut();
 
     // Compute the cost to the end of this edge
-    Cost newcost = pred.cost() + costing_->EdgeCost(directededge) +
-          costing_->TransitionCost(directededge, nodeinfo, pred);
+    Cost newcost = pred.cost() + edgecosts[i] +
+          costing.TransitionCost(directededge, nodeinfo, pred);
 
     // If this edge is a destination, subtract the partial/remainder cost
     // (cost from the dest. location to the end of the edge).
@@ -240,7 +297,7 @@ void AStarPathAlgorithm::ExpandForward(GraphReader& graphreader,
       if (t2 == nullptr) {
         continue;
       }
-      sortcost += astarheuristic_.Get(
+      sortcost += astarheuristic_.Get(directededge->endnode(),
              t2->node(directededge->endnode())->latlng(), dist);
     }
 
@@ -262,6 +319,7 @@ std::vector<PathInfo> AStarPathAlgorithm::GetBestPath(odin::Location& origin,
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   travel_type_ = costing_->travel_type();
+  SetExpansion();
 
   // Initialize - create adjacency list, edgestatus support, A*, etc.
   //Note: because we can correlate to more than one place for a given PathLocation
@@ -270,6 +328,11 @@ std::vector<PathInfo> AStarPathAlgorithm::GetBestPath(odin::Location& origin,
   PointLL origin_new(origin.path_edges(0).ll().lng(), origin.path_edges(0).ll().lat());
   PointLL destination_new(destination.path_edges(0).ll().lng(), destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
+
+  // Start loading the tiles between the locations before the search
+  // reaches them
+  graphreader.PrefetchAlong(origin_new, destination_new);
+
   float mindist = astarheuristic_.GetDistance(origin_new);
 
   // Initialize the origin and destination locations. Initialize the
@@ -277,7 +340,24 @@ std::vector<PathInfo> AStarPathAlgorithm::GetBestPath(odin::Location& origin,
   uint32_t density = SetDestination(graphreader, destination);
   SetOrigin(graphreader, origin, destination);
 
-  // Update hierarchy limits
+  // Departing at a time makes the search time dependent
+  time_dependent_ = origin.has_date_time() && DateTime::is_iso_local(origin.date_time());
+  origin_second_of_week_ = time_dependent_ ? DateTime::second_of_week(origin.date_time()) : 0;
+
+  // Bound the cost to the start nodes of the destination edges with the
+  // landmarks. Historical speeds can be faster than the ones the tables
+  // were built with so they are left out of time dependent searches.
+  if (landmarks_ && !time_dependent_) {
+    std::vector<GraphId> targets;
+    for (const auto& edge : destination.path_edges())
+      targets.push_back(graphreader.edge_startnode(GraphId(edge.graph_id())));
+    astarheuristic_.SetLandmarks(landmarks_.get(), targets, false);
+  }
+
+  // Update hierarchy limits. Upward transitions are made leaving the origin
+  // and the expansion within distance is around the destination.
+  ScaleHierarchyLimits(graphreader, origin_new, true, false, hierarchy_limits_);
+  ScaleHierarchyLimits(graphreader, destination_new, false, true, hierarchy_limits_);
   ModifyHierarchyLimits(mindist, density);
 
   // Find shortest path
@@ -351,7 +431,7 @@ std::vector<PathInfo> AStarPathAlgorithm::GetBestPath(odin::Location& origin,
     }
 
     // Expand forward from the end node of the predecessor edge.
-    ExpandForward(graphreader, pred.endnode(), pred, predindex, false,
+    (this->*expand_forward_)(graphreader, pred.endnode(), pred, predindex, false,
                   destination, best_path);
   }
   return {};      // Should never get here
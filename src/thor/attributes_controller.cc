@@ -50,11 +50,11 @@ const std::unordered_map<std::string, bool> AttributesController::kRouteAttribut
   { kEdgeId, true },
   { kEdgeWayId, true },
   { kEdgeWeightedGrade, true },
-  { kEdgeMaxUpwardGrade, true },
-  { kEdgeMaxDownwardGrade, true },
-  { kEdgeMeanElevation, true },
+  { kEdgeMaxUpwardGrade, false },
+  { kEdgeMaxDownwardGrade, false },
+  { kEdgeMeanElevation, false },
   { kEdgeLaneCount, true },
-  { kEdgeLaneConnectivity, true },
+  { kEdgeLaneConnectivity, false },
   { kEdgeCycleLane, true },
   { kEdgeBicycleNetwork, true },
   { kEdgeSidewalk, true },
@@ -62,7 +62,7 @@ const std::unordered_map<std::string, bool> AttributesController::kRouteAttribut
   { kEdgeSpeedLimit, true },
   { kEdgeTruckSpeed, true },
   { kEdgeTruckRoute, true },
-  { kEdgeTrafficSegments, true },
+  { kEdgeTrafficSegments, false },
 
   // Node keys
   { kNodeIntersectingEdgeBeginHeading, true },
@@ -100,20 +100,30 @@ const std::unordered_map<std::string, bool> AttributesController::kRouteAttribut
   { kAdminStateCode, true },
   { kAdminStateText, true },
   { kShape, true },
-  { kMatchedPoint, true },
-  { kMatchedType, true },
-  { kMatchedEdgeIndex, true },
-  { kMatchedBeginRouteDiscontinuity, true },
-  { kMatchedEndRouteDiscontinuity, true },
-  { kMatchedDistanceAlongEdge, true },
-  { kMatchedDistanceFromTracePoint, true },
-  { kConfidenceScore, true },
-  { kRawScore, true },
+  { kMatchedPoint, false },
+  { kMatchedType, false },
+  { kMatchedEdgeIndex, false },
+  { kMatchedBeginRouteDiscontinuity, false },
+  { kMatchedEndRouteDiscontinuity, false },
+  { kMatchedDistanceAlongEdge, false },
+  { kMatchedDistanceFromTracePoint, false },
+  { kConfidenceScore, false },
+  { kRawScore, false },
 
 };
 
+const std::unordered_set<std::string> AttributesController::kColumnAttributes = {
+  kEdgeLength,
+  kEdgeSpeed,
+  kEdgeWayId,
+  kEdgeBeginShapeIndex,
+  kEdgeEndShapeIndex,
+  kNodeElapsedTime,
+};
+
 AttributesController::AttributesController(
-    const std::unordered_map<std::string, bool>& new_attributes) {
+    const std::unordered_map<std::string, bool>& new_attributes)
+    : columnar(false) {
   attributes = new_attributes;
 }
 
@@ -142,5 +152,17 @@ bool AttributesController::category_attribute_enabled(
   return false;
 }
 
+bool AttributesController::columns_suffice() const {
+  for (const auto& pair : attributes) {
+    // an enabled edge or node attribute without a column
+    if (pair.second && !kColumnAttributes.count(pair.first) &&
+        (pair.first.compare(0, kEdgeCategory.size(), kEdgeCategory) == 0 ||
+         pair.first.compare(0, kNodeCategory.size(), kNodeCategory) == 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }
 }
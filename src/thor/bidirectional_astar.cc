@@ -3,6 +3,12 @@
 #include "thor/bidirectional_astar.h"
 #include "baldr/datetime.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
+#include "sif/autocost.h"
+#include "sif/bicyclecost.h"
+#include "sif/pedestriancost.h"
+#include "sif/truckcost.h"
+#include "sif/truckprofile.h"
 
 using namespace valhalla::baldr;
 using namespace valhalla::sif;
@@ -27,6 +33,7 @@ constexpr uint64_t kInitialEdgeLabelCountBD = 1000000;
 // Default constructor
 BidirectionalAStar::BidirectionalAStar(): PathAlgorithm() {
   threshold_ = 0;
+  alternates_ = 0;
   mode_ = TravelMode::kDrive;
   access_mode_ = kAutoAccess;
   travel_type_ = 0;
@@ -35,6 +42,8 @@ BidirectionalAStar::BidirectionalAStar(): PathAlgorithm() {
   adjacencylist_reverse_ = nullptr;
   edgestatus_forward_ = nullptr;
   edgestatus_reverse_ = nullptr;
+  expand_forward_ = &BidirectionalAStar::ExpandForward<DynamicCost>;
+  expand_reverse_ = &BidirectionalAStar::ExpandReverse<DynamicCost>;
 }
 
 // Destructor
@@ -44,12 +53,19 @@ BidirectionalAStar::~BidirectionalAStar() {
 
 // Clear the temporary information generated during path construction.
 void BidirectionalAStar::Clear() {
-  edgelabels_forward_.clear();
-  edgelabels_reverse_.clear();
+  METRICS_COUNT(kEdgesLabelled, edgelabels_forward_.size() + edgelabels_reverse_.size());
+  AddSearchStats(stats_, edgelabels_forward_.size(), adjacencylist_forward_.get());
+  AddSearchStats(stats_, edgelabels_reverse_.size(), adjacencylist_reverse_.get());
+  ReleaseLabels(label_arena_, edgelabels_forward_);
+  ReleaseLabels(label_arena_, edgelabels_reverse_);
+  transitions_forward_.clear();
+  transitions_reverse_.clear();
   adjacencylist_forward_.reset();
   adjacencylist_reverse_.reset();
-  edgestatus_forward_.reset();
-  edgestatus_reverse_.reset();
+  if (edgestatus_forward_)
+    edgestatus_forward_->Init();
+  if (edgestatus_reverse_)
+    edgestatus_reverse_->Init();
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -65,8 +81,10 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
 
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects
-  edgelabels_forward_.reserve(kInitialEdgeLabelCountBD);
-  edgelabels_reverse_.reserve(kInitialEdgeLabelCountBD);
+  ReserveLabels(label_arena_, edgelabels_forward_, kInitialEdgeLabelCountBD);
+  ReserveLabels(label_arena_, edgelabels_reverse_, kInitialEdgeLabelCountBD);
+  transitions_forward_.reserve(kInitialEdgeLabelCountBD);
+  transitions_reverse_.reserve(kInitialEdgeLabelCountBD);
 
   // Set up lambdas to get sort costs
   const auto forward_edgecost = [this](const uint32_t label) {
@@ -83,12 +101,18 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   float mincostf  = astarheuristic_forward_.Get(origll);
   adjacencylist_forward_.reset(new DoubleBucketQueue(mincostf, range, bucketsize,
                                                  forward_edgecost));
-  edgestatus_forward_.reset(new EdgeStatus());
+  if (edgestatus_forward_)
+    edgestatus_forward_->Init();
+  else
+    edgestatus_forward_.reset(new EdgeStatus());
 
   float mincostr = astarheuristic_reverse_.Get(destll);
   adjacencylist_reverse_.reset(new DoubleBucketQueue(mincostr, range, bucketsize,
                                                  reverse_edgecost));
-  edgestatus_reverse_.reset(new EdgeStatus());
+  if (edgestatus_reverse_)
+    edgestatus_reverse_->Init();
+  else
+    edgestatus_reverse_.reset(new EdgeStatus());
 
   // Set the cost diff between forward and reverse searches (due to distance
   // approximator differences). This is used to "even" the forward and reverse
@@ -98,6 +122,7 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   // Initialize best connection with max cost
   best_connection_ = { GraphId(), GraphId(),
                        std::numeric_limits<float>::max() };
+  connections_.clear();
 
   // Set the threshold to 0 (used to extend search once an initial
   // connection has been found).
@@ -108,10 +133,45 @@ void BidirectionalAStar::Init(const PointLL& origll, const PointLL& destll) {
   hierarchy_limits_reverse_ = costing_->GetHierarchyLimits();
 }
 
+// Pick the expansions instantiated for the class of the costing so the
+// costing isn't called through the vtable for every edge
+void BidirectionalAStar::SetExpansion() {
+  switch (static_cost_type(*costing_)) {
+    case StaticCostType::kAuto:
+      expand_forward_ = &BidirectionalAStar::ExpandForward<AutoCost>;
+      expand_reverse_ = &BidirectionalAStar::ExpandReverse<AutoCost>;
+      break;
+    case StaticCostType::kBicycle:
+      expand_forward_ = &BidirectionalAStar::ExpandForward<BicycleCost>;
+      expand_reverse_ = &BidirectionalAStar::ExpandReverse<BicycleCost>;
+      break;
+    case StaticCostType::kPedestrian:
+      expand_forward_ = &BidirectionalAStar::ExpandForward<PedestrianCost>;
+      expand_reverse_ = &BidirectionalAStar::ExpandReverse<PedestrianCost>;
+      break;
+    case StaticCostType::kTruck:
+      expand_forward_ = &BidirectionalAStar::ExpandForward<TruckCost>;
+      expand_reverse_ = &BidirectionalAStar::ExpandReverse<TruckCost>;
+      break;
+    case StaticCostType::kTruckFleet:
+      expand_forward_ = &BidirectionalAStar::ExpandForward<ProfileTruckCost<FleetTruckProfile>>;
+      expand_reverse_ = &BidirectionalAStar::ExpandReverse<ProfileTruckCost<FleetTruckProfile>>;
+      break;
+    default:
+      expand_forward_ = &BidirectionalAStar::ExpandForward<DynamicCost>;
+      expand_reverse_ = &BidirectionalAStar::ExpandReverse<DynamicCost>;
+      break;
+  }
+}
+
 // Expand from a node in the forward direction
+template <class cost_t>
 void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
        const GraphId& node, const BDEdgeLabel& pred, const uint32_t pred_idx,
        const bool from_transition) {
+  // Costing of the concrete class this expansion is instantiated for
+  const StaticCost<cost_t> costing(*costing_);
+
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
   const GraphTile* tile = graphreader.GetGraphTile(node);
@@ -119,7 +179,7 @@ void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
     return;
   }
   const NodeInfo* nodeinfo = tile->node(node);
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!costing.Allowed(nodeinfo)) {
     return;
   }
 
@@ -127,28 +187,43 @@ void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
   uint32_t shortcuts = 0;
   GraphId edgeid = { node.tileid(), node.level(), nodeinfo->edge_index() };
   const DirectedEdge* directededge = tile->directededge(edgeid);
-  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid) {
+  const HotEdge* hotedge = tile->hotedge(edgeid.id());
+
+  // Cost all the outbound edges at once, they are contiguous in the tile
+  Cost edgecosts[kMaxEdgesPerNode];
+  costing.EdgeCosts(directededge, nodeinfo->edge_count(), edgecosts);
+
+  // Live traffic speeds replace the ones the costing assumed
+  TileSpeeds speeds = graphreader.GetTrafficSpeeds(node);
+  if (speeds) {
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i) {
+      edgecosts[i] = costing.TrafficCost(directededge + i, edgecosts[i],
+                                         speeds[edgeid.id() + i]);
+    }
+  }
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++hotedge, ++edgeid) {
     // Handle transition edges - expand from the end node of the transition
     // (unless this is called from a transition).
-    if (directededge->trans_up()) {
+    if (hotedge->trans_up()) {
       if (!from_transition) {
         hierarchy_limits_forward_[node.level()].up_transition_count++;
-        ExpandForward(graphreader, directededge->endnode(), pred, pred_idx, true);
+        ExpandForward<cost_t>(graphreader, hotedge->endnode(), pred, pred_idx, true);
       }
       continue;
     }
-    if (directededge->trans_down()) {
+    if (hotedge->trans_down()) {
       if (!from_transition &&
-          !hierarchy_limits_forward_[directededge->endnode().level()].StopExpanding()) {
-        ExpandForward(graphreader, directededge->endnode(), pred, pred_idx, true);
+          !hierarchy_limits_forward_[hotedge->endnode().level()].StopExpanding()) {
+        ExpandForward<cost_t>(graphreader, hotedge->endnode(), pred, pred_idx, true);
       }
       continue;
     }
 
     // Quick check to skip if no access for this mode or if edge is
-    // superseded by a shortcut edge that was taken.
-    if (!(directededge->forwardaccess() & access_mode_) ||
-         (shortcuts & directededge->superseded())) {
+    // superseded by a shortcut edge that was taken. These only need the
+    // hot edge, the directed edge isn't touched until it is worth costing.
+    if (!(hotedge->forwardaccess() & access_mode_) ||
+         (shortcuts & hotedge->superseded())) {
       continue;
     }
 
@@ -161,8 +236,8 @@ void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
 
     // Skip this edge if no access is allowed (based on costing method)
     // or if a complex restriction prevents transition onto this edge.
-    if (!costing_->Allowed(directededge, pred, tile, edgeid) ||
-         costing_->Restricted(directededge, pred, edgelabels_forward_, tile,
+    if (!costing.Allowed(directededge, pred, tile, edgeid) ||
+         costing.Restricted(directededge, pred, edgelabels_forward_, tile,
                                      edgeid, true)) {
       continue;
     }
@@ -175,8 +250,8 @@ void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
         hierarchy_limits_forward_[edgeid.level()+1].StopExpanding()) {
       shortcuts |= directededge->shortcut();
     }
-    Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-    Cost newcost = pred.cost() + tc + costing_->EdgeCost(directededge);
+    Cost tc = costing.TransitionCost(directededge, nodeinfo, pred);
+    Cost newcost = pred.cost() + tc + edgecosts[i];
 
     // Check if edge is temporarily labeled and this path has less cost. If
     // less cost the predecessor is updated and the sort cost is decremented
@@ -186,7 +261,8 @@ void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
       if (newcost.cost <  lab.cost().cost) {
         float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
         adjacencylist_forward_->decrease(edgestatus.index(), newsortcost);
-        lab.Update(pred_idx, newcost, newsortcost, tc);
+        lab.Update(pred_idx, newcost, newsortcost);
+        transitions_forward_[edgestatus.index()] = tc;
       }
       continue;
     }
@@ -202,23 +278,28 @@ void BidirectionalAStar::ExpandForward(GraphReader& graphreader,
     // Find the sort cost (with A* heuristic) using the lat,lng at the
     // end node of the directed edge.
     float dist = 0.0f;
-    float sortcost = newcost.cost + astarheuristic_forward_.Get(
+    float sortcost = newcost.cost + astarheuristic_forward_.Get(directededge->endnode(),
           t2->node(directededge->endnode())->latlng(), dist);
 
     // Add edge label, add to the adjacency list and set edge status
     uint32_t idx = edgelabels_forward_.size();
     edgestatus_forward_->Set(edgeid, EdgeSet::kTemporary, idx);
     edgelabels_forward_.emplace_back(pred_idx, edgeid, oppedge, directededge,
-                  newcost, sortcost, dist, mode_, tc,
+                  newcost, sortcost, dist, mode_,
                   (pred.not_thru_pruning() || !directededge->not_thru()));
+    transitions_forward_.push_back(tc);
     adjacencylist_forward_->add(idx);
   }
 }
 
 // Expand from a node in reverse direction.
+template <class cost_t>
 void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
          const GraphId& node, const BDEdgeLabel& pred, const uint32_t pred_idx,
          const DirectedEdge* opp_pred_edge, const bool from_transition) {
+  // Costing of the concrete class this expansion is instantiated for
+  const StaticCost<cost_t> costing(*costing_);
+
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
   const GraphTile* tile = graphreader.GetGraphTile(node);
@@ -226,7 +307,7 @@ void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     return;
   }
   const NodeInfo* nodeinfo = tile->node(node);
-  if (!costing_->Allowed(nodeinfo)) {
+  if (!costing.Allowed(nodeinfo)) {
     return;
   }
 
@@ -234,29 +315,31 @@ void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
   uint32_t shortcuts = 0;
   GraphId edgeid = { node.tileid(), node.level(), nodeinfo->edge_index() };
   const DirectedEdge* directededge = tile->directededge(edgeid);
-  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++edgeid) {
+  const HotEdge* hotedge = tile->hotedge(edgeid.id());
+  for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++directededge, ++hotedge, ++edgeid) {
     // Handle transition edges - expand from the end not of the transition
     // unless this is called from a transition.
-    if (directededge->trans_up()) {
+    if (hotedge->trans_up()) {
       if (!from_transition) {
         hierarchy_limits_reverse_[node.level()].up_transition_count++;
-        ExpandReverse(graphreader, directededge->endnode(), pred, pred_idx,
+        ExpandReverse<cost_t>(graphreader, hotedge->endnode(), pred, pred_idx,
                       opp_pred_edge, true);
       }
       continue;
-    } else if (directededge->trans_down()) {
+    } else if (hotedge->trans_down()) {
       if (!from_transition &&
-          !hierarchy_limits_reverse_[directededge->endnode().level()].StopExpanding()) {
-        ExpandReverse(graphreader, directededge->endnode(), pred, pred_idx,
+          !hierarchy_limits_reverse_[hotedge->endnode().level()].StopExpanding()) {
+        ExpandReverse<cost_t>(graphreader, hotedge->endnode(), pred, pred_idx,
                       opp_pred_edge, true);
       }
       continue;
     }
 
     // Quick check to skip if no access for this mode or if edge is
-    // superseded by a shortcut edge that was taken.
-    if (!(directededge->reverseaccess() & access_mode_) ||
-         (shortcuts & directededge->superseded())) {
+    // superseded by a shortcut edge that was taken. These only need the
+    // hot edge, the directed edge isn't touched until it is worth costing.
+    if (!(hotedge->reverseaccess() & access_mode_) ||
+         (shortcuts & hotedge->superseded())) {
       continue;
     }
 
@@ -278,8 +361,8 @@ void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
 
     // Skip this edge if no access is allowed (based on costing method)
     // or if a complex restriction prevents transition onto this edge.
-    if (!costing_->AllowedReverse(directededge, pred, opp_edge, t2, oppedge) ||
-         costing_->Restricted(directededge, pred, edgelabels_reverse_, tile,
+    if (!costing.AllowedReverse(directededge, pred, opp_edge, t2, oppedge) ||
+         costing.Restricted(directededge, pred, edgelabels_reverse_, tile,
                                      edgeid, false)) {
       continue;
     }
@@ -293,9 +376,11 @@ void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
         hierarchy_limits_reverse_[edgeid.level()+1].StopExpanding()) {
       shortcuts |= directededge->shortcut();
     }
-    Cost tc = costing_->TransitionCostReverse(directededge->localedgeidx(),
+    Cost tc = costing.TransitionCostReverse(directededge->localedgeidx(),
                              nodeinfo, opp_edge, opp_pred_edge);
-    Cost newcost = pred.cost() + costing_->EdgeCost(opp_edge);
+    Cost newcost = pred.cost() +
+        costing.TrafficCost(opp_edge, costing.EdgeCost(opp_edge),
+                            graphreader.GetTrafficSpeeds(oppedge)[oppedge.id()]);
     newcost.cost += tc.cost;
 
     // Check if edge is temporarily labeled and this path has less cost. If
@@ -306,7 +391,8 @@ void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
       if (newcost.cost < lab.cost().cost ) {
         float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
         adjacencylist_reverse_->decrease(edgestatus.index(), newsortcost);
-        lab.Update(pred_idx, newcost, newsortcost, tc);
+        lab.Update(pred_idx, newcost, newsortcost);
+        transitions_reverse_[edgestatus.index()] = tc;
       }
       continue;
     }
@@ -314,15 +400,16 @@ void BidirectionalAStar::ExpandReverse(GraphReader& graphreader,
     // Find the sort cost (with A* heuristic) using the lat,lng at the
     // end node of the directed edge.
     float dist = 0.0f;
-    float sortcost = newcost.cost + astarheuristic_reverse_.Get(
+    float sortcost = newcost.cost + astarheuristic_reverse_.Get(directededge->endnode(),
        t2->node(directededge->endnode())->latlng(), dist);
 
     // Add edge label, add to the adjacency list and set edge status
     uint32_t idx = edgelabels_reverse_.size();
     edgestatus_reverse_->Set(edgeid, EdgeSet::kTemporary, idx);
     edgelabels_reverse_.emplace_back(pred_idx, edgeid, oppedge,
-                 directededge, newcost, sortcost, dist, mode_, tc,
+                 directededge, newcost, sortcost, dist, mode_,
                  (pred.not_thru_pruning() || !directededge->not_thru()));
+    transitions_reverse_.push_back(tc);
     adjacencylist_reverse_->add(idx);
   }
 }
@@ -338,12 +425,31 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   travel_type_ = costing_->travel_type();
   access_mode_ = costing_->access_mode();
+  SetExpansion();
 
   // Initialize - create adjacency list, edgestatus support, A*, etc.
   PointLL origin_new(origin.path_edges(0).ll().lng(), origin.path_edges(0).ll().lat());
   PointLL destination_new(destination.path_edges(0).ll().lng(), destination.path_edges(0).ll().lat());
   Init(origin_new, destination_new);
 
+  // Bound the costs with the landmarks: the forward search goes to the
+  // start nodes of the destination edges and the reverse search comes
+  // from the end nodes of the origin edges
+  if (landmarks_) {
+    std::vector<GraphId> targets;
+    for (const auto& edge : destination.path_edges())
+      targets.push_back(graphreader.edge_startnode(GraphId(edge.graph_id())));
+    astarheuristic_forward_.SetLandmarks(landmarks_.get(), targets, false);
+    targets.clear();
+    for (const auto& edge : origin.path_edges())
+      targets.push_back(graphreader.edge_endnode(GraphId(edge.graph_id())));
+    astarheuristic_reverse_.SetLandmarks(landmarks_.get(), targets, true);
+  }
+
+  // Start loading the tiles between the locations before the two searches
+  // reach them
+  graphreader.PrefetchAlong(origin_new, destination_new);
+
   // Set origin and destination locations - seeds the adj. lists
   // Note: because we can correlate to more than one place for a given
   // PathLocation using edges.front here means we are only setting the
@@ -352,6 +458,10 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
   SetOrigin(graphreader, origin);
   SetDestination(graphreader, destination);
 
+  // Each search makes its upward transitions leaving its own location
+  ScaleHierarchyLimits(graphreader, origin_new, true, false, hierarchy_limits_forward_);
+  ScaleHierarchyLimits(graphreader, destination_new, true, false, hierarchy_limits_reverse_);
+
   // Find shortest path. Switch between a forward direction and a reverse
   // direction search based on the current costs. Alternating like this
   // prevents one tree from expanding much more quickly (if in a sparser
@@ -380,7 +490,7 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
         // settled edge on the reverse search tree.
         pred = edgelabels_forward_[forward_pred_idx];
         if (edgestatus_reverse_->Get(pred.opp_edgeid()).set() == EdgeSet::kPermanent) {
-          SetForwardConnection(pred);
+          SetForwardConnection(pred, forward_pred_idx);
         }
       } else {
         // Search is exhausted. If a connection has been found, return it
@@ -402,7 +512,7 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
         // settled edge on the forward search tree.
         pred2 = edgelabels_reverse_[reverse_pred_idx];
         if (edgestatus_forward_->Get(pred2.opp_edgeid()).set() == EdgeSet::kPermanent) {
-          SetReverseConnection(pred2);
+          SetReverseConnection(pred2, reverse_pred_idx);
         }
       } else {
         // Search is exhausted. If a connection has been found, return it
@@ -418,12 +528,21 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
       }
     }
 
-    // Terminate some number of iterations after an initial connection
-    // has been found. This is not ideal, probably needs to be based on
-    // the max edge cost but that has performance limitations,
-    // so for now we use this bit of a hack...stay tuned.
+    // Once a connection has been found the search can stop when either
+    // direction can no longer improve on it: the sort costs of the labels
+    // left to expand in that direction (the pending predecessor and the
+    // adjacency list) are lower bounds on the cost of any path through them.
+    // Alternates still need the connections found after the best one, so
+    // they terminate some number of iterations after the initial connection.
     if (best_connection_.cost < std::numeric_limits<float>::max()) {
-      if (edgelabels_forward_.size() + edgelabels_reverse_.size() > threshold_) {
+      if (alternates_ > 0) {
+        if (edgelabels_forward_.size() + edgelabels_reverse_.size() > threshold_) {
+          return FormPath(graphreader);
+        }
+      } else if (std::min(pred.sortcost(), adjacencylist_forward_->min_cost()) >=
+                     best_connection_.cost ||
+                 std::min(pred2.sortcost(), adjacencylist_reverse_->min_cost()) >=
+                     best_connection_.cost) {
         return FormPath(graphreader);
       }
     }
@@ -446,7 +565,7 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
       }
 
       // Expand from the end node in forward direction.
-      ExpandForward(graphreader, pred.endnode(), pred, forward_pred_idx, false);
+      (this->*expand_forward_)(graphreader, pred.endnode(), pred, forward_pred_idx, false);
     } else {
       // Expand reverse - set to get next edge from reverse adj. list
       // on the next pass
@@ -468,7 +587,7 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
         graphreader.GetGraphTile(pred2.opp_edgeid())->directededge(pred2.opp_edgeid());
 
       // Expand from the end node in reverse direction.
-      ExpandReverse(graphreader, pred2.endnode(), pred2, reverse_pred_idx,
+      (this->*expand_reverse_)(graphreader, pred2.endnode(), pred2, reverse_pred_idx,
                     opp_pred_edge, false);
     }
   }
@@ -478,7 +597,7 @@ std::vector<PathInfo> BidirectionalAStar::GetBestPath(odin::Location& origin,
 // The edge on the forward search connects to a reached edge on the reverse
 // search tree. Check if this is the best connection so far and set the
 // search threshold.
-void BidirectionalAStar::SetForwardConnection(const BDEdgeLabel& pred) {
+void BidirectionalAStar::SetForwardConnection(const BDEdgeLabel& pred, const uint32_t pred_idx) {
   // Disallow connections that are part of a complex restriction.
   // TODO - validate that we do not need to "walk" the paths forward
   // and backward to see if they match a restriction.
@@ -486,9 +605,14 @@ void BidirectionalAStar::SetForwardConnection(const BDEdgeLabel& pred) {
     return;
   }
 
-  // Set a threshold to extend search
+  // Set a threshold to extend search. Search as far again past the first
+  // connection when alternates are wanted so the trees meet in more places.
   if (threshold_ == 0) {
-    threshold_ = GetThreshold(mode_, edgelabels_forward_.size() + edgelabels_reverse_.size());
+    uint32_t n = edgelabels_forward_.size() + edgelabels_reverse_.size();
+    threshold_ = GetThreshold(mode_, n);
+    if (alternates_ > 0) {
+      threshold_ += threshold_ - n;
+    }
   }
 
   // Get the opposing edge - a candidate shortest path has been found to the
@@ -502,7 +626,7 @@ void BidirectionalAStar::SetForwardConnection(const BDEdgeLabel& pred) {
     // plus the transition cost.
     c = edgelabels_forward_[pred.predecessor()].cost().cost +
         edgelabels_reverse_[oppedgestatus.index()].cost().cost +
-        pred.transition_cost();
+        transitions_forward_[pred_idx].cost;
     } else {
      // If no predecessor on the forward path get the predecessor on
      // the reverse path to form the cost.
@@ -510,19 +634,22 @@ void BidirectionalAStar::SetForwardConnection(const BDEdgeLabel& pred) {
      float oppcost = (predidx == kInvalidLabel) ?
            0 : edgelabels_reverse_[predidx].cost().cost;
      c = pred.cost().cost + oppcost +
-         edgelabels_reverse_[oppedgestatus.index()].transition_cost();
+         transitions_reverse_[oppedgestatus.index()].cost;
     }
 
     // Set best_connection if cost is less than the best cost so far.
     if (c < best_connection_.cost) {
       best_connection_ = { pred.edgeid(), oppedge, c };
     }
+    if (alternates_ > 0) {
+      connections_.push_back({ pred.edgeid(), oppedge, c });
+    }
 }
 
 // The edge on the reverse search connects to a reached edge on the forward
 // search tree. Check if this is the best connection so far and set the
 // search threshold.
-void BidirectionalAStar::SetReverseConnection(const BDEdgeLabel& pred) {
+void BidirectionalAStar::SetReverseConnection(const BDEdgeLabel& pred, const uint32_t pred_idx) {
   // Disallow connections that are part of a complex restriction.
   // TODO - validate that we do not need to "walk" the paths forward
   // and backward to see if they match a restriction.
@@ -530,9 +657,14 @@ void BidirectionalAStar::SetReverseConnection(const BDEdgeLabel& pred) {
     return;
   }
 
-  // Set a threshold to extend search
+  // Set a threshold to extend search. Search as far again past the first
+  // connection when alternates are wanted so the trees meet in more places.
   if (threshold_ == 0) {
-    threshold_ = GetThreshold(mode_, edgelabels_forward_.size() + edgelabels_reverse_.size());
+    uint32_t n = edgelabels_forward_.size() + edgelabels_reverse_.size();
+    threshold_ = GetThreshold(mode_, n);
+    if (alternates_ > 0) {
+      threshold_ += threshold_ - n;
+    }
   }
 
   // Get the opposing edge - a candidate shortest path has been found to the
@@ -546,7 +678,7 @@ void BidirectionalAStar::SetReverseConnection(const BDEdgeLabel& pred) {
     // plus the transition cost.
     c = edgelabels_reverse_[pred.predecessor()].cost().cost +
         edgelabels_forward_[oppedgestatus.index()].cost().cost +
-        pred.transition_cost();
+        transitions_reverse_[pred_idx].cost;
   } else {
     // If no predecessor on the reverse path get the predecessor on
     // the forward path to form the cost.
@@ -554,13 +686,16 @@ void BidirectionalAStar::SetReverseConnection(const BDEdgeLabel& pred) {
     float oppcost = (predidx == kInvalidLabel) ?
           0 : edgelabels_forward_[predidx].cost().cost;
     c = pred.cost().cost + oppcost +
-        edgelabels_forward_[oppedgestatus.index()].transition_cost();
+        transitions_forward_[oppedgestatus.index()].cost;
   }
 
   // Set best_connection if cost is less than the best cost so far.
   if (c < best_connection_.cost) {
     best_connection_ = { oppedge, pred.edgeid(), c };
   }
+  if (alternates_ > 0) {
+    connections_.push_back({ oppedge, pred.edgeid(), c });
+  }
 }
 
 // Add edges at the origin to the forward adjacency list.
@@ -610,6 +745,7 @@ void BidirectionalAStar::SetOrigin(GraphReader& graphreader,
     edgestatus_forward_->Set(edgeid, EdgeSet::kTemporary, idx);
     edgelabels_forward_.emplace_back(kInvalidLabel, edgeid, directededge, cost,
                                      sortcost, dist, mode_);
+    transitions_forward_.emplace_back();
     adjacencylist_forward_->add(idx);
 
     // Set the initial not_thru flag to false. There is an issue with not_thru
@@ -635,7 +771,6 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
   });
 
   // Iterate through edges and add to adjacency list
-  Cost c;
   for (const auto& edge : dest.path_edges()) {
     // If the destination is at a node, skip any outbound edges (so any
     // opposing inbound edges are not considered)
@@ -676,7 +811,8 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
     uint32_t idx = edgelabels_reverse_.size();
     edgestatus_reverse_->Set(opp_edge_id, EdgeSet::kTemporary, idx);
     edgelabels_reverse_.emplace_back(kInvalidLabel, opp_edge_id, edgeid,
-             opp_dir_edge, cost, sortcost, dist, mode_, c, false);
+             opp_dir_edge, cost, sortcost, dist, mode_, false);
+    transitions_reverse_.emplace_back();
     adjacencylist_reverse_->add(idx);
 
     // Set the initial not_thru flag to false. There is an issue with not_thru
@@ -685,11 +821,84 @@ void BidirectionalAStar::SetDestination(GraphReader& graphreader,
   }
 }
 
+// Form alternate paths from the connections between the search trees.
+std::vector<std::vector<PathInfo>> BidirectionalAStar::GetAlternatePaths(
+    GraphReader& graphreader, const std::vector<PathInfo>& best_path) {
+  std::vector<std::vector<PathInfo>> alternates;
+  if (alternates_ == 0 || best_path.empty() ||
+      best_connection_.cost == std::numeric_limits<float>::max()) {
+    return alternates;
+  }
+
+  // Forming paths sets the ferry flag, keep the one of the best path
+  bool has_ferry = has_ferry_;
+
+  auto edge_length = [&graphreader](const GraphId& edgeid) {
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    return (tile == nullptr) ? 0 : tile->directededge(edgeid)->length();
+  };
+
+  // Edges on the paths kept so far and on every path formed so far
+  std::unordered_set<GraphId> kept, formed;
+  for (const auto& p : best_path) {
+    kept.insert(p.edgeid);
+    formed.insert(p.edgeid);
+  }
+
+  // Check the cheapest connections first
+  std::sort(connections_.begin(), connections_.end(),
+    [](const CandidateConnection& a, const CandidateConnection& b) {
+      return a.cost < b.cost;
+    });
+  float max_cost = best_connection_.cost * (1.0f + kAlternateMaxStretch);
+  uint32_t candidates = alternates_ * kAlternateCandidatesPerPath;
+  for (const auto& connection : connections_) {
+    if (connection.cost > max_cost || candidates == 0 ||
+        alternates.size() == alternates_) {
+      break;
+    }
+    if (formed.count(connection.edgeid) > 0) {
+      continue;
+    }
+    --candidates;
+
+    // Measure how much of the path is on the paths kept so far, rejecting
+    // paths that use an edge more than once
+    auto path = FormPath(graphreader, connection);
+    std::unordered_set<GraphId> edges;
+    uint64_t length = 0, shared = 0;
+    bool repeats = false;
+    for (const auto& p : path) {
+      formed.insert(p.edgeid);
+      repeats = repeats || !edges.insert(p.edgeid).second;
+      uint32_t l = edge_length(p.edgeid);
+      length += l;
+      if (kept.count(p.edgeid) > 0) {
+        shared += l;
+      }
+    }
+    if (repeats || length == 0 || shared > kAlternateMaxSharing * length) {
+      continue;
+    }
+
+    kept.insert(edges.begin(), edges.end());
+    alternates.emplace_back(std::move(path));
+  }
+  has_ferry_ = has_ferry;
+  return alternates;
+}
+
 // Form the path from the adjacency list.
 std::vector<PathInfo> BidirectionalAStar::FormPath(GraphReader& graphreader) {
+  return FormPath(graphreader, best_connection_);
+}
+
+// Form the path through a connection between the search trees.
+std::vector<PathInfo> BidirectionalAStar::FormPath(GraphReader& graphreader,
+                                  const CandidateConnection& connection) {
   // Get the indexes where the connection occurs.
-  uint32_t idx1 = edgestatus_forward_->Get(best_connection_.edgeid).index();
-  uint32_t idx2 = edgestatus_reverse_->Get(best_connection_.opp_edgeid).index();
+  uint32_t idx1 = edgestatus_forward_->Get(connection.edgeid).index();
+  uint32_t idx2 = edgestatus_reverse_->Get(connection.opp_edgeid).index();
 
   // Metrics (TODO - more accurate cost)
   uint32_t pathcost = edgelabels_forward_[idx1].cost().cost +
@@ -734,7 +943,7 @@ std::vector<PathInfo> BidirectionalAStar::FormPath(GraphReader& graphreader) {
   float secs = path.back().elapsed_time;
 
   // Get the transition cost at the last edge of the reverse path
-  float tc = edgelabels_reverse_[idx2].transition_secs();
+  float tc = transitions_reverse_[idx2].secs;
 
   // Append the reverse path from the destination - use opposing edges
   // The first edge on the reverse path is the same as the last on the forward
@@ -761,8 +970,8 @@ std::vector<PathInfo> BidirectionalAStar::FormPath(GraphReader& graphreader) {
     }
 
     // Update edgelabel_index and transition cost to apply at next iteration
+    tc = transitions_reverse_[edgelabel_index].secs;
     edgelabel_index = predidx;
-    tc = edgelabel.transition_secs();
   }
   return path;
 }
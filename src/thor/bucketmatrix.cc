@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include "midgard/logging.h"
+#include "midgard/util.h"
+#include "thor/bucketmatrix.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+
+namespace {
+
+using namespace valhalla::thor;
+
+// Search label of a node
+struct label_t {
+  float cost;
+  float secs;
+  float length;
+  bool seed;      // Whether no arc has been taken to get here
+};
+
+// A target's label at a node it settled
+struct entry_t {
+  uint32_t node;
+  uint32_t target;
+  label_t label;
+};
+
+using labels_t = std::unordered_map<uint32_t, label_t>;
+
+// Settle every node up the hierarchy from the seeds, going forward from a
+// source or backward from a target
+void Search(const CHGraph& graph, const std::vector<BucketMatrix::Seed>& seeds,
+            const bool forward, labels_t& labels) {
+  using queue_entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<queue_entry_t, std::vector<queue_entry_t>,
+                      std::greater<queue_entry_t> > queue;
+  labels.clear();
+  for (const auto& seed : seeds) {
+    auto label = labels.find(seed.node);
+    if (label == labels.end() || seed.cost < label->second.cost) {
+      labels[seed.node] = {seed.cost, seed.secs, seed.length, true};
+      queue.emplace(seed.cost, seed.node);
+    }
+  }
+  while (!queue.empty()) {
+    float cost = queue.top().first;
+    uint32_t node = queue.top().second;
+    queue.pop();
+    const label_t pred = labels[node];
+    if (cost > pred.cost)
+      continue;
+    for (const auto& arc : forward ? graph.forward(node) : graph.backward(node)) {
+      float c = cost + arc.cost;
+      auto label = labels.find(arc.node);
+      if (label == labels.end() || c < label->second.cost) {
+        labels[arc.node] = {c, pred.secs + arc.secs, pred.length + arc.length, false};
+        queue.emplace(c, arc.node);
+      }
+    }
+  }
+}
+
+// Run work(index) for every index below count on up to max_threads threads
+void Parallel(const size_t count, const uint32_t max_threads,
+              const std::function<void (size_t)>& work) {
+  std::atomic<size_t> next(0);
+  const auto run = [&next, count, &work]() {
+    for (size_t i = next++; i < count; i = next++)
+      work(i);
+  };
+  size_t thread_count = std::max<size_t>(1, std::min<size_t>(max_threads, count));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(run);
+  run();
+  for (auto& thread : threads)
+    thread.join();
+}
+
+bool equals(const valhalla::odin::LatLng& a, const valhalla::odin::LatLng&b) {
+  return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
+      (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
+}
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+BucketMatrix::BucketMatrix(const std::shared_ptr<const CHGraph>& graph,
+                           const uint32_t max_threads)
+    : graph_(graph),
+      max_threads_(max_threads ? max_threads :
+                   std::max(1u, std::thread::hardware_concurrency())) {
+}
+
+// Form a time distance matrix from the set of source locations
+// to the set of target locations.
+std::vector<TimeDistance> BucketMatrix::SourceToTarget(
+        const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+        const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+        GraphReader& graphreader,
+        const std::shared_ptr<DynamicCost>* mode_costing,
+        const TravelMode mode, const float max_matrix_distance) {
+  // The graph reader isn't shared between threads so seed them all up front
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+  std::vector<std::vector<Seed> > sources, targets;
+  for (const auto& location : source_location_list)
+    sources.emplace_back(Seeds(location, graphreader, costing, true));
+  for (const auto& location : target_location_list)
+    targets.emplace_back(Seeds(location, graphreader, costing, false));
+  auto connections = Connect(sources, targets);
+
+  // Locations that are the same are 0 apart, otherwise leave out what is
+  // too long to be in the matrix
+  std::vector<TimeDistance> td;
+  td.reserve(connections.size());
+  for (uint32_t i = 0; i < sources.size(); ++i) {
+    for (uint32_t j = 0; j < targets.size(); ++j) {
+      const auto& connection = connections[i * targets.size() + j];
+      if (equals(source_location_list.Get(i).ll(), target_location_list.Get(j).ll())) {
+        td.emplace_back(0, 0);
+      } else if (connection.cost == kMaxCost || connection.length > max_matrix_distance) {
+        td.emplace_back(kMaxCost, kMaxCost);
+      } else {
+        td.emplace_back(std::round(connection.secs), std::round(connection.length));
+      }
+    }
+  }
+  return td;
+}
+
+// Find the cheapest connections between all the sources and targets
+std::vector<BucketMatrix::Connection> BucketMatrix::Connect(
+        const std::vector<std::vector<Seed> >& sources,
+        const std::vector<std::vector<Seed> >& targets) const {
+  std::vector<Connection> connections(sources.size() * targets.size(),
+                                      Connection{kMaxCost, kMaxCost, kMaxCost});
+  if (!graph_)
+    return connections;
+
+  // Search backward from each target, keeping the labels of each apart
+  std::vector<std::vector<entry_t> > target_entries(targets.size());
+  Parallel(targets.size(), max_threads_, [this, &targets, &target_entries](size_t j) {
+    labels_t labels;
+    Search(*graph_, targets[j], false, labels);
+    auto& entries = target_entries[j];
+    entries.reserve(labels.size());
+    for (const auto& label : labels)
+      entries.push_back({label.first, static_cast<uint32_t>(j), label.second});
+  });
+
+  // Put them in buckets by node, by target within a node
+  std::vector<entry_t> entries;
+  for (auto& e : target_entries) {
+    entries.insert(entries.end(), e.begin(), e.end());
+    std::vector<entry_t>().swap(e);
+  }
+  std::sort(entries.begin(), entries.end(), [](const entry_t& a, const entry_t& b) {
+    return a.node == b.node ? a.target < b.target : a.node < b.node;
+  });
+  std::unordered_map<uint32_t, std::pair<size_t, size_t> > buckets;
+  for (size_t i = 0; i < entries.size(); ) {
+    size_t end = i + 1;
+    while (end < entries.size() && entries[end].node == entries[i].node)
+      ++end;
+    buckets.emplace(entries[i].node, std::make_pair(i, end));
+    i = end;
+  }
+  LOG_DEBUG("Bucket matrix entries: " + std::to_string(entries.size()));
+
+  // Search forward from each source, meeting the targets in the buckets of
+  // the nodes it settles. Each source fills in its own row.
+  Parallel(sources.size(), max_threads_,
+           [this, &sources, &targets, &entries, &buckets, &connections](size_t i) {
+    labels_t labels;
+    Search(*graph_, sources[i], true, labels);
+    Connection* row = connections.data() + i * targets.size();
+    for (const auto& label : labels) {
+      auto bucket = buckets.find(label.first);
+      if (bucket == buckets.end())
+        continue;
+      for (size_t e = bucket->second.first; e < bucket->second.second; ++e) {
+        const auto& entry = entries[e];
+        // Meeting where both started is only a path if the target is ahead
+        // of the source on the same edge
+        float length = label.second.length + entry.label.length;
+        if (label.second.seed && entry.label.seed && length < 0.0f)
+          continue;
+        float cost = label.second.cost + entry.label.cost;
+        auto& connection = row[entry.target];
+        if (cost < connection.cost) {
+          connection = {cost, label.second.secs + entry.label.secs, length};
+        }
+      }
+    }
+  });
+  return connections;
+}
+
+// Constructor
+SweepMatrix::SweepMatrix(const std::shared_ptr<const CHGraph>& graph,
+                         const uint32_t max_threads)
+    : BucketMatrix(graph, max_threads) {
+}
+
+// Find the cheapest connections between all the sources and targets with
+// one pass down the picked part of the overlay per source
+std::vector<BucketMatrix::Connection> SweepMatrix::Connect(
+        const std::vector<std::vector<Seed> >& sources,
+        const std::vector<std::vector<Seed> >& targets) const {
+  std::vector<Connection> connections(sources.size() * targets.size(),
+                                      Connection{kMaxCost, kMaxCost, kMaxCost});
+  if (!graph_)
+    return connections;
+
+  // Pick every node above the targets in post order, so a node only comes
+  // after all the higher ranked nodes it has arcs from. A node has no
+  // position until all of those are placed.
+  std::unordered_map<uint32_t, uint32_t> local;
+  std::vector<uint32_t> order;
+  std::vector<std::pair<uint32_t, bool> > stack;
+  for (const auto& seeds : targets) {
+    for (const auto& seed : seeds)
+      stack.emplace_back(seed.node, false);
+  }
+  while (!stack.empty()) {
+    auto top = stack.back();
+    stack.pop_back();
+    if (top.second) {
+      local[top.first] = order.size();
+      order.push_back(top.first);
+      continue;
+    }
+    if (!local.emplace(top.first, kInvalidCHNode).second)
+      continue;
+    stack.emplace_back(top.first, true);
+    for (const auto& arc : graph_->backward(top.first)) {
+      if (local.find(arc.node) == local.cend())
+        stack.emplace_back(arc.node, false);
+    }
+  }
+
+  // The arcs into each picked node, from picked nodes by their position
+  std::vector<uint32_t> offsets(1, 0);
+  std::vector<CHArc> arcs;
+  offsets.reserve(order.size() + 1);
+  for (auto node : order) {
+    for (auto arc : graph_->backward(node)) {
+      arc.node = local[arc.node];
+      arcs.push_back(arc);
+    }
+    offsets.push_back(arcs.size());
+  }
+  LOG_DEBUG("Sweep matrix nodes: " + std::to_string(order.size()) +
+            " arcs: " + std::to_string(arcs.size()));
+
+  // Each thread sweeps its share of the sources with its own labels, the
+  // labels up from the source apart from those down the pass so that a
+  // target on the edge of the source can still be reached the long way
+  size_t thread_count = std::max<size_t>(1, std::min<size_t>(max_threads_, sources.size()));
+  Parallel(thread_count, thread_count, [&](size_t t) {
+    const label_t none{kMaxCost, kMaxCost, kMaxCost, false};
+    std::vector<label_t> up(order.size()), down(order.size());
+    labels_t labels;
+    for (size_t i = t; i < sources.size(); i += thread_count) {
+      std::fill(up.begin(), up.end(), none);
+      std::fill(down.begin(), down.end(), none);
+      Search(*graph_, sources[i], true, labels);
+      for (const auto& label : labels) {
+        auto found = local.find(label.first);
+        if (found != local.cend())
+          up[found->second] = label.second;
+      }
+      for (size_t v = 0; v < order.size(); ++v) {
+        label_t& best = down[v];
+        for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a) {
+          const CHArc& arc = arcs[a];
+          const label_t& from = up[arc.node].cost < down[arc.node].cost ? up[arc.node] : down[arc.node];
+          float c = from.cost + arc.cost;
+          if (from.cost != kMaxCost && c < best.cost)
+            best = {c, from.secs + arc.secs, from.length + arc.length, false};
+        }
+      }
+
+      // Each target is settled at its seeds, the way along the first edge
+      // only counting if the target is ahead of the source
+      Connection* row = connections.data() + i * targets.size();
+      for (size_t j = 0; j < targets.size(); ++j) {
+        for (const auto& seed : targets[j]) {
+          uint32_t v = local[seed.node];
+          for (const label_t* label : {&up[v], &down[v]}) {
+            if (label->cost == kMaxCost)
+              continue;
+            float length = label->length + seed.length;
+            if (label->seed && length < 0.0f)
+              continue;
+            float cost = label->cost + seed.cost;
+            if (cost < row[j].cost)
+              row[j] = {cost, label->secs + seed.secs, length};
+          }
+        }
+      }
+    }
+  });
+  return connections;
+}
+
+// Seed the search of a location the same way the contraction hierarchy
+// path algorithm does
+std::vector<BucketMatrix::Seed> BucketMatrix::Seeds(const odin::Location& location,
+        GraphReader& graphreader, const std::shared_ptr<DynamicCost>& costing,
+        const bool source) const {
+  // Only skip inbound (or outbound) edges if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : location.path_edges())
+    has_other_edges = has_other_edges || !(source ? edge.end_node() : edge.begin_node());
+
+  std::vector<Seed> seeds;
+  for (const auto& edge : location.path_edges()) {
+    if (has_other_edges && (source ? edge.end_node() : edge.begin_node()))
+      continue;
+    GraphId edgeid(edge.graph_id());
+    uint32_t node = graph_ ? graph_->node(edgeid) : kInvalidCHNode;
+    const DirectedEdge* directededge = graphreader.directededge(edgeid);
+    if (node == kInvalidCHNode || directededge == nullptr)
+      continue;
+
+    // What is left of the edge past the location
+    float remainder = 1.0f - edge.percent_along();
+    Cost cost = costing->EdgeCost(directededge) * remainder;
+    float length = directededge->length() * remainder;
+    if (source)
+      seeds.push_back({node, cost.cost + edge.distance(), cost.secs, length});
+    else
+      seeds.push_back({node, edge.distance() - cost.cost, -cost.secs, -length});
+  }
+  return seeds;
+}
+
+}
+}
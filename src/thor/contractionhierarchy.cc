@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include "midgard/logging.h"
+#include "thor/contractionhierarchy.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+ContractionHierarchy::ContractionHierarchy()
+    : PathAlgorithm() {
+}
+
+// Destructor
+ContractionHierarchy::~ContractionHierarchy() {
+  Clear();
+}
+
+// Clear the temporary information generated during path construction.
+void ContractionHierarchy::Clear() {
+  forward_.clear();
+  reverse_.clear();
+  forward_queue_ = queue_t();
+  reverse_queue_ = queue_t();
+}
+
+// Cheapest path between the sources and targets over the overlay. The
+// forward search climbs the forward arcs from the sources, the reverse search
+// the backward arcs from the targets, and the path goes through the node
+// where their costs add up to the least.
+float ContractionHierarchy::Search(const std::vector<std::pair<uint32_t, float> >& sources,
+                                   const std::vector<std::pair<uint32_t, float> >& targets,
+                                   std::vector<std::pair<uint32_t, float> >& path) {
+  Clear();
+  path.clear();
+  if (!graph_)
+    return -1.0f;
+
+  // Seed both searches
+  float min_source = std::numeric_limits<float>::max();
+  float min_target = std::numeric_limits<float>::max();
+  const auto seed = [](const std::pair<uint32_t, float>& s,
+                       std::unordered_map<uint32_t, label_t>& labels, queue_t& queue) {
+    auto label = labels.find(s.first);
+    if (label == labels.end() || s.second < label->second.cost) {
+      labels[s.first] = {s.second, kInvalidCHNode, {}};
+      queue.emplace(s.second, s.first);
+    }
+  };
+  for (const auto& s : sources) {
+    seed(s, forward_, forward_queue_);
+    min_source = std::min(min_source, s.second);
+  }
+  for (const auto& t : targets) {
+    seed(t, reverse_, reverse_queue_);
+    min_target = std::min(min_target, t.second);
+  }
+
+  // A node on the best path may be reached by one search with a cost above
+  // the best cost when the other search started below zero, so each search
+  // keeps going that much past the best cost found so far
+  float forward_slack = std::max(0.0f, -min_target);
+  float reverse_slack = std::max(0.0f, -min_source);
+  float best = std::numeric_limits<float>::max();
+  uint32_t meet = kInvalidCHNode;
+  size_t n = 0;
+  while (true) {
+    bool forward_done = forward_queue_.empty() ||
+                        forward_queue_.top().first > best + forward_slack;
+    bool reverse_done = reverse_queue_.empty() ||
+                        reverse_queue_.top().first > best + reverse_slack;
+    if (forward_done && reverse_done)
+      break;
+
+    // Allow this process to be aborted
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    // Expand whichever search is behind
+    bool forward = !forward_done &&
+        (reverse_done || forward_queue_.top().first <= reverse_queue_.top().first);
+    auto& queue = forward ? forward_queue_ : reverse_queue_;
+    auto& labels = forward ? forward_ : reverse_;
+    const auto& other = forward ? reverse_ : forward_;
+    float cost = queue.top().first;
+    uint32_t node = queue.top().second;
+    queue.pop();
+    if (cost > labels[node].cost)
+      continue;
+
+    // Did the searches meet here
+    auto met = other.find(node);
+    if (met != other.end() && cost + met->second.cost < best) {
+      best = cost + met->second.cost;
+      meet = node;
+    }
+
+    // Relax the arcs up the hierarchy
+    auto arcs = forward ? graph_->forward(node) : graph_->backward(node);
+    for (const auto& arc : arcs) {
+      float c = cost + arc.cost;
+      auto label = labels.find(arc.node);
+      if (label == labels.end() || c < label->second.cost) {
+        labels[arc.node] = {c, node, arc};
+        queue.emplace(c, arc.node);
+      }
+    }
+  }
+  if (meet == kInvalidCHNode)
+    return -1.0f;
+
+  // Collect the arcs from the source up to the meeting node and from there
+  // down to the target, all in their travel direction
+  std::vector<std::tuple<uint32_t, uint32_t, CHArc> > arcs;
+  uint32_t source = meet;
+  for (auto label = &forward_[meet]; label->pred != kInvalidCHNode;
+       label = &forward_[label->pred]) {
+    arcs.emplace_back(label->pred, source, label->arc);
+    source = label->pred;
+  }
+  std::reverse(arcs.begin(), arcs.end());
+  uint32_t node = meet;
+  for (auto label = &reverse_[meet]; label->pred != kInvalidCHNode;
+       label = &reverse_[label->pred]) {
+    arcs.emplace_back(node, label->pred, label->arc);
+    node = label->pred;
+  }
+
+  // Unpack the shortcuts
+  path.emplace_back(source, 0.0f);
+  for (const auto& arc : arcs)
+    graph_->Unpack(std::get<0>(arc), std::get<1>(arc), std::get<2>(arc), path);
+  return best;
+}
+
+// Form the path from the origin to the destination over the overlay
+std::vector<PathInfo> ContractionHierarchy::GetBestPath(odin::Location& origin,
+           odin::Location& destination, GraphReader& graphreader,
+           const std::shared_ptr<DynamicCost>* mode_costing,
+           const TravelMode mode) {
+  has_ferry_ = false;
+  if (!graph_)
+    return {};
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+
+  // Seed the forward search with the rest of each origin edge. Only skip
+  // inbound edges if we have other options.
+  bool has_other_edges = false;
+  for (const auto& edge : origin.path_edges())
+    has_other_edges = has_other_edges || !edge.end_node();
+  std::vector<std::pair<uint32_t, float> > sources;
+  std::unordered_map<uint32_t, float> source_secs;
+  for (const auto& edge : origin.path_edges()) {
+    if (has_other_edges && edge.end_node())
+      continue;
+    GraphId edgeid(edge.graph_id());
+    uint32_t node = graph_->node(edgeid);
+    const DirectedEdge* directededge = graphreader.directededge(edgeid);
+    if (node == kInvalidCHNode || directededge == nullptr)
+      continue;
+    Cost cost = costing->EdgeCost(directededge) * (1.0f - edge.percent_along());
+    sources.emplace_back(node, cost.cost + edge.distance());
+    source_secs[node] = cost.secs;
+  }
+
+  // Seed the reverse search with the cost from the end of each destination
+  // edge back to the destination, which is negative since the arc onto the
+  // edge includes its whole cost. Only skip outbound edges if we have other
+  // options.
+  has_other_edges = false;
+  for (const auto& edge : destination.path_edges())
+    has_other_edges = has_other_edges || !edge.begin_node();
+  std::vector<std::pair<uint32_t, float> > targets;
+  std::unordered_map<uint32_t, float> target_secs;
+  for (const auto& edge : destination.path_edges()) {
+    if (has_other_edges && edge.begin_node())
+      continue;
+    GraphId edgeid(edge.graph_id());
+    uint32_t node = graph_->node(edgeid);
+    const DirectedEdge* directededge = graphreader.directededge(edgeid);
+    if (node == kInvalidCHNode || directededge == nullptr)
+      continue;
+    // Paths along a single edge are left to A*
+    if (source_secs.find(node) != source_secs.end())
+      return {};
+    Cost cost = costing->EdgeCost(directededge) * (1.0f - edge.percent_along());
+    targets.emplace_back(node, edge.distance() - cost.cost);
+    target_secs[node] = cost.secs;
+  }
+  if (sources.empty() || targets.empty())
+    return {};
+
+  std::vector<std::pair<uint32_t, float> > nodes;
+  if (Search(sources, targets, nodes) < 0.0f) {
+    LOG_DEBUG("No path over the contraction hierarchy");
+    return {};
+  }
+
+  // Form the path, checking each edge against the tiles since the overlay
+  // doesn't know about complex restrictions
+  std::vector<PathInfo> path;
+  uint32_t access_mode = costing->access_mode();
+  const GraphTile* tile = nullptr;
+  float elapsed = source_secs[nodes.front().first];
+  for (auto node = nodes.cbegin(); node != nodes.cend(); ++node) {
+    const GraphId& edgeid = graph_->edgeid(node->first);
+    const DirectedEdge* directededge = graphreader.directededge(edgeid, tile);
+    if (directededge == nullptr || directededge->part_of_complex_restriction() ||
+        (directededge->start_restriction() & access_mode) ||
+        (directededge->end_restriction() & access_mode)) {
+      LOG_DEBUG("Contraction hierarchy path needs another algorithm");
+      return {};
+    }
+    if (directededge->use() == Use::kFerry)
+      has_ferry_ = true;
+
+    // Time to the end of the edge, or to the destination along the last one
+    elapsed += node->second;
+    if (node + 1 == nodes.cend())
+      elapsed -= target_secs[node->first];
+    path.emplace_back(mode, elapsed, edgeid, 0);
+  }
+  return path;
+}
+
+}
+}
@@ -1,6 +1,12 @@
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 #include "worker.h"
 #include "thor/costmatrix.h"
@@ -14,6 +20,10 @@ namespace {
 
 constexpr uint32_t kMaxMatrixIterations = 2000000;
 
+// Rounds of the expansion between checks for an interrupt. Every location
+// takes a step each round so this is much less often than it looks.
+constexpr int kInterruptRoundsInterval = 100;
+
 // Find a threshold to continue the search - should be based on
 // the max edge cost in the adjacency set?
 int GetThreshold(const TravelMode mode, const int n) {
@@ -26,21 +36,117 @@ bool equals(const valhalla::odin::LatLng& a, const valhalla::odin::LatLng&b) {
       (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
 }
 
+// Fewest locations worth giving a thread of its own each round
+constexpr uint32_t kMinLocationsPerThread = 8;
+
+// Threads, each with its own graph reader, that run a step for every
+// location of a round alongside the calling thread and wait for them all
+class round_pool_t {
+ public:
+  round_pool_t(const std::vector<GraphReader*>& readers)
+      : generation_(0), busy_(0), stop_(false), count_(0), next_(0) {
+    for (auto* reader : readers)
+      threads_.emplace_back([this, reader]() { Work(*reader); });
+  }
+
+  ~round_pool_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& thread : threads_)
+      thread.join();
+  }
+
+  // Run step(index, reader) for every index below count
+  void Run(const uint32_t count, GraphReader& reader,
+           const std::function<void (uint32_t, GraphReader&)>& step) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      step_ = &step;
+      count_ = count;
+      next_ = 0;
+      busy_ = threads_.size();
+      ++generation_;
+    }
+    start_.notify_all();
+    Steps(reader);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+    if (error_) {
+      auto error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+
+ protected:
+  void Work(GraphReader& reader) {
+    uint64_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+        if (stop_)
+          return;
+        seen = generation_;
+      }
+      Steps(reader);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0)
+        done_.notify_one();
+    }
+  }
+
+  void Steps(GraphReader& reader) {
+    for (uint32_t i = next_++; i < count_; i = next_++) {
+      try {
+        (*step_)(i, reader);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+          error_ = std::current_exception();
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  uint64_t generation_;
+  size_t busy_;
+  bool stop_;
+  std::exception_ptr error_;
+  const std::function<void (uint32_t, GraphReader&)>* step_;
+  uint32_t count_;
+  std::atomic<uint32_t> next_;
+};
+
 }
 
 namespace valhalla {
 namespace thor {
 
 // Constructor with cost threshold.
-CostMatrix::CostMatrix()
+CostMatrix::CostMatrix(LabelArena* label_arena)
     : mode_(TravelMode::kDrive),
       access_mode_(kAutoAccess),
+      label_arena_(label_arena),
+      interrupt_(nullptr),
+      stats_(nullptr),
+      deferred_(Deferred::kNone),
       source_count_(0),
       remaining_sources_(0),
       target_count_(0),
       remaining_targets_(0),
       current_cost_threshold_(0) {}
 
+CostMatrix::~CostMatrix() {
+  Clear();
+}
+
 float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
   float cost_threshold;
   switch (mode_) {
@@ -64,6 +170,17 @@ float CostMatrix::GetCostThreshold(const float max_matrix_distance) {
 void CostMatrix::Clear() {
   // Clear the target edge markings
   targets_.clear();
+  deferred_ = Deferred::kNone;
+  deferred_updates_.clear();
+  deferred_targets_.clear();
+
+  // Count the work of the searches before it is thrown away
+  for (size_t i = 0; i < source_edgelabel_.size(); ++i)
+    AddSearchStats(stats_, source_edgelabel_[i].size(),
+                   i < source_adjacency_.size() ? source_adjacency_[i].get() : nullptr);
+  for (size_t i = 0; i < target_edgelabel_.size(); ++i)
+    AddSearchStats(stats_, target_edgelabel_[i].size(),
+                   i < target_adjacency_.size() ? target_adjacency_[i].get() : nullptr);
 
   // Clear all source adjacency lists, edge labels, and edge status
   for (auto adj : source_adjacency_) {
@@ -71,13 +188,13 @@ void CostMatrix::Clear() {
   }
   source_adjacency_.clear();
 
-  for (auto el : source_edgelabel_) {
-    el.clear();
+  for (auto& el : source_edgelabel_) {
+    ReleaseLabels(label_arena_, el);
   }
   source_edgelabel_.clear();
 
-  for (auto es : source_edgestatus_) {
-    es.Init();
+  for (auto& es : source_edgestatus_) {
+    ReleaseEdgeStatus(label_arena_, es);
   }
   source_edgestatus_.clear();
 
@@ -87,13 +204,14 @@ void CostMatrix::Clear() {
   }
   target_adjacency_.clear();
 
-  for (auto el : target_edgelabel_) {
-    el.clear();
+  for (auto& el : target_edgelabel_) {
+    ReleaseLabels(label_arena_, el);
   }
   target_edgelabel_.clear();
+  target_transition_.clear();
 
-  for (auto es : target_edgestatus_) {
-    es.Init();
+  for (auto& es : target_edgestatus_) {
+    ReleaseEdgeStatus(label_arena_, es);
   }
   target_edgestatus_.clear();
 
@@ -128,35 +246,92 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   // location set.
   Initialize(source_location_list, target_location_list);
 
+  // Take the next step of a location's search, returns true once the
+  // location is done expanding
+  const auto target_step = [this](const uint32_t i, GraphReader& reader) {
+    if (target_status_[i].threshold > 0) {
+      target_status_[i].threshold--;
+      BackwardSearch(i, reader);
+      if (target_status_[i].threshold == 0) {
+        target_status_[i].threshold = -1;
+        return true;
+      }
+    }
+    return false;
+  };
+  int n = 0;
+  const auto source_step = [this, &n](const uint32_t i, GraphReader& reader) {
+    if (source_status_[i].threshold > 0) {
+      source_status_[i].threshold--;
+      ForwardSearch(i, n, reader);
+      if (source_status_[i].threshold == 0) {
+        source_status_[i].threshold = -1;
+        return true;
+      }
+    }
+    return false;
+  };
+  const auto done = [](uint32_t& remaining, const uint32_t finished) {
+    remaining = finished < remaining ? remaining - finished : 0;
+  };
+
+  // Use the extra threads when there are enough locations to go around
+  uint32_t extra_threads = std::min<size_t>(thread_readers_.size(),
+     (source_count_ + target_count_) / (2 * kMinLocationsPerThread));
+  std::unique_ptr<round_pool_t> pool;
+  std::atomic<uint32_t> finished(0);
+  std::function<void (uint32_t, GraphReader&)> parallel_target_step, parallel_source_step;
+  if (extra_threads > 0) {
+    pool.reset(new round_pool_t(std::vector<GraphReader*>(thread_readers_.begin(),
+                                thread_readers_.begin() + extra_threads)));
+    deferred_updates_.resize(std::max(source_count_, target_count_));
+    deferred_targets_.resize(target_count_);
+    parallel_target_step = [&target_step, &finished](const uint32_t i, GraphReader& reader) {
+      if (target_step(i, reader))
+        finished++;
+    };
+    parallel_source_step = [&source_step, &finished](const uint32_t i, GraphReader& reader) {
+      if (source_step(i, reader))
+        finished++;
+    };
+  }
+
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
   // spaces is checked during the forward search.
-  int n = 0;
   while (true) {
-    // Iterate all target locations in a backwards search
-    for (uint32_t i = 0; i < target_count_; i++) {
-      if (target_status_[i].threshold > 0) {
-        target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        if (target_status_[i].threshold == 0) {
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
-          }
+    // Allow this process to be aborted
+    if (interrupt_ && (n % kInterruptRoundsInterval) == 0) {
+      (*interrupt_)();
+    }
+
+    if (pool) {
+      // Iterate all target locations in a backwards search and then all
+      // source locations in a forward search, each on the threads
+      finished = 0;
+      deferred_ = Deferred::kSourceStatus;
+      pool->Run(target_count_, graphreader, parallel_target_step);
+      ApplyDeferred(target_count_);
+      done(remaining_targets_, finished);
+
+      finished = 0;
+      deferred_ = Deferred::kTargetStatus;
+      pool->Run(source_count_, graphreader, parallel_source_step);
+      ApplyDeferred(source_count_);
+      done(remaining_sources_, finished);
+      deferred_ = Deferred::kNone;
+    } else {
+      // Iterate all target locations in a backwards search
+      for (uint32_t i = 0; i < target_count_; i++) {
+        if (target_step(i, graphreader)) {
+          done(remaining_targets_, 1);
         }
       }
-    }
 
-    // Iterate all source locations in a forward search
-    for (uint32_t i = 0; i < source_count_; i++) {
-      if (source_status_[i].threshold > 0) {
-        source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader);
-        if (source_status_[i].threshold == 0) {
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
-          }
+      // Iterate all source locations in a forward search
+      for (uint32_t i = 0; i < source_count_; i++) {
+        if (source_step(i, graphreader)) {
+          done(remaining_sources_, 1);
         }
       }
     }
@@ -240,7 +415,7 @@ void CostMatrix::ExpandForward(GraphReader& graphreader,
                    const GraphId& node, const NodeInfo* nodeinfo,
                    BDEdgeLabel& pred, const uint32_t pred_idx,
                    std::vector<HierarchyLimits>& hierarchy_limits,
-                   std::vector<BDEdgeLabel>& edgelabels,
+                   Labels<BDEdgeLabel>& edgelabels,
                    EdgeStatus& edgestate,
                    std::shared_ptr<DoubleBucketQueue>& adj,
                    const bool from_transition) {
@@ -314,7 +489,7 @@ void CostMatrix::ExpandForward(GraphReader& graphreader,
       BDEdgeLabel& lab = edgelabels[edgestatus.index()];
       if (newcost.cost < lab.cost().cost) {
         adj->decrease(edgestatus.index(), newcost.cost);
-        lab.Update(pred_idx, newcost, newcost.cost, tc, distance);
+        lab.Update(pred_idx, newcost, newcost.cost, distance);
       }
       continue;
     }
@@ -331,7 +506,7 @@ void CostMatrix::ExpandForward(GraphReader& graphreader,
     uint32_t idx = edgelabels.size();
     edgestate.Set(edgeid, EdgeSet::kTemporary, idx);
     edgelabels.emplace_back(pred_idx, edgeid, oppedge, directededge,
-                    newcost, mode_, tc, distance,
+                    newcost, mode_, distance,
                     (pred.not_thru_pruning() || !directededge->not_thru()));
     adj->add(idx);
   }
@@ -430,23 +605,25 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
     const auto& edgestate = target_edgestatus_[target];
 
     // If this edge has been reached then a shortest path has been found
-    // to the end node of this directed edge.
-    EdgeStatusInfo oppedgestatus = edgestate.Get(oppedge);
+    // to the end node of this directed edge. Peek since other sources may
+    // be looking at the same target on another thread.
+    EdgeStatusInfo oppedgestatus = edgestate.Peek(oppedge);
     if (oppedgestatus.set() != EdgeSet::kUnreached) {
       const auto& edgelabels = target_edgelabel_[target];
       uint32_t predidx = edgelabels[oppedgestatus.index()].predecessor();
       const BDEdgeLabel& opp_el = edgelabels[oppedgestatus.index()];
+      const Cost& opp_tc = target_transition_[target][oppedgestatus.index()];
 
       // Special case - common edge for source and target are both initial edges
       if (pred.predecessor() == kInvalidLabel && predidx == kInvalidLabel) {
         float s = std::abs(pred.cost().secs + opp_el.cost().secs -
-                           opp_el.transition_cost());
+                           opp_tc.cost);
 
         // Update best connection and set found = true.
         // distance computation only works with the casts.
         uint32_t d = std::abs(static_cast<int>(pred.path_distance())   +
                               static_cast<int>(opp_el.path_distance()) -
-                              static_cast<int>(opp_el.transition_secs()));
+                              static_cast<int>(opp_tc.secs));
         best_connection_[idx].Update(pred.edgeid(), oppedge, Cost(s, s), d);
         best_connection_[idx].found = true;
 
@@ -456,7 +633,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
       } else {
         float oppcost = (predidx == kInvalidLabel) ?
                   0 : edgelabels[predidx].cost().cost;
-        float c = pred.cost().cost + oppcost +  opp_el.transition_cost();
+        float c = pred.cost().cost + oppcost +  opp_tc.cost;
 
         // Check if best connection
         if (c < best_connection_[idx].cost.cost) {
@@ -464,7 +641,7 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
                         0 : edgelabels[predidx].cost().secs;
           uint32_t oppdist = (predidx == kInvalidLabel) ?
                         0 : edgelabels[predidx].path_distance();
-          float s = pred.cost().secs + oppsec + opp_el.transition_secs();
+          float s = pred.cost().secs + oppsec + opp_tc.secs;
           uint32_t d = pred.path_distance() + oppdist;
 
           // Update best connection and set a threshold
@@ -485,7 +662,31 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
 // Update status when a connection is found.
 void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
-  // Remove the target from the source status
+  // Once a location has found all the others it continues its search for a
+  // limited number of times
+  int threshold = GetThreshold(mode_,
+         source_edgelabel_[source].size() + target_edgelabel_[target].size());
+
+  // Remove the target from the source status, unless the targets are
+  // searching in parallel
+  if (deferred_ == Deferred::kSourceStatus) {
+    deferred_updates_[target].push_back({source, target, threshold});
+  } else {
+    UpdateSourceStatus(source, target, threshold);
+  }
+
+  // Remove the source from the target status, unless the sources are
+  // searching in parallel
+  if (deferred_ == Deferred::kTargetStatus) {
+    deferred_updates_[source].push_back({source, target, threshold});
+  } else {
+    UpdateTargetStatus(source, target, threshold);
+  }
+}
+
+// Remove the target from the source status
+void CostMatrix::UpdateSourceStatus(const uint32_t source, const uint32_t target,
+                                    const int threshold) {
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
   if (it != s.end()) {
@@ -493,21 +694,44 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
     if (s.empty() && source_status_[source].threshold > 0) {
       // At least 1 connection has been found to each target for this source.
       // Set a threshold to continue search for a limited number of times.
-      source_status_[source].threshold = GetThreshold(mode_,
-             source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      source_status_[source].threshold = threshold;
     }
   }
+}
 
-  // Remove the source from the target status
+// Remove the source from the target status
+void CostMatrix::UpdateTargetStatus(const uint32_t source, const uint32_t target,
+                                    const int threshold) {
   auto& t = target_status_[target].remaining_locations;
-  it = t.find(source);
+  auto it = t.find(source);
   if (it != t.end()) {
     t.erase(it);
     if (t.empty() && target_status_[target].threshold > 0) {
       // At least 1 connection has been found to each source for this target.
       // Set a threshold to continue search for a limited number of times.
-      target_status_[target].threshold = GetThreshold(mode_,
-             source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      target_status_[target].threshold = threshold;
+    }
+  }
+}
+
+// Apply what the locations deferred in the order they would have on one thread
+void CostMatrix::ApplyDeferred(const uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    for (const auto& update : deferred_updates_[i]) {
+      if (deferred_ == Deferred::kSourceStatus) {
+        UpdateSourceStatus(update.source, update.target, update.threshold);
+      } else {
+        UpdateTargetStatus(update.source, update.target, update.threshold);
+      }
+    }
+    deferred_updates_[i].clear();
+  }
+  if (deferred_ == Deferred::kSourceStatus) {
+    for (uint32_t i = 0; i < count; i++) {
+      for (const auto& edgeid : deferred_targets_[i]) {
+        targets_[edgeid].push_back(i);
+      }
+      deferred_targets_[i].clear();
     }
   }
 }
@@ -519,7 +743,8 @@ void CostMatrix::ExpandReverse(GraphReader& graphreader,
                    BDEdgeLabel& pred, const uint32_t pred_idx,
                    const DirectedEdge* opp_pred_edge,
                    std::vector<HierarchyLimits>& hierarchy_limits,
-                   std::vector<BDEdgeLabel>& edgelabels,
+                   Labels<BDEdgeLabel>& edgelabels,
+                   std::vector<Cost>& transitions,
                    EdgeStatus& edgestate,
                    std::shared_ptr<DoubleBucketQueue>& adj,
                    const bool from_transition) {
@@ -547,7 +772,7 @@ void CostMatrix::ExpandReverse(GraphReader& graphreader,
       if (endtile != nullptr) {
         ExpandReverse(graphreader, endtile, node, endtile->node(node),
                  index, pred, pred_idx, opp_pred_edge,
-                 hierarchy_limits, edgelabels, edgestate, adj, true);
+                 hierarchy_limits, edgelabels, transitions, edgestate, adj, true);
       }
       continue;
     }
@@ -603,7 +828,8 @@ void CostMatrix::ExpandReverse(GraphReader& graphreader,
       BDEdgeLabel& lab = edgelabels[edgestatus.index()];
       if (newcost.cost < lab.cost().cost) {
         adj->decrease(edgestatus.index(), newcost.cost);
-        lab.Update(pred_idx, newcost, newcost.cost, tc, distance);
+        lab.Update(pred_idx, newcost, newcost.cost, distance);
+        transitions[edgestatus.index()] = tc;
       }
       continue;
     }
@@ -612,12 +838,17 @@ void CostMatrix::ExpandReverse(GraphReader& graphreader,
     uint32_t idx = edgelabels.size();
     edgestate.Set(edgeid, EdgeSet::kTemporary, idx);
     edgelabels.emplace_back(pred_idx, edgeid, oppedge,
-       directededge, newcost, mode_, tc, distance,
+       directededge, newcost, mode_, distance,
        (pred.not_thru_pruning() || !directededge->not_thru()));
+    transitions.push_back(tc);
     adj->add(idx);
 
     // Add to the list of targets that have reached this edge
-    targets_[edgeid].push_back(index);
+    if (deferred_ == Deferred::kSourceStatus) {
+      deferred_targets_[index].push_back(edgeid);
+    } else {
+      targets_[edgeid].push_back(index);
+    }
   }
 }
 
@@ -680,7 +911,7 @@ void CostMatrix::BackwardSearch(const uint32_t index,
       }
       ExpandReverse(graphreader, tile, node, nodeinfo, index, pred,
                     pred_idx, opp_pred_edge, hierarchy_limits, edgelabels,
-                    edgestate, adj, false);
+                    target_transition_[index], edgestate, adj, false);
     }
   }
 }
@@ -689,10 +920,17 @@ void CostMatrix::BackwardSearch(const uint32_t index,
 // locations.
 void CostMatrix::SetSources(GraphReader& graphreader,
                       const google::protobuf::RepeatedPtrField<odin::Location>& sources) {
-  // Allocate edge labels and edge status
+  // Allocate edge labels and edge status, reusing the ones of previous
+  // requests kept by the label arena
   source_count_ = sources.size();
   source_edgelabel_.resize(source_count_);
+  for (auto& el : source_edgelabel_) {
+    ReserveLabels(label_arena_, el, 0);
+  }
   source_edgestatus_.resize(source_count_);
+  for (auto& es : source_edgestatus_) {
+    ReserveEdgeStatus(label_arena_, es);
+  }
   source_adjacency_.resize(source_count_);
   source_hierarchy_limits_.resize(source_count_);
 
@@ -734,15 +972,10 @@ void CostMatrix::SetSources(GraphReader& graphreader,
       // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
       cost.cost += edge.distance();
 
-      // Store the edge cost and length in the transition cost (so we can
-      // recover the full length and cost for cases where origin and
-      // destination are on the same edge
-      Cost ec(std::round(edgecost.secs), static_cast<uint32_t>(directededge->length()));
-
       // Set the initial not_thru flag to false. There is an issue with not_thru
       // flags on small loops. Set this to false here to override this for now.
       BDEdgeLabel edge_label(kInvalidLabel, edgeid, oppedge, directededge, cost,
-                           mode_, ec, d, false);
+                           mode_, d, false);
       edge_label.set_not_thru(false);
 
       // Add EdgeLabel to the adjacency list (but do not set its status).
@@ -759,10 +992,18 @@ void CostMatrix::SetSources(GraphReader& graphreader,
 // these locations.
 void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
                      const google::protobuf::RepeatedPtrField<odin::Location>& targets) {
-  // Allocate target edge labels and edge status
+  // Allocate target edge labels and edge status, reusing the ones of
+  // previous requests kept by the label arena
   target_count_ = targets.size();
   target_edgelabel_.resize(targets.size());
+  target_transition_.resize(targets.size());
+  for (auto& el : target_edgelabel_) {
+    ReserveLabels(label_arena_, el, 0);
+  }
   target_edgestatus_.resize(targets.size());
+  for (auto& es : target_edgestatus_) {
+    ReserveEdgeStatus(label_arena_, es);
+  }
   target_adjacency_.resize(targets.size());
   target_hierarchy_limits_.resize(targets.size());
 
@@ -821,13 +1062,14 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
       // Set the initial not_thru flag to false. There is an issue with not_thru
       // flags on small loops. Set this to false here to override this for now.
       BDEdgeLabel edge_label(kInvalidLabel, opp_edge_id, edgeid, opp_dir_edge, cost,
-                           mode_, ec, d, false);
+                           mode_, d, false);
       edge_label.set_not_thru(false);
 
       // Add EdgeLabel to the adjacency list (but do not set its status).
       // Set the predecessor edge index to invalid to indicate the origin
       // of the path. Set the origin flag
       target_edgelabel_[index].push_back(std::move(edge_label));
+      target_transition_[index].push_back(ec);
       target_adjacency_[index]->add(target_edgelabel_[index].size() - 1);
       targets_[opp_edge_id].push_back(index);
     }
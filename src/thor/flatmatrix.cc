@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <thread>
+#include "midgard/logging.h"
+#include "thor/flatmatrix.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+
+namespace {
+
+// Search label of a node
+struct label_t {
+  float cost;
+  float secs;
+  float length;
+};
+
+bool equals(const valhalla::odin::LatLng& a, const valhalla::odin::LatLng&b) {
+  return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
+      (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
+}
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+FlatMatrix::FlatMatrix(const std::shared_ptr<const FlatGraph>& graph,
+                       const uint32_t max_threads)
+    : graph_(graph),
+      max_threads_(max_threads ? max_threads :
+                   std::max(1u, std::thread::hardware_concurrency())) {
+}
+
+// Form a time distance matrix from the set of source locations
+// to the set of target locations.
+std::vector<TimeDistance> FlatMatrix::SourceToTarget(
+        const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+        const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+        GraphReader& graphreader,
+        const std::shared_ptr<DynamicCost>* mode_costing,
+        const TravelMode mode, const float max_matrix_distance) {
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+  std::vector<std::vector<Seed> > sources, targets;
+  for (const auto& location : source_location_list)
+    sources.emplace_back(Seeds(location, graphreader, costing, true));
+  for (const auto& location : target_location_list)
+    targets.emplace_back(Seeds(location, graphreader, costing, false));
+  auto connections = Connect(sources, targets);
+
+  std::vector<TimeDistance> td;
+  td.reserve(connections.size());
+  for (uint32_t i = 0; i < sources.size(); ++i) {
+    for (uint32_t j = 0; j < targets.size(); ++j) {
+      const auto& connection = connections[i * targets.size() + j];
+      if (equals(source_location_list.Get(i).ll(), target_location_list.Get(j).ll())) {
+        td.emplace_back(0, 0);
+      } else if (connection.cost == kMaxCost || connection.length > max_matrix_distance) {
+        td.emplace_back(kMaxCost, kMaxCost);
+      } else {
+        td.emplace_back(std::round(connection.secs), std::round(connection.length));
+      }
+    }
+  }
+  return td;
+}
+
+// Find the cheapest connections between all the sources and targets with a
+// dijkstra per source that stops once it has settled every target
+std::vector<FlatMatrix::Connection> FlatMatrix::Connect(
+        const std::vector<std::vector<Seed> >& sources,
+        const std::vector<std::vector<Seed> >& targets) const {
+  std::vector<Connection> connections(sources.size() * targets.size(),
+                                      Connection{kMaxCost, kMaxCost, kMaxCost});
+  if (!graph_ || sources.empty())
+    return connections;
+
+  std::vector<bool> is_target(graph_->node_count(), false);
+  uint32_t target_nodes = 0;
+  for (const auto& seeds : targets) {
+    for (const auto& seed : seeds) {
+      if (!is_target[seed.node]) {
+        is_target[seed.node] = true;
+        ++target_nodes;
+      }
+    }
+  }
+
+  // Each thread searches from its share of the sources with its own labels.
+  // The labels come from taking arcs only, the seeds are kept apart so that a
+  // target behind the source on its edge can still be reached the long way.
+  const uint32_t* arc_targets = graph_->targets();
+  const float* arc_costs = graph_->costs();
+  const float* arc_secs = graph_->secs();
+  const float* arc_lengths = graph_->lengths();
+  const auto search = [&](const size_t t, const size_t thread_count) {
+    using queue_entry_t = std::pair<float, uint32_t>;
+    std::priority_queue<queue_entry_t, std::vector<queue_entry_t>,
+                        std::greater<queue_entry_t> > queue;
+    std::vector<label_t> labels(graph_->node_count(), label_t{kMaxCost, kMaxCost, kMaxCost});
+    std::vector<bool> settled(graph_->node_count(), false);
+    std::vector<uint32_t> touched;
+    const auto relax = [&](const uint32_t node, const label_t& from) {
+      for (uint32_t a = graph_->first_arc(node); a < graph_->last_arc(node); ++a) {
+        uint32_t to = arc_targets[a];
+        float c = from.cost + arc_costs[a];
+        if (c < labels[to].cost) {
+          if (labels[to].cost == kMaxCost)
+            touched.push_back(to);
+          labels[to] = {c, from.secs + arc_secs[a], from.length + arc_lengths[a]};
+          queue.emplace(c, to);
+        }
+      }
+    };
+
+    for (size_t i = t; i < sources.size(); i += thread_count) {
+      for (auto n : touched) {
+        labels[n] = {kMaxCost, kMaxCost, kMaxCost};
+        settled[n] = false;
+      }
+      touched.clear();
+      for (const auto& seed : sources[i])
+        relax(seed.node, {seed.cost, seed.secs, seed.length});
+      uint32_t remaining = target_nodes;
+      while (!queue.empty() && remaining > 0) {
+        auto top = queue.top();
+        queue.pop();
+        if (settled[top.second] || top.first > labels[top.second].cost)
+          continue;
+        settled[top.second] = true;
+        if (is_target[top.second])
+          --remaining;
+        relax(top.second, labels[top.second]);
+      }
+      decltype(queue)().swap(queue);
+
+      // Each target is reached at its seeds, from a source seed on the same
+      // edge only if the target is ahead of it
+      Connection* row = connections.data() + i * targets.size();
+      for (size_t j = 0; j < targets.size(); ++j) {
+        for (const auto& target : targets[j]) {
+          const label_t& label = labels[target.node];
+          if (label.cost != kMaxCost && label.cost + target.cost < row[j].cost)
+            row[j] = {label.cost + target.cost, label.secs + target.secs, label.length + target.length};
+          for (const auto& source : sources[i]) {
+            float length = source.length + target.length;
+            if (source.node == target.node && length >= 0.0f &&
+                source.cost + target.cost < row[j].cost)
+              row[j] = {source.cost + target.cost, source.secs + target.secs, length};
+          }
+        }
+      }
+    }
+  };
+
+  size_t thread_count = std::max<size_t>(1, std::min<size_t>(max_threads_, sources.size()));
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < thread_count; ++t)
+    threads.emplace_back(search, t, thread_count);
+  search(0, thread_count);
+  for (auto& thread : threads)
+    thread.join();
+  return connections;
+}
+
+// Seed the search of a location the same way the bucket matrix does
+std::vector<FlatMatrix::Seed> FlatMatrix::Seeds(const odin::Location& location,
+        GraphReader& graphreader, const std::shared_ptr<DynamicCost>& costing,
+        const bool source) const {
+  // Only skip inbound (or outbound) edges if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : location.path_edges())
+    has_other_edges = has_other_edges || !(source ? edge.end_node() : edge.begin_node());
+
+  std::vector<Seed> seeds;
+  for (const auto& edge : location.path_edges()) {
+    if (has_other_edges && (source ? edge.end_node() : edge.begin_node()))
+      continue;
+    GraphId edgeid(edge.graph_id());
+    uint32_t node = graph_ ? graph_->node(edgeid) : kInvalidFlatNode;
+    const DirectedEdge* directededge = graphreader.directededge(edgeid);
+    if (node == kInvalidFlatNode || directededge == nullptr)
+      continue;
+
+    // What is left of the edge past the location
+    float remainder = 1.0f - edge.percent_along();
+    Cost cost = costing->EdgeCost(directededge) * remainder;
+    float length = directededge->length() * remainder;
+    if (source)
+      seeds.push_back({node, cost.cost + edge.distance(), cost.secs, length});
+    else
+      seeds.push_back({node, edge.distance() - cost.cost, -cost.secs, -length});
+  }
+  return seeds;
+}
+
+}
+}
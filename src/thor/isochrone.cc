@@ -1,7 +1,9 @@
 #include <iostream> // TODO remove if not needed
 #include <map>
 #include <algorithm>
+#include <limits>
 #include "thor/isochrone.h"
+#include "thor/pathalgorithm.h"
 #include "baldr/datetime.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/logging.h"
@@ -35,21 +37,28 @@ uint32_t GetOperatorId(const GraphTile* tile, uint32_t routeid,
   return 0;
 }
 
+// Whether the forward expansion stops once this label is settled
+bool Exceeded(const EdgeLabel& label, const uint32_t max_seconds) {
+  return label.cost().secs > max_seconds || label.cost().cost > max_seconds * 4;
+}
+
 }
 
 namespace valhalla {
 namespace thor {
 
-constexpr uint32_t kBucketCount = 20000;
 constexpr uint32_t kInitialEdgeLabelCount = 500000;
 
 // Default constructor
-Isochrone::Isochrone()
+Isochrone::Isochrone(const uint32_t cache_seconds)
     : access_mode_(kAutoAccess),
       shape_interval_(50.0f),
       mode_(TravelMode::kDrive),
       adjacencylist_(nullptr),
-      edgestatus_(nullptr) {
+      edgestatus_(nullptr),
+      track_origins_(false),
+      interrupt_(nullptr),
+      cache_seconds_(cache_seconds) {
 }
 
 // Destructor
@@ -59,15 +68,25 @@ Isochrone::~Isochrone() {
 
 // Clear the temporary information generated during path construction.
 void Isochrone::Clear() {
+  // Keep the forward expansion around for a while for the next request
+  if (!cache_key_.empty() &&
+      std::chrono::steady_clock::now() - cache_time_ < std::chrono::seconds(cache_seconds_)) {
+    return;
+  }
+  cache_key_.clear();
+  settled_.clear();
+
   // Clear the edge labels, edge status flags, and adjacency list
   // TODO - clear only the edge label set that was used?
   edgelabels_.clear();
+  label_origins_.clear();
   bdedgelabels_.clear();
   mmedgelabels_.clear();
   bdedgelabels_.clear();
   mmedgelabels_.clear();
   adjacencylist_.reset();
-  edgestatus_.reset();
+  if (edgestatus_)
+    edgestatus_->Init();
 }
 
 // Construct the isotile. Use a fixed grid size. Convert time in minutes to
@@ -136,6 +155,7 @@ void Isochrone::ConstructIsoTile(const bool multimodal, const unsigned int max_m
 
   // Create isotile (gridded data)
   isotile_.reset(new GriddedData<PointLL>(bounds, grid_size, max_minutes));
+  catchments_.reset();
 
   // Find the center of the grid that the location lies within. Shift the
   // tilebounds so the location lies in the center of a tile.
@@ -152,11 +172,22 @@ void Isochrone::ConstructIsoTile(const bool multimodal, const unsigned int max_m
              std::to_string(center_ll.lat() - grid_center.lat()) + "," +
              std::to_string(center_ll.lng() - grid_center.lng()));
   }
+
+  // Catchments of the origins over the same tiles
+  if (track_origins_) {
+    catchments_.reset(new GriddedData<PointLL>(bounds, grid_size, std::numeric_limits<float>::max()));
+    catchments_->ShiftTileBounds(shift);
+  }
 }
 
 // Initialize - create adjacency list, edgestatus support, and reserve
 // edgelabels
 void Isochrone::Initialize(const uint32_t bucketsize) {
+  // The adjacency list and edge status are about to be reused
+  cache_key_.clear();
+  settled_.clear();
+  edgelabels_.clear();
+  label_origins_.clear();
   edgelabels_.reserve(kInitialEdgeLabelCount);
 
   // Set up lambda to get sort costs
@@ -166,12 +197,18 @@ void Isochrone::Initialize(const uint32_t bucketsize) {
 
   float range = kBucketCount * bucketsize;
   adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
-  edgestatus_.reset(new EdgeStatus());
+  if (edgestatus_)
+    edgestatus_->Init();
+  else
+    edgestatus_.reset(new EdgeStatus());
 }
 
 // Initialize - create adjacency list, edgestatus support, and reserve
 // edgelabels
 void Isochrone::InitializeReverse(const uint32_t bucketsize) {
+  // The adjacency list and edge status are about to be reused
+  cache_key_.clear();
+  settled_.clear();
   bdedgelabels_.reserve(kInitialEdgeLabelCount);
 
   // Set up lambda to get sort costs
@@ -181,12 +218,18 @@ void Isochrone::InitializeReverse(const uint32_t bucketsize) {
 
   float range = kBucketCount * bucketsize;
   adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
-  edgestatus_.reset(new EdgeStatus());
+  if (edgestatus_)
+    edgestatus_->Init();
+  else
+    edgestatus_.reset(new EdgeStatus());
 }
 
 // Initialize - create adjacency list, edgestatus support, and reserve
 // edgelabels
 void Isochrone::InitializeMultiModal(const uint32_t bucketsize) {
+  // The adjacency list and edge status are about to be reused
+  cache_key_.clear();
+  settled_.clear();
   mmedgelabels_.reserve(kInitialEdgeLabelCount);
 
   // Set up lambda to get sort costs
@@ -196,7 +239,10 @@ void Isochrone::InitializeMultiModal(const uint32_t bucketsize) {
 
   float range = kBucketCount * bucketsize;
   adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
-  edgestatus_.reset(new EdgeStatus());
+  if (edgestatus_)
+    edgestatus_->Init();
+  else
+    edgestatus_.reset(new EdgeStatus());
 }
 
 // Expand from a node in the forward direction
@@ -215,7 +261,8 @@ void Isochrone::ExpandForward(GraphReader& graphreader, const GraphId& node,
   if (!from_transition) {
     uint32_t idx = pred.predecessor();
     float secs0 = (idx == kInvalidLabel) ? 0 : edgelabels_[idx].cost().secs;
-    UpdateIsoTile(pred, graphreader, nodeinfo->latlng(), secs0);
+    UpdateIsoTile(pred, graphreader, nodeinfo->latlng(), secs0,
+                  track_origins_ ? label_origins_[pred_idx] : 0);
   }
   if (!costing_->Allowed(nodeinfo)) {
     return;
@@ -274,6 +321,9 @@ void Isochrone::ExpandForward(GraphReader& graphreader, const GraphId& node,
         float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
         adjacencylist_->decrease(edgestatus.index(), newsortcost);
         lab.Update(pred_idx, newcost, newsortcost);
+        if (track_origins_) {
+          label_origins_[edgestatus.index()] = label_origins_[pred_idx];
+        }
       }
       continue;
     }
@@ -283,6 +333,9 @@ void Isochrone::ExpandForward(GraphReader& graphreader, const GraphId& node,
     edgestatus_->Set(edgeid, EdgeSet::kTemporary, idx);
     edgelabels_.emplace_back(pred_idx, edgeid, directededge,
                              newcost, newcost.cost, 0.0f, mode_, 0);
+    if (track_origins_) {
+      label_origins_.push_back(label_origins_[pred_idx]);
+    }
     adjacencylist_->add(idx);
   }
 }
@@ -293,29 +346,53 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::Compute(
              const unsigned int max_minutes,
              GraphReader& graphreader,
              const std::shared_ptr<DynamicCost>* mode_costing,
-             const TravelMode mode) {
+             const TravelMode mode,
+             const std::string& cache_key) {
   // Set the mode and costing
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
   access_mode_ = costing_->access_mode();
 
-  // Initialize and create the isotile
+  // Carry on with the last expansion if it was from the same origins with
+  // the same costing. It is only kept again once it is consistent.
+  auto now = std::chrono::steady_clock::now();
+  bool resume = !cache_key.empty() && cache_key == cache_key_ &&
+                now - cache_time_ < std::chrono::seconds(cache_seconds_);
+  cache_key_.clear();
+
+  // Initialize and create the isotile, with the catchment of each origin
+  // when there is more than one
   auto max_seconds = max_minutes * 60;
-  Initialize(costing_->UnitSize());
+  track_origins_ = origin_locations.size() > 1;
+  if (!resume) {
+    Initialize(costing_->UnitSize());
+  }
   ConstructIsoTile(false, max_minutes, origin_locations);
 
-  // Set the origin locations
-  SetOriginLocations(graphreader, origin_locations, costing_);
+  // Redraw what was already settled or set the origin locations
+  bool done = false;
+  if (resume) {
+    done = ReplayIsoTile(graphreader, max_seconds);
+  } else {
+    SetOriginLocations(graphreader, origin_locations, costing_);
+  }
 
   // Compute the isotile
   uint32_t n = 0;
-  const GraphTile* tile;
-  while (true) {
+  bool cache = cache_seconds_ > 0 && !cache_key.empty();
+  size_t total_labels = edgelabels_.size();
+  while (!done) {
+    // Allow this process to be aborted
+    size_t current_labels = edgelabels_.size();
+    if (interrupt_ && total_labels/kInterruptIterationsInterval < current_labels/kInterruptIterationsInterval)
+      (*interrupt_)();
+    total_labels = current_labels;
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
     if (predindex == kInvalidLabel) {
-      return isotile_;
+      break;
     }
 
     // Copy the EdgeLabel for use in costing and settle the edge.
@@ -325,14 +402,51 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::Compute(
     // Expand from the end node in forward direction.
     ExpandForward(graphreader, pred.endnode(), pred, predindex, false);
     n++;
+    if (cache) {
+      settled_.push_back(predindex);
+    }
 
     // Return after the time interval has been met
-    if (pred.cost().secs > max_seconds || pred.cost().cost > max_seconds * 4) {
+    if (Exceeded(pred, max_seconds)) {
       LOG_DEBUG("Exceed time interval: n = " + std::to_string(n));
-      return isotile_;
+      done = true;
     }
   }
-  return isotile_;      // Should never get here
+
+  // Keep the expansion for the next request
+  if (cache) {
+    cache_key_ = cache_key;
+    cache_time_ = now;
+  }
+  return isotile_;
+}
+
+// Draw the isotile from the edges settled so far
+bool Isochrone::ReplayIsoTile(GraphReader& graphreader, const uint32_t max_seconds) {
+  // An edge doesn't mark the isotile if its opposing edge was settled first,
+  // so only let the edge status know about the edges settled before
+  auto edgestatus = edgestatus_;
+  edgestatus_.reset(new EdgeStatus());
+  bool done = false;
+  for (const auto predindex : settled_) {
+    const EdgeLabel& pred = edgelabels_[predindex];
+    edgestatus_->Set(pred.edgeid(), EdgeSet::kPermanent, predindex);
+
+    // Update the isotile the way ExpandForward did
+    const GraphTile* tile = graphreader.GetGraphTile(pred.endnode());
+    if (tile != nullptr) {
+      uint32_t idx = pred.predecessor();
+      float secs0 = (idx == kInvalidLabel) ? 0 : edgelabels_[idx].cost().secs;
+      UpdateIsoTile(pred, graphreader, tile->node(pred.endnode())->latlng(), secs0,
+                    track_origins_ ? label_origins_[predindex] : 0);
+    }
+    if (Exceeded(pred, max_seconds)) {
+      done = true;
+      break;
+    }
+  }
+  edgestatus_ = edgestatus;
+  return done;
 }
 
 // Expand from a node in reverse direction.
@@ -422,7 +536,7 @@ void Isochrone::ExpandReverse(GraphReader& graphreader,
       if (newcost.cost < lab.cost().cost) {
         float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
         adjacencylist_->decrease(edgestatus.index(), newsortcost);
-        lab.Update(pred_idx, newcost, newsortcost, tc);
+        lab.Update(pred_idx, newcost, newsortcost);
       }
       continue;
     }
@@ -432,7 +546,7 @@ void Isochrone::ExpandReverse(GraphReader& graphreader,
     edgestatus_->Set(edgeid, EdgeSet::kTemporary, idx);
     bdedgelabels_.emplace_back(pred_idx, edgeid, oppedge,
                    directededge, newcost, newcost.cost, 0.0f,
-                   mode_, tc, false);
+                   mode_, false);
     adjacencylist_->add(idx);
   }
 }
@@ -451,6 +565,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeReverse(
 
   // Initialize and create the isotile
   auto max_seconds = max_minutes * 60;
+  track_origins_ = false;
   InitializeReverse(costing_->UnitSize());
   ConstructIsoTile(false, max_minutes, dest_locations);
 
@@ -460,7 +575,14 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeReverse(
   // Compute the isotile
   uint32_t n = 0;
   const GraphTile* tile;
+  size_t total_labels = 0;
   while (true) {
+    // Allow this process to be aborted
+    size_t current_labels = bdedgelabels_.size();
+    if (interrupt_ && total_labels/kInterruptIterationsInterval < current_labels/kInterruptIterationsInterval)
+      (*interrupt_)();
+    total_labels = current_labels;
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -515,6 +637,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
 
   // Initialize and create the isotile
   auto max_seconds = max_minutes * 60;
+  track_origins_ = false;
   InitializeMultiModal(costing->UnitSize());
   ConstructIsoTile(true, max_minutes, origin_locations);
 
@@ -527,14 +650,12 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
     return isotile_;
   }
 
-  // Update start time
-  uint32_t start_time, localtime, date, dow, day = 0;
+  // Parse the start time (seconds from midnight), date, and day of week
+  // once, the expansion only adds the elapsed seconds to them
+  const DateTime::time_context_t start(origin_locations.Get(0).date_time());
+  uint32_t start_time = start.seconds_from_midnight;
+  uint32_t dow = start.dow_mask, day = 0;
   bool date_before_tile = false;
-  if (origin_locations.Get(0).has_date_time()) {
-    // Set route start time (seconds from midnight), date, and day of week
-    start_time = DateTime::seconds_from_midnight(origin_locations.Get(0).date_time());
-    localtime = start_time;
-  }
 
   // Expand using adjacency list until we exceed threshold
   uint32_t n = 0;
@@ -543,7 +664,14 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
   std::unordered_map<std::string, uint32_t> operators;
   std::unordered_set<uint32_t> processed_tiles;
   const GraphTile* tile;
+  size_t total_labels = 0;
   while (true) {
+    // Allow this process to be aborted
+    size_t current_labels = mmedgelabels_.size();
+    if (interrupt_ && total_labels/kInterruptIterationsInterval < current_labels/kInterruptIterationsInterval)
+      (*interrupt_)();
+    total_labels = current_labels;
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -625,14 +753,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
       // we must get the date from level 3 transit tiles and not level 2.  The level 3 date is
       // set when the fetcher grabbed the transit data and created the schedules.
       if (!date_set) {
-        date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(origin_locations.Get(0).date_time()));
-        dow  = DateTime::day_of_week_mask(origin_locations.Get(0).date_time());
-        uint32_t date_created = tile->header()->date_created();
-        if (date < date_created)
-          date_before_tile = true;
-        else
-          day = date - date_created;
-
+        date_before_tile = !start.day_from(tile->header()->date_created(), day);
         date_set = true;
       }
     }
@@ -838,7 +959,7 @@ std::shared_ptr<const GriddedData<PointLL> > Isochrone::ComputeMultiModal(
 
 // Update the isotile
 void Isochrone::UpdateIsoTile(const EdgeLabel& pred, GraphReader& graphreader,
-                              const PointLL& ll, float secs0) {
+                              const PointLL& ll, float secs0, const uint32_t origin) {
   // Skip if the opposing edge has already been settled.
   const GraphTile* t2;
   GraphId opp = graphreader.GetOpposingEdgeId(pred.edgeid(), t2);
@@ -866,12 +987,12 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred, GraphReader& graphreader,
     // Mark the cell at the begin node
     const auto* de = t2->directededge(opp);
     const auto* node = tile->node(de->endnode());
-    isotile_->SetIfLessThan(node->latlng(), secs0 * kMinPerSec);
+    MarkIsoTile(isotile_->TileId(node->latlng()), secs0 * kMinPerSec, origin);
 
     // Mark the cell at the end node (and any intervening cells)
     auto tiles = isotile_->Intersect(std::list<PointLL>{node->latlng(), ll});
     for (auto t : tiles) {
-      isotile_->SetIfLessThan(t.first, secs1 * kMinPerSec);
+      MarkIsoTile(t.first, secs1 * kMinPerSec, origin);
     }
     return;
   }
@@ -886,10 +1007,10 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred, GraphReader& graphreader,
 
   // Mark the initial grid cell and iterate through the shape pairs
   float secs = secs0;
-  isotile_->SetIfLessThan(shape.front(), secs * kMinPerSec);
+  MarkIsoTile(isotile_->TileId(shape.front()), secs * kMinPerSec, origin);
   auto tiles = isotile_->Intersect(std::list<PointLL>{shape.front(), shape.back()});
   for (auto t : tiles) {
-    isotile_->SetIfLessThan(t.first, secs * kMinPerSec);
+    MarkIsoTile(t.first, secs * kMinPerSec, origin);
   }
 
   // Mark grid cells along the shape if time is less than what is
@@ -902,7 +1023,7 @@ void Isochrone::UpdateIsoTile(const EdgeLabel& pred, GraphReader& graphreader,
     secs += delta;
     auto tiles = isotile_->Intersect(std::list<PointLL>{*itr1, *itr2});
     for (auto t : tiles) {
-      isotile_->SetIfLessThan(t.first, secs * kMinPerSec);
+      MarkIsoTile(t.first, secs * kMinPerSec, origin);
     }
   }
 }
@@ -912,10 +1033,14 @@ void Isochrone::SetOriginLocations(GraphReader& graphreader,
                  google::protobuf::RepeatedPtrField<valhalla::odin::Location>& origin_locations,
                  const std::shared_ptr<DynamicCost>& costing) {
   // Add edges for each location to the adjacency list
-  for (auto& origin : origin_locations) {
+  for (int i = 0; i < origin_locations.size(); ++i) {
+    auto& origin = *origin_locations.Mutable(i);
     PointLL ll(origin.ll().lng(), origin.ll().lat());
     // Set time at the origin lat, lon grid to 0
     isotile_->Set(ll, 0);
+    if (catchments_) {
+      catchments_->Set(ll, i);
+    }
 
     // Only skip inbound edges if we have other options
     bool has_other_edges = false;
@@ -966,6 +1091,9 @@ void Isochrone::SetOriginLocations(GraphReader& graphreader,
 
       // Add EdgeLabel to the adjacency list
       edgelabels_.push_back(std::move(edge_label));
+      if (track_origins_) {
+        label_origins_.push_back(i);
+      }
       adjacencylist_->add(idx);
     }
 
@@ -1067,7 +1195,6 @@ void Isochrone::SetDestinationLocations(GraphReader& graphreader,
     });
 
     // Iterate through edges and add to adjacency list
-    Cost c;
     for (const auto& edge : (dest.path_edges())) {
       // If the destination is at a node, skip any outbound edges (so any
       // opposing inbound edges are not considered)
@@ -1105,7 +1232,7 @@ void Isochrone::SetDestinationLocations(GraphReader& graphreader,
       uint32_t idx = bdedgelabels_.size();
       edgestatus_->Set(opp_edge_id, EdgeSet::kTemporary, idx);
       bdedgelabels_.emplace_back(kInvalidLabel, opp_edge_id, edgeid,
-                  opp_dir_edge, cost, cost.cost, 0.0f, mode_, c, false);
+                  opp_dir_edge, cost, cost.cost, 0.0f, mode_, false);
       adjacencylist_->add(idx);
     }
   }
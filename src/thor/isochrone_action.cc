@@ -2,6 +2,8 @@
 
 #include "tyr/serializers.h"
 
+#include <thread>
+
 using namespace valhalla::baldr;
 using namespace valhalla::midgard;
 
@@ -9,6 +11,7 @@ namespace valhalla {
   namespace thor {
 
     std::string thor_worker_t::isochrones(valhalla_request_t& request) {
+      track_stats(request);
       parse_locations(request);
       auto costing = parse_costing(request);
 
@@ -30,15 +33,122 @@ namespace valhalla {
       //Cost (including penalties) is used when adding to the adjacency list but the elapsed
       //time in seconds is used when terminating the search. The + 10 minutes adds a buffer for edges
       //where there has been a higher cost that might still be marked in the isochrone
-      auto grid = (costing == "multimodal" || costing == "transit") ?
-        isochrone_gen.ComputeMultiModal(*request.options.mutable_locations(), contours.back()+10, reader, mode_costing, mode) :
-        isochrone_gen.Compute(*request.options.mutable_locations(), contours.back()+10, reader, mode_costing, mode);
+      //A later request from the same locations with the same costing can pick up the expansion
+      //where this one stops, eg when only the contours change
+      std::string cache_key = costing;
+      auto costing_options = rapidjson::get_child_optional(request.document, ("/costing_options/" + costing).c_str());
+      if(costing_options)
+        cache_key += rapidjson::to_string(*costing_options);
+      for(const auto& location : request.options.locations())
+        cache_key += location.SerializeAsString();
+      isochrone_gen.set_interrupt(interrupt);
+
+      //the reverse expansion, for how long it takes to get to the locations rather than from
+      //them, can be drawn instead or as well. Both are expanded at once, the reverse one on a
+      //thread of its own when there is a reader and a copy of the costing for it to use
+      auto direction = rapidjson::get<std::string>(request.document, "/direction", "forward");
+      auto combine = rapidjson::get<std::string>(request.document, "/combine", "");
+      bool forward = direction != "reverse", reverse = direction == "reverse" || direction == "both";
+      sif::cost_ptr_t reverse_costing[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
+      bool threaded = forward && reverse && !matrix_readers.empty();
+      for (size_t m = 0; threaded && m < static_cast<size_t>(sif::TravelMode::kMaxTravelMode); ++m) {
+        reverse_costing[m] = mode_costing[m] ? mode_costing[m]->Clone() : nullptr;
+        threaded = !mode_costing[m] || reverse_costing[m];
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      std::shared_ptr<const GriddedData<PointLL> > grid, reverse_grid;
+      std::exception_ptr reverse_error;
+      auto reverse_locations = request.options.locations();
+      auto compute_reverse = [&](GraphReader& graph_reader, const sif::cost_ptr_t* costing) {
+        try {
+          reverse_grid = reverse_isochrone_gen.ComputeReverse(reverse_locations, contours.back()+10,
+                                                              graph_reader, costing, mode);
+        }
+        catch (...) {
+          reverse_error = std::current_exception();
+        }
+      };
+      std::thread reverse_thread;
+      if (threaded) {
+        //only the worker's own thread can be interrupted
+        reverse_isochrone_gen.set_interrupt(nullptr);
+        reverse_thread = std::thread(compute_reverse, std::ref(*matrix_readers.front()), reverse_costing);
+      }
+      else {
+        reverse_isochrone_gen.set_interrupt(interrupt);
+      }
+      try {
+        if (forward)
+          grid = (costing == "multimodal" || costing == "transit") ?
+            isochrone_gen.ComputeMultiModal(*request.options.mutable_locations(), contours.back()+10, reader, mode_costing, mode) :
+            isochrone_gen.Compute(*request.options.mutable_locations(), contours.back()+10, reader, mode_costing, mode, cache_key);
+      }
+      catch (...) {
+        if (reverse_thread.joinable())
+          reverse_thread.join();
+        throw;
+      }
+      if (reverse_thread.joinable())
+        reverse_thread.join();
+      else if (reverse)
+        compute_reverse(reader, mode_costing);
+      add_search_time(start);
+      if (reverse_error)
+        std::rethrow_exception(reverse_error);
+      if (forward)
+        isochrone_gen.TallyStats(search_stats);
+      if (reverse)
+        reverse_isochrone_gen.TallyStats(search_stats);
+
+      //the two grids cover the same tiles so they can be made into one, reached
+      //either way (the smaller time) or both ways (the larger time). An image only
+      //has room for one of them
+      bool raster = request.options.format() == odin::DirectionsOptions::png;
+      if (raster && combine != "max")
+        combine = "min";
+      if (forward && reverse && (combine == "min" || combine == "max")) {
+        auto combined = std::make_shared<GriddedData<PointLL> >(*grid);
+        combined->Combine(*reverse_grid, combine == "max");
+        grid = combined;
+        reverse_grid.reset();
+      }
+      else if (!forward) {
+        grid = reverse_grid;
+        reverse_grid.reset();
+      }
+
+      //a heatmap is drawn from the grid itself, without contouring it
+      if (raster) {
+        finish_stats();
+        return tyr::serializeIsochroneRaster<PointLL>(*grid, contours.back());
+      }
+
+      //from more than one location each one can get the contours of the part of the grid
+      //nearest to it, all of them from the one expansion
+      auto showLocations = rapidjson::get<bool>(request.document, "/show_locations", false);
+      auto catchments = forward && !reverse && rapidjson::get<bool>(request.document, "/catchments", false) ?
+        isochrone_gen.Catchments() : nullptr;
+      if (catchments) {
+        std::vector<GriddedData<PointLL>::contours_t> origin_isolines;
+        for (int i = 0; i < request.options.locations_size(); ++i) {
+          GriddedData<PointLL> origin_grid(*grid);
+          origin_grid.Mask(*catchments, i);
+          origin_isolines.emplace_back(origin_grid.GenerateContours(contours, polygons, denoise, generalize));
+        }
+        finish_stats();
+        return tyr::serializeCatchments<PointLL>(request, origin_isolines, polygons, colors, showLocations);
+      }
 
       //turn it into geojson
       auto isolines = grid->GenerateContours(contours, polygons, denoise, generalize);
+      GriddedData<PointLL>::contours_t reverse_isolines;
+      if (reverse_grid)
+        reverse_isolines = reverse_grid->GenerateContours(contours, polygons, denoise, generalize);
 
-      auto showLocations = rapidjson::get<bool>(request.document, "/show_locations", false);
-      return tyr::serializeIsochrones<PointLL>(request, isolines, polygons, colors, showLocations);
+      finish_stats();
+      return tyr::serializeIsochrones<PointLL>(request, isolines, polygons, colors, showLocations,
+                                               reverse_grid ? &reverse_isolines : nullptr);
 
     }
 
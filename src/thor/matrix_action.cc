@@ -2,7 +2,10 @@
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
+#include "thor/matrixcache.h"
+#include "thor/overlaymatrix.h"
 #include "thor/timedistancematrix.h"
 #include "tyr/serializers.h"
 
@@ -23,6 +26,7 @@ namespace valhalla {
   namespace thor {
 
     std::string thor_worker_t::matrix(valhalla_request_t& request) {
+      track_stats(request);
       parse_locations(request);
       auto costing = parse_costing(request);
 
@@ -34,39 +38,152 @@ namespace valhalla {
       if (request.options.units() == odin::DirectionsOptions::miles)
         distance_scale = kMilePerMeter;
 
-      json::MapPtr json;
       //do the real work
-      std::vector<TimeDistance> time_distances;
-      auto costmatrix = [&]() {
-        thor::CostMatrix matrix;
-        return matrix.SourceToTarget(request.options.sources(), request.options.targets(), reader, mode_costing,
-                                    mode, max_matrix_distance.find(costing)->second);
+      using locations_t = google::protobuf::RepeatedPtrField<odin::Location>;
+      auto costmatrix = [&](const locations_t& sources, const locations_t& targets) {
+        thor::CostMatrix matrix(&label_arena);
+        matrix.set_interrupt(interrupt);
+        matrix.set_stats(search_stats);
+        std::vector<GraphReader*> readers;
+        for (const auto& matrix_reader : matrix_readers)
+          readers.push_back(matrix_reader.get());
+        matrix.set_thread_readers(readers);
+        return matrix.SourceToTarget(sources, targets, reader, mode_costing,
+                                    mode, service_limits.costing(request.options.costing()).max_matrix_distance);
+      };
+      auto timedistancematrix = [&](const locations_t& sources, const locations_t& targets) {
+        thor::TimeDistanceMatrix matrix(&label_arena);
+        matrix.set_interrupt(interrupt);
+        matrix.set_hierarchy_limits(matrix_hierarchy_limits);
+        return matrix.SourceToTarget(sources, targets, reader, mode_costing,
+                                    mode, service_limits.costing(request.options.costing()).max_matrix_distance);
+      };
+      //the buckets need the contraction hierarchy of the costing, which is only
+      //there when the request keeps the default costing options
+      auto bucketmatrix = [&](const locations_t& sources, const locations_t& targets) {
+        thor::BucketMatrix matrix(ch_path.graph(), matrix_threads);
+        return matrix.SourceToTarget(sources, targets, reader, mode_costing,
+                                    mode, service_limits.costing(request.options.costing()).max_matrix_distance);
       };
-      auto timedistancematrix = [&]() {
-        thor::TimeDistanceMatrix matrix;
-        return matrix.SourceToTarget(request.options.sources(), request.options.targets(), reader, mode_costing,
-                                    mode, max_matrix_distance.find(costing)->second);
+      //sweeping the overlay once per source is for batches too big for buckets
+      auto sweepmatrix = [&](const locations_t& sources, const locations_t& targets) {
+        thor::SweepMatrix matrix(ch_path.graph(), matrix_threads);
+        return matrix.SourceToTarget(sources, targets, reader, mode_costing,
+                                    mode, service_limits.costing(request.options.costing()).max_matrix_distance);
       };
-      switch (source_to_target_algorithm) {
-        case SELECT_OPTIMAL:
-          //TODO - Do further performance testing to pick the best algorithm for the job
-          switch (mode) {
-            case TravelMode::kPedestrian:
-            case TravelMode::kBicycle:
-            case TravelMode::kPublicTransit:
-              time_distances = timedistancematrix();
-              break;
-            default:
-              time_distances = costmatrix();
+      //continental matrices cross the tiles between the locations over the boundary
+      //overlay of the costing, again only there for the default costing options
+      auto overlaymatrix = [&](const locations_t& sources, const locations_t& targets) {
+        thor::OverlayMatrix matrix(overlay, matrix_threads);
+        matrix.set_interrupt(interrupt);
+        std::vector<GraphReader*> readers;
+        for (const auto& matrix_reader : matrix_readers)
+          readers.push_back(matrix_reader.get());
+        matrix.set_thread_readers(readers);
+        return matrix.SourceToTarget(sources, targets, reader, mode_costing,
+                                    mode, service_limits.costing(request.options.costing()).max_matrix_distance);
+      };
+      auto source_to_target = [&](const locations_t& sources, const locations_t& targets) -> std::vector<TimeDistance> {
+        switch (source_to_target_algorithm) {
+          case SELECT_OPTIMAL:
+            //TODO - Do further performance testing to pick the best algorithm for the job
+            if (ch_path.graph())
+              return bucketmatrix(sources, targets);
+            switch (mode) {
+              case TravelMode::kPedestrian:
+              case TravelMode::kBicycle:
+              case TravelMode::kPublicTransit:
+                return timedistancematrix(sources, targets);
+              default:
+                return costmatrix(sources, targets);
+            }
+          case COST_MATRIX:
+            return costmatrix(sources, targets);
+          case TIME_DISTANCE_MATRIX:
+            return timedistancematrix(sources, targets);
+          case SWEEP_MATRIX:
+            return ch_path.graph() ? sweepmatrix(sources, targets) : costmatrix(sources, targets);
+          case OVERLAY_MATRIX:
+            return overlay ? overlaymatrix(sources, targets) : costmatrix(sources, targets);
+          case BUCKET_MATRIX:
+          default:
+            return ch_path.graph() ? bucketmatrix(sources, targets) : costmatrix(sources, targets);
+        }
+      };
+
+      auto start = std::chrono::steady_clock::now();
+      const auto& sources = request.options.sources();
+      const auto& targets = request.options.targets();
+
+      // A sweep over departure times searches from the sources at each time,
+      // which only the time distance matrix can do, sharing the searches the
+      // time doesn't change. The cache keeps the cells of a single departure
+      auto slice_count = rapidjson::get<uint32_t>(request.document, "/time_slices/count", 0);
+      if (slice_count > 0) {
+        auto interval = rapidjson::get<uint32_t>(request.document, "/time_slices/interval", 900);
+        thor::TimeDistanceMatrix matrix(&label_arena);
+        matrix.set_interrupt(interrupt);
+        matrix.set_hierarchy_limits(matrix_hierarchy_limits);
+        auto slices = matrix.SourceToTargetSlices(sources, targets, reader, mode_costing, mode,
+            service_limits.costing(request.options.costing()).max_matrix_distance, interval, slice_count);
+        add_search_time(start);
+        finish_stats();
+        return tyr::serializeMatrixSlices(request, slices, interval, distance_scale);
+      }
+
+      std::vector<TimeDistance> time_distances;
+      if (!matrix_cache.enabled()) {
+        time_distances = source_to_target(sources, targets);
+      } else {
+        // Take the cells earlier matrices kept and see which sources and
+        // targets have cells missing
+        auto costing_key = MatrixCache::CostingKey(get_costing_key(request.document, costing));
+        std::vector<uint64_t> source_keys, target_keys;
+        for (const auto& source : sources)
+          source_keys.push_back(MatrixCache::LocationKey(source));
+        for (const auto& target : targets)
+          target_keys.push_back(MatrixCache::LocationKey(target));
+        time_distances.resize(sources.size() * targets.size());
+        std::vector<int> missing_sources, missing_targets;
+        std::vector<bool> target_missing(targets.size(), false);
+        for (int s = 0; s < sources.size(); ++s) {
+          bool source_missing = false;
+          for (int t = 0; t < targets.size(); ++t) {
+            if (!matrix_cache.Find(source_keys[s], target_keys[t], costing_key,
+                                   time_distances[s * targets.size() + t])) {
+              source_missing = true;
+              target_missing[t] = true;
+            }
+          }
+          if (source_missing)
+            missing_sources.push_back(s);
+        }
+        for (int t = 0; t < targets.size(); ++t) {
+          if (target_missing[t])
+            missing_targets.push_back(t);
+        }
+
+        // Every missing cell is in a row and a column that are missing, so
+        // search the matrix of just those and keep its cells
+        if (!missing_sources.empty()) {
+          locations_t missing_source_locations, missing_target_locations;
+          for (auto s : missing_sources)
+            missing_source_locations.Add()->CopyFrom(sources.Get(s));
+          for (auto t : missing_targets)
+            missing_target_locations.Add()->CopyFrom(targets.Get(t));
+          auto found = source_to_target(missing_source_locations, missing_target_locations);
+          for (size_t i = 0; i < missing_sources.size(); ++i) {
+            for (size_t j = 0; j < missing_targets.size(); ++j) {
+              auto s = missing_sources[i], t = missing_targets[j];
+              const auto& td = found[i * missing_targets.size() + j];
+              time_distances[s * targets.size() + t] = td;
+              matrix_cache.Insert(source_keys[s], target_keys[t], costing_key, td);
+            }
           }
-          break;
-        case COST_MATRIX:
-          time_distances = costmatrix();
-          break;
-        case TIME_DISTANCE_MATRIX:
-          time_distances = timedistancematrix();
-          break;
+        }
       }
+      add_search_time(start);
+      finish_stats();
       return tyr::serializeMatrix(request, time_distances, distance_scale);
     }
   }
@@ -0,0 +1,110 @@
+#include <functional>
+#include <iterator>
+#include <boost/functional/hash.hpp>
+#include "thor/matrixcache.h"
+
+namespace valhalla {
+namespace thor {
+
+// Constructor.
+MatrixCache::MatrixCache(const size_t max_size, const uint32_t max_age)
+    : max_size_(max_size), max_age_(max_age) {
+}
+
+// Key of a location from its correlated edges and when it departs
+uint64_t MatrixCache::LocationKey(const odin::Location& location) {
+  size_t seed = 0;
+  for (const auto& edge : location.path_edges()) {
+    boost::hash_combine(seed, edge.graph_id());
+    boost::hash_combine(seed, edge.percent_along());
+  }
+
+  // Departures in the same quarter hour share cells, date times look like
+  // 2018-03-12T08:05
+  if (location.has_date_time()) {
+    const auto& date_time = location.date_time();
+    if (date_time.size() >= 16 && date_time[13] == ':') {
+      boost::hash_combine(seed, date_time.substr(0, 14));
+      boost::hash_combine(seed, std::stoi(date_time.substr(14, 2)) / 15);
+    } else {
+      boost::hash_combine(seed, date_time);
+    }
+  }
+  return seed;
+}
+
+// Key of a costing and its options
+uint64_t MatrixCache::CostingKey(const std::string& costing) {
+  return std::hash<std::string>()(costing);
+}
+
+size_t MatrixCache::KeyHasher::operator()(const Key& key) const {
+  size_t seed = 0;
+  boost::hash_combine(seed, key.source);
+  boost::hash_combine(seed, key.target);
+  boost::hash_combine(seed, key.costing);
+  return seed;
+}
+
+// Find the time and distance of a cell that isn't too old
+bool MatrixCache::Find(const uint64_t source, const uint64_t target,
+                       const uint64_t costing, TimeDistance& td) {
+  auto cell = cells_.find({source, target, costing});
+  if (cell == cells_.end())
+    return false;
+  if (std::chrono::steady_clock::now() - cell->second.kept > max_age_) {
+    order_.erase(cell->second.order);
+    cells_.erase(cell);
+    return false;
+  }
+  td = cell->second.td;
+  return true;
+}
+
+// Keep the time and distance of a cell
+void MatrixCache::Insert(const uint64_t source, const uint64_t target,
+                         const uint64_t costing, const TimeDistance& td) {
+  if (max_size_ == 0)
+    return;
+
+  // Kept again it is the newest one
+  auto now = std::chrono::steady_clock::now();
+  Key key{source, target, costing};
+  auto cell = cells_.find(key);
+  if (cell != cells_.end()) {
+    cell->second.td = td;
+    cell->second.kept = now;
+    order_.splice(order_.end(), order_, cell->second.order);
+    return;
+  }
+
+  // Make room, the old cells first and then the oldest of the rest
+  Expire(now);
+  if (cells_.size() >= max_size_) {
+    cells_.erase(order_.front());
+    order_.pop_front();
+  }
+  order_.push_back(key);
+  cells_.emplace(key, Cell{td, now, std::prev(order_.end())});
+}
+
+// Drop all the cells
+void MatrixCache::Clear() {
+  cells_.clear();
+  order_.clear();
+}
+
+// Drop the cells older than the maximum age, they are in the order they
+// were kept in
+void MatrixCache::Expire(const std::chrono::steady_clock::time_point& now) {
+  while (!order_.empty()) {
+    auto cell = cells_.find(order_.front());
+    if (now - cell->second.kept <= max_age_)
+      break;
+    cells_.erase(cell);
+    order_.pop_front();
+  }
+}
+
+}
+}
@@ -33,6 +33,17 @@ uint32_t GetOperatorId(const GraphTile* tile, uint32_t routeid,
   return 0;
 }
 
+// Get the time zone at the end node of a directed edge
+uint32_t GetTimezone(GraphReader& graphreader, const GraphId& edgeid) {
+  const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+  if (tile == nullptr)
+    return 0;
+  GraphId endnode = tile->directededge(edgeid)->endnode();
+  if (!graphreader.GetGraphTile(endnode, tile))
+    return 0;
+  return tile->node(endnode)->timezone();
+}
+
 }
 
 namespace valhalla {
@@ -65,7 +76,7 @@ void MultiModalPathAlgorithm::Init(const PointLL& origll,
 
   // Reserve size for edge labels - do this here rather than in constructor so
   // to limit how much extra memory is used for persistent objects
-  edgelabels_.reserve(kInitialEdgeLabelCount);
+  ReserveLabels(label_arena_, edgelabels_, kInitialEdgeLabelCount);
 
   // Set up lambda to get sort costs
   const auto edgecost = [this](const uint32_t label) {
@@ -77,7 +88,10 @@ void MultiModalPathAlgorithm::Init(const PointLL& origll,
   uint32_t bucketsize = costing->UnitSize();
   float range = kBucketCount * bucketsize;
   adjacencylist_.reset(new DoubleBucketQueue(0.0f, range, bucketsize, edgecost));
-  edgestatus_.reset(new EdgeStatus());
+  if (edgestatus_)
+    edgestatus_->Init();
+  else
+    edgestatus_.reset(new EdgeStatus());
 
   // Get hierarchy limits from the costing. Get a copy since we increment
   // transition counts (i.e., this is not a const reference).
@@ -87,14 +101,19 @@ void MultiModalPathAlgorithm::Init(const PointLL& origll,
 // Clear the temporary information generated during path construction.
 void MultiModalPathAlgorithm::Clear() {
   // Clear the edge labels and destination list
-  edgelabels_.clear();
+  AddSearchStats(stats_, edgelabels_.size(), adjacencylist_.get());
+  ReleaseLabels(label_arena_, edgelabels_);
   destinations_.clear();
+  origins_.clear();
+  inbound_lines_.clear();
+  inbound_tiles_.clear();
 
   // Clear elements from the adjacency list
   adjacencylist_.reset();
 
-  // Clear the edge status flags
-  edgestatus_.reset();
+  // Clear the edge status flags, keeping the touched tiles allocated
+  if (edgestatus_)
+    edgestatus_->Init();
 
   // Set the ferry flag to false
   has_ferry_ = false;
@@ -123,9 +142,13 @@ std::vector<PathInfo> MultiModalPathAlgorithm::GetBestPath(
   // Get maximum transfer distance
   uint32_t max_transfer_distance = costing->GetMaxTransferDistanceMM();
 
-  // For now the date_time must be set on the origin.
-  if (!origin.has_date_time())
+  // Arriving by a date_time set on the destination searches back in time
+  // from the destination
+  if (!origin.has_date_time()) {
+    if (destination.has_date_time())
+      return GetBestPathReverse(origin, destination, graphreader, mode_costing, mode);
     return { };
+  }
 
   // Initialize - create adjacency list, edgestatus support, A*, etc.
   //Note: because we can correlate to more than one place for a given PathLocation
@@ -157,13 +180,12 @@ std::vector<PathInfo> MultiModalPathAlgorithm::GetBestPath(
   SetDestination(graphreader, destination, costing);
   SetOrigin(graphreader, origin, destination, costing);
 
-  uint32_t start_time, localtime, date, dow, day = 0;
+  // Parse the start time (seconds from midnight), date, and day of week
+  // once, the expansion only adds the elapsed seconds to them
+  const DateTime::time_context_t start(origin.has_date_time() ? origin.date_time() : "");
+  uint32_t start_time = start.seconds_from_midnight;
+  uint32_t dow = start.dow_mask, day = 0;
   bool date_before_tile = false;
-  if (origin.has_date_time()) {
-    // Set route start time (seconds from midnight), date, and day of week
-    start_time = DateTime::seconds_from_midnight(origin.date_time());
-    localtime = start_time;
-  }
 
   bool date_set = false;
   // Find shortest path
@@ -279,14 +301,7 @@ std::vector<PathInfo> MultiModalPathAlgorithm::GetBestPath(
       // we must get the date from level 3 transit tiles and not level 2.  The level 3 date is
       // set when the fetcher grabbed the transit data and created the schedules.
       if (!date_set) {
-        date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(origin.date_time()));
-        dow  = DateTime::day_of_week_mask(origin.date_time());
-        uint32_t date_created = tile->header()->date_created();
-        if (date < date_created)
-          date_before_tile = true;
-        else
-          day = date - date_created;
-
+        date_before_tile = !start.day_from(tile->header()->date_created(), day);
         date_set = true;
       }
     }
@@ -524,6 +539,452 @@ std::vector<PathInfo> MultiModalPathAlgorithm::GetBestPath(
   return {};      // Should never get here
 }
 
+// Calculate the best path arriving at the destination by its date_time.
+// The search goes back in time from the destination towards the origin,
+// each label keeps the time from the start of its edge to the destination.
+std::vector<PathInfo> MultiModalPathAlgorithm::GetBestPathReverse(
+            odin::Location& origin, odin::Location& destination,
+            GraphReader& graphreader,
+            const std::shared_ptr<DynamicCost>* mode_costing,
+            const TravelMode mode) {
+  mode_ = mode;
+  const auto& costing = mode_costing[static_cast<uint32_t>(mode)];
+  const auto& pc = mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)];
+  const auto& tc = mode_costing[static_cast<uint32_t>(TravelMode::kPublicTransit)];
+  bool wheelchair = tc->wheelchair();
+  bool bicycle = tc->bicycle();
+
+  // Get maximum transfer distance
+  uint32_t max_transfer_distance = costing->GetMaxTransferDistanceMM();
+
+  // Initialize - the heuristic is towards the origin, with A* disabled it
+  // is only used to check the search converges
+  PointLL origin_new(origin.path_edges(0).ll().lng(), origin.path_edges(0).ll().lat());
+  PointLL destination_new(destination.path_edges(0).ll().lng(), destination.path_edges(0).ll().lat());
+  Init(destination_new, origin_new, costing);
+  float mindist = astarheuristic_.GetDistance(destination_new);
+
+  // Walking is the first mode so check there are transit stops within
+  // walking distance of the origin
+  bool disable_transit = false;
+  if (!CanReachDestination(origin, graphreader, TravelMode::kPedestrian, pc)) {
+    if (mindist > 2000) {
+      // Throw an exception so the message is returned in the service
+      throw valhalla_exception_t{440};
+    } else {
+      // Allow routing but disable use of transit
+      disable_transit = true;
+    }
+  }
+
+  // Initialize the origin and destination locations. Initialize the
+  // origin first in case the destination edge includes an origin edge.
+  SetOriginReverse(graphreader, origin, costing);
+  SetDestinationReverse(graphreader, origin, destination, costing);
+
+  // Parse the arrival time (seconds from midnight), date, and day of week
+  // once, the expansion only subtracts the elapsed seconds from them
+  const DateTime::time_context_t end(destination.date_time());
+  int64_t end_time = end.seconds_from_midnight;
+  uint32_t dow = end.dow_mask, day = 0;
+  bool date_before_tile = false;
+
+  bool date_set = false;
+  // Find shortest path
+  uint32_t nc = 0;       // Count of iterations with no convergence
+                         // towards the origin
+  std::unordered_map<std::string, uint32_t> operators;
+  std::unordered_set<uint32_t> processed_tiles;
+  auto exclude = [&tc, &processed_tiles](const GraphTile* tile) {
+    if (processed_tiles.find(tile->id().tileid()) == processed_tiles.end()) {
+      tc->AddToExcludeList(tile);
+      processed_tiles.emplace(tile->id().tileid());
+    }
+  };
+
+  const GraphTile* tile;
+  size_t total_labels = 0;
+  while (true) {
+    // Allow this process to be aborted
+    size_t current_labels = edgelabels_.size();
+    if(interrupt && total_labels/kInterruptIterationsInterval < current_labels/kInterruptIterationsInterval)
+      (*interrupt)();
+    total_labels = current_labels;
+
+    // Get next element from adjacency list. Check that it is valid. An
+    // invalid label indicates there are no edges that can be expanded.
+    uint32_t predindex = adjacencylist_->pop();
+    if (predindex == kInvalidLabel) {
+      LOG_ERROR("Route failed after iterations = " +
+                     std::to_string(edgelabels_.size()));
+      return { };
+    }
+
+    // Copy the EdgeLabel for use in costing. Check if this is the opposing
+    // edge of an origin edge and potentially complete the path.
+    MMEdgeLabel pred = edgelabels_[predindex];
+    if (origins_.find(pred.edgeid()) != origins_.end()) {
+      // Skip a destination edge the origin is after along it
+      if (pred.predecessor() != kInvalidLabel ||
+          IsTrivial(graphreader.GetOpposingEdgeId(pred.edgeid()), origin, destination)) {
+        auto path = FormPathReverse(predindex, graphreader);
+
+        // Leave the origin in time to arrive at the destination by its
+        // date_time, the transit departures of the trip are found from it
+        const auto& tz_db = DateTime::get_tz_db();
+        auto origin_tz = tz_db.from_index(GetTimezone(graphreader, path.front().edgeid));
+        auto dest_tz = tz_db.from_index(GetTimezone(graphreader, path.back().edgeid));
+        uint64_t arrival = DateTime::seconds_since_epoch(destination.date_time(), dest_tz);
+        std::string origin_date, dest_date;
+        DateTime::seconds_to_date(false, arrival - static_cast<uint64_t>(path.back().elapsed_time),
+                                  arrival, origin_tz, dest_tz, origin_date, dest_date);
+        if (!origin_date.empty())
+          origin.set_date_time(origin_date);
+        return path;
+      }
+    }
+
+    // Mark the edge as permanently labeled. Do not do this for a destination
+    // edge (this will allow loops/around the block cases)
+    if (!pred.origin()) {
+      edgestatus_->Update(pred.edgeid(), EdgeSet::kPermanent);
+    }
+
+    // Check that distance is converging towards the origin. Return route
+    // failure if no convergence for TODO iterations
+    float dist2origin = pred.distance();
+    if (dist2origin < mindist) {
+      mindist = dist2origin;
+      nc = 0;
+    } else if (nc++ > 500000) {
+      return {};
+    }
+
+    // Get the end node of the label, this is the start node of the edge the
+    // path takes. Skip if tile not found (can happen with regional data sets).
+    GraphId node = pred.endnode();
+    if ((tile = graphreader.GetGraphTile(node)) == nullptr) {
+      continue;
+    }
+
+    // Check access at the node
+    const NodeInfo* nodeinfo = tile->node(node);
+    if (!costing->Allowed(nodeinfo)) {
+      continue;
+    }
+
+    if (nodeinfo->type() == NodeType::kMultiUseTransitPlatform || nodeinfo->type() == NodeType::kTransitStation) {
+      exclude(tile);
+
+      //check if excluded.
+      if (tc->IsExcluded(tile, nodeinfo))
+        continue;
+    }
+
+    // Set local time, the search does not go back past midnight of the day
+    // it arrives on. TODO: adjust for time zone.
+    int64_t localtime = end_time - static_cast<int64_t>(pred.cost().secs);
+
+    // Set a default transfer penalty at a stop (if not same trip Id and block Id)
+    Cost transfer_cost = tc->DefaultTransferCost();
+
+    // Get any transfer times and penalties if this is a transit stop (and
+    // transit is taken at some point later on the path) and mode is pedestrian
+    mode_ = pred.mode();
+    bool has_transit = pred.has_transit();
+    GraphId prior_stop = pred.prior_stopid();
+    uint32_t operator_id = pred.transit_operator();
+    if (nodeinfo->type() == NodeType::kMultiUseTransitPlatform) {
+
+      // Get the transfer penalty when changing stations
+      if (mode_ == TravelMode::kPedestrian && prior_stop.Is_Valid() && has_transit) {
+        transfer_cost = tc->TransferCost();
+      }
+
+      // Take the transfer time off the local time when leaving a stop as a
+      // pedestrian (entering it in the reverse direction)
+      if (mode_ == TravelMode::kPedestrian) {
+        localtime -= transfer_cost.secs;
+      }
+
+      // Update prior stop. TODO - parent/child stop info?
+      prior_stop = node;
+
+      // we must get the date from level 3 transit tiles and not level 2.  The level 3 date is
+      // set when the fetcher grabbed the transit data and created the schedules.
+      if (!date_set) {
+        date_before_tile = !end.day_from(tile->header()->date_created(), day);
+        date_set = true;
+      }
+
+      // Expand the transit lines that end at this stop, taking the latest
+      // departure along each that arrives by the local time
+      for (const auto& line : InboundLines(graphreader, node)) {
+        if (localtime < 0) {
+          break;
+        }
+        EdgeStatusInfo edgestatus = edgestatus_->Get(line.edgeid);
+        if (edgestatus.set() == EdgeSet::kPermanent) {
+          continue;
+        }
+
+        // Check if transit costing allows this edge
+        const GraphTile* linetile = graphreader.GetGraphTile(line.edgeid);
+        if (linetile == nullptr) {
+          continue;
+        }
+        const DirectedEdge* lineedge = linetile->directededge(line.edgeid);
+        exclude(linetile);
+        if (!tc->Allowed(lineedge, pred, linetile, line.edgeid) ||
+            tc->IsExcluded(linetile, lineedge)) {
+          continue;
+        }
+
+        // Frequency based departures are made for the lookup and owned here
+        std::unique_ptr<const TransitDeparture> made;
+        auto previous_departure = [&](const uint32_t arrive_by) {
+          const TransitDeparture* d = linetile->GetPreviousDeparture(
+                    lineedge->lineid(), arrive_by, day, dow, date_before_tile,
+                    wheelchair, bicycle);
+          made.reset(d != nullptr && d->type() != kFixedSchedule ? d : nullptr);
+          return d;
+        };
+        uint32_t arrive_by = static_cast<uint32_t>(localtime);
+        const TransitDeparture* departure = previous_departure(arrive_by);
+        if (!departure) {
+          continue;
+        }
+
+        // There is no cost to remain on the same trip or valid blockId
+        Cost newcost = pred.cost();
+        uint32_t line_operator = pred.transit_operator();
+        if (departure->tripid() != pred.tripid() &&
+            (departure->blockid() == 0 || departure->blockid() != pred.blockid())) {
+          if (pred.tripid() > 0) {
+            // tripId > 0 means the later edge is a transit edge and this is
+            // an "in-station" transfer. Leave a small transfer time before
+            // the later trip departs and look up an earlier departure if
+            // this one does not make it.
+            if (departure->departure_time() + departure->elapsed_time() + 30 > arrive_by) {
+              if (arrive_by < 30 || !(departure = previous_departure(arrive_by - 30)))
+                continue;
+            }
+          }
+
+          // Get the operator Id
+          line_operator = GetOperatorId(linetile, departure->routeid(), operators);
+
+          // Add transfer penalty and operator change penalty
+          if (pred.transit_operator() > 0 &&
+              pred.transit_operator() != line_operator) {
+            // TODO - create a configurable operator change penalty
+            newcost.cost += 300;
+          }
+          else newcost.cost += transfer_cost.cost;
+        }
+
+        // Add the wait at this stop and the time on the line
+        newcost += tc->EdgeCostReverse(lineedge, departure, arrive_by);
+        uint32_t tripid = departure->tripid();
+        uint32_t blockid = departure->blockid();
+
+        // Check if edge is temporarily labeled and this path has less cost
+        if (edgestatus.set() == EdgeSet::kTemporary) {
+          MMEdgeLabel& lab = edgelabels_[edgestatus.index()];
+          if (newcost.cost < lab.cost().cost) {
+            float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
+            adjacencylist_->decrease(edgestatus.index(), newsortcost);
+            lab.Update(predindex, newcost, newsortcost, pred.path_distance(),
+                       tripid, blockid);
+          }
+          continue;
+        }
+
+        // Lines start at a node of the tile they are in
+        float dist = astarheuristic_.GetDistance(linetile->node(line.startnode)->latlng());
+        float sortcost = newcost.cost + astarheuristic_.Get(dist);
+        edgelabels_.emplace_back(predindex, line.edgeid, lineedge, line.startnode,
+                      newcost, sortcost, dist, TravelMode::kPublicTransit,
+                      pred.path_distance(), tripid, prior_stop, blockid,
+                      line_operator, true);
+        AddToAdjacencyList(line.edgeid, sortcost);
+      }
+    }
+
+    // The edge the path takes from this node, for the transition cost
+    const DirectedEdge* opp_pred_edge = nullptr;
+    if (mode_ != TravelMode::kPublicTransit &&
+        pred.use() != Use::kTransitionUp) {
+      opp_pred_edge = graphreader.GetOpposingEdge(pred.edgeid());
+    }
+
+    // Expand from the node, the path takes the opposing edges
+    GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid) {
+      // Skip shortcuts. Transit lines are expanded from the stop they end at.
+      if (directededge->is_shortcut() || directededge->IsTransitLine()) {
+        continue;
+      }
+
+      // Get the current set. Skip this edge if permanently labeled (best
+      // path already found to this directed edge).
+      EdgeStatusInfo edgestatus = edgestatus_->Get(edgeid);
+      if (edgestatus.set() == EdgeSet::kPermanent) {
+        continue;
+      }
+
+      if (directededge->trans_up() || directededge->trans_down()) {
+        // Add the transition edge to the adjacency list and edge labels
+        // using the predecessor information. Transition edges have
+        // no length.
+        edgelabels_.emplace_back(predindex, edgeid, directededge->endnode(), pred);
+        AddToAdjacencyList(edgeid, pred.sortcost());
+        continue;
+      }
+
+      // Get the opposing edge. Skip if the tile at the end node is not found.
+      const GraphTile* t2 = directededge->leaves_tile() ?
+          graphreader.GetGraphTile(directededge->endnode()) : tile;
+      if (t2 == nullptr) {
+        continue;
+      }
+      GraphId oppedge = t2->GetOpposingEdgeId(directededge);
+      const DirectedEdge* opp_edge = t2->directededge(oppedge);
+
+      // Getting off transit (boarding it on the path) resets the walking
+      // distance
+      TravelMode edge_mode = mode_;
+      bool mode_change = false;
+      walking_distance_ = pred.path_distance();
+      if (edge_mode == TravelMode::kPublicTransit) {
+        edge_mode = TravelMode::kPedestrian;
+        walking_distance_ = 0;
+        mode_change = true;
+      }
+
+      // Regular edge - use the appropriate costing and check if access
+      // is allowed. If mode is pedestrian this will validate walking
+      // distance has not been exceeded.
+      const auto& mc = mode_costing[static_cast<uint32_t>(edge_mode)];
+      if (!mc->AllowedReverse(directededge, pred, opp_edge, t2, oppedge)) {
+        continue;
+      }
+
+      Cost newcost = pred.cost();
+      Cost c = mc->EdgeCost(opp_edge);
+      c.cost *= mc->GetModeFactor();
+      newcost += c;
+
+      // Add to walking distance
+      if (edge_mode == TravelMode::kPedestrian) {
+        walking_distance_ += opp_edge->length();
+
+        // Prevent going from one transit connection directly to another
+        // at a transit stop - this is like entering a station and exiting
+        // without getting on transit
+        if (nodeinfo->type() == NodeType::kTransitEgress &&
+            pred.use()   == Use::kTransitConnection &&
+            directededge->use()  == Use::kTransitConnection)
+              continue;
+      }
+
+      // Add edge transition cost from the costing model, there is none to
+      // board transit (assume the wait time is the cost)
+      if (!mode_change && opp_pred_edge != nullptr) {
+        newcost += mc->TransitionCostReverse(directededge->localedgeidx(),
+                       nodeinfo, opp_edge, opp_pred_edge);
+      }
+
+      // If this edge is the opposing edge of an origin, subtract the partial
+      // cost (cost from the start of the edge to the origin location)
+      auto p = origins_.find(edgeid);
+      if (p != origins_.end()) {
+        newcost -= p->second;
+      }
+
+      // Do not allow transit connection edges if transit is disabled. Also,
+      // prohibit leaving the same station as the later one.
+      if (directededge->use() == Use::kPlatformConnection &&
+         (disable_transit || directededge->endnode() == pred.prior_stopid())) {
+        continue;
+      }
+
+      // Test if exceeding maximum transfer walking distance
+      if (directededge->use() == Use::kPlatformConnection &&
+          pred.prior_stopid().Is_Valid() &&
+          walking_distance_ > max_transfer_distance) {
+        continue;
+      }
+
+      // Check if edge is temporarily labeled and this path has less cost.
+      if (edgestatus.set() == EdgeSet::kTemporary) {
+        MMEdgeLabel& lab = edgelabels_[edgestatus.index()];
+        if (newcost.cost < lab.cost().cost) {
+          float newsortcost = lab.sortcost() - (lab.cost().cost - newcost.cost);
+          adjacencylist_->decrease(edgestatus.index(), newsortcost);
+          lab.Update(predindex, newcost, newsortcost, walking_distance_, 0, 0);
+        }
+        continue;
+      }
+
+      // If this is an origin edge the A* heuristic is 0. Otherwise the
+      // sort cost (with A* heuristic) is found using the lat,lng at the
+      // end node of the directed edge.
+      float dist = 0.0f;
+      float sortcost = newcost.cost;
+      if (p == origins_.end()) {
+        dist = astarheuristic_.GetDistance(t2->node(directededge->endnode())->latlng());
+        sortcost += astarheuristic_.Get(dist);
+      }
+
+      // Add edge label, add to the adjacency list and set edge status
+      edgelabels_.emplace_back(predindex, edgeid, directededge,
+                    newcost, sortcost, dist, edge_mode, walking_distance_,
+                    0, prior_stop, 0, operator_id, has_transit);
+      AddToAdjacencyList(edgeid, sortcost);
+    }
+  }
+  return {};      // Should never get here
+}
+
+// Get the transit lines ending at a stop. Transit lines have no opposing
+// edges so they are indexed by the stop they end at, a transit tile at a
+// time as the search gets to its stops. Lines ending at a stop start in the
+// tile of the stop or in a tile next to it.
+const std::vector<MultiModalPathAlgorithm::inbound_line_t>&
+MultiModalPathAlgorithm::InboundLines(GraphReader& graphreader, const GraphId& stop) {
+  const auto& transit_level = TileHierarchy::GetTransitLevel();
+  if (stop.level() == transit_level.level) {
+    const auto& tiles = transit_level.tiles;
+    auto bounds = tiles.TileBounds(stop.tileid());
+    float margin = tiles.TileSize() * 0.5f;
+    AABB2<PointLL> around(bounds.minx() - margin, bounds.miny() - margin,
+                          bounds.maxx() + margin, bounds.maxy() + margin);
+    for (auto tileid : tiles.TileList(around)) {
+      if (!inbound_tiles_.insert(tileid).second) {
+        continue;
+      }
+      const GraphTile* tile = graphreader.GetGraphTile(GraphId(tileid, stop.level(), 0));
+      if (tile == nullptr) {
+        continue;
+      }
+      for (uint32_t n = 0; n < tile->header()->nodecount(); n++) {
+        const NodeInfo* nodeinfo = tile->node(n);
+        GraphId edgeid(tileid, stop.level(), nodeinfo->edge_index());
+        const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+        for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid) {
+          if (directededge->IsTransitLine()) {
+            inbound_lines_[directededge->endnode()].push_back(
+                {edgeid, GraphId(tileid, stop.level(), n)});
+          }
+        }
+      }
+    }
+  }
+  return inbound_lines_[stop];
+}
+
 // Convenience method to add an edge to the adjacency list and temporarily
 // label it.
 void MultiModalPathAlgorithm::AddToAdjacencyList(const GraphId& edgeid,
@@ -664,6 +1125,100 @@ uint32_t MultiModalPathAlgorithm::SetDestination(GraphReader& graphreader,
   return density;
 }
 
+// Keep the origin edges of a reverse search, by their opposing edges
+void MultiModalPathAlgorithm::SetOriginReverse(GraphReader& graphreader,
+                 const odin::Location& origin,
+                 const std::shared_ptr<DynamicCost>& costing) {
+  // Only skip inbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(origin.path_edges().begin(), origin.path_edges().end(), [&has_other_edges](const odin::Location::PathEdge& e){
+    has_other_edges = has_other_edges || !e.end_node();
+  });
+
+  for (const auto& edge : origin.path_edges()) {
+    // If origin is at a node - skip any inbound edge (dist = 1)
+    if (has_other_edges && edge.end_node()) {
+      continue;
+    }
+
+    // Keep the cost to traverse the partial distance before the origin
+    // along the edge. This cost is subtracted from the total cost up to the
+    // start of the origin edge.
+    GraphId edgeid(edge.graph_id());
+    GraphId oppedge = graphreader.GetOpposingEdgeId(edgeid);
+    if (!oppedge.Is_Valid()) {
+      continue;
+    }
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    origins_[oppedge] = costing->EdgeCost(tile->directededge(edgeid)) *
+                                edge.percent_along();
+
+    // We need to penalize this location based on its score (distance in meters from input)
+    // We assume the slowest speed you could travel to cover that distance to start/end the route
+    // TODO: assumes 1m/s which is a maximum penalty this could vary per costing model
+    origins_[oppedge].cost -= edge.distance();
+  }
+}
+
+// Add the opposing edges of the destination edges to the adjacency list,
+// a reverse search starts from them
+void MultiModalPathAlgorithm::SetDestinationReverse(GraphReader& graphreader,
+                 const odin::Location& origin,
+                 const odin::Location& dest,
+                 const std::shared_ptr<DynamicCost>& costing) {
+  // Only skip outbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(dest.path_edges().begin(), dest.path_edges().end(), [&has_other_edges](const odin::Location::PathEdge& e){
+    has_other_edges = has_other_edges || !e.begin_node();
+  });
+
+  for (const auto& edge : dest.path_edges()) {
+    // If destination is at a node skip any outbound edges
+    if (has_other_edges && edge.begin_node()) {
+      continue;
+    }
+
+    // Get the opposing edge, skip if its tile is not found
+    GraphId edgeid(edge.graph_id());
+    const GraphTile* opp_tile = nullptr;
+    GraphId oppedge = graphreader.GetOpposingEdgeId(edgeid, opp_tile);
+    if (!oppedge.Is_Valid()) {
+      continue;
+    }
+    const DirectedEdge* opp_dir_edge = opp_tile->directededge(oppedge);
+    const DirectedEdge* directededge = graphreader.GetGraphTile(edgeid)->directededge(edgeid);
+
+    // Get the cost to the destination along the edge, penalized by the
+    // score of the location as the forward search does
+    Cost cost = costing->EdgeCost(directededge) * edge.percent_along();
+    cost.cost += edge.distance();
+
+    // If the origin is before the destination along this edge the path
+    // only takes part of it between the two
+    auto p = origins_.find(oppedge);
+    if (p != origins_.end() && IsTrivial(edgeid, origin, dest)) {
+      cost -= p->second;
+      cost.cost = std::max(0.0f, cost.cost);
+    }
+
+    // Add EdgeLabel to the adjacency list (but do not set its status).
+    // Set the predecessor edge index to invalid to indicate the start of
+    // the search, its end node is the start node of the destination edge.
+    const GraphTile* endtile = graphreader.GetGraphTile(opp_dir_edge->endnode());
+    if (endtile == nullptr) {
+      continue;
+    }
+    float dist = astarheuristic_.GetDistance(endtile->node(opp_dir_edge->endnode())->latlng());
+    uint32_t d = static_cast<uint32_t>(directededge->length() * edge.percent_along());
+    MMEdgeLabel edge_label(kInvalidLabel, oppedge, opp_dir_edge, cost,
+                         cost.cost + astarheuristic_.Get(dist), dist, mode_, d,
+                         0, GraphId(), 0, 0, false);
+    edge_label.set_origin();
+    edgelabels_.push_back(std::move(edge_label));
+    adjacencylist_->add(edgelabels_.size() - 1);
+  }
+}
+
 // Check if destination can be reached if walking is the last mode. Checks
 // if there are any transit stops within maximum walking distance.
 // TODO - once auto/bicycle are allowed modes we need to check if parking
@@ -820,5 +1375,42 @@ std::vector<PathInfo> MultiModalPathAlgorithm::FormPath(const uint32_t dest) {
   return path;
 }
 
+// Form the path of a reverse search. The labels from the origin reach the
+// destination through their predecessors so the path is already in order.
+// Transition edges are left out as bidirectional A* does.
+std::vector<PathInfo> MultiModalPathAlgorithm::FormPathReverse(
+            const uint32_t origin_label, GraphReader& graphreader) {
+  // Metrics to track
+  LOG_DEBUG("path_cost::" + std::to_string(edgelabels_[origin_label].cost().cost));
+  LOG_DEBUG("path_iterations::" + std::to_string(edgelabels_.size()));
+
+  // The time at the end of each edge is how long it takes to get to the
+  // start of the next one, the labels keep the time from there on
+  float secs = edgelabels_[origin_label].cost().secs;
+  std::vector<PathInfo> path;
+  for(auto edgelabel_index = origin_label; edgelabel_index != kInvalidLabel;
+      edgelabel_index = edgelabels_[edgelabel_index].predecessor()) {
+    const MMEdgeLabel& edgelabel = edgelabels_[edgelabel_index];
+    if (edgelabel.use() == Use::kTransitionUp) {
+      continue;
+    }
+
+    // The path takes transit lines themselves and the opposing edges of
+    // the other labels
+    GraphId edgeid = edgelabel.tripid() > 0 &&
+                     edgelabel.mode() == TravelMode::kPublicTransit ?
+        edgelabel.edgeid() : graphreader.GetOpposingEdgeId(edgelabel.edgeid());
+    uint32_t next = edgelabel.predecessor();
+    float elapsed = secs - (next == kInvalidLabel ? 0.0f : edgelabels_[next].cost().secs);
+    path.emplace_back(edgelabel.mode(), elapsed, edgeid, edgelabel.tripid());
+
+    // Check if this is a ferry
+    if (edgelabel.use() == Use::kFerry) {
+      has_ferry_ = true;
+    }
+  }
+  return path;
+}
+
 }
 }
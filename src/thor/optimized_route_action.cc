@@ -18,6 +18,7 @@ namespace valhalla {
   namespace thor {
 
   std::list<valhalla::odin::TripPath> thor_worker_t::optimized_route(valhalla_request_t& request) {
+    track_stats(request);
     parse_locations(request);
     auto costing = parse_costing(request);
 
@@ -25,10 +26,19 @@ namespace valhalla {
       valhalla::midgard::logging::Log("matrix_type::optimized_route", " [ANALYTICS] ");
 
     // Use CostMatrix to find costs from each location to every other location
-    CostMatrix costmatrix;
+    CostMatrix costmatrix(&label_arena);
+    std::vector<GraphReader*> readers;
+    for (const auto& matrix_reader : matrix_readers)
+      readers.push_back(matrix_reader.get());
+    costmatrix.set_thread_readers(readers);
+    costmatrix.set_interrupt(interrupt);
+    costmatrix.set_stats(search_stats);
+    auto start = std::chrono::steady_clock::now();
     std::vector<thor::TimeDistance> td = costmatrix.SourceToTarget(request.options.sources(), request.options.targets(), reader,
                                                                   mode_costing, mode,
-                                                                  max_matrix_distance.find(costing)->second);
+                                                                  service_limits.costing(request.options.costing()).max_matrix_distance);
+    add_search_time(start);
+    costmatrix.Clear();
 
     // Return an error if any locations are totally unreachable
     const auto& correlated =  (request.options.sources_size() > request.options.targets_size() ?
@@ -49,7 +59,7 @@ namespace valhalla {
       time_costs.emplace_back(static_cast<float>(td[i].time));
     }
 
-    Optimizer optimizer;
+    Optimizer optimizer(optimizer_chains);
     //returns the optimal order of the path_locations
     auto optimal_order = optimizer.Solve(correlated.size(), time_costs);
     //put the optimal order into the locations array
@@ -57,7 +67,9 @@ namespace valhalla {
     for (size_t i = 0; i < optimal_order.size(); i++)
       request.options.mutable_locations()->Add()->CopyFrom(correlated.Get(optimal_order[i]));
 
-    return path_depart_at(*request.options.mutable_locations(), costing);
+    auto trip_paths = path_depart_at(*request.options.mutable_locations(), costing, AttributesController());
+    finish_stats();
+    return trip_paths;
   }
 
   }
@@ -1,9 +1,17 @@
+#include <thread>
 #include "thor/optimizer.h"
 #include "midgard/logging.h"
 
 namespace valhalla {
 namespace thor {
 
+// Constructor
+Optimizer::Optimizer(const uint32_t chains, const bool local_search)
+    : chains_(chains ? chains : std::max(1u, std::thread::hardware_concurrency())),
+      seed_(std::mt19937_64::default_seed),
+      local_search_(local_search) {
+}
+
 // Optimize the tour through a set of locations given the cost matrix
 // among all locations. The first location (origin) and last location
 // (destination) remain fixed in the tour.
@@ -22,6 +30,46 @@ std::vector<uint32_t> Optimizer::Solve(const uint32_t count,
     return (TourCost(costs, tour1) < TourCost(costs, tour2)) ? tour1 : tour2;
   }
 
+  if (local_search_)
+    FindNeighbors(costs);
+
+  // Run the chains on threads of their own, each from a copy of this
+  // optimizer with its own seed
+  if (chains_ == 1) {
+    Run(costs);
+  } else {
+    std::vector<Optimizer> chains(chains_, *this);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < chains_; i++) {
+      chains[i].random_generator_.seed(seed_ + i);
+      if (i > 0)
+        threads.emplace_back([&chains, &costs, i]() { chains[i].Run(costs); });
+    }
+    chains.front().Run(costs);
+    for (auto& thread : threads)
+      thread.join();
+
+    // Keep the best tour, the one of the first chain to find it on ties
+    ntry_ = 0;
+    best_cost_ = chains.front().best_cost_;
+    best_tour_ = chains.front().best_tour_;
+    for (const auto& chain : chains) {
+      ntry_ += chain.ntry_;
+      if (chain.best_cost_ < best_cost_) {
+        best_cost_ = chain.best_cost_;
+        best_tour_ = chain.best_tour_;
+      }
+    }
+  }
+
+  // Return the best tour
+  LOG_DEBUG("Best tour cost = " + std::to_string(best_cost_) +
+           " ntries = " + std::to_string(ntry_));
+  return best_tour_;
+}
+
+// Run one annealing chain from a random tour.
+void Optimizer::Run(const std::vector<float>& costs) {
   // Populate the initial tour with a random order. The first and last
   // locations must remain fixed as the tour begin and end locations do not
   // change.
@@ -47,10 +95,104 @@ std::vector<uint32_t> Optimizer::Solve(const uint32_t count,
     temperature *= kCoolingRate;
   }
 
-  // Return the best tour
-  LOG_DEBUG("Best tour cost = " + std::to_string(best_cost_) +
-           " ntries = " + std::to_string(ntry_));
-  return best_tour_;
+  // Polish the best tour of the chain
+  if (local_search_)
+    LocalSearch(costs);
+}
+
+// Find the cheapest locations to go to from each location.
+void Optimizer::FindNeighbors(const std::vector<float>& costs) {
+  auto neighbors = std::make_shared<std::vector<std::vector<uint32_t> > >(count_);
+  std::vector<uint32_t> others;
+  for (uint32_t from = 0; from < count_; from++) {
+    others.clear();
+    for (uint32_t to = 1; to < count_; to++) {
+      if (to != from)
+        others.push_back(to);
+    }
+    uint32_t n = std::min<uint32_t>(kLocalSearchNeighbors, others.size());
+    std::partial_sort(others.begin(), others.begin() + n, others.end(),
+                      [this, &costs, from](const uint32_t a, const uint32_t b) {
+                        return Cost(costs, from, a) < Cost(costs, from, b);
+                      });
+    (*neighbors)[from].assign(others.begin(), others.begin() + n);
+  }
+  neighbors_ = neighbors;
+}
+
+// Improve the best tour with 2-opt and or-opt moves.
+void Optimizer::LocalSearch(const std::vector<float>& costs) {
+  UpdateTourSums(costs);
+  while (TwoOptMove(costs) || OrOptMove(costs)) {
+    UpdateTourSums(costs);
+  }
+  best_cost_ = TourCost(costs, best_tour_);
+}
+
+// Reverse the first part of the tour that lowers its cost when reversed.
+bool Optimizer::TwoOptMove(const std::vector<float>& costs) {
+  const auto& tour = best_tour_;
+  for (uint32_t i = 1; i < count_ - 2; i++) {
+    // Reverse the locations from i to j so that the one before i goes to
+    // its neighbor at j
+    for (uint32_t neighbor : (*neighbors_)[tour[i - 1]]) {
+      uint32_t j = position_[neighbor];
+      if (j <= i || j >= count_ - 1)
+        continue;
+      double diff = Cost(costs, tour[i - 1], tour[j]) + Cost(costs, tour[i], tour[j + 1]) -
+                    Cost(costs, tour[i - 1], tour[i]) - Cost(costs, tour[j], tour[j + 1]) +
+                    (backward_[j] - backward_[i]) - (forward_[j] - forward_[i]);
+      if (diff < -kMinImprovement) {
+        std::reverse(best_tour_.begin() + i, best_tour_.begin() + j + 1);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Move the first run of locations that lowers the tour cost when moved.
+bool Optimizer::OrOptMove(const std::vector<float>& costs) {
+  const auto& tour = best_tour_;
+  for (uint32_t length = 1; length <= 3; length++) {
+    for (uint32_t i = 1; i + length < count_; i++) {
+      // Take the run from i to e out and put it in front of a neighbor of e
+      uint32_t e = i + length - 1;
+      double removed = Cost(costs, tour[i - 1], tour[i]) + Cost(costs, tour[e], tour[e + 1]) -
+                       Cost(costs, tour[i - 1], tour[e + 1]);
+      for (uint32_t neighbor : (*neighbors_)[tour[e]]) {
+        uint32_t p = position_[neighbor];
+        if ((p >= i && p <= e + 1) || p == 0)
+          continue;
+        double added = Cost(costs, tour[p - 1], tour[i]) + Cost(costs, tour[e], tour[p]) -
+                       Cost(costs, tour[p - 1], tour[p]);
+        if (added - removed < -kMinImprovement) {
+          if (p > e) {
+            std::rotate(best_tour_.begin() + i, best_tour_.begin() + e + 1, best_tour_.begin() + p);
+          } else {
+            std::rotate(best_tour_.begin() + p, best_tour_.begin() + i, best_tour_.begin() + e + 1);
+          }
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Update the positions and prefix sums of the best tour.
+void Optimizer::UpdateTourSums(const std::vector<float>& costs) {
+  position_.resize(count_);
+  forward_.resize(count_);
+  backward_.resize(count_);
+  forward_[0] = backward_[0] = 0.0;
+  for (uint32_t i = 0; i < count_; i++) {
+    position_[best_tour_[i]] = i;
+    if (i > 0) {
+      forward_[i] = forward_[i - 1] + Cost(costs, best_tour_[i - 1], best_tour_[i]);
+      backward_[i] = backward_[i - 1] + Cost(costs, best_tour_[i], best_tour_[i - 1]);
+    }
+  }
 }
 
 // Perform the annealing process.
@@ -106,7 +248,7 @@ void Optimizer::CreateRandomTour() {
   for (uint32_t i = 1; i < count_ - 1; i++) {
     tour_.push_back(i);
   }
-  std::random_shuffle(tour_.begin(), tour_.end());
+  std::shuffle(tour_.begin(), tour_.end(), random_generator_);
   tour_.insert(tour_.begin(), 0);
   tour_.push_back(count_ - 1);
 }
@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include "baldr/graphtile.h"
+#include "midgard/logging.h"
+#include "sif/edgelabel.h"
+#include "sif/hierarchylimits.h"
+#include "thor/overlaymatrix.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+
+namespace {
+
+using namespace valhalla::thor;
+
+// Search label of an edge or an overlay node
+struct label_t {
+  float cost;
+  float secs;
+  float length;
+};
+
+using queue_entry_t = std::pair<float, uint64_t>;
+using min_queue_t = std::priority_queue<queue_entry_t, std::vector<queue_entry_t>,
+                                        std::greater<queue_entry_t> >;
+
+// A target's seed at a node of the overlay
+struct entry_t {
+  uint32_t node;
+  uint32_t target;
+  label_t label;
+};
+
+// Run work(index, reader) for every index below count, on the calling thread
+// with its own reader and on a thread for each of the extra readers. The
+// first exception stops the threads taking more work and is thrown once they
+// are done.
+void Parallel(const size_t count, GraphReader& reader, const std::vector<GraphReader*>& extra,
+              const std::function<void (size_t, GraphReader&)>& work) {
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_lock;
+  const auto run = [&](GraphReader& r) {
+    try {
+      for (size_t i = next++; i < count; i = next++)
+        work(i, r);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_lock);
+      if (!error)
+        error = std::current_exception();
+      next = count;
+    }
+  };
+  size_t thread_count = std::min<size_t>(extra.size(), count > 0 ? count - 1 : 0);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < thread_count; ++i)
+    threads.emplace_back(run, std::ref(*extra[i]));
+  run(reader);
+  for (auto& thread : threads)
+    thread.join();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+bool equals(const valhalla::odin::LatLng& a, const valhalla::odin::LatLng&b) {
+  return a.has_lat() == b.has_lat() && a.has_lng() == b.has_lng() &&
+      (!a.has_lat() || a.lat() == b.lat()) && (!a.has_lng() || a.lng() == b.lng());
+}
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+OverlayMatrix::OverlayMatrix(const std::shared_ptr<const OverlayGraph>& graph,
+                             const uint32_t max_threads)
+    : graph_(graph),
+      max_threads_(max_threads ? max_threads :
+                   std::max(1u, std::thread::hardware_concurrency())),
+      interrupt_(nullptr) {
+}
+
+// Form a time distance matrix from the set of source locations
+// to the set of target locations.
+std::vector<TimeDistance> OverlayMatrix::SourceToTarget(
+        const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+        const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+        GraphReader& graphreader,
+        const std::shared_ptr<DynamicCost>* mode_costing,
+        const TravelMode mode, const float max_matrix_distance) {
+  auto& costing = *mode_costing[static_cast<uint32_t>(mode)];
+  const size_t source_count = source_location_list.size();
+  const size_t target_count = target_location_list.size();
+  std::vector<PointLL> source_lls, target_lls;
+  for (const auto& location : source_location_list)
+    source_lls.emplace_back(location.ll().lng(), location.ll().lat());
+  for (const auto& location : target_location_list)
+    target_lls.emplace_back(location.ll().lng(), location.ll().lat());
+
+  // The targets by their edges so the sources can meet them on the way
+  std::vector<std::vector<Origin> > target_origins(target_count);
+  std::unordered_map<uint64_t, std::vector<TargetEdge> > target_edges;
+  for (size_t j = 0; j < target_count; ++j) {
+    target_origins[j] = Origins(target_location_list.Get(j), graphreader, costing, false);
+    for (const auto& origin : target_origins[j]) {
+      target_edges[origin.edgeid].push_back({static_cast<uint32_t>(j), origin.cost,
+                                             origin.secs, origin.length});
+    }
+  }
+
+  // Search locally from the targets and the sources, the targets first, on
+  // the threads that have a graph reader of their own
+  std::vector<std::vector<Seed> > sources(source_count), targets(target_count);
+  std::vector<std::vector<Connection> > direct(source_count);
+  Parallel(source_count + target_count, graphreader, thread_readers_,
+           [&](size_t i, GraphReader& reader) {
+    if (interrupt_ && &reader == &graphreader)
+      (*interrupt_)();
+    std::vector<Connection> none;
+    if (i < target_count) {
+      std::vector<PointLL> near(1, target_lls[i]);
+      near.insert(near.end(), source_lls.begin(), source_lls.end());
+      targets[i] = Search(target_origins[i], near, reader, costing, false, nullptr, none);
+    } else {
+      size_t s = i - target_count;
+      std::vector<PointLL> near(1, source_lls[s]);
+      near.insert(near.end(), target_lls.begin(), target_lls.end());
+      direct[s].assign(target_count, Connection{kMaxCost, kMaxCost, kMaxCost});
+      sources[s] = Search(Origins(source_location_list.Get(s), reader, costing, true), near,
+                          reader, costing, true, &target_edges, direct[s]);
+    }
+  });
+  if (interrupt_)
+    (*interrupt_)();
+  auto connections = Connect(sources, targets);
+
+  // Locations that are the same are 0 apart, otherwise take the cheaper of
+  // the ways over the overlay and the direct one, leaving out what is too
+  // long to be in the matrix
+  std::vector<TimeDistance> td;
+  td.reserve(connections.size());
+  for (uint32_t i = 0; i < source_count; ++i) {
+    for (uint32_t j = 0; j < target_count; ++j) {
+      auto connection = connections[i * target_count + j];
+      if (direct[i][j].cost < connection.cost)
+        connection = direct[i][j];
+      if (equals(source_location_list.Get(i).ll(), target_location_list.Get(j).ll())) {
+        td.emplace_back(0, 0);
+      } else if (connection.cost == kMaxCost || connection.length > max_matrix_distance) {
+        td.emplace_back(kMaxCost, kMaxCost);
+      } else {
+        td.emplace_back(std::round(connection.secs), std::round(connection.length));
+      }
+    }
+  }
+  return td;
+}
+
+// Find the cheapest connections over the overlay between all the sources
+// and targets
+std::vector<OverlayMatrix::Connection> OverlayMatrix::Connect(
+        const std::vector<std::vector<Seed> >& sources,
+        const std::vector<std::vector<Seed> >& targets) const {
+  std::vector<Connection> connections(sources.size() * targets.size(),
+                                      Connection{kMaxCost, kMaxCost, kMaxCost});
+  if (!graph_ || targets.empty())
+    return connections;
+
+  // The seeds of the targets in buckets by node. The seed of a target on a
+  // boundary edge refunds the rest of the edge, which the searches have to
+  // allow for before they stop.
+  std::vector<entry_t> entries;
+  float refund = 0.0f;
+  for (uint32_t j = 0; j < targets.size(); ++j) {
+    for (const auto& seed : targets[j]) {
+      entries.push_back({seed.node, j, {seed.cost, seed.secs, seed.length}});
+      refund = std::min(refund, seed.cost);
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const entry_t& a, const entry_t& b) {
+    return a.node == b.node ? a.target < b.target : a.node < b.node;
+  });
+  std::vector<uint32_t> buckets(graph_->node_count() + 1, 0);
+  for (const auto& entry : entries)
+    buckets[entry.node + 1]++;
+  for (size_t v = 1; v < buckets.size(); ++v)
+    buckets[v] += buckets[v - 1];
+
+  // Search the overlay from each source until every target has been met
+  // and nothing cheaper is left. Each source fills in its own row, the
+  // sources being split across threads.
+  std::atomic<size_t> next(0);
+  const auto run = [&]() {
+    const label_t none{kMaxCost, kMaxCost, kMaxCost};
+    std::vector<label_t> labels(graph_->node_count(), none);
+    std::vector<uint32_t> touched;
+    min_queue_t queue;
+    for (size_t i = next++; i < sources.size(); i = next++) {
+      for (auto node : touched)
+        labels[node] = none;
+      touched.clear();
+      queue = min_queue_t();
+      for (const auto& seed : sources[i]) {
+        if (seed.cost < labels[seed.node].cost) {
+          if (labels[seed.node].cost == kMaxCost)
+            touched.push_back(seed.node);
+          labels[seed.node] = {seed.cost, seed.secs, seed.length};
+          queue.emplace(seed.cost, seed.node);
+        }
+      }
+
+      Connection* row = connections.data() + i * targets.size();
+      size_t met = 0;
+      float worst = kMaxCost;
+      while (!queue.empty()) {
+        float cost = queue.top().first;
+        uint32_t node = static_cast<uint32_t>(queue.top().second);
+        queue.pop();
+        const label_t pred = labels[node];
+        if (cost > pred.cost)
+          continue;
+        if (met == targets.size() && cost + refund >= worst)
+          break;
+
+        bool improved = false;
+        for (uint32_t e = buckets[node]; e < buckets[node + 1]; ++e) {
+          const auto& entry = entries[e];
+          // Meeting where both started is only a path if the target is
+          // ahead of the source on the same edge
+          float length = pred.length + entry.label.length;
+          if (length < 0.0f)
+            continue;
+          float c = cost + entry.label.cost;
+          auto& connection = row[entry.target];
+          if (c < connection.cost) {
+            if (connection.cost == kMaxCost)
+              met++;
+            connection = {c, pred.secs + entry.label.secs, length};
+            improved = true;
+          }
+        }
+        if (improved && met == targets.size()) {
+          worst = 0.0f;
+          for (size_t j = 0; j < targets.size(); ++j)
+            worst = std::max(worst, row[j].cost);
+        }
+
+        for (const auto& arc : graph_->arcs(node)) {
+          float c = cost + arc.cost;
+          label_t& label = labels[arc.node];
+          if (c < label.cost) {
+            if (label.cost == kMaxCost)
+              touched.push_back(arc.node);
+            label = {c, pred.secs + arc.secs, pred.length + arc.length};
+            queue.emplace(c, arc.node);
+          }
+        }
+      }
+    }
+  };
+  size_t thread_count = std::max<size_t>(1, std::min<size_t>(max_threads_, sources.size()));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(run);
+  run();
+  for (auto& thread : threads)
+    thread.join();
+  return connections;
+}
+
+// Seed the search of a location the same way the bucket matrix does
+std::vector<OverlayMatrix::Origin> OverlayMatrix::Origins(const odin::Location& location,
+        GraphReader& graphreader, const DynamicCost& costing, const bool forward) const {
+  // Only skip inbound (or outbound) edges if we have other options
+  bool has_other_edges = false;
+  for (const auto& edge : location.path_edges())
+    has_other_edges = has_other_edges || !(forward ? edge.end_node() : edge.begin_node());
+
+  std::vector<Origin> origins;
+  for (const auto& edge : location.path_edges()) {
+    if (has_other_edges && (forward ? edge.end_node() : edge.begin_node()))
+      continue;
+    GraphId edgeid(edge.graph_id());
+    const DirectedEdge* directededge = graphreader.directededge(edgeid);
+    if (directededge == nullptr)
+      continue;
+
+    // What is left of the edge past the location
+    float remainder = 1.0f - edge.percent_along();
+    Cost cost = costing.EdgeCost(directededge) * remainder;
+    float length = directededge->length() * remainder;
+    if (forward)
+      origins.push_back({edgeid, cost.cost + edge.distance(), cost.secs, length});
+    else
+      origins.push_back({edgeid, edge.distance() - cost.cost, -cost.secs, -length});
+  }
+  return origins;
+}
+
+// Search locally from a location to the boundary edges. Edges are labeled
+// the way the overlay is, going forward with what it takes to the end of an
+// edge and going backward with what it takes from the end of an edge. The
+// turns are the ones CHBuilder::Turns finds, made at the end node of an edge
+// or at its copy on another level.
+std::vector<OverlayMatrix::Seed> OverlayMatrix::Search(const std::vector<Origin>& origins,
+        const std::vector<PointLL>& near, GraphReader& graphreader, DynamicCost& costing,
+        const bool forward, const std::unordered_map<uint64_t, std::vector<TargetEdge> >* targets,
+        std::vector<Connection>& direct) const {
+  std::vector<Seed> seeds;
+  if (!graph_)
+    return seeds;
+
+  auto filter = costing.GetEdgeFilter();
+  const auto usable = [&filter](const DirectedEdge* edge) {
+    return !edge->IsTransition() && !edge->is_shortcut() && filter(edge) > 0.f;
+  };
+  // Levels above 0 are only expanded near the locations
+  const auto& limits = costing.GetHierarchyLimits();
+  const auto expand = [&limits, &near](const GraphId& node, const PointLL& ll) {
+    if (node.level() == 0 || node.level() >= limits.size())
+      return true;
+    float within = limits[node.level()].expansion_within_dist;
+    return std::any_of(near.cbegin(), near.cend(),
+                       [&ll, within](const PointLL& other) { return ll.Distance(other) <= within; });
+  };
+
+  std::unordered_map<uint64_t, label_t> labels;
+  min_queue_t queue;
+  for (const auto& origin : origins) {
+    if (!usable(graphreader.directededge(origin.edgeid)))
+      continue;
+    auto label = labels.find(origin.edgeid);
+    if (label == labels.end() || origin.cost < label->second.cost) {
+      labels[origin.edgeid] = {origin.cost, origin.secs, origin.length};
+      queue.emplace(origin.cost, origin.edgeid);
+    }
+  }
+  const auto relax = [&labels, &queue](const GraphId& edgeid, const label_t& pred, const Cost& cost,
+                                       const float length) {
+    float c = pred.cost + cost.cost;
+    auto label = labels.find(edgeid);
+    if (label == labels.end() || c < label->second.cost) {
+      labels[edgeid] = {c, pred.secs + cost.secs, pred.length + length};
+      queue.emplace(c, edgeid);
+    }
+  };
+
+  std::vector<GraphId> nodes;
+  while (!queue.empty()) {
+    float cost = queue.top().first;
+    GraphId edgeid(queue.top().second);
+    queue.pop();
+    const label_t pred = labels[edgeid];
+    if (cost > pred.cost)
+      continue;
+
+    // Targets met on the way
+    if (targets) {
+      auto found = targets->find(edgeid);
+      if (found != targets->cend()) {
+        for (const auto& target : found->second) {
+          float length = pred.length + target.length;
+          float c = pred.cost + target.cost;
+          if (length >= 0.0f && c < direct[target.target].cost)
+            direct[target.target] = {c, pred.secs + target.secs, length};
+        }
+      }
+    }
+
+    // The overlay takes it from the boundary
+    uint32_t node = graph_->node(edgeid);
+    if (node != kInvalidOverlayNode) {
+      seeds.push_back({node, pred.cost, pred.secs, pred.length});
+      continue;
+    }
+
+    const GraphTile* tile = nullptr;
+    const DirectedEdge* edge = graphreader.directededge(edgeid, tile);
+    if (edge == nullptr)
+      continue;
+
+    if (forward) {
+      // Turn onto the edges leaving the end node
+      EdgeLabel label(0, edgeid, edge, Cost(), 0.f, 0.f, costing.travel_mode(), 0);
+      nodes.assign(1, edge->endnode());
+      for (size_t n = 0; n < nodes.size(); ++n) {
+        const GraphTile* node_tile = graphreader.GetGraphTile(nodes[n]);
+        if (node_tile == nullptr)
+          continue;
+        const NodeInfo* nodeinfo = node_tile->node(nodes[n]);
+        bool allowed = costing.Allowed(nodeinfo) && expand(nodes[n], nodeinfo->latlng());
+        GraphId nextid(nodes[n].tileid(), nodes[n].level(), nodeinfo->edge_index());
+        const DirectedEdge* next = node_tile->directededge(nodeinfo->edge_index());
+        for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++next, ++nextid) {
+          if (next->IsTransition()) {
+            if (std::find(nodes.cbegin(), nodes.cend(), next->endnode()) == nodes.cend())
+              nodes.push_back(next->endnode());
+            continue;
+          }
+          if (!allowed || !usable(next) || !costing.Allowed(next, label, node_tile, nextid))
+            continue;
+          relax(nextid, pred, costing.TransitionCost(next, nodeinfo, label) + costing.EdgeCost(next),
+                next->length());
+        }
+      }
+    } else {
+      // Turn off the edges entering the begin node, or its copies
+      const GraphTile* opp_tile = tile;
+      GraphId oppid = graphreader.GetOpposingEdgeId(edgeid, opp_tile);
+      const DirectedEdge* opp = oppid.Is_Valid() ? graphreader.directededge(oppid, opp_tile) : nullptr;
+      if (opp == nullptr)
+        continue;
+      const GraphTile* begin_tile = graphreader.GetGraphTile(opp->endnode());
+      if (begin_tile == nullptr)
+        continue;
+      const NodeInfo* begininfo = begin_tile->node(opp->endnode());
+      if (!costing.Allowed(begininfo))
+        continue;
+      Cost edge_cost = costing.EdgeCost(edge);
+      nodes.assign(1, opp->endnode());
+      for (size_t n = 0; n < nodes.size(); ++n) {
+        const GraphTile* node_tile = graphreader.GetGraphTile(nodes[n]);
+        if (node_tile == nullptr)
+          continue;
+        const NodeInfo* nodeinfo = node_tile->node(nodes[n]);
+        bool allowed = expand(nodes[n], nodeinfo->latlng());
+        GraphId outid(nodes[n].tileid(), nodes[n].level(), nodeinfo->edge_index());
+        const DirectedEdge* out = node_tile->directededge(nodeinfo->edge_index());
+        for (uint32_t i = 0; i < nodeinfo->edge_count(); ++i, ++out, ++outid) {
+          if (out->IsTransition()) {
+            if (std::find(nodes.cbegin(), nodes.cend(), out->endnode()) == nodes.cend())
+              nodes.push_back(out->endnode());
+            continue;
+          }
+          if (!allowed)
+            continue;
+          const GraphTile* in_tile = node_tile;
+          GraphId inid = graphreader.GetOpposingEdgeId(outid, in_tile);
+          const DirectedEdge* in = inid.Is_Valid() ? graphreader.directededge(inid, in_tile) : nullptr;
+          if (in == nullptr || !usable(in))
+            continue;
+          EdgeLabel label(0, inid, in, Cost(), 0.f, 0.f, costing.travel_mode(), 0);
+          if (!costing.Allowed(edge, label, tile, edgeid))
+            continue;
+          relax(inid, pred, costing.TransitionCost(edge, begininfo, label) + edge_cost,
+                edge->length());
+        }
+      }
+    }
+  }
+  return seeds;
+}
+
+}
+}
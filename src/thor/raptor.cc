@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include "baldr/datetime.h"
+#include "midgard/logging.h"
+#include "thor/raptor.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Seconds to change from one trip to another at the same stop
+constexpr uint32_t kInStationTransferSeconds = 30;
+
+constexpr uint64_t kInitialWalkLabelCount = 50000;
+
+// Copy a departure, freeing it if it was made for a frequency based trip
+TransitDeparture TakeDeparture(const TransitDeparture* departure) {
+  TransitDeparture copy = *departure;
+  if (departure->type() == kFrequencySchedule)
+    delete departure;
+  return copy;
+}
+
+}
+
+namespace valhalla {
+namespace thor {
+
+// Constructor
+RaptorPathAlgorithm::RaptorPathAlgorithm(const uint32_t max_rounds)
+    : PathAlgorithm(),
+      max_rounds_(max_rounds),
+      walk_base_(0),
+      best_label_(kInvalidLabel),
+      best_secs_(std::numeric_limits<float>::max()),
+      start_time_(0),
+      days_from_pivot_(0),
+      day_(0),
+      dow_(0),
+      date_before_tile_(false),
+      date_set_(false),
+      wheelchair_(false),
+      bicycle_(false) {
+}
+
+// Destructor
+RaptorPathAlgorithm::~RaptorPathAlgorithm() {
+  Clear();
+}
+
+// Clear the temporary information generated during path construction.
+void RaptorPathAlgorithm::Clear() {
+  AddSearchStats(stats_, labels_.size(), nullptr);
+  labels_.clear();
+  arrivals_.clear();
+  ReleaseLabels(label_arena_, walklabels_);
+  adjacencylist_.reset();
+  if (edgestatus_)
+    edgestatus_->Init();
+  destinations_.clear();
+  processed_tiles_.clear();
+  best_label_ = kInvalidLabel;
+  best_secs_ = std::numeric_limits<float>::max();
+  date_set_ = false;
+  has_ferry_ = false;
+}
+
+// Calculate the earliest arriving path, with the fewest trips, by transit
+std::vector<PathInfo> RaptorPathAlgorithm::GetBestPath(
+            odin::Location& origin, odin::Location& destination,
+            GraphReader& graphreader,
+            const std::shared_ptr<DynamicCost>* mode_costing,
+            const TravelMode mode) {
+  // Walking is allowed onto transit connections and as far as it can be at
+  // the start and end of a multimodal route. The path always starts out
+  // walking whatever the mode from the origin.
+  const auto& pc = mode_costing[static_cast<uint32_t>(TravelMode::kPedestrian)];
+  pc->SetAllowTransitConnections(true);
+  pc->UseMaxMultiModalDistance();
+  const auto& tc = mode_costing[static_cast<uint32_t>(TravelMode::kPublicTransit)];
+  wheelchair_ = tc->wheelchair();
+  bicycle_ = tc->bicycle();
+
+  // For now the date_time must be set on the origin.
+  if (!origin.has_date_time())
+    return { };
+
+  if (!edgestatus_)
+    edgestatus_.reset(new EdgeStatus());
+  ReserveLabels(label_arena_, walklabels_, kInitialWalkLabelCount);
+
+  // Walk from the origin to the first stops, which may set the time of a
+  // "current" origin so do it before parsing it
+  SetDestination(graphreader, destination, pc);
+  SetOrigin(graphreader, origin, destination, pc);
+  const DateTime::time_context_t start(origin.date_time());
+  start_time_ = start.seconds_from_midnight;
+  days_from_pivot_ = start.days_from_pivot;
+  dow_ = start.dow_mask;
+  std::vector<GraphId> marked;
+  Walk(graphreader, origin, destination, pc, tc, false, 1, marked);
+
+  // Each round rides the trips from the stops marked in the round before and
+  // then walks from the stops it got to earlier than before
+  for (uint32_t round = 1; round <= max_rounds_ && !marked.empty(); ++round) {
+    std::vector<GraphId> improved;
+    Ride(graphreader, tc, marked, round, improved);
+    if (improved.empty())
+      break;
+    SetStops(graphreader, improved, pc);
+    Walk(graphreader, origin, destination, pc, tc, true, round + 1, improved);
+    marked = std::move(improved);
+  }
+
+  if (best_label_ == kInvalidLabel) {
+    LOG_ERROR("Transit route failed after labels = " + std::to_string(labels_.size()));
+    return { };
+  }
+  return FormPath(best_label_);
+}
+
+// Set the destination edges and the cost of their remainders
+void RaptorPathAlgorithm::SetDestination(GraphReader& graphreader,
+                     const odin::Location& dest,
+                     const std::shared_ptr<DynamicCost>& costing) {
+  // Only skip outbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(dest.path_edges().begin(), dest.path_edges().end(), [&has_other_edges](const odin::Location::PathEdge& e){
+    has_other_edges = has_other_edges || !e.begin_node();
+  });
+
+  for (const auto& edge : dest.path_edges()) {
+    // If destination is at a node skip any outbound edges
+    if (has_other_edges && edge.begin_node()) {
+      continue;
+    }
+
+    GraphId id(edge.graph_id());
+    const GraphTile* tile = graphreader.GetGraphTile(id);
+    if (tile == nullptr) {
+      continue;
+    }
+    destinations_[edge.graph_id()] = costing->EdgeCost(tile->directededge(id)) *
+                                (1.0f - edge.percent_along());
+  }
+}
+
+// Start a walk from the origin edges
+void RaptorPathAlgorithm::SetOrigin(GraphReader& graphreader,
+                 odin::Location& origin,
+                 const odin::Location& destination,
+                 const std::shared_ptr<DynamicCost>& costing) {
+  // Only skip inbound edges if we have other options
+  bool has_other_edges = false;
+  std::for_each(origin.path_edges().begin(), origin.path_edges().end(), [&has_other_edges](const odin::Location::PathEdge& e){
+    has_other_edges = has_other_edges || !e.end_node();
+  });
+
+  walk_base_ = labels_.size();
+  const NodeInfo* nodeinfo = nullptr;
+  for (const auto& edge : origin.path_edges()) {
+    // If origin is at a node - skip any inbound edge (dist = 1)
+    if (has_other_edges && edge.end_node()) {
+      continue;
+    }
+
+    // Skip edges whose end node tile is missing, they can't be expanded
+    GraphId edgeid(edge.graph_id());
+    const GraphTile* tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    const GraphTile* endtile = graphreader.GetGraphTile(directededge->endnode());
+    if (endtile == nullptr) {
+      continue;
+    }
+    nodeinfo = endtile->node(directededge->endnode());
+
+    // Time to walk the rest of the edge, less the remainder past the
+    // destination if the whole path is along this edge
+    float secs = costing->EdgeCost(directededge).secs * (1.0f - edge.percent_along());
+    auto p = destinations_.find(edgeid);
+    if (p != destinations_.end() && IsTrivial(edgeid, origin, destination)) {
+      secs = std::max(0.0f, secs - p->second.secs);
+    }
+
+    uint32_t d = static_cast<uint32_t>(directededge->length() * (1.0f - edge.percent_along()));
+    EdgeLabel edge_label(kInvalidLabel, edgeid, directededge, Cost(secs, secs),
+                         secs, 0.0f, TravelMode::kPedestrian, d);
+    edge_label.set_origin();
+    walklabels_.push_back(std::move(edge_label));
+    labels_.push_back({kInvalidLabel, edgeid, secs, 0, TravelMode::kPedestrian});
+  }
+
+  // Set the origin timezone
+  if (nodeinfo != nullptr && origin.date_time() == "current") {
+    origin.set_date_time(DateTime::iso_date_time(
+        DateTime::get_tz_db().from_index(nodeinfo->timezone())));
+  }
+}
+
+// Start a walk from each of the stops, at their arrival time
+void RaptorPathAlgorithm::SetStops(GraphReader& graphreader,
+                 const std::vector<GraphId>& stops,
+                 const std::shared_ptr<DynamicCost>& costing) {
+  walk_base_ = labels_.size();
+  const EdgeLabel no_pred;
+  for (const auto& stop : stops) {
+    const GraphTile* tile = graphreader.GetGraphTile(stop);
+    if (tile == nullptr) {
+      continue;
+    }
+    const Arrival& arrival = arrivals_[stop.value];
+    const NodeInfo* nodeinfo = tile->node(stop);
+    GraphId edgeid(stop.tileid(), stop.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid) {
+      if (directededge->is_shortcut() || directededge->IsTransitLine() ||
+          !costing->Allowed(directededge, no_pred, tile, edgeid)) {
+        continue;
+      }
+      float secs = arrival.secs + costing->EdgeCost(directededge).secs;
+      auto p = destinations_.find(edgeid);
+      if (p != destinations_.end()) {
+        secs -= p->second.secs;
+      }
+      walklabels_.emplace_back(kInvalidLabel, edgeid, directededge, Cost(secs, secs),
+                               secs, 0.0f, TravelMode::kPedestrian, directededge->length());
+      labels_.push_back({arrival.label, edgeid, secs, 0, TravelMode::kPedestrian});
+    }
+  }
+}
+
+// Walk from the edges the walk was started with
+void RaptorPathAlgorithm::Walk(GraphReader& graphreader,
+            const odin::Location& origin, const odin::Location& dest,
+            const std::shared_ptr<DynamicCost>& costing,
+            const std::shared_ptr<DynamicCost>& tc, const bool transfer,
+            const uint32_t round, std::vector<GraphId>& marked) {
+  if (walklabels_.empty()) {
+    return;
+  }
+
+  // The walk starts at the earliest of the edges it was started with
+  const auto edgecost = [this](const uint32_t label) {
+    return walklabels_[label].sortcost();
+  };
+  float mincost = std::numeric_limits<float>::max();
+  for (const auto& label : walklabels_) {
+    mincost = std::min(mincost, label.sortcost());
+  }
+  uint32_t bucketsize = costing->UnitSize();
+  adjacencylist_.reset(new DoubleBucketQueue(mincost, kBucketCount * bucketsize,
+                                             bucketsize, edgecost));
+  for (uint32_t i = 0; i < walklabels_.size(); ++i) {
+    adjacencylist_->add(i);
+    edgestatus_->Set(walklabels_[i].edgeid(), EdgeSet::kTemporary, i);
+  }
+
+  // Entering a stop on foot takes a little longer after having ridden
+  float enter_secs = transfer ? tc->TransferCost().secs : tc->DefaultTransferCost().secs;
+  uint32_t max_transfer_distance = costing->GetMaxTransferDistanceMM();
+  const GraphTile* tile;
+  size_t total_labels = 0;
+  while (true) {
+    // Allow this process to be aborted
+    size_t current_labels = labels_.size();
+    if(interrupt && total_labels/kInterruptIterationsInterval < current_labels/kInterruptIterationsInterval)
+      (*interrupt)();
+    total_labels = current_labels;
+
+    // Nothing left to walk to that could arrive before the best so far
+    uint32_t predindex = adjacencylist_->pop();
+    if (predindex == kInvalidLabel) {
+      break;
+    }
+    EdgeLabel pred = walklabels_[predindex];
+    if (pred.cost().secs >= best_secs_) {
+      break;
+    }
+    edgestatus_->Update(pred.edgeid(), EdgeSet::kPermanent);
+
+    // Arrived at the destination. An origin edge only gets there along it
+    // if the destination is ahead of the origin.
+    if (destinations_.find(pred.edgeid()) != destinations_.end() &&
+        (transfer || pred.predecessor() != kInvalidLabel ||
+         IsTrivial(pred.edgeid(), origin, dest))) {
+      best_secs_ = pred.cost().secs;
+      best_label_ = walk_base_ + predindex;
+      continue;
+    }
+
+    // Get the end node. Skip if tile not found (can happen with
+    // regional data sets).
+    GraphId node = pred.endnode();
+    if ((tile = graphreader.GetGraphTile(node)) == nullptr) {
+      continue;
+    }
+    const NodeInfo* nodeinfo = tile->node(node);
+    if (!costing->Allowed(nodeinfo)) {
+      continue;
+    }
+
+    // Arrived at a stop, board from it next round if this is the earliest
+    // way there so far and not too far to walk to transfer
+    if (nodeinfo->type() == NodeType::kMultiUseTransitPlatform) {
+      AddToExcludeList(tc, tile);
+      if (!tc->IsExcluded(tile, nodeinfo) &&
+          (!transfer || pred.path_distance() <= max_transfer_distance)) {
+        // The level 3 transit tiles have the date the schedules start from
+        if (!date_set_) {
+          date_before_tile_ = days_from_pivot_ < tile->header()->date_created();
+          day_ = date_before_tile_ ? 0 : days_from_pivot_ - tile->header()->date_created();
+          date_set_ = true;
+        }
+        float secs = pred.cost().secs + enter_secs;
+        auto arrival = arrivals_.emplace(node.value,
+            Arrival{std::numeric_limits<float>::max(), kInvalidLabel, false, 0}).first;
+        if (secs < arrival->second.secs) {
+          arrival->second.secs = secs;
+          arrival->second.label = walk_base_ + predindex;
+          arrival->second.by_transit = false;
+          Mark(node, round, marked);
+        }
+      }
+    }
+
+    // Expand from end node, on foot only
+    GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid) {
+      if (directededge->is_shortcut() || directededge->IsTransitLine()) {
+        continue;
+      }
+      EdgeStatusInfo es = edgestatus_->Get(edgeid);
+      if (es.set() == EdgeSet::kPermanent) {
+        continue;
+      }
+
+      // Transition edges take the predecessor's cost
+      if (directededge->IsTransition()) {
+        walklabels_.emplace_back(predindex, edgeid, directededge->endnode(), pred);
+        labels_.push_back({walk_base_ + predindex, edgeid, pred.cost().secs, 0,
+                           TravelMode::kPedestrian});
+        adjacencylist_->add(walklabels_.size() - 1);
+        edgestatus_->Set(edgeid, EdgeSet::kTemporary, walklabels_.size() - 1);
+        continue;
+      }
+
+      // Skip if access is not allowed or the walk is too far. Going from
+      // one transit connection directly to another at a stop is like
+      // entering a station and leaving without getting on transit.
+      if (!costing->Allowed(directededge, pred, tile, edgeid) ||
+          (nodeinfo->type() == NodeType::kTransitEgress &&
+           pred.use() == Use::kTransitConnection &&
+           directededge->use() == Use::kTransitConnection)) {
+        continue;
+      }
+
+      // Time at the end of the edge, or at the destination along it
+      Cost c = costing->EdgeCost(directededge) +
+               costing->TransitionCost(directededge, nodeinfo, pred);
+      float secs = pred.cost().secs + c.secs;
+      auto p = destinations_.find(edgeid);
+      if (p != destinations_.end()) {
+        secs -= p->second.secs;
+      }
+      uint32_t walking_distance = pred.path_distance() + directededge->length();
+
+      // Check if edge is temporarily labeled and this path is quicker
+      if (es.set() == EdgeSet::kTemporary) {
+        EdgeLabel& lab = walklabels_[es.index()];
+        if (secs < lab.cost().secs) {
+          adjacencylist_->decrease(es.index(), secs);
+          lab.Update(predindex, Cost(secs, secs), secs, walking_distance);
+          Label& label = labels_[walk_base_ + es.index()];
+          label.predecessor = walk_base_ + predindex;
+          label.secs = secs;
+        }
+        continue;
+      }
+
+      walklabels_.emplace_back(predindex, edgeid, directededge, Cost(secs, secs),
+                               secs, 0.0f, TravelMode::kPedestrian, walking_distance);
+      labels_.push_back({walk_base_ + predindex, edgeid, secs, 0, TravelMode::kPedestrian});
+      adjacencylist_->add(walklabels_.size() - 1);
+      edgestatus_->Set(edgeid, EdgeSet::kTemporary, walklabels_.size() - 1);
+    }
+  }
+
+  // Done with this walk, the labels of its paths stay in labels_
+  AddSearchStats(stats_, 0, adjacencylist_.get());
+  walklabels_.clear();
+  adjacencylist_.reset();
+  edgestatus_->Init();
+}
+
+// Ride every trip that can be boarded from the marked stops
+void RaptorPathAlgorithm::Ride(GraphReader& graphreader,
+            const std::shared_ptr<DynamicCost>& tc,
+            const std::vector<GraphId>& marked, const uint32_t round,
+            std::vector<GraphId>& improved) {
+  // Trips along edges ridden this round. Once a trip has been ridden along
+  // an edge the rest of it has been too and boarding it later on can only
+  // get to the same stops at the same times.
+  std::set<std::pair<uint32_t, uint64_t> > ridden;
+  const EdgeLabel no_pred;
+  for (const auto& stop : marked) {
+    const GraphTile* tile = graphreader.GetGraphTile(stop);
+    if (tile == nullptr) {
+      continue;
+    }
+    const Arrival arrival = arrivals_[stop.value];
+
+    // Changing trips at a stop takes a little time, walking there already
+    // includes the time to enter it
+    uint32_t board_time = start_time_ + static_cast<uint32_t>(std::ceil(arrival.secs)) +
+                          (arrival.by_transit ? kInStationTransferSeconds : 0);
+
+    // Board the next departure along each transit line from the stop
+    const NodeInfo* nodeinfo = tile->node(stop);
+    GraphId edgeid(stop.tileid(), stop.level(), nodeinfo->edge_index());
+    const DirectedEdge* directededge = tile->directededge(nodeinfo->edge_index());
+    for (uint32_t i = 0; i < nodeinfo->edge_count(); i++, directededge++, ++edgeid) {
+      if (!directededge->IsTransitLine() ||
+          !tc->Allowed(directededge, no_pred, tile, edgeid) ||
+          tc->IsExcluded(tile, directededge)) {
+        continue;
+      }
+      const TransitDeparture* next = tile->GetNextDeparture(directededge->lineid(),
+          board_time, day_, dow_, date_before_tile_, wheelchair_, bicycle_);
+      if (next == nullptr) {
+        continue;
+      }
+      TransitDeparture departure = TakeDeparture(next);
+      uint32_t tripid = departure.tripid();
+
+      // Follow the trip from stop to stop
+      uint32_t predecessor = arrival.label;
+      GraphId ride_edgeid = edgeid;
+      const DirectedEdge* ride_edge = directededge;
+      while (ridden.emplace(tripid, ride_edgeid.value).second) {
+        // Nothing further along can arrive before the best so far
+        uint32_t arrival_time = departure.departure_time() + departure.elapsed_time();
+        float secs = static_cast<float>(arrival_time - start_time_);
+        if (arrival_time < start_time_ || secs >= best_secs_) {
+          break;
+        }
+        labels_.push_back({predecessor, ride_edgeid, secs, tripid, TravelMode::kPublicTransit});
+        predecessor = labels_.size() - 1;
+
+        // Get off here if it is the earliest way to the stop so far
+        GraphId node = ride_edge->endnode();
+        const GraphTile* endtile = graphreader.GetGraphTile(node);
+        if (endtile == nullptr) {
+          break;
+        }
+        const NodeInfo* endnode = endtile->node(node);
+        AddToExcludeList(tc, endtile);
+        if (!tc->IsExcluded(endtile, endnode)) {
+          auto stop_arrival = arrivals_.emplace(node.value,
+              Arrival{std::numeric_limits<float>::max(), kInvalidLabel, false, 0}).first;
+          if (secs < stop_arrival->second.secs) {
+            stop_arrival->second.secs = secs;
+            stop_arrival->second.label = predecessor;
+            stop_arrival->second.by_transit = true;
+            Mark(node, round + 1, improved);
+          }
+        }
+
+        // Stay on for the next transit line the trip departs along
+        bool stays_on = false;
+        GraphId next_edgeid(node.tileid(), node.level(), endnode->edge_index());
+        const DirectedEdge* next_edge = endtile->directededge(endnode->edge_index());
+        for (uint32_t j = 0; j < endnode->edge_count(); j++, next_edge++, ++next_edgeid) {
+          if (!next_edge->IsTransitLine()) {
+            continue;
+          }
+          const TransitDeparture* onward = endtile->GetTransitDeparture(
+              next_edge->lineid(), tripid, arrival_time);
+          if (onward == nullptr) {
+            continue;
+          }
+          TransitDeparture onward_departure = TakeDeparture(onward);
+          if (onward_departure.departure_time() >= arrival_time) {
+            departure = onward_departure;
+            ride_edgeid = next_edgeid;
+            ride_edge = next_edge;
+            stays_on = true;
+            break;
+          }
+        }
+        if (!stays_on) {
+          break;
+        }
+      }
+    }
+  }
+}
+
+// Add the stops and lines a tile excludes to the transit costing, once
+void RaptorPathAlgorithm::AddToExcludeList(const std::shared_ptr<DynamicCost>& tc,
+                                           const GraphTile* tile) {
+  if (processed_tiles_.emplace(tile->id().tileid()).second) {
+    tc->AddToExcludeList(tile);
+  }
+}
+
+// Mark a stop to board from in a round, once
+void RaptorPathAlgorithm::Mark(const GraphId& stop, const uint32_t round,
+                               std::vector<GraphId>& marked) {
+  auto& arrival = arrivals_[stop.value];
+  if (arrival.marked != round) {
+    arrival.marked = round;
+    marked.push_back(stop);
+  }
+}
+
+// Form the path from the labels
+std::vector<PathInfo> RaptorPathAlgorithm::FormPath(const uint32_t dest) {
+  // Metrics to track
+  LOG_DEBUG("path_secs::" + std::to_string(labels_[dest].secs));
+  LOG_DEBUG("path_iterations::" + std::to_string(labels_.size()));
+
+  // Work backwards from the destination
+  std::vector<PathInfo> path;
+  for (auto label_index = dest; label_index != kInvalidLabel;
+       label_index = labels_[label_index].predecessor) {
+    const Label& label = labels_[label_index];
+    path.emplace_back(label.mode, label.secs, label.edgeid, label.tripid);
+  }
+
+  // Reverse the list and return
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+}
+}
@@ -1,7 +1,12 @@
 #include "thor/worker.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <exception>
+#include <thread>
 
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "midgard/constants.h"
 #include "baldr/json.h"
 #include "sif/autocost.h"
@@ -16,59 +21,156 @@ using namespace valhalla::baldr;
 using namespace valhalla::sif;
 using namespace valhalla::thor;
 
+namespace {
+
+// Most alternate paths a route request can ask for
+constexpr uint32_t kMaxAlternates = 3;
+
+// Swap the shortcut edges of a path for the base edges they were formed from,
+// spreading the time along each shortcut over its base edges by length. The
+// tiles keep the base edges of their shortcuts so this is a copy of them per
+// shortcut, shortcuts in tiles that don't keep them stay on the path
+void recover_shortcuts(GraphReader& reader, std::vector<PathInfo>& path) {
+  std::vector<PathInfo> recovered;
+  recovered.reserve(path.size());
+  float elapsed_time = 0.0f;
+  for (const auto& info : path) {
+    auto base_edges = reader.RecoverShortcut(info.edgeid);
+    if (base_edges.empty()) {
+      recovered.push_back(info);
+      elapsed_time = info.elapsed_time;
+      continue;
+    }
+    const GraphTile* tile = reader.GetGraphTile(info.edgeid);
+    float length = tile->directededge(info.edgeid)->length();
+    float traversed = 0.0f;
+    for (size_t i = 0; i < base_edges.size(); ++i) {
+      const DirectedEdge* edge = reader.directededge(base_edges[i], tile);
+      traversed += edge ? edge->length() : 0.0f;
+      float time = (i + 1 == base_edges.size() || length <= 0.0f) ? info.elapsed_time :
+          elapsed_time + (info.elapsed_time - elapsed_time) * std::min(traversed / length, 1.0f);
+      recovered.emplace_back(info.mode, time, base_edges[i], info.trip_id);
+    }
+    elapsed_time = info.elapsed_time;
+  }
+  path.swap(recovered);
+}
+
+}
+
 namespace valhalla {
   namespace thor {
 
-  std::list<valhalla::odin::TripPath> thor_worker_t::route(valhalla_request_t& request){
+  std::list<valhalla::odin::TripPath> thor_worker_t::route(valhalla_request_t& request,
+      std::list<valhalla::odin::TripPath>* alternates){
+    track_stats(request);
     parse_locations(request);
     auto costing = parse_costing(request);
 
+    // Alternates come from the trees of a single search between two locations
+    uint32_t alternate_count = (alternates && request.options.locations_size() == 2) ?
+        std::min(request.options.alternates(), kMaxAlternates) : 0;
+
+    // A summary needs nothing of the edges but their length, time and where
+    // they are for gpx, so that is all its paths get and they get it in columns
+    AttributesController controller;
+    if (alternates) {
+      controller.disable_all();
+      for (const auto& attribute : {kEdgeLength, kEdgeWayId, kEdgeBeginShapeIndex, kNodeElapsedTime,
+                                    kNodeaAdminIndex, kAdminCountryCode, kAdminStateCode, kShape})
+        controller.attributes.at(attribute) = true;
+      controller.columnar = true;
+    }
+
     auto trippaths = (request.options.has_date_time_type() &&
         request.options.date_time_type() == odin::DirectionsOptions::arrive_by) ?
-        path_arrive_by(*request.options.mutable_locations(), costing) :
-        path_depart_at(*request.options.mutable_locations(), costing);
+        path_arrive_by(*request.options.mutable_locations(), costing, controller) :
+        path_depart_at(*request.options.mutable_locations(), costing, controller,
+                       alternates, alternate_count);
 
     if(!request.options.do_not_track())
       for(const auto& tp : trippaths)
         log_admin(tp);
 
+    finish_stats();
     return trippaths;
   }
 
-  thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routetype,
-        const odin::Location& origin, const odin::Location& destination) {
+  thor_worker_t::leg_router_t thor_worker_t::get_leg_router(const AttributesController& controller) {
+    return leg_router_t{reader, mode_costing, astar, bidir_astar, ch_path, interrupt, true, controller};
+  }
+
+  thor::PathAlgorithm* thor_worker_t::get_path_algorithm(leg_router_t& router,
+        const std::string& routetype, const odin::Location& origin,
+        const odin::Location& destination) {
     if (routetype == "multimodal" || routetype == "transit") {
+      if (raptor_transit) {
+        raptor.set_interrupt(interrupt);
+        return &raptor;
+      }
       multi_modal_astar.set_interrupt(interrupt);
       return &multi_modal_astar;
     }
 
     // Use A* if any origin and destination edges are the same - otherwise
-    // use bidirectional A*. Bidirectional A* does not handle trivial cases
+    // use the contraction hierarchy if there is one for the costing or
+    // bidirectional A*. Bidirectional A* does not handle trivial cases
     // with oneways.
     for (auto& edge1 : origin.path_edges()) {
       for (auto& edge2 : destination.path_edges()) {
         if (edge1.graph_id() == edge2.graph_id()) {
-          astar.set_interrupt(interrupt);
-          return &astar;
+          router.astar.set_interrupt(router.interrupt);
+          return &router.astar;
         }
       }
     }
-    bidir_astar.set_interrupt(interrupt);
-    return &bidir_astar;
+    // Departing at a time needs the search to know when it gets to each edge
+    // to use historical speeds, which only A* does
+    if (origin.has_date_time() && origin.path_edges_size() > 0) {
+      const baldr::GraphTile* tile = router.reader.GetGraphTile(baldr::GraphId(origin.path_edges(0).graph_id()));
+      if (tile != nullptr && tile->has_speed_profiles()) {
+        router.astar.set_interrupt(router.interrupt);
+        return &router.astar;
+      }
+    }
+    if (router.ch_path.graph()) {
+      router.ch_path.set_interrupt(router.interrupt);
+      return &router.ch_path;
+    }
+    router.bidir_astar.set_interrupt(router.interrupt);
+    return &router.bidir_astar;
   }
 
-  std::vector<thor::PathInfo> thor_worker_t::get_path(PathAlgorithm* path_algorithm, odin::Location& origin,
-      odin::Location& destination, const std::string& costing) {
+  std::vector<thor::PathInfo> thor_worker_t::get_path(leg_router_t& router, PathAlgorithm* path_algorithm,
+      odin::Location& origin, odin::Location& destination, const std::string& costing,
+      std::vector<std::vector<thor::PathInfo>>* alternates, const uint32_t alternate_count) {
+    METRICS_TIME(kThorPath);
+    auto start = std::chrono::steady_clock::now();
     // Find the path. If bidirectional A* disable use of destination only
     // edges on the first pass. If there is a failure, we allow them on the
     // second pass.
-    valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
-    if (path_algorithm == &bidir_astar) {
+    valhalla::sif::cost_ptr_t cost = router.mode_costing[static_cast<uint32_t>(mode)];
+    if (path_algorithm == &router.ch_path) {
+      // Fall back to bidirectional A* if the overlay can't route this
+      auto path = router.ch_path.GetBestPath(origin, destination, router.reader, router.mode_costing, mode);
+      if (!path.empty() && !(costing == "pedestrian" && router.ch_path.has_ferry())) {
+        recover_shortcuts(router.reader, path);
+        if (router.timed)
+          add_search_time(start);
+        return path;
+      }
+      router.ch_path.Clear();
+      router.bidir_astar.set_interrupt(router.interrupt);
+      router.bidir_astar.Clear();
+      path_algorithm = &router.bidir_astar;
+    }
+    if (path_algorithm == &router.bidir_astar) {
       cost->set_allow_destination_only(false);
+      router.bidir_astar.set_alternates(alternates ? alternate_count : 0);
     }
     cost->set_pass(0);
-    auto path = path_algorithm->GetBestPath(origin, destination, reader,
-                                             mode_costing, mode);
+    auto path = path_algorithm->GetBestPath(origin, destination, router.reader,
+                                             router.mode_costing, mode);
 
     // If path is not found try again with relaxed limits (if allowed)
     if (path.empty() ||
@@ -82,34 +184,46 @@ namespace valhalla {
 
         path_algorithm->Clear();
         cost->set_pass(1);
-        bool using_astar = (path_algorithm == &astar);
+        bool using_astar = (path_algorithm == &router.astar);
         float relax_factor = using_astar ? 16.0f : 8.0f;
         float expansion_within_factor = using_astar ? 4.0f : 2.0f;
         cost->RelaxHierarchyLimits(relax_factor, expansion_within_factor);
         cost->set_allow_destination_only(true);
         path = path_algorithm->GetBestPath(origin, destination,
-                                  reader, mode_costing, mode);
+                                  router.reader, router.mode_costing, mode);
       }
     }
 
+    // Only bidirectional A* keeps both trees to find alternates in
+    if (alternates && !path.empty() && path_algorithm == &router.bidir_astar) {
+      *alternates = router.bidir_astar.GetAlternatePaths(router.reader, path);
+      for (auto& alternate : *alternates)
+        recover_shortcuts(router.reader, alternate);
+    }
+    recover_shortcuts(router.reader, path);
+
     // All or nothing
+    if (router.timed)
+      add_search_time(start);
     if(path.empty())
       throw valhalla_exception_t{442};
     return path;
   }
 
-  std::list<valhalla::odin::TripPath> thor_worker_t::path_arrive_by(google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing) {
+  std::list<valhalla::odin::TripPath> thor_worker_t::path_arrive_by(google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing,
+      const AttributesController& controller) {
     // Things we'll need
     std::vector<thor::PathInfo> path;
     std::list<valhalla::odin::TripPath> trip_paths;
     correlated.begin()->set_type(odin::Location::kBreak);
     correlated.rbegin()->set_type(odin::Location::kBreak);
+    auto router = get_leg_router(controller);
 
     // For each pair of locations
     for(auto origin = ++correlated.rbegin(); origin != correlated.rend(); ++origin) {
       // Get the algorithm type for this location pair
       auto destination = std::prev(origin);
-      thor::PathAlgorithm* path_algorithm = get_path_algorithm(costing, *origin, *destination);
+      thor::PathAlgorithm* path_algorithm = get_path_algorithm(router, costing, *origin, *destination);
       path_algorithm->Clear();
 
       // If we are continuing through a location we need to make sure we
@@ -121,7 +235,7 @@ namespace valhalla {
       }
 
       // Get best path and keep it
-      auto temp_path = get_path(path_algorithm, *origin, *destination, costing);
+      auto temp_path = get_path(router, path_algorithm, *origin, *destination, costing);
       temp_path.swap(path);
 
       // Merge through legs by updating the time and splicing the lists
@@ -142,16 +256,15 @@ namespace valhalla {
           --destination;
         }
 
-        // Create controller for default route attributes
-        AttributesController controller;
-
         // Form output information based on path edges
-        auto trip_path = thor::TripPathBuilder::Build(controller, reader, mode_costing, path,
-                                                      *origin, *destination, throughs, interrupt);
+        auto trip_path = thor::TripPathBuilder::Build(router.controller, router.reader, router.mode_costing, path,
+                                                      *origin, *destination, throughs, router.interrupt);
         path.clear();
 
-        // Keep the protobuf path
-        trip_paths.emplace_back(std::move(trip_path));
+        // Keep the protobuf path, swapping it in because older protobufs
+        // have no move constructor and would copy every node and edge
+        trip_paths.emplace_back();
+        trip_paths.back().Swap(&trip_path);
       }
     }
 
@@ -159,18 +272,103 @@ namespace valhalla {
     return trip_paths;
   }
 
-  std::list<valhalla::odin::TripPath> thor_worker_t::path_depart_at(google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing) {
+  std::list<valhalla::odin::TripPath> thor_worker_t::path_depart_at(google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing,
+      const AttributesController& controller, std::list<valhalla::odin::TripPath>* alternates, const uint32_t alternate_count) {
+    correlated.begin()->set_type(odin::Location::kBreak);
+    correlated.rbegin()->set_type(odin::Location::kBreak);
+    auto router = get_leg_router(controller);
+
+    // The legs between two breaks make one trip path and share nothing with
+    // the legs between other breaks, unless building a trip path sets the
+    // time the next one departs at or the costing is multimodal
+    std::vector<int> breaks;
+    for (int i = 0; i < correlated.size(); ++i) {
+      if (correlated.Get(i).type() == odin::Location::kBreak)
+        breaks.push_back(i);
+    }
+    size_t extra_threads = breaks.size() > 2 ? std::min(matrix_readers.size(), breaks.size() - 2) : 0;
+    if (alternate_count || correlated.begin()->has_date_time() ||
+        costing == "multimodal" || costing == "transit")
+      extra_threads = 0;
+
+    // The extra threads need copies of the costings for the passes to relax
+    for (size_t i = 0; i < extra_threads; ++i) {
+      if (leg_threads.size() == i)
+        leg_threads.emplace_back(new leg_thread_t(label_arena_size));
+      auto& leg_thread = *leg_threads[i];
+      for (size_t m = 0; m < static_cast<size_t>(sif::TravelMode::kMaxTravelMode); ++m) {
+        leg_thread.mode_costing[m] = mode_costing[m] ? mode_costing[m]->Clone() : nullptr;
+        if (mode_costing[m] && !leg_thread.mode_costing[m])
+          extra_threads = 0;
+      }
+      leg_thread.ch_path.set_graph(ch_path.graph());
+      leg_thread.astar.set_landmarks(astar.landmarks());
+      leg_thread.bidir_astar.set_landmarks(astar.landmarks());
+    }
+    if (extra_threads == 0)
+      return depart_at_legs(router, correlated, costing, alternates, alternate_count);
+
+    // Each segment routes a copy of its locations, the breaks at its ends
+    // are shared with the segments next to it
+    size_t segment_count = breaks.size() - 1;
+    std::vector<google::protobuf::RepeatedPtrField<valhalla::odin::Location> > segments(segment_count);
+    for (size_t i = 0; i < segment_count; ++i) {
+      for (int l = breaks[i]; l <= breaks[i + 1]; ++l)
+        segments[i].Add()->CopyFrom(correlated.Get(l));
+    }
+
+    // The threads take the next segment left so the longest one decides how
+    // long it takes rather than all of them. Only the worker's own thread
+    // can be interrupted and is timed, over all of the segments.
+    std::vector<std::list<valhalla::odin::TripPath> > segment_paths(segment_count);
+    std::vector<std::exception_ptr> errors(segment_count);
+    std::atomic<size_t> next_segment(0);
+    auto route_segments = [this, &segments, &segment_paths, &errors, &next_segment, &costing]
+        (leg_router_t router) {
+      for (size_t i = next_segment++; i < segments.size(); i = next_segment++) {
+        try {
+          segment_paths[i] = depart_at_legs(router, segments[i], costing);
+        }
+        catch (...) {
+          errors[i] = std::current_exception();
+        }
+      }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < extra_threads; ++i) {
+      auto& leg_thread = *leg_threads[i];
+      threads.emplace_back(route_segments, leg_router_t{*matrix_readers[i], leg_thread.mode_costing,
+          leg_thread.astar, leg_thread.bidir_astar, leg_thread.ch_path, nullptr, false, controller});
+    }
+    router.timed = false;
+    route_segments(router);
+    for (auto& thread : threads)
+      thread.join();
+    add_search_time(start);
+
+    // Fail as routing them in order would have, at the first segment to fail
+    std::list<valhalla::odin::TripPath> trip_paths;
+    for (size_t i = 0; i < segment_count; ++i) {
+      if (errors[i])
+        std::rethrow_exception(errors[i]);
+      trip_paths.splice(trip_paths.end(), segment_paths[i]);
+    }
+    return trip_paths;
+  }
+
+  std::list<valhalla::odin::TripPath> thor_worker_t::depart_at_legs(leg_router_t& router,
+      google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing,
+      std::list<valhalla::odin::TripPath>* alternates, const uint32_t alternate_count) {
     // Things we'll need
     std::vector<thor::PathInfo> path;
     std::list<valhalla::odin::TripPath> trip_paths;
-    correlated.begin()->set_type(odin::Location::kBreak);
-    correlated.rbegin()->set_type(odin::Location::kBreak);
 
     // For each pair of locations
     for(auto destination = ++correlated.begin(); destination != correlated.end(); ++destination) {
       // Get the algorithm type for this location pair
       auto origin = std::prev(destination);
-      thor::PathAlgorithm* path_algorithm = get_path_algorithm(costing, *origin, *destination);
+      thor::PathAlgorithm* path_algorithm = get_path_algorithm(router, costing, *origin, *destination);
       path_algorithm->Clear();
 
       // If we are continuing through a location we need to make sure we
@@ -182,7 +380,20 @@ namespace valhalla {
       }
 
       // Get best path and keep it
-      auto temp_path = get_path(path_algorithm, *origin, *destination, costing);
+      std::vector<std::vector<thor::PathInfo>> alternate_paths;
+      auto temp_path = get_path(router, path_algorithm, *origin, *destination, costing,
+                                alternate_count ? &alternate_paths : nullptr, alternate_count);
+
+      // Alternates are only asked for between two locations so they are
+      // whole trips. Building sets the times at the locations so use copies.
+      for (const auto& alternate_path : alternate_paths) {
+        odin::Location alternate_origin = *origin;
+        odin::Location alternate_destination = *destination;
+        auto trip_path = thor::TripPathBuilder::Build(router.controller, router.reader, router.mode_costing,
+            alternate_path, alternate_origin, alternate_destination, {}, router.interrupt);
+        alternates->emplace_back();
+        alternates->back().Swap(&trip_path);
+      }
 
       // Merge through legs by updating the time and splicing the lists
       if(!path.empty()) {
@@ -204,16 +415,15 @@ namespace valhalla {
           --origin;
         }
 
-        // Create controller for default route attributes
-        AttributesController controller;
-
         // Form output information based on path edges
-        auto trip_path = thor::TripPathBuilder::Build(controller, reader, mode_costing, path,
-                                                      *origin, *destination, throughs, interrupt);
+        auto trip_path = thor::TripPathBuilder::Build(router.controller, router.reader, router.mode_costing, path,
+                                                      *origin, *destination, throughs, router.interrupt);
         path.clear();
 
-        // Keep the protobuf path
-        trip_paths.emplace_back(std::move(trip_path));
+        // Keep the protobuf path, swapping it in because older protobufs
+        // have no move constructor and would copy every node and edge
+        trip_paths.emplace_back();
+        trip_paths.back().Swap(&trip_path);
       }
     }
 
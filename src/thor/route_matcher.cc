@@ -1,5 +1,6 @@
 #include <vector>
 #include <algorithm>
+#include <iterator>
 #include <exception>
 #include "midgard/logging.h"
 #include "midgard/util.h"
@@ -88,6 +89,46 @@ end_node_t GetEndEdges(GraphReader& reader,
 }
 
 
+// Check whether the shape after the correlated index follows the shape of
+// an edge point for point, as the shape of a route made by Valhalla does.
+// Stops decoding the edge shape at the first point that differs so an edge
+// the shape does not follow costs a point or two. Returns the index of the
+// shape point at the end node of the edge or 0 if it does not follow it.
+size_t follow_edge_shape(const GraphTile* tile, const DirectedEdge* de,
+                         const std::vector<meili::Measurement>& shape,
+                         const size_t correlated_index) {
+  auto edgeinfo = tile->edgeinfo(de->edgeinfo_offset());
+  size_t index = correlated_index;
+  auto follows = [&shape, &index](const PointLL& ll) {
+    if (index + 1 >= shape.size() || !shape[index + 1].lnglat().ApproximatelyEqual(ll))
+      return false;
+    ++index;
+    return true;
+  };
+
+  // The first point of the edge is the node at the correlated index
+  if (de->forward()) {
+    auto decoder = edgeinfo.lazy_shape();
+    if (decoder.empty())
+      return 0;
+    decoder.pop();
+    while (!decoder.empty()) {
+      if (!follows(decoder.pop()))
+        return 0;
+    }
+  } else {
+    // Reversed edges have to be decoded to start from their end
+    const auto& edge_shape = edgeinfo.shape();
+    if (edge_shape.empty())
+      return 0;
+    for (auto ll = std::next(edge_shape.crbegin()); ll != edge_shape.crend(); ++ll) {
+      if (!follows(*ll))
+        return 0;
+    }
+  }
+  return index > correlated_index ? index : 0;
+}
+
 bool expand_from_node(const std::shared_ptr<DynamicCost>* mode_costing,
                       const TravelMode& mode, GraphReader& reader,
                       const std::vector<meili::Measurement>& shape,
@@ -117,8 +158,56 @@ bool expand_from_node(const std::shared_ptr<DynamicCost>* mode_costing,
   }
 
   const NodeInfo* node_info = tile->node(node);
+
+  // Most of the time the shape is that of a prior route and follows one of
+  // the edges point for point, try that before walking the shape along
+  // every edge. Transitions have no shape and are left to the walk.
+  GraphId followed_edge_id;
+  size_t followed_index = 0;
   GraphId edge_id(node.tileid(), node.level(), node_info->edge_index());
   const DirectedEdge* de = tile->directededge(node_info->edge_index());
+  for (uint32_t i = 0; i < node_info->edge_count(); i++, de++, ++edge_id) {
+    uint32_t n = path_infos.size();
+    if (de->is_shortcut() || de->use() == Use::kTransitConnection || de->IsTransition() ||
+        (n > 1 && (edge_id == path_infos[n-2].edgeid || edge_id == path_infos[n-1].edgeid))) {
+      continue;
+    }
+    size_t index = follow_edge_shape(tile, de, shape, correlated_index);
+    if (index == 0) {
+      continue;
+    }
+    const GraphTile* end_node_tile = reader.GetGraphTile(de->endnode());
+    if (end_node_tile == nullptr) {
+      continue;
+    }
+
+    // Same as a match found by walking the shape below
+    float prev_elapsed_time = elapsed_time;
+    EdgeLabel prev_label = prev_edge_label;
+    elapsed_time += mode_costing[static_cast<int>(mode)]->TransitionCost(
+        de, node_info, prev_edge_label).secs;
+    elapsed_time += mode_costing[static_cast<int>(mode)]->EdgeCost(de).secs;
+    path_infos.emplace_back(mode, elapsed_time, edge_id, 0);
+    prev_edge_label = {kInvalidLabel, edge_id, de, {}, 0, 0, mode, 0};
+    if (expand_from_node(mode_costing, mode, reader, shape, distances,
+                         index, end_node_tile, de->endnode(),
+                         end_nodes, prev_edge_label, elapsed_time,
+                         path_infos, false, end_node, total_distance)) {
+      return true;
+    }
+
+    // Undo it and fall back to walking the shape, which need not try this
+    // edge from the same point again
+    path_infos.pop_back();
+    elapsed_time = prev_elapsed_time;
+    prev_edge_label = prev_label;
+    followed_edge_id = edge_id;
+    followed_index = index;
+    break;
+  }
+
+  edge_id = GraphId(node.tileid(), node.level(), node_info->edge_index());
+  de = tile->directededge(node_info->edge_index());
   for (uint32_t i = 0; i < node_info->edge_count(); i++, de++, ++edge_id) {
     // Skip shortcuts and transit connection edges
     // TODO - later might allow transit connections for multi-modal
@@ -176,6 +265,11 @@ bool expand_from_node(const std::shared_ptr<DynamicCost>* mode_costing,
 
       // Found a match if shape equals directed edge LL within tolerance
       if (shape.at(index).lnglat().ApproximatelyEqual(de_end_ll) && de->length() < length_comparison(length, true)) {
+        // Already failed following the edge shape to here
+        if (edge_id == followed_edge_id && index == followed_index) {
+          break;
+        }
+
         // Update the elapsed time based on transition cost
         elapsed_time += mode_costing[static_cast<int>(mode)]->TransitionCost(
             de, node_info, prev_edge_label).secs;
@@ -1,6 +1,8 @@
 #include <vector>
 #include <algorithm>
 #include "thor/timedistancematrix.h"
+#include "baldr/datetime.h"
+#include "baldr/speed_profile.h"
 #include "midgard/logging.h"
 
 using namespace valhalla::baldr;
@@ -27,10 +29,26 @@ namespace valhalla {
 namespace thor {
 
 // Constructor with cost threshold.
-TimeDistanceMatrix::TimeDistanceMatrix()
+TimeDistanceMatrix::TimeDistanceMatrix(LabelArena* label_arena)
     : mode_(TravelMode::kDrive),
       settled_count_(0),
-      current_cost_threshold_(0) {}
+      current_cost_threshold_(0),
+      label_arena_(label_arena),
+      interrupt_(nullptr),
+      use_hierarchy_limits_(false),
+      time_dependent_(false),
+      origin_second_of_week_(0),
+      departure_offset_(0),
+      historical_speeds_used_(false) {
+  ReserveLabels(label_arena_, edgelabels_, 0);
+  edgestatus_.reset(new EdgeStatus());
+  ReserveEdgeStatus(label_arena_, *edgestatus_);
+}
+
+TimeDistanceMatrix::~TimeDistanceMatrix() {
+  ReleaseLabels(label_arena_, edgelabels_);
+  ReleaseEdgeStatus(label_arena_, *edgestatus_);
+}
 
 float TimeDistanceMatrix::GetCostThreshold(const float max_matrix_distance) const {
   float cost_threshold;
@@ -49,6 +67,46 @@ float TimeDistanceMatrix::GetCostThreshold(const float max_matrix_distance) cons
   return cost_threshold;
 }
 
+// Initialize the search state shared by one to many and many to one
+void TimeDistanceMatrix::Initialize(
+          const google::protobuf::RepeatedPtrField<odin::Location>& locations,
+          const float max_matrix_distance) {
+  current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
+  settled_count_ = 0;
+  hierarchy_limits_ = costing_->GetHierarchyLimits();
+  dest_edge_filter_.assign((1 << kDestEdgeFilterBits) / 64, 0);
+  dest_lls_.clear();
+  for (const auto& location : locations)
+    dest_lls_.emplace_back(location.ll().lng(), location.ll().lat());
+}
+
+// Mark an edge as having a destination on it
+void TimeDistanceMatrix::AddDestinationEdge(const uint64_t edgeid, const uint32_t idx) {
+  uint32_t bit = FilterBit(edgeid);
+  dest_edge_filter_[bit >> 6] |= 1ull << (bit & 63);
+  dest_edges_[edgeid].push_back(idx);
+}
+
+// Stop expanding from a node once its level has run out of upward
+// transitions, unless it is near a destination that is not settled yet
+bool TimeDistanceMatrix::StopExpanding(GraphReader& graphreader,
+                                       const GraphId& node) const {
+  if (!use_hierarchy_limits_ || node.level() >= hierarchy_limits_.size())
+    return false;
+  const HierarchyLimits& limits = hierarchy_limits_[node.level()];
+  if (!limits.StopExpanding())
+    return false;
+  const GraphTile* tile = graphreader.GetGraphTile(node);
+  if (tile == nullptr)
+    return true;
+  const auto& ll = tile->node(node)->latlng();
+  for (uint32_t i = 0; i < destinations_.size(); ++i) {
+    if (!destinations_[i].settled && !limits.StopExpanding(ll.Distance(dest_lls_[i])))
+      return false;
+  }
+  return true;
+}
+
 // Clear the temporary information generated during time + distance matrix
 // construction.
 void TimeDistanceMatrix::Clear() {
@@ -56,12 +114,14 @@ void TimeDistanceMatrix::Clear() {
   edgelabels_.clear();
   destinations_.clear();
   dest_edges_.clear();
+  std::fill(dest_edge_filter_.begin(), dest_edge_filter_.end(), 0);
+  dest_lls_.clear();
 
   // Clear elements from the adjacency list
   adjacencylist_.reset();
 
-  // Clear the edge status flags
-  edgestatus_.reset();
+  // Clear the edge status flags, keeping the touched tiles allocated
+  edgestatus_->Init();
 }
 
 // Expand from a node in the forward direction
@@ -91,8 +151,14 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
     // Handle transition edges - expand from the end node of the transition
     // (unless this is called from a transition).
     if (directededge->IsTransition()) {
+      // Count the upward transitions and do not go down onto a level that
+      // is no longer expanded
       if (!from_transition) {
-        ExpandForward(graphreader, directededge->endnode(), pred, pred_idx, true);
+        if (use_hierarchy_limits_ && directededge->trans_up() &&
+            node.level() < hierarchy_limits_.size())
+          hierarchy_limits_[node.level()].up_transition_count++;
+        if (!directededge->trans_down() || !StopExpanding(graphreader, directededge->endnode()))
+          ExpandForward(graphreader, directededge->endnode(), pred, pred_idx, true);
       }
       continue;
     }
@@ -112,9 +178,18 @@ void TimeDistanceMatrix::ExpandForward(GraphReader& graphreader,
       continue;
     }
 
-    // Get cost and update distance
-    Cost newcost = pred.cost() +
-                   costing_->EdgeCost(directededge) +
+    // Get cost and update distance. Departing at a time the historical
+    // speed at the time the search gets to the node is used if there is one
+    Cost edgecost = costing_->EdgeCost(directededge);
+    if (time_dependent_ && tile->has_speed_profiles()) {
+      uint8_t speed = tile->historical_speed(edgeid.id(),
+          origin_second_of_week_ + static_cast<uint32_t>(pred.cost().secs));
+      if (speed != 0) {
+        edgecost = costing_->TrafficCost(directededge, edgecost, speed);
+        historical_speeds_used_ = true;
+      }
+    }
+    Cost newcost = pred.cost() + edgecost +
                    costing_->TransitionCost(directededge, nodeinfo, pred);
     uint32_t distance = pred.path_distance() + directededge->length();
 
@@ -151,7 +226,12 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
   // Set the mode and costing
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
-  current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
+  Initialize(locations, max_matrix_distance);
+
+  // Departing at a time makes the search time dependent
+  time_dependent_ = origin.has_date_time() && DateTime::is_iso_local(origin.date_time());
+  origin_second_of_week_ = time_dependent_ ?
+      (DateTime::second_of_week(origin.date_time()) + departure_offset_) % kSecondsPerWeek : 0;
 
   // Construct adjacency list, edge status, and done set. Set bucket size and
   // cost range based on DynamicCost. Initialize A* heuristic with 0 cost
@@ -164,16 +244,21 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
   };
   adjacencylist_.reset(new DoubleBucketQueue(0.0f, current_cost_threshold_,
                                              bucketsize, edgecost));
-  edgestatus_.reset(new EdgeStatus());
+  edgestatus_->Init();
 
   // Initialize the origin and destination locations
-  settled_count_ = 0;
   SetOriginOneToMany(graphreader, origin);
   SetDestinations(graphreader, locations);
 
   // Find shortest path
   const GraphTile* tile;
+  uint32_t n = 0;
   while (true) {
+    // Allow this process to be aborted
+    if (interrupt_ && (n++ % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -193,13 +278,13 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
     }
 
     // Identify any destinations on this edge
-    auto destedge = dest_edges_.find(pred.edgeid());
-    if (destedge != dest_edges_.end()) {
+    auto* destedge = FindDestinationEdge(pred.edgeid());
+    if (destedge != nullptr) {
       // Update any destinations along this edge. Return if all destinations
       // have been settled.
       tile = graphreader.GetGraphTile(pred.edgeid());
       const DirectedEdge* edge = tile->directededge(pred.edgeid());
-      if (UpdateDestinations(origin, locations, destedge->second, edge,
+      if (UpdateDestinations(origin, locations, *destedge, edge,
                              pred, predindex)) {
         return FormTimeDistanceMatrix();
       }
@@ -210,6 +295,12 @@ std::vector<TimeDistance> TimeDistanceMatrix::OneToMany(
       return FormTimeDistanceMatrix();
     }
 
+    // Do not expand on a level that has run out of upward transitions
+    // unless near a destination
+    if (StopExpanding(graphreader, pred.endnode())) {
+      continue;
+    }
+
     // Expand forward from the end node of the predecessor edge.
     ExpandForward(graphreader, pred.endnode(), pred, predindex, false);
   }
@@ -251,8 +342,14 @@ void TimeDistanceMatrix::ExpandReverse(GraphReader& graphreader,
     // Handle transition edges - expand from the end node of the transition
     // (unless this is called from a transition).
     if (directededge->IsTransition()) {
+      // Count the upward transitions and do not go down onto a level that
+      // is no longer expanded
       if (!from_transition) {
-        ExpandReverse(graphreader, directededge->endnode(), pred, pred_idx, true);
+        if (use_hierarchy_limits_ && directededge->trans_up() &&
+            node.level() < hierarchy_limits_.size())
+          hierarchy_limits_[node.level()].up_transition_count++;
+        if (!directededge->trans_down() || !StopExpanding(graphreader, directededge->endnode()))
+          ExpandReverse(graphreader, directededge->endnode(), pred, pred_idx, true);
       }
       continue;
     }
@@ -318,7 +415,8 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
   // Set the mode and costing
   mode_ = mode;
   costing_ = mode_costing[static_cast<uint32_t>(mode_)];
-  current_cost_threshold_ = GetCostThreshold(max_matrix_distance);
+  Initialize(locations, max_matrix_distance);
+  time_dependent_ = false;
 
   // Construct adjacency list, edge status, and done set. Set bucket size and
   // cost range based on DynamicCost. Initialize A* heuristic with 0 cost
@@ -330,16 +428,21 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
   };
   adjacencylist_.reset(new DoubleBucketQueue(0.0f, current_cost_threshold_,
                                          bucketsize, edgecost));
-  edgestatus_.reset(new EdgeStatus());
+  edgestatus_->Init();
 
   // Initialize the origin and destination locations
-  settled_count_ = 0;
   SetOriginManyToOne(graphreader, dest);
   SetDestinationsManyToOne(graphreader, locations);
 
   // Find shortest path
   const GraphTile* tile;
+  uint32_t n = 0;
   while (true) {
+    // Allow this process to be aborted
+    if (interrupt_ && (n++ % kInterruptIterationsInterval) == 0) {
+      (*interrupt_)();
+    }
+
     // Get next element from adjacency list. Check that it is valid. An
     // invalid label indicates there are no edges that can be expanded.
     uint32_t predindex = adjacencylist_->pop();
@@ -359,13 +462,13 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
     }
 
     // Identify any destinations on this edge
-    auto destedge = dest_edges_.find(pred.edgeid());
-    if (destedge != dest_edges_.end()) {
+    auto* destedge = FindDestinationEdge(pred.edgeid());
+    if (destedge != nullptr) {
       // Update any destinations along this edge. Return if all destinations
       // have been settled.
       tile = graphreader.GetGraphTile(pred.edgeid());
       const DirectedEdge* edge = tile->directededge(pred.edgeid());
-      if (UpdateDestinations(dest, locations, destedge->second, edge,
+      if (UpdateDestinations(dest, locations, *destedge, edge,
                              pred, predindex)) {
         return FormTimeDistanceMatrix();
       }
@@ -376,6 +479,12 @@ std::vector<TimeDistance> TimeDistanceMatrix::ManyToOne(
       return FormTimeDistanceMatrix();
     }
 
+    // Do not expand on a level that has run out of upward transitions
+    // unless near a destination
+    if (StopExpanding(graphreader, pred.endnode())) {
+      continue;
+    }
+
     // Expand forward from the end node of the predecessor edge.
     ExpandReverse(graphreader, pred.endnode(), pred, predindex, false);
   }
@@ -420,6 +529,54 @@ std::vector<TimeDistance> TimeDistanceMatrix::SourceToTarget(
   return many_to_many;
 }
 
+// Form the matrices of a sweep over departure times
+std::vector<std::vector<TimeDistance> > TimeDistanceMatrix::SourceToTargetSlices(
+        const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+        const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+        baldr::GraphReader& graphreader,
+        const std::shared_ptr<sif::DynamicCost>* mode_costing,
+        const sif::TravelMode mode, const float max_matrix_distance,
+        const uint32_t interval, const uint32_t count) {
+  std::vector<std::vector<TimeDistance> > slices(count);
+  if (count == 0) {
+    return slices;
+  }
+
+  // The searches from the targets don't depend on the time
+  if (source_location_list.size() > target_location_list.size()) {
+    slices[0] = SourceToTarget(source_location_list, target_location_list, graphreader,
+                               mode_costing, mode, max_matrix_distance);
+    std::fill(slices.begin() + 1, slices.end(), slices[0]);
+    return slices;
+  }
+
+  // Search from each source at the first departure time and again at the
+  // others only if the search got to edges with historical speeds
+  for (auto& slice : slices) {
+    slice.reserve(source_location_list.size() * target_location_list.size());
+  }
+  for (const auto& origin : source_location_list) {
+    departure_offset_ = 0;
+    historical_speeds_used_ = false;
+    std::vector<TimeDistance> td = OneToMany(origin, target_location_list, graphreader,
+                                             mode_costing, mode, max_matrix_distance);
+    Clear();
+    bool shared = !historical_speeds_used_;
+    slices[0].insert(slices[0].end(), td.begin(), td.end());
+    for (uint32_t i = 1; i < count; ++i) {
+      if (!shared) {
+        departure_offset_ = i * interval;
+        td = OneToMany(origin, target_location_list, graphreader,
+                       mode_costing, mode, max_matrix_distance);
+        Clear();
+      }
+      slices[i].insert(slices[i].end(), td.begin(), td.end());
+    }
+  }
+  departure_offset_ = 0;
+  return slices;
+}
+
 // Add edges at the origin to the adjacency list
 void TimeDistanceMatrix::SetOriginOneToMany(GraphReader& graphreader,
                  const odin::Location& origin) {
@@ -546,7 +703,7 @@ void TimeDistanceMatrix::SetDestinations(GraphReader& graphreader,
 
       // Mark the edge as having a destination on it and add the
       // destination index
-      dest_edges_[edge.graph_id()].push_back(idx);
+      AddDestinationEdge(edge.graph_id(), idx);
     }
     idx++;
   }
@@ -587,7 +744,7 @@ void TimeDistanceMatrix::SetDestinationsManyToOne(GraphReader& graphreader,
 
       // Mark the edge as having a destination on it and add the
       // destination index
-      dest_edges_[opp_edge_id].push_back(idx);
+      AddDestinationEdge(opp_edge_id, idx);
     }
     idx++;
   }
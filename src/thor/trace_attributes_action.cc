@@ -35,6 +35,11 @@ namespace {
   constexpr size_t kRawScoreIndex = 1;
   constexpr size_t kMatchResultsIndex = 2;
   constexpr size_t kTripPathIndex = 3;
+
+  // Whether a path has any edges in either of its forms
+  bool is_empty(const valhalla::odin::TripPath& trip_path) {
+    return trip_path.node_size() == 0 && !trip_path.has_columns();
+  }
 }
 
 namespace valhalla {
@@ -65,6 +70,7 @@ void thor_worker_t::filter_attributes(const valhalla_request_t& request, Attribu
 std::string thor_worker_t::trace_attributes(valhalla_request_t& request) {
 
   // Parse request
+  track_stats(request);
   parse_locations(request);
   parse_costing(request);
   parse_trace_config(request);
@@ -80,6 +86,8 @@ std::string thor_worker_t::trace_attributes(valhalla_request_t& request) {
   std::vector<std::tuple<float, float, std::vector<thor::MatchResult>, odin::TripPath>> map_match_results;
   AttributesController controller;
   filter_attributes(request, controller);
+  // Json only asking for what the columns have needs no nodes, pbf keeps them
+  controller.columnar = request.options.format() != odin::DirectionsOptions::pbf && controller.columns_suffice();
   auto shape_match = STRING_TO_MATCH.find(rapidjson::get<std::string>(request.document, "/shape_match", "walk_or_snap"));
   if (shape_match == STRING_TO_MATCH.cend())
     throw valhalla_exception_t{445};
@@ -89,10 +97,11 @@ std::string thor_worker_t::trace_attributes(valhalla_request_t& request) {
   switch (shape_match->second) {
       case EDGE_WALK:
         try {
-          trip_path = route_match(request, controller);
-          if (trip_path.node().size() == 0)
+          route_match(request, controller).Swap(&trip_path);
+          if (is_empty(trip_path))
             throw std::exception{};
-          map_match_results.emplace_back(1.0f, 0.0f, std::vector<thor::MatchResult>{}, trip_path);
+          map_match_results.emplace_back(1.0f, 0.0f, std::vector<thor::MatchResult>{}, odin::TripPath{});
+          std::get<kTripPathIndex>(map_match_results.back()).Swap(&trip_path);
         } catch (const std::exception& e) {
           throw valhalla_exception_t{443, shape_match->first + " algorithm failed to find exact route match.  Try using shape_match:'walk_or_snap' to fallback to map-matching algorithm"};
         }
@@ -111,8 +120,8 @@ std::string thor_worker_t::trace_attributes(valhalla_request_t& request) {
       // then we want to fallback to try and use meili map matching to match to local route network.
       // No shortcuts are used and detailed information at every intersection becomes available.
       case WALK_OR_SNAP:
-        trip_path = route_match(request, controller);
-        if (trip_path.node().size() == 0) {
+        route_match(request, controller).Swap(&trip_path);
+        if (is_empty(trip_path)) {
           LOG_WARN(shape_match->first + " algorithm failed to find exact route match; Falling back to map_match...");
           try {
             map_match_results = map_match(request, controller);
@@ -120,15 +129,17 @@ std::string thor_worker_t::trace_attributes(valhalla_request_t& request) {
             throw valhalla_exception_t{444, shape_match->first + " algorithm failed to snap the shape points to the correct shape."};
           }
         } else {
-          map_match_results.emplace_back(1.0f, 0.0f, std::vector<thor::MatchResult>{}, trip_path);
+          map_match_results.emplace_back(1.0f, 0.0f, std::vector<thor::MatchResult>{}, odin::TripPath{});
+          std::get<kTripPathIndex>(map_match_results.back()).Swap(&trip_path);
         }
         break;
     }
   }
 
   if(map_match_results.empty()
-      || std::get<kTripPathIndex>(map_match_results.at(0)).node().size() == 0)
+      || is_empty(std::get<kTripPathIndex>(map_match_results.at(0))))
     throw valhalla_exception_t { 442 };
+  finish_stats();
   return tyr::serializeTraceAttributes(request, controller, map_match_results);
 }
 }
@@ -50,6 +50,7 @@ namespace thor {
 odin::TripPath thor_worker_t::trace_route(valhalla_request_t& request) {
 
   // Parse request
+  track_stats(request);
   parse_locations(request);
   parse_costing(request);
   parse_trace_config(request);
@@ -74,7 +75,7 @@ odin::TripPath thor_worker_t::trace_route(valhalla_request_t& request) {
     switch (shape_match->second) {
       case EDGE_WALK:
         try {
-          trip_path = route_match(request, controller);
+          route_match(request, controller).Swap(&trip_path);
           if (trip_path.node().size() == 0)
             throw;
         } catch (...) {
@@ -87,7 +88,7 @@ odin::TripPath thor_worker_t::trace_route(valhalla_request_t& request) {
         try {
           auto map_match_results = map_match(request, controller);
           if (!map_match_results.empty())
-            trip_path = std::get<kTripPathIndex>(map_match_results.at(0));
+            trip_path.Swap(&std::get<kTripPathIndex>(map_match_results.at(0)));
         } catch(...) {
           throw valhalla_exception_t { 442 };
         }
@@ -96,13 +97,13 @@ odin::TripPath thor_worker_t::trace_route(valhalla_request_t& request) {
       // then we want to fallback to try and use meili map matching to match to local route network.
       //No shortcuts are used and detailed information at every intersection becomes available.
       case WALK_OR_SNAP:
-        trip_path = route_match(request, controller);
+        route_match(request, controller).Swap(&trip_path);
         if (trip_path.node().size() == 0) {
           LOG_WARN(shape_match->first + " algorithm failed to find exact route match; Falling back to map_match...");
           try {
             auto map_match_results = map_match(request, controller);
             if (!map_match_results.empty())
-              trip_path = std::get<kTripPathIndex>(map_match_results.at(0));
+              trip_path.Swap(&std::get<kTripPathIndex>(map_match_results.at(0)));
           } catch(...) {
             throw valhalla_exception_t { 442 };
           }
@@ -114,6 +115,7 @@ odin::TripPath thor_worker_t::trace_route(valhalla_request_t& request) {
         log_admin(trip_path);
     }
 
+  finish_stats();
   return trip_path;
 }
 
@@ -128,12 +130,16 @@ odin::TripPath thor_worker_t::trace_route(valhalla_request_t& request) {
 odin::TripPath thor_worker_t::route_match(valhalla_request_t& request, const AttributesController& controller) {
   odin::TripPath trip_path;
   std::vector<PathInfo> path_infos;
-  if (RouteMatcher::FormPath(mode_costing, mode, reader, trace, request.options.locations(), path_infos)) {
+  auto start = std::chrono::steady_clock::now();
+  auto found = RouteMatcher::FormPath(mode_costing, mode, reader, trace, request.options.locations(), path_infos);
+  add_search_time(start);
+  if (found) {
     // Form the trip path based on mode costing, origin, destination, and path edges
-    trip_path = thor::TripPathBuilder::Build(controller, reader, mode_costing,
-                                             path_infos, *request.options.mutable_locations()->begin(),
-                                             *request.options.mutable_locations()->rbegin(), std::list<odin::Location>{},
-                                             interrupt);
+    auto built = thor::TripPathBuilder::Build(controller, reader, mode_costing,
+                                              path_infos, *request.options.mutable_locations()->begin(),
+                                              *request.options.mutable_locations()->rbegin(), std::list<odin::Location>{},
+                                              interrupt);
+    trip_path.Swap(&built);
   }
 
   return trip_path;
@@ -151,8 +157,10 @@ std::vector<std::tuple<float, float, std::vector<thor::MatchResult>, odin::TripP
   matcher->set_interrupt(interrupt);
   // Create the vector of matched path results
   std::vector<meili::MatchResults> offline_results;
+  auto start = std::chrono::steady_clock::now();
   if (trace.size() > 0)
     offline_results = matcher->OfflineMatch(trace, best_paths);
+  add_search_time(start);
 
   // Process each score/match result
   for (const auto& result : offline_results) {
@@ -428,18 +436,25 @@ std::vector<std::tuple<float, float, std::vector<thor::MatchResult>, odin::TripP
       // assert origin.edges contains path_edges.front() &&
       // destination.edges contains path_edges.back()
 
-      // Form the trip path based on mode costing, origin, destination, and path edges
-      trip_path = thor::TripPathBuilder::Build(controller, matcher->graphreader(),
-          mode_costing, path_edges, origin,
-          destination, std::list<odin::Location>{},
-          interrupt, &route_discontinuities);
+      // Form the trip path based on mode costing, origin, destination, and path edges,
+      // straight into the columns when those are all that is asked for
+      auto built = controller.columnar ?
+          thor::TripPathBuilder::BuildColumns(controller, matcher->graphreader(),
+              mode_costing, path_edges, origin, destination,
+              interrupt, &route_discontinuities) :
+          thor::TripPathBuilder::Build(controller, matcher->graphreader(),
+              mode_costing, path_edges, origin,
+              destination, std::list<odin::Location>{},
+              interrupt, &route_discontinuities);
+      trip_path.Swap(&built);
     } else {
       throw valhalla_exception_t { 442 };
     }
     // Keep the result
     map_match_results.emplace_back(
         map_match_results.empty() ? 1.0f : std::get<kRawScoreIndex>(map_match_results.front()) / result.score,
-        result.score, enhanced_match_results, trip_path);
+        result.score, enhanced_match_results, odin::TripPath{});
+    std::get<kTripPathIndex>(map_match_results.back()).Swap(&trip_path);
   }
 
   return map_match_results;
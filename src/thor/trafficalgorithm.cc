@@ -105,7 +105,7 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(odin::Location& origin,
     }
 
     // Check if this tile has real-time speeds
-    std::vector<uint8_t>& speeds = GetRealTimeSpeeds(node.tileid(), graphreader);
+    TileSpeeds speeds = graphreader.GetTrafficSpeeds(node);
 
     // Expand from end node.
     GraphId edgeid(node.tileid(), node.level(), nodeinfo->edge_index());
@@ -133,7 +133,7 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(odin::Location& origin,
       // TODO - want to add a traffic costing method in sif
       Cost edge_cost;
       Cost tc = costing_->TransitionCost(directededge, nodeinfo, pred);
-      if (speeds.size() == 0 || speeds[edgeid.id()] == 0) {
+      if (speeds[edgeid.id()] == 0) {
         edge_cost = costing_->EdgeCost(directededge);
       } else {
         // Traffic exists for this edge
@@ -196,33 +196,5 @@ std::vector<PathInfo> TrafficAlgorithm::GetBestPath(odin::Location& origin,
   return {};      // Should never get here
 }
 
-std::vector<uint8_t>& TrafficAlgorithm::GetRealTimeSpeeds(const uint32_t tileid,
-                               GraphReader& graphreader) {
-  // Check if this tile has real-time speeds
-  auto rts = real_time_speeds_.find(tileid);
-  if (rts == real_time_speeds_.end()) {
-    // Try to load the speeds file
-    std::ifstream rtsfile;
-    std::string traffic_dir = graphreader.tile_dir() + "/traffic/";
-    std::string fname = traffic_dir + std::to_string(tileid) + ".spd";
-    rtsfile.open(fname, std::ios::binary | std::ios::in | std::ios::ate);
-    if (rtsfile.is_open()) {
-      uint32_t count = rtsfile.tellg();
-      LOG_INFO("Load real time speeds: count = " + std::to_string(count));
-      rtsfile.seekg(0, rtsfile.beg);
-      std::vector<uint8_t> spds(count);
-      rtsfile.read((char*)(&spds.front()), count);
-      rtsfile.close();
-      real_time_speeds_[tileid] = spds;
-      return real_time_speeds_[tileid];
-    } else {
-      return empty_speeds_;
-    }
-  } else {
-    return rts->second;
-  }
-}
-
-
 }
 }
@@ -18,6 +18,7 @@
 #include "midgard/pointll.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "sif/costconstants.h"
 #include "proto/tripcommon.pb.h"
 
@@ -63,6 +64,24 @@ void AddPartialShape(std::vector<PointLL>& shape, iter start, iter end,
   }
 }
 
+// Append the shape of an edge in the direction it is traversed, decoding it
+// straight from the tile rather than through a copy in EdgeInfo::shape. The
+// first point is skipped when it is the last point of the edge before.
+void AppendShape(const EdgeInfo& edgeinfo, const bool forward,
+                 const bool skip_first, std::vector<PointLL>& shape) {
+  auto start = shape.size();
+  auto decoder = edgeinfo.lazy_shape();
+  if (forward && skip_first && !decoder.empty())
+    decoder.pop();
+  while (!decoder.empty())
+    shape.emplace_back(decoder.pop());
+  if (!forward) {
+    if (skip_first && shape.size() > start)
+      shape.pop_back();
+    std::reverse(shape.begin() + start, shape.end());
+  }
+}
+
 void TrimShape(std::vector<PointLL>& shape, const float start,
                const PointLL& start_vertex, const float end,
                const PointLL& end_vertex) {
@@ -432,6 +451,121 @@ void SetHeadings(TripPath_Edge* trip_edge, const AttributesController& controlle
   }
 }
 
+/**
+ * Keep the attributes of an edge that have a column in the columns of the path.
+ * @param  controller    Controller specifying attributes to add to the columns.
+ * @param  trip_edge     Trip path edge the attributes were set on.
+ * @param  elapsed_time  Seconds from the start of the leg to the end of the edge.
+ * @param  columns       Columns of the trip path.
+ */
+void AddColumns(const AttributesController& controller, const TripPath_Edge& trip_edge,
+                const uint32_t elapsed_time, TripPath_Columns& columns) {
+  if (controller.attributes.at(kEdgeLength))
+    columns.add_length(trip_edge.length());
+  if (controller.attributes.at(kEdgeSpeed))
+    columns.add_speed(trip_edge.speed());
+  if (controller.attributes.at(kEdgeWayId))
+    columns.add_way_id(trip_edge.way_id());
+  if (controller.attributes.at(kEdgeBeginShapeIndex))
+    columns.add_begin_shape_index(trip_edge.begin_shape_index());
+  if (controller.attributes.at(kEdgeEndShapeIndex))
+    columns.add_end_shape_index(trip_edge.end_shape_index());
+  if (controller.attributes.at(kNodeElapsedTime))
+    columns.add_elapsed_time(elapsed_time);
+}
+
+/**
+ * Add the shape of an edge of the path to the trip shape, cut short at a
+ * partial first or last edge and at a route discontinuity.
+ * @param  edgeinfo              Edge info of the edge.
+ * @param  directededge          Directed edge.
+ * @param  edge_index            Index of the edge in the path.
+ * @param  is_first_edge         Whether the edge is the first of the path.
+ * @param  is_last_edge          Whether the edge is the last of the path.
+ * @param  length_pct            Share of the edge on the path.
+ * @param  start_pct             Percent along the first edge of the origin.
+ * @param  start_vrt             Location on the first edge of the origin.
+ * @param  end_pct               Percent along the last edge of the destination.
+ * @param  end_vrt               Location on the last edge of the destination.
+ * @param  route_discontinuities Edges where the route is discontinuous, if any.
+ * @param  edge_shape            Scratch shape, reused from one edge to the next.
+ * @param  trip_shape            Trip shape to add to.
+ * @return Returns the index of the first shape point of the edge.
+ */
+uint32_t AddEdgeShape(const EdgeInfo& edgeinfo, const DirectedEdge* directededge,
+    const size_t edge_index, const bool is_first_edge, const bool is_last_edge,
+    const float length_pct, const float start_pct, const PointLL& start_vrt,
+    const float end_pct, const PointLL& end_vrt,
+    std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>>* route_discontinuities,
+    std::vector<PointLL>& edge_shape, std::vector<PointLL>& trip_shape) {
+  uint32_t begin_index = (is_first_edge) ? 0 : trip_shape.size() - 1;
+
+  // Process the shape for edges where a route discontinuity occurs
+  if (route_discontinuities && !route_discontinuities->empty()
+      && route_discontinuities->count(edge_index) > 0) {
+    // Get edge shape, reversed if directed edge is not forward
+    edge_shape.clear();
+    AppendShape(edgeinfo, directededge->forward(), false, edge_shape);
+
+    // Grab the edge begin and end info
+    auto& edge_begin_info = route_discontinuities->at(edge_index).first;
+    auto& edge_end_info = route_discontinuities->at(edge_index).second;
+
+    // Handle partial shape for first edge
+    if (is_first_edge && !edge_begin_info.exists) {
+      edge_begin_info.exists = true;
+      edge_begin_info.distance_along = start_pct;
+      edge_begin_info.vertex = start_vrt;
+    }
+
+    // Handle partial shape for last edge
+    if (is_last_edge && !edge_end_info.exists) {
+      edge_end_info.exists = true;
+      edge_end_info.distance_along = end_pct;
+      edge_end_info.vertex = end_vrt;
+    }
+
+    // Trim the shape
+    float edge_length = static_cast<float>(directededge->length());
+    TrimShape(edge_shape, edge_begin_info.distance_along * edge_length,
+        edge_begin_info.vertex, edge_end_info.distance_along * edge_length,
+        edge_end_info.vertex);
+
+    // Add edge shape to trip
+    trip_shape.insert(trip_shape.end(),
+        (edge_shape.begin() + ((edge_begin_info.exists || is_first_edge) ? 0 : 1)),
+        edge_shape.end());
+
+    // If edge_begin_info.exists and not the first edge
+    // then increment begin_index
+    // since the previous end shape index should not equal
+    // the current begin shape index because of discontinuity
+    if (edge_begin_info.exists && !is_first_edge) {
+      ++begin_index;
+    }
+
+  } else if (is_first_edge || is_last_edge) {
+    // We need to clip the shape if i its at the beginning or end and
+    // is not full length
+    float length = std::max(static_cast<float>(directededge->length()) * length_pct, 1.0f);
+    edge_shape.clear();
+    AppendShape(edgeinfo, true, false, edge_shape);
+    if (directededge->forward() == is_last_edge) {
+      AddPartialShape<std::vector<PointLL>::const_iterator>(
+          trip_shape, edge_shape.cbegin(), edge_shape.cend(),
+          length, is_last_edge, is_last_edge ? end_vrt : start_vrt);
+    } else {
+      AddPartialShape<std::vector<PointLL>::const_reverse_iterator>(
+          trip_shape, edge_shape.crbegin(), edge_shape.crend(),
+          length, is_last_edge, is_last_edge ? end_vrt : start_vrt);
+    }
+  } else {
+    // Just get the shape in there in the right direction
+    AppendShape(edgeinfo, directededge->forward(), true, trip_shape);
+  }
+  return begin_index;
+}
+
 }
 
 /**
@@ -520,6 +654,7 @@ TripPath TripPathBuilder::Build(
     const std::list<odin::Location>& through_loc,
     const std::function<void ()>* interrupt_callback,
     std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>>* route_discontinuities) {
+  METRICS_TIME(kThorTripPath);
   // Test interrupt prior to building trip path
   if (interrupt_callback) {
     (*interrupt_callback)();
@@ -528,6 +663,17 @@ TripPath TripPathBuilder::Build(
   // TripPath is a protocol buffer that contains information about the trip
   TripPath trip_path;
 
+  // A columnar path sets the attributes of each node and edge on one scratch
+  // node, reused from one edge to the next, and keeps the ones with columns
+  TripPath_Node scratch_node;
+  TripPath_Columns* columns = controller.columnar ? trip_path.mutable_columns() : nullptr;
+  auto next_node = [&trip_path, &scratch_node, columns]() {
+    if (!columns)
+      return trip_path.add_node();
+    scratch_node.Clear();
+    return &scratch_node;
+  };
+
   // Get the local tile level
   uint32_t local_level = TileHierarchy::levels().rbegin()->first;
 
@@ -537,9 +683,9 @@ TripPath TripPathBuilder::Build(
   auto* tp_orig = trip_path.mutable_location(0);
   auto* tp_dest = trip_path.mutable_location(trip_path.location_size() - 1);
 
-  uint32_t origin_sec_from_mid = 0;
-  if (origin.has_date_time())
-    origin_sec_from_mid = DateTime::seconds_from_midnight(origin.date_time());
+  // Parse the origin date and time once rather than at every node
+  const DateTime::time_context_t origin_time(origin.has_date_time() ? origin.date_time() : "");
+  uint32_t origin_sec_from_mid = origin_time.seconds_from_midnight;
 
   // Create an array of travel types per mode
   uint8_t travel_types[4];
@@ -614,10 +760,9 @@ TripPath TripPathBuilder::Build(
 
     // Get the shape. Reverse if the directed edge direction does
     // not match the traversal direction (based on start and end percent).
-    auto shape = tile->edgeinfo(edge->edgeinfo_offset()).shape();
-    if (edge->forward() != (start_pct < end_pct)) {
-      std::reverse(shape.begin(), shape.end());
-    }
+    std::vector<PointLL> shape;
+    AppendShape(tile->edgeinfo(edge->edgeinfo_offset()),
+                edge->forward() == (start_pct < end_pct), false, shape);
 
     // If traversing the opposing direction: adjust start and end percent
     // and reverse the edge and side of street if traversing the opposite
@@ -637,16 +782,14 @@ TripPath TripPathBuilder::Build(
     TrimShape(shape, start_pct * total, start_vrt, end_pct * total, end_vrt);
 
     uint32_t current_time = 0;
-    if (origin.has_date_time()) {
-      DateTime::seconds_from_midnight(origin.date_time());
-      current_time += path.front().elapsed_time;
-    }
+    if (origin.has_date_time())
+      current_time = origin_sec_from_mid + path.front().elapsed_time;
 
     // Add trip edge
     auto trip_edge = AddTripEdge(
         controller, path.front().edgeid, path.front().trip_id, 0,
         path.front().mode, travel_types[static_cast<int>(path.front().mode)],
-        edge, trip_path.add_node(), tile, current_time, std::abs(end_pct - start_pct));
+        edge, next_node(), tile, current_time, std::abs(end_pct - start_pct));
 
     // Set begin shape index if requested
     if (controller.attributes.at(kEdgeBeginShapeIndex))
@@ -658,8 +801,10 @@ TripPath TripPathBuilder::Build(
     // Set begin and end heading if requested. Uses shape so
     // must be done after the edge's shape has been added.
     SetHeadings(trip_edge, controller, edge, shape, 0);
+    if (columns)
+      AddColumns(controller, *trip_edge, path.front().elapsed_time, *columns);
 
-    auto* node = trip_path.add_node();
+    auto* node = next_node();
     if (controller.attributes.at(kNodeElapsedTime))
       node->set_elapsed_time(path.front().elapsed_time);
 
@@ -735,11 +880,16 @@ TripPath TripPathBuilder::Build(
   uint32_t block_id = 0;
   uint32_t prior_opp_local_index = -1;
   std::vector<PointLL> trip_shape;
+  // Shape of an edge that gets trimmed, reused from one edge to the next
+  std::vector<PointLL> edge_shape;
   std::string arrival_time;
   bool assumed_schedule = false;
   sif::TravelMode prev_mode = sif::TravelMode::kPedestrian;
   uint64_t osmchangeset = 0;
   size_t edge_index = 0;
+  // A node per edge and one at the end, so the nodes are only placed once
+  if (!columns)
+    trip_path.mutable_node()->Reserve(path.size() + 1);
   // TODO: this is temp until we use transit stop type from transitland
   TransitPlatformInfo_Type prev_transit_node_type =
       TransitPlatformInfo_Type_kStop;
@@ -758,7 +908,7 @@ TripPath TripPathBuilder::Build(
     }
 
     // Add a node to the trip path and set its attributes.
-    TripPath_Node* trip_node = trip_path.add_node();
+    TripPath_Node* trip_node = next_node();
 
     // Set node attributes - only set if they are true since they are optional
     const GraphTile* start_tile = graphreader.GetGraphTile(startnode);
@@ -776,10 +926,8 @@ TripPath TripPathBuilder::Build(
     }
 
     uint32_t current_time;
-    if (origin.has_date_time()) {
-      current_time = DateTime::seconds_from_midnight(origin.date_time());
-      current_time += elapsedtime;
-    }
+    if (origin.has_date_time())
+      current_time = origin_sec_from_mid + elapsedtime;
 
     // Assign the elapsed time from the start of the leg
     if (controller.attributes.at(kNodeElapsedTime))
@@ -793,7 +941,6 @@ TripPath TripPathBuilder::Build(
     }
 
     if (controller.attributes.at(kNodeTimeZone)) {
-      const auto& tz_db = DateTime::get_tz_db();
       auto tz = DateTime::get_tz_db().from_index(node->timezone());
       if(tz)
         trip_node->set_time_zone(tz->to_posix_string());
@@ -886,17 +1033,14 @@ TripPath TripPathBuilder::Build(
                                   trip_id,current_time);
 
         assumed_schedule = false;
-        uint32_t date, day = 0;
+        uint32_t day = 0;
         if (origin.has_date_time()) {
-          date = DateTime::days_from_pivot_date(DateTime::get_formatted_date(origin.date_time()));
-
-          if (graphtile->header()->date_created() > date) {
+          if (!origin_time.day_from(graphtile->header()->date_created(), day)) {
             // Set assumed schedule if requested
             if (controller.attributes.at(kNodeTransitPlatformInfoAssumedSchedule))
               transit_platform_info->set_assumed_schedule(true);
             assumed_schedule = true;
           } else {
-            day = date - graphtile->header()->date_created();
             if (day > graphtile->GetTransitSchedule(transit_departure->schedule_index())->end_day()) {
               // Set assumed schedule if requested
               if (controller.attributes.at(kNodeTransitPlatformInfoAssumedSchedule))
@@ -963,79 +1107,9 @@ TripPath TripPathBuilder::Build(
 
     // Get the shape and set shape indexes (directed edge forward flag
     // determines whether shape is traversed forward or reverse).
-    auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
-    uint32_t begin_index = (is_first_edge) ? 0 : trip_shape.size() - 1;
-
-    // Process the shape for edges where a route discontinuity occurs
-    if (route_discontinuities && !route_discontinuities->empty()
-        && route_discontinuities->count(edge_index) > 0) {
-      // Get edge shape
-      auto edge_shape = edgeinfo.shape();
-
-      // Reverse edge shape if directed edge is not forward
-      if (!directededge->forward()) {
-        std::reverse(edge_shape.begin(), edge_shape.end());
-      }
-
-      // Grab the edge begin and end info
-      auto& edge_begin_info = route_discontinuities->at(edge_index).first;
-      auto& edge_end_info = route_discontinuities->at(edge_index).second;
-
-      // Handle partial shape for first edge
-      if (is_first_edge && !edge_begin_info.exists) {
-        edge_begin_info.exists = true;
-        edge_begin_info.distance_along = start_pct;
-        edge_begin_info.vertex = start_vrt;
-      }
-
-      // Handle partial shape for last edge
-      if (is_last_edge && !edge_end_info.exists) {
-        edge_end_info.exists = true;
-        edge_end_info.distance_along = end_pct;
-        edge_end_info.vertex = end_vrt;
-      }
-
-      // Trim the shape
-      float edge_length = static_cast<float>(directededge->length());
-      TrimShape(edge_shape, edge_begin_info.distance_along * edge_length,
-          edge_begin_info.vertex, edge_end_info.distance_along * edge_length,
-          edge_end_info.vertex);
-
-      // Add edge shape to trip
-      trip_shape.insert(trip_shape.end(),
-          (edge_shape.begin() + ((edge_begin_info.exists || is_first_edge) ? 0 : 1)),
-          edge_shape.end());
-
-      // If edge_begin_info.exists and not the first edge
-      // then increment begin_index
-      // since the previous end shape index should not equal
-      // the current begin shape index because of discontinuity
-      if (edge_begin_info.exists && !is_first_edge) {
-        ++begin_index;
-      }
-
-    } else if (is_first_edge || is_last_edge) {
-      // We need to clip the shape if i its at the beginning or end and
-      // is not full length
-      float length = std::max(static_cast<float>(directededge->length()) * length_pct, 1.0f);
-      if (directededge->forward() == is_last_edge) {
-        AddPartialShape<std::vector<PointLL>::const_iterator>(
-            trip_shape, edgeinfo.shape().begin(), edgeinfo.shape().end(),
-            length, is_last_edge, is_last_edge ? end_vrt : start_vrt);
-      } else {
-        AddPartialShape<std::vector<PointLL>::const_reverse_iterator>(
-            trip_shape, edgeinfo.shape().rbegin(), edgeinfo.shape().rend(),
-            length, is_last_edge, is_last_edge ? end_vrt : start_vrt);
-      }
-    } else {
-      // Just get the shape in there in the right direction
-      if (directededge->forward())
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().begin() + 1,
-                          edgeinfo.shape().end());
-      else
-        trip_shape.insert(trip_shape.end(), edgeinfo.shape().rbegin() + 1,
-                          edgeinfo.shape().rend());
-    }
+    uint32_t begin_index = AddEdgeShape(graphtile->edgeinfo(directededge->edgeinfo_offset()),
+        directededge, edge_index, is_first_edge, is_last_edge, length_pct, start_pct, start_vrt,
+        end_pct, end_vrt, route_discontinuities, edge_shape, trip_shape);
 
     // Set begin shape index if requested
     if (controller.attributes.at(kEdgeBeginShapeIndex)) {
@@ -1049,6 +1123,8 @@ TripPath TripPathBuilder::Build(
     // Set begin and end heading if requested. Uses trip_shape so
     // must be done after the edge's shape has been added.
     SetHeadings(trip_edge, controller, directededge, trip_shape, begin_index);
+    if (columns)
+      AddColumns(controller, *trip_edge, edge_itr->elapsed_time, *columns);
 
     // Add connected edges from the start node. Do this after the first trip
     // edge is added
@@ -1187,7 +1263,7 @@ TripPath TripPathBuilder::Build(
   }
 
   // Add the last node
-  auto* node = trip_path.add_node();
+  auto* node = next_node();
   if (controller.attributes.at(kNodeaAdminIndex)) {
     node->set_admin_index(GetAdminIndex(
         last_tile->admininfo(last_tile->node(startnode)->admin_index()),
@@ -1213,6 +1289,105 @@ TripPath TripPathBuilder::Build(
   return trip_path;
 }
 
+TripPath TripPathBuilder::BuildColumns(
+    const AttributesController& controller, GraphReader& graphreader,
+    const std::shared_ptr<sif::DynamicCost>* mode_costing,
+    const std::vector<PathInfo>& path, odin::Location& origin, odin::Location& dest,
+    const std::function<void ()>* interrupt_callback,
+    std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>>* route_discontinuities) {
+  // A single edge may be traversed either way, which only the full build handles
+  if (path.size() == 1) {
+    return Build(controller, graphreader, mode_costing, path, origin, dest, {},
+                 interrupt_callback, route_discontinuities);
+  }
+
+  METRICS_TIME(kThorTripPath);
+  if (interrupt_callback) {
+    (*interrupt_callback)();
+  }
+
+  TripPath trip_path;
+  CopyLocations(trip_path, origin, {}, dest, path);
+
+  // Partial edges at the start and the end
+  float start_pct = 0.f, end_pct = 1.f;
+  PointLL start_vrt, end_vrt;
+  for (const auto& e : origin.path_edges()) {
+    if (e.graph_id() == path.front().edgeid) {
+      start_pct = e.percent_along();
+      start_vrt = PointLL(e.ll().lng(), e.ll().lat());
+      break;
+    }
+  }
+  for (const auto& e : dest.path_edges()) {
+    if (e.graph_id() == path.back().edgeid) {
+      end_pct = e.percent_along();
+      end_vrt = PointLL(e.ll().lng(), e.ll().lat());
+      break;
+    }
+  }
+
+  // Look the attributes up once rather than at every edge
+  const bool length = controller.attributes.at(kEdgeLength);
+  const bool speed = controller.attributes.at(kEdgeSpeed);
+  const bool way_id = controller.attributes.at(kEdgeWayId);
+  const bool begin_shape_index = controller.attributes.at(kEdgeBeginShapeIndex);
+  const bool end_shape_index = controller.attributes.at(kEdgeEndShapeIndex);
+  const bool elapsed_time = controller.attributes.at(kNodeElapsedTime);
+  const bool shape = controller.attributes.at(kShape);
+  const bool need_shape = shape || begin_shape_index || end_shape_index;
+
+  auto* columns = trip_path.mutable_columns();
+  std::vector<PointLL> trip_shape, edge_shape;
+  uint64_t osmchangeset = 0;
+  bool is_first_edge = true;
+  size_t edge_index = 0;
+  for (auto edge_itr = path.begin(); edge_itr != path.end(); ++edge_itr, ++edge_index) {
+    const GraphTile* graphtile = graphreader.GetGraphTile(edge_itr->edgeid);
+    const DirectedEdge* directededge = graphtile->directededge(edge_itr->edgeid);
+    if (directededge->IsTransition()) {
+      continue;
+    }
+    if (osmchangeset == 0)
+      osmchangeset = graphtile->header()->dataset_id();
+
+    auto is_last_edge = edge_itr == path.end() - 1;
+    float length_pct = (
+        is_first_edge ? 1.f - start_pct : (is_last_edge ? end_pct : 1.f));
+    if (length)
+      columns->add_length(std::max((directededge->length() * 0.001f * length_pct), 0.001f));
+    if (speed)
+      columns->add_speed(directededge->speed());
+
+    // Only decode the edge info for what needs it
+    if (way_id || need_shape) {
+      auto edgeinfo = graphtile->edgeinfo(directededge->edgeinfo_offset());
+      if (way_id)
+        columns->add_way_id(edgeinfo.wayid());
+      if (need_shape) {
+        uint32_t begin_index = AddEdgeShape(edgeinfo, directededge, edge_index, is_first_edge,
+            is_last_edge, length_pct, start_pct, start_vrt, end_pct, end_vrt,
+            route_discontinuities, edge_shape, trip_shape);
+        if (begin_shape_index)
+          columns->add_begin_shape_index(begin_index);
+        if (end_shape_index)
+          columns->add_end_shape_index(trip_shape.size() - 1);
+      }
+    }
+    if (elapsed_time)
+      columns->add_elapsed_time(edge_itr->elapsed_time);
+    is_first_edge = false;
+  }
+
+  if (need_shape)
+    SetBoundingBox(trip_path, trip_shape);
+  if (shape)
+    trip_path.set_shape(encode<std::vector<PointLL> >(trip_shape));
+  if (osmchangeset != 0 && controller.attributes.at(kOsmChangeset))
+    trip_path.set_osm_changeset(osmchangeset);
+  return trip_path;
+}
+
 // Add a trip edge to the trip node and set its attributes
 TripPath_Edge* TripPathBuilder::AddTripEdge(const AttributesController& controller,
                                             const GraphId& edge,
@@ -1248,30 +1423,34 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const AttributesController& controll
 #endif
 
   // Set the exits (if the directed edge has exit sign information) and if requested
-  if (directededge->exitsign()) {
-    std::vector<SignInfo> signs = graphtile->GetSigns(idx);
+  if (directededge->exitsign() &&
+      (controller.attributes.at(kEdgeSignExitNumber) ||
+       controller.attributes.at(kEdgeSignExitBranch) ||
+       controller.attributes.at(kEdgeSignExitToward) ||
+       controller.attributes.at(kEdgeSignExitName))) {
+    auto signs = graphtile->GetSignRange(idx);
     if (!signs.empty()) {
       TripPath_Sign* trip_exit = trip_edge->mutable_sign();
       for (const auto& sign : signs) {
         switch (sign.type()) {
           case Sign::Type::kExitNumber: {
             if (controller.attributes.at(kEdgeSignExitNumber))
-              trip_exit->add_exit_number(sign.text());
+              trip_exit->add_exit_number(graphtile->GetText(sign.text_offset()));
             break;
           }
           case Sign::Type::kExitBranch: {
             if (controller.attributes.at(kEdgeSignExitBranch))
-              trip_exit->add_exit_branch(sign.text());
+              trip_exit->add_exit_branch(graphtile->GetText(sign.text_offset()));
             break;
           }
           case Sign::Type::kExitToward: {
             if (controller.attributes.at(kEdgeSignExitToward))
-              trip_exit->add_exit_toward(sign.text());
+              trip_exit->add_exit_toward(graphtile->GetText(sign.text_offset()));
             break;
           }
           case Sign::Type::kExitName: {
             if (controller.attributes.at(kEdgeSignExitName))
-              trip_exit->add_exit_name(sign.text());
+              trip_exit->add_exit_name(graphtile->GetText(sign.text_offset()));
             break;
           }
         }
@@ -1439,7 +1618,7 @@ TripPath_Edge* TripPathBuilder::AddTripEdge(const AttributesController& controll
     trip_edge->set_lane_count(directededge->lanecount());
 
   if (directededge->laneconnectivity() && controller.attributes.at(kEdgeLaneConnectivity)) {
-    for (const auto& l : graphtile->GetLaneConnectivity(idx)) {
+    for (const auto& l : graphtile->GetLaneConnectivityRange(idx)) {
       TripPath_LaneConnectivity* path_lane = trip_edge->add_lane_connectivity();
       path_lane->set_from_way_id(l.from());
       path_lane->set_to_lanes(l.to_lanes());
@@ -6,17 +6,20 @@
 #include <unordered_map>
 #include <cstdint>
 #include <sstream>
+#include <thread>
 
 #include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
 #include "midgard/logging.h"
 #include "midgard/constants.h"
+#include "midgard/compute_slots.h"
 #include "baldr/json.h"
 #include "exception.h"
 
 #include "thor/worker.h"
 #include "thor/isochrone.h"
+#include "thor/optimizer.h"
 #include "tyr/actor.h"
+#include "tyr/serializers.h"
 
 using namespace valhalla;
 using namespace valhalla::tyr;
@@ -45,6 +48,7 @@ namespace {
     {"pedestrian", 7200.0f},
     {"transit", 14400.0f},
     {"truck", 43200.0f},
+    {"truck_fleet", 43200.0f},
   };
   //a scale factor to apply to the score so that we bias towards closer results more
   constexpr float kDistanceScale = 10.f;
@@ -63,8 +67,18 @@ namespace valhalla {
 
     thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config):
       mode(valhalla::sif::TravelMode::kPedestrian),
+      costing_cache_size(config.get<size_t>("thor.costing_cache_size", kDefaultCostingCacheSize)),
+      label_arena(config.get<size_t>("thor.label_arena_max_size", kDefaultLabelArenaSize)),
+      label_arena_size(config.get<size_t>("thor.label_arena_max_size", kDefaultLabelArenaSize)),
+      isochrone_gen(config.get<uint32_t>("thor.isochrone_cache_seconds", kDefaultIsochroneCacheSeconds)),
       matcher_factory(config), reader(matcher_factory.graphreader()),
-      long_request(config.get<float>("thor.logging.long_request")){
+      long_request(config.get<float>("thor.logging.long_request")),
+      service_limits(config.get_child("service_limits")),
+      matrix_cache(config.get<size_t>("thor.matrix_cache.max_size", kDefaultMatrixCacheSize),
+                   config.get<uint32_t>("thor.matrix_cache.max_age", kDefaultMatrixCacheSeconds)),
+      admission(config.get_child("thor.admission", {})),
+      memory_budget(config.get<size_t>("thor.request_memory_budget", 0)),
+      search_stats(nullptr) {
       // Register edge/node costing methods
       factory.Register("auto", sif::CreateAutoCost);
       factory.Register("auto_shorter", sif::CreateAutoShorterCost);
@@ -75,6 +89,73 @@ namespace valhalla {
       factory.Register("pedestrian", sif::CreatePedestrianCost);
       factory.Register("transit", sif::CreateTransitCost);
       factory.Register("truck", sif::CreateTruckCost);
+      factory.Register("truck_fleet", sif::CreateProfileTruckCost<sif::FleetTruckProfile>);
+
+      // Have the path algorithms keep their edge label storage between requests
+      astar.set_label_arena(&label_arena);
+      bidir_astar.set_label_arena(&label_arena);
+      multi_modal_astar.set_label_arena(&label_arena);
+      raptor.set_label_arena(&label_arena);
+
+      // Load the contraction hierarchy overlays built for these costings
+      auto ch_costings = config.get_child_optional("thor.contraction_hierarchies");
+      if (ch_costings) {
+        for (const auto& item : *ch_costings) {
+          auto costing = item.second.get_value<std::string>();
+          auto file_name = CHGraph::FileName(config.get<std::string>("mjolnir.tile_dir"), costing);
+          try {
+            std::shared_ptr<const CHGraph> graph(new CHGraph(CHGraph::Load(file_name)));
+            if (graph->costing() != costing)
+              throw std::runtime_error(file_name + " was built for " + graph->costing());
+            contraction_hierarchies.emplace(costing, graph);
+            LOG_INFO("Loaded " + costing + " contraction hierarchy with " +
+                     std::to_string(graph->node_count()) + " nodes");
+          }
+          catch (const std::exception& e) {
+            LOG_WARN("Not using a contraction hierarchy for " + costing + ": " + e.what());
+          }
+        }
+      }
+
+      // Load the landmark tables built for these costings
+      auto landmark_costings = config.get_child_optional("thor.landmarks");
+      if (landmark_costings) {
+        for (const auto& item : *landmark_costings) {
+          auto costing = item.second.get_value<std::string>();
+          auto file_name = Landmarks::FileName(config.get<std::string>("mjolnir.tile_dir"), costing);
+          try {
+            std::shared_ptr<const Landmarks> tables(new Landmarks(Landmarks::Load(file_name)));
+            if (tables->costing() != costing)
+              throw std::runtime_error(file_name + " was built for " + tables->costing());
+            landmarks.emplace(costing, tables);
+            LOG_INFO("Loaded " + std::to_string(tables->landmark_count()) + " " + costing +
+                     " landmarks for " + std::to_string(tables->node_count()) + " nodes");
+          }
+          catch (const std::exception& e) {
+            LOG_WARN("Not using landmarks for " + costing + ": " + e.what());
+          }
+        }
+      }
+
+      // Load the boundary overlays built for these costings
+      auto overlay_costings = config.get_child_optional("thor.overlays");
+      if (overlay_costings) {
+        for (const auto& item : *overlay_costings) {
+          auto costing = item.second.get_value<std::string>();
+          auto file_name = OverlayGraph::FileName(config.get<std::string>("mjolnir.tile_dir"), costing);
+          try {
+            std::shared_ptr<const OverlayGraph> graph(new OverlayGraph(OverlayGraph::Load(file_name)));
+            if (graph->costing() != costing)
+              throw std::runtime_error(file_name + " was built for " + graph->costing());
+            overlays.emplace(costing, graph);
+            LOG_INFO("Loaded " + costing + " boundary overlay with " +
+                     std::to_string(graph->node_count()) + " nodes");
+          }
+          catch (const std::exception& e) {
+            LOG_WARN("Not using a boundary overlay for " + costing + ": " + e.what());
+          }
+        }
+      }
 
       for (const auto& item : config.get_child("meili.customizable")) {
         trace_customizable.insert(item.second.get_value<std::string>());
@@ -84,18 +165,26 @@ namespace valhalla {
       // select_optimal if not present)
       auto conf_algorithm = config.get<std::string>("thor.source_to_target_algorithm",
                                                           "select_optimal");
-      for (const auto& kv : config.get_child("service_limits")) {
-        if(kv.first == "max_avoid_locations" || kv.first == "max_reachability" || kv.first == "max_radius")
-          continue;
-        if (kv.first != "skadi" && kv.first != "trace" && kv.first != "isochrone") {
-          max_matrix_distance.emplace(kv.first, config.get<float>("service_limits." + kv.first + ".max_matrix_distance"));
-        }
+      matrix_threads = config.get<uint32_t>("thor.matrix_threads", 0);
+      auto cost_matrix_threads = matrix_threads ? matrix_threads :
+                                 std::max(1u, std::thread::hardware_concurrency());
+      for (uint32_t i = 1; i < cost_matrix_threads; ++i) {
+        matrix_readers.emplace_back(new GraphReader(config.get_child("mjolnir")));
       }
+      matrix_hierarchy_limits = config.get<bool>("thor.matrix_hierarchy_limits", false);
+      optimizer_chains = config.get<uint32_t>("thor.optimizer_chains", kDefaultAnnealingChains);
+      raptor_transit = config.get<std::string>("thor.transit_algorithm", "multimodal") == "raptor";
 
       if (conf_algorithm == "timedistancematrix") {
         source_to_target_algorithm = TIME_DISTANCE_MATRIX;
       } else if (conf_algorithm == "costmatrix") {
         source_to_target_algorithm = COST_MATRIX;
+      } else if (conf_algorithm == "bucketmatrix") {
+        source_to_target_algorithm = BUCKET_MATRIX;
+      } else if (conf_algorithm == "sweepmatrix") {
+        source_to_target_algorithm = SWEEP_MATRIX;
+      } else if (conf_algorithm == "overlaymatrix") {
+        source_to_target_algorithm = OVERLAY_MATRIX;
       } else {
         source_to_target_algorithm = SELECT_OPTIMAL;
       }
@@ -103,6 +192,12 @@ namespace valhalla {
 
     thor_worker_t::~thor_worker_t(){}
 
+    thor_worker_t::leg_thread_t::leg_thread_t(const size_t label_arena_size):
+      label_arena(label_arena_size) {
+      astar.set_label_arena(&label_arena);
+      bidir_astar.set_label_arena(&label_arena);
+    }
+
 #ifdef HAVE_HTTP
     worker_t::result_t thor_worker_t::work(const std::list<zmq::message_t>& job, void* request_info, const std::function<void ()>& interrupt_function) {
       //get time for start of request
@@ -115,37 +210,56 @@ namespace valhalla {
         std::string request_str(static_cast<const char*>(job.front().data()), job.front().size());
         std::string serialized_options(static_cast<const char*>(job.back().data()), job.back().size());
         request.parse(request_str, serialized_options);
+        stage_trace_t span("thor", request.options);
 
         // Set the interrupt function
-        service_worker_t::set_interrupt(interrupt_function);
+        service_worker_t::set_interrupt(interrupt_function, request.options.deadline());
+
+        // Turn it away if there is already too much of this kind of work going on
+        auto ticket = admission.admit(request.options);
+        // And stop it should it need too much memory
+        MemoryBudget::Scope budget(memory_budget);
+        // And only compute on it while there is a core for it, giving up the core while waiting on tiles
+        midgard::compute_slots::ScopedSlot slot;
 
         worker_t::result_t result{true};
         double denominator = 0;
+        auto* to_response = request.options.format() == odin::DirectionsOptions::pbf ? to_response_pbf : to_response_json;
         //do request specific processing
         switch (request.options.action()) {
           case odin::DirectionsOptions::sources_to_targets:
-            result = to_response_json(matrix(request), info, request);
+            result = to_response(matrix(request), info, request);
             denominator = request.options.sources_size() + request.options.targets_size();
             break;
           case odin::DirectionsOptions::optimized_route: {
             // Forward the original request
             result.messages.emplace_back(std::move(request_str));
             auto trip_paths = optimized_route(request);
-            result.messages.emplace_back(request.options.SerializeAsString());
+            result.messages.emplace_back(span.forward(request.options));
             for (auto& trippath : trip_paths)
               result.messages.emplace_back(trippath.SerializeAsString());
             denominator = std::max(request.options.sources_size(), request.options.targets_size());
             break;
           }
           case odin::DirectionsOptions::isochrone:
-            result = to_response_json(isochrones(request), info, request);
+            result = request.options.format() == odin::DirectionsOptions::png ?
+              to_response_png(isochrones(request), info, request) : to_response_json(isochrones(request), info, request);
             denominator = request.options.sources_size() * request.options.targets_size();
             break;
           case odin::DirectionsOptions::route: {
+            // Respond straight from the paths if there is nothing for odin to do
+            if (tyr::summaryOnly(request.options)) {
+              std::list<odin::TripPath> alternates;
+              auto trip_paths = route(request, &alternates);
+              auto* to_summary = request.options.format() == odin::DirectionsOptions::gpx ? to_response_xml : to_response_json;
+              result = to_summary(tyr::serializeSummary(request, trip_paths, alternates), info, request);
+              denominator = request.options.locations_size();
+              break;
+            }
             // Forward the original request
             result.messages.emplace_back(std::move(request_str));
             auto trip_paths = route(request);
-            result.messages.emplace_back(request.options.SerializeAsString());
+            result.messages.emplace_back(span.forward(request.options));
             for (const auto& trippath : trip_paths)
               result.messages.emplace_back(trippath.SerializeAsString());
             denominator = request.options.locations_size();
@@ -155,13 +269,13 @@ namespace valhalla {
             // Forward the original request
             result.messages.emplace_back(std::move(request_str));
             auto trip_path = trace_route(request);
-            result.messages.emplace_back(request.options.SerializeAsString());
+            result.messages.emplace_back(span.forward(request.options));
             result.messages.emplace_back(trip_path.SerializeAsString());
             denominator = trace.size() / 1100;
             break;
           }
           case odin::DirectionsOptions::trace_attributes:
-            result = to_response_json(trace_attributes(request), info, request);
+            result = to_response(trace_attributes(request), info, request);
             denominator = trace.size() / 1100;
             break;
           default:
@@ -196,6 +310,9 @@ namespace valhalla {
       auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
       auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
 
+      //compress what this stage sends back to the clients that take it
+      configure_compression(config.get_child("httpd.service"));
+
       //listen for requests
       zmq::context_t context;
       thor_worker_t thor_worker(config);
@@ -209,13 +326,37 @@ namespace valhalla {
 #endif
 
     // Get the costing options if in the config or get the empty default.
-    // Creates the cost in the cost factory
+    // Creates the cost in the cost factory unless a request with the same
+    // options already did, in which case it gets a copy of that one
+    std::string thor_worker_t::get_costing_key(const rapidjson::Document& request,
+                                               const std::string& costing) {
+      // Member order doesn't matter so equal options always have the same key
+      auto costing_options = rapidjson::get_child_optional(request, ("/costing_options/" + costing).c_str());
+      rapidjson::Value no_options;
+      return costing + rapidjson::to_canonical_string(costing_options ? *costing_options : no_options);
+    }
+
     valhalla::sif::cost_ptr_t thor_worker_t::get_costing(const rapidjson::Document& request,
                                           const std::string& costing) {
       auto costing_options = rapidjson::get_child_optional(request, ("/costing_options/" + costing).c_str());
-      if(costing_options)
-        return factory.Create(costing, *costing_options);
-      return factory.Create(costing, boost::property_tree::ptree{});
+      rapidjson::Value no_options;
+      const rapidjson::Value& options = costing_options ? *costing_options : no_options;
+
+      auto key = get_costing_key(request, costing);
+      auto cached = costing_cache.find(key);
+      if (cached != costing_cache.end())
+        return cached->second->Clone();
+
+      // Keep the one we built untouched and hand out a copy, the path
+      // algorithms relax the hierarchy limits of the costing they are given
+      auto cost = factory.Create(costing, options);
+      auto copy = costing_cache_size ? cost->Clone() : nullptr;
+      if (!copy)
+        return cost;
+      if (costing_cache.size() >= costing_cache_size)
+        costing_cache.clear();
+      costing_cache.emplace(key, cost);
+      return copy;
     }
 
     std::string thor_worker_t::parse_costing(const valhalla_request_t& request) {
@@ -232,10 +373,27 @@ namespace valhalla {
         mode_costing[2] = get_costing(request.document, "bicycle");
         mode_costing[3] = get_costing(request.document, "transit");
         mode = valhalla::sif::TravelMode::kPedestrian;
+        ch_path.set_graph(nullptr);
+        astar.set_landmarks(nullptr);
+        bidir_astar.set_landmarks(nullptr);
+        overlay.reset();
       } else {
         valhalla::sif::cost_ptr_t cost = get_costing(request.document, costing);
         mode = cost->travel_mode();
         mode_costing[static_cast<uint32_t>(mode)] = cost;
+
+        // The contraction hierarchy and the landmarks only hold the default costing options
+        auto ch = contraction_hierarchies.find(costing);
+        auto costing_options = rapidjson::get_child_optional(request.document, ("/costing_options/" + costing).c_str());
+        bool default_options = !costing_options || (costing_options->IsObject() && costing_options->ObjectEmpty());
+        ch_path.set_graph(ch != contraction_hierarchies.end() && default_options ? ch->second : nullptr);
+        auto tables = landmarks.find(costing);
+        std::shared_ptr<const Landmarks> used = tables != landmarks.end() && default_options ?
+            tables->second : nullptr;
+        astar.set_landmarks(used);
+        bidir_astar.set_landmarks(used);
+        auto found = overlays.find(costing);
+        overlay = found != overlays.end() && default_options ? found->second : nullptr;
       }
       valhalla::midgard::logging::Log("travel_mode::" + std::to_string(static_cast<uint32_t>(mode)), " [ANALYTICS] ");
       return costing;
@@ -344,15 +502,88 @@ namespace valhalla {
       }
     }
 
+    void thor_worker_t::track_stats(valhalla_request_t& request) {
+      // Counting is off unless the request asked for it
+      search_stats = request.options.stats() ? request.options.mutable_search_stats() : nullptr;
+      astar.set_stats(search_stats);
+      bidir_astar.set_stats(search_stats);
+      multi_modal_astar.set_stats(search_stats);
+      raptor.set_stats(search_stats);
+      if (!search_stats)
+        return;
+
+      // Start from zero for this request
+      search_stats->Clear();
+      search_stats_start = std::chrono::steady_clock::now();
+      reader.reset_tile_counts();
+      for (auto& matrix_reader : matrix_readers)
+        matrix_reader->reset_tile_counts();
+    }
+
+    void thor_worker_t::add_search_time(const std::chrono::steady_clock::time_point& start) {
+      if (search_stats) {
+        auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start);
+        search_stats->set_search_ms(search_stats->search_ms() + elapsed.count());
+      }
+    }
+
+    void thor_worker_t::finish_stats() {
+      if (!search_stats)
+        return;
+
+      // The path algorithms count their labels when they are cleared
+      astar.Clear();
+      bidir_astar.Clear();
+      multi_modal_astar.Clear();
+      raptor.Clear();
+
+      // Map matching keeps its own counts for the life of the matcher
+      if (matcher && !trace.empty()) {
+        const auto& transition_cost_model = matcher->transition_cost_model();
+        search_stats->set_labels(search_stats->labels() + transition_cost_model.labels());
+        search_stats->set_queue_pushes(search_stats->queue_pushes() + transition_cost_model.queue_pushes());
+      }
+
+      // Tiles from all the readers the searches used
+      auto tile_counts = reader.tile_counts();
+      for (const auto& matrix_reader : matrix_readers) {
+        tile_counts.cache_hits += matrix_reader->tile_counts().cache_hits;
+        tile_counts.cache_misses += matrix_reader->tile_counts().cache_misses;
+      }
+      search_stats->set_tile_cache_hits(tile_counts.cache_hits);
+      search_stats->set_tiles_loaded(tile_counts.cache_misses);
+      search_stats->set_total_ms(std::chrono::duration<float, std::milli>(
+          std::chrono::steady_clock::now() - search_stats_start).count());
+    }
+
     void thor_worker_t::cleanup() {
+      search_stats = nullptr;
+      astar.set_stats(nullptr);
+      bidir_astar.set_stats(nullptr);
+      multi_modal_astar.set_stats(nullptr);
+      raptor.set_stats(nullptr);
       astar.Clear();
       bidir_astar.Clear();
       multi_modal_astar.Clear();
+      raptor.Clear();
+      ch_path.Clear();
+      for (auto& leg_thread : leg_threads) {
+        leg_thread->astar.Clear();
+        leg_thread->bidir_astar.Clear();
+        leg_thread->ch_path.Clear();
+        leg_thread->label_arena.Trim();
+        for (auto& cost : leg_thread->mode_costing)
+          cost.reset();
+      }
       trace.clear();
       isochrone_gen.Clear();
+      reverse_isochrone_gen.Clear();
+      label_arena.Trim();
       matcher_factory.ClearFullCache();
       if(reader.OverCommitted())
-        reader.Clear();
+        reader.Trim();
+      reader.RefreshTrafficSpeeds();
+      reader.RefreshTiles();
     }
 
   }
@@ -5,6 +5,7 @@
 #include "odin/worker.h"
 #include "tyr/serializers.h"
 #include "baldr/rapidjson_utils.h"
+#include "midgard/logging.h"
 
 #include <boost/property_tree/json_parser.hpp>
 
@@ -18,12 +19,38 @@ namespace valhalla {
 
     struct actor_t::pimpl_t {
       pimpl_t(const boost::property_tree::ptree& config):
-        loki_worker(config), thor_worker(config), odin_worker(config) {
+        loki_worker(config), thor_worker(config), odin_worker(config),
+        admission(config.get_child("thor.admission", {})),
+        memory_budget(config.get<size_t>("thor.request_memory_budget", 0)),
+        trace_sample_rate(config.get<float>("httpd.service.trace_sample_rate", 0.f)),
+        response_cache(config.get_child("httpd.service", {})) {
       }
-      void set_interrupts(const std::function<void ()>& interrupt_function) {
-        loki_worker.set_interrupt(interrupt_function);
-        thor_worker.set_interrupt(interrupt_function);
-        odin_worker.set_interrupt(interrupt_function);
+      void set_interrupts(const std::function<void ()>& interrupt_function, uint64_t deadline) {
+        loki_worker.set_interrupt(interrupt_function, deadline);
+        thor_worker.set_interrupt(interrupt_function, deadline);
+        odin_worker.set_interrupt(interrupt_function, deadline);
+      }
+      //locates the locations of a request for directions and paths through them
+      std::list<odin::TripPath> legs(valhalla_request_t& request) {
+        switch (request.options.action()) {
+          case odin::DirectionsOptions::route:
+            loki_worker.route(request);
+            return thor_worker.route(request);
+          case odin::DirectionsOptions::optimized_route:
+            loki_worker.matrix(request);
+            return thor_worker.optimized_route(request);
+          case odin::DirectionsOptions::trace_route: {
+            loki_worker.trace(request);
+            //an initializer list would copy the whole path
+            auto path = thor_worker.trace_route(request);
+            std::list<odin::TripPath> legs(1);
+            legs.back().Swap(&path);
+            return legs;
+          }
+          default:
+            //there are no directions for anything else
+            throw valhalla_exception_t{107};
+        }
       }
       void cleanup() {
         loki_worker.cleanup();
@@ -33,6 +60,10 @@ namespace valhalla {
       loki::loki_worker_t loki_worker;
       thor::thor_worker_t thor_worker;
       odin::odin_worker_t odin_worker;
+      admission_t admission;
+      size_t memory_budget;
+      float trace_sample_rate;
+      response_cache_t response_cache;
     };
 
     actor_t::actor_t(const boost::property_tree::ptree& config, bool auto_cleanup): pimpl(new pimpl_t(config)), auto_cleanup(auto_cleanup) {
@@ -42,154 +73,221 @@ namespace valhalla {
       pimpl->cleanup();
     }
 
-    std::string actor_t::route(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
-      //parse the request
-      valhalla_request_t request;
-      request.parse(request_str, odin::DirectionsOptions::route);
-      //check the request and locate the locations in the graph
-      pimpl->loki_worker.route(request);
-      auto legs = pimpl->thor_worker.route(request);
-      //get some directions back from them
-      auto directions = pimpl->odin_worker.narrate(request, legs);
-      //serialize them out to json string
-      auto bytes = tyr::serializeDirections(request, legs, directions);
+    std::string actor_t::act(valhalla_request_t& request, const std::function<void ()>& interrupt) {
+      //set the interrupts, they also throw once the deadline of the request passes
+      pimpl->set_interrupts(interrupt, request.options.deadline());
+      //turn it away if there is already too much of this kind of work going on
+      auto ticket = pimpl->admission.admit(request.options);
+      //and stop it should its searches need too much memory
+      thor::MemoryBudget::Scope budget(pimpl->memory_budget);
+      //each stage hands its results straight to the next
+      std::string bytes;
+      switch (request.options.action()) {
+        case odin::DirectionsOptions::route: {
+          //check the request and locate the locations in the graph
+          pimpl->loki_worker.route(request);
+          //machine clients that only want the time, length and shape skip odin
+          //and can get alternates along with the route
+          std::list<odin::TripPath> alternates;
+          bool summary_only = tyr::summaryOnly(request.options);
+          auto legs = pimpl->thor_worker.route(request, summary_only ? &alternates : nullptr);
+          if (summary_only) {
+            bytes = tyr::serializeSummary(request, legs, alternates);
+            break;
+          }
+          //get some directions back from them and serialize them
+          auto directions = pimpl->odin_worker.narrate(request, legs);
+          bytes = tyr::serializeDirections(request, legs, directions);
+          break;
+        }
+        case odin::DirectionsOptions::locate:
+          //check the request and locate the locations in the graph
+          bytes = pimpl->loki_worker.locate(request);
+          break;
+        case odin::DirectionsOptions::sources_to_targets:
+          //check the request and locate the locations in the graph
+          pimpl->loki_worker.matrix(request);
+          //compute the matrix
+          bytes = pimpl->thor_worker.matrix(request);
+          break;
+        case odin::DirectionsOptions::optimized_route: {
+          //locate the locations, compute all pairs and then the shortest path through them all
+          auto legs = pimpl->legs(request);
+          //get some directions back from them and serialize them
+          auto directions = pimpl->odin_worker.narrate(request, legs);
+          bytes = tyr::serializeDirections(request, legs, directions);
+          break;
+        }
+        case odin::DirectionsOptions::isochrone:
+          //check the request and locate the locations in the graph
+          pimpl->loki_worker.isochrones(request);
+          //compute the isochrones
+          bytes = pimpl->thor_worker.isochrones(request);
+          break;
+        case odin::DirectionsOptions::trace_route: {
+          //locate the shape and route between the locations in the graph to find the best path
+          auto legs = pimpl->legs(request);
+          //get some directions back from them and serialize them
+          auto directions = pimpl->odin_worker.narrate(request, legs);
+          bytes = tyr::serializeDirections(request, legs, directions);
+          break;
+        }
+        case odin::DirectionsOptions::trace_attributes:
+          //check the request and locate the locations in the graph
+          pimpl->loki_worker.trace(request);
+          //get the path and turn it into attribution along it
+          bytes = pimpl->thor_worker.trace_attributes(request);
+          break;
+        case odin::DirectionsOptions::height:
+          //get the height at each point
+          bytes = pimpl->loki_worker.height(request);
+          break;
+        case odin::DirectionsOptions::transit_available:
+          //check the request and locate the locations in the graph
+          bytes = pimpl->loki_worker.transit_available(request);
+          break;
+        default:
+          //apparently you wanted something that we figured we'd support but havent written yet
+          throw valhalla_exception_t{107};
+      }
       //if they want you do to do the cleanup automatically
       if(auto_cleanup)
         cleanup();
       return bytes;
     }
 
+    std::list<odin::TripDirections> actor_t::directions(valhalla_request_t& request, std::list<odin::TripPath>& legs,
+        const std::function<void ()>& interrupt) {
+      //same as above but without serializing anything at the end
+      pimpl->set_interrupts(interrupt, request.options.deadline());
+      auto ticket = pimpl->admission.admit(request.options);
+      legs = pimpl->legs(request);
+      auto directions = pimpl->odin_worker.narrate(request, legs);
+      if(auto_cleanup)
+        cleanup();
+      return directions;
+    }
+
+    std::string actor_t::route(const std::string& request_str, const std::function<void ()>& interrupt) {
+      //parse the request
+      valhalla_request_t request;
+      request.parse(request_str, odin::DirectionsOptions::route);
+      return act(request, interrupt);
+    }
+
     std::string actor_t::locate(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::locate);
-      //check the request and locate the locations in the graph
-      auto json = pimpl->loki_worker.locate(request);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return json;
+      return act(request, interrupt);
     }
 
     std::string actor_t::matrix(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::sources_to_targets);
-      //check the request and locate the locations in the graph
-      pimpl->loki_worker.matrix(request);
-      //compute the matrix
-      auto json = pimpl->thor_worker.matrix(request);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return json;
+      return act(request, interrupt);
     }
 
     std::string actor_t::optimized_route(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::optimized_route);
-      //check the request and locate the locations in the graph
-      pimpl->loki_worker.matrix(request);
-      //compute compute all pairs and then the shortest path through them all
-      auto legs = pimpl->thor_worker.optimized_route(request);
-      //get some directions back from them
-      auto directions = pimpl->odin_worker.narrate(request, legs);
-      //serialize them out to json string
-      auto bytes = tyr::serializeDirections(request, legs, directions);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return bytes;
+      return act(request, interrupt);
     }
 
     std::string actor_t::isochrone(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::isochrone);
-      //check the request and locate the locations in the graph
-      pimpl->loki_worker.isochrones(request);
-      //compute the isochrones
-      auto json = pimpl->thor_worker.isochrones(request);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return json;
+      return act(request, interrupt);
     }
 
     std::string actor_t::trace_route(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::trace_route);
-      //check the request and locate the locations in the graph
-      pimpl->loki_worker.trace(request);
-      //route between the locations in the graph to find the best path
-      std::list<TripPath> legs{pimpl->thor_worker.trace_route(request)};
-      //get some directions back from them
-      auto directions = pimpl->odin_worker.narrate(request, legs);
-      //serialize them out to json string
-      auto bytes = tyr::serializeDirections(request, legs, directions);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return bytes;
+      return act(request, interrupt);
     }
 
     std::string actor_t::trace_attributes(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::trace_attributes);
-      //check the request and locate the locations in the graph
-      pimpl->loki_worker.trace(request);
-      //get the path and turn it into attribution along it
-      auto json = pimpl->thor_worker.trace_attributes(request);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return json;
+      return act(request, interrupt);
     }
 
     std::string actor_t::height(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::height);
-      //get the height at each point
-      auto json = pimpl->loki_worker.height(request);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return json;
+      return act(request, interrupt);
     }
 
     std::string actor_t::transit_available(const std::string& request_str, const std::function<void ()>& interrupt) {
-      //set the interrupts
-      pimpl->set_interrupts(interrupt);
       //parse the request
       valhalla_request_t request;
       request.parse(request_str, odin::DirectionsOptions::transit_available);
-      //check the request and locate the locations in the graph
-      auto json = pimpl->loki_worker.transit_available(request);
-      //if they want you do to do the cleanup automatically
-      if(auto_cleanup)
-        cleanup();
-      return json;
-   }
+      return act(request, interrupt);
+    }
+
+#ifdef HAVE_HTTP
+    worker_t::result_t actor_t::work(const std::list<zmq::message_t>& job, void* request_info, const std::function<void ()>& interrupt) {
+      auto& info = *static_cast<http_request_info_t*>(request_info);
+      LOG_INFO("Got Request " + std::to_string(info.id));
+      valhalla_request_t request;
+      try {
+        //request parsing
+        auto http_request = http_request_t::from_string(static_cast<const char*>(job.front().data()), job.front().size());
+        if(http_request.path == "/metrics")
+          return to_response_metrics(info);
+        request.parse(http_request);
+        stage_trace_t span("valhalla", request.options, pimpl->trace_sample_rate);
+
+        //check there is a valid action
+        if(!request.options.has_action())
+          return jsonify_error({106}, info, request);
+
+        //enforce some limits and run it through every stage here, unless an identical request just did
+        pimpl->loki_worker.limits(request);
+        auto bytes = pimpl->response_cache.get(request, pimpl->loki_worker.tile_version(),
+          [this, &request, &interrupt]() { return act(request, interrupt); });
+        auto directions = request.options.action() == odin::DirectionsOptions::route ||
+                          request.options.action() == odin::DirectionsOptions::optimized_route ||
+                          request.options.action() == odin::DirectionsOptions::trace_route;
+        auto* to_response = directions && request.options.format() == odin::DirectionsOptions::gpx ? to_response_xml :
+                            (request.options.format() == odin::DirectionsOptions::pbf ? to_response_pbf : to_response_json);
+        return to_response(bytes, info, request);
+      }
+      catch(const valhalla_exception_t& e) {
+        valhalla::midgard::logging::Log("400::" + std::string(e.what()), " [ANALYTICS] ");
+        return jsonify_error(e, info, request);
+      }
+      catch(const std::exception& e) {
+        valhalla::midgard::logging::Log("400::" + std::string(e.what()), " [ANALYTICS] ");
+        return jsonify_error({199, std::string(e.what())}, info, request);
+      }
+    }
+
+    void run_service(const boost::property_tree::ptree& config) {
+      //gets requests from the http server
+      auto upstream_endpoint = config.get<std::string>("loki.service.proxy") + "_out";
+      //and sends every response straight back to it
+      auto loopback_endpoint = config.get<std::string>("httpd.service.loopback");
+      auto interrupt_endpoint = config.get<std::string>("httpd.service.interrupt");
+
+      //compress what this stage sends back to the clients that take it
+      configure_compression(config.get_child("httpd.service"));
+
+      //listen for requests, there is no next stage to forward to
+      zmq::context_t context;
+      actor_t actor(config);
+      prime_server::worker_t worker(context, upstream_endpoint, "ipc:///dev/null", loopback_endpoint, interrupt_endpoint,
+        std::bind(&actor_t::work, std::ref(actor), std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+        std::bind(&actor_t::cleanup, std::ref(actor)));
+      worker.work();
+    }
+#endif
 
   }
 }
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <sstream>
 
 #include "baldr/json.h"
@@ -40,6 +41,31 @@ namespace {
     return array;
   }
 
+  //polyline style encoding of whole meters, each is the zig zag varint of its difference
+  //from the one before written in 5 bit chunks offset by 63. postings without data keep
+  //the no data value. with ranges each range comes right before its height
+  std::string encode_heights(const std::vector<float>& ranges, const std::vector<double>& heights) {
+    std::string encoded;
+    encoded.reserve(heights.size() * (ranges.empty() ? 2 : 5));
+    auto serialize = [&encoded](int64_t number, int64_t& last) {
+      int64_t delta = number - last;
+      last = number;
+      uint64_t bits = delta < 0 ? ~(static_cast<uint64_t>(delta) << 1) : static_cast<uint64_t>(delta) << 1;
+      while (bits >= 0x20) {
+        encoded.push_back(static_cast<char>((0x20 | (bits & 0x1f)) + 63));
+        bits >>= 5;
+      }
+      encoded.push_back(static_cast<char>(bits + 63));
+    };
+    int64_t last_range = 0, last_height = 0;
+    for (size_t i = 0; i < heights.size(); ++i) {
+      if (!ranges.empty())
+        serialize(std::llround(ranges[i]), last_range);
+      serialize(std::llround(heights[i]), last_height);
+    }
+    return encoded;
+  }
+
   json::ArrayPtr serialize_shape(const google::protobuf::RepeatedPtrField<odin::Location>& shape) {
     auto array = json::array({});
     for(const auto& p : shape) {
@@ -66,8 +92,13 @@ namespace valhalla {
         const std::vector<double>& heights, std::vector<float> ranges) {
       auto json = json::map({});
 
-      //get the distances between the postings
-      if (ranges.size()) {
+      //compactly
+      if (request.options.encoded_heights()) {
+        json = json::map({
+          {ranges.size() ? "encoded_range_height" : "encoded_height", encode_heights(ranges, heights)}
+        });
+      }//get the distances between the postings
+      else if (ranges.size()) {
         json = json::map({
           {"range_height", serialize_range_height(ranges, heights, skadi::sample::get_no_data_value())}
         });
@@ -89,5 +120,49 @@ namespace valhalla {
       ss << *json;
       return ss.str();
     }
+
+    std::string serializeHeightBatch(const valhalla_request_t& request, const std::vector<std::string>& shapes,
+        const std::vector<std::vector<double> >& heights, const std::vector<std::vector<float> >& ranges) {
+      //large batches would make for a lot of little json objects so we write it out as we go
+      std::stringstream ss;
+      json::OstreamVisitor string(ss);
+      auto no_data_value = skadi::sample::get_no_data_value();
+      ss << "{\"heights\":[";
+      for (size_t s = 0; s < shapes.size(); ++s) {
+        if (s > 0)
+          ss << ',';
+        ss << "{\"encoded_polyline\":";
+        string(shapes[s]);
+        const auto& range = ranges[s];
+        if (request.options.encoded_heights()) {
+          ss << (range.empty() ? ",\"encoded_height\":" : ",\"encoded_range_height\":");
+          string(encode_heights(range, heights[s]));
+        }
+        else {
+          ss << (range.empty() ? ",\"height\":[" : ",\"range_height\":[");
+          for (size_t i = 0; i < heights[s].size(); ++i) {
+            if (i > 0)
+              ss << ',';
+            if (!range.empty())
+              ss << '[' << json::fp_t{range[i], 0} << ',';
+            if (heights[s][i] == no_data_value)
+              ss << "null";
+            else
+              ss << json::fp_t{heights[s][i], 0};
+            if (!range.empty())
+              ss << ']';
+          }
+          ss << ']';
+        }
+        ss << '}';
+      }
+      ss << ']';
+      if (request.options.has_id()) {
+        ss << ",\"id\":";
+        string(request.options.id());
+      }
+      ss << '}';
+      return ss.str();
+    }
   }
 }
@@ -7,12 +7,135 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 #include <utility>
+#include <zlib.h>
 
 using namespace valhalla::baldr::json;
 
 namespace {
   using rgba_t = std::tuple<float,float,float>;
+
+  //add the features of each contour interval, with some more properties if
+  //they need telling apart from other contours of the collection
+  template <class coord_t>
+  void add_features(const ArrayPtr& features,
+                    const typename valhalla::midgard::GriddedData<coord_t>::contours_t& grid_contours,
+                    bool polygons, const std::unordered_map<float, std::string>& colors,
+                    const MapPtr& marks = nullptr) {
+    //for each contour interval
+    int i = 0;
+    for(const auto& interval : grid_contours) {
+      auto color_itr = colors.find(interval.first);
+      //color was supplied
+      std::stringstream hex;
+      if(color_itr != colors.end() && !color_itr->second.empty()) {
+        hex << "#" << color_itr->second;
+      }//or we computed it..
+      else {
+        auto h = i * (150.f / grid_contours.size());
+        auto c = .5f;
+        auto x = c * (1 - std::abs(std::fmod(h/60.f, 2.f) - 1));
+        auto m = .25f;
+        rgba_t color = h < 60 ? rgba_t{m + c, m + x, m} : (h < 120 ? rgba_t{m + x, m + c, m} : rgba_t{m, m + c, m + x});
+        hex << "#" << std::hex << static_cast<int>(std::get<0>(color)*255 + .5f) <<
+                      std::hex << static_cast<int>(std::get<1>(color)*255 + .5f) <<
+                      std::hex << static_cast<int>(std::get<2>(color)*255 + .5f);
+      }
+      ++i;
+
+      //for each feature on that interval
+      for(const auto& feature : interval.second) {
+        //for each contour in that feature
+        auto geom = array({});
+        for(const auto& contour : feature) {
+          //make some geometry
+          auto coords = array({});
+          for(const auto& coord : contour)
+            coords->push_back(array({fp_t{coord.first, 6}, fp_t{coord.second, 6}}));
+          //its either a ring
+          if(polygons)
+            geom->emplace_back(coords);
+          //or a single line, if someone has more than one contour per feature they messed up
+          else
+            geom = coords;
+        }
+        auto properties = map({
+          {"contour", static_cast<uint64_t>(interval.first)},
+          { "color", hex.str()}, //lines
+          { "fill", hex.str()}, //geojson.io polys
+          { "fillColor", hex.str()}, //leaflet polys
+          { "opacity", fp_t{.33f, 2}}, //lines
+          { "fill-opacity", fp_t{.33f, 2}}, //geojson.io polys
+          { "fillOpacity", fp_t{.33f, 2}}, //leaflet polys
+        });
+        if(marks)
+          properties->insert(marks->cbegin(), marks->cend());
+        //add a feature
+        features->emplace_back(
+            map({
+            {"type", std::string("Feature")},
+            {"geometry", map({
+              {"type", std::string(polygons ? "Polygon" : "LineString")},
+              {"coordinates", geom},
+            })},
+            {"properties", properties},
+          })
+        );
+      }
+    }
+  }
+
+  //append a png chunk, its length and crc are big endian
+  void add_chunk(std::string& png, const char* type, const std::string& data) {
+    auto put32 = [&png](uint32_t value) {
+      for(int shift = 24; shift >= 0; shift -= 8)
+        png.push_back(static_cast<char>((value >> shift) & 0xff));
+    };
+    put32(data.size());
+    auto start = png.size();
+    png.append(type, 4);
+    png.append(data);
+    put32(crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(png.data() + start), png.size() - start));
+  }
+
+  //add the locations if asked for and wrap the features up as a collection
+  std::string serialize_collection(const valhalla::valhalla_request_t& request, const ArrayPtr& features,
+                                   bool show_locations) {
+    // Add original locations to the geojson
+    if(show_locations) {
+      for (const auto& location : request.options.locations()) {
+        features->emplace_back(
+            map({
+            {"type", std::string("Feature")},
+            {"properties", map({})},
+            {"geometry", map({
+              {"type", std::string("Point")},
+              {"coordinates", array({
+                fp_t{location.ll().lng(), 6},
+                fp_t{location.ll().lat(), 6}
+              })}
+            })}
+          })
+        );
+      }
+    }
+    //make the collection
+    auto feature_collection = map({
+      {"type", std::string("FeatureCollection")},
+      {"features", features},
+    });
+
+    if(request.options.has_id())
+      feature_collection->emplace("id", request.options.id());
+    if(request.options.stats())
+      feature_collection->emplace("stats", valhalla::tyr::serializeSearchStats(request.options.search_stats()));
+
+    std::stringstream ss;
+    ss << *feature_collection;
+    return ss.str();
+  }
 }
 
 namespace valhalla {
@@ -23,103 +146,89 @@ template <class coord_t>
 std::string serializeIsochrones(const valhalla_request_t& request,
                   const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
                   bool polygons, const std::unordered_map<float, std::string>& colors,
-                  bool show_locations) {
-  //for each contour interval
-  int i = 0;
+                  bool show_locations,
+                  const typename midgard::GriddedData<coord_t>::contours_t* reverse_contours) {
   auto features = array({});
-  for(const auto& interval : grid_contours) {
-    auto color_itr = colors.find(interval.first);
-    //color was supplied
-    std::stringstream hex;
-    if(color_itr != colors.end() && !color_itr->second.empty()) {
-      hex << "#" << color_itr->second;
-    }//or we computed it..
-    else {
-      auto h = i * (150.f / grid_contours.size());
-      auto c = .5f;
-      auto x = c * (1 - std::abs(std::fmod(h/60.f, 2.f) - 1));
-      auto m = .25f;
-      rgba_t color = h < 60 ? rgba_t{m + c, m + x, m} : (h < 120 ? rgba_t{m + x, m + c, m} : rgba_t{m, m + c, m + x});
-      hex << "#" << std::hex << static_cast<int>(std::get<0>(color)*255 + .5f) <<
-                    std::hex << static_cast<int>(std::get<1>(color)*255 + .5f) <<
-                    std::hex << static_cast<int>(std::get<2>(color)*255 + .5f);
-    }
-    ++i;
-
-    //for each feature on that interval
-    for(const auto& feature : interval.second) {
-      //for each contour in that feature
-      auto geom = array({});
-      for(const auto& contour : feature) {
-        //make some geometry
-        auto coords = array({});
-        for(const auto& coord : contour)
-          coords->push_back(array({fp_t{coord.first, 6}, fp_t{coord.second, 6}}));
-        //its either a ring
-        if(polygons)
-          geom->emplace_back(coords);
-        //or a single line, if someone has more than one contour per feature they messed up
-        else
-          geom = coords;
-      }
-      //add a feature
-      features->emplace_back(
-          map({
-          {"type", std::string("Feature")},
-          {"geometry", map({
-            {"type", std::string(polygons ? "Polygon" : "LineString")},
-            {"coordinates", geom},
-          })},
-          {"properties", map({
-            {"contour", static_cast<uint64_t>(interval.first)},
-            { "color", hex.str()}, //lines
-            { "fill", hex.str()}, //geojson.io polys
-            { "fillColor", hex.str()}, //leaflet polys
-            { "opacity", fp_t{.33f, 2}}, //lines
-            { "fill-opacity", fp_t{.33f, 2}}, //geojson.io polys
-            { "fillOpacity", fp_t{.33f, 2}}, //leaflet polys
-          })},
-        })
-      );
-    }
+  if(reverse_contours) {
+    add_features<coord_t>(features, grid_contours, polygons, colors, map({{"direction", std::string("forward")}}));
+    add_features<coord_t>(features, *reverse_contours, polygons, colors, map({{"direction", std::string("reverse")}}));
   }
-  // Add original locations to the geojson
-  if(show_locations) {
-    for (const auto& location : request.options.locations()) {
-      features->emplace_back(
-          map({
-          {"type", std::string("Feature")},
-          {"properties", map({})},
-          {"geometry", map({
-            {"type", std::string("Point")},
-            {"coordinates", array({
-              fp_t{location.ll().lng(), 6},
-              fp_t{location.ll().lat(), 6}
-            })}
-          })}
-        })
-      );
+  else {
+    add_features<coord_t>(features, grid_contours, polygons, colors);
+  }
+  return serialize_collection(request, features, show_locations);
+}
+
+template <class coord_t>
+std::string serializeCatchments(const valhalla_request_t& request,
+                  const std::vector<typename midgard::GriddedData<coord_t>::contours_t>& origin_contours,
+                  bool polygons, const std::unordered_map<float, std::string>& colors,
+                  bool show_locations) {
+  auto features = array({});
+  for(size_t i = 0; i < origin_contours.size(); ++i)
+    add_features<coord_t>(features, origin_contours[i], polygons, colors, map({{"origin", static_cast<uint64_t>(i)}}));
+  return serialize_collection(request, features, show_locations);
+}
+
+template <class coord_t>
+std::string serializeIsochroneRaster(const midgard::GriddedData<coord_t>& grid, const float max_minutes) {
+  //a row of 16 bit samples, big endian, after the filter type of the row. The first
+  //row is the northernmost, the last row of the grid
+  std::string rows;
+  auto width = grid.ncolumns(), height = grid.nrows();
+  rows.reserve((1 + width * 2) * height);
+  for(int32_t row = height - 1; row >= 0; --row) {
+    rows.push_back(0);
+    for(int32_t col = 0; col < width; ++col) {
+      auto minutes = grid.Value(grid.TileId(col, row));
+      uint16_t seconds = minutes < max_minutes ?
+        static_cast<uint16_t>(std::min(std::round(minutes * 60.f), 65534.f)) : 65535;
+      rows.push_back(static_cast<char>(seconds >> 8));
+      rows.push_back(static_cast<char>(seconds & 0xff));
     }
   }
-  //make the collection
-  auto feature_collection = map({
-    {"type", std::string("FeatureCollection")},
-    {"features", features},
-  });
-
-  if(request.options.has_id())
-    feature_collection->emplace("id", request.options.id());
-
-  std::stringstream ss;
-  ss << *feature_collection;
-  return ss.str();
+  uLongf size = compressBound(rows.size());
+  std::string idat(size, '\0');
+  if(compress2(reinterpret_cast<Bytef*>(&idat[0]), &size, reinterpret_cast<const Bytef*>(rows.data()),
+               rows.size(), Z_BEST_SPEED) != Z_OK)
+    throw std::runtime_error("Failed to compress the isochrone raster");
+  idat.resize(size);
+
+  //16 bit grayscale without interlacing
+  std::string ihdr;
+  for(uint32_t value : {static_cast<uint32_t>(width), static_cast<uint32_t>(height)})
+    for(int shift = 24; shift >= 0; shift -= 8)
+      ihdr.push_back(static_cast<char>((value >> shift) & 0xff));
+  ihdr.append({16, 0, 0, 0, 0});
+
+  //where the raster is and what its samples mean, the grid has no other way to say it
+  auto bounds = grid.TileBounds();
+  std::stringstream text;
+  text << std::setprecision(9) << bounds.minx() << ',' << bounds.miny() << ','
+       << bounds.minx() + width * grid.TileSize() << ',' << bounds.miny() + height * grid.TileSize();
+
+  std::string png("\x89PNG\r\n\x1a\n", 8);
+  add_chunk(png, "IHDR", ihdr);
+  add_chunk(png, "tEXt", std::string("bounds") + '\0' + text.str());
+  add_chunk(png, "tEXt", std::string("units") + '\0' + "seconds, 65535 where not reached");
+  add_chunk(png, "IDAT", idat);
+  add_chunk(png, "IEND", "");
+  return png;
 }
 
 template std::string serializeIsochrones<midgard::Point2>(const valhalla_request_t&,
                                             const midgard::GriddedData<midgard::Point2>::contours_t&, bool,
-                                            const std::unordered_map<float, std::string>&, bool);
+                                            const std::unordered_map<float, std::string>&, bool,
+                                            const midgard::GriddedData<midgard::Point2>::contours_t*);
 template std::string serializeIsochrones<midgard::PointLL>(const valhalla_request_t&,
                                              const midgard::GriddedData<midgard::PointLL>::contours_t&, bool,
+                                             const std::unordered_map<float, std::string>&, bool,
+                                             const midgard::GriddedData<midgard::PointLL>::contours_t*);
+
+template std::string serializeIsochroneRaster<midgard::PointLL>(const midgard::GriddedData<midgard::PointLL>&,
+                                                  const float);
+template std::string serializeCatchments<midgard::PointLL>(const valhalla_request_t&,
+                                             const std::vector<midgard::GriddedData<midgard::PointLL>::contours_t>&, bool,
                                              const std::unordered_map<float, std::string>&, bool);
 
 }
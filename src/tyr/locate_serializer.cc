@@ -6,8 +6,14 @@ using namespace valhalla;
 using namespace valhalla::baldr;
 
 namespace {
+  std::string side_of_street(const PathLocation::SideOfStreet sos) {
+    return sos == PathLocation::LEFT ? std::string("left") :
+      (sos == PathLocation::RIGHT ? std::string("right") : std::string("neither"));
+  }
+
   json::ArrayPtr serialize_edges(const PathLocation& location, GraphReader& reader, bool verbose) {
     auto array = json::array({});
+    std::vector<baldr::TrafficSegment> segments;
     for(const auto& edge : location.edges) {
       try {
         //get the osm way id
@@ -16,17 +22,14 @@ namespace {
         auto edge_info = tile->edgeinfo(directed_edge->edgeinfo_offset());
         //they want MOAR!
         if(verbose) {
-          auto segments = tile->GetTrafficSegments(edge.id);
+          tile->GetTrafficSegments(edge.id, segments);
           auto segments_array = json::array({});
           for(const auto& segment : segments)
             segments_array->emplace_back(segment.json());
           array->emplace_back(json::map({
             {"correlated_lat", json::fp_t{edge.projected.lat(), 6}},
             {"correlated_lon", json::fp_t{edge.projected.lng(), 6}},
-            {"side_of_street",
-              edge.sos == PathLocation::LEFT ? std::string("left") :
-                (edge.sos == PathLocation::RIGHT ? std::string("right") : std::string("neither"))
-            },
+            {"side_of_street", side_of_street(edge.sos)},
             {"percent_along", json::fp_t{edge.percent_along, 5} },
             {"distance", json::fp_t{edge.distance, 1}},
             {"minimum_reachability", static_cast<int64_t>(edge.minimum_reachability)},
@@ -42,10 +45,7 @@ namespace {
               {"way_id", edge_info.wayid()},
               {"correlated_lat", json::fp_t{edge.projected.lat(), 6}},
               {"correlated_lon", json::fp_t{edge.projected.lng(), 6}},
-              {"side_of_street",
-                edge.sos == PathLocation::LEFT ? std::string("left") :
-                  (edge.sos == PathLocation::RIGHT ? std::string("right") : std::string("neither"))
-              },
+              {"side_of_street", side_of_street(edge.sos)},
               {"percent_along", json::fp_t{edge.percent_along, 5} },
             })
           );
@@ -113,6 +113,56 @@ namespace {
 
     return m;
   }
+
+  // Serialize the candidate edges of every location as flat arrays, one entry per edge with
+  // the index of its location. Nothing comes from the tiles so large batches of locations
+  // cost little more than the search itself.
+  std::string serialize_columns(const valhalla_request_t& request, const std::vector<Location>& locations,
+      const std::unordered_map<Location, PathLocation>& projections) {
+    std::vector<std::pair<uint64_t, const PathLocation::PathEdge*> > edges;
+    std::vector<uint64_t> unfound;
+    for(size_t i = 0; i < locations.size(); ++i) {
+      auto projection = projections.find(locations[i]);
+      if(projection == projections.cend() || projection->second.edges.empty()) {
+        unfound.push_back(i);
+        continue;
+      }
+      for(const auto& edge : projection->second.edges)
+        edges.emplace_back(i, &edge);
+    }
+
+    std::string json;
+    json::Writer writer(json);
+    writer.start_object();
+    writer.start_array("location_index");
+    for(const auto& edge : edges)
+      writer(edge.first);
+    writer.end_array();
+    writer.start_array("edge_id");
+    for(const auto& edge : edges)
+      writer(static_cast<uint64_t>(edge.second->id.value));
+    writer.end_array();
+    writer.start_array("percent_along");
+    for(const auto& edge : edges)
+      writer(json::fp_t{edge.second->percent_along, 5});
+    writer.end_array();
+    writer.start_array("side_of_street");
+    for(const auto& edge : edges)
+      writer(side_of_street(edge.second->sos));
+    writer.end_array();
+    writer.start_array("distance");
+    for(const auto& edge : edges)
+      writer(json::fp_t{edge.second->distance, 1});
+    writer.end_array();
+    writer.start_array("unfound");
+    for(auto index : unfound)
+      writer(index);
+    writer.end_array();
+    if (request.options.has_id())
+      writer("id", request.options.id());
+    writer.end_object();
+    return json;
+  }
 }
 
 namespace valhalla {
@@ -120,6 +170,9 @@ namespace valhalla {
 
     std::string serializeLocate(const valhalla_request_t& request, const std::vector<Location>& locations,
         const std::unordered_map<Location, PathLocation>& projections, GraphReader& reader) {
+      if(request.options.columnar())
+        return serialize_columns(request, locations, projections);
+
       auto json = json::array({});
       for(const auto& location : locations) {
         try {
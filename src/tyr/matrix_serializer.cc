@@ -3,6 +3,7 @@
 #include "baldr/json.h"
 #include "thor/costmatrix.h"
 #include "tyr/serializers.h"
+#include "proto/response.pb.h"
 
 using namespace valhalla;
 using namespace valhalla::midgard;
@@ -12,53 +13,52 @@ using namespace valhalla::thor;
 
 namespace osrm_serializers {
 
-  json::ArrayPtr serialize_duration(const std::vector<TimeDistance>& tds, size_t start_td, const size_t td_count) {
-    auto time = json::array({});
+  void serialize_duration(json::Writer& writer, const std::vector<TimeDistance>& tds, size_t start_td, const size_t td_count) {
+    writer.start_array();
     for(size_t i = start_td; i < start_td + td_count; ++i) {
      //check to make sure a route was found; if not, return null for time in matrix result
      if (tds[i].time != kMaxCost) {
-       time->emplace_back(static_cast<uint64_t>(tds[i].time));
+       writer(static_cast<uint64_t>(tds[i].time));
      } else {
-       time->emplace_back(static_cast<std::nullptr_t>(nullptr));
+       writer(nullptr);
      }
     }
-    return time;
+    writer.end_array();
   }
 
-  json::ArrayPtr serialize_distance(const std::vector<TimeDistance>& tds,
+  void serialize_distance(json::Writer& writer, const std::vector<TimeDistance>& tds,
      size_t start_td, const size_t td_count, const size_t source_index, const size_t target_index, double distance_scale) {
-    auto distance = json::array({});
+    writer.start_array();
     for(size_t i = start_td; i < start_td + td_count; ++i) {
       //check to make sure a route was found; if not, return null for distance in matrix result
       if (tds[i].time != kMaxCost) {
-        distance->emplace_back(json::fp_t{tds[i].dist * distance_scale, 3});
+        writer(json::fp_t{tds[i].dist * distance_scale, 3});
       } else {
-        distance->emplace_back(static_cast<std::nullptr_t>(nullptr));
+        writer(nullptr);
       }
     }
-    return distance;
+    writer.end_array();
    }
 
   // Serialize route response in OSRM compatible format.
-  json::MapPtr serialize(const valhalla_request_t& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
-    auto json = json::map({});
-    auto time = json::array({});
-    auto distance = json::array({});
-
+  void serialize(json::Writer& writer, const valhalla_request_t& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
     // If here then the matrix succeeded. Set status code to OK and serialize
     // waypoints (locations).
-    json->emplace("code", std::string("Ok"));
-    json->emplace("sources", osrm::waypoints(request.options.sources()));
-    json->emplace("destinations", osrm::waypoints(request.options.targets()));
-
-    for(size_t source_index = 0; source_index < request.options.sources_size(); ++source_index) {
-      time->emplace_back(serialize_duration(time_distances, source_index * request.options.targets_size(), request.options.targets_size()));
-      distance->emplace_back(serialize_distance(time_distances, source_index * request.options.targets_size(), request.options.targets_size(),
-          source_index, 0, distance_scale));
-    }
-    json->emplace("durations", time);
-    json->emplace("distances", distance);
-    return json;
+    writer.start_object();
+    writer("code", std::string("Ok"));
+    writer("sources", osrm::waypoints(request.options.sources()));
+    writer("destinations", osrm::waypoints(request.options.targets()));
+
+    writer.start_array("durations");
+    for(size_t source_index = 0; source_index < request.options.sources_size(); ++source_index)
+      serialize_duration(writer, time_distances, source_index * request.options.targets_size(), request.options.targets_size());
+    writer.end_array();
+    writer.start_array("distances");
+    for(size_t source_index = 0; source_index < request.options.sources_size(); ++source_index)
+      serialize_distance(writer, time_distances, source_index * request.options.targets_size(), request.options.targets_size(),
+          source_index, 0, distance_scale);
+    writer.end_array();
+    writer.end_object();
   }
 }
 
@@ -69,60 +69,138 @@ namespace valhalla_serializers {
 
   */
 
-json::ArrayPtr locations(const google::protobuf::RepeatedPtrField<odin::Location>& correlated) {
-    auto input_locs = json::array({});
+  void locations(json::Writer& writer, const google::protobuf::RepeatedPtrField<odin::Location>& correlated) {
+    writer.start_array();
     for(size_t i = 0; i < correlated.size(); i++) {
-      input_locs->emplace_back(
-        json::map({
-          {"lat", json::fp_t{correlated.Get(i).ll().lat(), 6}},
-          {"lon", json::fp_t{correlated.Get(i).ll().lng(), 6}}
-        })
-      );
+      writer.start_object();
+      writer("lat", json::fp_t{correlated.Get(i).ll().lat(), 6});
+      writer("lon", json::fp_t{correlated.Get(i).ll().lng(), 6});
+      writer.end_object();
     }
-    return input_locs;
+    writer.end_array();
   }
 
-  json::ArrayPtr serialize_row(const std::vector<TimeDistance>& tds,
+  void serialize_row(json::Writer& writer, const std::vector<TimeDistance>& tds,
       size_t start_td, const size_t td_count, const size_t source_index, const size_t target_index, double distance_scale) {
-    auto row = json::array({});
+    writer.start_array();
     for(size_t i = start_td; i < start_td + td_count; ++i) {
       //check to make sure a route was found; if not, return null for distance & time in matrix result
+      writer.start_object();
+      writer("from_index", static_cast<uint64_t>(source_index));
+      writer("to_index", static_cast<uint64_t>(target_index + (i - start_td)));
       if (tds[i].time != kMaxCost) {
-        row->emplace_back(json::map({
-          {"from_index", static_cast<uint64_t>(source_index)},
-          {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-          {"time", static_cast<uint64_t>(tds[i].time)},
-          {"distance", json::fp_t{tds[i].dist * distance_scale, 3}}
-        }));
+        writer("time", static_cast<uint64_t>(tds[i].time));
+        writer("distance", json::fp_t{tds[i].dist * distance_scale, 3});
       } else {
-        row->emplace_back(json::map({
-          {"from_index", static_cast<uint64_t>(source_index)},
-          {"to_index", static_cast<uint64_t>(target_index + (i - start_td))},
-          {"time", static_cast<std::nullptr_t>(nullptr)},
-          {"distance", static_cast<std::nullptr_t>(nullptr)}
-        }));
+        writer("time", nullptr);
+        writer("distance", nullptr);
       }
+      writer.end_object();
     }
-    return row;
+    writer.end_array();
   }
 
-  json::MapPtr serialize(const valhalla_request_t& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
-    json::ArrayPtr matrix = json::array({});
-    for(size_t source_index = 0; source_index < request.options.sources_size(); ++source_index) {
-        matrix->emplace_back(
-          serialize_row(time_distances, source_index * request.options.targets_size(), request.options.targets_size(),
-                        source_index, 0, distance_scale));
+  // Serialize the matrix as flat arrays of times and distances in source major order
+  void serialize_columns(json::Writer& writer, const std::vector<TimeDistance>& time_distances, double distance_scale) {
+    writer.start_array("durations");
+    for (const auto& td : time_distances) {
+      if (td.time != kMaxCost)
+        writer(static_cast<uint64_t>(td.time));
+      else
+        writer(nullptr);
     }
-    auto json = json::map({
-      {"sources_to_targets", matrix},
-      {"units", odin::DirectionsOptions::Units_Name(request.options.units())},
-    });
-    json->emplace("targets", json::array({locations(request.options.targets())}));
-    json->emplace("sources", json::array({locations(request.options.sources())}));
+    writer.end_array();
+    writer.start_array("distances");
+    for (const auto& td : time_distances) {
+      if (td.time != kMaxCost)
+        writer(json::fp_t{td.dist * distance_scale, 3});
+      else
+        writer(nullptr);
+    }
+    writer.end_array();
+  }
+
+  // Serialize the times and distances of one matrix into the open object
+  void serialize_matrix(json::Writer& writer, const valhalla_request_t& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
+    if (request.options.columnar()) {
+      serialize_columns(writer, time_distances, distance_scale);
+    }
+    else {
+      writer.start_array("sources_to_targets");
+      for(size_t source_index = 0; source_index < request.options.sources_size(); ++source_index) {
+        serialize_row(writer, time_distances, source_index * request.options.targets_size(), request.options.targets_size(),
+                      source_index, 0, distance_scale);
+      }
+      writer.end_array();
+    }
+  }
+
+  // Serialize what follows the matrices, the same for one matrix or many
+  void serialize_trailer(json::Writer& writer, const valhalla_request_t& request) {
+    writer("units", odin::DirectionsOptions::Units_Name(request.options.units()));
+    writer.start_array("targets");
+    locations(writer, request.options.targets());
+    writer.end_array();
+    writer.start_array("sources");
+    locations(writer, request.options.sources());
+    writer.end_array();
 
     if (request.options.has_id())
-      json->emplace("id", request.options.id());
-    return json;
+      writer("id", request.options.id());
+    if (request.options.stats())
+      writer("stats", tyr::serializeSearchStats(request.options.search_stats()));
+  }
+
+  void serialize(json::Writer& writer, const valhalla_request_t& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
+    writer.start_object();
+    serialize_matrix(writer, request, time_distances, distance_scale);
+    serialize_trailer(writer, request);
+    writer.end_object();
+  }
+
+  // Serialize one matrix per departure time, each with its offset in seconds
+  void serialize_slices(json::Writer& writer, const valhalla_request_t& request, const std::vector<std::vector<TimeDistance> >& slices,
+      uint32_t interval, double distance_scale) {
+    writer.start_object();
+    writer.start_array("time_slices");
+    for (size_t i = 0; i < slices.size(); ++i) {
+      writer.start_object();
+      writer("departure_offset", static_cast<uint64_t>(i * interval));
+      serialize_matrix(writer, request, slices[i], distance_scale);
+      writer.end_object();
+    }
+    writer.end_array();
+    serialize_trailer(writer, request);
+    writer.end_object();
+  }
+}
+
+namespace pbf_serializers {
+
+  // Serialize the matrix as packed arrays of times and distances
+  std::string serialize(const valhalla_request_t& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
+    Response response;
+    if (request.options.has_id())
+      response.set_id(request.options.id());
+    response.set_units(request.options.units());
+    if (request.options.stats())
+      response.mutable_stats()->CopyFrom(request.options.search_stats());
+    auto* matrix = response.mutable_matrix();
+    matrix->mutable_sources()->CopyFrom(request.options.sources());
+    matrix->mutable_targets()->CopyFrom(request.options.targets());
+    matrix->mutable_times()->Reserve(time_distances.size());
+    matrix->mutable_distances()->Reserve(time_distances.size());
+    for (const auto& td : time_distances) {
+      //check to make sure a route was found; if not, -1 for time and distance in matrix result
+      if (td.time != kMaxCost) {
+        matrix->add_times(static_cast<int32_t>(td.time));
+        matrix->add_distances(td.dist * distance_scale);
+      } else {
+        matrix->add_times(-1);
+        matrix->add_distances(-1.f);
+      }
+    }
+    return response.SerializeAsString();
   }
 }
 
@@ -130,14 +208,27 @@ namespace valhalla {
   namespace tyr {
 
     std::string serializeMatrix(const valhalla_request_t& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
+      if (request.options.format() == odin::DirectionsOptions::pbf)
+        return pbf_serializers::serialize(request, time_distances, distance_scale);
+
+      //write straight into the response, a full matrix is too big to build up first
+      std::string response;
+      response.reserve(128 + time_distances.size() * 64);
+      json::Writer writer(response);
+      if (request.options.format() == odin::DirectionsOptions::osrm)
+        osrm_serializers::serialize(writer, request, time_distances, distance_scale);
+      else
+        valhalla_serializers::serialize(writer, request, time_distances, distance_scale);
+      return response;
+    }
 
-      auto json = request.options.format() == odin::DirectionsOptions::osrm ?
-      osrm_serializers::serialize(request, time_distances, distance_scale) :
-      valhalla_serializers::serialize(request, time_distances, distance_scale);
-
-      std::stringstream ss;
-      ss << *json;
-      return ss.str();
+    std::string serializeMatrixSlices(const valhalla_request_t& request, const std::vector<std::vector<TimeDistance> >& slices,
+        uint32_t interval, double distance_scale) {
+      std::string response;
+      response.reserve(128 + slices.size() * request.options.sources_size() * request.options.targets_size() * 64);
+      json::Writer writer(response);
+      valhalla_serializers::serialize_slices(writer, request, slices, interval, distance_scale);
+      return response;
     }
 
   }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <cctype>
 #include <iomanip>
@@ -23,6 +24,20 @@
 using namespace valhalla::baldr;
 using namespace valhalla::midgard;
 
+namespace {
+
+// Row or column of the shape cell containing a coordinate
+int32_t ShapeCell(const float coord) {
+  return static_cast<int32_t>(std::floor(coord / valhalla::tyr::kShapeCellSize));
+}
+
+uint64_t ShapeCellKey(const int32_t col, const int32_t row) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32)
+      | static_cast<uint32_t>(col);
+}
+
+}
+
 namespace valhalla {
 namespace tyr {
 
@@ -45,6 +60,16 @@ NavigationStatus Navigator::SetRoute(const std::string& route_json_str) {
     return nav_status;
   }
 
+  return InitializeRoute();
+}
+
+NavigationStatus Navigator::SetRoute(const Route& route) {
+  route_ = route;
+  return InitializeRoute();
+}
+
+NavigationStatus Navigator::InitializeRoute() {
+  NavigationStatus nav_status;
   leg_index_ = 0;
   maneuver_index_ = 0;
   InitializeDistanceUnits();
@@ -213,15 +238,17 @@ void Navigator::InitializeShapeLengthTime() {
 
     // Create maneuver speeds in units per second
     maneuver_speeds_.clear();
-    // TODO: rm or make trace
+#ifdef LOGGING_LEVEL_TRACE
     std::cout << std::endl << "SPEED ======================================" << std::endl;
     size_t zzz = 0;
+#endif
     for (const auto& maneuver : route_.trip().legs(leg_index_).maneuvers()) {
       // Calculate speed in units per second - protect against divide by zero
       float time = (maneuver.time() == 0) ? 0.000028f : maneuver.time();
       float speed = (maneuver.length()/time);
-      // TODO: rm or make trace
+#ifdef LOGGING_LEVEL_TRACE
       std::cout << "index=" << zzz++ << " | maneuver.length()=" << maneuver.length() << " | maneuver.time()=" << maneuver.time() << " | time=" << time << " | speed(units/sec)=" << speed << " | speed(units/hour)=" << (speed*3600) << std::endl;
+#endif
       maneuver_speeds_.emplace_back(speed);
 
     }
@@ -262,6 +289,67 @@ void Navigator::InitializeShapeLengthTime() {
     remaining_leg_values_.resize(0);
   }
   current_shape_index_ = 0;
+  InitializeShapeCells();
+}
+
+void Navigator::InitializeShapeCells() {
+  shape_cells_.clear();
+  for (size_t i = 0; (i + 1) < shape_.size(); ++i) {
+    // Add the segment to every cell its bounding box covers
+    const PointLL& u = shape_[i];
+    const PointLL& v = shape_[i + 1];
+    int32_t min_col = ShapeCell(std::min(u.lng(), v.lng()));
+    int32_t max_col = ShapeCell(std::max(u.lng(), v.lng()));
+    int32_t min_row = ShapeCell(std::min(u.lat(), v.lat()));
+    int32_t max_row = ShapeCell(std::max(u.lat(), v.lat()));
+    for (int32_t row = min_row; row <= max_row; ++row) {
+      for (int32_t col = min_col; col <= max_col; ++col) {
+        shape_cells_[ShapeCellKey(col, row)].push_back(i);
+      }
+    }
+  }
+}
+
+std::tuple<PointLL, float, int> Navigator::FindClosestPoint(
+    const PointLL& fix_pt) const {
+  // Most fixes are just ahead of the last one so try the shape near it first
+  auto closest = fix_pt.ClosestPoint(shape_, current_shape_index_,
+                                     kSnapWindowLength);
+  if (std::get<kClosestPointDistance>(closest) <= kOffRouteThreshold)
+    return closest;
+
+  // Otherwise check the segments, at or after the current shape index, in the
+  // cells within the off route threshold of the fix
+  float lat_delta = kOffRouteThreshold / kMetersPerDegreeLat;
+  float lng_delta = lat_delta / std::max(cosf(fix_pt.lat() * kRadPerDeg), 0.01f);
+  std::vector<uint32_t> segments;
+  for (int32_t row = ShapeCell(fix_pt.lat() - lat_delta);
+       row <= ShapeCell(fix_pt.lat() + lat_delta); ++row) {
+    for (int32_t col = ShapeCell(fix_pt.lng() - lng_delta);
+         col <= ShapeCell(fix_pt.lng() + lng_delta); ++col) {
+      auto cell = shape_cells_.find(ShapeCellKey(col, row));
+      if (cell == shape_cells_.end())
+        continue;
+      for (auto segment : cell->second) {
+        if (segment >= current_shape_index_)
+          segments.push_back(segment);
+      }
+    }
+  }
+
+  // Segments that span cells are found more than once. Checking them in
+  // shape order keeps the earliest one when distances are equal, as the
+  // linear search does.
+  std::sort(segments.begin(), segments.end());
+  segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+  for (auto segment : segments) {
+    // A cutoff of zero stops the search after this segment
+    auto candidate = fix_pt.ClosestPoint(shape_, segment, 0.0f);
+    if (std::get<kClosestPointDistance>(candidate)
+        < std::get<kClosestPointDistance>(closest))
+      closest = candidate;
+  }
+  return closest;
 }
 
 void Navigator::InitializeUsedInstructions() {
@@ -345,7 +433,7 @@ NavigationStatus Navigator::SnapToRoute(const FixLocation& fix_location) {
 
   // Find the closest point on the route that corresponds to the fix location
   PointLL fix_pt = PointLL(fix_location.lon(), fix_location.lat());
-  auto closest = fix_pt.ClosestPoint(shape_, current_shape_index_);
+  auto closest = FindClosestPoint(fix_pt);
 
   // If the fix point distance from route is greater than the off route threshold
   // then return invalid route state
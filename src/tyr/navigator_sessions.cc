@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#include "tyr/navigator_sessions.h"
+
+namespace valhalla {
+namespace tyr {
+
+NavigatorSessions::NavigatorSessions(const size_t shard_count) {
+  for (size_t i = 0; i < std::max(shard_count, size_t(1)); ++i)
+    shards_.emplace_back(new Shard());
+}
+
+NavigationStatus NavigatorSessions::Start(const std::string& vehicle_id,
+                                          const Route& route) {
+  // Set the route outside of the lock, it decodes the shape of the leg
+  Navigator navigator;
+  auto nav_status = navigator.SetRoute(route);
+
+  auto& shard = *shards_[ShardIndex(vehicle_id)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.sessions[vehicle_id] = std::move(navigator);
+  return nav_status;
+}
+
+bool NavigatorSessions::End(const std::string& vehicle_id) {
+  auto& shard = *shards_[ShardIndex(vehicle_id)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.sessions.erase(vehicle_id) > 0;
+}
+
+NavigationStatus NavigatorSessions::OnLocationChanged(
+    const std::string& vehicle_id, const FixLocation& fix_location) {
+  auto& shard = *shards_[ShardIndex(vehicle_id)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto session = shard.sessions.find(vehicle_id);
+  if (session == shard.sessions.end()) {
+    NavigationStatus nav_status;
+    nav_status.set_route_state(NavigationStatus_RouteState_kInvalid);
+    return nav_status;
+  }
+  return session->second.OnLocationChanged(fix_location);
+}
+
+std::vector<NavigationStatus> NavigatorSessions::OnLocationChanged(
+    const std::vector<VehicleFix>& fixes) {
+  std::vector<NavigationStatus> statuses(fixes.size());
+
+  // Order the fixes by shard, a stable sort keeps the fixes of each vehicle
+  // in the order of the batch
+  std::vector<size_t> shard_indexes(fixes.size());
+  std::vector<size_t> order(fixes.size());
+  for (size_t i = 0; i < fixes.size(); ++i)
+    shard_indexes[i] = ShardIndex(fixes[i].vehicle_id);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+    [&shard_indexes](const size_t a, const size_t b) {
+      return shard_indexes[a] < shard_indexes[b];
+    });
+
+  // Lock each shard once for all of its fixes
+  for (auto begin = order.cbegin(); begin != order.cend(); ) {
+    size_t shard_index = shard_indexes[*begin];
+    auto& shard = *shards_[shard_index];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (; begin != order.cend() && shard_indexes[*begin] == shard_index; ++begin) {
+      const auto& fix = fixes[*begin];
+      auto session = shard.sessions.find(fix.vehicle_id);
+      if (session == shard.sessions.end())
+        statuses[*begin].set_route_state(NavigationStatus_RouteState_kInvalid);
+      else
+        statuses[*begin] = session->second.OnLocationChanged(fix.fix_location);
+    }
+  }
+  return statuses;
+}
+
+size_t NavigatorSessions::size() const {
+  size_t count = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    count += shard->sessions.size();
+  }
+  return count;
+}
+
+size_t NavigatorSessions::ShardIndex(const std::string& vehicle_id) const {
+  return std::hash<std::string>()(vehicle_id) % shards_.size();
+}
+
+}
+}
@@ -12,6 +12,7 @@
 #include "midgard/pointll.h"
 #include "midgard/aabb2.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "midgard/encoded.h"
 #include "baldr/json.h"
 #include "baldr/turn.h"
@@ -19,6 +20,7 @@
 #include "exception.h"
 #include "odin/util.h"
 #include "proto/directions_options.pb.h"
+#include "proto/response.pb.h"
 #include "tyr/serializers.h"
 
 
@@ -826,27 +828,32 @@ namespace {
     std::string serialize(const valhalla::odin::DirectionsOptions& directions_options,
                           const std::list<TripPath>& path_legs,
                           const std::list<valhalla::odin::TripDirections>& legs) {
-      auto json = json::map({});
+      // Write the json straight into the response as it is made
+      std::string response;
+      json::Writer writer(response);
+      writer.start_object();
 
       // If here then the route succeeded. Set status code to OK and serialize
       // waypoints (locations).
       std::string status("Ok");
-      json->emplace("code", status);
+      writer("code", status);
       switch(directions_options.action()) {
         case valhalla::odin::DirectionsOptions::trace_route:
-          json->emplace("tracepoints", osrm::waypoints(directions_options.shape(), true));
+          writer("tracepoints", osrm::waypoints(directions_options.shape(), true));
           break;
         case valhalla::odin::DirectionsOptions::route:
-          json->emplace("waypoints", osrm::waypoints(directions_options.locations()));
+          writer("waypoints", osrm::waypoints(directions_options.locations()));
           break;
         case valhalla::odin::DirectionsOptions::optimized_route:
-          json->emplace("waypoints", waypoints(directions_options.locations()));
+          writer("waypoints", waypoints(directions_options.locations()));
           break;
       }
 
       // Add each route
       // TODO - alternate routes (currently Valhalla only has 1 route)
-      auto routes = json::array({});
+      // Routes are called matchings in osrm
+      writer.start_array(directions_options.action() == valhalla::odin::DirectionsOptions::trace_route
+          ? "matchings" : "routes");
 
       // For each route...
       for (int i = 0; i < 1; ++i) {
@@ -862,16 +869,13 @@ namespace {
         // Serialize route legs
         route->emplace("legs", serialize_legs(legs, path_legs));
 
-        routes->emplace_back(route);
+        writer(route);
       }
-
-      // Routes are called matchings in osrm
-      json->emplace(directions_options.action() == valhalla::odin::DirectionsOptions::trace_route
-          ? "matchings" : "routes", routes);
-
-      std::stringstream ss;
-      ss << *json;
-      return ss.str();
+      writer.end_array();
+      if (directions_options.stats())
+        writer("stats", serializeSearchStats(directions_options.search_stats()));
+      writer.end_object();
+      return response;
     }
   }
 
@@ -977,7 +981,8 @@ namespace {
       return route_summary;
     }
 
-    json::ArrayPtr locations(const std::list<valhalla::odin::TripDirections>& legs){
+    template <class leg_t>
+    json::ArrayPtr locations(const std::list<leg_t>& legs){
       auto locations = json::array({});
 
       int index = 0;
@@ -1392,27 +1397,117 @@ namespace {
 
     std::string serialize(const valhalla::odin::DirectionsOptions& directions_options,
                    const std::list<valhalla::odin::TripDirections>& directions_legs) {
-      //build up the json object
-      auto json = json::map
-      ({
-        {"trip", json::map
-          ({
-            {"locations", locations(directions_legs)},
-            {"summary", summary(directions_legs)},
-            {"legs", legs(directions_legs)},
-            {"status_message", string("Found route between points")}, //found route between points OR cannot find route between points
-            {"status", static_cast<uint64_t>(0)}, //0 success
-            {"units", valhalla::odin::DirectionsOptions::Units_Name(directions_options.units())},
-            {"language", directions_options.language()}
-          })
-        }
-      });
+      //write the json straight into the response, only the legs are built up first
+      std::string response;
+      json::Writer writer(response);
+      writer.start_object();
+      writer.start_object("trip");
+      writer("locations", locations(directions_legs));
+      writer("summary", summary(directions_legs));
+      writer("legs", legs(directions_legs));
+      writer("status_message", string("Found route between points")); //found route between points OR cannot find route between points
+      writer("status", static_cast<uint64_t>(0)); //0 success
+      writer("units", valhalla::odin::DirectionsOptions::Units_Name(directions_options.units()));
+      writer("language", directions_options.language());
+      writer.end_object();
       if (directions_options.has_id())
-        json->emplace("id", directions_options.id());
+        writer("id", directions_options.id());
+      if (directions_options.stats())
+        writer("stats", serializeSearchStats(directions_options.search_stats()));
+      writer.end_object();
+      return response;
+    }
+
+    //the summary and legs of a trip made straight from its paths
+    std::pair<json::MapPtr, json::ArrayPtr> path_summary(
+        const valhalla::odin::DirectionsOptions& directions_options,
+        std::list<valhalla::odin::TripPath>::const_iterator path_leg,
+        std::list<valhalla::odin::TripPath>::const_iterator path_legs_end) {
+      //the time, length and bounding box of each leg come straight from its path
+      float scale = directions_options.units() == DirectionsOptions::miles ? kMilePerKm : 1.0f;
+      uint64_t time = 0;
+      long double length = 0;
+      AABB2<PointLL> bbox(10000.0f, 10000.0f, -10000.0f, -10000.0f);
+      auto legs = json::array({});
+      for(; path_leg != path_legs_end; ++path_leg) {
+        float leg_length = 0.0f;
+        for(const auto& node : path_leg->node()) {
+          if(node.has_edge())
+            leg_length += node.edge().length();
+        }
+        for(auto edge_length : path_leg->columns().length())
+          leg_length += edge_length;
+        leg_length *= scale;
+        const auto& elapsed_times = path_leg->columns().elapsed_time();
+        uint64_t leg_time = path_leg->node_size() ? path_leg->node().rbegin()->elapsed_time() :
+            (elapsed_times.size() ? elapsed_times.Get(elapsed_times.size() - 1) : 0);
+        time += leg_time;
+        length += leg_length;
+        AABB2<PointLL> leg_bbox(path_leg->bbox().min_ll().lng(),
+                                path_leg->bbox().min_ll().lat(),
+                                path_leg->bbox().max_ll().lng(),
+                                path_leg->bbox().max_ll().lat());
+        bbox.Expand(leg_bbox);
+
+        auto summary = json::map({});
+        summary->emplace("time", leg_time);
+        summary->emplace("length", json::fp_t{leg_length, 3});
+        summary->emplace("min_lat", json::fp_t{leg_bbox.miny(), 6});
+        summary->emplace("min_lon", json::fp_t{leg_bbox.minx(), 6});
+        summary->emplace("max_lat", json::fp_t{leg_bbox.maxy(), 6});
+        summary->emplace("max_lon", json::fp_t{leg_bbox.maxx(), 6});
+        auto leg = json::map({});
+        leg->emplace("summary", summary);
+        leg->emplace("shape", path_leg->shape());
+        legs->emplace_back(leg);
+      }
+
+      auto route_summary = json::map({});
+      route_summary->emplace("time", time);
+      route_summary->emplace("length", json::fp_t{length, 3});
+      route_summary->emplace("min_lat", json::fp_t{bbox.miny(), 6});
+      route_summary->emplace("min_lon", json::fp_t{bbox.minx(), 6});
+      route_summary->emplace("max_lat", json::fp_t{bbox.maxy(), 6});
+      route_summary->emplace("max_lon", json::fp_t{bbox.maxx(), 6});
+      return std::make_pair(route_summary, legs);
+    }
 
-      std::stringstream ss;
-      ss << *json;
-      return ss.str();
+    std::string serialize(const valhalla::odin::DirectionsOptions& directions_options,
+                   const std::list<valhalla::odin::TripPath>& path_legs,
+                   const std::list<valhalla::odin::TripPath>& alternates) {
+      //the same trip as with directions, just without any maneuvers
+      auto trip = path_summary(directions_options, path_legs.cbegin(), path_legs.cend());
+      std::string response;
+      json::Writer writer(response);
+      writer.start_object();
+      writer.start_object("trip");
+      writer("locations", locations(path_legs));
+      writer("summary", trip.first);
+      writer("legs", trip.second);
+      writer("status_message", string("Found route between points"));
+      writer("status", static_cast<uint64_t>(0));
+      writer("units", valhalla::odin::DirectionsOptions::Units_Name(directions_options.units()));
+      writer("language", directions_options.language());
+      writer.end_object();
+
+      //alternates between the same locations, each a whole trip of one leg
+      if (!alternates.empty()) {
+        auto json_alternates = json::array({});
+        for (auto alternate = alternates.cbegin(); alternate != alternates.cend(); ++alternate) {
+          auto alternate_trip = path_summary(directions_options, alternate, std::next(alternate));
+          json_alternates->emplace_back(json::map({
+            {"summary", alternate_trip.first},
+            {"legs", alternate_trip.second}
+          }));
+        }
+        writer("alternates", json_alternates);
+      }
+      if (directions_options.has_id())
+        writer("id", directions_options.id());
+      if (directions_options.stats())
+        writer("stats", serializeSearchStats(directions_options.search_stats()));
+      writer.end_object();
+      return response;
     }
   }
 
@@ -2173,6 +2268,22 @@ namespace {
       //TODO: add time to each, need transition time at nodes
       gpx << "<rte>";
       uint64_t last_id = -1;
+      //output an intersection (note that begin and end points may not be intersections)
+      auto rtept = [&gpx, &wpts, &last_id](size_t shape_idx) {
+        const auto& rtept = wpts[shape_idx];
+        gpx << R"(<rtept lon=")" << rtept.first << R"(" lat=")" << rtept.second << R"(">)"
+            << "<name>" << last_id << "</name></rtept>";
+      };
+      //a columnar path has the edges alone, the last point ends the last of them
+      if(leg.has_columns()) {
+        const auto& columns = leg.columns();
+        for(int i = 0; i < columns.begin_shape_index_size(); ++i) {
+          if(i < columns.way_id_size())
+            last_id = columns.way_id(i);
+          rtept(columns.begin_shape_index(i));
+        }
+        rtept(wpts.size() - 1);
+      }
       for(const auto& node : leg.node()) {
         //if this isnt the last node we want the begin shape index of the edge
         size_t shape_idx = wpts.size() - 1;
@@ -2180,11 +2291,7 @@ namespace {
           last_id = node.edge().way_id();
           shape_idx = node.edge().begin_shape_index();
         }
-
-        //output this intersection (note that begin and end points may not be intersections)
-        const auto& rtept = wpts[shape_idx];
-        gpx << R"(<rtept lon=")" << rtept.first << R"(" lat=")" << rtept.second << R"(">)"
-            << "<name>" << last_id << "</name></rtept>";
+        rtept(shape_idx);
       }
       gpx << "</rte>";
     }
@@ -2193,8 +2300,24 @@ namespace {
     gpx << "</gpx>";
     return gpx.str();
   }
-}
 
+  namespace pbf_serializers {
+
+    // The binary response is the directions of each leg as odin made them
+    std::string serialize(const valhalla::odin::DirectionsOptions& directions_options,
+                          const std::list<valhalla::odin::TripDirections>& directions_legs) {
+      valhalla::Response response;
+      if (directions_options.has_id())
+        response.set_id(directions_options.id());
+      response.set_units(directions_options.units());
+      for (const auto& leg : directions_legs)
+        response.add_legs()->CopyFrom(leg);
+      if (directions_options.stats())
+        response.mutable_stats()->CopyFrom(directions_options.search_stats());
+      return response.SerializeAsString();
+    }
+  }
+}
 
 namespace valhalla {
   namespace tyr {
@@ -2202,6 +2325,7 @@ namespace valhalla {
     std::string serializeDirections(const valhalla_request_t& request,
         const std::list<TripPath>& path_legs,
         const std::list<TripDirections>& directions_legs) {
+      METRICS_TIME(kTyrSerialize);
       //serialize them
       switch(request.options.format()) {
         case DirectionsOptions_Format_osrm:
@@ -2210,6 +2334,22 @@ namespace valhalla {
           return pathToGPX(path_legs);
         case DirectionsOptions_Format_json:
           return valhalla_serializers::serialize(request.options, directions_legs);
+        case DirectionsOptions_Format_pbf:
+          return pbf_serializers::serialize(request.options, directions_legs);
+        default:
+          throw;
+      }
+    }
+
+    std::string serializeSummary(const valhalla_request_t& request,
+        const std::list<TripPath>& path_legs, const std::list<TripPath>& alternates) {
+      METRICS_TIME(kTyrSerialize);
+      //only the formats that can be made from the paths alone
+      switch(request.options.format()) {
+        case DirectionsOptions_Format_gpx:
+          return pathToGPX(path_legs);
+        case DirectionsOptions_Format_json:
+          return valhalla_serializers::serialize(request.options, path_legs, alternates);
         default:
           throw;
       }
@@ -86,3 +86,19 @@ namespace osrm {
 
 }
 
+namespace valhalla {
+  namespace tyr {
+
+    json::MapPtr serializeSearchStats(const odin::SearchStats& stats) {
+      return json::map({
+        {"labels", static_cast<uint64_t>(stats.labels())},
+        {"queue_pushes", static_cast<uint64_t>(stats.queue_pushes())},
+        {"tiles_loaded", static_cast<uint64_t>(stats.tiles_loaded())},
+        {"tile_cache_hits", static_cast<uint64_t>(stats.tile_cache_hits())},
+        {"search_ms", json::fp_t{stats.search_ms(), 3}},
+        {"total_ms", json::fp_t{stats.total_ms(), 3}},
+      });
+    }
+
+  }
+}
@@ -17,10 +17,9 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/iterator/reverse_iterator.hpp>
 
-#include <deque>
+#include <atomic>
 #include <algorithm>
 #include <thread>
-#include <mutex>
 #include <future>
 
 #include "config.h"
@@ -153,23 +152,27 @@ uint32_t match_score(const float length_diff, const float origin_diff,
 }
 
 // Edge association
-using leftovers_t = std::vector<std::pair<vb::GraphId, vb::TrafficChunk > >;
+using segments_t = std::vector<std::pair<vb::GraphId, vb::TrafficChunk > >;
 using chunk_t = std::unordered_map<vb::GraphId, std::vector<vb::TrafficChunk> >;
 using chunks_t = std::vector<std::pair<vb::GraphId, std::vector<vb::TrafficChunk > > >;
 struct edge_association {
   explicit edge_association(const bpt::ptree &pt);
 
-  // Associate a tile of OSMLR to Valhalla edges
+  // Associate a tile of OSMLR to Valhalla edges. Nothing is written to the
+  // graph tiles, the associations are kept until every OSMLR tile is matched.
   void add_tile(const std::string& file_name);
 
-  // Get the "leftovers" - these are edge-segment associations where the
-  // edges are not in the same tile as the OSMLR segment.
-  const leftovers_t& leftovers() const { return m_leftover_associations; }
+  // Get the segments - these are edges that associate to exactly 1 OSMLR
+  // segment, whichever tile the segment is in.
+  const segments_t& segments() const { return m_segment_associations; }
 
   // Get the chunks. These are edges that associate to more than 1 OSMLR
   // segment.
   const chunk_t& chunks() const { return traffic_chunks; }
 
+  // Get the graph tiles that had an OSMLR tile
+  const std::vector<vb::GraphId>& tiles() const { return m_tiles; }
+
   std::unordered_map<uint32_t, uint32_t> success_count() const { return success_count_; }
   std::unordered_map<uint32_t, uint32_t> failure_count() const { return failure_count_; }
   std::unordered_map<uint32_t, uint32_t> walk_count() const { return walk_count_; }
@@ -194,7 +197,6 @@ private:
   vs::TravelMode m_travel_mode;
   std::shared_ptr<vt::AStarPathAlgorithm> m_path_algo;
   std::shared_ptr<vs::DynamicCost> m_costing;
-  std::shared_ptr<vj::GraphTileBuilder> m_tile_builder;
 
   // Statistics
   std::unordered_map<uint32_t, uint32_t> success_count_;
@@ -206,7 +208,10 @@ private:
   chunk_t traffic_chunks;
 
   // simple associations saved for later
-  leftovers_t m_leftover_associations;
+  segments_t m_segment_associations;
+
+  // graph tiles that had an OSMLR tile
+  std::vector<vb::GraphId> m_tiles;
 };
 
 // Use this method to determine whether an edge should be allowed along the
@@ -286,7 +291,7 @@ public:
 };
 
 DistanceOnlyCost::DistanceOnlyCost(vs::TravelMode travel_mode)
-  : DynamicCost(bpt::ptree(), travel_mode) {
+  : DynamicCost(rapidjson::Value{}, travel_mode) {
 }
 
 DistanceOnlyCost::~DistanceOnlyCost() {
@@ -778,11 +783,8 @@ bool edge_association::match_segment(vb::GraphId segment_id, const pbf::Segment
     vb::TrafficChunk assoc(segment_id, edge.start_pct, edge.end_pct, i == 0, i == (edges.size() - 1));
     // Full edge.
     if (edge.start_pct == 0.0f && edge.end_pct == 1.0f) {
-      // Store the local segment and leave the non local for later
-      if(m_tile_builder->id() == edge.edgeid.Tile_Base())
-        m_tile_builder->AddTrafficSegment(edge.edgeid, assoc);
-      else
-        m_leftover_associations.emplace_back(std::make_pair(edge.edgeid, std::move(assoc)));
+      // Store the segment until its tile is written
+      m_segment_associations.emplace_back(std::make_pair(edge.edgeid, std::move(assoc)));
     }// Add the temporary chunk information for this edge to the map
     else
       traffic_chunks[edge.edgeid].emplace_back(std::move(assoc));
@@ -806,10 +808,8 @@ void edge_association::add_tile(const std::string& file_name) {
     }
   }
 
-  // Get a tile builder ready for this tile
-  m_tile_builder.reset(new vj::GraphTileBuilder(m_reader.tile_dir(),
-                       base_id, false));
-  m_tile_builder->InitializeTrafficSegments();
+  // The graph tile gets written even if none of its segments match
+  m_tiles.push_back(base_id);
 
   // Match the segments in this OSMLR tile
   std::cout.precision(16);
@@ -833,93 +833,69 @@ void edge_association::add_tile(const std::string& file_name) {
     entry_id += 1;
   }
 
-  // Finish this tile
-  m_tile_builder->UpdateTrafficSegments(false);
+  // Done with this tile
   m_reader.Clear();
 }
 
-// Add OSMLR segment associations to each tile in the list. Any "local"
-// associations where the edge is within the same tile as the OSMLR segment
-// are written to the tile.
-void add_local_associations(const bpt::ptree &pt, std::deque<std::string>& osmlr_tiles, std::mutex& lock,
-  std::promise<edge_association>& association) {
+// Orders associations by the graph tile of their edge then by the edge, so
+// the associations of each tile are next to each other
+template <class T>
+bool edge_order(const std::pair<vb::GraphId, T>& a, const std::pair<vb::GraphId, T>& b) {
+  return a.first.Tile_Base() < b.first.Tile_Base() ||
+        (a.first.Tile_Base() == b.first.Tile_Base() && a.first.id() < b.first.id());
+}
+
+// Finds the associations of a graph tile in associations sorted by edge_order
+template <class T>
+std::pair<typename std::vector<std::pair<vb::GraphId, T> >::const_iterator,
+          typename std::vector<std::pair<vb::GraphId, T> >::const_iterator>
+tile_range(const std::vector<std::pair<vb::GraphId, T> >& associations, const vb::GraphId& tile_id) {
+  auto lower = std::partition_point(associations.cbegin(), associations.cend(),
+    [&tile_id](const std::pair<vb::GraphId, T>& a) { return a.first.Tile_Base() < tile_id; });
+  auto upper = std::partition_point(lower, associations.cend(),
+    [&tile_id](const std::pair<vb::GraphId, T>& a) { return a.first.Tile_Base() == tile_id; });
+  return std::make_pair(lower, upper);
+}
+
+// Match the OSMLR segments of the tiles in the list. Each thread takes the
+// next tile nobody has taken yet and keeps what it matched to itself, no
+// graph tile is written until every OSMLR tile is matched.
+void add_local_associations(const bpt::ptree &pt, const std::vector<std::string>& osmlr_tiles,
+  std::atomic<size_t>& next_tile, std::promise<edge_association>& association) {
 
   //this holds the extra data before we serialize it to the extra section
   //of a tile.
   edge_association e(pt);
 
-  while(true) {
-    //get a file to work with
-    std::string osmlr_filename;
-    lock.lock();
-    if(osmlr_tiles.size()) {
-      osmlr_filename = std::move(osmlr_tiles.front());
-      osmlr_tiles.pop_front();
-    }
-    lock.unlock();
-    if(osmlr_filename.empty())
-      break;
-
-    //get the local associations
-    e.add_tile(osmlr_filename);
-  }
+  //get a file to work with until there are none left
+  for (size_t i = next_tile++; i < osmlr_tiles.size(); i = next_tile++)
+    e.add_tile(osmlr_tiles[i]);
 
   //pass it back
   association.set_value(std::move(e));
 }
 
-void add_leftover_associations(const bpt::ptree &pt, std::unordered_map<GraphId, leftovers_t>& leftovers,
-                               std::mutex& lock) {
-
-  // Get the tile dir
+// Write the associations of each graph tile in the list. Each thread takes the
+// next tile nobody has taken yet so every graph tile is written exactly once.
+void add_associations(const bpt::ptree &pt, const std::vector<vb::GraphId>& tiles,
+                      const segments_t& segments, const chunks_t& chunks,
+                      std::atomic<size_t>& next_tile) {
   std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
-
-  while(true) {
-    // Get leftovers from a tile
-    leftovers_t associations;
-    lock.lock();
-    if (leftovers.size()) {
-      associations = std::move(leftovers.begin()->second);
-      leftovers.erase(leftovers.begin());
-    }
-    lock.unlock();
-    if(associations.empty())
-      break;
-
-    // Write leftovers
-    vj::GraphTileBuilder tile_builder(tile_dir, associations.front().first.Tile_Base(), false);
+  for (size_t i = next_tile++; i < tiles.size(); i = next_tile++) {
+    vj::GraphTileBuilder tile_builder(tile_dir, tiles[i], false);
     tile_builder.InitializeTrafficSegments();
     tile_builder.InitializeTrafficChunks();
-    for(const auto& association : associations)
-      tile_builder.AddTrafficSegment(association.first, association.second);
-    tile_builder.UpdateTrafficSegments(false);
-  }
-}
-
-void add_chunks(const bpt::ptree &pt, std::unordered_map<vb::GraphId, chunks_t>& chunks,
-                               std::mutex& lock) {
-  std::string tile_dir = pt.get<std::string>("mjolnir.tile_dir");
-  while(true) {
-    // Get chunks
-    lock.lock();
-    std::vector<std::pair<vb::GraphId, std::vector<vb::TrafficChunk>>> associated_chunks;
-    if (chunks.size()) {
-      associated_chunks = std::move(chunks.begin()->second);
-      chunks.erase(chunks.begin());
-    }
-    lock.unlock();
-    if(associated_chunks.empty())
-      break;
 
-    // Write chunks
-    vj::GraphTileBuilder tile_builder(tile_dir, associated_chunks.front().first.Tile_Base(), false);
-    tile_builder.InitializeTrafficSegments();
-    tile_builder.InitializeTrafficChunks();
-    for(const auto& chunk : associated_chunks) {
-      tile_builder.AddTrafficSegments(chunk.first, chunk.second);
-    }
+    // Edges with a single segment and then those with chunks of several, an
+    // edge with both ends up with its chunks as before
+    auto tile_segments = tile_range(segments, tiles[i]);
+    for (auto association = tile_segments.first; association != tile_segments.second; ++association)
+      tile_builder.AddTrafficSegment(association->first, association->second);
+    auto tile_chunks = tile_range(chunks, tiles[i]);
+    for (auto chunk = tile_chunks.first; chunk != tile_chunks.second; ++chunk)
+      tile_builder.AddTrafficSegments(chunk->first, chunk->second);
 
-    // Since this is the last time UpdateTrafficSegments is called we set
+    // Since this is the only time UpdateTrafficSegments is called we set
     // the flag indicating the DirectedEdge traffic flags are set.
     tile_builder.UpdateTrafficSegments(true);
   }
@@ -978,7 +954,7 @@ int main(int argc, char** argv) {
   }
 
   //queue up all the work we'll be doing
-  std::deque<std::string> osmlr_tiles;
+  std::vector<std::string> osmlr_tiles;
   auto itr = bfs::recursive_directory_iterator(tile_dir);
   auto end = bfs::recursive_directory_iterator();
   for (; itr != end; ++itr) {
@@ -1003,14 +979,14 @@ int main(int argc, char** argv) {
   bpt::read_json(config.c_str(), pt);
 
   //fire off some threads to do the work
-  LOG_INFO("Associating local traffic segments with " + std::to_string(num_threads) + " threads");
+  LOG_INFO("Associating traffic segments with " + std::to_string(num_threads) + " threads");
   std::vector<std::shared_ptr<std::thread> > threads(num_threads);
   std::list<std::promise<edge_association> > results;
-  std::mutex lock;
+  std::atomic<size_t> next_tile(0);
   for (auto& thread : threads) {
     results.emplace_back();
-    thread.reset(new std::thread(add_local_associations, std::cref(pt), std::ref(osmlr_tiles),
-                                 std::ref(lock), std::ref(results.back())));
+    thread.reset(new std::thread(add_local_associations, std::cref(pt), std::cref(osmlr_tiles),
+                                 std::ref(next_tile), std::ref(results.back())));
   }
 
   //wait for it to finish
@@ -1018,15 +994,14 @@ int main(int argc, char** argv) {
     thread->join();
   LOG_INFO("Finished");
 
-  // Gather statistics, chunks, and leftovers (associations in a different tile)
+  // Gather statistics, segments, chunks and the tiles they go in
   std::unordered_map<uint32_t, uint32_t> success_count;
   std::unordered_map<uint32_t, uint32_t> failure_count;
   std::unordered_map<uint32_t, uint32_t> walk_count;
   std::unordered_map<uint32_t, uint32_t> path_count;
-  uint32_t leftover_count = 0;
-  uint32_t chunk_count = 0;
-  std::unordered_map<vb::GraphId, leftovers_t> leftovers;
-  std::unordered_map<vb::GraphId, chunks_t> chunks;
+  segments_t segments;
+  chunks_t chunks;
+  std::vector<vb::GraphId> tiles;
   for (auto& result : results) {
     auto associations = result.get_future().get();
 
@@ -1042,26 +1017,31 @@ int main(int argc, char** argv) {
     for( const auto& x : associations.path_count() )
       path_count[x.first] += x.second;
 
-    // Leftovers
-    for(const auto& association : associations.leftovers()) {
-      auto leftover = leftovers.insert({association.first.Tile_Base(), {}}).first;
-      leftover->second.push_back(association);
-    }
-    leftover_count += associations.leftovers().size();
-
-    // Temporary chunks
-    using single_chunk_t = std::pair<vb::GraphId, std::vector<vb::TrafficChunk>>;
-    for (const auto& association : associations.chunks()) {
-      vb::GraphId tileid = association.first.Tile_Base();
-      single_chunk_t c = std::make_pair(association.first, association.second);
-      if (chunks.find(tileid) == chunks.end()) {
-        chunks[tileid] = { c };
-      } else {
-        chunks[tileid].push_back(c);
-      }
-    }
-    chunk_count += associations.chunks().size();
+    segments.insert(segments.end(), associations.segments().cbegin(), associations.segments().cend());
+    chunks.insert(chunks.end(), associations.chunks().cbegin(), associations.chunks().cend());
+    tiles.insert(tiles.end(), associations.tiles().cbegin(), associations.tiles().cend());
+  }
+
+  // An edge is matched by at most one thread unless OSMLR tiles overlap, in
+  // which case the chunks of all of them are kept
+  std::sort(chunks.begin(), chunks.end(), edge_order<std::vector<vb::TrafficChunk> >);
+  chunks_t merged;
+  for (auto& chunk : chunks) {
+    if (!merged.empty() && merged.back().first == chunk.first)
+      merged.back().second.insert(merged.back().second.end(), chunk.second.cbegin(), chunk.second.cend());
+    else
+      merged.emplace_back(std::move(chunk));
   }
+  chunks.swap(merged);
+  std::stable_sort(segments.begin(), segments.end(), edge_order<vb::TrafficChunk>);
+
+  // Every graph tile with an OSMLR tile or an association gets written once
+  for (const auto& association : segments)
+    tiles.push_back(association.first.Tile_Base());
+  for (const auto& chunk : chunks)
+    tiles.push_back(chunk.first.Tile_Base());
+  std::sort(tiles.begin(), tiles.end());
+  tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
 
   for( const auto& x : success_count )
     LOG_INFO("Success = " + std::to_string(x.second) + " at level " + std::to_string(x.first));
@@ -1075,27 +1055,16 @@ int main(int argc, char** argv) {
   for( const auto& x : path_count )
     LOG_INFO("Path = " + std::to_string(x.second) + " at level " + std::to_string(x.first));
 
-  LOG_INFO("Leftovers = " + std::to_string(leftover_count) +
-           " Chunks = " + std::to_string(chunk_count));
-
-  LOG_INFO("Associating neighbouring traffic segments with " + std::to_string(num_threads) + " threads");
-
-  // Write all the leftovers
-  for (auto& thread : threads) {
-    results.emplace_back();
-    thread.reset(new std::thread(add_leftover_associations, std::cref(pt), std::ref(leftovers),
-                                 std::ref(lock)));
-  }
-
-  //wait for it to finish
-  for (auto& thread : threads)
-    thread->join();
+  LOG_INFO("Segments = " + std::to_string(segments.size()) +
+           " Chunks = " + std::to_string(chunks.size()));
 
-  // Write all the chunks
-  LOG_INFO("Adding chunks (edge associations to multiple segments) " + std::to_string(num_threads) + " threads");
+  // Write each graph tile once
+  LOG_INFO("Writing " + std::to_string(tiles.size()) + " tiles with " +
+           std::to_string(num_threads) + " threads");
+  next_tile = 0;
   for (auto& thread : threads) {
-    results.emplace_back();
-    thread.reset(new std::thread(add_chunks, std::cref(pt), std::ref(chunks), std::ref(lock)));
+    thread.reset(new std::thread(add_associations, std::cref(pt), std::cref(tiles),
+                                 std::cref(segments), std::cref(chunks), std::ref(next_tile)));
   }
 
   //wait for it to finish
@@ -1103,7 +1072,5 @@ int main(int argc, char** argv) {
     thread->join();
   LOG_INFO("Finished");
 
-  LOG_INFO("Finished");
-
   return EXIT_SUCCESS;
 }
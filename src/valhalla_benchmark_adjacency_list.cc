@@ -12,6 +12,7 @@
 #include "config.h"
 
 #include "baldr/double_bucket_queue.h"
+#include "baldr/label_bucket_queue.h"
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -19,12 +20,50 @@ using namespace valhalla::sif;
 
 namespace bpo = boost::program_options;
 
+/**
+ * Adds edge labels with the given costs to a label specialized bucket queue
+ * and removes them again, returning the costs in the order they came out.
+ */
+template <class layout_t>
+std::vector<uint32_t> BenchmarkLabelQueue(const std::string& name,
+              const std::vector<uint32_t>& costs, const float maxcost,
+              const float bucketsize) {
+  std::clock_t start = std::clock();
+  std::vector<EdgeLabel> edgelabels;
+  LabelBucketQueue<EdgeLabel, layout_t> adjlist(0, maxcost / 2, bucketsize, edgelabels);
+  for (uint32_t i = 0; i < costs.size(); i++) {
+    EdgeLabel el;
+    el.SetSortCost(costs[i]);
+    edgelabels.push_back(std::move(el));
+    adjlist.add(i);
+  }
+
+  uint32_t count = 0;
+  std::vector<uint32_t> ordered_cost;
+  while (true) {
+    uint32_t idx = adjlist.pop();
+    if (idx == kInvalidLabel) {
+      break;
+    }
+
+    // Copy the edge label - simulates what is done in PathAlgorithm
+    EdgeLabel el = edgelabels[idx];
+    ordered_cost.push_back(el.sortcost());
+    count++;
+  }
+  uint32_t ms = (std::clock() - start) / static_cast<double>(CLOCKS_PER_SEC / 1000);
+  LOG_INFO(name + ": Added and removed " + std::to_string(count) +
+           " edgelabels in " + std::to_string(ms) + " ms");
+  return ordered_cost;
+}
+
 /**
  * Benchmark of adjacency list. Constructs a large number of random numbers,
  * adds EdgeLabels to the AdjacencyList with those as the sortcost. Then
  * removes them from the list. This compares performance of an STL
  * priority_queue with the custom approximate double bucket sorting used
- * in adjacencylist.cc.
+ * in adjacencylist.cc, and with the label specialized bucket queue in both
+ * of its bucket layouts.
  */
 int Benchmark(const uint32_t n, const float maxcost,
               const float bucketsize) {
@@ -100,11 +139,21 @@ int Benchmark(const uint32_t n, const float maxcost,
   LOG_INFO("Bucketed Adj. List: Added and removed " + std::to_string(count) +
            " edgelabels in " + std::to_string(ms) + " ms");
 
+  // Test performance of the label specialized queue in both layouts
+  auto ordered_cost3 = BenchmarkLabelQueue<VectorBucketLayout>(
+      "Label Bucket Queue", costs, maxcost, bucketsize);
+  auto ordered_cost4 = BenchmarkLabelQueue<FlatBucketLayout>(
+      "Flat Label Bucket Queue", costs, maxcost, bucketsize);
+
   // Verify order
   for (uint32_t i = 0; i < count; i++) {
-    if (ordered_cost1[i] != ordered_cost2[i]) {
+    if (ordered_cost1[i] != ordered_cost2[i] ||
+        ordered_cost1[i] != ordered_cost3[i] ||
+        ordered_cost1[i] != ordered_cost4[i]) {
       LOG_INFO("Costs: " + std::to_string(ordered_cost1[i]) + "," +
-               std::to_string(ordered_cost2[i]));
+               std::to_string(ordered_cost2[i]) + "," +
+               std::to_string(ordered_cost3[i]) + "," +
+               std::to_string(ordered_cost4[i]));
     }
   }
   return 0;
@@ -118,7 +167,7 @@ int main(int argc, char *argv[]) {
   " Usage: adjlistbenchmark [options]\n"
   "\n"
   "adjlistbenchmark is benchmark comparing performance of an STL priority_queue"
-  "to the approximate double bucket adjacency list class supplied with Valhalla."
+  "to the approximate double bucket adjacency list classes supplied with Valhalla."
   "\n"
   "\n");
 
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "midgard/logging.h"
+#include "thor/optimizer.h"
+#include "config.h"
+
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+/**
+ * Synthetic cost matrix of random stops in a 20km square. The cost is the
+ * time in seconds at 10 m/s along the straight line with some detour that
+ * differs by direction, like the times of a real matrix.
+ */
+std::vector<float> SyntheticCosts(const uint32_t count, std::mt19937& gen) {
+  std::uniform_real_distribution<float> position(0.0f, 20000.0f);
+  std::uniform_real_distribution<float> detour(1.2f, 1.6f);
+  std::vector<std::pair<float, float> > stops(count);
+  for (auto& stop : stops)
+    stop = std::make_pair(position(gen), position(gen));
+  std::vector<float> costs(count * count, 0.0f);
+  for (uint32_t i = 0; i < count; i++) {
+    for (uint32_t j = 0; j < count; j++) {
+      if (i != j) {
+        float d = std::hypot(stops[i].first - stops[j].first, stops[i].second - stops[j].second);
+        costs[i * count + j] = std::round(d * detour(gen) / 10.0f);
+      }
+    }
+  }
+  return costs;
+}
+
+float TourCost(const uint32_t count, const std::vector<float>& costs,
+               const std::vector<uint32_t>& tour) {
+  float c = 0.0f;
+  for (uint32_t i = 0; i + 1 < tour.size(); i++)
+    c += costs[tour[i] * count + tour[i + 1]];
+  return c;
+}
+
+/**
+ * Solve a number of problems of a given size with the given optimizer
+ * settings, logging the average time and tour cost.
+ */
+void Benchmark(const std::string& name, const uint32_t count, const uint32_t runs,
+               const uint32_t chains, const bool local_search) {
+  std::mt19937 gen(count);
+  double ms = 0.0, cost = 0.0;
+  for (uint32_t run = 0; run < runs; run++) {
+    auto costs = SyntheticCosts(count, gen);
+    Optimizer optimizer(chains, local_search);
+    optimizer.Seed(run);
+    auto start = std::chrono::steady_clock::now();
+    auto tour = optimizer.Solve(count, costs);
+    auto end = std::chrono::steady_clock::now();
+    ms += std::chrono::duration<double, std::milli>(end - start).count();
+    cost += TourCost(count, costs, tour);
+  }
+  LOG_INFO(std::to_string(count) + " stops " + name + ": " +
+           std::to_string(static_cast<uint32_t>(ms / runs)) + " ms, tour cost " +
+           std::to_string(static_cast<uint32_t>(cost / runs)));
+}
+
+int main(int argc, char *argv[]) {
+
+  uint32_t runs, chains;
+  bpo::options_description options(
+  "valhalla " VERSION "\n"
+  "\n"
+  " Usage: valhalla_benchmark_optimizer [options]\n"
+  "\n"
+  "valhalla_benchmark_optimizer compares the time and the tour cost of the "
+  "annealing optimizer with and without its local search and with several "
+  "chains on synthetic 50, 100 and 200 stop problems."
+  "\n"
+  "\n");
+
+  options.add_options()
+    ("help,h", "Print this help message.")
+    ("version,v", "Print the version of this software.")
+    ("runs,r", bpo::value<uint32_t>(&runs)->default_value(5), "Number of problems of each size to average over.")
+    ("chains,c", bpo::value<uint32_t>(&chains)->default_value(kDefaultAnnealingChains), "Number of annealing chains to compare with, 0 for one per core.")
+    ;
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc,argv)
+      .options(options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_benchmark_optimizer " << VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  for (uint32_t count : { 50, 100, 200 }) {
+    Benchmark("annealing", count, runs, 1, false);
+    Benchmark("annealing + local search", count, runs, 1, true);
+    Benchmark(std::to_string(chains) + " chains + local search", count, runs, chains, true);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,355 @@
+#include "config.h"
+
+#include "baldr/filesystem_utils.h"
+#include "baldr/graphreader.h"
+#include "baldr/graphtile.h"
+#include "baldr/json.h"
+#include "midgard/distanceapproximator.h"
+#include "midgard/encoded.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+#include "sif/edgelabel.h"
+#include "thor/edgestatus.h"
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+boost::filesystem::path config_file_path;
+size_t tile_count = 16;
+double min_seconds = .5;
+std::string filter;
+std::string output_file;
+
+namespace {
+
+//keeps the compiler from throwing away work whose result nothing else uses
+volatile uint64_t sink;
+template <class T>
+void keep(const T& value) {
+  sink = sink + static_cast<uint64_t>(value);
+}
+
+//a tile to run things over along with the bytes it was read from
+struct tile_t {
+  GraphId id;
+  std::vector<char> bytes;
+  std::unique_ptr<GraphTile> tile;
+};
+
+//what is being measured and how many primitive operations one run of it does
+struct case_t {
+  std::string name;
+  std::function<void ()> run;
+  uint64_t operations;
+};
+
+struct result_t {
+  std::string name;
+  uint64_t iterations;
+  double ns_per_op;
+};
+
+/**
+ * Runs a case as many times as it takes to fill the minimum time, doubling the
+ * number of runs each round so the clock is read rarely, and returns the time
+ * each of its primitive operations took.
+ */
+result_t Measure(const case_t& c) {
+  //once untimed to warm up caches and lazily built state
+  c.run();
+  uint64_t iterations = 1;
+  while (true) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i)
+      c.run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed.count() >= min_seconds || iterations >= (uint64_t(1) << 30))
+      return {c.name, iterations, elapsed.count() * 1e9 / (iterations * std::max(c.operations, uint64_t(1)))};
+    iterations *= 2;
+  }
+}
+
+/**
+ * Reads the largest tiles of the hierarchy so the cases run over real data.
+ * Tiles that cannot be read raw (for example gzipped ones) are skipped.
+ */
+std::vector<tile_t> LoadTiles(const boost::property_tree::ptree& config) {
+  GraphReader reader(config.get_child("mjolnir"));
+  std::vector<std::pair<uintmax_t, GraphId> > sizes;
+  for (const auto& id : reader.GetTileSet()) {
+    auto path = reader.tile_dir() + filesystem::path_separator + GraphTile::FileSuffix(id);
+    if (boost::filesystem::exists(path))
+      sizes.emplace_back(boost::filesystem::file_size(path), id);
+  }
+  std::sort(sizes.begin(), sizes.end(), [](const std::pair<uintmax_t, GraphId>& a, const std::pair<uintmax_t, GraphId>& b) {
+    return a.first > b.first;
+  });
+  if (sizes.size() > tile_count)
+    sizes.resize(tile_count);
+
+  std::vector<tile_t> tiles;
+  for (const auto& size : sizes) {
+    auto path = reader.tile_dir() + filesystem::path_separator + GraphTile::FileSuffix(size.second);
+    std::ifstream file(path, std::ios::binary);
+    tile_t t{size.second, std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()), nullptr};
+    t.tile.reset(new GraphTile(t.id, t.bytes.data(), t.bytes.size()));
+    if (!t.bytes.empty() && t.tile->header() != nullptr)
+      tiles.emplace_back(std::move(t));
+  }
+  return tiles;
+}
+
+std::vector<case_t> MakeCases(const std::vector<tile_t>& tiles) {
+  std::vector<case_t> cases;
+
+  //count what we are about to iterate
+  uint64_t edges = 0;
+  for (const auto& t : tiles)
+    edges += t.tile->header()->directededgecount();
+
+  //pull all the shape out once for the midgard cases
+  std::vector<std::vector<PointLL> > shapes;
+  std::vector<std::string> encoded, encoded7;
+  uint64_t points = 0;
+  for (const auto& t : tiles) {
+    for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i) {
+      const auto* edge = t.tile->directededge(i);
+      if (!edge->forward())
+        continue;
+      shapes.emplace_back(t.tile->edgeinfo(edge->edgeinfo_offset()).shape());
+      encoded.emplace_back(encode(shapes.back()));
+      encoded7.emplace_back(encode7(shapes.back()));
+      points += shapes.back().size();
+    }
+  }
+
+  //baldr
+  cases.push_back({"GraphTile construction", [&tiles]() {
+    for (const auto& t : tiles) {
+      GraphTile tile(t.id, const_cast<char*>(t.bytes.data()), t.bytes.size());
+      keep(tile.header()->directededgecount());
+    }
+  }, tiles.size()});
+  cases.push_back({"GraphTile::directededge", [&tiles]() {
+    for (const auto& t : tiles)
+      for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i)
+        keep(t.tile->directededge(i)->length());
+  }, edges});
+  cases.push_back({"GraphTile::edgeinfo", [&tiles]() {
+    for (const auto& t : tiles)
+      for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i)
+        keep(t.tile->edgeinfo(t.tile->directededge(i)->edgeinfo_offset()).wayid());
+  }, edges});
+  cases.push_back({"EdgeInfo::shape", [&tiles]() {
+    for (const auto& t : tiles)
+      for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i)
+        keep(t.tile->edgeinfo(t.tile->directededge(i)->edgeinfo_offset()).shape().size());
+  }, edges});
+  cases.push_back({"EdgeInfo::lazy_shape", [&tiles]() {
+    for (const auto& t : tiles) {
+      for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i) {
+        auto decoder = t.tile->edgeinfo(t.tile->directededge(i)->edgeinfo_offset()).lazy_shape();
+        while (!decoder.empty())
+          keep(decoder.pop().lat());
+      }
+    }
+  }, edges});
+
+  //midgard
+  cases.push_back({"midgard::encode", [shapes]() {
+    for (const auto& shape : shapes)
+      keep(encode(shape).size());
+  }, points});
+  cases.push_back({"midgard::encode into a reused string", [shapes]() {
+    std::string output;
+    for (const auto& shape : shapes) {
+      output.clear();
+      encode(shape, output);
+      keep(output.size());
+    }
+  }, points});
+  cases.push_back({"midgard::decode", [encoded]() {
+    for (const auto& e : encoded)
+      keep(decode<std::vector<PointLL> >(e).size());
+  }, points});
+  cases.push_back({"midgard::decode7", [encoded7]() {
+    for (const auto& e : encoded7)
+      keep(decode7<std::vector<PointLL> >(e).size());
+  }, points});
+  cases.push_back({"DistanceApproximator::DistanceSquared", [shapes]() {
+    for (const auto& shape : shapes) {
+      DistanceApproximator approximator(shape.front());
+      for (const auto& p : shape)
+        keep(approximator.DistanceSquared(p));
+    }
+  }, points});
+  cases.push_back({"PointLL::Distance", [shapes]() {
+    for (const auto& shape : shapes)
+      for (size_t i = 1; i < shape.size(); ++i)
+        keep(shape[i - 1].Distance(shape[i]));
+  }, points});
+
+  //sif, every costing over every edge and every turn at the end of it
+  CostFactory<DynamicCost> factory;
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("hov", CreateHOVCost);
+  factory.Register("motor_scooter", CreateMotorScooterCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("truck", CreateTruckCost);
+  uint64_t turns = 0;
+  for (const auto& t : tiles) {
+    for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i) {
+      const auto* edge = t.tile->directededge(i);
+      if (edge->endnode().Tile_Base() == t.id.Tile_Base())
+        turns += t.tile->node(edge->endnode())->edge_count();
+    }
+  }
+  for (const auto& name : { "auto", "auto_shorter", "bus", "bicycle", "hov", "motor_scooter", "pedestrian", "truck" }) {
+    cost_ptr_t costing = factory.Create(name, boost::property_tree::ptree{});
+    cases.push_back({std::string(name) + " EdgeCost", [&tiles, costing]() {
+      for (const auto& t : tiles)
+        for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i)
+          keep(costing->EdgeCost(t.tile->directededge(i)).cost);
+    }, edges});
+    cases.push_back({std::string(name) + " TransitionCost", [&tiles, costing]() {
+      for (const auto& t : tiles) {
+        for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i) {
+          const auto* edge = t.tile->directededge(i);
+          if (edge->endnode().Tile_Base() != t.id.Tile_Base())
+            continue;
+          EdgeLabel pred(0, GraphId(t.id.tileid(), t.id.level(), i), edge, {}, 0, 0, costing->travel_mode(), 0);
+          const auto* node = t.tile->node(edge->endnode());
+          for (uint32_t j = 0; j < node->edge_count(); ++j)
+            keep(costing->TransitionCost(t.tile->directededge(node->edge_index() + j), node, pred).cost);
+        }
+      }
+    }, turns});
+  }
+
+  //thor
+  cases.push_back({"EdgeStatus::Set/Get/Update", [&tiles]() {
+    EdgeStatus status;
+    for (const auto& t : tiles) {
+      GraphId id(t.id.tileid(), t.id.level(), 0);
+      for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i, ++id)
+        status.Set(id, EdgeSet::kTemporary, i);
+      id = GraphId(t.id.tileid(), t.id.level(), 0);
+      for (uint32_t i = 0; i < t.tile->header()->directededgecount(); ++i, ++id) {
+        keep(status.Get(id).index());
+        status.Update(id, EdgeSet::kPermanent);
+      }
+    }
+    status.Init();
+  }, edges * 3});
+
+  //only the ones asked for
+  cases.erase(std::remove_if(cases.begin(), cases.end(), [](const case_t& c) {
+    return c.name.find(filter) == std::string::npos;
+  }), cases.end());
+  return cases;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+
+  bpo::options_description options(
+  "valhalla_benchmark_primitives " VERSION "\n"
+  "\n"
+  " Usage: valhalla_benchmark_primitives [options]\n"
+  "\n"
+  "valhalla_benchmark_primitives times the graph access, shape, distance, costing "
+  "and edge status primitives that routing spends most of its time in, over the "
+  "largest tiles of the configured tile set, and reports the time per operation."
+  "\n"
+  "\n");
+
+  options.add_options()
+    ("help,h", "Print this help message.")
+    ("version,v", "Print the version of this software.")
+    ("config,c", boost::program_options::value<boost::filesystem::path>(&config_file_path), "Path to the json configuration file.")
+    ("tiles,t", boost::program_options::value<size_t>(&tile_count), "How many of the largest tiles to run over, defaults to 16.")
+    ("seconds,s", boost::program_options::value<double>(&min_seconds), "Minimum time to run each case for, defaults to .5.")
+    ("filter,f", boost::program_options::value<std::string>(&filter), "Only run cases whose name contains this.")
+    ("output,o", boost::program_options::value<std::string>(&output_file), "Write the results as json to this file.")
+    ;
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc,argv)
+      .options(options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_benchmark_primitives " << VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (!vm.count("config")) {
+    std::cerr << "The <config> argument was not provided, but is mandatory\n\n";
+    std::cerr << options << "\n";
+    return EXIT_FAILURE;
+  }
+
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(config_file_path.c_str(), pt);
+  auto tiles = LoadTiles(pt);
+  if (tiles.empty()) {
+    LOG_ERROR("No tiles found in " + pt.get<std::string>("mjolnir.tile_dir"));
+    return EXIT_FAILURE;
+  }
+
+  //run them all
+  auto results = valhalla::baldr::json::array({});
+  for (const auto& c : MakeCases(tiles)) {
+    auto result = Measure(c);
+    LOG_INFO(result.name + ": " + std::to_string(result.ns_per_op) + " ns/op over " +
+             std::to_string(result.iterations) + " iterations");
+    results->push_back(valhalla::baldr::json::map({
+      {"name", result.name},
+      {"iterations", result.iterations},
+      {"ns_per_op", valhalla::baldr::json::fp_t{result.ns_per_op, 3}},
+    }));
+  }
+
+  if (!output_file.empty()) {
+    std::ofstream out(output_file);
+    out << *valhalla::baldr::json::map({
+      {"version", std::string(VERSION)},
+      {"tiles", static_cast<uint64_t>(tiles.size())},
+      {"benchmarks", results},
+    }) << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,337 @@
+#include "config.h"
+
+#include "tyr/actor.h"
+#include "baldr/json.h"
+#include "midgard/logging.h"
+#include "proto/directions_options.pb.h"
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/optional.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+using namespace valhalla;
+namespace bpo = boost::program_options;
+
+boost::filesystem::path config_file_path;
+size_t threads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+size_t passes = 1;
+bool cold = false;
+std::string default_action = "route";
+std::string output_file;
+std::string label;
+std::vector<std::string> input_files;
+
+//a request to replay and the action to replay it with
+struct job_t {
+  odin::DirectionsOptions::Action action;
+  std::string request;
+};
+std::vector<job_t> jobs;
+std::atomic<size_t> job_index(0);
+
+struct result_t {
+  odin::DirectionsOptions::Action action;
+  double ms;
+  bool pass;
+};
+using results_t = std::vector<result_t>;
+
+bool ParseArguments(int argc, char *argv[]) {
+
+  bpo::options_description options(
+    "benchmark_requests " VERSION "\n"
+    "\n"
+    " Usage: valhalla_benchmark_requests [options] <request_file> ...\n"
+    "\n"
+    "valhalla_benchmark_requests replays request files, like the ones in test_requests, "
+    "through every stage of the service in process across a number of threads and reports "
+    "the throughput and latency percentiles of each action. Each line of a file is a json "
+    "request, optionally preceded by -j as valhalla_run_route takes them, and optionally "
+    "preceded by the name of the action to run it with. Lines that are neither are skipped."
+    "\n"
+    "\n");
+
+  std::string mode = "warm";
+  options.add_options()
+      ("help,h", "Print this help message.")
+      ("version,v", "Print the version of this software.")
+      ("config,c", boost::program_options::value<boost::filesystem::path>(&config_file_path), "Path to the json configuration file.")
+      ("threads,t", boost::program_options::value<size_t>(&threads), "Concurrency to use.")
+      ("passes,p", boost::program_options::value<size_t>(&passes), "How many times to replay the requests for timing.")
+      ("mode,m", boost::program_options::value<std::string>(&mode), "warm replays everything once untimed before timing with the caches full, "
+          "cold times every request with empty caches by giving it a fresh set of workers.")
+      ("action,a", boost::program_options::value<std::string>(&default_action), "Action of requests that don't name one, defaults to route.")
+      ("output,o", boost::program_options::value<std::string>(&output_file), "Write the results as json to this file.")
+      ("label,l", boost::program_options::value<std::string>(&label), "Label to tag the results with, a commit hash for example.")
+      //positional arguments
+      ("input_files", boost::program_options::value<std::vector<std::string> >(&input_files)->multitoken());
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("input_files", 16);
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(), vm);
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what()
+      << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT
+      << "\n";
+    return false;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return false;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_benchmark_requests " << VERSION << "\n";
+    return false;
+  }
+
+  // argument checking and verification
+  for (auto arg : std::vector<std::string> { "config", "input_files" }) {
+    if (vm.count(arg) == 0) {
+      std::cerr << "The <" << arg << "> argument was not provided, but is mandatory\n\n";
+      std::cerr << options << "\n";
+      return false;
+    }
+  }
+
+  if (mode != "warm" && mode != "cold") {
+    std::cerr << "The mode must be warm or cold\n\n";
+    return false;
+  }
+  cold = mode == "cold";
+
+  odin::DirectionsOptions::Action action;
+  if (!odin::DirectionsOptions::Action_Parse(default_action, &action)) {
+    std::cerr << "Unknown action: " << default_action << "\n\n";
+    return false;
+  }
+
+  return true;
+}
+
+//turns a line of a request file into a job, false if there isnt one on it
+bool ParseJob(std::string line, job_t& job) {
+  auto trim = [&line]() {
+    line.erase(0, line.find_first_not_of(" \t\r"));
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+  };
+  trim();
+  //an action name may come first
+  odin::DirectionsOptions::Action_Parse(default_action, &job.action);
+  if(!line.empty() && line.front() != '-' && line.front() != '{') {
+    auto end = line.find_first_of(" \t");
+    if(!odin::DirectionsOptions::Action_Parse(line.substr(0, end), &job.action))
+      return false;
+    line.erase(0, end == std::string::npos ? end : end + 1);
+    trim();
+  }
+  //then the request as valhalla_run_route takes it
+  if(line.compare(0, 2, "-j") == 0) {
+    line.erase(0, 2);
+    trim();
+    if(line.size() > 1 && line.front() == '\'' && line.back() == '\'')
+      line = line.substr(1, line.size() - 2);
+  }
+  //or just the json
+  if(line.empty() || line.front() != '{')
+    return false;
+  job.request = std::move(line);
+  return true;
+}
+
+void work(const boost::property_tree::ptree& config, std::unique_ptr<tyr::actor_t>& actor,
+    std::promise<results_t>& promise) {
+  //warm mode keeps the same workers for everything, cold gets new ones each time
+  auto replay = [&config, &actor](const job_t& job) {
+    if(cold || !actor)
+      actor.reset(new tyr::actor_t(config));
+    auto start = std::chrono::steady_clock::now();
+    bool pass = true;
+    try {
+      valhalla_request_t request;
+      request.parse(job.request, job.action);
+      actor->act(request);
+    }
+    catch(...) {
+      pass = false;
+    }
+    auto end = std::chrono::steady_clock::now();
+    //not timed, this is what the service does between requests
+    actor->cleanup();
+    return result_t{job.action, std::chrono::duration<double, std::milli>(end - start).count(), pass};
+  };
+
+  //pull work off and do it
+  results_t results;
+  size_t i;
+  while((i = job_index.fetch_add(1)) < jobs.size())
+    results.emplace_back(replay(jobs[i]));
+
+  //return the statistics
+  promise.set_value(std::move(results));
+}
+
+//runs all the jobs across the threads, returning the results and how long it took
+std::pair<results_t, double> run(const boost::property_tree::ptree& config,
+    std::vector<std::unique_ptr<tyr::actor_t> >& actors) {
+  job_index = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  //start up the threads
+  std::list<std::thread> pool;
+  std::vector<std::promise<results_t> > pool_results(threads);
+  for(size_t i = 0; i < threads; ++i)
+    pool.emplace_back(work, std::cref(config), std::ref(actors[i]), std::ref(pool_results[i]));
+
+  //let the threads finish up
+  for(auto& thread : pool)
+    thread.join();
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  //grab all the results
+  results_t results;
+  for(auto& thread_results : pool_results) {
+    auto result = thread_results.get_future().get();
+    std::move(result.begin(), result.end(), std::back_inserter(results));
+  }
+  return std::make_pair(std::move(results), seconds);
+}
+
+int main(int argc, char** argv) {
+
+  if (!ParseArguments(argc, argv))
+    return EXIT_FAILURE;
+
+  //check what type of input we are getting
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(config_file_path.c_str(), pt);
+
+  //configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree = pt.get_child_optional("tyr.logging");
+  if(logging_subtree) {
+    auto logging_config = valhalla::midgard::ToMap<const boost::property_tree::ptree&,
+      std::unordered_map<std::string, std::string> >(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+
+  //fill up the queue with work
+  for(const auto& file : input_files) {
+    std::ifstream stream(file);
+    std::string line;
+    job_t job;
+    while(std::getline(stream, line)) {
+      if(ParseJob(line, job))
+        jobs.emplace_back(std::move(job));
+    }
+  }
+  if(jobs.empty()) {
+    LOG_ERROR("No requests found in the input files");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Replaying " + std::to_string(jobs.size()) + " requests " + std::to_string(passes) +
+    " time(s) with " + std::to_string(threads) + " threads and " + (cold ? "cold" : "warm") + " caches");
+
+  //each thread keeps its workers between passes so their caches stay warm
+  std::vector<std::unique_ptr<tyr::actor_t> > actors(threads);
+
+  //fill the caches without timing anything
+  if(!cold)
+    run(pt, actors);
+
+  //do the timed passes
+  results_t results;
+  double seconds = 0;
+  for(size_t p = 0; p < passes; ++p) {
+    auto pass = run(pt, actors);
+    std::move(pass.first.begin(), pass.first.end(), std::back_inserter(results));
+    seconds += pass.second;
+  }
+
+  //split them up by action
+  std::map<std::string, std::vector<double> > times;
+  std::map<std::string, size_t> failures;
+  for(const auto& result : results) {
+    const auto& action = odin::DirectionsOptions::Action_Name(result.action);
+    times[action].push_back(result.ms);
+    failures[action] += !result.pass;
+  }
+
+  //do some statistics
+  auto actions = baldr::json::map({});
+  for(auto& action : times) {
+    auto& ms = action.second;
+    std::sort(ms.begin(), ms.end());
+    auto percentile = [&ms](double p) {
+      auto rank = static_cast<size_t>(std::ceil(p * ms.size()));
+      return ms[std::max(rank, static_cast<size_t>(1)) - 1];
+    };
+    double total = 0;
+    for(auto t : ms)
+      total += t;
+    auto throughput = ms.size() / seconds;
+
+    LOG_INFO(action.first);
+    LOG_INFO("--------------------------------");
+    LOG_INFO("Total: " + std::to_string(ms.size()));
+    LOG_INFO("Failed: " + std::to_string(failures[action.first]));
+    LOG_INFO("Throughput: " + std::to_string(throughput) + " requests per second");
+    LOG_INFO("Mean: " + std::to_string(total / ms.size()) + "ms");
+    LOG_INFO("P50: " + std::to_string(percentile(.5)) + "ms");
+    LOG_INFO("P90: " + std::to_string(percentile(.9)) + "ms");
+    LOG_INFO("P99: " + std::to_string(percentile(.99)) + "ms");
+    LOG_INFO("Max: " + std::to_string(ms.back()) + "ms");
+    LOG_INFO("--------------------------------\n\n");
+
+    actions->emplace(action.first, baldr::json::map({
+      {"requests", static_cast<uint64_t>(ms.size())},
+      {"failures", static_cast<uint64_t>(failures[action.first])},
+      {"throughput", baldr::json::fp_t{throughput, 3}},
+      {"mean_ms", baldr::json::fp_t{total / ms.size(), 3}},
+      {"p50_ms", baldr::json::fp_t{percentile(.5), 3}},
+      {"p90_ms", baldr::json::fp_t{percentile(.9), 3}},
+      {"p95_ms", baldr::json::fp_t{percentile(.95), 3}},
+      {"p99_ms", baldr::json::fp_t{percentile(.99), 3}},
+      {"max_ms", baldr::json::fp_t{ms.back(), 3}},
+    }));
+  }
+
+  //so you can track them over time
+  if(!output_file.empty()) {
+    auto json = baldr::json::map({
+      {"version", std::string(VERSION)},
+      {"label", label},
+      {"mode", std::string(cold ? "cold" : "warm")},
+      {"threads", static_cast<uint64_t>(threads)},
+      {"passes", static_cast<uint64_t>(passes)},
+      {"requests", static_cast<uint64_t>(jobs.size())},
+      {"seconds", baldr::json::fp_t{seconds, 3}},
+      {"actions", actions},
+    });
+    std::ofstream out(output_file);
+    out << *json << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -9,9 +9,17 @@
 #include "midgard/logging.h"
 #include "skadi/sample.h"
 
-void get_samples(const valhalla::skadi::sample& sample, const std::list<std::pair<double, double> >& postings, size_t id) {
+void get_samples(const valhalla::skadi::sample& sample, const std::list<std::pair<double, double> >& postings, size_t id, bool batched) {
   LOG_INFO("Thread" + std::to_string(id) + " sampling " + std::to_string(postings.size()) + " postings");
-  auto values = sample.get_all(postings);
+  std::vector<double> values;
+  if(batched) {
+    values = sample.get_all(postings);
+  }
+  else {
+    values.reserve(postings.size());
+    for(const auto& posting : postings)
+      values.push_back(sample.get(posting));
+  }
   size_t no_data_value = 0;
   for(auto v : values)
     no_data_value += v == valhalla::skadi::sample::get_no_data_value();
@@ -49,16 +57,19 @@ int main(int argc, char** argv) {
   posting->pop_back();
   --posting_count;
 
-  //run the threads
-  auto start = std::chrono::system_clock::now();
-  std::list<std::thread> threads;
-  size_t id = 0;
-  for(const auto& p : postings)
-    threads.emplace_back(get_samples, std::cref(sample), std::cref(p), id++);
-  for(auto& t : threads)
-    t.join();
-  std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
-  LOG_INFO(std::to_string(posting_count / elapsed.count()) + " postings per second");
+  //run the threads, once sampling a posting at a time and once in batches
+  for(auto batched : {false, true}) {
+    auto start = std::chrono::system_clock::now();
+    std::list<std::thread> threads;
+    size_t id = 0;
+    for(const auto& p : postings)
+      threads.emplace_back(get_samples, std::cref(sample), std::cref(p), id++, batched);
+    for(auto& t : threads)
+      t.join();
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+    LOG_INFO(std::string(batched ? "Batched: " : "Single: ") +
+             std::to_string(posting_count / elapsed.count()) + " postings per second");
+  }
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/pathlocation.h"
+#include "baldr/tilehierarchy.h"
+#include "loki/search.h"
+#include "midgard/logging.h"
+#include "sif/autocost.h"
+#include "sif/costfactory.h"
+#include "thor/bidirectional_astar.h"
+#include "config.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+/**
+ * How far apart in memory the nodes and edges at either end of the edges
+ * within a local tile are, on average. An expansion goes from a node to the
+ * end nodes of its edges and then on to their edges so this is about how far
+ * it jumps through the tile at each step.
+ */
+void LogStrides(GraphReader& reader, const std::vector<GraphId>& tiles) {
+  double node_stride = 0.0, edge_stride = 0.0;
+  uint64_t count = 0;
+  for (const auto& tile_id : tiles) {
+    const GraphTile* tile = reader.GetGraphTile(tile_id);
+    if (tile == nullptr)
+      continue;
+    for (uint32_t i = 0; i < tile->header()->nodecount(); i++) {
+      const NodeInfo* node = tile->node(i);
+      for (uint32_t j = 0; j < node->edge_count(); j++) {
+        const DirectedEdge* edge = tile->directededge(node->edge_index() + j);
+        if (edge->endnode().Tile_Base() != tile_id)
+          continue;
+        const NodeInfo* end_node = tile->node(edge->endnode().id());
+        node_stride += std::abs(static_cast<double>(edge->endnode().id()) - i) * sizeof(NodeInfo);
+        edge_stride += std::abs(static_cast<double>(end_node->edge_index()) - node->edge_index()) *
+                       sizeof(DirectedEdge);
+        count++;
+      }
+    }
+    if (reader.OverCommitted())
+      reader.Clear();
+  }
+  LOG_INFO("Average node stride " + std::to_string(static_cast<uint64_t>(node_stride / count)) +
+           " bytes, edge stride " + std::to_string(static_cast<uint64_t>(edge_stride / count)) +
+           " bytes over " + std::to_string(count) + " edges");
+}
+
+int main(int argc, char *argv[]) {
+  std::string config;
+  uint32_t routes, seed;
+  float max_distance;
+  bpo::options_description options(
+  "valhalla " VERSION "\n"
+  "\n"
+  " Usage: valhalla_benchmark_tile_order [options]\n"
+  "\n"
+  "valhalla_benchmark_tile_order measures how the nodes and edges are laid out "
+  "within the local tiles and times a number of random auto routes with the "
+  "bidirectional a* between nodes of the tiles. Run it on a set of tiles built "
+  "with mjolnir.hilbert_order and one without to compare their locality."
+  "\n"
+  "\n");
+
+  options.add_options()
+    ("help,h", "Print this help message.")
+    ("version,v", "Print the version of this software.")
+    ("config,c", bpo::value<std::string>(&config)->required(), "Path to the json configuration file.")
+    ("routes,r", bpo::value<uint32_t>(&routes)->default_value(100), "Number of random routes to time.")
+    ("seed,s", bpo::value<uint32_t>(&seed)->default_value(1), "Seed of the random routes, the same seed picks the same nodes on tiles built from the same data.")
+    ("max_distance,d", bpo::value<float>(&max_distance)->default_value(100000.0f), "Longest crow flies distance in meters between the ends of a route.")
+    ;
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc,argv)
+      .options(options).run(), vm);
+    if (vm.count("help")) {
+      std::cout << options << "\n";
+      return EXIT_SUCCESS;
+    }
+    if (vm.count("version")) {
+      std::cout << "valhalla_benchmark_tile_order " << VERSION << "\n";
+      return EXIT_SUCCESS;
+    }
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what() << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT << "\n";
+    return EXIT_FAILURE;
+  }
+
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(config, pt);
+  GraphReader reader(pt.get_child("mjolnir"));
+
+  // The local tiles in order so a seed picks the same ones every time
+  auto tile_set = reader.GetTileSet(TileHierarchy::levels().rbegin()->first);
+  std::vector<GraphId> tiles(tile_set.begin(), tile_set.end());
+  std::sort(tiles.begin(), tiles.end());
+  if (tiles.empty()) {
+    LOG_ERROR("No local tiles in " + reader.tile_dir());
+    return EXIT_FAILURE;
+  }
+  LogStrides(reader, tiles);
+
+  // Pick the ends of the routes at random nodes. The nodes are picked by their
+  // position in the tile after sorting by location so that two sets of tiles
+  // built from the same data get the same routes however their nodes are laid out
+  std::mt19937 gen(seed);
+  auto random_node = [&reader, &tiles, &gen]() {
+    while (true) {
+      const GraphTile* tile = reader.GetGraphTile(tiles[gen() % tiles.size()]);
+      if (tile == nullptr || tile->header()->nodecount() == 0)
+        continue;
+      std::vector<PointLL> lls;
+      for (uint32_t i = 0; i < tile->header()->nodecount(); i++)
+        lls.push_back(tile->node(i)->latlng());
+      std::sort(lls.begin(), lls.end(), [](const PointLL& a, const PointLL& b) {
+        return a.lng() == b.lng() ? a.lat() < b.lat() : a.lng() < b.lng();
+      });
+      return lls[gen() % lls.size()];
+    }
+  };
+
+  std::shared_ptr<DynamicCost> mode_costing[4];
+  CostFactory<DynamicCost> factory;
+  factory.Register("auto", CreateAutoCost);
+  auto costing = factory.Create("auto", pt.get_child("costing_options.auto", {}));
+  auto mode = costing->travel_mode();
+  mode_costing[static_cast<uint32_t>(mode)] = costing;
+  BidirectionalAStar bd;
+  uint32_t found = 0;
+  double ms = 0.0;
+  for (uint32_t attempts = 0; found < routes && attempts < routes * 10; attempts++) {
+    Location origin(random_node()), dest(random_node());
+    if (origin.latlng_.Distance(dest.latlng_) > max_distance)
+      continue;
+    valhalla::odin::Location src, dst;
+    try {
+      auto projections = valhalla::loki::Search({origin, dest}, reader, costing->GetEdgeFilter(),
+                                                costing->GetNodeFilter());
+      PathLocation::toPBF(projections.at(origin), &src, reader);
+      PathLocation::toPBF(projections.at(dest), &dst, reader);
+    } catch (...) {
+      continue;
+    }
+
+    // Time the path algorithm only
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<PathInfo> path;
+    try {
+      path = bd.GetBestPath(src, dst, reader, mode_costing, mode);
+    } catch (...) {
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    bd.Clear();
+    if (path.empty())
+      continue;
+    ms += std::chrono::duration<double, std::milli>(end - start).count();
+    found++;
+  }
+  if (found == 0) {
+    LOG_ERROR("No routes found");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO(std::to_string(found) + " routes, bidirectional a* average " +
+           std::to_string(ms / found) + " ms");
+  return EXIT_SUCCESS;
+}
@@ -3,6 +3,7 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 
+#include "baldr/edgetracker.h"
 #include "baldr/graphconstants.h"
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
@@ -11,7 +12,11 @@
 
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <zlib.h>
 
 #include "config.h"
 
@@ -24,26 +29,12 @@ namespace bpo = boost::program_options;
 std::string column_separator{'\0'};
 std::string row_separator = "\n";
 std::string config;
+std::string output;
 bool ferries;
 bool unnamed;
 
 namespace {
 
-//a place we can mark what edges we've seen, even for the planet we should need < 100mb
-struct bitset_t {
-  bitset_t(size_t size) {bits.resize(std::ceil(size / 64.0));}
-  void set(const uint64_t id) {
-    if (id >= bits.size() * 64) throw std::runtime_error("id out of bounds");
-    bits[id / 64] |= static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64));
-  }
-  bool get(const uint64_t id) const {
-    if (id >= bits.size() * 64) throw std::runtime_error("id out of bounds");
-    return bits[id / 64] & (static_cast<uint64_t>(1) << (id % static_cast<uint64_t>(64)));
-  }
-protected:
-  std::vector<uint64_t> bits;
-};
-
 //often we need both the edge id and the directed edge, so lets have something to represent that
 struct edge_t {
   GraphId i;
@@ -71,8 +62,7 @@ edge_t opposing(GraphReader& reader, const GraphTile* tile, const DirectedEdge*
   return {id, t->directededge(id)};
 }
 
-edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set, const bitset_t& edge_set, GraphReader& reader,
-            const GraphTile*& tile, const edge_t& edge, const std::vector<std::string>& names) {
+edge_t next(const edge_tracker& tracker, GraphReader& reader, const GraphTile*& tile, const edge_t& edge, const std::vector<std::string>& names) {
   //get the right tile
   if(tile->id() != edge.e->endnode().Tile_Base())
     tile = reader.GetGraphTile(edge.e->endnode());
@@ -86,7 +76,7 @@ edge_t next(const std::unordered_map<GraphId, uint64_t>& tile_set, const bitset_
     GraphId id = tile->id();
     id.set_id(node->edge_index() + i);
     //already used
-    if(edge_set.get(tile_set.find(tile->id())->second + id.id()))
+    if(tracker.get(id))
       continue;
     edge_t candidate{id, tile->directededge(id)};
     //dont need these
@@ -122,125 +112,104 @@ void extend(GraphReader& reader, const GraphTile*& tile, const edge_t& edge, std
   shape.splice(shape.end(), more);
 }
 
+//marks an edge and its opposing edge, returning false if some other thread got them first. the
+//pair is always claimed through the same one of the two so that only one thread can ever win it
+bool claim(edge_tracker& tracker, const edge_t& edge, const edge_t& opposing) {
+  if(!opposing.e)
+    return !tracker.test_and_set(edge.i);
+  const auto& canonical = edge.i.value < opposing.i.value ? edge.i : opposing.i;
+  const auto& other = edge.i.value < opposing.i.value ? opposing.i : edge.i;
+  if(tracker.test_and_set(canonical))
+    return false;
+  tracker.set(other);
+  return true;
 }
 
-//program entry point
-int main(int argc, char *argv[]) {
-  bpo::options_description options("valhalla_export_edges " VERSION "\n"
-  "\n"
-  " Usage: valhalla_export_edges [options]\n"
-  "\n"
-  "valhalla_export_edges is a simple command line test tool which dumps information about each graph edge. "
-  "\n"
-  "\n");
-
-  options.add_options()
-      ("help,h", "Print this help message.")
-      ("version,v", "Print the version of this software.")
-      ("column,c", bpo::value<std::string>(&column_separator), "What separator to use between columns [default=\\0].")
-      ("row,r", bpo::value<std::string>(&column_separator), "What separator to use between row [default=\\n].")
-      ("ferries,f", "Export ferries as well [default=false]")
-      ("unnamed,u", "Export unnamed edges as well [default=false]")
-      // positional arguments
-      ("config", bpo::value<std::string>(&config), "Valhalla configuration file [required]");
-
-
-  bpo::positional_options_description pos_options;
-  pos_options.add("config", 1);
-  bpo::variables_map vm;
-  try {
-    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(), vm);
-    bpo::notify(vm);
-  }
-  catch (std::exception &e) {
-    std::cerr << "Unable to parse command line options because: " << e.what()
-              << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT
-              << "\n";
-    return EXIT_FAILURE;
+//where the rows go, either a gzip file per thread or batches written to stdout
+struct writer_t {
+  writer_t(size_t index) : file(nullptr) {
+    if(output.size()) {
+      auto file_name = output + "." + std::to_string(index) + ".gz";
+      file = gzopen(file_name.c_str(), "wb");
+      if(!file)
+        throw std::runtime_error("Could not open " + file_name + " for writing");
+    }
   }
-
-  if (vm.count("help") || !vm.count("config")) {
-    std::cout << options << "\n";
-    return EXIT_SUCCESS;
+  ~writer_t() {
+    flush();
+    if(file)
+      gzclose(file);
   }
-
-  if (vm.count("version")) {
-    std::cout << "valhalla_export_edges " << VERSION << "\n";
-    return EXIT_SUCCESS;
+  void write(const std::string& row) {
+    buffer.append(row);
+    if(buffer.size() > kBufferSize)
+      flush();
   }
-
-  bool ferries = vm.count("ferries");
-  bool unnamed = vm.count("unnamed");
-
-  //parse the config
-  boost::property_tree::ptree pt;
-  boost::property_tree::read_json(config.c_str(), pt);
-
-  //configure logging
-  valhalla::midgard::logging::Configure({{"type","std_err"},{"color","true"}});
-
-  //get something we can use to fetch tiles
-  valhalla::baldr::GraphReader reader(pt.get_child("mjolnir"));
-
-  //keep the global number of edges encountered at the point we encounter each tile
-  //this allows an edge to have a sequential global id and makes storing it very small
-  LOG_INFO("Enumerating edges...");
-  std::unordered_map<GraphId, uint64_t> tile_set(kMaxGraphTileId * TileHierarchy::levels().size());
-  uint64_t edge_count = 0;
-  for(const auto& level : TileHierarchy::levels()) {
-    for(uint32_t i = 0; i < level.second.tiles.TileCount(); ++i) {
-      GraphId tile_id{i, level.first, 0};
-      if(reader.DoesTileExist(tile_id)) {
-        //TODO: just read the header, parsing the whole thing isnt worth it at this point
-        tile_set.emplace(tile_id, edge_count);
-        const auto* tile = reader.GetGraphTile(tile_id);
-        edge_count += tile->header()->directededgecount();
-        reader.Clear();
-      }
+  void flush() {
+    if(buffer.empty())
+      return;
+    if(file) {
+      if(gzwrite(file, buffer.data(), buffer.size()) != static_cast<int>(buffer.size()))
+        throw std::runtime_error("Could not write the compressed output");
     }
+    else {
+      std::lock_guard<std::mutex> lock(stdout_lock);
+      std::cout.write(buffer.data(), buffer.size());
+      std::cout.flush();
+    }
+    buffer.clear();
   }
+protected:
+  static constexpr size_t kBufferSize = 1 << 20;
+  static std::mutex stdout_lock;
+  gzFile file;
+  std::string buffer;
+};
+std::mutex writer_t::stdout_lock;
 
-  //this is how we know what i've touched and what we havent
-  bitset_t edge_set(edge_count);
-
-  //TODO: we could parallelize this and it might be quite a bit faster but if we really want to maximize
-  //continuous edges we need to avoid the lady and the tramp scenario where two threads are consuming the same
-  //stretch of road at the same time
+//exports the edges of the tiles it takes from the shared list until there are none left
+void work(const boost::property_tree::ptree& pt, const std::vector<GraphId>& tiles,
+          std::atomic<size_t>& next_tile, edge_tracker& tracker, std::atomic<uint64_t>& set,
+          std::atomic<int>& progress, const uint64_t edge_count, const size_t index) {
+  //every thread has its own reader and its own output
+  GraphReader reader(pt.get_child("mjolnir"));
+  writer_t writer(index);
+  std::string row;
 
   //for each tile
-  LOG_INFO("Exporting " + std::to_string(edge_count) + " edges");
-  int progress = -1;
-  uint64_t set = 0;
-  for(const auto& tile_count_pair : tile_set) {
+  for(size_t n = next_tile++; n < tiles.size(); n = next_tile++) {
     //for each edge in the tile
-    reader.Clear();
-    const auto* tile = reader.GetGraphTile(tile_count_pair.first);
+    if(reader.OverCommitted())
+      reader.Trim();
+    const auto* tile = reader.GetGraphTile(tiles[n]);
+    uint64_t tile_set = 0;
     for(uint32_t i = 0; i < tile->header()->directededgecount(); ++i) {
       //we've seen this one already
-      if(edge_set.get(tile_count_pair.second + i))
+      GraphId edge_id = tiles[n];
+      edge_id.set_id(i);
+      if(tracker.get(edge_id))
         continue;
 
       //TODO: dont mark transition edges since we may need to use them to change levels multiple times
       //maybe we should mark them though once every normal edge connected there has been marked
 
-      //make sure we dont ever look at this again
-      edge_t edge{tile_count_pair.first, tile->directededge(i)};
-      edge.i.set_id(i);
-      edge_set.set(tile_count_pair.second + i);
-      ++set;
-
       //these wont have opposing edges that we care about
+      edge_t edge{edge_id, tile->directededge(i)};
       if(edge.e->trans_up() || edge.e->use() == Use::kTransitConnection ||
-         edge.e->trans_down() || edge.e->IsTransitLine()) //these 2 should never happen
+         edge.e->trans_down() || edge.e->IsTransitLine()) { //these 2 should never happen
+        if(!tracker.test_and_set(edge.i))
+          ++tile_set;
         continue;
+      }
 
-      //get the opposing edge as well (ensure a valid edge is returned)
+      //make sure we dont ever look at this or its opposing edge again
       edge_t opposing_edge = opposing(reader, tile, edge);
+      if(!claim(tracker, edge, opposing_edge))
+        continue;
+      tile_set += opposing_edge.e ? 2 : 1;
       if (opposing_edge.e == nullptr) {
         continue;
       }
-      edge_set.set(tile_set.find(opposing_edge.i.Tile_Base())->second + opposing_edge.i.id());
-      ++set;
 
       //shortcuts arent real and maybe we dont want ferries
       if(edge.e->is_shortcut() || (!ferries && edge.e->use() == Use::kFerry))
@@ -263,32 +232,34 @@ int main(int argc, char *argv[]) {
       //keep some state about this section of road
       std::list<edge_t> edges {edge};
 
-      //go forward
+      //go forward, stopping where another thread has already taken the road (the lady and the tramp)
       const auto* t = tile;
-      while((edge = next(tile_set, edge_set, reader, t, edge, names))) {
+      while((edge = next(tracker, reader, t, edge, names))) {
         //mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
         edge_t other = opposing(reader, t, edge);
+        if(!claim(tracker, edge, other))
+          break;
         if (other.e == nullptr) {
+          ++tile_set;
           continue;
         }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
+        tile_set += 2;
         //keep this
         edges.push_back(edge);
       }
 
       //go backward
       edge = opposing_edge;
-      while((edge = next(tile_set, edge_set, reader, t, edge, names))) {
+      while((edge = next(tracker, reader, t, edge, names))) {
         //mark them to never be used again
-        edge_set.set(tile_set.find(edge.i.Tile_Base())->second + edge.i.id());
         edge_t other = opposing(reader, t, edge);
+        if(!claim(tracker, edge, other))
+          break;
         if (other.e == nullptr) {
+          ++tile_set;
           continue;
         }
-        edge_set.set(tile_set.find(other.i.Tile_Base())->second + other.i.id());
-        set += 2;
+        tile_set += 2;
         //keep this
         edges.push_front(other);
       }
@@ -299,24 +270,124 @@ int main(int argc, char *argv[]) {
         extend(reader, t, e, shape);
 
       //output it as: shape,name,name,...
-      auto encoded = encode(shape);
-      std::cout << encoded << column_separator;
-      for(const auto& name : names)
-        std::cout << name << (&name == &names.back() ? "" : column_separator);
-      std::cout << row_separator;
-      std::cout.flush();
-
+      row = encode(shape);
+      row += column_separator;
+      for(const auto& name : names) {
+        row += name;
+        if(&name != &names.back())
+          row += column_separator;
+      }
+      row += row_separator;
+      writer.write(row);
     }
 
     //check progress
-    int procent = (100.f * set) / edge_count;
-    if(procent > progress)
-      LOG_INFO(std::to_string(progress = procent) + "%");
+    int procent = (100.f * (set += tile_set)) / edge_count;
+    int last = progress.load();
+    while(procent > last && !progress.compare_exchange_weak(last, procent));
+    if(procent > last)
+      LOG_INFO(std::to_string(procent) + "%");
+  }
+}
+
+}
+
+//program entry point
+int main(int argc, char *argv[]) {
+  unsigned int num_threads = std::max(1U, std::thread::hardware_concurrency());
+  bpo::options_description options("valhalla_export_edges " VERSION "\n"
+  "\n"
+  " Usage: valhalla_export_edges [options]\n"
+  "\n"
+  "valhalla_export_edges is a simple command line test tool which dumps information about each graph edge. "
+  "\n"
+  "\n");
+
+  options.add_options()
+      ("help,h", "Print this help message.")
+      ("version,v", "Print the version of this software.")
+      ("column,c", bpo::value<std::string>(&column_separator), "What separator to use between columns [default=\\0].")
+      ("row,r", bpo::value<std::string>(&row_separator), "What separator to use between row [default=\\n].")
+      ("ferries,f", "Export ferries as well [default=false]")
+      ("unnamed,u", "Export unnamed edges as well [default=false]")
+      ("output,o", bpo::value<std::string>(&output), "Write gzipped rows to OUTPUT.N.gz, one file per thread, instead of to stdout.")
+      ("concurrency,j", bpo::value<unsigned int>(&num_threads), "Number of threads to use.")
+      // positional arguments
+      ("config", bpo::value<std::string>(&config), "Valhalla configuration file [required]");
+
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("config", 1);
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(pos_options).run(), vm);
+    bpo::notify(vm);
+  }
+  catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what()
+              << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT
+              << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help") || !vm.count("config")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_export_edges " << VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  ferries = vm.count("ferries");
+  unnamed = vm.count("unnamed");
+  num_threads = std::max(1U, num_threads);
+
+  //parse the config
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(config.c_str(), pt);
+
+  //configure logging
+  valhalla::midgard::logging::Configure({{"type","std_err"},{"color","true"}});
+
+  //get something we can use to fetch tiles
+  valhalla::baldr::GraphReader reader(pt.get_child("mjolnir"));
+
+  //keep the global number of edges encountered at the point we encounter each tile
+  //this allows an edge to have a sequential global id and makes storing it very small
+  LOG_INFO("Enumerating edges...");
+  std::vector<GraphId> tiles;
+  for(const auto& level : TileHierarchy::levels()) {
+    for(uint32_t i = 0; i < level.second.tiles.TileCount(); ++i) {
+      GraphId tile_id{i, level.first, 0};
+      if(reader.DoesTileExist(tile_id))
+        tiles.push_back(tile_id);
+    }
   }
+  auto tracker = edge_tracker::create(tiles, reader);
+  //the tiles were numbered in order so the last one ends the range
+  uint64_t edge_count = tiles.empty() ? 0 : tracker.m_edges_in_tiles[tiles.back()] +
+                        reader.GetGraphTile(tiles.back())->header()->directededgecount();
+  reader.Clear();
+
+  //split the tiles up between the threads, they all mark the edges they take in the same tracker
+  //so that no edge is exported twice. where two threads meet on the same stretch of road each one
+  //just stops at the edges the other has already taken
+  LOG_INFO("Exporting " + std::to_string(edge_count) + " edges with " + std::to_string(num_threads) + " threads");
+  std::atomic<size_t> next_tile(0);
+  std::atomic<uint64_t> set(0);
+  std::atomic<int> progress(-1);
+  std::vector<std::thread> threads;
+  for(size_t i = 0; i < num_threads; ++i)
+    threads.emplace_back(work, std::cref(pt), std::cref(tiles), std::ref(next_tile), std::ref(tracker),
+                         std::ref(set), std::ref(progress), edge_count, i);
+  for(auto& thread : threads)
+    thread.join();
   LOG_INFO("Done");
 
   for(uint64_t i = 0; i < edge_count; ++i) {
-    if(!edge_set.get(i)) {
+    if(!tracker.m_edge_set.get(i)) {
       LOG_INFO(std::to_string(i));
       break;
     }
@@ -12,6 +12,8 @@
 #include <lz4hc.h>
 #include <lz4frame.h>
 
+#include "skadi/block_hgt.h"
+
 constexpr size_t HGT_BYTES = 3601 * 3601 * 2;
 
 long file_size(const std::string& file_name) {
@@ -147,6 +149,7 @@ int main(int argc, char** argv){
   if(argc < 2)
     return 0;
   //TODO: add arguments to this
+  bool blocks = argc > 2 && std::string(argv[2]) == "--blocks";
 
   std::string file_name(argv[1]);
   auto tile = read_file(file_name, file_size(file_name));
@@ -154,6 +157,14 @@ int main(int argc, char** argv){
   if(file_name.find(".lz4") == file_name.size() - 4) {
     tile = lunzip(tile, algorithm_t::HIGH);
     write_file(file_name.substr(0, file_name.size() - 4), tile);
+  }//test the file for proper block encoding
+  else if(file_name.find(".blk") == file_name.size() - 4) {
+    if(!valhalla::skadi::block_hgt::valid(tile.data(), tile.size()))
+      throw std::runtime_error("Corrupt block elevation data");
+    std::vector<char> out(HGT_BYTES);
+    for(size_t b = 0; b < valhalla::skadi::block_hgt::kBlockCount; ++b)
+      valhalla::skadi::block_hgt::unpack(tile.data(), b, static_cast<int16_t*>(static_cast<void*>(out.data())));
+    write_file(file_name.substr(0, file_name.size() - 4), out);
   }//compress an existing file
   else {
     //gunzip it
@@ -161,9 +172,17 @@ int main(int argc, char** argv){
       tile = gunzip(tile);
       file_name = file_name.substr(0, file_name.size() - 3);
     }
-    //lzip it
-    tile = lzip(tile, 9, algorithm_t::HIGH);
-    write_file(file_name + ".lz4", tile);
+    //split it into blocks that are compressed on their own
+    if(blocks) {
+      if(tile.size() != HGT_BYTES)
+        throw std::runtime_error("Wrong size elevation data: " + file_name);
+      tile = valhalla::skadi::block_hgt::pack(static_cast<const int16_t*>(static_cast<const void*>(tile.data())));
+      write_file(file_name + ".blk", tile);
+    }//lzip it
+    else {
+      tile = lzip(tile, 9, algorithm_t::HIGH);
+      write_file(file_name + ".lz4", tile);
+    }
   }
 
   return 0;
@@ -1,6 +1,14 @@
 #include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -14,6 +22,7 @@
 #include "baldr/pathlocation.h"
 #include "baldr/graphid.h"
 #include "midgard/encoded.h"
+#include "midgard/logging.h"
 #include "loki/search.h"
 #include "sif/costfactory.h"
 #include "meili/map_matcher.h"
@@ -31,6 +40,25 @@ using namespace valhalla::midgard;
 
 namespace bpo = boost::program_options;
 
+// Cost of an edge and of the transition onto it from the edge before it,
+// there is none onto the first edge of a path
+void cost_edge(GraphReader& reader, const cost_ptr_t& costing, const GraphId& current_id,
+               const GraphId& pred_id, Cost& edge_cost, Cost& trans_cost) {
+  auto tile = reader.GetGraphTile(current_id);
+  auto edge = tile->directededge(current_id);
+  trans_cost = {};
+  if (pred_id != kInvalidGraphId) {
+    auto pred_tile = reader.GetGraphTile(pred_id);
+    auto pred_edge = pred_tile->directededge(pred_id);
+    auto node_id = pred_edge->endnode();
+    auto node_tile = reader.GetGraphTile (node_id);
+    auto node = node_tile->node(node_id);
+    EdgeLabel pred_label (0, pred_id, pred_edge, {}, 0.0f, 0.0f, static_cast<TravelMode>(0), 0);
+    trans_cost = costing->TransitionCost(edge, node, pred_label);
+  }
+  edge_cost = costing->EdgeCost(edge);
+}
+
 void print_edge(GraphReader& reader, cost_ptr_t costing, const GraphId& current_id,
                 GraphId& pred_id, Cost& edge_total, Cost& trans_total, uint64_t& current_osmid) {
   //std::cout << "id: " << current_id << "\n";
@@ -47,17 +75,11 @@ void print_edge(GraphReader& reader, cost_ptr_t costing, const GraphId& current_
     std::cout << "+++++++++++++++++++++++++++++++++++++\n\n";
   }
 
+  Cost edge_cost, trans_cost;
+  cost_edge(reader, costing, current_id, pred_id, edge_cost, trans_cost);
   if (pred_id != kInvalidGraphId) {
-    auto pred_tile = reader.GetGraphTile(pred_id);
-    auto pred_edge = pred_tile->directededge(pred_id);
-    auto predinfo = tile->edgeinfo(pred_edge->edgeinfo_offset());
-    auto node_id = pred_edge->endnode();
-    auto node_tile = reader.GetGraphTile (node_id);
-    auto node = node_tile->node(node_id);
-    EdgeLabel pred_label (0, pred_id, pred_edge, {}, 0.0f, 0.0f, static_cast<TravelMode>(0), 0);
     std::cout << "-------Transition-------\n";
     std::cout << "Pred GraphId: " << pred_id << std::endl;
-    Cost trans_cost = costing->TransitionCost(edge, node, pred_label);
     trans_total += trans_cost;
     std::cout << "TransitionCost cost: " << trans_cost.cost;
     std::cout << " secs: " << trans_cost.secs << "\n";
@@ -68,16 +90,13 @@ void print_edge(GraphReader& reader, cost_ptr_t costing, const GraphId& current_
   std::cout << "----------Edge----------\n";
   std::cout << "Edge GraphId: " << current_id << std::endl;
   std::cout << "Edge length: " << edge->length() << std::endl;
-  Cost edge_cost = costing->EdgeCost(edge);
   edge_total += edge_cost;
   std::cout << "EdgeCost cost: " << edge_cost.cost << " secs: " << edge_cost.secs << "\n";
   std::cout << "------------------------\n\n";
 }
 
-void walk_edges(const std::string& shape, GraphReader& reader, const std::string& routetype,
-                boost::property_tree::ptree& pt) {
-  // Register edge/node costing methods
-  CostFactory<DynamicCost> factory;
+// Registers the costing methods paths can be costed with
+void register_costings(CostFactory<DynamicCost>& factory) {
   factory.Register("auto", CreateAutoCost);
   factory.Register("auto_shorter", CreateAutoShorterCost);
   factory.Register("bus", CreateBusCost);
@@ -87,6 +106,13 @@ void walk_edges(const std::string& shape, GraphReader& reader, const std::string
   factory.Register("pedestrian", CreatePedestrianCost);
   factory.Register("transit", CreateTransitCost);
   factory.Register("truck", CreateTruckCost);
+}
+
+void walk_edges(const std::string& shape, GraphReader& reader, const std::string& routetype,
+                boost::property_tree::ptree& pt) {
+  // Register edge/node costing methods
+  CostFactory<DynamicCost> factory;
+  register_costings(factory);
 
   std::string method_options = "costing_options." + routetype;
   auto costing_options = pt.get_child(method_options, {});
@@ -153,6 +179,216 @@ void walk_edges(const std::string& shape, GraphReader& reader, const std::string
   std::cout << "\n\n";
 }
 
+// Totals of the paths of a batch under the costing and the one compared to it
+struct comparison_t {
+  size_t paths = 0;
+  size_t failed = 0;
+  double cost = 0.0;
+  double secs = 0.0;
+  double compare_cost = 0.0;
+  double compare_secs = 0.0;
+  double abs_cost_delta = 0.0;
+  double abs_secs_delta = 0.0;
+
+  void add(const Cost& path, const Cost& compare_path) {
+    ++paths;
+    cost += path.cost;
+    secs += path.secs;
+    compare_cost += compare_path.cost;
+    compare_secs += compare_path.secs;
+    abs_cost_delta += std::abs(compare_path.cost - path.cost);
+    abs_secs_delta += std::abs(compare_path.secs - path.secs);
+  }
+
+  void add(const comparison_t& other) {
+    paths += other.paths;
+    failed += other.failed;
+    cost += other.cost;
+    secs += other.secs;
+    compare_cost += other.compare_cost;
+    compare_secs += other.compare_secs;
+    abs_cost_delta += other.abs_cost_delta;
+    abs_secs_delta += other.abs_secs_delta;
+  }
+};
+
+// The edges of a shape, walked with the route matcher or, should the shape
+// not follow edges exactly, map matched with meili
+std::vector<GraphId> match_edges(const std::string& shape, MapMatcherFactory& matcher_factory,
+                                 MapMatcher& matcher, const cost_ptr_t* mode_costing,
+                                 const TravelMode mode) {
+  GraphReader& reader = matcher_factory.graphreader();
+  std::vector<PointLL> shape_pts = decode<std::vector<PointLL> >(shape);
+  if (shape_pts.size() <= 1) {
+    return {};
+  }
+
+  // Walk the edges from the locations of the first and last shape point
+  std::vector<Measurement> measurements;
+  for (const auto& ll : shape_pts) {
+    measurements.emplace_back(Measurement{ll, 10, 10});
+  }
+  cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
+  std::vector<Location> locations{shape_pts.front(), shape_pts.back()};
+  const auto projections = Search(locations, reader, cost->GetEdgeFilter(), cost->GetNodeFilter());
+  std::vector<GraphId> edges;
+  if (projections.size() == locations.size() || shape_pts.front() == shape_pts.back()) {
+    valhalla::odin::DirectionsOptions directions_options;
+    for (const auto& loc : locations) {
+      PathLocation::toPBF(projections.at(loc), directions_options.mutable_locations()->Add(), reader);
+    }
+    std::vector<PathInfo> path_infos;
+    if (RouteMatcher::FormPath(mode_costing, mode, reader, measurements,
+                               directions_options.locations(), path_infos)) {
+      for (const auto& path_info : path_infos) {
+        if (edges.empty() || edges.back() != path_info.edgeid) {
+          edges.push_back(path_info.edgeid);
+        }
+      }
+      return edges;
+    }
+  }
+
+  // Otherwise map match it
+  measurements.clear();
+  for (const auto& ll : shape_pts) {
+    measurements.emplace_back(Measurement{ll,
+        matcher.config().get<float>("gps_accuracy") + 10,
+        matcher.config().get<float>("search_radius") + 10});
+  }
+  auto matches = matcher.OfflineMatch(measurements);
+  if (!matches.empty()) {
+    for (const auto edge : matches.front().edges) {
+      GraphId id(edge);
+      if (id.Is_Valid()) {
+        edges.push_back(id);
+      }
+    }
+  }
+  return edges;
+}
+
+// Cost of the edges and transitions along a path
+Cost path_cost(GraphReader& reader, const cost_ptr_t& costing, const std::vector<GraphId>& edges) {
+  Cost total;
+  GraphId pred_id;
+  for (const auto& current_id : edges) {
+    Cost edge_cost, trans_cost;
+    cost_edge(reader, costing, current_id, pred_id, edge_cost, trans_cost);
+    total += edge_cost + trans_cost;
+    pred_id = current_id;
+  }
+  return total;
+}
+
+// Costs the shapes of a batch on a thread, taking the next one not yet taken
+// until there are none left. The readers of the threads share one tile cache
+void compare_paths(const boost::property_tree::ptree& config, boost::property_tree::ptree request,
+                   boost::property_tree::ptree compare_request, const std::vector<std::string>& shapes,
+                   std::atomic<size_t>& next, std::ostream* out, std::mutex& mutex,
+                   comparison_t& comparison) {
+  CostFactory<DynamicCost> factory;
+  register_costings(factory);
+  std::string routetype = request.get<std::string>("costing");
+  cost_ptr_t costing = factory.Create(routetype, request.get_child("costing_options." + routetype, {}));
+  std::string compare_type = compare_request.get<std::string>("costing", routetype);
+  cost_ptr_t compare_costing = factory.Create(compare_type,
+      compare_request.get_child("costing_options." + compare_type, {}));
+  TravelMode mode = costing->travel_mode();
+  cost_ptr_t mode_costing[10];
+  mode_costing[static_cast<uint32_t>(mode)] = costing;
+
+  MapMatcherFactory matcher_factory(config);
+  std::shared_ptr<MapMatcher> matcher(matcher_factory.Create(routetype, config));
+  GraphReader& reader = matcher_factory.graphreader();
+
+  comparison_t local;
+  size_t i;
+  while ((i = next.fetch_add(1)) < shapes.size()) {
+    std::vector<GraphId> edges;
+    try {
+      edges = match_edges(shapes[i], matcher_factory, *matcher, mode_costing, mode);
+    } catch (std::exception& e) {
+      LOG_ERROR("Path " + std::to_string(i) + " failed: " + e.what());
+    }
+    matcher_factory.ClearFullCache();
+    if (edges.empty()) {
+      ++local.failed;
+      if (out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        *out << i << ",fail_no_match,0,0,0,0,0\n";
+      }
+      continue;
+    }
+    Cost cost = path_cost(reader, costing, edges);
+    Cost compare_cost = path_cost(reader, compare_costing, edges);
+    local.add(cost, compare_cost);
+    if (out) {
+      std::lock_guard<std::mutex> lock(mutex);
+      *out << i << ",success," << edges.size() << "," << cost.cost << "," << cost.secs << ","
+           << compare_cost.cost << "," << compare_cost.secs << "\n";
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  comparison.add(local);
+}
+
+// Costs every shape of a batch file, one polyline6 encoded shape per line,
+// under the costing of the request and the one it is compared to
+int compare_batch(boost::property_tree::ptree config, const boost::property_tree::ptree& request,
+                  const boost::property_tree::ptree& compare_request, const std::string& batch_file,
+                  const std::string& output_file, const unsigned int threads) {
+  std::ifstream in(batch_file);
+  if (!in)
+    throw std::runtime_error("Could not open batch file " + batch_file);
+  std::vector<std::string> shapes;
+  std::string line;
+  while (std::getline(in, line)) {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (!line.empty())
+      shapes.emplace_back(std::move(line));
+  }
+
+  std::ofstream out;
+  if (!output_file.empty()) {
+    out.open(output_file);
+    if (!out)
+      throw std::runtime_error("Could not open " + output_file);
+    out << "id,status,edges,cost,secs,compare_cost,compare_secs\n";
+  }
+
+  // All the threads go through one tile cache
+  if (!config.get<bool>("mjolnir.global_sharded_cache", false))
+    config.put("mjolnir.global_synchronized_cache", true);
+
+  std::atomic<size_t> next(0);
+  std::mutex mutex;
+  comparison_t comparison;
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < threads; ++i) {
+    workers.emplace_back(compare_paths, std::cref(config), request, compare_request, std::cref(shapes),
+                         std::ref(next), output_file.empty() ? nullptr : &out, std::ref(mutex),
+                         std::ref(comparison));
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  double cost_delta = comparison.compare_cost - comparison.cost;
+  double secs_delta = comparison.compare_secs - comparison.secs;
+  double n = std::max<size_t>(comparison.paths, 1);
+  std::cout << "+------------------------------------------------------------------------+\n";
+  std::cout << "| Paths Compared        : " << std::setw(10) << comparison.paths << "  Paths Not Matched     : " << std::setw(10) << comparison.failed << " |\n";
+  std::cout << "| Total Cost            : " << std::setw(10) << comparison.cost << "  Total Secs            : " << std::setw(10) << comparison.secs << " |\n";
+  std::cout << "| Compared Total Cost   : " << std::setw(10) << comparison.compare_cost << "  Compared Total Secs   : " << std::setw(10) << comparison.compare_secs << " |\n";
+  std::cout << "| Total Cost Delta      : " << std::setw(10) << cost_delta << "  Total Secs Delta      : " << std::setw(10) << secs_delta << " |\n";
+  std::cout << "| Mean Cost Delta       : " << std::setw(10) << cost_delta / n << "  Mean Secs Delta       : " << std::setw(10) << secs_delta / n << " |\n";
+  std::cout << "| Mean Abs Cost Delta   : " << std::setw(10) << comparison.abs_cost_delta / n << "  Mean Abs Secs Delta   : " << std::setw(10) << comparison.abs_secs_delta / n << " |\n";
+  std::cout << "+------------------------------------------------------------------------+\n";
+  return EXIT_SUCCESS;
+}
+
 // Main method for testing a single path
 int main(int argc, char *argv[]) {
   bpo::options_description options("valhalla_path_comparison " VERSION "\n"
@@ -163,9 +399,16 @@ int main(int argc, char *argv[]) {
   "\n"
   "Use the -j option for specifying the locations or the -s option to enter an encoded shape."
   "\n"
+  "Use the -b option to cost a batch file of polyline6 encoded shapes, one per line, across "
+  "threads sharing one tile cache instead. Each shape is walked or map matched and costed under "
+  "the costing of -t or -j and under the one of --compare, a request with a costing and its "
+  "options, and the totals and deltas over the batch are printed."
+  "\n"
   "\n");
 
   std::string routetype, json, shape, config;
+  std::string batch_file, compare_json, output_file;
+  unsigned int threads = std::max(1U, std::thread::hardware_concurrency());
 
   options.add_options()("help,h", "Print this help message.")(
       "version,v", "Print the version of this software.")(
@@ -175,6 +418,10 @@ int main(int argc, char *argv[]) {
       "json,j",
       boost::program_options::value<std::string>(&json),
       R"(JSON Example: {"paths":[[{"lat":12.47,"lon":15.2},{"lat":12.46,"lon":15.21}],[{"lat":12.36,"lon":15.17},{"lat":12.37,"lon":15.18}]],"costing":"bicycle","costing_options":{"bicycle":{"use_roads":0.55,"use_hills":0.1}}})")
+      ("batch,b", bpo::value<std::string>(&batch_file), "Cost the shapes of this file.")
+      ("compare", bpo::value<std::string>(&compare_json), R"(Costing to compare a batch to, for example: {"costing":"bicycle","costing_options":{"bicycle":{"use_roads":0.3}}})")
+      ("threads", bpo::value<unsigned int>(&threads), "Number of threads to cost a batch with.")
+      ("output", bpo::value<std::string>(&output_file), "File to write the costs of each path of a batch to as csv.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file");
 
@@ -208,6 +455,28 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
   }
 
+  // Cost the shapes of a batch file rather than the paths of a request
+  if (vm.count("batch")) {
+    boost::property_tree::ptree request, compare_request;
+    if (vm.count("json")) {
+      std::stringstream stream(json);
+      boost::property_tree::read_json(stream, request);
+    }
+    if (!routetype.empty() && !request.count("costing"))
+      request.put("costing", routetype);
+    if (!request.count("costing") || config.empty()) {
+      std::cerr << "The <type> and <config> arguments are mandatory with a batch\n\n" << options << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (vm.count("compare")) {
+      std::stringstream stream(compare_json);
+      boost::property_tree::read_json(stream, compare_request);
+    }
+    boost::property_tree::ptree pt;
+    boost::property_tree::read_json(config.c_str(), pt);
+    return compare_batch(pt, request, compare_request, batch_file, output_file, std::max(1U, threads));
+  }
+
   // Path Traces
   std::vector<std::vector<valhalla::baldr::Location>> paths;
 
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/optional.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/pathlocation.h"
+#include "loki/search.h"
+#include "sif/costfactory.h"
+#include "midgard/logging.h"
+#include "thor/isochrone.h"
+#include "tyr/serializers.h"
+
+#include "config.h"
+
+using namespace valhalla::midgard;
+using namespace valhalla::baldr;
+using namespace valhalla::loki;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace bpo = boost::program_options;
+
+namespace {
+
+// What every isochrone of the batch is drawn with
+struct batch_t {
+  std::string routetype;
+  boost::property_tree::ptree request;
+  std::vector<float> contour_times;
+  std::unordered_map<float, std::string> colors;
+  bool polygons;
+  bool show_locations;
+  bool reverse;
+  float denoise;
+  float generalize;
+  std::vector<Location> origins;
+};
+
+// Isochrones are written in the order of their origins, those done early
+// wait here for the ones before them
+class ordered_writer_t {
+ public:
+  ordered_writer_t(std::ostream& out) : out_(out), next_(0), written_(0) {
+  }
+
+  // Keep the geojson of an origin, empty if it failed, and write out all
+  // the ones that are now next in line
+  void write(const size_t index, std::string geojson) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.emplace(index, std::move(geojson));
+    for (auto next = pending_.begin(); next != pending_.end() && next->first == next_;
+         next = pending_.erase(next), ++next_) {
+      if (!next->second.empty()) {
+        out_ << next->second << '\n';
+        ++written_;
+      }
+    }
+  }
+
+  size_t written() const {
+    return written_;
+  }
+
+ protected:
+  std::ostream& out_;
+  std::mutex mutex_;
+  std::map<size_t, std::string> pending_;
+  size_t next_;
+  size_t written_;
+};
+
+// Returns the costing method (created from the dynamic cost factory).
+// Get the costing options. Merge in any request costing options that
+// override those in the config.
+valhalla::sif::cost_ptr_t get_costing(CostFactory<DynamicCost>& factory,
+                                      const boost::property_tree::ptree& request,
+                                      const std::string& costing) {
+  std::string method_options = "costing_options." + costing;
+  auto costing_options = request.get_child(method_options, {});
+  return factory.Create(costing, costing_options);
+}
+
+// Draw the isochrones of the origins handed out to this thread. The graph
+// reader, costing and isochrone are kept from one origin to the next.
+void work(const boost::property_tree::ptree& config, const batch_t& batch,
+          std::atomic<size_t>& next_origin, ordered_writer_t& writer) {
+  GraphReader reader(config.get_child("mjolnir"));
+  CostFactory<DynamicCost> factory;
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("truck", CreateTruckCost);
+  factory.Register("transit", CreateTransitCost);
+  std::shared_ptr<DynamicCost> mode_costing[4];
+  auto cost = get_costing(factory, batch.request, batch.routetype);
+  TravelMode mode = cost->travel_mode();
+  mode_costing[static_cast<uint32_t>(mode)] = cost;
+  Isochrone isochrone;
+
+  for (size_t i = next_origin++; i < batch.origins.size(); i = next_origin++) {
+    std::string geojson;
+    try {
+      // Find the edges of the origin
+      const auto& origin = batch.origins[i];
+      const auto projections = Search({origin}, reader, cost->GetEdgeFilter(), cost->GetNodeFilter());
+      valhalla::valhalla_request_t request;
+      PathLocation::toPBF(projections.at(origin), request.options.mutable_locations()->Add(), reader);
+
+      // Draw the isotile 10 minutes beyond the highest contour, as the
+      // isochrone service does, and turn it into contours
+      auto& locations = *request.options.mutable_locations();
+      auto max_minutes = batch.contour_times.back() + 10;
+      auto isotile = batch.reverse ?
+          isochrone.ComputeReverse(locations, max_minutes, reader, mode_costing, mode) :
+          isochrone.Compute(locations, max_minutes, reader, mode_costing, mode);
+      auto contours = isotile->GenerateContours(batch.contour_times, batch.polygons,
+                                                batch.denoise, batch.generalize);
+      geojson = valhalla::tyr::serializeIsochrones<PointLL>(request, contours, batch.polygons,
+                                                             batch.colors, batch.show_locations);
+    }
+    catch (const std::exception& e) {
+      LOG_WARN("No isochrone for origin " + std::to_string(i) + ": " + e.what());
+    }
+    isochrone.Clear();
+    writer.write(i, std::move(geojson));
+  }
+}
+
+}
+
+// Draw the isochrones of many origins at once
+int main(int argc, char *argv[]) {
+  bpo::options_description options("valhalla_run_isochrones " VERSION "\n"
+  "\n"
+  " Usage: valhalla_run_isochrones [options]\n"
+  "\n"
+  "valhalla_run_isochrones draws the isochrones of many origins, one per line of the "
+  "input file as lat,lng, on threads of their own. Each line of the output is the "
+  "geojson of an origin's isochrone, in the order of the input. Set "
+  "mjolnir.global_sharded_cache in the configuration so that the threads share tiles."
+  "\n"
+  "\n");
+
+  batch_t batch;
+  batch.polygons = false;
+  batch.show_locations = false;
+  batch.reverse = false;
+  batch.denoise = 1.f;
+  batch.generalize = kOptimalGeneralization;
+  size_t n_contours = 4;
+  unsigned int max_minutes = 60;
+  size_t threads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+  std::string json, config, input_file, filename;
+  options.add_options()("help,h", "Print this help message.")(
+      "version,v", "Print the version of this software.")(
+      "input,i", bpo::value<std::string>(&input_file),
+      "File with an origin per line: lat,lng,[through|stop],[name],...")(
+      "type,t", bpo::value<std::string>(&batch.routetype),
+      "Route Type: auto|bicycle|pedestrian|auto-shorter")(
+      "json,j", bpo::value<std::string>(&json),
+      "JSON with the costing, costing_options, contours, polygons, denoise, generalize and show_locations every isochrone is drawn with, as for valhalla_run_isochrone but without locations")
+      ("reverse,r", bpo::value<bool>(&batch.reverse), "Reverse direction.")
+      ("ncontours,n", bpo::value<size_t>(&n_contours), "Number of contours.")
+      ("minutes,m", bpo::value<unsigned int>(&max_minutes), "Maximum minutes.")
+      ("threads", bpo::value<size_t>(&threads), "Number of threads to draw isochrones on, defaults to one per core.")
+      ("config,c", bpo::value<std::string>(&config), "Valhalla configuration file")
+      ("file,f", bpo::value<std::string>(&filename), "Output file name, one geojson isochrone per line.")
+      ("polygons,p", bpo::value<bool>(&batch.polygons), "Return as polygons or lines.")
+      ("show_locations,l", bpo::value<bool>(&batch.show_locations), "Include the origin in each geojson.")
+      ("denoise,d", bpo::value<float>(&batch.denoise), "Denoise value. Must be between 0 and 1.")
+      ("generalize,g", bpo::value<float>(&batch.generalize), "Generalize value.");
+
+  bpo::positional_options_description pos_options;
+  pos_options.add("config", 1);
+  bpo::variables_map vm;
+  try {
+    bpo::store(
+        bpo::command_line_parser(argc, argv).options(options).positional(
+            pos_options).run(),
+        vm);
+    bpo::notify(vm);
+
+  } catch (std::exception &e) {
+    std::cerr << "Unable to parse command line options because: " << e.what()
+              << "\n" << "This is a bug, please report it at " PACKAGE_BUGREPORT
+              << "\n";
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("version")) {
+    std::cout << "valhalla_run_isochrones " << VERSION << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  for (auto arg : std::vector<std::string> { "input", "config" }) {
+    if (vm.count(arg) == 0) {
+      std::cerr << "The <" << arg << "> argument was not provided, but is mandatory\n\n";
+      std::cerr << options << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The isochrone options come from the json or from the command line
+  if (vm.count("json") == 0) {
+    if (vm.count("type") == 0) {
+      std::cerr << "The <type> argument was not provided, but is mandatory when json is not provided\n\n";
+      std::cerr << options << "\n";
+      return EXIT_FAILURE;
+    }
+    for (size_t i = 1; i <= n_contours; i++) {
+      batch.contour_times.push_back((max_minutes * i) / n_contours);
+    }
+  } else {
+    std::stringstream stream;
+    stream << json;
+    boost::property_tree::read_json(stream, batch.request);
+    batch.routetype = batch.request.get<std::string>("costing");
+    batch.denoise = batch.request.get<float>("denoise", batch.denoise);
+    batch.generalize = batch.request.get<float>("generalize", batch.generalize);
+    batch.polygons = batch.request.get<bool>("polygons", batch.polygons);
+    batch.show_locations = batch.request.get<bool>("show_locations", batch.show_locations);
+    for (const auto& contour : batch.request.get_child("contours")) {
+      batch.contour_times.push_back(contour.second.get<float>("time"));
+      batch.colors[batch.contour_times.back()] = contour.second.get<std::string>("color", "");
+    }
+  }
+  for (auto& c : batch.routetype)
+    c = std::tolower(c);
+  if (batch.routetype == "multimodal") {
+    std::cerr << "Multimodal isochrones need a date and time per origin and are not drawn in batches\n";
+    return EXIT_FAILURE;
+  }
+  if (batch.contour_times.empty()) {
+    std::cerr << "At least one contour is needed\n";
+    return EXIT_FAILURE;
+  }
+  batch.denoise = std::max(std::min(batch.denoise, 1.f), 0.f);
+  threads = std::max(threads, static_cast<size_t>(1));
+
+  //parse the config
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(config.c_str(), pt);
+
+  //configure logging
+  boost::optional<boost::property_tree::ptree&> logging_subtree = pt
+      .get_child_optional("thor.logging");
+  if (logging_subtree) {
+    auto logging_config = valhalla::midgard::ToMap<
+        const boost::property_tree::ptree&,
+        std::unordered_map<std::string, std::string> >(logging_subtree.get());
+    valhalla::midgard::logging::Configure(logging_config);
+  }
+  if (threads > 1 && !pt.get<bool>("mjolnir.global_sharded_cache", false))
+    LOG_WARN("Each thread caches its own tiles, set mjolnir.global_sharded_cache for them to share");
+
+  // Read the origins
+  std::ifstream input(input_file);
+  std::string line;
+  while (std::getline(input, line)) {
+    if (!line.empty())
+      batch.origins.emplace_back(Location::FromCsv(line));
+  }
+  LOG_INFO("Drawing " + std::to_string(batch.origins.size()) + " isochrones on " +
+           std::to_string(threads) + " threads");
+
+  // Draw them on the threads, writing them out as they come in order
+  std::ofstream file;
+  if (vm.count("file"))
+    file.open(filename, std::ofstream::out);
+  ordered_writer_t writer(vm.count("file") ? static_cast<std::ostream&>(file) : std::cout);
+  std::atomic<size_t> next_origin(0);
+  auto t1 = std::chrono::high_resolution_clock::now();
+  std::list<std::thread> pool;
+  for (size_t i = 0; i < threads; ++i)
+    pool.emplace_back(work, std::cref(pt), std::cref(batch), std::ref(next_origin), std::ref(writer));
+  for (auto& thread : pool)
+    thread.join();
+  auto t2 = std::chrono::high_resolution_clock::now();
+  uint32_t msecs = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+  LOG_INFO("Drew " + std::to_string(writer.written()) + " of " + std::to_string(batch.origins.size()) +
+           " isochrones in " + std::to_string(msecs) + " ms");
+
+  return EXIT_SUCCESS;
+}
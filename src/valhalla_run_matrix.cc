@@ -1,8 +1,14 @@
 #include <cstdint>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -21,6 +27,7 @@
 #include "midgard/logging.h"
 
 #include "thor/costmatrix.h"
+#include "thor/flatmatrix.h"
 #include "thor/timedistancematrix.h"
 #include "thor/optimizer.h"
 
@@ -114,6 +121,235 @@ void LogResults(const std::string& matrixtype,
   }
 }
 
+// Registers the costing methods matrices can be computed with
+void RegisterCostings(CostFactory<DynamicCost>& factory) {
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("transit", CreateTransitCost);
+}
+
+// Get the max matrix distances for construction of the CostMatrix and TimeDistanceMatrix classes
+std::unordered_map<std::string, float> GetMaxMatrixDistances(const boost::property_tree::ptree& pt) {
+  std::unordered_map<std::string,float> max_matrix_distance;
+  for (const auto& kv : pt.get_child("service_limits")) {
+    if(kv.first == "max_avoid_locations" || kv.first == "max_reachability" || kv.first == "max_radius")
+      continue;
+    if (kv.first != "skadi" && kv.first != "trace" && kv.first != "isochrone") {
+      max_matrix_distance.emplace(kv.first, pt.get<float>("service_limits." + kv.first + ".max_matrix_distance"));
+    }
+  }
+
+  if (max_matrix_distance.empty())
+    throw std::runtime_error("Missing max_matrix_distance configuration");
+  return max_matrix_distance;
+}
+
+// An origin and destination of a batch file
+struct od_pair_t {
+  PointLL origin;
+  PointLL destination;
+};
+
+// Reads the origin destination pairs of a batch file, a line of
+// lat,lng,lat,lng per pair. Blank lines and lines starting with # are skipped
+std::vector<od_pair_t> ReadPairs(const std::string& file) {
+  std::ifstream in(file);
+  if (!in)
+    throw std::runtime_error("Could not open batch file " + file);
+  std::vector<od_pair_t> pairs;
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.find_first_not_of(" \t\r") == std::string::npos || line.front() == '#')
+      continue;
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    float lat1, lng1, lat2, lng2;
+    if (!(fields >> lat1 >> lng1 >> lat2 >> lng2))
+      throw std::runtime_error("Bad origin destination pair on line " +
+                               std::to_string(line_number) + " of " + file);
+    pairs.push_back({{lng1, lat1}, {lng2, lat2}});
+  }
+  return pairs;
+}
+
+// Writes the result of each pair as soon as it is done, from whichever
+// thread did it, as a csv row or a json object per line. Pairs are told
+// apart by their id, the order they came in the batch file
+class BatchWriter {
+ public:
+  BatchWriter(std::ostream& out, const bool json) : out_(out), json_(json) {
+    if (!json_)
+      out_ << "id,origin_lat,origin_lng,destination_lat,destination_lng,status,time,length\n";
+  }
+
+  void Write(const size_t id, const od_pair_t& pair, const std::string& status,
+             const uint32_t time, const float length) {
+    std::string row = json_ ?
+      (boost::format("{\"id\":%d,\"origin\":[%.6f,%.6f],\"destination\":[%.6f,%.6f],"
+                     "\"status\":\"%s\",\"time\":%d,\"length\":%.3f}\n")
+        % id % pair.origin.lat() % pair.origin.lng() % pair.destination.lat()
+        % pair.destination.lng() % status % time % length).str() :
+      (boost::format("%d,%.6f,%.6f,%.6f,%.6f,%s,%d,%.3f\n")
+        % id % pair.origin.lat() % pair.origin.lng() % pair.destination.lat()
+        % pair.destination.lng() % status % time % length).str();
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_ << row;
+  }
+
+ private:
+  std::ostream& out_;
+  bool json_;
+  std::mutex mutex_;
+};
+
+// Computes a run of pairs of a batch sharing their origin as one one to many
+// matrix with the reader, costing and label storage of a thread. Time is
+// written in seconds and length in kilometers
+void BatchMatrix(GraphReader& reader, const std::vector<od_pair_t>& pairs,
+                 const size_t begin, const size_t end, LabelArena& label_arena,
+                 const std::shared_ptr<DynamicCost>* mode_costing, const TravelMode mode,
+                 const float max_matrix_distance, std::atomic<size_t>& failures,
+                 BatchWriter& writer) {
+  // Find the locations
+  std::vector<Location> locations{pairs[begin].origin};
+  for (size_t i = begin; i < end; ++i) {
+    locations.emplace_back(pairs[i].destination);
+  }
+  std::shared_ptr<DynamicCost> cost = mode_costing[static_cast<uint32_t>(mode)];
+  const auto projections = Search(locations, reader, cost->GetEdgeFilter(), cost->GetNodeFilter());
+  auto origin = projections.find(locations.front());
+  if (origin == projections.cend()) {
+    for (size_t i = begin; i < end; ++i) {
+      writer.Write(i, pairs[i], "fail_invalid_origin", 0, 0.0f);
+    }
+    failures += end - begin;
+    return;
+  }
+
+  // The targets are the destinations that were found
+  valhalla::odin::DirectionsOptions directions_options;
+  PathLocation::toPBF(origin->second, directions_options.mutable_sources()->Add(), reader);
+  std::vector<size_t> targets;
+  for (size_t i = begin; i < end; ++i) {
+    auto destination = projections.find(locations[i - begin + 1]);
+    if (destination == projections.cend()) {
+      writer.Write(i, pairs[i], "fail_invalid_dest", 0, 0.0f);
+      ++failures;
+      continue;
+    }
+    PathLocation::toPBF(destination->second, directions_options.mutable_targets()->Add(), reader);
+    targets.push_back(i);
+  }
+  if (targets.empty()) {
+    return;
+  }
+
+  CostMatrix matrix(&label_arena);
+  auto res = matrix.SourceToTarget(directions_options.sources(), directions_options.targets(),
+                                   reader, mode_costing, mode, max_matrix_distance);
+  for (size_t j = 0; j < targets.size(); ++j) {
+    if (res[j].time == kMaxCost) {
+      writer.Write(targets[j], pairs[targets[j]], "fail_no_route", 0, 0.0f);
+      ++failures;
+    } else {
+      writer.Write(targets[j], pairs[targets[j]], "success", res[j].time, res[j].dist * 0.001f);
+    }
+  }
+}
+
+// Computes the pairs of a batch on a thread, taking the next run of pairs
+// not yet taken until there are none left. Each thread keeps its own reader,
+// and so its own tile cache, costing and label storage for every run
+void BatchWork(const boost::property_tree::ptree& config, boost::property_tree::ptree request,
+               const std::string& routetype, const float max_matrix_distance,
+               const std::vector<od_pair_t>& pairs, const std::vector<size_t>& runs,
+               std::atomic<size_t>& next, std::atomic<size_t>& failures,
+               BatchWriter& writer) {
+  GraphReader reader(config.get_child("mjolnir"));
+  CostFactory<DynamicCost> factory;
+  RegisterCostings(factory);
+  std::shared_ptr<DynamicCost> mode_costing[4];
+  auto cost = get_costing(factory, request, routetype);
+  TravelMode mode = cost->travel_mode();
+  mode_costing[static_cast<uint32_t>(mode)] = cost;
+  LabelArena label_arena;
+
+  size_t i;
+  while ((i = next.fetch_add(1)) + 1 < runs.size()) {
+    try {
+      BatchMatrix(reader, pairs, runs[i], runs[i + 1], label_arena, mode_costing,
+                  mode, max_matrix_distance, failures, writer);
+    } catch (std::exception& e) {
+      LOG_ERROR("Pairs " + std::to_string(runs[i]) + " to " + std::to_string(runs[i + 1] - 1) +
+                " failed: " + e.what());
+      for (size_t j = runs[i]; j < runs[i + 1]; ++j) {
+        writer.Write(j, pairs[j], "fail_error", 0, 0.0f);
+      }
+      failures += runs[i + 1] - runs[i];
+    }
+    // Keep the tile cache within its limits between runs like the service
+    if (reader.OverCommitted()) {
+      reader.Clear();
+    }
+  }
+}
+
+// Computes every pair of a batch file across threads and writes them out.
+// Pairs that follow each other with the same origin are computed together
+int Batch(const boost::property_tree::ptree& config, const boost::property_tree::ptree& request,
+          const std::string& routetype, const float max_matrix_distance,
+          const std::string& batch_file, const std::string& output_file,
+          const std::string& format, const unsigned int threads) {
+  if (routetype == "multimodal") {
+    throw std::runtime_error("Batches can not be multimodal");
+  }
+  if (format != "csv" && format != "json") {
+    throw std::runtime_error("The batch format must be csv or json");
+  }
+  auto pairs = ReadPairs(batch_file);
+
+  // Where each run of pairs sharing an origin starts, and where the last ends
+  std::vector<size_t> runs;
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    if (i == 0 || pairs[i].origin != pairs[i - 1].origin) {
+      runs.push_back(i);
+    }
+  }
+  runs.push_back(pairs.size());
+  LOG_INFO("Computing " + std::to_string(pairs.size()) + " pairs from " +
+           std::to_string(runs.size() - 1) + " origins on " + std::to_string(threads) + " threads");
+
+  std::ofstream file;
+  if (!output_file.empty()) {
+    file.open(output_file);
+    if (!file)
+      throw std::runtime_error("Could not open " + output_file);
+  }
+  BatchWriter writer(output_file.empty() ? std::cout : file, format == "json");
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+  std::atomic<size_t> next(0), failures(0);
+  std::vector<std::thread> workers;
+  for (unsigned int i = 0; i < threads; ++i) {
+    workers.emplace_back(BatchWork, std::cref(config), request, std::cref(routetype),
+                         max_matrix_distance, std::cref(pairs), std::cref(runs),
+                         std::ref(next), std::ref(failures), std::ref(writer));
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  auto t1 = std::chrono::high_resolution_clock::now();
+  uint32_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+  LOG_INFO("Computed " + std::to_string(pairs.size()) + " pairs, " +
+           std::to_string(failures) + " failed, in " + std::to_string(ms) + " ms");
+  return EXIT_SUCCESS;
+}
+
 // Main method for testing time and distance matrix methods
 int main(int argc, char *argv[]) {
   bpo::options_description options("timedistance_test " VERSION "\n"
@@ -124,11 +360,19 @@ int main(int argc, char *argv[]) {
   "\n"
   "Use the -j option for specifying the locations. "
   "\n"
+  "Use the -b option to compute a batch file of origin destination pairs, a line "
+  "of lat,lng,lat,lng per pair, across threads instead. Pairs that follow each "
+  "other with the same origin are computed as one one to many matrix. The costing "
+  "and its options come from -t or -j, a result per pair is written as a csv row "
+  "or a json object per line. "
+  "\n"
   "\n");
 
-  std::string routetype, json, config;
+  std::string routetype, json, config, flat_graph;
   std::string matrixtype = "one_to_many";
   uint32_t iterations = 1;
+  std::string batch_file, output_file, format = "csv";
+  unsigned int threads = std::max(1U, std::thread::hardware_concurrency());
 
   options.add_options()("help,h", "Print this help message.")(
       "version,v", "Print the version of this software.")(
@@ -140,6 +384,12 @@ int main(int argc, char *argv[]) {
       boost::program_options::value<std::string>(&json),
       "JSON Example: '{\"locations\":[{\"lat\":40.748174,\"lon\":-73.984984,\"type\":\"break\",\"heading\":200,\"name\":\"Empire State Building\",\"street\":\"350 5th Avenue\",\"city\":\"New York\",\"state\":\"NY\",\"postal_code\":\"10118-0110\",\"country\":\"US\"},{\"lat\":40.749231,\"lon\":-73.968703,\"type\":\"break\",\"name\":\"United Nations Headquarters\",\"street\":\"405 East 42nd Street\",\"city\":\"New York\",\"state\":\"NY\",\"postal_code\":\"10017-3507\",\"country\":\"US\"}],\"costing\":\"auto\",\"directions_options\":{\"units\":\"miles\"}}'")
       ("multi-run", bpo::value<uint32_t>(&iterations), "Generate the route N additional times before exiting.")
+      ("flat-graph", bpo::value<std::string>(&flat_graph), "Also time the matrix over this flat graph snapshot "
+          "of the costing, built with valhalla_build_flat_graph.")
+      ("batch,b", bpo::value<std::string>(&batch_file), "Compute the origin destination pairs of this file.")
+      ("threads", bpo::value<unsigned int>(&threads), "Number of threads to compute a batch with.")
+      ("format", bpo::value<std::string>(&format), "Batch output: csv|json, json being an object per line.")
+      ("output", bpo::value<std::string>(&output_file), "File to write the batch results to, defaults to stdout.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file");
 
@@ -167,6 +417,41 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
   }
 
+  // Compute the pairs of a batch file rather than a single matrix
+  if (vm.count("batch")) {
+    boost::property_tree::ptree json_ptree;
+    if (vm.count("json")) {
+      std::stringstream stream;
+      stream << json;
+      boost::property_tree::read_json(stream, json_ptree);
+      routetype = json_ptree.get<std::string>("costing", routetype);
+    }
+    if (routetype.empty() || config.empty()) {
+      std::cerr << "The <type> and <config> arguments are mandatory with a batch\n\n";
+      std::cerr << options << "\n";
+      return EXIT_FAILURE;
+    }
+    for (auto & c : routetype)
+      c = std::tolower(c);
+
+    boost::property_tree::ptree pt;
+    boost::property_tree::read_json(config.c_str(), pt);
+    boost::optional<boost::property_tree::ptree&> logging_subtree = pt
+        .get_child_optional("thor.logging");
+    if (logging_subtree) {
+      auto logging_config = valhalla::midgard::ToMap<
+          const boost::property_tree::ptree&,
+          std::unordered_map<std::string, std::string> >(logging_subtree.get());
+      valhalla::midgard::logging::Configure(logging_config);
+    }
+    auto max_matrix_distance = GetMaxMatrixDistances(pt);
+    auto max_distance = max_matrix_distance.find(routetype);
+    if (max_distance == max_matrix_distance.cend())
+      throw std::runtime_error("No max_matrix_distance for " + routetype);
+    return Batch(pt, json_ptree, routetype, max_distance->second, batch_file, output_file,
+                 format, std::max(1U, threads));
+  }
+
   // We require JSON input of locations (unlike pathtest). The first location
   // is the origin.
   std::stringstream stream;
@@ -208,12 +493,7 @@ int main(int argc, char *argv[]) {
 
   // Construct costing
   CostFactory<DynamicCost> factory;
-  factory.Register("auto", CreateAutoCost);
-  factory.Register("auto_shorter", CreateAutoShorterCost);
-  factory.Register("bus", CreateBusCost);
-  factory.Register("bicycle", CreateBicycleCost);
-  factory.Register("pedestrian", CreatePedestrianCost);
-  factory.Register("transit", CreateTransitCost);
+  RegisterCostings(factory);
 
   // Figure out the route type
   for (auto & c : routetype)
@@ -288,26 +568,17 @@ int main(int argc, char *argv[]) {
   LOG_INFO("Location Processing took " + std::to_string(ms) + " ms");
 
   // Get the max matrix distances for construction of the CostMatrix and TimeDistanceMatrix classes
-  std::unordered_map<std::string,float> max_matrix_distance;
-  for (const auto& kv : pt.get_child("service_limits")) {
-    if(kv.first == "max_avoid_locations" || kv.first == "max_reachability" || kv.first == "max_radius")
-      continue;
-    if (kv.first != "skadi" && kv.first != "trace" && kv.first != "isochrone") {
-      max_matrix_distance.emplace(kv.first, pt.get<float>("service_limits." + kv.first + ".max_matrix_distance"));
-    }
-  }
-
-  if (max_matrix_distance.empty())
-    throw std::runtime_error("Missing max_matrix_distance configuration");
+  auto max_matrix_distance = GetMaxMatrixDistances(pt);
 
   // Compute the cost matrix
   t0 = std::chrono::high_resolution_clock::now();
 
-  // Timing with CostMatrix
+  // Timing with CostMatrix, reusing label storage between iterations like the service does
+  LabelArena label_arena;
   std::vector<TimeDistance> res;
   for (uint32_t n = 0; n < iterations; n++) {
     res.clear();
-    CostMatrix matrix;
+    CostMatrix matrix(&label_arena);
     res = matrix.SourceToTarget(directions_options.sources(), directions_options.targets(),
                                   reader, mode_costing, mode,
                                   max_matrix_distance.find(routetype)->second);
@@ -321,7 +592,7 @@ int main(int argc, char *argv[]) {
   // Run with TimeDistanceMatrix
   for (uint32_t n = 0; n < iterations; n++) {
     res.clear();
-    TimeDistanceMatrix tdm;
+    TimeDistanceMatrix tdm(&label_arena);
     if (matrixtype == "one_to_many") {
       res = tdm.OneToMany(*directions_options.locations().begin(), directions_options.locations(), reader, mode_costing,
                           mode, max_matrix_distance.find(routetype)->second);
@@ -339,6 +610,26 @@ int main(int argc, char *argv[]) {
   LOG_INFO("TimeDistanceMatrix average time to compute: " + std::to_string(avg) + " sec");
   LogResults(matrixtype, path_locations, res);
 
+  // Run over the flat graph snapshot
+  if (!flat_graph.empty()) {
+    std::shared_ptr<const FlatGraph> graph(new FlatGraph(FlatGraph::Load(flat_graph)));
+    if (graph->costing() != routetype)
+      throw std::runtime_error(flat_graph + " was built for " + graph->costing());
+    t0 = std::chrono::high_resolution_clock::now();
+    for (uint32_t n = 0; n < iterations; n++) {
+      res.clear();
+      FlatMatrix matrix(graph);
+      res = matrix.SourceToTarget(directions_options.sources(), directions_options.targets(),
+                                  reader, mode_costing, mode,
+                                  max_matrix_distance.find(routetype)->second);
+    }
+    t1 = std::chrono::high_resolution_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1-t0).count();
+    avg = (static_cast<float>(ms) / static_cast<float>(iterations)) * 0.001f;
+    LOG_INFO("FlatMatrix average time to compute: " + std::to_string(avg) + " sec");
+    LogResults(matrixtype, path_locations, res);
+  }
+
   return EXIT_SUCCESS;
 }
 
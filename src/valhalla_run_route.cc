@@ -1,10 +1,17 @@
 #include <cstdint>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <queue>
 #include <tuple>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <boost/program_options.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -405,6 +412,248 @@ valhalla::sif::cost_ptr_t get_costing(CostFactory<DynamicCost> factory,
   return factory.Create(costing, costing_options);
 }
 
+// Registers the costing methods routes can be made with
+void RegisterCostings(CostFactory<DynamicCost>& factory) {
+  factory.Register("auto", CreateAutoCost);
+  factory.Register("auto_shorter", CreateAutoShorterCost);
+  factory.Register("bus", CreateBusCost);
+  factory.Register("bicycle", CreateBicycleCost);
+  factory.Register("pedestrian", CreatePedestrianCost);
+  factory.Register("truck", CreateTruckCost);
+  factory.Register("transit", CreateTransitCost);
+}
+
+namespace {
+
+  // An origin and destination of a batch file
+  struct od_pair_t {
+    PointLL origin;
+    PointLL destination;
+  };
+
+  // Reads the origin destination pairs of a batch file, a line of
+  // lat,lng,lat,lng per pair. Blank lines and lines starting with # are skipped
+  std::vector<od_pair_t> ReadPairs(const std::string& file) {
+    std::ifstream in(file);
+    if (!in)
+      throw std::runtime_error("Could not open batch file " + file);
+    std::vector<od_pair_t> pairs;
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(in, line)) {
+      ++line_number;
+      if (line.find_first_not_of(" \t\r") == std::string::npos || line.front() == '#')
+        continue;
+      std::replace(line.begin(), line.end(), ',', ' ');
+      std::istringstream fields(line);
+      float lat1, lng1, lat2, lng2;
+      if (!(fields >> lat1 >> lng1 >> lat2 >> lng2))
+        throw std::runtime_error("Bad origin destination pair on line " +
+                                 std::to_string(line_number) + " of " + file);
+      pairs.push_back({{lng1, lat1}, {lng2, lat2}});
+    }
+    return pairs;
+  }
+
+  // Writes the result of each pair as soon as it is done, from whichever
+  // thread did it, as a csv row or a json object per line. Pairs are told
+  // apart by their id, the order they came in the batch file
+  class BatchWriter {
+   public:
+    BatchWriter(std::ostream& out, const bool json) : out_(out), json_(json) {
+      if (!json_)
+        out_ << "id,origin_lat,origin_lng,destination_lat,destination_lng,status,time,length\n";
+    }
+
+    void Write(const size_t id, const od_pair_t& pair, const std::string& status,
+               const uint32_t time, const float length) {
+      std::string row = json_ ?
+        (boost::format("{\"id\":%d,\"origin\":[%.6f,%.6f],\"destination\":[%.6f,%.6f],"
+                       "\"status\":\"%s\",\"time\":%d,\"length\":%.3f}\n")
+          % id % pair.origin.lat() % pair.origin.lng() % pair.destination.lat()
+          % pair.destination.lng() % status % time % length).str() :
+        (boost::format("%d,%.6f,%.6f,%.6f,%.6f,%s,%d,%.3f\n")
+          % id % pair.origin.lat() % pair.origin.lng() % pair.destination.lat()
+          % pair.destination.lng() % status % time % length).str();
+      std::lock_guard<std::mutex> lock(mutex_);
+      out_ << row;
+    }
+
+   private:
+    std::ostream& out_;
+    bool json_;
+    std::mutex mutex_;
+  };
+
+  // The outcome of routing a pair, time in seconds and length in kilometers
+  struct batch_result_t {
+    std::string status;
+    uint32_t time;
+    float length;
+  };
+
+  // Routes a pair of a batch with the reader and path algorithms of a thread.
+  // The costing is left as it came for the pairs after, relaxing the
+  // hierarchy limits for a second pass is done to a fresh one
+  batch_result_t BatchRoute(GraphReader& reader, const od_pair_t& pair,
+                            AStarPathAlgorithm& astar, BidirectionalAStar& bd,
+                            const std::function<cost_ptr_t ()>& create_cost,
+                            const cost_ptr_t& cost, const std::string& routetype) {
+    // Find the locations
+    std::vector<valhalla::baldr::Location> locations{pair.origin, pair.destination};
+    const auto projections = Search(locations, reader, cost->GetEdgeFilter(), cost->GetNodeFilter());
+    auto origin = projections.find(locations.front());
+    if (origin == projections.cend())
+      return {"fail_invalid_origin", 0, 0.0f};
+    auto destination = projections.find(locations.back());
+    if (destination == projections.cend())
+      return {"fail_invalid_dest", 0, 0.0f};
+    std::vector<PathLocation> path_location{origin->second, destination->second};
+
+    // Normalize the edge scores and use bidirectional except for possible
+    // trivial cases
+    PathAlgorithm* pathalgorithm = &bd;
+    for (auto& correlated : path_location) {
+      auto minScoreEdge = *std::min_element(correlated.edges.begin(), correlated.edges.end(),
+         [](PathLocation::PathEdge i, PathLocation::PathEdge j)->bool {
+           return i.distance < j.distance;
+         });
+      for (auto& e : correlated.edges) {
+        e.distance -= minScoreEdge.distance;
+      }
+    }
+    for (auto& edge1 : path_location.front().edges) {
+      for (auto& edge2 : path_location.back().edges) {
+        if (edge1.id == edge2.id) {
+          pathalgorithm = &astar;
+        }
+      }
+    }
+    bool using_astar = (pathalgorithm == &astar);
+
+    // Get the best path
+    valhalla::odin::Location src, sync;
+    PathLocation::toPBF(path_location.front(), &src, reader);
+    PathLocation::toPBF(path_location.back(), &sync, reader);
+    TravelMode mode = cost->travel_mode();
+    std::shared_ptr<DynamicCost> mode_costing[4];
+    mode_costing[static_cast<uint32_t>(mode)] = cost;
+    cost->set_pass(0);
+    std::vector<PathInfo> pathedges = pathalgorithm->GetBestPath(src, sync, reader, mode_costing, mode);
+    if (pathedges.size() == 0 ||
+        (routetype == "pedestrian" && pathalgorithm->has_ferry())) {
+      if (cost->AllowMultiPass()) {
+        pathalgorithm->Clear();
+        auto relaxed = create_cost();
+        relaxed->set_pass(1);
+        float relax_factor = (using_astar) ? 16.0f : 8.0f;
+        float expansion_within_factor = (using_astar) ? 4.0f : 2.0f;
+        relaxed->RelaxHierarchyLimits(relax_factor, expansion_within_factor);
+        mode_costing[static_cast<uint32_t>(mode)] = relaxed;
+        pathedges = pathalgorithm->GetBestPath(src, sync, reader, mode_costing, mode);
+      }
+    }
+    if (pathedges.size() == 0) {
+      pathalgorithm->Clear();
+      return {"fail_no_route", 0, 0.0f};
+    }
+
+    // Form the trip path for its time and length
+    AttributesController controller;
+    TripPath trip_path = TripPathBuilder::Build(controller, reader, mode_costing,
+                                                pathedges, src, sync,
+                                                std::list<valhalla::odin::Location>{});
+    pathalgorithm->Clear();
+    float length = 0.0f;
+    for (const auto& node : trip_path.node()) {
+      if (node.has_edge()) {
+        length += node.edge().length();
+      }
+    }
+    return {"success", trip_path.node().rbegin()->elapsed_time(), length};
+  }
+
+  // Routes the pairs of a batch on a thread, taking the next one not yet
+  // taken until there are none left. Each thread keeps its own reader, and
+  // so its own tile cache, costing and path algorithms for every pair
+  void BatchWork(const boost::property_tree::ptree& config, boost::property_tree::ptree request,
+                 const std::string& routetype, const std::vector<od_pair_t>& pairs,
+                 std::atomic<size_t>& next, std::atomic<size_t>& failures,
+                 BatchWriter& writer) {
+    GraphReader reader(config.get_child("mjolnir"));
+    CostFactory<DynamicCost> factory;
+    RegisterCostings(factory);
+    auto create_cost = [&factory, &request, &routetype]() {
+      return get_costing(factory, request, routetype);
+    };
+    cost_ptr_t cost = create_cost();
+    AStarPathAlgorithm astar;
+    BidirectionalAStar bd;
+
+    size_t i;
+    while ((i = next.fetch_add(1)) < pairs.size()) {
+      batch_result_t result;
+      try {
+        result = BatchRoute(reader, pairs[i], astar, bd, create_cost, cost, routetype);
+      } catch (std::exception& e) {
+        LOG_ERROR("Pair " + std::to_string(i) + " failed: " + e.what());
+        astar.Clear();
+        bd.Clear();
+        result = {"fail_error", 0, 0.0f};
+      }
+      if (result.status != "success") {
+        ++failures;
+      }
+      writer.Write(i, pairs[i], result.status, result.time, result.length);
+      // Keep the tile cache within its limits between pairs like the service
+      if (reader.OverCommitted()) {
+        reader.Clear();
+      }
+    }
+  }
+
+  // Routes every pair of a batch file across threads and writes them out
+  int Batch(const boost::property_tree::ptree& config, const boost::property_tree::ptree& request,
+            const std::string& routetype, const std::string& batch_file,
+            const std::string& output_file, const std::string& format,
+            const unsigned int threads) {
+    if (routetype == "multimodal") {
+      throw std::runtime_error("Batches can not be multimodal");
+    }
+    if (format != "csv" && format != "json") {
+      throw std::runtime_error("The batch format must be csv or json");
+    }
+    auto pairs = ReadPairs(batch_file);
+    LOG_INFO("Routing " + std::to_string(pairs.size()) + " pairs on " +
+             std::to_string(threads) + " threads");
+
+    std::ofstream file;
+    if (!output_file.empty()) {
+      file.open(output_file);
+      if (!file)
+        throw std::runtime_error("Could not open " + output_file);
+    }
+    BatchWriter writer(output_file.empty() ? std::cout : file, format == "json");
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::atomic<size_t> next(0), failures(0);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; ++i) {
+      workers.emplace_back(BatchWork, std::cref(config), request, std::cref(routetype),
+                           std::cref(pairs), std::ref(next), std::ref(failures), std::ref(writer));
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    uint32_t msecs = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+    LOG_INFO("Routed " + std::to_string(pairs.size()) + " pairs, " +
+             std::to_string(failures) + " failed, in " + std::to_string(msecs) + " ms");
+    return EXIT_SUCCESS;
+  }
+
+}
+
 // Main method for testing a single path
 int main(int argc, char *argv[]) {
   bpo::options_description options("valhalla_run_route " VERSION "\n"
@@ -415,12 +664,19 @@ int main(int argc, char *argv[]) {
   "\n"
   "Use the -o and -d options OR the -j option for specifying the locations. "
   "\n"
+  "Use the -b option to route a batch file of origin destination pairs, a line "
+  "of lat,lng,lat,lng per pair, across threads instead. The costing and its "
+  "options come from -t or -j, a result per pair is written as a csv row or a "
+  "json object per line. "
+  "\n"
   "\n");
 
   std::string origin, destination, routetype, json, config;
+  std::string batch_file, output_file, format = "csv";
   bool connectivity, multi_run, match_test;
   connectivity = multi_run = match_test = false;
   uint32_t iterations;
+  unsigned int threads = std::max(1U, std::thread::hardware_concurrency());
 
   options.add_options()("help,h", "Print this help message.")(
       "version,v", "Print the version of this software.")(
@@ -438,10 +694,13 @@ int main(int argc, char *argv[]) {
       ("connectivity", "Generate a connectivity map before testing the route.")
       ("match-test", "Test RouteMatcher with resulting shape.")
       ("multi-run", bpo::value<uint32_t>(&iterations), "Generate the route N additional times before exiting.")
+      ("batch,b", bpo::value<std::string>(&batch_file), "Route the origin destination pairs of this file.")
+      ("threads", bpo::value<unsigned int>(&threads), "Number of threads to route a batch with.")
+      ("format", bpo::value<std::string>(&format), "Batch output: csv|json, json being an object per line.")
+      ("output", bpo::value<std::string>(&output_file), "File to write the batch results to, defaults to stdout.")
       // positional arguments
       ("config", bpo::value<std::string>(&config), "Valhalla configuration file");
 
-
   bpo::positional_options_description pos_options;
   pos_options.add("config", 1);
 
@@ -483,6 +742,36 @@ int main(int argc, char *argv[]) {
     multi_run = true;
   }
 
+  // Route the pairs of a batch file rather than a single route
+  if (vm.count("batch")) {
+    boost::property_tree::ptree json_ptree;
+    if (vm.count("json")) {
+      std::stringstream stream;
+      stream << json;
+      boost::property_tree::read_json(stream, json_ptree);
+      routetype = json_ptree.get<std::string>("costing", routetype);
+    }
+    if (routetype.empty() || config.empty()) {
+      std::cerr << "The <type> and <config> arguments are mandatory with a batch\n\n";
+      std::cerr << options << "\n";
+      return EXIT_FAILURE;
+    }
+    for (auto & c : routetype)
+      c = std::tolower(c);
+
+    boost::property_tree::ptree pt;
+    boost::property_tree::read_json(config.c_str(), pt);
+    boost::optional<boost::property_tree::ptree&> logging_subtree = pt
+        .get_child_optional("thor.logging");
+    if (logging_subtree) {
+      auto logging_config = valhalla::midgard::ToMap<
+          const boost::property_tree::ptree&,
+          std::unordered_map<std::string, std::string> >(logging_subtree.get());
+      valhalla::midgard::logging::Configure(logging_config);
+    }
+    return Batch(pt, json_ptree, routetype, batch_file, output_file, format, std::max(1U, threads));
+  }
+
   // Directions options - set defaults
   DirectionsOptions directions_options;
 
@@ -584,13 +873,7 @@ int main(int argc, char *argv[]) {
 
   // Construct costing
   CostFactory<DynamicCost> factory;
-  factory.Register("auto", CreateAutoCost);
-  factory.Register("auto_shorter", CreateAutoShorterCost);
-  factory.Register("bus", CreateBusCost);
-  factory.Register("bicycle", CreateBicycleCost);
-  factory.Register("pedestrian", CreatePedestrianCost);
-  factory.Register("truck", CreateTruckCost);
-  factory.Register("transit", CreateTransitCost);
+  RegisterCostings(factory);
 
   // Figure out the route type
   for (auto & c : routetype)
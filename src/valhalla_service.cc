@@ -8,6 +8,12 @@
 #include <memory>
 #include <stdexcept>
 #include <sstream>
+#include <fstream>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -16,11 +22,64 @@
 #include <prime_server/http_protocol.hpp>
 using namespace prime_server;
 
+#include "midgard/compute_slots.h"
 #include "midgard/logging.h"
 
 #include "loki/worker.h"
 #include "thor/worker.h"
 #include "odin/worker.h"
+#include "tyr/actor.h"
+
+namespace {
+
+  using service_t = void (*)(const boost::property_tree::ptree&);
+
+  //the cpus of each numa node that has any, from a kernel list like 0-3,8-11
+  std::vector<std::vector<int> > numa_nodes() {
+    auto parse = [](const std::string& list) {
+      std::vector<int> ids;
+      std::stringstream ranges(list);
+      std::string range;
+      while(std::getline(ranges, range, ',')) {
+        auto dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for(int id = first; id <= last; ++id)
+          ids.push_back(id);
+      }
+      return ids;
+    };
+    std::vector<std::vector<int> > nodes;
+#ifdef __linux__
+    std::string list;
+    std::ifstream online("/sys/devices/system/node/online");
+    if(!std::getline(online, list))
+      return nodes;
+    for(auto node : parse(list)) {
+      std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      //nodes with only memory don't get any workers
+      if(std::getline(cpulist, list) && !list.empty())
+        nodes.emplace_back(parse(list));
+    }
+#endif
+    return nodes;
+  }
+
+  //keep the calling thread on these cpus, so the memory it touches first is the node's own
+  void pin(const std::vector<int>& cpus) {
+#ifdef __linux__
+    if(cpus.empty())
+      return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(auto cpu : cpus)
+      CPU_SET(cpu, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+      LOG_WARN("Could not pin a worker to its numa node");
+#endif
+  }
+
+}
 
 int main(int argc, char** argv) {
 
@@ -64,42 +123,87 @@ int main(int argc, char** argv) {
     valhalla::midgard::logging::Configure(logging_config);
   }
 
-  //number of workers to use at each stage
-  auto worker_concurrency = std::thread::hardware_concurrency();
+  //number of workers to use at each stage, each stage can have its own
+  size_t worker_concurrency = std::thread::hardware_concurrency();
   if(argc > 2)
     worker_concurrency = std::stoul(argv[2]);
+  auto stage_workers = [&config, worker_concurrency](const std::string& stage) {
+    auto workers = config.get<size_t>(stage + ".service.workers", 0);
+    return workers ? workers : worker_concurrency;
+  };
+
+  //optionally run a chain of thor and odin workers on each numa node, the workers are pinned to
+  //the cpus of their node and share a tile cache of its own, made out of memory local to the node.
+  //whichever node's loki worker takes a request hands it on to the thor and odin of the same node
+  std::vector<std::vector<int> > nodes;
+  if(config.get<bool>("httpd.service.numa", false)) {
+    nodes = numa_nodes();
+    if(nodes.size() < 2)
+      LOG_WARN("Found " + std::to_string(nodes.size()) + " numa nodes, running without pinning workers");
+  }
+  if(nodes.size() < 2)
+    nodes.assign(1, {});
+  std::vector<boost::property_tree::ptree> node_configs(nodes.size(), config);
+  if(nodes.size() > 1) {
+    for(size_t n = 0; n < nodes.size(); ++n) {
+      node_configs[n].put("thor.service.proxy", thor_proxy + "_" + std::to_string(n));
+      node_configs[n].put("odin.service.proxy", odin_proxy + "_" + std::to_string(n));
+      node_configs[n].put("mjolnir.cache_group", n);
+    }
+    LOG_INFO("Running workers on " + std::to_string(nodes.size()) + " numa nodes");
+  }
 
-  //setup the cluster within this process
+  //spread the workers of a stage over the nodes, at least one on each so no node's chain is broken
+  auto start_workers = [&nodes, &node_configs](size_t count, service_t service) {
+    count = std::max(count, nodes.size());
+    for(size_t i = 0; i < count; ++i) {
+      auto n = i % nodes.size();
+      std::thread([service](const std::vector<int>& cpus, const boost::property_tree::ptree& config) {
+        pin(cpus);
+        service(config);
+      }, nodes[n], node_configs[n]).detach();
+    }
+  };
+  //the proxy in front of a stage (of each node when it runs on every node)
   zmq::context_t context;
+  auto start_proxy = [&context](const std::string& proxy) {
+    std::thread(std::bind(&proxy_t::forward, proxy_t(context, proxy + "_in", proxy + "_out"))).detach();
+  };
+
+  //setup the cluster within this process
   std::thread server_thread = std::thread(std::bind(&http_server_t::serve,
     http_server_t(context, listen, loki_proxy + "_in", loopback, interrupt, true)));
 
-  //loki layer
-  std::thread loki_proxy_thread(std::bind(&proxy_t::forward, proxy_t(context, loki_proxy + "_in", loki_proxy + "_out")));
-  loki_proxy_thread.detach();
-  std::list<std::thread> loki_worker_threads;
-  for(size_t i = 0; i < worker_concurrency; ++i) {
-    loki_worker_threads.emplace_back(valhalla::loki::run_service, config);
-    loki_worker_threads.back().detach();
+  //or run every stage for a request on one worker, skipping the hops between them
+  if(config.get<bool>("httpd.service.in_process", false)) {
+    start_proxy(loki_proxy);
+    start_workers(worker_concurrency, valhalla::tyr::run_service);
+    server_thread.join();
+    return 0;
   }
 
+  //loki layer
+  start_proxy(loki_proxy);
+  start_workers(stage_workers("loki"), valhalla::loki::run_service);
+
   //thor layer
-  std::thread thor_proxy_thread(std::bind(&proxy_t::forward, proxy_t(context, thor_proxy + "_in", thor_proxy + "_out")));
-  thor_proxy_thread.detach();
-  std::list<std::thread> thor_worker_threads;
-  for(size_t i = 0; i < worker_concurrency; ++i) {
-    thor_worker_threads.emplace_back(valhalla::thor::run_service, config);
-    thor_worker_threads.back().detach();
+  for(const auto& node_config : node_configs)
+    start_proxy(node_config.get<std::string>("thor.service.proxy"));
+  //optionally with workers on top of the ones computing that only get to compute while the others
+  //wait on tiles from disk or a tile_url, so the cores keep busy on cold or network backed tiles
+  auto thor_workers = std::max(stage_workers("thor"), nodes.size());
+  auto io_workers = config.get<size_t>("thor.service.io_workers", 0);
+  if(io_workers) {
+    valhalla::midgard::compute_slots::set_slots(thor_workers);
+    LOG_INFO("Running " + std::to_string(io_workers) + " thor workers in addition to the " +
+             std::to_string(thor_workers) + " computing at once");
   }
+  start_workers(thor_workers + io_workers, valhalla::thor::run_service);
 
   //odin layer
-  std::thread odin_proxy_thread(std::bind(&proxy_t::forward, proxy_t(context, odin_proxy + "_in", odin_proxy + "_out")));
-  odin_proxy_thread.detach();
-  std::list<std::thread> odin_worker_threads;
-  for(size_t i = 0; i < worker_concurrency; ++i) {
-    odin_worker_threads.emplace_back(valhalla::odin::run_service, config);
-    odin_worker_threads.back().detach();
-  }
+  for(const auto& node_config : node_configs)
+    start_proxy(node_config.get<std::string>("odin.service.proxy"));
+  start_workers(stage_workers("odin"), valhalla::odin::run_service);
 
   //TODO: add multipoint accumulator
 
@@ -1,7 +1,14 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <list>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
-#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <zlib.h>
 
 #include "worker.h"
 #include "baldr/datetime.h"
@@ -9,6 +16,7 @@
 #include "odin/util.h"
 #include "midgard/util.h"
 #include "midgard/logging.h"
+#include "midgard/metrics.h"
 #include "midgard/encoded.h"
 
 namespace {
@@ -107,6 +115,8 @@ namespace {
     {140, 400},
     {141, 501},
     {142, 501},
+    {143, 400},
+    {144, 400},
 
     {150, 400},
     {151, 400},
@@ -117,15 +127,19 @@ namespace {
     {156, 400},
     {157, 400},
     {158, 400},
+    {159, 504},
 
     {160, 400},
     {161, 400},
     {162, 400},
     {163, 400},
+    {164, 400},
 
     {170, 400},
     {171, 400},
     {172, 400},
+    {173, 400},
+    {174, 502},
 
     {199, 400},
 
@@ -154,6 +168,7 @@ namespace {
     {312, 400},
     {313, 400},
     {314, 400},
+    {315, 400},
 
     {399, 400},
 
@@ -175,6 +190,9 @@ namespace {
     {444, 400},
     {445, 400},
 
+    {450, 503},
+    {451, 400},
+
     {499, 400},
 
     {500, 500},
@@ -260,6 +278,7 @@ namespace {
 	{312,R"({"code":"InvalidOptions","message":"Options are invalid."})"},
 	{313,R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
 	{314,R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
+	{315,R"({"code":"InvalidValue","message":"The successfully parsed query parameters are invalid."})"},
 
 	{399,R"({"code":"InvalidUrl","message":"URL string is invalid."})"},
 
@@ -374,6 +393,28 @@ namespace {
     }
   }
 
+  //work of each action in flight across all the workers of the process
+  std::mutex in_flight_mutex;
+  std::unordered_map<int, uint64_t> in_flight;
+
+  //responses shared between identical requests across all the workers of the process, those
+  //still being made have no time they were made at, the rest are listed oldest first
+  struct shared_response_t {
+    std::shared_future<std::string> response;
+    bool made;
+    std::chrono::steady_clock::time_point made_at;
+  };
+  std::mutex responses_mutex;
+  std::unordered_map<std::string, shared_response_t> responses;
+  std::list<std::string> made_order;
+  size_t responses_in_flight = 0;
+
+  //wall clock time so that deadlines mean the same thing in every process
+  uint64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
   void from_json(rapidjson::Document& doc, valhalla::odin::DirectionsOptions& options) {
     bool track = !options.has_do_not_track() || !options.do_not_track();
 
@@ -396,6 +437,24 @@ namespace {
     if (fmt && valhalla::odin::DirectionsOptions::Format_Parse(*fmt, &format))
       options.set_format(format);
 
+    //only the actions with big results have a binary response
+    if (options.format() == valhalla::odin::DirectionsOptions::pbf) {
+      switch (options.action()) {
+        case valhalla::odin::DirectionsOptions::route:
+        case valhalla::odin::DirectionsOptions::optimized_route:
+        case valhalla::odin::DirectionsOptions::trace_route:
+        case valhalla::odin::DirectionsOptions::sources_to_targets:
+        case valhalla::odin::DirectionsOptions::trace_attributes:
+          break;
+        default:
+          throw valhalla::valhalla_exception_t{143, "'" + valhalla::odin::DirectionsOptions::Action_Name(options.action()) + "'"};
+      }
+    }
+    //only the isochrone grid can be drawn as an image
+    if (options.format() == valhalla::odin::DirectionsOptions::png &&
+        options.action() != valhalla::odin::DirectionsOptions::isochrone)
+      throw valhalla::valhalla_exception_t{144, "'" + valhalla::odin::DirectionsOptions::Action_Name(options.action()) + "'"};
+
     auto id = rapidjson::get_optional<std::string>(doc, "/id");
     if(id)
       options.set_id(*id);
@@ -413,7 +472,7 @@ namespace {
     }
 
     auto language = rapidjson::get_optional<std::string>(doc, "/language");
-    if(language && valhalla::odin::get_locales().find(*language) != valhalla::odin::get_locales().end())
+    if(language && valhalla::odin::is_supported_locale(*language))
       options.set_language(*language);
 
     auto narrative = rapidjson::get_optional<bool>(doc, "/narrative");
@@ -433,12 +492,43 @@ namespace {
     else
       parse_locations(doc, options.mutable_shape(), "shape", 134, false);
 
+    //a batch of shapes for /height, raw ones are encoded so there is only one form to sample
+    auto encoded_polylines = rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/encoded_polylines");
+    if(encoded_polylines) {
+      for(const auto& encoded : *encoded_polylines) {
+        if(!encoded.IsString())
+          throw valhalla::valhalla_exception_t{134};
+        options.add_encoded_polylines(std::string(encoded.GetString(), encoded.GetStringLength()));
+      }
+    }
+    auto shapes = rapidjson::get_optional<rapidjson::Value::ConstArray>(doc, "/shapes");
+    if(shapes) {
+      for(const auto& shape : *shapes) {
+        if(!shape.IsArray())
+          throw valhalla::valhalla_exception_t{134};
+        std::vector<valhalla::midgard::PointLL> points;
+        for(const auto& point : shape.GetArray()) {
+          auto lat = rapidjson::get_optional<float>(point, "/lat");
+          auto lon = rapidjson::get_optional<float>(point, "/lon");
+          if(!lat || !lon || *lat < -90.0f || *lat > 90.0f)
+            throw valhalla::valhalla_exception_t{134};
+          points.emplace_back(valhalla::midgard::circular_range_clamp<float>(*lon, -180, 180), *lat);
+        }
+        options.add_encoded_polylines(valhalla::midgard::encode(points));
+      }
+    }
+    options.set_encoded_heights(rapidjson::get(doc, "/encoded_heights", false));
+
     //TODO: remove this?
     options.set_do_not_track(rapidjson::get_optional<bool>(doc, "/healthcheck").get_value_or(false));
 
     options.set_range(rapidjson::get(doc, "/range", false));
 
     options.set_verbose(rapidjson::get(doc, "/verbose",false));
+    options.set_columnar(rapidjson::get(doc, "/columnar",false));
+    options.set_stats(rapidjson::get(doc, "/stats",false));
+    options.set_summary_only(rapidjson::get(doc, "/summary_only",false));
+    options.set_alternates(rapidjson::get(doc, "/alternates", 0u));
 
     //costing
     auto costing_str = rapidjson::get_optional<std::string>(doc, "/costing");
@@ -510,11 +600,52 @@ namespace {
     if(resample_distance)
       options.set_resample_distance(*resample_distance);
 
+    //give up on the request once its time budget (milliseconds) is spent
+    auto timeout = rapidjson::get_optional<double>(doc, "/timeout");
+    if(timeout && *timeout > 0 && !options.has_deadline())
+      options.set_deadline(now_ms() + static_cast<uint64_t>(*timeout));
+
     //force these into the output so its obvious what we did to the user
     doc.AddMember({"language", allocator}, {options.language(), allocator}, allocator);
     doc.AddMember({"format", allocator},
       {valhalla::odin::DirectionsOptions::Format_Name(options.format()), allocator}, allocator);
   }
+
+  //whether an Accept-Encoding header takes gzip, ie lists it, or else *, without a quality of 0
+  bool accepts_gzip(const std::string& accept_encoding) {
+    std::stringstream codings(accept_encoding);
+    std::string coding;
+    bool any = false;
+    while(std::getline(codings, coding, ',')) {
+      auto params = coding.find(';');
+      auto name = coding.substr(0, params);
+      name.erase(0, name.find_first_not_of(" \t"));
+      name.erase(name.find_last_not_of(" \t") + 1);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      if(name != "gzip" && name != "x-gzip" && name != "*")
+        continue;
+      auto q = params == std::string::npos ? std::string::npos : coding.find("q=", params);
+      auto accepted = q == std::string::npos || std::strtod(coding.c_str() + q + 2, nullptr) > 0;
+      if(name != "*")
+        return accepted;
+      any = accepted;
+    }
+    return any;
+  }
+
+  //join the trace of a w3c traceparent header, version-traceid-parentid-flags, if it is sampled
+  void parse_traceparent(const std::string& traceparent, valhalla::odin::DirectionsOptions& options) {
+    if(traceparent.size() < 55 || traceparent[2] != '-' || traceparent[35] != '-' || traceparent[52] != '-')
+      return;
+    auto trace_id = traceparent.substr(3, 32);
+    auto parent = valhalla::midgard::tracing::from_hex(traceparent.substr(36, 16));
+    auto flags = valhalla::midgard::tracing::from_hex("00000000000000" + traceparent.substr(53, 2));
+    if(trace_id.find_first_not_of("0123456789abcdef") != std::string::npos ||
+       trace_id == std::string(32, '0') || !parent || !(flags & 1))
+      return;
+    options.set_trace_id(trace_id);
+    options.set_trace_parent(parent);
+  }
 }
 
 namespace valhalla {
@@ -522,6 +653,9 @@ namespace valhalla {
   valhalla_request_t::valhalla_request_t(){
     document.SetObject();
   }
+  valhalla_request_t::valhalla_request_t(const odin::DirectionsOptions& options):options(options){
+    document.SetObject();
+  }
   void valhalla_request_t::parse(const std::string& request, odin::DirectionsOptions::Action action) {
     document = from_string(request, valhalla_exception_t{100});
     options.set_action(action);
@@ -581,11 +715,25 @@ namespace valhalla {
     if(!request.path.empty() && odin::DirectionsOptions::Action_Parse(request.path.substr(1), &action))
       options.set_action(action);
 
+    //the time budget can also come in a header
+    auto timeout = request.headers.find("X-Request-Timeout");
+    if(timeout != request.headers.cend() && !document.HasMember("timeout"))
+      document.AddMember({"timeout", allocator}, {timeout->second, allocator}, allocator);
+
     //disable analytics
     auto do_not_track = request.headers.find("DNT");
     options.set_do_not_track(options.do_not_track() ||
       (do_not_track != request.headers.cend() && do_not_track->second == "1"));
 
+    //whether the response may be compressed
+    auto accept_encoding = request.headers.find("Accept-Encoding");
+    options.set_gzip(accept_encoding != request.headers.cend() && accepts_gzip(accept_encoding->second));
+
+    //join the trace the client is part of, when it wants this request traced
+    auto traceparent = request.headers.find("traceparent");
+    if(traceparent != request.headers.cend())
+      parse_traceparent(traceparent->second, options);
+
     //parse out the options
     from_json(document, options);
   }
@@ -595,7 +743,62 @@ namespace valhalla {
   const headers_t::value_type JS_MIME{"Content-type", "application/javascript;charset=utf-8"};
   const headers_t::value_type XML_MIME{"Content-type", "text/xml;charset=utf-8"};
   const headers_t::value_type GPX_MIME{"Content-type", "application/gpx+xml;charset=utf-8"};
+  const headers_t::value_type PBF_MIME{"Content-type", "application/x-protobuf"};
+  const headers_t::value_type PNG_MIME{"Content-type", "image/png"};
+  const headers_t::value_type METRICS_MIME{"Content-type", "text/plain; version=0.0.4"};
   const headers_t::value_type ATTACHMENT{"Content-Disposition", "attachment; filename=route.gpx"};
+  const headers_t::value_type GZIP{"Content-Encoding", "gzip"};
+  const headers_t::value_type VARY{"Vary", "Accept-Encoding"};
+
+  namespace {
+    //how the process compresses its responses, 0 bytes for not at all
+    struct compression_t {
+      size_t min_size;
+      int level;
+      size_t large_size;
+      int large_level;
+    } compression{0, Z_DEFAULT_COMPRESSION, 0, Z_DEFAULT_COMPRESSION};
+    std::once_flag compression_configured;
+
+    std::string gzip(const std::string& body, int level) {
+      z_stream stream{};
+      //15 window bits plus 16 to get a gzip header and trailer rather than a zlib one
+      if(deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw std::runtime_error("gzip compression init failed");
+      std::string compressed(deflateBound(&stream, body.size()), '\0');
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+      stream.avail_in = body.size();
+      stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+      stream.avail_out = compressed.size();
+      auto status = deflate(&stream, Z_FINISH);
+      deflateEnd(&stream);
+      if(status != Z_STREAM_END)
+        throw std::runtime_error("gzip compression failed");
+      compressed.resize(stream.total_out);
+      return compressed;
+    }
+
+    //a successful response, compressed if the client takes it and it is big enough to be worth it
+    http_response_t make_response(const std::string& body, headers_t headers, const valhalla_request_t& request) {
+      if(!compression.min_size)
+        return http_response_t(200, "OK", body, headers);
+      headers.insert(VARY);
+      if(!request.options.gzip() || body.size() < compression.min_size)
+        return http_response_t(200, "OK", body, headers);
+      headers.insert(GZIP);
+      auto level = compression.large_size && body.size() >= compression.large_size ? compression.large_level : compression.level;
+      return http_response_t(200, "OK", gzip(body, level), headers);
+    }
+  }
+
+  void configure_compression(const boost::property_tree::ptree& config) {
+    std::call_once(compression_configured, [&config]() {
+      compression.min_size = config.get<size_t>("gzip_min_size", 0);
+      compression.level = config.get<int>("gzip_level", Z_DEFAULT_COMPRESSION);
+      compression.large_size = config.get<size_t>("gzip_large_size", 0);
+      compression.large_level = config.get<int>("gzip_large_level", compression.level);
+    });
+  }
 
   worker_t::result_t jsonify_error(const valhalla_exception_t& exception, http_request_info_t& request_info, const valhalla_request_t& request) {
     //get the http status
@@ -638,7 +841,7 @@ namespace valhalla {
       stream << ')';
 
     worker_t::result_t result{false};
-    http_response_t response(200, "OK", stream.str(), headers_t{CORS, request.options.has_jsonp() ? JS_MIME : JSON_MIME});
+    auto response = make_response(stream.str(), headers_t{CORS, request.options.has_jsonp() ? JS_MIME : JSON_MIME}, request);
     response.from_info(request_info);
     result.messages.emplace_back(response.to_string());
     return result;
@@ -654,7 +857,7 @@ namespace valhalla {
       stream << ')';
 
     worker_t::result_t result{false};
-    http_response_t response(200, "OK", stream.str(), headers_t{CORS, request.options.has_jsonp() ? JS_MIME : JSON_MIME});
+    auto response = make_response(stream.str(), headers_t{CORS, request.options.has_jsonp() ? JS_MIME : JSON_MIME}, request);
     response.from_info(request_info);
     result.messages.emplace_back(response.to_string());
     return result;
@@ -670,7 +873,7 @@ namespace valhalla {
       stream << ')';
 
     worker_t::result_t result{false};
-    http_response_t response(200, "OK", stream.str(), headers_t{CORS, request.options.has_jsonp() ? JS_MIME : JSON_MIME});
+    auto response = make_response(stream.str(), headers_t{CORS, request.options.has_jsonp() ? JS_MIME : JSON_MIME}, request);
     response.from_info(request_info);
     result.messages.emplace_back(response.to_string());
     return result;
@@ -678,7 +881,45 @@ namespace valhalla {
 
   worker_t::result_t to_response_xml(const std::string& xml, http_request_info_t& request_info, const valhalla_request_t& request) {
     worker_t::result_t result{false};
-    http_response_t response(200, "OK", xml, headers_t{CORS, GPX_MIME, ATTACHMENT});
+    auto response = make_response(xml, headers_t{CORS, GPX_MIME, ATTACHMENT}, request);
+    response.from_info(request_info);
+    result.messages.emplace_back(response.to_string());
+    return result;
+  }
+
+  worker_t::result_t to_response_pbf(const std::string& pbf, http_request_info_t& request_info, const valhalla_request_t& request) {
+    //binary so no jsonp callback
+    worker_t::result_t result{false};
+    auto response = make_response(pbf, headers_t{CORS, PBF_MIME}, request);
+    response.from_info(request_info);
+    result.messages.emplace_back(response.to_string());
+    return result;
+  }
+
+  worker_t::result_t to_response_png(const std::string& png, http_request_info_t& request_info, const valhalla_request_t& request) {
+    //binary so no jsonp callback
+    worker_t::result_t result{false};
+    http_response_t response(200, "OK", png, headers_t{CORS, PNG_MIME});
+    response.from_info(request_info);
+    result.messages.emplace_back(response.to_string());
+    return result;
+  }
+
+  worker_t::result_t to_response_proxied(long status, const std::string& content_type, const std::string& body, http_request_info_t& request_info) {
+    //its already been through jsonp and compression wherever it came from
+    auto message = HTTP_STATUS_CODES.find(status);
+    worker_t::result_t result{false};
+    http_response_t response(status, message == HTTP_STATUS_CODES.cend() ? "Unknown" : message->second, body,
+      headers_t{CORS, content_type.empty() ? JSON_MIME : headers_t::value_type{"Content-type", content_type}});
+    response.from_info(request_info);
+    result.messages.emplace_back(response.to_string());
+    return result;
+  }
+
+  worker_t::result_t to_response_metrics(http_request_info_t& request_info) {
+    //whatever the stages running in this process have recorded so far
+    worker_t::result_t result{false};
+    http_response_t response(200, "OK", midgard::metrics::ToPrometheus(), headers_t{CORS, METRICS_MIME});
     response.from_info(request_info);
     result.messages.emplace_back(response.to_string());
     return result;
@@ -689,8 +930,253 @@ namespace valhalla {
 
   service_worker_t::service_worker_t(): interrupt(nullptr) {}
   service_worker_t::~service_worker_t() {}
-  void service_worker_t::set_interrupt(const std::function<void ()>& interrupt_function) {
+  void service_worker_t::set_interrupt(const std::function<void ()>& interrupt_function, uint64_t deadline) {
     interrupt = &interrupt_function;
+    if(!deadline)
+      return;
+
+    //a request that is already out of time is not worth starting
+    if(now_ms() > deadline)
+      throw valhalla_exception_t{159};
+    //otherwise the long running loops find out when they check for interrupts
+    deadline_interrupt = [&interrupt_function, deadline]() {
+      if(interrupt_function)
+        interrupt_function();
+      if(now_ms() > deadline)
+        throw valhalla_exception_t{159};
+    };
+    interrupt = &deadline_interrupt;
   };
 
+  admission_t::ticket_t::ticket_t(int action, uint64_t cost): action(action), cost(cost) {}
+  admission_t::ticket_t::ticket_t(ticket_t&& other): action(other.action), cost(other.cost) {
+    other.cost = 0;
+  }
+  admission_t::ticket_t::~ticket_t() {
+    if(cost) {
+      std::lock_guard<std::mutex> lock(in_flight_mutex);
+      in_flight[action] -= cost;
+    }
+  }
+
+  response_cache_t::response_cache_t(const boost::property_tree::ptree& config):
+    coalesce(config.get<bool>("coalesce", false)),
+    max_size(config.get<size_t>("response_cache_size", 0)),
+    max_age(std::chrono::milliseconds(static_cast<int64_t>(config.get<float>("response_cache_seconds", 1.f) * 1000))) {
+  }
+
+  std::string response_cache_t::get(const valhalla_request_t& request, uint64_t tile_version,
+                                    const std::function<std::string ()>& work) const {
+    //nothing is shared
+    if(!coalesce && max_size == 0)
+      return work();
+
+    auto request_key = key(request, tile_version);
+    std::promise<std::string> promise;
+    auto response = promise.get_future().share();
+    {
+      std::unique_lock<std::mutex> lock(responses_mutex);
+      //forget the responses that are too old or don't fit anymore
+      auto now = std::chrono::steady_clock::now();
+      while(!made_order.empty()) {
+        auto oldest = responses.find(made_order.front());
+        if(made_order.size() <= max_size && now - oldest->second.made_at < max_age)
+          break;
+        responses.erase(oldest);
+        made_order.pop_front();
+        METRICS_COUNT(kResponseCacheEvictions, 1);
+      }
+      METRICS_SET(kResponseCacheSize, made_order.size());
+
+      //someone made it already or is making it now
+      auto found = responses.find(request_key);
+      if(found != responses.end()) {
+        auto shared = found->second.response;
+        if(found->second.made)
+          METRICS_COUNT(kResponseCacheHits, 1);
+        else
+          METRICS_COUNT(kRequestsCoalesced, 1);
+        lock.unlock();
+        try {
+          return shared.get();
+        }
+        catch(...) {
+          return work();
+        }
+      }
+
+      //otherwise we make it and let the identical requests coming in meanwhile wait for it
+      if(coalesce) {
+        responses.emplace(request_key, shared_response_t{response, false, {}});
+        METRICS_SET(kRequestsInFlight, ++responses_in_flight);
+      }
+    }
+
+    //make it, sharing the failure with those waiting so they try for themselves
+    std::string made;
+    try {
+      made = work();
+    }
+    catch(...) {
+      promise.set_exception(std::current_exception());
+      if(coalesce) {
+        std::lock_guard<std::mutex> lock(responses_mutex);
+        responses.erase(request_key);
+        METRICS_SET(kRequestsInFlight, --responses_in_flight);
+      }
+      throw;
+    }
+    promise.set_value(made);
+
+    //keep it for a while if there is a cache
+    std::lock_guard<std::mutex> lock(responses_mutex);
+    if(coalesce)
+      METRICS_SET(kRequestsInFlight, --responses_in_flight);
+    if(max_size == 0) {
+      responses.erase(request_key);
+      return made;
+    }
+    auto& shared = responses[request_key];
+    if(!shared.made) {
+      shared = shared_response_t{response, true, std::chrono::steady_clock::now()};
+      made_order.push_back(request_key);
+      METRICS_SET(kResponseCacheSize, made_order.size());
+    }
+    return made;
+  }
+
+  std::string response_cache_t::key(const valhalla_request_t& request, uint64_t tile_version) {
+    //the deadline is when the client gives up and the trace who is watching, neither is part of what it asked for
+    auto options = request.options;
+    options.clear_deadline();
+    options.clear_trace_id();
+    options.clear_trace_parent();
+    options.clear_trace_sent();
+    auto request_key = std::to_string(tile_version);
+    request_key.push_back('\0');
+    request_key += options.SerializeAsString();
+    request_key.push_back('\0');
+    request_key += rapidjson::to_string(request.document);
+    return request_key;
+  }
+
+  stage_trace_t::stage_trace_t(const std::string& stage, odin::DirectionsOptions& options, float sample_rate) {
+    //start a trace for some of the requests that aren't part of one yet
+    if(!options.has_trace_id() && sample_rate > 0 &&
+       (midgard::tracing::new_span_id() >> 11) / 9007199254740992.0 < sample_rate)
+      options.set_trace_id(midgard::tracing::new_trace_id());
+    if(!options.has_trace_id())
+      return;
+
+    //the time it waited for this stage to take it
+    trace.id = options.trace_id();
+    trace.parent = options.trace_parent();
+    auto now = midgard::tracing::now();
+    if(options.has_trace_sent() && options.trace_sent() <= now)
+      trace.spans.push_back({stage + "_queue", midgard::tracing::new_span_id(), trace.parent, options.trace_sent(), now});
+
+    //everything timed from here on is part of this stage and the next stage's spans are children of it
+    scope.reset(new midgard::tracing::ScopedTrace(trace));
+    span.reset(new midgard::tracing::ScopedSpan(stage.c_str()));
+    options.set_trace_parent(trace.parent);
+    options.clear_trace_sent();
+  }
+
+  stage_trace_t::~stage_trace_t() {
+    if(!scope)
+      return;
+    span.reset();
+    for(const auto& s : trace.spans)
+      midgard::logging::Log(midgard::tracing::to_json(trace, s), " [TRACE] ");
+    scope.reset();
+  }
+
+  std::string stage_trace_t::forward(odin::DirectionsOptions& options) const {
+    if(scope)
+      options.set_trace_sent(midgard::tracing::now());
+    return options.SerializeAsString();
+  }
+
+  service_limits_t::service_limits_t(const boost::property_tree::ptree& config):
+    costings(), actions() {
+    bool found = false;
+    for(const auto& kv : config) {
+      // Costings have all the limits, a few actions only some of them
+      odin::DirectionsOptions::Costing costing;
+      if(odin::DirectionsOptions::Costing_Parse(kv.first, &costing) ||
+         odin::DirectionsOptions::Costing_Parse(kv.first + "_", &costing)) {
+        auto& limits = costings[costing];
+        limits.max_locations = kv.second.get<size_t>("max_locations");
+        limits.max_distance = kv.second.get<float>("max_distance");
+        limits.max_matrix_distance = kv.second.get<float>("max_matrix_distance");
+        limits.max_matrix_locations = kv.second.get<size_t>("max_matrix_locations");
+        found = true;
+      }
+      else if(kv.first == "isochrone") {
+        auto& limits = actions[odin::DirectionsOptions::isochrone];
+        limits.max_locations = kv.second.get<size_t>("max_locations");
+        limits.max_distance = kv.second.get<float>("max_distance");
+      }
+      else if(kv.first == "trace") {
+        auto max_distance = kv.second.get<float>("max_distance");
+        actions[odin::DirectionsOptions::trace_route].max_distance = max_distance;
+        actions[odin::DirectionsOptions::trace_attributes].max_distance = max_distance;
+      }
+    }
+    //this should never happen
+    if(!found)
+      throw std::runtime_error("Missing costing service_limits configuration");
+  }
+
+  admission_t::admission_t(const boost::property_tree::ptree& config) {
+    for(const auto& kv : config) {
+      odin::DirectionsOptions::Action action;
+      if(!odin::DirectionsOptions::Action_Parse(kv.first, &action)) {
+        LOG_WARN("Ignoring the admission budget of unknown action " + kv.first);
+        continue;
+      }
+      auto budget = kv.second.get_value<uint64_t>();
+      if(budget > 0)
+        budgets[action] = budget;
+    }
+  }
+
+  admission_t::ticket_t admission_t::admit(const odin::DirectionsOptions& options) const {
+    //nothing to keep track of if there is no budget for it
+    auto budget = budgets.find(options.action());
+    if(budget == budgets.cend())
+      return ticket_t(options.action(), 0);
+
+    //turn it away if it would go over, unless it has the budget to itself
+    auto request_cost = cost(options);
+    std::lock_guard<std::mutex> lock(in_flight_mutex);
+    auto& action_in_flight = in_flight[options.action()];
+    if(action_in_flight > 0 && action_in_flight + request_cost > budget->second)
+      throw valhalla_exception_t{450};
+    action_in_flight += request_cost;
+    return ticket_t(options.action(), request_cost);
+  }
+
+  uint64_t admission_t::cost(const odin::DirectionsOptions& options) {
+    uint64_t request_cost;
+    switch(options.action()) {
+      case odin::DirectionsOptions::sources_to_targets:
+        request_cost = static_cast<uint64_t>(options.sources_size()) * options.targets_size();
+        break;
+      case odin::DirectionsOptions::optimized_route:
+        request_cost = static_cast<uint64_t>(options.locations_size()) * options.locations_size();
+        break;
+      case odin::DirectionsOptions::trace_route:
+      case odin::DirectionsOptions::trace_attributes:
+      case odin::DirectionsOptions::height:
+        request_cost = options.shape_size();
+        for(const auto& encoded : options.encoded_polylines())
+          request_cost += midgard::decode<std::vector<midgard::PointLL> >(encoded).size();
+        break;
+      default:
+        request_cost = options.locations_size();
+    }
+    return std::max<uint64_t>(request_cost, 1);
+  }
+
 }
@@ -1,5 +1,6 @@
 #include "test.h"
 
+#include <cmath>
 #include <stdexcept>
 
 #include <boost/property_tree/ptree.hpp>
@@ -87,6 +88,66 @@ namespace {
 
   }
 
+  void test_summary_only() {
+    auto conf = make_conf();
+    tyr::actor_t actor(conf);
+
+    auto route_json = actor.route(R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+          {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto","summary_only":true})");
+    actor.cleanup();
+    auto route = json_to_pt(route_json);
+    if (route_json.find("maneuvers") != std::string::npos)
+      throw std::logic_error("Summary only routes should not have maneuvers");
+    const auto& leg = route.get_child("trip.legs").front().second;
+    if (leg.get<std::string>("shape").empty() || leg.get<float>("summary.length") <= 0.f ||
+        route.get<float>("trip.summary.length") != leg.get<float>("summary.length"))
+      throw std::logic_error("Summary only routes should have the time, length and shape of each leg");
+  }
+
+  void test_alternates() {
+    auto conf = make_conf();
+    tyr::actor_t actor(conf);
+
+    auto route_json = actor.route(R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+          {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto","summary_only":true,"alternates":2})");
+    actor.cleanup();
+    auto route = json_to_pt(route_json);
+    const auto& shape = route.get_child("trip.legs").front().second.get<std::string>("shape");
+    auto alternates = route.get_child_optional("alternates");
+    if (!alternates)
+      return;
+    if (alternates->size() > 2)
+      throw std::logic_error("There should be no more alternates than were asked for");
+    for (const auto& alternate : *alternates) {
+      const auto& leg = alternate.second.get_child("legs").front().second;
+      if (leg.get<std::string>("shape").empty() || leg.get<std::string>("shape") == shape)
+        throw std::logic_error("Alternates should have their own shape");
+    }
+  }
+
+  void test_parallel_legs() {
+    // Route the legs between the breaks on one thread and then on three
+    auto conf = make_conf();
+    conf.put("thor.matrix_threads", 1);
+    tyr::actor_t one_thread(conf);
+    conf.put("thor.matrix_threads", 3);
+    tyr::actor_t three_threads(conf);
+
+    std::string request = R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+          {"lat":40.544232,"lon":-76.385752,"type":"break"},{"lat":40.546115,"lon":-76.385076,"type":"break"},
+          {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto","summary_only":true})";
+    auto expected = json_to_pt(one_thread.route(request)).get_child("trip.legs");
+    auto legs = json_to_pt(three_threads.route(request)).get_child("trip.legs");
+    one_thread.cleanup();
+    three_threads.cleanup();
+    if (legs.size() != 3 || expected.size() != 3)
+      throw std::logic_error("Expected a leg between each pair of breaks");
+    for (auto leg = legs.begin(), other = expected.begin(); leg != legs.end(); ++leg, ++other) {
+      if (leg->second.get<std::string>("shape") != other->second.get<std::string>("shape"))
+        throw std::logic_error("Legs routed on threads should be the same and in the same order");
+    }
+  }
+
   void test_interrupt() {
     auto conf = make_conf();
     tyr::actor_t actor(conf);
@@ -107,6 +168,77 @@ namespace {
     //TODO: test the rest of them
   }
 
+  void test_prebuilt_options() {
+    auto conf = make_conf();
+    tyr::actor_t actor(conf);
+
+    //the same route from json and from options built by hand
+    auto route_json = actor.route(R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
+          {"lat":40.544232,"lon":-76.385752,"type":"break"}],"costing":"auto"})");
+    actor.cleanup();
+    odin::DirectionsOptions options;
+    options.set_action(odin::DirectionsOptions::route);
+    options.set_costing(odin::DirectionsOptions::auto_);
+    for (const auto& ll : std::vector<std::pair<float, float> >{{40.546115f, -76.385076f}, {40.544232f, -76.385752f}}) {
+      auto* location = options.add_locations();
+      location->mutable_ll()->set_lat(ll.first);
+      location->mutable_ll()->set_lng(ll.second);
+    }
+    valhalla_request_t request(options);
+    std::list<odin::TripPath> legs;
+    auto directions = actor.directions(request, legs);
+    actor.cleanup();
+    if (legs.size() != 1 || directions.size() != 1 || legs.front().node_size() == 0)
+      throw std::logic_error("Expected one leg with a path and directions");
+    auto length = json_to_pt(route_json).get<float>("trip.summary.length");
+    if (std::abs(directions.front().summary().length() - length) > .01f)
+      throw std::logic_error("Directions from prebuilt options should match the ones from json");
+
+    //there are no directions for anything but routes
+    options.set_action(odin::DirectionsOptions::locate);
+    try {
+      valhalla_request_t locate(options);
+      actor.directions(locate, legs);
+      throw std::logic_error("Expected only routes to have directions");
+    } catch (const valhalla_exception_t& e) { }
+  }
+
+  void test_admission() {
+    admission_t admission(json_to_pt(R"({"sources_to_targets": 10, "optimized_route": 0})"));
+    odin::DirectionsOptions matrix, big_matrix, route;
+    matrix.set_action(odin::DirectionsOptions::sources_to_targets);
+    for (int i = 0; i < 3; ++i) {
+      matrix.add_sources();
+      matrix.add_targets();
+    }
+    big_matrix = matrix;
+    for (int i = 0; i < 3; ++i) {
+      big_matrix.add_sources();
+      big_matrix.add_targets();
+    }
+    route.set_action(odin::DirectionsOptions::route);
+
+    {
+      //a 3x3 matrix fits but a second one would go over
+      auto ticket = admission.admit(matrix);
+      try {
+        admission.admit(matrix);
+        throw std::logic_error("Expected the second matrix to be turned away");
+      } catch (const valhalla_exception_t& e) {
+        if (e.code != 450)
+          throw std::logic_error("Expected the matrix to be turned away for being too much work");
+      }
+      //other actions are not held up by it
+      for (int i = 0; i < 100; ++i)
+        admission.admit(route);
+    }
+
+    //the budget comes back with the ticket and a matrix bigger than it still runs on its own
+    auto ticket = admission.admit(big_matrix);
+    if (admission_t::cost(big_matrix) != 36)
+      throw std::logic_error("Expected a matrix to cost sources times targets");
+  }
+
 }
 
 int main() {
@@ -114,7 +246,17 @@ int main() {
 
   suite.test(TEST_CASE(test_actor));
 
+  suite.test(TEST_CASE(test_summary_only));
+
+  suite.test(TEST_CASE(test_alternates));
+
+  suite.test(TEST_CASE(test_parallel_legs));
+
   suite.test(TEST_CASE(test_interrupt));
 
+  suite.test(TEST_CASE(test_prebuilt_options));
+
+  suite.test(TEST_CASE(test_admission));
+
   return suite.tear_down();
 }
@@ -15,6 +15,7 @@
 #include "baldr/location.h"
 #include "baldr/tilehierarchy.h"
 #include "sif/pedestriancost.h"
+#include "sif/costfactory.h"
 #include "sif/costconstants.h"
 #include "sif/dynamiccost.h"
 #include "thor/astar.h"
@@ -211,7 +212,7 @@ void assert_is_trivial_path(
 
   auto mode = vs::TravelMode::kPedestrian;
   vs::cost_ptr_t costs[int(vs::TravelMode::kMaxTravelMode)];
-  auto pedestrian = vs::CreatePedestrianCost(bpt::ptree());
+  auto pedestrian = vs::CreatePedestrianCost(rapidjson::Value{});
   costs[int(mode)] = pedestrian;
   assert(bool(costs[int(mode)]));
 
@@ -331,7 +332,9 @@ void trivial_path_no_uturns(const std::string& config_file) {
   auto costing_options = conf.get_child(method_options, {});
 
   std::shared_ptr<vs::DynamicCost> mode_costing[4];
-  std::shared_ptr<vs::DynamicCost> cost = vs::CreatePedestrianCost(costing_options);
+  vs::CostFactory<vs::DynamicCost> factory;
+  factory.Register("pedestrian", vs::CreatePedestrianCost);
+  std::shared_ptr<vs::DynamicCost> cost = factory.Create("pedestrian", costing_options);
   auto mode = cost->travel_mode();
   mode_costing[static_cast<uint32_t>(mode)] = cost;
 
@@ -131,6 +131,45 @@ void TestAdminAttributeEnabled() {
   TryCategoryAttributeEnabled(controller, kAdminCategory, true);
 }
 
+void TestRouteAttributes() {
+  AttributesController controller;
+
+  // Test default, route paths skip what only trace_attributes reports
+  TryCategoryAttributeEnabled(controller, kMatchedCategory, false);
+  if (controller.attributes.at(kEdgeLaneConnectivity) ||
+      controller.attributes.at(kEdgeTrafficSegments))
+    throw runtime_error("Route attributes should not include trace only attributes");
+  if (!controller.attributes.at(kEdgeNames) ||
+      !controller.attributes.at(kEdgeSignExitNumber))
+    throw runtime_error("Route attributes should include guidance attributes");
+
+  // Test all matched enabled
+  controller.enable_all();
+  TryCategoryAttributeEnabled(controller, kMatchedCategory, true);
+}
+
+void TestColumnsSuffice() {
+  AttributesController controller;
+
+  // Test default, route paths need much more than the columns
+  if (controller.columns_suffice())
+    throw runtime_error("Route attributes should not fit in columns");
+
+  // Test only column attributes enabled
+  controller.disable_all();
+  controller.attributes.at(kEdgeLength) = true;
+  controller.attributes.at(kEdgeWayId) = true;
+  controller.attributes.at(kNodeElapsedTime) = true;
+  controller.attributes.at(kShape) = true;
+  if (!controller.columns_suffice())
+    throw runtime_error("Column attributes should fit in columns");
+
+  // Test one more edge attribute enabled
+  controller.attributes.at(kEdgeNames) = true;
+  if (controller.columns_suffice())
+    throw runtime_error("Edge names should not fit in columns");
+}
+
 }
 
 int main() {
@@ -154,5 +193,11 @@ int main() {
   // Test admin category_attribute_enabled
   suite.test(TEST_CASE(TestAdminAttributeEnabled));
 
+  // Test route attributes defaults
+  suite.test(TEST_CASE(TestRouteAttributes));
+
+  // Test columns_suffice
+  suite.test(TEST_CASE(TestColumnsSuffice));
+
   return suite.tear_down();
 }
@@ -0,0 +1,120 @@
+#include "test.h"
+
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "meili/batch_matcher.h"
+#include "meili/map_matcher_factory.h"
+
+using namespace valhalla;
+
+namespace {
+
+boost::property_tree::ptree config() {
+  std::stringstream conf_json; conf_json << R"({
+    "mjolnir":{"tile_dir":"test/traffic_matcher_tiles"},
+    "meili":{"mode":"auto","grid":{"cache_size":100240,"size":500},
+             "default":{"beta":3,"breakage_distance":10000,"geometry":false,"gps_accuracy":5.0,"interpolation_distance":10,
+             "max_route_distance_factor":5,"max_route_time_factor":5,"max_search_radius":100,"route":true,
+             "search_radius":50,"sigma_z":4.07,"turn_penalty_factor":200}}
+  })";
+  boost::property_tree::ptree conf;
+  boost::property_tree::read_json(conf_json, conf);
+  return conf;
+}
+
+// Traces between a few points of the test tile
+std::vector<std::vector<meili::Measurement> > traces() {
+  std::vector<midgard::PointLL> points = {
+    {-76.376045f, 40.539207f}, {-76.357056f, 40.541309f}, {-76.351089f, 40.541504f},
+    {-76.38126f, 40.55602f}, {-76.35784f, 40.56786f}};
+  std::vector<std::vector<meili::Measurement> > traces;
+  for (size_t i = 0; i < 40; ++i) {
+    const auto& a = points[i % points.size()];
+    const auto& b = points[(i + i / points.size() % (points.size() - 1) + 1) % points.size()];
+    traces.push_back({{a, 5.f, 50.f, 0.}, {b, 5.f, 50.f, 300.}});
+  }
+  return traces;
+}
+
+void TestSameAsSerial() {
+  auto conf = config();
+  auto batch = traces();
+
+  // Match them one after the other with a single matcher
+  meili::MapMatcherFactory factory(conf);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(boost::property_tree::ptree()));
+  std::vector<std::vector<meili::MatchResults> > expected;
+  for (const auto& trace : batch)
+    expected.emplace_back(matcher->OfflineMatch(trace));
+
+  meili::BatchMatcher batch_matcher(conf, 4);
+  test::assert_bool(batch_matcher.thread_count() == 4, "Expected 4 threads");
+  for (int run = 0; run < 2; ++run) {
+    auto results = batch_matcher.Match(boost::property_tree::ptree(), batch);
+    test::assert_bool(results.size() == batch.size(), "Expected a result per trace");
+    for (size_t i = 0; i < results.size(); ++i) {
+      test::assert_bool(results[i].index == i && results[i].error.empty(), "Expected trace " + std::to_string(i) + " to match");
+      const auto& a = expected[i].front();
+      const auto& b = results[i].results.front();
+      test::assert_bool(!a.edges.empty() && a.edges == b.edges, "Expected the same path as the serial match");
+      test::assert_bool(a.results.size() == b.results.size(), "Expected the same number of matches");
+      for (size_t j = 0; j < a.results.size(); ++j)
+        test::assert_bool(a.results[j].edgeid == b.results[j].edgeid &&
+                          a.results[j].distance_along == b.results[j].distance_along,
+                          "Expected the same match points as the serial match");
+    }
+  }
+}
+
+void TestStreaming() {
+  meili::BatchMatcher batch_matcher(config(), 3);
+  auto batch = traces();
+
+  // Every trace comes back once, a bad one with its error
+  std::set<size_t> seen;
+  size_t failed = 0;
+  batch_matcher.Match(boost::property_tree::ptree(), batch, [&seen, &failed](meili::BatchMatcher::TraceResult&& result) {
+    seen.insert(result.index);
+    if (!result.error.empty())
+      failed++;
+  }, 0);
+  test::assert_bool(seen.size() == batch.size() && failed == batch.size(),
+                    "Expected every trace back with an error for k = 0");
+
+  // A throwing callback stops the batch and is rethrown
+  size_t called = 0;
+  try {
+    batch_matcher.Match(boost::property_tree::ptree(), batch, [&called](meili::BatchMatcher::TraceResult&&) {
+      called++;
+      throw std::runtime_error("stop");
+    });
+    throw std::logic_error("Expected the callback failure to be rethrown");
+  } catch (const std::runtime_error& e) {
+    test::assert_bool(std::string(e.what()) == "stop" && called == 1,
+                      "Expected the batch to stop at the first callback failure");
+  }
+
+  // A bad mode fails every trace rather than the batch
+  boost::property_tree::ptree preferences;
+  preferences.put("mode", "not_a_mode");
+  auto results = batch_matcher.Match(preferences, batch);
+  for (const auto& result : results)
+    test::assert_bool(!result.error.empty() && result.results.empty(), "Expected an error for a bad mode");
+}
+
+}
+
+int main() {
+  test::suite suite("batch matcher");
+
+  suite.test(TEST_CASE(TestSameAsSerial));
+
+  suite.test(TEST_CASE(TestStreaming));
+
+  return suite.tear_down();
+}
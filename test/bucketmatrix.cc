@@ -0,0 +1,192 @@
+#include "test.h"
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "baldr/chgraph.h"
+#include "mjolnir/chbuilder.h"
+#include "thor/bucketmatrix.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// Random graph of turns where the time and length of a turn are a fixed
+// share of its cost
+std::vector<CHBuilder::Turn> RandomTurns(const uint32_t node_count, std::mt19937& gen) {
+  std::vector<CHBuilder::Turn> turns;
+  for (uint32_t from = 0; from < node_count; ++from) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      uint32_t to = (from + 1 + static_cast<uint32_t>(test::rand01(gen) * 20)) % node_count;
+      if (i == 0)
+        to = (from + 1) % node_count;
+      float secs = std::floor(1 + test::rand01(gen) * 100);
+      turns.push_back({from, to, secs * 2, secs, secs * 10});
+    }
+  }
+  return turns;
+}
+
+std::vector<GraphId> Edges(const uint32_t node_count) {
+  std::vector<GraphId> edges;
+  for (uint32_t i = 0; i < node_count; ++i)
+    edges.emplace_back(7, 2, i);
+  return edges;
+}
+
+// Plain dijkstra from a node to all the others
+std::vector<float> Dijkstra(const uint32_t node_count, const std::vector<CHBuilder::Turn>& turns,
+                            const uint32_t source) {
+  std::vector<std::vector<CHBuilder::Turn> > out(node_count);
+  for (const auto& turn : turns)
+    out[turn.from].push_back(turn);
+  std::vector<float> dist(node_count, std::numeric_limits<float>::max());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second])
+      continue;
+    for (const auto& turn : out[top.second]) {
+      if (top.first + turn.cost < dist[turn.to]) {
+        dist[turn.to] = top.first + turn.cost;
+        queue.emplace(dist[turn.to], turn.to);
+      }
+    }
+  }
+  return dist;
+}
+
+void TestMatrix() {
+  std::mt19937 gen(11);
+  const uint32_t node_count = 400;
+  auto turns = RandomTurns(node_count, gen);
+  auto graph = std::make_shared<const CHGraph>(CHBuilder::Contract("auto", Edges(node_count), turns, 50));
+
+  std::vector<std::vector<BucketMatrix::Seed> > sources, targets;
+  for (uint32_t i = 0; i < 30; ++i)
+    sources.push_back({{static_cast<uint32_t>(test::rand01(gen) * node_count), 0.f, 0.f, 0.f}});
+  for (uint32_t i = 0; i < 40; ++i)
+    targets.push_back({{static_cast<uint32_t>(test::rand01(gen) * node_count), 0.f, 0.f, 0.f}});
+
+  BucketMatrix matrix(graph, 4);
+  auto connections = matrix.Connect(sources, targets);
+  test::assert_bool(connections.size() == sources.size() * targets.size(),
+                    "Expected a connection per source and target");
+  for (size_t i = 0; i < sources.size(); ++i) {
+    auto dist = Dijkstra(node_count, turns, sources[i].front().node);
+    for (size_t j = 0; j < targets.size(); ++j) {
+      const auto& connection = connections[i * targets.size() + j];
+      float expected = dist[targets[j].front().node];
+      test::assert_bool(std::fabs(connection.cost - expected) < 0.01f,
+                        "Expected the same cost as dijkstra " + std::to_string(connection.cost) +
+                        " vs " + std::to_string(expected));
+      test::assert_bool(std::fabs(connection.secs * 2 - connection.cost) < 0.01f &&
+                        std::fabs(connection.length - connection.secs * 10) < 0.1f,
+                        "Expected the time and length along the same path");
+    }
+  }
+
+  // The same on one thread
+  auto serial = BucketMatrix(graph, 1).Connect(sources, targets);
+  for (size_t i = 0; i < serial.size(); ++i)
+    test::assert_bool(serial[i].cost == connections[i].cost && serial[i].secs == connections[i].secs,
+                      "Expected the same connections on one thread");
+}
+
+void TestSeeds() {
+  // A line 0 -> 1 -> 2 -> 3 and a second way 0 -> 4 -> 3 that is cheaper
+  // unless the search is forced to start at 1
+  std::vector<CHBuilder::Turn> turns = {
+    {0, 1, 10, 10, 10}, {1, 2, 10, 10, 10}, {2, 3, 10, 10, 10}, {0, 4, 5, 5, 5}, {4, 3, 5, 5, 5}};
+  auto graph = std::make_shared<const CHGraph>(CHBuilder::Contract("auto", Edges(5), turns));
+  BucketMatrix matrix(graph, 2);
+
+  // Negative target seeds are how the rest of the destination edge is refunded
+  auto connections = matrix.Connect({{{0, 2.f, 2.f, 2.f}}, {{0, 25.f, 25.f, 25.f}, {1, 0.f, 0.f, 0.f}}},
+                                    {{{3, -4.f, -4.f, -4.f}}, {{2, 0.f, 0.f, 0.f}}});
+  test::assert_bool(connections[0].cost == 8.f && connections[0].length == 8.f,
+                    "Expected the cheaper way with the seeds applied");
+  test::assert_bool(connections[1].cost == 22.f, "Expected the way along the line");
+  test::assert_bool(connections[2].cost == 16.f, "Expected the cheaper of the two sources");
+  test::assert_bool(connections[3].cost == 10.f, "Expected the second source");
+
+  // On the same edge the target has to be ahead of the source
+  connections = matrix.Connect({{{1, 6.f, 6.f, 6.f}}}, {{{1, -2.f, -2.f, -2.f}}, {{1, -8.f, -8.f, -8.f}}});
+  test::assert_bool(connections[0].cost == 4.f, "Expected the path along the edge");
+  test::assert_bool(connections[1].cost == kMaxCost, "Expected no path back along the edge");
+
+  // Without an overlay nothing is connected
+  connections = BucketMatrix(nullptr).Connect({{{0, 0.f, 0.f, 0.f}}}, {{{3, 0.f, 0.f, 0.f}}});
+  test::assert_bool(connections[0].cost == kMaxCost, "Expected no connection without an overlay");
+}
+
+void TestSweep() {
+  std::mt19937 gen(13);
+  const uint32_t node_count = 400;
+  auto turns = RandomTurns(node_count, gen);
+  auto graph = std::make_shared<const CHGraph>(CHBuilder::Contract("auto", Edges(node_count), turns, 50));
+
+  std::vector<std::vector<BucketMatrix::Seed> > sources, targets;
+  for (uint32_t i = 0; i < 30; ++i)
+    sources.push_back({{static_cast<uint32_t>(test::rand01(gen) * node_count), 0.f, 0.f, 0.f}});
+  for (uint32_t i = 0; i < 40; ++i)
+    targets.push_back({{static_cast<uint32_t>(test::rand01(gen) * node_count), 0.f, 0.f, 0.f}});
+
+  auto connections = SweepMatrix(graph, 3).Connect(sources, targets);
+  test::assert_bool(connections.size() == sources.size() * targets.size(),
+                    "Expected a connection per source and target");
+  for (size_t i = 0; i < sources.size(); ++i) {
+    auto dist = Dijkstra(node_count, turns, sources[i].front().node);
+    for (size_t j = 0; j < targets.size(); ++j) {
+      const auto& connection = connections[i * targets.size() + j];
+      float expected = dist[targets[j].front().node];
+      test::assert_bool(std::fabs(connection.cost - expected) < 0.01f,
+                        "Expected the same cost as dijkstra " + std::to_string(connection.cost) +
+                        " vs " + std::to_string(expected));
+      test::assert_bool(std::fabs(connection.secs * 2 - connection.cost) < 0.01f &&
+                        std::fabs(connection.length - connection.secs * 10) < 0.1f,
+                        "Expected the time and length along the same path");
+    }
+  }
+
+  // The seeds are applied the same way as in the buckets
+  std::vector<CHBuilder::Turn> line = {
+    {0, 1, 10, 10, 10}, {1, 2, 10, 10, 10}, {2, 3, 10, 10, 10}, {0, 4, 5, 5, 5}, {4, 3, 5, 5, 5}};
+  auto line_graph = std::make_shared<const CHGraph>(CHBuilder::Contract("auto", Edges(5), line));
+  SweepMatrix matrix(line_graph, 2);
+  connections = matrix.Connect({{{0, 2.f, 2.f, 2.f}}, {{0, 25.f, 25.f, 25.f}, {1, 0.f, 0.f, 0.f}}},
+                               {{{3, -4.f, -4.f, -4.f}}, {{2, 0.f, 0.f, 0.f}}});
+  test::assert_bool(connections[0].cost == 8.f && connections[0].length == 8.f,
+                    "Expected the cheaper way with the seeds applied");
+  test::assert_bool(connections[1].cost == 22.f, "Expected the way along the line");
+  test::assert_bool(connections[2].cost == 16.f, "Expected the cheaper of the two sources");
+  test::assert_bool(connections[3].cost == 10.f, "Expected the second source");
+  connections = matrix.Connect({{{1, 6.f, 6.f, 6.f}}}, {{{1, -2.f, -2.f, -2.f}}, {{1, -8.f, -8.f, -8.f}}});
+  test::assert_bool(connections[0].cost == 4.f, "Expected the path along the edge");
+  test::assert_bool(connections[1].cost == kMaxCost, "Expected no path back along the edge");
+}
+
+}
+
+int main() {
+  test::suite suite("bucketmatrix");
+
+  suite.test(TEST_CASE(TestMatrix));
+
+  suite.test(TEST_CASE(TestSeeds));
+
+  suite.test(TEST_CASE(TestSweep));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "meili/candidate_search.h"
+
+using namespace valhalla;
+
+namespace {
+
+// Projects onto the decoded shape of every edge binned in the tiles, the
+// way the grid query did before it kept the segments
+class BruteForceQuery: public meili::CandidateQuery {
+ public:
+  BruteForceQuery(baldr::GraphReader& reader)
+      : meili::CandidateQuery(reader) {
+    for (const auto& tileid : reader.GetTileSet(baldr::TileHierarchy::levels().rbegin()->first)) {
+      const auto* tile = reader.GetGraphTile(tileid);
+      for (size_t bin = 0; bin < baldr::kBinCount; ++bin) {
+        for (const auto& edgeid : tile->GetBin(bin)) {
+          edgeids_.push_back(edgeid);
+        }
+      }
+    }
+    std::sort(edgeids_.begin(), edgeids_.end());
+    edgeids_.erase(std::unique(edgeids_.begin(), edgeids_.end()), edgeids_.end());
+  }
+
+  std::vector<baldr::PathLocation>
+  Query(const midgard::PointLL& location, float sq_search_radius, sif::EdgeFilter filter) const override {
+    return WithinSquaredDistance(location, sq_search_radius, edgeids_.cbegin(), edgeids_.cend(), filter);
+  }
+
+ protected:
+  std::vector<baldr::GraphId> edgeids_;
+};
+
+bool near(const float a, const float b, const float tolerance) {
+  return std::abs(a - b) <= tolerance;
+}
+
+void TestSameAsShapeProjection() {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", "test/traffic_matcher_tiles");
+  baldr::GraphReader reader(conf);
+  BruteForceQuery expected_query(reader);
+  meili::CandidateGridQuery grid_query(reader, 0.25f / 500, 0.25f / 500);
+
+  // Locations on a lattice over the roads of the test tile
+  size_t found = 0;
+  for (int i = 0; i < 30; ++i) {
+    for (int j = 0; j < 30; ++j) {
+      const midgard::PointLL location(-76.39f + i * 0.0015f, 40.53f + j * 0.0015f);
+      for (const float radius : {5.f, 50.f, 200.f}) {
+        const auto expected = expected_query.Query(location, radius * radius, nullptr);
+        const auto candidates = grid_query.Query(location, radius * radius, nullptr);
+        const auto where = std::to_string(location.lng()) + "," + std::to_string(location.lat()) + " within " + std::to_string(radius);
+        test::assert_bool(expected.size() == candidates.size(), "Expected the same candidates at " + where);
+        for (size_t c = 0; c < expected.size(); ++c) {
+          const auto& a = expected[c].edges;
+          const auto& b = candidates[c].edges;
+          test::assert_bool(a.size() == b.size(), "Expected the same candidate edges at " + where);
+          for (size_t e = 0; e < a.size(); ++e) {
+            test::assert_bool(a[e].id == b[e].id &&
+                              near(a[e].percent_along, b[e].percent_along, 1e-5f) &&
+                              near(a[e].distance, b[e].distance, 1e-2f + a[e].distance * 1e-5f) &&
+                              a[e].projected.Distance(b[e].projected) < 0.01f,
+                              "Expected the same projection at " + where);
+          }
+        }
+        found += candidates.size();
+      }
+    }
+  }
+  test::assert_bool(found > 0, "Expected some candidates near the roads");
+}
+
+}
+
+int main() {
+  test::suite suite("candidate search");
+
+  suite.test(TEST_CASE(TestSameAsShapeProjection));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,74 @@
+#include "test.h"
+#include "midgard/compute_slots.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+void wait_for(const std::atomic<bool>& flag) {
+  for(size_t i = 0; i < 5000 && !flag; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void TestNoSlots() {
+  //without slots nothing is held and nothing waits
+  compute_slots::set_slots(0);
+  compute_slots::ScopedSlot slot;
+  compute_slots::ScopedSlot other;
+  if(compute_slots::held() != 0)
+    throw std::runtime_error("Without slots none should be held");
+}
+
+void TestWaitGivesUpSlot() {
+  compute_slots::set_slots(1);
+  std::atomic<bool> holding(false), waiting(false), other_computing(false), done(false), in_order(false);
+  std::thread worker([&]() {
+    compute_slots::ScopedSlot slot;
+    holding = true;
+    //the other worker can only compute while this one waits
+    wait_for(waiting);
+    {
+      compute_slots::ScopedWait wait;
+      wait_for(other_computing);
+    }
+    //and this one only gets back to it once the other is done
+    in_order = done.load();
+  });
+  wait_for(holding);
+  {
+    waiting = true;
+    compute_slots::ScopedSlot slot;
+    if(compute_slots::held() != 1)
+      throw std::runtime_error("Only one slot should be held");
+    other_computing = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    done = true;
+  }
+  worker.join();
+  if(!in_order)
+    throw std::runtime_error("Should have waited for the slot");
+  if(compute_slots::held() != 0)
+    throw std::runtime_error("Every slot should have been given back");
+
+  //a thread already holding a slot doesnt wait on another
+  {
+    compute_slots::ScopedSlot slot;
+    compute_slots::ScopedSlot nested;
+  }
+  compute_slots::set_slots(0);
+}
+
+}
+
+int main() {
+  test::suite suite("compute_slots");
+
+  suite.test(TEST_CASE(TestNoSlots));
+  suite.test(TEST_CASE(TestWaitGivesUpSlot));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,179 @@
+#include "test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "config.h"
+#include "baldr/chgraph.h"
+#include "mjolnir/chbuilder.h"
+#include "thor/contractionhierarchy.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// Random graph of turns, roughly grid like so that there are plenty of
+// alternative paths for the witness searches to find
+std::vector<CHBuilder::Turn> RandomTurns(const uint32_t node_count, std::mt19937& gen) {
+  std::vector<CHBuilder::Turn> turns;
+  for (uint32_t from = 0; from < node_count; ++from) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      uint32_t to = (from + 1 + static_cast<uint32_t>(test::rand01(gen) * 20)) % node_count;
+      if (i == 0)
+        to = (from + 1) % node_count;
+      float secs = std::floor(1 + test::rand01(gen) * 100);
+      turns.push_back({from, to, secs * 2, secs});
+    }
+  }
+  return turns;
+}
+
+std::vector<GraphId> Edges(const uint32_t node_count) {
+  std::vector<GraphId> edges;
+  for (uint32_t i = 0; i < node_count; ++i)
+    edges.emplace_back(7, 2, i);
+  return edges;
+}
+
+// Plain dijkstra over the turns
+float Dijkstra(const uint32_t node_count, const std::vector<CHBuilder::Turn>& turns,
+               const uint32_t source, const uint32_t target) {
+  std::vector<std::vector<CHBuilder::Turn> > out(node_count);
+  for (const auto& turn : turns)
+    out[turn.from].push_back(turn);
+  std::vector<float> dist(node_count, std::numeric_limits<float>::max());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second])
+      continue;
+    if (top.second == target)
+      return top.first;
+    for (const auto& turn : out[top.second]) {
+      if (top.first + turn.cost < dist[turn.to]) {
+        dist[turn.to] = top.first + turn.cost;
+        queue.emplace(dist[turn.to], turn.to);
+      }
+    }
+  }
+  return -1.f;
+}
+
+// Cost of the turn between two nodes
+const CHBuilder::Turn* FindTurn(const std::vector<CHBuilder::Turn>& turns,
+                                const uint32_t from, const uint32_t to) {
+  const CHBuilder::Turn* best = nullptr;
+  for (const auto& turn : turns)
+    if (turn.from == from && turn.to == to && (best == nullptr || turn.cost < best->cost))
+      best = &turn;
+  return best;
+}
+
+void TestShortestPaths() {
+  std::mt19937 gen(42);
+  const uint32_t node_count = 400;
+  auto turns = RandomTurns(node_count, gen);
+  auto graph = std::make_shared<const CHGraph>(CHBuilder::Contract("auto", Edges(node_count), turns, 50));
+  test::assert_bool(graph->node_count() == node_count, "Expected a node per edge");
+  test::assert_bool(graph->node(GraphId(7, 2, 123)) == 123, "Expected to find the node of an edge");
+  test::assert_bool(graph->node(GraphId(8, 2, 123)) == kInvalidCHNode, "Unexpected node for an unknown edge");
+
+  ContractionHierarchy ch;
+  ch.set_graph(graph);
+  std::vector<std::pair<uint32_t, float> > path;
+  for (uint32_t i = 0; i < 200; ++i) {
+    uint32_t source = test::rand01(gen) * node_count;
+    uint32_t target = test::rand01(gen) * node_count;
+    if (source == target)
+      continue;
+    float expected = Dijkstra(node_count, turns, source, target);
+    float cost = ch.Search({{source, 0.f}}, {{target, 0.f}}, path);
+    test::assert_bool(std::fabs(cost - expected) < 0.01f, "Expected the same cost as dijkstra " +
+                      std::to_string(cost) + " vs " + std::to_string(expected));
+
+    // The unpacked path must be made of original turns adding up to the cost
+    test::assert_bool(path.front().first == source && path.back().first == target,
+                      "Expected the path to go from the source to the target");
+    float secs = 0.f;
+    for (size_t n = 1; n < path.size(); ++n) {
+      auto turn = FindTurn(turns, path[n - 1].first, path[n].first);
+      test::assert_bool(turn != nullptr, "Unpacked path is not made of turns");
+      test::assert_bool(turn->secs == path[n].second, "Unpacked path has the wrong elapsed time");
+      secs += turn->secs;
+    }
+    test::assert_bool(std::fabs(secs * 2 - cost) < 0.01f, "Unpacked path does not add up to its cost");
+  }
+}
+
+void TestSeedCosts() {
+  // A line 0 -> 1 -> 2 -> 3 and a second way 0 -> 4 -> 3 that is cheaper
+  // unless the search is forced to start at 1
+  std::vector<CHBuilder::Turn> turns = {
+    {0, 1, 10, 10}, {1, 2, 10, 10}, {2, 3, 10, 10}, {0, 4, 5, 5}, {4, 3, 5, 5}};
+  auto graph = std::make_shared<const CHGraph>(CHBuilder::Contract("auto", Edges(5), turns));
+  ContractionHierarchy ch;
+  ch.set_graph(graph);
+  std::vector<std::pair<uint32_t, float> > path;
+
+  // Negative target costs are how the rest of the destination edge is refunded
+  float cost = ch.Search({{0, 2.f}}, {{3, -4.f}}, path);
+  test::assert_bool(cost == 8.f && path.size() == 3 && path[1].first == 4,
+                    "Expected the cheaper way with the seed costs applied");
+  cost = ch.Search({{0, 25.f}, {1, 0.f}}, {{3, -4.f}}, path);
+  test::assert_bool(cost == 16.f && path.front().first == 1,
+                    "Expected the cheaper of the two sources");
+  cost = ch.Search({{3, 0.f}}, {{0, 0.f}}, path);
+  test::assert_bool(cost < 0.f && path.empty(), "Expected no path against the turns");
+}
+
+void TestWriteLoad() {
+  std::mt19937 gen(7);
+  auto turns = RandomTurns(100, gen);
+  auto graph = CHBuilder::Contract("truck", Edges(100), turns);
+  std::string file_name = "test/data/contractionhierarchy.ch";
+  graph.Write(file_name);
+  auto loaded = CHGraph::Load(file_name);
+  std::remove(file_name.c_str());
+  test::assert_bool(loaded.costing() == "truck", "Expected the costing to be read back");
+  test::assert_bool(loaded.node_count() == graph.node_count() &&
+                    loaded.arc_count() == graph.arc_count(), "Expected the same nodes and arcs");
+  for (uint32_t n = 0; n < graph.node_count(); ++n) {
+    test::assert_bool(loaded.edgeid(n) == graph.edgeid(n), "Expected the same edges");
+    auto a = graph.forward(n);
+    auto b = loaded.forward(n);
+    test::assert_bool(a.size() == b.size(), "Expected the same forward arcs");
+    for (size_t i = 0; i < a.size(); ++i)
+      test::assert_bool(a[i].node == b[i].node && a[i].middle == b[i].middle &&
+                        a[i].cost == b[i].cost, "Expected the same forward arcs");
+  }
+
+  test::assert_throw<std::runtime_error>([]() {
+    CHGraph::Load("test/data/does_not_exist.ch");
+  }, "Expected loading a missing hierarchy to throw");
+}
+
+}
+
+int main() {
+  test::suite suite("contractionhierarchy");
+
+  suite.test(TEST_CASE(TestShortestPaths));
+
+  suite.test(TEST_CASE(TestSeedCosts));
+
+  suite.test(TEST_CASE(TestWriteLoad));
+
+  return suite.tear_down();
+}
@@ -60,7 +60,7 @@ auto way_predicate = [](const OSMWay& a, const OSMWay& b){
   return a.osmwayid_ < b.osmwayid_;
 };
 
-OSMWay GetWay(uint64_t way_id, sequence<OSMWay>& ways) {
+OSMWay GetWay(uint64_t way_id, compressed_sequence<OSMWay>& ways) {
   auto found = ways.find({way_id}, way_predicate);
   if(found == ways.end())
     throw std::runtime_error("Couldn't find way: " + std::to_string(way_id));
@@ -489,6 +489,32 @@ void TestDST(){
 
 }
 
+void TestTimeContext() {
+  DateTime::time_context_t context("2015-05-08T08:30");
+  if (!context.valid || context.seconds_from_midnight != 30600 ||
+      context.days_from_pivot != 492 || context.dow_mask != kFriday)
+    throw std::runtime_error("Time context was not parsed correctly");
+
+  uint32_t day = 0;
+  if (!context.day_from(490, day) || day != 2)
+    throw std::runtime_error("Time context should be 2 days after the tile was created");
+  if (context.day_from(500, day))
+    throw std::runtime_error("Time context should be before the tile was created");
+
+  DateTime::time_context_t none;
+  if (none.valid || none.seconds_from_midnight != 0 || none.dow_mask != kDOWNone)
+    throw std::runtime_error("Empty time context should have no time");
+
+  //cached zones are the same ones the database has
+  const auto& tz_db = DateTime::get_tz_db();
+  auto index = tz_db.to_index("America/Chicago");
+  if (tz_db.from_index(index) != tz_db.from_index(index) ||
+      tz_db.from_index(index)->to_posix_string() != tz_db.time_zone_from_region("America/Chicago")->to_posix_string())
+    throw std::runtime_error("Timezone from index does not match its region");
+  if (tz_db.from_index(0))
+    throw std::runtime_error("Timezone index 0 should have no timezone");
+}
+
 int main(void) {
   test::suite suite("datetime");
 
@@ -501,6 +527,7 @@ int main(void) {
   suite.test(TEST_CASE(TestIsServiceAvailable));
   suite.test(TEST_CASE(TestIsValid));
   suite.test(TEST_CASE(TestDST));
+  suite.test(TEST_CASE(TestTimeContext));
 
   return suite.tear_down();
 }
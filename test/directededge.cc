@@ -55,6 +55,42 @@ namespace {
       throw runtime_error("DirectedEdge stopimpact for localidx 1 test failed");
     }
   }
+
+  void TestReach() {
+    DirectedEdge directededge;
+    if (directededge.reach(kAutoAccess) != 0 || directededge.reach(kPedestrianAccess) != 0)
+      throw runtime_error("DirectedEdge reach should not be known until it is set");
+    directededge.set_reach(kAutoAccess, 12);
+    directededge.set_reach(kBicycleAccess, 1000);
+    directededge.set_reach(kTruckAccess, 5);
+    if (directededge.reach(kAutoAccess) != 12 || directededge.reach(kPedestrianAccess) != 0)
+      throw runtime_error("DirectedEdge reach should be kept per mode");
+    if (directededge.reach(kBicycleAccess) != kMaxStoredReach)
+      throw runtime_error("DirectedEdge reach should be capped");
+    if (directededge.reach(kTruckAccess) != 0)
+      throw runtime_error("DirectedEdge reach should only be kept for auto, bicycle and pedestrian");
+  }
+
+  void TestTurnClass() {
+    DirectedEdge directededge;
+    directededge.set_drive_on_right(true);
+    directededge.set_turntype(2, Turn::Type::kSharpLeft);
+    directededge.set_turntype(4, Turn::Type::kRight);
+    directededge.set_edge_to_left(4, true);
+    directededge.set_edge_to_right(4, true);
+    directededge.set_edge_to_left(2, true);
+    if (directededge.turn_class(2) != static_cast<uint32_t>(Turn::Type::kSharpLeft))
+      throw runtime_error("DirectedEdge turn class should be the turn type without a crossing");
+    if (directededge.turn_class(4) != (static_cast<uint32_t>(Turn::Type::kRight) | 8))
+      throw runtime_error("DirectedEdge turn class should mark a crossing");
+    directededge.set_drive_on_right(false);
+    if (directededge.turn_class(2) != (static_cast<uint32_t>(Turn::Type::kSharpLeft) | 16) ||
+        directededge.turn_class(4) != (static_cast<uint32_t>(Turn::Type::kRight) | 24))
+      throw runtime_error("DirectedEdge turn class should mark driving on the left");
+    for (uint32_t idx = 0; idx < 8; idx++)
+      if (directededge.turn_class(idx) >= Turn::kClassCount)
+        throw runtime_error("DirectedEdge turn class out of range");
+  }
 }
 
 int main(void)
@@ -66,5 +102,9 @@ int main(void)
   // Write to file and read into DirectedEdge
   suite.test(TEST_CASE(TestWriteRead));
 
+  suite.test(TEST_CASE(TestReach));
+
+  suite.test(TEST_CASE(TestTurnClass));
+
   return suite.tear_down();
 }
@@ -4,6 +4,10 @@
 #include "midgard/pointll.h"
 #include "test.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 using namespace std;
 using namespace valhalla::midgard;
 
@@ -48,6 +52,54 @@ void TestDistanceSquared() {
   TryDistanceSquaredFromTestPt(a, b, a.Distance(b));
 }
 
+void TestBatches() {
+  // Enough of them for the vectorized loops and a few left over
+  std::mt19937 gen(17);
+  std::uniform_real_distribution<float> offset(-0.01f, 0.01f);
+  PointLL center(-76.3f, 40.1f);
+  DistanceApproximator approx(center);
+  const size_t count = 37;
+  std::vector<float> lngs, lats, ux, uy, vx, vy;
+  for (size_t i = 0; i < count; ++i) {
+    lngs.push_back(center.lng() + offset(gen));
+    lats.push_back(center.lat() + offset(gen));
+    ux.push_back(center.lng() + offset(gen));
+    uy.push_back(center.lat() + offset(gen));
+    vx.push_back(center.lng() + offset(gen));
+    vy.push_back(center.lat() + offset(gen));
+  }
+  // A segment of no length projects onto its start
+  vx[5] = ux[5];
+  vy[5] = uy[5];
+
+  // The same squared distances as one at a time
+  std::vector<float> sq_distances(count);
+  approx.DistanceSquared(lngs.data(), lats.data(), count, sq_distances.data());
+  for (size_t i = 0; i < count; ++i) {
+    float d = approx.DistanceSquared(PointLL(lngs[i], lats[i]));
+    if (fabs(sq_distances[i] - d) > d * 1e-5f)
+      throw runtime_error("Batched DistanceSquared should match the single one");
+  }
+
+  // The closest point on each segment with longitude scaled at the center
+  std::vector<float> x(count), y(count);
+  approx.Project(ux.data(), uy.data(), vx.data(), vy.data(), count, x.data(), y.data(),
+                 sq_distances.data());
+  float lon_scale = cosf(center.lat() * kRadPerDeg);
+  for (size_t i = 0; i < count; ++i) {
+    float bx = (vx[i] - ux[i]) * lon_scale, by = vy[i] - uy[i];
+    float sq = bx * bx + by * by;
+    float t = sq > 0.f ? ((center.lng() - ux[i]) * lon_scale * bx + (center.lat() - uy[i]) * by) / sq : 0.f;
+    t = std::max(0.f, std::min(t, 1.f));
+    PointLL point(ux[i] + (vx[i] - ux[i]) * t, uy[i] + by * t);
+    if (fabs(x[i] - point.lng()) > 1e-5f || fabs(y[i] - point.lat()) > 1e-5f ||
+        fabs(sq_distances[i] - approx.DistanceSquared(point)) > 1.f)
+      throw runtime_error("Batched Project should give the closest point on each segment");
+  }
+  if (x[5] != ux[5] || y[5] != uy[5])
+    throw runtime_error("Project onto a segment of no length should give its start");
+}
+
 }
 
 int main() {
@@ -62,5 +114,8 @@ int main() {
   // Test distance squared between 2 points
   suite.test(TEST_CASE(TestDistanceSquared));
 
+  // Test the batched distances and projections
+  suite.test(TEST_CASE(TestBatches));
+
   return suite.tear_down();
 }
@@ -7,6 +7,7 @@
 #include "config.h"
 #include "midgard/util.h"
 #include "baldr/double_bucket_queue.h"
+#include "baldr/label_bucket_queue.h"
 
 using namespace std;
 using namespace valhalla;
@@ -70,6 +71,71 @@ void TestClear() {
   TryClear(costs);
 }
 
+void TestReuseAfterClear() {
+  std::vector<float> edgelabels;
+  const auto edgecost = [&edgelabels](const uint32_t label) {
+    return edgelabels[label];
+  };
+
+  // Pop past the overflow so the range of the buckets moves up
+  DoubleBucketQueue adjlist(0, 100, 1, edgecost);
+  edgelabels = { 50, 250 };
+  adjlist.add(0);
+  adjlist.add(1);
+  adjlist.pop();
+  adjlist.pop();
+  adjlist.clear();
+
+  // The queue should still sort the costs below the moved range
+  edgelabels = { 30, 10, 20 };
+  for (uint32_t i = 0; i < edgelabels.size(); i++)
+    adjlist.add(i);
+  for (auto expected : { 1u, 2u, 0u }) {
+    if (adjlist.pop() != expected)
+      throw runtime_error("TestReuseAfterClear: expected order test failed");
+  }
+}
+
+void TestPushes() {
+  std::vector<float> edgelabels = { 50, 250, 30 };
+  const auto edgecost = [&edgelabels](const uint32_t label) {
+    return edgelabels[label];
+  };
+
+  // Adds count, so do decreases that move a label to another bucket
+  DoubleBucketQueue adjlist(0, 100, 1, edgecost);
+  for (uint32_t i = 0; i < edgelabels.size(); i++)
+    adjlist.add(i);
+  adjlist.decrease(0, 20);
+  edgelabels[0] = 20;
+  adjlist.decrease(0, 20.5f);
+  test::assert_bool(adjlist.pushes() == 4, "TestPushes: expected 4 pushes");
+
+  // Clearing keeps the count
+  adjlist.clear();
+  adjlist.add(2);
+  test::assert_bool(adjlist.pushes() == 5, "TestPushes: expected the count to survive clear");
+}
+
+void TestMinCost() {
+  std::vector<float> edgelabels = { 57, 1250, 33 };
+  const auto edgecost = [&edgelabels](const uint32_t label) {
+    return edgelabels[label];
+  };
+
+  // The minimum never passes the cost of a label still in the queue
+  DoubleBucketQueue adjlist(0, 100, 1, edgecost);
+  for (uint32_t i = 0; i < edgelabels.size(); i++)
+    adjlist.add(i);
+  test::assert_bool(adjlist.min_cost() <= 33, "TestMinCost: expected a bound below 33");
+  adjlist.pop();
+  test::assert_bool(adjlist.min_cost() <= 57, "TestMinCost: expected a bound below 57");
+  adjlist.pop();
+  test::assert_bool(adjlist.min_cost() <= 1250, "TestMinCost: expected a bound below 1250");
+  test::assert_bool(adjlist.pop() == 1, "TestMinCost: expected the overflow label");
+  test::assert_bool(adjlist.min_cost() == 1250, "TestMinCost: expected the bound of the moved range");
+}
+
 /**
    void TestDecreseCost() {
    std::vector<uint32_t> costs = { 67, 325, 25, 466, 1000, 100005, 758, 167,
@@ -81,7 +147,8 @@ void TestClear() {
    }
 */
 
-void TryRemove(DoubleBucketQueue &dbqueue, size_t num_to_remove, const std::vector<float>& costs)
+template <class queue_t, class cost_t>
+void TryRemove(queue_t &dbqueue, size_t num_to_remove, const std::vector<cost_t>& costs)
 {
   auto previous_cost = -std::numeric_limits<float>::infinity();
   for (size_t i = 0; i < num_to_remove; ++i) {
@@ -98,8 +165,9 @@ void TryRemove(DoubleBucketQueue &dbqueue, size_t num_to_remove, const std::vect
   }
 }
 
-void TrySimulation(DoubleBucketQueue& dbqueue,
-                   std::vector<float> &costs,
+template <class queue_t, class cost_t>
+void TrySimulation(queue_t& dbqueue,
+                   std::vector<cost_t> &costs,
                    size_t loop_count,
                    size_t expansion_size,
                    size_t max_increment_cost)
@@ -118,7 +186,7 @@ void TrySimulation(DoubleBucketQueue& dbqueue,
       break;
     }
 
-    const auto min_cost = costs[key];
+    const float min_cost = costs[key];
     // Must be the minimal one among the tracked labels
     for (auto k : addedLabels) {
       test::assert_bool(min_cost <= costs[k], "Simulation: minimal cost expected");
@@ -188,6 +256,70 @@ void TestSimulation()
   }
 }
 
+// Label with nothing but a sort cost for the label specialized queue
+struct CostLabel {
+  CostLabel(const float c) : cost(c) { }
+  operator float() const { return cost; }
+  float sortcost() const { return cost; }
+  float cost;
+};
+
+template <class layout_t>
+void TryLabelAddRemove() {
+  std::vector<CostLabel> labels;
+  std::vector<uint32_t> costs = { 67, 325, 25, 466, 1000, 100005, 758, 167,
+                                  258, 16442, 278, 111111000 };
+  LabelBucketQueue<CostLabel, layout_t> adjlist(0, 10000, 5, labels);
+  for (auto cost : costs) {
+    labels.emplace_back(cost);
+    adjlist.add(labels.size() - 1);
+  }
+  std::sort(costs.begin(), costs.end());
+  for (auto expected : costs) {
+    uint32_t labelindex = adjlist.pop();
+    test::assert_bool(labelindex != kInvalidLabel && labels[labelindex].cost == expected,
+                      "TryLabelAddRemove: expected order test failed");
+  }
+  test::assert_bool(adjlist.pop() == kInvalidLabel, "TryLabelAddRemove: expected empty queue");
+
+  // Clearing with labels in both the low level and overflow buckets
+  for (uint32_t i = 0; i < labels.size(); ++i)
+    adjlist.add(i);
+  adjlist.clear();
+  test::assert_bool(adjlist.pop() == kInvalidLabel, "TryLabelAddRemove: expected empty queue after clear");
+}
+
+void TestLabelAddRemove() {
+  TryLabelAddRemove<VectorBucketLayout>();
+  TryLabelAddRemove<FlatBucketLayout>();
+}
+
+template <class layout_t>
+void TryLabelSimulation() {
+  {
+    std::vector<CostLabel> labels;
+    LabelBucketQueue<CostLabel, layout_t> dbqueue(0, 1, 100000, labels);
+    TrySimulation(dbqueue, labels, 1000, 10, 1000);
+  }
+
+  {
+    std::vector<CostLabel> labels;
+    LabelBucketQueue<CostLabel, layout_t> dbqueue(0, 1, 1000, labels);
+    TrySimulation(dbqueue, labels, 333, 60, 100);
+  }
+
+  {
+    std::vector<CostLabel> labels;
+    LabelBucketQueue<CostLabel, layout_t> dbqueue(0, 100, 1, labels);
+    TrySimulation(dbqueue, labels, 333, 60, 100);
+  }
+}
+
+void TestLabelSimulation() {
+  TryLabelSimulation<VectorBucketLayout>();
+  TryLabelSimulation<FlatBucketLayout>();
+}
+
 }
 
 int main() {
@@ -197,9 +329,19 @@ int main() {
 
   suite.test(TEST_CASE(TestClear));
 
+  suite.test(TEST_CASE(TestReuseAfterClear));
+
+  suite.test(TEST_CASE(TestPushes));
+
+  suite.test(TEST_CASE(TestMinCost));
+
   //  suite.test(TEST_CASE(TestDecreaseCost));
 
   suite.test(TEST_CASE(TestSimulation));
 
+  suite.test(TEST_CASE(TestLabelAddRemove));
+
+  suite.test(TEST_CASE(TestLabelSimulation));
+
   return suite.tear_down();
 }
@@ -0,0 +1,52 @@
+#include "test.h"
+
+#include "baldr/edge_attribute_index.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+  void test_sizeof() {
+    if (sizeof(EdgeAttributeIndex) != 12)
+      throw std::runtime_error("EdgeAttributeIndex size should be 12 bytes but is " +
+                std::to_string(sizeof(EdgeAttributeIndex)));
+  }
+
+  void TestBuild() {
+    // Edges 0 and 3 have signs, 1 has restrictions and 3 lane connections
+    std::vector<Sign> signs{ {0, Sign::Type::kExitNumber, 0}, {0, Sign::Type::kExitToward, 4},
+                             {3, Sign::Type::kExitName, 8} };
+    std::vector<AccessRestriction> restrictions{ {1, AccessType::kMaxHeight, kAutoAccess, 4},
+                                                 {1, AccessType::kMaxWeight, kTruckAccess, 10} };
+    std::vector<LaneConnectivity> lanes{ {3, 123, "1|2", "1|2"} };
+    auto index = EdgeAttributeIndex::Build(signs.data(), signs.size(), restrictions.data(),
+                                           restrictions.size(), lanes.data(), lanes.size(), 5);
+    if (index.size() != 6)
+      throw runtime_error("There should be an entry for each edge and one past the last");
+
+    std::vector<std::pair<uint32_t, uint32_t> > expected_signs{{0, 2}, {2, 2}, {2, 2}, {2, 3}, {3, 3}};
+    std::vector<std::pair<uint32_t, uint32_t> > expected_restrictions{{0, 0}, {0, 2}, {2, 2}, {2, 2}, {2, 2}};
+    std::vector<std::pair<uint32_t, uint32_t> > expected_lanes{{0, 0}, {0, 0}, {0, 0}, {0, 1}, {1, 1}};
+    for (uint32_t i = 0; i < 5; ++i) {
+      if (index[i].sign() != expected_signs[i].first || index[i + 1].sign() != expected_signs[i].second)
+        throw runtime_error("Wrong signs for edge " + std::to_string(i));
+      if (index[i].access_restriction() != expected_restrictions[i].first ||
+          index[i + 1].access_restriction() != expected_restrictions[i].second)
+        throw runtime_error("Wrong access restrictions for edge " + std::to_string(i));
+      if (index[i].lane_connectivity() != expected_lanes[i].first ||
+          index[i + 1].lane_connectivity() != expected_lanes[i].second)
+        throw runtime_error("Wrong lane connections for edge " + std::to_string(i));
+    }
+  }
+
+}
+
+int main(void) {
+  test::suite suite("edge_attribute_index");
+
+  suite.test(TEST_CASE(test_sizeof));
+  suite.test(TEST_CASE(TestBuild));
+
+  return suite.tear_down();
+}
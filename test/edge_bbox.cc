@@ -0,0 +1,62 @@
+#include "test.h"
+
+#include "baldr/edge_bbox.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+  void test_sizeof() {
+    if (sizeof(EdgeBBox) != 8)
+      throw std::runtime_error("EdgeBBox size should be 8 bytes but is " +
+                std::to_string(sizeof(EdgeBBox)));
+  }
+
+  void TestContains() {
+    // A box in a 0.25 degree tile stays around the shape
+    AABB2<PointLL> tile_box(PointLL(5.0f, 52.0f), PointLL(5.25f, 52.25f));
+    AABB2<PointLL> shape_box(PointLL(5.1234567f, 52.0001f), PointLL(5.1301f, 52.2499f));
+    auto box = EdgeBBox(shape_box, tile_box).box(tile_box);
+    if (box.minx() > shape_box.minx() || box.miny() > shape_box.miny() ||
+        box.maxx() < shape_box.maxx() || box.maxy() < shape_box.maxy())
+      throw runtime_error("EdgeBBox should contain the whole shape");
+    float unit = 0.25f / kEdgeBBoxUnitsPerTile;
+    if (shape_box.minx() - box.minx() > 3 * unit || box.maxy() - shape_box.maxy() > 3 * unit)
+      throw runtime_error("EdgeBBox should be within a few units of the shape");
+
+    // Shapes leaving the tile are fine as long as they stay close to it
+    shape_box = AABB2<PointLL>(PointLL(4.9f, 51.9f), PointLL(5.4f, 52.3f));
+    box = EdgeBBox(shape_box, tile_box).box(tile_box);
+    if (box.minx() > shape_box.minx() || box.miny() > shape_box.miny() ||
+        box.maxx() < shape_box.maxx() || box.maxy() < shape_box.maxy() || box.maxx() > 5.5f)
+      throw runtime_error("EdgeBBox should contain a shape leaving the tile");
+  }
+
+  void TestUnbounded() {
+    // An axis reaching too far is unbounded, the other one is kept
+    AABB2<PointLL> tile_box(PointLL(5.0f, 52.0f), PointLL(5.25f, 52.25f));
+    AABB2<PointLL> shape_box(PointLL(5.1f, 52.1f), PointLL(6.0f, 52.2f));
+    auto box = EdgeBBox(shape_box, tile_box).box(tile_box);
+    if (box.minx() != -180.0f || box.maxx() != 180.0f)
+      throw runtime_error("EdgeBBox should be unbounded along a long axis");
+    if (box.miny() > 52.1f || box.maxy() < 52.2f || box.maxy() > 52.21f)
+      throw runtime_error("EdgeBBox should keep the short axis");
+
+    box = EdgeBBox().box(tile_box);
+    if (box.minx() != -180.0f || box.maxx() != 180.0f || box.miny() != -90.0f || box.maxy() != 90.0f)
+      throw runtime_error("Default EdgeBBox should be unbounded");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("edge_bbox");
+
+  suite.test(TEST_CASE(test_sizeof));
+  suite.test(TEST_CASE(TestContains));
+  suite.test(TEST_CASE(TestUnbounded));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,51 @@
+#include "test.h"
+
+#include "baldr/edge_shape_cache.h"
+#include "midgard/encoded.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+  void TestGet() {
+    std::vector<PointLL> shape{ {-76.3f, 40.1f}, {-76.31f, 40.11f}, {-76.32f, 40.1f} };
+    auto first = encode7(shape);
+    auto second = encode7(std::vector<PointLL>{shape.rbegin(), shape.rend()});
+
+    EdgeShapeCache cache(1);
+    auto decoded = cache.Get(first.data(), first.size());
+    if (decoded->size() != shape.size() || !decoded->front().ApproximatelyEqual(shape.front()) ||
+        !decoded->back().ApproximatelyEqual(shape.back()))
+      throw runtime_error("The shape should be decoded");
+    if (cache.Get(first.data(), first.size()) != decoded)
+      throw runtime_error("The shape should be decoded once");
+
+    // The cache is full so the other shape is decoded each time
+    auto other = cache.Get(second.data(), second.size());
+    if (other->size() != shape.size() || !other->front().ApproximatelyEqual(shape.back()))
+      throw runtime_error("The other shape should be decoded");
+    if (cache.size() != 1 || cache.Get(second.data(), second.size()) == other)
+      throw runtime_error("The cache should keep no more shapes than it was asked to");
+  }
+
+  void TestMaxShapes() {
+    if (EdgeShapeCache::max_shapes() != 0)
+      throw runtime_error("Tiles should keep no shapes by default");
+    EdgeShapeCache::set_max_shapes(100);
+    if (EdgeShapeCache::max_shapes() != 100)
+      throw runtime_error("Tiles should keep the shapes the process asked for");
+    EdgeShapeCache::set_max_shapes(0);
+  }
+
+}
+
+int main(void) {
+  test::suite suite("edge_shape_cache");
+
+  suite.test(TEST_CASE(TestGet));
+  suite.test(TEST_CASE(TestMaxShapes));
+
+  return suite.tear_down();
+}
@@ -54,6 +54,44 @@ void TestStatus() {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreached);
 }
 
+void TestTiles() {
+  EdgeStatus edgestatus(16);
+
+  // Interleave tiles and sparse ids so tiles get looked up and grown
+  for (uint32_t i = 0; i < 1000; ++i)
+    edgestatus.Set(GraphId(i % 7, 2, i * 13), EdgeSet::kTemporary, i);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    EdgeStatusInfo r = edgestatus.Get(GraphId(i % 7, 2, i * 13));
+    if (r.set() != EdgeSet::kTemporary || r.index() != i)
+      throw runtime_error("EdgeStatus tile get test failed");
+  }
+  TryGet(edgestatus, GraphId(0, 2, 1), EdgeSet::kUnreached);
+  TryGet(edgestatus, GraphId(8, 2, 0), EdgeSet::kUnreached);
+  TryGet(edgestatus, GraphId(0, 1, 0), EdgeSet::kUnreached);
+
+  // Update keeps the index
+  edgestatus.Update(GraphId(3, 2, 3 * 13), EdgeSet::kPermanent);
+  EdgeStatusInfo r = edgestatus.Get(GraphId(3, 2, 3 * 13));
+  if (r.set() != EdgeSet::kPermanent || r.index() != 3)
+    throw runtime_error("EdgeStatus update test failed");
+
+  // Copies are independent of the original
+  EdgeStatus copy(edgestatus);
+  copy.Set(GraphId(3, 2, 3 * 13), EdgeSet::kTemporary, 3);
+  TryGet(edgestatus, GraphId(3, 2, 3 * 13), EdgeSet::kPermanent);
+  TryGet(copy, GraphId(3, 2, 3 * 13), EdgeSet::kTemporary);
+
+  // Init resets touched tiles whether or not they are kept
+  edgestatus.Init();
+  for (uint32_t i = 0; i < 1000; ++i)
+    TryGet(edgestatus, GraphId(i % 7, 2, i * 13), EdgeSet::kUnreached);
+  edgestatus.Set(GraphId(1, 2, 2), EdgeSet::kTemporary, 1);
+  edgestatus.Init();
+  TryGet(edgestatus, GraphId(1, 2, 2), EdgeSet::kUnreached);
+  edgestatus.Set(GraphId(1, 2, 2), EdgeSet::kPermanent, 1);
+  TryGet(edgestatus, GraphId(1, 2, 2), EdgeSet::kPermanent);
+}
+
 }
 
 int main() {
@@ -62,5 +100,8 @@ int main() {
   // Test setting status, getting status, and clearing
   suite.test(TEST_CASE(TestStatus));
 
+  // Test statuses spread over tiles, copies and resetting between searches
+  suite.test(TEST_CASE(TestTiles));
+
   return suite.tear_down();
 }
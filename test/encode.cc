@@ -4,6 +4,7 @@
 #include "test.h"
 
 #include <string>
+#include <random>
 
 using namespace std;
 using namespace valhalla::midgard;
@@ -118,6 +119,39 @@ void test_varint() {
   do_varint_pair({{-9.42372, 152.03805}, {-1.82375, 116.05687}, {-71.41203, -66.66489}, {65.64729, 68.17239}, {34.2284, -77.90916}, {-72.90402, -47.25247}, {-78.55439, -25.28158}, {-31.92992, 103.20477}, {58.26482, -169.02219}});
 }
 
+void test_append() {
+  //lots of shapes with all sorts of step sizes so numbers of every length get written
+  std::mt19937 generator(17);
+  std::uniform_int_distribution<int> steps(0, 6);
+  std::uniform_real_distribution<double> unit(-1, 1);
+  for(size_t i = 0; i < 500; ++i) {
+    container_t points;
+    double step = std::pow(10., -steps(generator));
+    points.emplace_back(unit(generator) * 180, unit(generator) * 90);
+    for(size_t j = i % 23; j > 0; --j)
+      points.emplace_back(points.back().first + unit(generator) * step, points.back().second + unit(generator) * step);
+
+    for(bool varint : {false, true}) {
+      //appending encodes onto what is already there and gives back the room it didnt need
+      auto encoded = varint ? encode7(points) : encode(points);
+      std::string appended = "prefix";
+      varint ? encode7(points, appended) : encode(points, appended);
+      if(appended != "prefix" + encoded)
+        throw std::runtime_error("Encoding onto the end of a string failed");
+      auto decoded = varint ? decode7<container_t>(appended.substr(6)) : decode<container_t>(appended.substr(6));
+      if(decoded.size() != points.size())
+        throw std::runtime_error("Wrong number of points decoded");
+
+      //a number cut off at the end is an error
+      encoded.back() = varint ? char(0x80) : '_';
+      try {
+        varint ? decode7<container_t>(encoded) : decode<container_t>(encoded);
+        throw std::logic_error("Truncated encoding should have thrown");
+      }
+      catch(const std::runtime_error&) {}
+    }
+  }
+}
 }
 
 int main() {
@@ -125,6 +159,7 @@ int main() {
 
   suite.test(TEST_CASE(test_polyline));
   suite.test(TEST_CASE(test_varint));
+  suite.test(TEST_CASE(test_append));
 
   return suite.tear_down();
 }
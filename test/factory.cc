@@ -18,6 +18,40 @@ namespace {
     //TODO: then ask for some
     auto car = factory.Create("auto", boost::property_tree::ptree{});
   }
+
+  void test_clone() {
+    CostFactory<DynamicCost> factory;
+    factory.Register("auto", CreateAutoCost);
+    factory.Register("auto_shorter", CreateAutoShorterCost);
+    factory.Register("bicycle", CreateBicycleCost);
+    factory.Register("pedestrian", CreatePedestrianCost);
+    rapidjson::Document options;
+    options.Parse(R"({"use_ferry":0.2,"hierarchy_limits":{"1":{"max_up_transitions":7}}})");
+
+    if (factory.Create("auto", options)->GetHierarchyLimits()[1].max_up_transitions != 7)
+      throw std::runtime_error("Hierarchy limits should come from the costing options");
+
+    valhalla::baldr::DirectedEdge edge;
+    edge.set_length(1234);
+    edge.set_speed(55);
+    edge.set_use(valhalla::baldr::Use::kFerry);
+    for (const auto& name : {"auto", "auto_shorter", "bicycle", "pedestrian"}) {
+      auto cost = factory.Create(name, options);
+      auto copy = cost->Clone();
+      if (!copy || copy.get() == cost.get())
+        throw std::runtime_error(std::string(name) + " costing should copy into a new object");
+      if (copy->travel_mode() != cost->travel_mode() ||
+          copy->EdgeCost(&edge).cost != cost->EdgeCost(&edge).cost ||
+          copy->EdgeCost(&edge).secs != cost->EdgeCost(&edge).secs)
+        throw std::runtime_error(std::string(name) + " copy should cost like the original");
+
+      // Relaxing the copy mustn't touch the original
+      auto max_up_transitions = cost->GetHierarchyLimits()[1].max_up_transitions;
+      copy->RelaxHierarchyLimits(16.0f, 4.0f);
+      if (cost->GetHierarchyLimits()[1].max_up_transitions != max_up_transitions)
+        throw std::runtime_error(std::string(name) + " copy should have its own hierarchy limits");
+    }
+  }
 }
 
 int main(void)
@@ -25,6 +59,8 @@ int main(void)
   test::suite suite("factory");
 
   suite.test(TEST_CASE(test_register));
+
+  suite.test(TEST_CASE(test_clone));
   //TODO: many more
 
   return suite.tear_down();
@@ -0,0 +1,55 @@
+#include "test.h"
+
+#include "baldr/fixed_shape.h"
+#include "midgard/encoded.h"
+#include "midgard/pointll.h"
+#include "midgard/shape_decoder.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+  void test_sizeof() {
+    if (sizeof(FixedPoint) != 8)
+      throw std::runtime_error("FixedPoint size should be 8 bytes but is " +
+                std::to_string(sizeof(FixedPoint)));
+    if (sizeof(FixedShapeIndex) != 8)
+      throw std::runtime_error("FixedShapeIndex size should be 8 bytes but is " +
+                std::to_string(sizeof(FixedShapeIndex)));
+  }
+
+  void TestSameAsDecoded() {
+    // Reading the fixed point shape gives exactly the decoded points
+    std::vector<PointLL> shape{ {-76.299999f, 40.0423f}, {-76.3001f, 40.04f}, {-76.31f, 40.05f},
+                                {179.999999f, -89.999999f}, {-180.0f, 0.0f} };
+    auto encoded = encode7(shape);
+    auto fixed = DecodeFixedShape(encoded.data(), encoded.size());
+    if (fixed.size() != shape.size())
+      throw runtime_error("Every point of the shape should be decoded");
+
+    Shape7Decoder<PointLL> decoder(encoded.data(), encoded.size());
+    FixedShapeDecoder<PointLL> reader(fixed.data(), fixed.data() + fixed.size());
+    while (!decoder.empty()) {
+      if (reader.empty())
+        throw runtime_error("The fixed point shape should have as many points");
+      auto a = decoder.pop();
+      auto b = reader.pop();
+      if (a.lng() != b.lng() || a.lat() != b.lat())
+        throw runtime_error("The fixed point shape should read the same as the decoded one");
+    }
+    if (!reader.empty())
+      throw runtime_error("The fixed point shape should have no more points");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("fixed_shape");
+
+  suite.test(TEST_CASE(test_sizeof));
+  suite.test(TEST_CASE(TestSameAsDecoded));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,176 @@
+#include "test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "baldr/flatgraph.h"
+#include "mjolnir/flatgraphbuilder.h"
+#include "thor/flatmatrix.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+const AABB2<PointLL> kBounds(-76.f, 40.f, -75.f, 41.f);
+
+// Random graph of turns where the time and length of a turn are a fixed
+// share of its cost
+std::vector<CHBuilder::Turn> RandomTurns(const uint32_t node_count, std::mt19937& gen) {
+  std::vector<CHBuilder::Turn> turns;
+  for (uint32_t from = 0; from < node_count; ++from) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      uint32_t to = (from + 1 + static_cast<uint32_t>(test::rand01(gen) * 20)) % node_count;
+      if (i == 0)
+        to = (from + 1) % node_count;
+      float secs = std::floor(1 + test::rand01(gen) * 100);
+      turns.push_back({from, to, secs * 2, secs, secs * 10});
+    }
+  }
+  return turns;
+}
+
+std::vector<GraphId> Edges(const uint32_t node_count) {
+  std::vector<GraphId> edges;
+  for (uint32_t i = 0; i < node_count; ++i)
+    edges.emplace_back(7, 2, i);
+  return edges;
+}
+
+// Plain dijkstra from a node to all the others
+std::vector<float> Dijkstra(const uint32_t node_count, const std::vector<CHBuilder::Turn>& turns,
+                            const uint32_t source) {
+  std::vector<std::vector<CHBuilder::Turn> > out(node_count);
+  for (const auto& turn : turns)
+    out[turn.from].push_back(turn);
+  std::vector<float> dist(node_count, std::numeric_limits<float>::max());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second])
+      continue;
+    for (const auto& turn : out[top.second]) {
+      if (top.first + turn.cost < dist[turn.to]) {
+        dist[turn.to] = top.first + turn.cost;
+        queue.emplace(dist[turn.to], turn.to);
+      }
+    }
+  }
+  return dist;
+}
+
+void TestFlatten() {
+  std::vector<CHBuilder::Turn> turns = {
+    {2, 0, 4, 2, 20}, {0, 1, 10, 5, 50}, {2, 1, 6, 3, 30}, {0, 2, 8, 4, 40}};
+  auto graph = FlatGraphBuilder::Flatten("auto", kBounds, Edges(3), turns);
+  test::assert_bool(graph.node_count() == 3 && graph.arc_count() == 4,
+                    "Expected a node per edge and an arc per turn");
+  test::assert_bool(graph.first_arc(0) == 0 && graph.last_arc(0) == 2 &&
+                    graph.first_arc(1) == 2 && graph.last_arc(1) == 2 &&
+                    graph.first_arc(2) == 2 && graph.last_arc(2) == 4,
+                    "Expected the arcs of each node together");
+  test::assert_bool(graph.targets()[0] == 1 && graph.targets()[1] == 2 &&
+                    graph.targets()[2] == 0 && graph.targets()[3] == 1,
+                    "Expected the arcs of a node in the order they were found");
+  test::assert_bool(graph.costs()[1] == 8.f && graph.secs()[1] == 4.f && graph.lengths()[1] == 40.f,
+                    "Expected the weights with their arc");
+  test::assert_bool(graph.node(GraphId(7, 2, 1)) == 1 && graph.node(GraphId(7, 2, 3)) == kInvalidFlatNode,
+                    "Expected the nodes by their edges");
+
+  // Write it and load it back
+  std::string file_name = "test/data/flatmatrix.flat";
+  graph.Write(file_name);
+  auto loaded = FlatGraph::Load(file_name);
+  std::remove(file_name.c_str());
+  test::assert_bool(loaded.costing() == "auto" && loaded.node_count() == 3 && loaded.arc_count() == 4,
+                    "Expected the same graph back");
+  test::assert_bool(loaded.bounds().minx() == kBounds.minx() && loaded.bounds().maxy() == kBounds.maxy(),
+                    "Expected the same region back");
+  for (uint32_t a = 0; a < 4; ++a)
+    test::assert_bool(loaded.targets()[a] == graph.targets()[a] && loaded.costs()[a] == graph.costs()[a],
+                      "Expected the same arcs back");
+  test::assert_bool(FlatGraph::FileName("tiles", "auto") == "tiles/auto.flat",
+                    "Expected the costing's file in the tile dir");
+}
+
+void TestMatrix() {
+  std::mt19937 gen(17);
+  const uint32_t node_count = 400;
+  auto turns = RandomTurns(node_count, gen);
+  auto graph = std::make_shared<const FlatGraph>(FlatGraphBuilder::Flatten("auto", kBounds, Edges(node_count), turns));
+
+  std::vector<std::vector<FlatMatrix::Seed> > sources, targets;
+  for (uint32_t i = 0; i < 30; ++i)
+    sources.push_back({{static_cast<uint32_t>(test::rand01(gen) * node_count), 0.f, 0.f, 0.f}});
+  for (uint32_t i = 0; i < 40; ++i)
+    targets.push_back({{static_cast<uint32_t>(test::rand01(gen) * node_count), 0.f, 0.f, 0.f}});
+
+  auto connections = FlatMatrix(graph, 3).Connect(sources, targets);
+  test::assert_bool(connections.size() == sources.size() * targets.size(),
+                    "Expected a connection per source and target");
+  for (size_t i = 0; i < sources.size(); ++i) {
+    auto dist = Dijkstra(node_count, turns, sources[i].front().node);
+    for (size_t j = 0; j < targets.size(); ++j) {
+      const auto& connection = connections[i * targets.size() + j];
+      float expected = dist[targets[j].front().node];
+      test::assert_bool(std::fabs(connection.cost - expected) < 0.01f,
+                        "Expected the same cost as dijkstra " + std::to_string(connection.cost) +
+                        " vs " + std::to_string(expected));
+      test::assert_bool(std::fabs(connection.secs * 2 - connection.cost) < 0.01f &&
+                        std::fabs(connection.length - connection.secs * 10) < 0.1f,
+                        "Expected the time and length along the same path");
+    }
+  }
+}
+
+void TestSeeds() {
+  // A line 0 -> 1 -> 2 -> 3 and a second way 0 -> 4 -> 3 that is cheaper
+  // unless the search is forced to start at 1
+  std::vector<CHBuilder::Turn> turns = {
+    {0, 1, 10, 10, 10}, {1, 2, 10, 10, 10}, {2, 3, 10, 10, 10}, {0, 4, 5, 5, 5}, {4, 3, 5, 5, 5}};
+  auto graph = std::make_shared<const FlatGraph>(FlatGraphBuilder::Flatten("auto", kBounds, Edges(5), turns));
+  FlatMatrix matrix(graph, 2);
+
+  auto connections = matrix.Connect({{{0, 2.f, 2.f, 2.f}}, {{0, 25.f, 25.f, 25.f}, {1, 0.f, 0.f, 0.f}}},
+                                    {{{3, -4.f, -4.f, -4.f}}, {{2, 0.f, 0.f, 0.f}}});
+  test::assert_bool(connections[0].cost == 8.f && connections[0].length == 8.f,
+                    "Expected the cheaper way with the seeds applied");
+  test::assert_bool(connections[1].cost == 22.f, "Expected the way along the line");
+  test::assert_bool(connections[2].cost == 16.f, "Expected the cheaper of the two sources");
+  test::assert_bool(connections[3].cost == 10.f, "Expected the second source");
+
+  // On the same edge the target has to be ahead of the source
+  connections = matrix.Connect({{{1, 6.f, 6.f, 6.f}}}, {{{1, -2.f, -2.f, -2.f}}, {{1, -8.f, -8.f, -8.f}}});
+  test::assert_bool(connections[0].cost == 4.f, "Expected the path along the edge");
+  test::assert_bool(connections[1].cost == kMaxCost, "Expected no path back along the edge");
+
+  // Without a graph nothing is connected
+  connections = FlatMatrix(nullptr).Connect({{{0, 0.f, 0.f, 0.f}}}, {{{3, 0.f, 0.f, 0.f}}});
+  test::assert_bool(connections[0].cost == kMaxCost, "Expected no connection without a graph");
+}
+
+}
+
+int main() {
+  test::suite suite("flatmatrix");
+
+  suite.test(TEST_CASE(TestFlatten));
+
+  suite.test(TEST_CASE(TestMatrix));
+
+  suite.test(TEST_CASE(TestSeeds));
+
+  return suite.tear_down();
+}
@@ -36,7 +36,7 @@ auto way_predicate = [](const OSMWay& a, const OSMWay& b){
   return a.osmwayid_ < b.osmwayid_;
 };
 
-OSMWay GetWay(uint64_t way_id, sequence<OSMWay>& ways) {
+OSMWay GetWay(uint64_t way_id, compressed_sequence<OSMWay>& ways) {
   auto found = ways.find({way_id}, way_predicate);
   if(found == ways.end())
     throw std::runtime_error("Couldn't find way: " + std::to_string(way_id));
@@ -57,7 +57,7 @@ void BollardsGatesAndAccess(const std::string& config_file) {
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
   way_nodes.sort(node_predicate);
 
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   ways.sort(way_predicate);
 
   // bus access tests.
@@ -219,20 +219,20 @@ void Exits(const std::string& config_file) {
   auto node = GetNode(33698177, way_nodes);
 
   if (!node.intersection() ||
-      !node.ref() || osmdata.node_ref[33698177] != "51A-B")
+      !node.ref() || osmdata.ref_offset_map.name(osmdata.node_ref.find(33698177)) != "51A-B")
     throw std::runtime_error("Ref not set correctly .");
 
 
   node = GetNode(1901353894, way_nodes);
 
   if (!node.intersection() ||
-      !node.ref() || osmdata.node_name[1901353894] != "Harrisburg East")
+      !node.ref() || osmdata.name_offset_map.name(osmdata.node_name.find(1901353894)) != "Harrisburg East")
     throw std::runtime_error("Ref not set correctly .");
 
 
   node = GetNode(462240654, way_nodes);
 
-  if (!node.intersection() || osmdata.node_exit_to[462240654] != "PA441")
+  if (!node.intersection() || osmdata.name_offset_map.name(osmdata.node_exit_to.find(462240654)) != "PA441")
     throw std::runtime_error("Ref not set correctly .");
 
   boost::filesystem::remove(ways_file);
@@ -252,7 +252,7 @@ void Baltimore(const std::string& config_file) {
 
   auto osmdata = PBFGraphParser::Parse(conf.get_child("mjolnir"), {"test/data/baltimore.osm.pbf"},
                                        ways_file, way_nodes_file, access_file, restriction_file);
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   ways.sort(way_predicate);
 
   // bike_forward and reverse is set to false by default.  Meaning defaults for
@@ -329,7 +329,7 @@ void Bike(const std::string& config_file) {
 
   auto osmdata = PBFGraphParser::Parse(conf.get_child("mjolnir"), {"test/data/bike.osm.pbf"},
                                        ways_file, way_nodes_file, access_file, restriction_file);
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   ways.sort(way_predicate);
 
   //http://www.openstreetmap.org/way/6885577#map=14/51.9774/5.7718
@@ -380,7 +380,7 @@ void Bus(const std::string& config_file) {
 
   auto osmdata = PBFGraphParser::Parse(conf.get_child("mjolnir"), {"test/data/bus.osm.pbf"},
                                        ways_file, way_nodes_file, access_file, restriction_file);
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   ways.sort(way_predicate);
 
   auto way = GetWay(14327599, ways);
@@ -4,8 +4,12 @@
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 #include "baldr/connectivity_map.h"
+#include "baldr/tile_ring.h"
 
 #include <fcntl.h>
+#include <chrono>
+#include <fstream>
+#include <thread>
 #include <boost/filesystem.hpp>
 
 using namespace std;
@@ -59,6 +63,109 @@ void TestCacheLimits() {
     throw std::runtime_error("Cache should be over committed");
 }
 
+void TestLRUCache() {
+  LRUTileCache cache(100, 0.5f);
+  for (uint32_t i = 0; i < 10; ++i)
+    cache.Put({i, 2, 0}, GraphTile(), 10);
+  if (cache.OverCommitted())
+    throw std::runtime_error("Cache should be under committed");
+
+  // touch the oldest tiles so they become the most recently used
+  for (uint32_t i = 0; i < 3; ++i)
+    if (cache.Get({i, 2, 0}) == nullptr)
+      throw std::runtime_error("Tile should be in the cache");
+
+  // putting the same tile twice should not count its size twice
+  cache.Put({9, 2, 0}, GraphTile(), 10);
+  if (cache.OverCommitted())
+    throw std::runtime_error("Cache should be under committed");
+
+  cache.Put({10, 2, 0}, GraphTile(), 10);
+  if (!cache.OverCommitted())
+    throw std::runtime_error("Cache should be over committed");
+
+  // trimming down to 50 bytes keeps only the 5 most recently used tiles
+  cache.Trim();
+  if (cache.OverCommitted())
+    throw std::runtime_error("Cache should be under committed");
+  for (uint32_t i : {0, 1, 2, 9, 10})
+    if (!cache.Contains({i, 2, 0}))
+      throw std::runtime_error("Hot tile " + std::to_string(i) + " should have been kept");
+  for (uint32_t i = 3; i < 9; ++i)
+    if (cache.Contains({i, 2, 0}))
+      throw std::runtime_error("Cold tile " + std::to_string(i) + " should have been evicted");
+
+  cache.Clear();
+  if (cache.Contains({0, 2, 0}))
+    throw std::runtime_error("Cache should be empty");
+
+  // the factory hands out lru caches when asked to
+  boost::property_tree::ptree pt;
+  pt.put("cache_eviction", "lru");
+  std::unique_ptr<TileCache> made(TileCacheFactory::createTileCache(pt));
+  if (dynamic_cast<LRUTileCache*>(made.get()) == nullptr)
+    throw std::runtime_error("Factory should make an lru cache");
+}
+
+void TestShardedCache() {
+  boost::property_tree::ptree pt;
+  pt.put("global_sharded_cache", true);
+  pt.put("cache_shards", 4);
+  pt.put("max_cache_size", 400);
+  std::unique_ptr<TileCache> cache(TileCacheFactory::createTileCache(pt));
+
+  // fill it from a few threads at once
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < 4; ++t) {
+    threads.emplace_back([t, &pt]() {
+      std::unique_ptr<TileCache> c(TileCacheFactory::createTileCache(pt));
+      for (uint32_t i = t; i < 40; i += 4) {
+        GraphId id(i, 2, 0);
+        if (!c->Get(id))
+          c->Put(id, GraphTile(), 1);
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  // every reader sees the same shared tiles
+  for (uint32_t i = 0; i < 40; ++i) {
+    if (!cache->Contains({i, 2, 0}) || cache->Get({i, 2, 0}) == nullptr)
+      throw std::runtime_error("Tile should be in the shared sharded cache");
+  }
+  if (cache->Contains({41, 2, 0}))
+    throw std::runtime_error("Tile should not be in the cache");
+  if (cache->OverCommitted())
+    throw std::runtime_error("Cache should be under committed");
+
+  // tiles of different levels must not all land in one shard
+  auto sharded = static_cast<ShardedTileCache*>(cache.get());
+  std::unordered_set<size_t> used;
+  for (uint32_t i = 0; i < 40; ++i)
+    used.insert(sharded->Shard({i, 2, 0}));
+  if (used.size() < 2)
+    throw std::runtime_error("Tiles should be spread across shards");
+
+  // a reader remembers the tiles it got but forgets them once any reader evicts
+  std::unique_ptr<TileCache> other(TileCacheFactory::createTileCache(pt));
+  const auto* remembered = cache->Get({0, 2, 0});
+  if (remembered == nullptr || cache->Get({0, 2, 0}) != remembered || other->Get({0, 2, 0}) != remembered)
+    throw std::runtime_error("Readers should share the same tile");
+  other->Evict({0, 2, 0});
+  if (cache->Get({0, 2, 0}) || cache->Contains({0, 2, 0}))
+    throw std::runtime_error("Evicted tile should have been forgotten by every reader");
+
+  // a shard is over committed once it takes more than its share
+  for (uint32_t i = 100; i < 200; ++i)
+    cache->Put({i, 2, 0}, GraphTile(), 10);
+  if (!cache->OverCommitted())
+    throw std::runtime_error("Cache should be over committed");
+  cache->Clear();
+  if (cache->OverCommitted() || cache->Contains({0, 2, 0}))
+    throw std::runtime_error("Cache should be empty");
+}
+
 void touch_tile(const uint32_t tile_id, const std::string& tile_dir) {
   auto suffix = GraphTile::FileSuffix({tile_id, 2, 0});
   auto fullpath = tile_dir + '/' + suffix;
@@ -124,9 +231,236 @@ void TestConnectivityMap() {
   if(conn.get_color({a2, 2, 0}) == conn.get_color({d0, 2, 0}))
     throw std::runtime_error("a is disjoint from d");
 
+  //the colors should come back the same when mapped from a file
+  std::string file_name = tile_dir + "/connectivity.bin";
+  conn.save(file_name);
+  boost::filesystem::remove_all(tile_dir + "/2");
+  pt.put("connectivity_map", file_name);
+  connectivity_map_t mapped(pt);
+  for(auto tile : {a0, a1, a2, b0, c0, d0, d1})
+    if(mapped.get_color({tile, 2, 0}) != conn.get_color({tile, 2, 0}))
+      throw std::runtime_error("Mapped colors should match the ones found from the tiles");
+  if(mapped.get_color({level.tiles.RightNeighbor(b0), 2, 0}) != 0)
+    throw std::runtime_error("Tiles that dont exist should have no color");
+
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void write_tile(const GraphId& id, const std::string& tile_dir, const uint64_t dataset_id = 0) {
+  GraphTileHeader header;
+  header.set_graphid(id);
+  header.set_dataset_id(dataset_id);
+  header.set_end_offset(sizeof(GraphTileHeader));
+  auto fullpath = tile_dir + '/' + GraphTile::FileSuffix(id);
+  boost::filesystem::create_directories(boost::filesystem::path(fullpath).parent_path());
+  std::ofstream file(fullpath, std::ios::out | std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void TestPrefetch() {
+  std::string tile_dir = "test/gphrdr_prefetch_test";
+  boost::filesystem::remove_all(tile_dir);
+  GraphId a(0, 2, 0), b(1, 2, 0), missing(2, 2, 0);
+  write_tile(a, tile_dir);
+  write_tile(b, tile_dir);
+
+  //load them in the background and wait for them to show up
+  TilePrefetcher prefetcher(tile_dir, "", false, 2, 16);
+  prefetcher.Prefetch({a, b, missing});
+  for(size_t i = 0; i < 5000 && prefetcher.Staged() < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  GraphTile tile;
+  if(!prefetcher.Take(a, tile) || !tile.header() || tile.id() != a)
+    throw std::runtime_error("Prefetched tile should have been staged");
+  if(prefetcher.Take(a, tile))
+    throw std::runtime_error("Prefetched tile should only be taken once");
+  if(prefetcher.Take(missing, tile))
+    throw std::runtime_error("Missing tile should not have been staged");
+  prefetcher.Clear();
+  if(prefetcher.Staged() != 0 || prefetcher.Take(b, tile))
+    throw std::runtime_error("Clear should drop staged tiles");
+
+  //the reader should hand out the same tiles whether they were prefetched or not
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("tile_prefetch_threads", 1);
+  GraphReader reader(pt);
+  reader.Prefetch({a, b, missing});
+  reader.PrefetchAlong({0.1f, -89.9f}, {0.6f, -89.9f});
+  const auto* t = reader.GetGraphTile(b);
+  if(!t || t->id() != b)
+    throw std::runtime_error("Reader should have found the tile");
+  if(reader.GetGraphTile(missing))
+    throw std::runtime_error("Reader should not have found the missing tile");
+
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void TestTileRing() {
+  std::string tile_dir = "test/gphrdr_ring_test";
+  boost::filesystem::remove_all(tile_dir);
+  GraphId a(0, 2, 0), b(1, 2, 0), missing(2, 2, 0);
+  write_tile(a, tile_dir);
+  write_tile(b, tile_dir);
+
+  //not every kernel (or build) has io_uring, when it does the batch should
+  //come back in the order asked for with nothing for the missing tile
+  TileRing ring(1);
+  auto tiles = ring.Read(tile_dir, {b, missing, a});
+  if(tiles.size() != 3)
+    throw std::runtime_error("Expected a tile per id");
+  if(ring.valid() && (!tiles[0].header() || tiles[0].id() != b || !tiles[2].header() || tiles[2].id() != a))
+    throw std::runtime_error("Ring should have read the tiles");
+  if(tiles[1].header() || (!ring.valid() && (tiles[0].header() || tiles[2].header())))
+    throw std::runtime_error("Ring should not have read what it couldnt");
+
+  //either way the prefetcher should stage them all
+  TilePrefetcher prefetcher(tile_dir, "", false, 1, 16, false, 8);
+  prefetcher.Prefetch({a, b, missing});
+  for(size_t i = 0; i < 5000 && prefetcher.Staged() < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  GraphTile tile;
+  if(!prefetcher.Take(a, tile) || tile.id() != a || !prefetcher.Take(b, tile) || tile.id() != b)
+    throw std::runtime_error("Batch prefetched tiles should have been staged");
+
   boost::filesystem::remove_all(tile_dir);
 }
 
+void TestSpill() {
+  std::string tile_dir = "test/gphrdr_spill_test";
+  boost::filesystem::remove_all(tile_dir);
+
+  //a tile that came over the wire should be readable from disk once spilled
+  GraphId id(3, 2, 0);
+  GraphTileHeader header;
+  header.set_graphid(id);
+  header.set_end_offset(sizeof(GraphTileHeader));
+  std::vector<char> data(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header) + sizeof(header));
+  GraphTile fetched(id, std::move(data));
+  if(!fetched.header() || !fetched.Spill(tile_dir))
+    throw std::runtime_error("Tile should have been spilled");
+  GraphTile spilled(tile_dir, id);
+  if(!spilled.header() || spilled.id() != id || spilled.header()->end_offset() != sizeof(GraphTileHeader))
+    throw std::runtime_error("Spilled tile should be readable");
+
+  //nothing to spill and too little data to be a tile
+  if(GraphTile().Spill(tile_dir) || GraphTile(id, std::vector<char>(8)).header())
+    throw std::runtime_error("Empty tiles should not be spilled");
+
+  boost::filesystem::remove_all(tile_dir);
+}
+
+void TestSharedMemoryCache() {
+  std::string tile_dir = "test/gphrdr_shared_test", shared_dir = "test/gphrdr_shared_test_shm";
+  boost::filesystem::remove_all(tile_dir);
+  boost::filesystem::remove_all(shared_dir);
+  GraphId a(0, 2, 0), missing(2, 2, 0);
+  write_tile(a, tile_dir);
+
+  //the first reader puts the tile into shared memory
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("shared_cache_dir", shared_dir);
+  GraphReader reader(pt);
+  const auto* t = reader.GetGraphTile(a);
+  if(!t || t->id() != a)
+    throw std::runtime_error("Reader should have found the tile");
+  if(!boost::filesystem::exists(shared_dir + '/' + GraphTile::FileSuffix(a)))
+    throw std::runtime_error("Tile should have been put into shared memory");
+  if(reader.GetGraphTile(missing) || boost::filesystem::exists(shared_dir + '/' + GraphTile::FileSuffix(missing)))
+    throw std::runtime_error("Missing tile should not be shared");
+
+  //another reader, as if in another process, maps it from there without the tile directory
+  boost::filesystem::remove_all(tile_dir);
+  pt.put("tile_dir", "test/gphrdr_shared_test_nowhere");
+  GraphReader other(pt);
+  if(!other.DoesTileExist(a))
+    throw std::runtime_error("Shared tile should exist for the other reader");
+  t = other.GetGraphTile(a);
+  if(!t || t->id() != a || t->header()->end_offset() != sizeof(GraphTileHeader))
+    throw std::runtime_error("Other reader should have mapped the shared tile");
+
+  boost::filesystem::remove_all(shared_dir);
+}
+
+void TestSpillTier() {
+  std::string tile_dir = "test/gphrdr_spill_tier_test", spill_dir = "test/gphrdr_spill_tier_test_ssd";
+  boost::filesystem::remove_all(tile_dir);
+  boost::filesystem::remove_all(spill_dir);
+  GraphId a(0, 2, 0), b(1, 2, 0);
+  write_tile(a, tile_dir);
+  write_tile(b, tile_dir);
+
+  //with room for one copy the older one is removed
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("shared_cache_dir", spill_dir);
+  pt.put("shared_cache_max_size", sizeof(GraphTileHeader));
+  GraphReader reader(pt);
+  if(!reader.GetGraphTile(a) || !reader.GetGraphTile(b))
+    throw std::runtime_error("Reader should have found the tiles");
+  if(boost::filesystem::exists(spill_dir + '/' + GraphTile::FileSuffix(a)) ||
+     !boost::filesystem::exists(spill_dir + '/' + GraphTile::FileSuffix(b)))
+    throw std::runtime_error("Only the newest copy should have been kept");
+
+  //a tile dropped from memory comes back from its copy
+  boost::filesystem::remove_all(tile_dir);
+  reader.Clear();
+  const auto* t = reader.GetGraphTile(b);
+  if(!t || t->id() != b || reader.GetGraphTile(a))
+    throw std::runtime_error("Only the kept copy should come back");
+
+  boost::filesystem::remove_all(spill_dir);
+}
+
+void TestTileUpdates() {
+  std::string tile_dir = "test/gphrdr_updates_test", delta_dir = "test/gphrdr_updates_test_delta";
+  boost::filesystem::remove_all(tile_dir);
+  boost::filesystem::remove_all(delta_dir);
+  GraphId a(0, 2, 0), b(1, 2, 0);
+  write_tile(a, tile_dir, 1);
+  write_tile(b, tile_dir, 1);
+
+  //a running reader has the old tile cached
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", tile_dir);
+  pt.put("tile_updates_refresh_seconds", 0);
+  GraphReader reader(pt);
+  const auto* t = reader.GetGraphTile(a);
+  if(!t || t->header()->dataset_id() != 1 || !reader.GetGraphTile(b))
+    throw std::runtime_error("Reader should have found the old tiles");
+  if(reader.RefreshTiles())
+    throw std::runtime_error("Nothing was updated so nothing should be evicted");
+
+  //only the tile that differs is installed
+  write_tile(a, delta_dir, 2);
+  write_tile(b, delta_dir, 1);
+  auto installed = TileUpdates::Apply(tile_dir, delta_dir);
+  if(installed.size() != 1 || installed.front() != a)
+    throw std::runtime_error("Only the changed tile should have been installed");
+  if(TileUpdates::Read(tile_dir).size() != 1 || TileUpdates::Read(tile_dir).front().first != 1)
+    throw std::runtime_error("The changed tile should have been recorded as the first version");
+  if(!TileUpdates::Apply(tile_dir, delta_dir).empty())
+    throw std::runtime_error("Applying the same delta again should install nothing");
+
+  //the reader evicts it and reads the new one
+  if(!reader.RefreshTiles())
+    throw std::runtime_error("The updated tile should have been evicted");
+  t = reader.GetGraphTile(a);
+  if(!t || t->header()->dataset_id() != 2)
+    throw std::runtime_error("Reader should have read the updated tile");
+  if(reader.RefreshTiles())
+    throw std::runtime_error("The update should only be picked up once");
+
+  //a new reader starts out with the updates it already sees
+  GraphReader other(pt);
+  if(other.RefreshTiles())
+    throw std::runtime_error("A new reader should have nothing to evict");
+
+  boost::filesystem::remove_all(tile_dir);
+  boost::filesystem::remove_all(delta_dir);
+}
+
 }
 
 int main() {
@@ -136,7 +470,23 @@ int main() {
 
   suite.test(TEST_CASE(TestCacheLimits));
 
+  suite.test(TEST_CASE(TestLRUCache));
+
+  suite.test(TEST_CASE(TestShardedCache));
+
   suite.test(TEST_CASE(TestConnectivityMap));
 
+  suite.test(TEST_CASE(TestPrefetch));
+
+  suite.test(TEST_CASE(TestTileRing));
+
+  suite.test(TEST_CASE(TestSpill));
+
+  suite.test(TEST_CASE(TestSharedMemoryCache));
+
+  suite.test(TEST_CASE(TestSpillTier));
+
+  suite.test(TEST_CASE(TestTileUpdates));
+
   return suite.tear_down();
 }
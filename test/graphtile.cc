@@ -2,6 +2,7 @@
 #include "test.h"
 
 #include "baldr/graphtile.h"
+#include "baldr/tilecompression.h"
 
 #include <vector>
 
@@ -118,6 +119,28 @@ void bin() {
   }
 }
 
+void lz4_tile() {
+  // something compressible with a bit of noise
+  std::vector<char> tile(100000);
+  for(size_t i = 0; i < tile.size(); ++i)
+    tile[i] = static_cast<char>((i % 251) ^ (i / 4096));
+
+  auto compressed = lz4_compress_tile(tile.data(), tile.size());
+  if(compressed.size() >= tile.size())
+    throw std::logic_error("Tile did not compress");
+
+  std::vector<char> decompressed;
+  if(!lz4_decompress_tile(compressed.data(), compressed.size(), decompressed) || decompressed != tile)
+    throw std::logic_error("Tile did not round trip through lz4");
+
+  // truncated or corrupt containers are refused
+  if(lz4_decompress_tile(compressed.data(), compressed.size() - 1, decompressed))
+    throw std::logic_error("Truncated tile should not decompress");
+  compressed[0] = 'X';
+  if(lz4_decompress_tile(compressed.data(), compressed.size(), decompressed))
+    throw std::logic_error("Tile with bad magic should not decompress");
+}
+
 }
 
 int main() {
@@ -129,5 +152,7 @@ int main() {
 
   suite.test(TEST_CASE(bin));
 
+  suite.test(TEST_CASE(lz4_tile));
+
   return suite.tear_down();
 }
@@ -117,6 +117,62 @@ void TestDuplicateEdgeInfo() {
     throw std::runtime_error("There should still be exactly one of these in here");
 }
 
+void TestAddName() {
+  std::string test_dir = "test/data/builder_tiles";
+  GraphTileBuilder test(test_dir, GraphId(0,2,0), false);
+  if(test.AddName("") != 0)
+    throw std::runtime_error("The empty name should be at the start of the text list");
+
+  //names are only added once
+  auto main = test.AddName("Main Street");
+  if(main == 0 || test.AddName("Main Street") != main)
+    throw std::runtime_error("The same name should get the same offset");
+
+  //a name that starts like another one is its own name
+  auto main_prefix = test.AddName("Main");
+  if(main_prefix == main || test.AddName("Main") != main_prefix)
+    throw std::runtime_error("A name that is the start of another should get its own offset");
+  if(main_prefix != main + std::string("Main Street").size() + 1)
+    throw std::runtime_error("Names should follow each other in the text list");
+}
+
+void TestComplexRestrictions() {
+  // Restrictions are found by their to edge going forward and their from edge
+  // in reverse, whatever order they were added in
+  std::string test_dir = "test/data/restriction_tiles";
+  GraphId tile_id(0,2,0);
+  std::list<ComplexRestrictionBuilder> restrictions;
+  for (const auto& ids : std::vector<std::pair<uint32_t, uint32_t> >{{5, 9}, {1, 3}, {7, 9}, {2, 4}}) {
+    ComplexRestrictionBuilder restriction;
+    restriction.set_from_id(GraphId(0,2,ids.first));
+    restriction.set_to_id(GraphId(0,2,ids.second));
+    restriction.set_via_list({GraphId(0,2,ids.first + 10)});
+    restriction.set_type(RestrictionType::kNoLeftTurn);
+    restriction.set_modes(ids.first == 7 ? kPedestrianAccess : kAutoAccess);
+    restrictions.push_back(restriction);
+  }
+  GraphTileBuilder builder(test_dir, tile_id, false);
+  builder.UpdateComplexRestrictions(restrictions, true);
+  builder.UpdateComplexRestrictions(restrictions, false);
+  builder.StoreTileData();
+
+  GraphTile tile(test_dir, tile_id);
+  auto to = tile.GetRestrictions(true, GraphId(0,2,9), kAllAccess);
+  if (to.size() != 2 || to[0].from_id() != GraphId(0,2,5) || to[1].from_id() != GraphId(0,2,7))
+    throw std::runtime_error("Both restrictions to the edge should be found");
+  if (tile.GetRestrictions(true, GraphId(0,2,9), kAutoAccess).size() != 1)
+    throw std::runtime_error("Only the restrictions of the modes asked for should be found");
+  if (!tile.GetRestrictions(true, GraphId(0,2,5), kAllAccess).empty())
+    throw std::runtime_error("No restriction goes to this edge");
+  auto from = tile.GetRestrictions(false, GraphId(0,2,2), kAllAccess);
+  if (from.size() != 1 || from[0].to_id() != GraphId(0,2,4) || from[0].GetViaId(0) != GraphId(0,2,12))
+    throw std::runtime_error("The restriction from the edge should be found");
+  if (!tile.HasRestrictions(true, GraphId(0,2,9), kPedestrianAccess) ||
+      tile.HasRestrictions(true, GraphId(0,2,4), kPedestrianAccess) ||
+      tile.HasRestrictions(false, GraphId(0,2,9), kAllAccess))
+    throw std::runtime_error("Only the restrictions of the edge and modes should be found");
+}
+
 void TestAddBins() {
 
   //if you update the tile format you must regenerate test tiles. after your tile format change,
@@ -198,6 +254,77 @@ void TestAddBins() {
   }
 }
 
+void TestUpdateHeader() {
+  // Copy a test tile by adding no bins to it
+  GraphId id(744881,2,0);
+  GraphTile t("test/data/bin_tiles/no_bin", id);
+  if(!t.header())
+    throw std::runtime_error("Couldn't load test tile");
+  std::string header_dir = "test/data/bin_tiles/header";
+  GraphTileBuilder::AddBins(header_dir, &t, {});
+  if(GraphTile(header_dir, id).header()->up_transition_factor() != 1.0f ||
+     GraphTile(header_dir, id).header()->expansion_within_factor() != 1.0f)
+    throw std::logic_error("Tiles without factors should not scale the hierarchy limits");
+
+  // Factors are kept in steps and within what fits
+  GraphTileHeader header = *t.header();
+  header.set_up_transition_factor(0.55f);
+  header.set_expansion_within_factor(4.0f);
+  GraphTileBuilder::UpdateHeader(header_dir, header);
+  GraphTile updated(header_dir, id);
+  if(updated.header()->up_transition_factor() != 0.5f ||
+     updated.header()->expansion_within_factor() != 15 * kHierarchyLimitsStep)
+    throw std::logic_error("Unexpected hierarchy limits factors");
+
+  // Nothing but the header changes
+  if(updated.header()->end_offset() != t.header()->end_offset() ||
+     std::memcmp(reinterpret_cast<const char*>(updated.header()) + sizeof(GraphTileHeader),
+                 reinterpret_cast<const char*>(t.header()) + sizeof(GraphTileHeader),
+                 t.header()->end_offset() - sizeof(GraphTileHeader)) != 0)
+    throw std::logic_error("Updating the header should leave the rest of the tile alone");
+}
+
+void TestShortcutEdges() {
+  // Tiles built before shortcuts kept their base edges have none
+  GraphId id(744881,2,0);
+  GraphTile t("test/data/bin_tiles/no_bin", id);
+  if(!t.header())
+    throw std::runtime_error("Couldn't load test tile");
+  if(t.has_shortcut_edges() || !t.GetShortcutEdges(0).empty())
+    throw std::logic_error("Older tiles should not have shortcut edges");
+
+  // Base edges are kept per shortcut in the order they were added
+  std::string shortcut_dir = "test/data/bin_tiles/shortcut";
+  GraphTileBuilder::AddBins(shortcut_dir, &t, {});
+  std::vector<GraphId> first{GraphId(744881,2,3), GraphId(744882,2,7)};
+  std::vector<GraphId> second{GraphId(744881,2,5)};
+  {
+    GraphTileBuilder builder(shortcut_dir, id, true);
+    builder.AddShortcutBaseEdges(0, first);
+    builder.AddShortcutBaseEdges(2, second);
+    builder.StoreTileData();
+  }
+  GraphTile stored(shortcut_dir, id);
+  auto edges = stored.GetShortcutEdges(0);
+  if(!stored.has_shortcut_edges() ||
+     std::vector<GraphId>(edges.begin(), edges.end()) != first)
+    throw std::logic_error("Wrong base edges for the first shortcut");
+  edges = stored.GetShortcutEdges(2);
+  if(std::vector<GraphId>(edges.begin(), edges.end()) != second)
+    throw std::logic_error("Wrong base edges for the second shortcut");
+  if(!stored.GetShortcutEdges(1).empty() || !stored.GetShortcutEdges(3).empty())
+    throw std::logic_error("Edges without base edges should have none");
+
+  // They survive the tile being rewritten
+  {
+    GraphTileBuilder builder(shortcut_dir, id, true);
+    builder.StoreTileData();
+  }
+  edges = GraphTile(shortcut_dir, id).GetShortcutEdges(0);
+  if(std::vector<GraphId>(edges.begin(), edges.end()) != first)
+    throw std::logic_error("Base edges should be kept when a tile is rewritten");
+}
+
 struct fake_tile : public GraphTile {
  public:
   fake_tile(const std::string& plyenc_shape) {
@@ -247,9 +374,19 @@ int main() {
   // Write to file and read into EdgeInfo
   suite.test(TEST_CASE(TestDuplicateEdgeInfo));
 
+  suite.test(TEST_CASE(TestAddName));
+
+  suite.test(TEST_CASE(TestComplexRestrictions));
+
   // Add bins to a tile and see if its still ok
   suite.test(TEST_CASE(TestAddBins));
 
+  // Replace the header of a tile
+  suite.test(TEST_CASE(TestUpdateHeader));
+
+  // Keep the base edges of shortcuts in a tile
+  suite.test(TEST_CASE(TestShortcutEdges));
+
   // Test bin edges of some tricky edges
   suite.test(TEST_CASE(TestBinEdges));
 
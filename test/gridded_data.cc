@@ -1,6 +1,7 @@
 #include "test.h"
 #include "midgard/gridded_data.h"
 #include "midgard/pointll.h"
+#include <algorithm>
 #include <limits>
 //#include <iostream>
 
@@ -49,6 +50,14 @@ namespace {
     if(rings == 0)
       throw std::logic_error("There should be at least a few rings here");
 
+    //tracing the intervals in parallel shouldnt change anything
+    for(auto rings_only : {true, false}) {
+      auto serial = g.GenerateContours(iso_markers, rings_only, 1.f, 200.f, 1);
+      auto parallel = g.GenerateContours(iso_markers, rings_only, 1.f, 200.f, 4);
+      if(serial != parallel)
+        throw std::logic_error("Contours should be the same no matter how many threads trace them");
+    }
+
     /*
     std::cout << "{\"type\":\"FeatureCollection\",\"features\":[";
     for(const auto& feature : contours) {
@@ -66,6 +75,103 @@ namespace {
     std::cout << "]}";*/
   }
 
+  void test_sparse() {
+    //a large grid with only a small patch near its center set
+    GriddedData<PointLL> g({-50,-50,50,50}, 0.5f, std::numeric_limits<float>::max());
+    if(g.allocated_blocks() != 0)
+      throw std::logic_error("Nothing should be allocated before anything is set");
+    for(float x = -2.f; x <= 2.f; x += 0.5f) {
+      for(float y = -2.f; y <= 2.f; y += 0.5f) {
+        PointLL p(x, y);
+        g.SetIfLessThan(p, PointLL(0,0).Distance(p));
+      }
+    }
+
+    //only the blocks around the patch are needed
+    auto blocks = g.allocated_blocks();
+    if(blocks == 0 || blocks > 4)
+      throw std::logic_error("Only the blocks set should be allocated but there are " + std::to_string(blocks));
+    if(g.Value(g.TileId(PointLL(40,40))) != std::numeric_limits<float>::max())
+      throw std::logic_error("Tiles that were never set should have the initial value");
+    if(g.SetIfLessThan(PointLL(40,40), std::numeric_limits<float>::max()) || g.allocated_blocks() != blocks)
+      throw std::logic_error("Values that aren't less shouldn't allocate blocks");
+
+    //the patch should get a ring around its center
+    auto contours = g.GenerateContours({150000}, true);
+    const auto& features = contours.begin()->second;
+    if(features.empty() || features.front().empty())
+      throw std::logic_error("There should be a ring around the patch");
+    if(!PointLL(0,0).WithinPolygon(features.front().front()))
+      throw std::logic_error("The ring should be around the center of the patch");
+  }
+
+
+  void test_combine() {
+    //two patches that overlap in the middle
+    constexpr auto unset = std::numeric_limits<float>::max();
+    GriddedData<PointLL> a({-50,-50,50,50}, 0.5f, unset), b({-50,-50,50,50}, 0.5f, unset);
+    a.Set(PointLL(-1,0), 1.f);
+    a.Set(PointLL(0,0), 5.f);
+    b.Set(PointLL(0,0), 3.f);
+    b.Set(PointLL(1,0), 2.f);
+    b.Set(PointLL(40,40), 4.f);
+
+    //either of them
+    GriddedData<PointLL> either(a);
+    either.Combine(b, false);
+    if(either.Value(either.TileId(PointLL(-1,0))) != 1.f || either.Value(either.TileId(PointLL(0,0))) != 3.f ||
+       either.Value(either.TileId(PointLL(1,0))) != 2.f || either.Value(either.TileId(PointLL(40,40))) != 4.f)
+      throw std::logic_error("Combining the smaller values should keep a tile set in either grid");
+
+    //both of them
+    GriddedData<PointLL> both(a);
+    both.Combine(b, true);
+    if(both.Value(both.TileId(PointLL(-1,0))) != unset || both.Value(both.TileId(PointLL(0,0))) != 5.f ||
+       both.Value(both.TileId(PointLL(1,0))) != unset || both.Value(both.TileId(PointLL(40,40))) != unset)
+      throw std::logic_error("Combining the larger values should only keep a tile set in both grids");
+    if(both.allocated_blocks() > a.allocated_blocks())
+      throw std::logic_error("Combining the larger values shouldn't allocate blocks");
+
+    //only the same tiles can be combined
+    GriddedData<PointLL> c({-50,-50,50,50}, 0.25f, unset);
+    try {
+      c.Combine(a, false);
+      throw std::runtime_error("Grids over other tiles shouldn't be combined");
+    }
+    catch(const std::invalid_argument&) { }
+  }
+
+
+  void test_mask() {
+    //times from two origins and which of them each tile is nearest to
+    constexpr auto unset = std::numeric_limits<float>::max();
+    GriddedData<PointLL> times({-50,-50,50,50}, 0.5f, unset), origins({-50,-50,50,50}, 0.5f, unset);
+    for(float x = -3.f; x <= 3.f; x += 0.5f) {
+      for(float y = -2.f; y <= 2.f; y += 0.5f) {
+        PointLL p(x, y);
+        auto tile = times.TileId(p);
+        times.Set(tile, std::min(PointLL(-1,0).Distance(p), PointLL(1,0).Distance(p)));
+        origins.Set(tile, x < 0 ? 0 : 1);
+      }
+    }
+    times.Set(PointLL(40,40), 3.f);
+
+    //only the tiles nearest to the first origin are kept
+    GriddedData<PointLL> first(times);
+    first.Mask(origins, 0);
+    if(first.Value(first.TileId(PointLL(-1,0))) != 0.f || first.Value(first.TileId(PointLL(1,0))) != unset)
+      throw std::logic_error("Only the tiles with the key should be kept");
+    if(first.Value(first.TileId(PointLL(40,40))) != unset || first.allocated_blocks() >= times.allocated_blocks())
+      throw std::logic_error("Blocks without the key shouldn't be kept");
+
+    //the catchment gets a ring around its origin
+    auto contours = first.GenerateContours({100000}, true);
+    const auto& features = contours.begin()->second;
+    if(features.empty() || !PointLL(-1,0).WithinPolygon(features.front().front()) ||
+       PointLL(1,0).WithinPolygon(features.front().front()))
+      throw std::logic_error("The ring should only be around the first origin");
+  }
+
 }
 
 int main() {
@@ -73,5 +179,11 @@ int main() {
 
   suite.test(TEST_CASE(test_gridded));
 
+  suite.test(TEST_CASE(test_sparse));
+
+  suite.test(TEST_CASE(test_combine));
+
+  suite.test(TEST_CASE(test_mask));
+
   return suite.tear_down();
 }
@@ -0,0 +1,53 @@
+#include "test.h"
+
+#include "baldr/hotedge.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+  void test_sizeof() {
+    if (sizeof(HotEdge) != 16)
+      throw std::runtime_error("HotEdge size should be 16 bytes but is " +
+                std::to_string(sizeof(HotEdge)));
+  }
+
+  void TestFromDirectedEdge() {
+    DirectedEdge edge;
+    edge.set_endnode(GraphId(123, 1, 4567));
+    edge.set_forwardaccess(kAutoAccess | kBicycleAccess);
+    edge.set_reverseaccess(kPedestrianAccess);
+    edge.set_superseded(3);
+    edge.set_shortcut(2);
+    edge.set_leaves_tile(true);
+    edge.set_use(Use::kRoad);
+    HotEdge hot(edge);
+    if (hot.endnode() != edge.endnode())
+      throw runtime_error("HotEdge should have the end node of the directed edge");
+    if (hot.forwardaccess() != edge.forwardaccess() || hot.reverseaccess() != edge.reverseaccess())
+      throw runtime_error("HotEdge should have the access of the directed edge");
+    if (hot.superseded() != edge.superseded() || !hot.is_shortcut() || !hot.leaves_tile())
+      throw runtime_error("HotEdge should have the shortcut flags of the directed edge");
+    if (hot.trans_up() || hot.trans_down())
+      throw runtime_error("HotEdge of a road should not be a transition");
+
+    // Transitions
+    edge.set_trans_up();
+    if (!HotEdge(edge).trans_up() || HotEdge(edge).trans_down())
+      throw runtime_error("HotEdge should be a transition up");
+    edge.set_trans_down();
+    if (HotEdge(edge).trans_up() || !HotEdge(edge).trans_down())
+      throw runtime_error("HotEdge should be a transition down");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("hotedge");
+
+  suite.test(TEST_CASE(test_sizeof));
+  suite.test(TEST_CASE(TestFromDirectedEdge));
+
+  return suite.tear_down();
+}
@@ -83,12 +83,56 @@ void TestJsonSerialize() {
       throw std::runtime_error("Wrong json!");
 }
 
+void TestJsonWriter() {
+
+  using namespace std;
+  using namespace valhalla::baldr;
+
+  // Written as it goes in the order given
+  string result;
+  json::Writer writer(result);
+  writer.start_object();
+  writer("status", uint64_t(0));
+  writer.start_array("via_points");
+  writer.start_array();
+  writer(json::fp_t{40.744377, 3});
+  writer(json::fp_t{-73.990433, 3});
+  writer.end_array();
+  writer.start_object();
+  writer.end_object();
+  writer.end_array();
+  writer("found_alternative", bool(false));
+  writer("offset", int64_t(-12));
+  writer("nothing", nullptr);
+  writer("escaped_string", string("\"\t\r\n\\\a/"));
+  writer("names", json::array({string("West 26th Street"), json::map({{"checksum", uint64_t(2875622111)}})}));
+  writer.end_object();
+  string answer = "{\"status\":0,\"via_points\":[[40.744,-73.990],{}],\"found_alternative\":false,\"offset\":-12,"
+      "\"nothing\":null,\"escaped_string\":\"\\\"\\t\\r\\n\\\\\\u0007\\/\",\"names\":[\"West 26th Street\",{\"checksum\":2875622111}]}";
+  if(result != answer)
+    throw std::runtime_error("Wrong json written: " + result);
+
+  // Built values come out the same as through the ostream
+  auto dom = json::map({
+    {"a", json::array({uint64_t(1), json::fp_t{0.5, 6}, json::fp_t{NAN, 2}, json::array({}), json::map({})})},
+    {"b", json::map({{"c", string("d")}, {"e", bool(true)}})},
+    {"f", nullptr}
+  });
+  stringstream streamed; streamed << *dom;
+  string written;
+  json::Writer dom_writer(written);
+  dom_writer(dom);
+  if(written != streamed.str())
+    throw std::runtime_error("Expected the writer to match the ostream");
+}
+
 }
 
 int main() {
   test::suite suite("json");
 
   suite.test(TEST_CASE(TestJsonSerialize));
+  suite.test(TEST_CASE(TestJsonWriter));
 
   return suite.tear_down();
 }
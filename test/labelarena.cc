@@ -0,0 +1,105 @@
+#include "test.h"
+
+#include "thor/labelarena.h"
+#include "sif/edgelabel.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace {
+
+void TestReuse() {
+  LabelArena arena;
+
+  // Released storage should come back out on the next acquire
+  auto labels = arena.Acquire<EdgeLabel>(1000);
+  if (labels.capacity() < 1000 || !labels.empty())
+    throw runtime_error("Acquired labels should be empty with the reserved capacity");
+  labels.resize(10);
+  const auto* data = labels.data();
+  arena.Release(labels);
+  if (labels.capacity() != 0 || arena.size() < 1000 * sizeof(EdgeLabel))
+    throw runtime_error("Released labels should be kept by the arena");
+  auto again = arena.Acquire<EdgeLabel>(10);
+  if (again.data() != data || !again.empty() || arena.size() != 0)
+    throw runtime_error("Released labels should have been reused");
+
+  // Label types are pooled separately
+  arena.Release(again);
+  auto bd = arena.Acquire<BDEdgeLabel>(5);
+  if (bd.capacity() < 5 || arena.size() == 0)
+    throw runtime_error("Label types should not share storage");
+
+  // The helpers work without an arena too
+  std::vector<EdgeLabel> plain;
+  ReserveLabels<EdgeLabel>(nullptr, plain, 100);
+  plain.resize(3);
+  ReleaseLabels<EdgeLabel>(nullptr, plain);
+  if (!plain.empty() || plain.capacity() < 100)
+    throw runtime_error("Without an arena labels should just be cleared");
+}
+
+void TestTrim() {
+  LabelArena arena(1000 * sizeof(EdgeLabel));
+  std::vector<std::vector<EdgeLabel>> all;
+  for (size_t i = 1; i <= 4; ++i)
+    all.emplace_back(arena.Acquire<EdgeLabel>(i * 500));
+  for (auto& labels : all)
+    arena.Release(labels);
+
+  // Storage is kept until trimmed, then the largest goes first
+  if (arena.size() < 5000 * sizeof(EdgeLabel))
+    throw runtime_error("Arena should keep its high water mark until trimmed");
+  arena.Trim();
+  if (arena.size() > 1000 * sizeof(EdgeLabel) || arena.size() == 0)
+    throw runtime_error("Trim should free down to the maximum size");
+  auto labels = arena.Acquire<EdgeLabel>(0);
+  if (labels.capacity() > 1000)
+    throw runtime_error("Trim should have freed the largest storage");
+}
+
+void TestEdgeStatus() {
+  LabelArena arena;
+
+  // A released status comes back with its tiles but every edge unreached
+  EdgeStatus status;
+  ReserveEdgeStatus(&arena, status);
+  for (uint32_t i = 0; i < 100; ++i)
+    status.Set(GraphId(i % 3, 2, i), EdgeSet::kPermanent, i);
+  size_t capacity = status.capacity();
+  ReleaseEdgeStatus(&arena, status);
+  if (status.capacity() != 0 || arena.size() != capacity * sizeof(EdgeStatusInfo))
+    throw runtime_error("Released edge status should be kept by the arena");
+  EdgeStatus again;
+  ReserveEdgeStatus(&arena, again);
+  if (again.capacity() != capacity || arena.size() != 0)
+    throw runtime_error("Released edge status should have been reused");
+  for (uint32_t i = 0; i < 100; ++i)
+    if (again.Get(GraphId(i % 3, 2, i)).set() != EdgeSet::kUnreached)
+      throw runtime_error("Reused edge status should have every edge unreached");
+
+  // Trimming frees them like labels
+  LabelArena small(0);
+  ReleaseEdgeStatus(&small, again);
+  if (small.size() == 0)
+    throw runtime_error("Released edge status should be kept until trimmed");
+  small.Trim();
+  if (small.size() != 0)
+    throw runtime_error("Trim should free released edge statuses");
+}
+
+}
+
+int main() {
+  test::suite suite("labelarena");
+
+  suite.test(TEST_CASE(TestReuse));
+
+  suite.test(TEST_CASE(TestTrim));
+
+  suite.test(TEST_CASE(TestEdgeStatus));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,185 @@
+#include "test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "baldr/landmarks.h"
+#include "mjolnir/landmarkbuilder.h"
+#include "thor/astarheuristic.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// Random one way graph, a ring with random chords so that every node can
+// reach every other one and the costs differ by direction
+std::vector<LandmarkBuilder::Arc> RandomArcs(const uint32_t node_count, std::mt19937& gen) {
+  std::vector<LandmarkBuilder::Arc> arcs;
+  for (uint32_t from = 0; from < node_count; ++from) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      uint32_t to = (from + 1 + static_cast<uint32_t>(test::rand01(gen) * 20)) % node_count;
+      if (i == 0)
+        to = (from + 1) % node_count;
+      arcs.push_back({from, to, std::floor(1 + test::rand01(gen) * 100)});
+    }
+  }
+  return arcs;
+}
+
+// Nodes split over two tiles
+Landmarks Build(const uint32_t node_count, const std::vector<LandmarkBuilder::Arc>& arcs,
+                const uint32_t count) {
+  std::vector<GraphId> tiles{GraphId(3, 1, 0), GraphId(7, 2, 0)};
+  std::vector<uint32_t> offsets{0, node_count / 2, node_count};
+  return LandmarkBuilder::Compute("auto", std::move(tiles), std::move(offsets), arcs, count);
+}
+
+// Plain dijkstra over the arcs
+std::vector<float> Dijkstra(const uint32_t node_count, const std::vector<LandmarkBuilder::Arc>& arcs,
+                            const uint32_t source) {
+  std::vector<std::vector<LandmarkBuilder::Arc> > out(node_count);
+  for (const auto& arc : arcs)
+    out[arc.from].push_back(arc);
+  std::vector<float> dist(node_count, std::numeric_limits<float>::infinity());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second])
+      continue;
+    for (const auto& arc : out[top.second]) {
+      if (top.first + arc.cost < dist[arc.to]) {
+        dist[arc.to] = top.first + arc.cost;
+        queue.emplace(dist[arc.to], arc.to);
+      }
+    }
+  }
+  return dist;
+}
+
+void TestLowerBounds() {
+  std::mt19937 gen(3);
+  const uint32_t node_count = 300;
+  auto arcs = RandomArcs(node_count, gen);
+  auto landmarks = Build(node_count, arcs, 8);
+  test::assert_bool(landmarks.landmark_count() == 8, "Expected 8 landmarks");
+  test::assert_bool(landmarks.node_count() == node_count, "Expected costs for every node");
+
+  for (uint32_t from = 0; from < node_count; from += 7) {
+    auto dist = Dijkstra(node_count, arcs, from);
+    for (uint32_t to = 0; to < node_count; ++to) {
+      float bound = landmarks.LowerBound(from, to);
+      if (bound < 0.f || bound > dist[to] + 0.01f)
+        throw std::runtime_error("Bound " + std::to_string(bound) + " from " + std::to_string(from) +
+                                 " to " + std::to_string(to) + " is more than the cost " +
+                                 std::to_string(dist[to]));
+    }
+  }
+
+  // The bounds are the costs themselves to and from a landmark
+  for (size_t l = 0; l < landmarks.landmark_count(); ++l) {
+    uint32_t landmark = landmarks.landmark(l);
+    auto dist = Dijkstra(node_count, arcs, landmark);
+    for (uint32_t to = 0; to < node_count; ++to) {
+      if (std::fabs(landmarks.LowerBound(landmark, to) - dist[to]) > 0.01f ||
+          std::fabs(landmarks.cost_from(to, l) - dist[to]) > 0.01f)
+        throw std::runtime_error("Expected the exact cost from landmark " + std::to_string(landmark));
+    }
+  }
+}
+
+void TestNodes() {
+  std::mt19937 gen(5);
+  auto landmarks = Build(40, RandomArcs(40, gen), 4);
+  test::assert_bool(landmarks.node(GraphId(3, 1, 5)) == 5, "Expected the first tile's nodes first");
+  test::assert_bool(landmarks.node(GraphId(7, 2, 5)) == 25, "Expected the second tile's nodes after");
+  test::assert_bool(landmarks.node(GraphId(7, 2, 20)) == kInvalidLandmarkNode,
+                    "Expected nodes past the end of a tile to be invalid");
+  test::assert_bool(landmarks.node(GraphId(4, 1, 0)) == kInvalidLandmarkNode,
+                    "Expected nodes of other tiles to be invalid");
+
+  // More landmarks than nodes stops once every node is one
+  auto few = Build(4, {{0, 1, 1.f}, {1, 2, 1.f}, {2, 3, 1.f}, {3, 0, 1.f}}, 16);
+  test::assert_bool(few.landmark_count() == 4, "Expected every node to be a landmark");
+}
+
+void TestHeuristic() {
+  std::mt19937 gen(9);
+  const uint32_t node_count = 100;
+  auto arcs = RandomArcs(node_count, gen);
+  auto landmarks = Build(node_count, arcs, 8);
+
+  // All nodes are at the same place so only the landmarks give an estimate
+  AStarHeuristic heuristic;
+  heuristic.Init(PointLL(0, 0), 1.f);
+  heuristic.SetLandmarks(&landmarks, {GraphId(7, 2, 10), GraphId(7, 2, 20)}, false);
+  auto to_a = Dijkstra(node_count, arcs, 60);
+  for (uint32_t n = 0; n < node_count / 2; ++n) {
+    float dist = 1.f;
+    float estimate = heuristic.Get(GraphId(3, 1, n), PointLL(0, 0), dist);
+    auto from = Dijkstra(node_count, arcs, n);
+    test::assert_bool(dist == 0.f, "Expected the distance to be the straight line distance");
+    test::assert_bool(estimate <= std::min(from[60], from[70]) + 0.01f,
+                      "Expected the estimate to be at most the cost to either target");
+    test::assert_bool(estimate >= std::min(landmarks.LowerBound(n, 60),
+                                           landmarks.LowerBound(n, 70)) - 0.01f,
+                      "Expected the estimate to use the landmarks");
+  }
+
+  // A target the tables don't have turns them off
+  heuristic.SetLandmarks(&landmarks, {GraphId(7, 2, 10), GraphId(8, 2, 0)}, false);
+  float dist;
+  test::assert_bool(heuristic.Get(GraphId(3, 1, 1), PointLL(0, 0), dist) == 0.f,
+                    "Expected no landmarks to be used");
+}
+
+void TestWriteLoad() {
+  std::mt19937 gen(7);
+  auto landmarks = Build(100, RandomArcs(100, gen), 6);
+  std::string file_name = "test/data/auto" + std::string(kLandmarksExtension);
+  landmarks.Write(file_name);
+  auto loaded = Landmarks::Load(file_name);
+  std::remove(file_name.c_str());
+  test::assert_bool(loaded.costing() == "auto", "Expected the costing to be read back");
+  test::assert_bool(loaded.node_count() == landmarks.node_count() &&
+                    loaded.landmark_count() == landmarks.landmark_count(),
+                    "Expected the same nodes and landmarks");
+  for (uint32_t n = 0; n < landmarks.node_count(); ++n) {
+    for (size_t l = 0; l < landmarks.landmark_count(); ++l)
+      test::assert_bool(loaded.cost_from(n, l) == landmarks.cost_from(n, l) &&
+                        loaded.cost_to(n, l) == landmarks.cost_to(n, l), "Expected the same costs");
+  }
+  test::assert_bool(loaded.node(GraphId(7, 2, 0)) == 50, "Expected the same tiles");
+
+  test::assert_throw<std::runtime_error>([]() {
+    Landmarks::Load("test/data/does_not_exist.landmarks");
+  }, "Expected loading missing landmarks to throw");
+}
+
+}
+
+int main() {
+  test::suite suite("landmarks");
+
+  suite.test(TEST_CASE(TestLowerBounds));
+
+  suite.test(TEST_CASE(TestNodes));
+
+  suite.test(TEST_CASE(TestHeuristic));
+
+  suite.test(TEST_CASE(TestWriteLoad));
+
+  return suite.tear_down();
+}
@@ -0,0 +1,75 @@
+#include "test.h"
+#include "midgard/logging.h"
+
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <string>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+void work(size_t thread) {
+  for(size_t i = 0; i < 500; ++i) {
+    std::string message = std::to_string(thread) + " " + std::to_string(i);
+    LOG_ERROR(message);
+    LOG_INFO(message);
+    LOG_DEBUG(message);
+  }
+}
+
+void AsyncFileLoggerTest() {
+  //get rid of it first so we don't append
+  std::remove("test/async_file_log_test.log");
+
+  //configure bogusly
+  try {
+    logging::Configure({ {"type", "file"}, {"file_name", "test/async_file_log_test.log"}, {"level", "loud"} });
+    throw std::runtime_error("Configuring with an unknown level should have thrown");
+  }catch(...){}
+  //configure properly
+  logging::Configure({ {"type", "file"}, {"file_name", "test/async_file_log_test.log"}, {"async", "true"}, {"level", "info"} });
+
+  //more lines than a ring holds from threads that come and go
+  std::vector<std::thread> threads;
+  for(size_t i = 0; i < 4; ++i)
+    threads.emplace_back(work, i);
+  for(auto& thread : threads)
+    thread.join();
+
+  //give the writer time to catch up
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  //every line of every thread in the order it logged them without the debug ones
+  std::ifstream file("test/async_file_log_test.log");
+  std::string line;
+  size_t error = 0, info = 0, debug = 0;
+  std::vector<int> last(4, -1);
+  while(std::getline(file, line)) {
+    error += (line.find(" [ERROR] ") != std::string::npos);
+    info += (line.find(" [INFO] ") != std::string::npos);
+    debug += (line.find(" [DEBUG] ") != std::string::npos);
+    auto message = line.substr(line.find("] ") + 2);
+    size_t thread = std::stoul(message.substr(0, message.find(' ')));
+    int i = std::stoi(message.substr(message.find(' ') + 1));
+    if(i < last[thread])
+      throw std::runtime_error("Lines of a thread should stay in order");
+    last[thread] = i;
+  }
+  std::remove("test/async_file_log_test.log");
+  if(error != 2000 || info != 2000 || debug != 0)
+    throw std::runtime_error("Wrong distribution of log messages");
+}
+
+}
+
+int main() {
+  test::suite suite("logging_async");
+
+  //check asynchronous file logging
+  suite.test(TEST_CASE(AsyncFileLoggerTest));
+
+  return suite.tear_down();
+}
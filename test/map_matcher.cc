@@ -0,0 +1,164 @@
+#include "test.h"
+
+#include <memory>
+#include <sstream>
+#include <unordered_set>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "meili/map_matcher.h"
+#include "meili/map_matcher_factory.h"
+
+using namespace valhalla;
+
+namespace {
+
+boost::property_tree::ptree config() {
+  std::stringstream conf_json; conf_json << R"({
+    "mjolnir":{"tile_dir":"test/traffic_matcher_tiles"},
+    "meili":{"mode":"auto","grid":{"cache_size":100240,"size":500},
+             "default":{"beta":3,"breakage_distance":10000,"geometry":false,"gps_accuracy":5.0,"interpolation_distance":0,
+             "max_route_distance_factor":5,"max_route_time_factor":5,"max_search_radius":100,"route":true,
+             "search_radius":50,"sigma_z":4.07,"turn_penalty_factor":200}}
+  })";
+  boost::property_tree::ptree conf;
+  boost::property_tree::read_json(conf_json, conf);
+  return conf;
+}
+
+// A long trace along the roads between two points of the test tile
+std::vector<meili::Measurement> trace(meili::MapMatcher& matcher) {
+  std::vector<meili::Measurement> ends = {
+    {{-76.376045f, 40.539207f}, 5.f, 50.f, 0.}, {{-76.35784f, 40.56786f}, 5.f, 50.f, 600.}};
+  const auto paths = matcher.OfflineMatch(ends);
+  const auto& path = paths.front();
+  std::vector<meili::Measurement> measurements;
+  for (const auto& segment : path.segments) {
+    for (const auto& point : segment.Shape(matcher.graphreader())) {
+      if (measurements.empty() || measurements.back().lnglat().Distance(point) > 30.f) {
+        measurements.emplace_back(point, 5.f, 50.f, measurements.size() * 3.);
+      }
+    }
+  }
+  return measurements;
+}
+
+void TestOnlineSameAsOffline() {
+  meili::MapMatcherFactory factory(config());
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(boost::property_tree::ptree()));
+  const auto measurements = trace(*matcher);
+  test::assert_bool(measurements.size() > 20, "Expected a long trace");
+  const auto paths = matcher->OfflineMatch(measurements);
+  const auto& expected = paths.front().results;
+
+  // Nothing is final before the end with a lag as long as the trace
+  matcher->Clear();
+  for (const auto& measurement : measurements) {
+    auto results = matcher->OnlineMatch({measurement}, measurements.size());
+    test::assert_bool(results.empty(), "Expected nothing to be final yet");
+  }
+  auto results = matcher->OnlineMatch({}, 0);
+  test::assert_bool(results.size() == expected.size(), "Expected a result per measurement");
+  for (size_t i = 0; i < results.size(); ++i) {
+    test::assert_bool(results[i].edgeid == expected[i].edgeid &&
+                      results[i].distance_along == expected[i].distance_along,
+                      "Expected the same match as offline at " + std::to_string(i));
+  }
+  test::assert_bool(matcher->OnlineMatch({}, 0).empty(), "Expected everything to be final already");
+}
+
+void TestOnlineLag() {
+  meili::MapMatcherFactory factory(config());
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(boost::property_tree::ptree()));
+  const auto measurements = trace(*matcher);
+  matcher->Clear();
+
+  // Every measurement becomes final exactly once and in order
+  const meili::StateId::Time lag = 3;
+  std::vector<meili::MatchResult> results;
+  for (size_t i = 0; i < measurements.size(); ++i) {
+    auto finalized = matcher->OnlineMatch({measurements[i]}, lag);
+    results.insert(results.end(), finalized.begin(), finalized.end());
+    test::assert_bool(results.size() + lag == std::max<size_t>(i + 1, lag),
+                      "Expected all but the last " + std::to_string(lag) + " measurements to be final");
+    test::assert_bool(matcher->OnlineWinner().epoch_time == measurements[i].epoch_time(),
+                      "Expected the winner at the latest measurement");
+
+    // The states of the final measurements are discarded
+    const auto& container = matcher->state_container();
+    for (size_t t = 0; t + 1 < results.size(); ++t) {
+      test::assert_bool(container.column(t).empty(), "Expected the final states to be discarded");
+    }
+  }
+  auto rest = matcher->OnlineMatch({}, 0);
+  results.insert(results.end(), rest.begin(), rest.end());
+  test::assert_bool(results.size() == measurements.size(), "Expected a result per measurement");
+  size_t matched = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    test::assert_bool(results[i].epoch_time == measurements[i].epoch_time(), "Expected the results in order");
+    matched += results[i].HasState();
+  }
+  test::assert_bool(matched == results.size(), "Expected every measurement along the road to match");
+  test::assert_bool(matcher->OnlineWinner().epoch_time == measurements.back().epoch_time(),
+                    "Expected the final winner to be the last result");
+}
+
+void TestSimplification() {
+  meili::MapMatcherFactory factory(config());
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(boost::property_tree::ptree()));
+  auto measurements = trace(*matcher);
+
+  // Stop for a minute in the middle of the trace wobbling about
+  const auto middle = measurements.size() / 2;
+  std::vector<meili::Measurement> stop;
+  for (size_t i = 1; i <= 20; ++i) {
+    const auto& at = measurements[middle].lnglat();
+    stop.emplace_back(midgard::PointLL(at.first + (i % 2) * 0.00002f, at.second), 5.f, 50.f,
+                      measurements[middle].epoch_time() + i * 3.);
+  }
+  for (auto m = measurements.begin() + middle + 1; m != measurements.end(); ++m) {
+    *m = meili::Measurement(m->lnglat(), 5.f, 50.f, m->epoch_time() + 60.);
+  }
+  measurements.insert(measurements.begin() + middle + 1, stop.begin(), stop.end());
+  const auto paths = matcher->OfflineMatch(measurements);
+  const auto columns = matcher->state_container().size();
+  test::assert_bool(columns == measurements.size(), "Expected every measurement to be matched");
+
+  boost::property_tree::ptree preferences;
+  preferences.put("simplification_tolerance", 10.f);
+  preferences.put("stop_speed", 1.f);
+  std::unique_ptr<meili::MapMatcher> simplified(factory.Create(preferences));
+  const auto simplified_paths = simplified->OfflineMatch(measurements);
+  test::assert_bool(simplified->state_container().size() < columns - stop.size(),
+                    "Expected the stop and the straight stretches to be left out");
+
+  // Every measurement still gets a result on the same edges
+  const auto& expected = paths.front().results;
+  const auto& results = simplified_paths.front().results;
+  test::assert_bool(results.size() == measurements.size(), "Expected a result per measurement");
+  for (size_t i = 0; i < results.size(); ++i) {
+    test::assert_bool(results[i].epoch_time == measurements[i].epoch_time(), "Expected the results in order");
+    test::assert_bool(results[i].edgeid.Is_Valid(), "Expected every measurement to be on a road");
+  }
+  std::unordered_set<uint64_t> edges;
+  for (const auto& segment : paths.front().segments) {
+    edges.insert(segment.edgeid.value);
+  }
+  for (const auto& segment : simplified_paths.front().segments) {
+    test::assert_bool(edges.count(segment.edgeid.value) > 0, "Expected the same path");
+  }
+}
+
+}
+
+int main() {
+  test::suite suite("map matcher");
+
+  suite.test(TEST_CASE(TestOnlineSameAsOffline));
+
+  suite.test(TEST_CASE(TestOnlineLag));
+
+  suite.test(TEST_CASE(TestSimplification));
+
+  return suite.tear_down();
+}
@@ -1,6 +1,8 @@
 #include "test.h"
 
+#include <chrono>
 #include <string>
+#include <thread>
 #include <vector>
 #include <iostream>
 
@@ -13,6 +15,8 @@
 #include "sif/dynamiccost.h"
 #include "loki/worker.h"
 #include "midgard/logging.h"
+#include "tyr/serializers.h"
+#include "proto/response.pb.h"
 
 using namespace valhalla::thor;
 using namespace valhalla::sif;
@@ -29,8 +33,8 @@ namespace {
   class SimpleCost final : public DynamicCost {
   public:
 
-    SimpleCost(const boost::property_tree::ptree& pt)
-        : DynamicCost (pt, TravelMode::kDrive){}
+    SimpleCost(const rapidjson::Value& config)
+        : DynamicCost (config, TravelMode::kDrive){}
 
     ~SimpleCost() {}
 
@@ -114,8 +118,8 @@ namespace {
 
   };
 
-  cost_ptr_t CreateSimpleCost (const boost::property_tree::ptree& pt) {
-    return std::make_shared<SimpleCost> (pt);
+  cost_ptr_t CreateSimpleCost (const rapidjson::Value& config) {
+    return std::make_shared<SimpleCost> (config);
   }
 
 
@@ -292,11 +296,9 @@ void test_matrix() {
   loki_worker.matrix (request);
   adjust_scores(request);
 
-  auto request_pt = json_to_pt (test_request);
-
   GraphReader reader (config.get_child("mjolnir"));
 
-  cost_ptr_t costing = CreateSimpleCost(request_pt);
+  cost_ptr_t costing = CreateSimpleCost(request.document);
 
   CostMatrix cost_matrix;
   std::vector<TimeDistance> results;
@@ -331,6 +333,197 @@ void test_matrix() {
 
 }
 
+void test_matrix_threads() {
+  loki_worker_t loki_worker (config);
+
+  valhalla::valhalla_request_t request;
+  request.parse(test_request, valhalla::odin::DirectionsOptions::sources_to_targets);
+  loki_worker.matrix (request);
+  adjust_scores(request);
+
+  // Repeat the locations so there are enough to spread across threads
+  auto sources = request.options.sources();
+  auto targets = request.options.targets();
+  for (int i = 0; i < 3; ++i) {
+    sources.MergeFrom(request.options.sources());
+    targets.MergeFrom(request.options.targets());
+  }
+
+  GraphReader reader (config.get_child("mjolnir"));
+  GraphReader reader1 (config.get_child("mjolnir"));
+  GraphReader reader2 (config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.document);
+
+  CostMatrix cost_matrix;
+  auto expected = cost_matrix.SourceToTarget(sources, targets, reader, &costing, TravelMode::kDrive, 400000.0);
+  CostMatrix threaded_matrix;
+  threaded_matrix.set_thread_readers({&reader1, &reader2});
+  auto results = threaded_matrix.SourceToTarget(sources, targets, reader, &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != expected.size())
+    throw std::runtime_error("Expected a result per source and target on threads");
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    if (results[i].dist != expected[i].dist || results[i].time != expected[i].time) {
+      throw std::runtime_error("result " + std::to_string(i) + " on threads is not the same as"
+          " on one thread. Expected: " + std::to_string(expected[i].time) + " Actual: " +
+          std::to_string(results[i].time));
+    }
+  }
+  // The repeated locations get the same results
+  for (uint32_t i = 0; i < 4; ++i) {
+    for (uint32_t j = 0; j < 4; ++j) {
+      if (results[i * targets.size() + j].time != cost_matrix_answers[i * 4 + j].time)
+        throw std::runtime_error("result " + std::to_string(i) + "," + std::to_string(j) +
+            " on threads is not the expected value");
+    }
+  }
+}
+
+void test_matrix_hierarchy_limits() {
+  loki_worker_t loki_worker (config);
+
+  valhalla::valhalla_request_t request;
+  request.parse(test_request, valhalla::odin::DirectionsOptions::sources_to_targets);
+  loki_worker.matrix (request);
+  adjust_scores(request);
+
+  GraphReader reader (config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.document);
+
+  // Stopping at the hierarchy limits still reaches every location, the
+  // locations are close enough to keep expanding all the way to them
+  TimeDistanceMatrix timedist_matrix;
+  timedist_matrix.set_hierarchy_limits(true);
+  auto results = timedist_matrix.SourceToTarget(request.options.sources(), request.options.targets(), reader, &costing, TravelMode::kDrive, 400000.0);
+  if (results.size() != timedist_matrix_answers.size())
+    throw std::runtime_error("Expected a result per source and target with hierarchy limits");
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    if (results[i].time != timedist_matrix_answers[i].time || results[i].dist != timedist_matrix_answers[i].dist) {
+      throw std::runtime_error("result " + std::to_string(i) + " with hierarchy limits is not the"
+          " expected value. Expected: " + std::to_string(timedist_matrix_answers[i].time) +
+          " Actual: " + std::to_string(results[i].time));
+    }
+  }
+}
+
+void test_matrix_interrupt() {
+  loki_worker_t loki_worker (config);
+
+  valhalla::valhalla_request_t request;
+  request.parse(test_request, valhalla::odin::DirectionsOptions::sources_to_targets);
+  loki_worker.matrix (request);
+  adjust_scores(request);
+
+  GraphReader reader (config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.document);
+
+  // Both matrices give up as soon as they check for an interrupt
+  const std::function<void ()> interrupt = []() { throw std::runtime_error("interrupted"); };
+  CostMatrix cost_matrix;
+  cost_matrix.set_interrupt(&interrupt);
+  try {
+    cost_matrix.SourceToTarget(request.options.sources(), request.options.targets(), reader, &costing, TravelMode::kDrive, 400000.0);
+    throw std::logic_error("Expected CostMatrix to be interrupted");
+  } catch (const std::runtime_error&) { }
+  TimeDistanceMatrix timedist_matrix;
+  timedist_matrix.set_interrupt(&interrupt);
+  try {
+    timedist_matrix.SourceToTarget(request.options.sources(), request.options.targets(), reader, &costing, TravelMode::kDrive, 400000.0);
+    throw std::logic_error("Expected TimeDistanceMatrix to be interrupted");
+  } catch (const std::runtime_error&) { }
+}
+
+void test_matrix_deadline() {
+  // A timeout turns into a deadline which comes along with the options
+  valhalla::valhalla_request_t request;
+  request.parse(R"({"timeout":1,"sources":[{"lat":52.106337,"lon":5.101728}],"targets":[{"lat":52.106337,"lon":5.101728}],"costing":"auto"})",
+                valhalla::odin::DirectionsOptions::sources_to_targets);
+  if (!request.options.has_deadline())
+    throw std::logic_error("Expected the timeout to set a deadline");
+  valhalla::valhalla_request_t forwarded;
+  forwarded.parse(R"({})", request.options.SerializeAsString());
+  if (forwarded.options.deadline() != request.options.deadline())
+    throw std::logic_error("Expected the deadline to be passed on to the next stage");
+
+  // A worker won't start on a request that has run out of time
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  loki_worker_t loki_worker (config);
+  const std::function<void ()> interrupt = []() { };
+  try {
+    loki_worker.set_interrupt(interrupt, forwarded.options.deadline());
+    throw std::logic_error("Expected the deadline to have passed");
+  } catch (const valhalla::valhalla_exception_t& e) {
+    if (e.code != 159)
+      throw std::logic_error("Expected a timeout error");
+  }
+}
+
+void test_matrix_pbf() {
+  loki_worker_t loki_worker (config);
+
+  valhalla::valhalla_request_t request;
+  request.parse(test_request, valhalla::odin::DirectionsOptions::sources_to_targets);
+  request.options.set_format(valhalla::odin::DirectionsOptions::pbf);
+  loki_worker.matrix (request);
+  adjust_scores(request);
+
+  GraphReader reader (config.get_child("mjolnir"));
+  cost_ptr_t costing = CreateSimpleCost(request.document);
+  CostMatrix cost_matrix;
+  auto results = cost_matrix.SourceToTarget(request.options.sources(), request.options.targets(), reader, &costing, TravelMode::kDrive, 400000.0);
+
+  // The binary matrix has the same times and distances packed in source major order
+  valhalla::Response response;
+  if (!response.ParseFromString(valhalla::tyr::serializeMatrix(request, results, 0.001)))
+    throw std::runtime_error("Expected the pbf matrix to parse");
+  const auto& matrix = response.matrix();
+  if (matrix.times_size() != results.size() || matrix.distances_size() != results.size() ||
+      matrix.sources_size() != request.options.sources_size() || matrix.targets_size() != request.options.targets_size())
+    throw std::runtime_error("Expected a time and distance for every source and target pair");
+  for (uint32_t i = 0; i < results.size(); ++i) {
+    if (matrix.times(i) != static_cast<int32_t>(results[i].time) ||
+        std::abs(matrix.distances(i) - results[i].dist * 0.001f) > 1e-3f)
+      throw std::runtime_error("result " + std::to_string(i) + " of the pbf matrix is not the same");
+  }
+
+  // Only some actions have a binary response
+  try {
+    valhalla::valhalla_request_t locate;
+    locate.parse(R"({"format":"pbf","locations":[{"lat":52.1,"lon":5.1}]})", valhalla::odin::DirectionsOptions::locate);
+    throw std::logic_error("Expected locate to refuse the pbf format");
+  }
+  catch(const valhalla::valhalla_exception_t& e) {
+    if (e.code != 143)
+      throw std::logic_error("Expected an unsupported format error");
+  }
+}
+
+void test_matrix_columnar() {
+  valhalla::valhalla_request_t request;
+  for (int i = 0; i < 2; ++i)
+    request.options.add_sources()->mutable_ll()->set_lat(52.1f);
+  for (int i = 0; i < 3; ++i)
+    request.options.add_targets()->mutable_ll()->set_lat(52.1f);
+  request.options.set_columnar(true);
+  std::vector<TimeDistance> results(6, TimeDistance(60, 1000));
+  results[4].time = kMaxCost;
+
+  // Flat arrays in source major order with null where no path was found
+  std::stringstream json(valhalla::tyr::serializeMatrix(request, results, 0.001));
+  boost::property_tree::ptree response;
+  boost::property_tree::read_json(json, response);
+  if (response.count("sources_to_targets"))
+    throw std::logic_error("Expected no object per pair");
+  std::vector<std::string> durations, distances;
+  for (const auto& duration : response.get_child("durations"))
+    durations.push_back(duration.second.data());
+  for (const auto& distance : response.get_child("distances"))
+    distances.push_back(distance.second.data());
+  if (durations.size() != 6 || distances.size() != 6)
+    throw std::logic_error("Expected a duration and distance for every pair");
+  if (durations[0] != "60" || distances[0] != "1.000" || durations[4] != "null" || distances[4] != "null")
+    throw std::logic_error("Expected the pairs in source major order");
+}
+
 void test_matrix_osrm() {
   loki_worker_t loki_worker (config);
 
@@ -339,11 +532,9 @@ void test_matrix_osrm() {
 
   loki_worker.matrix (request);
   adjust_scores(request);
-  auto request_pt = json_to_pt (test_request_osrm);
-
   GraphReader reader (config.get_child("mjolnir"));
 
-  cost_ptr_t costing = CreateSimpleCost(request_pt);
+  cost_ptr_t costing = CreateSimpleCost(request.document);
 
   CostMatrix cost_matrix;
   std::vector<TimeDistance> results;
@@ -384,6 +575,18 @@ int main(int argc, char* argv[]) {
   logging::Configure({{"type", ""}}); //silence logs
 
   suite.test(TEST_CASE(test_matrix));
+
+  suite.test(TEST_CASE(test_matrix_threads));
+
+  suite.test(TEST_CASE(test_matrix_hierarchy_limits));
+
+  suite.test(TEST_CASE(test_matrix_interrupt));
+
+  suite.test(TEST_CASE(test_matrix_deadline));
+
+  suite.test(TEST_CASE(test_matrix_pbf));
+
+  suite.test(TEST_CASE(test_matrix_columnar));
   //suite.test(TEST_CASE(test_matrix_osrm));
 
   return suite.tear_down();
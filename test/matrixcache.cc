@@ -0,0 +1,80 @@
+#include "test.h"
+
+#include <thread>
+#include "thor/matrixcache.h"
+
+using namespace valhalla;
+using namespace valhalla::thor;
+
+namespace {
+
+  odin::Location location(uint64_t edgeid, float percent_along,
+                          const std::string& date_time = "") {
+    odin::Location location;
+    auto* edge = location.add_path_edges();
+    edge->set_graph_id(edgeid);
+    edge->set_percent_along(percent_along);
+    if (!date_time.empty())
+      location.set_date_time(date_time);
+    return location;
+  }
+
+  void TestLocationKey() {
+    if (MatrixCache::LocationKey(location(1, 0.5f)) != MatrixCache::LocationKey(location(1, 0.5f)))
+      throw std::runtime_error("Locations on the same edge at the same place should share a key");
+    if (MatrixCache::LocationKey(location(1, 0.5f)) == MatrixCache::LocationKey(location(1, 0.6f)))
+      throw std::runtime_error("Locations elsewhere along the edge should have their own key");
+    if (MatrixCache::LocationKey(location(1, 0.5f, "2018-03-12T08:01")) !=
+        MatrixCache::LocationKey(location(1, 0.5f, "2018-03-12T08:14")))
+      throw std::runtime_error("Departures in the same quarter hour should share a key");
+    if (MatrixCache::LocationKey(location(1, 0.5f, "2018-03-12T08:14")) ==
+        MatrixCache::LocationKey(location(1, 0.5f, "2018-03-12T08:15")))
+      throw std::runtime_error("Departures in other quarter hours should have their own key");
+  }
+
+  void TestFindInsert() {
+    MatrixCache cache(2, 60);
+    TimeDistance td;
+    if (cache.Find(1, 2, 3, td))
+      throw std::runtime_error("An empty cache should have no cells");
+    cache.Insert(1, 2, 3, TimeDistance(10, 100));
+    if (!cache.Find(1, 2, 3, td) || td.time != 10 || td.dist != 100)
+      throw std::runtime_error("A kept cell should be found");
+    if (cache.Find(2, 1, 3, td) || cache.Find(1, 2, 4, td))
+      throw std::runtime_error("Cells of other locations or costings should not be found");
+
+    // Keeping one again makes it the newest so the other one goes first
+    cache.Insert(1, 3, 3, TimeDistance(20, 200));
+    cache.Insert(1, 2, 3, TimeDistance(11, 110));
+    cache.Insert(1, 4, 3, TimeDistance(30, 300));
+    if (cache.size() != 2 || cache.Find(1, 3, 3, td))
+      throw std::runtime_error("The oldest cell should be dropped when the cache is full");
+    if (!cache.Find(1, 2, 3, td) || td.time != 11)
+      throw std::runtime_error("A cell kept again should have its new time");
+
+    MatrixCache disabled(0, 60);
+    disabled.Insert(1, 2, 3, TimeDistance(10, 100));
+    if (disabled.enabled() || disabled.size() != 0)
+      throw std::runtime_error("A cache without room should keep nothing");
+  }
+
+  void TestExpire() {
+    MatrixCache cache(10, 0);
+    cache.Insert(1, 2, 3, TimeDistance(10, 100));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    TimeDistance td;
+    if (cache.Find(1, 2, 3, td) || cache.size() != 0)
+      throw std::runtime_error("Cells older than the maximum age should be dropped");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("matrixcache");
+
+  suite.test(TEST_CASE(TestLocationKey));
+  suite.test(TEST_CASE(TestFindInsert));
+  suite.test(TEST_CASE(TestExpire));
+
+  return suite.tear_down();
+}
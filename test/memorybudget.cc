@@ -0,0 +1,88 @@
+#include "test.h"
+
+#include "thor/memorybudget.h"
+#include "thor/labelarena.h"
+#include "thor/edgestatus.h"
+#include "sif/edgelabel.h"
+#include "baldr/graphid.h"
+
+using namespace std;
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+using namespace valhalla::thor;
+
+namespace {
+
+void TestBudget() {
+  // Without a scope nothing is limited
+  Labels<EdgeLabel> labels;
+  labels.reserve(10000);
+  labels = Labels<EdgeLabel>();
+
+  // Within one, growing past the budget throws and leaves the labels as they were
+  {
+    MemoryBudget::Scope scope(1000 * sizeof(EdgeLabel));
+    labels.resize(500);
+    try {
+      labels.reserve(2000);
+      throw runtime_error("Growing past the budget should have thrown");
+    }
+    catch(const valhalla_exception_t& e) {
+      if (e.code != 451)
+        throw runtime_error("Wrong error for an exceeded budget");
+    }
+    if (labels.size() != 500 || labels.capacity() >= 2000)
+      throw runtime_error("Labels should be untouched when the budget is exceeded");
+    if (scope.peak() < 500 * sizeof(EdgeLabel))
+      throw runtime_error("Peak should count the labels held");
+
+    // Freeing makes room again
+    labels = Labels<EdgeLabel>();
+    labels.reserve(900);
+  }
+
+  // And the limit goes away with the scope
+  labels.reserve(5000);
+}
+
+void TestArena() {
+  // Storage an arena already held is not counted against the next request
+  LabelArena arena;
+  auto labels = arena.Acquire<EdgeLabel, BudgetAllocator<EdgeLabel> >(2000);
+  arena.Release(labels);
+  MemoryBudget::Scope scope(100 * sizeof(EdgeLabel));
+  ReserveLabels(&arena, labels, 1500);
+  if (labels.capacity() < 1500)
+    throw runtime_error("Arena storage should be reused within the budget");
+  ReleaseLabels(&arena, labels);
+}
+
+void TestEdgeStatus() {
+  // Edge statuses count too
+  MemoryBudget::Scope scope(1024);
+  EdgeStatus status;
+  status.Set(GraphId(10, 2, 10), EdgeSet::kTemporary, 0);
+  try {
+    status.Set(GraphId(10, 2, 100000), EdgeSet::kTemporary, 1);
+    throw runtime_error("Edge statuses past the budget should have thrown");
+  }
+  catch(const valhalla_exception_t& e) {
+    if (e.code != 451)
+      throw runtime_error("Wrong error for an exceeded budget");
+  }
+}
+
+}
+
+int main() {
+  test::suite suite("memorybudget");
+
+  suite.test(TEST_CASE(TestBudget));
+
+  suite.test(TEST_CASE(TestArena));
+
+  suite.test(TEST_CASE(TestEdgeStatus));
+
+  return suite.tear_down();
+}
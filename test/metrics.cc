@@ -0,0 +1,64 @@
+#include "test.h"
+#include "midgard/metrics.h"
+
+#include <thread>
+#include <vector>
+#include <string>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+void ThreadedMetricsTest() {
+  //record from a handful of threads, some of which are gone before we scrape
+  std::vector<std::thread> threads;
+  for(size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([](){
+      for(size_t j = 0; j < 100; ++j) {
+        metrics::Add(metrics::Counter::kTileCacheHits);
+        metrics::Add(metrics::Counter::kEdgesLabelled, 3);
+        metrics::Observe(metrics::Timer::kThorPath, j % 2 ? .25 : 20.);
+      }
+    });
+  }
+  for(auto& thread : threads)
+    thread.join();
+  {
+    METRICS_TIME(kOdinDirections);
+  }
+  metrics::Set(metrics::Gauge::kResponseCacheSize, 7);
+  METRICS_SET(kResponseCacheSize, 5);
+
+  auto text = metrics::ToPrometheus();
+  auto has = [&text](const std::string& line) {
+    if(text.find(line + "\n") == std::string::npos)
+      throw std::runtime_error("Expected to find: " + line + "\nin:\n" + text);
+  };
+  has("# TYPE valhalla_tile_cache_hits_total counter");
+  has("valhalla_tile_cache_hits_total 400");
+  has("valhalla_tile_cache_misses_total 0");
+  has("valhalla_edges_labelled_total 1200");
+  has("# TYPE valhalla_thor_path_milliseconds histogram");
+  has("valhalla_thor_path_milliseconds_bucket{le=\"0.5\"} 200");
+  has("valhalla_thor_path_milliseconds_bucket{le=\"10\"} 200");
+  has("valhalla_thor_path_milliseconds_bucket{le=\"25\"} 400");
+  has("valhalla_thor_path_milliseconds_bucket{le=\"+Inf\"} 400");
+  has("valhalla_thor_path_milliseconds_sum 4050");
+  has("valhalla_thor_path_milliseconds_count 400");
+  has("valhalla_odin_directions_milliseconds_count 1");
+  has("valhalla_loki_search_milliseconds_count 0");
+  has("# TYPE valhalla_response_cache_size gauge");
+  has("valhalla_response_cache_size 5");
+  has("valhalla_requests_in_flight 0");
+}
+
+}
+
+int main() {
+  test::suite suite("metrics");
+
+  //check counting and aggregation across threads
+  suite.test(TEST_CASE(ThreadedMetricsTest));
+
+  return suite.tear_down();
+}
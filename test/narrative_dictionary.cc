@@ -1447,6 +1447,39 @@ void test_en_US_verbal_multi_cue() {
   validate(phrase_0, "<CURRENT_VERBAL_CUE> Then <NEXT_VERBAL_CUE>");
 }
 
+void test_phrase_template() {
+  const NarrativeDictionary& dictionary = GetNarrativeDictionary("en-US");
+
+  // Templates are compiled from each phrase
+  const auto& phrase_template = dictionary.start_subset.templates.at("2");
+  validate(phrase_template.phrase(),
+           "Head <CARDINAL_DIRECTION> on <BEGIN_STREET_NAMES>. Continue on <STREET_NAMES>.");
+
+  // Tags are replaced with their values in one pass
+  std::string north = "north";
+  std::string begin_street_names = "Main Street";
+  std::string street_names = "Broadway";
+  std::string instruction;
+  phrase_template.Render(
+      PhraseValues()
+          .Set(PhraseTag::kCardinalDirection, north)
+          .Set(PhraseTag::kBeginStreetNames, begin_street_names)
+          .Set(PhraseTag::kStreetNames, street_names),
+      instruction);
+  validate(instruction, "Head north on Main Street. Continue on Broadway.");
+
+  // Tags without values and unknown tags are kept
+  instruction.clear();
+  PhraseTemplate("<STREET_NAMES> <NOT_A_TAG> <CARDINAL_DIRECTION>").Render(
+      PhraseValues().Set(PhraseTag::kStreetNames, street_names), instruction);
+  validate(instruction, "Broadway <NOT_A_TAG> <CARDINAL_DIRECTION>");
+
+  // Values are appended to what is already in the instruction
+  PhraseTemplate(" then <STREET_NAMES>").Render(
+      PhraseValues().Set(PhraseTag::kStreetNames, street_names), instruction);
+  validate(instruction, "Broadway <NOT_A_TAG> <CARDINAL_DIRECTION> then Broadway");
+}
+
 }
 
 int main() {
@@ -1629,5 +1662,8 @@ int main() {
   // test the en-US verbal_multi_cue phrases
   suite.test(TEST_CASE(test_en_US_verbal_multi_cue));
 
+  // test rendering the compiled phrase templates
+  suite.test(TEST_CASE(test_phrase_template));
+
   return suite.tear_down();
 }
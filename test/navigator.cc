@@ -210,6 +210,16 @@ class NavigatorTest : public Navigator {
     return route_state_;
   }
 
+  void SetShape(const std::vector<midgard::PointLL>& shape, size_t current_shape_index) {
+    Navigator::shape_ = shape;
+    Navigator::current_shape_index_ = current_shape_index;
+    Navigator::InitializeShapeCells();
+  }
+
+  std::tuple<midgard::PointLL, float, int> FindClosestPoint(const midgard::PointLL& fix_pt) const {
+    return Navigator::FindClosestPoint(fix_pt);
+  }
+
 };
 
 void TryTopLevelSetRoute(const std::string& route_json_str,
@@ -49680,6 +49690,41 @@ void TestIsTimeWithinBounds() {
   TryIsTimeWithinBounds(nav.IsTimeWithinBounds(20, 2, 6), false);
 }
 
+void TryFindClosestPoint(const NavigatorTest& nav, const std::vector<midgard::PointLL>& shape,
+    size_t current_shape_index, const midgard::PointLL& fix_pt) {
+  auto found = nav.FindClosestPoint(fix_pt);
+  auto expected = fix_pt.ClosestPoint(shape, current_shape_index);
+  bool expected_on_route = (std::get<kClosestPointDistance>(expected) <= kOffRouteThreshold);
+  bool found_on_route = (std::get<kClosestPointDistance>(found) <= kOffRouteThreshold);
+  if (found_on_route != expected_on_route)
+    throw std::runtime_error("Incorrect FindClosestPoint on route - found: " + std::string(found_on_route ? "true" : "false") + " | expected: " + std::string(expected_on_route ? "true" : "false"));
+  if (expected_on_route && std::get<kClosestPointSegmentIndex>(found) != std::get<kClosestPointSegmentIndex>(expected))
+    throw std::runtime_error("Incorrect FindClosestPoint segment index - found: " + std::to_string(std::get<kClosestPointSegmentIndex>(found)) + " | expected: " + std::to_string(std::get<kClosestPointSegmentIndex>(expected)));
+}
+
+void TestFindClosestPoint() {
+  // A zig zag shape about 300 km long, well past the snap window
+  std::vector<midgard::PointLL> shape;
+  for (int i = 0; i < 3000; ++i)
+    shape.emplace_back(-76.0f + i * 0.001f, 40.0f + ((i % 2) ? 0.0005f : 0.0f));
+  for (int i = 0; i < 3000; ++i)
+    shape.emplace_back(-73.0f, 40.0f + i * 0.001f);
+
+  NavigatorTest nav;
+  nav.SetShape(shape, 0);
+
+  // Near the current index, far along the route and off the route
+  TryFindClosestPoint(nav, shape, 0, {-75.99995f, 40.0001f});
+  TryFindClosestPoint(nav, shape, 0, {-74.5f, 40.0002f});
+  TryFindClosestPoint(nav, shape, 0, {-73.0001f, 42.5f});
+  TryFindClosestPoint(nav, shape, 0, {-74.5f, 40.01f});
+
+  // Shape before the current index is not snapped to
+  nav.SetShape(shape, 4000);
+  TryFindClosestPoint(nav, shape, 4000, {-74.5f, 40.0002f});
+  TryFindClosestPoint(nav, shape, 4000, {-73.0001f, 42.5f});
+}
+
 void CreateTestSeed() {
   std::string route_json_str = R"({"trip":{"language":"en-US","summary":{"max_lon":-75.985947,"max_lat":39.746597,"time":6389,"length":27.065,"min_lat":39.625179,"min_lon":-76.122726},"locations":[{"lon":-76.122696,"lat":39.651386,"type":"break"},{"lon":-76.120949,"lat":39.640343,"type":"break"}],"units":"miles","legs":[{"shape":"accsjAledepCuKgDsJcF{KgEgc@oR{KuE_O_I}EiCqV}JmKcF{JwDgNgDiSqGsd@yLqWqHsAm@eEkAcB]wHiCcGyByB{@uYeP}@m@}EiCsFwCoHuDkG{BqGiB}JiB}NiCqC]ms@oIkFm@gJ}@mYeD{KkBwH{AiNeEwR_Iwc@aRqa@gOuT_IwS}JcQ{JcFwDkVwNaHgD}EkA{FiBqLiCsKgCgIkBwIm@sj@{@yGOkGm@}DM{Fm@iHkAwH{AqGkBqMeEwIuD_D{AuOaHiLcFmKeF_D{Am@]qQoImKcFaW{K}@m@kKuEkV{KmD{AmA{@{JuE_JeEqMeFwXyL{EiBiMsF_IgDsGyC{EiBmKuEwMqGyB}@e@]qCiBuDgDwCwDgDeEaDqGqAgEsAsFkBoSiCag@oCmi@cAcP{As[_D}}@yCq{@{K_yCuDecAsKelCoIamCqBen@cBgc@cA}^]yM?{K~BgNxCsQTgD\\cFNuE]{KsGey@gDaf@cAePyG{sA}Em~@m@mIoH{tAcAcPiCee@}@qRyLqcC]mI}@gn@cAk`@aC}^}Dq{@aC{i@aCil@u@aSyBco@kAoTMwCOuEGuDm@sQMmJWqHkAmi@]uOGgC_DogAcBwm@iBso@]iL{Awc@sGqdBqBse@{@sPyBikAmFy_ByAc[}@aR{@eO}@aSU}I}@{UiBag@uEm~@iBk`@sAiWeFazA{@e[gEyk@iB_^{A_]m@oSyB__@aCse@aBaf@}Dyl@sBed@cAwMwCmTwDiNcFmJ{LkUkFoIiBuEkBsFaBqHyBgN{A}SwCmi@_@aHiBya@sAil@sAq\\sAkVgDqq@oCso@m@kKaC}i@cBud@aBsd@OeFsAwXyBed@{@eP{A_SmE_h@_DuZe@uDcBsPsAsQUeE_Dm@aC]eAOsAOkA{@aCyBsEwDgDgCgJsG{PiMgCkAcLoIyBkA{FgCeEyBgNcGqMsF}n@{UaMeFyLcFqMeFkKgDyLaG}PaHsKwDiGkAeF]sFz@yGjBkKdEsFhBab@dPkQpGk[xMgCz@ab@vNib@fNuJfDgh@rPcFzAkGjAmEl@kF\\{EM{GkAyGm@wMeEwXmKiXiL_X{LiXyL}XiM}OaHmU{JkKuEmE{AqB}@|Daf@pCwb@tDah@jA_SxBkVjB_ShBuOjAoIdFmUz@wCfDmJvC_I~IaSzEkKlKaSpRm^`R_^hHiM`ByB|EaH|JiLeAaHs@uF}@{KyBq\\cAsPmA_SoCm_@}@}Jk@oIGwCOuE]mJNiLDyBN_Jd@gNl@gY\\_It@qQbAq]t@a\\l@_^zAib@j@kUFwN?cFU{Lu@{KaBo]gEk_AyBse@yGscBG{AeOkpDiB_h@WcQkAcPcAsQsA}IgDuOqC_JmDaHmAyBiG{KiCgDgCeEaCcFcBuEqBsGsAqGu@sF}I_s@kBsPcA_I{AkLaB{KiR_fAaNsp@{E{U}@gDqBuEsAiCsAiBiCiCkKmJkVoRiHeFgDyBs_@wNkKgDaDM}N?uJl@k`@hBc`@?u_@?c`@?yC]sEkBmKaH_ImImEuFoDsEqBwD_D_IyBqGoDiM}DgNwCmKkBqGyBsFqByC}EsE{FsFgIaHuJsG{ZqQg]aSaXeOqWyMuEyB{~@qQ_{AkV_rA_T_^sFif@{KyC{@yBm@qB]uE?{Jj@{`@xC{`@fCy`@xBe`@xBqa@jBc`@hBuT|@eFl@qGOkKl@ud@hCiq@dE}n@fDyp@fDso@fDaSxBw\\xA}Ol@kiBnI}}@bGm^fCouBzLmJl@_lArFqpA`GwDNw\\hB{L|@}`CdOqp@vDwqA`HsqCtOcdAbF{zDnT}YjAm_@\\}Dl@eFhBo]`S_YoIuJyBwC]qG?}J\\_c@dEmENyHO{P{AaMyAwg@_JmPeEwX_I}ScGiw@sQyQwCqGOqCN_DjAmEhCoeBdwAkAzA_@\\qBzAgDjA}Dl@yBMiBm@_YyMueD_fB}YsPqRiMo|@un@p_BmmEdUwm@nm@g`BnN}_@bp@{hBpk@eaBfw@eaCfD{KvDkLlD_IfIuOzVya@jyAkgCbVwb@flAwuBnIgNdi@ux@rAkBrj@y_AhGwNnNuc@b`@oqA|EsQlEaR~CmTbBiM~Hl@fNOtjDkLzJMdFL`C^|DhBhCxBnDtE~CrFz_@fx@pC`HlEfN~BzJnJre@v\\nfB~CdO`Ifc@~M`q@jFzUxCnIpBdE`G|JtOlUlKpQlElKhH`RrAhBxBjBfDhBdE?xdAcGvYkA~H]tD]`I_@|D?piByKdj@kBh\\kArUiBnYmAjj@gCveBoIbGOhk@iBn}@iCl`CaHxRm@r_@iB|wAwCxHOrnAgDpB?fhDmJnIO`HMr`@}@rV{@`MLhMl@x\\hClm@tD~N|@vb@hBzVjA|^zBdZz@bP]dFkBxGm@pGMfx@kBx{@uDv{@eFb{@eEtm@kAh|@uEh{@uDjy@yCvw@oHbk@wDzAdFxB~HpGxVlKvc@hL`g@rL|h@pLnh@nIz`@hBm@jB?tTkAje@}@be@Ode@k@dd@?ld@z@rd@hCxkA\\zd@?dd@l@dd@?zL}@vC{@zAm@nDiCdEeEbe@yk@jLwNrPcQrPuO~SuOre@y`@fSwOjL{KtDsEdF{K~Rse@|JiXxBcFnDqGtTya@~b@uy@`b@ey@`eA_pBhb@gw@jQa]zOc[tJsPpRiWzKiMdKkLrK{J`BmAxHmItDeFbB|@~WrPnJbGtDvCbBhBjA|@l@z@rAxBjAfEzA~HxBhM`Hfc@nHbe@rGvb@`B~HzAtEbAxBjAhC~S|^|JrQtEzJ|DnIvCpHdFxLbLtYnN|_@bKb[xB`H`CfNtJzj@zFdZfDhMpGpQzK|_@bGbZlJre@fNpq@pLxl@|E~RpMxa@x[xjAbLha@vXp{@vNtd@vb@huAtTjt@tT`r@xGjU`IzUbo@xtBzQtn@fNbe@dExLz@hCzGrPfHbQbf@xkAxVvl@jLfXtY~r@|Ylt@tZzs@fDrGnIdZt^fsCpGli@t@nI~ClJ|EvNb`@|gA|EbQxBzL`CtOvC|TpBrP~Hdn@`XvjBdEtZnCpQrGde@~C~RrFzV~CxLhHrQjK`Q`MbQrKhM|T`RjL~IlTfNdZnSbLpGhHbGzKjLlZl_@jUp\\tZng@jZz_@|_DrvDlP`R`a@li@l~@huAb[dd@z[tc@tOlUlE`HzKpRiXbe@_IhMaMxLyGdF}J`HwMnIcRzKgIrF_I`GkFrFgDvDoDrFwCrFwDxLoHfYeKvb@gI`]}Nvl@q]ztAmJ|]cQbp@_Nbf@wClJdJrPjPdZfOjV|I`RvX~g@fItOjGxMfSha@pHfO\\j@pBfEjFlJpHdOvC`Hd@xB?hC?vCvDjAbGpHnNnS|TtYvRjVvSvXnSfYjp@n{@|s@haAllAj~A`MrPlZz`@p\\fb@rVp\\|IjLpHlJpQ|ThHnIxCvChLlKrLtO~\\vb@zPlT`CfDfDdE`ChCbVfYdZ|^fIzK`RhWpHhLvWz`@bLnSpMlTxBvD`Wpf@~NdZbAhCpH`RbFhMjLfXfIdPpVli@`NvXlOb[bVpg@j[tm@z[fn@bUvb@dUx`@|EzKLtO{EtZyGp\\bKdElKrFvRfNpRhNvChBnI`H`RrPvNrPzF`IfNnSnaAvuA~Xfc@ba@xl@~|D`~Fl_@jk@n]ng@|OnTdx@fkArVn^jQxWzAxBtJfNdO|Tjj@bz@~IfNvHzKpCdEhWj`@bFpHdP|TpBfCjF`HiG`Ia]pQ}IbGcMpGiVpGmF|@{PjAgIN}h@rFia@dEiCl@wCzAoTfNgDvC}IlJyMfNmEtEaH`HmEdFeJ~HuDfD}ExBmEhBoD|@yWdE_NhBuJjAsPxBqRhCoNjAgI\\sUlAgOm@uI_@yB]sA]eA}@_C`eBm@`q@mA`|@{@vb@e@vb@OlTGtEEbQWtPe@tYUhLe@zLm@xL{AbQyBxLiCxL{EdPqHzU{AdEaBbGsAtEcB~H}I~g@w]lqB{Kfm@gIrf@wTjhAqQddAyHpf@gCrP}O`|@mEp\\gIl^sFxWgDfOwChL{G~]eD`R}Jbf@qB|IyB`IiC`H}ExKoMhXuE|JeFzJ}D|JwClJ{ArFcA`HcBbGkA`He@bFkA~I_@`H]~Hm@pHu@|I_Dz`@mDj_@_DhXuE~S}EzUqGvXmOhl@u@fCqHr[oSh`AeJp\\oDzKwHnT_@jA{Jb[","summary":{"max_lon":-75.985947,"max_lat":39.746597,"time":6389,"length":27.065,"min_lat":39.625179,"min_lon":-76.122726},"maneuvers":[{"travel_mode":"bicycle","begin_shape_index":0,"length":3.602,"time":906,"type":1,"end_shape_index":157,"instruction":"Bike north on Liberty Grove Road.","verbal_pre_transition_instruction":"Bike north on Liberty Grove Road for 3.6 miles.","travel_type":"road","street_names":["Liberty Grove Road"]},{"travel_type":"road","verbal_pre_transition_instruction":"Continue on Barnes Corner Road for 1.4 miles.","verbal_transition_alert_instruction":"Continue on Barnes Corner Road.","length":1.399,"instruction":"Continue on Barnes Corner Road.","end_shape_index":213,"type":8,"time":341,"street_names":["Barnes Corner Road"],"begin_shape_index":157,"travel_mode":"bicycle"},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn left onto Montgomery Road.","verbal_transition_alert_instruction":"Turn left onto Montgomery Road.","length":0.941,"instruction":"Turn left onto Montgomery Road.","end_shape_index":270,"type":15,"time":228,"verbal_post_transition_instruction":"Continue for 9 tenths of a mile.","street_names":["Montgomery Road"],"begin_shape_index":213},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn right onto Biggs Highway, Maryland 2 74.","verbal_transition_alert_instruction":"Turn right onto Biggs Highway.","length":0.399,"instruction":"Turn right onto Biggs Highway\/MD 274.","end_shape_index":291,"type":10,"time":94,"verbal_post_transition_instruction":"Continue for 4 tenths of a mile.","street_names":["Biggs Highway","MD 274"],"begin_shape_index":270},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn left onto Wilson Road.","verbal_transition_alert_instruction":"Turn left onto Wilson Road.","length":3.444,"instruction":"Turn left onto Wilson Road.","end_shape_index":430,"type":15,"time":793,"verbal_post_transition_instruction":"Continue for 3.4 miles.","street_names":["Wilson Road"],"begin_shape_index":291},{"travel_type":"road","verbal_pre_transition_instruction":"Continue on Stoney Lane for 1.8 miles.","verbal_transition_alert_instruction":"Continue on Stoney Lane.","length":1.798,"instruction":"Continue on Stoney Lane.","end_shape_index":474,"type":8,"time":459,"street_names":["Stoney Lane"],"begin_shape_index":430,"travel_mode":"bicycle"},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn right onto East Christine Road, Pennsylvania 2 72.","verbal_transition_alert_instruction":"Turn right onto East Christine Road.","length":1.492,"instruction":"Turn right onto East Christine Road\/PA 272.","end_shape_index":500,"type":10,"time":334,"verbal_post_transition_instruction":"Continue for 1.5 miles.","street_names":["East Christine Road","PA 272"],"begin_shape_index":474},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn right onto McCoury Road.","verbal_transition_alert_instruction":"Turn right onto McCoury Road.","length":1.142,"instruction":"Turn right onto McCoury Road.","end_shape_index":542,"type":10,"time":229,"verbal_post_transition_instruction":"Continue for 1.1 miles.","street_names":["McCoury Road"],"begin_shape_index":500},{"travel_type":"road","verbal_pre_transition_instruction":"Continue on Chandlee Road for 1.3 miles.","verbal_transition_alert_instruction":"Continue on Chandlee Road.","length":1.250,"instruction":"Continue on Chandlee Road.","end_shape_index":569,"type":8,"time":297,"street_names":["Chandlee Road"],"begin_shape_index":542,"travel_mode":"bicycle"},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Bear left onto Thankless Lane.","verbal_transition_alert_instruction":"Bear left onto Thankless Lane.","length":0.657,"instruction":"Bear left onto Thankless Lane.","end_shape_index":582,"type":16,"time":163,"verbal_post_transition_instruction":"Continue for 7 tenths of a mile.","street_names":["Thankless Lane"],"begin_shape_index":569},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn right onto Calvert Road.","verbal_transition_alert_instruction":"Turn right onto Calvert Road.","length":0.218,"instruction":"Turn right onto Calvert Road.","end_shape_index":590,"type":10,"time":52,"verbal_post_transition_instruction":"Continue for 2 tenths of a mile.","street_names":["Calvert Road"],"begin_shape_index":582},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn left onto England Creamery Road.","verbal_transition_alert_instruction":"Turn left onto England Creamery Road.","length":1.430,"instruction":"Turn left onto England Creamery Road.","end_shape_index":637,"type":15,"time":335,"verbal_post_transition_instruction":"Continue for 1.4 miles.","street_names":["England Creamery Road"],"begin_shape_index":590},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn right onto Crothers Road.","verbal_transition_alert_instruction":"Turn right onto Crothers Road.","length":1.767,"instruction":"Turn right onto Crothers Road.","end_shape_index":700,"type":10,"time":424,"verbal_post_transition_instruction":"Continue for 1.8 miles.","street_names":["Crothers Road"],"begin_shape_index":637},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Bear right onto Principio Road.","verbal_transition_alert_instruction":"Bear right onto Principio Road.","length":1.612,"instruction":"Bear right onto Principio Road.","end_shape_index":744,"type":9,"time":338,"verbal_post_transition_instruction":"Continue for 1.6 miles.","street_names":["Principio Road"],"begin_shape_index":700},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn right onto Red Toad Road.","verbal_transition_alert_instruction":"Turn right onto Red Toad Road.","length":0.556,"instruction":"Turn right onto Red Toad Road.","end_shape_index":767,"type":10,"time":154,"verbal_post_transition_instruction":"Continue for 6 tenths of a mile.","street_names":["Red Toad Road"],"begin_shape_index":744},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn left onto Post Road.","verbal_transition_alert_instruction":"Turn left onto Post Road.","length":0.289,"instruction":"Turn left onto Post Road.","end_shape_index":784,"type":15,"time":90,"verbal_post_transition_instruction":"Continue for 3 tenths of a mile.","street_names":["Post Road"],"begin_shape_index":767},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn left onto Hopewell Road.","verbal_transition_alert_instruction":"Turn left onto Hopewell Road.","length":1.587,"instruction":"Turn left onto Hopewell Road.","end_shape_index":838,"type":15,"time":386,"verbal_post_transition_instruction":"Continue for 1.6 miles.","street_names":["Hopewell Road"],"begin_shape_index":784},{"travel_type":"road","travel_mode":"bicycle","end_shape_index":870,"verbal_pre_transition_instruction":"Turn left onto Jacob Tome Highway, Maryland 2 76.","begin_street_names":["Jacob Tome Highway","MD 276","MD 222 Truck"],"verbal_transition_alert_instruction":"Turn left onto Jacob Tome Highway.","length":1.226,"instruction":"Turn left onto Jacob Tome Highway\/MD 276\/MD 222 Truck. Continue on Jacob Tome Highway\/MD 276.","type":15,"time":290,"verbal_post_transition_instruction":"Continue on Jacob Tome Highway, Maryland 2 76 for 1.2 miles.","street_names":["Jacob Tome Highway","MD 276"],"begin_shape_index":838},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn right onto Waibel Road.","verbal_transition_alert_instruction":"Turn right onto Waibel Road.","length":0.583,"instruction":"Turn right onto Waibel Road.","end_shape_index":907,"type":10,"time":121,"verbal_post_transition_instruction":"Continue for 6 tenths of a mile.","street_names":["Waibel Road"],"begin_shape_index":870},{"travel_type":"road","travel_mode":"bicycle","verbal_pre_transition_instruction":"Turn left onto Doctor Jack Road.","verbal_transition_alert_instruction":"Turn left onto Doctor Jack Road.","length":1.674,"instruction":"Turn left onto Doctor Jack Road.","end_shape_index":980,"type":15,"time":355,"verbal_post_transition_instruction":"Continue for 1.7 miles.","street_names":["Doctor Jack Road"],"begin_shape_index":907},{"travel_type":"road","travel_mode":"bicycle","begin_shape_index":980,"time":0,"type":4,"end_shape_index":980,"instruction":"You have arrived at your destination.","length":0.000,"verbal_transition_alert_instruction":"You will arrive at your destination.","verbal_pre_transition_instruction":"You have arrived at your destination."}]}],"status_message":"Found route between points","status":0}})";
   NavigatorTest nav;
@@ -55906,6 +55951,9 @@ int main() {
   // TestIsTimeWithinBounds
   suite.test(TEST_CASE(TestIsTimeWithinBounds));
 
+  // TestFindClosestPoint
+  suite.test(TEST_CASE(TestFindClosestPoint));
+
   // CreateTestSeed
   //suite.test(TEST_CASE(CreateTestSeed));
 
@@ -0,0 +1,99 @@
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+#include "proto/route.pb.h"
+#include "proto/navigator.pb.h"
+#include "midgard/encoded.h"
+#include "midgard/pointll.h"
+#include "tyr/navigator_sessions.h"
+
+using namespace valhalla;
+using namespace valhalla::midgard;
+using namespace valhalla::tyr;
+
+namespace {
+
+// A one leg route that heads east for about 850 meters
+Route GetRoute() {
+  Route route;
+  auto* trip = route.mutable_trip();
+  trip->set_units("kilometers");
+  auto* leg = trip->add_legs();
+  leg->set_shape(encode(std::vector<PointLL>{{-76.30f, 40.04f}, {-76.29f, 40.04f}}));
+  auto* start = leg->add_maneuvers();
+  start->set_type(1);
+  start->set_length(0.852f);
+  start->set_time(60);
+  start->set_begin_shape_index(0);
+  start->set_end_shape_index(1);
+  auto* destination = leg->add_maneuvers();
+  destination->set_type(4);
+  destination->set_begin_shape_index(1);
+  destination->set_end_shape_index(1);
+  return route;
+}
+
+FixLocation GetFixLocation(float lon, float lat, uint64_t time) {
+  FixLocation fix_location;
+  fix_location.set_lon(lon);
+  fix_location.set_lat(lat);
+  fix_location.set_time(time);
+  return fix_location;
+}
+
+void TestSessions() {
+  NavigatorSessions sessions(4);
+  if (sessions.Start("a", GetRoute()).route_state() != NavigationStatus_RouteState_kInitialized)
+    throw std::runtime_error("Starting a session should initialize its route");
+  sessions.Start("b", GetRoute());
+  sessions.Start("b", GetRoute());
+  if (sessions.size() != 2)
+    throw std::runtime_error("Expected 2 sessions but got " + std::to_string(sessions.size()));
+
+  if (sessions.OnLocationChanged("c", GetFixLocation(-76.30f, 40.04f, 1)).route_state()
+      != NavigationStatus_RouteState_kInvalid)
+    throw std::runtime_error("A vehicle without a session should have an invalid route state");
+  if (sessions.OnLocationChanged("a", GetFixLocation(-76.30f, 40.04f, 1)).route_state()
+      == NavigationStatus_RouteState_kInvalid)
+    throw std::runtime_error("A fix on the route should be tracked");
+
+  if (!sessions.End("a") || sessions.End("a") || sessions.size() != 1)
+    throw std::runtime_error("Ending a session should remove it once");
+}
+
+void TestBatch() {
+  NavigatorSessions sessions(4);
+  sessions.Start("a", GetRoute());
+  sessions.Start("b", GetRoute());
+
+  std::vector<VehicleFix> fixes{
+    {"a", GetFixLocation(-76.30f, 40.04f, 1)},
+    {"c", GetFixLocation(-76.30f, 40.04f, 1)},
+    {"b", GetFixLocation(-76.30f, 41.00f, 1)},
+    {"a", GetFixLocation(-76.295f, 40.04f, 30)}
+  };
+  auto statuses = sessions.OnLocationChanged(fixes);
+  if (statuses.size() != fixes.size())
+    throw std::runtime_error("Expected a navigation status for each fix");
+  if (statuses[1].route_state() != NavigationStatus_RouteState_kInvalid ||
+      statuses[2].route_state() != NavigationStatus_RouteState_kInvalid)
+    throw std::runtime_error("Unknown vehicles and fixes off the route should be invalid");
+  if (statuses[0].route_state() == NavigationStatus_RouteState_kInvalid ||
+      statuses[3].route_state() == NavigationStatus_RouteState_kInvalid)
+    throw std::runtime_error("Fixes on the route should be tracked");
+  if (statuses[3].remaining_leg_length() >= statuses[0].remaining_leg_length())
+    throw std::runtime_error("Fixes of a vehicle should be processed in order");
+}
+
+}
+
+int main() {
+  test::suite suite("navigator_sessions");
+
+  suite.test(TEST_CASE(TestSessions));
+  suite.test(TEST_CASE(TestBatch));
+
+  return suite.tear_down();
+}
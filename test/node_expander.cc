@@ -0,0 +1,109 @@
+#include "test.h"
+
+#include "mjolnir/node_expander.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+const std::string nodes_file = "test_node_expander_nodes.bin";
+const std::string edges_file = "test_node_expander_edges.bin";
+
+Node make_node(const uint64_t osmid, const uint32_t start_of, const uint32_t end_of) {
+  Node node{};
+  node.node.osmid = osmid;
+  node.start_of = start_of;
+  node.end_of = end_of;
+  return node;
+}
+
+Edge make_edge(const uint32_t llindex, const uint32_t source, const uint32_t target,
+               const uint32_t importance, const bool link) {
+  Edge edge{0, llindex};
+  edge.attributes.importance = importance;
+  edge.attributes.driveableforward = true;
+  edge.attributes.driveablereverse = true;
+  edge.attributes.link = link;
+  edge.sourcenode_ = source;
+  edge.targetnode_ = target;
+  return edge;
+}
+
+// A little graph: every osm node has a node per edge it starts or ends,
+// node 3 starts and ends a loop and every third node has a link
+void write_graph(const uint32_t count) {
+  sequence<Node> nodes(nodes_file, true);
+  sequence<Edge> edges(edges_file, true);
+  for (uint32_t i = 0; i < count; ++i) {
+    edges.push_back(make_edge(i, i, i + 1, i % 8, i % 3 == 0));
+  }
+  edges.push_back(make_edge(count, 3, 3, 2, false));
+  for (uint32_t i = 0; i <= count; ++i) {
+    if (i > 0)
+      nodes.push_back(make_node(i, -1, i - 1));
+    if (i < count)
+      nodes.push_back(make_node(i, i, -1));
+    if (i == 3) {
+      nodes.push_back(make_node(i, count, -1));
+      nodes.push_back(make_node(i, -1, count));
+    }
+  }
+}
+
+void TestCollect() {
+  write_graph(10);
+  sequence<Node> nodes(nodes_file, false);
+  sequence<Edge> edges(edges_file, false);
+
+  // Node 3 has its 2 edges and the loop, seen from both ends, only once
+  auto node_itr = nodes.begin();
+  while ((*node_itr).node.osmid != 3)
+    ++node_itr;
+  auto bundle = collect_node_edges(node_itr, nodes, edges);
+  if (bundle.node_count != 4 || bundle.node_edges.size() != 3)
+    throw std::runtime_error("Bundle should have a loop edge only once");
+  for (size_t i = 1; i < bundle.node_edges.size(); ++i)
+    if (!(bundle.node_edges[i - 1].first < bundle.node_edges[i].first))
+      throw std::runtime_error("Bundle edges should be sorted");
+  if (!bundle.node.attributes_.link_edge || !bundle.node.attributes_.non_link_edge)
+    throw std::runtime_error("Bundle should have link and non link edges");
+}
+
+void TestFind() {
+  write_graph(1000);
+  auto pick = [](const node_bundle& bundle) {
+    return bundle.node.attributes_.link_edge && bundle.node.attributes_.non_link_edge;
+  };
+  auto expected = find_node_bundles(nodes_file, edges_file, 1, pick);
+  if (expected.empty())
+    throw std::runtime_error("Should find nodes with links");
+
+  // However many threads scan, no bundle is split and the same nodes come back
+  sequence<Node> nodes(nodes_file, false);
+  for (unsigned int threads : {2, 3, 7, 5000}) {
+    auto found = find_node_bundles(nodes_file, edges_file, threads, pick);
+    if (found != expected)
+      throw std::runtime_error("Threads should find the same nodes: " + std::to_string(threads));
+  }
+  for (auto position : expected)
+    if (position > 0 && (*nodes[position]).node.osmid == (*nodes[position - 1]).node.osmid)
+      throw std::runtime_error("Found nodes should start their bundles");
+
+  std::remove(nodes_file.c_str());
+  std::remove(edges_file.c_str());
+}
+
+}
+
+int main() {
+  test::suite suite("node_expander");
+
+  suite.test(TEST_CASE(TestCollect));
+  suite.test(TEST_CASE(TestFind));
+
+  return suite.tear_down();
+}
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <random>
 #include "config.h"
 #include "thor/optimizer.h"
 
@@ -21,8 +23,7 @@ void TryOptimizer(const uint32_t nlocs, const std::vector<float>& costs,
   }
 }
 
-void TestOptimizer() {
-  std::vector<float> costs = {
+const std::vector<float> kCosts = {
       0, 3036, 707, 956, 318, 1934, 355, 1170, 1286, 3171, 2133,
       2978, 0, 2664, 3613, 3102, 2011, 3139, 3846, 1764, 2050, 1143,
       638, 2638, 0, 1295, 763, 1536, 800, 1528, 888, 2773, 1735,
@@ -34,8 +35,103 @@ void TestOptimizer() {
       1214, 1750, 900, 1849, 1338, 634, 1375, 2082, 0, 1907, 846,
       3128, 2036, 2814, 3763, 3252, 2549, 3290, 3228, 1914, 0, 2010,
       2068, 1133, 1754, 2704, 2193, 1102, 2230, 2937, 854, 2000, 0 };
+
+float TourCost(const uint32_t nlocs, const std::vector<float>& costs,
+               const std::vector<uint32_t>& order) {
+  float cost = 0.0f;
+  for (uint32_t i = 0; i + 1 < order.size(); ++i)
+    cost += costs[order[i] * nlocs + order[i + 1]];
+  return cost;
+}
+
+void TestOptimizer() {
   std::vector<uint32_t> expected_order = { 0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10 };
-  TryOptimizer(11, costs, expected_order);
+  TryOptimizer(11, kCosts, expected_order);
+}
+
+std::vector<float> RandomCosts(const uint32_t nlocs) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> dist(0.0f, 1000.0f);
+  std::vector<float> costs(nlocs * nlocs);
+  for (auto& cost : costs)
+    cost = std::floor(dist(gen));
+  return costs;
+}
+
+void TestChains() {
+  // A larger random problem so the chains find different tours
+  const uint32_t nlocs = 40;
+  auto costs = RandomCosts(nlocs);
+
+  Optimizer single;
+  single.Seed(111111);
+  auto single_order = single.Solve(nlocs, costs);
+
+  Optimizer chains(4);
+  chains.Seed(111111);
+  auto order = chains.Solve(nlocs, costs);
+  if (order.size() != nlocs || order.front() != 0 || order.back() != nlocs - 1)
+    throw runtime_error("TestChains: expected the first and last location to stay fixed");
+  if (TourCost(nlocs, costs, order) > TourCost(nlocs, costs, single_order))
+    throw runtime_error("TestChains: expected the chains to do no worse than the first of them");
+
+  // The same seed gives the same tour
+  Optimizer again(4);
+  again.Seed(111111);
+  if (again.Solve(nlocs, costs) != order)
+    throw runtime_error("TestChains: expected the same tour from the same seed");
+
+  std::vector<uint32_t> expected_order = { 0, 3, 7, 4, 6, 2, 8, 5, 9, 1, 10 };
+  Optimizer small(3);
+  small.Seed(111111);
+  if (small.Solve(11, kCosts) != expected_order)
+    throw runtime_error("TestChains: expected order failed");
+}
+
+
+void TestLocalSearch() {
+  const uint32_t nlocs = 60;
+  auto costs = RandomCosts(nlocs);
+
+  Optimizer annealed(1, false);
+  annealed.Seed(111111);
+  auto annealed_order = annealed.Solve(nlocs, costs);
+  Optimizer polished(1, true);
+  polished.Seed(111111);
+  auto order = polished.Solve(nlocs, costs);
+  float cost = TourCost(nlocs, costs, order);
+  if (cost > TourCost(nlocs, costs, annealed_order))
+    throw runtime_error("TestLocalSearch: expected the local search to do no worse than annealing");
+  if (order.front() != 0 || order.back() != nlocs - 1)
+    throw runtime_error("TestLocalSearch: expected the first and last location to stay fixed");
+  std::vector<uint32_t> sorted(order);
+  std::sort(sorted.begin(), sorted.end());
+  for (uint32_t i = 0; i < nlocs; ++i) {
+    if (sorted[i] != i)
+      throw runtime_error("TestLocalSearch: expected every location once");
+  }
+
+  // No move the local search makes with a neighbor of the first location
+  // of the reversed part makes the tour any cheaper
+  for (uint32_t i = 1; i < nlocs - 2; ++i) {
+    std::vector<uint32_t> neighbors;
+    for (uint32_t to = 1; to < nlocs; ++to) {
+      if (to != order[i - 1])
+        neighbors.push_back(to);
+    }
+    std::sort(neighbors.begin(), neighbors.end(), [&](const uint32_t a, const uint32_t b) {
+      return costs[order[i - 1] * nlocs + a] < costs[order[i - 1] * nlocs + b];
+    });
+    neighbors.resize(kLocalSearchNeighbors);
+    for (uint32_t j = i + 1; j < nlocs - 1; ++j) {
+      if (std::find(neighbors.begin(), neighbors.end(), order[j]) == neighbors.end())
+        continue;
+      auto reversed = order;
+      std::reverse(reversed.begin() + i, reversed.begin() + j + 1);
+      if (TourCost(nlocs, costs, reversed) < cost - 0.01f)
+        throw runtime_error("TestLocalSearch: expected no cheaper 2-opt move");
+    }
+  }
 }
 
 }
@@ -45,5 +141,9 @@ int main() {
 
   suite.test(TEST_CASE(TestOptimizer));
 
+  suite.test(TEST_CASE(TestChains));
+
+  suite.test(TEST_CASE(TestLocalSearch));
+
   return suite.tear_down();
 }
@@ -0,0 +1,138 @@
+#include <cstdint>
+#include "test.h"
+#include "mjolnir/osmchange.h"
+#include "mjolnir/osmdata.h"
+#include "midgard/sequence.h"
+
+#include <cstdio>
+#include <fstream>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/tilehierarchy.h"
+
+using namespace std;
+using namespace valhalla::mjolnir;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+const std::string osc_file = "test/osmchange.osc";
+const std::string ways_file = "test_osmchange_ways.bin";
+const std::string way_nodes_file = "test_osmchange_way_nodes.bin";
+
+void WriteChange() {
+  std::ofstream osc(osc_file);
+  osc << R"(<?xml version="1.0" encoding="UTF-8"?>
+<osmChange version="0.6" generator="test">
+  <modify>
+    <node id="1" version="2" lat="30.1" lon="30.1"/>
+  </modify>
+  <create>
+    <node id="7" version="1" lat="40.1" lon="40.1"/>
+    <way id="400" version="1">
+      <nd ref="3"/>
+      <nd ref="7"/>
+      <tag k="highway" v="residential"/>
+    </way>
+    <relation id="500" version="1">
+      <member type="way" ref="600" role="from"/>
+      <member type="node" ref="8" role="via"/>
+    </relation>
+  </create>
+  <delete>
+    <way id="300" version="2"/>
+  </delete>
+</osmChange>
+)";
+}
+
+// Ways of a previous build, each with two nodes in its own tile
+void WriteBuild() {
+  compressed_sequence<OSMWay> ways(ways_file, true);
+  sequence<OSMWayNode> way_nodes(way_nodes_file, true);
+  uint64_t node_id = 1;
+  float degrees = 0.1f;
+  for (uint64_t way_id : { 100, 200, 300 }) {
+    ways.push_back({way_id});
+    for (size_t i = 0; i < 2; ++i) {
+      OSMWayNode way_node{};
+      way_node.node.osmid = node_id++;
+      way_node.node.set_latlng({degrees, degrees + i * 0.01f});
+      way_node.way_index = ways.size() - 1;
+      way_node.way_shape_node_index = i;
+      way_nodes.push_back(way_node);
+    }
+    degrees += 10.0f;
+  }
+}
+
+void TestRead() {
+  WriteChange();
+  OSMChange change;
+  change.Read(osc_file);
+  if (change.nodes.size() != 2 || !change.nodes[1].ApproximatelyEqual(PointLL(30.1f, 30.1f)))
+    throw std::runtime_error("Expected the modified and created nodes");
+  if (change.ways.size() != 1 || change.ways[400] != std::vector<uint64_t>{3, 7})
+    throw std::runtime_error("Expected the created way with its nodes");
+  if (change.deleted_ways.size() != 1 || !change.deleted_ways.count(300) || !change.deleted_nodes.empty())
+    throw std::runtime_error("Expected the deleted way");
+  if (!change.relation_ways.count(600) || !change.relation_nodes.count(8))
+    throw std::runtime_error("Expected the relation members");
+
+  // A later change replaces an earlier one
+  std::ofstream osc(osc_file);
+  osc << R"(<osmChange version="0.6"><delete><node id="1" version="3"/></delete></osmChange>)";
+  osc.close();
+  change.Read(osc_file);
+  if (change.nodes.count(1) || !change.deleted_nodes.count(1))
+    throw std::runtime_error("Expected the node to be deleted by the later change");
+  std::remove(osc_file.c_str());
+}
+
+void TestDirtyTiles() {
+  WriteChange();
+  WriteBuild();
+  OSMChange change;
+  change.Read(osc_file);
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/osmchange_no_tiles");
+  auto tiles = change.DirtyTiles(pt, ways_file, way_nodes_file);
+
+  // Where way 100 was since its node moved and where it moved to, where the
+  // old node of the new way is and the new one, where the deleted way was.
+  // Way 200 shares a node with the new way but didn't change itself.
+  auto local = TileHierarchy::levels().rbegin()->first;
+  std::set<GraphId> expected;
+  for (float degrees : { 0.1f, 30.1f, 10.1f, 40.1f, 20.1f }) {
+    for (const auto& level : TileHierarchy::levels())
+      expected.insert(TileHierarchy::GetGraphId(PointLL(degrees, degrees), level.first));
+  }
+  if (tiles != expected) {
+    std::string found;
+    for (const auto& tile : tiles)
+      found += std::to_string(tile.level()) + "/" + std::to_string(tile.tileid()) + " ";
+    throw std::runtime_error("Unexpected dirty tiles: " + found);
+  }
+  size_t local_count = std::count_if(tiles.begin(), tiles.end(),
+                                     [local](const GraphId& id) { return id.level() == local; });
+  if (local_count != 5)
+    throw std::runtime_error("Expected 5 local tiles");
+
+  std::remove(osc_file.c_str());
+  std::remove(ways_file.c_str());
+  std::remove((ways_file + ".idx").c_str());
+  std::remove(way_nodes_file.c_str());
+}
+
+}
+
+int main() {
+  test::suite suite("osmchange");
+
+  suite.test(TEST_CASE(TestRead));
+
+  suite.test(TEST_CASE(TestDirtyTiles));
+
+  return suite.tear_down();
+}
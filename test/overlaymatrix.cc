@@ -0,0 +1,216 @@
+#include "test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "baldr/overlaygraph.h"
+#include "mjolnir/chbuilder.h"
+#include "mjolnir/overlaybuilder.h"
+#include "thor/overlaymatrix.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+using namespace valhalla::thor;
+
+namespace {
+
+// Random graph of nodes in a few cells, most of them staying in their cell
+// and the rest leading into another one, where the time and length of a
+// turn are a fixed share of its cost
+struct cells_t {
+  std::vector<GraphId> edges;
+  std::vector<uint32_t> end_tiles;
+  std::vector<CHBuilder::Turn> turns;
+};
+
+cells_t RandomCells(const uint32_t node_count, const uint32_t cell_count, std::mt19937& gen) {
+  cells_t cells;
+  std::vector<std::vector<uint32_t> > in_cell(cell_count);
+  for (uint32_t i = 0; i < node_count; ++i) {
+    uint32_t cell = static_cast<uint32_t>(test::rand01(gen) * cell_count) % cell_count;
+    uint32_t end = cell;
+    if (test::rand01(gen) < 0.2f)
+      end = (cell + 1 + static_cast<uint32_t>(test::rand01(gen) * (cell_count - 1))) % cell_count;
+    cells.edges.emplace_back(cell, 0, i);
+    cells.end_tiles.push_back(end);
+    in_cell[cell].push_back(i);
+  }
+  for (uint32_t from = 0; from < node_count; ++from) {
+    const auto& next = in_cell[cells.end_tiles[from]];
+    for (uint32_t i = 0; i < 3 && !next.empty(); ++i) {
+      uint32_t to = next[static_cast<uint32_t>(test::rand01(gen) * next.size()) % next.size()];
+      float secs = std::floor(1 + test::rand01(gen) * 100);
+      cells.turns.push_back({from, to, secs * 2, secs, secs * 10});
+    }
+  }
+  return cells;
+}
+
+// Plain dijkstra from a node to all the others
+std::vector<float> Dijkstra(const uint32_t node_count, const std::vector<CHBuilder::Turn>& turns,
+                            const uint32_t source) {
+  std::vector<std::vector<CHBuilder::Turn> > out(node_count);
+  for (const auto& turn : turns)
+    out[turn.from].push_back(turn);
+  std::vector<float> dist(node_count, std::numeric_limits<float>::max());
+  using entry_t = std::pair<float, uint32_t>;
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > queue;
+  dist[source] = 0.f;
+  queue.emplace(0.f, source);
+  while (!queue.empty()) {
+    auto top = queue.top();
+    queue.pop();
+    if (top.first > dist[top.second])
+      continue;
+    for (const auto& turn : out[top.second]) {
+      if (top.first + turn.cost < dist[turn.to]) {
+        dist[turn.to] = top.first + turn.cost;
+        queue.emplace(dist[turn.to], turn.to);
+      }
+    }
+  }
+  return dist;
+}
+
+void TestOverlay() {
+  std::mt19937 gen(17);
+  const uint32_t node_count = 600;
+  auto cells = RandomCells(node_count, 6, gen);
+  auto graph = std::make_shared<const OverlayGraph>(
+      OverlayBuilder::Overlay("auto", cells.edges, cells.end_tiles, cells.turns, 3));
+
+  // Only the nodes leading into another cell are in the overlay
+  for (uint32_t i = 0; i < node_count; ++i) {
+    bool boundary = cells.end_tiles[i] != cells.edges[i].tileid();
+    test::assert_bool((graph->node(cells.edges[i]) != kInvalidOverlayNode) == boundary,
+                      "Expected exactly the boundary edges in the overlay");
+  }
+  test::assert_bool(graph->node_count() > 50, "Expected a good number of boundary edges");
+
+  // Between the boundary nodes the overlay costs what the whole graph does
+  std::vector<std::vector<OverlayMatrix::Seed> > sources, targets;
+  for (uint32_t i = 0; i < 20; ++i) {
+    uint32_t node = static_cast<uint32_t>(test::rand01(gen) * graph->node_count()) % graph->node_count();
+    sources.push_back({{node, 0.f, 0.f, 0.f}});
+  }
+  for (uint32_t i = 0; i < 30; ++i) {
+    uint32_t node = static_cast<uint32_t>(test::rand01(gen) * graph->node_count()) % graph->node_count();
+    targets.push_back({{node, 0.f, 0.f, 0.f}});
+  }
+  OverlayMatrix matrix(graph, 4);
+  auto connections = matrix.Connect(sources, targets);
+  test::assert_bool(connections.size() == sources.size() * targets.size(),
+                    "Expected a connection per source and target");
+  for (size_t i = 0; i < sources.size(); ++i) {
+    auto dist = Dijkstra(node_count, cells.turns, graph->edgeid(sources[i].front().node).id());
+    for (size_t j = 0; j < targets.size(); ++j) {
+      const auto& connection = connections[i * targets.size() + j];
+      float expected = dist[graph->edgeid(targets[j].front().node).id()];
+      if (expected == std::numeric_limits<float>::max()) {
+        test::assert_bool(connection.cost == kMaxCost, "Expected no connection where dijkstra has none");
+        continue;
+      }
+      test::assert_bool(std::fabs(connection.cost - expected) < 0.01f,
+                        "Expected the same cost as dijkstra " + std::to_string(connection.cost) +
+                        " vs " + std::to_string(expected));
+      test::assert_bool(std::fabs(connection.secs * 2 - connection.cost) < 0.01f &&
+                        std::fabs(connection.length - connection.secs * 10) < 0.1f,
+                        "Expected the time and length along the same path");
+    }
+  }
+
+  // The same on one thread
+  auto serial = OverlayMatrix(graph, 1).Connect(sources, targets);
+  for (size_t i = 0; i < serial.size(); ++i)
+    test::assert_bool(serial[i].cost == connections[i].cost && serial[i].secs == connections[i].secs,
+                      "Expected the same connections on one thread");
+}
+
+void TestSeeds() {
+  // Cells 1 and 2 with the boundary edges 0 (into 2), 3 (into 1) and 4 (into
+  // 2), crossing cell 2 from 0 to 3 by way of 1 and 2, or from 4 straight
+  // to 3 for more
+  std::vector<GraphId> edges = {{1, 0, 0}, {2, 0, 1}, {2, 0, 2}, {2, 0, 3}, {1, 0, 4}};
+  std::vector<uint32_t> end_tiles = {2, 2, 2, 1, 2};
+  std::vector<CHBuilder::Turn> turns = {
+    {0, 1, 10, 10, 10}, {1, 2, 10, 10, 10}, {2, 3, 10, 10, 10}, {4, 3, 50, 50, 50}};
+  auto graph = std::make_shared<const OverlayGraph>(
+      OverlayBuilder::Overlay("auto", edges, end_tiles, turns, 2));
+  test::assert_bool(graph->node_count() == 3 && graph->arc_count() == 2,
+                    "Expected an arc across cell 2 from each edge entering it");
+  uint32_t a = graph->node(edges[0]), b = graph->node(edges[3]), c = graph->node(edges[4]);
+  test::assert_bool(a != kInvalidOverlayNode && b != kInvalidOverlayNode && c != kInvalidOverlayNode,
+                    "Expected the boundary edges to be nodes");
+  OverlayMatrix matrix(graph, 2);
+
+  // The seeds are added to both ends and the cheaper source is taken
+  auto connections = matrix.Connect({{{a, 2.f, 2.f, 2.f}}, {{c, 1.f, 1.f, 1.f}, {a, 40.f, 40.f, 40.f}}},
+                                    {{{b, 3.f, 3.f, 3.f}}});
+  test::assert_bool(connections[0].cost == 35.f && connections[0].length == 35.f,
+                    "Expected the way across the cell with the seeds applied");
+  test::assert_bool(connections[1].cost == 54.f, "Expected the cheaper of the two sources");
+
+  // Negative target seeds refund the rest of the last edge, on the same
+  // edge the target has to be ahead of the source
+  connections = matrix.Connect({{{b, 6.f, 6.f, 6.f}}}, {{{b, -2.f, -2.f, -2.f}}, {{b, -8.f, -8.f, -8.f}}});
+  test::assert_bool(connections[0].cost == 4.f, "Expected the path along the edge");
+  test::assert_bool(connections[1].cost == kMaxCost, "Expected no path back along the edge");
+
+  // Even when the source is met first, a cheaper way refunded at the end
+  // is still found
+  connections = matrix.Connect({{{a, 0.f, 0.f, 0.f}}}, {{{a, 25.f, 25.f, 25.f}, {b, -9.f, -9.f, -9.f}}});
+  test::assert_bool(connections[0].cost == 21.f, "Expected the refunded way to be cheaper");
+
+  // Without an overlay nothing is connected
+  connections = OverlayMatrix(nullptr).Connect({{{0, 0.f, 0.f, 0.f}}}, {{{0, 0.f, 0.f, 0.f}}});
+  test::assert_bool(connections[0].cost == kMaxCost, "Expected no connection without an overlay");
+}
+
+void TestFile() {
+  std::mt19937 gen(19);
+  auto cells = RandomCells(200, 4, gen);
+  auto graph = OverlayBuilder::Overlay("truck", cells.edges, cells.end_tiles, cells.turns);
+  std::string file_name = OverlayGraph::FileName("test/data", "overlaymatrix");
+  test::assert_bool(file_name == "test/data/overlaymatrix.mld", "Unexpected overlay file name");
+  graph.Write(file_name);
+  auto loaded = OverlayGraph::Load(file_name);
+  std::remove(file_name.c_str());
+  test::assert_bool(loaded.costing() == "truck" && loaded.node_count() == graph.node_count() &&
+                    loaded.arc_count() == graph.arc_count(),
+                    "Expected the same overlay back from the file");
+  for (uint32_t v = 0; v < graph.node_count(); ++v) {
+    test::assert_bool(loaded.edgeid(v) == graph.edgeid(v) && loaded.node(graph.edgeid(v)) == v,
+                      "Expected the same nodes back from the file");
+    auto arcs = graph.arcs(v);
+    auto loaded_arcs = loaded.arcs(v);
+    test::assert_bool(std::distance(arcs.begin(), arcs.end()) ==
+                      std::distance(loaded_arcs.begin(), loaded_arcs.end()),
+                      "Expected the same arcs back from the file");
+  }
+
+  bool threw = false;
+  try {
+    OverlayGraph::Load("test/data/does_not_exist.mld");
+  } catch (const std::exception&) {
+    threw = true;
+  }
+  test::assert_bool(threw, "Expected loading a missing overlay to throw");
+}
+
+}
+
+int main() {
+  test::suite suite("overlaymatrix");
+
+  suite.test(TEST_CASE(TestOverlay));
+  suite.test(TEST_CASE(TestSeeds));
+  suite.test(TEST_CASE(TestFile));
+
+  return suite.tear_down();
+}
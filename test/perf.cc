@@ -0,0 +1,324 @@
+#include "test.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "baldr/json.h"
+#include "midgard/logging.h"
+#include "tyr/actor.h"
+
+using namespace valhalla;
+
+/*
+ * runs a handful of representative requests against the utrecht test tiles and measures, per
+ * request, how many allocations and bytes they make and how many cycles, last level cache misses
+ * and branch misses they take. the numbers are checked against a stored baseline and any scenario
+ * which regressed past it fails. to (re)record the baseline, say after eliminating allocations:
+ *
+ *   ./test/perf test/data/perf_baseline.json --update
+ *
+ * a missing baseline is recorded on the first run. hardware counters are only checked when the
+ * kernel lets us open them (see /proc/sys/kernel/perf_event_paranoid) and are noisier than the
+ * allocation counts so they get a looser tolerance
+ */
+
+namespace {
+
+  //counts every allocation made through operator new while counting is on
+  std::atomic<bool> counting(false);
+  std::atomic<uint64_t> allocations(0);
+  std::atomic<uint64_t> allocated_bytes(0);
+
+  void* allocate(size_t size) {
+    if(counting.load(std::memory_order_relaxed)) {
+      allocations.fetch_add(1, std::memory_order_relaxed);
+      allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return std::malloc(size ? size : 1);
+  }
+
+}
+
+void* operator new(size_t size) {
+  void* p = allocate(size);
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  void* p = allocate(size);
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+  //a hardware counter of the calling thread, invalid if the kernel wont give us one
+  class counter_t {
+   public:
+    explicit counter_t(uint64_t config) : fd(-1) {
+#ifdef __linux__
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+    ~counter_t() {
+#ifdef __linux__
+      if(fd >= 0)
+        close(fd);
+#endif
+    }
+    counter_t(const counter_t&) = delete;
+    counter_t& operator=(const counter_t&) = delete;
+    bool valid() const {
+      return fd >= 0;
+    }
+    void start() {
+#ifdef __linux__
+      if(fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+    }
+    uint64_t stop() {
+      uint64_t count = 0;
+#ifdef __linux__
+      if(fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(fd, &count, sizeof(count)) != sizeof(count))
+          count = 0;
+      }
+#endif
+      return count;
+    }
+   protected:
+    int fd;
+  };
+
+#ifdef __linux__
+  const uint64_t kCycles = PERF_COUNT_HW_CPU_CYCLES;
+  const uint64_t kLLCMisses = PERF_COUNT_HW_CACHE_MISSES;
+  const uint64_t kBranchMisses = PERF_COUNT_HW_BRANCH_MISSES;
+#else
+  const uint64_t kCycles = 0, kLLCMisses = 0, kBranchMisses = 0;
+#endif
+
+  //how far past the baseline a metric may go before the scenario fails
+  const std::map<std::string, float> kTolerances = {
+    {"allocations", .02f}, {"bytes", .02f}, {"cycles", .25f}, {"llc_misses", .25f}, {"branch_misses", .25f},
+  };
+
+  //each scenario is warmed up once, so that tiles are cached, then measured over this many runs
+  constexpr size_t kIterations = 5;
+
+  boost::property_tree::ptree json_to_pt(const std::string& json) {
+    std::stringstream ss; ss << json;
+    boost::property_tree::ptree pt;
+    boost::property_tree::read_json(ss, pt);
+    return pt;
+  }
+
+  const auto conf = json_to_pt(R"({
+    "mjolnir":{"tile_dir":"test/data/utrecht_tiles", "concurrency": 1},
+    "loki":{
+      "actions":["locate","route","sources_to_targets","optimized_route","isochrone","trace_route","trace_attributes"],
+      "logging":{"long_request": 100},
+      "service_defaults":{"minimum_reachability": 50,"radius": 0}
+    },
+    "thor":{"logging":{"long_request": 110}},
+    "meili":{"customizable": ["turn_penalty_factor","max_route_distance_factor","max_route_time_factor","search_radius"],
+             "mode":"auto","grid":{"cache_size":100240,"size":500},
+             "default":{"beta":3,"breakage_distance":2000,"geometry":false,"gps_accuracy":5.0,"interpolation_distance":10,
+             "max_route_distance_factor":5,"max_route_time_factor":5,"max_search_radius":200,"route":true,
+             "search_radius":15.0,"sigma_z":4.07,"turn_penalty_factor":200}},
+    "service_limits": {
+      "auto": {"max_distance": 5000000.0, "max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "auto_shorter": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "bicycle": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+      "bus": {"max_distance": 5000000.0,"max_locations": 50,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "hov": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50},
+      "isochrone": {"max_contours": 4,"max_distance": 25000.0,"max_locations": 1,"max_time": 120},
+      "max_avoid_locations": 50,"max_radius": 200,"max_reachability": 100,
+      "multimodal": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 0.0,"max_matrix_locations": 0},
+      "pedestrian": {"max_distance": 250000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50,"max_transit_walking_distance": 10000,"min_transit_walking_distance": 1},
+      "skadi": {"max_shape": 750000,"min_resample": 10.0},
+      "trace": {"max_distance": 200000.0,"max_gps_accuracy": 100.0,"max_search_radius": 100,"max_shape": 16000,"max_best_paths":4,"max_best_paths_shape":100},
+      "transit": {"max_distance": 500000.0,"max_locations": 50,"max_matrix_distance": 200000.0,"max_matrix_locations": 50},
+      "truck": {"max_distance": 5000000.0,"max_locations": 20,"max_matrix_distance": 400000.0,"max_matrix_locations": 50}
+    }
+  })");
+
+  //the same places the matrix test uses
+  const auto route_request = R"({"costing":"auto","locations":[
+    {"lat":52.106337,"lon":5.101728},{"lat":52.094273,"lon":5.075254}]})";
+  const auto locate_request = R"({"costing":"auto","locations":[
+    {"lat":52.106337,"lon":5.101728},{"lat":52.111276,"lon":5.089717},
+    {"lat":52.103105,"lon":5.081005},{"lat":52.103948,"lon":5.06813}]})";
+  const auto matrix_request = R"({"costing":"auto",
+    "sources":[{"lat":52.106337,"lon":5.101728},{"lat":52.111276,"lon":5.089717},
+               {"lat":52.103105,"lon":5.081005},{"lat":52.103948,"lon":5.06813}],
+    "targets":[{"lat":52.106126,"lon":5.101497},{"lat":52.100469,"lon":5.087099},
+               {"lat":52.103105,"lon":5.081005},{"lat":52.094273,"lon":5.075254}]})";
+  const auto isochrone_request = R"({"costing":"auto","locations":[{"lat":52.103105,"lon":5.081005}],
+    "contours":[{"time":5},{"time":10}]})";
+
+  std::string path;
+  bool update = false;
+  boost::property_tree::ptree baseline;
+  tyr::actor_t* actor = nullptr;
+
+  std::string json_escape(const std::string& unescaped) {
+    std::stringstream ss;
+    baldr::json::OstreamVisitor v(ss);
+    v(unescaped);
+    return ss.str();
+  }
+
+  //measures a scenario and checks it against the baseline or records it there when updating
+  template <class scenario_t>
+  void measure(const std::string& name, const scenario_t& scenario) {
+    scenario();
+
+    counter_t cycles(kCycles), llc_misses(kLLCMisses), branch_misses(kBranchMisses);
+    std::map<std::string, uint64_t> metrics;
+    for(size_t i = 0; i < kIterations; ++i) {
+      allocations = allocated_bytes = 0;
+      counting = true;
+      cycles.start(); llc_misses.start(); branch_misses.start();
+      scenario();
+      metrics["branch_misses"] += branch_misses.stop();
+      metrics["llc_misses"] += llc_misses.stop();
+      metrics["cycles"] += cycles.stop();
+      counting = false;
+      metrics["allocations"] += allocations;
+      metrics["bytes"] += allocated_bytes;
+    }
+    if(!cycles.valid()) metrics.erase("cycles");
+    if(!llc_misses.valid()) metrics.erase("llc_misses");
+    if(!branch_misses.valid()) metrics.erase("branch_misses");
+
+    //per request
+    std::string report, regressions;
+    for(auto& metric : metrics) {
+      metric.second /= kIterations;
+      report += " " + metric.first + "=" + std::to_string(metric.second);
+      auto recorded = baseline.get_optional<uint64_t>(name + "." + metric.first);
+      if(update || !recorded) {
+        baseline.put(name + "." + metric.first, metric.second);
+        continue;
+      }
+      if(metric.second > *recorded * (1.f + kTolerances.at(metric.first)))
+        regressions += " " + metric.first + " " + std::to_string(*recorded) + " -> " +
+                       std::to_string(metric.second);
+    }
+    std::cout << report << std::flush;
+    if(!regressions.empty())
+      throw std::runtime_error("regressed past the baseline:" + regressions);
+  }
+
+  void test_locate() {
+    measure("locate", []() { actor->locate(locate_request); });
+  }
+
+  void test_route() {
+    measure("route", []() { actor->route(route_request); });
+  }
+
+  void test_matrix() {
+    measure("matrix", []() { actor->matrix(matrix_request); });
+  }
+
+  void test_isochrone() {
+    measure("isochrone", []() { actor->isochrone(isochrone_request); });
+  }
+
+  void test_trace_route() {
+    //match the shape of the route back onto the graph
+    auto route = json_to_pt(actor->route(route_request));
+    auto encoded_shape = route.get_child("trip.legs").front().second.get<std::string>("shape");
+    auto trace_request = R"({"costing":"auto","shape_match":"map_snap","encoded_polyline":)" +
+                         json_escape(encoded_shape) + "}";
+    measure("trace_route", [&trace_request]() { actor->trace_route(trace_request); });
+  }
+
+}
+
+int main(int argc, char* argv[]) {
+  path = argc > 1 ? argv[1] : "test/data/perf_baseline.json";
+  update = argc > 2 && std::string(argv[2]) == "--update";
+  if(boost::filesystem::exists(path))
+    boost::property_tree::read_json(path, baseline);
+  else
+    update = true;
+
+  //keep the logging from showing up in the counts
+  midgard::logging::Configure({{"type", ""}});
+  tyr::actor_t a(conf, true);
+  actor = &a;
+
+  test::suite suite("perf");
+
+  suite.test(TEST_CASE(test_locate));
+  suite.test(TEST_CASE(test_route));
+  suite.test(TEST_CASE(test_matrix));
+  suite.test(TEST_CASE(test_isochrone));
+  suite.test(TEST_CASE(test_trace_route));
+
+  if(update) {
+    boost::property_tree::write_json(path, baseline);
+    std::cout << "Recorded the baseline in " << path << std::endl;
+  }
+
+  return suite.tear_down();
+}
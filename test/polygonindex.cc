@@ -0,0 +1,75 @@
+#include "test.h"
+
+#include <cstdlib>
+#include <unordered_map>
+#include "mjolnir/admin.h"
+#include "mjolnir/polygonindex.h"
+
+using namespace std;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+  unordered_map<uint32_t, multi_polygon_type> polygons() {
+    // Two states sharing a border, an island, a diagonal one across them and
+    // a hole that is inside none of them
+    unordered_map<uint32_t, multi_polygon_type> polys;
+    const vector<pair<uint32_t, string>> wkts{
+      {1, "MULTIPOLYGON(((0 0,0 1,0.5 1,0.5 0,0 0),(0.1 0.1,0.2 0.1,0.2 0.2,0.1 0.2,0.1 0.1)))"},
+      {2, "MULTIPOLYGON(((0.5 0,0.5 1,1 1,1 0,0.5 0)))"},
+      {3, "MULTIPOLYGON(((0.7 0.7,0.7 0.8,0.8 0.8,0.8 0.7,0.7 0.7)),((1.1 1.1,1.1 1.2,1.2 1.2,1.2 1.1,1.1 1.1)))"},
+      {4, "MULTIPOLYGON(((0 0.3,0.6 0.9,0.6 0.3,0 0.3)))"}
+    };
+    for (const auto& wkt : wkts) {
+      multi_polygon_type poly;
+      boost::geometry::read_wkt(wkt.second, poly);
+      boost::geometry::correct(poly);
+      polys.emplace(wkt.first, poly);
+    }
+    return polys;
+  }
+
+  void TestMatchesPolygonLoop() {
+    auto polys = polygons();
+    AABB2<PointLL> bounds(PointLL(0, 0), PointLL(1, 1));
+    for (uint32_t grid_size : {1, 4, 32}) {
+      PolygonIndex index(polys, bounds, grid_size);
+      if (index.size() != polys.size())
+        throw runtime_error("All the polygons should be in the index");
+
+      // Points inside and just off the tile, and on the cell and polygon edges
+      srand(42);
+      for (int i = 0; i < 5000; ++i) {
+        PointLL ll(-0.1f + 1.4f * rand() / RAND_MAX, -0.1f + 1.4f * rand() / RAND_MAX);
+        if (index.Get(ll) != GetMultiPolyId(polys, ll))
+          throw runtime_error("Index should find the same polygon as testing each one at " +
+                              to_string(ll.lng()) + "," + to_string(ll.lat()));
+      }
+      for (float x = 0.f; x <= 1.f; x += 0.125f) {
+        for (float y = 0.f; y <= 1.f; y += 0.125f) {
+          PointLL ll(x, y);
+          if (index.Get(ll) != GetMultiPolyId(polys, ll))
+            throw runtime_error("Index should find the same polygon on cell edges");
+        }
+      }
+    }
+  }
+
+  void TestEmpty() {
+    unordered_map<uint32_t, multi_polygon_type> polys;
+    PolygonIndex index(polys, AABB2<PointLL>(PointLL(0, 0), PointLL(1, 1)));
+    if (index.Get(PointLL(0.5f, 0.5f)) != 0 || index.Get(PointLL(2.f, 2.f)) != 0)
+      throw runtime_error("No polygon should be found without polygons");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("polygonindex");
+
+  suite.test(TEST_CASE(TestMatchesPolygonLoop));
+  suite.test(TEST_CASE(TestEmpty));
+
+  return suite.tear_down();
+}
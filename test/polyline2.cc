@@ -3,8 +3,12 @@
 
 #include "test.h"
 
+#include <algorithm>
+#include <list>
+#include <random>
 #include <vector>
 
+#include "midgard/linesegment2.h"
 #include "midgard/point2.h"
 
 using namespace std;
@@ -46,6 +50,47 @@ void TestGeneralizeAndLength() {
   TryGeneralizeAndLength(pl, 100.0f, 79.0569f);
 }
 
+void TestGeneralizeTolerance() {
+  // A long random walk
+  std::mt19937 gen(11);
+  std::normal_distribution<float> step(0.f, 2.f);
+  std::vector<Point2> pts;
+  Point2 p(0.f, 0.f);
+  for (size_t i = 0; i < 100000; ++i) {
+    p = Point2(p.x() + 1.f + step(gen), p.y() + step(gen));
+    pts.push_back(p);
+  }
+
+  // Every point left out is within the tolerance of the kept segment around it,
+  // give or take the float precision this far out
+  const float tolerance = 5.f;
+  auto generalized = pts;
+  Polyline2<Point2>::Generalize(generalized, tolerance);
+  if (generalized.front() != pts.front() || generalized.back() != pts.back())
+    throw runtime_error("Generalize should keep the end points");
+  if (generalized.size() >= pts.size() / 2)
+    throw runtime_error("Generalize should have left out most of the points");
+  auto kept = generalized.cbegin();
+  Point2 closest;
+  for (const auto& pt : pts) {
+    if (pt == *kept) {
+      ++kept;
+      continue;
+    }
+    LineSegment2<Point2> segment(*std::prev(kept), *kept);
+    if (segment.Distance(pt, closest) > tolerance * 1.01f)
+      throw runtime_error("Generalize left out a point further than the tolerance");
+  }
+  if (kept != generalized.cend())
+    throw runtime_error("Generalize should keep the points in order");
+
+  // The same points are kept from a list
+  std::list<Point2> list(pts.cbegin(), pts.cend());
+  Polyline2<Point2>::Generalize(list, tolerance);
+  if (!std::equal(list.cbegin(), list.cend(), generalized.cbegin()) || list.size() != generalized.size())
+    throw runtime_error("Generalize should keep the same points from a list");
+}
+
 void TryClosestPoint(const Polyline2<Point2>& pl, const Point2& a, const Point2& b) {
 
   auto result = pl.ClosestPoint(a);
@@ -128,6 +173,9 @@ int main() {
   // Test Generalize
   suite.test(TEST_CASE(TestGeneralizeAndLength));
 
+  // Test Generalize keeps every point within the tolerance on a long line
+  suite.test(TEST_CASE(TestGeneralizeTolerance));
+
   // Test distance of a point to a line segment
   suite.test(TEST_CASE(TestClosestPoint));
 
@@ -260,6 +260,65 @@ void TestRoutePathIterator()
 }
 
 
+
+void TestSharedSearchSpace()
+{
+  // Node status is kept per tile and reset between searches
+  meili::NodeStatus status;
+  baldr::GraphId a(5, 2, 0), b(5, 2, 1000), c(7, 1, 3);
+  test::assert_bool(!status.find(a) && !status.find(b) && !status.find(c),
+                    "TestSharedSearchSpace: nothing should be reached");
+  status.emplace(b, 3);
+  status.emplace(c, 4);
+  test::assert_bool(!status.find(a) && status.find(b)->label_idx == 3 && status.find(c)->label_idx == 4,
+                    "TestSharedSearchSpace: wrong node status");
+  status.clear();
+  test::assert_bool(!status.find(b) && !status.find(c),
+                    "TestSharedSearchSpace: status should be cleared");
+
+  // Consecutive label sets search with the same queue and node status
+  sif::TravelMode travelmode = static_cast<sif::TravelMode>(0);
+  baldr::DirectedEdge de;
+  auto space = std::make_shared<meili::SearchSpace>(100);
+  for (int i = 0; i < 2; ++i) {
+    meili::LabelSet labelset(space);
+    labelset.put(a, travelmode, nullptr);
+    labelset.put(b, baldr::GraphId(), 0.f, 1.f, {5.f, 1.f}, 0.f, 5.f + i, 0, &de, travelmode);
+    labelset.put(c, baldr::GraphId(), 0.f, 1.f, {2.f, 1.f}, 0.f, 2.f + i, 0, &de, travelmode);
+    labelset.put(0, baldr::GraphId(), 0.f, 1.f, {3.f, 1.f}, 0.f, 3.f + i, 0, &de, travelmode);
+    std::vector<uint32_t> order;
+    for (auto idx = labelset.pop(); idx != baldr::kInvalidLabel; idx = labelset.pop()) {
+      order.push_back(idx);
+    }
+    test::assert_bool(order == std::vector<uint32_t>({0, 2, 3, 1}),
+                      "TestSharedSearchSpace: wrong order of labels");
+    labelset.clear_queue();
+    labelset.clear_status();
+  }
+}
+
+void TestCorridor()
+{
+  // About 1km east along the equator with a 100m buffer
+  midgard::PointLL start(0.f, 0.f), end(0.009f, 0.f);
+  meili::Corridor corridor(start, end, 100.f);
+  test::assert_bool(corridor.contains(start) && corridor.contains(end) &&
+                    corridor.contains(midgard::PointLL(0.0045f, 0.0008f)),
+                    "TestCorridor: positions near the segment should be within");
+  test::assert_bool(!corridor.contains(midgard::PointLL(0.0045f, 0.0012f)) &&
+                    !corridor.contains(midgard::PointLL(-0.0012f, 0.f)) &&
+                    !corridor.contains(midgard::PointLL(0.0102f, 0.f)),
+                    "TestCorridor: positions beside or past the ends should be outside");
+  test::assert_bool(corridor.contains(midgard::PointLL(-0.0008f, 0.f)),
+                    "TestCorridor: the buffer should go around the ends");
+
+  // Both measurements at the same place is a circle
+  meili::Corridor circle(start, start, 100.f);
+  test::assert_bool(circle.contains(midgard::PointLL(0.f, 0.0008f)) &&
+                    !circle.contains(midgard::PointLL(0.0012f, 0.f)),
+                    "TestCorridor: a corridor without a segment should be a circle");
+}
+
 int main(int argc, char *argv[])
 {
   test::suite suite("routing");
@@ -272,5 +331,9 @@ int main(int argc, char *argv[])
 
   suite.test(TEST_CASE(TestRoutePathIterator));
 
+  suite.test(TEST_CASE(TestSharedSearchSpace));
+
+  suite.test(TEST_CASE(TestCorridor));
+
   return suite.tear_down();
 }
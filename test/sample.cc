@@ -1,5 +1,6 @@
 #include "test.h"
 #include "skadi/sample.h"
+#include "skadi/block_hgt.h"
 #include "pixels.h"
 
 #include "midgard/sequence.h"
@@ -9,6 +10,8 @@ using namespace valhalla;
 
 #include <cmath>
 #include <list>
+#include <random>
+#include <thread>
 #include <fstream>
 #include <zlib.h>
 #include <lz4.h>
@@ -84,6 +87,11 @@ void create_tile() {
   std::ofstream gzfile("test/data/samplegz/N40/N40W077.hgt.gz", std::ios::binary | std::ios::trunc);
   gzfile.write(static_cast<const char*>(static_cast<void*>(gzipped.data())), gzipped.size());
 
+  //write it again but this time in blocks
+  auto blocks = skadi::block_hgt::pack(tile.data());
+  std::ofstream blkfile("test/data/sampleblk/N40/N40W077.hgt.blk", std::ios::binary | std::ios::trunc);
+  blkfile.write(blocks.data(), blocks.size());
+
   //write it again but this time lzipped
   auto lzipped = lzip(tile);
   std::ofstream lzfile("test/data/samplelz/N40/N40W077.hgt.lz4", std::ios::binary | std::ios::trunc);
@@ -121,6 +129,7 @@ void _get(const std::string& location) {
 void get() { _get("test/data/sample"); };
 void getgz() { _get("test/data/samplegz"); };
 void getlz() { _get("test/data/samplelz"); };
+void getblk() { _get("test/data/sampleblk"); };
 
 struct testable_sample_t : public skadi::sample {
   testable_sample_t(const std::string& dir):sample(dir){
@@ -132,8 +141,8 @@ struct testable_sample_t : public skadi::sample {
       for(size_t i = 0; i < 3601 * 4; ++i)
         s.push_back(((-32768 & 0xFF) << 8) | ((-32768 >> 8) & 0xFF));
     }
-    mapped_cache.front().first = format_t::RAW;
-    mapped_cache.front().second.map("test/data/blah.hgt", 3601*6);
+    mapped_cache->tiles.front().first = format_t::RAW;
+    mapped_cache->tiles.front().second.map("test/data/blah.hgt", 3601*6);
   }
 };
 
@@ -180,6 +189,127 @@ void lazy_load() {
     throw std::runtime_error("Wrong value at location: " + std::to_string(s.get(std::make_pair(1 - 0.503915, 0.678783))));
 }
 
+void batched() {
+  //the batched interpolation should match the single posting one everywhere
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> distribution(0, 1);
+  auto check = [&generator, &distribution](const skadi::sample& s, double lon, double lat, double lat_range) {
+    std::vector<std::pair<double, double> > postings;
+    for(size_t i = 0; i < 1001; ++i)
+      postings.emplace_back(lon + distribution(generator), lat + distribution(generator) * lat_range);
+    //some in the next tile over and some right on the pixel rows
+    postings.emplace_back(lon + 1.5, lat + .5);
+    postings.emplace_back(lon + .25, lat);
+    postings.emplace_back(lon + .75, lat + 1 - 1e-9);
+    auto values = s.get_all(postings);
+    for(size_t i = 0; i < postings.size(); ++i)
+      if(std::fabs(values[i] - s.get(postings[i])) > 1e-6)
+        throw std::runtime_error("Batched value differs at " + std::to_string(i) + ": " +
+          std::to_string(values[i]) + " vs " + std::to_string(s.get(postings[i])));
+  };
+  check(skadi::sample("test/data/sample"), -77, 40, 1);
+  check(skadi::sample("test/data/samplelz"), -77, 40, 1);
+  //a couple of rows of data above a row of no data
+  check(testable_sample_t("/dev/null"), -180, -89 - 1.9 / 3600, 1.9 / 3600);
+}
+
+void blocks() {
+  std::vector<int16_t> tile(3601 * 3601, 0);
+  for (const auto& p : pixels)
+    tile[p.first] = p.second;
+
+  //every block should come back to the same place
+  auto blocks = skadi::block_hgt::pack(tile.data());
+  if(!skadi::block_hgt::valid(blocks.data(), blocks.size()))
+    throw std::logic_error("Packed blocks should be valid");
+  if(skadi::block_hgt::valid(blocks.data(), blocks.size() - 1))
+    throw std::logic_error("Truncated blocks should not be valid");
+  std::vector<int16_t> unpacked(tile.size(), 1);
+  for(size_t b = 0; b < skadi::block_hgt::kBlockCount; ++b)
+    skadi::block_hgt::unpack(blocks.data(), b, unpacked.data());
+  if(unpacked != tile)
+    throw std::logic_error("Unpacked blocks should match the tile");
+
+  //mangle the upper left block, only lookups that touch it should notice
+  const auto* offsets = static_cast<const uint64_t*>(static_cast<const void*>(blocks.data() + sizeof(skadi::block_hgt::header_t)));
+  std::fill(blocks.begin() + offsets[0], blocks.begin() + offsets[1], 0xFF);
+  {
+    std::ofstream file("test/data/sampleblk/N00/N00E000.hgt.blk", std::ios::binary | std::ios::trunc);
+    file.write(blocks.data(), blocks.size());
+  }
+  skadi::sample s("test/data/sampleblk");
+  if(std::fabs(490 - s.get(std::make_pair(0.496085, 0.678783))) > 1.0)
+    throw std::runtime_error("Wrong value at location: " + std::to_string(s.get(std::make_pair(0.496085, 0.678783))));
+  if(s.get(std::make_pair(0.01, 0.99)) != skadi::sample::get_no_data_value())
+    throw std::logic_error("Corrupt block should have no data");
+  auto heights = s.get_all(std::vector<std::pair<double, double> >{{0.496085, 0.678783}, {0.5, 0.5}, {0.9, 0.1}});
+  for(const auto height : heights)
+    if(height == skadi::sample::get_no_data_value())
+      throw std::logic_error("Postings away from the corrupt block should have data");
+}
+
+struct cached_sample_t : public skadi::sample {
+  using skadi::sample::sample;
+  using skadi::sample::source;
+};
+
+void lru() {
+  //a second compressed tile to go back and forth with
+  {
+    std::vector<int16_t> tile(3601 * 3601, 0);
+    for (const auto& p : pixels)
+      tile[p.first] = p.second;
+    auto gzipped = gzip(tile);
+    std::ofstream gzfile("test/data/samplegz/N00/N00E000.hgt.gz", std::ios::binary | std::ios::trunc);
+    gzfile.write(static_cast<const char*>(static_cast<void*>(gzipped.data())), gzipped.size());
+  }
+  uint16_t a = 130 * 360 + 103, b = 90 * 360 + 180;
+  const auto& pixel = *pixels.begin();
+
+  //a tile pushed out of the cache stays valid for whoever still has it
+  cached_sample_t one("test/data/samplegz", 1);
+  auto a1 = one.source(a);
+  auto b1 = one.source(b);
+  if(!a1 || !b1 || a1.get() == b1.get())
+    throw std::logic_error("Expected two different tiles");
+  if(a1.get()[pixel.first] != pixel.second)
+    throw std::logic_error("Evicted tile should still be usable");
+  if(one.source(a).get() == a1.get())
+    throw std::logic_error("Evicted tile should have been decompressed again");
+
+  //with room for both they should both stay cached
+  cached_sample_t two("test/data/samplegz", 2);
+  a1 = two.source(a);
+  b1 = two.source(b);
+  if(two.source(a).get() != a1.get() || two.source(b).get() != b1.get())
+    throw std::logic_error("Tiles should have stayed in the cache");
+
+  //a sampler sharing the mapped tiles decompresses its own
+  cached_sample_t other(two, 2);
+  auto a2 = other.source(a);
+  if(!a2 || a2.get() == a1.get() || a2.get()[pixel.first] != pixel.second)
+    throw std::logic_error("Samplers sharing mapped tiles should each have their own cache");
+  if(other.source(a).get() != a2.get())
+    throw std::logic_error("Tile should have stayed in the other cache");
+
+  //zig zag across the tiles from a few threads at once
+  std::vector<std::pair<double, double> > postings;
+  for(size_t i = 0; i < 100; ++i) {
+    postings.emplace_back(-76.503915, 40.678783);
+    postings.emplace_back(0.496085, 0.678783);
+  }
+  std::vector<std::thread> threads;
+  std::vector<std::vector<double> > heights(4);
+  for(auto& h : heights)
+    threads.emplace_back([&one, &postings, &h](){ h = one.get_all(postings); });
+  for(auto& t : threads)
+    t.join();
+  for(const auto& h : heights)
+    for(const auto height : h)
+      if(std::fabs(490 - height) > 1.0)
+        throw std::runtime_error("Wrong value while sharing the cache: " + std::to_string(height));
+}
+
 }
 
 int main() {
@@ -197,7 +327,15 @@ int main() {
 
   suite.test(TEST_CASE(getlz));
 
+  suite.test(TEST_CASE(getblk));
+
+  suite.test(TEST_CASE(blocks));
+
   suite.test(TEST_CASE(lazy_load));
 
+  suite.test(TEST_CASE(lru));
+
+  suite.test(TEST_CASE(batched));
+
   return suite.tear_down();
 }
@@ -129,6 +129,14 @@ void make_tile() {
     tile.nodes().emplace_back(add_node(d, 3));
   }
 
+  //everything can go everywhere except cars which can only go from a to d
+  for(auto& edge : tile.directededges()) {
+    edge.set_forwardaccess(kAllAccess);
+    edge.set_reverseaccess(kAllAccess);
+  }
+  tile.directededges()[3].set_reverseaccess(kAllAccess & ~kAutoAccess);
+  tile.directededges()[8].set_forwardaccess(kAllAccess & ~kAutoAccess);
+
   //write the tile
   tile.StoreTileData();
 
@@ -269,6 +277,59 @@ void test_reachability_radius() {
   search({ob, Location::StopType::BREAK, 3, 0}, 2, 3);
 }
 
+void test_access_filter() {
+  auto t = a.first.tileid();
+  auto l = a.first.level();
+  GraphTile tile(tile_dir, tile_id);
+  if(tile.edge_access({t, l, 8}) != ((kAllAccess & ~kAutoAccess) | (kAllAccess << kReverseAccessShift)))
+    throw std::logic_error("Wrong packed edge access");
+
+  //ruling out edges by their access shouldnt change what the filter finds
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  valhalla::baldr::GraphReader reader(conf);
+  auto auto_filter = [](const DirectedEdge* edge) { return edge->forwardaccess() & kAutoAccess ? 1.f : 0.f; };
+  Location x{a.second.MidPoint(d.second)};
+  const auto packed = Search({x}, reader, auto_filter, PassThroughNodeFilter, kAutoAccess).at(x);
+  const auto filtered = Search({x}, reader, auto_filter, PassThroughNodeFilter).at(x);
+  if(!(packed == filtered) || packed.edges.size() != filtered.edges.size())
+    throw std::logic_error("Access should rule out the same edges as the filter");
+  if(packed.edges.size() != 1 || packed.edges.front().id != GraphId(t, l, 3))
+    throw std::logic_error("Cars should only find the edge from a to d");
+
+  //walking can go either way
+  const auto walked = Search({x}, reader, PassThroughEdgeFilter, PassThroughNodeFilter, kPedestrianAccess).at(x);
+  if(walked.edges.size() != 2)
+    throw std::logic_error("Walking should find the edges both ways");
+}
+
+void test_search_threads() {
+  boost::property_tree::ptree conf;
+  conf.put("tile_dir", tile_dir);
+  valhalla::baldr::GraphReader reader(conf), other_reader(conf), third_reader(conf);
+
+  //enough locations along the edges to be split among the readers
+  std::vector<Location> locations;
+  for(int i = 0; i < 60; ++i) {
+    float along = (i / 3 + 1) / 21.f;
+    auto from = i % 3 == 0 ? a.second : b.second;
+    auto to = i % 3 == 1 ? a.second : (i % 3 == 2 ? d.second : c.second);
+    locations.emplace_back(from.AffineCombination(1.f - along, along, to));
+  }
+
+  const auto expected = Search(locations, reader, PassThroughEdgeFilter, PassThroughNodeFilter);
+  const auto results = Search(locations, std::vector<GraphReader*>{&reader, &other_reader, &third_reader},
+    PassThroughEdgeFilter, PassThroughNodeFilter);
+  if(results.size() != expected.size())
+    throw std::logic_error("Wrong number of locations found");
+  for(const auto& location : locations) {
+    const auto& p = results.at(location);
+    const auto& e = expected.at(location);
+    if(!(p == e) || p.edges.size() != e.edges.size())
+      throw std::logic_error("Searching on several threads should find the same edges");
+  }
+}
+
 }
 
 int main() {
@@ -280,5 +341,9 @@ int main() {
 
   suite.test(TEST_CASE(test_reachability_radius));
 
+  suite.test(TEST_CASE(test_access_filter));
+
+  suite.test(TEST_CASE(test_search_threads));
+
   return suite.tear_down();
 }
@@ -0,0 +1,93 @@
+#include "test.h"
+
+#include <algorithm>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/segmentindex.h"
+#include "baldr/tilehierarchy.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+  boost::property_tree::ptree config() {
+    boost::property_tree::ptree conf;
+    conf.put("tile_dir", "test/traffic_matcher_tiles");
+    return conf;
+  }
+
+  const GraphTile* local_tile(GraphReader& graphreader) {
+    const auto level = TileHierarchy::levels().rbegin()->first;
+    return graphreader.GetGraphTile(*graphreader.GetTileSet(level).begin());
+  }
+
+  void TestQuery() {
+    GraphReader graphreader(config());
+    const auto* tile = local_tile(graphreader);
+    SegmentIndex index(*tile, graphreader, 100);
+
+    // Every edge with a segment crossing a range is found in each bin
+    size_t found = 0;
+    for (size_t b = 0; b < kBinCount; ++b) {
+      const auto& bin = index.bin(b);
+      if (bin.edgeids.size() != bin.lengths.size() || bin.first_segment.size() != bin.edgeids.size() + 1 ||
+          bin.ux.size() != bin.first_segment.back() || bin.cell_offsets.size() != bin.cells.size() + 1)
+        throw runtime_error("Expected the arrays of a bin to line up");
+      for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 10; ++j) {
+          const auto x = bin.bounds.minx() + bin.bounds.Width() * i / 10.f;
+          const auto y = bin.bounds.miny() + bin.bounds.Height() * j / 10.f;
+          AABB2<PointLL> range(x, y, x + bin.bounds.Width() / 7.f, y + bin.bounds.Height() / 13.f);
+          std::vector<uint32_t> indexes;
+          bin.Query(range, indexes);
+          if (!std::is_sorted(indexes.begin(), indexes.end()) ||
+              std::adjacent_find(indexes.begin(), indexes.end()) != indexes.end())
+            throw runtime_error("Expected the edges sorted and without duplicates");
+
+          AABB2<PointLL> clipped(std::max(range.minx(), bin.bounds.minx()), std::max(range.miny(), bin.bounds.miny()),
+                                 std::min(range.maxx(), bin.bounds.maxx()), std::min(range.maxy(), bin.bounds.maxy()));
+          for (uint32_t e = 0; e < bin.edgeids.size(); ++e) {
+            for (auto s = bin.first_segment[e]; s < bin.first_segment[e + 1]; ++s) {
+              if (clipped.Intersects(PointLL(bin.ux[s], bin.uy[s]), PointLL(bin.vx[s], bin.vy[s]))) {
+                if (!std::binary_search(indexes.begin(), indexes.end(), e))
+                  throw runtime_error("Expected an edge crossing the range to be found");
+                found++;
+                break;
+              }
+            }
+          }
+        }
+      }
+    }
+    if (found == 0)
+      throw runtime_error("Expected some edges in the bins of the test tile");
+  }
+
+  void TestShared() {
+    // A tile keeps its index until asked for other divisions
+    GraphReader graphreader(config());
+    const auto* tile = local_tile(graphreader);
+    if (tile->segment_index())
+      throw runtime_error("Expected no segment index until one is asked for");
+    auto index = graphreader.GetSegmentIndex(tile, 100);
+    if (tile->segment_index() != index || graphreader.GetSegmentIndex(tile, 100) != index)
+      throw runtime_error("Expected the segment index to be kept with the tile");
+    auto other = graphreader.GetSegmentIndex(tile, 50);
+    if (other == index || other->divisions() != 50 || tile->segment_index() != other)
+      throw runtime_error("Expected another segment index for other divisions");
+  }
+
+}
+
+int main(void)
+{
+  test::suite suite("segmentindex");
+
+  suite.test(TEST_CASE(TestQuery));
+  suite.test(TEST_CASE(TestShared));
+
+  return suite.tear_down();
+}
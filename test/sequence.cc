@@ -1,4 +1,5 @@
 #include <cstdint>
+#include <random>
 #include "test.h"
 #include "midgard/sequence.h"
 
@@ -71,6 +72,90 @@ void test_iterator() {
     throw std::runtime_error("Pre-decrement operator wasn't right");
 }
 
+void test_read_only_map() {
+  size_t count = 16;
+  auto file_name = write_nodes(count);
+  sort_nodes(file_name);
+  mem_map<osm_node> nodes(file_name, count, POSIX_MADV_NORMAL, true);
+  for(uint64_t i = 0; i < count; ++i)
+    if(nodes.get()[i].id != i)
+      throw std::runtime_error("Read only map found wrong node at: " + std::to_string(i));
+}
+
+void test_external_sort() {
+  //shuffled ids with plenty of duplicates
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<uint64_t> ids(0, 99999);
+  std::vector<uint64_t> expected;
+  {
+    sequence<osm_node> sequence("nodes.nd", true);
+    for(uint32_t i = 0; i < 300000; ++i) {
+      expected.push_back(ids(gen));
+      sequence.push_back({expected.back(), 0.f, 0.f, i});
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+
+  //sorted on threads in memory and in runs that are merged back together
+  auto less_than = [](const osm_node& a, const osm_node& b){return a.id < b.id;};
+  for(size_t buffer_size : {size_t(1000000), size_t(70000), size_t(1234)}) {
+    sequence<osm_node> sequence("nodes.nd", false);
+    sequence.sort(less_than, buffer_size, 4);
+    if(sequence.size() != expected.size())
+      throw std::runtime_error("Sorting changed the number of nodes");
+    for(size_t i = 0; i < expected.size(); ++i)
+      if((*sequence[i]).id != expected[i])
+        throw std::runtime_error("Found wrong node at: " + std::to_string(i));
+  }
+}
+
+void test_compressed() {
+  //write more than a block and read it back in and out of order
+  const uint64_t count = 10000;
+  {
+    compressed_sequence<osm_node> sequence("nodes.lz4", true, 512, 4);
+    for(uint64_t i = 0; i < count / 2; ++i)
+      sequence.push_back({i * 2, 1.f, 2.f, 3});
+  }
+  {
+    //append to it after opening it again
+    compressed_sequence<osm_node> sequence("nodes.lz4", false, 512, 4);
+    for(uint64_t i = count / 2; i < count; ++i)
+      sequence.push_back({i * 2, 1.f, 2.f, 3});
+  }
+  compressed_sequence<osm_node> sequence("nodes.lz4", false, 512, 4);
+  if(sequence.size() != count)
+    throw std::runtime_error("Wrong number of compressed nodes " + std::to_string(sequence.size()));
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<uint64_t> index(0, count - 1);
+  for(int i = 0; i < 2000; ++i) {
+    auto j = index(gen);
+    if((*sequence[j]).id != j * 2)
+      throw std::runtime_error("Found wrong compressed node at: " + std::to_string(j));
+  }
+
+  //binary search it
+  auto less_than = [](const osm_node& a, const osm_node& b){return a.id < b.id;};
+  if(sequence.find({4242}, less_than).position() != 2121 || sequence.find({4243}, less_than) != sequence.end())
+    throw std::runtime_error("Binary search of the compressed nodes was wrong");
+
+  //change them all and then stream through them
+  sequence.transform([](osm_node& node){ node.attributes = node.id + 1; });
+  uint64_t i = 0;
+  sequence.enumerate([&i](const osm_node& node){
+    if(node.id != i * 2 || node.attributes != node.id + 1)
+      throw std::runtime_error("Found wrong transformed node at: " + std::to_string(i));
+    ++i;
+  });
+  if(i != count || sequence.back().attributes != (count - 1) * 2 + 1)
+    throw std::runtime_error("Expected all the transformed nodes");
+
+  //sort them the other way around
+  sequence.sort([](const osm_node& a, const osm_node& b){return a.id > b.id;}, 1000, 2);
+  if(sequence.size() != count || sequence.front().id != (count - 1) * 2 || sequence.back().id != 0 ||
+     (*sequence[1234]).id != (count - 1 - 1234) * 2)
+    throw std::runtime_error("Sorting the compressed nodes was wrong");
+}
 
 int main() {
   test::suite suite("sequence");
@@ -79,5 +164,11 @@ int main() {
 
   suite.test(TEST_CASE(test_iterator));
 
+  suite.test(TEST_CASE(test_read_only_map));
+
+  suite.test(TEST_CASE(test_external_sort));
+
+  suite.test(TEST_CASE(test_compressed));
+
   return suite.tear_down();
 }
@@ -0,0 +1,106 @@
+#include "test.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/shard_map.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+  boost::property_tree::ptree json_to_pt(const std::string& json) {
+    std::stringstream ss;
+    ss << json;
+    boost::property_tree::ptree pt;
+    boost::property_tree::read_json(ss, pt);
+    return pt;
+  }
+
+  const std::string regions = R"("regions": [
+    {"name": "benelux", "url": "http://benelux:8002", "bbox": [2.5, 49.4, 7.3, 53.6]},
+    {"name": "germany", "url": "http://germany:8002", "bbox": [5.8, 47.2, 15.1, 55.1]},
+    {"name": "planet", "url": "http://planet:8002", "bbox": [-180, -90, 180, 90]}])";
+
+  const PointLL utrecht(5.1f, 52.09f);
+  const PointLL berlin(13.4f, 52.5f);
+
+  std::string owner(const ShardMap& shards, const std::vector<PointLL>& locations,
+                    float radius = 0.f) {
+    const auto* shard = shards.Owner(locations, radius);
+    return shard ? shard->name : "none";
+  }
+
+  void TestConfig() {
+    ShardMap shards(json_to_pt(R"({"self": "benelux", "fallback": "planet", )" + regions + "}"));
+    if (shards.shards().size() != 3 || shards.self().name != "benelux" ||
+        shards.self().url != "http://benelux:8002")
+      throw std::runtime_error("Regions were not read as configured");
+    if (!shards.fallback() || shards.fallback()->name != "planet")
+      throw std::runtime_error("Fallback should be the planet");
+    if (ShardMap(json_to_pt(R"({"self": "germany", )" + regions + "}")).fallback())
+      throw std::runtime_error("There should be no fallback unless one is configured");
+
+    auto refused = [](const std::string& json) {
+      try {
+        ShardMap shards(json_to_pt(json));
+      } catch (const std::exception&) { return true; }
+      return false;
+    };
+    if (!refused(R"({"self": "france", )" + regions + "}"))
+      throw std::runtime_error("Self has to be one of the regions");
+    if (!refused(R"({"self": "benelux", "fallback": "france", )" + regions + "}"))
+      throw std::runtime_error("Fallback has to be one of the regions");
+    if (!refused(R"({"self": "a", "regions": [{"name": "a", "url": "http://a", "bbox": [1, 2, 3]}]})"))
+      throw std::runtime_error("Bounding boxes need four coordinates");
+  }
+
+  void TestOwner() {
+    ShardMap benelux(json_to_pt(R"({"self": "benelux", )" + regions + "}"));
+    ShardMap germany(json_to_pt(R"({"self": "germany", )" + regions + "}"));
+
+    // Our own region wins when more than one holds the locations
+    if (owner(benelux, {utrecht}) != "benelux")
+      throw std::runtime_error("Utrecht should stay in the benelux");
+    if (owner(germany, {PointLL(6.5f, 51.5f)}) != "germany")
+      throw std::runtime_error("Where the regions overlap our own should be picked");
+    if (owner(benelux, {PointLL(6.5f, 51.5f)}) != "benelux")
+      throw std::runtime_error("Where the regions overlap our own should be picked");
+
+    // Otherwise the first region that holds them all
+    if (owner(benelux, {berlin}) != "germany")
+      throw std::runtime_error("Berlin should go to germany");
+    if (owner(benelux, {utrecht, berlin}) != "planet")
+      throw std::runtime_error("A route across regions should go to the one holding both");
+
+    // Locations whose tiles are only partly in the region
+    if (owner(benelux, {PointLL(7.2f, 52.f)}) != "benelux")
+      throw std::runtime_error("All tiles of a location inside the box should be held");
+    if (owner(benelux, {PointLL(7.6f, 52.f)}) != "germany")
+      throw std::runtime_error("A location past the box should not be held");
+    if (owner(benelux, {PointLL(7.2f, 52.f)}, 50000.f) != "germany")
+      throw std::runtime_error("Tiles within the radius of a location should all be held");
+
+    // Nobody holds it all
+    ShardMap split(json_to_pt(R"({"self": "benelux", "regions": [
+      {"name": "benelux", "url": "http://benelux:8002", "bbox": [2.5, 49.4, 7.3, 53.6]},
+      {"name": "germany", "url": "http://germany:8002", "bbox": [5.8, 47.2, 15.1, 55.1]}]})"));
+    if (owner(split, {utrecht, berlin}) != "none")
+      throw std::runtime_error("No region should hold locations in both");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("shard_map");
+
+  suite.test(TEST_CASE(TestConfig));
+  suite.test(TEST_CASE(TestOwner));
+
+  return suite.tear_down();
+}
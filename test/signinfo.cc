@@ -13,6 +13,11 @@ using valhalla::mjolnir::GraphBuilder;
 
 namespace {
 
+void SetExitTo(OSMData& osmdata, const OSMNode& node, const std::string& exit_to) {
+  osmdata.node_exit_to.insert(node.osmid, osmdata.name_offset_map.index(exit_to));
+  osmdata.node_exit_to.sort();
+}
+
 void ExitToTest() {
   OSMNode node{1234};
   OSMWay way{};
@@ -23,7 +28,7 @@ void ExitToTest() {
   node.set_exit_to(true);
 
 
-  osmdata.node_exit_to[node.osmid] = "US 11;To I 81;Carlisle;Harrisburg";
+  SetExitTo(osmdata, node, "US 11;To I 81;Carlisle;Harrisburg");
 
   std::vector<SignInfo> exitsigns;
   exitsigns = GraphBuilder::CreateExitSignInfoList(node, way, osmdata, fork, forward);
@@ -41,7 +46,7 @@ void ExitToTest() {
   else throw std::runtime_error("US 11/To I 81/Carlisle/Harrisburg failed to be parsed.  " + std::to_string(exitsigns.size()) );
 
   exitsigns.clear();
-  osmdata.node_exit_to[node.osmid] = "US 11;Toward I 81;Carlisle;Harrisburg";
+  SetExitTo(osmdata, node, "US 11;Toward I 81;Carlisle;Harrisburg");
 
   exitsigns = GraphBuilder::CreateExitSignInfoList(node, way, osmdata, fork, forward);
 
@@ -57,7 +62,7 @@ void ExitToTest() {
   else throw std::runtime_error("US 11;Toward I 81;Carlisle;Harrisburg failed to be parsed.");
 
   exitsigns.clear();
-  osmdata.node_exit_to[node.osmid] = "I 95 To I 695";
+  SetExitTo(osmdata, node, "I 95 To I 695");
 
   exitsigns = GraphBuilder::CreateExitSignInfoList(node, way, osmdata, fork, forward);
 
@@ -74,7 +79,7 @@ void ExitToTest() {
   else throw std::runtime_error("I 95 To I 695 failed to be parsed.");
 
   exitsigns.clear();
-  osmdata.node_exit_to[node.osmid] = "I 495 Toward I 270";
+  SetExitTo(osmdata, node, "I 495 Toward I 270");
 
   exitsigns = GraphBuilder::CreateExitSignInfoList(node, way, osmdata, fork, forward);
 
@@ -91,7 +96,7 @@ void ExitToTest() {
   else throw std::runtime_error("I 495 Toward I 270 failed to be parsed.");
 
   exitsigns.clear();
-  osmdata.node_exit_to[node.osmid] = "I 495 Toward I 270 To I 95";//default to toward.  Punt on parsing.
+  SetExitTo(osmdata, node, "I 495 Toward I 270 To I 95");//default to toward.  Punt on parsing.
 
   exitsigns = GraphBuilder::CreateExitSignInfoList(node, way, osmdata, fork, forward);
 
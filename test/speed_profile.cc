@@ -0,0 +1,63 @@
+#include "test.h"
+
+#include "baldr/speed_profile.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+  void test_sizeof() {
+    if (sizeof(SpeedProfile) != kSpeedProfileBuckets)
+      throw std::runtime_error("SpeedProfile size should be " + std::to_string(kSpeedProfileBuckets) +
+                " bytes but is " + std::to_string(sizeof(SpeedProfile)));
+    if (SpeedProfileIndexSize(3) != 8 || SpeedProfileIndexSize(4) != 8 || SpeedProfileIndexSize(0) != 0)
+      throw std::runtime_error("SpeedProfile index should be padded to 4 bytes");
+  }
+
+  void TestSpeed() {
+    // Slow at 8 on monday morning, fast the hour after and 40 the rest of the week
+    std::vector<uint8_t> speeds(kSpeedProfileBuckets, 40);
+    uint32_t monday_8am = (24 + 8) * kSecondsPerSpeedBucket;
+    speeds[monday_8am / kSecondsPerSpeedBucket] = 20;
+    speeds[monday_8am / kSecondsPerSpeedBucket + 1] = 80;
+    SpeedProfile profile(speeds);
+
+    if (profile.speed(monday_8am) != 20)
+      throw runtime_error("Speed at the start of an hour should be the speed of the hour");
+    if (profile.speed(monday_8am + kSecondsPerSpeedBucket / 2) != 50)
+      throw runtime_error("Speed should be interpolated between hours");
+    if (profile.speed(monday_8am + kSecondsPerSpeedBucket) != 80)
+      throw runtime_error("Speed should be the speed of the next hour");
+    if (profile.speed(monday_8am + kSecondsPerWeek) != 20)
+      throw runtime_error("Speed should wrap around the end of the week");
+    if (profile.speed(kSecondsPerWeek - kSecondsPerSpeedBucket / 2) != 40)
+      throw runtime_error("Speed should interpolate into the start of the week");
+  }
+
+  void TestMissing() {
+    // Hours without speeds have none and don't pull their neighbours down
+    std::vector<uint8_t> speeds(kSpeedProfileBuckets, 0);
+    speeds[1] = 60;
+    SpeedProfile profile(speeds);
+    if (profile.speed(kSecondsPerSpeedBucket / 2) != 0)
+      throw runtime_error("Hour without a speed should have none");
+    if (profile.speed(kSecondsPerSpeedBucket * 3 / 2) != 60)
+      throw runtime_error("Hour before one without a speed should keep its speed");
+    if (SpeedProfile().speed(1234) != 0)
+      throw runtime_error("Default SpeedProfile should have no speeds");
+    if (!(SpeedProfile(speeds) == profile) || SpeedProfile() == profile)
+      throw runtime_error("SpeedProfiles should compare by their speeds");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("speed_profile");
+
+  suite.test(TEST_CASE(test_sizeof));
+  suite.test(TEST_CASE(TestSpeed));
+  suite.test(TEST_CASE(TestMissing));
+
+  return suite.tear_down();
+}
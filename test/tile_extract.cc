@@ -0,0 +1,98 @@
+#include <cstdint>
+#include "test.h"
+
+#include "baldr/graphreader.h"
+#include "midgard/sequence.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+const std::string extract_file = "test/data/tile_extract_test.tar";
+
+// Same layout valhalla_build_extract writes for each tile
+struct index_entry_t {
+  uint64_t offset;
+  uint32_t tile_id;
+  uint32_t size;
+};
+
+std::string tar_header(const std::string& name, const size_t size, const bool valid = true) {
+  tar::header_t header{};
+  std::strncpy(header.name, name.c_str(), sizeof(header.name));
+  std::snprintf(header.mode, sizeof(header.mode), "%07o", 0644);
+  std::snprintf(header.size, sizeof(header.size), "%011o", static_cast<unsigned>(size));
+  header.typeflag = '0';
+  std::memcpy(header.magic, "ustar", 6);
+  std::memset(header.chksum, ' ', sizeof(header.chksum));
+  unsigned sum = 0;
+  for (size_t i = 0; i < sizeof(header); ++i)
+    sum += reinterpret_cast<const unsigned char*>(&header)[i];
+  std::snprintf(header.chksum, sizeof(header.chksum), "%06o", sum + (valid ? 0 : 1));
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+std::string padded(std::string data) {
+  data.resize((data.size() + sizeof(tar::header_t) - 1) / sizeof(tar::header_t) * sizeof(tar::header_t), '\0');
+  return data;
+}
+
+std::string tile(const GraphId& id) {
+  GraphTileHeader header;
+  header.set_graphid(id);
+  header.set_end_offset(sizeof(GraphTileHeader));
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void TestIndexedExtract() {
+  // The tile headers are corrupt so the tiles can only be found through the index
+  GraphId a(0, 2, 0), b(5, 1, 0);
+  std::vector<std::pair<GraphId, std::string> > tiles{{a, tile(a)}, {b, tile(b)}};
+  std::string index, members;
+  size_t offset = sizeof(tar::header_t) + padded(std::string(tiles.size() * sizeof(index_entry_t), '\0')).size();
+  for (const auto& t : tiles) {
+    offset += sizeof(tar::header_t);
+    index_entry_t entry{offset, static_cast<uint32_t>(t.first.value), static_cast<uint32_t>(t.second.size())};
+    index.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    members += tar_header("tiles/" + GraphTile::FileSuffix(t.first), t.second.size(), false) + padded(t.second);
+    offset += padded(t.second).size();
+  }
+  boost::filesystem::create_directories("test/data");
+  std::ofstream(extract_file, std::ios::binary) << tar_header("index.bin", index.size()) << padded(index)
+                                                << members << std::string(2 * sizeof(tar::header_t), '\0');
+
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/tile_extract_test_nowhere");
+  pt.put("tile_extract", extract_file);
+  GraphReader reader(pt);
+  for (const auto& t : tiles) {
+    const auto* found = reader.GetGraphTile(t.first);
+    if (!found || found->id() != t.first)
+      throw std::runtime_error("Tile " + std::to_string(t.first.value) + " should be found through the index");
+    if (!reader.DoesTileExist(t.first) || !GraphReader::DoesTileExist(pt, t.first))
+      throw std::runtime_error("Tile " + std::to_string(t.first.value) + " should exist");
+  }
+  if (reader.GetGraphTile(GraphId(1, 2, 0)) || reader.DoesTileExist(GraphId(1, 2, 0)))
+    throw std::runtime_error("Tiles not in the index should not be found");
+  auto tile_set = reader.GetTileSet();
+  if (tile_set.size() != 2 || reader.GetTileSet(2).size() != 1 || !reader.GetTileSet(2).count(a))
+    throw std::runtime_error("The tile set should come from the index");
+
+  std::remove(extract_file.c_str());
+}
+
+}
+
+int main() {
+  test::suite suite("tile_extract");
+
+  suite.test(TEST_CASE(TestIndexedExtract));
+
+  return suite.tear_down();
+}
@@ -4,6 +4,7 @@
 #include "midgard/pointll.h"
 #include "midgard/util.h"
 
+#include <algorithm>
 #include <random>
 
 using namespace valhalla::midgard;
@@ -252,6 +253,17 @@ void test_random_linestring() {
       for(auto sub : tile.second)
         if(sub > 24)
           throw std::runtime_error("Non-existant bin!");
+    //the flat list should have the same cells once each and in order
+    std::vector<std::pair<int32_t, unsigned short> > cells;
+    t.Intersect(linestring, cells);
+    size_t count = 0;
+    for(auto tile : answer)
+      count += tile.second.size();
+    if(cells.size() != count || !std::is_sorted(cells.begin(), cells.end()))
+      throw std::runtime_error("Flat intersection should have each cell once in order");
+    for(const auto& cell : cells)
+      if(!answer[cell.first].count(cell.second))
+        throw std::runtime_error("Flat intersection has a cell the map doesnt");
   }
 }
 
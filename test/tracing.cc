@@ -0,0 +1,73 @@
+#include "test.h"
+#include "midgard/tracing.h"
+#include "midgard/metrics.h"
+
+#include <string>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+void UntracedTest() {
+  //nothing is recorded without a trace
+  if(tracing::current() != nullptr)
+    throw std::runtime_error("No thread should start out tracing");
+  tracing::ScopedSpan span("nothing");
+}
+
+void SpanTest() {
+  tracing::trace_t trace;
+  trace.id = tracing::new_trace_id();
+  trace.parent = 42;
+  {
+    tracing::ScopedTrace scope(trace);
+    tracing::ScopedSpan outer("outer");
+    {
+      tracing::ScopedSpan inner("inner");
+    }
+    //the timers of the stages are spans too
+    METRICS_TIME(kLokiSearch);
+  }
+  if(tracing::current() != nullptr)
+    throw std::runtime_error("Tracing should stop with the scope");
+
+  //children hang off of whatever span was open when they started
+  if(trace.spans.size() != 3 || trace.spans[0].name != "outer" || trace.spans[1].name != "inner" ||
+     trace.spans[2].name != "loki_search")
+    throw std::runtime_error("Wrong spans recorded");
+  if(trace.spans[0].parent != 42 || trace.spans[1].parent != trace.spans[0].id ||
+     trace.spans[2].parent != trace.spans[0].id || trace.parent != 42)
+    throw std::runtime_error("Spans should nest");
+  for(const auto& span : trace.spans)
+    if(span.id == 0 || span.end < span.start)
+      throw std::runtime_error("Spans should have an id and a start before their end");
+}
+
+void IdTest() {
+  auto trace_id = tracing::new_trace_id();
+  if(trace_id.size() != 32 || trace_id.find_first_not_of("0123456789abcdef") != std::string::npos)
+    throw std::runtime_error("Trace ids should be 32 hex digits");
+  if(tracing::to_hex(0xab) != "00000000000000ab" || tracing::from_hex("00000000000000ab") != 0xab)
+    throw std::runtime_error("Span ids should round trip through hex");
+  if(tracing::from_hex("00000000000000aX") != 0 || tracing::from_hex("ab") != 0)
+    throw std::runtime_error("Malformed span ids should not parse");
+
+  tracing::trace_t trace;
+  trace.id = trace_id;
+  tracing::span_t span{"thor", 0xab, 0, 1, 3};
+  auto json = tracing::to_json(trace, span);
+  if(json != R"({"traceId":")" + trace_id + R"(","spanId":"00000000000000ab","name":"thor","startTimeUnixNano":1000,"endTimeUnixNano":3000})")
+    throw std::runtime_error("Wrong json for a span: " + json);
+}
+
+}
+
+int main() {
+  test::suite suite("tracing");
+
+  suite.test(TEST_CASE(UntracedTest));
+  suite.test(TEST_CASE(SpanTest));
+  suite.test(TEST_CASE(IdTest));
+
+  return suite.tear_down();
+}
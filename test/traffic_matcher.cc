@@ -74,7 +74,7 @@ namespace {
     //then finish it and you should see partial, then full and the full should not count the length of the partial in it
   };
 
-  void test_matcher() {
+  boost::property_tree::ptree config() {
     //fake config
     std::stringstream conf_json; conf_json << R"({
       "mjolnir":{"tile_dir":"test/traffic_matcher_tiles"},
@@ -86,9 +86,12 @@ namespace {
     })";
     boost::property_tree::ptree conf;
     boost::property_tree::read_json(conf_json, conf);
+    return conf;
+  }
 
+  void test_matcher() {
     //find me a find, catch me a catch
-    testable_matcher matcher(conf);
+    testable_matcher matcher(config());
 
     //some edges should have no matches and most will have no segments
     for(const auto& test_case : test_cases) {
@@ -126,6 +129,91 @@ namespace {
 
   }
 
+  void test_bulk() {
+    //the testable one keeps state so only the plain one can run on threads
+    auto conf = config();
+    testable_matcher matcher(conf);
+    meili::TrafficSegmentMatcher bulk_matcher(conf);
+    meili::BatchMatcher batch(conf, 3);
+
+    //the traces of the test cases in binary
+    std::stringstream probes;
+    for(size_t i = 0; i < test_cases.size(); ++i) {
+      std::stringstream json_ss; json_ss << test_cases[i].first;
+      boost::property_tree::ptree request;
+      boost::property_tree::read_json(json_ss, request);
+      meili::probe_trace_t header{100 + i, 0, 0};
+      for(const auto& pt : request.get_child("trace"))
+        header.point_count++;
+      probes.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      for(const auto& pt : request.get_child("trace")) {
+        meili::probe_point_t point{pt.second.get<double>("lon"), pt.second.get<double>("lat"),
+                                   pt.second.get<double>("time"), 0.f, 0};
+        probes.write(reinterpret_cast<const char*>(&point), sizeof(point));
+      }
+    }
+
+    //read them back
+    std::vector<uint64_t> ids;
+    std::vector<std::vector<meili::Measurement> > traces;
+    uint64_t trace_id;
+    std::vector<meili::Measurement> measurements;
+    while(meili::TrafficSegmentMatcher::read_trace(probes, 5.f, 50.f, trace_id, measurements)) {
+      ids.push_back(trace_id);
+      traces.push_back(measurements);
+    }
+    if(traces.size() != test_cases.size() || ids.back() != 100 + test_cases.size() - 1 || traces.front().front().gps_accuracy() != 5.f)
+      throw std::logic_error("wrong traces read from binary probes");
+
+    //the same segments as one at a time through json
+    boost::property_tree::ptree match_config;
+    match_config.put("breakage_distance", 10000);
+    std::vector<std::vector<meili::traffic_segment_t> > bulk(traces.size());
+    bulk_matcher.match(batch, match_config, traces,
+      [&bulk](size_t index, std::vector<meili::traffic_segment_t>&& segments, const std::string& error) {
+        if(!error.empty())
+          throw std::logic_error("bulk match failed: " + error);
+        bulk[index] = std::move(segments);
+      });
+    for(size_t i = 0; i < test_cases.size(); ++i) {
+      matcher.match(test_cases[i].first);
+      const auto& a_segs = matcher.segments;
+      const auto& b_segs = bulk[i];
+      if(a_segs.size() != b_segs.size())
+        throw std::logic_error("wrong number of segments matched in bulk");
+      for(size_t j = 0; j < a_segs.size(); ++j) {
+        if(a_segs[j].segment_id != b_segs[j].segment_id || a_segs[j].start_time != b_segs[j].start_time ||
+           a_segs[j].end_time != b_segs[j].end_time || a_segs[j].length != b_segs[j].length ||
+           a_segs[j].begin_shape_index != b_segs[j].begin_shape_index || a_segs[j].end_shape_index != b_segs[j].end_shape_index)
+          throw std::logic_error("bulk segment differs from the json match");
+      }
+
+      //and written as records
+      std::stringstream out;
+      meili::TrafficSegmentMatcher::write_segments(out, ids[i], b_segs);
+      meili::segment_speed_t record;
+      for(const auto& segment : b_segs) {
+        if(!out.read(reinterpret_cast<char*>(&record), sizeof(record)) || record.trace_id != ids[i] ||
+           record.segment_id != segment.segment_id.value || record.length != segment.length ||
+           record.start_time != segment.start_time)
+          throw std::logic_error("wrong segment speed record");
+      }
+      if(out.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        throw std::logic_error("expected a record per segment");
+    }
+
+    //a bad trace fails alone
+    traces.front().erase(traces.front().begin() + 1, traces.front().end());
+    size_t failed = 0;
+    bulk_matcher.match(batch, match_config, traces,
+      [&failed](size_t index, std::vector<meili::traffic_segment_t>&& segments, const std::string& error) {
+        if(!error.empty())
+          failed += index == 0 && segments.empty();
+      });
+    if(failed != 1)
+      throw std::logic_error("expected only the short trace to fail");
+  }
+
 }
 
 int main() {
@@ -133,5 +221,7 @@ int main() {
 
   suite.test(TEST_CASE(test_matcher));
 
+  suite.test(TEST_CASE(test_bulk));
+
   return suite.tear_down();
 }
@@ -0,0 +1,72 @@
+#include "test.h"
+#include "baldr/traffic_speeds.h"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+using namespace valhalla::baldr;
+
+namespace {
+
+const std::string traffic_dir = "test/data/traffic_speeds";
+
+//writes next to it and renames into place like a feed should
+void write_speeds(const uint32_t tileid, const std::vector<uint8_t>& speeds) {
+  auto file = traffic_dir + "/" + std::to_string(tileid) + ".spd";
+  {
+    std::ofstream out(file + ".tmp", std::ios::binary);
+    out.write(reinterpret_cast<const char*>(speeds.data()), speeds.size());
+  }
+  std::rename((file + ".tmp").c_str(), file.c_str());
+}
+
+void TestSpeeds() {
+  boost::filesystem::remove_all(traffic_dir);
+  boost::filesystem::create_directories(traffic_dir);
+  write_speeds(7, {0, 30, 50});
+  write_speeds(9, {100});
+
+  //whats there to begin with
+  TrafficSpeeds traffic(traffic_dir, 0);
+  auto seven = traffic.speeds(7);
+  if(!seven || seven.count != 3 || seven[0] != 0 || seven[1] != 30 || seven[2] != 50)
+    throw std::logic_error("Wrong speeds for tile 7");
+  if(seven[3] != 0)
+    throw std::logic_error("Edges past the end should have no speed");
+  if(traffic.speeds(8))
+    throw std::logic_error("Tile 8 should have no speeds");
+  if(traffic.Refresh())
+    throw std::logic_error("Nothing changed so there should be nothing to refresh");
+
+  //a new file and one thats gone
+  write_speeds(7, {10, 20, 30, 40});
+  boost::filesystem::remove(traffic_dir + "/9.spd");
+  if(!traffic.Refresh())
+    throw std::logic_error("Changes should have been picked up");
+  seven = traffic.speeds(7);
+  if(seven.count != 4 || seven[0] != 10 || seven[3] != 40)
+    throw std::logic_error("Wrong refreshed speeds for tile 7");
+  if(traffic.speeds(9))
+    throw std::logic_error("Tile 9 should have no speeds anymore");
+
+  //not time to look again yet
+  TrafficSpeeds later(traffic_dir, 3600);
+  write_speeds(9, {100});
+  if(later.Refresh() || later.speeds(9))
+    throw std::logic_error("Should not have refreshed before the interval");
+
+  boost::filesystem::remove_all(traffic_dir);
+}
+
+}
+
+int main() {
+  test::suite suite("traffic_speeds");
+
+  //check mapping and refreshing speed files
+  suite.test(TEST_CASE(TestSpeeds));
+
+  return suite.tear_down();
+}
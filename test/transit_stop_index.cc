@@ -0,0 +1,73 @@
+#include "test.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "baldr/transit_stop_index.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+  const std::string index_file = "test_transit_stop_index.bin";
+
+  // A few stops in a city, one on each side of a cell boundary and one far away
+  std::vector<PointLL> stops() {
+    return {PointLL(-76.6101f, 39.2901f), PointLL(-76.6130f, 39.2950f),
+            PointLL(-76.5999f, 39.2999f), PointLL(-76.6001f, 39.3001f),
+            PointLL(13.4050f, 52.5200f)};
+  }
+
+  void check(const transit_stop_index_t& index) {
+    if (index.size() != 5)
+      throw std::runtime_error("Expected 5 stops but got " + std::to_string(index.size()));
+    if (!index.has_stop(PointLL(-76.6105f, 39.2901f), 50.f))
+      throw std::runtime_error("Stop 35m away should be within 50m");
+    if (index.has_stop(PointLL(-76.6105f, 39.2901f), 20.f))
+      throw std::runtime_error("Stop 35m away should not be within 20m");
+    if (!index.has_stop(PointLL(-76.6000f, 39.3000f), 20.f))
+      throw std::runtime_error("Stops across a cell boundary should be found");
+    if (!index.has_stop(PointLL(13.4051f, 52.5201f), 30.f))
+      throw std::runtime_error("Stops far from the rest should be found");
+    if (index.has_stop(PointLL(2.3522f, 48.8566f), 500.f))
+      throw std::runtime_error("There should be no stops where there is no transit");
+  }
+
+  void TestBuilt() {
+    check(transit_stop_index_t(stops()));
+    if (transit_stop_index_t(std::vector<PointLL>{}).has_stop(PointLL(-76.61f, 39.29f), 1000.f))
+      throw std::runtime_error("An empty index should have no stops");
+  }
+
+  void TestMapped() {
+    transit_stop_index_t(stops()).save(index_file);
+    check(transit_stop_index_t(index_file));
+
+    // Anything else is refused
+    {
+      std::ofstream file(index_file, std::ios::out | std::ios::binary | std::ios::trunc);
+      file << "not a transit stop index at all";
+    }
+    bool threw = false;
+    try {
+      transit_stop_index_t mapped(index_file);
+    } catch (const std::exception&) {
+      threw = true;
+    }
+    std::remove(index_file.c_str());
+    if (!threw)
+      throw std::runtime_error("Mapping something other than an index should throw");
+  }
+
+}
+
+int main() {
+  test::suite suite("transit_stop_index");
+
+  suite.test(TEST_CASE(TestBuilt));
+  suite.test(TEST_CASE(TestMapped));
+
+  return suite.tear_down();
+}
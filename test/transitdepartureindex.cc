@@ -0,0 +1,126 @@
+#include "test.h"
+
+#include <algorithm>
+#include <vector>
+#include "baldr/transitdepartureindex.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+  TransitDeparture fixed(uint32_t lineid, uint32_t tripid, uint32_t time,
+                         uint32_t schedule, bool wheelchair = true) {
+    return TransitDeparture(lineid, tripid, 0, 0, 0, time, 60, schedule, wheelchair, true);
+  }
+
+  TransitDeparture frequency(uint32_t lineid, uint32_t tripid, uint32_t start,
+                             uint32_t end, uint32_t every, uint32_t schedule) {
+    return TransitDeparture(lineid, tripid, 0, 0, 0, start, end, every, 60, schedule, true, true);
+  }
+
+  // Departures sorted as tiles store them, by line, type and then time
+  vector<TransitDeparture> departures() {
+    vector<TransitDeparture> departures{
+      fixed(1, 10, 28800, 0), fixed(1, 11, 30600, 1), fixed(1, 12, 32400, 0, false),
+      fixed(1, 13, 36000, 0), fixed(2, 20, 25200, 1), frequency(2, 21, 27000, 30000, 600, 0),
+      fixed(2, 22, 28800, 1), fixed(3, 30, 3600, 0)
+    };
+    std::sort(departures.begin(), departures.end());
+    return departures;
+  }
+
+  uint32_t tripid(const vector<TransitDeparture>& departures, uint32_t found) {
+    return found == kNoDeparture ? 0 : departures[found].tripid();
+  }
+
+  void TestRuns() {
+    auto deps = departures();
+    TransitDepartureIndex index(deps.data(), deps.size());
+    if (index.run_count() != 5)
+      throw runtime_error("Expected 5 runs of departures but got " + to_string(index.run_count()));
+  }
+
+  void TestFixed() {
+    auto deps = departures();
+    TransitDepartureIndex index(deps.data(), deps.size());
+    auto all = [](uint32_t) { return true; };
+    auto only0 = [](uint32_t schedule) { return schedule == 0; };
+    uint32_t time = 0;
+
+    if (tripid(deps, index.Next(1, 28000, all, false, false, time)) != 10 || time != 28800)
+      throw runtime_error("Next departure should be the first one after the current time");
+    if (tripid(deps, index.Next(1, 29000, all, false, false, time)) != 11)
+      throw runtime_error("Next departure should be on the other schedule");
+    if (tripid(deps, index.Next(1, 29000, only0, false, false, time)) != 12)
+      throw runtime_error("Next departure should skip invalid schedules");
+    if (tripid(deps, index.Next(1, 29000, only0, true, false, time)) != 13 || time != 36000)
+      throw runtime_error("Next departure should skip ones without wheelchair access");
+    if (index.Next(1, 36001, all, false, false, time) != kNoDeparture)
+      throw runtime_error("There should be no departures after the last one");
+    if (index.Next(4, 0, all, false, false, time) != kNoDeparture)
+      throw runtime_error("There should be no departures on a line without any");
+  }
+
+  void TestFrequency() {
+    auto deps = departures();
+    TransitDepartureIndex index(deps.data(), deps.size());
+    auto all = [](uint32_t) { return true; };
+    auto only0 = [](uint32_t schedule) { return schedule == 0; };
+    uint32_t time = 0;
+
+    // Tiles order the frequency departures of a line after the fixed ones
+    if (tripid(deps, index.Next(2, 27500, all, false, false, time)) != 22 || time != 28800)
+      throw runtime_error("Fixed departures should come before frequency departures");
+    if (tripid(deps, index.Next(2, 27500, only0, false, false, time)) != 21 || time != 27600)
+      throw runtime_error("Next frequency departure should be the next one after the current time");
+    if (tripid(deps, index.Next(2, 27600, only0, false, false, time)) != 21 || time != 27600)
+      throw runtime_error("Frequency departure at the current time should be taken");
+    if (tripid(deps, index.Next(2, 29900, all, false, false, time)) != 0)
+      throw runtime_error("Frequency departures should end before their end time");
+    if (index.Next(2, 29900, only0, false, false, time) != kNoDeparture)
+      throw runtime_error("Ended frequency departures should not be found");
+  }
+
+
+  void TestPrevious() {
+    auto deps = departures();
+    TransitDepartureIndex index(deps.data(), deps.size());
+    auto all = [](uint32_t) { return true; };
+    auto only0 = [](uint32_t schedule) { return schedule == 0; };
+    uint32_t time = 0;
+
+    // Departures take 60 seconds to get to the end of the line
+    if (tripid(deps, index.Previous(1, 32460, all, false, false, time)) != 12 || time != 32400)
+      throw runtime_error("Previous departure should be the last one arriving by the current time");
+    if (tripid(deps, index.Previous(1, 32459, all, false, false, time)) != 11 || time != 30600)
+      throw runtime_error("Previous departure should be on the other schedule");
+    if (tripid(deps, index.Previous(1, 32459, only0, false, false, time)) != 10)
+      throw runtime_error("Previous departure should skip invalid schedules");
+    if (tripid(deps, index.Previous(1, 36000, only0, true, false, time)) != 10 || time != 28800)
+      throw runtime_error("Previous departure should skip ones without wheelchair access");
+    if (index.Previous(1, 28859, all, false, false, time) != kNoDeparture)
+      throw runtime_error("There should be no departures arriving before the first one");
+
+    if (tripid(deps, index.Previous(2, 28000, only0, false, false, time)) != 21 || time != 27600)
+      throw runtime_error("Previous frequency departure should be the last one arriving by the current time");
+    if (tripid(deps, index.Previous(2, 31000, all, false, false, time)) != 21 || time != 29400)
+      throw runtime_error("Frequency departures should end before their end time");
+    if (tripid(deps, index.Previous(2, 28900, all, false, false, time)) != 22 || time != 28800)
+      throw runtime_error("Previous departure should be the latest of fixed and frequency ones");
+    if (index.Previous(2, 27059, only0, false, false, time) != kNoDeparture)
+      throw runtime_error("Frequency departures should not be found before they start");
+  }
+
+}
+
+int main(void) {
+  test::suite suite("transitdepartureindex");
+
+  suite.test(TEST_CASE(TestRuns));
+  suite.test(TEST_CASE(TestFixed));
+  suite.test(TEST_CASE(TestFrequency));
+  suite.test(TEST_CASE(TestPrevious));
+
+  return suite.tear_down();
+}
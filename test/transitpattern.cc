@@ -0,0 +1,102 @@
+#include "test.h"
+
+#include <algorithm>
+#include <vector>
+#include "baldr/transitpattern.h"
+
+using namespace std;
+using namespace valhalla::baldr;
+
+namespace {
+
+  TransitDeparture fixed(uint32_t lineid, uint32_t tripid, uint32_t time,
+                         uint32_t schedule, uint32_t headsign = 0) {
+    return TransitDeparture(lineid, tripid, 0, 0, headsign, time, 60, schedule, true, true);
+  }
+
+  TransitDeparture frequency(uint32_t lineid, uint32_t tripid, uint32_t start,
+                             uint32_t end, uint32_t every, uint32_t schedule) {
+    return TransitDeparture(lineid, tripid, 0, 0, 0, start, end, every, 60, schedule, true, true);
+  }
+
+  // A line running every half hour on one schedule, a few departures on
+  // another, one with another headsign and a frequency based line
+  vector<TransitDeparture> departures() {
+    vector<TransitDeparture> departures;
+    for (uint32_t i = 0; i < 10; ++i)
+      departures.push_back(fixed(1, 100 + i, 21600 + i * 1800, 0));
+    departures.push_back(fixed(1, 200, 22000, 1));
+    departures.push_back(fixed(1, 201, 26000, 1));
+    departures.push_back(fixed(1, 202, 30000, 0, 7));
+    for (uint32_t i = 0; i < 3; ++i)
+      departures.push_back(frequency(2, 300 + i, 21600 + i * 3600, 25200 + i * 3600, 600, 0));
+    std::sort(departures.begin(), departures.end());
+    return departures;
+  }
+
+  bool same(const TransitDeparture& a, const TransitDeparture& b) {
+    return a.lineid() == b.lineid() && a.tripid() == b.tripid() && a.routeid() == b.routeid() &&
+           a.blockid() == b.blockid() && a.headsign_offset() == b.headsign_offset() &&
+           a.type() == b.type() && a.departure_time() == b.departure_time() &&
+           a.elapsed_time() == b.elapsed_time() && a.schedule_index() == b.schedule_index() &&
+           a.wheelchair_accessible() == b.wheelchair_accessible() &&
+           a.bicycle_accessible() == b.bicycle_accessible() &&
+           (a.type() == kFixedSchedule ||
+            (a.end_time() == b.end_time() && a.frequency() == b.frequency()));
+  }
+
+  void TestEncode() {
+    auto deps = departures();
+    vector<TransitDeparture> others;
+    vector<TransitPattern> patterns;
+    vector<PatternTrip> trips;
+    TransitPattern::Encode(deps, others, patterns, trips);
+
+    // Only the half hourly trips share enough to be worth a pattern
+    if (patterns.size() != 1 || patterns[0].trip_count() != 10 || trips.size() != 10)
+      throw runtime_error("Expected one pattern of 10 trips");
+    if (others.size() != 6)
+      throw runtime_error("Expected 6 departures outside of patterns but got " +
+                          to_string(others.size()));
+    if (!std::is_sorted(others.begin(), others.end()))
+      throw runtime_error("Departures outside of patterns should stay sorted");
+    for (uint32_t i = 1; i < trips.size(); ++i)
+      if (trips[i - 1].departure_time > trips[i].departure_time)
+        throw runtime_error("Pattern trips should be in departure order");
+    if (patterns.size() * sizeof(TransitPattern) + trips.size() * sizeof(PatternTrip) >=
+        patterns[0].trip_count() * sizeof(TransitDeparture))
+      throw runtime_error("Patterns should be smaller than their departures");
+  }
+
+  void TestRoundTrip() {
+    auto deps = departures();
+    vector<TransitDeparture> others;
+    vector<TransitPattern> patterns;
+    vector<PatternTrip> trips;
+    TransitPattern::Encode(deps, others, patterns, trips);
+
+    auto decoded = TransitPattern::Decode(others.data(), others.size(), patterns.data(),
+                                          patterns.size(), trips.data());
+    if (decoded.size() != deps.size())
+      throw runtime_error("Decoding should give back every departure");
+    for (size_t i = 0; i < deps.size(); ++i)
+      if (!same(deps[i], decoded[i]))
+        throw runtime_error("Decoded departure " + to_string(i) + " differs");
+
+    // Nothing to share leaves the departures as they are
+    vector<TransitDeparture> few{fixed(1, 1, 3600, 0), fixed(1, 2, 7200, 0)};
+    TransitPattern::Encode(few, others, patterns, trips);
+    if (!patterns.empty() || !trips.empty() || others.size() != few.size())
+      throw runtime_error("Too few trips should not make a pattern");
+  }
+
+}
+
+int main() {
+  test::suite suite("transitpattern");
+
+  suite.test(TEST_CASE(TestEncode));
+  suite.test(TEST_CASE(TestRoundTrip));
+
+  return suite.tear_down();
+}
@@ -52,6 +52,24 @@ void TestAddAndIndex() {
       throw runtime_error("UniqueNames: name given an index failed");
 }
 
+void TestGrow() {
+  // Enough names that the table has to grow a few times
+  UniqueNames names;
+  for (uint32_t i = 1; i <= 10000; i++) {
+    if (names.index("Street " + std::to_string(i)) != i)
+      throw runtime_error("UniqueNames: names should get indexes in the order they are added");
+  }
+  for (uint32_t i = 1; i <= 10000; i++) {
+    if (names.index("Street " + std::to_string(i)) != i ||
+        names.name(i) != "Street " + std::to_string(i))
+      throw runtime_error("UniqueNames: names should be found after the table grew");
+  }
+  if (names.Size() != 10000)
+    throw runtime_error("UniqueNames Size test failed");
+  if (names.index("") != 0 || names.name(0) != "" || names.name(20000) != "")
+    throw runtime_error("UniqueNames: the blank name should be at index 0");
+}
+
 int main() {
   test::suite suite("uniquenames");
 
@@ -61,5 +79,8 @@ int main() {
   // Test Size
   suite.test(TEST_CASE(TestSize));
 
+  // Test adding many names
+  suite.test(TEST_CASE(TestGrow));
+
   return suite.tear_down();
 }
@@ -198,6 +198,39 @@ void TestResample() {
   }
 }
 
+void TestResampleReuse() {
+  //the vector kernel steps along each segment in doubles rather than from the last float point
+  //placed, so the points may slide along the line a little but should be spaced the same
+  std::vector<PointLL> shape{{-76.5049f, 40.7124f}, {-76.6052f, 40.7122f}, {-76.6052f, 40.7122f},
+                             {-76.8056f, 40.7121f}, {-76.8849f, 40.7224f}, {-76.9052f, 40.8122f}};
+  std::vector<Point2> plane(shape.cbegin(), shape.cend());
+  std::vector<PointLL> resampled{{1.f, 1.f}};
+  for(auto resolution : {10.0, 333.0, 100000.0}) {
+    for(auto preserve : {false, true}) {
+      resample_spherical_polyline(shape, resolution, resampled, preserve);
+      auto expected = resample_spherical_polyline(plane, resolution, preserve);
+      if(resampled.size() + 1 < expected.size() || resampled.size() > expected.size() + 1)
+        throw std::runtime_error("Resampled into a different number of points");
+      if(resampled.front() != shape.front())
+        throw std::runtime_error("Resampled line should start where the line does");
+      for(auto p = std::next(resampled.cbegin()); p != resampled.cend(); ++p) {
+        if(p->Distance(*std::prev(p)) > resolution + 1)
+          throw std::runtime_error("Resampled points are too far apart");
+        //the arcs between these far apart points bow a few meters away from the straight segments
+        if(!equal(std::get<1>(p->ClosestPoint(shape)), 0.f, 10.f))
+          throw std::runtime_error("Resampled point was not found on original line");
+      }
+      if(preserve && resampled.back() != shape.back())
+        throw std::runtime_error("Preserved line should end where the line does");
+    }
+  }
+
+  //nothing in nothing out
+  resample_spherical_polyline(std::vector<PointLL>{}, 10.0, resampled);
+  if(!resampled.empty())
+    throw std::runtime_error("Resampling nothing should give back nothing");
+}
+
 void TestIterable() {
   int a[] = {1,2,3,4,5};
   char b[] = {'a','b','c','d','e'};
@@ -344,6 +377,29 @@ void TestExpandLocation() {
   }
 }
 
+
+void TestHilbertIndex() {
+  // Every cell is on the curve once and each step along it is to a neighbour
+  const uint32_t order = 4, n = 1 << order;
+  std::vector<std::pair<uint32_t, uint32_t> > cells(n * n, {n, n});
+  for (uint32_t x = 0; x < n; ++x) {
+    for (uint32_t y = 0; y < n; ++y) {
+      auto d = valhalla::midgard::hilbert_index(order, x, y);
+      if (d >= cells.size() || cells[d].first != n)
+        throw std::logic_error("Hilbert index out of range or repeated");
+      cells[d] = {x, y};
+    }
+  }
+  for (size_t d = 1; d < cells.size(); ++d) {
+    auto dx = std::abs(static_cast<int>(cells[d].first) - static_cast<int>(cells[d - 1].first));
+    auto dy = std::abs(static_cast<int>(cells[d].second) - static_cast<int>(cells[d - 1].second));
+    if (dx + dy != 1)
+      throw std::logic_error("Hilbert curve should only step to neighbouring cells");
+  }
+  if (valhalla::midgard::hilbert_index(order, 0, 0) != 0 ||
+      valhalla::midgard::hilbert_index(order, n - 1, 0) != n * n - 1)
+    throw std::logic_error("Hilbert curve should run from one corner to the next");
+}
 }
 
 int main() {
@@ -365,6 +421,8 @@ int main() {
 
   suite.test(TEST_CASE(TestResample));
 
+  suite.test(TEST_CASE(TestResampleReuse));
+
   suite.test(TEST_CASE(TestIterable));
 
   suite.test(TEST_CASE(TestTrimPolyline));
@@ -374,5 +432,7 @@ int main() {
   // trim_front of a polyline
   suite.test(TEST_CASE(TestTrimFront));
 
+  suite.test(TEST_CASE(TestHilbertIndex));
+
   return suite.tear_down();
 }
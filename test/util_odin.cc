@@ -19,6 +19,16 @@ namespace {
       throw std::runtime_error("Should find 'en-US' locales file");
   }
 
+  void test_get_locale() {
+    if(!is_supported_locale("en") || is_supported_locale("xx-XX"))
+      throw std::runtime_error("Only the tags and aliases of the locales should be supported");
+    auto en = get_locale("en");
+    if(!en || en != get_locale("en-US") || en != get_locales().at("en"))
+      throw std::runtime_error("An alias should share the dictionary of its locale");
+    if(get_locale("xx-XX"))
+      throw std::runtime_error("Should not find a dictionary for 'xx-XX'");
+  }
+
   void try_get_formatted_time(const std::string& date_time,
                               const std::string& expected_date_time,
                               const std::locale& locale) {
@@ -208,6 +218,7 @@ int main() {
 
   suite.test(TEST_CASE(test_supported_locales));
   suite.test(TEST_CASE(test_get_locales));
+  suite.test(TEST_CASE(test_get_locale));
   suite.test(TEST_CASE(test_time));
   suite.test(TEST_CASE(test_date));
 
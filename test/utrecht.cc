@@ -39,7 +39,7 @@ auto way_predicate = [](const OSMWay& a, const OSMWay& b){
   return a.osmwayid_ < b.osmwayid_;
 };
 
-OSMWay GetWay(uint64_t way_id, sequence<OSMWay>& ways) {
+OSMWay GetWay(uint64_t way_id, compressed_sequence<OSMWay>& ways) {
   auto found = ways.find({way_id}, way_predicate);
   if(found == ways.end())
     throw std::runtime_error("Couldn't find way: " + std::to_string(way_id));
@@ -56,7 +56,7 @@ void Parse() {
 void TestBike() {
   boost::property_tree::ptree conf;
   conf.put<std::string>("mjolnir.tile_dir", "test/data/parser_tiles");
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   ways.sort(way_predicate);
 
   auto way = GetWay(127361688, ways);
@@ -129,7 +129,7 @@ void TestBike() {
 void TestBus() {
   boost::property_tree::ptree conf;
   conf.put<std::string>("mjolnir.tile_dir", "test/data/parser_tiles");
-  sequence<OSMWay> ways(ways_file, false);
+  compressed_sequence<OSMWay> ways(ways_file, false);
   ways.sort(way_predicate);
 
   auto way = GetWay(33648196, ways);
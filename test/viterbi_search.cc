@@ -610,6 +610,63 @@ void TestTopKSearch()
 
 }
 
+void test_kbest_viterbi_search_brute_force(const std::vector<Column>& columns, uint32_t k)
+{
+  const auto& pcs = sort_all_paths(columns);
+  std::vector<std::vector<StateId>> stateids;
+  for (StateId::Time time = 0; time < columns.size(); time++) {
+    stateids.emplace_back();
+    for (uint32_t id = 0; id < columns[time].size(); id++) {
+      stateids.back().emplace_back(time, id);
+    }
+  }
+
+  KBestViterbiSearch vs{EmissionCostModel(columns), TransitionCostModel(columns)};
+  const auto& paths = vs.Search(stateids, k);
+  if (columns.empty()) {
+    test::assert_bool(paths.empty(), "expect no paths from empty columns");
+    return;
+  }
+
+  test::assert_bool(
+      paths.size() == std::min<size_t>(k, pcs.size()),
+      "expect " + std::to_string(std::min<size_t>(k, pcs.size())) + " paths but got " + std::to_string(paths.size()));
+  for (size_t i = 0; i < paths.size(); i++) {
+    validate_path(columns, paths[i].stateids);
+    test::assert_bool(
+        total_cost(columns, paths[i].stateids) == paths[i].cost,
+        "the cost of a path must be its total cost");
+    test::assert_bool(
+        paths[i].cost == pcs[i].cost(),
+        "the path " + std::to_string(i) + " must cost " + std::to_string(pcs[i].cost()) + " but got " + std::to_string(paths[i].cost));
+    for (size_t j = 0; j < i; j++) {
+      test::assert_bool(paths[i].stateids != paths[j].stateids, "the paths must be unique");
+    }
+  }
+}
+
+void TestKBestViterbiSearch()
+{
+  for (const uint32_t k : {1, 3, 10, 1000}) {
+    const auto& columns = generate_columns(
+        // transition costs
+        std::uniform_int_distribution<int>(1, 10),
+        // emission costs
+        std::uniform_int_distribution<int>(1, 10),
+        generate_column_counts(
+            4,
+            // column sizes
+            std::uniform_int_distribution<size_t>(1, 5)));
+    test_kbest_viterbi_search_brute_force(columns, k);
+  }
+
+  // Disconnected, empty and no columns
+  std::vector<Column> columns{{{1.f, {{0, 1.f}}}, {2.f, {}}}, {{1.f, {}}}, {{1.f, {}}}};
+  test_kbest_viterbi_search_brute_force(columns, 3);
+  test_kbest_viterbi_search_brute_force({{}}, 3);
+  test_kbest_viterbi_search_brute_force({}, 3);
+}
+
 int main(int argc, char *argv[])
 {
   test::suite suite("viterbi search & topk search");
@@ -618,5 +675,7 @@ int main(int argc, char *argv[])
 
   suite.test(TEST_CASE(TestTopKSearch));
 
+  suite.test(TEST_CASE(TestKBestViterbiSearch));
+
   return suite.tear_down();
 }
@@ -0,0 +1,171 @@
+#ifndef VALHALLA_BALDR_CHGRAPH_H_
+#define VALHALLA_BALDR_CHGRAPH_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/util.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Invalid contraction hierarchy node index
+constexpr uint32_t kInvalidCHNode = std::numeric_limits<uint32_t>::max();
+
+// File extension of a contraction hierarchy overlay, the file name is the
+// name of the costing it was built for
+constexpr const char* kCHGraphExtension = ".ch";
+
+/**
+ * An arc of the contraction hierarchy. Arcs are always stored at their lower
+ * ranked end and node is the higher ranked end. Original arcs are a turn
+ * from one directed edge onto another, shortcut arcs replace the two arcs
+ * into and out of a contracted middle node.
+ */
+struct CHArc {
+  uint32_t node;    // Higher ranked end of the arc
+  uint32_t middle;  // Contracted node this shortcut bypasses or kInvalidCHNode
+  float cost;       // Cost of the arc (turn plus the edge turned onto)
+  float secs;       // Elapsed time in seconds along the arc
+  float length;     // Length in meters along the arc
+};
+
+/**
+ * Edge based contraction hierarchy overlay for one costing profile. Each
+ * node of the hierarchy is a directed edge of the routing graph and each
+ * original arc is an allowed turn from one edge onto the next, so turn costs
+ * and simple turn restrictions are part of the hierarchy. The arcs are kept
+ * in two compressed adjacency arrays: the forward (upward) arcs leaving each
+ * node and the backward arcs, which enter each node from a higher ranked
+ * one, so both searches of a query only ever go up.
+ */
+class CHGraph {
+ public:
+  /**
+   * Constructor for an empty hierarchy.
+   */
+  CHGraph();
+
+  /**
+   * Constructor.
+   * @param  costing       Name of the costing the hierarchy was built for
+   * @param  edges         Directed edge of each node, sorted by id
+   * @param  fwd_offsets   Index of the first forward arc of each node, with
+   *                       one extra entry at the end
+   * @param  fwd_arcs      Forward arcs
+   * @param  bwd_offsets   Index of the first backward arc of each node, with
+   *                       one extra entry at the end
+   * @param  bwd_arcs      Backward arcs
+   */
+  CHGraph(const std::string& costing, std::vector<GraphId>&& edges,
+          std::vector<uint32_t>&& fwd_offsets, std::vector<CHArc>&& fwd_arcs,
+          std::vector<uint32_t>&& bwd_offsets, std::vector<CHArc>&& bwd_arcs);
+
+  /**
+   * Load a hierarchy from a file written with Write.
+   * @param  file_name  File to load
+   * @return Returns the hierarchy, throws if the file can't be read or
+   *         isn't a contraction hierarchy.
+   */
+  static CHGraph Load(const std::string& file_name);
+
+  /**
+   * Write the hierarchy to a file.
+   * @param  file_name  File to write
+   */
+  void Write(const std::string& file_name) const;
+
+  /**
+   * Get the name of the overlay file for a costing.
+   * @param  tile_dir  Tile directory the overlay is kept in
+   * @param  costing   Name of the costing
+   * @return Returns the path of the overlay file
+   */
+  static std::string FileName(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * @return Returns the name of the costing the hierarchy was built for
+   */
+  const std::string& costing() const {
+    return costing_;
+  }
+
+  /**
+   * @return Returns the number of nodes (directed edges) in the hierarchy
+   */
+  size_t node_count() const {
+    return edges_.size();
+  }
+
+  /**
+   * @return Returns the number of arcs, forward and backward, in the hierarchy
+   */
+  size_t arc_count() const {
+    return fwd_arcs_.size() + bwd_arcs_.size();
+  }
+
+  /**
+   * Get the node of a directed edge.
+   * @param  edgeid  Directed edge id
+   * @return Returns the node or kInvalidCHNode if the edge isn't in the
+   *         hierarchy (for instance because the costing never allows it)
+   */
+  uint32_t node(const GraphId& edgeid) const;
+
+  /**
+   * Get the directed edge of a node.
+   * @param  node  Node index
+   * @return Returns the directed edge id
+   */
+  const GraphId& edgeid(const uint32_t node) const {
+    return edges_[node];
+  }
+
+  /**
+   * Get the forward arcs of a node, these lead to higher ranked nodes.
+   * @param  node  Node index
+   * @return Returns the arcs leaving the node
+   */
+  midgard::iterable_t<const CHArc> forward(const uint32_t node) const {
+    return midgard::iterable_t<const CHArc>(fwd_arcs_.data() + fwd_offsets_[node],
+                                            fwd_arcs_.data() + fwd_offsets_[node + 1]);
+  }
+
+  /**
+   * Get the backward arcs of a node, these come from higher ranked nodes.
+   * @param  node  Node index
+   * @return Returns the arcs entering the node
+   */
+  midgard::iterable_t<const CHArc> backward(const uint32_t node) const {
+    return midgard::iterable_t<const CHArc>(bwd_arcs_.data() + bwd_offsets_[node],
+                                            bwd_arcs_.data() + bwd_offsets_[node + 1]);
+  }
+
+  /**
+   * Expand an arc into the nodes it passes through. Shortcuts are unpacked
+   * recursively until only original arcs remain.
+   * @param  from   Node the arc leaves
+   * @param  to     Node the arc enters
+   * @param  arc    The arc
+   * @param  nodes  The nodes after from, up to and including to, are
+   *                appended along with the elapsed time of each of their arcs
+   */
+  void Unpack(const uint32_t from, const uint32_t to, const CHArc& arc,
+              std::vector<std::pair<uint32_t, float> >& nodes) const;
+
+ protected:
+  std::string costing_;
+  std::vector<GraphId> edges_;
+  std::vector<uint32_t> fwd_offsets_;
+  std::vector<CHArc> fwd_arcs_;
+  std::vector<uint32_t> bwd_offsets_;
+  std::vector<CHArc> bwd_arcs_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_CHGRAPH_H_
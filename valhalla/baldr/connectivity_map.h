@@ -2,7 +2,10 @@
 #define VALHALLA_BALDR_CONNECTIVITY_MAP_H_
 
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/midgard/sequence.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -11,13 +14,23 @@
 namespace valhalla {
   namespace baldr {
     //TODO: maintain consistent coloring of regions despite the connectivity changing
+    /**
+     * The color of every tile of each level, tiles share a color when there is a path between
+     * them. Colors are kept in a flat array per level indexed by tile id, 0 for tiles that dont
+     * exist. If mjolnir.connectivity_map names a file written by valhalla_build_connectivity
+     * the colors are memory mapped from it rather than found by crawling the tiles, which
+     * saves every process that loads it the work. The file has to be rebuilt along with the
+     * tiles.
+     */
     class connectivity_map_t {
      public:
       /**
        * Constructs the connectivity map
-       * @param pt   the ptree sub child labeled mjolnir in the valhalla json config
+       * @param pt         the ptree sub child labeled mjolnir in the valhalla json config
+       * @param use_file   whether to map the colors from the connectivity_map file if
+       *                   there is one rather than finding them from the tiles
        */
-      connectivity_map_t(const boost::property_tree::ptree& pt);
+      connectivity_map_t(const boost::property_tree::ptree& pt, const bool use_file = true);
 
       /**
        * Returns the color for the given graphid
@@ -53,10 +66,31 @@ namespace valhalla {
        */
       std::vector<size_t> to_image(const uint32_t hierarchy_level) const;
 
+      /**
+       * Writes the colors of every level to a file which can be memory mapped
+       * by the constructor
+       *
+       * @param file_name  the file to write
+       */
+      void save(const std::string& file_name) const;
+
      private:
+      //maps the colors from a file, returns false if it isnt usable
+      bool load(const std::string& file_name);
+
+      //the colors of the tiles of a level indexed by tile id
+      struct level_colors_t {
+        const uint32_t* colors;
+        uint32_t count;
+      };
+      const level_colors_t* find_level(const uint32_t level) const;
+
       uint32_t transit_level;
-      //this is a map(tile_level, map(tile_id, tile_color))
-      std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t> > colors;
+      //colors of each level, indexed by the level
+      std::vector<level_colors_t> levels;
+      //where the colors live, either found from the tiles or mapped from a file
+      std::vector<std::vector<uint32_t> > owned;
+      std::unique_ptr<midgard::mem_map<char> > mapped;
     };
   }
 }
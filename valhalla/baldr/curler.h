@@ -15,6 +15,7 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <algorithm>
 #include <stdexcept>
 #include <valhalla/midgard/logging.h>
 
@@ -30,6 +31,11 @@ namespace {
     return std::shared_ptr<CURL>(curl_easy_init(), [](CURL* c){curl_easy_cleanup(c);});
   }
 
+  static std::shared_ptr<CURLM> init_curl_multi() {
+    static curl_singleton_t s;
+    return std::shared_ptr<CURLM>(curl_multi_init(), [](CURLM* m){curl_multi_cleanup(m);});
+  }
+
   char ALL_ENCODINGS[] = "";
 
 }
@@ -37,6 +43,8 @@ namespace {
 namespace valhalla {
 namespace baldr {
 
+  struct multi_curler_t;
+
   struct curler_t {
     struct logged_error_t: public std::runtime_error {
       logged_error_t(const std::string& msg):std::runtime_error(msg) {
@@ -73,7 +81,27 @@ namespace baldr {
       return result;
     }
 
+    //posts the body to the url, the connection goes back to getting once it has
+    std::vector<char> post(const std::string& url, long& http_code, std::string& content_type, const std::string& body, bool allow_compression = true) {
+      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size())), "Failed to set post size ");
+      assert_curl(curl_easy_setopt(connection.get(), CURLOPT_POSTFIELDS, body.c_str()), "Failed to set post body ");
+      std::vector<char> result;
+      try {
+        result = (*this)(url, http_code, allow_compression);
+      }
+      catch(...) {
+        curl_easy_setopt(connection.get(), CURLOPT_HTTPGET, 1L);
+        throw;
+      }
+      char* type = nullptr;
+      curl_easy_getinfo(connection.get(), CURLINFO_CONTENT_TYPE, &type);
+      content_type = type ? type : "";
+      curl_easy_setopt(connection.get(), CURLOPT_HTTPGET, 1L);
+      return result;
+    }
+
   protected:
+    friend struct multi_curler_t;
 
     void assert_curl(CURLcode code, const std::string& msg){
       if(code != CURLE_OK)
@@ -90,6 +118,92 @@ namespace baldr {
     char error[CURL_ERROR_SIZE];
   };
 
+  //fetches many urls at once over a bounded number of concurrent connections
+  struct multi_curler_t {
+    multi_curler_t(size_t max_connections = 8):
+      multi(init_curl_multi()), max_connections(std::max(max_connections, size_t(1))) {
+      if(multi.get() == nullptr)
+        throw curler_t::logged_error_t("Failed to created CURL multi handle");
+      //multiplex over a single connection when the server speaks http2, its fine if this isnt supported
+      curl_multi_setopt(multi.get(), CURLMOPT_PIPELINING, 2L);
+      curl_multi_setopt(multi.get(), CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(this->max_connections));
+    }
+
+    //results come back in the same order as the urls, a transfer that failed outright gets an http code of 0
+    std::vector<std::vector<char> > operator()(const std::vector<std::string>& urls, std::vector<long>& http_codes, bool allow_compression = true) {
+      std::vector<std::vector<char> > results(urls.size());
+      http_codes.assign(urls.size(), 0);
+
+      //a pool of easy handles that get reused from one transfer to the next
+      std::vector<std::shared_ptr<CURL> > handles;
+      std::vector<CURL*> idle;
+      size_t next = 0, active = 0;
+      auto start = [&](CURL* handle) {
+        curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, allow_compression ? ALL_ENCODINGS : nullptr);
+        curl_easy_setopt(handle, CURLOPT_URL, urls[next].c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &results[next]);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, reinterpret_cast<char*>(next));
+        curl_multi_add_handle(multi.get(), handle);
+        ++next;
+        ++active;
+      };
+
+      while(next < urls.size() || active > 0) {
+        //keep the connections busy
+        while(next < urls.size() && active < max_connections) {
+          if(idle.empty()) {
+            handles.emplace_back(curl_easy_init(), [](CURL* c){curl_easy_cleanup(c);});
+            if(handles.back().get() == nullptr)
+              throw curler_t::logged_error_t("Failed to created CURL connection");
+            configure(handles.back().get());
+            idle.push_back(handles.back().get());
+          }
+          start(idle.back());
+          idle.pop_back();
+        }
+
+        //move the transfers along
+        int running = 0;
+        if(curl_multi_perform(multi.get(), &running) != CURLM_OK)
+          throw curler_t::logged_error_t("Failed to perform CURL multi transfer");
+        if(static_cast<size_t>(running) == active)
+          curl_multi_wait(multi.get(), nullptr, 0, 1000, nullptr);
+
+        //collect the ones that finished
+        int queued = 0;
+        while(CURLMsg* message = curl_multi_info_read(multi.get(), &queued)) {
+          if(message->msg != CURLMSG_DONE)
+            continue;
+          char* index = nullptr;
+          curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &index);
+          auto i = reinterpret_cast<size_t>(index);
+          if(message->data.result == CURLE_OK)
+            curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &http_codes[i]);
+          else
+            LOG_WARN("Failed to get URL " + urls[i] + ": " + curl_easy_strerror(message->data.result));
+          curl_multi_remove_handle(multi.get(), message->easy_handle);
+          idle.push_back(message->easy_handle);
+          --active;
+        }
+      }
+
+      return results;
+    }
+
+  protected:
+
+    static void configure(CURL* handle) {
+      curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+      curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curler_t::write_callback);
+      //this is less secure but we'll worry about that later
+      curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
+      curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+
+    std::shared_ptr<CURLM> multi;
+    size_t max_connections;
+  };
+
 }
 }
 
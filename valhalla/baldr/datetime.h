@@ -21,6 +21,8 @@ namespace DateTime {
     boost::shared_ptr<time_zone_base_type> from_index(size_t index) const;
    protected:
     std::vector<std::string> regions;
+    //built once so looking one up by index doesnt go through the region names
+    std::vector<boost::shared_ptr<time_zone_base_type> > zones;
   };
 
   /**
@@ -175,6 +177,14 @@ namespace DateTime {
    */
   uint32_t seconds_from_midnight(const std::string& date_time);
 
+  /**
+   * Get the number of seconds elapsed from midnight at the start of the
+   * Sunday of the week.
+   * @param   date_time in the format of 2015-05-06T08:00
+   * @return  Returns the seconds from the start of the week.
+   */
+  uint32_t second_of_week(const std::string& date_time);
+
   /**
    * Add x seconds to a date_time and return a ISO date_time string.
    * @param   date_time   in the format of 01:34:15 or 2015-05-06T08:00
@@ -191,6 +201,38 @@ namespace DateTime {
    * @return true or false
    */
   bool is_iso_local(const std::string& date_time);
+
+  /**
+   * The date and time of a request parsed once up front so that searches can
+   * use it with integer arithmetic instead of parsing it again at every
+   * transit stop they reach.
+   */
+  struct time_context_t {
+    /**
+     * Constructor
+     * @param  date_time  in the format of 2015-05-06T08:00, empty if the
+     *                    request has none
+     */
+    time_context_t(const std::string& date_time = "");
+
+    /**
+     * Get the day of the schedules in a tile for this date.
+     * @param  date_created  Days from the pivot date the tile was created.
+     * @param  day           Set to the days since the tile was created.
+     * @return Returns false if the date is before the tile was created.
+     */
+    bool day_from(const uint32_t date_created, uint32_t& day) const {
+      if (days_from_pivot < date_created)
+        return false;
+      day = days_from_pivot - date_created;
+      return true;
+    }
+
+    bool valid;                     // Request has a date and time
+    uint32_t seconds_from_midnight; // Seconds from midnight local time
+    uint32_t days_from_pivot;       // Days elapsed since the pivot date
+    uint32_t dow_mask;              // Day of week mask of the date
+  };
 }
 }
 }
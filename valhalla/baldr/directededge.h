@@ -294,6 +294,27 @@ class DirectedEdge {
    */
   void set_unreachable(const bool unreachable);
 
+  /**
+   * Get the number of nodes a mode can reach going forward from the end node
+   * of this edge, as found within its tile when the tile was built. Only the
+   * auto, bicycle and pedestrian modes have their reach stored. Reach is
+   * capped at kMaxStoredReach.
+   * @param  access  Access mode (kAutoAccess, kBicycleAccess or
+   *                 kPedestrianAccess).
+   * @return  Returns the reach of the mode or 0 if it is not known.
+   */
+  uint32_t reach(const uint32_t access) const;
+
+  /**
+   * Sets the number of nodes a mode can reach going forward from the end
+   * node of this edge. Modes other than auto, bicycle and pedestrian are
+   * ignored.
+   * @param  access  Access mode (kAutoAccess, kBicycleAccess or
+   *                 kPedestrianAccess).
+   * @param  reach   Number of nodes reachable, capped at kMaxStoredReach.
+   */
+  void set_reach(const uint32_t access, const uint32_t reach);
+
   /**
    * A traffic signal occurs at the end of this edge.
    * @return  Returns true if a traffic signal is present at the end of the
@@ -884,6 +905,22 @@ class DirectedEdge {
    */
   void set_edge_to_right(const uint32_t localidx, const bool right);
 
+  /**
+   * Get the turn class of the transition from the prior edge (given by the
+   * local index of the corresponding inbound edge at the node). It packs
+   * everything the turn cost depends on besides the stop impact and density:
+   * the turn type in the low 3 bits, a bit set when there are edges both to
+   * the left and right (a crossing) and a bit set when driving on the left.
+   * Costing maps it to the cost of the turn with a table (sif::TurnCosts).
+   * @param  localidx  Local index at the node of the inbound edge.
+   * @return  Returns the turn class, less than Turn::kClassCount.
+   */
+  uint32_t turn_class(const uint32_t localidx) const {
+    uint32_t crossing = ((edge_to_left_ & stopimpact_.s.edge_to_right) >> localidx) & 1;
+    return static_cast<uint32_t>(turntype(localidx)) | (crossing << 3) |
+           (static_cast<uint32_t>(!drive_on_right_) << 4);
+  }
+
   /**
    * Get the index of the directed edge on the local level of the graph
    * hierarchy. This is used for turn restrictions so the edges can be
@@ -1048,7 +1085,9 @@ class DirectedEdge {
  protected:
 
   uint64_t endnode_             : 46; // End node of the directed edge
-  uint64_t spare1_              : 18;
+  uint64_t auto_reach_          : 6;  // Nodes reachable by auto (capped)
+  uint64_t bicycle_reach_       : 6;  // Nodes reachable by bicycle (capped)
+  uint64_t pedestrian_reach_    : 6;  // Nodes reachable on foot (capped)
 
   // Data offsets and flags for extended data. Where a flag exists the actual
   // data can be indexed by the directed edge Id within the tile.
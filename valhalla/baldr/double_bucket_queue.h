@@ -50,6 +50,8 @@ class DoubleBucketQueue {
 
   /**
    * Clear all labels from the low-level buckets and the overflow buckets.
+   * The range of the low-level buckets is reset to the initial one so that
+   * the queue can be reused.
    */
   void clear();
 
@@ -63,6 +65,7 @@ class DoubleBucketQueue {
    */
   void add(const uint32_t label) {
     get_bucket(labelcost_(label)).push_back(label);
+    ++pushes_;
   }
 
   /**
@@ -81,10 +84,32 @@ class DoubleBucketQueue {
    */
   uint32_t pop();
 
+  /**
+   * Number of label indexes put into a bucket since construction, counting
+   * both adds and decreases that moved a label to another bucket. Clearing
+   * the queue does not reset it.
+   * @return  Returns the number of pushes.
+   */
+  uint64_t pushes() const {
+    return pushes_;
+  }
+
+  /**
+   * Lower bound on the cost of the labels left in the queue: the low end of
+   * the current bucket. Costs below it only end up in the queue when a label
+   * is added with a lower cost than the last one removed, which a search with
+   * a consistent heuristic never does.
+   * @return  Returns the minimum cost of the labels in the queue.
+   */
+  float min_cost() const {
+    return currentcost_;
+  }
+
  private:
   float bucketrange_;  // Total range of costs in lower level buckets
   float bucketsize_;   // Bucket size (range of costs in same bucket)
   float inv_;          // 1/bucketsize (so we can avoid division)
+  float startcost_;    // Minimum cost of the buckets before any overflow
   float mincost_;      // Minimum cost within the low level buckets
   float maxcost_;      // Above this goes into overflow bucket
   float currentcost_;  // Current cost
@@ -101,6 +126,9 @@ class DoubleBucketQueue {
   // Cost function to get cost given the label index.
   LabelCost labelcost_;
 
+  // Labels put into buckets so far
+  uint64_t pushes_;
+
   /**
    * Returns the bucket given the cost.
    * @param  cost  Cost.
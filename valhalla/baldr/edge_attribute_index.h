@@ -0,0 +1,89 @@
+#ifndef VALHALLA_BALDR_EDGE_ATTRIBUTE_INDEX_H_
+#define VALHALLA_BALDR_EDGE_ATTRIBUTE_INDEX_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/accessrestriction.h>
+#include <valhalla/baldr/laneconnectivity.h>
+#include <valhalla/baldr/sign.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Where the signs, access restrictions and lane connections of a directed
+ * edge start in the lists of the tile, which are sorted by edge index. Tiles
+ * keep one of these for each directed edge plus one past the last edge, so
+ * the entries of edge i run from entry i to entry i + 1 and are found
+ * without searching the lists.
+ */
+class EdgeAttributeIndex {
+ public:
+  /**
+   * Constructor.
+   */
+  EdgeAttributeIndex();
+
+  /**
+   * Constructor with arguments.
+   * @param  sign                Index of the first sign.
+   * @param  access_restriction  Index of the first access restriction.
+   * @param  lane_connectivity   Index of the first lane connection.
+   */
+  EdgeAttributeIndex(const uint32_t sign, const uint32_t access_restriction,
+                     const uint32_t lane_connectivity);
+
+  /**
+   * Get the index of the first sign of the edge.
+   * @return  Returns the index into the sign list.
+   */
+  uint32_t sign() const {
+    return sign_;
+  }
+
+  /**
+   * Get the index of the first access restriction of the edge.
+   * @return  Returns the index into the access restriction list.
+   */
+  uint32_t access_restriction() const {
+    return access_restriction_;
+  }
+
+  /**
+   * Get the index of the first lane connection ending on the edge.
+   * @return  Returns the index into the lane connectivity list.
+   */
+  uint32_t lane_connectivity() const {
+    return lane_connectivity_;
+  }
+
+  /**
+   * Make the index of the directed edges of a tile from its lists, each
+   * sorted by edge index.
+   * @param  signs         Signs of the tile.
+   * @param  sign_count    Number of signs.
+   * @param  restrictions  Access restrictions of the tile.
+   * @param  restriction_count  Number of access restrictions.
+   * @param  lanes         Lane connections of the tile.
+   * @param  lane_count    Number of lane connections.
+   * @param  edge_count    Number of directed edges of the tile.
+   * @return Returns edge_count + 1 entries.
+   */
+  static std::vector<EdgeAttributeIndex> Build(const Sign* signs, const uint32_t sign_count,
+                                               const AccessRestriction* restrictions,
+                                               const uint32_t restriction_count,
+                                               const LaneConnectivity* lanes,
+                                               const uint32_t lane_count,
+                                               const uint32_t edge_count);
+
+ protected:
+  uint32_t sign_;
+  uint32_t access_restriction_;
+  uint32_t lane_connectivity_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_EDGE_ATTRIBUTE_INDEX_H_
@@ -0,0 +1,56 @@
+#ifndef VALHALLA_BALDR_EDGEBBOX_H_
+#define VALHALLA_BALDR_EDGEBBOX_H_
+
+#include <cstdint>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Bounding box coordinates are stored as offsets from the base (lower left)
+// of the tile in units of 1/16384th of the tile size. A box can reach up to 2
+// tile sizes away from the base this way, an axis that reaches further is
+// stored as unbounded.
+constexpr float kEdgeBBoxUnitsPerTile = 16384.0f;
+constexpr int16_t kEdgeBBoxUnboundedMin = -32768;
+constexpr int16_t kEdgeBBoxUnboundedMax = 32767;
+
+/**
+ * Quantized bounding box of the shape of a directed edge. Lets edge
+ * searches rule out an edge without decoding its shape. The box is rounded
+ * outward so that it always contains the whole shape.
+ */
+class EdgeBBox {
+ public:
+  /**
+   * Constructor of an unbounded box.
+   */
+  EdgeBBox();
+
+  /**
+   * Constructor with arguments.
+   * @param  box       Bounding box of the shape of the edge.
+   * @param  tile_box  Bounding box of the tile the edge is in.
+   */
+  EdgeBBox(const midgard::AABB2<midgard::PointLL>& box,
+           const midgard::AABB2<midgard::PointLL>& tile_box);
+
+  /**
+   * Get the bounding box. An unbounded axis spans the whole world.
+   * @param  tile_box  Bounding box of the tile the edge is in.
+   * @return Returns a box containing the whole shape of the edge.
+   */
+  midgard::AABB2<midgard::PointLL> box(const midgard::AABB2<midgard::PointLL>& tile_box) const;
+
+ protected:
+  int16_t minx_;
+  int16_t miny_;
+  int16_t maxx_;
+  int16_t maxy_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_EDGEBBOX_H_
@@ -0,0 +1,69 @@
+#ifndef VALHALLA_BALDR_EDGE_SHAPE_CACHE_H_
+#define VALHALLA_BALDR_EDGE_SHAPE_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Decoded shapes of the edges of a tile, so the shapes of the edges every
+ * request goes over are decoded once for as long as the tile is cached
+ * rather than on each request. Every copy of the tile shares it so it goes
+ * away with the last copy of the tile. Safe to use from many threads at once.
+ * It holds at most a given number of shapes, those asked for first, and
+ * decodes the others each time. Tiles only get one when the process sets
+ * how many shapes to keep, see set_max_shapes.
+ */
+class EdgeShapeCache {
+ public:
+  /**
+   * Constructor.
+   * @param  max_shapes  Greatest number of shapes to keep.
+   */
+  explicit EdgeShapeCache(const size_t max_shapes);
+
+  /**
+   * Get the decoded shape of an edge.
+   * @param  encoded  Encoded shape of the edge in the tile, which also
+   *                  identifies the edge info within the tile.
+   * @param  size     Size of the encoded shape.
+   * @return Returns the decoded shape.
+   */
+  std::shared_ptr<const std::vector<midgard::PointLL> > Get(const char* encoded, const size_t size);
+
+  /**
+   * Get the number of shapes kept.
+   * @return Returns the number of shapes.
+   */
+  size_t size() const;
+
+  /**
+   * Set how many shapes the tiles loaded from now on keep, 0 for tiles
+   * not to keep any. This holds for the whole process.
+   * @param  max_shapes  Greatest number of shapes each tile keeps.
+   */
+  static void set_max_shapes(const size_t max_shapes);
+
+  /**
+   * Get how many shapes the tiles loaded from now on keep.
+   * @return Returns the greatest number of shapes each tile keeps.
+   */
+  static size_t max_shapes();
+
+ protected:
+  size_t max_shapes_;
+  mutable std::mutex mutex_;
+  std::unordered_map<const char*, std::shared_ptr<const std::vector<midgard::PointLL> > > shapes_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_EDGE_SHAPE_CACHE_H_
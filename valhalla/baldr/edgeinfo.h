@@ -10,6 +10,7 @@
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/shape_decoder.h>
 #include <valhalla/midgard/util.h>
+#include <valhalla/baldr/edge_shape_cache.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/json.h>
 
@@ -61,8 +62,11 @@ class EdgeInfo {
    * @param  ptr  Pointer to a bit of memory that has the info for this edge
    * @param  names_list  Pointer to the start of the text/names list.
    * @param  names_list_length  Length (bytes) of the text/names list.
+   * @param  shape_cache  Decoded shapes of the tile, nullptr to decode the
+   *                      shape of this edge on its own.
    */
-  EdgeInfo(char* ptr, const char* names_list, const size_t names_list_length);
+  EdgeInfo(char* ptr, const char* names_list, const size_t names_list_length,
+           EdgeShapeCache* shape_cache = nullptr);
 
   /**
    * Destructor
@@ -167,6 +171,11 @@ class EdgeInfo {
   // Lng, lat shape of the edge
   mutable std::vector<PointLL> shape_;
 
+  // Decoded shapes of the tile and this edge's shape from it, if the tile
+  // keeps them
+  EdgeShapeCache* shape_cache_;
+  mutable std::shared_ptr<const std::vector<PointLL> > cached_shape_;
+
   // The list of names within the tile
   const char* names_list_;
 
@@ -1,7 +1,10 @@
 #ifndef VALHALLA_BALDR_EDGE_TRACKER_H_
 #define VALHALLA_BALDR_EDGE_TRACKER_H_
 
+#include <atomic>
+#include <climits>
 #include <cstdint>
+#include <vector>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 
@@ -11,7 +14,8 @@ namespace baldr {
 // a place we can mark what edges we've seen, even for the planet we should
 // need ~ 100mb, as it allocates one bit per ID. there are currently around
 // 453 million ways in OSM, and we might allocate two edge IDs per way,
-// giving something like 108mb of bits needed.
+// giving something like 108mb of bits needed. the bits are atomic so that
+// several threads can mark edges at once.
 struct bitset_t {
   typedef uint64_t value_type;
   static const size_t bits_per_value = sizeof(value_type) * CHAR_BIT;
@@ -21,9 +25,11 @@ struct bitset_t {
   bitset_t(size_t size);
   void set(const uint64_t id);
   bool get(const uint64_t id) const;
+  // sets the bit, returning whether it was already set
+  bool test_and_set(const uint64_t id);
 
 protected:
-  std::vector<value_type> bits;
+  std::vector<std::atomic<value_type> > bits;
 
   // return ceil(n / q) = r, such that r * q >= n.
   static inline constexpr size_t div_round_up(size_t n, size_t q) {
@@ -50,6 +56,8 @@ struct edge_tracker {
 
   bool get(const GraphId &edge_id) const;
   void set(const GraphId &edge_id);
+  // marks the edge, returning whether another thread (or call) already had
+  bool test_and_set(const GraphId &edge_id);
 
   edge_index_t m_edges_in_tiles;
   //this is how we know what i've touched and what we havent
@@ -0,0 +1,66 @@
+#ifndef VALHALLA_BALDR_FIXED_SHAPE_H_
+#define VALHALLA_BALDR_FIXED_SHAPE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Shape point kept as fixed point integers, in millionths of a degree like
+ * the encoded shapes, so points read back are the same as decoded ones.
+ */
+struct FixedPoint {
+  int32_t lon;
+  int32_t lat;
+};
+
+/**
+ * Where the fixed point shape of an edge info starts in the list of shape
+ * points of the tile. Entries are sorted by edge info offset and followed
+ * by one past the last, so the points of an edge info run up to where the
+ * next entry's start.
+ */
+struct FixedShapeIndex {
+  uint32_t edgeinfo_offset;
+  uint32_t first_point;
+};
+
+/**
+ * Reads a fixed point shape like midgard::Shape7Decoder reads an encoded
+ * one, without having to decode each point from the previous one.
+ */
+template <typename Point>
+class FixedShapeDecoder {
+ public:
+  FixedShapeDecoder(const FixedPoint* begin, const FixedPoint* end)
+    : begin(begin), end(end) {
+  }
+  Point pop() {
+    const FixedPoint& point = *begin++;
+    return Point(typename Point::first_type(double(point.lon) * 1e-6),
+                 typename Point::second_type(double(point.lat) * 1e-6));
+  }
+  bool empty() const {
+    return begin == end;
+  }
+
+ private:
+  const FixedPoint* begin;
+  const FixedPoint* end;
+};
+
+/**
+ * Decode an encoded shape into fixed point integers.
+ * @param  encoded  Encoded shape, as kept in the edge info.
+ * @param  size     Size of the encoded shape.
+ * @return Returns the points of the shape.
+ */
+std::vector<FixedPoint> DecodeFixedShape(const char* encoded, const size_t size);
+
+}
+}
+
+#endif  // VALHALLA_BALDR_FIXED_SHAPE_H_
@@ -0,0 +1,181 @@
+#ifndef VALHALLA_BALDR_FLATGRAPH_H_
+#define VALHALLA_BALDR_FLATGRAPH_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Invalid flat graph node index
+constexpr uint32_t kInvalidFlatNode = std::numeric_limits<uint32_t>::max();
+
+// File extension of a flat graph snapshot, the file name is the name of the
+// costing it was flattened for
+constexpr const char* kFlatGraphExtension = ".flat";
+
+/**
+ * A region of the tiled routing graph flattened for one costing profile into
+ * contiguous arrays, for offline batch jobs that would otherwise look up a
+ * tile on every edge they touch. Like the contraction hierarchy overlay it is
+ * edge based: each node is a directed edge the costing may use and each arc
+ * an allowed turn onto the next edge, weighted with the turn and the edge
+ * turned onto. The arcs leaving each node are kept together and their ends
+ * and weights in separate arrays so a search reads them in order.
+ */
+class FlatGraph {
+ public:
+  /**
+   * Constructor for an empty graph.
+   */
+  FlatGraph();
+
+  /**
+   * Constructor.
+   * @param  costing  Name of the costing the graph was flattened for
+   * @param  bounds   Region of the routing graph that was flattened
+   * @param  edges    Directed edge of each node, sorted by id
+   * @param  offsets  Index of the first arc of each node, with one extra
+   *                  entry at the end
+   * @param  targets  Node each arc leads to
+   * @param  costs    Cost of each arc
+   * @param  secs     Elapsed time in seconds along each arc
+   * @param  lengths  Length in meters along each arc
+   */
+  FlatGraph(const std::string& costing, const midgard::AABB2<midgard::PointLL>& bounds,
+            std::vector<GraphId>&& edges, std::vector<uint32_t>&& offsets,
+            std::vector<uint32_t>&& targets, std::vector<float>&& costs,
+            std::vector<float>&& secs, std::vector<float>&& lengths);
+
+  /**
+   * Load a graph from a file written with Write.
+   * @param  file_name  File to load
+   * @return Returns the graph, throws if the file can't be read or isn't a
+   *         flat graph.
+   */
+  static FlatGraph Load(const std::string& file_name);
+
+  /**
+   * Write the graph to a file.
+   * @param  file_name  File to write
+   */
+  void Write(const std::string& file_name) const;
+
+  /**
+   * Get the name of the flat graph file for a costing.
+   * @param  tile_dir  Tile directory the graph is kept in
+   * @param  costing   Name of the costing
+   * @return Returns the path of the flat graph file
+   */
+  static std::string FileName(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * @return Returns the name of the costing the graph was flattened for
+   */
+  const std::string& costing() const {
+    return costing_;
+  }
+
+  /**
+   * @return Returns the region of the routing graph that was flattened
+   */
+  const midgard::AABB2<midgard::PointLL>& bounds() const {
+    return bounds_;
+  }
+
+  /**
+   * @return Returns the number of nodes (directed edges) in the graph
+   */
+  size_t node_count() const {
+    return edges_.size();
+  }
+
+  /**
+   * @return Returns the number of arcs (turns) in the graph
+   */
+  size_t arc_count() const {
+    return targets_.size();
+  }
+
+  /**
+   * Get the node of a directed edge.
+   * @param  edgeid  Directed edge id
+   * @return Returns the node or kInvalidFlatNode if the edge isn't in the
+   *         graph (outside the region or never allowed by the costing)
+   */
+  uint32_t node(const GraphId& edgeid) const;
+
+  /**
+   * Get the directed edge of a node.
+   * @param  node  Node index
+   * @return Returns the directed edge id
+   */
+  const GraphId& edgeid(const uint32_t node) const {
+    return edges_[node];
+  }
+
+  /**
+   * @param  node  Node index
+   * @return Returns the index of the first arc leaving the node
+   */
+  uint32_t first_arc(const uint32_t node) const {
+    return offsets_[node];
+  }
+
+  /**
+   * @param  node  Node index
+   * @return Returns the index one past the last arc leaving the node
+   */
+  uint32_t last_arc(const uint32_t node) const {
+    return offsets_[node + 1];
+  }
+
+  /**
+   * @return Returns the node each arc leads to, by arc index
+   */
+  const uint32_t* targets() const {
+    return targets_.data();
+  }
+
+  /**
+   * @return Returns the cost of each arc, by arc index
+   */
+  const float* costs() const {
+    return costs_.data();
+  }
+
+  /**
+   * @return Returns the elapsed time in seconds along each arc, by arc index
+   */
+  const float* secs() const {
+    return secs_.data();
+  }
+
+  /**
+   * @return Returns the length in meters along each arc, by arc index
+   */
+  const float* lengths() const {
+    return lengths_.data();
+  }
+
+ protected:
+  std::string costing_;
+  midgard::AABB2<midgard::PointLL> bounds_;
+  std::vector<GraphId> edges_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> targets_;
+  std::vector<float> costs_;
+  std::vector<float> secs_;
+  std::vector<float> lengths_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_FLATGRAPH_H_
@@ -11,6 +11,8 @@ namespace baldr {
 constexpr uint32_t kMaxGraphTileId = 4194303;
 // Maximum id/index within a tile. 21 bits
 constexpr uint32_t kMaxGraphId = 2097151;
+// Maximum reach stored on a directed edge per mode. 6 bits
+constexpr uint32_t kMaxStoredReach = 63;
 
 // Access bit field constants. Access in directed edge allows 12 bits.
 constexpr uint16_t kAutoAccess       = 1;
@@ -29,9 +31,16 @@ constexpr uint16_t kAllAccess        = 4095;
 constexpr uint32_t kVehicularAccess = kAutoAccess | kTruckAccess | kMopedAccess |
                                       kTaxiAccess | kBusAccess | kHOVAccess;
 
+// Tiles keep the access of their directed edges packed together, the access
+// along the edge in the low 12 bits and the access against it (the access of
+// its opposing edge) shifted up by this much
+constexpr uint32_t kReverseAccessShift = 12;
+
 // Maximum number of transit records per tile and other max. transit
 // field values.
 constexpr uint32_t kMaxTransitDepartures    = 16777215;
+constexpr uint32_t kMaxDeparturePatterns    = 65535;
+constexpr uint32_t kMaxPatternTrips         = 16777215;
 constexpr uint32_t kMaxTransitStops         = 65535;
 constexpr uint32_t kMaxTransitRoutes        = 4095;
 constexpr uint32_t kMaxTransitSchedules     = 4095;
@@ -67,6 +76,9 @@ enum class Traversability {
 // Maximum relative density at a node or within a tile
 constexpr uint32_t kMaxDensity = 15;
 
+// Step of the hierarchy limits factors kept within a tile (0.125 - 1.875)
+constexpr float kHierarchyLimitsStep = 0.125f;
+
 // Maximum speed. This impacts the effectiveness of A* for driving routes
 // so it should be set as low as is reasonable. Speeds above this in OSM are
 // clamped to this maximum value.
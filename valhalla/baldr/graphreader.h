@@ -1,15 +1,24 @@
 #ifndef VALHALLA_BALDR_GRAPHREADER_H_
 #define VALHALLA_BALDR_GRAPHREADER_H_
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <list>
 #include <string>
 #include <unordered_map>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include <valhalla/baldr/curler.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 #include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/baldr/tileprefetcher.h>
+#include <valhalla/baldr/tile_heat.h>
+#include <valhalla/baldr/tile_updates.h>
+#include <valhalla/baldr/traffic_speeds.h>
 #include <boost/property_tree/ptree.hpp>
 
 namespace valhalla {
@@ -63,6 +72,18 @@ class TileCache {
    * Clears the cache.
    */
   virtual void Clear() = 0;
+
+  /**
+   * Evicts tiles until the cache is no longer over committed. Depending on
+   * the cache this may evict every tile.
+   */
+  virtual void Trim() = 0;
+
+  /**
+   * Evicts a single tile, for example because it was updated on disk.
+   * @param graphid  the graphid of the tile
+   */
+  virtual void Evict(const GraphId& graphid) = 0;
 };
 
 /**
@@ -116,6 +137,17 @@ class SimpleTileCache : public TileCache {
    */
   virtual void Clear();
 
+  /**
+   * Evicts every tile, same as Clear.
+   */
+  virtual void Trim();
+
+  /**
+   * Evicts a single tile.
+   * @param graphid  the graphid of the tile
+   */
+  virtual void Evict(const GraphId& graphid);
+
  protected:
   // The actual cached GraphTile objects
   std::unordered_map<GraphId, GraphTile> cache_;
@@ -127,6 +159,142 @@ class SimpleTileCache : public TileCache {
   size_t max_cache_size_;
 };
 
+/**
+ * Class that manages a tile cache with least recently used eviction. Once
+ * the cache grows past its maximum size Trim only evicts the least recently
+ * used tiles until it is back under the low watermark, so hot tiles stay
+ * resident.
+ * It is NOT thread-safe!
+ */
+class LRUTileCache : public TileCache {
+ public:
+  /**
+  * Constructor.
+  * @param max_size       maximum size of the cache (the high watermark)
+  * @param low_watermark  fraction of max_size the cache is trimmed down to
+  */
+  LRUTileCache(size_t max_size, float low_watermark);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  const GraphTile* Put(const GraphId& graphid, const GraphTile& tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId. Marks the tile as
+   * the most recently used one.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  const GraphTile* Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   * Evicts the least recently used tiles until the cache is at or below
+   * the low watermark.
+   */
+  void Trim() override;
+
+  /**
+   * Evicts a single tile.
+   * @param graphid  the graphid of the tile
+   */
+  void Evict(const GraphId& graphid) override;
+
+ protected:
+  struct entry_t {
+    GraphTile tile;
+    size_t size;
+    std::list<GraphId>::iterator position;
+  };
+
+  // The actual cached GraphTile objects
+  std::unordered_map<GraphId, entry_t> cache_;
+
+  // Tile ids ordered from most to least recently used
+  mutable std::list<GraphId> recency_;
+
+  // The current cache size in bytes
+  size_t cache_size_;
+
+  // The max cache size in bytes
+  size_t max_cache_size_;
+
+  // The size in bytes Trim brings the cache down to
+  size_t low_cache_size_;
+};
+
+/**
+ * Small direct mapped table of the tiles one reader got from a cache it
+ * shares with other readers, so asking for them again doesn't take a lock.
+ * Each reader has its own, the cached tiles are shared. Anything evicting
+ * from the shared cache bumps the shared generation, which makes every
+ * lookaside forget what it had, so all a hit costs is an uncontended load
+ * of that generation. Hits don't touch the shared cache so tiles used mostly
+ * through lookasides can look colder to an lru cache than they are.
+ * It is NOT thread-safe, the generation is.
+ */
+class TileLookaside {
+ public:
+  /**
+   * Constructor.
+   * @param generation  generation of the shared cache
+   */
+  explicit TileLookaside(std::atomic<uint64_t>& generation);
+
+  /**
+   * Get a tile this reader got from the shared cache before.
+   * @param graphid  the graphid of the tile
+   * @return the tile or nullptr if it isn't in the lookaside
+   */
+  const GraphTile* Get(const GraphId& graphid) const;
+
+  /**
+   * Remember a tile this reader got from the shared cache.
+   * @param graphid  the graphid of the tile
+   * @param tile     the tile in the shared cache, nullptr does nothing
+   */
+  void Put(const GraphId& graphid, const GraphTile* tile) const;
+
+  /**
+   * Makes every lookaside of the shared cache forget its tiles, call it
+   * before evicting from the shared cache.
+   */
+  void Invalidate();
+
+ private:
+  static constexpr size_t kSlots = 64;
+  std::atomic<uint64_t>& generation_;
+  mutable uint64_t seen_;
+  mutable std::array<std::pair<GraphId, const GraphTile*>, kSlots> slots_;
+};
+
 /**
  * Tile cache synchronized using external mutex.
  * It is thread-safe.
@@ -135,10 +303,11 @@ class SynchronizedTileCache : public TileCache {
  public:
   /**
   * Constructor.
-  * @param max_size  maximum size of the cache
-  * @param mutex reference to an external mutex
+  * @param max_size    maximum size of the cache
+  * @param mutex       reference to an external mutex
+  * @param generation  generation of the cache, shared by everything using it
   */
-  SynchronizedTileCache(TileCache& cache, std::mutex& mutex);
+  SynchronizedTileCache(TileCache& cache, std::mutex& mutex, std::atomic<uint64_t>& generation);
   /**
    * Reserves enough cache to hold (max_cache_size / tile_size) items.
    * @param tile_size appeoximate size of one tile
@@ -178,9 +347,208 @@ class SynchronizedTileCache : public TileCache {
    */
   void Clear() override;
 
+  /**
+   * Evicts tiles until the cache is no longer over committed.
+   */
+  void Trim() override;
+
+  /**
+   * Evicts a single tile.
+   * @param graphid  the graphid of the tile
+   */
+  void Evict(const GraphId& graphid) override;
+
  private:
   TileCache& cache_;
   std::mutex& mutex_ref_;
+  TileLookaside lookaside_;
+};
+
+/**
+ * Tile cache split into shards, each with its own mutex. A tile always lives
+ * in the shard picked by its GraphId so threads asking for different tiles
+ * rarely contend on the same lock. Each shard gets an equal part of the
+ * maximum cache size and is accounted for separately.
+ * It is thread-safe.
+ */
+class ShardedTileCache : public TileCache {
+ public:
+  /**
+   * Constructor.
+   * @param shards      external caches, one per shard
+   * @param mutexes     external mutexes, one per shard
+   * @param generation  generation of the shards, shared by everything using them
+   */
+  ShardedTileCache(std::vector<std::unique_ptr<TileCache> >& shards,
+                   std::vector<std::mutex>& mutexes, std::atomic<uint64_t>& generation);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  const GraphTile* Put(const GraphId& graphid, const GraphTile& tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  const GraphTile* Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if any of the shards is over committed with respect to its limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   * Evicts tiles from every over committed shard.
+   */
+  void Trim() override;
+
+  /**
+   * Evicts a single tile from its shard.
+   * @param graphid  the graphid of the tile
+   */
+  void Evict(const GraphId& graphid) override;
+
+  /**
+   * Returns the shard a given tile is stored in.
+   * @param graphid  the graphid of the tile
+   * @return the index of the shard
+   */
+  size_t Shard(const GraphId& graphid) const;
+
+ private:
+  std::vector<std::unique_ptr<TileCache> >& shards_;
+  std::vector<std::mutex>& mutexes_;
+  TileLookaside lookaside_;
+};
+
+/**
+ * Tile cache backed by a directory on a shared memory file system, for
+ * example /dev/shm, so that every worker process on a host maps the same
+ * copy of a tile rather than each keeping one of its own. The first process
+ * to load a tile writes its decompressed data there, renaming it into place
+ * so the others only ever see a whole tile, and then every process serves
+ * the tile from a read only mapping of that copy. The wrapped cache keeps
+ * the mappings of this process and does the accounting and eviction, which
+ * only ever drops a mapping, the shared copy stays for the other processes.
+ * It is as thread-safe as the cache it wraps.
+ *
+ * The directory can just as well be on a local SSD, which makes it a second
+ * tier below the wrapped cache: a tile dropped from memory is mapped back
+ * from its decompressed copy rather than fetched from the tile_url or
+ * inflated again. As a disk has no limit of its own the copies can be given
+ * one, past which the copies this process put there are removed oldest first.
+ */
+class SharedMemoryTileCache : public TileCache {
+ public:
+  /**
+   * Constructor.
+   * @param cache       cache to keep the mappings of this process in, taken over
+   * @param shared_dir  tile directory on the shared memory file system
+   * @param max_size    bytes of copies this process keeps in the directory,
+   *                    0 for no limit other than the file system's
+   */
+  SharedMemoryTileCache(TileCache* cache, const std::string& shared_dir,
+                        size_t max_size = 0);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache of this or any other process.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts the tile into shared memory, unless another process already has,
+   * and keeps a mapping of the shared copy.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  const GraphTile* Put(const GraphId& graphid, const GraphTile& tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId, mapping the
+   * shared copy if another process put it there.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  const GraphTile* Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the mappings of this process.
+   */
+  void Clear() override;
+
+  /**
+   * Drops mappings until the cache is no longer over committed.
+   */
+  void Trim() override;
+
+  /**
+   * Drops the mapping of a tile and removes the shared copy, so the next
+   * process to load it puts the tile there again.
+   * @param graphid  the graphid of the tile
+   */
+  void Evict(const GraphId& graphid) override;
+
+ private:
+  /**
+   * Maps the shared copy of a tile and keeps it in the wrapped cache.
+   * @param graphid  the graphid of the tile
+   * @return the mapped tile or nullptr if there is no shared copy
+   */
+  const GraphTile* Map(const GraphId& graphid) const;
+
+  /**
+   * Accounts for a copy this process put into the directory, removing the
+   * oldest ones while there are more than the limit.
+   * @param graphid  the graphid of the tile
+   */
+  void Spilled(const GraphId& graphid);
+
+  std::unique_ptr<TileCache> cache_;
+  std::string shared_dir_;
+
+  // Copies this process put into the directory, oldest first, and their size
+  size_t max_size_;
+  size_t size_;
+  std::list<std::pair<GraphId, size_t> > spilled_;
 };
 
 /**
@@ -257,11 +625,61 @@ class GraphReader {
     return GetGraphTile(pointll, TileHierarchy::levels().rbegin()->second.level);
   }
 
+  /**
+   * Asks for tiles to be loaded in the background so that they are already
+   * in memory by the time they are needed. Does nothing unless the reader
+   * was configured with tile_prefetch_threads and reads separate tile files.
+   * @param ids  Ids of the tiles to load, the most urgent first
+   */
+  void Prefetch(const std::vector<GraphId>& ids);
+
+  /**
+   * Prefetches the tiles, at every level, along the straight line between
+   * two points. Tiles nearest either end are asked for first since that is
+   * where a (bidirectional) search starts out. Without background threads
+   * but with a tile_url the tiles are instead fetched right away in one
+   * concurrent batch, see FetchTiles.
+   * @param a  One end of the line
+   * @param b  The other end of the line
+   */
+  void PrefetchAlong(const PointLL& a, const PointLL& b);
+
+  /**
+   * Fetches tiles from the tile_url concurrently and puts them in the cache.
+   * Tiles which are already cached or are found in the tile_dir are skipped.
+   * Does nothing unless the reader was configured with a tile_url.
+   * @param ids  Ids of the tiles to fetch
+   */
+  void FetchTiles(const std::vector<GraphId>& ids);
+
+  /**
+   * Loads tiles into the cache ahead of the requests that will need them,
+   * on several threads. Tiles already cached or missing are skipped and it
+   * stops once the tiles loaded would fill the cache past max_size. With an
+   * extract the kernel is also asked to read the tiles in ahead, since what
+   * is cached is only a view of the mapping.
+   * @param ids       Ids of the tiles to load, the most wanted first
+   * @param threads   How many threads to read tile files with
+   * @param max_size  How much of the cache, in bytes, the tiles may take up
+   * @return  Returns how many tiles were loaded.
+   */
+  size_t Preload(const std::vector<GraphId>& ids, const size_t threads, const size_t max_size);
+
   /**
    * Clears the cache
    */
   void Clear() {
     cache_->Clear();
+    if (prefetcher_)
+      prefetcher_->Clear();
+  }
+
+  /**
+   * Evicts tiles from the cache until it is no longer over committed. Like
+   * Clear this invalidates any tile pointers handed out for evicted tiles.
+   */
+  void Trim() {
+    cache_->Trim();
   }
 
   /**
@@ -272,6 +690,65 @@ class GraphReader {
     return cache_->OverCommitted();
   }
 
+  // Tiles asked for through GetGraphTile, split by whether the cache had them
+  struct tile_counts_t {
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+  };
+
+  /**
+   * Counts of the tiles asked for since construction or the last reset
+   * @return  Returns the tile counts.
+   */
+  const tile_counts_t& tile_counts() const {
+    return tile_counts_;
+  }
+
+  /**
+   * Starts counting the tiles asked for from zero again
+   */
+  void reset_tile_counts() {
+    tile_counts_ = {0, 0};
+  }
+
+  /**
+   * Live traffic speeds of the directed edges in a tile. Look them up when
+   * you need them, they may be swapped for newer ones between requests.
+   * @param  id  Graph Id of the tile or of anything in it
+   * @return  Returns the speeds, empty if there is no traffic for the tile.
+   */
+  TileSpeeds GetTrafficSpeeds(const GraphId& id) const {
+    return traffic_ ? traffic_->speeds(id.tileid()) : TileSpeeds{nullptr, 0};
+  }
+
+  /**
+   * Picks up newer traffic speeds if there are any and it is time to look.
+   * Call it between requests.
+   */
+  void RefreshTrafficSpeeds() {
+    if (traffic_)
+      traffic_->Refresh();
+  }
+
+  /**
+   * Evicts the tiles that were updated in place in the tile_dir since the
+   * last time, if it is time to look, so they are read again. Like Trim this
+   * invalidates any tile pointers handed out for them, call it between
+   * requests. When the reader keeps a tile_heat_file its counts are also
+   * written out every so often.
+   * @return  Returns true if any tiles were evicted.
+   */
+  bool RefreshTiles();
+
+  /**
+   * The version of the tiles the reader serves, moved on each time RefreshTiles
+   * sees tiles updated in place.
+   * @return  Returns the version, 0 for an extract or tiles never updated.
+   */
+  uint32_t tile_version() const {
+    return tile_updates_ ? tile_updates_->version() : 0;
+  }
+
   /**
    * Convenience method to get an opposing directed edge.
    * @param  edgeid  Graph Id of the directed edge.
@@ -321,6 +798,14 @@ class GraphReader {
     return oppedgeid.Is_Valid() ? tile->directededge(oppedgeid) : nullptr;
   }
 
+  /**
+   * Convenience method to recover the base edges of a shortcut edge.
+   * @param  shortcut_id  Graph Id of the shortcut edge.
+   * @return  Returns the base edges in the order they are traversed, empty
+   *          if the edge is not a shortcut or its tile doesn't keep them.
+   */
+  std::vector<GraphId> RecoverShortcut(const GraphId& shortcut_id);
+
   /**
    * Convenience method to get an end node.
    * @param edge  the edge whose end node you want
@@ -531,6 +1016,16 @@ class GraphReader {
     return edgeinfo(edgeid, NO_TILE);
   }
 
+  /**
+   * Get the segment index of the bins of a tile, building it and attaching
+   * it to the tile if it has none with the given divisions yet. Readers
+   * sharing the tile share its index.
+   * @param  tile       Tile whose bins are indexed.
+   * @param  divisions  Number of cells along each side of a bin.
+   * @return Returns the segment index of the tile.
+   */
+  std::shared_ptr<const SegmentIndex> GetSegmentIndex(const GraphTile* tile, const uint32_t divisions);
+
   /**
    * Gets back a set of available tiles
    * @return  returns the list of available tiles
@@ -563,12 +1058,28 @@ class GraphReader {
 
   // Stuff for getting at remote tiles
   curler_t curler;
+  std::unique_ptr<multi_curler_t> multi_curler_;
   std::string tile_url_;
   std::unordered_set<GraphId> _404s;
+  // Whether fetched tiles are written to the tile_dir and how many to fetch at once
+  bool tile_url_spill_;
+  size_t tile_url_concurrency_;
   // Information about where the tiles are kept
   std::string tile_dir_;
+  // Whether tile files are memory mapped rather than read into memory
+  bool tile_mmap_;
+  // Background tile loading, null unless configured
+  std::unique_ptr<TilePrefetcher> prefetcher_;
+  size_t prefetch_max_;
 
   std::unique_ptr<TileCache> cache_;
+  tile_counts_t tile_counts_{0, 0};
+  // Live traffic speeds shared by every reader, null if there are none
+  std::shared_ptr<TrafficSpeeds> traffic_;
+  // Tiles updated in place, null when serving an extract
+  std::unique_ptr<TileUpdates> tile_updates_;
+  // How often each tile is asked for, null unless there is a tile_heat_file
+  std::unique_ptr<TileHeat> heat_;
 };
 
 }
@@ -7,11 +7,19 @@
 #include <valhalla/baldr/graphtileheader.h>
 #include <valhalla/baldr/complexrestriction.h>
 #include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/edge_attribute_index.h>
+#include <valhalla/baldr/edge_bbox.h>
 #include <valhalla/baldr/edge_elevation.h>
+#include <valhalla/baldr/fixed_shape.h>
+#include <valhalla/baldr/hotedge.h>
+#include <valhalla/baldr/shortcut_edges.h>
+#include <valhalla/baldr/speed_profile.h>
 #include <valhalla/baldr/laneconnectivity.h>
 #include <valhalla/baldr/nodeinfo.h>
 #include <valhalla/baldr/trafficassociation.h>
 #include <valhalla/baldr/transitdeparture.h>
+#include <valhalla/baldr/transitdepartureindex.h>
+#include <valhalla/baldr/transitpattern.h>
 #include <valhalla/baldr/transitroute.h>
 #include <valhalla/baldr/transitstop.h>
 #include <valhalla/baldr/transitschedule.h>
@@ -20,14 +28,19 @@
 #include <valhalla/baldr/edgeinfo.h>
 #include <valhalla/baldr/admininfo.h>
 #include <valhalla/baldr/curler.h>
+#include <valhalla/baldr/segmentindex.h>
 
 #include <valhalla/midgard/util.h>
 #include <valhalla/midgard/aabb2.h>
 
+#include <functional>
 #include <memory>
 #include <valhalla/baldr/signinfo.h>
 
 namespace valhalla {
+namespace midgard {
+template <class T> class mem_map;
+}
 namespace baldr {
 
 using tile_index_pair = std::pair<uint32_t, uint32_t>;
@@ -48,8 +61,12 @@ class GraphTile {
    * into memory.
    * @param  tile_dir   Tile directory.
    * @param  graphid    GraphId (tileid and level)
+   * @param  mmap_tile  Map the tile file read only instead of reading it
+   *                    into memory. The page cache backing the map is
+   *                    shared between every process using the tile. Gzipped
+   *                    tiles cannot be mapped and are always read.
    */
-  GraphTile(const std::string& tile_dir, const GraphId& graphid);
+  GraphTile(const std::string& tile_dir, const GraphId& graphid, bool mmap_tile = false);
 
   /**
    * Constructor given the graph Id, pointer to the tile data, and the
@@ -61,11 +78,32 @@ class GraphTile {
   GraphTile(const GraphId& graphid, char* ptr, size_t size);
 
   /**
-   * Constructor given the graph Id, in memory tile data
-   * @param  graphid  Tile Id.
-   * @param  tile     Vector of char data with tile's data..
+   * Constructor given a tile url. Fetches the graph tile over http.
+   * @param  tile_url   Url the tiles are served from.
+   * @param  graphid    GraphId (tileid and level)
+   * @param  curler     Connection to fetch the tile with.
+   * @param  spill_dir  If not empty the fetched tile is also written to this
+   *                    tile directory so it needn't be fetched again.
+   */
+  GraphTile(const std::string& tile_url, const GraphId& graphid, curler_t& curler,
+            const std::string& spill_dir = "");
+
+  /**
+   * Constructor given the graph Id and tile data already in memory, for
+   * example the body of a batched http fetch.
+   * @param  graphid    Tile Id.
+   * @param  tile_data  The tile's data, taken over by the tile.
+   */
+  GraphTile(const GraphId& graphid, std::vector<char>&& tile_data);
+
+  /**
+   * Writes the tile's data to a tile directory. The tile is written to a
+   * temporary file and renamed into place, so concurrent readers only ever
+   * see a whole tile.
+   * @param  tile_dir  Tile directory to write the tile to.
+   * @return Returns true if the tile was written.
    */
-  GraphTile(const std::string& tile_url, const GraphId& graphid, curler_t& curler);
+  bool Spill(const std::string& tile_dir) const;
 
   /**
    * Destructor
@@ -93,6 +131,13 @@ class GraphTile {
    */
   midgard::AABB2<PointLL> BoundingBox() const;
 
+  /**
+   * Get the bounding box of a graph tile.
+   * @param  graphid  Graph Id of the tile.
+   * @return Returns the bounding box of the tile.
+   */
+  static midgard::AABB2<PointLL> BoundingBox(const GraphId& graphid);
+
   /**
    * Gets the id of the graph tile
    * @return  Returns the graph id of the tile (pointing to the first node)
@@ -168,6 +213,22 @@ class GraphTile {
                              std::to_string(header_->directededgecount()));
   }
 
+  /**
+   * Get a pointer to the hot attributes of an edge. The hot edges of a
+   * node's directed edges follow one another like the directed edges do.
+   * @param  idx  Index of the directed edge within the current tile.
+   * @return  Returns a pointer to the hot edge.
+   */
+  const HotEdge* hotedge(const size_t idx) const {
+    if (idx < header_->directededgecount())
+      return &hotedges_[idx];
+    throw std::runtime_error("GraphTile HotEdge index out of bounds: " +
+                             std::to_string(header_->graphid().tileid()) + "," +
+                             std::to_string(header_->graphid().level()) + "," +
+                             std::to_string(idx)  + " directededgecount= " +
+                             std::to_string(header_->directededgecount()));
+  }
+
   /**
    * Get an iterable set of directed edges from a node in this tile
    * @param  node  GraphId of the node from which the edges leave
@@ -212,6 +273,28 @@ class GraphTile {
                                                   const GraphId id,
                                                   const uint64_t modes) const;
 
+  /**
+   * Is there a complex restriction in the forward or reverse order.
+   * @param   forward - do we want the restrictions in reverse order?
+   * @param   id - edge id
+   * @param   modes - access modes
+   * @return  Returns true if a complex restriction of the id and modes exists.
+   */
+  bool HasRestrictions(const bool forward, const GraphId id, const uint64_t modes) const;
+
+  /**
+   * Visit the complex restrictions in the forward or reverse order without
+   * copying them. Restrictions differ in size so they are handed to the
+   * visitor as they are read from the tile.
+   * @param   forward - do we want the restrictions in reverse order?
+   * @param   id - edge id
+   * @param   modes - access modes
+   * @param   visitor - called with each restriction of the id and modes,
+   *          returns false to stop visiting.
+   */
+  void VisitRestrictions(const bool forward, const GraphId id, const uint64_t modes,
+                         const std::function<bool (const ComplexRestriction&)>& visitor) const;
+
   /**
    * Convenience method to get the directed edges originating at a node.
    * @param  node_index  Node Id within this tile.
@@ -260,6 +343,14 @@ class GraphTile {
    */
   std::string GetName(const uint32_t textlist_offset) const;
 
+  /**
+   * Get the text/name for a given offset to the textlist without copying it.
+   * The text is null terminated and lives as long as the tile.
+   * @param   textlist_offset  offset into the text list.
+   * @return  Returns the desired text
+   */
+  const char* GetText(const uint32_t textlist_offset) const;
+
   /**
    * Convenience method to get the signs for an edge given the directed
    * edge index.
@@ -268,6 +359,14 @@ class GraphTile {
    */
   std::vector<SignInfo> GetSigns(const uint32_t idx) const;
 
+  /**
+   * Get the signs of an edge without copying them or their text. Use
+   * GetText with the text offset of a sign to get its text.
+   * @param  idx  Directed edge index. Used to lookup list of signs.
+   * @return  Returns an iterable list of the edge's signs, empty if it has none.
+   */
+  midgard::iterable_t<const Sign> GetSignRange(const uint32_t idx) const;
+
   /**
    * Get the next departure given the directed edge Id and the current
    * time (seconds from midnight). TODO - what if crosses midnight?
@@ -290,6 +389,31 @@ class GraphTile {
                                            bool wheelchair,
                                            bool bicycle) const;
 
+  /**
+   * Get the previous departure given the directed edge Id and the current
+   * time (seconds from midnight) at the end of the edge, for searches going
+   * back in time from the destination. This is the latest departure that
+   * arrives at the end of the edge by the current time.
+   * @param   lineid            Transit Line Id
+   * @param   current_time      Current time (seconds from midnight) at the
+   *                            end of the edge.
+   * @param   day               Days since the tile creation date.
+   * @param   dow               Day of week (see graphconstants.h)
+   * @param   date_before_tile  Is the date that was inputed before
+   *                            the tile creation date?
+   * @param   wheelchair        Only find departures with wheelchair access if true
+   * @param   bicyle            Only find departures with bicycle access if true
+   * @return  Returns a pointer to the transit departure information.
+   *          Returns nullptr if no departures are found.
+   */
+  const TransitDeparture* GetPreviousDeparture(const uint32_t lineid,
+                                               const uint32_t current_time,
+                                               const uint32_t day,
+                                               const uint32_t dow,
+                                               bool  date_before_tile,
+                                               bool wheelchair,
+                                               bool bicycle) const;
+
   /**
    * Get the departure given the directed edge Id and tripid
    * @param   lineid  Transit Line Id
@@ -363,6 +487,16 @@ class GraphTile {
   std::vector<AccessRestriction> GetAccessRestrictions(const uint32_t edgeid,
                                                        const uint32_t access) const;
 
+  /**
+   * Get the access restrictions of an edge for all modes without copying
+   * them. The restrictions of an edge are next to each other in the tile.
+   * @param   edgeid  Directed edge Id.
+   * @return  Returns an iterable list of the edge's AccessRestrictions,
+   *          empty if it has none.
+   */
+  midgard::iterable_t<const AccessRestriction> GetAccessRestrictionRange(
+      const uint32_t edgeid) const;
+
   /**
    * Get an iteratable list of GraphIds given a bin in the tile
    * @param  column the bin's column
@@ -378,6 +512,22 @@ class GraphTile {
    */
   midgard::iterable_t<GraphId> GetBin(size_t index) const;
 
+  /**
+   * Get the segment index of the bins of the tile, if it has been built.
+   * The index is built by GraphReader::GetSegmentIndex and shared by every
+   * reader of the tile. Safe to call while another thread attaches one.
+   * @return Returns the segment index, nullptr if it was not built yet.
+   */
+  std::shared_ptr<const SegmentIndex> segment_index() const;
+
+  /**
+   * Attach a segment index to the tile unless another thread attached one
+   * with the same cell divisions first.
+   * @param  index  Segment index built from this tile.
+   * @return Returns the segment index attached to the tile.
+   */
+  std::shared_ptr<const SegmentIndex> set_segment_index(std::shared_ptr<const SegmentIndex> index) const;
+
   /**
    * Get traffic segment(s) associated to this edge.
    * @param   edge  GraphId of the directed edge.
@@ -394,6 +544,24 @@ class GraphTile {
    */
   std::vector<TrafficSegment> GetTrafficSegments(const uint32_t idx) const;
 
+  /**
+   * Get traffic segment(s) associated to this edge into a list kept by the
+   * caller, so that it can be reused from edge to edge.
+   * @param   edge      GraphId of the directed edge.
+   * @param   segments  (OUT) Traffic segment Ids and weights that associate
+   *                    to this edge, cleared first.
+   */
+  void GetTrafficSegments(const GraphId& edge, std::vector<TrafficSegment>& segments) const;
+
+  /**
+   * Get traffic segment(s) associated to this edge into a list kept by the
+   * caller, so that it can be reused from edge to edge.
+   * @param   idx       index of the directed edge within the tile.
+   * @param   segments  (OUT) Traffic segment Ids and weights that associate
+   *                    to this edge, cleared first.
+   */
+  void GetTrafficSegments(const uint32_t idx, std::vector<TrafficSegment>& segments) const;
+
   /**
    * Get lane connections ending on this edge.
    * @param  edge  GraphId of the directed edge.
@@ -401,6 +569,14 @@ class GraphTile {
    */
   std::vector<LaneConnectivity> GetLaneConnectivity(const uint32_t idx) const;
 
+  /**
+   * Get lane connections ending on this edge without copying them.
+   * @param  idx  Directed edge index.
+   * @return  Returns an iterable list of lane connections ending on this edge,
+   *          empty if there are none.
+   */
+  midgard::iterable_t<const LaneConnectivity> GetLaneConnectivityRange(const uint32_t idx) const;
+
   /**
    * Get a pointer to a edge elevation data for the specified edge.
    * @param  edge  GraphId of the directed edge.
@@ -416,11 +592,107 @@ class GraphTile {
     }
   }
 
+  /**
+   * Get the bounding box of the shape of the specified edge.
+   * @param  edge  GraphId of the directed edge.
+   * @param  box   Set to a box containing the whole shape of the edge.
+   * @return  Returns false if the tile has no edge bounding boxes.
+   */
+  bool edge_bbox(const GraphId& edge, midgard::AABB2<PointLL>& box) const {
+    if (edge_bboxes_ == nullptr || edge.id() >= header_->directededgecount())
+      return false;
+    box = edge_bboxes_[edge.id()].box(bounding_box_);
+    return true;
+  }
+
+  /**
+   * Get the packed access of the specified edge, its forward access with its
+   * reverse access shifted up by kReverseAccessShift. The accesses of all of
+   * the edges are kept next to each other so that ruling out edges by access
+   * doesn't have to touch their directed edges.
+   * @param  edge  GraphId of the directed edge.
+   * @return  Returns the packed access, every access if it isn't known.
+   */
+  uint32_t edge_access(const GraphId& edge) const {
+    if (!derived_ || edge.id() >= derived_->edge_access.size())
+      return kAllAccess | (kAllAccess << kReverseAccessShift);
+    return derived_->edge_access[edge.id()];
+  }
+
+  /**
+   * Does the tile keep the shapes of its edges as fixed point integers too.
+   * @return  Returns true if fixed_shape can be used rather than decoding.
+   */
+  bool has_fixed_shapes() const {
+    return fixed_shape_index_ != nullptr;
+  }
+
+  /**
+   * Get the fixed point shape of an edge info, which is read point by point
+   * the way EdgeInfo::lazy_shape decodes the encoded one but without the
+   * decoding. Only tiles that have fixed point shapes can be asked.
+   * @param  edgeinfo_offset  Offset to the edge info.
+   * @return Returns the shape, empty if the edge info has none.
+   */
+  FixedShapeDecoder<PointLL> fixed_shape(const uint32_t edgeinfo_offset) const;
+
+  /**
+   * Does the tile keep the base edges its shortcut edges were formed from.
+   * @return  Returns true if GetShortcutEdges can recover the shortcuts.
+   */
+  bool has_shortcut_edges() const {
+    return shortcut_edges_index_ != nullptr;
+  }
+
+  /**
+   * Get the base edges a shortcut edge was formed from, in the order they
+   * are traversed along the shortcut.
+   * @param  idx  Index of the shortcut edge within the current tile.
+   * @return Returns the base edges, empty if the tile doesn't keep them for
+   *         this edge.
+   */
+  midgard::iterable_t<const GraphId> GetShortcutEdges(const uint32_t idx) const;
+
+  /**
+   * Does the tile have historical speed profiles.
+   * @return  Returns true if any directed edges in the tile have a profile.
+   */
+  bool has_speed_profiles() const {
+    return speed_profile_index_ != nullptr;
+  }
+
+  /**
+   * Get the historical speed profile of a directed edge.
+   * @param  idx  Index of the directed edge within the current tile.
+   * @return  Returns the speed profile, nullptr if the edge has none.
+   */
+  const SpeedProfile* speed_profile(const size_t idx) const {
+    if (speed_profile_index_ == nullptr || idx >= header_->directededgecount())
+      return nullptr;
+    uint16_t profile = speed_profile_index_[idx];
+    return profile == kNoSpeedProfile || profile > speed_profile_count_ ?
+        nullptr : &speed_profiles_[profile - 1];
+  }
+
+  /**
+   * Get the historical speed of a directed edge at a time of the week.
+   * @param  idx             Index of the directed edge within the current tile.
+   * @param  second_of_week  Seconds since midnight on Sunday, local time.
+   * @return  Returns the speed in kph, 0 if there is no historical speed.
+   */
+  uint8_t historical_speed(const size_t idx, const uint32_t second_of_week) const {
+    const SpeedProfile* profile = speed_profile(idx);
+    return profile ? profile->speed(second_of_week) : 0;
+  }
+
  protected:
 
   // Graph tile memory, this must be shared so that we can put it into cache
   std::shared_ptr<std::vector<char>> graphtile_;
 
+  // Graph tile memory when the tile file is memory mapped rather than read
+  std::shared_ptr<midgard::mem_map<char>> memmap_;
+
   // Header information for the tile
   GraphTileHeader* header_;
 
@@ -435,6 +707,13 @@ class GraphTile {
   // Transit departures, many per index (indexed by directed edge index and
   // sorted by departure time)
   TransitDeparture* departures_;
+  uint32_t departure_count_;
+
+  // Departures expanded from the schedule patterns of the tile, if it has any
+  std::shared_ptr<std::vector<TransitDeparture>> decoded_departures_;
+
+  // Departures grouped by line, schedule and type to find the next one
+  std::shared_ptr<TransitDepartureIndex> departure_index_;
 
   // Transit stops (indexed by stop index within the tile)
   TransitStop* transit_stops_;
@@ -470,6 +749,10 @@ class GraphTile {
   // Size of the complex restrictions in the reverse direction
   std::size_t complex_restriction_reverse_size_;
 
+  // Offsets of the complex restrictions sorted by the edge they are found
+  // by, the to edge in the forward direction and the from edge in reverse
+  using restriction_index_t = std::vector<std::pair<uint64_t, uint32_t>>;
+
   // List of edge info structures. Since edgeinfo is not fixed size we
   // use offsets in directed edges.
   char* edgeinfo_;
@@ -507,14 +790,75 @@ class GraphTile {
   // Edge elevation data
   EdgeElevation* edge_elevation_;
 
-  // Map of stop one stops in this tile.
-  std::unordered_map<std::string, tile_index_pair> stop_one_stops;
+  // Bounding boxes of the directed edges, nullptr if the tile has none
+  EdgeBBox* edge_bboxes_;
+
+  // Bounding box of the tile, which the edge bounding boxes are relative to
+  midgard::AABB2<PointLL> bounding_box_;
+
+  // Hot attributes of the directed edges, same count as directed edges
+  HotEdge* hotedges_;
+
+  // Hot edges made from the directed edges of a tile that has none
+  std::shared_ptr<std::vector<HotEdge>> derived_hotedges_;
 
-  // Map of route one stops in this tile.
-  std::unordered_map<std::string, std::list<tile_index_pair>> route_one_stops;
+  // Speed profile of each directed edge, nullptr if the tile has none
+  uint16_t* speed_profile_index_;
 
-  // Map of operator one stops in this tile.
-  std::unordered_map<std::string, std::list<tile_index_pair>> oper_one_stops;
+  // Historical speed profiles the directed edges refer to and their count
+  SpeedProfile* speed_profiles_;
+  uint32_t speed_profile_count_;
+
+  // Where the signs, access restrictions and lane connections of each
+  // directed edge start, nullptr if the tile has no index and they are
+  // searched for instead
+  EdgeAttributeIndex* edge_attribute_index_;
+
+  // Fixed point shapes of the edge infos and their index, nullptr if the
+  // tile only has the encoded shapes
+  FixedShapeIndex* fixed_shape_index_;
+  uint32_t fixed_shape_index_count_;
+  FixedPoint* fixed_shape_points_;
+
+  // Base edges of the shortcut edges and their index, nullptr if the tile
+  // doesn't keep them
+  ShortcutEdgesIndex* shortcut_edges_index_;
+  uint32_t shortcut_edges_index_count_;
+  GraphId* shortcut_base_edges_;
+
+  // Segment index of the bins, built on demand and only accessed atomically
+  mutable std::shared_ptr<const SegmentIndex> segment_index_;
+
+  // Lookups built from the tile data when the tile is initialized. They
+  // never change after that so every copy of the tile shares them, putting a
+  // tile into a cache only copies pointers
+  struct derived_t {
+    restriction_index_t complex_restriction_forward_index;
+    restriction_index_t complex_restriction_reverse_index;
+
+    // Map of stop one stops in this tile.
+    std::unordered_map<std::string, tile_index_pair> stop_one_stops;
+
+    // Map of route one stops in this tile.
+    std::unordered_map<std::string, std::list<tile_index_pair>> route_one_stops;
+
+    // Map of operator one stops in this tile.
+    std::unordered_map<std::string, std::list<tile_index_pair>> oper_one_stops;
+
+    // Decoded shapes of the edges, nullptr if the process keeps none
+    std::unique_ptr<EdgeShapeCache> shape_cache;
+
+    // Packed forward and reverse access of each directed edge
+    std::vector<uint32_t> edge_access;
+  };
+  std::shared_ptr<const derived_t> derived_;
+
+  /**
+   * Read an lz4 compressed tile from disk into graphtile_.
+   * @param  file_location  Path to the compressed tile.
+   * @return Returns true if the tile was read and decompressed.
+   */
+  bool ReadCompressed(const std::string& file_location);
 
   /**
    * Set pointers to internal tile data structures.
@@ -525,6 +869,17 @@ class GraphTile {
   void Initialize(const GraphId& graphid, char* tile_ptr,
                   const size_t tile_size);
 
+  /**
+   * Index complex restrictions by the edge they are looked up by.
+   * @param  restrictions  Pointer to the complex restrictions.
+   * @param  size          Size of the complex restrictions in bytes.
+   * @param  forward       True for forward restrictions (indexed by their to
+   *                       edge), false for reverse (indexed by their from edge).
+   * @param  index         Set to the edge ids and offsets of the restrictions.
+   */
+  static void IndexRestrictions(char* restrictions, const std::size_t size,
+                                const bool forward, restriction_index_t& index);
+
   /**
    * For transit tiles, save off the pair<tileid,lineid> lookup via
    * onestop_ids.  This will be used for including or excluding transit lines
@@ -532,8 +887,9 @@ class GraphTile {
    * route's tile_line pairs and it is used to include or exclude the operator
    * as a whole. Also associates stops.
    * @param  graphid  Tile Id.
+   * @param  derived  Lookups of the tile to add the one stops to.
    */
-  void AssociateOneStopIds(const GraphId& graphid);
+  void AssociateOneStopIds(const GraphId& graphid, derived_t& derived);
 };
 
 }
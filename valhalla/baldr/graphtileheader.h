@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <string>
 
+#include <valhalla/baldr/graphconstants.h>
 #include <valhalla/baldr/graphid.h>
 
 namespace valhalla {
@@ -14,7 +15,7 @@ namespace baldr {
 // something to the tile simply subtract one from this number and add it
 // just before the empty_slots_ array below. NOTE that it can ONLY be an
 // offset in bytes and NOT a bitfield or union or anything of that sort
-constexpr size_t kEmptySlots = 13;
+constexpr size_t kEmptySlots = 7;
 
 // Maximum size of the version string (stored as a fixed size
 // character array so the GraphTileHeader size remains fixed).
@@ -105,6 +106,40 @@ class GraphTileHeader {
    */
   void set_density(const uint32_t density);
 
+  /**
+   * Get the factor the maximum number of upward transitions from this
+   * tile's level is scaled with for locations within the tile.
+   * @return  Returns the factor, 1 if it was never set.
+   */
+  float up_transition_factor() const {
+    return up_transition_factor_ == 0 ? 1.0f :
+           up_transition_factor_ * kHierarchyLimitsStep;
+  }
+
+  /**
+   * Set the factor the maximum number of upward transitions from this
+   * tile's level is scaled with.
+   * @param  factor  Factor, rounded to a multiple of kHierarchyLimitsStep.
+   */
+  void set_up_transition_factor(const float factor);
+
+  /**
+   * Get the factor the distance within which this tile's level is always
+   * expanded is scaled with for locations within the tile.
+   * @return  Returns the factor, 1 if it was never set.
+   */
+  float expansion_within_factor() const {
+    return expansion_within_factor_ == 0 ? 1.0f :
+           expansion_within_factor_ * kHierarchyLimitsStep;
+  }
+
+  /**
+   * Set the factor the distance within which this tile's level is always
+   * expanded is scaled with.
+   * @param  factor  Factor, rounded to a multiple of kHierarchyLimitsStep.
+   */
+  void set_expansion_within_factor(const float factor);
+
   /**
    * Get the relative quality of name assignment for this tile.
    * @return  Returns relative name quality for this tile (0-15).
@@ -203,6 +238,34 @@ class GraphTileHeader {
    */
   void set_departurecount(const uint32_t departures);
 
+  /**
+   * Gets the number of transit departure patterns in this tile.
+   * @return  Returns the number of departure patterns.
+   */
+  uint32_t departure_pattern_count() const {
+    return departure_pattern_count_;
+  }
+
+  /**
+   * Sets the number of transit departure patterns in this tile.
+   * @param patterns  The number of departure patterns.
+   */
+  void set_departure_pattern_count(const uint32_t patterns);
+
+  /**
+   * Gets the number of trips of the transit departure patterns in this tile.
+   * @return  Returns the number of pattern trips.
+   */
+  uint32_t pattern_trip_count() const {
+    return pattern_trip_count_;
+  }
+
+  /**
+   * Sets the number of trips of the transit departure patterns in this tile.
+   * @param trips  The number of pattern trips.
+   */
+  void set_pattern_trip_count(const uint32_t trips);
+
   /**
    * Gets the number of transit stops in this tile.
    * @return  Returns the number of transit stops.
@@ -458,6 +521,97 @@ class GraphTileHeader {
    */
   void set_edge_elevation_offset(const uint32_t offset);
 
+  /**
+   * Gets the offset to the edge bounding boxes. Tiles without them have
+   * this offset at the end of the tile.
+   * @return  Returns the number of bytes to offset to the edge bounding boxes.
+   */
+  uint32_t edge_bbox_offset() const {
+    return edge_bbox_offset_;
+  }
+
+  /**
+   * Sets the offset to the edge bounding boxes.
+   * @param offset Offset in bytes to the start of the edge bounding boxes.
+   */
+  void set_edge_bbox_offset(const uint32_t offset);
+
+  /**
+   * Gets the offset to the hot edges. Tiles without them have this offset
+   * at the end of the tile.
+   * @return  Returns the number of bytes to offset to the hot edges.
+   */
+  uint32_t hotedge_offset() const {
+    return hotedge_offset_;
+  }
+
+  /**
+   * Sets the offset to the hot edges.
+   * @param offset Offset in bytes to the start of the hot edges.
+   */
+  void set_hotedge_offset(const uint32_t offset);
+
+  /**
+   * Gets the offset to the historical speed profiles. Tiles without them
+   * have this offset at the end of the tile.
+   * @return  Returns the number of bytes to offset to the speed profiles.
+   */
+  uint32_t speed_profile_offset() const {
+    return speed_profile_offset_;
+  }
+
+  /**
+   * Sets the offset to the historical speed profiles.
+   * @param offset Offset in bytes to the start of the speed profiles.
+   */
+  void set_speed_profile_offset(const uint32_t offset);
+
+  /**
+   * Gets the offset to the edge attribute index, where the signs, access
+   * restrictions and lane connections of each directed edge start. Tiles
+   * without it have this offset at the end of the tile.
+   * @return  Returns the number of bytes to offset to the edge attribute index.
+   */
+  uint32_t edge_attribute_index_offset() const {
+    return edge_attribute_index_offset_;
+  }
+
+  /**
+   * Sets the offset to the edge attribute index.
+   * @param offset Offset in bytes to the start of the edge attribute index.
+   */
+  void set_edge_attribute_index_offset(const uint32_t offset);
+
+  /**
+   * Gets the offset to the fixed point shapes of the edge infos. Tiles
+   * without them have this offset at the end of the tile.
+   * @return  Returns the number of bytes to offset to the fixed point shapes.
+   */
+  uint32_t fixed_shape_offset() const {
+    return fixed_shape_offset_;
+  }
+
+  /**
+   * Sets the offset to the fixed point shapes.
+   * @param offset Offset in bytes to the start of the fixed point shapes.
+   */
+  void set_fixed_shape_offset(const uint32_t offset);
+
+  /**
+   * Gets the offset to the base edges of the shortcut edges. Tiles without
+   * them have this offset at the end of the tile.
+   * @return  Returns the number of bytes to offset to the shortcut edges.
+   */
+  uint32_t shortcut_edges_offset() const {
+    return shortcut_edges_offset_;
+  }
+
+  /**
+   * Sets the offset to the base edges of the shortcut edges.
+   * @param offset Offset in bytes to the start of the shortcut edges.
+   */
+  void set_shortcut_edges_offset(const uint32_t offset);
+
   /**
    * Get the offset to the end of the tile
    * @return the number of bytes in the tile, unless the last slot is used
@@ -485,7 +639,15 @@ class GraphTileHeader {
   uint64_t name_quality_  : 4;
   uint64_t speed_quality_ : 4;
   uint64_t exit_quality_  : 4;
-  uint64_t spare1_        : 48;
+
+  // Factors the hierarchy limits of this tile's level are scaled with near
+  // locations within the tile, in steps of kHierarchyLimitsStep. 0 if unset.
+  uint64_t up_transition_factor_    : 4;
+  uint64_t expansion_within_factor_ : 4;
+
+  // Number of transit departure patterns and of the trips of the patterns
+  uint64_t departure_pattern_count_ : 16;
+  uint64_t pattern_trip_count_      : 24;
 
   // Number of transit records
   uint64_t departurecount_ : 24;
@@ -532,6 +694,28 @@ class GraphTileHeader {
   // Offset to the beginning of the edge elevation data.
   uint32_t edge_elevation_offset_;
 
+  // Offset to the beginning of the bounding boxes of the directed edges.
+  uint32_t edge_bbox_offset_;
+
+  // Offset to the beginning of the hot edges (one per directed edge).
+  uint32_t hotedge_offset_;
+
+  // Offset to the beginning of the speed profile index of the directed edges
+  // followed by the speed profiles they refer to.
+  uint32_t speed_profile_offset_;
+
+  // Offset to the beginning of the edge attribute index (one per directed
+  // edge plus one).
+  uint32_t edge_attribute_index_offset_;
+
+  // Offset to the beginning of the fixed point shapes, the number of index
+  // entries then the index of the edge infos then the shape points.
+  uint32_t fixed_shape_offset_;
+
+  // Offset to the beginning of the base edges of the shortcut edges, the
+  // number of index entries then the index of the shortcuts then the edges.
+  uint32_t shortcut_edges_offset_;
+
   // Marks the end of this version of the tile with the rest of the slots
   // being available for growth. If you want to use one of the empty slots,
   // simply add a uint32_t some_offset_; just above empty_slots_ and decrease
@@ -0,0 +1,115 @@
+#ifndef VALHALLA_BALDR_HOTEDGE_H_
+#define VALHALLA_BALDR_HOTEDGE_H_
+
+#include <cstdint>
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The part of a directed edge that path expansion looks at before it knows
+ * whether the edge is worth costing: its end node, access, transition and
+ * shortcut flags. Tiles keep an array of these alongside the directed edges
+ * (same index) so that the edges that get skipped, which are most of them,
+ * are checked at 4 per cache line rather than pulling in the whole directed
+ * edge. Everything else, what costing and trip path building use, stays in
+ * the directed edge.
+ */
+class HotEdge {
+ public:
+  /**
+   * Constructor.
+   */
+  HotEdge();
+
+  /**
+   * Constructor with arguments.
+   * @param  edge  Directed edge to take the hot attributes from.
+   */
+  HotEdge(const DirectedEdge& edge);
+
+  /**
+   * Gets the end node of this directed edge.
+   * @return  Returns the end node.
+   */
+  GraphId endnode() const {
+    return GraphId(endnode_);
+  }
+
+  /**
+   * Get the access modes in the forward direction (bit field).
+   * @return  Returns the access modes in the forward direction.
+   */
+  uint32_t forwardaccess() const {
+    return forwardaccess_;
+  }
+
+  /**
+   * Get the access modes in the reverse direction (bit field).
+   * @return  Returns the access modes in the reverse direction.
+   */
+  uint32_t reverseaccess() const {
+    return reverseaccess_;
+  }
+
+  /**
+   * Mask indicating the shortcut that supersedes this directed edge.
+   * @return  Returns the shortcut mask of the matching superseded edge
+   *          outbound from the node. 0 indicates the edge is not superseded.
+   */
+  uint32_t superseded() const {
+    return superseded_;
+  }
+
+  /**
+   * Does this edge represent a transition up one level in the hierarchy.
+   * @return  Returns true if the edge is a transition up.
+   */
+  bool trans_up() const {
+    return trans_up_;
+  }
+
+  /**
+   * Does this edge represent a transition down one level in the hierarchy.
+   * @return  Returns true if the edge is a transition down.
+   */
+  bool trans_down() const {
+    return trans_down_;
+  }
+
+  /**
+   * Is this edge a shortcut edge.
+   * @return  Returns true if this edge is a shortcut.
+   */
+  bool is_shortcut() const {
+    return is_shortcut_;
+  }
+
+  /**
+   * Does this directed edge end in a different tile.
+   * @return  Returns true if the end node is in a different tile.
+   */
+  bool leaves_tile() const {
+    return leaves_tile_;
+  }
+
+ protected:
+  uint64_t endnode_       : 46; // End node of the directed edge
+  uint64_t superseded_    : 7;  // Edge is superseded by a shortcut (mask)
+  uint64_t trans_up_      : 1;  // Transition up one level
+  uint64_t trans_down_    : 1;  // Transition down one level
+  uint64_t is_shortcut_   : 1;  // True if this edge is a shortcut
+  uint64_t leaves_tile_   : 1;  // True if the end node is in another tile
+  uint64_t spare1_        : 7;
+
+  uint64_t forwardaccess_ : 12; // Access (bit mask) in forward direction
+  uint64_t reverseaccess_ : 12; // Access (bit mask) in reverse direction
+  uint64_t spare2_        : 40;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_HOTEDGE_H_
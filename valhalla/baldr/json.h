@@ -12,6 +12,8 @@
 #include <list>
 #include <sstream>
 #include <iomanip>
+#include <cstdio>
+#include <vector>
 
 namespace valhalla {
 namespace baldr {
@@ -137,6 +139,136 @@ inline std::ostream& operator<<(std::ostream& stream, const Jarray& json){
   return stream;
 }
 
+/**
+ * Writes json straight into a string as it goes, instead of building the maps
+ * and arrays first and visiting them afterwards. Members are written in the
+ * order they are given, so the caller opens and closes each object and array
+ * around them. The output is the same text the ostream operators make.
+ */
+class Writer {
+ public:
+  Writer(std::string& buffer):buffer_(buffer), separator_(false) {}
+
+  //open and close objects and arrays, optionally as the value of a key
+  void start_object() { begin(); buffer_.push_back('{'); separator_ = false; }
+  void start_object(const std::string& key) { name(key); start_object(); }
+  void end_object() { buffer_.push_back('}'); separator_ = true; }
+  void start_array() { begin(); buffer_.push_back('['); separator_ = false; }
+  void start_array(const std::string& key) { name(key); start_array(); }
+  void end_array() { buffer_.push_back(']'); separator_ = true; }
+
+  //write a value as an array element or as the value of a key
+  template <class T>
+  void operator()(const T& value) { begin(); write(value); separator_ = true; }
+  template <class T>
+  void operator()(const std::string& key, const T& value) { name(key); write(value); separator_ = true; }
+
+ protected:
+  //how we write the different primitives and any already built values
+  void write(const std::string& value) {
+    buffer_.push_back('"');
+    for (const auto& c : value) {
+      switch (c) {
+      case '\\': buffer_.append("\\\\"); break;
+      case '"': buffer_.append("\\\""); break;
+      case '/': buffer_.append("\\/"); break;
+      case '\b': buffer_.append("\\b"); break;
+      case '\f': buffer_.append("\\f"); break;
+      case '\n': buffer_.append("\\n"); break;
+      case '\r': buffer_.append("\\r"); break;
+      case '\t': buffer_.append("\\t"); break;
+      default:
+        if(c >= 0 && c < 32) {
+          char hex[8];
+          snprintf(hex, sizeof(hex), "\\u%04X", static_cast<int>(c));
+          buffer_.append(hex);
+        }
+        else
+          buffer_.push_back(c);
+        break;
+      }
+    }
+    buffer_.push_back('"');
+  }
+  void write(const char* value) { write(std::string(value)); }
+  void write(uint64_t value) { number("%" PRIu64, value); }
+  void write(int64_t value) { number("%" PRId64, value); }
+  void write(const fp_t& value) {
+    char text[64];
+    auto length = snprintf(text, sizeof(text), "%.*Lf", static_cast<int>(value.precision), value.value);
+    //big values dont fit on the stack
+    std::vector<char> big;
+    if (length >= static_cast<int>(sizeof(text))) {
+      big.resize(length + 1);
+      snprintf(big.data(), big.size(), "%.*Lf", static_cast<int>(value.precision), value.value);
+    }
+    if(!std::isfinite(value.value))
+      buffer_.push_back('"');
+    buffer_.append(big.empty() ? text : big.data(), length);
+    if(!std::isfinite(value.value))
+      buffer_.push_back('"');
+  }
+  void write(bool value) { buffer_.append(value ? "true" : "false"); }
+  void write(std::nullptr_t) { buffer_.append("null"); }
+  void write(const MapPtr& value);
+  void write(const ArrayPtr& value);
+  void write(const Value& value);
+
+  template <class T>
+  void number(const char* format, T value) {
+    char text[24];
+    buffer_.append(text, snprintf(text, sizeof(text), format, value));
+  }
+  void begin() {
+    if(separator_)
+      buffer_.push_back(',');
+  }
+  void name(const std::string& key) {
+    begin();
+    write(key);
+    buffer_.push_back(':');
+    separator_ = false;
+  }
+
+  std::string& buffer_;
+  bool separator_;
+};
+
+//lets the writer write any already built value
+class WriterVisitor : public boost::static_visitor<>
+{
+ public:
+  WriterVisitor(Writer& writer):writer_(writer){}
+  template <class T>
+  void operator()(const T& value) const { writer_(value); }
+ private:
+  Writer& writer_;
+};
+
+inline void Writer::write(const MapPtr& value) {
+  buffer_.push_back('{');
+  separator_ = false;
+  for(const auto& key_value : *value) {
+    name(key_value.first);
+    write(key_value.second);
+    separator_ = true;
+  }
+  buffer_.push_back('}');
+}
+
+inline void Writer::write(const ArrayPtr& value) {
+  buffer_.push_back('[');
+  separator_ = false;
+  for(const auto& element : *value)
+    boost::apply_visitor(WriterVisitor(*this), element);
+  buffer_.push_back(']');
+}
+
+inline void Writer::write(const Value& value) {
+  //already past the separator so write the bare value
+  boost::apply_visitor(WriterVisitor(*this), value);
+}
+
 inline MapPtr map(std::initializer_list<Jmap::value_type> list) {
   return MapPtr(new Jmap(list));
 }
@@ -0,0 +1,325 @@
+#ifndef VALHALLA_BALDR_LABEL_BUCKET_QUEUE_H_
+#define VALHALLA_BALDR_LABEL_BUCKET_QUEUE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Bucket layout storing each bucket as its own vector of label indexes.
+ * This is the same layout DoubleBucketQueue uses.
+ */
+class VectorBucketLayout {
+ public:
+  void resize(const size_t count) {
+    buckets_.resize(count);
+  }
+
+  void push(const uint32_t bucket, const uint32_t label) {
+    buckets_[bucket].push_back(label);
+  }
+
+  void remove(const uint32_t bucket, const uint32_t label) {
+    auto& b = buckets_[bucket];
+    auto itr = std::find(b.begin(), b.end(), label);
+    if (itr != b.end())
+      b.erase(itr);
+  }
+
+  bool empty(const uint32_t bucket) const {
+    return buckets_[bucket].empty();
+  }
+
+  uint32_t pop(const uint32_t bucket) {
+    uint32_t label = buckets_[bucket].back();
+    buckets_[bucket].pop_back();
+    return label;
+  }
+
+  void clear(const uint32_t bucket) {
+    buckets_[bucket].clear();
+  }
+
+  template <class visitor_t>
+  void for_each(const uint32_t bucket, const visitor_t& visit) const {
+    for (const auto label : buckets_[bucket])
+      visit(label);
+  }
+
+  // Empties the bucket, handing each label to move. Labels may be pushed
+  // back onto the same bucket while moving.
+  template <class visitor_t>
+  void drain(const uint32_t bucket, const visitor_t& move) {
+    scratch_.clear();
+    scratch_.swap(buckets_[bucket]);
+    for (const auto label : scratch_)
+      move(label);
+  }
+
+ private:
+  std::vector<std::vector<uint32_t> > buckets_;
+  std::vector<uint32_t> scratch_;
+};
+
+/**
+ * Flat bucket layout. Each bucket is an intrusive doubly linked list kept in
+ * arrays indexed by label, so there is no allocation per bucket, removal is
+ * constant time and the whole queue lives in three contiguous arrays. Label
+ * indexes should be dense since the link arrays are sized by the largest
+ * label seen.
+ */
+class FlatBucketLayout {
+ public:
+  void resize(const size_t count) {
+    heads_.resize(count, kInvalidLabel);
+  }
+
+  void push(const uint32_t bucket, const uint32_t label) {
+    if (label >= next_.size()) {
+      size_t size = std::max(static_cast<size_t>(label) + 1, next_.size() * 2);
+      next_.resize(size, kInvalidLabel);
+      prev_.resize(size, kInvalidLabel);
+    }
+    uint32_t head = heads_[bucket];
+    next_[label] = head;
+    prev_[label] = kInvalidLabel;
+    if (head != kInvalidLabel)
+      prev_[head] = label;
+    heads_[bucket] = label;
+  }
+
+  void remove(const uint32_t bucket, const uint32_t label) {
+    uint32_t next = next_[label];
+    uint32_t prev = prev_[label];
+    if (prev == kInvalidLabel)
+      heads_[bucket] = next;
+    else
+      next_[prev] = next;
+    if (next != kInvalidLabel)
+      prev_[next] = prev;
+  }
+
+  bool empty(const uint32_t bucket) const {
+    return heads_[bucket] == kInvalidLabel;
+  }
+
+  uint32_t pop(const uint32_t bucket) {
+    uint32_t label = heads_[bucket];
+    uint32_t next = next_[label];
+    heads_[bucket] = next;
+    if (next != kInvalidLabel)
+      prev_[next] = kInvalidLabel;
+    return label;
+  }
+
+  void clear(const uint32_t bucket) {
+    heads_[bucket] = kInvalidLabel;
+  }
+
+  template <class visitor_t>
+  void for_each(const uint32_t bucket, const visitor_t& visit) const {
+    for (uint32_t label = heads_[bucket]; label != kInvalidLabel; label = next_[label])
+      visit(label);
+  }
+
+  // Empties the bucket, handing each label to move. Labels may be pushed
+  // back onto the same bucket while moving.
+  template <class visitor_t>
+  void drain(const uint32_t bucket, const visitor_t& move) {
+    uint32_t label = heads_[bucket];
+    heads_[bucket] = kInvalidLabel;
+    while (label != kInvalidLabel) {
+      uint32_t next = next_[label];
+      move(label);
+      label = next;
+    }
+  }
+
+ private:
+  std::vector<uint32_t> heads_;  // First label in each bucket
+  std::vector<uint32_t> next_;   // Next label in the same bucket
+  std::vector<uint32_t> prev_;   // Previous label in the same bucket
+};
+
+/**
+ * Double bucket queue specialized on the label type. Behaves exactly like
+ * DoubleBucketQueue but reads the cost straight from the labels' sortcost()
+ * rather than calling through a std::function, which lets the compiler
+ * inline the cost lookup on every add, decrease and overflow move. The bucket
+ * storage is a template parameter, either VectorBucketLayout (the layout of
+ * DoubleBucketQueue) or FlatBucketLayout.
+ */
+template <class label_t, class layout_t = VectorBucketLayout>
+class LabelBucketQueue {
+ public:
+  /**
+   * Constructor given a minimum cost, a range of costs held within the
+   * bucket sort, and a bucket size. All costs above mincost + range are
+   * stored in an "overflow" bucket.
+   * @param mincost    Minimum cost. Used to create the initial range for
+   *                   bucket sorting.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   *                   Must be an integer value.
+   * @param labels     Labels the queued label indexes refer to. The vector
+   *                   must outlive the queue but may grow while in use.
+   */
+  LabelBucketQueue(const float mincost, const float range,
+                   const uint32_t bucketsize, const std::vector<label_t>& labels)
+      : labels_(&labels) {
+    // We need at least a bucketsize of 1 or more
+    if (bucketsize < 1)
+      throw std::runtime_error("Bucketsize must be 1 or greater");
+
+    // We need at least a bucketrange of something larger than 0
+    if (range <= 0.f)
+      throw std::runtime_error("Bucketrange must be greater than 0");
+
+    // Adjust min cost to be the start of a bucket
+    uint32_t c = static_cast<uint32_t>(mincost);
+    currentcost_ = (c - (c % bucketsize));
+    mincost_ = currentcost_;
+    bucketrange_ = range;
+    bucketsize_ = static_cast<float>(bucketsize);
+    inv_ = 1.0f / bucketsize_;
+    maxcost_ = mincost_ + bucketrange_;
+
+    // Allocate the low-level buckets plus one more for the overflow
+    bucketcount_ = static_cast<uint32_t>(range / bucketsize_) + 1;
+    overflowbucket_ = bucketcount_;
+    buckets_.resize(bucketcount_ + 1);
+    currentbucket_ = 0;
+  }
+
+  /**
+   * Clear all labels from the low-level buckets and the overflow buckets.
+   */
+  void clear() {
+    buckets_.clear(overflowbucket_);
+    for (; currentbucket_ < bucketcount_; ++currentbucket_)
+      buckets_.clear(currentbucket_);
+    currentcost_ = mincost_;
+    currentbucket_ = 0;
+  }
+
+  /**
+   * Adds a label index to the bucketed sort. Adds it to the appropriate bucket
+   * given the label's sort cost.
+   * @param   label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) {
+    buckets_.push(get_bucket(cost(label)), label);
+  }
+
+  /**
+   * The specified label index now has a smaller cost. Reorders it in the
+   * sorted bucket list. Must be called before the label's sort cost is
+   * updated since that is how the current bucket is found.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) {
+    uint32_t prevbucket = get_bucket(cost(label));
+    uint32_t newbucket = get_bucket(newcost);
+    if (prevbucket != newbucket) {
+      buckets_.remove(prevbucket, label);
+      buckets_.push(newbucket, label);
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the sorted buckets.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the buckets are empty.
+   */
+  uint32_t pop() {
+    if (empty()) {
+      if (buckets_.empty(overflowbucket_)) {
+        // Reset currentbucket to the last bucket - in case another access of
+        // adjacency list is done.
+        currentbucket_ = bucketcount_ - 1;
+        return kInvalidLabel;
+      }
+      empty_overflow();
+      if (empty())
+        return kInvalidLabel;
+    }
+    return buckets_.pop(currentbucket_);
+  }
+
+ private:
+  float cost(const uint32_t label) const {
+    return (*labels_)[label].sortcost();
+  }
+
+  uint32_t get_bucket(const float cost) const {
+    return (cost < currentcost_) ? currentbucket_ :
+             (cost < maxcost_) ?
+               static_cast<uint32_t>((cost - mincost_) * inv_) :
+               overflowbucket_;
+  }
+
+  bool empty() {
+    while (currentbucket_ < bucketcount_ && buckets_.empty(currentbucket_)) {
+      currentbucket_++;
+      currentcost_ += bucketsize_;
+    }
+    return currentbucket_ == bucketcount_;
+  }
+
+  void empty_overflow() {
+    // Find the minimum cost so we can figure out where the new range should be
+    float min = std::numeric_limits<float>::max();
+    buckets_.for_each(overflowbucket_, [this, &min](const uint32_t label) {
+      min = std::min(min, cost(label));
+    });
+
+    // Adjust cost range so smallest element is in the low level buckets
+    mincost_ += (std::floor((min - mincost_) / bucketrange_)) * bucketrange_;
+
+    // Avoid precision issues
+    if (mincost_ > min)
+      mincost_ -= bucketrange_;
+    else if (mincost_ + bucketrange_ < min)
+      mincost_ += bucketrange_;
+    maxcost_ = mincost_ + bucketrange_;
+
+    // Move elements within the range from overflow to buckets, the rest go
+    // back into the overflow bucket
+    buckets_.drain(overflowbucket_, [this](const uint32_t label) {
+      float c = cost(label);
+      buckets_.push(c < maxcost_ ? static_cast<uint32_t>((c - mincost_) * inv_) :
+                    overflowbucket_, label);
+    });
+
+    // Reset current cost and bucket to beginning of low level buckets
+    currentcost_ = mincost_;
+    currentbucket_ = 0;
+  }
+
+  float bucketrange_;  // Total range of costs in lower level buckets
+  float bucketsize_;   // Bucket size (range of costs in same bucket)
+  float inv_;          // 1/bucketsize (so we can avoid division)
+  float mincost_;      // Minimum cost within the low level buckets
+  float maxcost_;      // Above this goes into overflow bucket
+  float currentcost_;  // Current cost
+
+  uint32_t bucketcount_;     // Number of low level buckets
+  uint32_t overflowbucket_;  // Index of the overflow bucket
+  uint32_t currentbucket_;   // Current low level bucket
+  layout_t buckets_;         // Low level buckets followed by the overflow
+
+  const std::vector<label_t>* labels_;  // Labels the indexes refer to
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_LABEL_BUCKET_QUEUE_H_
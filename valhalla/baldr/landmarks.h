@@ -0,0 +1,158 @@
+#ifndef VALHALLA_BALDR_LANDMARKS_H_
+#define VALHALLA_BALDR_LANDMARKS_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Invalid landmark node index
+constexpr uint32_t kInvalidLandmarkNode = std::numeric_limits<uint32_t>::max();
+
+// Cost to or from a landmark of a node that can't reach it or be reached
+constexpr float kUnreachableLandmark = std::numeric_limits<float>::infinity();
+
+// File extension of the landmark tables, the file name is the name of the
+// costing they were built for
+constexpr const char* kLandmarksExtension = ".landmarks";
+
+/**
+ * Landmark (ALT) cost tables for one costing profile. For a handful of
+ * landmark nodes spread over the graph it keeps the least cost from each
+ * landmark to every node and from every node to each landmark. By the
+ * triangle inequality the cost of any path from a node u to a node v is at
+ * least cost(L, v) - cost(L, u) and cost(u, L) - cost(v, L) for every
+ * landmark L, which is a much tighter lower bound on real networks than the
+ * straight line distance.
+ *
+ * The nodes are the graph nodes of every tile, numbered tile by tile in the
+ * order of their tile ids. The costs of a node are kept together, the cost
+ * from and to each landmark in turn.
+ */
+class Landmarks {
+ public:
+  /**
+   * Constructor for empty tables.
+   */
+  Landmarks();
+
+  /**
+   * Constructor.
+   * @param  costing    Name of the costing the tables were built for
+   * @param  tiles      Tile id of each tile with nodes, sorted by id
+   * @param  offsets    Index of the first node of each tile, with one extra
+   *                    entry at the end for the total number of nodes
+   * @param  landmarks  Node index of each landmark
+   * @param  costs      For each node the cost from and to each landmark
+   */
+  Landmarks(const std::string& costing, std::vector<GraphId>&& tiles,
+            std::vector<uint32_t>&& offsets, std::vector<uint32_t>&& landmarks,
+            std::vector<float>&& costs);
+
+  /**
+   * Load landmark tables from a file written with Write.
+   * @param  file_name  File to load
+   * @return Returns the tables, throws if the file can't be read or doesn't
+   *         hold landmark tables.
+   */
+  static Landmarks Load(const std::string& file_name);
+
+  /**
+   * Write the tables to a file.
+   * @param  file_name  File to write
+   */
+  void Write(const std::string& file_name) const;
+
+  /**
+   * Get the name of the landmarks file for a costing.
+   * @param  tile_dir  Tile directory the tables are kept in
+   * @param  costing   Name of the costing
+   * @return Returns the path of the landmarks file
+   */
+  static std::string FileName(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * @return Returns the name of the costing the tables were built for
+   */
+  const std::string& costing() const {
+    return costing_;
+  }
+
+  /**
+   * @return Returns the number of landmarks
+   */
+  size_t landmark_count() const {
+    return landmarks_.size();
+  }
+
+  /**
+   * @return Returns the number of nodes with costs
+   */
+  size_t node_count() const {
+    return offsets_.back();
+  }
+
+  /**
+   * Get the node index of a landmark.
+   * @param  landmark  Landmark index
+   * @return Returns the node index of the landmark
+   */
+  uint32_t landmark(const size_t landmark) const {
+    return landmarks_[landmark];
+  }
+
+  /**
+   * Get the node index of a graph node.
+   * @param  nodeid  Graph node id
+   * @return Returns the node index or kInvalidLandmarkNode if the tables
+   *         were built without the node's tile
+   */
+  uint32_t node(const GraphId& nodeid) const;
+
+  /**
+   * Get the least cost from a landmark to a node.
+   * @param  node      Node index
+   * @param  landmark  Landmark index
+   * @return Returns the cost or kUnreachableLandmark
+   */
+  float cost_from(const uint32_t node, const size_t landmark) const {
+    return costs_[(static_cast<size_t>(node) * landmarks_.size() + landmark) * 2];
+  }
+
+  /**
+   * Get the least cost from a node to a landmark.
+   * @param  node      Node index
+   * @param  landmark  Landmark index
+   * @return Returns the cost or kUnreachableLandmark
+   */
+  float cost_to(const uint32_t node, const size_t landmark) const {
+    return costs_[(static_cast<size_t>(node) * landmarks_.size() + landmark) * 2 + 1];
+  }
+
+  /**
+   * Get a lower bound of the cost of going from one node to another. Only
+   * landmarks both nodes are connected with count, if there are none the
+   * bound is 0.
+   * @param  from  Node index of the node to go from
+   * @param  to    Node index of the node to go to
+   * @return Returns the largest lower bound any landmark gives
+   */
+  float LowerBound(const uint32_t from, const uint32_t to) const;
+
+ protected:
+  std::string costing_;
+  std::vector<GraphId> tiles_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> landmarks_;
+  std::vector<float> costs_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_LANDMARKS_H_
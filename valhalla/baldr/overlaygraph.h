@@ -0,0 +1,143 @@
+#ifndef VALHALLA_BALDR_OVERLAYGRAPH_H_
+#define VALHALLA_BALDR_OVERLAYGRAPH_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/util.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Invalid overlay node index
+constexpr uint32_t kInvalidOverlayNode = std::numeric_limits<uint32_t>::max();
+
+// File extension of a boundary overlay, the file name is the name of the
+// costing it was built for
+constexpr const char* kOverlayGraphExtension = ".mld";
+
+/**
+ * An arc of the boundary overlay, the cheapest way across a cell from the
+ * edge entering it to one of the edges leaving it.
+ */
+struct OverlayArc {
+  uint32_t node;    // Node the arc leads to
+  float cost;       // Cost of the turns and edges after the node left, up to
+                    // and including the edge of the node it leads to
+  float secs;       // Elapsed time in seconds along the arc
+  float length;     // Length in meters along the arc
+};
+
+/**
+ * Edge based overlay of the boundaries of the level 0 tiles for one costing
+ * profile, in the style of multi level dijkstra with the tiles as its cells.
+ * Each node of the overlay is a level 0 directed edge that ends in another
+ * tile than it starts in. Its arcs are the cheapest ways across the tile it
+ * enters to each of the nodes leaving that tile, found with turn costs over
+ * the level 0 edges of the tile alone. So a path between two nodes of the
+ * overlay costs the same as the cheapest path between their edges over all
+ * of level 0, while a search of it only settles the few edges crossing the
+ * tile boundaries.
+ */
+class OverlayGraph {
+ public:
+  /**
+   * Constructor for an empty overlay.
+   */
+  OverlayGraph();
+
+  /**
+   * Constructor.
+   * @param  costing  Name of the costing the overlay was built for
+   * @param  edges    Directed edge of each node, sorted by id
+   * @param  offsets  Index of the first arc of each node, with one extra
+   *                  entry at the end
+   * @param  arcs     Arcs leaving the nodes
+   */
+  OverlayGraph(const std::string& costing, std::vector<GraphId>&& edges,
+               std::vector<uint32_t>&& offsets, std::vector<OverlayArc>&& arcs);
+
+  /**
+   * Load an overlay from a file written with Write.
+   * @param  file_name  File to load
+   * @return Returns the overlay, throws if the file can't be read or isn't
+   *         a boundary overlay.
+   */
+  static OverlayGraph Load(const std::string& file_name);
+
+  /**
+   * Write the overlay to a file.
+   * @param  file_name  File to write
+   */
+  void Write(const std::string& file_name) const;
+
+  /**
+   * Get the name of the overlay file for a costing.
+   * @param  tile_dir  Tile directory the overlay is kept in
+   * @param  costing   Name of the costing
+   * @return Returns the path of the overlay file
+   */
+  static std::string FileName(const std::string& tile_dir, const std::string& costing);
+
+  /**
+   * @return Returns the name of the costing the overlay was built for
+   */
+  const std::string& costing() const {
+    return costing_;
+  }
+
+  /**
+   * @return Returns the number of nodes (boundary edges) in the overlay
+   */
+  size_t node_count() const {
+    return edges_.size();
+  }
+
+  /**
+   * @return Returns the number of arcs in the overlay
+   */
+  size_t arc_count() const {
+    return arcs_.size();
+  }
+
+  /**
+   * Get the node of a directed edge.
+   * @param  edgeid  Directed edge id
+   * @return Returns the node or kInvalidOverlayNode if the edge doesn't
+   *         cross a tile boundary or the costing never allows it
+   */
+  uint32_t node(const GraphId& edgeid) const;
+
+  /**
+   * Get the directed edge of a node.
+   * @param  node  Node index
+   * @return Returns the directed edge id
+   */
+  const GraphId& edgeid(const uint32_t node) const {
+    return edges_[node];
+  }
+
+  /**
+   * Get the arcs of a node, across the tile its edge enters.
+   * @param  node  Node index
+   * @return Returns the arcs leaving the node
+   */
+  midgard::iterable_t<const OverlayArc> arcs(const uint32_t node) const {
+    return midgard::iterable_t<const OverlayArc>(arcs_.data() + offsets_[node],
+                                                 arcs_.data() + offsets_[node + 1]);
+  }
+
+ protected:
+  std::string costing_;
+  std::vector<GraphId> edges_;
+  std::vector<uint32_t> offsets_;
+  std::vector<OverlayArc> arcs_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_OVERLAYGRAPH_H_
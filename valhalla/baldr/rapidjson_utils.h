@@ -1,8 +1,12 @@
 #ifndef VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 #define VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 #include <boost/optional.hpp>
 #include <boost/lexical_cast.hpp>
@@ -28,6 +32,41 @@ inline std::string to_string(const T& document_or_value) {
   return std::string(buffer.GetString(), buffer.GetSize());
 }
 
+//writes the value with the members of each object in name order so equal json gives equal output
+template<typename W>
+inline void write_canonical(W& writer, const rapidjson::Value& value) {
+  if(value.IsObject()) {
+    std::vector<const rapidjson::Value::Member*> members;
+    members.reserve(value.MemberCount());
+    for(const auto& member : value.GetObject())
+      members.push_back(&member);
+    std::sort(members.begin(), members.end(), [](const rapidjson::Value::Member* a, const rapidjson::Value::Member* b) {
+      return std::strcmp(a->name.GetString(), b->name.GetString()) < 0;
+    });
+    writer.StartObject();
+    for(const auto* member : members) {
+      writer.Key(member->name.GetString(), member->name.GetStringLength());
+      write_canonical(writer, member->value);
+    }
+    writer.EndObject();
+  }
+  else if(value.IsArray()) {
+    writer.StartArray();
+    for(const auto& element : value.GetArray())
+      write_canonical(writer, element);
+    writer.EndArray();
+  }
+  else
+    value.Accept(writer);
+}
+
+inline std::string to_canonical_string(const rapidjson::Value& value) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  write_canonical(writer, value);
+  return std::string(buffer.GetString(), buffer.GetSize());
+}
+
 /* NOTE: all of these helper functions use the dom traversal style syntax for accessing nested keys
  * what this means is that every path you provide has to begin with '/' and allows for multiple to get at children
  * these functions don't currently check for '/' because rapidjson will throw when its not found
@@ -59,6 +98,12 @@ inline typename std::enable_if<std::is_arithmetic<T>::value, boost::optional<T>
     return ptr->template Get<T>();
   //try to convert from a string
   if(ptr->IsString()) {
+    //lexical_cast only knows 0 and 1 but json written from a ptree spells bools out
+    if(std::is_same<T, bool>::value) {
+      std::string s = ptr->template Get<std::string>();
+      if(s == "true") return static_cast<T>(true);
+      if(s == "false") return static_cast<T>(false);
+    }
     try { return boost::lexical_cast<T>(ptr->template Get<std::string>()); }
     catch (...) { }
   }
@@ -0,0 +1,87 @@
+#ifndef VALHALLA_BALDR_SEGMENTINDEX_H_
+#define VALHALLA_BALDR_SEGMENTINDEX_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace baldr {
+
+class GraphReader;
+class GraphTile;
+
+/**
+ * Immutable spatial index of the line segments of the edges binned in a
+ * tile. It is built once per tile and shared by everyone reading the tile,
+ * so edge searches neither decode the shapes nor rebuild a grid again for
+ * every request. Each bin of the tile is divided into a grid of cells, and
+ * only the cells crossed by a segment are stored.
+ */
+class SegmentIndex {
+ public:
+
+  /**
+   * The edges of a bin and their segments. The segments of an edge are
+   * contiguous and kept as a structure of arrays so that a location can
+   * be projected onto a run of them at once.
+   */
+  struct Bin {
+    /**
+     * Get the edges with a segment in the cells overlapping the range.
+     * @param  range    Range to look in.
+     * @param  indexes  Indexes of the edges in the bin, appended sorted
+     *                  and without duplicates.
+     */
+    void Query(const midgard::AABB2<midgard::PointLL>& range,
+               std::vector<uint32_t>& indexes) const;
+
+    midgard::AABB2<midgard::PointLL> bounds;   // Bounds of the bin
+    uint32_t divisions;                        // Cells along each side
+    std::vector<GraphId> edgeids;              // Edges in the bin
+    std::vector<float> lengths;                // Length of the shape of each edge
+    std::vector<uint32_t> first_segment;       // First segment of each edge and one past the last
+    std::vector<float> ux, uy, vx, vy;         // Ends of each segment
+    std::vector<float> partial_lengths;        // Length of the shape before each segment
+    std::vector<uint32_t> cells;               // Cells crossed by a segment, sorted
+    std::vector<uint32_t> cell_offsets;        // First edge of each cell and one past the last
+    std::vector<uint32_t> cell_edges;          // Edges crossing each cell
+  };
+
+  /**
+   * Constructor. Indexes the edges of each bin of the tile, reading the
+   * tiles of the edges that are binned here but live elsewhere.
+   * @param  tile       Tile whose bins are indexed.
+   * @param  reader     Graph reader to get the other tiles from.
+   * @param  divisions  Number of cells along each side of a bin.
+   */
+  SegmentIndex(const GraphTile& tile, GraphReader& reader, const uint32_t divisions);
+
+  /**
+   * Get a bin.
+   * @param  index  Index of the bin within the tile (row ordered).
+   * @return Returns the bin.
+   */
+  const Bin& bin(const size_t index) const {
+    return bins_[index];
+  }
+
+  /**
+   * Number of cells along each side of a bin.
+   */
+  uint32_t divisions() const {
+    return divisions_;
+  }
+
+ protected:
+  uint32_t divisions_;
+  std::vector<Bin> bins_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_SEGMENTINDEX_H_
@@ -0,0 +1,80 @@
+#ifndef VALHALLA_BALDR_SHARD_MAP_H_
+#define VALHALLA_BALDR_SHARD_MAP_H_
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+  namespace baldr {
+
+    /**
+     * A cluster which serves the tiles of one region, its tiles are the tiles of every level that
+     * intersect the bounding box the region was cut with
+     */
+    struct shard_t {
+      std::string name;
+      std::string url;
+      midgard::AABB2<midgard::PointLL> bbox;
+    };
+
+    /**
+     * The regions a set of clusters split the graph into, for picking the cluster that can answer
+     * a request from the tiles its locations are in. Configured by loki.shards:
+     *
+     *   {"self": "benelux", "fallback": "planet", "regions": [
+     *     {"name": "benelux", "url": "http://benelux:8002", "bbox": [2.5, 49.4, 7.3, 53.6]}, ...]}
+     *
+     * where self names the region of this cluster and the optional fallback names the region to
+     * send requests to whose locations no single region holds. A region holds a location when it
+     * has every tile the location could be correlated in, that is every tile within the radius
+     * of the location at every level. So as not to keep every tile of a large region the tiles
+     * are checked against the bounding box of the region rather than looked up
+     */
+    class ShardMap {
+     public:
+      /**
+       * Constructs the map of the regions
+       * @param pt  the ptree sub child labeled shards in the loki config, throws if a region
+       *            is missing its url or bounding box or if self or fallback name no region
+       */
+      explicit ShardMap(const boost::property_tree::ptree& pt);
+
+      /**
+       * @return the region of this cluster
+       */
+      const shard_t& self() const;
+
+      /**
+       * @return the region to send requests to that no single region holds, null without one
+       */
+      const shard_t* fallback() const;
+
+      /**
+       * @return the regions in the order they were configured
+       */
+      const std::vector<shard_t>& shards() const;
+
+      /**
+       * Returns the region holding all of the locations, preferring this cluster's own region
+       * and otherwise the first configured region which holds them
+       * @param locations  the locations of a request
+       * @param radius     the distance in meters around each location to hold the tiles of
+       * @return the region or null if no region holds them all
+       */
+      const shard_t* Owner(const std::vector<midgard::PointLL>& locations, const float radius) const;
+
+     private:
+      std::vector<shard_t> shards_;
+      size_t self_;
+      size_t fallback_;
+    };
+
+  }
+}
+
+#endif  // VALHALLA_BALDR_SHARD_MAP_H_
@@ -0,0 +1,24 @@
+#ifndef VALHALLA_BALDR_SHORTCUT_EDGES_H_
+#define VALHALLA_BALDR_SHORTCUT_EDGES_H_
+
+#include <cstdint>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Where the base edges a shortcut edge was formed from start in the list of
+ * base edges of the tile. Entries are sorted by the index of the shortcut
+ * edge within the tile and followed by one past the last, so the base edges
+ * of a shortcut run up to where the next entry's start. The base edges are
+ * kept in the order they are traversed along the shortcut.
+ */
+struct ShortcutEdgesIndex {
+  uint32_t shortcut_index;
+  uint32_t first_edge;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_SHORTCUT_EDGES_H_
@@ -0,0 +1,88 @@
+#ifndef VALHALLA_BALDR_SPEED_PROFILE_H_
+#define VALHALLA_BALDR_SPEED_PROFILE_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// Speed profiles hold the speed at each hour of the week starting at
+// midnight on Sunday, local time
+constexpr uint32_t kSpeedProfileBuckets = 168;
+constexpr uint32_t kSecondsPerSpeedBucket = 3600;
+constexpr uint32_t kSecondsPerWeek = kSpeedProfileBuckets * kSecondsPerSpeedBucket;
+
+// Directed edges refer to the speed profiles of their tile by index starting
+// from 1, 0 means the edge has no profile
+constexpr uint16_t kNoSpeedProfile = 0;
+constexpr uint32_t kMaxSpeedProfiles = 65535;
+
+/**
+ * Historical speeds of the directed edges sharing it over a typical week.
+ * Tiles keep a small table of them, each edge refers to the one closest to
+ * how its speed varies so many edges share a profile.
+ */
+class SpeedProfile {
+ public:
+  /**
+   * Constructor of a profile without speeds.
+   */
+  SpeedProfile();
+
+  /**
+   * Constructor with arguments.
+   * @param  speeds  Speed (kph) at each hour of the week starting at
+   *                 midnight on Sunday, there should be kSpeedProfileBuckets
+   *                 of them. Missing hours have no speed.
+   */
+  SpeedProfile(const std::vector<uint8_t>& speeds);
+
+  /**
+   * Get the speed at a time of the week, interpolated between the hours on
+   * either side of it.
+   * @param  second_of_week  Seconds since midnight on Sunday, local time.
+   *                         Times past the end of the week wrap around.
+   * @return Returns the speed in kph, 0 if the profile has none then.
+   */
+  uint8_t speed(const uint32_t second_of_week) const {
+    uint32_t second = second_of_week % kSecondsPerWeek;
+    uint32_t bucket = second / kSecondsPerSpeedBucket;
+    uint32_t next = bucket + 1 == kSpeedProfileBuckets ? 0 : bucket + 1;
+    uint32_t from = speeds_[bucket];
+    uint32_t to = speeds_[next];
+    if (from == 0 || to == 0)
+      return from;
+    uint32_t into = second - bucket * kSecondsPerSpeedBucket;
+    return (from * (kSecondsPerSpeedBucket - into) + to * into +
+            kSecondsPerSpeedBucket / 2) / kSecondsPerSpeedBucket;
+  }
+
+  /**
+   * Get the speed (kph) at an hour of the week.
+   * @param  bucket  Hours since midnight on Sunday.
+   * @return Returns the speed in kph.
+   */
+  uint8_t bucket(const uint32_t bucket) const {
+    return speeds_[bucket];
+  }
+
+  bool operator==(const SpeedProfile& other) const;
+
+ protected:
+  uint8_t speeds_[kSpeedProfileBuckets];
+};
+
+/**
+ * Size in bytes of the profile index of the directed edges of a tile, which
+ * is padded so the profiles that follow it stay 4 byte aligned.
+ * @param  directededgecount  Number of directed edges in the tile.
+ */
+inline uint32_t SpeedProfileIndexSize(const uint32_t directededgecount) {
+  return (directededgecount * sizeof(uint16_t) + 3) & ~3u;
+}
+
+}
+}
+
+#endif  // VALHALLA_BALDR_SPEED_PROFILE_H_
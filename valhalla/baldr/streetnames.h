@@ -13,7 +13,12 @@
 namespace valhalla {
 namespace baldr {
 
-class StreetNames : public std::list<std::unique_ptr<StreetName>> {
+/**
+ * The names of a street. The names themselves never change once made so
+ * copies of a list, like clones and the names found in common with another
+ * list, share them rather than making new ones.
+ */
+class StreetNames : public std::list<std::shared_ptr<const StreetName>> {
  public:
   StreetNames();
 
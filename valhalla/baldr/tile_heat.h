@@ -0,0 +1,85 @@
+#ifndef VALHALLA_BALDR_TILE_HEAT_H_
+#define VALHALLA_BALDR_TILE_HEAT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * How often each tile was asked for, so a restarted service can load the
+ * tiles it will need most before it takes requests. Every reader counts the
+ * tiles it is asked for on its own and every so often adds its counts to
+ * those of the process, which are then written to the heat file, hottest
+ * tile first, by renaming a new file into place. The counts already in the
+ * file when the process starts are kept, so the file follows the traffic
+ * across restarts.
+ */
+class TileHeat {
+ public:
+  /**
+   * Constructor.
+   * @param  file           Heat file the counts are kept in.
+   * @param  flush_seconds  How often to add the counts to those of the process
+   *                        and write the file.
+   */
+  TileHeat(const std::string& file, const size_t flush_seconds);
+
+  /**
+   * Destructor. Adds the counts not flushed yet.
+   */
+  ~TileHeat();
+
+  /**
+   * Counts a tile being asked for.
+   * @param  base  Id of the tile.
+   */
+  void Count(const GraphId& base) {
+    ++counts_[base.value];
+  }
+
+  /**
+   * Adds the counts to those of the process and writes the heat file if it
+   * is time to. Call it between requests.
+   * @param  force  Whether to do it even if it is not time yet.
+   */
+  void Flush(const bool force = false);
+
+  /**
+   * Reads the hottest tiles of a heat file.
+   * @param  file   Heat file to read.
+   * @param  count  How many tiles to read at most, 0 for all of them.
+   * @return  Returns the id and count of each tile, hottest first.
+   */
+  static std::vector<std::pair<GraphId, uint64_t> > Read(const std::string& file, const size_t count = 0);
+
+  /**
+   * Writes a heat file, hottest tile first.
+   * @param  file    Heat file to write.
+   * @param  counts  How often each tile, by the value of its id, was asked for.
+   */
+  static void Write(const std::string& file, const std::unordered_map<uint64_t, uint64_t>& counts);
+
+ protected:
+  // Counts of every reader of the process with this heat file
+  struct totals_t;
+  std::shared_ptr<totals_t> totals_;
+  std::string file_;
+  std::chrono::steady_clock::duration flush_interval_;
+  std::chrono::steady_clock::time_point last_flush_;
+  // Counts since the last flush, by the value of the tile id
+  std::unordered_map<uint64_t, uint64_t> counts_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TILE_HEAT_H_
@@ -0,0 +1,63 @@
+#ifndef VALHALLA_BALDR_TILE_RING_H_
+#define VALHALLA_BALDR_TILE_RING_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphtile.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Reads batches of tiles from disk with a single io_uring submission on
+ * linux so that the kernel can fill the page cache for all of them at once
+ * rather than one blocking read() at a time. Only the uncompressed tile
+ * files are read through the ring, anything else (compressed tiles, tiles
+ * fetched from a url) is left for the caller to load as usual. When built
+ * without io_uring support, or when the kernel refuses to set up a ring,
+ * the ring is not valid and reads nothing. A ring is not thread safe, each
+ * loading thread needs its own.
+ */
+class TileRing {
+ public:
+  /**
+   * Constructor. Sets up the ring.
+   * @param  depth  Number of reads the ring can have in flight at once
+   */
+  explicit TileRing(uint32_t depth);
+
+  /**
+   * Destructor. Tears down the ring.
+   */
+  ~TileRing();
+
+  TileRing(const TileRing&) = delete;
+  TileRing& operator=(const TileRing&) = delete;
+
+  /**
+   * @return Returns true if the ring was set up and can be used to read
+   */
+  bool valid() const;
+
+  /**
+   * Read a batch of tiles. Reads in waves of at most the depth of the ring.
+   * @param  tile_dir  Tile directory to read the tiles from
+   * @param  ids       Base ids of the tiles to read
+   * @return Returns a tile per id, in the same order. Tiles which could not
+   *         be read through the ring have no header.
+   */
+  std::vector<GraphTile> Read(const std::string& tile_dir, const std::vector<GraphId>& ids);
+
+ protected:
+  struct ring_t;
+  std::unique_ptr<ring_t> ring_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TILE_RING_H_
@@ -0,0 +1,84 @@
+#ifndef VALHALLA_BALDR_TILE_UPDATES_H_
+#define VALHALLA_BALDR_TILE_UPDATES_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Tiles updated in place in a tile directory that is already being served.
+ * Apply installs the tiles of a delta, the tiles of a newer build that
+ * differ from the ones there, by writing each next to the old one and
+ * renaming it into place. Mappings of the old files stay valid and new
+ * reads only ever see whole tiles. It then records which tiles changed
+ * under a new version in the tile_updates file of the tile directory, again
+ * by renaming a new list into place.
+ *
+ * Readers keep the version they have seen and every so often ask for the
+ * tiles updated since, so they can evict just those from their caches
+ * instead of restarting cold.
+ */
+class TileUpdates {
+ public:
+  /**
+   * Constructor. Starts at the current version, the cache of a new reader
+   * has nothing it would need to evict.
+   * @param  tile_dir         Directory of the tiles being served.
+   * @param  refresh_seconds  How often to look for updates.
+   */
+  TileUpdates(const std::string& tile_dir, const size_t refresh_seconds);
+
+  /**
+   * Gets the tiles updated since the last time if it is time to look.
+   * @return  Returns the ids of the updated tiles.
+   */
+  std::vector<GraphId> Changed();
+
+  /**
+   * The version of the updates seen so far.
+   * @return  Returns the version, 0 if the tiles were never updated.
+   */
+  uint32_t version() const {
+    return version_;
+  }
+
+  /**
+   * Installs the tiles of a delta that differ from the ones in the tile
+   * directory and records them as updated under the next version.
+   * @param  tile_dir   Directory of the tiles being served.
+   * @param  delta_dir  Directory of the new tiles, laid out like tile_dir.
+   * @return  Returns the ids of the tiles that were installed.
+   */
+  static std::vector<GraphId> Apply(const std::string& tile_dir, const std::string& delta_dir);
+
+  /**
+   * Reads the updates recorded in a tile directory, oldest first.
+   * @param  tile_dir  Directory of the tiles being served.
+   * @return  Returns the version and id of each updated tile.
+   */
+  static std::vector<std::pair<uint32_t, GraphId> > Read(const std::string& tile_dir);
+
+ protected:
+  std::string tile_dir_;
+  std::string file_;
+  std::chrono::steady_clock::duration refresh_interval_;
+  std::chrono::steady_clock::time_point last_refresh_;
+
+  // Which file was read last, Apply renames a new one into place
+  uint64_t inode_;
+  std::time_t modified_;
+  uint32_t version_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TILE_UPDATES_H_
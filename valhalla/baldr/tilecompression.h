@@ -0,0 +1,62 @@
+#ifndef VALHALLA_BALDR_TILECOMPRESSION_H_
+#define VALHALLA_BALDR_TILECOMPRESSION_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// File extension appended to the tile file name of an lz4 compressed tile
+constexpr const char* kLZ4TileExtension = ".lz4";
+
+// Magic bytes at the beginning of every lz4 compressed tile
+constexpr char kLZ4TileMagic[4] = {'V', 'L', 'Z', '4'};
+
+/**
+ * Fixed size header prepended to an lz4 compressed tile. Because the size
+ * of the uncompressed tile is known up front the tile can be decompressed
+ * with a single allocation and a single block decode.
+ */
+struct CompressedTileHeader {
+  char magic[4];              // Always kLZ4TileMagic
+  uint32_t version;           // Version of the compressed tile container
+  uint64_t uncompressed_size; // Size of the tile once decompressed
+  uint64_t compressed_size;   // Size of the compressed block after the header
+};
+
+/**
+ * Compress a tile into the lz4 tile container.
+ * @param  data  Pointer to the uncompressed tile
+ * @param  size  Size of the uncompressed tile in bytes
+ * @param  high_compression  Use lz4hc, slower to compress but smaller
+ *                           on disk. Decompression speed is the same.
+ * @return Returns the header followed by the compressed block
+ */
+std::vector<char> lz4_compress_tile(const char* data, size_t size,
+                                    bool high_compression = true);
+
+/**
+ * Decompress a tile from the lz4 tile container.
+ * @param  data  Pointer to the header followed by the compressed block
+ * @param  size  Size of the compressed container in bytes
+ * @param  tile  Filled with the decompressed tile
+ * @return Returns false if the container is truncated or corrupt
+ */
+bool lz4_decompress_tile(const char* data, size_t size, std::vector<char>& tile);
+
+/**
+ * Compress a tile file on disk into the lz4 tile container. The compressed
+ * tile is written next to the original with kLZ4TileExtension appended.
+ * @param  file_name  Tile file to compress
+ * @param  remove_original  Remove the uncompressed tile once written
+ * @return Returns the size of the compressed tile or 0 on failure
+ */
+size_t lz4_compress_tile_file(const std::string& file_name, bool remove_original = true);
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TILECOMPRESSION_H_
@@ -0,0 +1,109 @@
+#ifndef VALHALLA_BALDR_TILEPREFETCHER_H_
+#define VALHALLA_BALDR_TILEPREFETCHER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphtile.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Loads tiles from disk (or a tile url) on a small pool of background
+ * threads so that they are already in memory by the time an algorithm
+ * reaches them. Loaded tiles are staged here rather than put in a tile
+ * cache so that the cache itself never has to be touched by more than the
+ * thread owning it. The owner collects them with Take. With a ring depth
+ * each thread takes a batch of queued tiles at a time and reads them with a
+ * single io_uring submission, falling back to loading them one at a time
+ * where io_uring is unavailable or the tile isn't a plain file.
+ */
+class TilePrefetcher {
+ public:
+  /**
+   * Constructor.
+   * @param  tile_dir      Tile directory to load tiles from
+   * @param  tile_url      Url to fetch tiles from if not in tile_dir, may be empty
+   * @param  mmap_tile     Whether to memory map tiles instead of reading them
+   * @param  thread_count  Number of background loading threads
+   * @param  max_staged    Maximum number of loaded tiles kept waiting to be
+   *                       taken, requests past this are dropped
+   * @param  spill_tiles   Write tiles fetched from the tile_url to tile_dir
+   * @param  ring_depth    Most tiles a thread reads at once through io_uring,
+   *                       0 reads them one at a time
+   */
+  TilePrefetcher(const std::string& tile_dir, const std::string& tile_url,
+                 bool mmap_tile, size_t thread_count, size_t max_staged,
+                 bool spill_tiles = false, uint32_t ring_depth = 0);
+
+  /**
+   * Destructor. Stops and joins the loading threads.
+   */
+  ~TilePrefetcher();
+
+  TilePrefetcher(const TilePrefetcher&) = delete;
+  TilePrefetcher& operator=(const TilePrefetcher&) = delete;
+
+  /**
+   * Queue tiles to be loaded in the background. Tiles already queued, being
+   * loaded or staged are skipped.
+   * @param  ids  Base ids of the tiles to load, loaded in the order given
+   */
+  void Prefetch(const std::vector<GraphId>& ids);
+
+  /**
+   * Take a prefetched tile. If the tile is currently being loaded this waits
+   * for it, if it is only queued it is dropped from the queue, since the
+   * caller is about to load it anyway.
+   * @param  id    Base id of the tile
+   * @param  tile  Set to the loaded tile
+   * @return Returns true if the tile was loaded by the prefetcher
+   */
+  bool Take(const GraphId& id, GraphTile& tile);
+
+  /**
+   * Drops all queued and staged tiles. Tiles being loaded are dropped once
+   * their load completes.
+   */
+  void Clear();
+
+  /**
+   * @return Returns the number of loaded tiles waiting to be taken
+   */
+  size_t Staged() const;
+
+ protected:
+  void Work();
+
+  std::string tile_dir_;
+  std::string tile_url_;
+  bool mmap_tile_;
+  size_t max_staged_;
+  bool spill_tiles_;
+  uint32_t ring_depth_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable loaded_cv_;
+  bool stop_;
+  std::deque<GraphId> queue_;
+  std::unordered_set<GraphId> queued_;
+  std::unordered_set<GraphId> loading_;
+  std::unordered_set<GraphId> dropped_;
+  std::unordered_map<GraphId, GraphTile> staged_;
+  std::vector<std::thread> threads_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TILEPREFETCHER_H_
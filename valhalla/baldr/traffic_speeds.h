@@ -0,0 +1,114 @@
+#ifndef VALHALLA_BALDR_TRAFFIC_SPEEDS_H_
+#define VALHALLA_BALDR_TRAFFIC_SPEEDS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <valhalla/midgard/sequence.h>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * The live speeds of the directed edges of a tile, indexed by the id of the
+ * directed edge within the tile. A speed of 0 means there is no live speed.
+ */
+struct TileSpeeds {
+  const uint8_t* speeds;
+  uint32_t count;
+
+  uint8_t operator[](const uint32_t index) const {
+    return index < count ? speeds[index] : 0;
+  }
+  explicit operator bool() const {
+    return count > 0;
+  }
+};
+
+/**
+ * Live traffic speed overlay. Each tile with traffic has a file in the
+ * traffic directory named <tileid>.spd holding one byte per directed edge
+ * with its current speed in kph. The files are memory mapped read only so
+ * the speeds are shared through the page cache by every process using them.
+ *
+ * Readers never lock. The mapped tiles are held in an immutable snapshot
+ * which Refresh swaps atomically for a new one when files have changed, the
+ * snapshot before it is kept until the next swap so a reader only ever sees
+ * complete tiles. Readers should look up the speeds of a tile when they need
+ * them rather than hold onto them across refreshes. Whatever writes the
+ * files should write them elsewhere and rename them into place, so a mapping
+ * of an older file stays valid while newer ones replace it.
+ */
+class TrafficSpeeds {
+ public:
+  /**
+   * Constructor, maps whatever speed files are in the directory.
+   * @param  traffic_dir       directory holding the speed files
+   * @param  refresh_seconds   how often Refresh looks for changed files
+   */
+  TrafficSpeeds(const std::string& traffic_dir, const size_t refresh_seconds);
+  ~TrafficSpeeds();
+
+  /**
+   * The speeds of the directed edges of a tile.
+   * @param  tileid  the tile id (within its level) of the tile
+   * @return the speeds, empty if the tile has no traffic
+   */
+  TileSpeeds speeds(const uint32_t tileid) const {
+    const auto* snapshot = current_.load(std::memory_order_acquire);
+    auto tile = snapshot->find(tileid);
+    if (tile == snapshot->cend())
+      return {nullptr, 0};
+    return {tile->second->map.get(), static_cast<uint32_t>(tile->second->map.size())};
+  }
+
+  /**
+   * Maps the speed files that changed since the last time it looked, if it is
+   * time to look again and no other thread is already doing so.
+   * @return true if a new snapshot of the speeds was published
+   */
+  bool Refresh();
+
+  /**
+   * Gets the overlay of a directory. There is one per directory per process
+   * so every worker shares the same mappings.
+   * @param  traffic_dir       directory holding the speed files
+   * @param  refresh_seconds   how often Refresh looks for changed files
+   */
+  static std::shared_ptr<TrafficSpeeds> get_instance(const std::string& traffic_dir,
+                                                     const size_t refresh_seconds);
+
+ protected:
+  // A mapped speed file and which file it was, renaming a new one into place
+  // changes the inode even when it lands within the same second
+  struct tile_t {
+    midgard::mem_map<uint8_t> map;
+    uint64_t inode;
+    std::time_t modified;
+  };
+  using snapshot_t = std::unordered_map<uint32_t, std::shared_ptr<const tile_t> >;
+
+  // Builds a snapshot of the directory reusing what didnt change
+  snapshot_t* Scan(const snapshot_t& last) const;
+
+  std::string traffic_dir_;
+  std::chrono::steady_clock::duration refresh_interval_;
+  std::chrono::steady_clock::time_point last_refresh_;
+
+  // What readers see and the one they may still be looking at from before
+  std::atomic<const snapshot_t*> current_;
+  std::unique_ptr<const snapshot_t> owned_current_;
+  std::unique_ptr<const snapshot_t> previous_;
+  std::mutex refresh_lock_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TRAFFIC_SPEEDS_H_
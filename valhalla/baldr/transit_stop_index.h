@@ -0,0 +1,95 @@
+#ifndef VALHALLA_BALDR_TRANSIT_STOP_INDEX_H_
+#define VALHALLA_BALDR_TRANSIT_STOP_INDEX_H_
+
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/midgard/sequence.h>
+#include <valhalla/midgard/tiles.h>
+
+#include <boost/property_tree/ptree.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+  namespace baldr {
+
+    // Size (degrees) of the cells of the grid the transit stops are binned in
+    constexpr float kTransitStopCellSize = 0.05f;
+
+    /**
+     * The positions of the transit stops (platforms) of the transit level, binned in a world
+     * wide grid so that checking for stops near a location only looks at the stops of the few
+     * cells around it. Only the cells with stops are kept, sorted by cell id, and the stops of
+     * a cell are stored next to each other with their longitudes and latitudes in separate
+     * arrays. If mjolnir.transit_stop_index names a file written by valhalla_build_connectivity
+     * the index is memory mapped from it, so checking for transit needs no tiles at all. The
+     * file has to be rebuilt along with the transit tiles.
+     */
+    class transit_stop_index_t {
+     public:
+      /**
+       * Constructs the index of a set of stops
+       * @param stops  the positions of the stops
+       */
+      explicit transit_stop_index_t(const std::vector<midgard::PointLL>& stops);
+
+      /**
+       * Constructs the index by memory mapping a file written by save
+       * @param file_name  the file to map, throws if it cant be mapped or isnt an index
+       */
+      explicit transit_stop_index_t(const std::string& file_name);
+
+      transit_stop_index_t(transit_stop_index_t&&) = default;
+      transit_stop_index_t& operator=(transit_stop_index_t&&) = default;
+
+      /**
+       * Constructs the index of the stops of every tile of the transit level
+       * @param pt  the ptree sub child labeled mjolnir in the valhalla json config
+       * @return the index
+       */
+      static transit_stop_index_t build(const boost::property_tree::ptree& pt);
+
+      /**
+       * Returns whether there is a stop within a radius of a location
+       * @param ll      the location
+       * @param radius  the radius in meters
+       * @return true if a stop is at most radius meters away
+       */
+      bool has_stop(const midgard::PointLL& ll, const float radius) const;
+
+      /**
+       * @return the number of stops in the index
+       */
+      size_t size() const;
+
+      /**
+       * Writes the index to a file which can be memory mapped by the constructor
+       * @param file_name  the file to write
+       */
+      void save(const std::string& file_name) const;
+
+     private:
+      //the stops of a cell run from first to the first of the next cell
+      struct cell_t {
+        uint32_t id;
+        uint32_t first;
+      };
+
+      midgard::Tiles<midgard::PointLL> grid;
+      //cells with stops sorted by id, plus one past the last for the end of its stops
+      const cell_t* cells;
+      uint32_t cell_count;
+      const float* lngs;
+      const float* lats;
+      uint32_t stop_count;
+      //where the index lives, either built from the stops or mapped from a file
+      std::vector<cell_t> owned_cells;
+      std::vector<float> owned_lngs;
+      std::vector<float> owned_lats;
+      std::unique_ptr<midgard::mem_map<char> > mapped;
+    };
+  }
+}
+
+#endif //VALHALLA_BALDR_TRANSIT_STOP_INDEX_H_
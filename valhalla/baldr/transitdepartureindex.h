@@ -0,0 +1,201 @@
+#ifndef VALHALLA_BALDR_TRANSITDEPARTUREINDEX_H_
+#define VALHALLA_BALDR_TRANSITDEPARTUREINDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <valhalla/baldr/transitdeparture.h>
+
+namespace valhalla {
+namespace baldr {
+
+constexpr uint32_t kNoDeparture = 0xffffffff;
+
+/**
+ * Index over the departures of a tile, which are sorted by line Id, type
+ * and then departure time. The departures of each line are grouped into
+ * runs that share a schedule and departure type so finding the next
+ * departure checks the validity of each schedule once and binary searches
+ * the runs whose schedule is valid, rather than walking every departure of
+ * the line until one runs on the requested day.
+ */
+class TransitDepartureIndex {
+ public:
+  /**
+   * Constructor with arguments.
+   * @param  departures  Departures of a tile sorted by line Id, type and
+   *                     then departure time.
+   * @param  count       Number of departures.
+   */
+  TransitDepartureIndex(const TransitDeparture* departures, const uint32_t count);
+
+  /**
+   * Get the next departure along a line. This is the first departure of the
+   * line, in the order of the departures, at or after the current time that
+   * runs on a valid schedule and has the requested access.
+   * @param  lineid          Transit line Id.
+   * @param  current_time    Current time (seconds from midnight).
+   * @param  schedule_valid  Returns whether the schedule with a given schedule
+   *                         index runs on the requested day.
+   * @param  wheelchair      Only find departures with wheelchair access if true
+   * @param  bicycle         Only find departures with bicycle access if true
+   * @param  departure_time  Set to the time of the departure, for frequency
+   *                         based departures it is the next one from the
+   *                         current time.
+   * @return Returns the index of the departure, kNoDeparture if there is none.
+   */
+  template <class schedule_valid_t>
+  uint32_t Next(const uint32_t lineid, const uint32_t current_time,
+                const schedule_valid_t& schedule_valid, const bool wheelchair,
+                const bool bicycle, uint32_t& departure_time) const {
+    uint32_t best = kNoDeparture;
+    auto run = runs_.cbegin() + FirstRun(lineid);
+    for (; run != runs_.cend() && run->lineid == lineid; ++run) {
+      // Runs start with their earliest departure so this one cant do better
+      if (order_[run->begin] >= best || !schedule_valid(run->schedule_index))
+        continue;
+
+      uint32_t i = run->type == kFixedSchedule ?
+          LowerBound(*run, current_time) : run->begin;
+      for (; i < run->end && order_[i] < best; ++i) {
+        const auto& d = departures_[order_[i]];
+        if ((wheelchair && !d.wheelchair_accessible()) ||
+            (bicycle && !d.bicycle_accessible()))
+          continue;
+
+        // Fixed departures are the first one left after the current time
+        if (run->type == kFixedSchedule) {
+          best = order_[i];
+          departure_time = d.departure_time();
+          break;
+        }
+
+        // Frequency based ones have to have one left before they end
+        uint32_t time = d.departure_time();
+        if (time < current_time) {
+          uint32_t frequency = d.frequency();
+          if (frequency == 0)
+            continue;
+          time += ((current_time - time + frequency - 1) / frequency) * frequency;
+        }
+        if (time >= current_time && time < d.end_time()) {
+          best = order_[i];
+          departure_time = time;
+          break;
+        }
+      }
+    }
+    return best;
+  }
+
+  /**
+   * Get the previous departure along a line, for searches going back in
+   * time from the end of the line. This is the latest departure of the line
+   * that arrives at the end of the line at or before the current time, runs
+   * on a valid schedule and has the requested access. Of departures leaving
+   * at the same time the first one, in the order of the departures, is found.
+   * @param  lineid          Transit line Id.
+   * @param  current_time    Current time (seconds from midnight) at the end
+   *                         of the line.
+   * @param  schedule_valid  Returns whether the schedule with a given schedule
+   *                         index runs on the requested day.
+   * @param  wheelchair      Only find departures with wheelchair access if true
+   * @param  bicycle         Only find departures with bicycle access if true
+   * @param  departure_time  Set to the time of the departure, for frequency
+   *                         based departures it is the last one arriving by
+   *                         the current time.
+   * @return Returns the index of the departure, kNoDeparture if there is none.
+   */
+  template <class schedule_valid_t>
+  uint32_t Previous(const uint32_t lineid, const uint32_t current_time,
+                    const schedule_valid_t& schedule_valid, const bool wheelchair,
+                    const bool bicycle, uint32_t& departure_time) const {
+    uint32_t best = kNoDeparture;
+    uint32_t best_time = 0;
+    auto is_better = [&best, &best_time](const uint32_t index, const uint32_t time) {
+      return best == kNoDeparture || time > best_time ||
+             (time == best_time && index < best);
+    };
+    auto run = runs_.cbegin() + FirstRun(lineid);
+    for (; run != runs_.cend() && run->lineid == lineid; ++run) {
+      if (!schedule_valid(run->schedule_index))
+        continue;
+
+      // Fixed departures are walked back from the last one leaving by the
+      // current time, the first one arriving by then is the latest of the run
+      if (run->type == kFixedSchedule) {
+        for (uint32_t i = UpperBound(*run, current_time); i > run->begin; --i) {
+          const auto& d = departures_[order_[i - 1]];
+          if (!is_better(order_[i - 1], d.departure_time()))
+            break;
+          if ((wheelchair && !d.wheelchair_accessible()) ||
+              (bicycle && !d.bicycle_accessible()) ||
+              d.departure_time() + d.elapsed_time() > current_time)
+            continue;
+          best = order_[i - 1];
+          best_time = departure_time = d.departure_time();
+          break;
+        }
+        continue;
+      }
+
+      // Frequency based ones take the last departure before they end
+      for (uint32_t i = run->begin; i < run->end; ++i) {
+        const auto& d = departures_[order_[i]];
+        if ((wheelchair && !d.wheelchair_accessible()) ||
+            (bicycle && !d.bicycle_accessible()) ||
+            d.departure_time() + d.elapsed_time() > current_time ||
+            d.departure_time() >= d.end_time())
+          continue;
+        uint32_t latest = std::min(current_time - d.elapsed_time(), d.end_time() - 1);
+        uint32_t time = d.departure_time();
+        if (d.frequency() > 0)
+          time += ((latest - time) / d.frequency()) * d.frequency();
+        if (is_better(order_[i], time)) {
+          best = order_[i];
+          best_time = departure_time = time;
+        }
+      }
+    }
+    return best;
+  }
+
+  /**
+   * Get the number of runs of departures sharing a line, schedule and type.
+   * @return Returns the number of runs.
+   */
+  size_t run_count() const {
+    return runs_.size();
+  }
+
+ protected:
+  // Departures of one line sharing a schedule and type. Begin and end are
+  // positions in order_, which holds their indexes in the departures.
+  struct Run {
+    uint32_t lineid;
+    uint32_t schedule_index;
+    uint32_t type;
+    uint32_t begin;
+    uint32_t end;
+  };
+
+  // Position of the first run of a line
+  size_t FirstRun(const uint32_t lineid) const;
+
+  // Position in order_ of the first departure of a fixed run at or after
+  // the current time
+  uint32_t LowerBound(const Run& run, const uint32_t current_time) const;
+
+  // Position in order_ after the last departure of a fixed run at or before
+  // the current time
+  uint32_t UpperBound(const Run& run, const uint32_t current_time) const;
+
+  const TransitDeparture* departures_;
+  std::vector<Run> runs_;
+  std::vector<uint32_t> order_;
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TRANSITDEPARTUREINDEX_H_
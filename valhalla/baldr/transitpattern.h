@@ -0,0 +1,100 @@
+#ifndef VALHALLA_BALDR_TRANSITPATTERN_H_
+#define VALHALLA_BALDR_TRANSITPATTERN_H_
+
+#include <cstdint>
+#include <vector>
+#include <valhalla/baldr/transitdeparture.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Fewest trips of a pattern, fewer are cheaper stored as departures
+constexpr uint32_t kMinPatternTrips = 3;
+
+/**
+ * Trip of a schedule pattern, the only parts of the departure that differ
+ * from the other trips of the pattern.
+ */
+struct PatternTrip {
+  uint32_t tripid;          // TripId (internal)
+  uint32_t departure_time;  // Departure time (seconds from midnight)
+};
+
+/**
+ * Fixed departures of a line that share their route, block, headsign,
+ * elapsed time, schedule and access stored once for all of their trips.
+ * Timetables that repeat the same trip over the day store a pattern with
+ * the trip Id and departure time of each trip rather than a departure per
+ * trip. Patterns are expanded back into departures when a tile is loaded.
+ */
+class TransitPattern {
+ public:
+  /**
+   * Constructor with arguments.
+   * @param  departure   Departure the other trips of the pattern share all
+   *                     but their trip Id and departure time with.
+   * @param  first_trip  Index of the first trip of the pattern.
+   * @param  trip_count  Number of trips of the pattern.
+   */
+  TransitPattern(const TransitDeparture& departure, const uint32_t first_trip,
+                 const uint32_t trip_count);
+
+  /**
+   * Get the index of the first trip of the pattern within the tile.
+   * @return  Returns the index of the first trip.
+   */
+  uint32_t first_trip() const;
+
+  /**
+   * Get the number of trips of the pattern.
+   * @return  Returns the number of trips.
+   */
+  uint32_t trip_count() const;
+
+  /**
+   * Get the departure of a trip of the pattern.
+   * @param  trip  Trip of the pattern.
+   * @return  Returns the departure of the trip.
+   */
+  TransitDeparture departure(const PatternTrip& trip) const;
+
+  /**
+   * Split departures into the ones stored as they are and the patterns
+   * (with their trips) storing the rest.
+   * @param  departures  Departures sorted by line Id, type and then departure
+   *                     time.
+   * @param  others      Returns the departures not part of a pattern, sorted.
+   * @param  patterns    Returns the patterns.
+   * @param  trips       Returns the trips of the patterns.
+   */
+  static void Encode(const std::vector<TransitDeparture>& departures,
+                     std::vector<TransitDeparture>& others,
+                     std::vector<TransitPattern>& patterns,
+                     std::vector<PatternTrip>& trips);
+
+  /**
+   * Expand patterns back into departures.
+   * @param  departures     Departures not part of a pattern.
+   * @param  count          Number of departures.
+   * @param  patterns       Patterns.
+   * @param  pattern_count  Number of patterns.
+   * @param  trips          Trips of the patterns.
+   * @return Returns all of the departures sorted by line Id, type and then
+   *         departure time.
+   */
+  static std::vector<TransitDeparture> Decode(const TransitDeparture* departures,
+                                              const uint32_t count,
+                                              const TransitPattern* patterns,
+                                              const uint32_t pattern_count,
+                                              const PatternTrip* trips);
+
+ protected:
+  TransitDeparture departure_;  // Departure of the first trip of the pattern
+  uint32_t first_trip_;         // Index of the first trip
+  uint32_t trip_count_;         // Number of trips
+};
+
+}
+}
+
+#endif  // VALHALLA_BALDR_TRANSITPATTERN_H_
@@ -23,6 +23,10 @@ class Turn {
     kSlightLeft = 7
   };
 
+  // Number of turn classes (see DirectedEdge::turn_class): every turn type
+  // on its own or at a crossing, when driving on the right or the left
+  static constexpr uint32_t kClassCount = 32;
+
   Turn() = delete;
 
   /**
@@ -37,6 +37,8 @@ namespace valhalla {
     {140,"Action does not support multimodal costing"},
     {141,"Arrive by for multimodal not implemented yet"},
     {142,"Arrive by not implemented for isochrones"},
+    {143,"Action does not support the pbf format"},
+    {144,"Action does not support the png format"},
 
     {150,"Exceeded max locations"},
     {151,"Exceeded max time"},
@@ -47,14 +49,18 @@ namespace valhalla {
     {156,"Outside the valid walking distance between stops of a multimodal route"},
     {157,"Exceeded max avoid locations"},
     {158,"Input trace option is out of bounds"},
+    {159,"Exceeded the request timeout"},
 
     {160,"Date and time required for origin for date_type of depart at"},
     {161,"Date and time required for destination for date_type of arrive by"},
     {162,"Date and time is invalid.  Format is YYYY-MM-DDTHH:MM"},
     {163,"Invalid date_type"},
+    {164,"Exceeded max time slices"},
 
     {170,"Locations are in unconnected regions. Go check/edit the map at osm.org"},
     {171,"No suitable edges near location"},
+    {173,"Locations are in more than one shard and no shard holds them all"},
+    {174,"Failed to get a response from the shard holding the locations"},
 
     {199,"Unknown"},
 
@@ -85,6 +91,7 @@ namespace valhalla {
     {312,"Insufficiently specified required parameter 'shape' or 'encoded_polyline'"},
     {313,"'resample_distance' must be >= "},
     {314,"Too many shape points"},
+    {315,"Too many shapes"},
 
     {399,"Unknown"},
 
@@ -107,6 +114,9 @@ namespace valhalla {
     {444,"Map Match algorithm failed to find path"},
     {445,"Shape match algorithm specification in api request is incorrect. Please see documentation for valid shape_match input."},
 
+    {450,"Too many requests of this kind in progress, try again later"},
+    {451,"Request needed more memory than it is allowed"},
+
     {499,"Unknown"},
 
     // tyr project 5xx
@@ -38,11 +38,32 @@ const sif::NodeFilter PassThroughNodeFilter = [](const baldr::NodeInfo* node){ r
  * @param reader         and object used to access tiled route data TODO: switch this out for a proper cache
  * @param edge_filter    a function/functor to be used in the rejection of edges. defaults to a pass through filter
  * @param node_filter    a function/functor to be used in the rejection of nodes used in graph traversal. defaults to a pass through filter
+ * @param access_mode    access mode of the costing the filters came from, which its edge filter requires. lets the reach
+ *                       stored on the edges stand in for the reachability search and rules out edges by their access
+ *                       before calling the edge filter. defaults to 0 which always searches and filters every edge
  * @return pathLocations the correlated data with in the tile that matches the inputs. If a projection is not found, it will not have any entry in the returned value.
  */
 std::unordered_map<baldr::Location, baldr::PathLocation>
 Search(const std::vector<baldr::Location>& locations, baldr::GraphReader& reader,
-  const sif::EdgeFilter& edge_filter = PassThroughEdgeFilter, const sif::NodeFilter& node_filter = PassThroughNodeFilter);
+  const sif::EdgeFilter& edge_filter = PassThroughEdgeFilter, const sif::NodeFilter& node_filter = PassThroughNodeFilter,
+  const uint32_t access_mode = 0);
+
+/**
+ * Find locations within the route network like the above but on several threads, each with a reader of its own.
+ * The locations are split up by the bin of the local tiles they are in so those close to each other are searched
+ * together and share it. Too few locations to be worth the threads are all searched with the first reader.
+ *
+ * @param locations      the positions which need to be correlated to the route network
+ * @param readers        one reader per thread to search with, the first is used on the calling thread
+ * @param edge_filter    a function/functor to be used in the rejection of edges. defaults to a pass through filter
+ * @param node_filter    a function/functor to be used in the rejection of nodes used in graph traversal. defaults to a pass through filter
+ * @param access_mode    access mode of the costing the filters came from, see above
+ * @return pathLocations the correlated data with in the tile that matches the inputs. If a projection is not found, it will not have any entry in the returned value.
+ */
+std::unordered_map<baldr::Location, baldr::PathLocation>
+Search(const std::vector<baldr::Location>& locations, const std::vector<baldr::GraphReader*>& readers,
+  const sif::EdgeFilter& edge_filter = PassThroughEdgeFilter, const sif::NodeFilter& node_filter = PassThroughNodeFilter,
+  const uint32_t access_mode = 0);
 
 }
 }
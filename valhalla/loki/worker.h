@@ -2,6 +2,8 @@
 #define __VALHALLA_LOKI_SERVICE_H__
 
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/property_tree/ptree.hpp>
@@ -12,6 +14,8 @@
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/connectivity_map.h>
+#include <valhalla/baldr/shard_map.h>
+#include <valhalla/baldr/transit_stop_index.h>
 #include <valhalla/sif/costfactory.h>
 #include <valhalla/baldr/rapidjson_utils.h>
 #include <valhalla/skadi/sample.h>
@@ -19,6 +23,9 @@
 #include <valhalla/proto/directions_options.pb.h>
 
 namespace valhalla {
+  namespace baldr {
+    struct curler_t;
+  }
   namespace loki {
 
 #ifdef HAVE_HTTP
@@ -41,6 +48,9 @@ namespace valhalla {
       void trace(valhalla_request_t& request);
       std::string height(valhalla_request_t& request);
       std::string transit_available(valhalla_request_t& request);
+      uint32_t tile_version() const {
+        return reader.tile_version();
+      }
 
      protected:
 
@@ -56,25 +66,41 @@ namespace valhalla {
       void init_isochrones(valhalla_request_t& request);
       void init_trace(valhalla_request_t& request);
       std::vector<PointLL> init_height(valhalla_request_t& request);
+      bool resample_height(std::vector<PointLL>& shape, const valhalla_request_t& request) const;
+      std::string height_batch(valhalla_request_t& request);
       void init_transit_available(valhalla_request_t& request);
+      std::unordered_map<baldr::Location, baldr::PathLocation> search(const std::vector<baldr::Location>& locations);
+#ifdef HAVE_HTTP
+      boost::optional<worker_t::result_t> dispatch(const valhalla_request_t& request, const std::string& path,
+        http_request_info_t& info);
+#endif
 
       boost::property_tree::ptree config;
       sif::CostFactory<sif::DynamicCost> factory;
       sif::EdgeFilter edge_filter;
       sif::NodeFilter node_filter;
+      uint32_t access_mode;
       valhalla::baldr::GraphReader reader;
+      // Graph readers of the extra threads the locations of a request are searched with
+      std::vector<std::unique_ptr<valhalla::baldr::GraphReader> > search_readers;
       std::shared_ptr<valhalla::baldr::connectivity_map_t> connectivity_map;
+      // Transit stops mapped from mjolnir.transit_stop_index, null without one
+      std::shared_ptr<const valhalla::baldr::transit_stop_index_t> transit_stops;
+      // Regions of the clusters the graph is sharded over, null unless loki.shards is configured,
+      // and the connection requests for the other regions are handed on over
+      std::shared_ptr<const valhalla::baldr::ShardMap> shards;
+      std::shared_ptr<valhalla::baldr::curler_t> shard_curler;
       std::string action_str;
-      std::unordered_map<std::string, size_t> max_locations;
-      std::unordered_map<std::string, float> max_distance;
-      std::unordered_map<std::string, float> max_matrix_distance;
-      std::unordered_map<std::string, float> max_matrix_locations;
+      service_limits_t service_limits;
       size_t max_avoid_locations;
+      size_t max_time_slices;
       unsigned int max_reachability;
       unsigned int default_reachability;
       unsigned long max_radius;
       unsigned long default_radius;
       float long_request;
+      // Fraction of the requests without a trace context to trace
+      float trace_sample_rate;
       // Minimum and maximum walking distances (to validate input).
       size_t min_transit_walking_dis;
       size_t max_transit_walking_dis;
@@ -85,8 +111,9 @@ namespace valhalla {
       float max_search_radius;
       unsigned int max_best_paths;
       size_t max_best_paths_shape;
-      skadi::sample sample;
+      std::shared_ptr<const skadi::sample> sample;
       size_t max_elevation_shape;
+      size_t max_elevation_shapes;
       float min_resample;
     };
   }
@@ -0,0 +1,112 @@
+#ifndef MMP_BATCH_MATCHER_H_
+#define MMP_BATCH_MATCHER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/meili/map_matcher_factory.h>
+#include <valhalla/meili/match_result.h>
+#include <valhalla/meili/measurement.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Matches batches of traces on a pool of threads. Neither the graph reader
+ * nor the candidate grid is thread safe so each thread has a matcher factory
+ * of its own, their graph readers sharing the tiles through the global
+ * sharded tile cache. Each thread creates its map matcher once per batch and
+ * reuses it for every trace it takes, so unlike a request per trace the
+ * config is merged and the grid cache is warmed only once per thread.
+ */
+class BatchMatcher {
+ public:
+
+  /**
+   * What became of a trace, handed back as soon as it is matched.
+   */
+  struct TraceResult {
+    size_t index;                       // Index of the trace in the batch
+    std::vector<MatchResults> results;  // Best paths, empty if it failed
+    std::string error;                  // Why it failed, empty if it didn't
+  };
+
+  using callback_t = std::function<void (TraceResult&&)>;
+
+  /**
+   * A job run for each trace with the map matcher of the thread it runs on,
+   * which is null if it couldn't be created, along with why it couldn't.
+   */
+  using job_t = std::function<void (size_t index, const std::shared_ptr<MapMatcher>& matcher,
+                                    const std::string& error)>;
+
+  /**
+   * Constructor.
+   * @param  config        Boost property tree - config information. Unless
+   *                       it says otherwise the graph readers use the
+   *                       global sharded tile cache.
+   * @param  thread_count  Number of threads to match on, 0 for one per core.
+   */
+  BatchMatcher(const boost::property_tree::ptree& config,
+               const uint32_t thread_count = 0);
+
+  ~BatchMatcher();
+
+  /**
+   * Matches the traces, handing each result to the callback as soon as the
+   * trace is matched, so in no particular order. The callback is called from
+   * the threads but never concurrently. A trace that can't be matched gets a
+   * result with the error, the other traces are still matched. If the
+   * callback throws no more traces are matched and it is rethrown here.
+   * @param  preferences  Mode and match options of all the traces, the same
+   *                      as for MapMatcherFactory::Create.
+   * @param  traces       Measurements of each trace.
+   * @param  callback     Called with the result of each trace.
+   * @param  k            Number of best paths to find for each trace.
+   */
+  void Match(const boost::property_tree::ptree& preferences,
+             const std::vector<std::vector<Measurement> >& traces,
+             const callback_t& callback, const uint32_t k = 1);
+
+  /**
+   * Matches the traces.
+   * @param  preferences  Mode and match options of all the traces.
+   * @param  traces       Measurements of each trace.
+   * @param  k            Number of best paths to find for each trace.
+   * @return Returns the result of each trace in the order of the traces.
+   */
+  std::vector<TraceResult> Match(const boost::property_tree::ptree& preferences,
+                                 const std::vector<std::vector<Measurement> >& traces,
+                                 const uint32_t k = 1);
+
+  /**
+   * Runs a job for each of a number of traces on the threads, so that
+   * more than the match can be done with the matcher of each thread. The
+   * jobs are run concurrently. If a job throws no more jobs are started
+   * and it is rethrown here once the running ones are done.
+   * @param  preferences  Mode and match options of the matchers.
+   * @param  count        Number of traces.
+   * @param  job          Called once for each trace index.
+   */
+  void Run(const boost::property_tree::ptree& preferences, const size_t count, const job_t& job);
+
+  /**
+   * Number of threads the traces are matched on.
+   */
+  size_t thread_count() const {
+    return factories_.size();
+  }
+
+ protected:
+  // One per thread, the calling thread uses the first
+  std::vector<std::unique_ptr<MapMatcherFactory> > factories_;
+};
+
+}
+}
+
+#endif // MMP_BATCH_MATCHER_H_
@@ -18,10 +18,9 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/directededge.h>
 #include <valhalla/baldr/edgeinfo.h>
+#include <valhalla/baldr/segmentindex.h>
 #include <valhalla/sif/dynamiccost.h>
 
-#include <valhalla/meili/grid_range_query.h>
-
 namespace valhalla{
 
 namespace meili {
@@ -48,6 +47,16 @@ class CandidateQuery
                         edgeid_iterator_t edgeid_end,
                         sif::EdgeFilter filter) const;
 
+  // Same as above but the location is projected onto the shape of each
+  // edge by the projector, which also tells the edge id of each item
+  template <typename item_iterator_t, typename projector_t> std::vector<baldr::PathLocation>
+  WithinSquaredDistance(const midgard::PointLL& location,
+                        float sq_search_radius,
+                        item_iterator_t item_begin,
+                        item_iterator_t item_end,
+                        sif::EdgeFilter filter,
+                        projector_t& projector) const;
+
   baldr::GraphReader& reader_;
 };
 
@@ -55,7 +64,12 @@ class CandidateQuery
 class CandidateGridQuery final: public CandidateQuery
 {
  public:
-  using grid_t = GridRangeQuery<baldr::GraphId, midgard::PointLL>;
+  // An edge found in a bin
+  struct edge_ref_t {
+    baldr::GraphId edgeid;
+    const baldr::SegmentIndex::Bin* bin;
+    uint32_t index;
+  };
 
   CandidateGridQuery(baldr::GraphReader& reader, float cell_width, float cell_height);
 
@@ -64,31 +78,38 @@ class CandidateGridQuery final: public CandidateQuery
   std::vector<baldr::PathLocation>
   Query(const midgard::PointLL& location, float sq_search_radius, sif::EdgeFilter filter) const override;
 
-  std::unordered_map<baldr::GraphId, grid_t>::size_type
+  std::unordered_map<int32_t, const baldr::SegmentIndex::Bin*>::size_type
   size() const
   { return grid_cache_.size(); }
 
   void Clear()
-  { grid_cache_.clear(); }
+  {
+    grid_cache_.clear();
+    indexes_.clear();
+  }
 
  private:
 
   // Get a grid for a specified bin within a tile. Tile support for
   // graph tiles and bins is provided to go between bin Ids and tile Ids.
-  const grid_t* GetGrid(const int32_t bin_id,
-                        const midgard::Tiles<midgard::PointLL>& tiles,
-                        const midgard::Tiles<midgard::PointLL>& bins) const;
+  const baldr::SegmentIndex::Bin*
+  GetGrid(const int32_t bin_id,
+          const midgard::Tiles<midgard::PointLL>& tiles,
+          const midgard::Tiles<midgard::PointLL>& bins) const;
 
-  std::unordered_set<baldr::GraphId>
+  // Get the edges within the range, sorted by edge id
+  std::vector<edge_ref_t>
   RangeQuery(const midgard::AABB2<midgard::PointLL>& range) const;
 
   uint32_t bin_level_;
 
-  float cell_width_;
-  float cell_height_;
+  // Cells along each side of a bin in the segment indexes
+  uint32_t divisions_;
 
-  // Grid cache - cached per "bin" within a graph tile
-  mutable std::unordered_map<int32_t, grid_t> grid_cache_;
+  // Grid cache - the bins of the shared segment indexes of the tiles,
+  // which are kept alive while they are cached here
+  mutable std::unordered_map<int32_t, const baldr::SegmentIndex::Bin*> grid_cache_;
+  mutable std::unordered_map<baldr::GraphId, std::shared_ptr<const baldr::SegmentIndex>> indexes_;
 };
 
 }
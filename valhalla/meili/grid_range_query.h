@@ -2,6 +2,7 @@
 #ifndef MMP_GRID_RANGE_QUERY_H_
 #define MMP_GRID_RANGE_QUERY_H_
 
+#include <algorithm>
 #include <tuple>
 #include <vector>
 #include <unordered_set>
@@ -116,6 +117,31 @@ class GridRangeQuery
     return items;
   }
 
+  // Query all items that intersects with the range, appending them to a
+  // flat vector sorted and without duplicates
+  void Query(const midgard::AABB2<coord_t>& range, std::vector<item_t>& items) const
+  {
+    int mincol, minrow, maxcol, maxrow;
+    std::tie(mincol, minrow) = grid_.SquareAtPoint(range.minpt());
+    std::tie(maxcol, maxrow) = grid_.SquareAtPoint(range.maxpt());
+
+    // Normalize
+    mincol = std::max(0, std::min(mincol, ncols_ - 1));
+    maxcol = std::max(0, std::min(maxcol, ncols_ - 1));
+    minrow = std::max(0, std::min(minrow, nrows_ - 1));
+    maxrow = std::max(0, std::min(maxrow, nrows_ - 1));
+
+    const auto begin = items.size();
+    for (int row = minrow; row <= maxrow; ++row) {
+      for (int col = mincol; col <= maxcol; ++col) {
+        const auto& squared_items = GetItemsInSquare(col, row);
+        items.insert(items.end(), squared_items.begin(), squared_items.end());
+      }
+    }
+    std::sort(items.begin() + begin, items.end());
+    items.erase(std::unique(items.begin() + begin, items.end()), items.end());
+  }
+
  private:
   std::vector<item_t>& ItemsInSquare(int col, int row)
   {
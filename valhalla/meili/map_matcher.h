@@ -63,6 +63,30 @@ class MapMatcher final
   std::vector<MatchResults>
   OfflineMatch(const std::vector<Measurement>& measurements, uint32_t k = 1);
 
+  /**
+   * Match a live trace as its measurements come in. The measurements are
+   * appended to the ones matched since the last Clear and the viterbi search
+   * picks up from the winner at the last measurement, so a call only costs
+   * as much as the measurements it appends. The match of a measurement
+   * becomes final once lag more measurements have come after it, then the
+   * candidates and routes of the states up to it are discarded so that only
+   * the measurements are kept of the final part of the trace. Unlike
+   * OfflineMatch no measurement is interpolated.
+   * Call it with no measurements and a lag of 0 at the end of the trace to
+   * finalize the rest.
+   * @param measurements  the measurements that came in since the last call
+   * @param lag           how many of the latest measurements stay provisional
+   * @return the match results that became final in this call, in order
+   */
+  std::vector<MatchResult>
+  OnlineMatch(const std::vector<Measurement>& measurements, StateId::Time lag);
+
+  /**
+   * The best match of the latest measurement appended by OnlineMatch so
+   * far. Unless it is final it may change as more measurements come in.
+   */
+  MatchResult OnlineWinner();
+
   /**
    * Set a callback that will throw when the map-matching should be aborted
    * @param interrupt_callback  the function to periodically call to see if we should abort
@@ -78,8 +102,7 @@ class MapMatcher final
   StateId::Time
   AppendMeasurement(const Measurement& measurement, const float sq_max_search_radius);
 
-  void RemoveRedundancies(const std::vector<StateId>& result);
-  //void RemoveRedundancies(const MatchResults& path, std::vector<StateId>& result);
+  std::vector<MatchResult> FinalizeOnline(StateId::Time time);
 
   boost::property_tree::ptree config_;
 
@@ -103,6 +126,14 @@ class MapMatcher final
   EmissionCostModel emission_cost_model_;
 
   TransitionCostModel transition_cost_model_;
+
+  // Online matching: measurements before this time are final
+  StateId::Time online_time_;
+
+  // The state and match result the last final measurement got
+  StateId online_stateid_;
+
+  MatchResult online_result_;
 };
 
 bool
@@ -49,7 +49,7 @@ public:
   static constexpr size_t kModeCostingCount = 8;
 
 private:
-  typedef sif::cost_ptr_t (*factory_function_t)(const boost::property_tree::ptree&);
+  typedef sif::cost_ptr_t (*factory_function_t)(const rapidjson::Value&);
 
   boost::property_tree::ptree config_;
 
@@ -3,6 +3,7 @@
 #define MMP_ROUTING_H_
 #include <cstdint>
 
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <stdexcept>
@@ -135,6 +136,9 @@ class Label : public sif::EdgeLabel {
   float turn_cost_;
 };
 
+// Label index of the status of a node or destination not reached yet
+constexpr uint32_t kUnreachedStatus = (1u << 31) - 1;
+
 // Status information: label index and whether it is permanently labeled.
 struct Status{
   Status() = delete;
@@ -143,35 +147,158 @@ struct Status{
       : label_idx(idx),
         permanent(false) {}
 
+  bool reached() const {
+    return label_idx != kUnreachedStatus;
+  }
+
   uint32_t label_idx : 31;
   uint32_t permanent : 1;
 };
 
+// Default number of node statuses kept allocated between searches
+constexpr uint32_t kDefaultNodeStatusSize = 1000000;
+
+/**
+ * Status of the nodes reached by route searches. The status is kept in a
+ * dense array per tile indexed by the node's index within its tile rather
+ * than in a hash map. A tile's array is allocated the first time one of its
+ * nodes is reached and is only reset, not freed, for the next search.
+ */
+class NodeStatus {
+ public:
+  NodeStatus(const uint32_t max_retained = kDefaultNodeStatusSize)
+      : max_retained_(max_retained), last_tile_(kNoTile), last_(nullptr) {
+  }
+
+  NodeStatus(const NodeStatus&) = delete;
+  NodeStatus& operator=(const NodeStatus&) = delete;
+
+  /**
+   * Get the status of a node.
+   * @param  nodeid  GraphId of the node.
+   * @return Returns the status or nullptr if the node was not reached.
+   */
+  Status* find(const baldr::GraphId& nodeid) {
+    auto& status = tile(nodeid).status;
+    if (nodeid.id() < status.size() && status[nodeid.id()].reached()) {
+      return &status[nodeid.id()];
+    }
+    return nullptr;
+  }
+
+  /**
+   * Mark a node as reached by a label.
+   * @param  nodeid     GraphId of the node.
+   * @param  label_idx  Index of the label that reached it.
+   */
+  void emplace(const baldr::GraphId& nodeid, const uint32_t label_idx) {
+    auto& tile_status = tile(nodeid);
+    auto& status = tile_status.status;
+    if (nodeid.id() >= status.size()) {
+      status.resize(std::max<size_t>(nodeid.id() + 1, status.size() * 2), Status(kUnreachedStatus));
+    }
+    status[nodeid.id()] = Status(label_idx);
+    tile_status.touched = true;
+  }
+
+  /**
+   * Mark all the nodes as unreached. Only the tiles touched since the last
+   * clear are reset, and they stay allocated unless more statuses than the
+   * retention size are.
+   */
+  void clear() {
+    size_t retained = 0;
+    for (const auto& tile_status : statuses_) {
+      retained += tile_status.second.status.capacity();
+    }
+    if (retained > max_retained_) {
+      statuses_.clear();
+    } else {
+      for (auto& tile_status : statuses_) {
+        if (tile_status.second.touched) {
+          std::fill(tile_status.second.status.begin(), tile_status.second.status.end(),
+                    Status(kUnreachedStatus));
+          tile_status.second.touched = false;
+        }
+      }
+    }
+    last_tile_ = kNoTile;
+    last_ = nullptr;
+  }
+
+ private:
+  // Status of the nodes in one tile and whether any were set since clear
+  struct TileStatus {
+    std::vector<Status> status;
+    bool touched = false;
+  };
+
+  static constexpr uint32_t kNoTile = std::numeric_limits<uint32_t>::max();
+
+  // Get the statuses of the node's tile, remembering the last one since
+  // searches tend to stay within a tile for a while
+  TileStatus& tile(const baldr::GraphId& nodeid) {
+    const auto tile = static_cast<uint32_t>(nodeid.Tile_Base().value);
+    if (tile != last_tile_) {
+      last_ = &statuses_[tile];
+      last_tile_ = tile;
+    }
+    return *last_;
+  }
+
+  size_t max_retained_;
+  std::unordered_map<uint32_t, TileStatus> statuses_;
+  uint32_t last_tile_;
+  TileStatus* last_;
+};
+
+/**
+ * The priority queue and the node statuses a route search only needs while
+ * it runs. The label sets made by a transition cost model share one of
+ * these so the buckets of the queue and the arrays of statuses stay
+ * allocated from one search to the next instead of every search allocating
+ * its own. Only one label set may search with it at a time.
+ */
+struct SearchSpace {
+  SearchSpace(const float max_cost, const float bucket_size = 1.0f);
+
+  std::shared_ptr<baldr::DoubleBucketQueue> queue;  // Sorted by the labels
+  NodeStatus node_status;                           // Node status
+  const std::vector<Label>* labels;                 // Labels of the search
+};
+
+using search_space_ptr_t = std::shared_ptr<SearchSpace>;
+
 /**
  * LabelSet used during shortest path construction and recovery. Includes a
- * priority queue (sorted by sortdist) and maps that contain status (is the
- * element "permanently" labeled) of nodes and edges.
+ * priority queue (sorted by sortdist) and the status (is the element
+ * "permanently" labeled) of nodes and destinations.
  */
 class LabelSet
 {
  public:
   LabelSet(const float max_cost, const float bucket_size = 1.0f);
 
+  /**
+   * Construct a label set that searches with a shared queue and node status.
+   */
+  LabelSet(const search_space_ptr_t& space);
+
   /**
    * Add an origin label using a destination index.
    */
   void put(const uint16_t dest, const sif::TravelMode mode,
            const Label* edgelabel) {
     // Do not add a duplicate label for the same destination index
-    if (dest_status_.find(dest) == dest_status_.end()) {
+    if (!dest_status(dest)) {
       // If edgelabel is not null, append it to the label set otherwise append
       // a dummy. In both cases add the label to the priority queue, set its
       // predecessor to kInvalidLabel, and initialize costs to 0.
       const uint32_t idx = labels_.size();
-      dest_status_.emplace(dest, idx);
+      dest_status_[dest] = Status(idx);
       labels_.emplace_back(edgelabel ? *edgelabel : Label());
       labels_.back().InitAsOrigin(mode, dest, {});
-      queue_->add(idx);
+      queue().add(idx);
     }
   }
 
@@ -181,15 +308,15 @@ class LabelSet
   void put(const baldr::GraphId& nodeid, const sif::TravelMode mode,
            const Label* edgelabel) {
     // Do not add a duplicate origin label for the same node
-    if (node_status_.find(nodeid) == node_status_.end()) {
+    if (!space_->node_status.find(nodeid)) {
       // If edgelabel is not null, append it to the label set otherwise append
       // a dummy. In both cases add the label to the priority queue and set its
       // predecessor to kInvalidLabel
       const uint32_t idx = labels_.size();
-      node_status_.emplace(nodeid, idx);
+      space_->node_status.emplace(nodeid, idx);
       labels_.emplace_back(edgelabel ? *edgelabel : Label());
       labels_.back().InitAsOrigin(mode, kInvalidDestination, nodeid);
-      queue_->add(idx);
+      queue().add(idx);
     }
   }
 
@@ -227,32 +354,102 @@ class LabelSet
     return labels_[label_idx];
   }
 
+  /**
+   * Get the number of labels in the set.
+   * @return  Returns the number of labels put so far.
+   */
+  size_t size() const {
+    return labels_.size();
+  }
+
   /**
    * Clear the priority queue.
    */
   void clear_queue() {
-    queue_->clear();
+    queue().clear();
   }
 
   /**
-   * Clear the status maps.
+   * Clear the status of the nodes and destinations.
    */
   void clear_status() {
-    node_status_.clear();
+    space_->node_status.clear();
     dest_status_.clear();
   }
 
  private:
-  std::shared_ptr<baldr::DoubleBucketQueue> queue_;         // Priority queue
-  std::unordered_map<baldr::GraphId, Status> node_status_;  // Node status
-  std::unordered_map<uint16_t, Status> dest_status_;        // Destination status
-  std::vector<Label> labels_;                               // Label list.
+  // Get the queue, sorting it by the labels of this set
+  baldr::DoubleBucketQueue& queue() {
+    space_->labels = &labels_;
+    return *space_->queue;
+  }
+
+  // Get the status of a destination, nullptr if it was not reached
+  Status* dest_status(const uint16_t dest) {
+    if (dest >= dest_status_.size()) {
+      dest_status_.resize(dest + 1, Status(kUnreachedStatus));
+    }
+    return dest_status_[dest].reached() ? &dest_status_[dest] : nullptr;
+  }
+
+  search_space_ptr_t space_;         // Priority queue and node status
+  std::vector<Status> dest_status_;  // Destination status by index
+  std::vector<Label> labels_;        // Label list.
 };
 
 using labelset_ptr_t = std::shared_ptr<LabelSet>;
 
+/**
+ * Corridor a route search between two measurements is kept within: every
+ * position within some buffer of the segment between the measurements.
+ * Distances are approximated on a plane around the first measurement,
+ * which is plenty for the few kilometers between measurements.
+ */
+class Corridor {
+ public:
+  /**
+   * Constructor.
+   * @param  start   Position of the first measurement
+   * @param  end     Position of the second measurement
+   * @param  buffer  Distance in meters positions may be from the segment
+   */
+  Corridor(const midgard::PointLL& start, const midgard::PointLL& end, const float buffer)
+      : start_(start),
+        m_per_lng_degree_(midgard::DistanceApproximator::MetersPerLngDegree(start.lat())),
+        dx_((end.lng() - start.lng()) * m_per_lng_degree_),
+        dy_((end.lat() - start.lat()) * midgard::kMetersPerDegreeLat),
+        length2_(dx_ * dx_ + dy_ * dy_),
+        buffer2_(buffer * buffer) {
+  }
+
+  /**
+   * Is the position within the corridor?
+   * @param  ll  Position
+   * @return Returns true if the position is within the buffer of the segment
+   */
+  bool contains(const midgard::PointLL& ll) const {
+    float x = (ll.lng() - start_.lng()) * m_per_lng_degree_;
+    float y = (ll.lat() - start_.lat()) * midgard::kMetersPerDegreeLat;
+    // Project onto the segment and clamp to its ends
+    float t = length2_ > 0.f ? std::max(0.f, std::min(1.f, (x * dx_ + y * dy_) / length2_)) : 0.f;
+    x -= t * dx_;
+    y -= t * dy_;
+    return x * x + y * y <= buffer2_;
+  }
+
+ private:
+  midgard::PointLL start_;
+  float m_per_lng_degree_;
+  float dx_;       // Segment in meters east
+  float dy_;       // Segment in meters north
+  float length2_;  // Squared length of the segment
+  float buffer2_;  // Squared buffer
+};
+
 /**
  * Find the shortest paths between an origin and a set of destinations.
+ * Nodes are not expanded once the distance to them plus the heuristic
+ * reaches max_dist, or if they are outside the corridor when one is given.
  */
 std::unordered_map<uint16_t, uint32_t>
 find_shortest_path(baldr::GraphReader& reader,
@@ -261,7 +458,8 @@ find_shortest_path(baldr::GraphReader& reader,
                    const midgard::DistanceApproximator& approximator,
                    const float search_radius, sif::cost_ptr_t costing,
                    const Label* edgelabel, const float turn_cost_table[181],
-                   const float max_dist, const float max_time);
+                   const float max_dist, const float max_time,
+                   const Corridor* corridor = nullptr);
 
 // Route path iterator. Methods to assist recovering route paths from Labels.
 class RoutePathIterator:
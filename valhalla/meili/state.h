@@ -2,10 +2,13 @@
 #ifndef MMP_STATE_H_
 #define MMP_STATE_H_
 
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 
+#include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/pathlocation.h>
+#include <valhalla/midgard/util.h>
 #include <valhalla/meili/measurement.h>
 #include <valhalla/meili/routing.h>
 #include <valhalla/meili/stateid.h>
@@ -21,6 +24,7 @@ class State
       : stateid_(stateid),
         candidate_(candidate),
         labelset_(nullptr),
+        route_time_(kInvalidTime),
         label_idx_() {}
 
   const StateId& stateid() const
@@ -41,13 +45,21 @@ class State
       throw std::runtime_error("expect valid labelset but got nullptr");
     }
 
-    // Cache results
+    // Cache results by the id of the state they reach, the states are all
+    // of the same time and their ids are dense so this is a flat array
+    route_time_ = stateids.empty() ? kInvalidTime : stateids.front().time();
     label_idx_.clear();
     uint16_t dest = 1;  // dest at 0 is remained for the origin
     for (const auto& stateid: stateids) {
+      if (stateid.time() != route_time_) {
+        throw std::logic_error("expect the routed states to be of the same time");
+      }
       const auto it = results.find(dest);
       if (it != results.end()) {
-        label_idx_[stateid] = it->second;
+        if (label_idx_.size() <= stateid.id()) {
+          label_idx_.resize(stateid.id() + 1, baldr::kInvalidLabel);
+        }
+        label_idx_[stateid.id()] = it->second;
       }
       dest++;
     }
@@ -58,18 +70,18 @@ class State
 
   const Label* last_label(const State& state) const
   {
-    const auto it = label_idx_.find(state.stateid());
-    if (it != label_idx_.end()) {
-      return &labelset_->label(it->second);
+    const auto idx = label_idx(state.stateid());
+    if (idx != baldr::kInvalidLabel) {
+      return &labelset_->label(idx);
     }
     return nullptr;
   }
 
   RoutePathIterator RouteBegin(const State& state) const
   {
-    const auto it = label_idx_.find(state.stateid());
-    if (it != label_idx_.end()) {
-      return RoutePathIterator(labelset_.get(), it->second);
+    const auto idx = label_idx(state.stateid());
+    if (idx != baldr::kInvalidLabel) {
+      return RoutePathIterator(labelset_.get(), idx);
     }
     return RoutePathIterator(labelset_.get());
   }
@@ -78,36 +90,65 @@ class State
   { return RoutePathIterator(labelset_.get()); }
 
  private:
+  uint32_t label_idx(const StateId& stateid) const
+  {
+    return stateid.time() == route_time_ && stateid.id() < label_idx_.size() ?
+        label_idx_[stateid.id()] : baldr::kInvalidLabel;
+  }
+
   StateId stateid_;
 
   baldr::PathLocation candidate_;
 
   mutable std::shared_ptr<LabelSet> labelset_;
 
-  mutable std::unordered_map<StateId, uint32_t> label_idx_;
+  // Time of the states routed to and the label reaching each of them by id
+  mutable StateId::Time route_time_;
+
+  mutable std::vector<uint32_t> label_idx_;
 };
 
 class StateContainer
 {
  private:
-  using Column = std::vector<State>;
+  using Column = midgard::iterable_t<const State>;
 
  public:
   StateContainer()
       : measurements_(),
         leave_times_(),
-        columns_() {}
+        states_(),
+        column_offsets_(),
+        states_offset_(0),
+        discarded_time_(0) {}
 
   void Clear()
   {
     measurements_.clear();
     leave_times_.clear();
-    columns_.clear();
+    states_.clear();
+    column_offsets_.clear();
+    states_offset_ = 0;
+    discarded_time_ = 0;
+  }
+
+  // Free the states (their candidates and routes) before a time but keep
+  // their measurements. The discarded states must not be accessed anymore.
+  // The states of all columns are kept one after the other, so the memory
+  // is only given back once most of them are discarded
+  void DiscardBefore(StateId::Time time)
+  {
+    discarded_time_ = std::max(discarded_time_, std::min(time, size()));
+    const auto discarded = column_begin(discarded_time_);
+    if (0 < discarded && states_.size() < discarded * 2) {
+      states_.erase(states_.begin(), states_.begin() + discarded);
+      states_offset_ += discarded;
+    }
   }
 
   const State&
   state(const StateId& stateid) const
-  { return columns_[stateid.time()][stateid.id()]; }
+  { return states_[column_begin(stateid.time()) + stateid.id()]; }
 
   const Measurement&
   measurement(const StateId::Time& time) const
@@ -119,12 +160,19 @@ class StateContainer
   void SetMeasurementLeaveTime(const StateId::Time& time, double leave_time)
   { leave_times_[time] = leave_time; }
 
-  const Column&
+  Column
   column(const StateId::Time& time) const
-  { return columns_[time]; }
+  {
+    // Discarded columns are empty
+    if (time < discarded_time_) {
+      return Column(states_.data(), static_cast<size_t>(0));
+    }
+    const auto* first = states_.data() + column_begin(time);
+    return Column(first, states_.data() + column_end(time));
+  }
 
   StateId::Time size() const
-  { return static_cast<StateId::Time>(columns_.size()); }
+  { return static_cast<StateId::Time>(column_offsets_.size()); }
 
   std::string geojson(const StateId& s)
   { return geojson(state(s)); }
@@ -140,7 +188,10 @@ class StateContainer
 
   StateId
   NewStateId() const
-  { return columns_.empty() ? StateId() : StateId(columns_.size() - 1, columns_.back().size()); }
+  {
+    return column_offsets_.empty() ? StateId() :
+        StateId(size() - 1, column_end(size() - 1) - column_begin(size() - 1));
+  }
 
   StateId::Time
   AppendMeasurement(const Measurement& measurement)
@@ -149,7 +200,7 @@ class StateContainer
 
     measurements_.push_back(measurement);
     leave_times_.push_back(measurement.epoch_time());
-    columns_.emplace_back();
+    column_offsets_.push_back(states_offset_ + states_.size());
 
     return time;
   }
@@ -165,27 +216,42 @@ class StateContainer
 
   void AppendState(const State& state)
   {
-    if (columns_.empty()) {
+    if (column_offsets_.empty()) {
       throw std::runtime_error("add measurement first");
     }
-    const auto expected_time = columns_.size() - 1;
-    const auto expected_id = columns_.back().size();
-    if (state.stateid() != StateId(expected_time, expected_id)) {
+    const auto& expected = NewStateId();
+    if (state.stateid() != expected) {
       throw std::runtime_error(
           "state's stateid should be "                                  \
-          + std::to_string(expected_time) + "/" + std::to_string(expected_id) + \
+          + std::to_string(expected.time()) + "/" + std::to_string(expected.id()) + \
           " but got " + std::to_string(state.stateid().time()) + "/" + std::to_string(state.stateid().id()));
     }
 
-    columns_.back().push_back(state);
+    states_.push_back(state);
   }
 
  private:
+  // Where the states of a column begin and end in the states
+  size_t column_begin(const StateId::Time& time) const
+  { return time < column_offsets_.size() ? column_offsets_[time] - states_offset_ : states_.size(); }
+
+  size_t column_end(const StateId::Time& time) const
+  { return time + 1 < column_offsets_.size() ? column_offsets_[time + 1] - states_offset_ : states_.size(); }
+
   std::vector<Measurement> measurements_;
 
   std::vector<double> leave_times_;
 
-  std::vector<Column> columns_;
+  // The states of all the columns in the order of their times
+  std::vector<State> states_;
+
+  // Offset of the first state of each column
+  std::vector<size_t> column_offsets_;
+
+  // Number of states erased from the front of the states
+  size_t states_offset_;
+
+  StateId::Time discarded_time_;
 };
 
 }
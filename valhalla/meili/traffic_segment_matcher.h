@@ -2,6 +2,9 @@
 #define MMP_TRAFFIC_SEGMENT_MATCHER_H_
 
 #include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
 #include <string>
 #include <vector>
 #include <list>
@@ -11,6 +14,8 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/json.h>
+#include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/meili/batch_matcher.h>
 #include <valhalla/meili/map_matcher.h>
 #include <valhalla/meili/map_matcher_factory.h>
 
@@ -38,6 +43,36 @@ struct traffic_segment_t {
   std::vector<uint64_t> way_ids; // A list of way ids from the directed edge
 };
 
+// Header of a trace in binary probe input, followed by its points
+struct probe_trace_t {
+  uint64_t trace_id;     // Unique id of the trace
+  uint32_t point_count;  // Number of points that follow
+  uint32_t spare;
+};
+
+// Point of a trace in binary probe input
+struct probe_point_t {
+  double lon;            // Longitude in degrees
+  double lat;            // Latitude in degrees
+  double time;           // Seconds from epoch
+  float accuracy;        // GPS accuracy in meters, <= 0 for the default
+  uint32_t spare;
+};
+
+// Segment speed record of binary output, one per matched segment of a trace
+struct segment_speed_t {
+  uint64_t trace_id;           // Id of the trace the segment was matched from
+  uint64_t segment_id;         // Traffic segment id, invalid for a path without one
+  double start_time;           // Begin time along this segment, if < 0 then no begin match
+  double end_time;             // End time along this segment, if < 0 then no end match
+  int32_t length;              // Length in meters along this segment, if < 0 then no match
+  int32_t queue_length;        // Length of any queue from the end of the segment
+  uint32_t begin_shape_index;  // Begins at this index of the trace
+  uint32_t end_shape_index;    // Ends at this index of the trace
+  uint32_t internal;           // Whether the segment is made of internal edges
+  uint32_t spare;
+};
+
 /**
  * Traffic segment matcher. Allows matching GPS traces to Valhalla edges and
  * then forms the traffic segments associated to those edges.
@@ -65,12 +100,71 @@ class TrafficSegmentMatcher {
    */
   virtual std::string match(const std::string& json);
 
+  /**
+   * Matches measurements to Valhalla edges and then associates those to
+   * traffic segments, without going through json. Only uses the matcher
+   * given so it can be called concurrently with different matchers.
+   * @param   matcher       Map matcher to match with.
+   * @param   measurements  GPS trace, as cleaned by validate_measurements.
+   * @return  Returns the traffic segments (and times) that the GPS trace
+   *          is matched to.
+   */
+  std::vector<traffic_segment_t> match(const std::shared_ptr<MapMatcher>& matcher,
+                                       const std::vector<Measurement>& measurements) const;
+
+  using segments_callback_t = std::function<void (size_t index, std::vector<traffic_segment_t>&& segments,
+                                                  const std::string& error)>;
+
+  /**
+   * Matches many GPS traces to traffic segments on the threads of a batch
+   * matcher. The segments of each trace are handed to the callback as soon
+   * as they are formed, so in no particular order, and never concurrently.
+   * A trace that can't be matched is handed back with the error and empty
+   * segments. If the callback throws no more traces are matched and it is
+   * rethrown here.
+   * @param  batch         Batch matcher whose threads do the work.
+   * @param  match_config  Mode and match options of all the traces.
+   * @param  traces        GPS traces, cleaned here by validate_measurements.
+   * @param  callback      Called with the segments of each trace.
+   */
+  void match(BatchMatcher& batch, const boost::property_tree::ptree& match_config,
+             std::vector<std::vector<Measurement> >& traces, const segments_callback_t& callback) const;
+
+  /**
+   * Reads the next trace of binary probe input, bypassing json entirely.
+   * @param  in                     Stream of probe_trace_t each followed by its
+   *                                probe_point_t.
+   * @param  default_accuracy       Accuracy of the points that have none.
+   * @param  default_search_radius  Search radius of the points.
+   * @param  trace_id               Id of the trace read.
+   * @param  measurements           Points of the trace read, not yet validated.
+   * @return Returns false at the end of the input.
+   */
+  static bool read_trace(std::istream& in, float default_accuracy, float default_search_radius,
+                         uint64_t& trace_id, std::vector<Measurement>& measurements);
+
+  /**
+   * Writes the segments of a trace to binary output, one segment_speed_t each.
+   * @param  out               Stream to write to.
+   * @param  trace_id          Id of the trace the segments were matched from.
+   * @param  traffic_segments  Segments of the trace.
+   */
+  static void write_segments(std::ostream& out, const uint64_t trace_id,
+                             const std::vector<traffic_segment_t>& traffic_segments);
+
+  /**
+   * Checks that there are enough measurements and that they are in order,
+   * dropping the ones at the same time as the next.
+   * @param  measurements  GPS trace.
+   */
+  static void validate_measurements(std::vector<Measurement>& measurements);
+
   /**
    * Parses the input to the traffic matcher, mainly the trace array
-   * @param  json string of gps data {"trace":[{"lat":0,"lon":0,time:0},...]}
+   * @param  request  json of gps data {"trace":[{"lat":0,"lon":0,time:0},...]}
    * @return the list of measurements from the json trace
    */
-  static std::vector<Measurement> parse_measurements(const boost::property_tree::ptree request,
+  static std::vector<Measurement> parse_measurements(const rapidjson::Value& request,
     float default_accuracy, float default_search_radius);
 
   /**
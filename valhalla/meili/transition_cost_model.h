@@ -3,8 +3,11 @@
 
 #include <functional>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/meili/measurement.h>
+#include <valhalla/meili/routing.h>
 #include <valhalla/meili/state.h>
 #include <valhalla/meili/topk_search.h>
 #include <valhalla/meili/viterbi_search.h>
@@ -27,7 +30,8 @@ class TransitionCostModel
       float breakage_distance,
       float max_route_distance_factor,
       float max_route_time_factor,
-      float turn_penalty_factor);
+      float turn_penalty_factor,
+      float corridor_buffer = 0.f);
 
   TransitionCostModel(
       baldr::GraphReader& graphreader,
@@ -54,6 +58,14 @@ class TransitionCostModel
 
   float operator()(const StateId& lhs, const StateId& rhs) const;
 
+  // Edge labels the route searches between states have created so far
+  uint64_t labels() const
+  { return labels_; }
+
+  // Labels put into the queue the route searches share so far
+  uint64_t queue_pushes() const
+  { return search_space_->queue->pushes(); }
+
  private:
 
   void UpdateRoute(const StateId& lhs, const StateId& rhs) const;
@@ -95,8 +107,18 @@ class TransitionCostModel
 
   float turn_penalty_factor_;
 
+  // Distance (meters) the route searches may stray from the segment between
+  // two measurements, 0 to search without a corridor
+  float corridor_buffer_;
+
   // Cost for each degree in [0, 180]
   float turn_cost_table_[181];
+
+  // Queue and node status shared by the route searches
+  search_space_ptr_t search_space_;
+
+  // Labels of all the route searches, they are counted as the routes are kept
+  mutable uint64_t labels_;
 };
 
 }
@@ -3,6 +3,7 @@
 #define MMP_VITERBI_SEARCH_H_
 
 #include <vector>
+#include <functional>
 #include <unordered_map>
 #include <unordered_set>
 #include <stdexcept>
@@ -300,7 +301,8 @@ class ViterbiSearch: public IViterbiSearch
       const IEmissionCostModel& emission_cost_model,
       const ITransitionCostModel& transition_cost_model)
       : IViterbiSearch(emission_cost_model, transition_cost_model),
-        earliest_time_(0) {}
+        earliest_time_(0),
+        discarded_time_(0) {}
 
   ViterbiSearch()
       : ViterbiSearch(DefaultEmissionCostModel, DefaultTransitionCostModel) {}
@@ -331,6 +333,15 @@ class ViterbiSearch: public IViterbiSearch
 
   StateId Predecessor(const StateId& stateid) const override;
 
+  /**
+   * Discard the states before a time and whatever the search knows about
+   * them. Labels before it are skipped from then on as if they were before
+   * the earliest time, i.e. the paths through the discarded states are
+   * final. It keeps an online search from growing with the trace.
+   * @param time  states earlier than this time are discarded
+   */
+  void DiscardBefore(StateId::Time time);
+
   virtual bool IsInvalidCost(double cost) const
   { return cost < 0.f; }
 
@@ -343,11 +354,29 @@ class ViterbiSearch: public IViterbiSearch
 
   std::vector<StateId> winner_;
 
-  std::vector<std::vector<StateId>> unreached_states_;
+  // What is kept of a scanned state, a negative cost means it isn't scanned
+  struct ScannedLabel
+  {
+    double costsofar;
+    StateId predecessor;
+  };
+
+  // Number of states of each column that are not scanned yet
+  std::vector<uint32_t> unreached_counts_;
 
   SPQueue<StateLabel> queue_;
 
-  std::unordered_map<StateId, StateLabel> scanned_labels_;
+  // Scanned states of each column by id. The ids of a column are dense
+  // except for the clones of the top k search, which are claimed from the
+  // top of the range and are kept aside
+  std::vector<std::vector<ScannedLabel>> scanned_labels_;
+
+  std::unordered_map<StateId, ScannedLabel> sparse_scanned_labels_;
+
+  const ScannedLabel* FindScannedLabel(const StateId& stateid) const;
+
+  // Remember a label as scanned, false if its state is scanned already
+  bool Scan(const StateLabel& label);
 
   // Initialize labels from a column and push them into priority queue
   void InitQueue(const std::vector<StateId>& column);
@@ -357,6 +386,46 @@ class ViterbiSearch: public IViterbiSearch
   StateId::Time IterativeSearch(StateId::Time target, bool request_new_start);
 
   StateId::Time earliest_time_;
+
+  StateId::Time discarded_time_;
+};
+
+/**
+ * Finds the k cheapest paths through columns of states in a single pass, a
+ * list viterbi. Every state is settled at most k times, the ith time by its
+ * ith cheapest path from the first column, so the paths that settle the
+ * states of the last column come out as the k cheapest paths of all in order.
+ * The costs are those of the viterbi search, a negative cost tells that a
+ * state or transition can't be used.
+ */
+class KBestViterbiSearch
+{
+ public:
+  struct Path
+  {
+    std::vector<StateId> stateids;
+    double cost;
+  };
+
+  KBestViterbiSearch(
+      const IEmissionCostModel& emission_cost_model,
+      const ITransitionCostModel& transition_cost_model)
+      : emission_cost_model_(emission_cost_model),
+        transition_cost_model_(transition_cost_model) {}
+
+  /**
+   * Find the cheapest paths visiting a state of every column in turn.
+   * @param  columns  the states of each time
+   * @param  k        how many paths to find at most
+   * @return the paths from the cheapest one on, fewer than k if there are
+   *         no more and none if the last column can't be reached
+   */
+  std::vector<Path> Search(const std::vector<std::vector<StateId>>& columns, uint32_t k) const;
+
+ private:
+  IEmissionCostModel emission_cost_model_;
+
+  ITransitionCostModel transition_cost_model_;
 };
 
 }
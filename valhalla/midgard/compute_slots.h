@@ -0,0 +1,53 @@
+#ifndef VALHALLA_MIDGARD_COMPUTE_SLOTS_H_
+#define VALHALLA_MIDGARD_COMPUTE_SLOTS_H_
+
+#include <cstddef>
+
+namespace valhalla {
+namespace midgard {
+
+//caps how many threads of the process compute at once so that a stage can run more workers than
+//there are cores for it. a worker holds a slot while it works on a request and gives it up while it
+//waits on tile io, so that another worker can use the core in the meantime rather than it sitting
+//idle. threads that never hold a slot, and every thread when there are no slots, never wait
+namespace compute_slots {
+
+//sets how many threads may hold a slot at once, 0 (the default) for no limit. set it before
+//starting the threads which hold them
+void set_slots(size_t slots);
+
+//the number of slots, 0 for no limit
+size_t slots();
+
+//the number of slots currently held
+size_t held();
+
+//holds a slot for the calling thread for as long as it is in scope, waiting for one if need be
+class ScopedSlot {
+ public:
+  ScopedSlot();
+  ~ScopedSlot();
+  ScopedSlot(const ScopedSlot&) = delete;
+  ScopedSlot& operator=(const ScopedSlot&) = delete;
+ protected:
+  bool acquired;
+};
+
+//gives up the slot of the calling thread, if it holds one, for as long as it is in scope. wrap the
+//blocking io in one and the slot is taken back (waiting for it if need be) once the io is done
+class ScopedWait {
+ public:
+  ScopedWait();
+  ~ScopedWait();
+  ScopedWait(const ScopedWait&) = delete;
+  ScopedWait& operator=(const ScopedWait&) = delete;
+ protected:
+  bool released;
+};
+
+}
+
+}
+}
+
+#endif  // VALHALLA_MIDGARD_COMPUTE_SLOTS_H_
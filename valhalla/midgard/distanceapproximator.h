@@ -3,6 +3,7 @@
 #define VALHALLA_MIDGARD_DISTANCEAPPROXIMATOR_H_
 
 #include <math.h>
+#include <cstddef>
 
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/constants.h>
@@ -72,6 +73,31 @@ class DistanceApproximator
            sqr((ll.lng() - centerlng_) * m_per_lng_degree_);
   }
 
+  /**
+   * Approximates the squared distances of a batch of positions to the test
+   * point the same way as the single position version, several at a time
+   * where the instruction set allows.
+   * @param   lngs          Longitudes of the positions (degrees)
+   * @param   lats          Latitudes of the positions (degrees)
+   * @param   count         Number of positions
+   * @param   sq_distances  Squared distances in meters, one per position
+   */
+  void DistanceSquared(const float* lngs, const float* lats, const size_t count,
+                       float* sq_distances) const;
+
+  /**
+   * Projects the test point onto a batch of segments, scaling longitude by
+   * the cos of the test point latitude like PointLL::ClosestPoint, and
+   * approximates the squared distances to the projected points.
+   * @param   ux, uy        Longitudes and latitudes of the segment starts
+   * @param   vx, vy        Longitudes and latitudes of the segment ends
+   * @param   count         Number of segments
+   * @param   x, y          Longitudes and latitudes of the projected points
+   * @param   sq_distances  Squared distances in meters, one per segment
+   */
+  void Project(const float* ux, const float* uy, const float* vx, const float* vy,
+               const size_t count, float* x, float* y, float* sq_distances) const;
+
   /**
    * Approximates arc distance between 2 lat,lng positions using meters per
    * latitude and longitude degree.  Uses the mid latitude of the 2 positions
@@ -6,6 +6,7 @@
 #include <type_traits>
 #include <cmath>
 #include <vector>
+#include <string>
 
 namespace valhalla {
 namespace midgard {
@@ -72,34 +73,35 @@ container_t decode7(const std::string& encoded) {
 }
 
 /**
- * Polyline encode a container of points into a string suitable for web use
+ * Polyline encode a container of points onto the end of a string suitable for
+ * web use. Room for the worst case is made up front and the characters are
+ * written straight into it, so reusing a string avoids allocating altogether
  * Note: newer versions of this algorithm allow one to specify a zoom level
  * which allows displaying simplified versions of the encoded linestring
  *
  * @param points    the list of points to encode
- * @return string   the encoded container of points
+ * @param output    the string to append the encoded points to
  */
 template<class container_t>
-std::string encode(const container_t& points) {
-  //a place to keep the output
-  std::string output;
-  //unless the shape is very course you should probably only need about 3 bytes
-  //per coord, which is 6 bytes with 2 coords, so we overshoot to 8 just in case
-  output.reserve(points.size() * 8);
+void encode(const container_t& points, std::string& output) {
+  //a 32 bit number takes at most 7 characters and there are 2 per point
+  size_t start = output.size();
+  output.resize(start + points.size() * 14);
+  char* out = &output[start];
 
   //handy lambda to turn an integer into an encoded string
-  auto serialize = [&output](int number) {
+  auto serialize = [&out](int number) {
     //move the bits left 1 position and flip all the bits if it was a negative number
     number = number < 0 ? ~(number << 1) : (number << 1);
     //write 5 bit chunks of the number
     while (number >= 0x20) {
       int nextValue = (0x20 | (number & 0x1f)) + 63;
-      output.push_back(static_cast<char>(nextValue));
+      *out++ = static_cast<char>(nextValue);
       number >>= 5;
     }
     //write the last chunk
     number += 63;
-    output.push_back(static_cast<char>(number));
+    *out++ = static_cast<char>(number);
   };
 
   //this is an offset encoding so we remember the last point we saw
@@ -116,26 +118,39 @@ std::string encode(const container_t& points) {
     last_lon = lon;
     last_lat = lat;
   }
-  return output;
+  //give back what we didnt use
+  output.resize(out - &output[0]);
 }
 
-
 /**
- * Varint encode a container of points into a string
+ * Polyline encode a container of points into a string suitable for web use
  *
  * @param points    the list of points to encode
  * @return string   the encoded container of points
  */
 template<class container_t>
-std::string encode7(const container_t& points) {
-  //a place to keep the output
+std::string encode(const container_t& points) {
   std::string output;
-  //unless the shape is very course you should probably only need about 3 bytes
-  //per coord, which is 6 bytes with 2 coords, so we overshoot to 8 just in case
-  output.reserve(points.size() * 8);
+  encode(points, output);
+  return output;
+}
+
+/**
+ * Varint encode a container of points onto the end of a string. Like encode
+ * room for the worst case is made up front and written straight into
+ *
+ * @param points    the list of points to encode
+ * @param output    the string to append the encoded points to
+ */
+template<class container_t>
+void encode7(const container_t& points, std::string& output) {
+  //a 32 bit number takes at most 5 bytes and there are 2 per point
+  size_t start = output.size();
+  output.resize(start + points.size() * 10);
+  char* out = &output[start];
 
   //handy lambda to turn an integer into an encoded string
-  auto serialize = [&output](int number) {
+  auto serialize = [&out](int number) {
     //get the sign bit down on the least significant end to
     //make the most significant bits mostly zeros
     number = number < 0 ? ~(number << 1) : number << 1;
@@ -143,11 +158,11 @@ std::string encode7(const container_t& points) {
     while (number > 0x7f) {
       //marking the most significant bit means there are more pieces to come
       int nextValue = (0x80 | (number & 0x7f));
-      output.push_back(static_cast<char>(nextValue));
+      *out++ = static_cast<char>(nextValue);
       number >>= 7;
     }
     //write the last chunk
-    output.push_back(static_cast<char>(number & 0x7f));
+    *out++ = static_cast<char>(number & 0x7f);
   };
 
   //this is an offset encoding so we remember the last point we saw
@@ -164,6 +179,20 @@ std::string encode7(const container_t& points) {
     last_lon = lon;
     last_lat = lat;
   }
+  //give back what we didnt use
+  output.resize(out - &output[0]);
+}
+
+/**
+ * Varint encode a container of points into a string
+ *
+ * @param points    the list of points to encode
+ * @return string   the encoded container of points
+ */
+template<class container_t>
+std::string encode7(const container_t& points) {
+  std::string output;
+  encode7(points, output);
   return output;
 }
 
@@ -6,6 +6,7 @@
 #include <map>
 #include <limits>
 #include <list>
+#include <functional>
 
 namespace valhalla {
 namespace midgard {
@@ -14,9 +15,17 @@ namespace midgard {
 // compute an optimal generalization factor when creating contours.
 constexpr float kOptimalGeneralization = std::numeric_limits<float>::max();
 
+// Tiles along each side of a block of gridded data. Blocks are only allocated
+// once one of their tiles is set.
+constexpr int32_t kGriddedBlockSize = 16;
+
 /**
  * Class to store data in a gridded/tiled data structure. Contains methods
- * to mark each tile with data using a compare operator.
+ * to mark each tile with data using a compare operator. The data is kept in
+ * square blocks of tiles that are allocated the first time one of their tiles
+ * is set, tiles in the other blocks keep the initial value. Memory and the
+ * time to generate contours depend on the tiles that are set rather than the
+ * area of the bounding box.
  */
 template <class coord_t>
 class GriddedData : public Tiles<coord_t> {
@@ -39,6 +48,14 @@ class GriddedData : public Tiles<coord_t> {
    */
   bool Set(const coord_t& pt, const float value);
 
+  /**
+   * Set the value at a specified tile Id. Verifies that the tile is valid.
+   * @param  tile_id  Tile Id to set value for.
+   * @param  value    Value to set at the tile/grid location.
+   * @return whether or not the value was set
+   */
+  bool Set(const int tile_id, const float value);
+
   /**
    * Set the value at a specified tile Id if the value is less than the current
    * value set at the grid location. Verifies that the tile is valid.
@@ -59,10 +76,46 @@ class GriddedData : public Tiles<coord_t> {
   bool SetIfLessThan(const coord_t& pt, const float value);
 
   /**
-   * Get the array of data.
+   * Combine another grid over the same tiles into this one, tile by tile, so
+   * that contours of either or both of them can be drawn at once.
+   * @param  other     Grid with the same bounds, tile size and initial value.
+   * @param  keep_max  Keep the larger value of each tile (reached by both)
+   *                   rather than the smaller one (reached by either).
+   */
+  void Combine(const GriddedData<coord_t>& other, const bool keep_max);
+
+  /**
+   * Keep only the tiles that have a given value in another grid over the same
+   * tiles, the others get the initial value again. Used to cut a grid into the
+   * parts nearest to each of its origins.
+   * @param  keys  Grid with the same bounds and tile size.
+   * @param  key   Value of the tiles of keys to keep.
+   */
+  void Mask(const GriddedData<coord_t>& keys, const float key);
+
+  /**
+   * Get the value at a specified tile Id.
+   * @param  tile_id  Tile Id to get the value of.
+   * @return Returns the value set at the tile, the initial value if it
+   *         was never set.
+   */
+  float Value(const int tile_id) const {
+    const auto& block = blocks_[BlockId(tile_id)];
+    return block.empty() ? max_value_ : block[BlockOffset(tile_id)];
+  }
+
+  /**
+   * Get the array of data. All the tiles are expanded so this is meant
+   * for debugging and small grids.
    * @return  Returns the data associated with the tiles.
    */
-  const std::vector<float>& data() const;
+  std::vector<float> data() const;
+
+  /**
+   * Get the number of blocks that have been allocated.
+   * @return  Returns the number of allocated blocks.
+   */
+  size_t allocated_blocks() const;
 
   /**
    * TODO: implement two versions of this, leave this one for linestring contours
@@ -79,18 +132,49 @@ class GriddedData : public Tiles<coord_t> {
    * @param generalize           Generalization factor in meters. A special value
    *                             kOptimalGeneralization will let the method choose
    *                             an optimal generalization factor based on grid size.
+   * @param max_threads          the intervals are traced in parallel on up to this
+   *                             many threads, 0 uses one per core
    *
    * @return contour line geometries with the larger intervals first (for rendering purposes)
    */
-  using contour_t = std::list<coord_t>;
-  using feature_t = std::list<contour_t>;
-  using contours_t = std::map<float, std::list<feature_t>, std::function<bool(const float, const float)> >;
+  using contour_t = std::vector<coord_t>;
+  using feature_t = std::vector<contour_t>;
+  using contours_t = std::map<float, std::vector<feature_t>, std::function<bool(const float, const float)> >;
   contours_t GenerateContours(const std::vector<float>& contour_intervals, const bool rings_only = false,
-    const float denoise = 1.f, const float generalize = 200.f) const;
+    const float denoise = 1.f, const float generalize = 200.f, const size_t max_threads = 0) const;
 
  protected:
+  /**
+   * Trace the contour lines of a single interval and clean them up.
+   * @param contour     the value at which the contour lines should occur
+   * @param rings_only  only include geometry of contours that are polygonal
+   * @param denoise     see GenerateContours
+   * @param gen_factor  Generalization factor in meters, 0 for none
+   * @return the contour lines, largest first
+   */
+  std::vector<contour_t> GenerateContour(const float contour, const bool rings_only,
+    const float denoise, const float gen_factor) const;
+
+  // Get the block a tile is in
+  int32_t BlockId(const int tile_id) const {
+    return (tile_id / this->ncolumns_ / kGriddedBlockSize) * block_columns_ +
+           (tile_id % this->ncolumns_) / kGriddedBlockSize;
+  }
+
+  // Get where in its block a tile is
+  int32_t BlockOffset(const int tile_id) const {
+    return (tile_id / this->ncolumns_ % kGriddedBlockSize) * kGriddedBlockSize +
+           (tile_id % this->ncolumns_) % kGriddedBlockSize;
+  }
+
+  // Get the value of a tile for writing, allocating its block if need be
+  float& Cell(const int tile_id);
+
   float max_value_;             // Maximum value stored in the tile
-  std::vector<float> data_;     // Data value within each tile
+  int32_t block_rows_;          // Number of rows of blocks
+  int32_t block_columns_;       // Number of columns of blocks
+  std::vector<std::vector<float> > blocks_;  // Data value within each tile
+                                             // of a block, empty until set
 };
 
 }
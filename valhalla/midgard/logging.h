@@ -41,6 +41,8 @@ class Logger {
   virtual void Log(const std::string&, const std::string& custom_directive = " [TRACE] ");
  protected:
   std::mutex lock;
+  //messages below this level are dropped before they are formatted
+  LogLevel min_level;
 };
 
 //statically get a logger using the factory
@@ -54,6 +56,7 @@ void Log(const std::string&, const std::string& custom_directive = " [TRACE] ");
 //try something like:
 //logging::Configure({ {"type", "std_out"}, {"color", ""} })
 //logging::Configure({ {"type", "file"}, {"file_name", "test.log"}, {"reopen_interval", "1"} })
+//add {"async", "true"} to write from a thread of its own and {"level", "warn"} to drop the rest
 void Configure(const LoggingConfig& config);
 
 //guarding against redefinitions
@@ -0,0 +1,102 @@
+#ifndef VALHALLA_MIDGARD_METRICS_H_
+#define VALHALLA_MIDGARD_METRICS_H_
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+#include <valhalla/midgard/tracing.h>
+
+namespace valhalla {
+namespace midgard {
+
+namespace metrics {
+
+//hot path counters, each thread keeps its own copy which are summed on scrape
+enum class Counter : uint8_t {
+  kTileCacheHits,
+  kTileCacheMisses,
+  kEdgesLabelled,
+  kResponseCacheHits,
+  kRequestsCoalesced,
+  kResponseCacheEvictions,
+  kMemoryBudgetExceeded,
+  kRequestMemoryBytes,
+  kCount
+};
+
+//current sizes of things shared by the whole process, set rather than summed
+enum class Gauge : uint8_t {
+  kResponseCacheSize,
+  kRequestsInFlight,
+  kCount
+};
+
+//per stage latency histograms, also thread local and summed on scrape
+enum class Timer : uint8_t {
+  kLokiSearch,
+  kThorPath,
+  kThorTripPath,
+  kOdinDirections,
+  kTyrSerialize,
+  kCount
+};
+
+//the name of the span each timer records in a traced request, in enum order
+constexpr const char* kTimerSpans[] = { "loki_search", "thor_path", "thor_trip_path", "odin_directions", "tyr_serialize" };
+
+//upper bounds (in milliseconds) of the histogram buckets, the last bucket is +Inf
+constexpr double kBucketBounds[] = { 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+constexpr size_t kBucketCount = sizeof(kBucketBounds) / sizeof(kBucketBounds[0]) + 1;
+
+//bump a counter for the calling thread, no locks or contended atomics involved
+void Add(Counter counter, uint64_t value = 1);
+
+//record a latency in milliseconds for the calling thread
+void Observe(Timer timer, double milliseconds);
+
+//set the current value of a gauge for the whole process
+void Set(Gauge gauge, int64_t value);
+
+//aggregate what every thread has recorded so far into prometheus' text exposition format
+std::string ToPrometheus();
+
+//observes the time between its construction and destruction, and records it as a span too
+//when the request being worked on is traced
+class ScopedTimer {
+ public:
+  ScopedTimer(Timer timer) : timer(timer), start(std::chrono::steady_clock::now()),
+    span(kTimerSpans[static_cast<size_t>(timer)]) {}
+  ~ScopedTimer() {
+    Observe(timer, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+ protected:
+  Timer timer;
+  std::chrono::steady_clock::time_point start;
+  tracing::ScopedSpan span;
+};
+
+//convenience macros so instrumentation can be compiled out with VALHALLA_NO_METRICS
+#define METRICS_CONCAT_INNER(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_INNER(a, b)
+#ifdef VALHALLA_NO_METRICS
+  #define METRICS_COUNT(counter, value)
+  #define METRICS_TIME(timer)
+  #define METRICS_SET(gauge, value)
+#else
+  #define METRICS_COUNT(counter, value) \
+    ::valhalla::midgard::metrics::Add(::valhalla::midgard::metrics::Counter::counter, value)
+  #define METRICS_TIME(timer) \
+    ::valhalla::midgard::metrics::ScopedTimer METRICS_CONCAT(metrics_timer_, __LINE__)(::valhalla::midgard::metrics::Timer::timer)
+  #define METRICS_SET(gauge, value) \
+    ::valhalla::midgard::metrics::Set(::valhalla::midgard::metrics::Gauge::gauge, value)
+#endif
+
+}
+
+}
+}
+
+#endif
@@ -18,10 +18,13 @@
 #include <cmath>
 #include <cstring>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cerrno>
 #include <stdexcept>
 #include <iostream>
+#include <queue>
+#include <thread>
 
 #ifdef _MSC_VER
 #include <io.h>
@@ -31,6 +34,7 @@
 #include <unistd.h>
 #endif // _MSC_VER
 #include <fcntl.h>
+#include <lz4.h>
 
 #ifdef _MSC_VER
 #define WIN32_LEAN_AND_MEAN 1
@@ -116,8 +120,8 @@ class mem_map {
   mem_map(): ptr(nullptr), count(0), file_name("") { }
 
   //construct with file
-  mem_map(const std::string& file_name, size_t size, int advice = POSIX_MADV_NORMAL): ptr(nullptr), count(0), file_name("") {
-    map(file_name, size, advice);
+  mem_map(const std::string& file_name, size_t size, int advice = POSIX_MADV_NORMAL, bool read_only = false): ptr(nullptr), count(0), file_name("") {
+    map(file_name, size, advice, read_only);
   }
 
   //unmap when done
@@ -125,8 +129,9 @@ class mem_map {
     unmap();
   }
 
-  //reset to another file or another size
-  void map(const std::string& new_file_name, size_t new_count, int advice = POSIX_MADV_NORMAL) {
+  //reset to another file or another size, read only maps can be shared by
+  //many processes but writing to them will segfault
+  void map(const std::string& new_file_name, size_t new_count, int advice = POSIX_MADV_NORMAL, bool read_only = false) {
     //just in case there was already something
     unmap();
 
@@ -134,13 +139,13 @@ class mem_map {
     if(new_count > 0) {
       auto fd =
 #if defined(_MSC_VER)
-        _open(new_file_name.c_str(), O_RDWR, 0);
+        _open(new_file_name.c_str(), read_only ? O_RDONLY : O_RDWR, 0);
 #else
-        open(new_file_name.c_str(), O_RDWR, 0);
+        open(new_file_name.c_str(), read_only ? O_RDONLY : O_RDWR, 0);
 #endif
       if(fd == -1)
         throw std::runtime_error(new_file_name + "(open): " + strerror(errno));
-      ptr = mmap(nullptr, new_count * sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ptr = mmap(nullptr, new_count * sizeof(T), read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
       if(ptr == MAP_FAILED)
         throw std::runtime_error(new_file_name + "(mmap): " + strerror(errno));
 
@@ -259,16 +264,65 @@ class sequence {
     return npos;
   }
 
-  //sort the file based on the predicate
-  void sort(const std::function<bool (const T&, const T&)>& predicate, size_t buffer_size = 1024 * 1024 * 512 / sizeof(T)) {
-    using queue_t = std::map<T, std::list<std::fstream>::iterator, std::function<bool (const T&, const T&)> >;
-
+  //sort the file based on the predicate. at most buffer_size elements are sorted in memory
+  //at a time, split across the threads. if the file is bigger than that each sorted run is
+  //spilled to a temporary file next to this one and then they are all merged back into it
+  void sort(const std::function<bool (const T&, const T&)>& predicate, size_t buffer_size = 1024 * 1024 * 512 / sizeof(T),
+            unsigned int threads = std::thread::hardware_concurrency()) {
     flush();
     //if no elements we are done
     if(memmap.size() == 0)
       return;
-    std::sort(static_cast<T*>(memmap), static_cast<T*>(memmap) + memmap.size(), predicate);
-    return;
+    buffer_size = std::max(buffer_size, static_cast<size_t>(1));
+    threads = std::max(threads, 1u);
+
+    //it fits so sort it where it is
+    T* data = static_cast<T*>(memmap);
+    if(memmap.size() <= buffer_size) {
+      sort_run(data, data + memmap.size(), predicate, threads);
+      return;
+    }
+
+    //sort it a run at a time and spill each one
+    std::vector<std::string> run_names;
+    {
+      std::vector<T> run;
+      run.reserve(buffer_size);
+      for(size_t start = 0; start < memmap.size(); start += buffer_size) {
+        run.assign(data + start, data + std::min(start + buffer_size, memmap.size()));
+        sort_run(run.data(), run.data() + run.size(), predicate, threads);
+        run_names.push_back(file_name + ".run" + std::to_string(run_names.size()));
+        std::ofstream out(run_names.back(), std::ios_base::binary | std::ios_base::trunc);
+        if(!out.write(static_cast<const char*>(static_cast<const void*>(run.data())), run.size() * sizeof(T)))
+          throw std::runtime_error(run_names.back() + ": " + strerror(errno));
+      }
+    }
+
+    //merge the runs back into the file, each run gets an equal share of the buffer to read with
+    std::vector<std::unique_ptr<run_reader> > runs;
+    for(const auto& run_name : run_names)
+      runs.emplace_back(new run_reader(run_name, std::max(buffer_size / run_names.size(), static_cast<size_t>(1))));
+    //a min heap on the predicate, ties go to the earlier run
+    using entry_t = std::pair<T, size_t>;
+    auto greater = [&predicate](const entry_t& a, const entry_t& b) {
+      return predicate(b.first, a.first) || (!predicate(a.first, b.first) && a.second > b.second);
+    };
+    std::priority_queue<entry_t, std::vector<entry_t>, decltype(greater)> queue(greater);
+    for(size_t i = 0; i < runs.size(); ++i) {
+      if(const T* element = runs[i]->next())
+        queue.emplace(*element, i);
+    }
+    size_t index = 0;
+    while(!queue.empty()) {
+      size_t run = queue.top().second;
+      data[index++] = queue.top().first;
+      queue.pop();
+      if(const T* element = runs[run]->next())
+        queue.emplace(*element, run);
+    }
+    runs.clear();
+    for(const auto& run_name : run_names)
+      std::remove(run_name.c_str());
   }
 
   //perform an volatile operation on all the items of this sequence
@@ -444,12 +498,404 @@ class sequence {
 
  protected:
 
+  //reads a sorted run back a buffer at a time
+  struct run_reader {
+    run_reader(const std::string& file_name, size_t buffer_size)
+      : file(file_name, std::ios_base::binary), buffer(buffer_size * sizeof(T)), position(0), count(0) {
+      if(!file)
+        throw std::runtime_error(file_name + ": " + strerror(errno));
+    }
+    //the next element of the run or null if there are no more
+    const T* next() {
+      if(position == count) {
+        file.read(buffer.data(), buffer.size());
+        count = file.gcount() / sizeof(T);
+        position = 0;
+        if(count == 0)
+          return nullptr;
+      }
+      return static_cast<const T*>(static_cast<const void*>(buffer.data())) + position++;
+    }
+    std::ifstream file;
+    std::vector<char> buffer;
+    size_t position, count;
+  };
+
+  //sort a range in memory by sorting a piece of it on each thread and then merging
+  //neighbouring pieces, also on their own threads, until there is only one
+  static void sort_run(T* begin, T* end, const std::function<bool (const T&, const T&)>& predicate,
+                       unsigned int threads) {
+    size_t count = end - begin;
+    threads = static_cast<unsigned int>(std::min(static_cast<size_t>(threads), count / 65536 + 1));
+    if(threads < 2) {
+      std::sort(begin, end, predicate);
+      return;
+    }
+
+    //where each piece starts
+    std::vector<T*> pieces;
+    for(unsigned int i = 0; i < threads; ++i)
+      pieces.push_back(begin + count * i / threads);
+    pieces.push_back(end);
+
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i + 1 < pieces.size(); ++i)
+      workers.emplace_back([&predicate, &pieces, i]() {
+        std::sort(pieces[i], pieces[i + 1], predicate);
+      });
+    for(auto& worker : workers)
+      worker.join();
+
+    //merge pairs of pieces until there is only the one
+    while(pieces.size() > 2) {
+      workers.clear();
+      std::vector<T*> merged;
+      for(size_t i = 0; i + 1 < pieces.size(); i += 2) {
+        merged.push_back(pieces[i]);
+        if(i + 2 < pieces.size())
+          workers.emplace_back([&predicate, &pieces, i]() {
+            std::inplace_merge(pieces[i], pieces[i + 1], pieces[i + 2], predicate);
+          });
+      }
+      merged.push_back(end);
+      for(auto& worker : workers)
+        worker.join();
+      pieces.swap(merged);
+    }
+  }
+
   std::shared_ptr<std::fstream> file;
   std::string file_name;
   std::vector<T> write_buffer;
   mem_map<T> memmap;
 };
 
+//a sequence that is written once and kept as lz4 compressed blocks of elements, with an index
+//of the blocks in a file of its own next to it. elements can be read in any order, a handful
+//of the most recently used blocks are kept decompressed, and enumerating or transforming all
+//of them streams through the blocks one at a time
+template <class T>
+class compressed_sequence {
+ public:
+  //static_assert(std::is_pod<T>::value, "compressed_sequence requires POD types for now");
+  static const size_t npos = -1;
+
+  compressed_sequence() = delete;
+
+  compressed_sequence(const compressed_sequence&) = delete;
+
+  compressed_sequence(const std::string& file_name, bool create = false, size_t block_size = 1024 * 64 / sizeof(T),
+                      size_t cache_size = 64):
+    file(new std::fstream(file_name, std::ios_base::binary | std::ios_base::in | std::ios_base::out | (create ? std::ios_base::trunc : std::ios_base::ate))),
+    file_name(file_name), block_size(block_size ? block_size : 1), cache_size(cache_size ? cache_size : 1), count(0) {
+
+    //crack open the file
+    if(!*file)
+      throw std::runtime_error(file_name + ": " + strerror(errno));
+    write_buffer.reserve(this->block_size);
+
+    //read the index of the blocks, unless we are starting over
+    std::ifstream index_file(index_name(), std::ios_base::binary);
+    if(!create && index_file) {
+      block_t block;
+      while(index_file.read(static_cast<char*>(static_cast<void*>(&block)), sizeof(block)))
+        add_block(block);
+      if(blocks.size() && blocks.back().offset + blocks.back().size != static_cast<uint64_t>(file->tellg()))
+        throw std::runtime_error("This file doesn't match its block index");
+    }
+    else {
+      if(!create && file->tellg() != std::streampos(0))
+        throw std::runtime_error(file_name + ": missing block index");
+      std::ofstream(index_name(), std::ios_base::binary | std::ios_base::trunc);
+    }
+  }
+
+  ~compressed_sequence() {
+    //finish writing whatever it was to file
+    flush();
+  }
+
+  //add an element to the sequence
+  void push_back(const T& obj) {
+    write_buffer.push_back(obj);
+    //compress it to the file
+    if(write_buffer.size() == block_size)
+      flush();
+  }
+
+  //force compressing whatever we have in the write_buffer to the file as a block
+  void flush() {
+    if(write_buffer.empty())
+      return;
+    int bound = LZ4_compressBound(write_buffer.size() * sizeof(T));
+    compressed.resize(bound);
+    int size = LZ4_compress_default(static_cast<const char*>(static_cast<const void*>(write_buffer.data())),
+                                    compressed.data(), write_buffer.size() * sizeof(T), bound);
+    if(size <= 0)
+      throw std::runtime_error(file_name + ": failed to compress block");
+    file->seekp(0, file->end);
+    block_t block{static_cast<uint64_t>(file->tellp()), static_cast<uint32_t>(size),
+                  static_cast<uint32_t>(write_buffer.size())};
+    file->write(compressed.data(), size);
+    file->flush();
+    std::ofstream index_file(index_name(), std::ios_base::binary | std::ios_base::app);
+    if(!*file || !index_file.write(static_cast<const char*>(static_cast<const void*>(&block)), sizeof(block)))
+      throw std::runtime_error(file_name + ": " + strerror(errno));
+    add_block(block);
+    write_buffer.clear();
+  }
+
+  //how many things have been written so far
+  size_t size() const {
+    return count + write_buffer.size();
+  }
+
+  //perform a non-volatile operation on all the items of this sequence
+  void enumerate(const std::function<void (const T&)>& predicate) {
+    flush();
+    std::vector<char> data;
+    for(size_t b = 0; b < blocks.size(); ++b) {
+      read_block(b, data);
+      const T* elements = static_cast<const T*>(static_cast<const void*>(data.data()));
+      for(uint32_t i = 0; i < blocks[b].count; ++i)
+        predicate(elements[i]);
+    }
+  }
+
+  //sort the file based on the predicate. the elements are decompressed to a temporary
+  //sequence next to this one which is sorted and then compressed back into this one
+  void sort(const std::function<bool (const T&, const T&)>& predicate, size_t buffer_size = 1024 * 1024 * 512 / sizeof(T),
+            unsigned int threads = std::thread::hardware_concurrency()) {
+    flush();
+    const std::string sort_name = file_name + ".sort";
+    {
+      sequence<T> sorted(sort_name, true);
+      enumerate([&sorted](const T& element) { sorted.push_back(element); });
+      sorted.sort(predicate, buffer_size, threads);
+      clear();
+      sorted.enumerate([this](const T& element) { push_back(element); });
+    }
+    flush();
+    std::remove(sort_name.c_str());
+  }
+
+  //perform an volatile operation on all the items of this sequence, the blocks
+  //are compressed again to a new file which then replaces this one
+  void transform(const std::function<void (T&)>& predicate) {
+    flush();
+    std::vector<block_t> old_blocks;
+    old_blocks.swap(blocks);
+    std::vector<size_t>().swap(block_starts);
+    recent.clear();
+    cache.clear();
+    count = 0;
+    auto old_file = file;
+    file.reset(new std::fstream(file_name + ".tmp", std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::trunc));
+    std::ofstream(index_name(), std::ios_base::binary | std::ios_base::trunc);
+    std::vector<char> data;
+    for(const auto& block : old_blocks) {
+      read_block(*old_file, block, data);
+      T* elements = static_cast<T*>(static_cast<void*>(data.data()));
+      for(uint32_t i = 0; i < block.count; ++i) {
+        predicate(elements[i]);
+        write_buffer.push_back(elements[i]);
+      }
+      //keep the blocks as they were
+      flush();
+    }
+    old_file.reset();
+    file.reset();
+    if(std::rename((file_name + ".tmp").c_str(), file_name.c_str()))
+      throw std::runtime_error(file_name + "(rename): " + strerror(errno));
+    file.reset(new std::fstream(file_name, std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::ate));
+  }
+
+  //a read only view of an element within the sequence, read through the cache of blocks
+  struct iterator {
+    friend class compressed_sequence;
+   public:
+    iterator() = delete;
+    operator T() {
+      return parent->get(index);
+    }
+    T operator*() {
+      return operator T();
+    }
+    iterator& operator++() {
+      ++index;
+      return *this;
+    }
+    iterator operator++(int) {
+      auto other = *this;
+      ++index;
+      return other;
+    }
+    iterator operator+(size_t offset) {
+      auto other = *this;
+      other.index += offset;
+      return other;
+    }
+    iterator& operator--() {
+      --index;
+      return *this;
+    }
+    iterator operator-(size_t offset) {
+      auto other = *this;
+      other.index -= offset;
+      return other;
+    }
+    bool operator==(const iterator& other) const {
+      return parent == other.parent && index == other.index;
+    }
+    bool operator!=(const iterator& other) const {
+      return index != other.index || parent != other.parent;
+    }
+    size_t operator-(const iterator& other) const {
+      return index - other.index;
+    }
+    size_t position() const {
+      return index;
+    }
+   protected:
+    iterator(compressed_sequence* base, size_t offset): parent(base), index(offset) {}
+    compressed_sequence* parent;
+    size_t index;
+  };
+
+  //search for an object using binary search O(logn)
+  //assumes the file was written in sorted order
+  //the predicate should be something like a less than or greater than check
+  iterator find(const T& target, const std::function<bool (const T&, const T&)>& predicate) {
+    flush();
+    size_t low = 0, high = count;
+    while(low < high) {
+      size_t middle = low + (high - low) / 2;
+      if(predicate(get(middle), target))
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    if(low < count && !predicate(target, get(low)))
+      return at(low);
+    return end();
+  }
+
+  iterator at(size_t index) {
+    flush();
+    return iterator(this, index);
+  }
+
+  //read at certain index
+  iterator operator[](size_t index) {
+    return at(index);
+  }
+
+  //read at the beginning
+  T front() {
+    return *at(0);
+  }
+
+  //read at the end
+  T back() {
+    flush();
+    return get(count - 1);
+  }
+
+  //first iterator
+  iterator begin() {
+    return at(0);
+  }
+
+  //invalid end iterator
+  iterator end() {
+    flush();
+    return iterator(this, count);
+  }
+
+ protected:
+
+  //where a block is in the file and how many elements it has
+  struct block_t {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t count;
+  };
+
+  std::string index_name() const {
+    return file_name + ".idx";
+  }
+
+  void add_block(const block_t& block) {
+    blocks.push_back(block);
+    block_starts.push_back(count);
+    count += block.count;
+  }
+
+  void read_block(std::fstream& from, const block_t& block, std::vector<char>& data) {
+    compressed.resize(block.size);
+    data.resize(block.count * sizeof(T));
+    from.seekg(block.offset);
+    if(!from.read(compressed.data(), block.size))
+      throw std::runtime_error(file_name + ": unable to read block");
+    if(LZ4_decompress_safe(compressed.data(), data.data(), block.size, data.size()) != static_cast<int>(data.size()))
+      throw std::runtime_error(file_name + ": corrupt block");
+  }
+
+  void read_block(size_t b, std::vector<char>& data) {
+    read_block(*file, blocks[b], data);
+  }
+
+  //start over with an empty file and index
+  void clear() {
+    file.reset(new std::fstream(file_name, std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::trunc));
+    if(!*file)
+      throw std::runtime_error(file_name + ": " + strerror(errno));
+    std::ofstream(index_name(), std::ios_base::binary | std::ios_base::trunc);
+    std::vector<block_t>().swap(blocks);
+    std::vector<size_t>().swap(block_starts);
+    recent.clear();
+    cache.clear();
+    count = 0;
+  }
+
+  //the element at the index, decompressing its block if it isnt cached
+  T get(size_t index) {
+    if(index >= count)
+      throw std::runtime_error(file_name + ": index " + std::to_string(index) + " is out of range");
+    size_t b = std::upper_bound(block_starts.begin(), block_starts.end(), index) - block_starts.begin() - 1;
+    auto cached = cache.find(b);
+    if(cached == cache.end()) {
+      //make room by dropping the least recently used block
+      std::vector<char> data;
+      if(cache.size() >= cache_size) {
+        auto evicted = cache.find(recent.back());
+        data.swap(evicted->second.first);
+        cache.erase(evicted);
+        recent.pop_back();
+      }
+      read_block(b, data);
+      recent.push_front(b);
+      cached = cache.emplace(b, std::make_pair(std::move(data), recent.begin())).first;
+    }
+    else if(cached->second.second != recent.begin()) {
+      recent.splice(recent.begin(), recent, cached->second.second);
+    }
+    return *(static_cast<const T*>(static_cast<const void*>(cached->second.first.data())) + (index - block_starts[b]));
+  }
+
+  std::shared_ptr<std::fstream> file;
+  std::string file_name;
+  size_t block_size;
+  size_t cache_size;
+  size_t count;
+  std::vector<T> write_buffer;
+  std::vector<char> compressed;
+  std::vector<block_t> blocks;
+  std::vector<size_t> block_starts;
+  std::list<size_t> recent;
+  std::unordered_map<size_t, std::pair<std::vector<char>, std::list<size_t>::iterator> > cache;
+};
+
 struct tar {
   struct header_t {
     char name[100]; char mode[8]; char uid[8]; char gid[8]; char size[12]; char mtime[12]; char chksum[8];
@@ -490,12 +936,18 @@ struct tar {
 
   };
 
-  tar(const std::string& tar_file, bool regular_files_only = true):tar_file(tar_file),corrupt_blocks(0) {
+  tar(const std::string& tar_file, bool regular_files_only = true, bool traverse = true):tar_file(tar_file),corrupt_blocks(0) {
     //map the file
     struct stat s;
     if(stat(tar_file.c_str(), &s) || s.st_size == 0 || (s.st_size % sizeof(header_t)) != 0)
       return;
     try { mm.map(tar_file, s.st_size); } catch (...) { return; }
+    //the caller may know where things are without looking at every header
+    if(traverse)
+      read_contents(regular_files_only);
+  }
+
+  void read_contents(bool regular_files_only = true) {
     //rip through the tar to see whats in it noting that most tars end with 2 empty blocks
     //but we can concatenate tars and get empty blocks in between so we'll just be pretty
     //lax about it and we'll count the ones we cant make sense of
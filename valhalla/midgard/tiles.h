@@ -293,6 +293,16 @@ class Tiles {
   template <class container_t>
   std::unordered_map<int32_t, std::unordered_set<unsigned short> > Intersect(const container_t& linestring) const;
 
+  /**
+   * Intersect the linestring with the tiles like above but keep the intersected sub cells in a
+   * flat list which can be reused from one linestring to the next so nothing is allocated per tile
+   * @param line_string  the linestring to be tested against the cells
+   * @param cells        cleared then filled with the pairs of tile and sub cell index intersected,
+   *                     sorted by tile then sub cell and without duplicates
+   */
+  template <class container_t>
+  void Intersect(const container_t& linestring, std::vector<std::pair<int32_t, unsigned short> >& cells) const;
+
   /**
    * Intersect the bounding box with the tiles to see which tiles and sub-cells
    * (a.k.a bins) it intersects with. This can be used to reduce the number of
@@ -0,0 +1,89 @@
+#ifndef VALHALLA_MIDGARD_TRACING_H_
+#define VALHALLA_MIDGARD_TRACING_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace valhalla {
+namespace midgard {
+
+namespace tracing {
+
+//a timed piece of the work on a traced request, times are in microseconds since the epoch
+struct span_t {
+  std::string name;
+  uint64_t id;
+  uint64_t parent;
+  uint64_t start;
+  uint64_t end;
+};
+
+//the spans the calling thread recorded for a traced request. ids follow w3c trace context
+//(and so opentelemetry): 32 lowercase hex digits for the trace and a non zero 64 bit span id
+struct trace_t {
+  std::string id;
+  uint64_t parent = 0; //the span new spans are children of
+  std::vector<span_t> spans;
+};
+
+//the trace of the calling thread, null unless the request it is working on is traced
+trace_t* current();
+
+//records the spans of the calling thread into a trace for as long as it is in scope
+class ScopedTrace {
+ public:
+  ScopedTrace(trace_t& trace);
+  ~ScopedTrace();
+  ScopedTrace(const ScopedTrace&) = delete;
+  ScopedTrace& operator=(const ScopedTrace&) = delete;
+ protected:
+  trace_t* previous;
+};
+
+//records a span between its construction and destruction if the calling thread is tracing,
+//the spans started in the meantime are its children. a pointer check when it isn't
+class ScopedSpan {
+ public:
+  ScopedSpan(const char* name) : trace(current()) {
+    if(trace)
+      begin(name);
+  }
+  ~ScopedSpan() {
+    if(trace)
+      end();
+  }
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+ protected:
+  void begin(const char* name);
+  void end();
+  trace_t* trace;
+  size_t index;
+  uint64_t parent;
+};
+
+//microseconds since the epoch
+uint64_t now();
+
+//a new random trace id
+std::string new_trace_id();
+
+//a new random span id, never 0
+uint64_t new_span_id();
+
+//a span id as the 16 lowercase hex digits of w3c trace context
+std::string to_hex(uint64_t span_id);
+
+//parse 16 hex digits into a span id, 0 if they aren't
+uint64_t from_hex(const std::string& span_id);
+
+//a span of a trace as a json object, in the field names of opentelemetry's json encoding
+std::string to_json(const trace_t& trace, const span_t& span);
+
+}
+
+}
+}
+
+#endif
@@ -377,6 +377,24 @@ T clamp(T value, T lower, T upper) {
 template<class container_t>
 container_t resample_spherical_polyline(const container_t& polyline, double resolution, bool preserve = false);
 
+/**
+ * Resample a polyline in spherical coordinates like the above, into a vector that can be reused
+ * between calls. The arc length of each segment is found once up front, which also tells how many
+ * points there will be so the output is sized once (with room for one more, callers often add the
+ * last point). The points placed along a segment are interpolated between the unit vectors of its
+ * ends with the sines of their offsets stepped along, so only converting them back to lat,lon costs
+ * any trigonometry. Vectors of PointLL given to the above are resampled with this.
+ * @param polyline     the points in the line
+ * @param resolution   maximum distance between any two points in the resampled line
+ * @param resampled    the resampled line, anything in it is replaced
+ * @param preserve     keep input points in resampled line or not
+ */
+void resample_spherical_polyline(const std::vector<PointLL>& polyline, double resolution,
+                                 std::vector<PointLL>& resampled, bool preserve = false);
+template <>
+std::vector<PointLL> resample_spherical_polyline<std::vector<PointLL> >(const std::vector<PointLL>& polyline,
+                                                                       double resolution, bool preserve);
+
 /**
  * A class to wrap a primitive array in something iterable which is useful for loops mostly
  * Basically if you dont have a vector or list, this makes your array a bit more usable in
@@ -390,10 +408,11 @@ struct iterable_t {
   using iterator = T*;
   iterable_t(T* first, size_t size): head(first), tail(first + size), count(size){}
   iterable_t(T* first, T* end): head(first), tail(end), count(end - first){}
-  T* begin() { return head; }
-  T* end() { return tail; }
-  T& operator[](size_t index){ return *(head + index); }
+  T* begin() const { return head; }
+  T* end() const { return tail; }
+  T& operator[](size_t index) const { return *(head + index); }
   size_t size() const { return count; }
+  bool empty() const { return count == 0; }
  protected:
   T* head;
   T* tail;
@@ -445,6 +464,19 @@ typename coord_t::first_type x_intercept(const coord_t& u, const coord_t& v, con
 template <class container_t>
 float polygon_area(const container_t& polygon);
 
+/**
+ * Distance along a hilbert curve through the cells of a square grid with 2^order
+ * cells on a side. Cells that are close along the curve are close in the grid,
+ * so sorting things by it keeps what is near each other in space near each
+ * other in memory.
+ *
+ * @param order  order of the curve, at most 16
+ * @param x      column of the cell, less than 2^order
+ * @param y      row of the cell, less than 2^order
+ * @return the index of the cell along the curve
+ */
+uint32_t hilbert_index(const uint32_t order, uint32_t x, uint32_t y);
+
 template <typename T>
 struct ring_queue_t {
   ring_queue_t(size_t limit):limit(limit), i(0) {
@@ -4,16 +4,14 @@
 #include <cstdint>
 #include <valhalla/midgard/aabb2.h>
 #include <valhalla/midgard/pointll.h>
+#include <valhalla/midgard/sequence.h>
 #include <valhalla/baldr/graphconstants.h>
-#include <boost/geometry.hpp>
-#include <boost/geometry/geometries/point_xy.hpp>
-#include <boost/geometry/geometries/polygon.hpp>
-#include <boost/geometry/multi/geometries/multi_polygon.hpp>
 #include <boost/geometry/io/wkt/wkt.hpp>
 #include <sqlite3.h>
 #include <unordered_map>
 
 #include <valhalla/mjolnir/graphtilebuilder.h>
+#include <valhalla/mjolnir/polygonindex.h>
 
 using namespace valhalla::baldr;
 using namespace valhalla::midgard;
@@ -21,11 +19,6 @@ using namespace valhalla::midgard;
 namespace valhalla {
 namespace mjolnir {
 
-// Geometry types for admin queries
-typedef boost::geometry::model::d2::point_xy<double> point_type;
-typedef boost::geometry::model::polygon<point_type> polygon_type;
-typedef boost::geometry::model::multi_polygon<polygon_type> multi_polygon_type;
-
 /**
  * Get the dbhandle of a sqlite db.  Used for timezones and admins DBs.
  * @param  database   db file location.
@@ -60,6 +53,71 @@ std::unordered_map<uint32_t,multi_polygon_type> GetAdminInfo(sqlite3 *db_handle,
                                                              const AABB2<PointLL>& aabb,
                                                              GraphTileBuilder& tilebuilder);
 
+/**
+ * Admin areas packed into a flat file, an alternative to querying the admin
+ * db for each tile. The file is memory mapped read only so all the threads
+ * building tiles share one copy of it and need no SQLite connection. It
+ * holds the states, with the names and iso codes of their countries, and
+ * the countries, each with its bounding box and the rings of its polygons.
+ */
+class PackedAdmins {
+ public:
+  /**
+   * Constructor. Maps the packed admin file.
+   * @param  file_name   Packed admin file written by Write.
+   */
+  PackedAdmins(const std::string& file_name);
+
+  /**
+   * Get the admin polys that intersect with the tile bounding box. Like the
+   * db query these are the states or, if no state does, the countries.
+   * @param  drive_on_right   unordered map that indicates if a country drives on right side of the road
+   * @param  aabb             bb of the tile
+   * @param  tilebuilder      Graph tile builder
+   */
+  std::unordered_map<uint32_t,multi_polygon_type> GetAdminInfo(std::unordered_map<uint32_t, bool>& drive_on_right,
+                                                               const AABB2<PointLL>& aabb,
+                                                               GraphTileBuilder& tilebuilder) const;
+
+  /**
+   * Get the number of admin areas in the file.
+   * @return Returns the number of states and countries.
+   */
+  size_t size() const;
+
+  /**
+   * Pack the states and countries of an admin db into a file.
+   * @param  db_handle    sqlite3 db handle of a built admin db
+   * @param  file_name    Packed admin file to write.
+   * @return Returns the number of admin areas written.
+   */
+  static uint32_t Write(sqlite3 *db_handle, const std::string& file_name);
+
+ protected:
+  struct Header;
+  struct Admin;
+  struct Ring;
+
+  // Get the polygons of an admin area
+  multi_polygon_type GetPolygons(const Admin& admin) const;
+
+  // Get a string from the string blob
+  std::string GetString(const uint32_t offset) const;
+
+  // Find the admins of a level that intersect the bounding box and add them
+  void AddAdmins(const uint32_t admin_level, const AABB2<PointLL>& aabb,
+                 std::unordered_map<uint32_t, bool>& drive_on_right,
+                 GraphTileBuilder& tilebuilder,
+                 std::unordered_map<uint32_t,multi_polygon_type>& polys) const;
+
+  midgard::mem_map<char> file_;
+  const Header* header_;
+  const Admin* admins_;
+  const Ring* rings_;
+  const double* points_;
+  const char* strings_;
+};
+
 /**
  * Get all the country access records from the db and save them to a map.
  * @param  db_handle    sqlite3 db handle
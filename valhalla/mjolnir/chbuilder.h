@@ -0,0 +1,99 @@
+#ifndef VALHALLA_MJOLNIR_CHBUILDER_H
+#define VALHALLA_MJOLNIR_CHBUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/chgraph.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/sif/dynamiccost.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+// Maximum number of nodes a witness search settles before it gives up and
+// a shortcut is added
+constexpr uint32_t kDefaultCHWitnessLimit = 500;
+
+/**
+ * Class used to build the contraction hierarchy overlay of a costing.
+ */
+class CHBuilder {
+ public:
+  /**
+   * A turn from one node of the hierarchy (directed edge) onto the next.
+   */
+  struct Turn {
+    uint32_t from;  // Node turned from
+    uint32_t to;    // Node turned onto
+    float cost;     // Cost of the turn plus the edge turned onto
+    float secs;     // Elapsed time of the turn plus the edge turned onto
+    float length;   // Length of the edge turned onto
+  };
+
+  /**
+   * Build the contraction hierarchy for a costing from the tiles in the
+   * mjolnir tile_dir and write it next to them. The costing is created with
+   * its default options, which are the options the hierarchy is used for.
+   * @param  pt       Configuration
+   * @param  costing  Name of the costing
+   */
+  static void Build(const boost::property_tree::ptree& pt, const std::string& costing);
+
+  /**
+   * Build the contraction hierarchy of the routing graph for a costing.
+   * @param  reader        Graph reader for the tiles to contract
+   * @param  costing       Costing to weight the turns with
+   * @param  costing_name  Name of the costing
+   * @param  witness_limit Maximum nodes settled by a witness search
+   * @return Returns the hierarchy
+   */
+  static baldr::CHGraph Contract(baldr::GraphReader& reader,
+                                 const sif::cost_ptr_t& costing,
+                                 const std::string& costing_name,
+                                 const uint32_t witness_limit = kDefaultCHWitnessLimit);
+
+  /**
+   * Find the turns of the routing graph for a costing, between the directed
+   * edges it may use.
+   * @param  reader        Graph reader for the tiles
+   * @param  costing       Costing to weight the turns with
+   * @param  costing_name  Name of the costing
+   * @param  edges         Filled with the directed edges, sorted by id, the
+   *                       turns being between their indices
+   * @param  bounds        Only take the edges of the tiles this intersects,
+   *                       all of them if null
+   * @param  only_level    Only take the edges of this hierarchy level, those
+   *                       of every level if negative
+   * @return Returns the turns
+   */
+  static std::vector<Turn> Turns(baldr::GraphReader& reader,
+                                 const sif::cost_ptr_t& costing,
+                                 const std::string& costing_name,
+                                 std::vector<baldr::GraphId>& edges,
+                                 const midgard::AABB2<midgard::PointLL>* bounds = nullptr,
+                                 const int only_level = -1);
+
+  /**
+   * Contract a graph given as a list of turns.
+   * @param  costing_name  Name of the costing
+   * @param  edges         Directed edge of each node, sorted by id
+   * @param  turns         Turns between the nodes
+   * @param  witness_limit Maximum nodes settled by a witness search
+   * @return Returns the hierarchy
+   */
+  static baldr::CHGraph Contract(const std::string& costing_name,
+                                 std::vector<baldr::GraphId>&& edges,
+                                 const std::vector<Turn>& turns,
+                                 const uint32_t witness_limit = kDefaultCHWitnessLimit);
+};
+
+}
+}
+
+#endif  // VALHALLA_MJOLNIR_CHBUILDER_H
@@ -33,6 +33,22 @@ class ComplexRestrictionBuilder {
    */
   void set_to_id(const GraphId to_id);
 
+  /**
+   * Get the from edge id.
+   * @return  Returns the from id.
+   */
+  GraphId from_id() const {
+    return from_id_;
+  }
+
+  /**
+   * Get the to edge id.
+   * @return  Returns the to id.
+   */
+  GraphId to_id() const {
+    return to_id_;
+  }
+
   /**
    * set the vias for this restriction
    * @param  via_list  via list.
@@ -55,6 +55,14 @@ class EdgeInfoBuilder {
    */
   void set_encoded_shape(const std::string& encoded_shape);
 
+  /**
+   * Get the encoded shape string.
+   * @return  Returns the encoded shape string.
+   */
+  const std::string& encoded_shape() const {
+    return encoded_shape_;
+  }
+
   /**
    * Get the size of this edge info (without padding).
    * @return  Returns the size in bytes of this object.
@@ -68,6 +76,12 @@ class EdgeInfoBuilder {
    */
   std::size_t SizeOf() const;
 
+  /**
+   * Append the bytes of this edge info, including padding, to a buffer.
+   * @param  buffer  Buffer the edge info is appended to.
+   */
+  void AppendTo(std::string& buffer) const;
+
  protected:
 
   // OSM Way Id
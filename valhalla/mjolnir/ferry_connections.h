@@ -65,7 +65,7 @@ struct NodeStatusInfo {
  * @param  edges The file backed list of edges in the graph.
  * @return  Returns the best (most important) classification
  */
-uint32_t GetBestNonFerryClass(const std::map<Edge, size_t>& edges);
+uint32_t GetBestNonFerryClass(const node_edges_t& edges);
 
 /**
  * Form the shortest path from the start node until a node that
@@ -73,7 +73,7 @@ uint32_t GetBestNonFerryClass(const std::map<Edge, size_t>& edges);
  */
 uint32_t ShortestPath(const uint32_t start_node_idx,
                       const uint32_t node_idx,
-                      sequence<OSMWay>& ways,
+                      compressed_sequence<OSMWay>& ways,
                       sequence<OSMWayNode>& way_nodes,
                       sequence<Edge>& edges,
                       sequence<Node>& nodes,
@@ -86,18 +86,21 @@ uint32_t ShortestPath(const uint32_t start_node_idx,
  */
 bool ShortFerry(const uint32_t node_index, node_bundle& bundle,
                 sequence<Edge>& edges, sequence<Node>& nodes,
-                sequence<OSMWay>& ways,
+                compressed_sequence<OSMWay>& ways,
                 sequence<OSMWayNode>& way_nodes);
 
 /**
  * Reclassify edges from a ferry along the shortest path to the
- * specified road classification.
+ * specified road classification. The nodes where ferries connect to
+ * roads are found on the given number of threads, the paths from them
+ * are then formed in order on the calling thread.
  */
 void ReclassifyFerryConnections(const std::string& ways_file,
                                 const std::string& way_nodes_file,
                                 const std::string& nodes_file,
                                 const std::string& edges_file,
-                                const uint32_t rc, DataQuality& stats);
+                                const uint32_t rc, DataQuality& stats,
+                                const unsigned int threads);
 
 }
 }
@@ -0,0 +1,68 @@
+#ifndef VALHALLA_MJOLNIR_FLATGRAPHBUILDER_H
+#define VALHALLA_MJOLNIR_FLATGRAPHBUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/flatgraph.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/mjolnir/chbuilder.h>
+#include <valhalla/sif/dynamiccost.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to flatten a region of the routing graph for a costing into a
+ * flat graph snapshot.
+ */
+class FlatGraphBuilder {
+ public:
+  /**
+   * Flatten a region of the tiles in the mjolnir tile_dir for a costing and
+   * write it to a file. The costing is created with its default options.
+   * @param  pt         Configuration
+   * @param  costing    Name of the costing
+   * @param  bounds     Region to flatten, the tiles it intersects are taken
+   * @param  file_name  File to write, the costing's file in the tile_dir if
+   *                    empty
+   */
+  static void Build(const boost::property_tree::ptree& pt, const std::string& costing,
+                    const midgard::AABB2<midgard::PointLL>& bounds,
+                    const std::string& file_name = "");
+
+  /**
+   * Flatten a region of the routing graph for a costing.
+   * @param  reader        Graph reader for the tiles
+   * @param  costing       Costing to weight the turns with
+   * @param  costing_name  Name of the costing
+   * @param  bounds        Region to flatten
+   * @return Returns the flat graph
+   */
+  static baldr::FlatGraph Flatten(baldr::GraphReader& reader, const sif::cost_ptr_t& costing,
+                                  const std::string& costing_name,
+                                  const midgard::AABB2<midgard::PointLL>& bounds);
+
+  /**
+   * Flatten a graph given as a list of turns.
+   * @param  costing_name  Name of the costing
+   * @param  bounds        Region the graph covers
+   * @param  edges         Directed edge of each node, sorted by id
+   * @param  turns         Turns between the nodes
+   * @return Returns the flat graph
+   */
+  static baldr::FlatGraph Flatten(const std::string& costing_name,
+                                  const midgard::AABB2<midgard::PointLL>& bounds,
+                                  std::vector<baldr::GraphId>&& edges,
+                                  const std::vector<CHBuilder::Turn>& turns);
+};
+
+}
+}
+
+#endif  // VALHALLA_MJOLNIR_FLATGRAPHBUILDER_H
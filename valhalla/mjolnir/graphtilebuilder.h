@@ -62,6 +62,13 @@ class GraphTileBuilder : public baldr::GraphTile {
    */
   void StoreTileData();
 
+  /**
+   * Output the tile to file under another tile directory than the one it
+   * was read from. Stores as binary data.
+   * @param  tile_dir  Tile directory to write the tile to.
+   */
+  void StoreTileData(const std::string& tile_dir);
+
   /**
    * Update a graph tile with new nodes and directed edges. Assumes no new
    * nodes or edges are added. Attributes within existing nodes and edges
@@ -135,6 +142,16 @@ class GraphTileBuilder : public baldr::GraphTile {
    * @param  lc  Lane connectivity information.
    */
   void AddLaneConnectivity(const std::vector<baldr::LaneConnectivity>& lc);
+
+  /**
+   * Add the base edges a shortcut edge was formed from. Shortcuts have to be
+   * added in the order of their directed edge index.
+   * @param  idx         Directed edge index of the shortcut.
+   * @param  base_edges  Base edges in the order they are traversed.
+   */
+  void AddShortcutBaseEdges(const uint32_t idx,
+                            const std::vector<baldr::GraphId>& base_edges);
+
   /**
    * Update all of the complex restrictions.
    * @param  complex_restriction_builder  list of complex restrictions.
@@ -346,6 +363,40 @@ class GraphTileBuilder : public baldr::GraphTile {
                       const GraphTile* tile,
                       const std::array<std::vector<GraphId>, kBinCount>& more_bins);
 
+  /**
+   * Sets the historical speed profiles of the directed edges of a tile,
+   * replacing any it already has. Only modifies the header to reflect the
+   * new size, everything else is copied directly without ever looking at it
+   * @param tile_dir   Base tile directory
+   * @param tile       the tile that needs the speed profiles
+   * @param profiles   the speed profiles of the tile
+   * @param index      the profile of each directed edge, an index into
+   *                   profiles starting from 1 or kNoSpeedProfile if it has none
+   */
+  static void AddSpeedProfiles(const std::string& tile_dir,
+                               const GraphTile* tile,
+                               const std::vector<SpeedProfile>& profiles,
+                               const std::vector<uint16_t>& index);
+
+  /**
+   * Adds the shapes of the edge infos of a finished tile as fixed point
+   * integers, so they can be read without decoding them, replacing any the
+   * tile already has. Only modifies the header to reflect the new size,
+   * everything else is copied directly without ever looking at it. Storing
+   * the tile again drops them.
+   * @param tile_dir   Base tile directory
+   * @param tile       the tile that needs the fixed point shapes
+   */
+  static void AddFixedShapes(const std::string& tile_dir, const GraphTile* tile);
+
+  /**
+   * Replaces the header of a tile on disk, the rest of the tile is left as
+   * it is. The header must only differ in fields that don't move any data.
+   * @param tile_dir   Base tile directory
+   * @param header     the new header of the tile with the graph id of the header
+   */
+  static void UpdateHeader(const std::string& tile_dir, const GraphTileHeader& header);
+
   /**
    * Initialize traffic segment association. Sizes the traffic segment
    * association list and sets them all to Invalid.
@@ -418,6 +469,18 @@ class GraphTileBuilder : public baldr::GraphTile {
   // Write all reverse complex restriction items to specified stream
   void SerializeComplexRestrictionsReverseToOstream(std::ostream& out) const;
 
+  // Bounding boxes of the shapes of the directed edges. Index with directed
+  // edge Id.
+  std::vector<EdgeBBox> EdgeBBoxes() const;
+
+  // Find the offset of a name already in the text list, returns false if
+  // it isn't there yet
+  bool FindName(const std::string& name, const size_t hash, uint32_t& offset) const;
+
+  // Put a name with the given hash at the end of the text list and return
+  // its offset
+  uint32_t AppendName(const std::string& name, const size_t hash);
+
   // Write all edgeinfo items to specified stream
   void SerializeEdgeInfosToOstream(std::ostream& out) const;
 
@@ -479,15 +542,17 @@ class GraphTileBuilder : public baldr::GraphTile {
   size_t edge_info_offset_ = 0;
   std::unordered_map<edge_tuple, size_t, EdgeTupleHasher> edge_offset_map_;
 
-  // The edgeinfo list
-  std::list<EdgeInfoBuilder> edgeinfo_list_;
+  // The edge info, serialized one after the other as it is added so
+  // building a tile doesn't allocate for each edge info
+  std::string edgeinfo_buffer_;
 
-  // Text list offset and map
+  // Text list offset and the offsets of the names by the hash of the name.
+  // Names are compared against the text list so they aren't stored twice
   uint32_t text_list_offset_ = 0;
-  std::unordered_map<std::string, uint32_t> text_offset_map_;
+  std::unordered_multimap<size_t, uint32_t> text_offset_map_;
 
-  // Text list. List of names used within this tile
-  std::list<std::string> textlistbuilder_;
+  // Text list. Names used within this tile, each one null terminated
+  std::string textlist_buffer_;
 
   // Traffic segment association
   std::vector<baldr::TrafficAssociation> traffic_segment_builder_;
@@ -501,6 +566,14 @@ class GraphTileBuilder : public baldr::GraphTile {
   // List of edge elevation records. Index with directed edge Id.
   std::vector<EdgeElevation> edge_elevation_builder_;
 
+  // Historical speed profiles and the profile of each directed edge.
+  std::vector<SpeedProfile> speed_profile_builder_;
+  std::vector<uint16_t> speed_profile_index_builder_;
+
+  // Where the base edges of each shortcut edge start and the base edges.
+  std::vector<ShortcutEdgesIndex> shortcut_edges_index_builder_;
+  std::vector<baldr::GraphId> shortcut_base_edges_builder_;
+
   // lane connectivity list offset
   uint32_t lane_connectivity_offset_ = 0;
 };
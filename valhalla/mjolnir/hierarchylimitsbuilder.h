@@ -0,0 +1,51 @@
+#ifndef VALHALLA_MJOLNIR_HIERARCHYLIMITSBUILDER_H
+#define VALHALLA_MJOLNIR_HIERARCHYLIMITSBUILDER_H
+
+#include <cstdint>
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to learn how far the path algorithms should expand each
+ * hierarchy level near a location. The road density and how many of the
+ * nodes lead to the level above are measured around every tile and turned
+ * into factors the default hierarchy limits are scaled with, which are kept
+ * in the tile header.
+ */
+class HierarchyLimitsBuilder {
+ public:
+  /**
+   * Measure the tiles and set the hierarchy limits factors in their headers.
+   * Runs on the finished graph, after the graph validator has set the
+   * tile densities.
+   * @param  pt  Property tree containing the mjolnir configuration
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+
+  /**
+   * Get the factor for the distance within which a level is always
+   * expanded. Sparse regions get a larger distance since the roads that
+   * reach the destination are further apart, dense ones a smaller one.
+   * @param  density  Mean relative density around the tile (0-15)
+   * @return Returns the factor
+   */
+  static float ExpansionWithinFactor(const float density);
+
+  /**
+   * Get the factor for the maximum number of upward transitions from a
+   * level. Where more of the nodes lead up than on average the count is
+   * reached sooner, so these regions are allowed more of them and the
+   * ones where few nodes lead up fewer.
+   * @param  up_ratio       Share of the nodes around the tile that lead up
+   * @param  level_up_ratio Share of the nodes of the whole level that lead up
+   * @return Returns the factor
+   */
+  static float UpTransitionFactor(const float up_ratio, const float level_up_ratio);
+};
+
+}
+}
+
+#endif  // VALHALLA_MJOLNIR_HIERARCHYLIMITSBUILDER_H
@@ -0,0 +1,82 @@
+#ifndef VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+#define VALHALLA_MJOLNIR_LANDMARKBUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/landmarks.h>
+#include <valhalla/sif/dynamiccost.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+// Number of landmarks picked when none is configured
+constexpr uint32_t kDefaultLandmarkCount = 16;
+
+/**
+ * Class used to build the landmark (ALT) cost tables of a costing.
+ */
+class LandmarkBuilder {
+ public:
+  /**
+   * An edge of the graph the costs are found over, between two node indexes.
+   */
+  struct Arc {
+    uint32_t from;  // Node the edge leaves
+    uint32_t to;    // Node the edge enters
+    float cost;     // Cost of the edge
+  };
+
+  /**
+   * Build the landmark tables for a costing from the tiles in the mjolnir
+   * tile_dir and write them next to them. The costing is created with its
+   * default options, which are the options the tables are used for.
+   * @param  pt       Configuration
+   * @param  costing  Name of the costing
+   * @param  count    Number of landmarks to pick
+   */
+  static void Build(const boost::property_tree::ptree& pt, const std::string& costing,
+                    const uint32_t count = kDefaultLandmarkCount);
+
+  /**
+   * Find the landmark tables of the routing graph for a costing. The edges
+   * are weighted with the costing's EdgeCost only, leaving the turn costs
+   * out keeps the costs a lower bound of what the path algorithms find.
+   * @param  reader        Graph reader for the tiles
+   * @param  costing       Costing to weight the edges with
+   * @param  costing_name  Name of the costing
+   * @param  count         Number of landmarks to pick
+   * @return Returns the landmark tables
+   */
+  static baldr::Landmarks Compute(baldr::GraphReader& reader, const sif::cost_ptr_t& costing,
+                                  const std::string& costing_name,
+                                  const uint32_t count = kDefaultLandmarkCount);
+
+  /**
+   * Find the landmark tables of a graph given as a list of arcs. Landmarks
+   * are picked one at a time as the node farthest from the ones picked so
+   * far, which spreads them to the edges of the graph where they give the
+   * best bounds.
+   * @param  costing_name  Name of the costing
+   * @param  tiles         Tile id of each tile with nodes, sorted by id
+   * @param  offsets       Index of the first node of each tile, with one
+   *                       extra entry at the end for the number of nodes
+   * @param  arcs          Arcs between the nodes
+   * @param  count         Number of landmarks to pick
+   * @return Returns the landmark tables
+   */
+  static baldr::Landmarks Compute(const std::string& costing_name,
+                                  std::vector<baldr::GraphId>&& tiles,
+                                  std::vector<uint32_t>&& offsets,
+                                  const std::vector<Arc>& arcs,
+                                  const uint32_t count = kDefaultLandmarkCount);
+};
+
+}
+}
+
+#endif  // VALHALLA_MJOLNIR_LANDMARKBUILDER_H
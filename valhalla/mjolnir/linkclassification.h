@@ -10,11 +10,14 @@ namespace mjolnir {
 
 // Reclassify links (ramps and turn channels). OSM usually classifies links as
 // the best classification, while to more effectively create shortcuts it is
-// better to "downgrade" link edges to the lower classification.
+// better to "downgrade" link edges to the lower classification. The exit
+// nodes the link trees are formed from are found on the given number of
+// threads, the links are then reclassified in order on the calling thread.
 void ReclassifyLinks(const std::string& ways_file,
                      const std::string& nodes_file,
                      const std::string& edges_file,
-                     const std::string& way_nodes_file);
+                     const std::string& way_nodes_file,
+                     const unsigned int threads);
 }
 }
 #endif  // VALHALLA_MJOLNIR_LINK_CLASSIFICATION_H_
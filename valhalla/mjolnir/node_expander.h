@@ -1,9 +1,12 @@
 #ifndef VALHALLA_MJOLNIR_NODE_EXPANDER_H_
 #define VALHALLA_MJOLNIR_NODE_EXPANDER_H_
 
+#include <algorithm>
+#include <functional>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
-#include <map>
 
 #include <valhalla/midgard/sequence.h>
 #include <valhalla/baldr/graphid.h>
@@ -152,6 +155,10 @@ struct Node {
   }
 };
 
+// The edges at a node and their indices in the edge sequence, sorted by
+// Edge::operator< (the order of the directed edges at the node in the tile)
+using node_edges_t = std::vector<std::pair<Edge, size_t> >;
+
 // collect all the edges that start or end at this node
 struct node_bundle : Node {
   size_t node_count;
@@ -159,9 +166,9 @@ struct node_bundle : Node {
   size_t non_link_count;
   size_t driveforward_count;
 
-  //TODO: to enable two directed edges per loop edge turn this into an
-  // unordered_multimap or just a list of pairs
-  std::map<Edge, size_t> node_edges;
+  //TODO: to enable two directed edges per loop edge stop skipping the edges
+  // that compare equal to one already added
+  node_edges_t node_edges;
 
   node_bundle(const Node& other)
       : Node(other),
@@ -170,6 +177,18 @@ struct node_bundle : Node {
         non_link_count(0),
         driveforward_count(0) {
   }
+
+  // Add an edge in order. Like inserting into a map an edge comparing equal
+  // to one already added (a loop, seen from both of its ends) is skipped
+  bool add_edge(const Edge& edge, const size_t index) {
+    auto itr = std::lower_bound(node_edges.begin(), node_edges.end(), edge,
+      [](const std::pair<Edge, size_t>& a, const Edge& b) { return a.first < b; });
+    if (itr != node_edges.end() && !(edge < itr->first)) {
+      return false;
+    }
+    node_edges.emplace(itr, edge, index);
+    return true;
+  }
 };
 
 /**
@@ -179,6 +198,22 @@ node_bundle collect_node_edges(const sequence<Node>::iterator& node_itr,
                                sequence<Node>& nodes,
                                sequence<Edge>& edges);
 
+/**
+ * Find the nodes whose bundles pass a test, scanning all of them on several
+ * threads. The nodes are split into a contiguous range of whole bundles per
+ * thread and each thread maps the files on its own, so the test may only
+ * read the bundle it is given.
+ * @param  nodes_file  File of the node sequence.
+ * @param  edges_file  File of the edge sequence.
+ * @param  threads     Number of threads to scan with.
+ * @param  pick        Test of a bundle, true to keep its node.
+ * @return Returns the index of the first node of every bundle kept, in order.
+ */
+std::vector<size_t> find_node_bundles(const std::string& nodes_file,
+                                      const std::string& edges_file,
+                                      const unsigned int threads,
+                                      const std::function<bool (const node_bundle&)>& pick);
+
 }
 }
 #endif  // VALHALLA_MJOLNIR_NODE_EXPANDER_H_
@@ -0,0 +1,64 @@
+#ifndef VALHALLA_MJOLNIR_OSMCHANGE_H_
+#define VALHALLA_MJOLNIR_OSMCHANGE_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * What osm change files (osc) created, modified or deleted, enough of it to
+ * tell which tiles a build would have to make again to pick up the changes.
+ */
+struct OSMChange {
+  // Nodes that were created or modified and where they are now
+  std::unordered_map<uint64_t, midgard::PointLL> nodes;
+  std::unordered_set<uint64_t> deleted_nodes;
+
+  // Ways that were created or modified and the nodes they have now
+  std::unordered_map<uint64_t, std::vector<uint64_t> > ways;
+  std::unordered_set<uint64_t> deleted_ways;
+
+  // Members of relations that were created, modified or deleted, restrictions
+  // and the like change the edges of the ways and nodes they are made of
+  std::unordered_set<uint64_t> relation_nodes;
+  std::unordered_set<uint64_t> relation_ways;
+
+  /**
+   * Read the changes of an osc file. Files should be read oldest first since
+   * a later change to an element replaces an earlier one.
+   * @param  osc_file  osmChange xml file
+   */
+  void Read(const std::string& osc_file);
+
+  /**
+   * Find the tiles that have to be built again to pick up the changes. These
+   * are the local level tiles of where the changed ways and nodes were in the
+   * previous build, from its ways and way nodes files, and where they are now.
+   * Since building a tile again renumbers its nodes the local tiles with edges
+   * that end in one of those tiles are added as well, as their opposing edges
+   * have to be fixed up, and then the tiles of the higher levels over all of
+   * them.
+   * @param  pt              mjolnir config, for the tiles of the previous build
+   * @param  ways_file       ways of the previous build
+   * @param  way_nodes_file  way nodes of the previous build
+   * @return Returns the tiles of all the levels
+   */
+  std::set<baldr::GraphId> DirtyTiles(const boost::property_tree::ptree& pt,
+                                      const std::string& ways_file,
+                                      const std::string& way_nodes_file) const;
+};
+
+}
+}
+
+#endif  // VALHALLA_MJOLNIR_OSMCHANGE_H_
@@ -6,6 +6,9 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <algorithm>
+#include <utility>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <valhalla/mjolnir/osmnode.h>
@@ -47,6 +50,66 @@ using BikeMultiMap = std::unordered_multimap<uint64_t, OSMBike>;
 
 using OSMStringMap = std::unordered_map<uint64_t, std::string>;
 
+/**
+ * Name or ref indexes of nodes. Nodes are parsed in order of their ids (per
+ * input file) so the indexes are kept as a flat list of node id and index,
+ * sorted once parsing is done, instead of a hash map with a node and a string
+ * per entry.
+ */
+class OSMNodeIndexMap {
+ public:
+  /**
+   * Add the index of a node.
+   * @param  osmid  OSM node id.
+   * @param  index  Index into the unique names or refs.
+   */
+  void insert(const uint64_t osmid, const uint32_t index) {
+    entries_.emplace_back(osmid, index);
+  }
+
+  /**
+   * Sort the indexes by node id so they can be found, the last one added for
+   * a node is kept. Call once all the nodes are added.
+   */
+  void sort() {
+    std::stable_sort(entries_.begin(), entries_.end(),
+      [](const entry_t& a, const entry_t& b) { return a.first < b.first; });
+    auto last = entries_.begin();
+    for (const auto& entry : entries_) {
+      if (last != entries_.begin() && (last - 1)->first == entry.first) {
+        *(last - 1) = entry;
+      } else {
+        *last++ = entry;
+      }
+    }
+    entries_.erase(last, entries_.end());
+    entries_.shrink_to_fit();
+  }
+
+  /**
+   * Find the index of a node.
+   * @param  osmid  OSM node id.
+   * @return  Returns the index or 0 (the blank name) if the node has none.
+   */
+  uint32_t find(const uint64_t osmid) const {
+    auto entry = std::lower_bound(entries_.cbegin(), entries_.cend(), osmid,
+      [](const entry_t& a, const uint64_t id) { return a.first < id; });
+    return entry != entries_.cend() && entry->first == osmid ? entry->second : 0;
+  }
+
+  /**
+   * Get the number of nodes with an index.
+   * @return  Returns the number of nodes.
+   */
+  size_t size() const {
+    return entries_.size();
+  }
+
+ protected:
+  using entry_t = std::pair<uint64_t, uint32_t>;
+  std::vector<entry_t> entries_;
+};
+
 using OSMShapeMap = std::unordered_map<uint64_t, PointLL>;
 using OSMWayMap = std::unordered_map<uint64_t, std::list<uint64_t>>;
 
@@ -91,14 +154,14 @@ struct OSMData {
   // Stores bike information from the relations.  Indexed by the way Id.
   BikeMultiMap bike_relations;
 
-  // Map that stores all the ref info on a node
-  OSMStringMap node_ref;
+  // Ref indexes (into ref_offset_map) of nodes
+  OSMNodeIndexMap node_ref;
 
-  // Map that stores all the exit_to info on a node
-  OSMStringMap node_exit_to;
+  // Exit_to indexes (into name_offset_map) of nodes
+  OSMNodeIndexMap node_exit_to;
 
-  // Map that stores all the name info on a node
-  OSMStringMap node_name;
+  // Name indexes (into name_offset_map) of nodes
+  OSMNodeIndexMap node_name;
 
   // Map that stores an updated ref for a way
   OSMStringMap way_ref;
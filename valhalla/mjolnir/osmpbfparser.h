@@ -58,6 +58,15 @@ struct Member {
   Member(Member&& other);
 };
 
+// Where a blob starts in the file and which kinds of objects its block has
+struct Block {
+  uint64_t offset;
+  Interest contents;
+};
+
+// The blocks of a file, in file order
+using Index = std::vector<Block>;
+
 //pure virtual interface for consumers to implement
 struct Callback {
   virtual ~Callback(){};
@@ -71,8 +80,13 @@ struct Callback {
 class Parser {
  public:
   Parser() = delete;
-  //parse the pbf file for the things you are interested in
-  static void parse(std::ifstream& file, const Interest interest, Callback& callback);
+  //parse the pbf file for the things you are interested in. with more than one thread the
+  //blobs are read on their own thread and inflated and decoded on the others, the
+  //callbacks are still made one at a time on the calling thread in the order of the file.
+  //an empty index is filled in with all the blocks of the file, given a filled in index
+  //only the blocks having something of interest are read so later passes can skip the rest
+  static void parse(std::ifstream& file, const Interest interest, Callback& callback,
+                    const unsigned int threads = 1, Index* index = nullptr);
   //clean up protobuf library level memory, this will make protobuf unusable after its called
   static void free();
 };
@@ -0,0 +1,68 @@
+#ifndef VALHALLA_MJOLNIR_OVERLAYBUILDER_H
+#define VALHALLA_MJOLNIR_OVERLAYBUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/overlaygraph.h>
+#include <valhalla/mjolnir/chbuilder.h>
+#include <valhalla/sif/dynamiccost.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build the level 0 tile boundary overlay of a costing.
+ */
+class OverlayBuilder {
+ public:
+  /**
+   * Build the boundary overlay for a costing from the tiles in the mjolnir
+   * tile_dir and write it next to them. The costing is created with its
+   * default options, which are the options the overlay is used for. The
+   * tiles are crossed on mjolnir.concurrency threads.
+   * @param  pt       Configuration
+   * @param  costing  Name of the costing
+   */
+  static void Build(const boost::property_tree::ptree& pt, const std::string& costing);
+
+  /**
+   * Build the boundary overlay of the level 0 routing graph for a costing.
+   * @param  reader        Graph reader for the tiles
+   * @param  costing       Costing to weight the turns with
+   * @param  costing_name  Name of the costing
+   * @param  threads       Threads to cross the tiles with, 0 for one per core
+   * @return Returns the overlay
+   */
+  static baldr::OverlayGraph Overlay(baldr::GraphReader& reader,
+                                     const sif::cost_ptr_t& costing,
+                                     const std::string& costing_name,
+                                     const uint32_t threads = 0);
+
+  /**
+   * Build the boundary overlay of a graph given as a list of turns. The cell
+   * of a node is the tile of its edge, a node is on the boundary when its
+   * edge ends in another cell and turns only lead to the nodes of the cell
+   * their node ends in.
+   * @param  costing_name  Name of the costing
+   * @param  edges         Directed edge of each node, sorted by id
+   * @param  end_tiles     Tile id of the end node of each edge
+   * @param  turns         Turns between the nodes
+   * @param  threads       Threads to cross the cells with, 0 for one per core
+   * @return Returns the overlay
+   */
+  static baldr::OverlayGraph Overlay(const std::string& costing_name,
+                                     const std::vector<baldr::GraphId>& edges,
+                                     const std::vector<uint32_t>& end_tiles,
+                                     const std::vector<CHBuilder::Turn>& turns,
+                                     const uint32_t threads = 0);
+};
+
+}
+}
+
+#endif  // VALHALLA_MJOLNIR_OVERLAYBUILDER_H
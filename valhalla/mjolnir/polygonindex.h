@@ -0,0 +1,106 @@
+#ifndef VALHALLA_MJOLNIR_POLYGONINDEX_H_
+#define VALHALLA_MJOLNIR_POLYGONINDEX_H_
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <boost/geometry.hpp>
+#include <boost/geometry/geometries/point_xy.hpp>
+#include <boost/geometry/geometries/polygon.hpp>
+#include <boost/geometry/geometries/box.hpp>
+#include <boost/geometry/multi/geometries/multi_polygon.hpp>
+#include <boost/geometry/index/rtree.hpp>
+
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+// Geometry types for admin queries
+typedef boost::geometry::model::d2::point_xy<double> point_type;
+typedef boost::geometry::model::polygon<point_type> polygon_type;
+typedef boost::geometry::model::multi_polygon<polygon_type> multi_polygon_type;
+
+// Number of rows and columns of the cell grid over a tile
+constexpr uint32_t kPolygonIndexGridSize = 32;
+
+/**
+ * Index of the admin or timezone polygons that intersect a tile, used to
+ * find the polygon that covers a point. The bounding boxes of the polygons
+ * are kept in an R-tree and the tile is split into a grid of cells. A cell
+ * is classified the first time a point falls in it: a cell inside a polygon
+ * or outside all of them answers without a point in polygon test, only cells
+ * that polygon boundaries cross test the point against the polygons crossing
+ * them. Lookups return the same polygon as GetMultiPolyId would.
+ *
+ * Cells are classified lazily so an index must not be shared across threads.
+ */
+class PolygonIndex {
+ public:
+  /**
+   * Constructor. The polygons are referenced rather than copied so they
+   * must outlive the index.
+   * @param  polys      Polygons keyed by their admin or timezone index.
+   * @param  bounds     Bounding box of the tile.
+   * @param  grid_size  Number of rows and columns of the cell grid.
+   */
+  PolygonIndex(const std::unordered_map<uint32_t, multi_polygon_type>& polys,
+               const midgard::AABB2<midgard::PointLL>& bounds,
+               const uint32_t grid_size = kPolygonIndexGridSize);
+
+  /**
+   * Get the index of the polygon that covers a point.
+   * @param  ll  Point to look up.
+   * @return Returns the admin or timezone index of the polygon, 0 if no
+   *         polygon covers the point.
+   */
+  uint32_t Get(const midgard::PointLL& ll) const;
+
+  /**
+   * Get the number of polygons in the index.
+   * @return Returns the number of polygons.
+   */
+  size_t size() const {
+    return polys_.size();
+  }
+
+ protected:
+  typedef boost::geometry::model::box<point_type> box_type;
+  typedef std::pair<box_type, uint32_t> value_type;
+
+  // Polygons overlapping a cell. Candidates are the positions of polygons
+  // that cross the cell and need an exact test, in order. If none of them
+  // covers the point it is covered by the polygon with index id, 0 if none.
+  struct Cell {
+    bool classified;
+    uint32_t id;
+    std::vector<uint32_t> candidates;
+  };
+
+  // Classify a cell from the polygons whose bounding boxes it intersects
+  void Classify(const uint32_t row, const uint32_t col, Cell& cell) const;
+
+  // Test the point against the candidates in order
+  uint32_t Test(const point_type& p, const std::vector<uint32_t>& candidates,
+                const uint32_t id) const;
+
+  // Polygons and their indexes, in the order they are tested
+  std::vector<std::pair<uint32_t, const multi_polygon_type*>> polys_;
+
+  // Bounding boxes of the polygons and their positions in polys_
+  boost::geometry::index::rtree<value_type,
+                                boost::geometry::index::quadratic<16>> rtree_;
+
+  // Cell grid over the tile
+  midgard::AABB2<midgard::PointLL> bounds_;
+  uint32_t grid_size_;
+  double cell_width_;
+  double cell_height_;
+  mutable std::vector<Cell> cells_;
+};
+
+}
+}
+
+#endif  // VALHALLA_MJOLNIR_POLYGONINDEX_H_
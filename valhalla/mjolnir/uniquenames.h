@@ -5,15 +5,16 @@
 #include <string>
 #include <vector>
 #include <algorithm>
-#include <unordered_map>
 
 namespace valhalla {
 namespace mjolnir {
 
-using NamesMap = std::unordered_map<std::string, uint32_t>;
-
 /**
- * Class to hold a list of unique names and indexes to them.
+ * Class to hold a list of unique names and indexes to them. Each name is
+ * kept once, in the order it was added, and is found again through a flat
+ * open addressed table of indexes. Planet extracts have tens of millions of
+ * names so this costs a string and a couple of slots per name rather than a
+ * hash map node plus an iterator to it.
  */
 class UniqueNames {
  public:
@@ -54,12 +55,26 @@ class UniqueNames {
   void Log() const;
 
  protected:
-  // Map of names to indexes
-  NamesMap names_;
+  /**
+   * Get the slot of a name in the table, the one holding its index or the
+   * empty one it would be put in.
+   * @param  name  Name.
+   * @return  Returns the slot.
+   */
+  size_t Slot(const std::string& name) const;
+
+  /**
+   * Resize the table and put the indexes of all the names back into it.
+   * @param  slot_count  Number of slots, a power of 2.
+   */
+  void Rehash(const size_t slot_count);
+
+  // List of names, the blank name is at index 0
+  std::vector<std::string> names_;
 
-  // List of entries into the map
-  using nameiter = NamesMap::iterator;
-  std::vector<nameiter> indexes_;
+  // Table of indexes into the names. The blank name is never looked up in it
+  // so 0 marks an empty slot
+  std::vector<uint32_t> slots_;
 };
 
 }
@@ -38,9 +38,9 @@ class EnhancedTripPath : public TripPath {
 
   EnhancedTripPath_Admin* GetAdmin(size_t index);
 
-  std::string GetCountryCode(int node_index);
+  const std::string& GetCountryCode(int node_index);
 
-  std::string GetStateCode(int node_index);
+  const std::string& GetStateCode(int node_index);
 
   const ::valhalla::odin::Location& GetOrigin() const;
 
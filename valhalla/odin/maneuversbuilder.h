@@ -3,7 +3,10 @@
 
 #include <cstdint>
 #include <list>
+#include <memory>
+#include <vector>
 
+#include <valhalla/baldr/streetnames.h>
 #include <valhalla/proto/trippath.pb.h>
 #include <valhalla/proto/directions_options.pb.h>
 #include <valhalla/odin/enhancedtrippath.h>
@@ -62,8 +65,19 @@ class ManeuversBuilder {
 
   void CountAndSortExitSigns(std::list<Maneuver>& maneuvers);
 
+  void CountAndSortExitSigns(Maneuver& prev_man, Maneuver& curr_man);
+
   void ConfirmManeuverTypeAssignment(std::list<Maneuver>& maneuvers);
 
+  /**
+   * Counts and sorts the exit signs, confirms the maneuver type assignment and
+   * enhances the signless interchanges of the combined maneuvers in a single
+   * walk from the last maneuver to the first, rather than a walk each.
+   *
+   * @param maneuvers The list of maneuvers to process.
+   */
+  void PostProcess(std::list<Maneuver>& maneuvers);
+
   void CreateDestinationManeuver(Maneuver& maneuver);
 
   void CreateStartManeuver(Maneuver& maneuver);
@@ -147,9 +161,38 @@ class ManeuversBuilder {
    */
   void EnhanceSignlessInterchnages(std::list<Maneuver>& maneuvers);
 
+  void EnhanceSignlessInterchnage(const Maneuver& prev_man, Maneuver& curr_man,
+                                  const Maneuver& next_man);
+
+  /**
+   * Returns the street names of the edge before the specified node, using
+   * the country of that node. They are made the first time they are asked
+   * for and kept for the rest of the build.
+   *
+   * @param node_index The index of the node the edge ends at.
+   *
+   * @return the street names of the previous edge.
+   */
+  const baldr::StreetNames& GetPrevEdgeNames(int node_index) const;
+
+  /**
+   * Returns the street names of the edge after the specified node, using
+   * the country of that node. They are made the first time they are asked
+   * for and kept for the rest of the build.
+   *
+   * @param node_index The index of the node the edge begins at.
+   *
+   * @return the street names of the current edge.
+   */
+  const baldr::StreetNames& GetCurrEdgeNames(int node_index) const;
+
   const DirectionsOptions& directions_options_;
   EnhancedTripPath* trip_path_;
 
+  // The street names of the edges before and after each node
+  mutable std::vector<std::unique_ptr<baldr::StreetNames> > prev_edge_names_;
+  mutable std::vector<std::unique_ptr<baldr::StreetNames> > curr_edge_names_;
+
 };
 
 }
@@ -1,6 +1,8 @@
 #ifndef VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 #define VALHALLA_ODIN_NARRATIVE_DICTIONARY_H_
 
+#include <cstdint>
+#include <array>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -148,8 +150,122 @@ constexpr auto kTransitPlatformCountLabelTag = "<TRANSIT_STOP_COUNT_LABEL>";
 namespace valhalla {
 namespace odin {
 
+// Slots of the phrase tags that instructions are formed with
+enum class PhraseTag : uint8_t {
+  kCardinalDirection,
+  kRelativeDirection,
+  kOrdinalValue,
+  kStreetNames,
+  kPreviousStreetNames,
+  kBeginStreetNames,
+  kCrossStreetNames,
+  kLength,
+  kDestination,
+  kCurrentVerbalCue,
+  kNextVerbalCue,
+  kNumberSign,
+  kBranchSign,
+  kTowardSign,
+  kNameSign,
+  kFerryLabel,
+  kTransitPlatform,
+  kStationLabel,
+  kTime,
+  kTransitName,
+  kTransitHeadSign,
+  kTransitPlatformCount,
+  kTransitPlatformCountLabel,
+  kCount
+};
+
+/**
+ * The values to replace the phrase tags with when forming an instruction.
+ * Only references to the values are kept so they must outlive the render.
+ */
+class PhraseValues {
+ public:
+  PhraseValues() {
+    values_.fill(nullptr);
+  }
+
+  /**
+   * Sets the value of a phrase tag.
+   *
+   * @param  tag  The phrase tag.
+   * @param  value  The value to replace the tag with.
+   * @return this object so values can be chained.
+   */
+  PhraseValues& Set(const PhraseTag tag, const std::string& value) {
+    values_[static_cast<size_t>(tag)] = &value;
+    return *this;
+  }
+
+  /**
+   * Returns the value of a phrase tag, nullptr if it has not been set.
+   *
+   * @param  tag  The phrase tag.
+   * @return the value of the phrase tag.
+   */
+  const std::string* Get(const PhraseTag tag) const {
+    return values_[static_cast<size_t>(tag)];
+  }
+
+ protected:
+  std::array<const std::string*, static_cast<size_t>(PhraseTag::kCount)> values_;
+};
+
+/**
+ * A localized phrase compiled into spans of literal text and the slots of
+ * its tags, so that an instruction is formed in a single pass over the
+ * phrase instead of replacing each tag in a copy of it.
+ */
+class PhraseTemplate {
+ public:
+  PhraseTemplate() = default;
+
+  /**
+   * Compiles the specified phrase. Tags that are not phrase tags are kept
+   * as literal text.
+   *
+   * @param  phrase  The localized phrase with tags.
+   */
+  explicit PhraseTemplate(const std::string& phrase);
+
+  /**
+   * Appends the phrase to the instruction with each of its tags replaced by
+   * the value set for it. Tags without a value are appended as they are.
+   *
+   * @param  values  The values of the phrase tags.
+   * @param  instruction  The instruction to append to.
+   */
+  void Render(const PhraseValues& values, std::string& instruction) const;
+
+  /**
+   * Returns the phrase this template was compiled from.
+   *
+   * @return the phrase this template was compiled from.
+   */
+  const std::string& phrase() const {
+    return phrase_;
+  }
+
+ protected:
+  // A span of the phrase, literal text when slot is kLiteral
+  struct Token {
+    uint32_t offset;
+    uint32_t length;
+    uint8_t slot;
+  };
+  static constexpr uint8_t kLiteral = static_cast<uint8_t>(PhraseTag::kCount);
+
+  std::string phrase_;
+  std::vector<Token> tokens_;
+  size_t literal_length_ = 0;
+};
+
 struct PhraseSet {
   std::unordered_map<std::string, std::string> phrases;
+  std::unordered_map<std::string, PhraseTemplate> templates;
 };
 
 struct StartSubset : PhraseSet {
@@ -2,6 +2,7 @@
 #define VALHALLA_ODIN_UTIL_H_
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -48,7 +49,26 @@ std::string get_localized_date(const std::string& date_time,
                                const std::locale& locale);
 
 /**
- * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information
+ * Returns whether the locale string is a language tag or alias of one of the
+ * locales, without parsing any of them
+ *
+ * @param locale  the language tag or alias
+ * @return true if there is a dictionary for the locale
+ */
+bool is_supported_locale(const std::string& locale);
+
+/**
+ * Returns the NarrativeDictionary of a locale string. Only the locales that
+ * are used are parsed, each the first time it is asked for
+ *
+ * @param locale  the language tag or alias
+ * @return the dictionary or nullptr if the locale is not supported
+ */
+std::shared_ptr<NarrativeDictionary> get_locale(const std::string& locale);
+
+/**
+ * Returns locale strings mapped to NarrativeDictionaries containing parsed narrative information.
+ * This parses every locale, prefer get_locale when only one is needed
  *
  * @return the map of locales to NarrativeDictionaries
  */
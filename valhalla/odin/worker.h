@@ -23,6 +23,10 @@ namespace valhalla {
       virtual void cleanup() override;
 
       std::list<TripDirections> narrate(const valhalla_request_t& request, std::list<TripPath>& legs) const;
+
+     protected:
+      // How many threads the legs of a trip are narrated with
+      uint32_t narrate_threads;
     };
   }
 }
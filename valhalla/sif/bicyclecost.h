@@ -2,16 +2,223 @@
 #define VALHALLA_SIF_BICYCLECOST_H_
 
 #include <cstdint>
+#include <vector>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/nodeinfo.h>
+#include <valhalla/sif/costconstants.h>
 #include <valhalla/sif/dynamiccost.h>
 
 namespace valhalla {
 namespace sif {
 
+/**
+ * Derived class providing dynamic edge costing for bicycle routes.
+ */
+class BicycleCost : public DynamicCost {
+ public:
+  /**
+   * Constructor. Configuration / options for bicycle costing are provided
+   * via a json object.
+   * @param  config  Json object with configuration/options.
+   */
+  BicycleCost(const rapidjson::Value& config);
+
+  virtual ~BicycleCost();
+
+  /**
+   * Copies this costing, options and all.
+   * @return  Returns the copy.
+   */
+  virtual cost_ptr_t Clone() const;
+
+  /**
+   * Get the access mode used by this costing method.
+   * @return  Returns access mode.
+   */
+  uint32_t access_mode() const;
+
+  /**
+   * Checks if access is allowed for the provided directed edge.
+   * This is generally based on mode of travel and the access modes
+   * allowed on the edge. However, it can be extended to exclude access
+   * based on other parameters.
+   * @param  edge     Pointer to a directed edge.
+   * @param  pred     Predecessor edge information.
+   * @param  tile     current tile
+   * @param  edgeid   edgeid that we care about
+   * @return  Returns true if access is allowed, false if not.
+   */
+  virtual bool Allowed(const baldr::DirectedEdge* edge,
+                       const EdgeLabel& pred,
+                       const baldr::GraphTile*& tile,
+                       const baldr::GraphId& edgeid) const;
+
+  /**
+   * Checks if access is allowed for an edge on the reverse path
+   * (from destination towards origin). Both opposing edges are
+   * provided.
+   * @param  edge           Pointer to a directed edge.
+   * @param  pred           Predecessor edge information.
+   * @param  opp_edge       Pointer to the opposing directed edge.
+   * @param  tile           Tile for the opposing edge (for looking
+   *                        up restrictions).
+   * @param  opp_edgeid     Opposing edge Id
+   * @return  Returns true if access is allowed, false if not.
+   */
+  virtual bool AllowedReverse(const baldr::DirectedEdge* edge,
+                 const EdgeLabel& pred,
+                 const baldr::DirectedEdge* opp_edge,
+                 const baldr::GraphTile*& tile,
+                 const baldr::GraphId& opp_edgeid) const;
+
+  /**
+   * Checks if access is allowed for the provided node. Node access can
+   * be restricted if bollards or gates are present. (TODO - others?)
+   * @param  edge  Pointer to node information.
+   * @return  Returns true if access is allowed, false if not.
+   */
+  virtual bool Allowed(const baldr::NodeInfo* node) const;
+
+  /**
+   * Get the cost to traverse the specified directed edge. Cost includes
+   * the time (seconds) to traverse the edge.
+   * @param   edge  Pointer to a directed edge.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const;
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge.
+   * Defaults to 0. Costing models that wish to include edge transition
+   * costs (i.e., intersection/turn costs) must override this method.
+   * @param  edge  Directed edge (the to edge)
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  Predecessor edge information.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
+                              const baldr::NodeInfo* node,
+                              const EdgeLabel& pred) const;
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge
+   * when using a reverse search (from destination towards the origin).
+   * @param  idx   Directed edge local index
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  the opposing current edge in the reverse tree.
+   * @param  edge  the opposing predecessor in the reverse tree
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost TransitionCostReverse(const uint32_t idx,
+                                     const baldr::NodeInfo* node,
+                                     const baldr::DirectedEdge* pred,
+                                     const baldr::DirectedEdge* edge) const;
+
+  /**
+   * Get the cost factor for A* heuristics. This factor is multiplied
+   * with the distance to the destination to produce an estimate of the
+   * minimum cost to the destination. The A* heuristic must underestimate the
+   * cost to the destination. So a time based estimate based on speed should
+   * assume the maximum speed is used to the destination such that the time
+   * estimate is less than the least possible time along roads.
+   */
+  virtual float AStarCostFactor() const;
+
+  /**
+   * Get the current travel type.
+   * @return  Returns the current travel type.
+   */
+  virtual uint8_t travel_type() const;
+
+  // Public so the tests in the source file can reach them
+
+  float speedfactor_[baldr::kMaxSpeedKph + 1];  // Cost factors based on speed in kph
+  float maneuver_penalty_;               // Penalty (seconds) when inconsistent names
+  float driveway_penalty_;               // Penalty (seconds) using a driveway
+  float gate_cost_;                      // Cost (seconds) to go through gate
+  float gate_penalty_;                   // Penalty (seconds) to go through gate
+  float alley_penalty_;                  // Penalty (seconds) to use a alley
+  float ferry_cost_;                     // Cost (seconds) to exit a ferry
+  float ferry_penalty_;                  // Penalty (seconds) to enter a ferry
+  float ferry_factor_;                   // Weighting to apply to ferry edges
+  float country_crossing_cost_;          // Cost (seconds) to go across a country border
+  float country_crossing_penalty_;       // Penalty (seconds) to go across a country border
+  float use_roads_;                      // Preference of using roads between 0 and 1
+  float road_factor_;                    // Road factor based on use_roads_
+  float use_ferry_;                      // Preference of using ferries between 0 and 1
+  float use_hills_;                      // Preference of using hills between 0 and 1
+  float avoid_bad_surfaces_;             // Preference of avoiding bad surfaces for the bike type
+
+  // Average speed (kph) on smooth, flat roads.
+  float speed_;
+
+  // Bicycle type
+  BicycleType type_;
+
+  // Minimal surface type that will be penalized for costing
+  baldr::Surface minimal_surface_penalized_;
+
+  baldr::Surface worst_allowed_surface_;
+
+
+  // Speed penalty factor. Penalties apply above a threshold
+  // (based on the use_roads factor)
+  float speedpenalty_[baldr::kMaxSpeedKph + 1];
+  uint32_t speed_penalty_threshold_;
+  
+  // Seconds per meter and the base edge factor by surface and weighted grade
+  // (relative value from 0-15). These fold the surface and grade speed
+  // factors, the grade penalties (based on use_hills) and the bad surface
+  // penalties together so they are looked up once per edge.
+  float surface_grade_sec_[8][baldr::kMaxGradeFactor + 1];
+  float surface_grade_factor_[8][baldr::kMaxGradeFactor + 1];
+
+protected:
+
+  /**
+   * Returns a function/functor to be used in location searching which will
+   * exclude and allow ranking results from the search by looking at each
+   * edges attribution and suitability for use as a location by the travel
+   * mode used by the costing method. Function/functor is also used to filter
+   * edges not usable / inaccessible by bicycle.
+   */
+  virtual const EdgeFilter GetEdgeFilter() const {
+    // Throw back a lambda that checks the access for this type of costing
+    baldr::Surface s = worst_allowed_surface_;
+    return [s](const baldr::DirectedEdge* edge) {
+      if ( edge->IsTransition() || edge->is_shortcut() ||
+          !(edge->forwardaccess() & baldr::kBicycleAccess) ||
+           edge->use() == baldr::Use::kSteps ||
+           edge->surface() > s) {
+        return 0.0f;
+      } else {
+        // TODO - use classification/use to alter the factor
+        return 1.0f;
+      }
+    };
+  }
+
+  /**
+   * Returns a function/functor to be used in location searching which will
+   * exclude results from the search by looking at each node's attribution
+   * @return Function to be used in filtering out nodes
+   */
+  virtual const NodeFilter GetNodeFilter() const {
+    //throw back a lambda that checks the access for this type of costing
+    return [](const baldr::NodeInfo* node) {
+      return !(node->access() & baldr::kBicycleAccess);
+    };
+  }
+
+};
+
 /**
  * Create a bicyclecost
- * @param  config  Property tree with configuration / options.
+ * @param  config  Json object with configuration / options.
  */
-cost_ptr_t CreateBicycleCost(const boost::property_tree::ptree& config);
+cost_ptr_t CreateBicycleCost(const rapidjson::Value& config);
 
 }
 }
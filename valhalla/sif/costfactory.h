@@ -3,12 +3,14 @@
 
 #include <map>
 #include <memory>
+#include <sstream>
 
 #include <valhalla/sif/autocost.h>
 #include <valhalla/sif/bicyclecost.h>
 #include <valhalla/sif/motorscootercost.h>
 #include <valhalla/sif/pedestriancost.h>
 #include <valhalla/sif/truckcost.h>
+#include <valhalla/sif/truckprofile.h>
 #include <valhalla/sif/transitcost.h>
 #include <valhalla/baldr/rapidjson_utils.h>
 
@@ -26,7 +28,7 @@ class CostFactory {
  public:
   typedef std::shared_ptr<cost_t> cost_ptr_t;
   //TODO: might want to have some configurable params to each cost type
-  typedef cost_ptr_t (*factory_function_t)(const boost::property_tree::ptree& config);
+  typedef cost_ptr_t (*factory_function_t)(const rapidjson::Value& config);
 
   /**
    * Constructor
@@ -46,10 +48,10 @@ class CostFactory {
   /**
    * Make a cost from its name
    * @param name    the name of the cost to create
-   * @param config  Property tree with configuration / cost options
+   * @param config  Json object with configuration / cost options
    */
   cost_ptr_t Create(const std::string& name,
-                    const boost::property_tree::ptree& config) const {
+                    const rapidjson::Value& config) const {
     auto itr = factory_funcs_.find(name);
     if (itr == factory_funcs_.end()) {
       throw std::runtime_error("No costing method found for '" + name + "'");
@@ -58,17 +60,22 @@ class CostFactory {
     return itr->second(config);
   }
 
+  /**
+   * Make a cost from its name using options held in a property tree. This
+   * round trips the options through json so prefer the overload above when
+   * a json document is already at hand.
+   * @param name    the name of the cost to create
+   * @param config  Property tree with configuration / cost options
+   */
   cost_ptr_t Create(const std::string& name,
-                    const rapidjson::Value& config) const {
-    if (config.IsNull())
-      return Create(name, boost::property_tree::ptree{});
-    rapidjson::StringBuffer buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    config.Accept(writer);
-    boost::property_tree::ptree pt;
-    std::istringstream is(buffer.GetString());;
-    boost::property_tree::read_json(is, pt);
-    return Create(name, pt);
+                    const boost::property_tree::ptree& config) const {
+    if (config.empty())
+      return Create(name, rapidjson::Value{});
+    std::stringstream ss;
+    boost::property_tree::write_json(ss, config, false);
+    rapidjson::Document document;
+    document.Parse(ss.str().c_str());
+    return Create(name, document);
   }
  private:
   std::map<std::string, factory_function_t> factory_funcs_;
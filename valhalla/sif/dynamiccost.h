@@ -8,6 +8,7 @@
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
 #include <valhalla/baldr/double_bucket_queue.h> // For kInvalidLabel
+#include <valhalla/midgard/constants.h>
 
 #include <memory>
 #include <unordered_set>
@@ -55,14 +56,23 @@ class DynamicCost {
  public:
   /**
    * Constructor.
-   * @param  pt   Property tree with (optional) costing configuration.
+   * @param  config  Json object with (optional) costing configuration.
    * @param  mode Travel mode
    */
-  DynamicCost(const boost::property_tree::ptree& pt,
+  DynamicCost(const rapidjson::Value& config,
               const TravelMode mode);
 
   virtual ~DynamicCost();
 
+  /**
+   * Copies this costing so that it can be handed out again without parsing
+   * its options a second time. The copy has its own hierarchy limits and
+   * pass so relaxing them doesn't change the original. Defaults to nullptr,
+   * costing methods that support copying must override this method.
+   * @return  Returns the copy or nullptr if this costing can't be copied.
+   */
+  virtual std::shared_ptr<DynamicCost> Clone() const;
+
   /**
    * Does the costing method allow multiple passes (with relaxed
    * hierarchy limits).
@@ -165,6 +175,18 @@ class DynamicCost {
    */
   virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const = 0;
 
+  /**
+   * Get the costs to traverse a run of directed edges, such as the outbound
+   * edges of a node, which are contiguous in the tile. Defaults to EdgeCost
+   * of each edge. Costing models can override it with a loop that needs no
+   * call per edge.
+   * @param   edges  Pointer to the first directed edge.
+   * @param   count  Number of directed edges.
+   * @param   costs  Returns the cost and time (seconds) of each edge.
+   */
+  virtual void EdgeCosts(const baldr::DirectedEdge* edges,
+                         const uint32_t count, Cost* costs) const;
+
   /**
    * Get the cost to traverse the specified directed edge using a transit
    * departure (schedule based edge traversal). Cost includes
@@ -178,6 +200,39 @@ class DynamicCost {
                         const baldr::TransitDeparture* departure,
                         const uint32_t curr_time) const;
 
+  /**
+   * Get the cost to traverse the specified directed edge using a transit
+   * departure when searching back in time from the destination. Cost
+   * includes the time (seconds) waiting at the end of the edge after the
+   * departure arrives there and the time to traverse the edge.
+   * @param   edge      Pointer to a directed edge.
+   * @param   departure Transit departure record.
+   * @param   curr_time Current local time (seconds from midnight) at the
+   *                    end of the edge.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost EdgeCostReverse(const baldr::DirectedEdge* edge,
+                               const baldr::TransitDeparture* departure,
+                               const uint32_t curr_time) const;
+
+  /**
+   * Adjusts the cost to traverse a directed edge for its live traffic speed.
+   * Only driven modes use traffic, the cost is scaled by the same factor as
+   * the time so the costing's preferences are kept.
+   * @param   edge   Pointer to a directed edge.
+   * @param   cost   Cost of the edge from EdgeCost.
+   * @param   speed  Live speed of the edge in kph, 0 if there is none.
+   * @return  Returns the cost and time (seconds)
+   */
+  Cost TrafficCost(const baldr::DirectedEdge* edge, const Cost& cost,
+                   const uint8_t speed) const {
+    if (speed == 0 || travel_mode_ != TravelMode::kDrive || cost.secs <= 0.0f)
+      return cost;
+    float sec = edge->length() * (midgard::kSecPerHour * 0.001f) /
+                static_cast<float>(speed);
+    return { cost.cost * sec / cost.secs, sec };
+  }
+
   /**
    * Returns the cost to make the transition from the predecessor edge.
    * Defaults to 0. Costing models that wish to include edge transition
@@ -407,7 +462,7 @@ class DynamicCost {
   /**
    * Adds a list of edges (GraphIds) to the user specified avoid list.
    * This can be used by test programs - alternatively a list of avoid
-   * edges will be passed in the property tree for the costing options
+   * edges will be passed in the json for the costing options
    * of a specified type.
    * @param  avoid_edges  Set of edge Ids to avoid.
    */
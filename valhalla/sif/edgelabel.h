@@ -383,7 +383,10 @@ class EdgeLabel {
 /**
  * EdgeLabel used for bidirectional path algorithms: Bidirectional A*
  * and CostMatrix (which does not use a heuristic based on distance
- * to the destination).
+ * to the destination). The transition cost onto the edge is only needed
+ * where the two searches connect and when forming the path, so the path
+ * algorithms keep it in a vector of their own alongside the labels. That
+ * keeps the labels a search reads on every expansion smaller.
  */
 class BDEdgeLabel : public EdgeLabel {
  public:
@@ -404,18 +407,15 @@ class BDEdgeLabel : public EdgeLabel {
    * @param sortcost     Cost for sorting (includes A* heuristic)n
    * @param dist         Distance to the destination in meters.
    * @param mode         Mode of travel along this edge.
-   * @param tc           Transition cost entering this edge.
    * @param not_thru_pruning  Is not thru pruning enabled.
    */
   BDEdgeLabel(const uint32_t predecessor, const baldr::GraphId& edgeid,
               const baldr::GraphId& oppedgeid,
               const baldr::DirectedEdge* edge, const sif::Cost& cost,
               const float sortcost, const float dist,
-              const sif::TravelMode mode, const sif::Cost& tc,
-              const bool not_thru_pruning)
+              const sif::TravelMode mode, const bool not_thru_pruning)
       : EdgeLabel(predecessor, edgeid, edge, cost, sortcost, dist, mode, 0),
         opp_edgeid_(oppedgeid),
-        transition_cost_(tc),
         not_thru_pruning_(not_thru_pruning) {
   }
 
@@ -429,18 +429,16 @@ class BDEdgeLabel : public EdgeLabel {
    * @param endnode       End node of the directed edge.
    * @param cost          True cost (cost and time in seconds) to the edge.
    * @param mode          Mode of travel along this edge.
-   * @param tc            Transition cost entering this edge.
    * @param path_distance Accumulated path distance.
    * @param not_thru_pruning  Is not thru pruning enabled.
    */
   BDEdgeLabel(const uint32_t predecessor, const baldr::GraphId& edgeid,
               const baldr::GraphId& oppedgeid,
               const baldr::DirectedEdge* edge, const sif::Cost& cost,
-              const sif::TravelMode mode, const sif::Cost& tc,
-              const uint32_t path_distance, const bool not_thru_pruning)
+              const sif::TravelMode mode, const uint32_t path_distance,
+              const bool not_thru_pruning)
     : EdgeLabel(predecessor, edgeid, edge, cost, cost.cost, 0, mode, path_distance),
       opp_edgeid_(oppedgeid),
-      transition_cost_(tc),
       not_thru_pruning_(not_thru_pruning) {
   }
 
@@ -462,42 +460,6 @@ class BDEdgeLabel : public EdgeLabel {
       : EdgeLabel(predecessor, edgeid, edge, cost, sortcost, dist, mode, 0),
         not_thru_pruning_(false) {
     opp_edgeid_ =  {};
-    transition_cost_ = {};
-  }
-
-  /**
-   * Update an existing edge label with new predecessor and cost information.
-   * The mode, edge Id, and end node remain the same.
-   * @param predecessor Predecessor directed edge in the shortest path.
-   * @param cost        True cost (and elapsed time in seconds) to the edge.
-   * @param sortcost    Cost for sorting (includes A* heuristic).
-   * @param tc          Transition cost onto the edge.
-   */
-  void Update(const uint32_t predecessor, const sif::Cost& cost,
-              const float sortcost, const sif::Cost& tc) {
-    predecessor_ = predecessor;
-    cost_ = cost;
-    sortcost_ = sortcost;
-    transition_cost_ = tc;
-  }
-
-  /**
-   * Update an existing edge label with new predecessor and cost information.
-   * Update distance as well (used in time distance matrix)
-   * @param predecessor   Predecessor directed edge in the shortest path.
-   * @param cost          True cost (and elapsed time in seconds) to the edge.
-   * @param sortcost      Cost for sorting (includes A* heuristic).
-   * @param tc            Transition cost onto the edge.
-   * @param path_distance  Accumulated path distance.
-   */
-  void Update(const uint32_t predecessor, const sif::Cost& cost,
-              const float sortcost, const sif::Cost& tc,
-              const uint32_t path_distance) {
-    predecessor_ = predecessor;
-    cost_ = cost;
-    sortcost_ = sortcost;
-    transition_cost_ = tc;
-    path_distance_ = path_distance;
   }
 
   /**
@@ -508,26 +470,6 @@ class BDEdgeLabel : public EdgeLabel {
     return baldr::GraphId(opp_edgeid_);
   }
 
-  /**
-   * Get the transition cost in seconds. This is used in the bidirectional A*
-   * to determine the cost at the connection.
-   * @return  Returns the transition cost (including penalties) in seconds.
-   */
-  float transition_cost() const {
-    return transition_cost_.cost;
-  }
-
-  /**
-   * Get the transition cost in seconds. This is used in the bidirectional A*
-   * reverse path search to allow the recovery of the true elapsed time along
-   * the path. This is needed since the transition cost is applied at a
-   * different node than the forward search.
-   * @return  Returns the transition cost (without penalties) in seconds.
-   */
-  float transition_secs() const {
-    return transition_cost_.secs;
-  }
-
   /**
    * Should not thru pruning be enabled on this path?
    * @return Returns true if not thru pruning should be enabled.
@@ -541,9 +483,6 @@ class BDEdgeLabel : public EdgeLabel {
   // not_thru_pruning_: Is not thru pruning enabled?
   uint64_t opp_edgeid_       : 63;  // Could be 46 (to provide more spare)
   uint64_t not_thru_pruning_ : 1;
-
-  // Transition cost (for recovering elapsed time on reverse path)
-  sif::Cost transition_cost_;
 };
 
 /**
@@ -583,6 +522,40 @@ class MMEdgeLabel : public EdgeLabel {
         has_transit_(has_transit) {
   }
 
+  /**
+   * Constructor with values for a transit line of a multi-modal path found
+   * searching in reverse, from the destination towards the origin. Transit
+   * lines have no opposing edges so the label keeps the line itself and the
+   * stop it starts at is the node expanded next.
+   * @param predecessor   Index into the edge label list for the predecessor
+   *                      directed edge in the shortest path.
+   * @param edgeid        Directed edge (the transit line).
+   * @param edge          Directed edge.
+   * @param startnode     Start node of the directed edge.
+   * @param cost          True cost (cost and time in seconds) to the edge.
+   * @param sortcost      Cost for sorting (includes A* heuristic)
+   * @param dist          Distance meters to the origin
+   * @param mode          Mode of travel along this edge.
+   * @param path_distance Accumulated distance.
+   * @param tripid        Trip Id for a transit edge.
+   * @param prior_stopid  Prior transit stop Id.
+   * @param blockid       Transit trip block Id.
+   * @param transit_operator Transit operator - index into an internal map
+   * @param has_transit   Does the path to this edge have any transit.
+   */
+  MMEdgeLabel(const uint32_t predecessor, const baldr::GraphId& edgeid,
+            const baldr::DirectedEdge* edge, const baldr::GraphId& startnode,
+            const sif::Cost& cost, const float sortcost, const float dist,
+            const sif::TravelMode mode, const uint32_t path_distance,
+            const uint32_t tripid, const baldr::GraphId& prior_stopid,
+            const uint32_t blockid, const uint32_t transit_operator,
+            const bool has_transit)
+      : MMEdgeLabel(predecessor, edgeid, edge, cost, sortcost, dist, mode,
+                    path_distance, tripid, prior_stopid, blockid,
+                    transit_operator, has_transit) {
+    endnode_ = startnode;
+  }
+
   /**
    * Constructor given a predecessor edge label. This is used for hierarchy
    * transitions where the attributes at the predecessor are needed (rather
@@ -2,7 +2,8 @@
 #define VALHALLA_SIF_HIERARCHYLIMITS_H_
 
 #include <limits>
-#include <boost/property_tree/ptree.hpp>
+#include <string>
+#include <valhalla/baldr/rapidjson_utils.h>
 
 // Default hierarchy transitions. Note that this corresponds to a 3 level
 // strategy: highway, arterial, local. Any changes to this will require
@@ -46,22 +47,24 @@ struct HierarchyLimits {
                                  // always allowed. Used for A*.
 
   /**
-   * Set hierarchy limits for the specified level using a property tree.
-   * @param  pt     Property tree
+   * Set hierarchy limits for the specified level using the costing options.
+   * @param  config Json object with (optional) costing configuration
    * @param  level  Hierarchy level
    */
-  HierarchyLimits(const boost::property_tree::ptree& pt, const uint32_t level)
+  HierarchyLimits(const rapidjson::Value& config, const uint32_t level)
       : up_transition_count(0) {
 
     // Construct string to identify the level of the hierarchy
-    std::string hl = "hierarchy_limits." + std::to_string(level);
+    std::string hl = "/hierarchy_limits/" + std::to_string(level);
 
     // Set maximum number of upward transitions
-    max_up_transitions = pt.get<uint32_t>(hl + ".max_up_transitions",
+    max_up_transitions = rapidjson::get<uint32_t>(config,
+                    (hl + "/max_up_transitions").c_str(),
                     kDefaultMaxUpTransitions[level]);
 
     // Set distance within which expansion is always allowed for this level
-    expansion_within_dist = pt.get<float>(hl + ".expansion_within_dist",
+    expansion_within_dist = rapidjson::get<float>(config,
+                    (hl + "/expansion_within_dist").c_str(),
                     kDefaultExpansionWithinDist[level]);
   }
 
@@ -89,6 +92,21 @@ struct HierarchyLimits {
     return up_transition_count > max_up_transitions;
   }
 
+  /**
+   * Scale hierarchy limits with the factors of the tile a location is in.
+   * Limits that are unlimited or never expand are left alone.
+   * @param  up_transition_factor     Factor for the maximum upward transitions
+   * @param  expansion_within_factor  Factor for the expansion within distance
+   */
+  void Scale(const float up_transition_factor, const float expansion_within_factor) {
+    if (max_up_transitions != kUnlimitedTransitions) {
+      max_up_transitions = static_cast<uint32_t>(max_up_transitions * up_transition_factor);
+    }
+    if (0.0f < expansion_within_dist && expansion_within_dist < kMaxDistance) {
+      expansion_within_dist *= expansion_within_factor;
+    }
+  }
+
   /**
    * Relax hierarchy limits to try to find a route when initial attempt fails.
    * Do not relax limits if they are unlimited (bicycle and pedestrian for
@@ -4,7 +4,6 @@
 #include <cstdint>
 
 #include <valhalla/sif/dynamiccost.h>
-#include <boost/property_tree/ptree.hpp>
 
 namespace valhalla {
 namespace sif {
@@ -14,7 +13,7 @@ namespace sif {
  * uses the same rules except for some different access restrictions
  * and the tendency to avoid hills
  */
-cost_ptr_t CreateMotorScooterCost(const boost::property_tree::ptree& config);
+cost_ptr_t CreateMotorScooterCost(const rapidjson::Value& config);
 
 }
 }
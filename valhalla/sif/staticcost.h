@@ -0,0 +1,173 @@
+#ifndef VALHALLA_SIF_STATICCOST_H_
+#define VALHALLA_SIF_STATICCOST_H_
+
+#include <cstdint>
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/nodeinfo.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+
+namespace valhalla {
+namespace sif {
+
+/**
+ * The costing classes path algorithms can be instantiated for so that the
+ * costing in their expansion isn't called through the vtable.
+ */
+enum class StaticCostType : uint8_t {
+  kDynamic = 0,     // Any other costing, called through the vtable
+  kAuto = 1,
+  kBicycle = 2,
+  kPedestrian = 3,
+  kTruck = 4,
+  kTruckFleet = 5   // The truck costing of FleetTruckProfile
+};
+
+/**
+ * Get the costing class to instantiate a path algorithm for. A costing only
+ * gets a concrete class when it is exactly that class, not one derived from
+ * it (auto shorter, bus and hov derive from auto and override its methods).
+ * @param  costing  Costing method.
+ * @return Returns the costing class, kDynamic if there is no instantiation.
+ */
+StaticCostType static_cost_type(const DynamicCost& costing);
+
+/**
+ * Calls the costing methods used in path expansion on a costing whose class
+ * is known at compile time. The calls are qualified with the class so they
+ * bind directly rather than through the vtable, and what the class defines
+ * in its header is inlined into the expansion loop.
+ */
+template <class cost_t>
+class StaticCost {
+ public:
+  /**
+   * Constructor.
+   * @param  costing  Costing method, its class has to be exactly cost_t.
+   */
+  StaticCost(const DynamicCost& costing)
+      : costing_(static_cast<const cost_t&>(costing)) {
+  }
+
+  bool Allowed(const baldr::NodeInfo* node) const {
+    return costing_.cost_t::Allowed(node);
+  }
+
+  bool Allowed(const baldr::DirectedEdge* edge, const EdgeLabel& pred,
+               const baldr::GraphTile*& tile, const baldr::GraphId& edgeid) const {
+    return costing_.cost_t::Allowed(edge, pred, tile, edgeid);
+  }
+
+  bool AllowedReverse(const baldr::DirectedEdge* edge, const EdgeLabel& pred,
+                      const baldr::DirectedEdge* opp_edge, const baldr::GraphTile*& tile,
+                      const baldr::GraphId& opp_edgeid) const {
+    return costing_.cost_t::AllowedReverse(edge, pred, opp_edge, tile, opp_edgeid);
+  }
+
+  Cost EdgeCost(const baldr::DirectedEdge* edge) const {
+    return costing_.cost_t::EdgeCost(edge);
+  }
+
+  void EdgeCosts(const baldr::DirectedEdge* edges, const uint32_t count,
+                 Cost* costs) const {
+    for (uint32_t i = 0; i < count; i++) {
+      costs[i] = costing_.cost_t::EdgeCost(edges + i);
+    }
+  }
+
+  Cost TrafficCost(const baldr::DirectedEdge* edge, const Cost& cost,
+                   const uint8_t speed) const {
+    return costing_.TrafficCost(edge, cost, speed);
+  }
+
+  Cost TransitionCost(const baldr::DirectedEdge* edge, const baldr::NodeInfo* node,
+                      const EdgeLabel& pred) const {
+    return costing_.cost_t::TransitionCost(edge, node, pred);
+  }
+
+  Cost TransitionCostReverse(const uint32_t idx, const baldr::NodeInfo* node,
+                             const baldr::DirectedEdge* pred,
+                             const baldr::DirectedEdge* edge) const {
+    return costing_.cost_t::TransitionCostReverse(idx, node, pred, edge);
+  }
+
+  template <typename edge_labels_container_t>
+  bool Restricted(const baldr::DirectedEdge* edge, const EdgeLabel& pred,
+                  const edge_labels_container_t& edge_labels,
+                  const baldr::GraphTile*& tile, const baldr::GraphId& edgeid,
+                  const bool forward) const {
+    return costing_.Restricted(edge, pred, edge_labels, tile, edgeid, forward);
+  }
+
+ protected:
+  const cost_t& costing_;
+};
+
+/**
+ * Any other costing is called through the vtable as usual.
+ */
+template <>
+class StaticCost<DynamicCost> {
+ public:
+  StaticCost(const DynamicCost& costing)
+      : costing_(costing) {
+  }
+
+  bool Allowed(const baldr::NodeInfo* node) const {
+    return costing_.Allowed(node);
+  }
+
+  bool Allowed(const baldr::DirectedEdge* edge, const EdgeLabel& pred,
+               const baldr::GraphTile*& tile, const baldr::GraphId& edgeid) const {
+    return costing_.Allowed(edge, pred, tile, edgeid);
+  }
+
+  bool AllowedReverse(const baldr::DirectedEdge* edge, const EdgeLabel& pred,
+                      const baldr::DirectedEdge* opp_edge, const baldr::GraphTile*& tile,
+                      const baldr::GraphId& opp_edgeid) const {
+    return costing_.AllowedReverse(edge, pred, opp_edge, tile, opp_edgeid);
+  }
+
+  Cost EdgeCost(const baldr::DirectedEdge* edge) const {
+    return costing_.EdgeCost(edge);
+  }
+
+  void EdgeCosts(const baldr::DirectedEdge* edges, const uint32_t count,
+                 Cost* costs) const {
+    costing_.EdgeCosts(edges, count, costs);
+  }
+
+  Cost TrafficCost(const baldr::DirectedEdge* edge, const Cost& cost,
+                   const uint8_t speed) const {
+    return costing_.TrafficCost(edge, cost, speed);
+  }
+
+  Cost TransitionCost(const baldr::DirectedEdge* edge, const baldr::NodeInfo* node,
+                      const EdgeLabel& pred) const {
+    return costing_.TransitionCost(edge, node, pred);
+  }
+
+  Cost TransitionCostReverse(const uint32_t idx, const baldr::NodeInfo* node,
+                             const baldr::DirectedEdge* pred,
+                             const baldr::DirectedEdge* edge) const {
+    return costing_.TransitionCostReverse(idx, node, pred, edge);
+  }
+
+  template <typename edge_labels_container_t>
+  bool Restricted(const baldr::DirectedEdge* edge, const EdgeLabel& pred,
+                  const edge_labels_container_t& edge_labels,
+                  const baldr::GraphTile*& tile, const baldr::GraphId& edgeid,
+                  const bool forward) const {
+    return costing_.Restricted(edge, pred, edge_labels, tile, edgeid, forward);
+  }
+
+ protected:
+  const DynamicCost& costing_;
+};
+
+}
+}
+
+#endif  // VALHALLA_SIF_STATICCOST_H_
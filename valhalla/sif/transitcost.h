@@ -9,9 +9,9 @@ namespace sif {
 
 /**
  * Create a transit cost object.
- * @param  config  Property tree with configuration / options.
+ * @param  config  Json object with configuration / options.
  */
-cost_ptr_t CreateTransitCost(const boost::property_tree::ptree& config);
+cost_ptr_t CreateTransitCost(const rapidjson::Value& config);
 
 }
 }
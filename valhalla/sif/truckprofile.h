@@ -0,0 +1,229 @@
+#ifndef VALHALLA_SIF_TRUCKPROFILE_H_
+#define VALHALLA_SIF_TRUCKPROFILE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include <valhalla/baldr/directededge.h>
+#include <valhalla/baldr/graphconstants.h>
+#include <valhalla/baldr/nodeinfo.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/truckcost.h>
+
+namespace valhalla {
+namespace sif {
+
+/**
+ * The truck costing options of a fleet whose requests always use the same
+ * ones. These are the defaults of truck costing, a fleet changes them here
+ * (or adds a profile of its own next to this one, see ProfileTruckCost).
+ * A cost or penalty of 0 takes its check out of the costing altogether.
+ */
+struct FleetTruckProfile {
+  static constexpr float kManeuverPenalty         = 5.0f;   // Seconds
+  static constexpr float kDestinationOnlyPenalty  = 600.0f; // Seconds
+  static constexpr float kAlleyPenalty            = 5.0f;   // Seconds
+  static constexpr float kGateCost                = 30.0f;  // Seconds
+  static constexpr float kGatePenalty             = 300.0f; // Seconds
+  static constexpr float kTollBoothCost           = 15.0f;  // Seconds
+  static constexpr float kTollBoothPenalty        = 0.0f;   // Seconds
+  static constexpr float kCountryCrossingCost     = 600.0f; // Seconds
+  static constexpr float kCountryCrossingPenalty  = 0.0f;   // Seconds
+  static constexpr float kLowClassPenalty         = 30.0f;  // Seconds
+  static constexpr float kTruckRouteFactor        = 0.85f;  // 1 to not favor truck routes
+
+  static constexpr bool  kHazmat    = false;
+  static constexpr float kWeight    = 21.77f; // Metric Tons
+  static constexpr float kAxleLoad  = 9.07f;  // Metric Tons
+  static constexpr float kHeight    = 4.11f;  // Meters
+  static constexpr float kWidth     = 2.6f;   // Meters
+  static constexpr float kLength    = 21.64f; // Meters
+};
+
+/**
+ * Truck costing whose options are fixed at compile time by a profile rather
+ * than parsed from the request. Edge and transition costs are defined here
+ * so that, instantiated for the profile, the options are constants and the
+ * checks of the costs and penalties a profile leaves at 0 are compiled out.
+ * Only the options of the DynamicCost base (avoid edges and hierarchy limits)
+ * are still taken from the request.
+ *
+ * A profile is served under a costing name of its own: add the name to the
+ * Costing enum of directions_options.proto, register CreateProfileTruckCost
+ * for it with the cost factories of loki and thor, give it service limits and
+ * a StaticCostType so the path algorithms are instantiated for it.
+ */
+template <class profile_t>
+class ProfileTruckCost : public TruckCost {
+ public:
+  /**
+   * Construct the costing of the profile.
+   * @param  config  Json object with the options of the request, only those
+   *                 of DynamicCost are used.
+   */
+  ProfileTruckCost(const rapidjson::Value& config)
+      : TruckCost(config) {
+    maneuver_penalty_ = profile_t::kManeuverPenalty;
+    destination_only_penalty_ = profile_t::kDestinationOnlyPenalty;
+    alley_penalty_ = profile_t::kAlleyPenalty;
+    gate_cost_ = profile_t::kGateCost;
+    gate_penalty_ = profile_t::kGatePenalty;
+    tollbooth_cost_ = profile_t::kTollBoothCost;
+    tollbooth_penalty_ = profile_t::kTollBoothPenalty;
+    country_crossing_cost_ = profile_t::kCountryCrossingCost;
+    country_crossing_penalty_ = profile_t::kCountryCrossingPenalty;
+    low_class_penalty_ = profile_t::kLowClassPenalty;
+
+    hazmat_ = profile_t::kHazmat;
+    weight_ = profile_t::kWeight;
+    axle_load_ = profile_t::kAxleLoad;
+    height_ = profile_t::kHeight;
+    width_ = profile_t::kWidth;
+    length_ = profile_t::kLength;
+    SetMinAllowed();
+  }
+
+  virtual ~ProfileTruckCost() {
+  }
+
+  /**
+   * Copies this costing.
+   * @return  Returns the copy.
+   */
+  virtual cost_ptr_t Clone() const {
+    return std::make_shared<ProfileTruckCost>(*this);
+  }
+
+  /**
+   * Get the cost to traverse the specified directed edge. Cost includes
+   * the time (seconds) to traverse the edge.
+   * @param   edge  Pointer to a directed edge.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost EdgeCost(const baldr::DirectedEdge* edge) const {
+    float factor = density_factor_[edge->density()];
+    if (profile_t::kTruckRouteFactor != 1.0f && edge->truck_route() > 0) {
+      factor *= profile_t::kTruckRouteFactor;
+    }
+
+    float sec = (edge->truck_speed() > 0) ?
+        edge->length() * speedfactor_[edge->truck_speed()] :
+        edge->length() * speedfactor_[edge->speed()];
+    return { sec * factor, sec };
+  }
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge.
+   * @param  edge  Directed edge (the to edge)
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  Predecessor edge information.
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost TransitionCost(const baldr::DirectedEdge* edge,
+                              const baldr::NodeInfo* node,
+                              const EdgeLabel& pred) const {
+    uint32_t idx = pred.opp_local_idx();
+    float seconds = NodeCost(node, pred.toll(), edge->toll());
+    float penalty = NodePenalty(node, pred.toll(), edge->toll());
+    penalty += EdgePenalty(edge, node, idx, pred.destonly(), pred.use());
+    seconds += TurnCost(edge, node, idx);
+    return { seconds + penalty, seconds };
+  }
+
+  /**
+   * Returns the cost to make the transition from the predecessor edge
+   * when using a reverse search (from destination towards the origin).
+   * @param  idx   Directed edge local index
+   * @param  node  Node (intersection) where transition occurs.
+   * @param  pred  the opposing current edge in the reverse tree.
+   * @param  edge  the opposing predecessor in the reverse tree
+   * @return  Returns the cost and time (seconds)
+   */
+  virtual Cost TransitionCostReverse(const uint32_t idx,
+                                     const baldr::NodeInfo* node,
+                                     const baldr::DirectedEdge* pred,
+                                     const baldr::DirectedEdge* edge) const {
+    float seconds = NodeCost(node, pred->toll(), edge->toll());
+    float penalty = NodePenalty(node, pred->toll(), edge->toll());
+    penalty += EdgePenalty(edge, node, idx, pred->destonly(), pred->use());
+    seconds += TurnCost(edge, node, idx);
+    return { seconds + penalty, seconds };
+  }
+
+ protected:
+  // Time (seconds) of going through a border control, gate or toll booth
+  static float NodeCost(const baldr::NodeInfo* node, const bool pred_toll,
+                        const bool toll) {
+    float seconds = 0.0f;
+    if (profile_t::kCountryCrossingCost > 0.0f &&
+        node->type() == baldr::NodeType::kBorderControl) {
+      seconds += profile_t::kCountryCrossingCost;
+    }
+    if (profile_t::kGateCost > 0.0f && node->type() == baldr::NodeType::kGate) {
+      seconds += profile_t::kGateCost;
+    }
+    if (profile_t::kTollBoothCost > 0.0f &&
+        (node->type() == baldr::NodeType::kTollBooth || (!pred_toll && toll))) {
+      seconds += profile_t::kTollBoothCost;
+    }
+    return seconds;
+  }
+
+  // Penalty (seconds) of going through a border control, gate or toll booth
+  static float NodePenalty(const baldr::NodeInfo* node, const bool pred_toll,
+                           const bool toll) {
+    float penalty = 0.0f;
+    if (profile_t::kCountryCrossingPenalty > 0.0f &&
+        node->type() == baldr::NodeType::kBorderControl) {
+      penalty += profile_t::kCountryCrossingPenalty;
+    }
+    if (profile_t::kGatePenalty > 0.0f && node->type() == baldr::NodeType::kGate) {
+      penalty += profile_t::kGatePenalty;
+    }
+    if (profile_t::kTollBoothPenalty > 0.0f &&
+        (node->type() == baldr::NodeType::kTollBooth || (!pred_toll && toll))) {
+      penalty += profile_t::kTollBoothPenalty;
+    }
+    return penalty;
+  }
+
+  // Penalties (seconds) without any time cost of taking the edge
+  float EdgePenalty(const baldr::DirectedEdge* edge, const baldr::NodeInfo* node,
+                    const uint32_t idx, const bool pred_destonly,
+                    const baldr::Use pred_use) const {
+    float penalty = 0.0f;
+    if (profile_t::kDestinationOnlyPenalty > 0.0f && allow_destination_only_ &&
+        !pred_destonly && edge->destonly()) {
+      penalty += profile_t::kDestinationOnlyPenalty;
+    }
+    if (profile_t::kAlleyPenalty > 0.0f && pred_use != baldr::Use::kAlley &&
+        edge->use() == baldr::Use::kAlley) {
+      penalty += profile_t::kAlleyPenalty;
+    }
+    // Ignore name inconsistency when entering a link to avoid double penalizing.
+    if (profile_t::kManeuverPenalty > 0.0f && !edge->link() &&
+        !node->name_consistency(idx, edge->localedgeidx())) {
+      penalty += profile_t::kManeuverPenalty;
+    }
+    if (profile_t::kLowClassPenalty > 0.0f &&
+        (edge->classification() == baldr::RoadClass::kResidential ||
+         edge->classification() == baldr::RoadClass::kServiceOther)) {
+      penalty += profile_t::kLowClassPenalty;
+    }
+    return penalty;
+  }
+};
+
+/**
+ * Create the truck costing of a profile
+ * @param  config  Json object with configuration / options.
+ */
+template <class profile_t>
+cost_ptr_t CreateProfileTruckCost(const rapidjson::Value& config) {
+  return std::make_shared<ProfileTruckCost<profile_t>>(config);
+}
+
+}
+}
+
+#endif  // VALHALLA_SIF_TRUCKPROFILE_H_
@@ -0,0 +1,53 @@
+#ifndef VALHALLA_SIF_TURNCOSTS_H_
+#define VALHALLA_SIF_TURNCOSTS_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include <valhalla/baldr/turn.h>
+
+namespace valhalla {
+namespace sif {
+
+/**
+ * The cost of a turn for each turn class (see DirectedEdge::turn_class), so
+ * costing a transition looks the cost up rather than picking between the
+ * tables of the driving sides and the crossing cost for every one.
+ */
+class TurnCosts {
+ public:
+  /**
+   * Constructor.
+   * @param  right     Turn costs by turn type when driving on the right.
+   * @param  left      Turn costs by turn type when driving on the left.
+   * @param  crossing  Cost of a turn with edges both to its left and right.
+   * @param  at_least  When true a crossing only raises the cost of a turn to
+   *                   the crossing cost, otherwise it is the cost of the turn.
+   */
+  TurnCosts(const float (&right)[8], const float (&left)[8],
+            const float crossing, const bool at_least = false) {
+    for (uint32_t type = 0; type < 8; type++) {
+      costs_[type] = right[type];
+      costs_[type | 8] = at_least ? std::max(right[type], crossing) : crossing;
+      costs_[type | 16] = left[type];
+      costs_[type | 24] = at_least ? std::max(left[type], crossing) : crossing;
+    }
+  }
+
+  /**
+   * Get the cost of a turn.
+   * @param  turn_class  Turn class of the transition.
+   * @return Returns the cost of the turn.
+   */
+  float operator[](const uint32_t turn_class) const {
+    return costs_[turn_class];
+  }
+
+ protected:
+  float costs_[baldr::Turn::kClassCount];
+};
+
+}
+}
+
+#endif  // VALHALLA_SIF_TURNCOSTS_H_
@@ -0,0 +1,76 @@
+#ifndef __VALHALLA_BLOCK_HGT_H__
+#define __VALHALLA_BLOCK_HGT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace valhalla {
+  namespace skadi {
+
+    /*
+     * The .hgt.blk format stores an srtmgl1 tile split into square blocks of pixels
+     * that are each lz4hc compressed on their own so that a lookup only has to
+     * decompress the blocks it touches. The file starts with a header, followed by
+     * the offset of each block (and one past the last) from the start of the file
+     * and then the blocks themselves. Blocks go from the upper left to the bottom
+     * right and the ones on the right and bottom edges are narrower/shorter. Since
+     * the header and offsets are at the front a reader can also fetch just them
+     * and then the blocks it needs with range requests.
+     */
+    namespace block_hgt {
+
+      //how many pixels wide and tall a block is
+      constexpr size_t kBlockDim = 256;
+      //how many blocks there are in each row and column
+      constexpr size_t kBlocksPerSide = (3601 + kBlockDim - 1) / kBlockDim;
+      constexpr size_t kBlockCount = kBlocksPerSide * kBlocksPerSide;
+
+      struct header_t {
+        char magic[4];
+        uint32_t version;
+        uint32_t block_dim;
+        uint32_t block_count;
+      };
+
+      /*
+       * Compresses a whole tile into the blocked format
+       *
+       * @param  tile   the 3601 * 3601 pixels of the tile
+       * @param  level  the lz4hc compression level
+       * @return the contents of the .hgt.blk file
+       */
+      std::vector<char> pack(const int16_t* tile, int level = 9);
+
+      /*
+       * @param  data  the contents of a .hgt.blk file
+       * @param  size  the size of the file
+       * @return whether the header and the block offsets are consistent with the size
+       */
+      bool valid(const char* data, size_t size);
+
+      /*
+       * @param  x  the column of a pixel
+       * @param  y  the row of a pixel
+       * @return the block the pixel is in
+       */
+      inline size_t block(size_t x, size_t y) {
+        return (y / kBlockDim) * kBlocksPerSide + x / kBlockDim;
+      }
+
+      /*
+       * Decompresses one block into its place in the tile, throws if its corrupt
+       *
+       * @param  data   the contents of a valid .hgt.blk file
+       * @param  block  the block to decompress
+       * @param  tile   the 3601 * 3601 pixels of the tile to decompress into
+       */
+      void unpack(const char* data, size_t block, int16_t* tile);
+
+    }
+
+  }
+}
+
+
+#endif //__VALHALLA_BLOCK_HGT_H__
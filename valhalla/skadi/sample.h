@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -15,18 +16,39 @@ namespace valhalla {
 
     class sample{
      public:
+      //how many decompressed tiles are cached by default
+      static constexpr size_t kDefaultCacheSize = 4;
+
       //non-default-constructable and non-copyable
       sample() = delete;
-      sample(sample&&) = default;
-      sample& operator=(sample&&) = default;
+      sample(sample&&);
+      sample& operator=(sample&&);
       sample(const sample&) = delete;
       sample& operator=(const sample&) = delete;
 
       /**
        * Constructor
        * @param data_source  directory name of the datasource from which to sample
+       * @param cache_size   how many decompressed tiles to keep around at once, each
+       *                     one is about 25MB
+       */
+      sample(const std::string& data_source, size_t cache_size = kDefaultCacheSize);
+
+      /**
+       * Constructor for another sampler of the same datasource. The mapped tiles
+       * are shared with the other one but the decompressed tiles are not, so that
+       * threads sampling different areas (say while building tiles) each keep their
+       * own tiles rather than pushing each others out of a shared cache
+       * @param other       the sampler whose mapped tiles to share
+       * @param cache_size  how many decompressed tiles to keep around at once, each
+       *                    one is about 25MB
+       */
+      sample(const sample& other, size_t cache_size);
+
+      /**
+       * Destructor
        */
-      sample(const std::string& data_source);
+      ~sample();
 
       /**
        * Get a single sample from the datasource
@@ -47,13 +69,32 @@ namespace valhalla {
        */
       static double get_no_data_value();
 
+      /**
+       * Gets the sampler of a datasource. There is one per datasource per process
+       * so every worker shares the same mappings and decompressed tiles
+       * @param data_source  directory name of the datasource from which to sample
+       * @param cache_size   how many decompressed tiles to keep around at once, the
+       *                     first caller decides
+       */
+      static std::shared_ptr<const sample> get_instance(const std::string& data_source,
+                                                        size_t cache_size = kDefaultCacheSize);
+
      protected:
 
       /**
+       * Gets the data of a tile, decompressing it if its not already in the
+       * cache. The returned pointer keeps the data alive even if another
+       * thread pushes the tile out of the cache while its being used
+       *
        * @param  index  the index of the data tile being requested
+       * @param  u      the fractional pixel columns that will be interpolated
+       * @param  v      the fractional pixel rows that will be interpolated
+       * @param  count  how many of them there are, for tiles stored in blocks only
+       *                the blocks under them are decompressed, or all if there are none
        * @return the array of data or nullptr if there was none
        */
-      const int16_t* source(uint16_t index) const;
+      std::shared_ptr<const int16_t> source(uint16_t index, const double* u = nullptr,
+                                            const double* v = nullptr, size_t count = 0) const;
 
       /**
        * maps a new source, used at start up and called periodically
@@ -64,15 +105,21 @@ namespace valhalla {
        * @param  file   the file name of the data tile being mapped
        * @return none
        */
-      enum class format_t{ UNKNOWN = 0, GZIP = 1, LZ4HC = 2, RAW = 3 };
+      enum class format_t{ UNKNOWN = 0, GZIP = 1, LZ4HC = 2, BLOCKS = 3, RAW = 4 };
       void map(uint16_t index, format_t format, const std::string& file);
 
-      //using memory maps
-      mutable std::vector<std::pair<format_t, midgard::mem_map<char> > > mapped_cache;
-
-      //TODO: make an LRU
-      using unzipped_t = std::pair<int16_t, std::vector<int16_t> >;
-      mutable unzipped_t unzipped_cache;
+      //using memory maps, shared by the samplers of a datasource. lazily loaded
+      //tiles are mapped while holding the mutex
+      struct mapped_t {
+        mapped_t(size_t count): tiles(count) {}
+        std::mutex mutex;
+        std::vector<std::pair<format_t, midgard::mem_map<char> > > tiles;
+      };
+      std::shared_ptr<mapped_t> mapped_cache;
+
+      //least recently used decompressed tiles, shared between threads
+      struct cache_t;
+      std::unique_ptr<cache_t> unzipped_cache;
 
       std::string data_source;
     };
@@ -11,11 +11,14 @@
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/sif/hierarchylimits.h>
+#include <valhalla/sif/staticcost.h>
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/memorybudget.h>
 #include <valhalla/thor/pathinfo.h>
 #include <valhalla/thor/pathalgorithm.h>
 
@@ -73,6 +76,24 @@ class AStarPathAlgorithm : public PathAlgorithm {
     max_label_count_ = max_count;
   }
 
+  /**
+   * Set the landmark tables to use in the A* heuristic. They are only used
+   * for searches that aren't time dependent.
+   * @param  landmarks  Landmark tables of the costing, may be null when the
+   *                    costing options don't match the ones they were
+   *                    built for
+   */
+  void set_landmarks(const std::shared_ptr<const baldr::Landmarks>& landmarks) {
+    landmarks_ = landmarks;
+  }
+
+  /**
+   * @return Returns the landmark tables in use, may be null
+   */
+  const std::shared_ptr<const baldr::Landmarks>& landmarks() const {
+    return landmarks_;
+  }
+
  protected:
   uint32_t max_label_count_;    // Max label count to allow
   sif::TravelMode mode_;        // Current travel mode
@@ -81,14 +102,20 @@ class AStarPathAlgorithm : public PathAlgorithm {
   // Hierarchy limits.
   std::vector<sif::HierarchyLimits> hierarchy_limits_;
 
-  // A* heuristic
+  // A* heuristic and the landmark tables it may use
   AStarHeuristic astarheuristic_;
+  std::shared_ptr<const baldr::Landmarks> landmarks_;
 
   // Current costing mode
   std::shared_ptr<sif::DynamicCost> costing_;
 
+  // Expansion instantiated for the class of the current costing
+  void (AStarPathAlgorithm::*expand_forward_)(baldr::GraphReader&, const baldr::GraphId&,
+           const sif::EdgeLabel&, const uint32_t, const bool, const odin::Location&,
+           std::pair<int32_t, float>&);
+
   // Vector of edge labels (requires access by index).
-  std::vector<sif::EdgeLabel> edgelabels_;
+  Labels<sif::EdgeLabel> edgelabels_;
 
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
@@ -99,6 +126,11 @@ class AStarPathAlgorithm : public PathAlgorithm {
   // Destinations, id and cost
   std::map<uint64_t, sif::Cost> destinations_;
 
+  // When departing at a time the search is time dependent, historical speeds
+  // are looked up at the time of the week the search gets to each edge
+  bool time_dependent_;
+  uint32_t origin_second_of_week_;
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
@@ -109,14 +141,19 @@ class AStarPathAlgorithm : public PathAlgorithm {
   /**
    * Modify hierarchy limits based on distance between origin and destination
    * and the relative road density at the destination. For shorter routes
-   * we stay on arterial roads further from the destination. Also for lower
-   * road densities near the destination the hierarchy transition distances
-   * are increased.
+   * we stay on arterial roads further from the destination. The road
+   * density near the destination is taken into account by the hierarchy
+   * limits factors of the destination tiles, see ScaleHierarchyLimits.
    * @param   dist     Distance between origin and destination.
    * @param   density  Relative road density near the destination.
    */
   void ModifyHierarchyLimits(const float dist, const uint32_t density);
 
+  /**
+   * Pick the expansion instantiated for the class of the costing.
+   */
+  void SetExpansion();
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
@@ -130,6 +167,7 @@ class AStarPathAlgorithm : public PathAlgorithm {
    *                         edge.
    * @param   dest        Location information of the destination.
    */
+  template <class cost_t>
   void ExpandForward(baldr::GraphReader& graphreader,
                      const baldr::GraphId& node, const sif::EdgeLabel& pred,
                      const uint32_t pred_idx, const bool from_transition,
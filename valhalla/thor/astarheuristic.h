@@ -1,6 +1,11 @@
 #ifndef VALHALLA_THOR_ASTARHEURISTIC_H_
 #define VALHALLA_THOR_ASTARHEURISTIC_H_
 
+#include <algorithm>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/midgard/distanceapproximator.h>
 #include <valhalla/midgard/pointll.h>
 #include <valhalla/midgard/util.h>
@@ -10,7 +15,9 @@ namespace thor {
 
 /**
  * Class to calculate A* cost heuristics based on distances of nodes from
- * a destination within the shortest path computation.
+ * a destination within the shortest path computation. With landmark tables
+ * the heuristic is the larger of the distance based estimate and the
+ * landmark lower bound.
  */
 class AStarHeuristic {
  public:
@@ -19,7 +26,9 @@ class AStarHeuristic {
    */
   AStarHeuristic()
      : costfactor_(1.0f),
-       distapprox_({}) {
+       distapprox_({}),
+       landmarks_(nullptr),
+       reverse_(false) {
   }
 
   /**
@@ -35,6 +44,39 @@ class AStarHeuristic {
   void Init(const midgard::PointLL& ll, const float factor) {
     distapprox_.SetTestPoint(ll);
     costfactor_ = factor;
+    landmarks_ = nullptr;
+    targets_.clear();
+  }
+
+  /**
+   * Use landmark tables for the heuristic, must be called after Init. The
+   * estimate is the least landmark lower bound to any of the target nodes,
+   * if the tables don't have one of them they aren't used at all.
+   * @param  landmarks  Landmark tables of the costing, can be null
+   * @param  targets    Graph nodes the path can end at: the start nodes of
+   *                    the destination edges, or for a search from the
+   *                    destination the end nodes of the origin edges
+   * @param  reverse    True if the search goes towards the origin and the
+   *                    bounds are for paths from the targets
+   */
+  void SetLandmarks(const baldr::Landmarks* landmarks,
+                    const std::vector<baldr::GraphId>& targets,
+                    const bool reverse) {
+    landmarks_ = nullptr;
+    targets_.clear();
+    if (landmarks == nullptr || landmarks->landmark_count() == 0 || targets.empty())
+      return;
+    for (const auto& target : targets) {
+      uint32_t node = target.Is_Valid() ? landmarks->node(target) :
+                                          baldr::kInvalidLandmarkNode;
+      if (node == baldr::kInvalidLandmarkNode) {
+        targets_.clear();
+        return;
+      }
+      targets_.push_back(node);
+    }
+    landmarks_ = landmarks;
+    reverse_ = reverse;
   }
 
   /**
@@ -79,10 +121,39 @@ class AStarHeuristic {
     return  dist * costfactor_;
   }
 
+  /**
+   * Get the A* heuristic of a graph node at the lat,lng. Uses the landmark
+   * tables when they are set. Returns the distance via an argument, it is
+   * the distance to the destination either way.
+   * @param   node  Graph node
+   * @param   ll    Lat,lng of the node
+   * @param   distance  Distance (meters) to the destination.
+   * @return  Returns an estimate of the cost to the destination.
+   *          For A* shortest path this MUST UNDERESTIMATE the true cost.
+   */
+  float Get(const baldr::GraphId& node, const midgard::PointLL& ll, float& dist) const {
+    float estimate = Get(ll, dist);
+    if (landmarks_ != nullptr) {
+      uint32_t n = landmarks_->node(node);
+      if (n != baldr::kInvalidLandmarkNode) {
+        float bound = baldr::kUnreachableLandmark;
+        for (const auto target : targets_) {
+          bound = std::min(bound, reverse_ ? landmarks_->LowerBound(target, n) :
+                                             landmarks_->LowerBound(n, target));
+        }
+        estimate = std::max(estimate, bound);
+      }
+    }
+    return estimate;
+  }
+
  private:
   midgard::DistanceApproximator distapprox_;  // Distance approximation
   float costfactor_;    // Cost factor - ensures the cost estimate
                         // underestimates the true cost.
+  const baldr::Landmarks* landmarks_;  // Landmark tables, null if unused
+  std::vector<uint32_t> targets_;      // Landmark node indexes of the targets
+  bool reverse_;                       // Bounds are from the targets
 };
 
 }
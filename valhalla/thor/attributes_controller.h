@@ -3,6 +3,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace valhalla {
 namespace thor {
@@ -112,6 +113,7 @@ const std::string kConfidenceScore = "confidence_score";
 const std::string kRawScore = "raw_score";
 
 // Categories
+const std::string kEdgeCategory = "edge.";
 const std::string kNodeCategory = "node.";
 const std::string kAdminCategory = "admin.";
 const std::string kMatchedCategory = "matched.";
@@ -124,9 +126,16 @@ struct AttributesController {
 
   /*
    * Attributes that are required by the route action to make guidance instructions.
+   * Those only trace_attributes reports, like grades, lane connectivity, traffic
+   * segments and the matched points, are off so building a route's path skips them.
    */
   static const std::unordered_map<std::string, bool> kRouteAttributes;
 
+  /*
+   * Edge and node attributes that a path built columnar keeps, see TripPath.Columns.
+   */
+  static const std::unordered_set<std::string> kColumnAttributes;
+
   /*
    * Constructor that will use the route attributes by default.
    */
@@ -149,7 +158,17 @@ struct AttributesController {
    */
   bool category_attribute_enabled(const std::string& category) const;
 
+  /**
+   * Returns true if the columns of a path have every edge and node attribute
+   * that is enabled, false otherwise.
+   */
+  bool columns_suffice() const;
+
   std::unordered_map<std::string, bool> attributes;
+
+  // Build paths with their edges in columns rather than nodes. The other
+  // edge and node attributes are only used to make the path level ones
+  bool columnar;
 };
 
 }
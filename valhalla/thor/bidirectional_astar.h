@@ -5,15 +5,19 @@
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <memory>
 
 #include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/landmarks.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/sif/hierarchylimits.h>
+#include <valhalla/sif/staticcost.h>
 #include <valhalla/thor/pathalgorithm.h>
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/memorybudget.h>
 #include <valhalla/proto/tripcommon.pb.h>
 
 namespace valhalla {
@@ -29,6 +33,16 @@ struct CandidateConnection {
   float cost;
 };
 
+// Alternate paths may cost at most this fraction more than the best path
+constexpr float kAlternateMaxStretch = 0.25f;
+
+// Most of the length of an alternate path that may be shared with the best
+// path and the alternates found before it
+constexpr float kAlternateMaxSharing = 0.6f;
+
+// Candidate connections formed into paths for each alternate asked for
+constexpr uint32_t kAlternateCandidatesPerPath = 16;
+
 /**
  * Bidirectional A* algorithm. Method for finding least-cost path.
  */
@@ -60,12 +74,55 @@ class BidirectionalAStar : public PathAlgorithm {
            const std::shared_ptr<sif::DynamicCost>* mode_costing,
            const sif::TravelMode mode);
 
+  /**
+   * Set the number of alternate paths the next search should be able to
+   * find. The search continues a little further past the first connection
+   * so the trees overlap enough to hold alternates.
+   * @param  alternates  Number of alternate paths, 0 for none.
+   */
+  void set_alternates(const uint32_t alternates) {
+    alternates_ = alternates;
+  }
+
+  /**
+   * Set the landmark tables to use in the A* heuristics of both searches.
+   * @param  landmarks  Landmark tables of the costing, may be null when the
+   *                    costing options don't match the ones they were
+   *                    built for
+   */
+  void set_landmarks(const std::shared_ptr<const baldr::Landmarks>& landmarks) {
+    landmarks_ = landmarks;
+  }
+
+  /**
+   * Form alternate paths from the forward and reverse search trees of the
+   * last call to GetBestPath, without searching again. Every connection
+   * where the trees met is a candidate path through that edge. Candidates
+   * are taken cheapest first if they cost at most kAlternateMaxStretch more
+   * than the best path, share at most kAlternateMaxSharing of their length
+   * with the paths kept so far and do not use an edge twice. Candidates
+   * whose connecting edge lies on a path already formed are skipped, since
+   * the trees mostly give back the same path for it.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  best_path    Best path returned by GetBestPath.
+   * @return  Returns up to the number of alternates set, cheapest first.
+   */
+  std::vector<std::vector<PathInfo>> GetAlternatePaths(
+           baldr::GraphReader& graphreader,
+           const std::vector<PathInfo>& best_path);
+
   /**
    * Clear the temporary information generated during path construction.
    */
   void Clear();
 
  protected:
+  // Number of alternate paths asked for
+  uint32_t alternates_;
+
+  // Every connection between the trees, kept when alternates are asked for
+  std::vector<CandidateConnection> connections_;
+
   // Access mode used by the costing method
   uint32_t access_mode_;
 
@@ -78,6 +135,12 @@ class BidirectionalAStar : public PathAlgorithm {
   // Current costing mode
   std::shared_ptr<sif::DynamicCost> costing_;
 
+  // Expansions instantiated for the class of the current costing
+  void (BidirectionalAStar::*expand_forward_)(baldr::GraphReader&, const baldr::GraphId&,
+           const sif::BDEdgeLabel&, const uint32_t, const bool);
+  void (BidirectionalAStar::*expand_reverse_)(baldr::GraphReader&, const baldr::GraphId&,
+           const sif::BDEdgeLabel&, const uint32_t, const baldr::DirectedEdge*, const bool);
+
   // Hierarchy limits
   std::vector<sif::HierarchyLimits> hierarchy_limits_forward_;
   std::vector<sif::HierarchyLimits> hierarchy_limits_reverse_;
@@ -86,10 +149,16 @@ class BidirectionalAStar : public PathAlgorithm {
   float cost_diff_;
   AStarHeuristic astarheuristic_forward_;
   AStarHeuristic astarheuristic_reverse_;
+  std::shared_ptr<const baldr::Landmarks> landmarks_;
 
   // Vector of edge labels (requires access by index).
-  std::vector<sif::BDEdgeLabel> edgelabels_forward_;
-  std::vector<sif::BDEdgeLabel> edgelabels_reverse_;
+  Labels<sif::BDEdgeLabel> edgelabels_forward_;
+  Labels<sif::BDEdgeLabel> edgelabels_reverse_;
+
+  // Transition cost onto the edge of each edge label, by the same index.
+  // Only read where the searches connect and when forming the path.
+  std::vector<sif::Cost> transitions_forward_;
+  std::vector<sif::Cost> transitions_reverse_;
 
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_forward_;
@@ -99,7 +168,8 @@ class BidirectionalAStar : public PathAlgorithm {
   std::shared_ptr<EdgeStatus> edgestatus_forward_;
   std::shared_ptr<EdgeStatus> edgestatus_reverse_;
 
-  // Best candidate connection and threshold to extend search.
+  // Best candidate connection and threshold to extend search when
+  // looking for alternates.
   uint32_t threshold_;
   CandidateConnection best_connection_;
 
@@ -112,9 +182,15 @@ class BidirectionalAStar : public PathAlgorithm {
    */
   void Init(const PointLL& origll, const PointLL& destll);
 
+  /**
+   * Pick the expansions instantiated for the class of the costing.
+   */
+  void SetExpansion();
+
   /**
    * Expand from the node along the forward search path.
    */
+  template <class cost_t>
   void ExpandForward(baldr::GraphReader& graphreader,
            const baldr::GraphId& node, const sif::BDEdgeLabel& pred,
            const uint32_t pred_idx, const bool from_transition);
@@ -122,6 +198,7 @@ class BidirectionalAStar : public PathAlgorithm {
   /**
    * Expand from the node along the reverse search path.
    */
+  template <class cost_t>
   void ExpandReverse(baldr::GraphReader& graphreader,
            const baldr::GraphId& node, const sif::BDEdgeLabel& pred,
            const uint32_t pred_idx, const baldr::DirectedEdge* opp_pred_edge,
@@ -148,17 +225,19 @@ class BidirectionalAStar : public PathAlgorithm {
    * The edge on the forward search connects to a reached edge on the reverse
    * search tree. Check if this is the best connection so far and set the
    * search threshold.
-   * @param  pred  Edge label of the predecessor.
+   * @param  pred      Edge label of the predecessor.
+   * @param  pred_idx  Index of the predecessor edge label.
    */
-  void SetForwardConnection(const sif::BDEdgeLabel& pred);
+  void SetForwardConnection(const sif::BDEdgeLabel& pred, const uint32_t pred_idx);
 
   /**
    * The edge on the reverse search connects to a reached edge on the forward
    * search tree. Check if this is the best connection so far and set the
    * search threshold.
-   * @param  pred  Edge label of the predecessor.
+   * @param  pred      Edge label of the predecessor.
+   * @param  pred_idx  Index of the predecessor edge label.
    */
-  void SetReverseConnection(const sif::BDEdgeLabel& pred);
+  void SetReverseConnection(const sif::BDEdgeLabel& pred, const uint32_t pred_idx);
 
    /**
     * Form the path from the adjacency lists. Recovers the path from the
@@ -171,6 +250,15 @@ class BidirectionalAStar : public PathAlgorithm {
     *          destination - along with travel modes and elapsed time.
     */
   std::vector<PathInfo> FormPath(baldr::GraphReader& graphreader);
+
+  /**
+   * Form the path through a connection between the trees.
+   * @param   graphreader  Graph tile reader (for getting opposing edges).
+   * @param   connection   Connection where the forward and reverse paths meet.
+   * @return  Returns the path info ordered from origin to destination.
+   */
+  std::vector<PathInfo> FormPath(baldr::GraphReader& graphreader,
+                                 const CandidateConnection& connection);
 };
 
 }
@@ -0,0 +1,143 @@
+#ifndef VALHALLA_THOR_BUCKETMATRIX_H_
+#define VALHALLA_THOR_BUCKETMATRIX_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <valhalla/baldr/chgraph.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+#include <valhalla/proto/tripcommon.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Class to compute time distance matrices over a contraction hierarchy
+ * overlay with buckets. A reverse search up the hierarchy from each target
+ * leaves an entry with its cost in a bucket at every node it settles, then a
+ * forward search up the hierarchy from each source scans the buckets of the
+ * nodes it settles, the cheapest sum for each target being its connection.
+ * The searches only settle a few hundred nodes each and don't depend on one
+ * another so the targets and then the sources are split across threads.
+ * Like the overlay itself the matrix is only good for requests with the
+ * default costing options and it doesn't know about complex restrictions.
+ */
+class BucketMatrix {
+ public:
+  /**
+   * A node a search starts from. For a source it holds what it takes to get
+   * from the location to the end of its edge. For a target it holds what the
+   * rest of the edge past the location takes, negated, since the arcs onto
+   * the edge include all of it.
+   */
+  struct Seed {
+    uint32_t node;    // Node of the hierarchy (directed edge)
+    float cost;
+    float secs;
+    float length;
+  };
+
+  /**
+   * Cheapest connection between a source and a target.
+   */
+  struct Connection {
+    float cost;       // kMaxCost if there is none
+    float secs;
+    float length;
+  };
+
+  /**
+   * Constructor.
+   * @param  graph        Contraction hierarchy overlay of the costing
+   * @param  max_threads  Most threads to search with, 0 for one per core
+   */
+  BucketMatrix(const std::shared_ptr<const baldr::CHGraph>& graph,
+               const uint32_t max_threads = 0);
+
+  /**
+   * Destructor
+   */
+  virtual ~BucketMatrix() {}
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from origin index to all other locations
+   */
+  std::vector<TimeDistance> SourceToTarget(
+          const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+          const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+          baldr::GraphReader& graphreader,
+          const std::shared_ptr<sif::DynamicCost>* mode_costing,
+          const sif::TravelMode mode, const float max_matrix_distance);
+
+  /**
+   * Find the cheapest connection between every source and every target.
+   * @param  sources  Seeds of each source
+   * @param  targets  Seeds of each target
+   * @return Returns the connections from each source to all the targets
+   */
+  virtual std::vector<Connection> Connect(const std::vector<std::vector<Seed> >& sources,
+                                          const std::vector<std::vector<Seed> >& targets) const;
+
+ protected:
+  std::shared_ptr<const baldr::CHGraph> graph_;
+  uint32_t max_threads_;
+
+  /**
+   * Seeds of a location, at the edges it is on.
+   * @param  location     Location with its path edges
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing      Costing method
+   * @param  source       Whether the location is a source or a target
+   * @return Returns the seeds
+   */
+  std::vector<Seed> Seeds(const odin::Location& location, baldr::GraphReader& graphreader,
+                          const std::shared_ptr<sif::DynamicCost>& costing,
+                          const bool source) const;
+};
+
+/**
+ * Time distance matrices over a contraction hierarchy overlay for batches
+ * with thousands of sources and targets, where the buckets of the targets
+ * get too big to scan. The nodes above the targets are picked out of the
+ * overlay once and put in an order where every node comes after the higher
+ * ranked nodes it has arcs from, as one compact array of the arcs into each.
+ * Then for each source a search up the hierarchy is followed by a single
+ * pass down that array, which settles every picked node and so every target
+ * at once. The pass touches memory in order and costs the same for every
+ * source, the sources being split across threads.
+ */
+class SweepMatrix : public BucketMatrix {
+ public:
+  /**
+   * Constructor.
+   * @param  graph        Contraction hierarchy overlay of the costing
+   * @param  max_threads  Most threads to search with, 0 for one per core
+   */
+  SweepMatrix(const std::shared_ptr<const baldr::CHGraph>& graph,
+              const uint32_t max_threads = 0);
+
+  /**
+   * Find the cheapest connection between every source and every target.
+   * @param  sources  Seeds of each source
+   * @param  targets  Seeds of each target
+   * @return Returns the connections from each source to all the targets
+   */
+  std::vector<Connection> Connect(const std::vector<std::vector<Seed> >& sources,
+                                  const std::vector<std::vector<Seed> >& targets) const override;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_BUCKETMATRIX_H_
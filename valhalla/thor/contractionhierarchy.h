@@ -0,0 +1,116 @@
+#ifndef VALHALLA_THOR_CONTRACTIONHIERARCHY_H_
+#define VALHALLA_THOR_CONTRACTIONHIERARCHY_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/chgraph.h>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/proto/tripcommon.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Shortest path over a contraction hierarchy overlay built by mjolnir for
+ * one costing profile. Both searches only climb the hierarchy so a query
+ * settles a few hundred nodes where bidirectional A* settles hundreds of
+ * thousands of edges. The overlay holds the costs of the costing's default
+ * options so it may only be used for requests that don't change them.
+ * Returns an empty path when the path can't be found over the overlay or
+ * crosses a complex restriction (which the overlay doesn't model) so the
+ * caller can fall back to another algorithm.
+ */
+class ContractionHierarchy : public PathAlgorithm {
+ public:
+  /**
+   * Constructor.
+   */
+  ContractionHierarchy();
+
+  /**
+   * Destructor
+   */
+  virtual ~ContractionHierarchy();
+
+  /**
+   * Set the overlay to route over.
+   * @param  graph  the overlay, may be null when there is none
+   */
+  void set_graph(const std::shared_ptr<const baldr::CHGraph>& graph) {
+    graph_ = graph;
+  }
+
+  /**
+   * @return Returns the overlay being routed over, may be null
+   */
+  const std::shared_ptr<const baldr::CHGraph>& graph() const {
+    return graph_;
+  }
+
+  /**
+   * Form path between and origin and destination location using the supplied
+   * costing method.
+   * @param  origin       Origin location
+   * @param  dest         Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing Costing methods.
+   * @param  mode         Travel mode to use.
+   * @return Returns the path edges (and elapsed time/modes at end of
+   *          each edge).
+   */
+  std::vector<PathInfo> GetBestPath(odin::Location& origin,
+           odin::Location& dest, baldr::GraphReader& graphreader,
+           const std::shared_ptr<sif::DynamicCost>* mode_costing,
+           const sif::TravelMode mode) override;
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+  /**
+   * Find the cheapest path between any of the sources and any of the
+   * targets over the overlay.
+   * @param  sources  Source nodes and their initial costs
+   * @param  targets  Target nodes and the cost from the end of them to the
+   *                  destination (may be negative)
+   * @param  path     Filled with the nodes along the path, each with the
+   *                  elapsed time of the arc into it (0 for the source)
+   * @return Returns the cost of the path or a negative value if there is
+   *         no path
+   */
+  float Search(const std::vector<std::pair<uint32_t, float> >& sources,
+               const std::vector<std::pair<uint32_t, float> >& targets,
+               std::vector<std::pair<uint32_t, float> >& path);
+
+ protected:
+  // Search label of a node
+  struct label_t {
+    float cost;         // Cost from the sources (or to the targets)
+    uint32_t pred;      // Previous node of the search or kInvalidCHNode
+    baldr::CHArc arc;   // Arc between pred and the node
+  };
+  using queue_entry_t = std::pair<float, uint32_t>;
+  using queue_t = std::priority_queue<queue_entry_t, std::vector<queue_entry_t>,
+                                      std::greater<queue_entry_t> >;
+
+  std::shared_ptr<const baldr::CHGraph> graph_;
+  std::unordered_map<uint32_t, label_t> forward_;
+  std::unordered_map<uint32_t, label_t> reverse_;
+  queue_t forward_queue_;
+  queue_t reverse_queue_;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_CONTRACTIONHIERARCHY_H_
@@ -8,6 +8,7 @@
 #include <utility>
 #include <memory>
 #include <cstdint>
+#include <functional>
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
@@ -16,6 +17,9 @@
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/proto/tripcommon.pb.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/labelarena.h>
+#include <valhalla/thor/memorybudget.h>
+#include <valhalla/thor/search_stats.h>
 
 namespace valhalla {
 namespace thor {
@@ -101,8 +105,45 @@ class CostMatrix {
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param  label_arena  Arena to draw the per location edge label storage
+   *                      from, must outlive the matrix, may be null.
    */
-  CostMatrix();
+  CostMatrix(LabelArena* label_arena = nullptr);
+
+  /**
+   * Destructor. Gives the edge label storage back to the arena.
+   */
+  ~CostMatrix();
+
+  /**
+   * Expand the searches on more threads. Each round of the expansion the
+   * targets and then the sources take their next step in parallel, the
+   * connections and status updates that cross over to the other side are
+   * applied once every location is done with the round so the matrix comes
+   * out the same as it does on one thread.
+   * @param  readers  Graph readers for the extra threads, one each, not to be
+   *                  used by anything else while the matrix is formed.
+   */
+  void set_thread_readers(const std::vector<baldr::GraphReader*>& readers) {
+    thread_readers_ = readers;
+  }
+
+  /**
+   * Set a callback that will throw when the matrix computation should be aborted
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_interrupt(const std::function<void ()>* interrupt_callback) {
+    interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Set where the work done by the searches is added up when Clear is called
+   * @param stats  the statistics of the current request, null to stop counting
+   */
+  void set_stats(odin::SearchStats* stats) {
+    stats_ = stats;
+  }
 
   /**
    * Forms a time distance matrix from the set of source locations
@@ -138,6 +179,15 @@ class CostMatrix {
   // Current costing mode
   std::shared_ptr<sif::DynamicCost> costing_;
 
+  // Where edge label storage comes from, may be null
+  LabelArena* label_arena_;
+
+  // Called once in a while to see if the matrix should be aborted, may be null
+  const std::function<void ()>* interrupt_;
+
+  // Where search work is counted, null unless asked for
+  odin::SearchStats* stats_;
+
   // Number of source and target locations that can be expanded
   uint32_t source_count_;
   uint32_t remaining_sources_;
@@ -155,14 +205,17 @@ class CostMatrix {
   // source location (forward traversal)
   std::vector<std::vector<sif::HierarchyLimits>> source_hierarchy_limits_;
   std::vector<std::shared_ptr<baldr::DoubleBucketQueue>> source_adjacency_;
-  std::vector<std::vector<sif::BDEdgeLabel>> source_edgelabel_;
+  std::vector<Labels<sif::BDEdgeLabel>> source_edgelabel_;
   std::vector<EdgeStatus> source_edgestatus_;
 
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each
   // target location (reverse traversal)
   std::vector<std::vector<sif::HierarchyLimits>> target_hierarchy_limits_;
   std::vector<std::shared_ptr<baldr::DoubleBucketQueue>> target_adjacency_;
-  std::vector<std::vector<sif::BDEdgeLabel>> target_edgelabel_;
+  std::vector<Labels<sif::BDEdgeLabel>> target_edgelabel_;
+  // Transition cost onto the edge of each target edge label, only read
+  // when a source search connects to it
+  std::vector<std::vector<sif::Cost>> target_transition_;
   std::vector<EdgeStatus> target_edgestatus_;
 
   // Mark each target edge with a list of target indexes that have reached it
@@ -171,6 +224,22 @@ class CostMatrix {
   // List of best connections found so far
   std::vector<BestCandidate> best_connection_;
 
+  // Graph readers of the extra threads
+  std::vector<baldr::GraphReader*> thread_readers_;
+
+  // While the targets (or sources) take their steps in parallel the status
+  // of the other side and the edges the targets reach are only updated once
+  // the round is done, in location order
+  enum class Deferred : uint8_t { kNone, kSourceStatus, kTargetStatus };
+  struct StatusUpdate {
+    uint32_t source;
+    uint32_t target;
+    int threshold;
+  };
+  Deferred deferred_;
+  std::vector<std::vector<StatusUpdate>> deferred_updates_;
+  std::vector<std::vector<baldr::GraphId>> deferred_targets_;
+
   /**
    * Get the cost threshold based on the current mode and the max arc-length distance
    * for that mode.
@@ -205,7 +274,7 @@ class CostMatrix {
                      const baldr::NodeInfo* nodeinfo,
                      sif::BDEdgeLabel& pred, const uint32_t pred_idx,
                      std::vector<sif::HierarchyLimits>& hierarchy_limits,
-                     std::vector<sif::BDEdgeLabel>& edgelabels,
+                     Labels<sif::BDEdgeLabel>& edgelabels,
                      EdgeStatus& edgestate,
                      std::shared_ptr<baldr::DoubleBucketQueue>& adj,
                      const bool from_transition);
@@ -218,7 +287,8 @@ class CostMatrix {
                      sif::BDEdgeLabel& pred, const uint32_t pred_idx,
                      const baldr::DirectedEdge* opp_pred_edge,
                      std::vector<sif::HierarchyLimits>& hierarchy_limits,
-                     std::vector<sif::BDEdgeLabel>& edgelabels,
+                     Labels<sif::BDEdgeLabel>& edgelabels,
+                     std::vector<sif::Cost>& transitions,
                      EdgeStatus& edgestate,
                      std::shared_ptr<baldr::DoubleBucketQueue>& adj,
                      const bool from_transition);
@@ -240,6 +310,29 @@ class CostMatrix {
    */
   void UpdateStatus(const uint32_t source_, const uint32_t target);
 
+  /**
+   * Remove a target from the locations a source has left to find.
+   * @param  source     Source index
+   * @param  target     Target index
+   * @param  threshold  Steps the source has left once it found them all
+   */
+  void UpdateSourceStatus(const uint32_t source, const uint32_t target, const int threshold);
+
+  /**
+   * Remove a source from the locations a target has left to find.
+   * @param  source     Source index
+   * @param  target     Target index
+   * @param  threshold  Steps the target has left once it found them all
+   */
+  void UpdateTargetStatus(const uint32_t source, const uint32_t target, const int threshold);
+
+  /**
+   * Apply the status updates and reached edges that were deferred during
+   * a parallel part of a round.
+   * @param  count  Number of locations that took steps.
+   */
+  void ApplyDeferred(const uint32_t count);
+
   /**
    * Iterate the backward search from the target/destination location.
    * @param  index        Index of the target location.
@@ -1,13 +1,18 @@
 #ifndef VALHALLA_THOR_EDGESTATUS_H_
 #define VALHALLA_THOR_EDGESTATUS_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <unordered_map>
+#include <vector>
 #include <valhalla/baldr/graphid.h>
+#include <valhalla/thor/memorybudget.h>
 
 namespace valhalla {
 namespace thor {
 
-// Default size to reserve for the EdgeStatus unordered map
+// Default number of edge statuses kept allocated between searches
 constexpr uint32_t kDefaultEdgeStatusSize = 2000000;
 
 // Edge label status
@@ -45,23 +50,80 @@ struct EdgeStatusInfo {
 
 /**
  * Class to define / lookup the status and index of an edge in the edge label
- * list during shortest path algorithms.
+ * list during shortest path algorithms. The status is kept in a dense array
+ * per tile indexed by the directed edge's index within its tile. A tile's
+ * array is allocated the first time an edge in it is touched and grows to
+ * the highest edge index seen, so lookups are an array index rather than a
+ * hash and a pointer chase. The tiles touched since the last Init are kept
+ * in a list so that resetting for the next search only visits those.
  */
 class EdgeStatus {
  public:
   /**
-   * Constructor given an initial size.
-   * @param  sz  Size to reserve for edgestatus unordered map.
+   * Constructor given a retention size.
+   * @param  sz  Number of edge statuses that may be kept allocated between
+   *             calls to Init, beyond this the tiles are freed.
    */
-  EdgeStatus(const uint32_t sz = kDefaultEdgeStatusSize) {
-    edgestatus_.reserve(sz);
+  EdgeStatus(const uint32_t sz = kDefaultEdgeStatusSize)
+      : max_retained_(sz), allocated_(0), last_tile_(kNoTile), last_(nullptr) {
+  }
+
+  // The last tile looked up and the touched tiles point into this object's
+  // own map. Moving the map keeps its elements where they are.
+  EdgeStatus(const EdgeStatus& other)
+      : max_retained_(other.max_retained_), allocated_(other.allocated_),
+        edgestatus_(other.edgestatus_), last_tile_(kNoTile), last_(nullptr) {
+    for (auto& tile : edgestatus_)
+      if (tile.second.touched)
+        touched_.push_back(&tile.second);
+  }
+  EdgeStatus(EdgeStatus&& other)
+      : max_retained_(other.max_retained_), allocated_(other.allocated_),
+        edgestatus_(std::move(other.edgestatus_)), touched_(std::move(other.touched_)),
+        last_tile_(kNoTile), last_(nullptr) {
+    other.allocated_ = 0;
+    other.edgestatus_.clear();
+    other.touched_.clear();
+    other.last_tile_ = kNoTile;
+    other.last_ = nullptr;
+  }
+  EdgeStatus& operator=(EdgeStatus other) {
+    max_retained_ = other.max_retained_;
+    allocated_ = other.allocated_;
+    edgestatus_.swap(other.edgestatus_);
+    touched_.swap(other.touched_);
+    last_tile_ = kNoTile;
+    last_ = nullptr;
+    return *this;
   }
 
   /**
-   * Initialize the status to unreached for all edges.
+   * Initialize the status to unreached for all edges. Only the tiles touched
+   * since the last Init are reset, and they stay allocated for reuse unless
+   * more than the retention size is allocated.
    */
   void Init() {
-    edgestatus_.clear();
+    if (allocated_ > max_retained_) {
+      edgestatus_.clear();
+      allocated_ = 0;
+    } else {
+      for (auto* tile : touched_) {
+        std::fill(tile->status.begin(), tile->status.end(), EdgeStatusInfo());
+        tile->touched = false;
+      }
+    }
+    touched_.clear();
+    last_tile_ = kNoTile;
+    last_ = nullptr;
+  }
+
+  /**
+   * Get the number of edge statuses allocated, which stay allocated across
+   * Init as long as there are no more than the retention size.
+   * @return  Returns the number of edge statuses allocated.
+   */
+  size_t capacity() const {
+    return allocated_;
   }
 
   /**
@@ -72,7 +134,7 @@ class EdgeStatus {
    */
   void Set(const baldr::GraphId& edgeid, const EdgeSet set,
            const uint32_t index) {
-    edgestatus_[edgeid.value] = { set, index };
+    *Find(edgeid) = { set, index };
   }
 
   /**
@@ -81,7 +143,7 @@ class EdgeStatus {
    * @param  set      Label set for this directed edge.
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set) {
-    edgestatus_[edgeid.value].set_ = static_cast<uint32_t>(set);
+    Find(edgeid)->set_ = static_cast<uint32_t>(set);
   }
 
   /**
@@ -90,14 +152,89 @@ class EdgeStatus {
    * @return  Returns edge status info.
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid) const {
-    auto p = edgestatus_.find(edgeid.value);
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second;
+    const auto* status = Tile(TileKey(edgeid));
+    return (status == nullptr || edgeid.id() >= status->size()) ?
+        EdgeStatusInfo() : (*status)[edgeid.id()];
+  }
+
+  /**
+   * Get the status info of a directed edge given its GraphId without
+   * remembering its tile, so that several threads may look up edges at once
+   * as long as none are being set.
+   * @param   edgeid  GraphId of the directed edge.
+   * @return  Returns edge status info.
+   */
+  EdgeStatusInfo Peek(const baldr::GraphId& edgeid) const {
+    auto found = edgestatus_.find(TileKey(edgeid));
+    return (found == edgestatus_.end() || edgeid.id() >= found->second.status.size()) ?
+        EdgeStatusInfo() : found->second.status[edgeid.id()];
   }
 
  private:
-  // Map to store the status and index of GraphIds that have been encountered.
-  // Any unreached edges are not added to the map.
-  std::unordered_map<uint64_t, EdgeStatusInfo> edgestatus_;
+  // Statuses of the edges of a tile, counted against the memory budget
+  using statuses_t = std::vector<EdgeStatusInfo, BudgetAllocator<EdgeStatusInfo> >;
+
+  // Status of the edges in one tile and whether any were set since Init
+  struct TileStatus {
+    statuses_t status;
+    bool touched = false;
+  };
+
+  static constexpr uint32_t kNoTile = std::numeric_limits<uint32_t>::max();
+
+  static uint32_t TileKey(const baldr::GraphId& edgeid) {
+    return static_cast<uint32_t>(edgeid.Tile_Base().value);
+  }
+
+  // Get the statuses of a tile, remembering the last one since searches
+  // tend to stay within a tile for a while
+  const statuses_t* Tile(const uint32_t tile) const {
+    if (tile != last_tile_) {
+      auto found = edgestatus_.find(tile);
+      if (found == edgestatus_.end())
+        return nullptr;
+      // Only read through here but shared with Find which writes
+      last_tile_ = tile;
+      last_ = const_cast<TileStatus*>(&found->second);
+    }
+    return &last_->status;
+  }
+
+  // Get the status of an edge for writing, allocating as needed
+  EdgeStatusInfo* Find(const baldr::GraphId& edgeid) {
+    uint32_t tile = TileKey(edgeid);
+    if (tile != last_tile_) {
+      last_ = &edgestatus_[tile];
+      last_tile_ = tile;
+    }
+    if (!last_->touched) {
+      last_->touched = true;
+      touched_.push_back(last_);
+    }
+    auto& status = last_->status;
+    if (edgeid.id() >= status.size()) {
+      allocated_ -= status.capacity();
+      status.resize(std::max<size_t>(edgeid.id() + 1, status.size() * 2));
+      allocated_ += status.capacity();
+    }
+    return &status[edgeid.id()];
+  }
+
+  // Number of statuses that may stay allocated across Init and the number
+  // that are allocated
+  size_t max_retained_;
+  size_t allocated_;
+
+  // Statuses of the edges in each tile that has been encountered, keyed by
+  // the tile's base GraphId. Any unreached edges are kUnreached.
+  std::unordered_map<uint32_t, TileStatus> edgestatus_;
+
+  // The tiles with edges set since Init
+  std::vector<TileStatus*> touched_;
+
+  // The last tile looked up
+  mutable uint32_t last_tile_;
+  mutable TileStatus* last_;
 };
 
 }
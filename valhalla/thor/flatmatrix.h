@@ -0,0 +1,88 @@
+#ifndef VALHALLA_THOR_FLATMATRIX_H_
+#define VALHALLA_THOR_FLATMATRIX_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <valhalla/baldr/flatgraph.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/bucketmatrix.h>
+#include <valhalla/thor/costmatrix.h>
+#include <valhalla/proto/tripcommon.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Class to compute time distance matrices of offline batch jobs over a flat
+ * graph snapshot. Each source is searched from with a plain dijkstra over
+ * its arrays, the graph reader only being needed to seed the locations, and
+ * the sources are split across threads. The snapshot holds the costs of the
+ * costing's default options and stops at the edge of its region, so paths
+ * leaving the region aren't found, and it doesn't know about complex
+ * restrictions.
+ */
+class FlatMatrix {
+ public:
+  using Seed = BucketMatrix::Seed;
+  using Connection = BucketMatrix::Connection;
+
+  /**
+   * Constructor.
+   * @param  graph        Flat graph of the costing
+   * @param  max_threads  Most threads to search with, 0 for one per core
+   */
+  FlatMatrix(const std::shared_ptr<const baldr::FlatGraph>& graph,
+             const uint32_t max_threads = 0);
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from origin index to all other locations
+   */
+  std::vector<TimeDistance> SourceToTarget(
+          const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+          const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+          baldr::GraphReader& graphreader,
+          const std::shared_ptr<sif::DynamicCost>* mode_costing,
+          const sif::TravelMode mode, const float max_matrix_distance);
+
+  /**
+   * Find the cheapest connection between every source and every target.
+   * The seeds are the same as those of the bucket matrix.
+   * @param  sources  Seeds of each source
+   * @param  targets  Seeds of each target
+   * @return Returns the connections from each source to all the targets
+   */
+  std::vector<Connection> Connect(const std::vector<std::vector<Seed> >& sources,
+                                  const std::vector<std::vector<Seed> >& targets) const;
+
+ protected:
+  std::shared_ptr<const baldr::FlatGraph> graph_;
+  uint32_t max_threads_;
+
+  /**
+   * Seeds of a location, at the edges it is on.
+   * @param  location     Location with its path edges
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing      Costing method
+   * @param  source       Whether the location is a source or a target
+   * @return Returns the seeds
+   */
+  std::vector<Seed> Seeds(const odin::Location& location, baldr::GraphReader& graphreader,
+                          const std::shared_ptr<sif::DynamicCost>& costing,
+                          const bool source) const;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_FLATMATRIX_H_
@@ -1,7 +1,10 @@
 #ifndef VALHALLA_THOR_ISOCHRONE_H_
 #define VALHALLA_THOR_ISOCHRONE_H_
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
 #include <map>
 #include <unordered_map>
@@ -16,11 +19,16 @@
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/memorybudget.h>
+#include <valhalla/thor/search_stats.h>
 #include <valhalla/proto/tripcommon.pb.h>
 
 namespace valhalla {
 namespace thor {
 
+// How long a worker keeps the expansion of its last isochrone by default
+constexpr uint32_t kDefaultIsochroneCacheSeconds = 60;
+
 /**
  * Algorithm to generate an isochrone as a lat,lon grid with time taken to
  * each each grid point. This gridded data can then be contoured to create
@@ -30,14 +38,48 @@ class Isochrone {
  public:
   /**
    * Constructor.
+   * @param  cache_seconds  How long the forward expansion of Compute is kept
+   *                        for a later request with the same cache key, 0
+   *                        keeps nothing between requests.
    */
-  Isochrone();
+  Isochrone(const uint32_t cache_seconds = 0);
 
   /**
    * Destructor
    */
   virtual ~Isochrone();
 
+  /**
+   * Set a callback that will throw when the expansion should be aborted
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_interrupt(const std::function<void ()>* interrupt_callback) {
+    interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Add the size of the expansion the last isochrone was drawn from to the
+   * statistics of a request. An expansion carried on from an earlier request
+   * counts in full again.
+   * @param stats  the statistics of the current request, may be null
+   */
+  void TallyStats(odin::SearchStats* stats) const {
+    AddSearchStats(stats, edgelabels_.size() + bdedgelabels_.size() + mmedgelabels_.size(),
+                   adjacencylist_.get());
+  }
+
+  /**
+   * Which origin each tile of the last forward isotile was reached from
+   * first, so one expansion from many origins draws the area nearest to each
+   * of them. Only kept when Compute had more than one origin.
+   * @return the index of the origin of each tile, the largest float where
+   *         nothing was reached, or null with a single origin.
+   */
+  std::shared_ptr<const GriddedData<midgard::PointLL> > Catchments() const {
+    return catchments_;
+  }
+
   /**
    * Clear the temporary memory (adjacency list, edgestatus, edgelabels)
    */
@@ -47,19 +89,25 @@ class Isochrone {
    * Compute an isochrone grid. This creates and populates a lat,lon grid with
    * time taken to reach each grid point. This gridded data is then contoured
    * so it can be output as polygons. Multiple locations are allowed as the
-   * origins - within some reasonable distance from each other.
+   * origins - within some reasonable distance from each other. When the
+   * cache key matches the one of the last call the expansion carries on from
+   * where that call stopped rather than starting over, so the key must
+   * change whenever the origins or the costing do.
    * @param  origin_locs  List of origin locations.
    * @param  max_minutes  Maximum time (minutes) for largest contour
    * @param  graphreader  Graphreader
    * @param  mode_costing List of costing objects
    * @param  mode         Travel mode
+   * @param  cache_key    Identifies the origins and costing, empty to not
+   *                      keep the expansion for later calls.
    */
   std::shared_ptr<const GriddedData<midgard::PointLL> > Compute(
           google::protobuf::RepeatedPtrField<valhalla::odin::Location>& origin_locs,
           const unsigned int max_minutes,
           baldr::GraphReader& graphreader,
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
-          const sif::TravelMode mode);
+          const sif::TravelMode mode,
+          const std::string& cache_key = "");
 
   // Compute iso-tile that we can use to generate isochrones. This is used for
   // the reverse direction - construct times for gridded data indicating how
@@ -99,9 +147,9 @@ class Isochrone {
   std::shared_ptr<sif::DynamicCost> costing_;
 
   // Vector of edge labels (requires access by index).
-  std::vector<sif::EdgeLabel> edgelabels_;
-  std::vector<sif::BDEdgeLabel> bdedgelabels_;
-  std::vector<sif::MMEdgeLabel> mmedgelabels_;
+  Labels<sif::EdgeLabel> edgelabels_;
+  Labels<sif::BDEdgeLabel> bdedgelabels_;
+  Labels<sif::MMEdgeLabel> mmedgelabels_;
 
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
@@ -112,6 +160,23 @@ class Isochrone {
   // Isochrone gridded time data
   std::shared_ptr<GriddedData<midgard::PointLL> > isotile_;
 
+  // With more than one origin, the origin each forward edge label leads back
+  // to and the origin each tile of the isotile was first reached from
+  bool track_origins_;
+  std::vector<uint32_t> label_origins_;
+  std::shared_ptr<GriddedData<midgard::PointLL> > catchments_;
+
+  // Called once in a while to see if the expansion should be aborted, may be null
+  const std::function<void ()>* interrupt_;
+
+  // Forward expansion kept between calls to Compute. The edge labels are
+  // listed in the order they were settled so the isotile of any time limit
+  // can be drawn again from them.
+  uint32_t cache_seconds_;
+  std::string cache_key_;
+  std::chrono::steady_clock::time_point cache_time_;
+  std::vector<uint32_t> settled_;
+
   /**
    * Initialize prior to computing the isochrones. Creates adjacency list,
    * edgestatus support, and reserves edgelabels.
@@ -165,10 +230,35 @@ class Isochrone {
    * @param  graphreader  Graph reader
    * @param  ll           Lat,lon at the end of the edge.
    * @param  secs0        Seconds at start of the edge.
+   * @param  origin       Index of the origin the edge was reached from.
    */
   void UpdateIsoTile(const sif::EdgeLabel& pred,
                      baldr::GraphReader& graphreader,
-                     const midgard::PointLL& ll, const float secs0);
+                     const midgard::PointLL& ll, const float secs0,
+                     const uint32_t origin = 0);
+
+  /**
+   * Marks a tile of the isotile if the time is less than what it has, and
+   * which origin it was reached from when that is tracked.
+   * @param  tile_id  Tile of the isotile.
+   * @param  minutes  Minutes to reach the tile.
+   * @param  origin   Index of the origin the tile was reached from.
+   */
+  void MarkIsoTile(const int tile_id, const float minutes, const uint32_t origin) {
+    if (isotile_->SetIfLessThan(tile_id, minutes) && catchments_) {
+      catchments_->Set(tile_id, origin);
+    }
+  }
+
+  /**
+   * Draws the isotile again from the edges settled by the cached forward
+   * expansion, in the order they were settled so that it comes out the same
+   * as it would from a new expansion.
+   * @param  graphreader  Graph reader
+   * @param  max_seconds  Time limit of the isotile.
+   * @return true if the time limit was met, else the expansion has to go on.
+   */
+  bool ReplayIsoTile(baldr::GraphReader& graphreader, const uint32_t max_seconds);
 
   /**
    * Add edge(s) at each origin location to the adjacency list.
@@ -0,0 +1,254 @@
+#ifndef VALHALLA_THOR_LABELARENA_H_
+#define VALHALLA_THOR_LABELARENA_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <valhalla/thor/edgestatus.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default number of bytes of edge label storage kept between requests
+constexpr size_t kDefaultLabelArenaSize = 268435456; // 256 megs
+
+/**
+ * Pool of edge label vectors that lets path algorithms reuse the storage of
+ * previous requests rather than allocating and freeing it every time. The
+ * storage of released vectors is kept until Trim is called, so within a
+ * request (say a matrix with many sources) the pool grows to its high water
+ * mark and the next request reuses it. Edge statuses are pooled the same
+ * way, keeping the per tile arrays of the tiles they touched. An arena is
+ * not thread safe, each worker thread should own one.
+ */
+class LabelArena {
+ public:
+  /**
+   * Constructor.
+   * @param  max_size  Bytes of released label storage Trim keeps around.
+   */
+  LabelArena(const size_t max_size = kDefaultLabelArenaSize)
+      : max_size_(max_size), size_(0) {
+  }
+
+  LabelArena(const LabelArena&) = delete;
+  LabelArena& operator=(const LabelArena&) = delete;
+
+  /**
+   * Get an empty label vector, reusing released storage when there is some.
+   * @param  count  Number of labels to reserve at least.
+   * @return Returns an empty vector with at least count capacity.
+   */
+  template <class label_t, class allocator_t = std::allocator<label_t> >
+  std::vector<label_t, allocator_t> Acquire(const size_t count) {
+    std::vector<label_t, allocator_t> labels;
+    auto& free = Pool<label_t, allocator_t>().free;
+    if (!free.empty()) {
+      labels = std::move(free.back());
+      free.pop_back();
+      size_ -= labels.capacity() * sizeof(label_t);
+    }
+    labels.reserve(count);
+    return labels;
+  }
+
+  /**
+   * Give a label vector's storage back to the arena. The vector is left
+   * empty and without any capacity.
+   * @param  labels  Labels to give back.
+   */
+  template <class label_t, class allocator_t>
+  void Release(std::vector<label_t, allocator_t>& labels) {
+    if (labels.capacity() == 0)
+      return;
+    labels.clear();
+    size_ += labels.capacity() * sizeof(label_t);
+    Pool<label_t, allocator_t>().free.emplace_back(std::move(labels));
+    labels = std::vector<label_t, allocator_t>();
+  }
+
+  /**
+   * Get an edge status with every edge unreached, reusing a released one
+   * (and the tiles it has allocated) when there is one.
+   * @return Returns the edge status.
+   */
+  EdgeStatus AcquireEdgeStatus() {
+    auto& free = EdgeStatusPool().free;
+    if (free.empty())
+      return EdgeStatus();
+    EdgeStatus status(std::move(free.back()));
+    free.pop_back();
+    size_ -= status.capacity() * sizeof(EdgeStatusInfo);
+    return status;
+  }
+
+  /**
+   * Give an edge status back to the arena. The status is left without any
+   * tiles allocated.
+   * @param  status  Edge status to give back.
+   */
+  void Release(EdgeStatus& status) {
+    status.Init();
+    if (status.capacity() == 0)
+      return;
+    size_ += status.capacity() * sizeof(EdgeStatusInfo);
+    EdgeStatusPool().free.emplace_back(std::move(status));
+  }
+
+  /**
+   * Free released storage, largest first, until no more than the maximum
+   * size is kept. Call this between requests.
+   */
+  void Trim() {
+    while (size_ > max_size_) {
+      pool_base_t* largest = nullptr;
+      size_t largest_size = 0;
+      for (auto& pool : pools_) {
+        size_t size = pool.second->largest();
+        if (size > largest_size) {
+          largest = pool.second.get();
+          largest_size = size;
+        }
+      }
+      if (largest == nullptr)
+        break;
+      size_ -= largest->free_largest();
+    }
+  }
+
+  /**
+   * @return Returns the number of bytes of released storage being kept.
+   */
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  // Released vectors of one label type and allocator
+  struct pool_base_t {
+    virtual ~pool_base_t() {}
+    virtual size_t largest() const = 0;
+    virtual size_t free_largest() = 0;
+  };
+  template <class label_t, class allocator_t>
+  struct pool_t : public pool_base_t {
+    std::vector<std::vector<label_t, allocator_t> > free;
+    size_t largest() const override {
+      size_t bytes = 0;
+      for (const auto& labels : free)
+        bytes = std::max(bytes, labels.capacity() * sizeof(label_t));
+      return bytes;
+    }
+    size_t free_largest() override {
+      auto largest = free.begin();
+      for (auto labels = free.begin(); labels != free.end(); ++labels)
+        if (labels->capacity() > largest->capacity())
+          largest = labels;
+      size_t bytes = largest->capacity() * sizeof(label_t);
+      free.erase(largest);
+      return bytes;
+    }
+  };
+
+  // Released edge statuses
+  struct edgestatus_pool_t : public pool_base_t {
+    std::vector<EdgeStatus> free;
+    size_t largest() const override {
+      size_t bytes = 0;
+      for (const auto& status : free)
+        bytes = std::max(bytes, status.capacity() * sizeof(EdgeStatusInfo));
+      return bytes;
+    }
+    size_t free_largest() override {
+      auto largest = free.begin();
+      for (auto status = free.begin(); status != free.end(); ++status)
+        if (status->capacity() > largest->capacity())
+          largest = status;
+      size_t bytes = largest->capacity() * sizeof(EdgeStatusInfo);
+      free.erase(largest);
+      return bytes;
+    }
+  };
+
+  edgestatus_pool_t& EdgeStatusPool() {
+    auto& pool = pools_[std::type_index(typeid(EdgeStatus))];
+    if (!pool)
+      pool.reset(new edgestatus_pool_t());
+    return static_cast<edgestatus_pool_t&>(*pool);
+  }
+
+  template <class label_t, class allocator_t>
+  pool_t<label_t, allocator_t>& Pool() {
+    auto& pool = pools_[std::type_index(typeid(std::vector<label_t, allocator_t>))];
+    if (!pool)
+      pool.reset(new pool_t<label_t, allocator_t>());
+    return static_cast<pool_t<label_t, allocator_t>&>(*pool);
+  }
+
+  size_t max_size_;
+  size_t size_;
+  std::unordered_map<std::type_index, std::unique_ptr<pool_base_t> > pools_;
+};
+
+/**
+ * Reserve label storage, drawing it from an arena if there is one and the
+ * labels don't already have storage of their own.
+ * @param  arena   Arena to draw from, may be null.
+ * @param  labels  Labels to reserve storage for.
+ * @param  count   Number of labels to reserve at least.
+ */
+template <class label_t, class allocator_t>
+void ReserveLabels(LabelArena* arena, std::vector<label_t, allocator_t>& labels, const size_t count) {
+  if (arena != nullptr && labels.capacity() == 0)
+    labels = arena->Acquire<label_t, allocator_t>(count);
+  else
+    labels.reserve(count);
+}
+
+/**
+ * Clear labels, giving their storage back to an arena if there is one.
+ * @param  arena   Arena to give the storage to, may be null.
+ * @param  labels  Labels to clear.
+ */
+template <class label_t, class allocator_t>
+void ReleaseLabels(LabelArena* arena, std::vector<label_t, allocator_t>& labels) {
+  if (arena != nullptr)
+    arena->Release(labels);
+  else
+    labels.clear();
+}
+
+/**
+ * Reset an edge status for a search, drawing it from an arena if there is
+ * one and the status doesn't already have tiles of its own.
+ * @param  arena   Arena to draw from, may be null.
+ * @param  status  Edge status to reset.
+ */
+inline void ReserveEdgeStatus(LabelArena* arena, EdgeStatus& status) {
+  if (arena != nullptr && status.capacity() == 0)
+    status = arena->AcquireEdgeStatus();
+  else
+    status.Init();
+}
+
+/**
+ * Reset an edge status, giving its tiles back to an arena if there is one.
+ * @param  arena   Arena to give the tiles to, may be null.
+ * @param  status  Edge status to reset.
+ */
+inline void ReleaseEdgeStatus(LabelArena* arena, EdgeStatus& status) {
+  if (arena != nullptr)
+    arena->Release(status);
+  else
+    status.Init();
+}
+
+}
+}
+
+#endif  // VALHALLA_THOR_LABELARENA_H_
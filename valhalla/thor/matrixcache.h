@@ -0,0 +1,134 @@
+#ifndef VALHALLA_THOR_MATRIXCACHE_H_
+#define VALHALLA_THOR_MATRIXCACHE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <valhalla/thor/costmatrix.h>
+#include <valhalla/proto/tripcommon.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+// Default most cells a worker keeps, 0 for no cache
+constexpr size_t kDefaultMatrixCacheSize = 0;
+
+// Default seconds a cell is kept before its time and distance are found again
+constexpr uint32_t kDefaultMatrixCacheSeconds = 60;
+
+/**
+ * Times and distances of earlier matrix cells, keyed on the edges the source
+ * and target were correlated to, where along them they are, when they depart
+ * (to the quarter hour) and the costing and its options. Matrices asked for
+ * again and again with mostly the same locations only have to search from the
+ * sources and to the targets that have cells missing. Cells are dropped once
+ * they are older than the maximum age, so traffic is taken into account
+ * again, and the oldest ones go first when the cache is full.
+ */
+class MatrixCache {
+ public:
+  /**
+   * Constructor.
+   * @param  max_size  Most cells to keep, 0 to keep none.
+   * @param  max_age   Seconds a cell is kept.
+   */
+  MatrixCache(const size_t max_size = kDefaultMatrixCacheSize,
+              const uint32_t max_age = kDefaultMatrixCacheSeconds);
+
+  /**
+   * Get the key of a source or target location, from its correlated edges
+   * and the quarter hour it departs at if it has a date and time.
+   * @param  location  Correlated location.
+   * @return Returns the key of the location.
+   */
+  static uint64_t LocationKey(const odin::Location& location);
+
+  /**
+   * Get the key of a costing.
+   * @param  costing  Name of the costing followed by its canonical options.
+   * @return Returns the key of the costing.
+   */
+  static uint64_t CostingKey(const std::string& costing);
+
+  /**
+   * Find the time and distance of a cell that isn't too old.
+   * @param  source   Key of the source location.
+   * @param  target   Key of the target location.
+   * @param  costing  Key of the costing.
+   * @param  td       Set to the time and distance of the cell when found.
+   * @return Returns true if the cell was found.
+   */
+  bool Find(const uint64_t source, const uint64_t target, const uint64_t costing,
+            TimeDistance& td);
+
+  /**
+   * Keep the time and distance of a cell, dropping the oldest cell if the
+   * cache is full.
+   * @param  source   Key of the source location.
+   * @param  target   Key of the target location.
+   * @param  costing  Key of the costing.
+   * @param  td       Time and distance of the cell.
+   */
+  void Insert(const uint64_t source, const uint64_t target, const uint64_t costing,
+              const TimeDistance& td);
+
+  /**
+   * Is the cache keeping any cells at all.
+   * @return Returns true if it has room for cells.
+   */
+  bool enabled() const {
+    return max_size_ > 0;
+  }
+
+  /**
+   * Get the number of cells kept.
+   * @return Returns the number of cells.
+   */
+  size_t size() const {
+    return cells_.size();
+  }
+
+  /**
+   * Drop all the cells.
+   */
+  void Clear();
+
+ protected:
+  struct Key {
+    uint64_t source;
+    uint64_t target;
+    uint64_t costing;
+    bool operator==(const Key& other) const {
+      return source == other.source && target == other.target && costing == other.costing;
+    }
+  };
+
+  struct KeyHasher {
+    size_t operator()(const Key& key) const;
+  };
+
+  // Keys in the order the cells were kept in, oldest first
+  using order_t = std::list<Key>;
+
+  struct Cell {
+    TimeDistance td;
+    std::chrono::steady_clock::time_point kept;
+    order_t::iterator order;
+  };
+
+  // Drop the cells older than the maximum age
+  void Expire(const std::chrono::steady_clock::time_point& now);
+
+  size_t max_size_;
+  std::chrono::seconds max_age_;
+  std::unordered_map<Key, Cell, KeyHasher> cells_;
+  order_t order_;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_MATRIXCACHE_H_
@@ -0,0 +1,145 @@
+#ifndef VALHALLA_THOR_MEMORYBUDGET_H_
+#define VALHALLA_THOR_MEMORYBUDGET_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <valhalla/exception.h>
+#include <valhalla/midgard/metrics.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Counts the bytes the search containers (edge labels and edge status) of
+ * the calling thread allocate while a request is being worked on, so that a
+ * single huge isochrone or optimized route can be stopped before it takes
+ * the memory of the whole process. Outside of a Scope, or with a budget of
+ * 0, nothing is ever turned away. Storage a label arena already held when
+ * the request started is not counted against it, only what the request
+ * allocated on top of that.
+ */
+class MemoryBudget {
+ public:
+  /**
+   * Counts the allocations of the calling thread against a budget for as
+   * long as it is in scope. Scopes don't nest.
+   */
+  class Scope {
+   public:
+    /**
+     * Constructor.
+     * @param  budget  Bytes the request may allocate, 0 for no limit.
+     */
+    Scope(const size_t budget) {
+      auto& account = Account();
+      account.baseline = account.used;
+      account.peak = 0;
+      account.budget = budget;
+    }
+
+    ~Scope() {
+      auto& account = Account();
+      METRICS_COUNT(kRequestMemoryBytes, account.peak);
+      account.budget = 0;
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    /**
+     * @return Returns the most bytes the request held at once so far.
+     */
+    size_t peak() const {
+      return Account().peak;
+    }
+  };
+
+  /**
+   * Count an allocation, throws before it is made if it takes the request
+   * over its budget.
+   * @param  bytes  Bytes about to be allocated.
+   */
+  static void Allocate(const size_t bytes) {
+    auto& account = Account();
+    int64_t held = account.used + static_cast<int64_t>(bytes) - account.baseline;
+    if (account.budget && held > static_cast<int64_t>(account.budget)) {
+      METRICS_COUNT(kMemoryBudgetExceeded, 1);
+      throw valhalla_exception_t{451};
+    }
+    account.used += bytes;
+    account.peak = std::max(account.peak, static_cast<size_t>(std::max<int64_t>(held, 0)));
+  }
+
+  /**
+   * Count a deallocation.
+   * @param  bytes  Bytes deallocated.
+   */
+  static void Free(const size_t bytes) {
+    Account().used -= bytes;
+  }
+
+ private:
+  // What the calling thread holds and its budget. Memory can be freed on
+  // another thread than the one that allocated it, so it is signed
+  struct account_t {
+    int64_t used = 0;
+    int64_t baseline = 0;
+    size_t peak = 0;
+    size_t budget = 0;
+  };
+
+  static account_t& Account() {
+    static thread_local account_t account;
+    return account;
+  }
+};
+
+/**
+ * Allocator that counts what it allocates against the memory budget of the
+ * calling thread.
+ */
+template <class T>
+struct BudgetAllocator {
+  using value_type = T;
+
+  BudgetAllocator() = default;
+  template <class U>
+  BudgetAllocator(const BudgetAllocator<U>&) {
+  }
+
+  T* allocate(const size_t n) {
+    MemoryBudget::Allocate(n * sizeof(T));
+    try {
+      return std::allocator<T>().allocate(n);
+    } catch (...) {
+      MemoryBudget::Free(n * sizeof(T));
+      throw;
+    }
+  }
+
+  void deallocate(T* p, const size_t n) {
+    std::allocator<T>().deallocate(p, n);
+    MemoryBudget::Free(n * sizeof(T));
+  }
+};
+
+template <class T, class U>
+bool operator==(const BudgetAllocator<T>&, const BudgetAllocator<U>&) {
+  return true;
+}
+template <class T, class U>
+bool operator!=(const BudgetAllocator<T>&, const BudgetAllocator<U>&) {
+  return false;
+}
+
+// Edge labels of a search, counted against the memory budget
+template <class label_t>
+using Labels = std::vector<label_t, BudgetAllocator<label_t> >;
+
+}
+}
+
+#endif  // VALHALLA_THOR_MEMORYBUDGET_H_
@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <memory>
 
@@ -16,6 +17,7 @@
 #include <valhalla/sif/hierarchylimits.h>
 #include <valhalla/thor/astarheuristic.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/memorybudget.h>
 #include <valhalla/thor/pathinfo.h>
 #include <valhalla/thor/astar.h>
 #include <valhalla/proto/tripcommon.pb.h>
@@ -41,7 +43,10 @@ class MultiModalPathAlgorithm : public PathAlgorithm {
 
   /**
    * Form multi-modal path between and origin and destination location using
-   * the supplied costing method.
+   * the supplied costing method. The path departs at the date_time of the
+   * origin or, when only the destination has one, arrives by it. Arriving
+   * by a time searches back in time from the destination and sets the
+   * date_time of the origin to when the path departs.
    * @param  origin  Origin location
    * @param  dest    Destination location
    * @param  graphreader  Graph reader for accessing routing graph.
@@ -75,7 +80,7 @@ class MultiModalPathAlgorithm : public PathAlgorithm {
   AStarHeuristic astarheuristic_;
 
   // Vector of edge labels (requires access by index).
-  std::vector<sif::MMEdgeLabel> edgelabels_;
+  Labels<sif::MMEdgeLabel> edgelabels_;
 
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
@@ -86,6 +91,21 @@ class MultiModalPathAlgorithm : public PathAlgorithm {
   // Destinations, id and cost
   std::map<uint64_t, sif::Cost> destinations_;
 
+  // Origins of a reverse search, the opposing edge of each origin edge and
+  // the cost of the part of the origin edge before the origin
+  std::map<uint64_t, sif::Cost> origins_;
+
+  // A transit line and the stop it starts at
+  struct inbound_line_t {
+    baldr::GraphId edgeid;
+    baldr::GraphId startnode;
+  };
+
+  // Transit lines by the stop they end at and the transit tiles indexed
+  // so far, for reverse searches
+  std::unordered_map<uint64_t, std::vector<inbound_line_t>> inbound_lines_;
+  std::unordered_set<uint32_t> inbound_tiles_;
+
   /**
    * Initializes the hierarchy limits, A* heuristic, and adjacency list.
    * @param  origll  Lat,lng of the origin.
@@ -139,6 +159,67 @@ class MultiModalPathAlgorithm : public PathAlgorithm {
            baldr::GraphReader& graphreader, const sif::TravelMode dest_mode,
            const std::shared_ptr<sif::DynamicCost>& costing);
 
+  /**
+   * Form the multi-modal path arriving at the destination by its date_time,
+   * searching back in time from the destination towards the origin.
+   * @param  origin  Origin location
+   * @param  dest    Destination location, with the date_time to arrive by
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return  Returns the path edges (and elapsed time/modes at end of
+   *          each edge).
+   */
+  std::vector<PathInfo> GetBestPathReverse(odin::Location& origin,
+           odin::Location& dest, baldr::GraphReader& graphreader,
+           const std::shared_ptr<sif::DynamicCost>* mode_costing,
+           const sif::TravelMode mode);
+
+  /**
+   * Get the transit lines that end at a transit stop, indexing the transit
+   * tiles they can start in the first time.
+   * @param  graphreader  Graph tile reader.
+   * @param  stop         Node of the stop.
+   * @return  Returns the transit lines ending at the stop.
+   */
+  const std::vector<inbound_line_t>& InboundLines(baldr::GraphReader& graphreader,
+                                                  const baldr::GraphId& stop);
+
+  /**
+   * Keep the origin edges of a reverse search, by their opposing edges.
+   * @param  graphreader  Graph tile reader.
+   * @param  origin       Location information of the origin.
+   * @param  costing      Dynamic costing.
+   */
+  void SetOriginReverse(baldr::GraphReader& graphreader,
+                        const odin::Location& origin,
+                        const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Add the opposing edges of the destination edges to the adjacency list,
+   * a reverse search starts from them.
+   * @param  graphreader  Graph tile reader.
+   * @param  origin       Location information of the origin.
+   * @param  dest         Location information of the destination.
+   * @param  costing      Dynamic costing.
+   */
+  void SetDestinationReverse(baldr::GraphReader& graphreader,
+                             const odin::Location& origin,
+                             const odin::Location& dest,
+                             const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Form the path of a reverse search. Recovers the path from the origin
+   * forwards towards the destination (using predecessor information)
+   * @param   origin_label  Index in the edge labels of the origin edge.
+   * @param   graphreader   Graph tile reader.
+   * @return  Returns the path info, a list of GraphIds representing the
+   *          directed edges along the path - ordered from origin to
+   *          destination - along with travel modes and elapsed time.
+   */
+  std::vector<PathInfo> FormPathReverse(const uint32_t origin_label,
+                                        baldr::GraphReader& graphreader);
+
   /**
     * Form the path from the adjacency list. Recovers the path from the
     * destination backwards towards the origin (using predecessor information)
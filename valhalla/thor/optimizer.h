@@ -2,6 +2,7 @@
 #define VALHALLA_THOR_OPTIMIZER_H_
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <algorithm>
 #include <random>
@@ -15,6 +16,17 @@ namespace thor {
 // setting too high takes longer to converge on a solution.
 constexpr float kCoolingRate = 0.93f;
 
+// Default number of annealing chains the service runs for each tour
+constexpr uint32_t kDefaultAnnealingChains = 4;
+
+// Least decrease in tour cost for the local search to make a move, so that
+// rounding in its prefix sums can't make it go back and forth.
+constexpr double kMinImprovement = 1e-3;
+
+// Number of cheapest locations to go to next that the local search tries
+// to connect each location to.
+constexpr uint32_t kLocalSearchNeighbors = 8;
+
 // Alteration type.
 // kRotate  - Alters a portion of the tour by rotating the locations about
 //            a middle point. The middle location becomes the new start
@@ -34,10 +46,24 @@ struct TourAlteration {
 /**
  * Optimization method using simulated annealing. Optimizes the order of
  * locations - keeping the first location (origin) and last location
- * (destination) fixed.
+ * (destination) fixed. Several independent annealing chains can be run on
+ * threads of their own, each starting from its own random tour, and the
+ * best tour of all of them is kept. Chain i is seeded with the seed of the
+ * optimizer plus i so the result is repeatable for a given seed. After the
+ * annealing each chain can improve its best tour with a 2-opt and or-opt
+ * local search that only tries to connect locations to their cheapest
+ * neighbors and evaluates each move from prefix sums of the tour costs.
  */
 class Optimizer {
 public:
+  /**
+   * Constructor.
+   * @param  chains        Number of annealing chains to run concurrently,
+   *                        0 for one per core.
+   * @param  local_search  Whether to improve the annealed tours with 2-opt
+   *                        and or-opt moves.
+   */
+  Optimizer(const uint32_t chains = 1, const bool local_search = true);
 
   /**
    * Optimize the tour through a set of locations given the cost matrix
@@ -57,10 +83,14 @@ public:
    * @param  seed  Seed to use for the random number generator.
    */
   void Seed(const uint32_t seed) {
+    seed_ = seed;
     random_generator_.seed(seed);
   }
 
 protected:
+  uint32_t chains_;                  // # of annealing chains
+  uint64_t seed_;                    // Seed of the first chain
+  bool local_search_;                // Whether to run the local search
   // Random number generation: 0 <= r < 1
   std::mt19937_64 random_generator_;
   std::uniform_real_distribution<float> uniform_distribution_ { 0.0, 1.0 };
@@ -73,6 +103,60 @@ protected:
   std::vector<uint32_t> tour_;       // Current tour (order of locations)
   std::vector<uint32_t> best_tour_;  // Best tour so far
 
+  // Cheapest locations to go to from each location, shared by the chains
+  std::shared_ptr<const std::vector<std::vector<uint32_t> > > neighbors_;
+
+  // Local search state: index of each location in the tour and the cost of
+  // the tour up to each index going forward and going backward along it
+  std::vector<uint32_t> position_;
+  std::vector<double> forward_;
+  std::vector<double> backward_;
+
+  /**
+   * Run one annealing chain from a random tour, leaving the best tour it
+   * finds and its cost in best_tour_ and best_cost_.
+   * @param  costs  2-D cost matrix.
+   */
+  void Run(const std::vector<float>& costs);
+
+  /**
+   * Find the cheapest locations to go to from each location. The first
+   * location is left out since nothing can go to it.
+   * @param  costs  2-D cost matrix.
+   */
+  void FindNeighbors(const std::vector<float>& costs);
+
+  /**
+   * Improve best_tour_ with 2-opt and or-opt moves until none of them
+   * lowers its cost.
+   * @param  costs  2-D cost matrix.
+   */
+  void LocalSearch(const std::vector<float>& costs);
+
+  /**
+   * Reverse the first part of best_tour_ that lowers its cost when reversed
+   * and that starts by connecting a location to one of its neighbors. Since
+   * the costs aren't symmetric the cost of the reversed part comes from the
+   * backward prefix sums.
+   * @param  costs  2-D cost matrix.
+   * @return Returns true if the tour was changed.
+   */
+  bool TwoOptMove(const std::vector<float>& costs);
+
+  /**
+   * Move the first run of up to 3 locations of best_tour_ that lowers its
+   * cost when put in front of a neighbor of its last location.
+   * @param  costs  2-D cost matrix.
+   * @return Returns true if the tour was changed.
+   */
+  bool OrOptMove(const std::vector<float>& costs);
+
+  /**
+   * Update the positions and prefix sums of best_tour_.
+   * @param  costs  2-D cost matrix.
+   */
+  void UpdateTourSums(const std::vector<float>& costs);
+
   /*
    * Perform the annealing process.
    * @param  costs        2-D cost matrix.
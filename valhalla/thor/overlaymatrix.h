@@ -0,0 +1,183 @@
+#ifndef VALHALLA_THOR_OVERLAYMATRIX_H_
+#define VALHALLA_THOR_OVERLAYMATRIX_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/overlaygraph.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+#include <valhalla/proto/tripcommon.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Class to compute time distance matrices of long distances over the level 0
+ * tile boundary overlay of a costing. A local search from each location goes
+ * over the routing graph within the hierarchy limits of the costing, forward
+ * from a source and backward from a target, and stops at the level 0 edges
+ * leaving (or entering) a tile, which are the nodes of the overlay. Then a
+ * search of the overlay from the nodes each source reached meets the nodes
+ * the targets reached, crossing every tile in between in a single arc. Pairs
+ * close enough for the local search of the source to reach the target are
+ * also connected directly. Only levels with an expansion distance in their
+ * hierarchy limits bound the local searches so the matrix is for the
+ * costings of vehicles, and like the overlay itself it is only good for
+ * requests with the default costing options and it doesn't know about
+ * complex restrictions.
+ */
+class OverlayMatrix {
+ public:
+  /**
+   * A node of the overlay a search starts from or ends at. For a source it
+   * holds what it takes to get from the location to the end of the edge of
+   * the node. For a target what it takes from the end of that edge to the
+   * location.
+   */
+  struct Seed {
+    uint32_t node;    // Node of the overlay (boundary edge)
+    float cost;
+    float secs;
+    float length;
+  };
+
+  /**
+   * Cheapest connection between a source and a target.
+   */
+  struct Connection {
+    float cost;       // kMaxCost if there is none
+    float secs;
+    float length;
+  };
+
+  /**
+   * Constructor.
+   * @param  graph        Boundary overlay of the costing
+   * @param  max_threads  Most threads to search the overlay with, 0 for one
+   *                      per core
+   */
+  OverlayMatrix(const std::shared_ptr<const baldr::OverlayGraph>& graph,
+                const uint32_t max_threads = 0);
+
+  /**
+   * Destructor
+   */
+  virtual ~OverlayMatrix() {}
+
+  /**
+   * Do the local searches on more threads.
+   * @param  readers  Graph readers for the extra threads, one each, not to be
+   *                  used by anything else while the matrix is formed.
+   */
+  void set_thread_readers(const std::vector<baldr::GraphReader*>& readers) {
+    thread_readers_ = readers;
+  }
+
+  /**
+   * Set a callback that will throw when the matrix computation should be aborted
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_interrupt(const std::function<void ()>* interrupt_callback) {
+    interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from origin index to all other locations
+   */
+  std::vector<TimeDistance> SourceToTarget(
+          const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+          const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+          baldr::GraphReader& graphreader,
+          const std::shared_ptr<sif::DynamicCost>* mode_costing,
+          const sif::TravelMode mode, const float max_matrix_distance);
+
+  /**
+   * Find the cheapest connection over the overlay between every source and
+   * every target.
+   * @param  sources  Seeds of each source
+   * @param  targets  Seeds of each target
+   * @return Returns the connections from each source to all the targets
+   */
+  std::vector<Connection> Connect(const std::vector<std::vector<Seed> >& sources,
+                                  const std::vector<std::vector<Seed> >& targets) const;
+
+ protected:
+  /**
+   * Where a local search starts, an edge of the location with what it takes
+   * to get from the location to the end of the edge going forward or from
+   * the end of the edge to the location going backward.
+   */
+  struct Origin {
+    baldr::GraphId edgeid;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  // A target on an edge the local search of a source settles
+  struct TargetEdge {
+    uint32_t target;
+    float cost;
+    float secs;
+    float length;
+  };
+
+  std::shared_ptr<const baldr::OverlayGraph> graph_;
+  uint32_t max_threads_;
+  std::vector<baldr::GraphReader*> thread_readers_;
+  const std::function<void ()>* interrupt_;
+
+  /**
+   * Edges a location is on, the way the other matrices seed them.
+   * @param  location     Location with its path edges
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing      Costing method
+   * @param  forward      Whether the location is a source or a target
+   * @return Returns the origins
+   */
+  std::vector<Origin> Origins(const odin::Location& location, baldr::GraphReader& graphreader,
+                              const sif::DynamicCost& costing, const bool forward) const;
+
+  /**
+   * Search the routing graph from a location up to the nodes of the overlay.
+   * Levels above 0 are only expanded within the expansion distance of their
+   * hierarchy limits from the location or one of the locations on the other
+   * side, level 0 is expanded up to the tile boundaries.
+   * @param  origins      Edges of the location
+   * @param  near         The location and the locations on the other side
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  costing      Costing method
+   * @param  forward      Search forward from a source or backward from a target
+   * @param  targets      Targets by their edges, to connect directly going
+   *                      forward, may be null
+   * @param  direct       Filled with a connection per target going forward
+   * @return Returns the seeds of the location at the nodes of the overlay
+   */
+  std::vector<Seed> Search(const std::vector<Origin>& origins,
+                           const std::vector<midgard::PointLL>& near,
+                           baldr::GraphReader& graphreader, sif::DynamicCost& costing,
+                           const bool forward,
+                           const std::unordered_map<uint64_t, std::vector<TargetEdge> >* targets,
+                           std::vector<Connection>& direct) const;
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_OVERLAYMATRIX_H_
@@ -10,8 +10,13 @@
 
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/tilehierarchy.h>
+#include <valhalla/midgard/pointll.h>
 #include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/hierarchylimits.h>
+#include <valhalla/thor/labelarena.h>
 #include <valhalla/thor/pathinfo.h>
+#include <valhalla/thor/search_stats.h>
 #include <valhalla/proto/tripcommon.pb.h>
 
 namespace valhalla {
@@ -31,6 +36,8 @@ class PathAlgorithm {
    */
   PathAlgorithm()
      : interrupt(nullptr),
+       label_arena_(nullptr),
+       stats_(nullptr),
        has_ferry_(false) {
   }
 
@@ -69,6 +76,23 @@ class PathAlgorithm {
     interrupt = interrupt_callback;
   }
 
+  /**
+   * Set an arena to draw edge label storage from so that it is reused from
+   * one request to the next rather than allocated every time
+   * @param arena  the arena, must outlive this algorithm, may be null
+   */
+  void set_label_arena(LabelArena* arena) {
+    label_arena_ = arena;
+  }
+
+  /**
+   * Set where the work done by each search is added up when Clear is called
+   * @param stats  the statistics of the current request, null to stop counting
+   */
+  void set_stats(odin::SearchStats* stats) {
+    stats_ = stats;
+  }
+
   /**
    * Does the path include a ferry?
    * @return  Returns true if the path includes a ferry.
@@ -80,6 +104,10 @@ class PathAlgorithm {
  protected:
   const std::function<void()>* interrupt;
 
+  LabelArena* label_arena_;  // Where edge label storage comes from, may be null
+
+  odin::SearchStats* stats_; // Where search work is counted, null unless asked for
+
   bool has_ferry_;    // Indicates whether the path has a ferry
 
   /**
@@ -106,6 +134,35 @@ class PathAlgorithm {
     }
     return false;
   }
+
+  /**
+   * Scale the hierarchy limits of every level with the factors kept in the
+   * tile of that level a location is in. Tiles built without factors leave
+   * the limits as they are.
+   * @param  graphreader       Graph reader for accessing routing graph.
+   * @param  ll                Location the limits are used near.
+   * @param  up_transitions    Scale the maximum upward transitions.
+   * @param  expansion_within  Scale the expansion within distance.
+   * @param  hierarchy_limits  Hierarchy limits to scale.
+   */
+  void ScaleHierarchyLimits(baldr::GraphReader& graphreader, const midgard::PointLL& ll,
+                            const bool up_transitions, const bool expansion_within,
+                            std::vector<sif::HierarchyLimits>& hierarchy_limits) const {
+    for (const auto& level : baldr::TileHierarchy::levels()) {
+      int32_t tileid = level.second.tiles.TileId(ll);
+      if (tileid < 0 || level.first >= hierarchy_limits.size()) {
+        continue;
+      }
+      baldr::GraphId id(tileid, level.first, 0);
+      const baldr::GraphTile* tile = graphreader.DoesTileExist(id) ?
+                                     graphreader.GetGraphTile(id) : nullptr;
+      if (tile != nullptr) {
+        hierarchy_limits[level.first].Scale(
+            up_transitions ? tile->header()->up_transition_factor() : 1.0f,
+            expansion_within ? tile->header()->expansion_within_factor() : 1.0f);
+      }
+    }
+  }
 };
 
 }
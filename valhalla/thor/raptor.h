@@ -0,0 +1,223 @@
+#ifndef VALHALLA_THOR_RAPTOR_H_
+#define VALHALLA_THOR_RAPTOR_H_
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/sif/edgelabel.h>
+#include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/memorybudget.h>
+#include <valhalla/thor/pathalgorithm.h>
+#include <valhalla/thor/pathinfo.h>
+#include <valhalla/proto/tripcommon.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+// Rounds of riding transit, the most trips a path boards
+constexpr uint32_t kDefaultRaptorRounds = 5;
+
+/**
+ * Round based public transit routing (RAPTOR). Each round rides every trip
+ * that can be boarded from the stops whose arrival time improved in the
+ * round before, so after round k the arrival times are the earliest ones
+ * using at most k trips. After riding, each round walks from the stops it
+ * improved to transfer to other stops and to reach the destination. Walking
+ * to the first stop, between stops and from the last one uses pedestrian
+ * costing. The timetable is read from the transit tiles as it is needed:
+ * trips are boarded with the next departure along a transit line and then
+ * followed from stop to stop by their trip Id.
+ *
+ * Unlike MultiModalPathAlgorithm, which weighs transit against walking with
+ * costs, this finds the earliest arrival and, between paths that arrive at
+ * the same time, the one with the fewest trips.
+ */
+class RaptorPathAlgorithm : public PathAlgorithm {
+ public:
+  /**
+   * Constructor.
+   * @param  max_rounds  Most trips a path may board.
+   */
+  RaptorPathAlgorithm(const uint32_t max_rounds = kDefaultRaptorRounds);
+
+  /**
+   * Destructor
+   */
+  virtual ~RaptorPathAlgorithm();
+
+  /**
+   * Form a transit path between an origin and destination location, walking
+   * to, between and from the stops.
+   * @param  origin  Origin location, must have a date and time
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return  Returns the path edges (and elapsed time/modes at end of
+   *          each edge).
+   */
+  std::vector<PathInfo> GetBestPath(odin::Location& origin,
+           odin::Location& dest, baldr::GraphReader& graphreader,
+           const std::shared_ptr<sif::DynamicCost>* mode_costing,
+           const sif::TravelMode mode);
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear();
+
+ protected:
+  // An edge along the paths found so far
+  struct Label {
+    uint32_t predecessor;    // Label of the edge before, kInvalidLabel at the origin
+    baldr::GraphId edgeid;   // Directed edge
+    float secs;              // Elapsed time at the end of the edge
+    uint32_t tripid;         // Trip ridden along the edge, 0 when walking
+    sif::TravelMode mode;
+  };
+
+  // Earliest arrival found at a stop
+  struct Arrival {
+    float secs;              // Elapsed time at the stop
+    uint32_t label;          // Label of the edge arriving at the stop
+    bool by_transit;         // Arrived on a trip rather than walking
+    uint32_t marked;         // Last round the stop was marked to board from
+  };
+
+  uint32_t max_rounds_;
+
+  // Edges along all the paths the search has found, walks and rides
+  std::vector<Label> labels_;
+
+  // Earliest arrival at each stop (transit platform node)
+  std::unordered_map<uint64_t, Arrival> arrivals_;
+
+  // Labels, status and queue of the current walk. A walk label at index i
+  // is labels_[walk_base_ + i].
+  Labels<sif::EdgeLabel> walklabels_;
+  std::shared_ptr<EdgeStatus> edgestatus_;
+  std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
+  uint32_t walk_base_;
+
+  // Destinations, id and cost of the remainder of the edge
+  std::map<uint64_t, sif::Cost> destinations_;
+
+  // Best arrival at the destination so far
+  uint32_t best_label_;
+  float best_secs_;
+
+  // Start time, date and day of week of the schedules. The day relative to
+  // the schedules is set from the first transit tile reached.
+  uint32_t start_time_;
+  uint32_t days_from_pivot_;
+  uint32_t day_;
+  uint32_t dow_;
+  bool date_before_tile_;
+  bool date_set_;
+
+  // Only ride departures with wheelchair or bicycle access
+  bool wheelchair_;
+  bool bicycle_;
+
+  // Tiles whose excluded stops and lines have been added to the costing
+  std::unordered_set<uint32_t> processed_tiles_;
+
+  /**
+   * Set the destination edges and the cost of their remainders.
+   * @param   graphreader  Graph tile reader.
+   * @param   dest         Location information of the destination.
+   * @param   costing      Pedestrian costing.
+   */
+  void SetDestination(baldr::GraphReader& graphreader, const odin::Location& dest,
+                      const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Start a walk from the origin edges.
+   * @param   graphreader  Graph tile reader.
+   * @param   origin       Location information of the origin.
+   * @param   dest         Location information of the destination.
+   * @param   costing      Pedestrian costing.
+   */
+  void SetOrigin(baldr::GraphReader& graphreader, odin::Location& origin,
+                 const odin::Location& dest,
+                 const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Start a walk from each of the stops, at their arrival time.
+   * @param   graphreader  Graph tile reader.
+   * @param   stops        Stops to walk from.
+   * @param   costing      Pedestrian costing.
+   */
+  void SetStops(baldr::GraphReader& graphreader, const std::vector<baldr::GraphId>& stops,
+                const std::shared_ptr<sif::DynamicCost>& costing);
+
+  /**
+   * Walk from the edges added by SetOrigin or SetStops, marking the stops
+   * whose arrival improves and updating the best arrival at the destination.
+   * @param   graphreader   Graph tile reader.
+   * @param   origin        Origin location, to check for trivial paths.
+   * @param   dest          Destination location.
+   * @param   costing       Pedestrian costing.
+   * @param   tc            Transit costing.
+   * @param   transfer      Walking to transfer between stops rather than
+   *                        from the origin.
+   * @param   round         Round to mark the stops reached in.
+   * @param   marked        Stops marked to board from in the next round.
+   */
+  void Walk(baldr::GraphReader& graphreader, const odin::Location& origin,
+            const odin::Location& dest,
+            const std::shared_ptr<sif::DynamicCost>& costing,
+            const std::shared_ptr<sif::DynamicCost>& tc, const bool transfer,
+            const uint32_t round, std::vector<baldr::GraphId>& marked);
+
+  /**
+   * Ride every trip that can be boarded from the marked stops, keeping the
+   * arrivals at the stops they improve.
+   * @param   graphreader   Graph tile reader.
+   * @param   tc            Transit costing.
+   * @param   marked        Stops to board from.
+   * @param   round         Current round.
+   * @param   improved      Stops whose arrival the trips improved.
+   */
+  void Ride(baldr::GraphReader& graphreader,
+            const std::shared_ptr<sif::DynamicCost>& tc,
+            const std::vector<baldr::GraphId>& marked, const uint32_t round,
+            std::vector<baldr::GraphId>& improved);
+
+  /**
+   * Add the stops and lines a tile excludes to the transit costing, once.
+   * @param   tc    Transit costing.
+   * @param   tile  Transit tile.
+   */
+  void AddToExcludeList(const std::shared_ptr<sif::DynamicCost>& tc,
+                        const baldr::GraphTile* tile);
+
+  /**
+   * Mark a stop to board from in a round, once.
+   * @param   stop     Transit platform node.
+   * @param   round    Round to board from it in.
+   * @param   marked   Stops marked in the round.
+   */
+  void Mark(const baldr::GraphId& stop, const uint32_t round,
+            std::vector<baldr::GraphId>& marked);
+
+  /**
+   * Form the path from the labels, working back from the destination.
+   * @param   dest  Label of the destination edge.
+   * @return  Returns the path info, ordered from origin to destination.
+   */
+  std::vector<PathInfo> FormPath(const uint32_t dest);
+};
+
+}
+}
+
+#endif  // VALHALLA_THOR_RAPTOR_H_
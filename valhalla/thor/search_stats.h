@@ -0,0 +1,32 @@
+#ifndef VALHALLA_THOR_SEARCH_STATS_H_
+#define VALHALLA_THOR_SEARCH_STATS_H_
+
+#include <cstdint>
+
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/proto/directions_options.pb.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Adds the work a search did to the statistics of a request. Searches only
+ * keep statistics when they are handed somewhere to put them, so this does
+ * nothing for requests that did not ask for them.
+ * @param  stats   Statistics to add to, may be null
+ * @param  labels  Edge labels the search created
+ * @param  queue   Adjacency list the search used, may be null
+ */
+inline void AddSearchStats(odin::SearchStats* stats, const uint64_t labels,
+                           const baldr::DoubleBucketQueue* queue) {
+  if (stats == nullptr)
+    return;
+  stats->set_labels(stats->labels() + labels);
+  if (queue != nullptr)
+    stats->set_queue_pushes(stats->queue_pushes() + queue->pushes());
+}
+
+}
+}
+
+#endif  // VALHALLA_THOR_SEARCH_STATS_H_
@@ -12,9 +12,12 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/baldr/pathlocation.h>
 #include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/midgard/pointll.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
+#include <valhalla/sif/hierarchylimits.h>
 #include <valhalla/thor/edgestatus.h>
+#include <valhalla/thor/memorybudget.h>
 #include <valhalla/thor/pathalgorithm.h>
 #include <valhalla/thor/costmatrix.h>
 #include <valhalla/thor/astar.h>
@@ -28,6 +31,9 @@ constexpr float kTimeDistCostThresholdAutoDivisor = 112.0f; // 400 km distance t
 constexpr float kTimeDistCostThresholdBicycleDivisor = 19.0f; // 200 km distance threshold will result in a cost threshold of ~10800 (3 hours)
 constexpr float kTimeDistCostThresholdPedestrianDivisor = 7.0f; // 200 km distance threshold will result in a cost threshold of ~28800 (8 hours)
 
+// Bits of the filter in front of the destination edge lookup
+constexpr uint32_t kDestEdgeFilterBits = 16;
+
 // Structure to hold information about each destination.
 struct Destination {
   bool settled;         // Has the best time/distance to this destination
@@ -57,8 +63,54 @@ class TimeDistanceMatrix {
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param  label_arena  Arena to draw the edge label storage from, must
+   *                      outlive the matrix, may be null.
+   */
+  TimeDistanceMatrix(LabelArena* label_arena = nullptr);
+
+  /**
+   * Destructor. Gives the edge label storage back to the arena.
+   */
+  ~TimeDistanceMatrix();
+
+  /**
+   * Set a callback that will throw when the matrix computation should be aborted
+   * @param interrupt_callback  the function to periodically call to see if
+   *                            we should abort
+   */
+  void set_interrupt(const std::function<void ()>* interrupt_callback) {
+    interrupt_ = interrupt_callback;
+  }
+
+  /**
+   * Use the hierarchy limits of the costing like the path algorithms do. A
+   * level stops being expanded once its upward transitions have run out,
+   * except within the expansion distance of a destination that has not been
+   * settled. Long matrices settle far fewer edges this way but, as with
+   * routes, the paths found are not always the least cost ones.
+   * @param  hierarchy_limits  Stop expanding levels at their limits if true.
+   */
+  void set_hierarchy_limits(const bool hierarchy_limits) {
+    use_hierarchy_limits_ = hierarchy_limits;
+  }
+
+  /**
+   * Depart from each source some time after its date time, for one slice of
+   * a sweep over the departure times.
+   * @param  seconds  Seconds added to the date times of the sources.
    */
-  TimeDistanceMatrix();
+  void set_departure_offset(const uint32_t seconds) {
+    departure_offset_ = seconds;
+  }
+
+  /**
+   * Whether a search since the last call cost an edge with its historical
+   * speed, if not its results don't depend on the departure time.
+   * @return Returns true if a historical speed was used.
+   */
+  bool historical_speeds_used() const {
+    return historical_speeds_used_;
+  }
 
   /**
    * One to many time and distance cost matrix. Computes time and distance
@@ -128,6 +180,32 @@ class TimeDistanceMatrix {
           const std::shared_ptr<sif::DynamicCost>* mode_costing,
           const sif::TravelMode mode, const float max_matrix_distance);
 
+  /**
+   * Forms the time distance matrices of a sweep over departure times, the
+   * ones after the date time of each source by multiples of an interval.
+   * The search from a source is only done again for the other departure
+   * times if it used historical speeds, the others share its results. Only
+   * the searches from the sources depend on the time, with more sources
+   * than targets the searches are from the targets and every slice is the
+   * same.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  costing               Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @param  interval              Seconds between the departure times.
+   * @param  count                 Number of departure times.
+   * @return time/distance matrix of each departure time, in order
+   */
+  std::vector<std::vector<TimeDistance> > SourceToTargetSlices(
+          const google::protobuf::RepeatedPtrField<odin::Location>& source_location_list,
+          const google::protobuf::RepeatedPtrField<odin::Location>& target_location_list,
+          baldr::GraphReader& graphreader,
+          const std::shared_ptr<sif::DynamicCost>* mode_costing,
+          const sif::TravelMode mode, const float max_matrix_distance,
+          const uint32_t interval, const uint32_t count);
+
   /**
    * Clear the temporary information generated during time+distance
    * matrix construction.
@@ -152,8 +230,25 @@ class TimeDistanceMatrix {
   // has a vector of indexes into the destinations vector
   std::unordered_map<uint64_t, std::vector<uint32_t>> dest_edges_;
 
+  // Bit per hash of the destination edges, most settled edges have no bit
+  // set so they skip looking up dest_edges_
+  std::vector<uint64_t> dest_edge_filter_;
+
+  // Whether to stop expanding levels at the hierarchy limits of the costing
+  bool use_hierarchy_limits_;
+  std::vector<sif::HierarchyLimits> hierarchy_limits_;
+
+  // Where the destinations are, to keep expanding near the unsettled ones
+  std::vector<midgard::PointLL> dest_lls_;
+
   // Vector of edge labels (requires access by index).
-  std::vector<sif::EdgeLabel> edgelabels_;
+  Labels<sif::EdgeLabel> edgelabels_;
+
+  // Where edge label storage comes from, may be null
+  LabelArena* label_arena_;
+
+  // Called once in a while to see if the matrix should be aborted, may be null
+  const std::function<void ()>* interrupt_;
 
   // Adjacency list - approximate double bucket sort
   std::shared_ptr<baldr::DoubleBucketQueue> adjacencylist_;
@@ -165,6 +260,14 @@ class TimeDistanceMatrix {
 
   sif::TravelMode mode_;
 
+  // Searches from a source with an ISO local date time cost the edges with
+  // the historical speeds of the time they get to them, the departure being
+  // offset by some seconds for the slices of a sweep
+  bool time_dependent_;
+  uint32_t origin_second_of_week_;
+  uint32_t departure_offset_;
+  bool historical_speeds_used_;
+
   /**
    * Expand from the node along the forward search path. Immediately expands
    * from the end node of any transition edge (so no transition edges are added
@@ -204,6 +307,48 @@ class TimeDistanceMatrix {
    */
   float GetCostThreshold(const float max_matrix_distance) const;
 
+  /**
+   * Initialize the search state shared by one to many and many to one.
+   * @param  locations            Destinations of the search.
+   * @param  max_matrix_distance  Maximum arc-length distance for current mode.
+   */
+  void Initialize(const google::protobuf::RepeatedPtrField<odin::Location>& locations,
+                  const float max_matrix_distance);
+
+  /**
+   * Mark an edge as having a destination on it.
+   * @param  edgeid  Edge with a destination.
+   * @param  idx     Index of the destination.
+   */
+  void AddDestinationEdge(const uint64_t edgeid, const uint32_t idx);
+
+  /**
+   * Find the destinations on an edge.
+   * @param  edgeid  Edge to look up.
+   * @return Returns the destination indexes or nullptr if there are none.
+   */
+  std::vector<uint32_t>* FindDestinationEdge(const uint64_t edgeid) {
+    uint32_t bit = FilterBit(edgeid);
+    if (!(dest_edge_filter_[bit >> 6] & (1ull << (bit & 63))))
+      return nullptr;
+    auto destedge = dest_edges_.find(edgeid);
+    return destedge == dest_edges_.end() ? nullptr : &destedge->second;
+  }
+
+  // Bit of the destination edge filter of an edge
+  static uint32_t FilterBit(const uint64_t edgeid) {
+    return static_cast<uint32_t>((edgeid * 0x9E3779B97F4A7C15ull) >> (64 - kDestEdgeFilterBits));
+  }
+
+  /**
+   * Should expanding from a node stop because its level has run out of
+   * upward transitions and it is not near a destination left to settle.
+   * @param  graphreader  Graph tile reader.
+   * @param  node         Node to expand from.
+   * @return Returns true if the node should not be expanded.
+   */
+  bool StopExpanding(baldr::GraphReader& graphreader, const baldr::GraphId& node) const;
+
   /**
    * Sets the origin for a many to one time+distance matrix computation.
    * @param  graphreader   Graph reader for accessing routing graph.
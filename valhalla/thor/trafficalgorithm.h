@@ -16,8 +16,8 @@ namespace thor {
 /**
  * Traffic pathfinding algorithm. Note that this is just a quick proof of
  * concept for how tiled speeds could be used to influence route paths and
- * estimated times. Ideally this would be integrated into sif (costing) and
- * baldr (tile access).
+ * estimated times. The speeds come from the live traffic overlay of the
+ * graph reader, see baldr::TrafficSpeeds.
  */
 class TrafficAlgorithm : public AStarPathAlgorithm {
 public:
@@ -48,19 +48,6 @@ public:
            odin::Location& dest, baldr::GraphReader& graphreader,
            const std::shared_ptr<sif::DynamicCost>* mode_costing,
            const sif::TravelMode mode);
-
-
-protected:
-  // Map of real-time speeds
-  std::unordered_map<uint32_t, std::vector<uint8_t>> real_time_speeds_;
-  std::vector<uint8_t> empty_speeds_;
-
-  /**
-   * Get address of the real-time speed table for the specified tile.
-   * Loads the speeds if they are not yet loaded.
-   */
-  std::vector<uint8_t>& GetRealTimeSpeeds(const uint32_t tileid,
-                                          baldr::GraphReader& graphreader);
 };
 
 }
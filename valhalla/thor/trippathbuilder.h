@@ -50,6 +50,21 @@ class TripPathBuilder {
       std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>>*
         route_discontinuities = nullptr);
 
+  /**
+   * Form a columnar trip path straight from the edges on the path, for a
+   * controller whose attributes all have columns. Only the columns asked for
+   * are read from the tiles, the shape is only decoded when it or the shape
+   * indexes are asked for and no nodes, admins or times are set.
+   */
+  static odin::TripPath BuildColumns(
+      const AttributesController& controller, baldr::GraphReader& graphreader,
+      const std::shared_ptr<sif::DynamicCost>* mode_costing,
+      const std::vector<PathInfo>& path, odin::Location& origin,
+      odin::Location& dest,
+      const std::function<void ()>* interrupt_callback = nullptr,
+      std::unordered_map<size_t, std::pair<RouteDiscontinuity, RouteDiscontinuity>>*
+        route_discontinuities = nullptr);
+
   /**
    * Add trip edge. (TODO more comments)
    * @param  controller    Controller to determine which attributes to set.
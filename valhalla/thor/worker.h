@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <vector>
 #include <tuple>
+#include <chrono>
+#include <functional>
+#include <memory>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -13,15 +16,20 @@
 #include <valhalla/baldr/directededge.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/overlaygraph.h>
 #include <valhalla/sif/costfactory.h>
 #include <valhalla/sif/edgelabel.h>
 #include <valhalla/thor/bidirectional_astar.h>
 #include <valhalla/thor/astar.h>
+#include <valhalla/thor/contractionhierarchy.h>
 #include <valhalla/thor/match_result.h>
 #include <valhalla/thor/multimodal.h>
+#include <valhalla/thor/raptor.h>
 #include <valhalla/thor/trippathbuilder.h>
 #include <valhalla/thor/attributes_controller.h>
 #include <valhalla/thor/isochrone.h>
+#include <valhalla/thor/labelarena.h>
+#include <valhalla/thor/matrixcache.h>
 #include <valhalla/meili/map_matcher_factory.h>
 #include <valhalla/proto/directions_options.pb.h>
 #include <valhalla/proto/trippath.pb.h>
@@ -30,6 +38,9 @@
 namespace valhalla {
 namespace thor {
 
+// Number of differently optioned costings a worker keeps around for reuse
+constexpr size_t kDefaultCostingCacheSize = 64;
+
 #ifdef HAVE_HTTP
 void run_service(const boost::property_tree::ptree& config);
 #endif
@@ -44,7 +55,10 @@ class thor_worker_t : public service_worker_t{
   enum SOURCE_TO_TARGET_ALGORITHM {
     SELECT_OPTIMAL = 0,
     COST_MATRIX = 1,
-    TIME_DISTANCE_MATRIX = 2
+    TIME_DISTANCE_MATRIX = 2,
+    BUCKET_MATRIX = 3,
+    SWEEP_MATRIX = 4,
+    OVERLAY_MATRIX = 5
   };
   static const std::unordered_map<std::string, SHAPE_MATCH> STRING_TO_MATCH;
   thor_worker_t(const boost::property_tree::ptree& config);
@@ -54,7 +68,10 @@ class thor_worker_t : public service_worker_t{
 #endif
   virtual void cleanup() override;
 
-  std::list<odin::TripPath> route(valhalla_request_t& request);
+  // Alternates are only asked for with a summary, the paths of which keep just
+  // the time, length and shape of the legs in columns
+  std::list<odin::TripPath> route(valhalla_request_t& request,
+      std::list<odin::TripPath>* alternates = nullptr);
   std::string matrix(valhalla_request_t& request);
   std::list<odin::TripPath> optimized_route(valhalla_request_t& request);
   std::string isochrones(valhalla_request_t& request);
@@ -63,12 +80,42 @@ class thor_worker_t : public service_worker_t{
 
  protected:
 
-  std::vector<thor::PathInfo> get_path(PathAlgorithm* path_algorithm, odin::Location& origin,
-      odin::Location& destination, const std::string& costing);
+  // What routing the legs between two break locations needs from one thread
+  struct leg_router_t {
+    baldr::GraphReader& reader;
+    valhalla::sif::cost_ptr_t* mode_costing;
+    AStarPathAlgorithm& astar;
+    BidirectionalAStar& bidir_astar;
+    ContractionHierarchy& ch_path;
+    const std::function<void ()>* interrupt;
+    // Add the search time to the request stats, only on the worker's own thread
+    bool timed;
+    // What the trip paths are built with
+    const AttributesController& controller;
+  };
+
+  // Path algorithms and costings of an extra thread that routes legs, kept
+  // from one request to the next
+  struct leg_thread_t {
+    leg_thread_t(const size_t label_arena_size);
+    LabelArena label_arena;
+    AStarPathAlgorithm astar;
+    BidirectionalAStar bidir_astar;
+    ContractionHierarchy ch_path;
+    valhalla::sif::cost_ptr_t mode_costing[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
+  };
+
+  leg_router_t get_leg_router(const AttributesController& controller);
+  std::vector<thor::PathInfo> get_path(leg_router_t& router, PathAlgorithm* path_algorithm,
+      odin::Location& origin, odin::Location& destination, const std::string& costing,
+      std::vector<std::vector<thor::PathInfo>>* alternates = nullptr,
+      const uint32_t alternate_count = 0);
   void log_admin(const odin::TripPath&);
   valhalla::sif::cost_ptr_t get_costing(
       const rapidjson::Document& request, const std::string& costing);
-  thor::PathAlgorithm* get_path_algorithm(
+  std::string get_costing_key(
+      const rapidjson::Document& request, const std::string& costing);
+  thor::PathAlgorithm* get_path_algorithm(leg_router_t& router,
       const std::string& routetype, const odin::Location& origin,
       const odin::Location& destination);
   odin::TripPath route_match(valhalla_request_t& request, const AttributesController& controller);
@@ -76,33 +123,82 @@ class thor_worker_t : public service_worker_t{
       valhalla_request_t& request, const AttributesController& controller, uint32_t best_paths = 1);
 
   std::list<odin::TripPath> path_arrive_by(
-      google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing);
+      google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing,
+      const AttributesController& controller);
   std::list<odin::TripPath> path_depart_at(
-      google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing);
+      google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing,
+      const AttributesController& controller, std::list<odin::TripPath>* alternates = nullptr,
+      const uint32_t alternate_count = 0);
+  std::list<odin::TripPath> depart_at_legs(leg_router_t& router,
+      google::protobuf::RepeatedPtrField<valhalla::odin::Location>& correlated, const std::string &costing,
+      std::list<odin::TripPath>* alternates = nullptr, const uint32_t alternate_count = 0);
 
   void parse_locations(valhalla_request_t& request);
   void parse_measurements(const valhalla_request_t& request);
   void parse_trace_config(const valhalla_request_t& request);
   std::string parse_costing(const valhalla_request_t& request);
   void filter_attributes(const valhalla_request_t& request, AttributesController& controller);
+  void track_stats(valhalla_request_t& request);
+  void add_search_time(const std::chrono::steady_clock::time_point& start);
+  void finish_stats();
 
   valhalla::sif::TravelMode mode;
   std::vector<meili::Measurement> trace;
   sif::CostFactory<sif::DynamicCost> factory;
+  // Costings built so far keyed on costing and options, requests get copies of them
+  std::unordered_map<std::string, valhalla::sif::cost_ptr_t> costing_cache;
+  size_t costing_cache_size;
   valhalla::sif::cost_ptr_t mode_costing[static_cast<int>(sif::TravelMode::kMaxTravelMode)];
+  // Edge label storage reused by the path algorithms from one request to the next
+  LabelArena label_arena;
+  // Size the extra leg routing threads give their own arenas
+  size_t label_arena_size;
   // Path algorithms (TODO - perhaps use a map?))
   AStarPathAlgorithm astar;
   BidirectionalAStar bidir_astar;
   MultiModalPathAlgorithm multi_modal_astar;
+  RaptorPathAlgorithm raptor;
+  ContractionHierarchy ch_path;
+  // Contraction hierarchy overlays by costing, used when the costing options aren't changed
+  std::unordered_map<std::string, std::shared_ptr<const baldr::CHGraph> > contraction_hierarchies;
+  // Landmark tables by costing for the A* heuristics, also only for the default costing options
+  std::unordered_map<std::string, std::shared_ptr<const baldr::Landmarks> > landmarks;
+  // Boundary overlays by costing for the overlay matrix, also only for the default costing options
+  std::unordered_map<std::string, std::shared_ptr<const baldr::OverlayGraph> > overlays;
+  // Overlay of the costing of the current request, null if there is none
+  std::shared_ptr<const baldr::OverlayGraph> overlay;
   Isochrone isochrone_gen;
+  // Reverse expansion of isochrones asked for in both directions, never cached
+  Isochrone reverse_isochrone_gen;
   std::shared_ptr<meili::MapMatcher> matcher;
   float long_request;
-  std::unordered_map<std::string, float> max_matrix_distance;
+  service_limits_t service_limits;
+  // Cells of earlier matrices so later ones only search for what is missing
+  MatrixCache matrix_cache;
   SOURCE_TO_TARGET_ALGORITHM source_to_target_algorithm;
+  // Have the time distance matrix stop expanding levels at the hierarchy limits
+  bool matrix_hierarchy_limits;
+  // Route multimodal and transit requests with raptor rather than multi_modal_astar
+  bool raptor_transit;
+  // Threads the bucket matrix searches with, 0 for one per core
+  uint32_t matrix_threads;
+  // Graph readers of the extra threads the cost matrix searches with
+  std::vector<std::unique_ptr<baldr::GraphReader> > matrix_readers;
+  // Extra threads routing the legs between breaks use the matrix readers too
+  std::vector<std::unique_ptr<leg_thread_t> > leg_threads;
+  // Annealing chains the optimized route runs concurrently
+  uint32_t optimizer_chains;
   valhalla::meili::MapMatcherFactory matcher_factory;
   valhalla::baldr::GraphReader& reader;
   std::unordered_set<std::string> trace_customizable;
   boost::property_tree::ptree trace_config;;
+  // Budgets of the heavy actions shared by all the workers of the process
+  admission_t admission;
+  // Bytes of edge labels and statuses a request may allocate, 0 for no limit
+  size_t memory_budget;
+  // Where the work of the current request is counted, null unless it asked for stats
+  odin::SearchStats* search_stats;
+  std::chrono::steady_clock::time_point search_stats_start;
 };
 
 }
@@ -2,16 +2,57 @@
 #define VALHALLA_TYR_ACTOR_H_
 
 #include <boost/property_tree/ptree.hpp>
+#include <functional>
 #include <memory>
 #include <unordered_map>
 
+#include <valhalla/worker.h>
+#include <valhalla/proto/tripdirections.pb.h>
+#include <valhalla/proto/trippath.pb.h>
+
 namespace valhalla {
   namespace tyr {
 
+#ifdef HAVE_HTTP
+    /**
+     * Runs loki, thor and odin as a single in process stage behind the http
+     * server. Each request goes through every stage on the same thread with
+     * its options and paths handed along by move, instead of hopping through
+     * a proxy and being reserialized between each of them.
+     */
+    void run_service(const boost::property_tree::ptree& config);
+#endif
+
     class actor_t {
      public:
       actor_t(const boost::property_tree::ptree& config, bool auto_cleanup = false);
       void cleanup();
+
+      /**
+       * Runs a parsed request through every stage it needs in process. This is
+       * what the other actions and any front end, network or not, go through.
+       * @param  request    the request, its action says what to do with it
+       * @param  interrupt  called periodically, throws to stop processing
+       * @return the serialized response
+       */
+      std::string act(valhalla_request_t& request, const std::function<void ()>& interrupt = []()->void{});
+      /**
+       * Runs a route, optimized_route or trace_route request through every stage in process
+       * and hands back what they made instead of serializing it. Together with a request made
+       * from prebuilt options there is no json or protobuf string anywhere along the way
+       * @param  request    the request, its action says what to do with it
+       * @param  legs       filled in with the path of each leg
+       * @param  interrupt  called periodically, throws to stop processing
+       * @return the directions of each leg
+       */
+      std::list<odin::TripDirections> directions(valhalla_request_t& request, std::list<odin::TripPath>& legs,
+        const std::function<void ()>& interrupt = []()->void{});
+#ifdef HAVE_HTTP
+      /**
+       * The work function of the in process prime_server stage
+       */
+      worker_t::result_t work(const std::list<zmq::message_t>& job, void* request_info, const std::function<void ()>& interrupt);
+#endif
       std::string route(const std::string& request_str, const std::function<void ()>& interrupt = []()->void{});
       std::string locate(const std::string& request_str, const std::function<void ()>& interrupt = []()->void{});
       std::string matrix(const std::string& request_str, const std::function<void ()>& interrupt = []()->void{});
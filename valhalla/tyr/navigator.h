@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 
 #include <valhalla/baldr/json.h>
 #include <valhalla/baldr/location.h>
@@ -43,6 +44,13 @@ constexpr uint32_t kFinalMediumTransitionAlertMinSpeed = 10; // ~22.4 MPH
 constexpr uint32_t kPostTransitionLowerBound = 2;
 constexpr uint32_t kPostTransitionUpperBound = 6;
 
+// Length in meters of the route, from the current shape index, searched for
+// the closest point before falling back to the shape cells
+constexpr float kSnapWindowLength = 2000.0f;
+
+// Size in degrees of the cells the leg shape segments are indexed by
+constexpr float kShapeCellSize = 0.01f;
+
 // Closest point tuple indexes
 constexpr size_t kClosestPoint = 0;
 constexpr size_t kClosestPointDistance = 1;
@@ -167,6 +175,16 @@ class Navigator {
      */
     NavigationStatus SetRoute(const std::string& route_json_str);
 
+    /**
+     * Sets the route path for the navigator to process from a route that
+     * has already been parsed, such as one built by the route serializer.
+     *
+     * @param  route  The route to navigate.
+     *
+     * @return a NavigationStatus_RouteState_kInitialized route state.
+     */
+    NavigationStatus SetRoute(const Route& route);
+
     /**
      * Passes in the current fix location of the user. This method will snap
      * the location to the route and verify that the user is still on the route.
@@ -184,6 +202,14 @@ class Navigator {
 
   protected:
 
+    /**
+     * Initializes the navigator state for the first leg of the route that
+     * has been set.
+     *
+     * @return a NavigationStatus_RouteState_kInitialized route state.
+     */
+    NavigationStatus InitializeRoute();
+
     /**
      * Assigns the kilometer units boolean based on the value specified
      * in the route.
@@ -203,6 +229,28 @@ class Navigator {
      */
     void InitializeShapeLengthTime();
 
+    /**
+     * Indexes the segments of the leg shape by the cells they cover so the
+     * closest point to a fix far from the current shape index can be found
+     * without scanning the rest of the shape.
+     */
+    void InitializeShapeCells();
+
+    /**
+     * Finds the closest point on the leg shape, at or after the current shape
+     * index, to the specified point. The shape just ahead of the current index
+     * is searched first and if it is not within the off route threshold then
+     * the segments in the cells near the point are checked.
+     *
+     * @param  fix_pt  The point to snap.
+     *
+     * @return tuple of <Closest point along the shape,
+     *                   Distance in meters of the closest point,
+     *                   Index of the segment of the shape which contains the closest point >
+     */
+    std::tuple<midgard::PointLL, float, int> FindClosestPoint(
+        const midgard::PointLL& fix_pt) const;
+
     /**
      * Initializes the used instruction boolean values for each maneuver and
      * instruction type.
@@ -605,6 +653,9 @@ class Navigator {
     // Current shape index
     size_t current_shape_index_;
 
+    // Segments of the current leg shape by the cells they cover
+    std::unordered_map<uint64_t, std::vector<uint32_t>> shape_cells_;
+
     // Maneuver speeds in units per second
     std::vector<float> maneuver_speeds_;
 
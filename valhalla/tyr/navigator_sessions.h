@@ -0,0 +1,98 @@
+#ifndef VALHALLA_TYR_NAVIGATOR_SESSIONS_H_
+#define VALHALLA_TYR_NAVIGATOR_SESSIONS_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <valhalla/tyr/navigator.h>
+#include <valhalla/proto/route.pb.h>
+#include <valhalla/proto/navigator.pb.h>
+
+namespace valhalla {
+namespace tyr {
+
+// Default number of shards the sessions are split into
+constexpr size_t kDefaultSessionShards = 64;
+
+// A fix location reported by a vehicle
+struct VehicleFix {
+  std::string vehicle_id;
+  FixLocation fix_location;
+};
+
+/**
+ * Holds the navigators of many vehicles at once, keyed by vehicle Id, so a
+ * service can feed each vehicle's fix locations to its own navigator. The
+ * sessions are split into shards that each have their own lock, so several
+ * threads can process fixes at the same time as long as the vehicles fall
+ * in different shards. A batch of fixes locks each shard it touches once.
+ */
+class NavigatorSessions {
+ public:
+  /**
+   * Constructor.
+   * @param  shard_count  Number of shards to split the sessions into.
+   */
+  NavigatorSessions(const size_t shard_count = kDefaultSessionShards);
+
+  /**
+   * Starts navigating a route for a vehicle, replacing any session the
+   * vehicle already has.
+   * @param  vehicle_id  Id of the vehicle.
+   * @param  route       Route for the vehicle to navigate.
+   * @return the navigation status from setting the route.
+   */
+  NavigationStatus Start(const std::string& vehicle_id, const Route& route);
+
+  /**
+   * Ends the session of a vehicle.
+   * @param  vehicle_id  Id of the vehicle.
+   * @return true if the vehicle had a session.
+   */
+  bool End(const std::string& vehicle_id);
+
+  /**
+   * Passes the current fix location of a vehicle to its navigator.
+   * @param  vehicle_id    Id of the vehicle.
+   * @param  fix_location  The current fix location of the vehicle.
+   * @return the navigation status of the vehicle, with an invalid route
+   *         state if the vehicle has no session.
+   */
+  NavigationStatus OnLocationChanged(const std::string& vehicle_id,
+                                     const FixLocation& fix_location);
+
+  /**
+   * Passes a batch of fix locations to the navigators of their vehicles.
+   * Fixes of the same vehicle are processed in the order of the batch.
+   * @param  fixes  Fix locations of the vehicles.
+   * @return the navigation status for each fix, in the order of the batch.
+   */
+  std::vector<NavigationStatus> OnLocationChanged(
+      const std::vector<VehicleFix>& fixes);
+
+  /**
+   * Get the number of active sessions.
+   * @return Returns the number of vehicles with a session.
+   */
+  size_t size() const;
+
+ protected:
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Navigator> sessions;
+  };
+
+  // Shard that holds the session of a vehicle
+  size_t ShardIndex(const std::string& vehicle_id) const;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}
+}
+
+#endif  // VALHALLA_TYR_NAVIGATOR_SESSIONS_H_
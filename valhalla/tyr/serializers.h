@@ -35,6 +35,30 @@ namespace valhalla {
         const std::list<odin::TripPath>& path_legs,
         const std::list<odin::TripDirections>& directions_legs);
 
+    /**
+     * Whether a route should be serialized from its paths alone, without
+     * odin building maneuvers and narrative for it. Only the formats that
+     * need no directions can be.
+     *
+     * @param options  The options of the request
+     */
+    inline bool summaryOnly(const odin::DirectionsOptions& options) {
+      return options.summary_only() && (options.format() == odin::DirectionsOptions::json ||
+                                        options.format() == odin::DirectionsOptions::gpx);
+    }
+
+    /**
+     * Turn paths into a route with the time, length and shape of the trip and
+     * each of its legs but no maneuvers
+     *
+     * @param request     The original request
+     * @param path_legs   The path of each leg
+     * @param alternates  The path of each alternate trip, json only
+     */
+    std::string serializeSummary(const valhalla_request_t& request,
+        const std::list<odin::TripPath>& path_legs,
+        const std::list<odin::TripPath>& alternates = {});
+
     /**
      * Turn a time distance matrix into json that one can look up location pair results from
      *
@@ -43,14 +67,51 @@ namespace valhalla {
     std::string serializeMatrix(const valhalla_request_t& request,
         const std::vector<thor::TimeDistance>& time_distances, double distance_scale);
 
+    /**
+     * Turn the time distance matrices of a sweep over departure times into
+     * json, valhalla's own format whatever the format of the request
+     *
+     * @param slices    The matrix of each departure time, in order
+     * @param interval  Seconds between the departure times
+     */
+    std::string serializeMatrixSlices(const valhalla_request_t& request,
+        const std::vector<std::vector<thor::TimeDistance> >& slices, uint32_t interval, double distance_scale);
+
     /**
      * Turn grid data contours into geojson
      *
      * @param grid_contours    the contours generated from the grid
      * @param colors           the #ABC123 hex string color used in geojson fill color
+     * @param reverse_contours the contours of the reverse expansion, if any. The features
+     *                         of both are then marked with the direction they are for
      */
     template <class coord_t>
     std::string serializeIsochrones(const valhalla_request_t& request, const typename midgard::GriddedData<coord_t>::contours_t& grid_contours,
+        bool polygons = true, const std::unordered_map<float, std::string>& colors = {}, bool show_locations = false,
+        const typename midgard::GriddedData<coord_t>::contours_t* reverse_contours = nullptr);
+
+    /**
+     * Turn the grid itself into a 16 bit grayscale png, for heatmaps that don't
+     * need it contoured. Each pixel is the seconds it takes to reach its tile, the
+     * northernmost row first, 65535 where it isn't reached within the time. The
+     * bounds of the raster are kept in a text chunk as minx,miny,maxx,maxy
+     *
+     * @param grid         the minutes to reach each tile
+     * @param max_minutes  the tiles that take this long or longer count as not reached
+     */
+    template <class coord_t>
+    std::string serializeIsochroneRaster(const midgard::GriddedData<coord_t>& grid, const float max_minutes);
+
+    /**
+     * Turn the contours of the catchment of each origin into geojson, the
+     * features are marked with the index of the origin they are nearest to
+     *
+     * @param origin_contours  the contours of each origin's part of the grid
+     * @param colors           the #ABC123 hex string color used in geojson fill color
+     */
+    template <class coord_t>
+    std::string serializeCatchments(const valhalla_request_t& request,
+        const std::vector<typename midgard::GriddedData<coord_t>::contours_t>& origin_contours,
         bool polygons = true, const std::unordered_map<float, std::string>& colors = {}, bool show_locations = false);
 
     /**
@@ -63,6 +124,18 @@ namespace valhalla {
     std::string serializeHeight(const valhalla_request_t& request,
         const std::vector<double>& heights, std::vector<float> ranges = {});
 
+    /**
+     * Turn the heights and ranges of several shapes into a height response,
+     * written straight out rather than built up as json first
+     *
+     * @param request  The original request
+     * @param shapes   The encoded polyline of each shape
+     * @param heights  The actual height at each point of each shape
+     * @param ranges   The distances between the points of each shape. If they are empty no ranges are serialized
+     */
+    std::string serializeHeightBatch(const valhalla_request_t& request, const std::vector<std::string>& shapes,
+        const std::vector<std::vector<double> >& heights, const std::vector<std::vector<float> >& ranges);
+
     /**
      * Turn some correlated points on the graph into info about those locations
      *
@@ -102,6 +175,13 @@ namespace valhalla {
      *                     from the JSON string
      */
     void jsonToProtoRoute(const std::string& json_route, Route& proto_route);
+
+    /**
+     * Turn the statistics thor kept of the work it did for a request into json
+     *
+     * @param stats  The search statistics of the request
+     */
+    baldr::json::MapPtr serializeSearchStats(const odin::SearchStats& stats);
   }
 }
 
@@ -1,16 +1,21 @@
 #ifndef __VALHALLA_SERVICE_H__
 #define __VALHALLA_SERVICE_H__
 
+#include <array>
+#include <chrono>
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <memory>
 
 #include <boost/optional.hpp>
+#include <boost/property_tree/ptree.hpp>
 
 #include <valhalla/valhalla.h>
 #include <valhalla/exception.h>
 #include <valhalla/baldr/json.h>
 #include <valhalla/baldr/rapidjson_utils.h>
+#include <valhalla/midgard/tracing.h>
 #include <valhalla/proto/directions_options.pb.h>
 
 #ifdef HAVE_HTTP
@@ -27,6 +32,12 @@ namespace valhalla {
     odin::DirectionsOptions options;
 
     valhalla_request_t();
+    /**
+     * A request whose options were built directly rather than parsed from json, for programs
+     * embedding the pipeline. Anything only json carries, like costing options, gets its default
+     * @param  options  the options of the request, the action among them
+     */
+    explicit valhalla_request_t(const odin::DirectionsOptions& options);
     void parse(const std::string& request, odin::DirectionsOptions::Action action);
     void parse(const std::string& request, const std::string& serialized_options);
 #ifdef HAVE_HTTP
@@ -34,12 +45,183 @@ namespace valhalla {
 #endif
   };
 
+  /**
+   * Keeps how much work of each action is in flight across all the workers of the process under
+   * a budget so that a flood of heavy requests, say large matrices, can't take every worker away
+   * from the quick ones. A request costs sources * targets for a matrix, locations squared for an
+   * optimized route, the number of shape points for a trace and the number of locations otherwise.
+   * A request is turned away when the work already in flight plus its own would go over the budget
+   * of its action, unless nothing of that action is in flight so a single request always runs.
+   */
+  class admission_t {
+   public:
+    /**
+     * Gives the cost of an admitted request back to the budget once it goes out of scope
+     */
+    class ticket_t {
+     public:
+      ticket_t(ticket_t&& other);
+      ~ticket_t();
+     protected:
+      friend class admission_t;
+      ticket_t(int action, uint64_t cost);
+      int action;
+      uint64_t cost;
+    };
+
+    /**
+     * @param  config  budget of each action by name, actions without one or with 0 are not limited
+     */
+    admission_t(const boost::property_tree::ptree& config);
+
+    /**
+     * Admit a request or throw if there is too much of its kind of work in flight
+     * @param  options  the parsed options of the request
+     * @return the ticket to hold on to for as long as the request is being worked on
+     */
+    ticket_t admit(const odin::DirectionsOptions& options) const;
+
+    /**
+     * The cost of a request as counted against the budget of its action
+     * @param  options  the parsed options of the request
+     */
+    static uint64_t cost(const odin::DirectionsOptions& options);
+
+   protected:
+    std::unordered_map<int, uint64_t> budgets;
+  };
+
+  /**
+   * Shares the responses of identical requests between the workers of a process. With coalescing a request
+   * that comes in while an identical one is being worked on waits for its response instead of being worked on
+   * again, and with a cache size responses are also kept for a short while for identical requests that come right
+   * after. Requests are identical when their options, save for the deadline, their json and the version of the
+   * tiles are. Should the request waited on fail, those waiting on it are worked on after all
+   */
+  class response_cache_t {
+   public:
+    /**
+     * @param  config  the httpd.service config, coalesce turns on waiting for identical requests in flight
+     *                 and response_cache_size and response_cache_seconds size the cache, a size of 0 for none
+     */
+    response_cache_t(const boost::property_tree::ptree& config);
+
+    /**
+     * Get the response of a request, made by the work function unless it can be shared
+     * @param  request       the parsed request
+     * @param  tile_version  version of the tiles the response is made from
+     * @param  work          makes the response
+     * @return the response
+     */
+    std::string get(const valhalla_request_t& request, uint64_t tile_version,
+                    const std::function<std::string ()>& work) const;
+
+    /**
+     * The key of a request, the same for every request identical to it
+     * @param  request       the parsed request
+     * @param  tile_version  version of the tiles the response is made from
+     */
+    static std::string key(const valhalla_request_t& request, uint64_t tile_version);
+
+   protected:
+    bool coalesce;
+    size_t max_size;
+    std::chrono::steady_clock::duration max_age;
+  };
+
+  /**
+   * The span of a stage (loki, thor, odin or all of them in process) of a traced request. While in scope the
+   * timed parts of the stage, like the searches and path algorithms, are recorded as its children and when it
+   * goes out of scope every span of the stage is logged as a json line tagged [TRACE]. The time the request
+   * waited between the previous stage handing it on and this one starting it, in the proxy between them, is
+   * recorded as a span of its own. Requests are traced when the client sent a sampled w3c traceparent header
+   * or, at the sample rate, when it sent none. Nothing is recorded for the rest
+   */
+  class stage_trace_t {
+   public:
+    /**
+     * @param  stage        name of the stage, its span is named after it
+     * @param  options      options of the request, whose trace context is advanced to this stage
+     * @param  sample_rate  the fraction of the requests not traced yet to start a trace for, only the first stage
+     *                      should pass one
+     */
+    stage_trace_t(const std::string& stage, odin::DirectionsOptions& options, float sample_rate = 0);
+    ~stage_trace_t();
+    stage_trace_t(const stage_trace_t&) = delete;
+    stage_trace_t& operator=(const stage_trace_t&) = delete;
+
+    /**
+     * Serialize the options to hand the request on to the next stage
+     * @param  options  options of the request
+     * @return the serialized options
+     */
+    std::string forward(odin::DirectionsOptions& options) const;
+
+   protected:
+    midgard::tracing::trace_t trace;
+    std::unique_ptr<midgard::tracing::ScopedTrace> scope;
+    std::unique_ptr<midgard::tracing::ScopedSpan> span;
+  };
+
+  /**
+   * The service limits of the config resolved once into tables indexed by the costing or the
+   * action of a request, so checking a request against them doesn't hash any strings. Every
+   * costing and action the config has limits for must have all of them, the rest have none of
+   * their own and keep 0 for each
+   */
+  class service_limits_t {
+   public:
+    struct limits_t {
+      size_t max_locations;
+      float max_distance;
+      float max_matrix_distance;
+      size_t max_matrix_locations;
+    };
+
+    /**
+     * @param  config  the service_limits of the config
+     */
+    service_limits_t(const boost::property_tree::ptree& config);
+
+    /**
+     * The limits of a costing, those of its routes and matrices
+     * @param  costing  the costing of the request
+     */
+    const limits_t& costing(odin::DirectionsOptions::Costing costing) const {
+      return costings[costing];
+    }
+
+    /**
+     * The limits of an action whose limits don't depend on the costing, isochrones and traces
+     * @param  action  the action of the request
+     */
+    const limits_t& action(odin::DirectionsOptions::Action action) const {
+      return actions[action];
+    }
+
+   protected:
+    std::array<limits_t, odin::DirectionsOptions::Costing_ARRAYSIZE> costings;
+    std::array<limits_t, odin::DirectionsOptions::Action_ARRAYSIZE> actions;
+  };
+
 #ifdef HAVE_HTTP
   worker_t::result_t jsonify_error(const valhalla_exception_t& exception, http_request_info_t& request_info, const valhalla_request_t& options);
   worker_t::result_t to_response(baldr::json::ArrayPtr array, http_request_info_t& request_info, const valhalla_request_t& options);
   worker_t::result_t to_response(baldr::json::MapPtr map, http_request_info_t& request_info, const valhalla_request_t& options);
   worker_t::result_t to_response_json(const std::string& json, http_request_info_t& request_info, const valhalla_request_t& options);
   worker_t::result_t to_response_xml(const std::string& xml, http_request_info_t& request_info, const valhalla_request_t& options);
+  worker_t::result_t to_response_pbf(const std::string& pbf, http_request_info_t& request_info, const valhalla_request_t& options);
+  worker_t::result_t to_response_png(const std::string& png, http_request_info_t& request_info, const valhalla_request_t& options);
+  worker_t::result_t to_response_metrics(http_request_info_t& request_info);
+  worker_t::result_t to_response_proxied(long status, const std::string& content_type, const std::string& body, http_request_info_t& request_info);
+
+  /**
+   * Gzip the successful responses of the process for clients whose Accept-Encoding takes it. Only the first call
+   * of the process counts, so each stage can call it when it starts
+   * @param  config  the httpd.service config, gzip_min_size is the smallest body to compress, 0 to compress none,
+   *                 with gzip_level and bodies of gzip_large_size or more with gzip_large_level instead
+   */
+  void configure_compression(const boost::property_tree::ptree& config);
 #endif
 
   class service_worker_t {
@@ -68,11 +250,14 @@ namespace valhalla {
     /**
      * A function which may or may not be called periodically and show throw if computation is supposed to be halted
      * @param  interrupt    the function to be called which should throw
+     * @param  deadline     milliseconds since the epoch after which the interrupt throws too, 0 for none.
+     *                      throws right away if the deadline has already passed
      */
-    virtual void set_interrupt(const std::function<void ()>& interrupt) final;
+    virtual void set_interrupt(const std::function<void ()>& interrupt, uint64_t deadline = 0) final;
 
    protected:
     const std::function<void ()>* interrupt;
+    std::function<void ()> deadline_interrupt;
 
   };
 }